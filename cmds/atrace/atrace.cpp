@@ -42,6 +42,7 @@
 #include <hidl/ServiceManagement.h>
 
 #include <pdx/default_transport/service_utility.h>
+#include <log/log.h>
 #include <utils/String8.h>
 #include <utils/Timers.h>
 #include <utils/Tokenizer.h>
@@ -302,6 +303,7 @@ static bool g_tracePdx = false;
 static bool g_traceAborted = false;
 static bool g_categoryEnables[arraysize(k_categories)] = {};
 static std::string g_traceFolder;
+static int g_traceFolderFd = -1;
 static std::vector<TracingVendorFileCategory> g_vendorFileCategories;
 static sp<IAtraceDevice> g_atraceHal;
 static std::vector<TracingVendorHalCategory> g_vendorHalCategories;
@@ -349,14 +351,17 @@ static const char* k_traceStreamPath =
 static const char* k_traceMarkerPath =
     "trace_marker";
 
+static const char* k_setEventPath =
+    "set_event";
+
 // Check whether a file exists.
 static bool fileExists(const char* filename) {
-    return access((g_traceFolder + filename).c_str(), F_OK) != -1;
+    return faccessat(g_traceFolderFd, filename, F_OK, 0) != -1;
 }
 
 // Check whether a file is writable.
 static bool fileIsWritable(const char* filename) {
-    return access((g_traceFolder + filename).c_str(), W_OK) != -1;
+    return faccessat(g_traceFolderFd, filename, W_OK, 0) != -1;
 }
 
 // Truncate a file.
@@ -380,7 +385,7 @@ static bool truncateFile(const char* path)
 static bool _writeStr(const char* filename, const char* str, int flags)
 {
     std::string fullFilename = g_traceFolder + filename;
-    int fd = open(fullFilename.c_str(), flags);
+    int fd = openat(g_traceFolderFd, filename, flags | O_CLOEXEC);
     if (fd == -1) {
         fprintf(stderr, "error opening %s: %s (%d)\n", fullFilename.c_str(),
                 strerror(errno), errno);
@@ -445,6 +450,74 @@ static bool setKernelOptionEnable(const char* filename, bool enable)
     return writeStr(filename, enable ? "1" : "0");
 }
 
+// Read whether a kernel option is enabled: 1 or 0, or -1 if its state isn't
+// known, e.g. for the enable file of an event group with both enabled and
+// disabled events.
+static int getKernelOptionEnable(const char* filename)
+{
+    int fd = openat(g_traceFolderFd, filename, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    char buf[4] = {};
+    ssize_t len = read(fd, buf, sizeof(buf));
+    close(fd);
+    if (len == 2 && buf[1] == '\n' && (buf[0] == '0' || buf[0] == '1')) {
+        return buf[0] - '0';
+    }
+    return -1;
+}
+
+// Convert the path of an event enable file to its name in set_event, e.g.
+// "events/sched/sched_switch/enable" to "sched:sched_switch" and
+// "events/irq/enable" to "irq:*". Returns false for the other files.
+static bool getSetEventName(const std::string& path, std::string* name)
+{
+    std::vector<std::string> parts = android::base::Split(path, "/");
+    if (parts.size() < 3 || parts.size() > 4 || parts.front() != "events" ||
+            parts.back() != "enable") {
+        return false;
+    }
+    *name = parts[1] + ":" + (parts.size() == 4 ? parts[2] : "*");
+    return true;
+}
+
+// Set the kernel options to the given state, writing only the options whose
+// state differs. The event enables are written to set_event in a single write
+// when it is writable, which is much faster than writing each enable file.
+static bool setKernelOptionsEnable(const std::vector<std::string>& paths, bool enable)
+{
+    std::vector<const std::string*> changes;
+    std::string setEvents;
+    bool batched = fileIsWritable(k_setEventPath);
+    for (const std::string& path : paths) {
+        if (getKernelOptionEnable(path.c_str()) == (enable ? 1 : 0)) {
+            continue;
+        }
+        changes.push_back(&path);
+        std::string name;
+        if (batched && getSetEventName(path, &name)) {
+            setEvents += (enable ? "" : "!") + name + "\n";
+        } else {
+            batched = false;
+        }
+    }
+    if (changes.empty()) {
+        return true;
+    }
+    // set_event is truncated (disabling all of the events) unless it's
+    // appended to.
+    if (batched && appendStr(k_setEventPath, setEvents.c_str())) {
+        return true;
+    }
+
+    bool ok = true;
+    for (const std::string* path : changes) {
+        ok &= setKernelOptionEnable(path->c_str(), enable);
+    }
+    return ok;
+}
+
 // Check whether the category is supported on the device with the current
 // rootness.  A category is supported only if all its required /sys/ files are
 // writable and if enabling the category will enable one or more tracing tags
@@ -633,24 +706,24 @@ static bool setAppCmdlineProperty(char* cmdline)
 
 // Disable all /sys/ enable files.
 static bool disableKernelTraceEvents() {
-    bool ok = true;
+    std::vector<std::string> paths;
     for (size_t i = 0; i < arraysize(k_categories); i++) {
         const TracingCategory &c = k_categories[i];
         for (int j = 0; j < MAX_SYS_FILES; j++) {
             const char* path = c.sysfiles[j].path;
             if (path != nullptr && fileIsWritable(path)) {
-                ok &= setKernelOptionEnable(path, false);
+                paths.push_back(path);
             }
         }
     }
     for (const TracingVendorFileCategory& c : g_vendorFileCategories) {
         for (const std::string& path : c.ftrace_enable_paths) {
             if (fileIsWritable(path.c_str())) {
-                ok &= setKernelOptionEnable(path.c_str(), false);
+                paths.push_back(path);
             }
         }
     }
-    return ok;
+    return setKernelOptionsEnable(paths, false);
 }
 
 // Verify that the comma separated list of functions are being traced by the
@@ -861,6 +934,7 @@ static bool setUpKernelTracing()
     ok &= disableKernelTraceEvents();
 
     // Enable all the sysfs enables that are in an enabled category.
+    std::vector<std::string> paths;
     for (size_t i = 0; i < arraysize(k_categories); i++) {
         if (g_categoryEnables[i]) {
             const TracingCategory &c = k_categories[i];
@@ -869,7 +943,7 @@ static bool setUpKernelTracing()
                 bool required = c.sysfiles[j].required == REQ;
                 if (path != nullptr) {
                     if (fileIsWritable(path)) {
-                        ok &= setKernelOptionEnable(path, true);
+                        paths.push_back(path);
                     } else if (required) {
                         fprintf(stderr, "error writing file %s\n", path);
                         ok = false;
@@ -883,11 +957,12 @@ static bool setUpKernelTracing()
         if (c.enabled) {
             for (const std::string& path : c.ftrace_enable_paths) {
                 if (fileIsWritable(path.c_str())) {
-                    ok &= setKernelOptionEnable(path.c_str(), true);
+                    paths.push_back(path);
                 }
             }
         }
     }
+    ok &= setKernelOptionsEnable(paths, true);
 
     return ok;
 }
@@ -1133,6 +1208,14 @@ bool findTraceFiles()
         g_traceFolder = debugfs_path;
     }
 
+    // Keep the folder open so that the files in it are looked up from there.
+    g_traceFolderFd = open(g_traceFolder.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (g_traceFolderFd == -1) {
+        fprintf(stderr, "error opening %s: %s (%d)\n", g_traceFolder.c_str(), strerror(errno),
+                errno);
+        return false;
+    }
+
     return true;
 }
 
@@ -1377,6 +1460,7 @@ int main(int argc, char **argv)
     }
 
     bool ok = true;
+    nsecs_t setUpStart = systemTime(CLOCK_MONOTONIC);
 
     if (traceStart) {
         ok &= setUpUserspaceTracing();
@@ -1388,6 +1472,11 @@ int main(int argc, char **argv)
         ok &= startTrace();
     }
 
+    if (traceStart) {
+        ALOGI("setting up tracing took %" PRId64 "ms",
+              ns2ms(systemTime(CLOCK_MONOTONIC) - setUpStart));
+    }
+
     if (ok && traceStart) {
 
         if (!traceStream && !onlyUserspace) {
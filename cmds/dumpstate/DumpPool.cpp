@@ -18,6 +18,9 @@
 
 #include "DumpPool.h"
 
+#include <sys/sysinfo.h>
+
+#include <algorithm>
 #include <array>
 #include <thread>
 
@@ -58,7 +61,9 @@ DumpPool::~DumpPool() {
     if (shutdown_ || threads_.empty()) {
         return;
     }
-    while (!tasks_.empty()) tasks_.pop();
+    for (auto& tasks : tasks_) {
+        while (!tasks.empty()) tasks.pop();
+    }
 
     shutdown_ = true;
     condition_variable_.notify_all();
@@ -69,15 +74,15 @@ DumpPool::~DumpPool() {
     }
     threads_.clear();
     deleteTempFiles(tmp_root_);
+    logTaskTimings();
     MYLOGI("shutdown thread pool\n");
 }
 
 void DumpPool::start(int thread_counts) {
     assert(thread_counts > 0);
     assert(threads_.empty());
-    if (thread_counts > MAX_THREAD_COUNT) {
-        thread_counts = MAX_THREAD_COUNT;
-    }
+    // More threads than CPUs only slow each other down.
+    thread_counts = std::min({thread_counts, MAX_THREAD_COUNT, std::max(get_nprocs(), 1)});
     MYLOGI("Start thread pool:%d\n", thread_counts);
     shutdown_ = false;
     for (int i = 0; i < thread_counts; i++) {
@@ -157,6 +162,24 @@ void DumpPool::deleteTempFiles(const std::string& folder) {
     }
 }
 
+void DumpPool::recordTaskTiming(const std::string& title,
+                                std::chrono::steady_clock::duration queued,
+                                std::chrono::steady_clock::duration ran) {
+    std::unique_lock lock(lock_);
+    task_timings_.push_back({title, queued, ran});
+}
+
+void DumpPool::logTaskTimings() {
+    using std::chrono::duration_cast;
+    using std::chrono::milliseconds;
+    for (const auto& timing : task_timings_) {
+        MYLOGI("Task '%s' was queued for %lldms and ran for %lldms\n", timing.title.c_str(),
+               static_cast<long long>(duration_cast<milliseconds>(timing.queued).count()),
+               static_cast<long long>(duration_cast<milliseconds>(timing.ran).count()));
+    }
+    task_timings_.clear();
+}
+
 void DumpPool::setThreadName(const pthread_t thread, int id) {
     std::array<char, 15> name;
     snprintf(name.data(), name.size(), "dumpstate_%d", id);
@@ -166,12 +189,15 @@ void DumpPool::setThreadName(const pthread_t thread, int id) {
 void DumpPool::loop() {
     std::unique_lock lock(lock_);
     while (!shutdown_) {
-        if (tasks_.empty()) {
+        // The tasks of the highest priority run first.
+        auto tasks = std::find_if(tasks_.rbegin(), tasks_.rend(),
+                                  [](const auto& queue) { return !queue.empty(); });
+        if (tasks == tasks_.rend()) {
             condition_variable_.wait(lock);
             continue;
         } else {
-            std::packaged_task<std::string()> task = std::move(tasks_.front());
-            tasks_.pop();
+            std::packaged_task<std::string()> task = std::move(tasks->front());
+            tasks->pop();
             lock.unlock();
             std::invoke(task);
             lock.lock();
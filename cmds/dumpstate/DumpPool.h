@@ -17,9 +17,12 @@
 #ifndef FRAMEWORK_NATIVE_CMD_DUMPPOOL_H_
 #define FRAMEWORK_NATIVE_CMD_DUMPPOOL_H_
 
+#include <array>
+#include <chrono>
 #include <future>
 #include <queue>
 #include <string>
+#include <vector>
 
 #include <android-base/file.h>
 #include <android-base/macros.h>
@@ -71,11 +74,20 @@ inline void WaitForTask(std::future<std::string> future) {
  *
  * std::futures returned by `enqueueTask*()` must all have their `get` methods
  * called, or have been destroyed before the DumpPool itself is destroyed.
+ *
+ * The queued tasks of higher priority run first, so that the tasks which the
+ * caller waits for first don't wait for the others to run. The time each task
+ * waited in the queue and ran for is logged when the pool is destroyed.
  */
 class DumpPool {
   friend class android::os::dumpstate::DumpPoolTest;
 
   public:
+    enum class Priority {
+        NORMAL = 0,
+        HIGH = 1,
+    };
+
     /*
      * Creates a thread pool.
      *
@@ -94,7 +106,8 @@ class DumpPool {
     /*
      * Starts the threads in the pool.
      *
-     * |thread_counts| the number of threads to start.
+     * |thread_counts| the number of threads to start, at most the number of
+     * CPUs.
      */
     void start(int thread_counts = MAX_THREAD_COUNT);
 
@@ -110,9 +123,19 @@ class DumpPool {
      */
     template<class F, class... Args>
     std::future<std::string> enqueueTask(const std::string& duration_title, F&& f, Args&&... args) {
+        return enqueueTask(Priority::NORMAL, duration_title, std::forward<F>(f),
+                           std::forward<Args>(args)...);
+    }
+
+    /*
+     * Adds a task of the given priority into the queue of the thread pool.
+     */
+    template<class F, class... Args>
+    std::future<std::string> enqueueTask(Priority priority, const std::string& duration_title,
+                                         F&& f, Args&&... args) {
         std::function<void(void)> func = std::bind(std::forward<F>(f),
                 std::forward<Args>(args)...);
-        auto future = post(duration_title, func);
+        auto future = post(priority, duration_title, func);
         if (threads_.empty()) {
             start();
         }
@@ -130,9 +153,19 @@ class DumpPool {
      */
     template<class F, class... Args> std::future<std::string> enqueueTaskWithFd(
             const std::string& duration_title, F&& f, Args&&... args) {
+        return enqueueTaskWithFd(Priority::NORMAL, duration_title, std::forward<F>(f),
+                                 std::forward<Args>(args)...);
+    }
+
+    /*
+     * Adds a task of the given priority, which takes a file descriptor as a
+     * parameter, into the queue of the thread pool.
+     */
+    template<class F, class... Args> std::future<std::string> enqueueTaskWithFd(
+            Priority priority, const std::string& duration_title, F&& f, Args&&... args) {
         std::function<void(int)> func = std::bind(std::forward<F>(f),
                 std::forward<Args>(args)...);
-        auto future = post(duration_title, func);
+        auto future = post(priority, duration_title, func);
         if (threads_.empty()) {
             start();
         }
@@ -152,23 +185,38 @@ class DumpPool {
     template<class T> void invokeTask(T dump_func, const std::string& duration_title, int out_fd);
 
     template<class T>
-    std::future<std::string> post(const std::string& duration_title, T dump_func) {
+    std::future<std::string> post(Priority priority, const std::string& duration_title,
+                                  T dump_func) {
+        const auto queued_time = std::chrono::steady_clock::now();
         Task packaged_task([=]() {
+            const auto start_time = std::chrono::steady_clock::now();
             std::unique_ptr<TmpFile> tmp_file_ptr = createTempFile();
             if (!tmp_file_ptr) {
                 return std::string("");
             }
             invokeTask(dump_func, duration_title, tmp_file_ptr->fd.get());
             fsync(tmp_file_ptr->fd.get());
+            recordTaskTiming(duration_title, start_time - queued_time,
+                             std::chrono::steady_clock::now() - start_time);
             return std::string(tmp_file_ptr->path);
         });
         std::unique_lock lock(lock_);
         auto future = packaged_task.get_future();
-        tasks_.push(std::move(packaged_task));
+        tasks_[static_cast<size_t>(priority)].push(std::move(packaged_task));
         condition_variable_.notify_one();
         return future;
     }
 
+    struct TaskTiming {
+        std::string title;
+        std::chrono::steady_clock::duration queued;
+        std::chrono::steady_clock::duration ran;
+    };
+
+    void recordTaskTiming(const std::string& title, std::chrono::steady_clock::duration queued,
+                          std::chrono::steady_clock::duration ran);
+    void logTaskTimings();
+
     typedef struct {
       android::base::unique_fd fd;
       char path[1024];
@@ -198,7 +246,9 @@ class DumpPool {
     std::condition_variable condition_variable_;
 
     std::vector<std::thread> threads_;
-    std::queue<Task> tasks_;
+    // The queued tasks, by priority.
+    std::array<std::queue<Task>, static_cast<size_t>(Priority::HIGH) + 1> tasks_;
+    std::vector<TaskTiming> task_timings_;  // Guarded by lock_.
 
     DISALLOW_COPY_AND_ASSIGN(DumpPool);
 };
@@ -84,14 +84,18 @@
 
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <future>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <regex>
 #include <set>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -844,6 +848,151 @@ static const std::set<std::string> PROBLEMATIC_FILE_EXTENSIONS = {
       ".shb", ".sys", ".vb",  ".vbe", ".vbs", ".vxd", ".wsc", ".wsf", ".wsh"
 };
 
+namespace {
+
+// Reads an fd on its own thread into a bounded queue of chunks, which the zip entry of the
+// fd is written from.
+class ZipEntryReader {
+  public:
+    ZipEntryReader(const std::string& entry_name, int fd, std::chrono::milliseconds timeout)
+        : entry_name_(entry_name),
+          fd_(fd),
+          timeout_(timeout),
+          end_(std::chrono::steady_clock::now() + timeout),
+          thread_([this] { Read(); }) {
+    }
+
+    ~ZipEntryReader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cancelled_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    // Moves the next chunk of the fd to |chunk|, and returns false once the fd has been read to
+    // the end or has failed, see status().
+    bool Next(std::vector<uint8_t>* chunk) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !chunks_.empty() || done_; });
+        if (chunks_.empty()) {
+            return false;
+        }
+        if (!chunk->empty()) {
+            free_chunks_.push_back(std::move(*chunk));
+        }
+        *chunk = std::move(chunks_.front());
+        chunks_.pop_front();
+        lock.unlock();
+        cv_.notify_all();
+        return true;
+    }
+
+    // Only valid once Next() has returned false.
+    status_t status() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return status_;
+    }
+
+  private:
+    static constexpr size_t kChunkSize = 65536;
+    static constexpr size_t kMaxQueuedChunks = 16;
+    // How long a read may wait for data before checking whether it was cancelled.
+    static constexpr std::chrono::milliseconds kPollInterval = 100ms;
+
+    status_t ReadChunk(std::vector<uint8_t>* chunk) {
+        struct pollfd pfd = {fd_, POLLIN};
+        while (true) {
+            auto wait = kPollInterval;
+            if (timeout_.count() > 0) {
+                wait = std::min(wait, std::max(0ms, std::chrono::duration_cast<
+                        std::chrono::milliseconds>(end_ - std::chrono::steady_clock::now())));
+            }
+            int rc = TEMP_FAILURE_RETRY(poll(&pfd, 1, wait.count()));
+            if (rc < 0) {
+                MYLOGE("Error in poll while adding from fd to zip entry %s:%s\n",
+                       entry_name_.c_str(), strerror(errno));
+                return -errno;
+            } else if (rc > 0) {
+                break;
+            } else if (timeout_.count() > 0 && std::chrono::steady_clock::now() >= end_) {
+                MYLOGE("Timed out adding from fd to zip entry %s:%s Timeout:%lldms\n",
+                       entry_name_.c_str(), strerror(errno), timeout_.count());
+                return TIMED_OUT;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (cancelled_) {
+                chunk->clear();
+                return OK;
+            }
+        }
+
+        chunk->resize(kChunkSize);
+        ssize_t bytes_read = TEMP_FAILURE_RETRY(read(fd_, chunk->data(), chunk->size()));
+        if (bytes_read == -1) {
+            MYLOGE("read(%s): %s\n", entry_name_.c_str(), strerror(errno));
+            chunk->clear();
+            return -errno;
+        }
+        chunk->resize(bytes_read);
+        return OK;
+    }
+
+    void Read() {
+        status_t status = OK;
+        while (true) {
+            std::vector<uint8_t> chunk;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] {
+                    return chunks_.size() < kMaxQueuedChunks || cancelled_;
+                });
+                if (cancelled_) {
+                    break;
+                }
+                if (!free_chunks_.empty()) {
+                    chunk = std::move(free_chunks_.back());
+                    free_chunks_.pop_back();
+                }
+            }
+            status = ReadChunk(&chunk);
+            if (status != OK || chunk.empty()) {
+                break;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                chunks_.push_back(std::move(chunk));
+            }
+            cv_.notify_all();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            status_ = status;
+            done_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    const std::string& entry_name_;
+    const int fd_;
+    const std::chrono::milliseconds timeout_;
+    const std::chrono::steady_clock::time_point end_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::vector<uint8_t>> chunks_;
+    std::vector<std::vector<uint8_t>> free_chunks_;
+    status_t status_ = OK;
+    bool done_ = false;
+    bool cancelled_ = false;
+
+    // Started last, once the members above are initialized.
+    std::thread thread_;
+};
+
+}  // namespace
+
 status_t Dumpstate::AddZipEntryFromFd(const std::string& entry_name, int fd,
                                       std::chrono::milliseconds timeout = 0ms) {
     std::string valid_name = entry_name;
@@ -880,45 +1029,21 @@ status_t Dumpstate::AddZipEntryFromFd(const std::string& entry_name, int fd,
         }
     };
     auto scope_guard = android::base::make_scope_guard(finish_entry);
-    auto start = std::chrono::steady_clock::now();
-    auto end = start + timeout;
-    struct pollfd pfd = {fd, POLLIN};
-
-    std::vector<uint8_t> buffer(65536);
-    while (1) {
-        if (timeout.count() > 0) {
-            // lambda to recalculate the timeout.
-            auto time_left_ms = [end]() {
-                auto now = std::chrono::steady_clock::now();
-                auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end - now);
-                return std::max(diff.count(), 0LL);
-            };
-
-            int rc = TEMP_FAILURE_RETRY(poll(&pfd, 1, time_left_ms()));
-            if (rc < 0) {
-                MYLOGE("Error in poll while adding from fd to zip entry %s:%s\n",
-                       entry_name.c_str(), strerror(errno));
-                return -errno;
-            } else if (rc == 0) {
-                MYLOGE("Timed out adding from fd to zip entry %s:%s Timeout:%lldms\n",
-                       entry_name.c_str(), strerror(errno), timeout.count());
-                return TIMED_OUT;
-            }
-        }
 
-        ssize_t bytes_read = TEMP_FAILURE_RETRY(read(fd, buffer.data(), buffer.size()));
-        if (bytes_read == 0) {
-            break;
-        } else if (bytes_read == -1) {
-            MYLOGE("read(%s): %s\n", entry_name.c_str(), strerror(errno));
-            return -errno;
-        }
-        err = zip_writer_->WriteBytes(buffer.data(), bytes_read);
+    // Deflate the chunks on this thread while the reader drains the fd, so that a service
+    // streaming its dump into a pipe isn't held up by the compression of its earlier output.
+    ZipEntryReader reader(entry_name, fd, timeout);
+    std::vector<uint8_t> chunk;
+    while (reader.Next(&chunk)) {
+        err = zip_writer_->WriteBytes(chunk.data(), chunk.size());
         if (err) {
             MYLOGE("zip_writer_->WriteBytes(): %s\n", ZipWriter::ErrorCodeString(err));
             return UNKNOWN_ERROR;
         }
     }
+    if (status_t status = reader.status(); status != OK) {
+        return status;
+    }
 
     err = zip_writer_->FinishEntry();
     finished_entry = true;
@@ -1660,14 +1785,17 @@ Dumpstate::RunStatus Dumpstate::dumpstate() {
         // drop root user. Restarts it.
         ds.dump_pool_->start(/* thread_counts = */3);
 
-        dump_hals = ds.dump_pool_->enqueueTaskWithFd(DUMP_HALS_TASK, &DumpHals, _1);
+        // The tasks which are waited for first run first.
+        dump_hals = ds.dump_pool_->enqueueTaskWithFd(
+            DumpPool::Priority::HIGH, DUMP_HALS_TASK, &DumpHals, _1);
         dump_incident_report = ds.dump_pool_->enqueueTask(
             DUMP_INCIDENT_REPORT_TASK, &DumpIncidentReport);
         dump_netstats_report = ds.dump_pool_->enqueueTask(
             DUMP_NETSTATS_PROTO_TASK, &DumpNetstatsProto);
         dump_board = ds.dump_pool_->enqueueTaskWithFd(
-            DUMP_BOARD_TASK, &Dumpstate::DumpstateBoard, &ds, _1);
-        dump_checkins = ds.dump_pool_->enqueueTaskWithFd(DUMP_CHECKINS_TASK, &DumpCheckins, _1);
+            DumpPool::Priority::HIGH, DUMP_BOARD_TASK, &Dumpstate::DumpstateBoard, &ds, _1);
+        dump_checkins = ds.dump_pool_->enqueueTaskWithFd(
+            DumpPool::Priority::HIGH, DUMP_CHECKINS_TASK, &DumpCheckins, _1);
     }
 
     // Dump various things. Note that anything that takes "long" (i.e. several seconds) should
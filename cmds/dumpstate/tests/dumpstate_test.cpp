@@ -52,6 +52,7 @@ namespace dumpstate {
 
 using DumpstateDeviceAidl = ::aidl::android::hardware::dumpstate::IDumpstateDevice;
 using ::android::hardware::dumpstate::V1_1::DumpstateMode;
+using ::testing::ElementsAre;
 using ::testing::EndsWith;
 using ::testing::Eq;
 using ::testing::HasSubstr;
@@ -1782,6 +1783,32 @@ TEST_F(DumpPoolTest, EnqueueTask_withDurationLog) {
     EXPECT_THAT(getTempFileCounts(kTestDataPath), Eq(0));
 }
 
+TEST_F(DumpPoolTest, EnqueueTask_highPriorityRunsFirst) {
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::vector<std::string> order;
+    auto block = [released]() {
+        released.wait();
+    };
+    auto append = [&order](const std::string& name) {
+        order.push_back(name);
+    };
+
+    setLogDuration(/* log_duration = */false);
+    dump_pool_->start(/* thread_counts = */1);
+    auto t1 = dump_pool_->enqueueTask("", block);
+    auto t2 = dump_pool_->enqueueTask("", append, "normal");
+    auto t3 = dump_pool_->enqueueTask(DumpPool::Priority::HIGH, "", append, "high");
+    release.set_value();
+
+    WaitForTask(std::move(t1), "", out_fd_.get());
+    WaitForTask(std::move(t2), "", out_fd_.get());
+    WaitForTask(std::move(t3), "", out_fd_.get());
+
+    EXPECT_THAT(order, ElementsAre("high", "normal"));
+    EXPECT_THAT(getTempFileCounts(kTestDataPath), Eq(0));
+}
+
 class TaskQueueTest : public DumpstateBaseTest {
 public:
     void SetUp() {
@@ -15,8 +15,11 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <iomanip>
+#include <mutex>
 #include <thread>
 
 #include <android-base/file.h>
@@ -39,6 +42,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/poll.h>
 #include <sys/socket.h>
 #include <sys/time.h>
@@ -66,7 +70,7 @@ static void usage() {
         "         To dump all services.\n"
         "or:\n"
         "       dumpsys [-t TIMEOUT] [--priority LEVEL] [--clients] [--dump] [--pid] [--thread] "
-        "[--help | "
+        "[--jobs JOBS] [--help | "
         "-l | --skip SERVICES "
         "| SERVICE [ARGS]]\n"
         "         --help: shows this help\n"
@@ -75,6 +79,9 @@ static void usage() {
         "         -T TIMEOUT_MS: TIMEOUT to use in milliseconds instead of default 10 seconds\n"
         "         --clients: dump client PIDs instead of usual dump\n"
         "         --dump: ask the service to dump itself (this is the default)\n"
+        "         --jobs JOBS: dump up to JOBS services at once when dumping several services,\n"
+        "               each with its own TIMEOUT. The dumps are still printed in order, followed\n"
+        "               by the time each of them took\n"
         "         --pid: dump PID instead of usual dump\n"
         "         --proto: filter services that support dumping data in proto format. Dumps\n"
         "               will be in proto format.\n"
@@ -135,13 +142,15 @@ int Dumpsys::main(int argc, char* const argv[]) {
     bool asProto = false;
     int dumpTypeFlags = 0;
     int timeoutArgMs = 10000;
+    int jobs = 1;
     int priorityFlags = IServiceManager::DUMP_FLAG_PRIORITY_ALL;
     static struct option longOptions[] = {
         {"help", no_argument, 0, 0},           {"clients", no_argument, 0, 0},
         {"dump", no_argument, 0, 0},           {"pid", no_argument, 0, 0},
         {"priority", required_argument, 0, 0}, {"proto", no_argument, 0, 0},
         {"skip", no_argument, 0, 0},           {"stability", no_argument, 0, 0},
-        {"thread", no_argument, 0, 0},         {0, 0, 0, 0}};
+        {"thread", no_argument, 0, 0},         {"jobs", required_argument, 0, 0},
+        {0, 0, 0, 0}};
 
     // Must reset optind, otherwise subsequent calls will fail (wouldn't happen on main.cpp, but
     // happens on test cases).
@@ -182,6 +191,13 @@ int Dumpsys::main(int argc, char* const argv[]) {
                 dumpTypeFlags |= TYPE_THREAD;
             } else if (!strcmp(longOptions[optionIndex].name, "clients")) {
                 dumpTypeFlags |= TYPE_CLIENTS;
+            } else if (!strcmp(longOptions[optionIndex].name, "jobs")) {
+                char* endptr;
+                jobs = strtol(optarg, &endptr, 10);
+                if (*endptr != '\0' || jobs <= 0) {
+                    fprintf(stderr, "Error: invalid number of jobs: '%s'\n", optarg);
+                    return -1;
+                }
             }
             break;
 
@@ -271,6 +287,12 @@ int Dumpsys::main(int argc, char* const argv[]) {
         return 0;
     }
 
+    if (jobs > 1 && N > 1) {
+        dumpServicesConcurrently(services, skippedServices, dumpTypeFlags, args, priorityFlags,
+                                 asProto, std::chrono::milliseconds(timeoutArgMs), jobs);
+        return 0;
+    }
+
     for (size_t i = 0; i < N; i++) {
         const String16& serviceName = services[i];
         if (IsSkipped(skippedServices, serviceName)) continue;
@@ -304,6 +326,96 @@ int Dumpsys::main(int argc, char* const argv[]) {
     return 0;
 }
 
+void Dumpsys::dumpServicesConcurrently(const Vector<String16>& services,
+                                       const Vector<String16>& skippedServices,
+                                       int dumpTypeFlags, const Vector<String16>& args,
+                                       int priorityFlags, bool asProto,
+                                       std::chrono::milliseconds timeout, size_t jobs) const {
+    // The section of each service is written to a memfd by the worker which dumps it, and copied
+    // to stdout once the sections of the services before it have been.
+    struct ServiceDump {
+        unique_fd output;
+        bool started = false;
+        bool done = false;
+        status_t status = OK;
+        std::chrono::duration<double> elapsedDuration{0};
+        size_t bytesWritten = 0;
+    };
+    const size_t N = services.size();
+    std::vector<ServiceDump> dumps(N);
+    std::mutex lock;
+    std::condition_variable dumpDone;
+    std::atomic<size_t> nextService = 0;
+
+    auto dumpServices = [&]() {
+        for (size_t i = nextService++; i < N; i = nextService++) {
+            const String16& serviceName = services[i];
+            ServiceDump dump;
+            if (!IsSkipped(skippedServices, serviceName)) {
+                Dumpsys dumpsys(sm_);
+                dump.output.reset(memfd_create("dumpsys", MFD_CLOEXEC));
+                if (dump.output == -1) {
+                    std::cerr << "Failed to create memfd to dump service " << serviceName << ": "
+                              << strerror(errno) << std::endl;
+                } else if (dumpsys.startDumpThread(dumpTypeFlags, serviceName, args) == OK) {
+                    dump.started = true;
+                    writeDumpHeader(dump.output.get(), serviceName, priorityFlags);
+                    dump.status = dumpsys.writeDump(dump.output.get(), serviceName, timeout,
+                                                    asProto, dump.elapsedDuration,
+                                                    dump.bytesWritten);
+                    if (dump.status == TIMED_OUT) {
+                        WriteStringToFd(StringPrintf("\n*** SERVICE '%s' DUMP TIMEOUT (%llums) "
+                                                     "EXPIRED ***\n\n",
+                                                     String8(serviceName).c_str(),
+                                                     timeout.count()),
+                                        dump.output.get());
+                    }
+                    writeDumpFooter(dump.output.get(), serviceName, dump.elapsedDuration);
+                    dumpsys.stopDumpThread(dump.status == OK);
+                }
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            dumps[i] = std::move(dump);
+            dumps[i].done = true;
+            dumpDone.notify_all();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < std::min(jobs, N); i++) {
+        workers.emplace_back(dumpServices);
+    }
+
+    std::string timings;
+    for (size_t i = 0; i < N; i++) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            dumpDone.wait(guard, [&] { return dumps[i].done; });
+        }
+        ServiceDump& dump = dumps[i];
+        if (!dump.started) {
+            continue;
+        }
+        char buf[4096];
+        ssize_t rc;
+        lseek(dump.output.get(), 0, SEEK_SET);
+        while ((rc = TEMP_FAILURE_RETRY(read(dump.output.get(), buf, sizeof(buf)))) > 0) {
+            if (!WriteFully(STDOUT_FILENO, buf, rc)) {
+                break;
+            }
+        }
+        dump.output.reset();
+        StringAppendF(&timings, "  %-40s %8.3fs %10zu bytes%s\n", String8(services[i]).c_str(),
+                      dump.elapsedDuration.count(), dump.bytesWritten,
+                      dump.status == OK ? "" : (" " + statusToString(dump.status)).c_str());
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    WriteStringToFd(StringPrintf("--------- dumpsys durations with %zu jobs:\n", jobs) + timings,
+                    STDOUT_FILENO);
+}
+
 Vector<String16> Dumpsys::listServices(int priorityFilterFlags, bool filterByProto) const {
     Vector<String16> services = sm_->listServices(priorityFilterFlags);
     services.sort(sort_func);
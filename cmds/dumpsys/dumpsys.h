@@ -126,6 +126,15 @@ class Dumpsys {
     }
 
   private:
+    /**
+     * Dumps up to {@code jobs} of {@code services} at once to stdout, in the order of
+     * {@code services}, followed by the duration of each dump.
+     */
+    void dumpServicesConcurrently(const Vector<String16>& services,
+                                  const Vector<String16>& skippedServices, int dumpTypeFlags,
+                                  const Vector<String16>& args, int priorityFlags, bool asProto,
+                                  std::chrono::milliseconds timeout, size_t jobs) const;
+
     android::IServiceManager* sm_;
     std::thread activeThread_;
     mutable android::base::unique_fd redirectFd_;
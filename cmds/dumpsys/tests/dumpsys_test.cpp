@@ -454,6 +454,49 @@ TEST_F(DumpsysTest, DumpMultipleServices) {
     AssertDumped("running3", "dump3");
 }
 
+// Tests 'dumpsys --jobs 2' with no other arguments
+TEST_F(DumpsysTest, DumpMultipleServicesConcurrently) {
+    ExpectListServices({"running1", "stopped2", "running3", "running4"});
+    ExpectDumpAndHang("running1", 1, "dump1");
+    ExpectCheckService("stopped2", false);
+    ExpectDump("running3", "dump3");
+    ExpectDump("running4", "dump4");
+
+    CallMain({"--jobs", "2"});
+
+    AssertRunningServices({"running1", "running3", "running4"});
+    AssertDumped("running1", "dump1");
+    AssertStopped("stopped2");
+    AssertDumped("running3", "dump3");
+    AssertDumped("running4", "dump4");
+    // The dumps are printed in order even though running1 finishes last.
+    const std::string format("(.|\n)*DUMP OF SERVICE running1:\ndump1(.|\n)*"
+                             "DUMP OF SERVICE running3:\ndump3(.|\n)*"
+                             "DUMP OF SERVICE running4:\ndump4(.|\n)*"
+                             "dumpsys durations with 2 jobs:\n"
+                             "  running1 +[0-9.]+s +5 bytes\n"
+                             "  running3 +[0-9.]+s +5 bytes\n"
+                             "  running4 +[0-9.]+s +5 bytes\n");
+    AssertOutputFormat(format);
+}
+
+// Tests 'dumpsys --jobs 2 -T 500' with a service that times out after 2s
+TEST_F(DumpsysTest, DumpMultipleServicesConcurrentlyWithTimeout) {
+    ExpectListServices({"running1", "running2"});
+    sp<BinderMock> binder_mock = ExpectDumpAndHang("running1", 2, "dump1");
+    ExpectDump("running2", "dump2");
+
+    CallMain({"--jobs", "2", "-T", "500"});
+
+    AssertOutputContains("SERVICE 'running1' DUMP TIMEOUT (500ms) EXPIRED");
+    AssertNotDumped("dump1");
+    AssertDumped("running2", "dump2");
+    AssertOutputContains("TIMED_OUT");
+
+    // TODO(b/65056227): BinderMock is not destructed because thread is detached on dumpsys.cpp
+    Mock::AllowLeak(binder_mock.get());
+}
+
 // Tests 'dumpsys --skip skipped3 skipped5', which should skip these services
 TEST_F(DumpsysTest, DumpWithSkip) {
     ExpectListServices({"running1", "stopped2", "skipped3", "running4", "skipped5"});
@@ -133,5 +133,62 @@ int CacheItem::purge() {
     return res;
 }
 
+CachePurger::CachePurger(size_t threadCount) {
+    for (size_t i = 0; i < threadCount; i++) {
+        mThreads.emplace_back([this] { run(); });
+    }
+}
+
+CachePurger::~CachePurger() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStopping = true;
+    }
+    mItemQueued.notify_all();
+    for (auto& thread : mThreads) {
+        thread.join();
+    }
+}
+
+void CachePurger::purge(const std::shared_ptr<CacheItem>& item) {
+    if (item->directory || mThreads.empty()) {
+        wait();
+        item->purge();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mItems.push_back(item);
+        mPendingCount++;
+    }
+    mItemQueued.notify_one();
+}
+
+void CachePurger::wait() {
+    std::unique_lock<std::mutex> lock(mLock);
+    mItemsPurged.wait(lock, [this] { return mPendingCount == 0; });
+}
+
+void CachePurger::run() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mItemQueued.wait(lock, [this] { return mStopping || !mItems.empty(); });
+        if (mItems.empty()) {
+            // Stopping, with all of the items purged.
+            return;
+        }
+        auto item = std::move(mItems.front());
+        mItems.pop_front();
+        lock.unlock();
+
+        item->purge();
+
+        lock.lock();
+        if (--mPendingCount == 0) {
+            mItemsPurged.notify_all();
+        }
+    }
+}
+
 }  // namespace installd
 }  // namespace android
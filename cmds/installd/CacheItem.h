@@ -17,8 +17,13 @@
 #ifndef ANDROID_INSTALLD_CACHE_ITEM_H
 #define ANDROID_INSTALLD_CACHE_ITEM_H
 
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <fts.h>
 #include <sys/types.h>
@@ -58,6 +63,34 @@ private:
     DISALLOW_COPY_AND_ASSIGN(CacheItem);
 };
 
+/**
+ * Purges cache items on a few threads. Directories are purged once the items
+ * queued before them are, since their trees may hold these items.
+ */
+class CachePurger {
+public:
+    explicit CachePurger(size_t threadCount);
+    ~CachePurger();
+
+    void purge(const std::shared_ptr<CacheItem>& item);
+    // Waits for the queued items to be purged.
+    void wait();
+
+private:
+    void run();
+
+    std::mutex mLock;
+    std::condition_variable mItemQueued;
+    std::condition_variable mItemsPurged;
+    std::deque<std::shared_ptr<CacheItem>> mItems;
+    // The number of items which are queued or being purged.
+    size_t mPendingCount = 0;
+    bool mStopping = false;
+    std::vector<std::thread> mThreads;
+
+    DISALLOW_COPY_AND_ASSIGN(CachePurger);
+};
+
 }  // namespace installd
 }  // namespace android
 
@@ -22,6 +22,8 @@
 #include <sys/xattr.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
+
 #include <android-base/logging.h>
 #include <android-base/stringprintf.h>
 
@@ -171,22 +173,33 @@ void CacheTracker::loadItems() {
     }
     ATRACE_END();
 
-    ATRACE_BEGIN("sortItems");
-    auto cmp = [](std::shared_ptr<CacheItem> left, std::shared_ptr<CacheItem> right) {
-        // TODO: sort dotfiles last
-        // TODO: sort code_cache last
-        if (left->modified != right->modified) {
-            return (left->modified > right->modified);
-        }
-        if (left->level != right->level) {
-            return (left->level < right->level);
-        }
-        return left->directory;
-    };
-    std::stable_sort(items.begin(), items.end(), cmp);
+    // The items are only ordered as they are purged, since there usually are
+    // far more items than are purged to reach the target.
+    ATRACE_BEGIN("heapifyItems");
+    std::make_heap(items.begin(), items.end(), purgedAfter);
     ATRACE_END();
 }
 
+bool CacheTracker::purgedAfter(const std::shared_ptr<CacheItem>& left,
+                               const std::shared_ptr<CacheItem>& right) {
+    // TODO: sort dotfiles last
+    // TODO: sort code_cache last
+    if (left->modified != right->modified) {
+        return (left->modified > right->modified);
+    }
+    if (left->level != right->level) {
+        return (left->level < right->level);
+    }
+    return left->directory && !right->directory;
+}
+
+std::shared_ptr<CacheItem> CacheTracker::popItem() {
+    std::pop_heap(items.begin(), items.end(), purgedAfter);
+    auto item = items.back();
+    items.pop_back();
+    return item;
+}
+
 void CacheTracker::ensureItems() {
     if (mItemsLoaded) {
         return;
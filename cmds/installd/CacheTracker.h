@@ -50,6 +50,8 @@ public:
     void loadItems();
 
     void ensureItems();
+    // Removes the item to purge first from items, which is kept as a heap.
+    std::shared_ptr<CacheItem> popItem();
 
     int getCacheRatio();
 
@@ -69,6 +71,11 @@ private:
     bool loadQuotaStats();
     void loadItemsFrom(const std::string& path);
 
+    // Whether left is purged after right: the oldest items are purged first,
+    // and the deepest ones first among the items of the same age.
+    static bool purgedAfter(const std::shared_ptr<CacheItem>& left,
+                            const std::shared_ptr<CacheItem>& right);
+
     DISALLOW_COPY_AND_ASSIGN(CacheTracker);
 };
 
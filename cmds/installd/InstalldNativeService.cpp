@@ -36,6 +36,8 @@
 #include <sys/xattr.h>
 #include <unistd.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <functional>
@@ -108,6 +110,12 @@ static constexpr const char* kMiscMirrorDePath = "/data_mirror/misc_de";
 
 static constexpr const int MIN_RESTRICTED_HOME_SDK_VERSION = 24; // > M
 
+// The number of threads which delete the cache files freed by freeCache.
+static constexpr const size_t kFreeCachePurgeThreads = 4;
+
+// The number of threads which relabel the directories of a package.
+static constexpr const size_t kRestoreconThreads = 4;
+
 static constexpr const char* PKG_LIB_POSTFIX = "/lib";
 static constexpr const char* CACHE_DIR_POSTFIX = "/cache";
 static constexpr const char* CODE_CACHE_DIR_POSTFIX = "/code_cache";
@@ -587,6 +595,50 @@ static int restorecon_app_data_lazy(const std::string& path, const std::string&
 
     return 0;
 }
+
+/**
+ * Perform recursive restorecon of the given package directories, spread on a
+ * few threads, and return the directories which failed.
+ */
+static std::vector<std::string> restorecon_pkgdirs(const std::string& packageName,
+                                                   const std::vector<std::string>& paths,
+                                                   const char* seInfo, uid_t uid) {
+    ScopedTrace tracer("restorecon-pkgdirs");
+    const auto start = std::chrono::steady_clock::now();
+
+    // SELINUX_ANDROID_RESTORECON_DATADATA flag is set by libselinux. Not needed here.
+    std::vector<char> failed(paths.size(), false);
+    std::atomic<size_t> next(0);
+    const auto restorecon = [&]() {
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            if (selinux_android_restorecon_pkgdir(paths[i].c_str(), seInfo, uid,
+                                                  SELINUX_ANDROID_RESTORECON_RECURSE) < 0) {
+                failed[i] = true;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min(paths.size(), kRestoreconThreads); i++) {
+        workers.emplace_back(restorecon);
+    }
+    restorecon();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::vector<std::string> failedPaths;
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (failed[i]) {
+            failedPaths.push_back(paths[i]);
+        }
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+    LOG(DEBUG) << "Restorecon of " << paths.size() << " directories of " << packageName
+               << " took " << elapsed.count() << "ms on " << workers.size() + 1 << " threads";
+    return failedPaths;
+}
+
 static bool internal_storage_has_project_id() {
     // The following path is populated in setFirstBoot, so if this file is present
     // then project ids can be used. Using call once to cache the result of this check
@@ -2219,6 +2271,7 @@ binder::Status InstalldNativeService::freeCache(const std::optional<std::string>
         // 3. Bounce across the queue, freeing items from whichever tracker is
         // the most over their assigned quota
         atrace_pm_begin("bounce");
+        CachePurger purger(noop ? 0 : kFreeCachePurgeThreads);
         std::shared_ptr<CacheTracker> active;
         while (active || !queue.empty()) {
             // Only look at apps under quota when explicitly requested
@@ -2249,12 +2302,11 @@ binder::Status InstalldNativeService::freeCache(const std::optional<std::string>
                 active = nullptr;
                 continue;
             } else {
-                auto item = active->items.back();
-                active->items.pop_back();
+                auto item = active->popItem();
 
                 LOG(DEBUG) << "Purging " << item->toString() << " from " << active->toString();
                 if (!noop) {
-                    item->purge();
+                    purger.purge(item);
                 }
                 active->cacheUsed -= item->size;
                 needed -= item->size;
@@ -2264,6 +2316,7 @@ binder::Status InstalldNativeService::freeCache(const std::optional<std::string>
                 // Verify that we're actually done before bailing, since sneaky
                 // apps might be using hardlinks
                 if (needed <= 0) {
+                    purger.wait();
                     free = data_disk_free(data_path);
                     needed = targetFreeBytes - free;
                     if (needed <= 0) {
@@ -3427,24 +3480,19 @@ binder::Status InstalldNativeService::restoreconAppDataLocked(
 
     binder::Status res = ok();
 
-    // SELINUX_ANDROID_RESTORECON_DATADATA flag is set by libselinux. Not needed here.
-    unsigned int seflags = SELINUX_ANDROID_RESTORECON_RECURSE;
     const char* uuid_ = uuid ? uuid->c_str() : nullptr;
     const char* pkgName = packageName.c_str();
-    const char* seinfo = seInfo.c_str();
 
     uid_t uid = multiuser_get_uid(userId, appId);
+    std::vector<std::string> paths;
     if (flags & FLAG_STORAGE_CE) {
-        auto path = create_data_user_ce_package_path(uuid_, userId, pkgName);
-        if (selinux_android_restorecon_pkgdir(path.c_str(), seinfo, uid, seflags) < 0) {
-            res = error("restorecon failed for " + path);
-        }
+        paths.push_back(create_data_user_ce_package_path(uuid_, userId, pkgName));
     }
     if (flags & FLAG_STORAGE_DE) {
-        auto path = create_data_user_de_package_path(uuid_, userId, pkgName);
-        if (selinux_android_restorecon_pkgdir(path.c_str(), seinfo, uid, seflags) < 0) {
-            res = error("restorecon failed for " + path);
-        }
+        paths.push_back(create_data_user_de_package_path(uuid_, userId, pkgName));
+    }
+    for (const auto& path : restorecon_pkgdirs(packageName, paths, seInfo.c_str(), uid)) {
+        res = error("restorecon failed for " + path);
     }
     return res;
 }
@@ -3459,13 +3507,11 @@ binder::Status InstalldNativeService::restoreconSdkDataLocked(
 
     binder::Status res = ok();
 
-    // SELINUX_ANDROID_RESTORECON_DATADATA flag is set by libselinux. Not needed here.
-    unsigned int seflags = SELINUX_ANDROID_RESTORECON_RECURSE;
     const char* uuid_ = uuid ? uuid->c_str() : nullptr;
     const char* pkgName = packageName.c_str();
-    const char* seinfo = seInfo.c_str();
 
     uid_t uid = multiuser_get_sdk_sandbox_uid(userId, appId);
+    std::vector<std::string> paths;
     constexpr int storageFlags[2] = {FLAG_STORAGE_CE, FLAG_STORAGE_DE};
     for (int currentFlag : storageFlags) {
         if ((flags & currentFlag) == 0) {
@@ -3478,18 +3524,17 @@ binder::Status InstalldNativeService::restoreconSdkDataLocked(
             LOG(INFO) << "Missing source " << packagePath;
             continue;
         }
-        const auto subDirHandler = [&packagePath, &seinfo, &uid, &seflags,
-                                    &res](const std::string& subDir) {
-            const auto& fullpath = packagePath + "/" + subDir;
-            if (selinux_android_restorecon_pkgdir(fullpath.c_str(), seinfo, uid, seflags) < 0) {
-                res = error("restorecon failed for " + fullpath);
-            }
+        const auto subDirHandler = [&packagePath, &paths](const std::string& subDir) {
+            paths.push_back(packagePath + "/" + subDir);
         };
         const auto ec = foreach_subdir(packagePath, subDirHandler);
         if (ec != 0) {
             res = error("Failed to restorecon for subdirs of " + packagePath);
         }
     }
+    for (const auto& path : restorecon_pkgdirs(packageName, paths, seInfo.c_str(), uid)) {
+        res = error("restorecon failed for " + path);
+    }
     return res;
 }
 
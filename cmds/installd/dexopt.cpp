@@ -37,6 +37,7 @@
 #include <android-base/logging.h>
 #include <android-base/no_destructor.h>
 #include <android-base/properties.h>
+#include <android-base/scopeguard.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
 #include <android-base/unique_fd.h>
@@ -124,6 +125,18 @@ class DexOptStatus {
         return dexopt_blocked_;
     }
 
+    // Counts a dex2oat job which is about to run, and returns the number of
+    // jobs which run, with it.
+    unsigned begin_dex2oat_job() {
+        std::lock_guard<std::mutex> lock(dexopt_lock_);
+        return ++dex2oat_job_count_;
+    }
+
+    void end_dex2oat_job() {
+        std::lock_guard<std::mutex> lock(dexopt_lock_);
+        --dex2oat_job_count_;
+    }
+
     // Enable or disable dexopt blocking.
     void control_dexopt_blocking(bool block) {
         std::lock_guard<std::mutex> lock(dexopt_lock_);
@@ -149,6 +162,8 @@ class DexOptStatus {
     std::unordered_set<pid_t> dexopt_pids_ GUARDED_BY(dexopt_lock_);
     // PIDs of child processes killed by cancellation.
     std::unordered_set<pid_t> dexopt_killed_pids_ GUARDED_BY(dexopt_lock_);
+    // The number of dex2oat jobs which run, from their initialization to their end.
+    unsigned dex2oat_job_count_ GUARDED_BY(dexopt_lock_) = 0;
 };
 
 android::base::NoDestructor<DexOptStatus> dexopt_status_;
@@ -1960,13 +1975,18 @@ int dexopt(const char* dex_path, uid_t uid, const char* pkgname, const char* ins
 
     LOG(VERBOSE) << "DexInv: --- BEGIN '" << dex_path << "' ---";
 
+    // The jobs which run at the same time share the CPUs.
+    const unsigned concurrent_jobs = dexopt_status_->begin_dex2oat_job();
+    auto end_dex2oat_job = android::base::make_scope_guard(
+            [] { dexopt_status_->end_dex2oat_job(); });
+
     RunDex2Oat runner(dex2oat_bin, execv_helper.get());
     runner.Initialize(out_oat.GetUniqueFile(), out_vdex.GetUniqueFile(), out_image.GetUniqueFile(),
                       in_dex, in_vdex, dex_metadata, reference_profile, class_loader_context,
                       join_fds(context_input_fds), swap_fd.get(), instruction_set, compiler_filter,
                       debuggable, boot_complete, for_restore, target_sdk_version,
                       enable_hidden_api_checks, generate_compact_dex, compile_without_image,
-                      background_job_compile, compilation_reason);
+                      background_job_compile, compilation_reason, concurrent_jobs);
 
     bool cancelled = false;
     pid_t pid = dexopt_status_->check_cancellation_and_fork(&cancelled);
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otapreopt_batch.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/parseint.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+
+using android::base::ReadFileToString;
+using android::base::StringPrintf;
+
+namespace android {
+namespace installd {
+
+static constexpr const char* kFingerprintProperty = "ro.build.fingerprint=";
+
+OtaCheckpoint::OtaCheckpoint(const std::string& path, const std::string& update_id) {
+    if (update_id.empty()) {
+        // Without telling updates apart, a checkpoint could skip the commands of
+        // another update.
+        LOG(WARNING) << "Unknown update, not checkpointing to " << path;
+        return;
+    }
+
+    std::string content;
+    bool resume = false;
+    if (ReadFileToString(path, &content)) {
+        std::vector<std::string> lines = android::base::Split(content, "\n");
+        resume = lines[0] == update_id;
+        // A line which a reboot cut short matches no command, so it is harmless.
+        for (size_t i = 1; resume && i < lines.size(); ++i) {
+            if (!lines[i].empty()) {
+                completed_.insert(lines[i]);
+            }
+        }
+    }
+
+    fd_.reset(open(path.c_str(),
+                   O_WRONLY | O_CREAT | O_CLOEXEC | (resume ? O_APPEND : O_TRUNC), 0600));
+    if (!fd_.ok()) {
+        PLOG(ERROR) << "Failed to open checkpoint " << path;
+        completed_.clear();
+        return;
+    }
+    if (resume) {
+        LOG(INFO) << "Resuming after " << completed_.size() << " completed commands";
+        return;
+    }
+    std::string header = update_id + "\n";
+    if (!android::base::WriteStringToFd(header, fd_) || fdatasync(fd_.get()) != 0) {
+        PLOG(ERROR) << "Failed to write checkpoint " << path;
+        fd_.reset();
+    }
+}
+
+bool OtaCheckpoint::IsCompleted(const std::string& command) const {
+    return completed_.count(command) > 0;
+}
+
+void OtaCheckpoint::MarkCompleted(const std::string& command) {
+    completed_.insert(command);
+    if (!fd_.ok()) {
+        return;
+    }
+    std::string line = command + "\n";
+    if (!android::base::WriteStringToFd(line, fd_) || fdatasync(fd_.get()) != 0) {
+        PLOG(ERROR) << "Failed to checkpoint " << command;
+    }
+}
+
+std::string ReadBuildFingerprint(const std::string& build_prop_path) {
+    std::string content;
+    if (!ReadFileToString(build_prop_path, &content)) {
+        return "";
+    }
+    for (const std::string& line : android::base::Split(content, "\n")) {
+        if (android::base::StartsWith(line, kFingerprintProperty)) {
+            return android::base::Trim(line.substr(strlen(kFingerprintProperty)));
+        }
+    }
+    return "";
+}
+
+bool ParsePressureAvg10(const std::string& content, float* avg10) {
+    for (const std::string& line : android::base::Split(content, "\n")) {
+        if (sscanf(line.c_str(), "some avg10=%f", avg10) == 1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+float ReadPressureAvg10(const std::string& path) {
+    std::string content;
+    float avg10 = 0;
+    if (!ReadFileToString(path, &content) || !ParsePressureAvg10(content, &avg10)) {
+        return 0;
+    }
+    return avg10;
+}
+
+static bool ReadInt(const std::string& path, int64_t* value) {
+    std::string content;
+    return ReadFileToString(path, &content) &&
+            android::base::ParseInt(android::base::Trim(content), value);
+}
+
+bool IsThermalThrottled(const std::string& thermal_dir) {
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(thermal_dir.c_str()), closedir);
+    if (dir == nullptr) {
+        return false;
+    }
+    for (dirent* entry = readdir(dir.get()); entry != nullptr; entry = readdir(dir.get())) {
+        if (!android::base::StartsWith(entry->d_name, "thermal_zone")) {
+            continue;
+        }
+        const std::string zone = thermal_dir + "/" + entry->d_name;
+        int64_t temp;
+        if (!ReadInt(zone + "/temp", &temp)) {
+            continue;
+        }
+        std::string type;
+        for (int i = 0;
+             ReadFileToString(StringPrintf("%s/trip_point_%d_type", zone.c_str(), i), &type);
+             ++i) {
+            int64_t trip_temp;
+            if (android::base::Trim(type) == "passive" &&
+                    ReadInt(StringPrintf("%s/trip_point_%d_temp", zone.c_str(), i), &trip_temp) &&
+                    trip_temp > 0 && temp >= trip_temp) {
+                LOG(INFO) << entry->d_name << " is at " << temp << ", above " << trip_temp;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+size_t DefaultOtaJobCount() {
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return static_cast<size_t>(std::clamp(cpus / 2, 1L, 4L));
+}
+
+}  // namespace installd
+}  // namespace android
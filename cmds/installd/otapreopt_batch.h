@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTAPREOPT_BATCH_H_
+#define OTAPREOPT_BATCH_H_
+
+#include <string>
+#include <unordered_set>
+
+#include <android-base/unique_fd.h>
+
+namespace android {
+namespace installd {
+
+// The dexopt commands which completed in an earlier run for the same update, so
+// that a run which resumes after a reboot can skip them. The file lives in the
+// OTA directory of the target slot, next to the artifacts of the commands, and
+// starts with a line which identifies the update.
+class OtaCheckpoint {
+  public:
+    // Reads the checkpoint at path. The checkpoint of another update is
+    // discarded.
+    OtaCheckpoint(const std::string& path, const std::string& update_id);
+
+    bool IsCompleted(const std::string& command) const;
+
+    // Records the command, and syncs the file so that it survives a reboot.
+    void MarkCompleted(const std::string& command);
+
+  private:
+    std::unordered_set<std::string> completed_;
+    android::base::unique_fd fd_;
+};
+
+// Reads the build fingerprint out of a build.prop file, or returns an empty
+// string if it has none.
+std::string ReadBuildFingerprint(const std::string& build_prop_path);
+
+// Returns the "some avg10" percentage of a pressure stall file, such as
+// /proc/pressure/io, or 0 if it can't be read.
+float ReadPressureAvg10(const std::string& path);
+bool ParsePressureAvg10(const std::string& content, float* avg10);
+
+// Whether a thermal zone under thermal_dir reached one of its passive trip
+// points, above which the kernel throttles the CPUs.
+bool IsThermalThrottled(const std::string& thermal_dir);
+
+// The number of otapreopt processes to run at the same time by default. Each
+// dex2oat already runs several threads, so this is a fraction of the CPUs.
+size_t DefaultOtaJobCount();
+
+}  // namespace installd
+}  // namespace android
+
+#endif  // OTAPREOPT_BATCH_H_
@@ -25,11 +25,13 @@
 #include <array>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
 
 #include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/macros.h>
+#include <android-base/parseint.h>
 #include <android-base/scopeguard.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
@@ -38,6 +40,7 @@
 #include <selinux/android.h>
 
 #include "installd_constants.h"
+#include "otapreopt_batch.h"
 #include "otapreopt_utils.h"
 
 #ifndef LOG_TAG
@@ -53,6 +56,14 @@ namespace installd {
 // so just try the possibilities one by one.
 static constexpr std::array kTryMountFsTypes = {"ext4", "erofs"};
 
+// In batch mode, no further otapreopt is started while the CPU or I/O pressure
+// stall of the last 10s is above these percentages, or while the device is hot.
+// One otapreopt always runs, so that the update progresses.
+static constexpr float kMaxCpuPressure = 60.f;
+static constexpr float kMaxIoPressure = 40.f;
+
+static constexpr const char* kCheckpointName = "otapreopt_completed";
+
 static void CloseDescriptor(const char* descriptor_string) {
     int fd = -1;
     std::istringstream stream(descriptor_string);
@@ -134,9 +145,87 @@ static void TryExtraMount(const char* name, const char* slot, const char* target
     (void)TryMountWithFstypes(block_device.c_str(), target);
 }
 
+static bool IsThrottled() {
+    return ReadPressureAvg10("/proc/pressure/cpu") > kMaxCpuPressure ||
+            ReadPressureAvg10("/proc/pressure/io") > kMaxIoPressure ||
+            IsThermalThrottled("/sys/class/thermal");
+}
+
+static std::vector<std::string> OtapreoptCommand(const std::string& line,
+                                                 const char* slot_suffix) {
+    std::vector<std::string> tokenized_line = android::base::Tokenize(line, " ");
+    std::vector<std::string> cmd{"/system/bin/otapreopt", slot_suffix};
+    std::move(tokenized_line.begin(), tokenized_line.end(), std::back_inserter(cmd));
+    return cmd;
+}
+
+// Runs up to max_jobs otapreopt processes at the same time, and skips the commands
+// which completed in an earlier run for the same update.
+static void RunBatch(const std::vector<std::string>& lines, const char* slot_suffix,
+                     size_t max_jobs) {
+    const std::string ota_dir = StringPrintf("/data/ota/%s", slot_suffix);
+    if (mkdir(ota_dir.c_str(), 0711) != 0 && errno != EEXIST) {
+        PLOG(WARNING) << "Failed to create " << ota_dir;
+    }
+    OtaCheckpoint checkpoint(ota_dir + "/" + kCheckpointName,
+                             ReadBuildFingerprint("/system/build.prop"));
+    LOG(INFO) << "Running " << lines.size() << " commands, up to " << max_jobs << " at a time";
+
+    int count = 0;
+    // The commands of the running otapreopt processes, by pid.
+    std::map<pid_t, const std::string*> running;
+    for (size_t next = 0; next < lines.size() || !running.empty();) {
+        while (next < lines.size() && running.size() < max_jobs &&
+               (running.empty() || !IsThrottled())) {
+            const std::string& line = lines[next++];
+            if (checkpoint.IsCompleted(line)) {
+                LOG(INFO) << "Already completed: " << line;
+                std::cout << ++count << std::endl;
+                continue;
+            }
+
+            std::vector<std::string> cmd = OtapreoptCommand(line, slot_suffix);
+            LOG(INFO) << "Command " << next << ": " << android::base::Join(cmd, " ");
+            std::string error_msg;
+            pid_t pid = ExecAsync(cmd, &error_msg);
+            if (pid == -1) {
+                LOG(ERROR) << "Running otapreopt failed: " << error_msg;
+                std::cout << ++count << std::endl;
+                continue;
+            }
+            running.emplace(pid, &line);
+        }
+        if (running.empty()) {
+            continue;
+        }
+
+        // Wait for any otapreopt, and then check again how many can run.
+        int status;
+        pid_t pid = TEMP_FAILURE_RETRY(waitpid(-1, &status, 0));
+        if (pid == -1) {
+            PLOG(ERROR) << "Failed to wait for otapreopt";
+            return;
+        }
+        auto it = running.find(pid);
+        if (it == running.end()) {
+            continue;
+        }
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            checkpoint.MarkCompleted(*it->second);
+        } else {
+            LOG(ERROR) << "Running otapreopt failed with status " << status << ": "
+                       << *it->second;
+        }
+        running.erase(it);
+
+        // Print the count to stdout and flush to indicate progress.
+        std::cout << ++count << std::endl;
+    }
+}
+
 // Entry for otapreopt_chroot. Expected parameters are:
 //
-//   [cmd] [status-fd] [target-slot-suffix]
+//   [cmd] [status-fd] [target-slot-suffix] [--batch[=<jobs>]]
 //
 // The file descriptor denoted by status-fd will be closed. Dexopt commands on
 // the form
@@ -146,20 +235,37 @@ static void TryExtraMount(const char* name, const char* slot, const char* target
 // are then read from stdin until EOF and passed on to /system/bin/otapreopt one
 // by one. After each call a line with the current command count is written to
 // stdout and flushed.
+//
+// With --batch, all of the commands are read first, and then run by up to
+// <jobs> otapreopt processes at the same time, or DefaultOtaJobCount() of them
+// if <jobs> is not given. Fewer run while the device is under pressure or hot.
+// Completed commands are checkpointed in the OTA directory of the target slot,
+// and skipped by a later run for the same update, e.g. after a reboot.
 static int otapreopt_chroot(const int argc, char **arg) {
     // Validate arguments
     if (argc == 2 && std::string_view(arg[1]) == "--version") {
         // Accept a single --version flag, to allow the script to tell this binary
-        // from the earlier one.
-        std::cout << "2" << std::endl;
+        // from the earlier ones. Version 3 accepts --batch.
+        std::cout << "3" << std::endl;
         return 0;
     }
-    if (argc != 3) {
+    if (argc != 3 && argc != 4) {
         LOG(ERROR) << "Wrong number of arguments: " << argc;
         exit(208);
     }
     const char* status_fd = arg[1];
     const char* slot_suffix = arg[2];
+    size_t max_jobs = 0;
+    if (argc == 4) {
+        std::string_view batch(arg[3]);
+        if (batch == "--batch") {
+            max_jobs = DefaultOtaJobCount();
+        } else if (!android::base::ConsumePrefix(&batch, "--batch=") ||
+                   !android::base::ParseUint(std::string(batch), &max_jobs) || max_jobs == 0) {
+            LOG(ERROR) << "Unknown argument: " << arg[3];
+            exit(208);
+        }
+    }
 
     // Set O_CLOEXEC on standard fds. They are coming from the caller, we do not
     // want to pass them on across our fork/exec into a different domain.
@@ -352,6 +458,18 @@ static int otapreopt_chroot(const int argc, char **arg) {
 
     // Now go on and read dexopt lines from stdin and pass them on to otapreopt.
 
+    if (max_jobs > 0) {
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(std::cin, line);) {
+            if (!line.empty()) {
+                lines.push_back(std::move(line));
+            }
+        }
+        RunBatch(lines, slot_suffix, max_jobs);
+        LOG(INFO) << "No more dexopt commands";
+        return 0;
+    }
+
     int count = 1;
     for (std::array<char, 10000> linebuf;
          std::cin.clear(), std::cin.getline(&linebuf[0], linebuf.size()); ++count) {
@@ -363,9 +481,7 @@ static int otapreopt_chroot(const int argc, char **arg) {
             continue;
         }
 
-        std::vector<std::string> tokenized_line = android::base::Tokenize(line, " ");
-        std::vector<std::string> cmd{"/system/bin/otapreopt", slot_suffix};
-        std::move(tokenized_line.begin(), tokenized_line.end(), std::back_inserter(cmd));
+        std::vector<std::string> cmd = OtapreoptCommand(line, slot_suffix);
 
         LOG(INFO) << "Command " << count << ": " << android::base::Join(cmd, " ");
 
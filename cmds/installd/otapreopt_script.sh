@@ -50,7 +50,8 @@ else
   exit 1
 fi
 
-if [ "$(/system/bin/otapreopt_chroot --version)" != 2 ]; then
+CHROOT_VERSION=$(/system/bin/otapreopt_chroot --version)
+if [ "$CHROOT_VERSION" != 2 ] && [ "$CHROOT_VERSION" != 3 ]; then
   # We require an updated chroot wrapper that reads dexopt commands from stdin.
   # Even if we kept compat with the old binary, the OTA preopt wouldn't work due
   # to missing sepolicy rules, so there's no use spending time trying to dexopt
@@ -77,7 +78,14 @@ done
 DONE=$(cmd otadexopt done)
 cmd otadexopt cleanup
 
-echo "$0: Using streaming otapreopt_chroot on ${#otadexopt_cmds[@]} packages"
+# Version 3 of the chroot wrapper runs the commands in parallel, and resumes
+# after the commands which an interrupted run completed.
+CHROOT_ARGS=()
+if [ "$CHROOT_VERSION" = 3 ] ; then
+  CHROOT_ARGS+=("--batch")
+fi
+
+echo "$0: Using streaming otapreopt_chroot ${CHROOT_ARGS[@]} on ${#otadexopt_cmds[@]} packages"
 
 function print_otadexopt_cmds {
   for cmd in "${otadexopt_cmds[@]}" ; do
@@ -94,7 +102,7 @@ function report_progress {
 }
 
 print_otadexopt_cmds | \
-  /system/bin/otapreopt_chroot $STATUS_FD $TARGET_SLOT_SUFFIX | \
+  /system/bin/otapreopt_chroot $STATUS_FD $TARGET_SLOT_SUFFIX "${CHROOT_ARGS[@]}" | \
   report_progress
 
 if [ "$DONE" = "OTA incomplete." ] ; then
@@ -20,6 +20,9 @@
 
 SLOT_SUFFIX=$(getprop ro.boot.slot_suffix)
 if test -n "$SLOT_SUFFIX" ; then
+  # The checkpoint of otapreopt_chroot --batch is only needed until the update
+  # is applied.
+  rm -f /data/ota/$SLOT_SUFFIX/otapreopt_completed
   if test -d /data/ota/$SLOT_SUFFIX/dalvik-cache ; then
     log -p i -t otapreopt_slot "Moving A/B artifacts for slot ${SLOT_SUFFIX}."
     OLD_SIZE=$(du -h -s /data/dalvik-cache)
@@ -17,6 +17,8 @@
 #ifndef OTAPREOPT_UTILS_H_
 #define OTAPREOPT_UTILS_H_
 
+#include <sys/types.h>
+
 #include <regex>
 #include <string>
 #include <vector>
@@ -33,6 +35,10 @@ static inline bool ValidateTargetSlotSuffix(const std::string& input) {
 // Wrapper on fork/execv to run a command in a subprocess.
 bool Exec(const std::vector<std::string>& arg_vector, std::string* error_msg);
 
+// Like Exec, but returns the pid of the subprocess without waiting for it, or -1
+// if it could not be started.
+pid_t ExecAsync(const std::vector<std::string>& arg_vector, std::string* error_msg);
+
 }  // namespace installd
 }  // namespace android
 
@@ -17,12 +17,16 @@
 
 #include "run_dex2oat.h"
 
+#include <sys/sysinfo.h>
+
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include <android-base/file.h>
 #include <android-base/logging.h>
+#include <android-base/parseint.h>
 #include <android-base/properties.h>
 #include <android-base/scopeguard.h>
 #include <android-base/stringprintf.h>
@@ -82,7 +86,8 @@ void RunDex2Oat::Initialize(const UniqueFile& output_oat,
                             bool generate_compact_dex,
                             bool use_jitzygote,
                             bool background_job_compile,
-                            const char* compilation_reason) {
+                            const char* compilation_reason,
+                            unsigned concurrent_jobs) {
     PrepareBootImageFlags(use_jitzygote);
 
     PrepareInputFileFlags(output_oat, output_vdex, output_image, input_dex, input_vdex,
@@ -94,7 +99,7 @@ void RunDex2Oat::Initialize(const UniqueFile& output_oat,
                                generate_compact_dex, compilation_reason);
 
     PrepareCompilerRuntimeAndPerfConfigFlags(post_bootcomplete, for_restore,
-                                             background_job_compile);
+                                             background_job_compile, concurrent_jobs);
 
     const std::string dex2oat_flags = GetProperty("dalvik.vm.dex2oat-flags", "");
     std::vector<std::string> dex2oat_flags_args = SplitBySpaces(dex2oat_flags);
@@ -276,11 +281,13 @@ void RunDex2Oat::PrepareCompilerConfigFlags(const UniqueFile& input_vdex,
 
 void RunDex2Oat::PrepareCompilerRuntimeAndPerfConfigFlags(bool post_bootcomplete,
                                                           bool for_restore,
-                                                          bool background_job_compile) {
+                                                          bool background_job_compile,
+                                                          unsigned concurrent_jobs) {
     // CPU set
+    std::string dex2oat_cpu_set_arg;
     {
         std::string cpu_set_format = "--cpu-set=%s";
-        std::string dex2oat_cpu_set_arg = post_bootcomplete
+        dex2oat_cpu_set_arg = post_bootcomplete
                 ? (for_restore
                    ? MapPropertyToArgWithBackup(
                            "dalvik.vm.restore-dex2oat-cpu-set",
@@ -312,6 +319,10 @@ void RunDex2Oat::PrepareCompilerRuntimeAndPerfConfigFlags(bool post_bootcomplete
                               threads_format)
                       : MapPropertyToArg("dalvik.vm.dex2oat-threads", threads_format)))
                 : MapPropertyToArg("dalvik.vm.boot-dex2oat-threads", threads_format);
+        if (concurrent_jobs > 1) {
+            dex2oat_threads_arg =
+                    ShareCpusArg(dex2oat_cpu_set_arg, dex2oat_threads_arg, concurrent_jobs);
+        }
         AddArg(dex2oat_threads_arg);
     }
 
@@ -325,6 +336,27 @@ void RunDex2Oat::PrepareCompilerRuntimeAndPerfConfigFlags(bool post_bootcomplete
     }
 }
 
+std::string RunDex2Oat::ShareCpusArg(const std::string& cpu_set_arg,
+                                     const std::string& threads_arg, unsigned concurrent_jobs) {
+    // dex2oat runs a thread per CPU of its CPU set by default.
+    unsigned cpus = 0;
+    if (cpu_set_arg.empty()) {
+        cpus = std::max(get_nprocs(), 1);
+    } else {
+        cpus = static_cast<unsigned>(std::count(cpu_set_arg.begin(), cpu_set_arg.end(), ',')) + 1;
+    }
+    unsigned threads = cpus;
+    if (android::base::StartsWith(threads_arg, "-j") &&
+        !android::base::ParseUint(threads_arg.substr(2), &threads)) {
+        return threads_arg;
+    }
+
+    // Share the CPUs between the jobs, rather than oversubscribe them with the
+    // threads of each job.
+    threads = std::clamp(cpus / concurrent_jobs, 1u, std::max(threads, 1u));
+    return StringPrintf("-j%u", threads);
+}
+
 void RunDex2Oat::Exec(int exit_code) {
     execv_helper_->Exec(exit_code);
 }
@@ -52,7 +52,8 @@ class RunDex2Oat {
                     bool generate_compact_dex,
                     bool use_jitzygote,
                     bool background_job_compile,
-                    const char* compilation_reason);
+                    const char* compilation_reason,
+                    unsigned concurrent_jobs = 1);
 
     void Exec(int exit_code);
 
@@ -79,12 +80,18 @@ class RunDex2Oat {
                                     const char* compilation_reason);
     void PrepareCompilerRuntimeAndPerfConfigFlags(bool post_bootcomplete,
                                                   bool for_restore,
-                                                  bool background_job_compile);
+                                                  bool background_job_compile,
+                                                  unsigned concurrent_jobs);
 
     virtual std::string GetProperty(const std::string& key, const std::string& default_value);
     virtual bool GetBoolProperty(const std::string& key, bool default_value);
 
   private:
+    // Returns the thread count arg of a job which runs with concurrent_jobs - 1
+    // other jobs.
+    static std::string ShareCpusArg(const std::string& cpu_set_arg,
+                                    const std::string& threads_arg, unsigned concurrent_jobs);
+
     void AddArg(const std::string& arg);
     void AddRuntimeArg(const std::string& arg);
 
@@ -117,6 +117,7 @@ class RunDex2OatTest : public testing::Test {
         bool use_jitzygote = false;
         bool background_job_compile = false;
         const char* compilation_reason = nullptr;
+        unsigned concurrent_jobs = 1;
     };
 
     class FakeExecVHelper : public ExecVHelper {
@@ -261,7 +262,8 @@ class RunDex2OatTest : public testing::Test {
                           args->generate_compact_dex,
                           args->use_jitzygote,
                           args->background_job_compile,
-                          args->compilation_reason);
+                          args->compilation_reason,
+                          args->concurrent_jobs);
         runner.Exec(/*exit_code=*/ 0);
     }
 
@@ -537,6 +539,44 @@ TEST_F(RunDex2OatTest, ThreadsPostBootCompleteForRestore_Backup) {
     VerifyExpectedFlags();
 }
 
+TEST_F(RunDex2OatTest, ThreadsConcurrentJobsShareCpuSet) {
+    setSystemProperty("dalvik.vm.dex2oat-cpu-set", "0,1,2,3,4,5");
+    setSystemProperty("dalvik.vm.dex2oat-threads", "4");
+    auto args = RunDex2OatArgs::MakeDefaultTestArgs();
+    args->post_bootcomplete = true;
+    args->concurrent_jobs = 2;
+    CallRunDex2Oat(std::move(args));
+
+    SetExpectedFlagUsed("--cpu-set", "=0,1,2,3,4,5");
+    SetExpectedFlagUsed("-j", "3");
+    VerifyExpectedFlags();
+}
+
+TEST_F(RunDex2OatTest, ThreadsConcurrentJobsKeepFewerThreads) {
+    setSystemProperty("dalvik.vm.dex2oat-cpu-set", "0,1,2,3,4,5");
+    setSystemProperty("dalvik.vm.dex2oat-threads", "2");
+    auto args = RunDex2OatArgs::MakeDefaultTestArgs();
+    args->post_bootcomplete = true;
+    args->concurrent_jobs = 2;
+    CallRunDex2Oat(std::move(args));
+
+    SetExpectedFlagUsed("--cpu-set", "=0,1,2,3,4,5");
+    SetExpectedFlagUsed("-j", "2");
+    VerifyExpectedFlags();
+}
+
+TEST_F(RunDex2OatTest, ThreadsConcurrentJobsRunOneThreadAtLeast) {
+    setSystemProperty("dalvik.vm.dex2oat-cpu-set", "0,1");
+    auto args = RunDex2OatArgs::MakeDefaultTestArgs();
+    args->post_bootcomplete = true;
+    args->concurrent_jobs = 4;
+    CallRunDex2Oat(std::move(args));
+
+    SetExpectedFlagUsed("--cpu-set", "=0,1");
+    SetExpectedFlagUsed("-j", "1");
+    VerifyExpectedFlags();
+}
+
 TEST_F(RunDex2OatTest, Debuggable) {
     auto args = RunDex2OatArgs::MakeDefaultTestArgs();
     args->debuggable = true;
@@ -16,11 +16,14 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <gtest/gtest.h>
 
 #include "installd_constants.h"
+#include "otapreopt_batch.h"
 #include "otapreopt_parameters.h"
 
 namespace android {
@@ -244,5 +247,69 @@ TEST_F(OTAPreoptTest, ReadArgumentsFailInvalidSlot) {
     ASSERT_FALSE(params.ReadArguments(args.size() - 1, args.data()));
 }
 
+TEST(OtaCheckpointTest, ResumesTheSameUpdate) {
+    TemporaryDir dir;
+    const std::string path = std::string(dir.path) + "/checkpoint";
+    {
+        OtaCheckpoint checkpoint(path, "fingerprint/1");
+        EXPECT_FALSE(checkpoint.IsCompleted("dexopt a"));
+        checkpoint.MarkCompleted("dexopt a");
+        EXPECT_TRUE(checkpoint.IsCompleted("dexopt a"));
+    }
+    {
+        OtaCheckpoint checkpoint(path, "fingerprint/1");
+        EXPECT_TRUE(checkpoint.IsCompleted("dexopt a"));
+        EXPECT_FALSE(checkpoint.IsCompleted("dexopt b"));
+        checkpoint.MarkCompleted("dexopt b");
+    }
+    OtaCheckpoint checkpoint(path, "fingerprint/1");
+    EXPECT_TRUE(checkpoint.IsCompleted("dexopt a"));
+    EXPECT_TRUE(checkpoint.IsCompleted("dexopt b"));
+}
+
+TEST(OtaCheckpointTest, DiscardsAnotherUpdate) {
+    TemporaryDir dir;
+    const std::string path = std::string(dir.path) + "/checkpoint";
+    OtaCheckpoint(path, "fingerprint/1").MarkCompleted("dexopt a");
+
+    EXPECT_FALSE(OtaCheckpoint(path, "fingerprint/2").IsCompleted("dexopt a"));
+    // Nor is the discarded checkpoint back for the first update.
+    EXPECT_FALSE(OtaCheckpoint(path, "fingerprint/1").IsCompleted("dexopt a"));
+}
+
+TEST(OtaBatchTest, ReadBuildFingerprint) {
+    TemporaryFile build_prop;
+    ASSERT_TRUE(android::base::WriteStringToFile(
+            "ro.build.id=ABC\nro.build.fingerprint=brand/device:15/ABC/1:user/release-keys\n",
+            build_prop.path));
+    EXPECT_EQ("brand/device:15/ABC/1:user/release-keys", ReadBuildFingerprint(build_prop.path));
+    EXPECT_EQ("", ReadBuildFingerprint("/does/not/exist"));
+}
+
+TEST(OtaBatchTest, ParsePressureAvg10) {
+    float avg10 = 0;
+    ASSERT_TRUE(ParsePressureAvg10("some avg10=12.50 avg60=3.00 avg300=1.00 total=100\n"
+                                   "full avg10=2.00 avg60=1.00 avg300=0.50 total=10\n",
+                                   &avg10));
+    EXPECT_FLOAT_EQ(12.5f, avg10);
+    EXPECT_FALSE(ParsePressureAvg10("full avg10=2.00 avg60=1.00 avg300=0.50 total=10\n",
+                                    &avg10));
+}
+
+TEST(OtaBatchTest, IsThermalThrottledAbovePassiveTripPoint) {
+    TemporaryDir dir;
+    const std::string zone = std::string(dir.path) + "/thermal_zone0";
+    ASSERT_EQ(0, mkdir(zone.c_str(), 0700));
+    ASSERT_TRUE(android::base::WriteStringToFile("hot\n", zone + "/trip_point_0_type"));
+    ASSERT_TRUE(android::base::WriteStringToFile("40000\n", zone + "/trip_point_0_temp"));
+    ASSERT_TRUE(android::base::WriteStringToFile("passive\n", zone + "/trip_point_1_type"));
+    ASSERT_TRUE(android::base::WriteStringToFile("60000\n", zone + "/trip_point_1_temp"));
+
+    ASSERT_TRUE(android::base::WriteStringToFile("50000\n", zone + "/temp"));
+    EXPECT_FALSE(IsThermalThrottled(dir.path));
+    ASSERT_TRUE(android::base::WriteStringToFile("61000\n", zone + "/temp"));
+    EXPECT_TRUE(IsThermalThrottled(dir.path));
+}
+
 }  // namespace installd
 }  // namespace android
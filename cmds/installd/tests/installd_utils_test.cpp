@@ -21,6 +21,7 @@
 
 #include <android-base/logging.h>
 #include <android-base/scopeguard.h>
+#include <android-base/stringprintf.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -48,6 +49,7 @@
 namespace android {
 namespace installd {
 
+using android::base::StringPrintf;
 using ::testing::UnorderedElementsAre;
 
 class UtilsTest : public testing::Test {
@@ -678,6 +680,53 @@ TEST_F(UtilsTest, TestForEachSubdir) {
     EXPECT_THAT(result, UnorderedElementsAre("com.foo", "com.bar"));
 }
 
+TEST_F(UtilsTest, CalculateTreeSize) {
+    auto deleter = [&]() {
+        delete_dir_contents_and_dir("/data/local/tmp/user/0", true /* ignore_if_missing */);
+    };
+    auto scope_guard = android::base::make_scope_guard(deleter);
+
+    // Enough directories for the measurement to run on several threads.
+    std::vector<std::string> paths = {"/data/local/tmp/user/0"};
+    for (int i = 0; i < 8; i++) {
+        const std::string dir = StringPrintf("/data/local/tmp/user/0/dir%d", i);
+        paths.push_back(dir);
+        paths.push_back(dir + "/sub");
+        paths.push_back(dir + "/sub/file");
+        paths.push_back(dir + "/link");
+    }
+    system("mkdir -p /data/local/tmp/user/0");
+    for (int i = 0; i < 8; i++) {
+        system(StringPrintf("mkdir -p /data/local/tmp/user/0/dir%d/sub", i).c_str());
+        system(StringPrintf("head -c %d /dev/zero > /data/local/tmp/user/0/dir%d/sub/file",
+                            i * 10000, i).c_str());
+        // Links are measured, but not followed.
+        system(StringPrintf("ln -s /data/local/tmp /data/local/tmp/user/0/dir%d/link", i).c_str());
+    }
+
+    int64_t expected = 0;
+    for (const std::string& path : paths) {
+        struct stat st;
+        ASSERT_EQ(0, lstat(path.c_str(), &st)) << path;
+        expected += st.st_blocks * 512;
+    }
+
+    int64_t size = 0;
+    ASSERT_EQ(0, calculate_tree_size("/data/local/tmp/user/0", &size));
+    EXPECT_EQ(expected, size);
+
+    // The size of a file is its own.
+    size = 0;
+    ASSERT_EQ(0, calculate_tree_size("/data/local/tmp/user/0/dir7/sub/file", &size));
+    struct stat st;
+    ASSERT_EQ(0, lstat("/data/local/tmp/user/0/dir7/sub/file", &st));
+    EXPECT_EQ(st.st_blocks * 512, size);
+
+    // Sizes add up to the ones measured before.
+    ASSERT_EQ(0, calculate_tree_size("/data/local/tmp/user/0/missing", &size));
+    EXPECT_EQ(st.st_blocks * 512, size);
+}
+
 TEST_F(UtilsTest, TestSdkSandboxDataPaths) {
     // Ce data paths
     EXPECT_EQ("/data/misc_ce/0/sdksandbox",
@@ -25,11 +25,17 @@
 #include <sys/pidfd.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #include <sys/xattr.h>
 #include <unistd.h>
 #include <uuid/uuid.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/stringprintf.h>
@@ -464,47 +470,138 @@ int set_quota_project_id(const std::string& path, long project_id, bool set_inhe
     return 0;
 }
 
-int calculate_tree_size(const std::string& path, int64_t* size,
-        int32_t include_gid, int32_t exclude_gid, bool exclude_apps) {
-    FTS *fts;
-    FTSENT *p;
-    int64_t matchedSize = 0;
-    char *argv[] = { (char*) path.c_str(), nullptr };
-    if (!(fts = fts_open(argv, FTS_PHYSICAL | FTS_NOCHDIR | FTS_XDEV, nullptr))) {
-        if (errno != ENOENT) {
-            PLOG(ERROR) << "Failed to fts_open " << path;
+// The maximum number of threads which measure a tree, with the calling thread.
+static constexpr size_t kMaxTreeSizeThreads = 4;
+
+/**
+ * Measures the disk usage of a tree with a work queue of directories, which more threads join as
+ * the queue grows. The directories are read with getdents64 and their entries measured with
+ * fstatat, without opening or following them, nor crossing mount points.
+ */
+class TreeSizeWalker {
+public:
+    TreeSizeWalker(int32_t include_gid, int32_t exclude_gid, bool exclude_apps)
+          : mIncludeGid(include_gid), mExcludeGid(exclude_gid), mExcludeApps(exclude_apps) {}
+
+    int64_t measure(const std::string& path) {
+        struct stat st;
+        if (lstat(path.c_str(), &st) != 0) {
+            return 0;
+        }
+        mRootDev = st.st_dev;
+        measureEntry(path, st, &mSize, &mDirs);
+        run();
+        // The workers are only started while there is work left, so none is started from now.
+        for (std::thread& worker : mWorkers) {
+            worker.join();
+        }
+        return mSize;
+    }
+
+private:
+    // Adds the size of the entry at path to size, and appends it to subdirs if its children are
+    // measured too.
+    void measureEntry(const std::string& path, const struct stat& st, int64_t* size,
+                      std::vector<std::string>* subdirs) {
+        int32_t user_uid = multiuser_get_app_id(st.st_uid);
+        int32_t user_gid = multiuser_get_app_id(st.st_gid);
+        if (mExcludeApps && ((user_uid >= AID_APP_START && user_uid <= AID_APP_END)
+                || (user_gid >= AID_CACHE_GID_START && user_gid <= AID_CACHE_GID_END)
+                || (user_gid >= AID_SHARED_GID_START && user_gid <= AID_SHARED_GID_END))) {
+            // Don't traverse inside or measure
+            return;
+        }
+        if ((mIncludeGid == -1 || static_cast<int32_t>(st.st_gid) == mIncludeGid)
+                && (mExcludeGid == -1 || static_cast<int32_t>(st.st_gid) != mExcludeGid)) {
+            *size += st.st_blocks * 512;
+        }
+        if (S_ISDIR(st.st_mode) && st.st_dev == mRootDev) {
+            subdirs->push_back(path);
         }
-        return -1;
     }
-    while ((p = fts_read(fts)) != nullptr) {
-        switch (p->fts_info) {
-        case FTS_D:
-        case FTS_DEFAULT:
-        case FTS_F:
-        case FTS_SL:
-        case FTS_SLNONE:
-            int32_t uid = p->fts_statp->st_uid;
-            int32_t gid = p->fts_statp->st_gid;
-            int32_t user_uid = multiuser_get_app_id(uid);
-            int32_t user_gid = multiuser_get_app_id(gid);
-            if (exclude_apps && ((user_uid >= AID_APP_START && user_uid <= AID_APP_END)
-                    || (user_gid >= AID_CACHE_GID_START && user_gid <= AID_CACHE_GID_END)
-                    || (user_gid >= AID_SHARED_GID_START && user_gid <= AID_SHARED_GID_END))) {
-                // Don't traverse inside or measure
-                fts_set(fts, p, FTS_SKIP);
+
+    // Measures the children of the directory at path.
+    void measureDir(const std::string& path, int64_t* size, std::vector<std::string>* subdirs) {
+        unique_fd dfd(open(path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+        if (dfd == -1) {
+            return;
+        }
+        alignas(struct dirent) char buf[16 * 1024];
+        while (true) {
+            ssize_t n = TEMP_FAILURE_RETRY(syscall(__NR_getdents64, dfd.get(), buf, sizeof(buf)));
+            if (n <= 0) {
                 break;
             }
-            if (include_gid != -1 && gid != include_gid) {
-                break;
+            for (ssize_t offset = 0; offset < n;) {
+                // The layout of struct dirent is the one of linux_dirent64.
+                const struct dirent* de = reinterpret_cast<const struct dirent*>(buf + offset);
+                offset += de->d_reclen;
+                const char* name = de->d_name;
+                if (!strcmp(name, ".") || !strcmp(name, "..")) {
+                    continue;
+                }
+                struct stat st;
+                if (fstatat(dfd.get(), name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                    continue;
+                }
+                measureEntry(path + "/" + name, st, size, subdirs);
             }
-            if (exclude_gid != -1 && gid == exclude_gid) {
+        }
+    }
+
+    void run() {
+        int64_t size = 0;
+        std::vector<std::string> subdirs;
+        std::unique_lock<std::mutex> lock(mLock);
+        while (true) {
+            mWorkAvailable.wait(lock, [this] { return !mDirs.empty() || mBusyThreads == 0; });
+            if (mDirs.empty()) {
                 break;
             }
-            matchedSize += (p->fts_statp->st_blocks * 512);
-            break;
+            std::string dir = std::move(mDirs.back());
+            mDirs.pop_back();
+            mBusyThreads++;
+            lock.unlock();
+
+            measureDir(dir, &size, &subdirs);
+
+            lock.lock();
+            mBusyThreads--;
+            mDirs.insert(mDirs.end(), std::make_move_iterator(subdirs.begin()),
+                         std::make_move_iterator(subdirs.end()));
+            if (!subdirs.empty()) {
+                if (mDirs.size() > 1 && mWorkers.size() + 1 < mMaxThreads) {
+                    mWorkers.emplace_back([this] { run(); });
+                }
+                mWorkAvailable.notify_all();
+            } else if (mBusyThreads == 0 && mDirs.empty()) {
+                mWorkAvailable.notify_all();
+            }
+            subdirs.clear();
         }
-    }
-    fts_close(fts);
+        mSize += size;
+    }
+
+    const int32_t mIncludeGid;
+    const int32_t mExcludeGid;
+    const bool mExcludeApps;
+    const size_t mMaxThreads =
+            std::clamp<size_t>(std::thread::hardware_concurrency(), 1, kMaxTreeSizeThreads);
+    dev_t mRootDev = 0;
+
+    std::mutex mLock;
+    std::condition_variable mWorkAvailable;
+    // The directories whose children are left to measure.
+    std::vector<std::string> mDirs;
+    // The number of threads which measure a directory.
+    size_t mBusyThreads = 0;
+    std::vector<std::thread> mWorkers;
+    int64_t mSize = 0;
+};
+
+int calculate_tree_size(const std::string& path, int64_t* size,
+        int32_t include_gid, int32_t exclude_gid, bool exclude_apps) {
+    int64_t matchedSize = TreeSizeWalker(include_gid, exclude_gid, exclude_apps).measure(path);
 #if MEASURE_DEBUG
     if ((include_gid == -1) && (exclude_gid == -1)) {
         LOG(DEBUG) << "Measured " << path << " size " << matchedSize;
@@ -19,6 +19,8 @@
 #include <getopt.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <functional>
 #include <iomanip>
@@ -26,6 +28,7 @@
 #include <map>
 #include <regex>
 #include <sstream>
+#include <thread>
 
 #include <android-base/file.h>
 #include <android-base/hex.h>
@@ -211,6 +214,7 @@ bool ListCommand::getPidInfo(
 }
 
 const BinderPidInfo* ListCommand::getPidInfoCached(pid_t serverPid) {
+    std::lock_guard<std::mutex> lock(mFetchMutex);
     auto pair = mCachedPidInfos.insert({serverPid, BinderPidInfo{}});
     if (pair.second /* did insertion take place? */) {
         if (!getPidInfo(serverPid, &pair.first->second)) {
@@ -621,14 +625,40 @@ Status ListCommand::fetchBinderized(const sp<IServiceManager> &manager) {
 
     Status status = OK;
     std::map<std::string, TableEntry> allTableEntries;
+    std::vector<TableEntry*> entries;
     for (const auto& fqInstanceName : *fqInstanceNames) {
         // create entry and default assign all fields.
         TableEntry& entry = allTableEntries[fqInstanceName];
         entry.interfaceName = fqInstanceName;
         entry.transport = mode;
         entry.serviceStatus = ServiceStatus::NON_RESPONSIVE;
+        entries.push_back(&entry);
+    }
 
-        status |= fetchBinderizedEntry(manager, &entry);
+    // Each HAL is queried with several IPCs, each one of them with its own timeout, so query up
+    // to mJobs HALs at once.
+    std::atomic<size_t> nextEntry = 0;
+    const auto fetchEntries = [&] {
+        for (size_t i = nextEntry++; i < entries.size(); i = nextEntry++) {
+            auto start = std::chrono::steady_clock::now();
+            Status entryStatus = fetchBinderizedEntry(manager, entries[i]);
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start);
+            std::lock_guard<std::mutex> lock(mFetchMutex);
+            if (mVerbose) {
+                err() << "Fetched \"" << entries[i]->interfaceName << "\" in " << elapsed.count()
+                      << "ms" << std::endl;
+            }
+            status |= entryStatus;
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min<size_t>(mJobs, entries.size()); ++i) {
+        workers.emplace_back(fetchEntries);
+    }
+    fetchEntries();
+    for (std::thread& worker : workers) {
+        worker.join();
     }
 
     for (auto& pair : allTableEntries) {
@@ -641,6 +671,7 @@ Status ListCommand::fetchBinderizedEntry(const sp<IServiceManager> &manager,
                                          TableEntry *entry) {
     Status status = OK;
     const auto handleError = [&](Status additionalError, const std::string& msg) {
+        std::lock_guard<std::mutex> lock(mFetchMutex);
         err() << "Warning: Skipping \"" << entry->interfaceName << "\": " << msg << std::endl;
         status |= DUMP_BINDERIZED_ERROR | additionalError;
     };
@@ -1000,6 +1031,21 @@ void ListCommand::registerAllOptions() {
         thiz->mNeat = true;
         return OK;
     }, "output is machine parsable (no explanatory text).\nCannot be used with --debug."});
+    mOptions.push_back({'\0', "jobs", required_argument, v++, [](ListCommand* thiz, const char* arg) {
+        char* end;
+        long jobs = strtol(arg, &end, 10);
+        if (*end != '\0' || jobs <= 0) {
+            thiz->err() << "Invalid number of jobs: " << arg << std::endl;
+            return USAGE;
+        }
+        thiz->mJobs = jobs;
+        return OK;
+    }, "query up to 'arg' binderized HALs at once. Default is " + std::to_string(kDefaultJobs) +
+       "."});
+    mOptions.push_back({'\0', "verbose", no_argument, v++, [](ListCommand* thiz, const char*) {
+        thiz->mVerbose = true;
+        return OK;
+    }, "print the time taken to query each binderized HAL to stderr."});
     mOptions.push_back(
             {'\0', "types", required_argument, v++,
              [](ListCommand* thiz, const char* arg) {
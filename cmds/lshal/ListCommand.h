@@ -20,6 +20,7 @@
 #include <stdint.h>
 
 #include <fstream>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -85,6 +86,9 @@ public:
 
     static std::string INIT_VINTF_NOTES;
 
+    // Number of binderized HALs fetched at once by default.
+    static constexpr size_t kDefaultJobs = 8;
+
 protected:
     Status parseArgs(const Arg &arg);
     // Retrieve first-hand information
@@ -175,6 +179,16 @@ protected:
     // If true, explanatory text are not emitted.
     bool mNeat = false;
 
+    // Number of binderized HALs fetched at once.
+    size_t mJobs = kDefaultJobs;
+
+    // If true, the time taken to fetch each binderized HAL is emitted to err().
+    bool mVerbose = false;
+
+    // Guards the state shared by the threads which fetch binderized HALs: mCachedPidInfos and
+    // err().
+    std::mutex mFetchMutex;
+
     // Type(s) of HAL associations to list.
     std::vector<HalType> mListTypes{};
     // Type(s) of HAL associations to fetch.
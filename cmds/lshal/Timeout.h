@@ -18,6 +18,8 @@
 
 #include <chrono>
 #include <future>
+#include <mutex>
+#include <vector>
 
 #include <hidl/Status.h>
 #include <utils/Errors.h>
@@ -47,8 +49,12 @@ timeoutIPC(std::chrono::duration<R, P> wait, const sp<I> &interfaceObject, Funct
     // Putting this in the global list avoids std::future::~future() that may wait for the
     // result to come back.
     // This leaks memory, but lshal is a debugging tool, so this is fine.
+    static std::mutex gDeadPoolMutex;
     static std::vector<decltype(future)> gDeadPool{};
-    gDeadPool.emplace_back(std::move(future));
+    {
+        std::lock_guard<std::mutex> lock(gDeadPoolMutex);
+        gDeadPool.emplace_back(std::move(future));
+    }
 
     if (status == std::future_status::timeout) {
         return Status::fromStatusT(TIMED_OUT);
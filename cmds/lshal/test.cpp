@@ -561,6 +561,28 @@ TEST_F(ListTest, DumpDefault) {
     EXPECT_EQ("", err.str());
 }
 
+TEST_F(ListTest, DumpVerboseWithJobs) {
+    const std::string expected =
+        "[fake description 0]\n"
+        "Interface\n"
+        "a.h.foo1@1.0::IFoo/1\n"
+        "a.h.foo2@2.0::IFoo/2\n"
+        "\n";
+
+    optind = 1; // mimic Lshal::parseArg()
+    EXPECT_EQ(0u, mockList->main(createArg({"lshal", "-i", "--types=b", "--verbose", "--jobs",
+                                            "2"})));
+    EXPECT_EQ(expected, out.str());
+    EXPECT_THAT(err.str(), HasSubstr("Fetched \"a.h.foo1@1.0::IFoo/1\" in "));
+    EXPECT_THAT(err.str(), HasSubstr("Fetched \"a.h.foo2@2.0::IFoo/2\" in "));
+}
+
+TEST_F(ListTest, InvalidJobs) {
+    optind = 1; // mimic Lshal::parseArg()
+    EXPECT_NE(0u, mockList->main(createArg({"lshal", "--jobs", "0"})));
+    EXPECT_THAT(err.str(), HasSubstr("Invalid number of jobs: 0"));
+}
+
 TEST_F(ListTest, DumpHash) {
     const std::string expected =
         "[fake description 0]\n"
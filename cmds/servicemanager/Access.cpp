@@ -126,6 +126,7 @@ bool Access::canAdd(const CallingContext& ctx, const std::string& name) {
 }
 
 bool Access::canList(const CallingContext& ctx) {
+    std::lock_guard lock(mSelinuxMutex);
     return actionAllowed(ctx, mThisProcessContext, "list", "service_manager");
 }
 
@@ -153,14 +154,41 @@ bool Access::actionAllowed(const CallingContext& sctx, const char* tctx, const c
 
 bool Access::actionAllowedFromLookup(const CallingContext& sctx, const std::string& name, const char *perm) {
 #ifdef __ANDROID__
-    char *tctx = nullptr;
-    if (selabel_lookup(getSehandle(), &tctx, name.c_str(), SELABEL_CTX_ANDROID_SERVICE) != 0) {
-        LOG(ERROR) << "SELinux: No match for " << name << " in service_contexts.\n";
-        return false;
+    // Both only read the status page which the kernel updates, so they need no lock.
+    const PolicyState policyState = {
+        .policyLoad = selinux_status_policyload(),
+        .enforcing = selinux_status_getenforce(),
+    };
+    std::string key = sctx.sid;
+    key.append(1, '\0').append(perm).append(1, '\0').append(name);
+    if (policyState.policyLoad >= 0) {
+        std::shared_lock lock(mCacheMutex);
+        if (mCachedPolicyState == policyState && mAllowedLookups.count(key) > 0) {
+            return true;
+        }
+    }
+
+    bool allowed = false;
+    {
+        std::lock_guard lock(mSelinuxMutex);
+        char *tctx = nullptr;
+        if (selabel_lookup(getSehandle(), &tctx, name.c_str(), SELABEL_CTX_ANDROID_SERVICE) != 0) {
+            LOG(ERROR) << "SELinux: No match for " << name << " in service_contexts.\n";
+            return false;
+        }
+
+        allowed = actionAllowed(sctx, tctx, perm, name);
+        freecon(tctx);
     }
 
-    bool allowed = actionAllowed(sctx, tctx, perm, name);
-    freecon(tctx);
+    if (allowed && policyState.policyLoad >= 0) {
+        std::unique_lock lock(mCacheMutex);
+        if (!(mCachedPolicyState == policyState) || mAllowedLookups.size() >= kMaxCachedLookups) {
+            mAllowedLookups.clear();
+            mCachedPolicyState = policyState;
+        }
+        mAllowedLookups.insert(std::move(key));
+    }
     return allowed;
 #else
     (void)sctx;
@@ -16,12 +16,19 @@
 
 #pragma once
 
+#include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <sys/types.h>
+#include <unordered_set>
 
 namespace android {
 
 // singleton
+//
+// Thread-safe. Calls into libselinux, whose AVC is not thread-safe, are serialized, but granted
+// lookups are cached, so that concurrent lookups of the same services don't queue behind each
+// other.
 class Access {
 public:
     Access();
@@ -51,6 +58,27 @@ private:
             const char *perm);
 
     char* mThisProcessContext = nullptr;
+
+    std::mutex mSelinuxMutex;
+
+    // The policy which the cached decisions were made with. A policy reload or a change of the
+    // enforcing mode drops the cache.
+    struct PolicyState {
+        int policyLoad = -1;
+        int enforcing = -1;
+
+        bool operator==(const PolicyState& other) const {
+            return policyLoad == other.policyLoad && enforcing == other.enforcing;
+        }
+    };
+
+    // Denials are not cached, so that each of them is still audited. The cache is dropped once it
+    // reaches kMaxCachedLookups.
+    static constexpr size_t kMaxCachedLookups = 4096;
+    std::shared_mutex mCacheMutex;
+    PolicyState mCachedPolicyState;
+    // Keyed by the caller context, the permission and the service name.
+    std::unordered_set<std::string> mAllowedLookups;
 };
 
 };
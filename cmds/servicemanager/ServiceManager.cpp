@@ -25,6 +25,7 @@
 #include <binder/Stability.h>
 #include <cutils/android_filesystem_config.h>
 #include <cutils/multiuser.h>
+#include <mutex>
 #include <thread>
 
 #ifndef VENDORSERVICEMANAGER
@@ -358,16 +359,23 @@ sp<IBinder> ServiceManager::tryGetService(const std::string& name, bool startIfN
     auto ctx = mAccess->getCallingContext();
 
     sp<IBinder> out;
-    Service* service = nullptr;
-    if (auto it = mNameToService.find(name); it != mNameToService.end()) {
-        service = &(it->second);
-
-        if (!service->allowIsolated && is_multiuser_uid_isolated(ctx.uid)) {
-            LOG(WARNING) << "Isolated app with UID " << ctx.uid << " requested '" << name
-                         << "', but the service is not allowed for isolated apps.";
-            return nullptr;
+    // Whether the lookup has to update the client guarantee of the service, which it can only do
+    // with the mutex held exclusively. Once the guarantee of a service without client callbacks is
+    // set, nothing clears it, so most lookups only need the mutex shared.
+    bool updateClients = false;
+    {
+        std::shared_lock lock(mMutex);
+        if (auto it = mNameToService.find(name); it != mNameToService.end()) {
+            const Service& service = it->second;
+
+            if (!service.allowIsolated && is_multiuser_uid_isolated(ctx.uid)) {
+                LOG(WARNING) << "Isolated app with UID " << ctx.uid << " requested '" << name
+                             << "', but the service is not allowed for isolated apps.";
+                return nullptr;
+            }
+            out = service.binder;
+            updateClients = !service.guaranteeClient || mNameToClientCallback.count(name) > 0;
         }
-        out = service->binder;
     }
 
     if (!mAccess->canFind(ctx, name)) {
@@ -378,15 +386,21 @@ sp<IBinder> ServiceManager::tryGetService(const std::string& name, bool startIfN
         tryStartService(ctx, name);
     }
 
-    if (out) {
-        // Force onClients to get sent, and then make sure the timerfd won't clear it
-        // by setting guaranteeClient again. This logic could be simplified by using
-        // a time-based guarantee. However, forcing onClients(true) to get sent
-        // right here is always going to be important for processes serving multiple
-        // lazy interfaces.
-        service->guaranteeClient = true;
-        CHECK(handleServiceClientCallback(2 /* sm + transaction */, name, false));
-        service->guaranteeClient = true;
+    if (out && updateClients) {
+        std::unique_lock lock(mMutex);
+        // The service may have been replaced or removed while the mutex was released.
+        auto it = mNameToService.find(name);
+        if (it != mNameToService.end() && it->second.binder == out) {
+            Service* service = &(it->second);
+            // Force onClients to get sent, and then make sure the timerfd won't clear it
+            // by setting guaranteeClient again. This logic could be simplified by using
+            // a time-based guarantee. However, forcing onClients(true) to get sent
+            // right here is always going to be important for processes serving multiple
+            // lazy interfaces.
+            service->guaranteeClient = true;
+            CHECK(handleServiceClientCallback(2 /* sm + transaction */, name, false));
+            service->guaranteeClient = true;
+        }
     }
 
     return out;
@@ -445,6 +459,7 @@ Status ServiceManager::addService(const std::string& name, const sp<IBinder>& bi
         return Status::fromExceptionCode(Status::EX_ILLEGAL_STATE, "Couldn't linkToDeath.");
     }
 
+    std::unique_lock lock(mMutex);
     auto it = mNameToService.find(name);
     bool prevClients = false;
     if (it != mNameToService.end()) {
@@ -503,6 +518,7 @@ Status ServiceManager::listServices(int32_t dumpPriority, std::vector<std::strin
         return Status::fromExceptionCode(Status::EX_SECURITY, "SELinux denied.");
     }
 
+    std::shared_lock lock(mMutex);
     size_t toReserve = 0;
     for (auto const& [name, service] : mNameToService) {
         (void) name;
@@ -558,6 +574,7 @@ Status ServiceManager::registerForNotifications(
         return Status::fromExceptionCode(Status::EX_ILLEGAL_STATE, "Couldn't link to death.");
     }
 
+    std::unique_lock lock(mMutex);
     mNameToRegistrationCallback[name].push_back(callback);
 
     if (auto it = mNameToService.find(name); it != mNameToService.end()) {
@@ -578,6 +595,7 @@ Status ServiceManager::unregisterForNotifications(
         return Status::fromExceptionCode(Status::EX_SECURITY, "SELinux denied.");
     }
 
+    std::unique_lock lock(mMutex);
     bool found = false;
 
     auto it = mNameToRegistrationCallback.find(name);
@@ -709,6 +727,7 @@ void ServiceManager::removeRegistrationCallback(const wp<IBinder>& who,
 }
 
 void ServiceManager::binderDied(const wp<IBinder>& who) {
+    std::unique_lock lock(mMutex);
     for (auto it = mNameToService.begin(); it != mNameToService.end();) {
         if (who == it->second.binder) {
             // TODO: currently, this entry contains the state also
@@ -762,6 +781,7 @@ Status ServiceManager::registerClientCallback(const std::string& name, const sp<
         return Status::fromExceptionCode(Status::EX_SECURITY, "SELinux denied.");
     }
 
+    std::unique_lock lock(mMutex);
     auto serviceIt = mNameToService.find(name);
     if (serviceIt == mNameToService.end()) {
         ALOGE("Could not add callback for nonexistent service: %s", name.c_str());
@@ -832,6 +852,7 @@ ssize_t ServiceManager::Service::getNodeStrongRefCount() {
 }
 
 void ServiceManager::handleClientCallbacks() {
+    std::unique_lock lock(mMutex);
     for (const auto& [name, service] : mNameToService) {
         handleServiceClientCallback(1 /* sm has one refcount */, name, true);
     }
@@ -919,6 +940,7 @@ Status ServiceManager::tryUnregisterService(const std::string& name, const sp<IB
         return Status::fromExceptionCode(Status::EX_SECURITY, "SELinux denied.");
     }
 
+    std::unique_lock lock(mMutex);
     auto serviceIt = mNameToService.find(name);
     if (serviceIt == mNameToService.end()) {
         ALOGW("Tried to unregister %s, but that service wasn't registered to begin with.",
@@ -976,6 +998,7 @@ Status ServiceManager::getServiceDebugInfo(std::vector<ServiceDebugInfo>* outRet
         return Status::fromExceptionCode(Status::EX_SECURITY, "SELinux denied.");
     }
 
+    std::shared_lock lock(mMutex);
     outReturn->reserve(mNameToService.size());
     for (auto const& [name, service] : mNameToService) {
         ServiceDebugInfo info;
@@ -989,6 +1012,7 @@ Status ServiceManager::getServiceDebugInfo(std::vector<ServiceDebugInfo>* outRet
 }
 
 void ServiceManager::clear() {
+    std::unique_lock lock(mMutex);
     mNameToService.clear();
     mNameToRegistrationCallback.clear();
     mNameToClientCallback.clear();
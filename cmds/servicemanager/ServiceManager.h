@@ -20,6 +20,8 @@
 #include <android/os/IClientCallback.h>
 #include <android/os/IServiceCallback.h>
 
+#include <shared_mutex>
+
 #include "Access.h"
 
 namespace android {
@@ -88,6 +90,8 @@ private:
     using ClientCallbackMap = std::map<std::string, std::vector<sp<IClientCallback>>>;
     using ServiceMap = std::map<std::string, Service>;
 
+    // The helpers below must be called with mMutex held exclusively.
+
     // removes a callback from mNameToRegistrationCallback, removing it if the vector is empty
     // this updates iterator to the next location
     void removeRegistrationCallback(const wp<IBinder>& who,
@@ -105,6 +109,10 @@ private:
 
     sp<IBinder> tryGetService(const std::string& name, bool startIfNotFound);
 
+    // Guards the maps. In the multi-threaded mode, the binder threads look services up with the
+    // mutex held shared, so that lookups don't queue behind each other. Registration, notifications
+    // and client callbacks hold it exclusively, so that they stay sequential.
+    std::shared_mutex mMutex;
     ServiceMap mNameToService;
     ServiceCallbackMap mNameToRegistrationCallback;
     ClientCallbackMap mNameToClientCallback;
@@ -23,6 +23,9 @@
 #include <utils/Looper.h>
 #include <utils/StrongPointer.h>
 
+#include <algorithm>
+#include <thread>
+
 #include "Access.h"
 #include "ServiceManager.h"
 
@@ -33,6 +36,7 @@ using ::android::LooperCallback;
 using ::android::ProcessState;
 using ::android::ServiceManager;
 using ::android::sp;
+using ::android::base::GetUintProperty;
 using ::android::base::SetProperty;
 using ::android::os::IServiceManager;
 
@@ -123,6 +127,9 @@ private:
     sp<BinderCallback> mBinderCallback;
 };
 
+// In the multi-threaded mode, this many binder threads join the looper thread.
+constexpr size_t kMaxExtraBinderThreads = 7;
+
 int main(int argc, char** argv) {
     android::base::InitLogging(argv, android::base::KernelLogger);
 
@@ -155,6 +162,21 @@ int main(int argc, char** argv) {
     sp<BinderCallback> binderCallback = BinderCallback::setupTo(looper);
     ClientCallbackCallback::setupTo(looper, manager, binderCallback);
 
+    // Lookups can run concurrently on the extra threads, which the driver hands transactions to
+    // just like to the looper thread. Everything else still runs sequentially, see
+    // ServiceManager::mMutex.
+    const size_t threadCount = GetUintProperty<size_t>("ro.servicemanager.threads", 1);
+    const size_t extraThreadCount = std::min(std::max<size_t>(threadCount, 1) - 1,
+                                             kMaxExtraBinderThreads);
+    for (size_t i = 0; i < extraThreadCount; i++) {
+        std::thread([] {
+            IPCThreadState::self()->joinThreadPool(true /*isMain*/);
+        }).detach();
+    }
+    if (extraThreadCount > 0) {
+        LOG(INFO) << "Handling requests on " << extraThreadCount + 1 << " threads";
+    }
+
 #ifndef VENDORSERVICEMANAGER
     if (!SetProperty("servicemanager.ready", "true")) {
         LOG(ERROR) << "Failed to set servicemanager ready property";
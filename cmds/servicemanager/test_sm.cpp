@@ -24,6 +24,10 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "Access.h"
 #include "ServiceManager.h"
 
@@ -536,3 +540,37 @@ TEST(ServiceNotifications, GetMultipleNotification) {
     EXPECT_THAT(cb->registrations, ElementsAre("asdfasdf", "asdfasdf"));
     EXPECT_THAT(cb->registrations, ElementsAre("asdfasdf", "asdfasdf"));
 }
+
+TEST(Concurrency, LookupsRunWhileServicesAreAdded) {
+    auto sm = getPermissiveServiceManager();
+
+    sp<IBinder> stable = getBinder();
+    EXPECT_TRUE(sm->addService("stable", stable,
+        false /*allowIsolated*/, IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+
+    std::atomic<bool> done = false;
+    std::vector<std::thread> lookups;
+    for (size_t i = 0; i < 4; i++) {
+        lookups.emplace_back([&] {
+            while (!done) {
+                sp<IBinder> out;
+                EXPECT_TRUE(sm->checkService("stable", &out).isOk());
+                EXPECT_EQ(stable, out);
+                EXPECT_TRUE(sm->checkService("changing", &out).isOk());
+            }
+        });
+    }
+
+    for (size_t i = 0; i < 200; i++) {
+        EXPECT_TRUE(sm->addService("changing", getBinder(),
+            false /*allowIsolated*/, IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+        std::vector<std::string> names;
+        EXPECT_TRUE(sm->listServices(IServiceManager::DUMP_FLAG_PRIORITY_ALL, &names).isOk());
+        EXPECT_THAT(names, ElementsAre("changing", "stable"));
+    }
+
+    done = true;
+    for (auto& lookup : lookups) {
+        lookup.join();
+    }
+}
@@ -27,15 +27,18 @@
 #include <gui/LayerState.h>
 #include <gui/Surface.h>
 #include <private/gui/ComposerService.h>
+#include <ui/Fence.h>
 
 #include <utils/Log.h>
 #include <utils/String8.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <condition_variable>
 #include <cstdlib>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -47,6 +50,135 @@
 
 using namespace android;
 
+namespace {
+
+// Measures the latency from applying each replayed transaction to the present of the frame it
+// was latched in, through transaction completed callbacks. Enabled by setting
+// SURFACEREPLAYER_LATENCY_CSV to the path of the per-transaction csv which is written
+// once the replay ends, along with a histogram of the latencies on stdout. Replaying with the wait
+// option replays at the recorded timestamps, otherwise as fast as possible.
+class TransactionLatencyRecorder {
+public:
+    static TransactionLatencyRecorder& getInstance() {
+        static TransactionLatencyRecorder sInstance;
+        return sInstance;
+    }
+
+    bool isEnabled() const { return !mCsvPath.empty(); }
+
+    // Registers the transaction completed callback, which must be called right before the
+    // transaction is applied.
+    void onApply(SurfaceComposerClient::Transaction& transaction, int64_t recordedTime) {
+        std::lock_guard lock(mMutex);
+        mRecords.push_back({.recordedTime = recordedTime, .applyTime = systemTime()});
+        mPendingCount++;
+        // The records are never erased, so the pointer to one stays valid.
+        transaction.addTransactionCompletedCallback(onTransactionCompleted, &mRecords.back());
+    }
+
+    // Waits for the pending callbacks, then writes the csv and the histogram.
+    void writeReport() {
+        std::unique_lock lock(mMutex);
+        if (!mCondition.wait_for(lock, kCallbackTimeout, [this] { return mPendingCount == 0; })) {
+            std::cerr << mPendingCount << " transactions did not complete" << std::endl;
+        }
+
+        std::ofstream csv(mCsvPath);
+        if (!csv) {
+            std::cerr << "Could not open " << mCsvPath << std::endl;
+            return;
+        }
+
+        csv << "recorded_time_ns,apply_time_ns,latch_time_ns,present_time_ns,latency_ns\n";
+        std::vector<nsecs_t> latencies;
+        for (auto& record : mRecords) {
+            nsecs_t presentTime = -1;
+            if (record.presentFence && record.presentFence->isValid() &&
+                record.presentFence->wait(kFenceTimeoutMs) == NO_ERROR) {
+                presentTime = record.presentFence->getSignalTime();
+            }
+            const nsecs_t latency = presentTime > 0 ? presentTime - record.applyTime : -1;
+            if (latency >= 0) {
+                latencies.push_back(latency);
+            }
+            csv << record.recordedTime << "," << record.applyTime << "," << record.latchTime << ","
+                << presentTime << "," << latency << "\n";
+        }
+        std::cout << "Wrote the latency of " << mRecords.size() << " transactions to " << mCsvPath
+                  << std::endl;
+        printHistogram(latencies);
+    }
+
+private:
+    struct Record {
+        int64_t recordedTime;
+        nsecs_t applyTime;
+        nsecs_t latchTime = -1;
+        sp<Fence> presentFence;
+    };
+
+    static constexpr auto kCallbackTimeout = std::chrono::seconds(5);
+    static constexpr int kFenceTimeoutMs = 1000;
+    static constexpr nsecs_t kBucketWidth = 1'000'000;
+    static constexpr size_t kBucketCount = 50;
+
+    TransactionLatencyRecorder() {
+        if (const char* path = std::getenv("SURFACEREPLAYER_LATENCY_CSV")) {
+            mCsvPath = path;
+        }
+    }
+
+    static void onTransactionCompleted(void* context, nsecs_t latchTime,
+                                       const sp<Fence>& presentFence,
+                                       const std::vector<SurfaceControlStats>& /*stats*/) {
+        auto& recorder = getInstance();
+        std::lock_guard lock(recorder.mMutex);
+        auto* record = static_cast<Record*>(context);
+        record->latchTime = latchTime;
+        record->presentFence = presentFence;
+        recorder.mPendingCount--;
+        recorder.mCondition.notify_all();
+    }
+
+    static void printHistogram(std::vector<nsecs_t> latencies) {
+        if (latencies.empty()) {
+            std::cout << "No transaction was presented" << std::endl;
+            return;
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        const auto percentile = [&latencies](size_t percent) {
+            return latencies[std::min(latencies.size() - 1, latencies.size() * percent / 100)];
+        };
+        std::cout << "Apply to present latency (ms): p50=" << percentile(50) / 1e6
+                  << " p90=" << percentile(90) / 1e6 << " p99=" << percentile(99) / 1e6
+                  << " max=" << latencies.back() / 1e6 << std::endl;
+
+        // One bucket per millisecond, with the last one holding everything above.
+        std::vector<size_t> buckets(kBucketCount);
+        for (const nsecs_t latency : latencies) {
+            buckets[std::min(static_cast<size_t>(latency / kBucketWidth), kBucketCount - 1)]++;
+        }
+        for (size_t i = 0; i < kBucketCount; i++) {
+            if (buckets[i] == 0) continue;
+            std::cout << (i == kBucketCount - 1 ? ">=" : "  ") << i << "ms: " << buckets[i]
+                      << std::endl;
+        }
+    }
+
+    std::string mCsvPath;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Record> mRecords;
+    size_t mPendingCount = 0;
+};
+
+// The recorded timestamp of the transaction replayed by the current thread.
+thread_local int64_t tRecordedTime = 0;
+
+} // namespace
+
 std::atomic_bool Replayer::sReplayingManually(false);
 
 Replayer::Replayer(const std::string& filename, bool replayManually, int numThreads, bool wait,
@@ -154,6 +286,10 @@ status_t Replayer::replay() {
 
     SurfaceComposerClient::enableVSyncInjections(false);
 
+    if (TransactionLatencyRecorder::getInstance().isEnabled()) {
+        TransactionLatencyRecorder::getInstance().writeReport();
+    }
+
     return status;
 }
 
@@ -279,7 +415,11 @@ status_t Replayer::dispatchEvent(int index) {
     status_t status = NO_ERROR;
     switch (increment.increment_case()) {
         case increment.kTransaction: {
-            std::thread(&Replayer::doTransaction, this, increment.transaction(), event).detach();
+            std::thread([this, transaction = increment.transaction(), event,
+                         timeStamp = increment.time_stamp()] {
+                tRecordedTime = timeStamp;
+                doTransaction(transaction, event);
+            }).detach();
         } break;
         case increment.kSurfaceCreation: {
             std::thread(&Replayer::createSurfaceControl, this, increment.surface_creation(), event)
@@ -346,6 +486,9 @@ status_t Replayer::doTransaction(const Transaction& t, const std::shared_ptr<Eve
 
     event->readyToExecute();
 
+    if (TransactionLatencyRecorder::getInstance().isEnabled()) {
+        TransactionLatencyRecorder::getInstance().onApply(liveTransaction, tRecordedTime);
+    }
     liveTransaction.apply(t.synchronous());
 
     ALOGV("Ended Transaction");
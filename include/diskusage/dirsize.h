@@ -24,6 +24,8 @@ __BEGIN_DECLS
 
 int64_t stat_size(struct stat *s);
 int64_t calculate_dir_size(int dfd);
+/* Like calculate_dir_size(), walking the tree on up to |threads| threads. */
+int64_t calculate_dir_size_parallel(int dfd, int threads);
 
 __END_DECLS
 
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace android::ftl::details {
+
+// Open-addressing table of the positions of the mappings of a SmallMap, which replaces its linear
+// search once it holds more than kLinearSearchMaxSize mappings. The mappings stay in the storage of
+// the map, and the table only holds their positions. Collisions are resolved by linear probing, and
+// erasure shifts back the positions which follow the erased one, rather than leaving tombstones.
+template <typename Hash>
+class SmallMapIndex {
+ public:
+  static constexpr std::size_t kLinearSearchMaxSize = 16;
+  static constexpr std::size_t kNotFound = std::numeric_limits<std::size_t>::max();
+
+  bool active() const { return !slots_.empty(); }
+
+  // Returns the position of the mapping for the given key, or kNotFound. The index must be active.
+  template <typename Map, typename Key, typename KeyEqual>
+  std::size_t find(const Map& map, const Key& key, KeyEqual equal) const {
+    for (std::size_t slot = home(key);; slot = next(slot)) {
+      const Position position = slots_[slot];
+      if (position == kEmpty) return kNotFound;
+      if (equal(map[position].first, key)) return position;
+    }
+  }
+
+  // Indexes the last mapping, once it is appended.
+  template <typename Map>
+  void push_back(const Map& map) {
+    const std::size_t size = map.size();
+    if (active() ? 2 * size > slots_.size() : size > kLinearSearchMaxSize) {
+      rebuild(map);
+    } else if (active()) {
+      place(map[size - 1].first, size - 1);
+    }
+  }
+
+  // Unindexes the mapping at the given position, and moves the last mapping to that position, before
+  // the map does the same with unstable_erase.
+  template <typename Map>
+  void unstable_erase(const Map& map, std::size_t position) {
+    if (!active()) return;
+
+    std::size_t gap = slot_of(map, position);
+    for (std::size_t slot = next(gap);; slot = next(slot)) {
+      const Position moved = slots_[slot];
+      if (moved == kEmpty) break;
+
+      // Shift back the positions which probing from their home slot would no longer reach.
+      const std::size_t mask = slots_.size() - 1;
+      if (((slot - home(map[moved].first)) & mask) >= ((slot - gap) & mask)) {
+        slots_[gap] = moved;
+        gap = slot;
+      }
+    }
+    slots_[gap] = kEmpty;
+
+    if (const std::size_t last = map.size() - 1; position != last) {
+      slots_[slot_of(map, last)] = static_cast<Position>(position);
+    }
+  }
+
+  // Indexes all of the mappings if there are more than kLinearSearchMaxSize of them.
+  template <typename Map>
+  void rebuild(const Map& map) {
+    const std::size_t size = map.size();
+    if (size <= kLinearSearchMaxSize) {
+      clear();
+      return;
+    }
+
+    // Keep the load factor between 1/4 and 1/2.
+    std::size_t capacity = 2 * kLinearSearchMaxSize;
+    shift_ = 64 - 5;
+    while (capacity < 4 * size) {
+      capacity *= 2;
+      shift_--;
+    }
+
+    slots_.assign(capacity, kEmpty);
+    for (std::size_t position = 0; position < size; position++) {
+      place(map[position].first, position);
+    }
+  }
+
+  void clear() { slots_.clear(); }
+
+ private:
+  using Position = std::uint32_t;
+  static constexpr Position kEmpty = std::numeric_limits<Position>::max();
+
+  // Fibonacci hashing spreads the hashes which only differ in their high bits, e.g. std::hash is
+  // the identity for integers.
+  template <typename Key>
+  std::size_t home(const Key& key) const {
+    return static_cast<std::size_t>(
+        (static_cast<std::uint64_t>(Hash{}(key)) * 0x9e3779b97f4a7c15u) >> shift_);
+  }
+
+  std::size_t next(std::size_t slot) const { return (slot + 1) & (slots_.size() - 1); }
+
+  template <typename Map>
+  std::size_t slot_of(const Map& map, std::size_t position) const {
+    std::size_t slot = home(map[position].first);
+    while (slots_[slot] != position) slot = next(slot);
+    return slot;
+  }
+
+  template <typename Key>
+  void place(const Key& key, std::size_t position) {
+    std::size_t slot = home(key);
+    while (slots_[slot] != kEmpty) slot = next(slot);
+    slots_[slot] = static_cast<Position>(position);
+  }
+
+  std::vector<Position> slots_;
+  int shift_ = 64;
+};
+
+// SmallMap without Hash only searches linearly.
+template <>
+class SmallMapIndex<void> {};
+
+}  // namespace android::ftl::details
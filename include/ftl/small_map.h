@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <ftl/details/small_map.h>
 #include <ftl/initializer_list.h>
 #include <ftl/optional.h>
 #include <ftl/small_vector.h>
@@ -36,6 +37,10 @@ namespace android::ftl {
 //
 // SmallMap<K, V, 0> unconditionally allocates on the heap.
 //
+// Lookups search linearly, unless a Hash is given, in which case maps of more than 16 mappings also
+// keep an open-addressing table of the positions of their mappings. HashedSmallMap<K, V, N> is an
+// alias with std::hash for maps which may grow that large. The Hash must be consistent with KeyEqual.
+//
 // Example usage:
 //
 //   ftl::SmallMap<int, std::string, 3> map;
@@ -61,11 +66,15 @@ namespace android::ftl {
 //
 //   assert(map == SmallMap(ftl::init::map(-1, "xyz"sv)(0, "nil"sv)(42, "???"sv)(123, "abc"sv)));
 //
-template <typename K, typename V, std::size_t N, typename KeyEqual = std::equal_to<K>>
+template <typename K, typename V, std::size_t N, typename KeyEqual = std::equal_to<K>,
+          typename Hash = void>
 class SmallMap final {
   using Map = SmallVector<std::pair<const K, V>, N>;
+  using Index = details::SmallMapIndex<Hash>;
+
+  static constexpr bool kHashed = !std::is_void_v<Hash>;
 
-  template <typename, typename, std::size_t, typename>
+  template <typename, typename, std::size_t, typename, typename>
   friend class SmallMap;
 
  public:
@@ -101,11 +110,14 @@ class SmallMap final {
   SmallMap(InitializerList<U, std::index_sequence<Sizes...>, Types...>&& list)
       : map_(std::move(list)) {
     deduplicate();
+    rebuild_index();
   }
 
   // Copies or moves key-value pairs from a convertible map.
-  template <typename Q, typename W, std::size_t M, typename E>
-  SmallMap(SmallMap<Q, W, M, E> other) : map_(std::move(other.map_)) {}
+  template <typename Q, typename W, std::size_t M, typename E, typename H>
+  SmallMap(SmallMap<Q, W, M, E, H> other) : map_(std::move(other.map_)) {
+    rebuild_index();
+  }
 
   static constexpr size_type static_capacity() { return N; }
 
@@ -146,26 +158,31 @@ class SmallMap final {
   //   assert(d == 'D');
   //
   auto get(const key_type& key) const -> Optional<std::reference_wrapper<const mapped_type>> {
-    for (const auto& [k, v] : *this) {
-      if (KeyEqual{}(k, key)) {
-        return std::cref(v);
-      }
+    if (const auto it = find(key); it != end()) {
+      return std::cref(it->second);
     }
     return {};
   }
 
   auto get(const key_type& key) -> Optional<std::reference_wrapper<mapped_type>> {
-    for (auto& [k, v] : *this) {
-      if (KeyEqual{}(k, key)) {
-        return std::ref(v);
-      }
+    if (const auto it = find(key); it != end()) {
+      return std::ref(it->second);
     }
     return {};
   }
 
   // Returns an iterator to an existing mapping for the given key, or the end() iterator otherwise.
   const_iterator find(const key_type& key) const { return const_cast<SmallMap&>(*this).find(key); }
-  iterator find(const key_type& key) { return find(key, begin()); }
+
+  iterator find(const key_type& key) {
+    if constexpr (kHashed) {
+      if (index_.active()) {
+        const std::size_t position = index_.find(map_, key, KeyEqual{});
+        return position == Index::kNotFound ? end() : begin() + position;
+      }
+    }
+    return find(key, begin());
+  }
 
   // Inserts a mapping unless it exists. Returns an iterator to the inserted or existing mapping,
   // and whether the mapping was inserted.
@@ -183,6 +200,10 @@ class SmallMap final {
         map_.emplace_back(std::piecewise_construct, std::forward_as_tuple(key),
                           std::forward_as_tuple(std::forward<Args>(args)...));
 
+    if constexpr (kHashed) {
+      index_.push_back(map_);
+    }
+
     if constexpr (static_capacity() > 0) {
       return {&ref_or_it, true};
     } else {
@@ -232,13 +253,23 @@ class SmallMap final {
   //
   // The last() and end() iterators, as well as those to the erased mapping, are invalidated.
   //
-  bool erase(const key_type& key) { return erase(key, begin()); }
+  bool erase(const key_type& key) {
+    const auto it = find(key);
+    if (it == end()) return false;
+    unstable_erase(it);
+    return true;
+  }
 
   // Removes all mappings.
   //
   // All iterators are invalidated.
   //
-  void clear() { map_.clear(); }
+  void clear() {
+    map_.clear();
+    if constexpr (kHashed) {
+      index_.clear();
+    }
+  }
 
  private:
   iterator find(const key_type& key, iterator first) {
@@ -249,10 +280,23 @@ class SmallMap final {
   bool erase(const key_type& key, iterator first) {
     const auto it = find(key, first);
     if (it == end()) return false;
-    map_.unstable_erase(it);
+    unstable_erase(it);
     return true;
   }
 
+  void unstable_erase(iterator it) {
+    if constexpr (kHashed) {
+      index_.unstable_erase(map_, static_cast<std::size_t>(it - begin()));
+    }
+    map_.unstable_erase(it);
+  }
+
+  void rebuild_index() {
+    if constexpr (kHashed) {
+      index_.rebuild(map_);
+    }
+  }
+
   void deduplicate() {
     for (auto it = begin(); it != end();) {
       if (const auto key = it->first; ++it != end()) {
@@ -262,6 +306,7 @@ class SmallMap final {
   }
 
   Map map_;
+  [[no_unique_address]] Index index_;
 };
 
 // Deduction guide for in-place constructor.
@@ -269,9 +314,15 @@ template <typename K, typename V, typename E, std::size_t... Sizes, typename...
 SmallMap(InitializerList<KeyValue<K, V, E>, std::index_sequence<Sizes...>, Types...>&&)
     -> SmallMap<K, V, sizeof...(Sizes), E>;
 
+// SmallMap which hashes its keys once it holds more than 16 mappings.
+template <typename K, typename V, std::size_t N, typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K>>
+using HashedSmallMap = SmallMap<K, V, N, KeyEqual, Hash>;
+
 // Returns whether the key-value pairs of two maps are equal.
-template <typename K, typename V, std::size_t N, typename Q, typename W, std::size_t M, typename E>
-bool operator==(const SmallMap<K, V, N, E>& lhs, const SmallMap<Q, W, M, E>& rhs) {
+template <typename K, typename V, std::size_t N, typename Q, typename W, std::size_t M, typename E,
+          typename H, typename I>
+bool operator==(const SmallMap<K, V, N, E, H>& lhs, const SmallMap<Q, W, M, E, I>& rhs) {
   if (lhs.size() != rhs.size()) return false;
 
   for (const auto& [k, v] : lhs) {
@@ -285,8 +336,9 @@ bool operator==(const SmallMap<K, V, N, E>& lhs, const SmallMap<Q, W, M, E>& rhs
 }
 
 // TODO: Remove in C++20.
-template <typename K, typename V, std::size_t N, typename Q, typename W, std::size_t M, typename E>
-inline bool operator!=(const SmallMap<K, V, N, E>& lhs, const SmallMap<Q, W, M, E>& rhs) {
+template <typename K, typename V, std::size_t N, typename Q, typename W, std::size_t M, typename E,
+          typename H, typename I>
+inline bool operator!=(const SmallMap<K, V, N, E, H>& lhs, const SmallMap<Q, W, M, E, I>& rhs) {
   return !(lhs == rhs);
 }
 
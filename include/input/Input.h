@@ -876,6 +876,10 @@ public:
             nsecs_t eventTime,
             const PointerCoords* pointerCoords);
 
+    // Reserves the storage of the given number of samples, including the current one, so that
+    // adding the samples of a batch does not reallocate it for each of them.
+    void reserveSamples(size_t sampleCount);
+
     void offsetLocation(float xOffset, float yOffset);
 
     void scale(float globalScaleFactor);
@@ -28,6 +28,8 @@
  * The InputConsumer is used by the application to receive events from the input dispatcher.
  */
 
+#include <algorithm>
+#include <deque>
 #include <string>
 #include <unordered_map>
 
@@ -71,10 +73,17 @@ struct InputMessage {
         DRAG,
         TIMELINE,
         TOUCH_MODE,
+        MOTION_BATCH,
+        VERSION,
 
-        ftl_last = TOUCH_MODE
+        ftl_last = VERSION
     };
 
+    // The versions of the messages which the consumer of a channel handles, which it sends to the
+    // publisher in a VERSION message. A consumer which sent none only handles version 0.
+    static constexpr uint32_t VERSION_MOTION_BATCH = 1; // MOTION_BATCH messages
+    static constexpr uint32_t CURRENT_VERSION = VERSION_MOTION_BATCH;
+
     struct Header {
         Type type; // 4 bytes
         uint32_t seq;
@@ -166,6 +175,75 @@ struct InputMessage {
             }
         } motion;
 
+        /**
+         * Consecutive samples of a motion event, which only differ by the fields of the samples,
+         * so that they reach the consumer in one message. The pointer properties are only sent
+         * once, and the coords of the samples follow each other, pointerCount coords per sample.
+         */
+        struct MotionBatch {
+            static constexpr size_t MAX_SAMPLES = 8;
+            // As many as fit in the space of the pointers of a motion message.
+            static constexpr size_t MAX_COORDS = 13;
+
+            uint32_t sampleCount;
+            uint32_t pointerCount;
+            int32_t deviceId;
+            int32_t source;
+            int32_t displayId;
+            int32_t action;
+            int32_t actionButton;
+            int32_t flags;
+            int32_t metaState;
+            int32_t buttonState;
+            MotionClassification classification; // base type: uint8_t
+            uint8_t empty1[3];                   // 3 bytes to fill gap created by classification
+            int32_t edgeFlags;
+            nsecs_t downTime __attribute__((aligned(8)));
+            float dsdx; // Begin window transform
+            float dtdx; //
+            float dtdy; //
+            float dsdy; //
+            float tx;   //
+            float ty;   // End window transform
+            float xPrecision;
+            float yPrecision;
+            float xCursorPosition;
+            float yCursorPosition;
+            float dsdxRaw; // Begin raw transform
+            float dtdxRaw; //
+            float dtdyRaw; //
+            float dsdyRaw; //
+            float txRaw;   //
+            float tyRaw;   // End raw transform
+            PointerProperties pointerProperties[MAX_POINTERS];
+            struct Sample {
+                uint32_t seq;
+                int32_t eventId;
+                nsecs_t eventTime __attribute__((aligned(8)));
+                std::array<uint8_t, 32> hmac;
+            } samples[MAX_SAMPLES] __attribute__((aligned(8)));
+            /**
+             * As the pointers of a motion message, only the coords of the samples are sent, so
+             * "coords" must be the last field of the struct.
+             */
+            PointerCoords coords[MAX_COORDS] __attribute__((aligned(8)));
+
+            inline size_t size() const {
+                // Bounded, so that invalid counts don't wrap around to a valid size.
+                const size_t coordCount =
+                        std::min(static_cast<size_t>(sampleCount) * pointerCount, MAX_COORDS + 1);
+                return sizeof(MotionBatch) - sizeof(PointerCoords) * MAX_COORDS +
+                        sizeof(PointerCoords) * coordCount;
+            }
+        } motionBatch;
+
+        struct Version {
+            uint32_t version;
+            uint32_t empty;
+
+            inline size_t size() const { return sizeof(Version); }
+        } version;
+
         struct Finished {
             bool handled;
             uint8_t empty[7];
@@ -224,6 +302,8 @@ struct InputMessage {
     void getSanitizedCopy(InputMessage* msg) const;
 };
 
+class InputMessageRing;
+
 /*
  * An input channel consists of a local unix domain socket used to send and receive
  * input messages across processes.  Each channel has a descriptive name for debugging purposes.
@@ -231,6 +311,9 @@ struct InputMessage {
  * Each endpoint has its own InputChannel object that specifies its file descriptor.
  * For parceling, this relies on android::os::InputChannelCore, defined in aidl.
  *
+ * The messages sent by the server may instead go through a ring in shared memory, in which case
+ * the socket only carries the wakeups of the client and the messages sent by the client.
+ *
  * The input channel is closed when all references to it are released.
  */
 class InputChannel : private android::os::InputChannelCore {
@@ -243,11 +326,18 @@ public:
      * The two returned input channels are equivalent, and are labeled as "server" and "client"
      * for convenience. The two input channels share the same token.
      *
+     * With |useSharedMemory|, the messages sent by the server go through a ring in shared memory,
+     * so that the client receives them without a syscall each. The client must then receive
+     * messages until WOULD_BLOCK before it waits for the socket, as a message sent while it was
+     * receiving the last ones may not wake it up. The channels fall back to the socket if the
+     * memory cannot be allocated.
+     *
      * Return OK on success.
      */
     static status_t openInputChannelPair(const std::string& name,
                                          std::unique_ptr<InputChannel>& outServerChannel,
-                                         std::unique_ptr<InputChannel>& outClientChannel);
+                                         std::unique_ptr<InputChannel>& outClientChannel,
+                                         bool useSharedMemory = false);
 
     inline std::string getName() const { return name; }
     inline int getFd() const { return fd.get(); }
@@ -328,6 +418,19 @@ private:
                                                 android::base::unique_fd fd, sp<IBinder> token);
 
     InputChannel(const std::string name, android::base::unique_fd fd, sp<IBinder> token);
+
+    bool readsRing() const { return mRing != nullptr && !mWritesRing; }
+    bool writesRing() const { return mRing != nullptr && mWritesRing; }
+
+    bool isPeerClosed() const;
+    status_t sendDatagram(const void* data, size_t size);
+    status_t receiveSocketMessage(InputMessage* msg);
+    status_t receiveRingMessage(InputMessage* msg);
+
+    // The ring of the messages sent by the server, shared by the duplicates of the channel, whose
+    // fd is held by |ring|.
+    std::shared_ptr<InputMessageRing> mRing;
+    bool mWritesRing = false;
 };
 
 /*
@@ -376,6 +479,40 @@ public:
                                 const PointerProperties* pointerProperties,
                                 const PointerCoords* pointerCoords);
 
+    struct MotionSample {
+        uint32_t seq;
+        int32_t eventId;
+        std::array<uint8_t, 32> hmac;
+        nsecs_t eventTime;
+        // pointerCount coords.
+        const PointerCoords* pointerCoords;
+    };
+
+    /* Publishes consecutive samples of a move or hover move event, which only differ by the fields
+     * of MotionSample, in as few messages as the consumer handles. The samples are published one
+     * message each to a consumer which does not handle batches.
+     *
+     * The samples are published in order, and outPublishedCount is set to the number of samples
+     * which were published, including when an error is returned.
+     *
+     * Returns OK on success.
+     * Returns WOULD_BLOCK if the channel is full.
+     * Returns DEAD_OBJECT if the channel's peer has been closed.
+     * Returns BAD_VALUE if a seq is 0, if pointerCount is less than 1 or greater than
+     * MAX_POINTERS, or if the action is neither a move nor a hover move.
+     * Other errors probably indicate that the channel is broken.
+     */
+    status_t publishMotionSamples(int32_t deviceId, int32_t source, int32_t displayId,
+                                  int32_t action, int32_t actionButton, int32_t flags,
+                                  int32_t edgeFlags, int32_t metaState, int32_t buttonState,
+                                  MotionClassification classification,
+                                  const ui::Transform& transform, float xPrecision,
+                                  float yPrecision, float xCursorPosition, float yCursorPosition,
+                                  const ui::Transform& rawTransform, nsecs_t downTime,
+                                  uint32_t pointerCount, const PointerProperties* pointerProperties,
+                                  const std::vector<MotionSample>& samples,
+                                  size_t* outPublishedCount);
+
     /* Publishes a focus event to the input channel.
      *
      * Returns OK on success.
@@ -447,8 +584,20 @@ public:
     android::base::Result<ConsumerResponse> receiveConsumerResponse();
 
 private:
+    status_t publishMotionBatch(int32_t deviceId, int32_t source, int32_t displayId,
+                                int32_t action, int32_t actionButton, int32_t flags,
+                                int32_t edgeFlags, int32_t metaState, int32_t buttonState,
+                                MotionClassification classification, const ui::Transform& transform,
+                                float xPrecision, float yPrecision, float xCursorPosition,
+                                float yCursorPosition, const ui::Transform& rawTransform,
+                                nsecs_t downTime, uint32_t pointerCount,
+                                const PointerProperties* pointerProperties,
+                                const MotionSample* samples, size_t sampleCount);
+
     std::shared_ptr<InputChannel> mChannel;
     InputVerifier mInputVerifier;
+    // The version which the consumer sent, once the publisher received it.
+    uint32_t mConsumerVersion = 0;
 };
 
 /*
@@ -543,6 +692,9 @@ private:
     // call to consume and that still needs to be handled.
     bool mMsgDeferred;
 
+    // The motion messages of the samples of a received MOTION_BATCH which were not handled yet.
+    std::deque<InputMessage> mUnbatchedMessages;
+
     // Batched motion events per device and source.
     struct Batch {
         std::vector<InputMessage> samples;
@@ -653,6 +805,9 @@ private:
     // will be raised for that connection, and no further events will be posted to that channel.
     std::unordered_map<uint32_t /*seq*/, nsecs_t /*consumeTime*/> mConsumeTimes;
 
+    // Receives the next message, with the samples of a MOTION_BATCH as separate motion messages.
+    status_t receiveMessage(InputMessage* msg);
+
     status_t consumeBatch(InputEventFactoryInterface* factory,
             nsecs_t frameTime, uint32_t* outSeq, InputEvent** outEvent);
     status_t consumeSamples(InputEventFactoryInterface* factory,
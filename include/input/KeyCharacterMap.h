@@ -25,6 +25,7 @@
 
 #include <android-base/result.h>
 #include <input/Input.h>
+#include <input/KeyMapCache.h>
 #include <utils/Errors.h>
 #include <utils/Tokenizer.h>
 #include <utils/Unicode.h>
@@ -77,6 +78,12 @@ public:
     static base::Result<std::shared_ptr<KeyCharacterMap>> load(const std::string& filename,
                                                                Format format);
 
+    /* Loads a key character map from a file, or from its entry in the cache if it is up to date.
+     */
+    static base::Result<std::shared_ptr<KeyCharacterMap>> load(const std::string& filename,
+                                                               Format format,
+                                                               const KeyMapCache& cache);
+
     /* Loads a key character map from its string contents. */
     static base::Result<std::shared_ptr<KeyCharacterMap>> loadContents(const std::string& filename,
                                                                        const char* contents,
@@ -273,6 +280,9 @@ private:
 
     /* Reloads the data from mLoadFileName and unapplies any overlay. */
     status_t reloadBaseFromFile();
+
+    void writeToCache(Format format, KeyMapCache::Writer& writer) const;
+    bool readFromCache(Format format, KeyMapCache::Reader& reader);
 };
 
 } // namespace android
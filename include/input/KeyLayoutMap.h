@@ -18,6 +18,7 @@
 
 #include <android-base/result.h>
 #include <input/InputDevice.h>
+#include <input/KeyMapCache.h>
 
 #include <stdint.h>
 #include <utils/Errors.h>
@@ -67,6 +68,10 @@ public:
                                                             const char* contents = nullptr);
     static base::Result<std::shared_ptr<KeyLayoutMap>> loadContents(const std::string& filename,
                                                                     const char* contents);
+    // Loads the key layout map of the file from its entry in the cache, if the entry is up to
+    // date, or parses the file and replaces its entry otherwise.
+    static base::Result<std::shared_ptr<KeyLayoutMap>> load(const std::string& filename,
+                                                            const KeyMapCache& cache);
 
     status_t mapKey(int32_t scanCode, int32_t usageCode,
             int32_t* outKeyCode, uint32_t* outFlags) const;
@@ -112,6 +117,9 @@ private:
 
     const Key* getKey(int32_t scanCode, int32_t usageCode) const;
 
+    void writeToCache(KeyMapCache::Writer& writer) const;
+    bool readFromCache(KeyMapCache::Reader& reader);
+
     class Parser {
         KeyLayoutMap* mMap;
         Tokenizer* mTokenizer;
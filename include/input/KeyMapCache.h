@@ -0,0 +1,113 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace android {
+
+/**
+ * A cache of the parsed key layout and key character map files, so that the maps of an input
+ * device are read from a compact binary entry instead of being tokenized and parsed again each
+ * time a device is added.
+ *
+ * Each entry is a file of the cache directory, which is mapped when it is read. An entry is only
+ * used by the build which wrote it, while the file it was parsed from has the same stamp, and the
+ * text file is parsed again otherwise, or whenever the entry does not validate. The stamp alone
+ * does not tell the files updated by an OTA apart, since the files of the system images all have
+ * the same modification time.
+ */
+class KeyMapCache {
+public:
+    enum class Kind : int32_t {
+        KEY_LAYOUT = 1,
+        KEY_CHARACTER_MAP = 2,
+    };
+
+    // Identifies the contents of the file an entry was parsed from.
+    struct Stamp {
+        int64_t modificationTime;
+        int64_t size;
+        int64_t inode;
+        int64_t device;
+
+        bool operator==(const Stamp&) const = default;
+    };
+
+    // Serializes a map into the payload of an entry.
+    class Writer {
+    public:
+        void writeInt32(int32_t value);
+        void writeString(const std::string& value);
+
+    private:
+        friend class KeyMapCache;
+        std::vector<int32_t> mWords;
+    };
+
+    // Deserializes a map from the payload of an entry. As a Parcel, it reports the reads past the
+    // end of the payload through hasError, after which it only returns zeroes.
+    class Reader {
+    public:
+        explicit Reader(std::span<const int32_t> words);
+
+        int32_t readInt32();
+        std::string readString();
+        // Reads the number of elements which follow, each made of at least wordsPerElement words.
+        size_t readCount(size_t wordsPerElement);
+        bool hasError() const { return mError; }
+        bool isAtEnd() const { return mPosition == mWords.size(); }
+
+    private:
+        std::span<const int32_t> mWords;
+        size_t mPosition = 0;
+        bool mError = false;
+    };
+
+    // Returns the cache of the input configuration files of the device, or nullptr if it is
+    // disabled. The directory is set by the "ro.input.keymap_cache_dir" property, and the build
+    // is identified by "ro.build.fingerprint".
+    static const KeyMapCache* getDefault();
+
+    // Returns the stamp of the file, or nothing if it cannot be read.
+    static std::optional<Stamp> getStamp(const std::string& path);
+
+    KeyMapCache(std::string directory, std::string buildFingerprint);
+
+    // Reads the entry of the file with the given stamp. Returns whether the entry was valid and
+    // the read function returned true.
+    bool read(Kind kind, const std::string& path, const Stamp& stamp,
+              const std::function<bool(Reader&)>& readMap) const;
+
+    // Replaces the entry of the file, parsed while it had the given stamp.
+    void write(Kind kind, const std::string& path, const Stamp& stamp,
+               const Writer& writer) const;
+
+private:
+    std::string getEntryPath(Kind kind, const std::string& path) const;
+
+    const std::string mDirectory;
+    const std::string mBuildFingerprint;
+};
+
+} // namespace android
@@ -28,6 +28,7 @@
 #include <utils/Timers.h>
 
 #include <tensorflow/lite/core/api/error_reporter.h>
+#include <tensorflow/lite/core/c/common.h>
 #include <tensorflow/lite/interpreter.h>
 #include <tensorflow/lite/model.h>
 #include <tensorflow/lite/signature_runner.h>
@@ -105,6 +106,9 @@ public:
         // The noise floor for predictions.
         // Distances (r) less than this should be discarded as noise.
         float distanceNoiseFloor = 0;
+        // The number of threads of the XNNPACK delegate the model runs on, or 0 to run the model
+        // on the builtin kernels.
+        int32_t xnnpackThreads = 0;
     };
 
     // Creates a model from an encoded Flatbuffer model.
@@ -141,10 +145,15 @@ private:
     explicit TfLiteMotionPredictorModel(std::unique_ptr<android::base::MappedFile> model,
                                         Config config);
 
+    void applyDelegate();
     void allocateTensors();
     void attachInputTensors();
     void attachOutputTensors();
 
+    // Invokes the model once on empty inputs, so that the first prediction does not pay for the
+    // lazy initialization of the interpreter and for faulting in the pages of the model.
+    void warmUp();
+
     TfLiteTensor* mInputR = nullptr;
     TfLiteTensor* mInputPhi = nullptr;
     TfLiteTensor* mInputPressure = nullptr;
@@ -158,6 +167,8 @@ private:
     std::unique_ptr<android::base::MappedFile> mFlatBuffer;
     std::unique_ptr<tflite::ErrorReporter> mErrorReporter;
     std::unique_ptr<tflite::FlatBufferModel> mModel;
+    // The delegate must outlive the interpreter it is applied to.
+    std::unique_ptr<TfLiteDelegate, void (*)(TfLiteDelegate*)> mDelegate{nullptr, nullptr};
     std::unique_ptr<tflite::Interpreter> mInterpreter;
     tflite::SignatureRunner* mRunner = nullptr;
 
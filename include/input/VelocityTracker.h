@@ -233,6 +233,43 @@ private:
     const Weighting mWeighting;
 };
 
+/*
+ * Velocity tracker algorithm equivalent to the unweighted quadratic least-squares fit of
+ * `LeastSquaresVelocityTrackerStrategy`, which keeps the sums the fit is solved from up to date
+ * as movements are added and expire, so that getting the velocity does not iterate over them.
+ */
+class IncrementalLeastSquaresVelocityTrackerStrategy : public AccumulatingVelocityTrackerStrategy {
+public:
+    IncrementalLeastSquaresVelocityTrackerStrategy();
+    ~IncrementalLeastSquaresVelocityTrackerStrategy() override;
+
+    void addMovement(nsecs_t eventTime, int32_t pointerId, float position) override;
+    void clearPointer(int32_t pointerId) override;
+    std::optional<float> getVelocity(int32_t pointerId) const override;
+
+private:
+    // Sample horizon, as for `LeastSquaresVelocityTrackerStrategy`.
+    static constexpr nsecs_t HORIZON = 100 * 1000000; // 100 ms
+
+    // The sums are recomputed from the movements once the latest movement is this long after
+    // their origin, so that the powers of the times stay small and the rounding errors of the
+    // expired movements do not accumulate.
+    static constexpr nsecs_t REBASE_INTERVAL = 2 * HORIZON;
+
+    // The sums of the powers of the times of the movements, in seconds since the origin, and of
+    // their products with the positions.
+    struct MomentSums {
+        nsecs_t originTime = 0;
+        double count = 0;
+        double t = 0, t2 = 0, t3 = 0, t4 = 0;
+        double y = 0, ty = 0, t2y = 0;
+
+        void add(const Movement& movement, double weight);
+    };
+
+    std::map<int32_t /*pointerId*/, MomentSums> mSums;
+};
+
 /*
  * Velocity tracker algorithm that uses an IIR filter.
  */
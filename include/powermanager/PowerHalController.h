@@ -24,6 +24,13 @@
 #include <android-base/thread_annotations.h>
 #include <powermanager/PowerHalWrapper.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
 namespace android {
 
 namespace power {
@@ -42,6 +49,22 @@ public:
 
 // -------------------------------------------------------------------------------------------------
 
+// Latencies of the boosts and modes sent to the Power HAL by the worker of a
+// PowerHalController with async dispatch.
+struct HalDispatchStats {
+    // Requests sent to the HAL, and requests dropped as identical to a recent one.
+    int64_t dispatchedCount = 0;
+    int64_t coalescedCount = 0;
+    // Time between the api call and the HAL call.
+    std::chrono::nanoseconds totalQueueDelay{0};
+    std::chrono::nanoseconds maxQueueDelay{0};
+    // Time spent in the HAL calls.
+    std::chrono::nanoseconds totalHalDuration{0};
+    std::chrono::nanoseconds maxHalDuration{0};
+};
+
+// -------------------------------------------------------------------------------------------------
+
 // Controller for Power HAL handle.
 // This relies on HalConnector to connect to the underlying Power HAL
 // service and reconnects to it after each failed api call. This also ensures
@@ -51,10 +74,18 @@ public:
     PowerHalController() : PowerHalController(std::make_unique<HalConnector>()) {}
     explicit PowerHalController(std::unique_ptr<HalConnector> connector)
           : mHalConnector(std::move(connector)) {}
-    virtual ~PowerHalController() = default;
+    virtual ~PowerHalController();
 
     virtual void init();
 
+    // Sends setBoost and setMode to the HAL from a dedicated worker thread, so the
+    // callers return without waiting for the HAL. The calls then return ok, and
+    // failures are only logged. A boost identical to one which is still queued, or
+    // which was sent less than coalesceWindow ago, is dropped. A mode which is
+    // still queued is updated in place.
+    void enableAsyncDispatch(std::chrono::nanoseconds coalesceWindow);
+    HalDispatchStats getDispatchStats();
+
     virtual HalResult<void> setBoost(aidl::android::hardware::power::Boost boost,
                                      int32_t durationMs) override;
     virtual HalResult<void> setMode(aidl::android::hardware::power::Mode mode,
@@ -81,9 +112,33 @@ private:
     std::shared_ptr<HalWrapper> mConnectedHal GUARDED_BY(mConnectedHalMutex) = nullptr;
     const std::shared_ptr<HalWrapper> mDefaultHal = std::make_shared<EmptyHalWrapper>();
 
+    struct DispatchRequest {
+        bool isBoost;
+        int32_t value;
+        // The duration of a boost, or whether a mode is enabled.
+        int32_t arg;
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+
+    std::mutex mDispatchMutex;
+    std::condition_variable mDispatchCondition;
+    std::thread mDispatchThread;
+    bool mAsyncDispatch GUARDED_BY(mDispatchMutex) = false;
+    bool mDispatchStopping GUARDED_BY(mDispatchMutex) = false;
+    std::chrono::nanoseconds mCoalesceWindow GUARDED_BY(mDispatchMutex){0};
+    std::deque<DispatchRequest> mDispatchQueue GUARDED_BY(mDispatchMutex);
+    // When each boost and duration was last sent to the HAL.
+    std::map<std::pair<int32_t, int32_t>, std::chrono::steady_clock::time_point> mLastBoostTimes
+            GUARDED_BY(mDispatchMutex);
+    HalDispatchStats mDispatchStats GUARDED_BY(mDispatchMutex);
+
     std::shared_ptr<HalWrapper> initHal();
     template <typename T>
     HalResult<T> processHalResult(HalResult<T>&& result, const char* functionName);
+    HalResult<void> sendToHal(const DispatchRequest& request);
+    // Queues the request if async dispatch is enabled, and returns whether it did.
+    bool queueRequest(DispatchRequest request);
+    void runDispatchThread();
 };
 
 // -------------------------------------------------------------------------------------------------
@@ -27,6 +27,7 @@
 #include <binder/Parcel.h>
 #include <binder/RecordedTransaction.h>
 #include <binder/RpcServer.h>
+#include <binder/TransactionStats.h>
 #include <binder/unique_fd.h>
 #include <pthread.h>
 
@@ -365,6 +366,10 @@ status_t BBinder::transact(
         reply->markSensitive();
     }
 
+    using android::binder::debug::TransactionStats;
+    const bool sampleStats = TransactionStats::shouldSample();
+    const uint64_t startNs = sampleStats ? TransactionStats::nowNs() : 0;
+
     status_t err = NO_ERROR;
     switch (code) {
         case PING_TRANSACTION:
@@ -393,6 +398,14 @@ status_t BBinder::transact(
             break;
     }
 
+    if (sampleStats) [[unlikely]] {
+        const String16& descriptor = getInterfaceDescriptor();
+        TransactionStats::record(TransactionStats::Direction::INCOMING,
+                                 std::u16string_view(descriptor.c_str(), descriptor.size()), code,
+                                 TransactionStats::nowNs() - startNs, data.dataSize(),
+                                 reply == nullptr ? 0 : reply->dataSize());
+    }
+
     // In case this is being transacted on in the same process.
     if (reply != nullptr) {
         reply->setDataPosition(0);
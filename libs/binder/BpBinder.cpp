@@ -23,6 +23,7 @@
 #include <binder/IResultReceiver.h>
 #include <binder/RpcSession.h>
 #include <binder/Stability.h>
+#include <binder/TransactionStats.h>
 
 #include <stdio.h>
 
@@ -372,6 +373,10 @@ status_t BpBinder::transact(
             }
         }
 
+        using android::binder::debug::TransactionStats;
+        const bool sampleStats = TransactionStats::shouldSample();
+        const uint64_t startNs = sampleStats ? TransactionStats::nowNs() : 0;
+
         status_t status;
         if (isRpcBinder()) [[unlikely]] {
             status = rpcSession()->transact(sp<IBinder>::fromExisting(this), code, data, reply,
@@ -384,6 +389,12 @@ status_t BpBinder::transact(
 
             status = IPCThreadState::self()->transact(binderHandle(), code, data, reply, flags);
         }
+        if (sampleStats) [[unlikely]] {
+            TransactionStats::record(TransactionStats::Direction::OUTGOING,
+                                     TransactionStats::peekDescriptor(data), code,
+                                     TransactionStats::nowNs() - startNs, data.dataSize(),
+                                     reply == nullptr ? 0 : reply->dataSize());
+        }
         if (data.dataSize() > LOG_TRANSACTIONS_OVER_SIZE) {
             RpcMutexUniqueLock _l(mLock);
             ALOGW("Large outgoing transaction of %zu bytes, interface descriptor %s, code %d",
@@ -733,6 +733,11 @@ void IPCThreadState::joinThreadPool(bool isMain)
     pthread_mutex_unlock(&mProcess->mThreadCountLock);
     mOut.writeInt32(isMain ? BC_ENTER_LOOPER : BC_REGISTER_LOOPER);
 
+    if (mProcess->mCpuPolicy != nullptr) {
+        mIsReservedForHighPriority = mProcess->cpuPolicyJoin();
+        mIsOnHighPriorityCpus = mIsReservedForHighPriority;
+    }
+
     mIsLooper = true;
     status_t result;
     do {
@@ -757,6 +762,11 @@ void IPCThreadState::joinThreadPool(bool isMain)
 
     mOut.writeInt32(BC_EXIT_LOOPER);
     mIsLooper = false;
+    if (mIsReservedForHighPriority) {
+        mProcess->cpuPolicyLeave();
+        mIsReservedForHighPriority = false;
+        mIsOnHighPriorityCpus = false;
+    }
     talkWithDriver(false);
     pthread_mutex_lock(&mProcess->mThreadCountLock);
     LOG_ALWAYS_FATAL_IF(mProcess->mCurrentThreads == 0,
@@ -959,6 +969,8 @@ IPCThreadState::IPCThreadState()
         mWorkSource(kUnsetWorkSource),
         mPropagateWorkSource(false),
         mIsLooper(false),
+        mIsReservedForHighPriority(false),
+        mIsOnHighPriorityCpus(false),
         mIsFlushing(false),
         mStrictModePolicy(0),
         mLastTransactionBinderFlags(0),
@@ -1384,6 +1396,13 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
             // ALOGI(">>>> TRANSACT from pid %d sid %s uid %d\n", mCallingPid,
             //    (mCallingSid ? mCallingSid : "<N/A>"), mCallingUid);
 
+            // The kernel already applied the priority of the caller to this thread.
+            bool movedCpus = false;
+            if (mProcess->mCpuPolicy != nullptr) {
+                movedCpus = mProcess->cpuPolicyBeginTransaction(mIsOnHighPriorityCpus);
+                if (movedCpus) mIsOnHighPriorityCpus = true;
+            }
+
             Parcel reply;
             status_t error;
             IF_LOG_TRANSACTIONS() {
@@ -1450,6 +1469,11 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
                 LOG_ONEWAY("NOT sending reply to %d!", mCallingPid);
             }
 
+            if (movedCpus) {
+                mProcess->cpuPolicyEndTransaction();
+                mIsOnHighPriorityCpus = false;
+            }
+
             mServingStackPointer = origServingStackPointer;
             mCallingPid = origPid;
             mCallingSid = origSid;
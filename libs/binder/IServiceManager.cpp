@@ -45,6 +45,7 @@
 #include <vndksupport/linker.h>
 #endif
 
+#include "ServiceCache.h"
 #include "Static.h"
 
 namespace android {
@@ -118,6 +119,7 @@ public:
 
 protected:
     sp<AidlServiceManager> mTheRealServiceManager;
+    const sp<ServiceCache> mServiceCache;
     // AidlRegistrationCallback -> services that its been registered for
     // notifications.
     using LocalRegistrationAndWaiter =
@@ -290,7 +292,8 @@ void* openDeclaredPassthroughHal(const String16& interface, const String16& inst
 // ----------------------------------------------------------------------
 
 ServiceManagerShim::ServiceManagerShim(const sp<AidlServiceManager>& impl)
- : mTheRealServiceManager(impl)
+ : mTheRealServiceManager(impl),
+   mServiceCache(sp<ServiceCache>::make(impl, ServiceCache::getConfiguredNames()))
 {}
 
 // This implementation could be simplified and made more efficient by delegating
@@ -341,18 +344,23 @@ sp<IBinder> ServiceManagerShim::getService(const String16& name) const
     return nullptr;
 }
 
-sp<IBinder> ServiceManagerShim::checkService(const String16& name) const
+sp<IBinder> ServiceManagerShim::checkService(const String16& name16) const
 {
+    const std::string name = String8(name16).c_str();
+    if (sp<IBinder> cached = mServiceCache->lookup(name)) return cached;
+
     sp<IBinder> ret;
-    if (!mTheRealServiceManager->checkService(String8(name).c_str(), &ret).isOk()) {
+    if (!mTheRealServiceManager->checkService(name, &ret).isOk()) {
         return nullptr;
     }
+    mServiceCache->maybeAdd(name, ret);
     return ret;
 }
 
 status_t ServiceManagerShim::addService(const String16& name, const sp<IBinder>& service,
                                         bool allowIsolated, int dumpsysPriority)
 {
+    mServiceCache->remove(String8(name).c_str());
     Status status = mTheRealServiceManager->addService(
         String8(name).c_str(), service, allowIsolated, dumpsysPriority);
     return status.exceptionCode();
@@ -402,6 +410,7 @@ sp<IBinder> ServiceManagerShim::waitForService(const String16& name16)
     };
 
     const std::string name = String8(name16).c_str();
+    if (sp<IBinder> cached = mServiceCache->lookup(name)) return cached;
 
     sp<IBinder> out;
     if (Status status = realGetService(name, &out); !status.isOk()) {
@@ -416,7 +425,10 @@ sp<IBinder> ServiceManagerShim::waitForService(const String16& name16)
         }
         return nullptr;
     }
-    if (out != nullptr) return out;
+    if (out != nullptr) {
+        mServiceCache->maybeAdd(name, out);
+        return out;
+    }
 
     sp<Waiter> waiter = sp<Waiter>::make();
     if (Status status = mTheRealServiceManager->registerForNotifications(name, waiter);
@@ -24,6 +24,9 @@
 #include <utils/SortedVector.h>
 #include <utils/String8.h>
 
+#include <algorithm>
+#include <unordered_map>
+
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -119,18 +122,28 @@ private:
 
 // ----------------------------------------------------------------------------
 
-class SimpleBestFitAllocator
+/*
+ * A segregated-fit allocator: free chunks are kept in lists by size class,
+ * with two levels of classes as in TLSF, and bitmaps of the non-empty lists.
+ * Together with the list of all chunks in address order (for merging) and a
+ * table of allocated chunks, allocate and deallocate take constant time.
+ */
+
+class SegregatedFitAllocator
 {
     enum {
         PAGE_ALIGNED = 0x00000001
     };
 public:
-    explicit SimpleBestFitAllocator(size_t size);
-    ~SimpleBestFitAllocator();
+    // base is where the heap is mapped, or nullptr if it isn't
+    SegregatedFitAllocator(size_t size, void* base);
+    ~SegregatedFitAllocator();
 
     size_t      allocate(size_t size, uint32_t flags = 0);
     status_t    deallocate(size_t offset);
     size_t      size() const;
+    MemoryDealer::Stats getStats() const;
+    void        setReleaseFreePages(bool release);
     void        dump(const char* what) const;
     void        dump(String8& res, const char* what) const;
 
@@ -140,24 +153,49 @@ private:
 
     struct chunk_t {
         chunk_t(size_t start, size_t size)
-        : start(start), size(size), free(1), prev(nullptr), next(nullptr) {
+        : start(start), size(size), free(1), prev(nullptr), next(nullptr),
+          freePrev(nullptr), freeNext(nullptr) {
         }
         size_t              start;
-        size_t              size : 28;
-        int                 free : 4;
+        size_t              size;
+        int                 free;
+        // neighbours by address
         mutable chunk_t*    prev;
         mutable chunk_t*    next;
+        // neighbours in the free list of its size class
+        chunk_t*            freePrev;
+        chunk_t*            freeNext;
     };
 
+    // sizes below kSecondLevelCount units each have a class, and above that
+    // every power of two is split in kSecondLevelCount classes
+    static constexpr size_t kSecondLevelBits = 4;
+    static constexpr size_t kSecondLevelCount = 1 << kSecondLevelBits;
+    static constexpr size_t kFirstLevelCount = 64;
+
+    static void mapping(size_t size, size_t* fl, size_t* sl);
+    void     insertFree(chunk_t* chunk);
+    void     removeFree(chunk_t* chunk);
+    chunk_t* findFree(size_t size);
     ssize_t  alloc(size_t size, uint32_t flags);
     chunk_t* dealloc(size_t start);
+    void     releasePage(size_t offset, const chunk_t* freed) const;
     void     dump_l(const char* what) const;
     void     dump_l(String8& res, const char* what) const;
 
     static const int    kMemoryAlign;
     mutable std::mutex mLock;
     LinkedList<chunk_t> mList;
+    // allocated chunks by start
+    std::unordered_map<size_t, chunk_t*> mAllocated;
+    uint64_t            mFirstLevelBitmap;
+    uint32_t            mSecondLevelBitmap[kFirstLevelCount];
+    chunk_t*            mFreeLists[kFirstLevelCount][kSecondLevelCount];
+    size_t              mFreeChunks;
+    size_t              mAllocatedSize;
     size_t              mHeapSize;
+    uint8_t*            mBase;
+    bool                mReleaseFreePages;
 };
 
 // ----------------------------------------------------------------------------
@@ -227,8 +265,10 @@ Allocation::~Allocation()
 // ----------------------------------------------------------------------------
 
 MemoryDealer::MemoryDealer(size_t size, const char* name, uint32_t flags)
-      : mHeap(sp<MemoryHeapBase>::make(size, flags, name)),
-        mAllocator(new SimpleBestFitAllocator(size)) {}
+      : mHeap(sp<MemoryHeapBase>::make(size, flags, name)) {
+    void* base = mHeap->getBase();
+    mAllocator = new SegregatedFitAllocator(size, base == MAP_FAILED ? nullptr : base);
+}
 
 MemoryDealer::~MemoryDealer()
 {
@@ -255,35 +295,50 @@ void MemoryDealer::dump(const char* what) const
     allocator()->dump(what);
 }
 
+MemoryDealer::Stats MemoryDealer::getStats() const
+{
+    return allocator()->getStats();
+}
+
+void MemoryDealer::setReleaseFreePages(bool release)
+{
+    allocator()->setReleaseFreePages(release);
+}
+
 const sp<IMemoryHeap>& MemoryDealer::heap() const {
     return mHeap;
 }
 
-SimpleBestFitAllocator* MemoryDealer::allocator() const {
+SegregatedFitAllocator* MemoryDealer::allocator() const {
     return mAllocator;
 }
 
 // static
 size_t MemoryDealer::getAllocationAlignment()
 {
-    return SimpleBestFitAllocator::getAllocationAlignment();
+    return SegregatedFitAllocator::getAllocationAlignment();
 }
 
 // ----------------------------------------------------------------------------
 
 // align all the memory blocks on a cache-line boundary
-const int SimpleBestFitAllocator::kMemoryAlign = 32;
+const int SegregatedFitAllocator::kMemoryAlign = 32;
 
-SimpleBestFitAllocator::SimpleBestFitAllocator(size_t size)
+SegregatedFitAllocator::SegregatedFitAllocator(size_t size, void* base)
+    : mFirstLevelBitmap(0), mSecondLevelBitmap(), mFreeLists(), mFreeChunks(0),
+      mAllocatedSize(0), mBase(static_cast<uint8_t*>(base)), mReleaseFreePages(false)
 {
     size_t pagesize = getpagesize();
     mHeapSize = ((size + pagesize-1) & ~(pagesize-1));
 
-    chunk_t* node = new chunk_t(0, mHeapSize / kMemoryAlign);
-    mList.insertHead(node);
+    if (mHeapSize) {
+        chunk_t* node = new chunk_t(0, mHeapSize / kMemoryAlign);
+        mList.insertHead(node);
+        insertFree(node);
+    }
 }
 
-SimpleBestFitAllocator::~SimpleBestFitAllocator()
+SegregatedFitAllocator::~SegregatedFitAllocator()
 {
     while(!mList.isEmpty()) {
         chunk_t* removed = mList.remove(mList.head());
@@ -298,19 +353,19 @@ SimpleBestFitAllocator::~SimpleBestFitAllocator()
     }
 }
 
-size_t SimpleBestFitAllocator::size() const
+size_t SegregatedFitAllocator::size() const
 {
     return mHeapSize;
 }
 
-size_t SimpleBestFitAllocator::allocate(size_t size, uint32_t flags)
+size_t SegregatedFitAllocator::allocate(size_t size, uint32_t flags)
 {
     std::unique_lock<std::mutex> _l(mLock);
     ssize_t offset = alloc(size, flags);
     return offset;
 }
 
-status_t SimpleBestFitAllocator::deallocate(size_t offset)
+status_t SegregatedFitAllocator::deallocate(size_t offset)
 {
     std::unique_lock<std::mutex> _l(mLock);
     chunk_t const * const freed = dealloc(offset);
@@ -320,138 +375,246 @@ status_t SimpleBestFitAllocator::deallocate(size_t offset)
     return NAME_NOT_FOUND;
 }
 
-ssize_t SimpleBestFitAllocator::alloc(size_t size, uint32_t flags)
+MemoryDealer::Stats SegregatedFitAllocator::getStats() const
 {
-    if (size == 0) {
-        return 0;
+    std::unique_lock<std::mutex> _l(mLock);
+    MemoryDealer::Stats stats;
+    stats.heapSize = mHeapSize;
+    stats.allocatedSize = mAllocatedSize * kMemoryAlign;
+    stats.freeSize = mHeapSize - stats.allocatedSize;
+    stats.allocations = mAllocated.size();
+    stats.freeChunks = mFreeChunks;
+    if (mFirstLevelBitmap) {
+        // the largest chunk is in the highest non-empty class
+        const size_t fl = 63 - __builtin_clzll(mFirstLevelBitmap);
+        const size_t sl = 31 - __builtin_clz(mSecondLevelBitmap[fl]);
+        for (const chunk_t* cur = mFreeLists[fl][sl]; cur; cur = cur->freeNext) {
+            stats.largestFreeChunk = std::max(stats.largestFreeChunk, cur->size * kMemoryAlign);
+        }
     }
-    size = (size + kMemoryAlign-1) / kMemoryAlign;
-    chunk_t* free_chunk = nullptr;
-    chunk_t* cur = mList.head();
+    return stats;
+}
 
-    size_t pagesize = getpagesize();
-    while (cur) {
-        int extra = 0;
-        if (flags & PAGE_ALIGNED)
-            extra = ( -cur->start & ((pagesize/kMemoryAlign)-1) ) ;
-
-        // best fit
-        if (cur->free && (cur->size >= (size+extra))) {
-            if ((!free_chunk) || (cur->size < free_chunk->size)) {
-                free_chunk = cur;
+void SegregatedFitAllocator::setReleaseFreePages(bool release)
+{
+    std::unique_lock<std::mutex> _l(mLock);
+    mReleaseFreePages = release;
+}
+
+void SegregatedFitAllocator::mapping(size_t size, size_t* fl, size_t* sl)
+{
+    if (size < kSecondLevelCount) {
+        *fl = 0;
+        *sl = size;
+    } else {
+        const size_t msb = 63 - __builtin_clzll(size);
+        *fl = msb - kSecondLevelBits + 1;
+        *sl = (size >> (msb - kSecondLevelBits)) - kSecondLevelCount;
+    }
+}
+
+void SegregatedFitAllocator::insertFree(chunk_t* chunk)
+{
+    size_t fl, sl;
+    mapping(chunk->size, &fl, &sl);
+    chunk->freePrev = nullptr;
+    chunk->freeNext = mFreeLists[fl][sl];
+    if (chunk->freeNext) chunk->freeNext->freePrev = chunk;
+    mFreeLists[fl][sl] = chunk;
+    mFirstLevelBitmap |= uint64_t(1) << fl;
+    mSecondLevelBitmap[fl] |= uint32_t(1) << sl;
+    mFreeChunks++;
+}
+
+void SegregatedFitAllocator::removeFree(chunk_t* chunk)
+{
+    size_t fl, sl;
+    mapping(chunk->size, &fl, &sl);
+    if (chunk->freePrev) chunk->freePrev->freeNext = chunk->freeNext;
+    else                 mFreeLists[fl][sl] = chunk->freeNext;
+    if (chunk->freeNext) chunk->freeNext->freePrev = chunk->freePrev;
+    chunk->freePrev = chunk->freeNext = nullptr;
+    if (mFreeLists[fl][sl] == nullptr) {
+        mSecondLevelBitmap[fl] &= ~(uint32_t(1) << sl);
+        if (mSecondLevelBitmap[fl] == 0) mFirstLevelBitmap &= ~(uint64_t(1) << fl);
+    }
+    mFreeChunks--;
+}
+
+SegregatedFitAllocator::chunk_t* SegregatedFitAllocator::findFree(size_t size)
+{
+    // Round up to the next class, so that any chunk of that class or a larger
+    // one fits, and take the first one from the smallest such class.
+    size_t target = size;
+    if (size >= kSecondLevelCount) {
+        const size_t msb = 63 - __builtin_clzll(size);
+        target += (size_t(1) << (msb - kSecondLevelBits)) - 1;
+    }
+    size_t fl, sl;
+    chunk_t* found = nullptr;
+    if (target >= size) {
+        mapping(target, &fl, &sl);
+        uint32_t slMap = mSecondLevelBitmap[fl] & (~uint32_t(0) << sl);
+        if (!slMap && fl + 1 < kFirstLevelCount) {
+            const uint64_t flMap = mFirstLevelBitmap & (~uint64_t(0) << (fl + 1));
+            if (flMap) {
+                fl = __builtin_ctzll(flMap);
+                slMap = mSecondLevelBitmap[fl];
             }
-            if (cur->size == size) {
+        }
+        if (slMap) {
+            found = mFreeLists[fl][__builtin_ctz(slMap)];
+        }
+    }
+    if (!found) {
+        // Only chunks of the class of size itself may still fit, e.g. when
+        // the whole heap is requested.
+        mapping(size, &fl, &sl);
+        for (chunk_t* cur = mFreeLists[fl][sl]; cur; cur = cur->freeNext) {
+            if (cur->size >= size) {
+                found = cur;
                 break;
             }
         }
-        cur = cur->next;
     }
+    if (found) {
+        removeFree(found);
+    }
+    return found;
+}
 
-    if (free_chunk) {
-        const size_t free_size = free_chunk->size;
-        free_chunk->free = 0;
-        free_chunk->size = size;
-        if (free_size > size) {
-            int extra = 0;
-            if (flags & PAGE_ALIGNED)
-                extra = ( -free_chunk->start & ((pagesize/kMemoryAlign)-1) ) ;
-            if (extra) {
-                chunk_t* split = new chunk_t(free_chunk->start, extra);
-                free_chunk->start += extra;
-                mList.insertBefore(free_chunk, split);
-            }
+ssize_t SegregatedFitAllocator::alloc(size_t size, uint32_t flags)
+{
+    if (size == 0) {
+        return 0;
+    }
+    size = (size + kMemoryAlign-1) / kMemoryAlign;
 
-            ALOGE_IF((flags&PAGE_ALIGNED) && 
-                    ((free_chunk->start*kMemoryAlign)&(pagesize-1)),
-                    "PAGE_ALIGNED requested, but page is not aligned!!!");
+    const size_t pageUnits = getpagesize() / kMemoryAlign;
+    const size_t maxExtra = (flags & PAGE_ALIGNED) ? pageUnits - 1 : 0;
+    chunk_t* free_chunk = findFree(size + maxExtra);
+    if (!free_chunk) {
+        return NO_MEMORY;
+    }
 
-            const ssize_t tail_free = free_size - (size+extra);
-            if (tail_free > 0) {
-                chunk_t* split = new chunk_t(
-                        free_chunk->start + free_chunk->size, tail_free);
-                mList.insertAfter(free_chunk, split);
-            }
-        }
-        return (free_chunk->start)*kMemoryAlign;
+    free_chunk->free = 0;
+    const size_t extra = (flags & PAGE_ALIGNED) ? (-free_chunk->start & (pageUnits-1)) : 0;
+    if (extra) {
+        chunk_t* split = new chunk_t(free_chunk->start, extra);
+        free_chunk->start += extra;
+        free_chunk->size -= extra;
+        mList.insertBefore(free_chunk, split);
+        insertFree(split);
     }
-    return NO_MEMORY;
+    if (free_chunk->size > size) {
+        chunk_t* split = new chunk_t(free_chunk->start + size, free_chunk->size - size);
+        free_chunk->size = size;
+        mList.insertAfter(free_chunk, split);
+        insertFree(split);
+    }
+
+    mAllocated[free_chunk->start] = free_chunk;
+    mAllocatedSize += free_chunk->size;
+    return (free_chunk->start)*kMemoryAlign;
 }
 
-SimpleBestFitAllocator::chunk_t* SimpleBestFitAllocator::dealloc(size_t start)
+SegregatedFitAllocator::chunk_t* SegregatedFitAllocator::dealloc(size_t start)
 {
     start = start / kMemoryAlign;
-    chunk_t* cur = mList.head();
-    while (cur) {
-        if (cur->start == start) {
-            LOG_FATAL_IF(cur->free,
-                "block at offset 0x%08lX of size 0x%08X already freed",
-                cur->start*kMemoryAlign, cur->size*kMemoryAlign);
-
-            // merge freed blocks together
-            chunk_t* freed = cur;
-            cur->free = 1;
-            do {
-                chunk_t* const p = cur->prev;
-                chunk_t* const n = cur->next;
-                if (p && (p->free || !cur->size)) {
-                    freed = p;
-                    p->size += cur->size;
-                    mList.remove(cur);
-                    delete cur;
-                }
-                cur = n;
-            } while (cur && cur->free);
-
-            #ifndef NDEBUG
-                if (!freed->free) {
-                    dump_l("dealloc (!freed->free)");
-                }
-            #endif
-            LOG_FATAL_IF(!freed->free,
-                "freed block at offset 0x%08lX of size 0x%08X is not free!",
-                freed->start * kMemoryAlign, freed->size * kMemoryAlign);
-
-            return freed;
-        }
-        cur = cur->next;
+    auto it = mAllocated.find(start);
+    if (it == mAllocated.end()) {
+        return nullptr;
+    }
+    chunk_t* cur = it->second;
+    mAllocated.erase(it);
+    mAllocatedSize -= cur->size;
+
+    // merge freed blocks together
+    const size_t freedStart = cur->start * kMemoryAlign;
+    const size_t freedEnd = (cur->start + cur->size) * kMemoryAlign;
+    chunk_t* freed = cur;
+    freed->free = 1;
+    chunk_t* const p = freed->prev;
+    if (p && p->free) {
+        removeFree(p);
+        p->size += freed->size;
+        mList.remove(freed);
+        delete freed;
+        freed = p;
+    }
+    chunk_t* const n = freed->next;
+    if (n && n->free) {
+        removeFree(n);
+        freed->size += n->size;
+        mList.remove(n);
+        delete n;
+    }
+
+    if (mReleaseFreePages) {
+        // Allocation gave back the pages within the block already, but the
+        // ones it shared with its neighbours may be entirely free now.
+        const size_t pagesize = getpagesize();
+        const size_t first = freedStart & ~(pagesize-1);
+        const size_t last = (freedEnd - 1) & ~(pagesize-1);
+        releasePage(first, freed);
+        if (last != first) releasePage(last, freed);
     }
-    return nullptr;
+
+    insertFree(freed);
+    return freed;
 }
 
-void SimpleBestFitAllocator::dump(const char* what) const
+void SegregatedFitAllocator::releasePage(size_t offset, const chunk_t* freed) const
+{
+    const size_t pagesize = getpagesize();
+    if (mBase == nullptr || offset < freed->start * kMemoryAlign ||
+        offset + pagesize > (freed->start + freed->size) * kMemoryAlign) {
+        return;
+    }
+    // MADV_REMOVE is not defined on Dapper based Goobuntu
+#ifdef MADV_REMOVE
+    void* const start_ptr = mBase + offset;
+    int err = madvise(start_ptr, pagesize, MADV_REMOVE);
+    ALOGW_IF(err, "madvise(%p, %zu, MADV_REMOVE) returned %s",
+            start_ptr, pagesize, err<0 ? strerror(errno) : "Ok");
+#endif
+}
+
+void SegregatedFitAllocator::dump(const char* what) const
 {
     std::unique_lock<std::mutex> _l(mLock);
     dump_l(what);
 }
 
-void SimpleBestFitAllocator::dump_l(const char* what) const
+void SegregatedFitAllocator::dump_l(const char* what) const
 {
     String8 result;
     dump_l(result, what);
     ALOGD("%s", result.c_str());
 }
 
-void SimpleBestFitAllocator::dump(String8& result,
+void SegregatedFitAllocator::dump(String8& result,
         const char* what) const
 {
     std::unique_lock<std::mutex> _l(mLock);
     dump_l(result, what);
 }
 
-void SimpleBestFitAllocator::dump_l(String8& result,
+void SegregatedFitAllocator::dump_l(String8& result,
         const char* what) const
 {
     size_t size = 0;
+    size_t largest = 0;
     int32_t i = 0;
     chunk_t const* cur = mList.head();
-    
+
     const size_t SIZE = 256;
     char buffer[SIZE];
     snprintf(buffer, SIZE, "  %s (%p, size=%u)\n",
             what, this, (unsigned int)mHeapSize);
-    
+
     result.append(buffer);
-            
+
     while (cur) {
         const char* errs[] = {"", "| link bogus NP",
                             "| link bogus PN", "| link bogus NP+PN" };
@@ -463,11 +626,13 @@ void SimpleBestFitAllocator::dump_l(String8& result,
             int(cur->size*kMemoryAlign),
                     int(cur->free) ? "F" : "A",
                     errs[np|pn]);
-        
+
         result.append(buffer);
 
         if (!cur->free)
             size += cur->size*kMemoryAlign;
+        else
+            largest = std::max(largest, cur->size*kMemoryAlign);
 
         i++;
         cur = cur->next;
@@ -475,6 +640,13 @@ void SimpleBestFitAllocator::dump_l(String8& result,
     snprintf(buffer, SIZE,
             "  size allocated: %u (%u KB)\n", int(size), int(size/1024));
     result.append(buffer);
+
+    // share of the free memory which isn't in the largest free chunk
+    const size_t freeSize = mHeapSize - size;
+    snprintf(buffer, SIZE,
+            "  free chunks: %zu, largest: %zu, fragmentation: %zu%%\n",
+            mFreeChunks, largest, freeSize ? 100 - largest * 100 / freeSize : 0);
+    result.append(buffer);
 }
 
 
@@ -43,6 +43,7 @@
 
 #ifndef BINDER_DISABLE_BLOB
 #include <cutils/ashmem.h>
+#include <linux/memfd.h>
 #endif
 #include <utils/String16.h>
 #include <utils/String8.h>
@@ -113,6 +114,70 @@ static std::atomic<size_t> gParcelGlobalAllocSize;
 // Maximum number of file descriptors per Parcel.
 constexpr size_t kMaxFds = 1024;
 
+// Most transactions are small, so each thread keeps a few of the small data buffers which it
+// freed, for the next parcels it writes. The size of Parcel is fixed by prebuilts, so this stands
+// in for storing small parcels inline.
+constexpr size_t kSmallDataCapacity = 256;
+constexpr size_t kMaxCachedSmallData = 4;
+
+struct SmallDataCache {
+    uint8_t* buffers[kMaxCachedSmallData];
+    size_t count;
+    // Set once the buffers are freed at thread exit. Parcels destroyed after that, such as the
+    // ones of IPCThreadState, free their data directly.
+    bool exited;
+};
+
+#ifdef BINDER_RPC_SINGLE_THREADED
+static SmallDataCache* smallDataCache() {
+    static SmallDataCache sCache;
+    return &sCache;
+}
+#else
+// Trivially destructible, so that it outlives the thread exit handlers which free parcels.
+static thread_local SmallDataCache tSmallDataCache;
+
+struct SmallDataCacheReleaser {
+    ~SmallDataCacheReleaser() {
+        while (tSmallDataCache.count > 0) {
+            free(tSmallDataCache.buffers[--tSmallDataCache.count]);
+        }
+        tSmallDataCache.exited = true;
+    }
+};
+
+static SmallDataCache* smallDataCache() {
+    thread_local SmallDataCacheReleaser tReleaser;
+    (void)tReleaser;
+    return &tSmallDataCache;
+}
+#endif
+
+// Allocates a data buffer of at least *capacity bytes, and updates *capacity to its size.
+static uint8_t* allocateData(size_t* capacity) {
+    if (*capacity == 0 || *capacity > kSmallDataCapacity) {
+        return static_cast<uint8_t*>(malloc(*capacity));
+    }
+    *capacity = kSmallDataCapacity;
+    SmallDataCache* cache = smallDataCache();
+    if (cache->count > 0) {
+        return cache->buffers[--cache->count];
+    }
+    return static_cast<uint8_t*>(malloc(kSmallDataCapacity));
+}
+
+// Frees a buffer of allocateData(), or keeps it for the next parcels of the thread.
+static void releaseData(uint8_t* data, size_t capacity) {
+    if (capacity == kSmallDataCapacity) {
+        SmallDataCache* cache = smallDataCache();
+        if (!cache->exited && cache->count < kMaxCachedSmallData) {
+            cache->buffers[cache->count++] = data;
+            return;
+        }
+    }
+    free(data);
+}
+
 // Maximum size of a blob to transfer in-place.
 [[maybe_unused]] static const size_t BLOB_INPLACE_LIMIT = 16 * 1024;
 
@@ -1039,6 +1104,26 @@ bool Parcel::enforceInterface(const char16_t* interface,
     }
 }
 
+const char16_t* Parcel::peekInterfaceToken(size_t* outLen) const {
+    size_t initPosition = dataPosition();
+    setDataPosition(0);
+    const char16_t* interface = nullptr;
+    if (maybeKernelFields() != nullptr) {
+#ifdef BINDER_WITH_KERNEL_IPC
+        // StrictModePolicy, WorkSource, vendor header
+        (void)readInt32();
+        (void)readInt32();
+        if (readInt32() == kHeader) {
+            interface = readString16Inplace(outLen);
+        }
+#endif // BINDER_WITH_KERNEL_IPC
+    } else {
+        interface = readString16Inplace(outLen);
+    }
+    setDataPosition(initPosition);
+    return interface;
+}
+
 void Parcel::setEnforceNoDataAvail(bool enforceNoDataAvail) {
     mEnforceNoDataAvail = enforceNoDataAvail;
 }
@@ -1618,6 +1703,74 @@ status_t Parcel::writeUniqueFileDescriptor(const unique_fd& fd) {
     return writeDupFileDescriptor(fd.get());
 }
 
+#ifndef BINDER_DISABLE_BLOB
+bool Parcel::canWriteBlobFileDescriptor() const {
+    if (!mAllowFds) return false;
+    if (auto* rpcFields = maybeRpcFields()) {
+        // Trusty handles can't refer to shared memory created here.
+        return rpcFields->mSession->getFileDescriptorTransportMode() ==
+                RpcSession::FileDescriptorTransportMode::UNIX;
+    }
+    return true;
+}
+
+// Over RPC, blobs are passed in memfds. Unlike with ashmem, the receiver can
+// check the seals to make sure the size is fixed, and that an immutable blob
+// can't be changed by anyone other than the writer's existing mapping.
+status_t Parcel::writeBlobMemfd(unique_fd fd, size_t len, bool mutableCopy,
+                                WritableBlob* outBlob) {
+    if (ftruncate(fd.get(), static_cast<off_t>(len)) != 0) return -errno;
+
+    void* ptr = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (ptr == MAP_FAILED) return -errno;
+    auto unmap = make_scope_guard([&] { ::munmap(ptr, len); });
+
+    int seals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+    if (!mutableCopy) seals |= F_SEAL_FUTURE_WRITE;
+    // Nothing is written to the parcel before this, so that writeBlob() can
+    // fall back to ashmem when the seals aren't supported (-EINVAL).
+    if (fcntl(fd.get(), F_ADD_SEALS, seals) != 0) return -errno;
+
+    status_t status = writeInt32(mutableCopy ? BLOB_ASHMEM_MUTABLE : BLOB_ASHMEM_IMMUTABLE);
+    if (status != OK) return status;
+    int rawFd = fd.get();
+    status = writeFileDescriptor(fd.release(), true /*takeOwnership*/);
+    if (status != OK) return status;
+
+    unmap.release();
+    outBlob->init(rawFd, ptr, len, mutableCopy);
+    return OK;
+}
+
+status_t Parcel::readBlobMemfd(int fd, size_t len, bool isMutable, ReadableBlob* outBlob) const {
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals < 0) {
+        ALOGE("readBlob: fd is neither ashmem nor memfd");
+        return BAD_VALUE;
+    }
+    // Otherwise, the writer could truncate it, and accessing the mapping would crash.
+    if ((seals & F_SEAL_SHRINK) == 0) {
+        ALOGE("readBlob: memfd can be shrunk");
+        return BAD_VALUE;
+    }
+    if (!isMutable && (seals & (F_SEAL_WRITE | F_SEAL_FUTURE_WRITE)) == 0) {
+        ALOGE("readBlob: immutable blob memfd isn't sealed for writing");
+        return BAD_VALUE;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 0 || static_cast<size_t>(st.st_size) < len) {
+        ALOGE("request size %zu does not match memfd size", len);
+        return BAD_VALUE;
+    }
+    void* ptr = ::mmap(nullptr, len, isMutable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                       fd, 0);
+    if (ptr == MAP_FAILED) return NO_MEMORY;
+
+    outBlob->init(fd, ptr, len, isMutable);
+    return OK;
+}
+#endif // BINDER_DISABLE_BLOB
+
 status_t Parcel::writeBlob(size_t len, bool mutableCopy, WritableBlob* outBlob)
 {
 #ifdef BINDER_DISABLE_BLOB
@@ -1633,7 +1786,7 @@ status_t Parcel::writeBlob(size_t len, bool mutableCopy, WritableBlob* outBlob)
     }
 
     status_t status;
-    if (!mAllowFds || len <= BLOB_INPLACE_LIMIT) {
+    if (!canWriteBlobFileDescriptor() || len <= BLOB_INPLACE_LIMIT) {
         ALOGV("writeBlob: write in place");
         status = writeInt32(BLOB_INPLACE);
         if (status) return status;
@@ -1645,6 +1798,21 @@ status_t Parcel::writeBlob(size_t len, bool mutableCopy, WritableBlob* outBlob)
         return NO_ERROR;
     }
 
+    if (isForRpc()) {
+        unique_fd memfd(memfd_create("Parcel Blob", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+        if (memfd.ok()) {
+            ALOGV("writeBlob: write to memfd");
+            status = writeBlobMemfd(std::move(memfd), len, mutableCopy, outBlob);
+            // Kernels before 5.1 don't have F_SEAL_FUTURE_WRITE, in which
+            // case ashmem still keeps immutable blobs from being written.
+            if (status != -EINVAL) return status;
+            ALOGV("writeBlob: can't seal memfd: %s", strerror(-status));
+        } else {
+            // e.g. an old kernel, in which case ashmem still works
+            ALOGV("writeBlob: memfd_create failed: %s", strerror(errno));
+        }
+    }
+
     ALOGV("writeBlob: write to ashmem");
     int fd = ashmem_create_region("Parcel Blob", len);
     if (fd < 0) return NO_MEMORY;
@@ -2485,6 +2653,10 @@ status_t Parcel::readBlob(size_t len, ReadableBlob* outBlob) const
     if (fd == int(BAD_TYPE)) return BAD_VALUE;
 
     if (!ashmem_valid(fd)) {
+        if (isForRpc()) {
+            ALOGV("readBlob: read from memfd");
+            return readBlobMemfd(fd, len, isMutable, outBlob);
+        }
         ALOGE("invalid fd");
         return BAD_VALUE;
     }
@@ -2877,9 +3049,12 @@ void Parcel::freeDataNoInit()
             gParcelGlobalAllocSize -= mDataCapacity;
             gParcelGlobalAllocCount--;
             if (mDeallocZero) {
+                // Sensitive data isn't left for other parcels.
                 zeroMemory(mData, mDataSize);
+                free(mData);
+            } else {
+                releaseData(mData, mDataCapacity);
             }
-            free(mData);
         }
         auto* kernelFields = maybeKernelFields();
         if (kernelFields && kernelFields->mObjects) free(kernelFields->mObjects);
@@ -3016,7 +3191,8 @@ status_t Parcel::continueWrite(size_t desired)
 
         // If there is a different owner, we need to take
         // posession.
-        uint8_t* data = (uint8_t*)malloc(desired);
+        size_t capacity = desired;
+        uint8_t* data = allocateData(&capacity);
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
@@ -3026,7 +3202,7 @@ status_t Parcel::continueWrite(size_t desired)
         if (kernelFields && objectsSize) {
             objects = (binder_size_t*)calloc(objectsSize, sizeof(binder_size_t));
             if (!objects) {
-                free(data);
+                releaseData(data, capacity);
 
                 mError = NO_MEMORY;
                 return NO_MEMORY;
@@ -3041,7 +3217,7 @@ status_t Parcel::continueWrite(size_t desired)
         }
         if (rpcFields) {
             if (status_t status = truncateRpcObjects(objectsSize); status != OK) {
-                free(data);
+                releaseData(data, capacity);
                 return status;
             }
         }
@@ -3062,14 +3238,14 @@ status_t Parcel::continueWrite(size_t desired)
                kernelFields ? kernelFields->mObjectsSize : 0);
         mOwner = nullptr;
 
-        LOG_ALLOC("Parcel %p: taking ownership of %zu capacity", this, desired);
-        gParcelGlobalAllocSize += desired;
+        LOG_ALLOC("Parcel %p: taking ownership of %zu capacity", this, capacity);
+        gParcelGlobalAllocSize += capacity;
         gParcelGlobalAllocCount++;
 
         mData = data;
         mDataSize = (mDataSize < desired) ? mDataSize : desired;
         ALOGV("continueWrite Setting data size of %p to %zu", this, mDataSize);
-        mDataCapacity = desired;
+        mDataCapacity = capacity;
         if (kernelFields) {
             kernelFields->mObjects = objects;
             kernelFields->mObjectsSize = kernelFields->mObjectsCapacity = objectsSize;
@@ -3145,7 +3321,8 @@ status_t Parcel::continueWrite(size_t desired)
 
     } else {
         // This is the first data.  Easy!
-        uint8_t* data = (uint8_t*)malloc(desired);
+        size_t capacity = desired;
+        uint8_t* data = allocateData(&capacity);
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
@@ -3159,15 +3336,15 @@ status_t Parcel::continueWrite(size_t desired)
                   kernelFields ? kernelFields->mObjectsCapacity : 0, desired);
         }
 
-        LOG_ALLOC("Parcel %p: allocating with %zu capacity", this, desired);
-        gParcelGlobalAllocSize += desired;
+        LOG_ALLOC("Parcel %p: allocating with %zu capacity", this, capacity);
+        gParcelGlobalAllocSize += capacity;
         gParcelGlobalAllocCount++;
 
         mData = data;
         mDataSize = mDataPos = 0;
         ALOGV("continueWrite Setting data size of %p to %zu", this, mDataSize);
         ALOGV("continueWrite Setting data pos of %p to %zu", this, mDataPos);
-        mDataCapacity = desired;
+        mDataCapacity = capacity;
     }
 
     return NO_ERROR;
@@ -18,7 +18,9 @@
 
 #include <binder/PersistableBundle.h>
 
+#include <algorithm>
 #include <limits>
+#include <tuple>
 
 #include <binder/IBinder.h>
 #include <binder/Parcel.h>
@@ -58,6 +60,32 @@ bool getValue(const android::String16& key, T* out, const map<android::String16,
     return true;
 }
 
+// Skips 'count' values of 'size' bytes, as Parcel pads them.
+android::status_t skipValues(const android::Parcel* parcel, size_t count, size_t size) {
+    size_t bytes;
+    if (__builtin_mul_overflow(count, size, &bytes)) return android::BAD_VALUE;
+    if (bytes == 0) return android::OK;
+    return parcel->readInplace(bytes) == nullptr ? android::NOT_ENOUGH_DATA : android::OK;
+}
+
+// Skips a value written by Parcel::writeString16.
+android::status_t skipString16(const android::Parcel* parcel) {
+    int32_t len;
+    if (android::status_t status = parcel->readInt32(&len); status != android::OK) return status;
+    if (len == -1) return android::OK;  // null
+    if (len < 0) return android::BAD_VALUE;
+    return skipValues(parcel, static_cast<size_t>(len) + 1, sizeof(char16_t));
+}
+
+// Skips a vector written by one of the Parcel::write*Vector methods, with
+// elements of 'size' bytes.
+android::status_t skipVector(const android::Parcel* parcel, size_t size) {
+    int32_t count;
+    if (android::status_t status = parcel->readInt32(&count); status != android::OK) return status;
+    if (count < 0) return android::OK;  // null, which the getter will fail to read
+    return skipValues(parcel, static_cast<size_t>(count), size);
+}
+
 template <typename T>
 set<android::String16> getKeys(const map<android::String16, T>& map) {
     if (map.empty()) return set<android::String16>();
@@ -91,6 +119,76 @@ namespace os {
          }                                                               \
     }
 
+bool operator==(const PersistableBundle& lhs, const PersistableBundle& rhs) {
+    if (lhs.mLazyData != nullptr || rhs.mLazyData != nullptr) {
+        if (lhs.mLazyData == rhs.mLazyData) return true;
+        PersistableBundle lhsDecoded = lhs;
+        PersistableBundle rhsDecoded = rhs;
+        lhsDecoded.decodeLazyData();
+        rhsDecoded.decodeLazyData();
+        return lhsDecoded == rhsDecoded;
+    }
+    return (lhs.mBoolMap == rhs.mBoolMap && lhs.mIntMap == rhs.mIntMap &&
+            lhs.mLongMap == rhs.mLongMap && lhs.mDoubleMap == rhs.mDoubleMap &&
+            lhs.mStringMap == rhs.mStringMap && lhs.mBoolVectorMap == rhs.mBoolVectorMap &&
+            lhs.mIntVectorMap == rhs.mIntVectorMap && lhs.mLongVectorMap == rhs.mLongVectorMap &&
+            lhs.mDoubleVectorMap == rhs.mDoubleVectorMap &&
+            lhs.mStringVectorMap == rhs.mStringVectorMap &&
+            lhs.mPersistableBundleMap == rhs.mPersistableBundleMap);
+}
+
+bool PersistableBundle::getLazyParcel(const String16& key, int32_t type, Parcel* out) const {
+    // A parcel may hold a key once per type, as every type has its map once decoded, and the
+    // last entry of a key and type wins, as when decoding them.
+    const vector<LazyEntry>& entries = mLazyData->entries;
+    auto it = std::upper_bound(entries.begin(), entries.end(), std::tie(key, type),
+                               [](const auto& keyAndType, const LazyEntry& entry) {
+                                   return keyAndType < std::tie(entry.key, entry.type);
+                               });
+    if (it == entries.begin()) return false;
+    --it;
+    if (it->key != key || it->type != type) return false;
+
+    // only copies this value
+    if (out->setData(mLazyData->data.data() + it->offset, it->size) != NO_ERROR) return false;
+    return true;
+}
+
+template <typename T>
+bool PersistableBundle::getLazyValue(const String16& key, int32_t type, T* out,
+                                     status_t (Parcel::*read)(T*) const) const {
+    Parcel parcel;
+    if (!getLazyParcel(key, type, &parcel)) return false;
+    T value;
+    if (status_t status = (parcel.*read)(&value); status != NO_ERROR) {
+        ALOGE("Failed to decode value of type %d: %s", type, statusToString(status).c_str());
+        return false;
+    }
+    *out = std::move(value);
+    return true;
+}
+
+set<String16> PersistableBundle::getLazyKeys(int32_t type) const {
+    set<String16> keys;
+    for (const LazyEntry& entry : mLazyData->entries) {
+        if (entry.type == type) keys.emplace(entry.key);
+    }
+    return keys;
+}
+
+void PersistableBundle::decodeLazyData() {
+    if (mLazyData == nullptr) return;
+    std::shared_ptr<const LazyData> lazyData = std::move(mLazyData);
+    mLazyData = nullptr;
+
+    Parcel parcel;
+    status_t status = parcel.setData(lazyData->data.data(), lazyData->data.size());
+    if (status == NO_ERROR) status = readEntries(&parcel);
+    // The values were only checked to fit, so they may still not decode.
+    ALOGE_IF(status != NO_ERROR, "Dropping undecodable values of PersistableBundle: %s",
+             statusToString(status).c_str());
+}
+
 status_t PersistableBundle::writeToParcel(Parcel* parcel) const {
     /*
      * Keep implementation in sync with writeToParcelInner() in
@@ -103,6 +201,19 @@ status_t PersistableBundle::writeToParcel(Parcel* parcel) const {
         return NO_ERROR;
     }
 
+    if (mLazyData != nullptr) {
+        // This length value doesn't include the length header or magic number.
+        const vector<uint8_t>& data = mLazyData->data;
+        if (data.size() > std::numeric_limits<int32_t>::max()) {
+            ALOGE("Parcel length (%zu) too large to store in 32-bit signed int", data.size());
+            return BAD_VALUE;
+        }
+        RETURN_IF_FAILED(parcel->writeInt32(static_cast<int32_t>(data.size())));
+        RETURN_IF_FAILED(parcel->writeInt32(BUNDLE_MAGIC_NATIVE));
+        RETURN_IF_FAILED(parcel->write(data.data(), data.size()));
+        return NO_ERROR;
+    }
+
     size_t length_pos = parcel->dataPosition();
     RETURN_IF_FAILED(parcel->writeInt32(1));  // dummy, will hold length
     RETURN_IF_FAILED(parcel->writeInt32(BUNDLE_MAGIC_NATIVE));
@@ -142,6 +253,7 @@ bool PersistableBundle::empty() const {
 }
 
 size_t PersistableBundle::size() const {
+    if (mLazyData != nullptr) return mLazyData->entries.size();
     return (mBoolMap.size() +
             mIntMap.size() +
             mLongMap.size() +
@@ -156,6 +268,7 @@ size_t PersistableBundle::size() const {
 }
 
 size_t PersistableBundle::erase(const String16& key) {
+    decodeLazyData();
     RETURN_IF_ENTRY_ERASED(mBoolMap, key);
     RETURN_IF_ENTRY_ERASED(mIntMap, key);
     RETURN_IF_ENTRY_ERASED(mLongMap, key);
@@ -225,90 +338,139 @@ void PersistableBundle::putPersistableBundle(const String16& key, const Persista
 }
 
 bool PersistableBundle::getBoolean(const String16& key, bool* out) const {
+    if (mLazyData != nullptr) {
+        return getLazyValue(key, VAL_BOOLEAN, out, &Parcel::readBool);
+    }
     return getValue(key, out, mBoolMap);
 }
 
 bool PersistableBundle::getInt(const String16& key, int32_t* out) const {
+    if (mLazyData != nullptr) {
+        return getLazyValue(key, VAL_INTEGER, out, &Parcel::readInt32);
+    }
     return getValue(key, out, mIntMap);
 }
 
 bool PersistableBundle::getLong(const String16& key, int64_t* out) const {
+    if (mLazyData != nullptr) {
+        return getLazyValue(key, VAL_LONG, out, &Parcel::readInt64);
+    }
     return getValue(key, out, mLongMap);
 }
 
 bool PersistableBundle::getDouble(const String16& key, double* out) const {
+    if (mLazyData != nullptr) {
+        return getLazyValue(key, VAL_DOUBLE, out, &Parcel::readDouble);
+    }
     return getValue(key, out, mDoubleMap);
 }
 
 bool PersistableBundle::getString(const String16& key, String16* out) const {
+    if (mLazyData != nullptr) {
+        return getLazyValue(key, VAL_STRING, out, &Parcel::readString16);
+    }
     return getValue(key, out, mStringMap);
 }
 
 bool PersistableBundle::getBooleanVector(const String16& key, vector<bool>* out) const {
+    if (mLazyData != nullptr) {
+        return getLazyValue(key, VAL_BOOLEANARRAY, out, &Parcel::readBoolVector);
+    }
     return getValue(key, out, mBoolVectorMap);
 }
 
 bool PersistableBundle::getIntVector(const String16& key, vector<int32_t>* out) const {
+    if (mLazyData != nullptr) {
+        return getLazyValue(key, VAL_INTARRAY, out, &Parcel::readInt32Vector);
+    }
     return getValue(key, out, mIntVectorMap);
 }
 
 bool PersistableBundle::getLongVector(const String16& key, vector<int64_t>* out) const {
+    if (mLazyData != nullptr) {
+        return getLazyValue(key, VAL_LONGARRAY, out, &Parcel::readInt64Vector);
+    }
     return getValue(key, out, mLongVectorMap);
 }
 
 bool PersistableBundle::getDoubleVector(const String16& key, vector<double>* out) const {
+    if (mLazyData != nullptr) {
+        return getLazyValue(key, VAL_DOUBLEARRAY, out, &Parcel::readDoubleVector);
+    }
     return getValue(key, out, mDoubleVectorMap);
 }
 
 bool PersistableBundle::getStringVector(const String16& key, vector<String16>* out) const {
+    if (mLazyData != nullptr) {
+        return getLazyValue(key, VAL_STRINGARRAY, out, &Parcel::readString16Vector);
+    }
     return getValue(key, out, mStringVectorMap);
 }
 
 bool PersistableBundle::getPersistableBundle(const String16& key, PersistableBundle* out) const {
+    if (mLazyData != nullptr) {
+        Parcel parcel;
+        if (!getLazyParcel(key, VAL_PERSISTABLEBUNDLE, &parcel)) return false;
+        PersistableBundle value;
+        if (value.readFromParcel(&parcel) != NO_ERROR) return false;
+        *out = std::move(value);
+        return true;
+    }
     return getValue(key, out, mPersistableBundleMap);
 }
 
 set<String16> PersistableBundle::getBooleanKeys() const {
+    if (mLazyData != nullptr) return getLazyKeys(VAL_BOOLEAN);
     return getKeys(mBoolMap);
 }
 
 set<String16> PersistableBundle::getIntKeys() const {
+    if (mLazyData != nullptr) return getLazyKeys(VAL_INTEGER);
     return getKeys(mIntMap);
 }
 
 set<String16> PersistableBundle::getLongKeys() const {
+    if (mLazyData != nullptr) return getLazyKeys(VAL_LONG);
     return getKeys(mLongMap);
 }
 
 set<String16> PersistableBundle::getDoubleKeys() const {
+    if (mLazyData != nullptr) return getLazyKeys(VAL_DOUBLE);
     return getKeys(mDoubleMap);
 }
 
 set<String16> PersistableBundle::getStringKeys() const {
+    if (mLazyData != nullptr) return getLazyKeys(VAL_STRING);
     return getKeys(mStringMap);
 }
 
 set<String16> PersistableBundle::getBooleanVectorKeys() const {
+    if (mLazyData != nullptr) return getLazyKeys(VAL_BOOLEANARRAY);
     return getKeys(mBoolVectorMap);
 }
 
 set<String16> PersistableBundle::getIntVectorKeys() const {
+    if (mLazyData != nullptr) return getLazyKeys(VAL_INTARRAY);
     return getKeys(mIntVectorMap);
 }
 
 set<String16> PersistableBundle::getLongVectorKeys() const {
+    if (mLazyData != nullptr) return getLazyKeys(VAL_LONGARRAY);
     return getKeys(mLongVectorMap);
 }
 
 set<String16> PersistableBundle::getDoubleVectorKeys() const {
+    if (mLazyData != nullptr) return getLazyKeys(VAL_DOUBLEARRAY);
     return getKeys(mDoubleVectorMap);
 }
 
 set<String16> PersistableBundle::getStringVectorKeys() const {
+    if (mLazyData != nullptr) return getLazyKeys(VAL_STRINGARRAY);
     return getKeys(mStringVectorMap);
 }
 
 set<String16> PersistableBundle::getPersistableBundleKeys() const {
+    if (mLazyData != nullptr) return getLazyKeys(VAL_PERSISTABLEBUNDLE);
     return getKeys(mPersistableBundleMap);
 }
 
@@ -403,6 +565,15 @@ status_t PersistableBundle::readFromParcelInner(const Parcel* parcel, size_t len
         return BAD_VALUE;
     }
 
+    // Merge into the existing values.
+    if (!empty()) {
+        decodeLazyData();
+        return readEntries(parcel);
+    }
+
+    size_t start_pos = parcel->dataPosition();
+    auto lazy_data = std::make_shared<LazyData>();
+
     /*
      * To keep this implementation in sync with unparcel() in
      * frameworks/base/core/java/android/os/BaseBundle.java, the number of
@@ -411,6 +582,90 @@ status_t PersistableBundle::readFromParcelInner(const Parcel* parcel, size_t len
      */
     int32_t num_entries;
     RETURN_IF_FAILED(parcel->readInt32(&num_entries));
+    // every entry has at least a key length, type, and value
+    if (num_entries > 0) {
+        lazy_data->entries.reserve(std::min(static_cast<size_t>(num_entries),
+                                            parcel->dataAvail() / (3 * sizeof(int32_t))));
+    }
+
+    for (; num_entries > 0; --num_entries) {
+        LazyEntry entry;
+        RETURN_IF_FAILED(parcel->readString16(&entry.key));
+        RETURN_IF_FAILED(parcel->readInt32(&entry.type));
+        size_t value_pos = parcel->dataPosition();
+
+        switch (entry.type) {
+            case VAL_BOOLEAN:
+            case VAL_INTEGER: {
+                RETURN_IF_FAILED(skipValues(parcel, 1, sizeof(int32_t)));
+                break;
+            }
+            case VAL_LONG:
+            case VAL_DOUBLE: {
+                RETURN_IF_FAILED(skipValues(parcel, 1, sizeof(int64_t)));
+                break;
+            }
+            case VAL_STRING: {
+                RETURN_IF_FAILED(skipString16(parcel));
+                break;
+            }
+            case VAL_BOOLEANARRAY:
+            case VAL_INTARRAY: {
+                RETURN_IF_FAILED(skipVector(parcel, sizeof(int32_t)));
+                break;
+            }
+            case VAL_LONGARRAY:
+            case VAL_DOUBLEARRAY: {
+                RETURN_IF_FAILED(skipVector(parcel, sizeof(int64_t)));
+                break;
+            }
+            case VAL_STRINGARRAY: {
+                int32_t count;
+                RETURN_IF_FAILED(parcel->readInt32(&count));
+                for (int32_t i = 0; i < count; i++) {
+                    RETURN_IF_FAILED(skipString16(parcel));
+                }
+                break;
+            }
+            case VAL_PERSISTABLEBUNDLE: {
+                // Unlike at the top level, the length is trusted, like in Java.
+                int32_t bundle_length;
+                RETURN_IF_FAILED(parcel->readInt32(&bundle_length));
+                if (bundle_length < 0) {
+                    ALOGE("Bad length in parcel: %d", bundle_length);
+                    return UNEXPECTED_NULL;
+                }
+                if (bundle_length > 0) {
+                    // the magic number, and the entries
+                    size_t bundle_size = sizeof(int32_t) + static_cast<size_t>(bundle_length);
+                    RETURN_IF_FAILED(skipValues(parcel, 1, bundle_size));
+                }
+                break;
+            }
+            default: {
+                ALOGE("Unrecognized type: %d", entry.type);
+                return BAD_TYPE;
+            }
+        }
+
+        entry.offset = value_pos - start_pos;
+        entry.size = parcel->dataPosition() - value_pos;
+        lazy_data->entries.push_back(std::move(entry));
+    }
+
+    size_t end_pos = parcel->dataPosition();
+    lazy_data->data.assign(parcel->data() + start_pos, parcel->data() + end_pos);
+    std::stable_sort(lazy_data->entries.begin(), lazy_data->entries.end(),
+                     [](const LazyEntry& lhs, const LazyEntry& rhs) {
+                         return std::tie(lhs.key, lhs.type) < std::tie(rhs.key, rhs.type);
+                     });
+    if (!lazy_data->entries.empty()) mLazyData = std::move(lazy_data);
+    return NO_ERROR;
+}
+
+status_t PersistableBundle::readEntries(const Parcel* parcel) {
+    int32_t num_entries;
+    RETURN_IF_FAILED(parcel->readInt32(&num_entries));
 
     for (; num_entries > 0; --num_entries) {
         String16 key;
@@ -37,13 +37,16 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <atomic>
 #include <mutex>
 
 #define BINDER_VM_SIZE ((1 * 1024 * 1024) - sysconf(_SC_PAGE_SIZE) * 2)
@@ -81,6 +84,19 @@ protected:
     const bool mIsMain;
 };
 
+struct ProcessState::CpuPolicy {
+    ThreadPoolCpuPolicy policy;
+    cpu_set_t poolCpus;
+    cpu_set_t highPriorityCpus;
+
+    // how many threads are on highPriorityCpus because of reservedThreads
+    std::atomic<size_t> reservedThreads = 0;
+
+    std::vector<std::atomic<uint64_t>> transactionsPerCpu;
+    std::atomic<uint64_t> highPriorityTransactions = 0;
+    std::atomic<uint64_t> migrations = 0;
+};
+
 sp<ProcessState> ProcessState::self()
 {
     return init(kDefaultDriver, false /*requireDefault*/);
@@ -295,15 +311,78 @@ void ProcessState::setCallRestriction(CallRestriction restriction) {
 
 ProcessState::handle_entry* ProcessState::lookupHandleLocked(int32_t handle)
 {
-    const size_t N=mHandleToObject.size();
-    if (N <= (size_t)handle) {
-        handle_entry e;
-        e.binder = nullptr;
-        e.refs = nullptr;
-        status_t err = mHandleToObject.insertAt(e, N, handle+1-N);
-        if (err < NO_ERROR) return nullptr;
+    if (handle < 0) return nullptr;
+    const size_t chunk = static_cast<size_t>(handle) / kHandleChunkSize;
+    const HandleDirectory* dir = mHandleToObject.load(std::memory_order_relaxed);
+    if (dir == nullptr || dir->chunks.size() <= chunk || dir->chunks[chunk] == nullptr) {
+        // Readers may still use the current directory, so publish a new one.
+        auto newDir = std::make_unique<HandleDirectory>();
+        if (dir != nullptr) newDir->chunks = dir->chunks;
+        if (newDir->chunks.size() <= chunk) newDir->chunks.resize(chunk + 1, nullptr);
+        auto newChunk = std::make_unique<HandleChunk>();
+        newDir->chunks[chunk] = newChunk.get();
+        mHandleChunks.push_back(std::move(newChunk));
+        dir = newDir.get();
+        mHandleToObject.store(dir, std::memory_order_release);
+        mHandleDirectories.push_back(std::move(newDir));
+    }
+    return &dir->chunks[chunk]->entries[static_cast<size_t>(handle) % kHandleChunkSize];
+}
+
+size_t ProcessState::beginHandleRead() {
+    const size_t reader = mHandleReadEpoch.load() & 1;
+    mHandleReaders[reader]++;
+    return reader;
+}
+
+void ProcessState::endHandleRead(size_t reader) {
+    mHandleReaders[reader]--;
+}
+
+void ProcessState::waitForHandleReadersLocked() {
+    // Each flip sends new readers to the other counter, so that waiting for
+    // this one to drain ends. Once both have, every read section which may
+    // have seen an entry from before this call has ended. Sections never
+    // block, so this is short.
+    for (int i = 0; i < 2; i++) {
+        const size_t reader = mHandleReadEpoch.fetch_add(1) & 1;
+        while (mHandleReaders[reader].load() != 0) {
+            sched_yield();
+        }
     }
-    return &mHandleToObject.editItemAt(handle);
+}
+
+sp<IBinder> ProcessState::tryGetLiveProxyForHandle(int32_t handle) {
+    // The context object and the special case for the context manager below
+    // always go through mLock.
+    if (handle <= 0) return nullptr;
+
+    const size_t chunk = static_cast<size_t>(handle) / kHandleChunkSize;
+    RefBase::weakref_type* refs = nullptr;
+    IBinder* b = nullptr;
+
+    const size_t reader = beginHandleRead();
+    const HandleDirectory* dir = mHandleToObject.load(std::memory_order_acquire);
+    if (dir != nullptr && chunk < dir->chunks.size() && dir->chunks[chunk] != nullptr) {
+        b = dir->chunks[chunk]->entries[static_cast<size_t>(handle) % kHandleChunkSize]
+                    .binder.load();
+        // The BpBinder destructor calls expungeHandle, which waits for this
+        // section to end, so b and its weak references are still there. As
+        // below, this fails once the proxy is being destroyed.
+        if (b != nullptr) {
+            refs = b->getWeakRefs();
+            if (!refs->attemptIncWeak(this)) b = nullptr;
+        }
+    }
+    endHandleRead(reader);
+
+    sp<IBinder> result;
+    if (b != nullptr) {
+        // now our weak reference keeps it alive
+        result.force_set(b);
+        refs->decWeak(this);
+    }
+    return result;
 }
 
 // see b/166779391: cannot change the VNDK interface, so access like this
@@ -311,7 +390,8 @@ extern sp<BBinder> the_context_object;
 
 sp<IBinder> ProcessState::getStrongProxyForHandle(int32_t handle)
 {
-    sp<IBinder> result;
+    sp<IBinder> result = tryGetLiveProxyForHandle(handle);
+    if (result != nullptr) return result;
 
     std::unique_lock<std::mutex> _l(mLock);
 
@@ -327,7 +407,7 @@ sp<IBinder> ProcessState::getStrongProxyForHandle(int32_t handle)
         // We need to do this because there is a race condition between someone
         // releasing a reference on this BpBinder, and a new reference on its handle
         // arriving from the driver.
-        IBinder* b = e->binder;
+        IBinder* b = e->binder.load(std::memory_order_relaxed);
         if (b == nullptr || !e->refs->attemptIncWeak(this)) {
             if (handle == 0) {
                 // Special case for context manager...
@@ -360,8 +440,8 @@ sp<IBinder> ProcessState::getStrongProxyForHandle(int32_t handle)
             }
 
             sp<BpBinder> b = BpBinder::PrivateAccessor::create(handle);
-            e->binder = b.get();
             if (b) e->refs = b->getWeakRefs();
+            e->binder.store(b.get());
             result = b;
         } else {
             // This little bit of nastyness is to allow us to add a primary
@@ -384,7 +464,11 @@ void ProcessState::expungeHandle(int32_t handle, IBinder* binder)
     // This handle may have already been replaced with a new BpBinder
     // (if someone failed the AttemptIncWeak() above); we don't want
     // to overwrite it.
-    if (e && e->binder == binder) e->binder = nullptr;
+    if (e && e->binder.load(std::memory_order_relaxed) == binder) e->binder.store(nullptr);
+
+    // Either way, binder is no longer in the table, but lookups without mLock
+    // may still be using it.
+    waitForHandleReadersLocked();
 }
 
 String8 ProcessState::makeBinderThreadName() {
@@ -474,6 +558,124 @@ bool ProcessState::isThreadPoolStarted() const {
     return mThreadPoolStarted;
 }
 
+static bool toCpuSet(const std::vector<int>& cpus, cpu_set_t* set) {
+    CPU_ZERO(set);
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            ALOGE("Invalid CPU %d for the binder threadpool", cpu);
+            return false;
+        }
+        CPU_SET(cpu, set);
+    }
+    return true;
+}
+
+status_t ProcessState::setThreadPoolCpuPolicy(const ThreadPoolCpuPolicy& policy) {
+    auto cpuPolicy = std::make_unique<CpuPolicy>();
+    cpuPolicy->policy = policy;
+    if (!toCpuSet(policy.highPriorityCpus, &cpuPolicy->highPriorityCpus)) return BAD_VALUE;
+    if (policy.poolCpus.empty()) {
+        // so that threads can move back after high priority transactions
+        if (0 != sched_getaffinity(0, sizeof(cpu_set_t), &cpuPolicy->poolCpus)) {
+            int savedErrno = errno;
+            ALOGE("Could not get CPU affinity: %s", strerror(savedErrno));
+            return -savedErrno;
+        }
+    } else if (!toCpuSet(policy.poolCpus, &cpuPolicy->poolCpus)) {
+        return BAD_VALUE;
+    }
+
+    long numCpus = sysconf(_SC_NPROCESSORS_CONF);
+    cpuPolicy->transactionsPerCpu =
+            std::vector<std::atomic<uint64_t>>(numCpus > 0 ? static_cast<size_t>(numCpus) : 1);
+
+    // Threads only read mCpuPolicy once they counted themselves in mCurrentThreads, so it must
+    // be set under the same lock as that count is checked. mLock orders this with
+    // startThreadPool.
+    std::unique_lock<std::mutex> _l(mLock);
+    pthread_mutex_lock(&mThreadCountLock);
+    auto unlockGuard = make_scope_guard([&]() { pthread_mutex_unlock(&mThreadCountLock); });
+    if (mThreadPoolStarted || mCurrentThreads != 0) {
+        ALOGE("The threadpool CPU policy must be set before any thread joins the threadpool");
+        return INVALID_OPERATION;
+    }
+    mCpuPolicy = std::move(cpuPolicy);
+    return OK;
+}
+
+ProcessState::ThreadPoolCpuStats ProcessState::getThreadPoolCpuStats() const {
+    ThreadPoolCpuStats stats;
+    if (mCpuPolicy == nullptr) return stats;
+
+    for (const auto& count : mCpuPolicy->transactionsPerCpu) {
+        stats.transactionsPerCpu.push_back(count.load(std::memory_order_relaxed));
+    }
+    stats.highPriorityTransactions =
+            mCpuPolicy->highPriorityTransactions.load(std::memory_order_relaxed);
+    stats.migrations = mCpuPolicy->migrations.load(std::memory_order_relaxed);
+    return stats;
+}
+
+static void setThreadCpus(const cpu_set_t& cpus) {
+    if (0 != sched_setaffinity(0, sizeof(cpu_set_t), &cpus)) {
+        ALOGW("Could not set CPU affinity of binder thread: %s", strerror(errno));
+    }
+}
+
+bool ProcessState::cpuPolicyJoin() {
+    CpuPolicy& cpuPolicy = *mCpuPolicy;
+
+    bool reserved = false;
+    if (!cpuPolicy.policy.highPriorityCpus.empty()) {
+        size_t current = cpuPolicy.reservedThreads.load();
+        while (current < cpuPolicy.policy.reservedThreads) {
+            if (cpuPolicy.reservedThreads.compare_exchange_weak(current, current + 1)) {
+                reserved = true;
+                break;
+            }
+        }
+    }
+
+    if (reserved) {
+        setThreadCpus(cpuPolicy.highPriorityCpus);
+    } else if (!cpuPolicy.policy.poolCpus.empty()) {
+        setThreadCpus(cpuPolicy.poolCpus);
+    }
+    return reserved;
+}
+
+void ProcessState::cpuPolicyLeave() {
+    mCpuPolicy->reservedThreads--;
+}
+
+bool ProcessState::cpuPolicyBeginTransaction(bool onHighPriorityCpus) {
+    CpuPolicy& cpuPolicy = *mCpuPolicy;
+
+    int policy = sched_getscheduler(0);
+    bool highPriority = policy == SCHED_FIFO || policy == SCHED_RR ||
+            getpriority(PRIO_PROCESS, 0) <= cpuPolicy.policy.highPriorityNice;
+
+    bool moved = false;
+    if (highPriority) {
+        cpuPolicy.highPriorityTransactions.fetch_add(1, std::memory_order_relaxed);
+        if (!onHighPriorityCpus && !cpuPolicy.policy.highPriorityCpus.empty()) {
+            setThreadCpus(cpuPolicy.highPriorityCpus);
+            cpuPolicy.migrations.fetch_add(1, std::memory_order_relaxed);
+            moved = true;
+        }
+    }
+
+    if (int cpu = sched_getcpu();
+        cpu >= 0 && static_cast<size_t>(cpu) < cpuPolicy.transactionsPerCpu.size()) {
+        cpuPolicy.transactionsPerCpu[cpu].fetch_add(1, std::memory_order_relaxed);
+    }
+    return moved;
+}
+
+void ProcessState::cpuPolicyEndTransaction() {
+    setThreadCpus(mCpuPolicy->poolCpus);
+}
+
 #define DRIVER_FEATURES_PATH "/dev/binderfs/features/"
 bool ProcessState::isDriverFeatureEnabled(const DriverFeature feature) {
     static const char* const names[] = {
@@ -561,6 +763,9 @@ ProcessState::ProcessState(const char* driver)
         mCurrentThreads(0),
         mKernelStartedThreads(0),
         mStarvationStartTimeMs(0),
+        mHandleToObject(nullptr),
+        mHandleReadEpoch(0),
+        mHandleReaders{0, 0},
         mForked(false),
         mThreadPoolStarted(false),
         mThreadPoolSeq(1),
@@ -21,6 +21,7 @@
 #include <binder/unique_fd.h>
 
 #include <inttypes.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <algorithm>
@@ -259,59 +260,121 @@ std::optional<RecordedTransaction> RecordedTransaction::fromFile(const unique_fd
             return std::nullopt;
         }
 
-        switch (chunk.chunkType) {
-            case HEADER_CHUNK: {
-                if (chunk.dataSize != static_cast<uint32_t>(sizeof(TransactionHeader))) {
-                    ALOGE("Header Chunk indicated size %" PRIu32 "; Expected %zu.", chunk.dataSize,
-                          sizeof(TransactionHeader));
-                    return std::nullopt;
-                }
-                t.mData.mHeader = *reinterpret_cast<TransactionHeader*>(payloadMap);
-                break;
-            }
-            case INTERFACE_NAME_CHUNK: {
-                t.mData.mInterfaceName =
-                        std::string(reinterpret_cast<char*>(payloadMap), chunk.dataSize);
-                break;
+        if (!t.applyChunk(chunk.chunkType, reinterpret_cast<const uint8_t*>(payloadMap),
+                          chunk.dataSize)) {
+            return std::nullopt;
+        }
+    } while (chunk.chunkType != END_CHUNK);
+
+    return std::optional<RecordedTransaction>(std::move(t));
+}
+
+bool RecordedTransaction::applyChunk(uint32_t chunkType, const uint8_t* data,
+                                     uint32_t dataSize) {
+    switch (chunkType) {
+        case HEADER_CHUNK: {
+            if (dataSize != static_cast<uint32_t>(sizeof(TransactionHeader))) {
+                ALOGE("Header Chunk indicated size %" PRIu32 "; Expected %zu.", dataSize,
+                      sizeof(TransactionHeader));
+                return false;
             }
-            case DATA_PARCEL_CHUNK: {
-                if (t.mSentDataOnly.setData(reinterpret_cast<const unsigned char*>(payloadMap),
-                                            chunk.dataSize) != android::NO_ERROR) {
-                    ALOGE("Failed to set sent parcel data.");
-                    return std::nullopt;
-                }
-                break;
+            mData.mHeader = *reinterpret_cast<const TransactionHeader*>(data);
+            break;
+        }
+        case INTERFACE_NAME_CHUNK: {
+            mData.mInterfaceName = std::string(reinterpret_cast<const char*>(data), dataSize);
+            break;
+        }
+        case DATA_PARCEL_CHUNK: {
+            if (mSentDataOnly.setData(data, dataSize) != android::NO_ERROR) {
+                ALOGE("Failed to set sent parcel data.");
+                return false;
             }
-            case REPLY_PARCEL_CHUNK: {
-                if (t.mReplyDataOnly.setData(reinterpret_cast<const unsigned char*>(payloadMap),
-                                             chunk.dataSize) != android::NO_ERROR) {
-                    ALOGE("Failed to set reply parcel data.");
-                    return std::nullopt;
-                }
-                break;
+            break;
+        }
+        case REPLY_PARCEL_CHUNK: {
+            if (mReplyDataOnly.setData(data, dataSize) != android::NO_ERROR) {
+                ALOGE("Failed to set reply parcel data.");
+                return false;
             }
-            case DATA_PARCEL_OBJECT_CHUNK: {
-                const uint64_t* objects = reinterpret_cast<const uint64_t*>(payloadMap);
-                size_t metaDataSize = (chunk.dataSize / sizeof(uint64_t));
-                ALOGI("Total objects found in saved parcel %zu", metaDataSize);
-                for (size_t index = 0; index < metaDataSize; ++index) {
-                    t.mData.mSentObjectData.push_back(objects[index]);
-                }
-                break;
+            break;
+        }
+        case DATA_PARCEL_OBJECT_CHUNK: {
+            const uint64_t* objects = reinterpret_cast<const uint64_t*>(data);
+            size_t metaDataSize = (dataSize / sizeof(uint64_t));
+            ALOGI("Total objects found in saved parcel %zu", metaDataSize);
+            for (size_t index = 0; index < metaDataSize; ++index) {
+                mData.mSentObjectData.push_back(objects[index]);
             }
-            case END_CHUNK:
-                break;
-            default:
-                ALOGI("Unrecognized chunk.");
-                break;
+            break;
         }
+        case END_CHUNK:
+            break;
+        default:
+            ALOGI("Unrecognized chunk.");
+            break;
+    }
+    return true;
+}
+
+std::optional<RecordedTransaction> RecordedTransaction::fromBuffer(const uint8_t* data,
+                                                                   size_t size,
+                                                                   size_t* outConsumed) {
+    if (reinterpret_cast<uintptr_t>(data) % sizeof(transaction_checksum_t) != 0) {
+        ALOGE("Recording buffer must be 8-byte aligned.");
+        return std::nullopt;
+    }
+
+    RecordedTransaction t;
+    ChunkDescriptor chunk;
+    size_t position = 0;
+    do {
+        if (size - position < sizeof(ChunkDescriptor)) {
+            ALOGE("Not enough data remains to contain expected chunk descriptor");
+            return std::nullopt;
+        }
+        memcpy(&chunk, data + position, sizeof(ChunkDescriptor));
+        position += sizeof(ChunkDescriptor);
+
+        if (chunk.dataSize > kMaxChunkDataSize) {
+            ALOGE("Chunk data exceeds maximum size.");
+            return std::nullopt;
+        }
+        size_t chunkPayloadSize =
+                chunk.dataSize + PADDING8(chunk.dataSize) + sizeof(transaction_checksum_t);
+        if (chunkPayloadSize > size - position) {
+            ALOGE("Chunk payload exceeds remaining data size.");
+            return std::nullopt;
+        }
+
+        const transaction_checksum_t* checksumData =
+                reinterpret_cast<const transaction_checksum_t*>(data + position -
+                                                                sizeof(ChunkDescriptor));
+        transaction_checksum_t checksum = 0;
+        for (size_t checksumIndex = 0;
+             checksumIndex < (sizeof(ChunkDescriptor) + chunkPayloadSize) /
+                     sizeof(transaction_checksum_t);
+             checksumIndex++) {
+            checksum ^= checksumData[checksumIndex];
+        }
+        if (checksum != 0) {
+            ALOGE("Checksum failed.");
+            return std::nullopt;
+        }
+
+        if (!t.applyChunk(chunk.chunkType, data + position, chunk.dataSize)) {
+            return std::nullopt;
+        }
+        position += chunkPayloadSize;
     } while (chunk.chunkType != END_CHUNK);
 
+    *outConsumed = position;
     return std::optional<RecordedTransaction>(std::move(t));
 }
 
-android::status_t RecordedTransaction::writeChunk(borrowed_fd fd, uint32_t chunkType,
-                                                  size_t byteCount, const uint8_t* data) const {
+android::status_t RecordedTransaction::appendChunk(std::vector<std::byte>* buffer,
+                                                   uint32_t chunkType, size_t byteCount,
+                                                   const uint8_t* data) {
     if (byteCount > kMaxChunkDataSize) {
         ALOGE("Chunk data exceeds maximum size");
         return BAD_VALUE;
@@ -322,70 +385,82 @@ android::status_t RecordedTransaction::writeChunk(borrowed_fd fd, uint32_t chunk
     const std::byte* descriptorBytes = reinterpret_cast<const std::byte*>(&descriptor);
     const std::byte* dataBytes = reinterpret_cast<const std::byte*>(data);
 
-    // Add Chunk to intermediate buffer, except checksum
-    std::vector<std::byte> buffer;
-    buffer.insert(buffer.end(), descriptorBytes, descriptorBytes + sizeof(ChunkDescriptor));
-    buffer.insert(buffer.end(), dataBytes, dataBytes + byteCount);
+    // Add Chunk to the buffer, except checksum
+    size_t chunkStart = buffer->size();
+    buffer->insert(buffer->end(), descriptorBytes, descriptorBytes + sizeof(ChunkDescriptor));
+    buffer->insert(buffer->end(), dataBytes, dataBytes + byteCount);
     std::byte zero{0};
-    buffer.insert(buffer.end(), PADDING8(byteCount), zero);
+    buffer->insert(buffer->end(), PADDING8(byteCount), zero);
 
-    // Calculate checksum from buffer
-    transaction_checksum_t* checksumData = reinterpret_cast<transaction_checksum_t*>(buffer.data());
+    // Calculate checksum from buffer. Chunks start 8-byte aligned, since
+    // every chunk is padded.
     transaction_checksum_t checksumValue = 0;
-    for (size_t idx = 0; idx < (buffer.size() / sizeof(transaction_checksum_t)); idx++) {
-        checksumValue ^= checksumData[idx];
+    for (size_t idx = chunkStart; idx < buffer->size(); idx += sizeof(transaction_checksum_t)) {
+        transaction_checksum_t word;
+        memcpy(&word, buffer->data() + idx, sizeof(word));
+        checksumValue ^= word;
     }
 
     // Write checksum to buffer
     std::byte* checksumBytes = reinterpret_cast<std::byte*>(&checksumValue);
-    buffer.insert(buffer.end(), checksumBytes, checksumBytes + sizeof(transaction_checksum_t));
-
-    // Write buffer to file
-    if (!WriteFully(fd, buffer.data(), buffer.size())) {
-        ALOGE("Failed to write chunk fd %d", fd.get());
-        return UNKNOWN_ERROR;
-    }
+    buffer->insert(buffer->end(), checksumBytes, checksumBytes + sizeof(transaction_checksum_t));
     return NO_ERROR;
 }
 
 android::status_t RecordedTransaction::dumpToFile(const unique_fd& fd) const {
+    // The whole transaction is written at once, so that a recording only
+    // takes one write per transaction, and a reader following the file never
+    // sees part of one.
+    std::vector<std::byte> buffer;
+    buffer.reserve(6 * (sizeof(ChunkDescriptor) + sizeof(transaction_checksum_t) + 8) +
+                   sizeof(TransactionHeader) + mData.mInterfaceName.size() +
+                   mSentDataOnly.dataBufferSize() + mReplyDataOnly.dataBufferSize() +
+                   mData.mSentObjectData.size() * sizeof(uint64_t));
+
     if (NO_ERROR !=
-        writeChunk(fd, HEADER_CHUNK, sizeof(TransactionHeader),
-                   reinterpret_cast<const uint8_t*>(&(mData.mHeader)))) {
+        appendChunk(&buffer, HEADER_CHUNK, sizeof(TransactionHeader),
+                    reinterpret_cast<const uint8_t*>(&(mData.mHeader)))) {
         ALOGE("Failed to write transactionHeader to fd %d", fd.get());
         return UNKNOWN_ERROR;
     }
     if (NO_ERROR !=
-        writeChunk(fd, INTERFACE_NAME_CHUNK, mData.mInterfaceName.size() * sizeof(uint8_t),
-                   reinterpret_cast<const uint8_t*>(mData.mInterfaceName.c_str()))) {
+        appendChunk(&buffer, INTERFACE_NAME_CHUNK, mData.mInterfaceName.size() * sizeof(uint8_t),
+                    reinterpret_cast<const uint8_t*>(mData.mInterfaceName.c_str()))) {
         ALOGI("Failed to write Interface Name Chunk to fd %d", fd.get());
         return UNKNOWN_ERROR;
     }
 
     if (NO_ERROR !=
-        writeChunk(fd, DATA_PARCEL_CHUNK, mSentDataOnly.dataBufferSize(), mSentDataOnly.data())) {
+        appendChunk(&buffer, DATA_PARCEL_CHUNK, mSentDataOnly.dataBufferSize(),
+                    mSentDataOnly.data())) {
         ALOGE("Failed to write sent Parcel to fd %d", fd.get());
         return UNKNOWN_ERROR;
     }
 
     if (NO_ERROR !=
-        writeChunk(fd, REPLY_PARCEL_CHUNK, mReplyDataOnly.dataBufferSize(),
-                   mReplyDataOnly.data())) {
+        appendChunk(&buffer, REPLY_PARCEL_CHUNK, mReplyDataOnly.dataBufferSize(),
+                    mReplyDataOnly.data())) {
         ALOGE("Failed to write reply Parcel to fd %d", fd.get());
         return UNKNOWN_ERROR;
     }
 
     if (NO_ERROR !=
-        writeChunk(fd, DATA_PARCEL_OBJECT_CHUNK, mData.mSentObjectData.size() * sizeof(uint64_t),
-                   reinterpret_cast<const uint8_t*>(mData.mSentObjectData.data()))) {
+        appendChunk(&buffer, DATA_PARCEL_OBJECT_CHUNK,
+                    mData.mSentObjectData.size() * sizeof(uint64_t),
+                    reinterpret_cast<const uint8_t*>(mData.mSentObjectData.data()))) {
         ALOGE("Failed to write sent parcel object metadata to fd %d", fd.get());
         return UNKNOWN_ERROR;
     }
 
-    if (NO_ERROR != writeChunk(fd, END_CHUNK, 0, NULL)) {
+    if (NO_ERROR != appendChunk(&buffer, END_CHUNK, 0, NULL)) {
         ALOGE("Failed to write end chunk to fd %d", fd.get());
         return UNKNOWN_ERROR;
     }
+
+    if (!WriteFully(fd, buffer.data(), buffer.size())) {
+        ALOGE("Failed to write transaction to fd %d", fd.get());
+        return UNKNOWN_ERROR;
+    }
     return NO_ERROR;
 }
 
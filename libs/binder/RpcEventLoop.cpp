@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RpcEventLoop"
+
+#include "RpcEventLoop.h"
+
+#include <inttypes.h>
+
+#include <algorithm>
+
+#ifndef BINDER_RPC_SINGLE_THREADED
+#include <sys/epoll.h>
+#endif
+
+#include <log/log.h>
+
+#include "FdTrigger.h"
+#include "JavaThreadAttacher.h"
+#include "RpcState.h"
+#include "Utils.h"
+
+namespace android {
+
+using android::binder::borrowed_fd;
+using android::binder::unique_fd;
+
+void RpcEventLoop::endConnection(sp<RpcSession>&& session,
+                                 const sp<RpcSession::RpcConnection>& connection) {
+    sp<RpcSession::EventListener> listener;
+    {
+        RpcMutexLockGuard _l(session->mMutex);
+        listener = session->mEventListener.promote();
+    }
+
+    // done after all cleanup, since session shutdown progresses via callbacks here
+    if (connection != nullptr) {
+        LOG_ALWAYS_FATAL_IF(!session->removeIncomingConnection(connection),
+                            "bad state: connection object guaranteed to be in list");
+    }
+
+    session = nullptr;
+
+    if (listener != nullptr) {
+        listener->onSessionIncomingThreadEnded();
+    }
+}
+
+#ifdef BINDER_RPC_SINGLE_THREADED
+
+std::shared_ptr<RpcEventLoop> RpcEventLoop::make(const Options&) {
+    return nullptr;
+}
+
+RpcEventLoop::~RpcEventLoop() {}
+
+void RpcEventLoop::stop(bool) {}
+
+RpcSession::IncomingThreadStats RpcEventLoop::getStats() {
+    return {};
+}
+
+void RpcEventLoop::addConnection(sp<RpcSession>&&, sp<RpcSession::RpcConnection>&&) {
+    LOG_ALWAYS_FATAL("RpcEventLoop is not supported on single-threaded libbinder");
+}
+
+#else // BINDER_RPC_SINGLE_THREADED
+
+// epoll event data of mStopTrigger
+constexpr uint64_t kStopId = 0;
+
+std::shared_ptr<RpcEventLoop> RpcEventLoop::make(const Options& options) {
+    LOG_ALWAYS_FATAL_IF(options.minThreads == 0,
+                        "RpcEventLoop needs at least one thread to wait for commands");
+    LOG_ALWAYS_FATAL_IF(options.maxThreads < options.minThreads,
+                        "RpcEventLoop max threads %zu is less than min threads %zu",
+                        options.maxThreads, options.minThreads);
+
+    std::shared_ptr<RpcEventLoop> loop(new RpcEventLoop(options));
+    loop->mEpoll = unique_fd(TEMP_FAILURE_RETRY(epoll_create1(EPOLL_CLOEXEC)));
+    if (!loop->mEpoll.ok()) {
+        ALOGE("Could not create epoll instance: %s", strerror(errno));
+        return nullptr;
+    }
+
+    loop->mStopTrigger = FdTrigger::make();
+    if (loop->mStopTrigger == nullptr) return nullptr;
+    // level-triggered, so that every thread wakes up
+    if (!loop->control(EPOLL_CTL_ADD, loop->mStopTrigger->readFd(), EPOLLIN, kStopId)) {
+        return nullptr;
+    }
+
+    RpcMutexLockGuard _l(loop->mLock);
+    for (size_t i = 0; i < options.minThreads; i++) {
+        loop->spawnThreadLocked();
+    }
+    return loop;
+}
+
+RpcEventLoop::~RpcEventLoop() {
+    RpcMutexLockGuard _l(mLock);
+    LOG_ALWAYS_FATAL_IF(!mConnections.empty(), "Destroying RpcEventLoop with %zu connections",
+                        mConnections.size());
+}
+
+void RpcEventLoop::stop(bool wait) {
+    RpcMutexUniqueLock _l(mLock);
+    LOG_ALWAYS_FATAL_IF(!mConnections.empty(), "Stopping RpcEventLoop with %zu connections",
+                        mConnections.size());
+    if (!mStopping) {
+        mStopping = true;
+        mStopTrigger->trigger();
+    }
+    if (wait) {
+        mThreadExitCv.wait(_l, [&] { return mStats.threads == 0; });
+    }
+}
+
+RpcSession::IncomingThreadStats RpcEventLoop::getStats() {
+    RpcMutexLockGuard _l(mLock);
+    return mStats;
+}
+
+void RpcEventLoop::addConnection(sp<RpcSession>&& session,
+                                 sp<RpcSession::RpcConnection>&& connection) {
+    LOG_ALWAYS_FATAL_IF(connection == nullptr, "must have connection if setup succeeded");
+    LOG_ALWAYS_FATAL_IF(connection->rpcTransport->pollFd().get() < 0,
+                        "RpcEventLoop needs a transport which can be polled");
+
+    // It was assigned to the setup thread, but nested calls must not use it
+    // when they are made from other connections on that thread.
+    session->clearConnectionTid(connection);
+
+    // Check before any other thread can use the transport. It may already
+    // have buffered data, which epoll wouldn't report.
+    bool ready = connection->rpcTransport->pollRead() != WOULD_BLOCK;
+
+    RpcMutexUniqueLock _l(mLock);
+
+    if (mStopping) {
+        _l.unlock();
+        endConnection(std::move(session), connection);
+        return;
+    }
+
+    uint64_t sessionId;
+    if (auto it = mSessionIds.find(session.get()); it != mSessionIds.end()) {
+        sessionId = it->second;
+    } else {
+        sessionId = mNextId++;
+        // Only waited on once, since it doesn't change after triggering.
+        if (!control(EPOLL_CTL_ADD, session->mShutdownTrigger->readFd(), EPOLLIN | EPOLLONESHOT,
+                     sessionId)) {
+            _l.unlock();
+            endConnection(std::move(session), connection);
+            return;
+        }
+        mSessionIds[session.get()] = sessionId;
+        mSessions[sessionId].session = session;
+    }
+
+    uint64_t id = mNextId++;
+    mSessions[sessionId].connections.push_back(id);
+    mConnections[id] = Connection{
+            .sessionId = sessionId,
+            .connection = std::move(connection),
+    };
+    session = nullptr;
+
+    if (ready) {
+        [[maybe_unused]] JavaThreadAttacher javaThreadAttacher;
+        serve(std::move(_l), id);
+    } else {
+        rearmOrEnd(std::move(_l), id, OK);
+    }
+}
+
+bool RpcEventLoop::control(int op, borrowed_fd fd, uint32_t events, uint64_t id) {
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = id;
+    if (0 != epoll_ctl(mEpoll.get(), op, fd.get(), &event)) {
+        ALOGE("epoll_ctl(%d) failed on fd %d: %s", op, fd.get(), strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void RpcEventLoop::spawnThreadLocked() {
+    // counted as waiting right away, so that no other thread is spawned for
+    // the same reason before it gets there
+    mStats.threads++;
+    mStats.idleThreads++;
+    mStats.spawned++;
+    mStats.peakThreads = std::max(mStats.peakThreads, mStats.threads);
+
+    // detached, since the last thread may drop the last reference to the
+    // session owning this loop
+    RpcMaybeThread([self = shared_from_this()] { self->threadLoop(); }).detach();
+}
+
+void RpcEventLoop::threadLoop() {
+    [[maybe_unused]] JavaThreadAttacher javaThreadAttacher;
+
+    int timeoutMs = -1;
+    if (mOptions.idleTimeout.count() > 0 && mOptions.maxThreads > mOptions.minThreads) {
+        timeoutMs = static_cast<int>(mOptions.idleTimeout.count());
+    }
+
+    while (true) {
+        // only take one event, so that other threads can serve the others
+        epoll_event event;
+        int ret = TEMP_FAILURE_RETRY(epoll_wait(mEpoll.get(), &event, 1, timeoutMs));
+        LOG_ALWAYS_FATAL_IF(ret < 0, "epoll_wait failed: %s", strerror(errno));
+
+        {
+            RpcMutexLockGuard _l(mLock);
+            if (ret == 0 || event.data.u64 == kStopId) {
+                if (ret != 0 || mStats.threads > mOptions.minThreads) {
+                    mStats.threads--;
+                    mStats.idleThreads--;
+                    if (ret == 0) mStats.retired++;
+                    mThreadExitCv.notify_all();
+                    return;
+                }
+                continue;
+            }
+
+            // Make sure there is still a thread waiting for the next command.
+            mStats.idleThreads--;
+            if (mStats.idleThreads == 0 && !mStopping) {
+                if (mStats.threads < mOptions.maxThreads) {
+                    spawnThreadLocked();
+                } else {
+                    mStats.exhausted++;
+                }
+            }
+        }
+
+        onEvent(event.data.u64);
+
+        RpcMutexLockGuard _l(mLock);
+        mStats.idleThreads++;
+    }
+}
+
+void RpcEventLoop::onEvent(uint64_t id) {
+    RpcMutexUniqueLock _l(mLock);
+
+    if (mSessions.count(id) != 0) {
+        shutdownSession(std::move(_l), id);
+        return;
+    }
+
+    auto it = mConnections.find(id);
+    // ended meanwhile, the event was already waiting to be taken
+    if (it == mConnections.end()) return;
+
+    if (it->second.busy) {
+        it->second.pending = true;
+        return;
+    }
+    serve(std::move(_l), id);
+}
+
+void RpcEventLoop::serve(RpcMutexUniqueLock lock, uint64_t id) {
+    // Not erased while busy, and references to unordered_map elements stay
+    // valid when other elements are added.
+    Connection& connection = mConnections.at(id);
+    LOG_ALWAYS_FATAL_IF(connection.busy, "Connection served by two threads");
+    connection.busy = true;
+    sp<RpcSession> session = mSessions.at(connection.sessionId).session;
+
+    status_t status;
+    do {
+        connection.pending = false;
+        lock.unlock();
+        status = session->executeReadyCommands(connection.connection);
+        lock.lock();
+    } while (status == OK && connection.pending);
+    connection.busy = false;
+
+    rearmOrEnd(std::move(lock), id, status);
+}
+
+void RpcEventLoop::rearmOrEnd(RpcMutexUniqueLock lock, uint64_t id, status_t status) {
+    Connection& connection = mConnections.at(id);
+
+    if (status == OK && !mSessions.at(connection.sessionId).shuttingDown) {
+        int op = connection.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        if (control(op, connection.connection->rpcTransport->pollFd(), EPOLLIN | EPOLLONESHOT,
+                    id)) {
+            connection.registered = true;
+            return;
+        }
+    }
+
+    Ended ended = removeConnectionLocked(id);
+    lock.unlock();
+    endConnection(std::move(ended.session), ended.connection);
+}
+
+void RpcEventLoop::shutdownSession(RpcMutexUniqueLock lock, uint64_t sessionId) {
+    Session& session = mSessions.at(sessionId);
+    session.shuttingDown = true;
+
+    // Busy connections are ended by the thread serving them, once reads
+    // fail because of the trigger.
+    std::vector<uint64_t> idle;
+    for (uint64_t id : session.connections) {
+        if (!mConnections.at(id).busy) idle.push_back(id);
+    }
+
+    // may erase the session
+    std::vector<Ended> ended;
+    for (uint64_t id : idle) {
+        ended.push_back(removeConnectionLocked(id));
+    }
+
+    lock.unlock();
+    for (Ended& e : ended) {
+        endConnection(std::move(e.session), e.connection);
+    }
+}
+
+RpcEventLoop::Ended RpcEventLoop::removeConnectionLocked(uint64_t id) {
+    auto it = mConnections.find(id);
+    LOG_ALWAYS_FATAL_IF(it == mConnections.end(), "Unknown connection %" PRIu64, id);
+    Connection connection = std::move(it->second);
+    mConnections.erase(it);
+
+    if (connection.registered) {
+        (void)control(EPOLL_CTL_DEL, connection.connection->rpcTransport->pollFd(), 0, id);
+    }
+
+    auto sessionIt = mSessions.find(connection.sessionId);
+    LOG_ALWAYS_FATAL_IF(sessionIt == mSessions.end(), "Unknown session %" PRIu64,
+                        connection.sessionId);
+    Session& session = sessionIt->second;
+    std::erase(session.connections, id);
+
+    Ended ended{
+            .session = session.session,
+            .connection = std::move(connection.connection),
+    };
+
+    if (session.connections.empty()) {
+        (void)control(EPOLL_CTL_DEL, session.session->mShutdownTrigger->readFd(), 0,
+                      connection.sessionId);
+        mSessionIds.erase(session.session.get());
+        mSessions.erase(sessionIt);
+    }
+
+    return ended;
+}
+
+#endif // BINDER_RPC_SINGLE_THREADED
+
+} // namespace android
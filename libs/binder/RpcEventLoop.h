@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <binder/RpcSession.h>
+#include <binder/RpcThreads.h>
+#include <binder/unique_fd.h>
+
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+
+class FdTrigger;
+
+// Serves incoming connections on a set of threads, which wait for data on all
+// of them with epoll, instead of on one thread per connection. See
+// RpcServer::setEventThreads and RpcSession::setAdaptiveIncomingThreads.
+//
+// Like the kernel asks ProcessState for another looper with BR_SPAWN_LOOPER,
+// a thread is started whenever the last waiting thread takes a command, up to
+// Options::maxThreads. The threads hold a reference to the loop, so it is
+// destroyed once the last of them exits.
+class RpcEventLoop : public std::enable_shared_from_this<RpcEventLoop> {
+public:
+    struct Options {
+        // started right away, and never retired
+        size_t minThreads = 1;
+        size_t maxThreads = 1;
+        // how long threads beyond minThreads wait for a command before they
+        // exit, or forever if zero
+        std::chrono::milliseconds idleTimeout{0};
+    };
+
+    // Returns nullptr on error, and always on single-threaded builds.
+    static std::shared_ptr<RpcEventLoop> make(const Options& options);
+    ~RpcEventLoop();
+
+    // Makes the threads exit. All connections must have ended. If 'wait',
+    // this also waits until they have, which must not be done on one of them.
+    void stop(bool wait);
+
+    RpcSession::IncomingThreadStats getStats();
+
+    // Takes over a connection which RpcSession::preJoinSetup set up
+    // successfully on the calling thread, instead of RpcSession::join. The
+    // transport must have an RpcTransport::pollFd.
+    void addConnection(sp<RpcSession>&& session, sp<RpcSession::RpcConnection>&& connection);
+
+    // The cleanup of RpcSession::join for a connection which isn't served by
+    // a thread (connection may be nullptr if setup failed).
+    static void endConnection(sp<RpcSession>&& session,
+                              const sp<RpcSession::RpcConnection>& connection);
+
+private:
+    explicit RpcEventLoop(const Options& options) : mOptions(options) {}
+
+    struct Session {
+        sp<RpcSession> session;
+        // ids of its connections
+        std::vector<uint64_t> connections;
+        // once set, connections are ended instead of waited on again
+        bool shuttingDown = false;
+    };
+    struct Connection {
+        // key in mSessions
+        uint64_t sessionId = 0;
+        sp<RpcSession::RpcConnection> connection;
+        // whether it was added to the epoll set
+        bool registered = false;
+        // whether a thread is executing commands from it
+        bool busy = false;
+        // whether an event arrived while busy
+        bool pending = false;
+    };
+    struct Ended {
+        sp<RpcSession> session;
+        sp<RpcSession::RpcConnection> connection;
+    };
+
+    [[nodiscard]] bool control(int op, binder::borrowed_fd fd, uint32_t events, uint64_t id);
+    void spawnThreadLocked();
+    void threadLoop();
+    void onEvent(uint64_t id);
+    // Serves the connection 'id' on this thread until it has no more data.
+    void serve(RpcMutexUniqueLock lock, uint64_t id);
+    // Waits for more data on the connection, or ends it.
+    void rearmOrEnd(RpcMutexUniqueLock lock, uint64_t id, status_t status);
+    void shutdownSession(RpcMutexUniqueLock lock, uint64_t sessionId);
+    [[nodiscard]] Ended removeConnectionLocked(uint64_t id);
+
+    const Options mOptions;
+    binder::unique_fd mEpoll;
+    std::unique_ptr<FdTrigger> mStopTrigger;
+
+    RpcMutex mLock; // for all below
+    bool mStopping = false;
+    RpcSession::IncomingThreadStats mStats;
+    // notified when a thread exits after stop
+    RpcConditionVariable mThreadExitCv;
+    // ids are the data of epoll events, and are never reused. Sessions are
+    // keyed by the id of their shutdown trigger.
+    uint64_t mNextId = 1;
+    std::unordered_map<uint64_t, Session> mSessions;
+    std::unordered_map<const RpcSession*, uint64_t> mSessionIds;
+    std::unordered_map<uint64_t, Connection> mConnections;
+};
+
+} // namespace android
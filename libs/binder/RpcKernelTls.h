@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+// Key derivation for moving the records of a TLS 1.3 connection into the
+// kernel, see RpcTransportCtxFactoryTls::Options::kernelTls.
+
+#include <linux/tls.h>
+#include <openssl/digest.h>
+#include <openssl/mem.h>
+#include <openssl/span.h>
+
+#include <string.h>
+
+#include <string_view>
+
+namespace android {
+
+// HKDF-Expand-Label from RFC 8446, with an empty context.
+bool hkdfExpandLabel(uint8_t* out, size_t outLen, const EVP_MD* digest,
+                     bssl::Span<const uint8_t> secret, std::string_view label);
+
+// Fills in what setsockopt(SOL_TLS) takes for one direction of a connection
+// (e.g. tls12_crypto_info_aes_gcm_128): the record key and IV derived from
+// the traffic secret of that direction, and the sequence number of the next
+// record.
+template <typename CryptoInfo>
+bool makeKernelTlsCryptoInfo(CryptoInfo* info, uint16_t cipherType, const EVP_MD* digest,
+                             bssl::Span<const uint8_t> secret, uint64_t sequence) {
+    *info = {};
+    info->info.version = TLS_1_3_VERSION;
+    info->info.cipher_type = cipherType;
+
+    // In TLS 1.3, the kernel takes the 12 byte static IV as salt + iv.
+    uint8_t iv[12] = {};
+    static_assert(sizeof(info->salt) + sizeof(info->iv) == sizeof(iv));
+    bool derived = hkdfExpandLabel(info->key, sizeof(info->key), digest, secret, "key") &&
+            hkdfExpandLabel(iv, sizeof(iv), digest, secret, "iv");
+    memcpy(info->salt, iv, sizeof(info->salt));
+    memcpy(info->iv, iv + sizeof(info->salt), sizeof(info->iv));
+    OPENSSL_cleanse(iv, sizeof(iv));
+    if (!derived) return false;
+    for (size_t i = 0; i < sizeof(info->rec_seq); i++) {
+        size_t shift = 8 * (sizeof(info->rec_seq) - 1 - i);
+        info->rec_seq[i] = static_cast<uint8_t>(sequence >> shift);
+    }
+    return true;
+}
+
+} // namespace android
@@ -34,6 +34,7 @@
 #include "BuildFlags.h"
 #include "FdTrigger.h"
 #include "OS.h"
+#include "RpcEventLoop.h"
 #include "RpcSocketAddress.h"
 #include "RpcState.h"
 #include "RpcTransportUtils.h"
@@ -124,6 +125,17 @@ size_t RpcServer::getMaxThreads() {
     return mMaxThreads;
 }
 
+void RpcServer::setEventThreads(size_t threads) {
+    LOG_ALWAYS_FATAL_IF(!kEnableRpcThreads && threads > 0,
+                        "Event threads are not supported on single-threaded libbinder");
+    LOG_ALWAYS_FATAL_IF(mJoinThreadRunning, "Cannot set event threads while running");
+    mEventThreads = threads;
+}
+
+size_t RpcServer::getEventThreads() {
+    return mEventThreads;
+}
+
 bool RpcServer::setProtocolVersion(uint32_t version) {
     if (!RpcState::validateProtocolVersion(version)) {
         return false;
@@ -247,6 +259,15 @@ void RpcServer::join() {
         mJoinThreadRunning = true;
         mShutdownTrigger = FdTrigger::make();
         LOG_ALWAYS_FATAL_IF(mShutdownTrigger == nullptr, "Cannot create join signaler");
+
+        if (mEventThreads > 0) {
+            mEventLoop = RpcEventLoop::make({
+                    .minThreads = mEventThreads,
+                    .maxThreads = mEventThreads,
+            });
+            ALOGE_IF(mEventLoop == nullptr,
+                     "Could not start event threads, using a thread per connection instead");
+        }
     }
 
     status_t status;
@@ -344,6 +365,16 @@ bool RpcServer::shutdown() {
         mJoinThread.reset();
     }
 
+    // All sessions ended, so the event threads are only returning from
+    // their last callbacks, which may take mLock.
+    if (mEventLoop != nullptr) {
+        std::shared_ptr<RpcEventLoop> eventLoop = std::move(mEventLoop);
+        _l.unlock();
+        eventLoop->stop(true /*wait*/);
+        eventLoop = nullptr;
+        _l.lock();
+    }
+
     mServer = RpcTransportFd();
 
     LOG_RPC_DETAIL("Finished waiting on shutdown.");
@@ -448,6 +479,7 @@ void RpcServer::establishConnection(
 
     RpcMaybeThread thisThread;
     sp<RpcSession> session;
+    RpcEventLoop* eventLoop = nullptr;
     {
         RpcMutexUniqueLock _l(server->mLock);
 
@@ -546,8 +578,13 @@ void RpcServer::establishConnection(
             return;
         }
 
-        detachGuard.release();
-        session->preJoinThreadOwnership(std::move(thisThread));
+        if (client->pollFd().get() >= 0) eventLoop = server->mEventLoop.get();
+
+        // with an event loop, this thread is done after setup
+        if (eventLoop == nullptr) {
+            detachGuard.release();
+            session->preJoinThreadOwnership(std::move(thisThread));
+        }
     }
 
     auto setupResult = session->preJoinSetup(std::move(client));
@@ -555,6 +592,19 @@ void RpcServer::establishConnection(
     // avoid strong cycle
     server = nullptr;
 
+    if (eventLoop != nullptr) {
+        if (setupResult.status == OK) {
+            // The server can't finish shutting down while the session has
+            // this connection, so the event loop is still alive.
+            eventLoop->addConnection(std::move(session), std::move(setupResult.connection));
+        } else {
+            ALOGE("Connection failed to init, closing with status %s",
+                  statusToString(setupResult.status).c_str());
+            RpcEventLoop::endConnection(std::move(session), setupResult.connection);
+        }
+        return;
+    }
+
     joinFn(std::move(session), std::move(setupResult));
 }
 
@@ -18,7 +18,6 @@
 
 #include <binder/RpcSession.h>
 
-#include <dlfcn.h>
 #include <inttypes.h>
 #include <netinet/tcp.h>
 #include <poll.h>
@@ -36,18 +35,15 @@
 
 #include "BuildFlags.h"
 #include "FdTrigger.h"
+#include "JavaThreadAttacher.h"
 #include "OS.h"
+#include "RpcEventLoop.h"
 #include "RpcSocketAddress.h"
 #include "RpcState.h"
 #include "RpcTransportUtils.h"
 #include "RpcWireFormat.h"
 #include "Utils.h"
 
-#if defined(__ANDROID__) && !defined(__ANDROID_RECOVERY__)
-#include <jni.h>
-extern "C" JavaVM* AndroidRuntimeGetJavaVM();
-#endif
-
 namespace android {
 
 using namespace android::binder::impl;
@@ -90,6 +86,26 @@ size_t RpcSession::getMaxIncomingThreads() {
     return mMaxIncomingThreads;
 }
 
+void RpcSession::setAdaptiveIncomingThreads(size_t minThreads,
+                                            std::chrono::milliseconds idleTimeout) {
+    RpcMutexLockGuard _l(mMutex);
+    LOG_ALWAYS_FATAL_IF(mStartedSetup,
+                        "Must set adaptive incoming threads before setting up connections");
+    LOG_ALWAYS_FATAL_IF(minThreads == 0, "Need at least one incoming thread to wait for calls");
+    mAdaptiveMinIncomingThreads = minThreads;
+    mIncomingIdleTimeout = idleTimeout;
+}
+
+RpcSession::IncomingThreadStats RpcSession::getIncomingThreadStats() {
+    std::shared_ptr<RpcEventLoop> eventLoop;
+    {
+        RpcMutexLockGuard _l(mMutex);
+        eventLoop = mIncomingEventLoop;
+    }
+    if (eventLoop == nullptr) return {};
+    return eventLoop->getStats();
+}
+
 void RpcSession::setMaxOutgoingConnections(size_t connections) {
     RpcMutexLockGuard _l(mMutex);
     LOG_ALWAYS_FATAL_IF(mStartedSetup,
@@ -140,6 +156,37 @@ RpcSession::FileDescriptorTransportMode RpcSession::getFileDescriptorTransportMo
     return mFileDescriptorTransportMode;
 }
 
+void RpcSession::setOnewayBatching(size_t maxBatchBytes, std::chrono::microseconds flushDeadline) {
+    LOG_ALWAYS_FATAL_IF(flushDeadline.count() < 0, "Negative oneway flush deadline");
+    RpcMutexLockGuard _l(mOnewayBatch.mutex);
+    mOnewayBatch.maxBytes = maxBatchBytes;
+    mOnewayBatch.flushDeadline = flushDeadline;
+}
+
+void RpcSession::setBusyPollReads(std::chrono::microseconds spinDuration,
+                                  std::chrono::microseconds socketBusyPoll) {
+    RpcMutexLockGuard _l(mMutex);
+    LOG_ALWAYS_FATAL_IF(mStartedSetup, "Must set busy polling before setting up connections");
+    LOG_ALWAYS_FATAL_IF(spinDuration.count() < 0 || socketBusyPoll.count() < 0,
+                        "Negative busy polling duration");
+    if (spinDuration.count() > 0) {
+        mBusyPoll = std::make_shared<RpcBusyPoll>();
+        mBusyPoll->spinDuration = spinDuration;
+    } else {
+        mBusyPoll = nullptr;
+    }
+    mSocketBusyPoll = socketBusyPoll;
+}
+
+RpcSession::BusyPollStats RpcSession::getBusyPollStats() {
+    RpcMutexLockGuard _l(mMutex);
+    if (mBusyPoll == nullptr) return {};
+    return {
+            .hits = mBusyPoll->hits.load(),
+            .misses = mBusyPoll->misses.load(),
+    };
+}
+
 status_t RpcSession::setupUnixDomainClient(const char* path) {
     return setupSocketClient(UnixSocketAddress(path));
 }
@@ -361,68 +408,6 @@ RpcSession::PreJoinSetupResult RpcSession::preJoinSetup(
     };
 }
 
-namespace {
-#if !defined(__ANDROID__) || defined(__ANDROID_RECOVERY__)
-class JavaThreadAttacher {};
-#else
-// RAII object for attaching / detaching current thread to JVM if Android Runtime exists. If
-// Android Runtime doesn't exist, no-op.
-class JavaThreadAttacher {
-public:
-    JavaThreadAttacher() {
-        // Use dlsym to find androidJavaAttachThread because libandroid_runtime is loaded after
-        // libbinder.
-        auto vm = getJavaVM();
-        if (vm == nullptr) return;
-
-        char threadName[16];
-        if (0 != pthread_getname_np(pthread_self(), threadName, sizeof(threadName))) {
-            constexpr const char* defaultThreadName = "UnknownRpcSessionThread";
-            memcpy(threadName, defaultThreadName,
-                   std::min<size_t>(sizeof(threadName), strlen(defaultThreadName) + 1));
-        }
-        LOG_RPC_DETAIL("Attaching current thread %s to JVM", threadName);
-        JavaVMAttachArgs args;
-        args.version = JNI_VERSION_1_2;
-        args.name = threadName;
-        args.group = nullptr;
-        JNIEnv* env;
-
-        LOG_ALWAYS_FATAL_IF(vm->AttachCurrentThread(&env, &args) != JNI_OK,
-                            "Cannot attach thread %s to JVM", threadName);
-        mAttached = true;
-    }
-    ~JavaThreadAttacher() {
-        if (!mAttached) return;
-        auto vm = getJavaVM();
-        LOG_ALWAYS_FATAL_IF(vm == nullptr,
-                            "Unable to detach thread. No JavaVM, but it was present before!");
-
-        LOG_RPC_DETAIL("Detaching current thread from JVM");
-        int ret = vm->DetachCurrentThread();
-        if (ret == JNI_OK) {
-            mAttached = false;
-        } else {
-            ALOGW("Unable to detach current thread from JVM (%d)", ret);
-        }
-    }
-
-private:
-    JavaThreadAttacher(const JavaThreadAttacher&) = delete;
-    void operator=(const JavaThreadAttacher&) = delete;
-
-    bool mAttached = false;
-
-    static JavaVM* getJavaVM() {
-        static auto fn = reinterpret_cast<decltype(&AndroidRuntimeGetJavaVM)>(
-                dlsym(RTLD_DEFAULT, "AndroidRuntimeGetJavaVM"));
-        if (fn == nullptr) return nullptr;
-        return fn();
-    }
-};
-#endif
-} // namespace
-
 void RpcSession::join(sp<RpcSession>&& session, PreJoinSetupResult&& setupResult) {
     sp<RpcConnection>& connection = setupResult.connection;
 
@@ -467,6 +452,28 @@ void RpcSession::join(sp<RpcSession>&& session, PreJoinSetupResult&& setupResult
     }
 }
 
+status_t RpcSession::executeReadyCommands(const sp<RpcConnection>& connection) {
+    {
+        RpcMutexLockGuard _l(mMutex);
+        // so that nested calls from these commands use this connection
+        connection->exclusiveTid = binder::os::GetThreadId();
+    }
+
+    sp<RpcSession> thiz = sp<RpcSession>::fromExisting(this);
+    status_t status;
+    while ((status = connection->rpcTransport->pollRead()) == OK) {
+        status = state()->getAndExecuteCommand(connection, thiz, RpcState::CommandType::ANY);
+        if (status != OK) {
+            LOG_RPC_DETAIL("Binder connection closing w/ status %s",
+                           statusToString(status).c_str());
+            break;
+        }
+    }
+
+    clearConnectionTid(connection);
+    return status == WOULD_BLOCK ? OK : status;
+}
+
 sp<RpcServer> RpcSession::server() {
     RpcServer* unsafeServer = mForServer.unsafe_get();
     sp<RpcServer> server = mForServer.promote();
@@ -504,6 +511,11 @@ status_t RpcSession::setupClient(const std::function<status_t(const std::vector<
 
         mId.clear();
 
+        if (mIncomingEventLoop != nullptr) {
+            mIncomingEventLoop->stop(false /*wait*/);
+            mIncomingEventLoop = nullptr;
+        }
+
         mShutdownTrigger = nullptr;
         mRpcBinderState = std::make_unique<RpcState>();
 
@@ -571,6 +583,18 @@ status_t RpcSession::setupClient(const std::function<status_t(const std::vector<
         if (status_t status = connectAndInit(mId, false /*incoming*/); status != OK) return status;
     }
 
+    if (mAdaptiveMinIncomingThreads > 0 && mMaxIncomingThreads > 0) {
+        std::shared_ptr<RpcEventLoop> eventLoop = RpcEventLoop::make({
+                .minThreads = std::min(mAdaptiveMinIncomingThreads, mMaxIncomingThreads),
+                .maxThreads = mMaxIncomingThreads,
+                .idleTimeout = mIncomingIdleTimeout,
+        });
+        ALOGE_IF(eventLoop == nullptr,
+                 "Could not start adaptive incoming threads, using a thread per connection");
+        RpcMutexLockGuard _l(mMutex);
+        mIncomingEventLoop = std::move(eventLoop);
+    }
+
     for (size_t i = 0; i < mMaxIncomingThreads; i++) {
         if (status_t status = connectAndInit(mId, true /*incoming*/); status != OK) return status;
     }
@@ -613,6 +637,19 @@ status_t RpcSession::setupOneSocketConnection(const RpcSocketAddress& addr,
             }
         }
 
+#ifdef SO_BUSY_POLL
+        if (mSocketBusyPoll.count() > 0) {
+            int busyPoll = static_cast<int>(mSocketBusyPoll.count());
+            // Best effort, since raising it may need CAP_NET_ADMIN, and not
+            // all sockets support it.
+            if (setsockopt(serverFd.get(), SOL_SOCKET, SO_BUSY_POLL, &busyPoll, sizeof(busyPoll)) <
+                0) {
+                ALOGW("Could not set SO_BUSY_POLL on %s: %s", addr.toString().c_str(),
+                      strerror(errno));
+            }
+        }
+#endif
+
         RpcTransportFd transportFd(std::move(serverFd));
 
         if (0 != TEMP_FAILURE_RETRY(connect(transportFd.fd.get(), addr.addr(), addr.addrSize()))) {
@@ -664,6 +701,10 @@ status_t RpcSession::setupOneSocketConnection(const RpcSocketAddress& addr,
 status_t RpcSession::initAndAddConnection(RpcTransportFd fd, const std::vector<uint8_t>& sessionId,
                                           bool incoming) {
     LOG_ALWAYS_FATAL_IF(mShutdownTrigger == nullptr);
+    {
+        RpcMutexLockGuard _l(mMutex);
+        fd.busyPoll = mBusyPoll;
+    }
     auto server = mCtx->newTransport(std::move(fd), mShutdownTrigger.get());
     if (server == nullptr) {
         ALOGE("%s: Unable to set up RpcTransport", __PRETTY_FUNCTION__);
@@ -721,6 +762,20 @@ status_t RpcSession::initAndAddConnection(RpcTransportFd fd, const std::vector<u
 }
 
 status_t RpcSession::addIncomingConnection(std::unique_ptr<RpcTransport> rpcTransport) {
+    // only set before connections are added
+    if (mIncomingEventLoop != nullptr && rpcTransport->pollFd().get() >= 0) {
+        // Setup is waited for anyway, so it is done on this thread.
+        auto setupResult = preJoinSetup(std::move(rpcTransport));
+        if (setupResult.status == OK) {
+            mIncomingEventLoop->addConnection(sp<RpcSession>::fromExisting(this),
+                                              std::move(setupResult.connection));
+        } else {
+            RpcEventLoop::endConnection(sp<RpcSession>::fromExisting(this),
+                                        setupResult.connection);
+        }
+        return OK;
+    }
+
     RpcMutex mutex;
     RpcConditionVariable joinCv;
     RpcMutexUniqueLock lock(mutex);
@@ -836,6 +891,9 @@ bool RpcSession::removeIncomingConnection(const sp<RpcConnection>& connection) {
         it != mConnections.mIncoming.end()) {
         mConnections.mIncoming.erase(it);
         if (mConnections.mIncoming.size() == 0) {
+            // may be called on one of its threads, so they aren't waited for
+            if (mIncomingEventLoop != nullptr) mIncomingEventLoop->stop(false /*wait*/);
+
             sp<EventListener> listener = mEventListener.promote();
             if (listener) {
                 _l.unlock();
@@ -94,32 +94,43 @@ status_t RpcState::onBinderLeaving(const sp<RpcSession>& session, const sp<IBind
         return INVALID_OPERATION;
     }
 
+    if (isRpc) {
+        uint64_t address = binder->remoteBinder()->getPrivateAccessor().rpcAddress();
+        NodeShard& shard = shardFor(address);
+        RpcMutexLockGuard _l(shard.mutex);
+        if (isTerminated()) return DEAD_OBJECT;
+
+        auto it = shard.nodes.find(address);
+        LOG_ALWAYS_FATAL_IF(it == shard.nodes.end() || it->second.binder != binder,
+                            "RPC binder must have known address at this point");
+        it->second.timesSent++;
+        it->second.sentRef = binder; // might already be set
+        *outAddress = address;
+        return OK;
+    }
+
     RpcMutexLockGuard _l(mNodeMutex);
-    if (mTerminated) return DEAD_OBJECT;
-
-    // TODO(b/182939933): maybe move address out of BpBinder, and keep binder->address map
-    // in RpcState
-    for (auto& [addr, node] : mNodeForAddress) {
-        if (binder == node.binder) {
-            if (isRpc) {
-                // check integrity of data structure
-                uint64_t actualAddr = binder->remoteBinder()->getPrivateAccessor().rpcAddress();
-                LOG_ALWAYS_FATAL_IF(addr != actualAddr, "Address mismatch %" PRIu64 " vs %" PRIu64,
-                                    addr, actualAddr);
-            }
-            node.timesSent++;
-            node.sentRef = binder; // might already be set
-            *outAddress = addr;
+    if (isTerminated()) return DEAD_OBJECT;
+
+    if (auto found = mAddressForLocalBinder.find(binder.get());
+        found != mAddressForLocalBinder.end()) {
+        NodeShard& shard = shardFor(found->second);
+        RpcMutexLockGuard _ls(shard.mutex);
+        if (auto it = shard.nodes.find(found->second);
+            it != shard.nodes.end() && it->second.binder == binder) {
+            it->second.timesSent++;
+            it->second.sentRef = binder; // might already be set
+            *outAddress = it->first;
             return OK;
         }
+        // stale, the node is being erased
     }
-    LOG_ALWAYS_FATAL_IF(isRpc, "RPC binder must have known address at this point");
 
     bool forServer = session->server() != nullptr;
 
     // arbitrary limit for maximum number of nodes in a process (otherwise we
     // might run out of addresses)
-    if (mNodeForAddress.size() > 100000) {
+    if (countBinders() > 100000) {
         return NO_MEMORY;
     }
 
@@ -139,16 +150,21 @@ status_t RpcState::onBinderLeaving(const sp<RpcSession>& session, const sp<IBind
             mNextId++;
         }
 
-        auto&& [it, inserted] = mNodeForAddress.insert({RpcWireAddress::toRaw(address),
-                                                        BinderNode{
-                                                                .binder = binder,
-                                                                .sentRef = binder,
-                                                                .timesSent = 1,
-                                                        }});
-        if (inserted) {
-            *outAddress = it->first;
-            return OK;
-        }
+        uint64_t rawAddress = RpcWireAddress::toRaw(address);
+        NodeShard& shard = shardFor(rawAddress);
+        RpcMutexLockGuard _ls(shard.mutex);
+        if (shard.nodes.count(rawAddress) != 0) continue;
+        if (!reserveNode()) return DEAD_OBJECT;
+
+        shard.nodes.emplace(rawAddress,
+                            BinderNode{
+                                    .binder = binder,
+                                    .sentRef = binder,
+                                    .timesSent = 1,
+                            });
+        mAddressForLocalBinder[binder.get()] = rawAddress;
+        *outAddress = rawAddress;
+        return OK;
     }
 }
 
@@ -170,10 +186,11 @@ status_t RpcState::onBinderEntering(const sp<RpcSession>& session, uint64_t addr
         return BAD_VALUE;
     }
 
-    RpcMutexLockGuard _l(mNodeMutex);
-    if (mTerminated) return DEAD_OBJECT;
+    NodeShard& shard = shardFor(address);
+    RpcMutexLockGuard _l(shard.mutex);
+    if (isTerminated()) return DEAD_OBJECT;
 
-    if (auto it = mNodeForAddress.find(address); it != mNodeForAddress.end()) {
+    if (auto it = shard.nodes.find(address); it != shard.nodes.end()) {
         *out = it->second.binder.promote();
 
         // implicitly have strong RPC refcount, since we received this binder
@@ -189,7 +206,8 @@ status_t RpcState::onBinderEntering(const sp<RpcSession>& session, uint64_t addr
         return BAD_VALUE;
     }
 
-    auto&& [it, inserted] = mNodeForAddress.insert({address, BinderNode{}});
+    if (!reserveNode()) return DEAD_OBJECT;
+    auto&& [it, inserted] = shard.nodes.insert({address, BinderNode{}});
     LOG_ALWAYS_FATAL_IF(!inserted, "Failed to insert binder when creating proxy");
 
     // Currently, all binders are assumed to be part of the same session (no
@@ -205,12 +223,13 @@ status_t RpcState::flushExcessBinderRefs(const sp<RpcSession>& session, uint64_t
     // extra reference counting packets now.
     if (binder->remoteBinder()) return OK;
 
-    RpcMutexUniqueLock _l(mNodeMutex);
-    if (mTerminated) return DEAD_OBJECT;
+    NodeShard& shard = shardFor(address);
+    RpcMutexUniqueLock _l(shard.mutex);
+    if (isTerminated()) return DEAD_OBJECT;
 
-    auto it = mNodeForAddress.find(address);
+    auto it = shard.nodes.find(address);
 
-    LOG_ALWAYS_FATAL_IF(it == mNodeForAddress.end(), "Can't be deleted while we hold sp<>");
+    LOG_ALWAYS_FATAL_IF(it == shard.nodes.end(), "Can't be deleted while we hold sp<>");
     LOG_ALWAYS_FATAL_IF(it->second.binder != binder,
                         "Caller of flushExcessBinderRefs using inconsistent arguments");
 
@@ -233,19 +252,19 @@ status_t RpcState::flushExcessBinderRefs(const sp<RpcSession>& session, uint64_t
 }
 
 status_t RpcState::sendObituaries(const sp<RpcSession>& session) {
-    RpcMutexUniqueLock _l(mNodeMutex);
-
     // Gather strong pointers to all of the remote binders for this session so
     // we hold the strong references. remoteBinder() returns a raw pointer.
     // Send the obituaries and drop the strong pointers outside of the lock so
     // the destructors and the onBinderDied calls are not done while locked.
     std::vector<sp<IBinder>> remoteBinders;
-    for (const auto& [_, binderNode] : mNodeForAddress) {
-        if (auto binder = binderNode.binder.promote()) {
-            remoteBinders.push_back(std::move(binder));
+    for (NodeShard& shard : mNodeShards) {
+        RpcMutexLockGuard _l(shard.mutex);
+        for (const auto& [_, binderNode] : shard.nodes) {
+            if (auto binder = binderNode.binder.promote()) {
+                remoteBinders.push_back(std::move(binder));
+            }
         }
     }
-    _l.unlock();
 
     for (const auto& binder : remoteBinders) {
         if (binder->remoteBinder() &&
@@ -257,8 +276,7 @@ status_t RpcState::sendObituaries(const sp<RpcSession>& session) {
 }
 
 size_t RpcState::countBinders() {
-    RpcMutexLockGuard _l(mNodeMutex);
-    return mNodeForAddress.size();
+    return mNodeCount.load(std::memory_order_relaxed) & ~kTerminatedBit;
 }
 
 void RpcState::dump() {
@@ -267,13 +285,17 @@ void RpcState::dump() {
 }
 
 void RpcState::clear() {
-    return clear(RpcMutexUniqueLock(mNodeMutex));
-}
+    RpcMutexUniqueLock _l(mNodeMutex);
+
+    // no new nodes from now on
+    mNodeCount.fetch_or(kTerminatedBit, std::memory_order_acq_rel);
 
-void RpcState::clear(RpcMutexUniqueLock nodeLock) {
     if (mTerminated) {
-        LOG_ALWAYS_FATAL_IF(!mNodeForAddress.empty(),
-                            "New state should be impossible after terminating!");
+        for (NodeShard& shard : mNodeShards) {
+            RpcMutexLockGuard _ls(shard.mutex);
+            LOG_ALWAYS_FATAL_IF(!shard.nodes.empty(),
+                                "New state should be impossible after terminating!");
+        }
         return;
     }
     mTerminated = true;
@@ -283,35 +305,76 @@ void RpcState::clear(RpcMutexUniqueLock nodeLock) {
         dumpLocked();
     }
 
-    // invariants
-    for (auto& [address, node] : mNodeForAddress) {
-        bool guaranteedHaveBinder = node.timesSent > 0;
-        if (guaranteedHaveBinder) {
-            LOG_ALWAYS_FATAL_IF(node.sentRef == nullptr,
-                                "Binder expected to be owned with address: %" PRIu64 " %s", address,
-                                node.toString().c_str());
-        }
-    }
-
     // if the destructor of a binder object makes another RPC call, then calling
     // decStrong could deadlock. So, we must hold onto these binders until
-    // mNodeMutex is no longer taken.
-    auto temp = std::move(mNodeForAddress);
-    mNodeForAddress.clear(); // RpcState isn't reusable, but for future/explicit
+    // no node locks are taken.
+    std::vector<NodeMap> temp;
+    temp.reserve(kNumNodeShards);
+    for (NodeShard& shard : mNodeShards) {
+        RpcMutexLockGuard _ls(shard.mutex);
+
+        // invariants
+        for (auto& [address, node] : shard.nodes) {
+            bool guaranteedHaveBinder = node.timesSent > 0;
+            if (guaranteedHaveBinder) {
+                LOG_ALWAYS_FATAL_IF(node.sentRef == nullptr,
+                                    "Binder expected to be owned with address: %" PRIu64 " %s",
+                                    address, node.toString().c_str());
+            }
+        }
+
+        temp.push_back(std::move(shard.nodes));
+        shard.nodes.clear(); // RpcState isn't reusable, but for future/explicit
+    }
+    mAddressForLocalBinder.clear();
+    mNodeCount.store(kTerminatedBit, std::memory_order_release);
 
-    nodeLock.unlock();
+    _l.unlock();
     temp.clear(); // explicit
 }
 
 void RpcState::dumpLocked() {
     ALOGE("DUMP OF RpcState %p", this);
-    ALOGE("DUMP OF RpcState (%zu nodes)", mNodeForAddress.size());
-    for (const auto& [address, node] : mNodeForAddress) {
-        ALOGE("- address: %" PRIu64 " %s", address, node.toString().c_str());
+    ALOGE("DUMP OF RpcState (%zu nodes)", countBinders());
+    for (NodeShard& shard : mNodeShards) {
+        RpcMutexLockGuard _ls(shard.mutex);
+        for (const auto& [address, node] : shard.nodes) {
+            ALOGE("- address: %" PRIu64 " %s", address, node.toString().c_str());
+        }
     }
     ALOGE("END DUMP OF RpcState");
 }
 
+RpcState::NodeShard& RpcState::shardFor(uint64_t address) {
+    // Addresses are mostly sequential, so mix the bits before picking a shard.
+    static_assert((kNumNodeShards & (kNumNodeShards - 1)) == 0);
+    return mNodeShards[(address * 0x9E3779B97F4A7C15ull) >> (64 - __builtin_ctzll(kNumNodeShards))];
+}
+
+bool RpcState::reserveNode() {
+    size_t count = mNodeCount.load(std::memory_order_acquire);
+    do {
+        if (count & kTerminatedBit) return false;
+    } while (!mNodeCount.compare_exchange_weak(count, count + 1, std::memory_order_acq_rel));
+    return true;
+}
+
+bool RpcState::releaseNode() {
+    size_t count = mNodeCount.load(std::memory_order_acquire);
+    while (true) {
+        // being cleared, so nodes are erased by clear()
+        if (count & kTerminatedBit) return false;
+
+        // Claiming the last node stops any other thread from adding a node,
+        // so that the session can't be used after it has started shutting
+        // down.
+        size_t next = count == 1 ? kTerminatedBit : count - 1;
+        if (mNodeCount.compare_exchange_weak(count, next, std::memory_order_acq_rel)) {
+            return count == 1;
+        }
+    }
+}
+
 std::string RpcState::BinderNode::toString() const {
     sp<IBinder> strongBinder = this->binder.promote();
 
@@ -381,6 +444,77 @@ status_t RpcState::rpcSend(const sp<RpcSession::RpcConnection>& connection,
     return OK;
 }
 
+status_t RpcState::rpcSendOneway(const sp<RpcSession::RpcConnection>& connection,
+                                 const sp<RpcSession>& session, iovec* iovs, int niovs,
+                                 const std::optional<SmallFunction<status_t()>>& altPoll,
+                                 const std::vector<std::variant<unique_fd, borrowed_fd>>*
+                                         ancillaryFds) {
+    auto& batch = session->mOnewayBatch;
+
+    size_t frameSize = 0;
+    for (int i = 0; i < niovs; i++) frameSize += iovs[i].iov_len;
+
+    std::vector<uint8_t> toSend;
+    {
+        RpcMutexUniqueLock _l(batch.mutex);
+
+        // File descriptors are attached to a specific write, so they can't be
+        // moved into a batch.
+        bool hasFds = ancillaryFds != nullptr && !ancillaryFds->empty();
+        if (batch.maxBytes == 0 || hasFds || batch.pending.size() + frameSize > batch.maxBytes) {
+            // Frames which don't fit are never queued, so the pending bytes
+            // may never reach maxBytes. Wake up the thread waiting to flush,
+            // since it would only wait longer for a batch which can't grow.
+            if (batch.flushing && !batch.pending.empty() && !hasFds) {
+                batch.full = true;
+                batch.cv.notify_all();
+            }
+            _l.unlock();
+            return rpcSend(connection, session, "transaction", iovs, niovs, altPoll,
+                           ancillaryFds);
+        }
+
+        for (int i = 0; i < niovs; i++) {
+            const uint8_t* base = static_cast<const uint8_t*>(iovs[i].iov_base);
+            batch.pending.insert(batch.pending.end(), base, base + iovs[i].iov_len);
+        }
+        batch.cv.notify_all();
+
+        // The thread which is currently writing will pick this up in its next
+        // batch. Since async numbers order oneway transactions on the remote
+        // side, it doesn't matter which connection the batch is written to.
+        if (batch.flushing) return OK;
+        batch.flushing = true;
+
+        if (batch.flushDeadline.count() > 0) {
+            (void)batch.cv.wait_for(_l, batch.flushDeadline,
+                                    [&] {
+                                        return batch.full ||
+                                                batch.pending.size() >= batch.maxBytes;
+                                    });
+        }
+        toSend.swap(batch.pending);
+        batch.full = false;
+    }
+
+    while (true) {
+        iovec iov{toSend.data(), toSend.size()};
+        status_t status = rpcSend(connection, session, "oneway batch", &iov, 1, altPoll);
+
+        RpcMutexLockGuard _l(batch.mutex);
+        // On error, the session is already shut down, so drop what is pending.
+        if (status != OK) batch.pending.clear();
+        if (batch.pending.empty()) {
+            batch.flushing = false;
+            return status;
+        }
+        // swap so that both buffers keep their capacity
+        toSend.clear();
+        toSend.swap(batch.pending);
+        batch.full = false;
+    }
+}
+
 status_t RpcState::rpcRec(const sp<RpcSession::RpcConnection>& connection,
                           const sp<RpcSession>& session, const char* what, iovec* iovs, int niovs,
                           std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) {
@@ -546,13 +680,18 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
     uint64_t asyncNumber = 0;
 
     if (address != 0) {
-        RpcMutexUniqueLock _l(mNodeMutex);
-        if (mTerminated) return DEAD_OBJECT; // avoid fatal only, otherwise races
-        auto it = mNodeForAddress.find(address);
-        LOG_ALWAYS_FATAL_IF(it == mNodeForAddress.end(),
-                            "Sending transact on unknown address %" PRIu64, address);
+        if (isTerminated()) return DEAD_OBJECT; // avoid fatal only, otherwise races
 
+        // Synchronous transactions don't need the node, and the caller holds
+        // the sp<> keeping it alive, so only oneway transactions take the lock.
         if (flags & IBinder::FLAG_ONEWAY) {
+            NodeShard& shard = shardFor(address);
+            RpcMutexUniqueLock _l(shard.mutex);
+            if (isTerminated()) return DEAD_OBJECT; // avoid fatal only, otherwise races
+            auto it = shard.nodes.find(address);
+            LOG_ALWAYS_FATAL_IF(it == shard.nodes.end(),
+                                "Sending transact on unknown address %" PRIu64, address);
+
             asyncNumber = it->second.asyncNumber;
             if (!nodeProgressAsyncNumber(&it->second)) {
                 _l.unlock();
@@ -617,9 +756,15 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
 
         return drainCommands(connection, session, CommandType::CONTROL_ONLY);
     };
-    if (status_t status = rpcSend(connection, session, "transaction", iovs, countof(iovs),
-                                  std::ref(altPoll), rpcFields->mFds.get());
-        status != OK) {
+    status_t status;
+    if (flags & IBinder::FLAG_ONEWAY) {
+        status = rpcSendOneway(connection, session, iovs, countof(iovs), std::ref(altPoll),
+                               rpcFields->mFds.get());
+    } else {
+        status = rpcSend(connection, session, "transaction", iovs, countof(iovs),
+                         std::ref(altPoll), rpcFields->mFds.get());
+    }
+    if (status != OK) {
         // rpcSend calls shutdownAndWait, so all refcounts should be reset. If we ever tolerate
         // errors here, then we may need to undo the binder-sent counts for the transaction as
         // well as for the binder objects in the Parcel
@@ -734,10 +879,11 @@ status_t RpcState::sendDecStrongToTarget(const sp<RpcSession::RpcConnection>& co
     };
 
     {
-        RpcMutexUniqueLock _l(mNodeMutex);
-        if (mTerminated) return DEAD_OBJECT; // avoid fatal only, otherwise races
-        auto it = mNodeForAddress.find(addr);
-        LOG_ALWAYS_FATAL_IF(it == mNodeForAddress.end(),
+        NodeShard& shard = shardFor(addr);
+        RpcMutexUniqueLock _l(shard.mutex);
+        if (isTerminated()) return DEAD_OBJECT; // avoid fatal only, otherwise races
+        auto it = shard.nodes.find(addr);
+        LOG_ALWAYS_FATAL_IF(it == shard.nodes.end(),
                             "Sending dec strong on unknown address %" PRIu64, addr);
 
         LOG_ALWAYS_FATAL_IF(it->second.timesRecd < target, "Can't dec count of %zu to %zu.",
@@ -907,9 +1053,10 @@ processTransactInternalTailCall:
             (void)session->shutdownAndWait(false);
             replyStatus = BAD_VALUE;
         } else if (oneway) {
-            RpcMutexUniqueLock _l(mNodeMutex);
-            auto it = mNodeForAddress.find(addr);
-            if (it->second.binder.promote() != target) {
+            NodeShard& shard = shardFor(addr);
+            RpcMutexUniqueLock _l(shard.mutex);
+            auto it = shard.nodes.find(addr);
+            if (it == shard.nodes.end() || it->second.binder.promote() != target) {
                 ALOGE("Binder became invalid during transaction. Bad client? %" PRIu64, addr);
                 replyStatus = BAD_VALUE;
             } else if (transaction->asyncNumber != it->second.asyncNumber) {
@@ -1056,10 +1203,11 @@ processTransactInternalTailCall:
         // downside: asynchronous transactions may drown out synchronous
         // transactions.
         {
-            RpcMutexUniqueLock _l(mNodeMutex);
-            auto it = mNodeForAddress.find(addr);
+            NodeShard& shard = shardFor(addr);
+            RpcMutexUniqueLock _l(shard.mutex);
+            auto it = shard.nodes.find(addr);
             // last refcount dropped after this transaction happened
-            if (it == mNodeForAddress.end()) return OK;
+            if (it == shard.nodes.end()) return OK;
 
             if (!nodeProgressAsyncNumber(&it->second)) {
                 _l.unlock();
@@ -1165,9 +1313,10 @@ status_t RpcState::processDecStrong(const sp<RpcSession::RpcConnection>& connect
         return status;
 
     uint64_t addr = RpcWireAddress::toRaw(body.address);
-    RpcMutexUniqueLock _l(mNodeMutex);
-    auto it = mNodeForAddress.find(addr);
-    if (it == mNodeForAddress.end()) {
+    NodeShard& shard = shardFor(addr);
+    RpcMutexUniqueLock _l(shard.mutex);
+    auto it = shard.nodes.find(addr);
+    if (it == shard.nodes.end()) {
         ALOGE("Unknown binder address %" PRIu64 " for dec strong.", addr);
         return OK;
     }
@@ -1263,9 +1412,12 @@ status_t RpcState::validateParcel(const sp<RpcSession>& session, const Parcel& p
     return OK;
 }
 
-sp<IBinder> RpcState::tryEraseNode(const sp<RpcSession>& session, RpcMutexUniqueLock nodeLock,
-                                   std::map<uint64_t, BinderNode>::iterator& it) {
+sp<IBinder> RpcState::tryEraseNode(const sp<RpcSession>& session, RpcMutexUniqueLock shardLock,
+                                   NodeMap::iterator& it) {
+    bool erased = false;
     bool shouldShutdown = false;
+    uint64_t address = it->first;
+    const IBinder* binder = it->second.binder.unsafe_get();
 
     sp<IBinder> ref;
 
@@ -1275,26 +1427,32 @@ sp<IBinder> RpcState::tryEraseNode(const sp<RpcSession>& session, RpcMutexUnique
         if (it->second.timesRecd == 0) {
             LOG_ALWAYS_FATAL_IF(!it->second.asyncTodo.empty(),
                                 "Can't delete binder w/ pending async transactions");
-            mNodeForAddress.erase(it);
-
-            if (mNodeForAddress.size() == 0) {
-                shouldShutdown = true;
-            }
+            shardFor(address).nodes.erase(it);
+            erased = true;
+            shouldShutdown = releaseNode();
         }
     }
 
-    // If we shutdown, prevent RpcState from being re-used. This prevents another
-    // thread from getting the root object again.
-    if (shouldShutdown) {
-        clear(std::move(nodeLock));
-    } else {
-        nodeLock.unlock(); // explicit
-    }
+    shardLock.unlock(); // explicit
     // LOCK IS RELEASED
 
+    // If we shutdown, prevent RpcState from being re-used. This prevents another
+    // thread from getting the root object again.
     if (shouldShutdown) {
+        clear();
         ALOGI("RpcState has no binders left, so triggering shutdown...");
         (void)session->shutdownAndWait(false);
+    } else if (erased) {
+        bool createdHere = (RpcWireAddress::fromRaw(address).options &
+                            RPC_WIRE_ADDRESS_OPTION_FOR_SERVER) != 0;
+        if (createdHere == (session->server() != nullptr)) {
+            RpcMutexLockGuard _l(mNodeMutex);
+            // the binder may have been sent again at a new address meanwhile
+            if (auto found = mAddressForLocalBinder.find(binder);
+                found != mAddressForLocalBinder.end() && found->second == address) {
+                mAddressForLocalBinder.erase(found);
+            }
+        }
     }
 
     return ref;
@@ -22,9 +22,11 @@
 #include <binder/RpcThreads.h>
 #include <binder/unique_fd.h>
 
-#include <map>
+#include <array>
+#include <atomic>
 #include <optional>
 #include <queue>
+#include <unordered_map>
 
 #include <sys/uio.h>
 
@@ -171,7 +173,6 @@ public:
     void clear();
 
 private:
-    void clear(RpcMutexUniqueLock nodeLock);
     void dumpLocked();
 
     // Alternative to std::vector<uint8_t> that doesn't abort on allocation failure and caps
@@ -194,6 +195,13 @@ private:
             const std::optional<binder::impl::SmallFunction<status_t()>>& altPoll,
             const std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>>* ancillaryFds =
                     nullptr);
+    // Same as rpcSend, but may coalesce the data with other oneway transactions,
+    // see RpcSession::setOnewayBatching.
+    [[nodiscard]] status_t rpcSendOneway(
+            const sp<RpcSession::RpcConnection>& connection, const sp<RpcSession>& session,
+            iovec* iovs, int niovs,
+            const std::optional<binder::impl::SmallFunction<status_t()>>& altPoll,
+            const std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>>* ancillaryFds);
     [[nodiscard]] status_t rpcRec(const sp<RpcSession::RpcConnection>& connection,
                                   const sp<RpcSession>& session, const char* what, iovec* iovs,
                                   int niovs,
@@ -273,10 +281,35 @@ private:
         std::string toString() const;
     };
 
+    using NodeMap = std::unordered_map<uint64_t, BinderNode>;
+
+    // Nodes are spread over shards by address, so that threads working on
+    // different binders don't contend on the same lock.
+    struct NodeShard {
+        RpcMutex mutex;
+        NodeMap nodes;
+    };
+    static constexpr size_t kNumNodeShards = 16;
+    NodeShard& shardFor(uint64_t address);
+
+    // Set in mNodeCount once no more nodes may be added.
+    static constexpr size_t kTerminatedBit = size_t{1} << (sizeof(size_t) * 8 - 1);
+
+    bool isTerminated() const {
+        return mNodeCount.load(std::memory_order_acquire) & kTerminatedBit;
+    }
+    // Must be called with the lock of the shard the node is added to. Returns
+    // false if no nodes may be added anymore.
+    [[nodiscard]] bool reserveNode();
+    // Must be called after erasing a node. Returns true if this was the last
+    // node, in which case no more nodes may be added and the caller must
+    // clear() this and shut down the session.
+    [[nodiscard]] bool releaseNode();
+
     // Checks if there is any reference left to a node and erases it. If this
     // is the last node, shuts down the session.
     //
-    // Node lock is passed here for convenience, so that we can release it
+    // Shard lock is passed here for convenience, so that we can release it
     // and terminate the session, but we could leave it up to the caller
     // by returning a continuation if we needed to erase multiple specific
     // nodes. It may be tempting to allow the client to keep on holding the
@@ -284,18 +317,28 @@ private:
     // this introduces the posssibility that another thread calls
     // getRootBinder and thinks it is valid, rather than immediately getting
     // an error.
-    sp<IBinder> tryEraseNode(const sp<RpcSession>& session, RpcMutexUniqueLock nodeLock,
-                             std::map<uint64_t, BinderNode>::iterator& it);
+    sp<IBinder> tryEraseNode(const sp<RpcSession>& session, RpcMutexUniqueLock shardLock,
+                             NodeMap::iterator& it);
 
     // true - success
     // false - session shutdown, halt
     [[nodiscard]] bool nodeProgressAsyncNumber(BinderNode* node);
 
+    // Guards everything below, and is held while clearing. When taken
+    // together with a shard lock, this must be taken first.
     RpcMutex mNodeMutex;
+    // whether clear() has run
     bool mTerminated = false;
     uint32_t mNextId = 0;
+    // Addresses of the local binders we have sent, so that sending them again
+    // doesn't need to search all nodes. Entries are removed after the node is
+    // erased, so a lookup must check the node still refers to the binder.
+    std::unordered_map<const IBinder*, uint64_t> mAddressForLocalBinder;
+
     // binders known by both sides of a session
-    std::map<uint64_t, BinderNode> mNodeForAddress;
+    std::array<NodeShard, kNumNodeShards> mNodeShards;
+    // number of nodes in all shards, with kTerminatedBit
+    std::atomic<size_t> mNodeCount = 0;
 };
 
 } // namespace android
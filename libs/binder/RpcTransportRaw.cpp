@@ -84,6 +84,7 @@ public:
     }
 
     bool isWaiting() override { return mSocket.isInPollingState(); }
+    borrowed_fd pollFd() override { return mSocket.fd; }
 
 private:
     android::RpcTransportFd mSocket;
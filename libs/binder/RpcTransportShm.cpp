@@ -0,0 +1,598 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RpcShmTransport"
+#include <log/log.h>
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <deque>
+#include <new>
+
+#include <binder/Functional.h>
+#include <binder/RpcTransportShm.h>
+
+#include "FdTrigger.h"
+#include "OS.h"
+#include "RpcState.h"
+#include "RpcTransportUtils.h"
+#include "Utils.h"
+
+namespace android {
+
+using namespace android::binder::impl;
+using android::binder::borrowed_fd;
+using android::binder::unique_fd;
+
+namespace {
+
+constexpr uint32_t kShmMagic = 0x42525348; // "HSRB"
+constexpr uint32_t kShmVersion = 1;
+
+// Size of the data area of each ring. Must be a power of two.
+constexpr size_t kRingSize = 256 * 1024;
+static_assert((kRingSize & (kRingSize - 1)) == 0);
+
+// Bytes sent over the socket.
+constexpr uint8_t kDoorbell = 'D';
+constexpr uint8_t kFdBatch = 'F';
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+// Lives in shared memory. Head and tail are running byte counts, so the
+// amount of data in the ring is always head - tail.
+struct RingControl {
+    alignas(64) std::atomic<uint64_t> head; // written by the producer
+    std::atomic<uint32_t> consumerWaiting;
+    alignas(64) std::atomic<uint64_t> tail; // written by the consumer
+    std::atomic<uint32_t> producerWaiting;
+};
+
+// Ring 0 carries data from the client to the server, and ring 1 carries data
+// from the server to the client.
+struct SharedControl {
+    RingControl rings[2];
+};
+
+constexpr size_t kControlSize = 4096;
+static_assert(sizeof(SharedControl) <= kControlSize);
+constexpr size_t kMappingSize = kControlSize + 2 * kRingSize;
+
+// Sent by the client along with the memfd.
+struct ShmHello {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t ringSize;
+};
+
+// Precedes the data of each interruptableWriteFully in the ring.
+struct RecordHeader {
+    uint32_t size;
+    // if non-zero, a kFdBatch with this many FDs was sent on the socket before
+    // this record was published
+    uint32_t numFds;
+};
+
+struct MappingDeleter {
+    void operator()(void* addr) const { munmap(addr, kMappingSize); }
+};
+using Mapping = std::unique_ptr<void, MappingDeleter>;
+
+} // namespace
+
+// RpcTransport which passes data through shared memory rings. See
+// RpcTransportCtxFactoryShm.
+class RpcTransportShm : public RpcTransport {
+public:
+    RpcTransportShm(android::RpcTransportFd socket, Mapping mapping, bool isServer)
+          : mSocket(std::move(socket)), mMapping(std::move(mapping)) {
+        auto* base = static_cast<uint8_t*>(mMapping.get());
+        auto* control = reinterpret_cast<SharedControl*>(base);
+        uint8_t* clientToServer = base + kControlSize;
+        uint8_t* serverToClient = clientToServer + kRingSize;
+        mTx = &control->rings[isServer ? 1 : 0];
+        mTxData = isServer ? serverToClient : clientToServer;
+        mRx = &control->rings[isServer ? 0 : 1];
+        mRxData = isServer ? clientToServer : serverToClient;
+    }
+
+    status_t pollRead(void) override {
+        if (mRx->head.load(std::memory_order_acquire) != mRxTail) return OK;
+
+        uint8_t buf;
+        ssize_t ret = TEMP_FAILURE_RETRY(
+                ::recv(mSocket.fd.get(), &buf, sizeof(buf), MSG_PEEK | MSG_DONTWAIT));
+        if (ret < 0) {
+            int savedErrno = errno;
+            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+                return WOULD_BLOCK;
+            }
+
+            LOG_RPC_DETAIL("RpcTransport poll(): %s", strerror(savedErrno));
+            return -savedErrno;
+        } else if (ret == 0) {
+            return DEAD_OBJECT;
+        }
+
+        // Only wakeups, or file descriptors for a record which isn't published
+        // yet, are pending.
+        return WOULD_BLOCK;
+    }
+
+    status_t interruptableWriteFully(
+            FdTrigger* fdTrigger, iovec* iovs, int niovs,
+            const std::optional<SmallFunction<status_t()>>& altPoll,
+            const std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) override {
+        MAYBE_WAIT_IN_FLAKE_MODE;
+
+        if (niovs < 0) {
+            return BAD_VALUE;
+        }
+
+        if (fdTrigger->isTriggered()) {
+            return DEAD_OBJECT;
+        }
+
+        size_t size = 0;
+        for (int i = 0; i < niovs; i++) {
+            if (__builtin_add_overflow(size, iovs[i].iov_len, &size)) return BAD_VALUE;
+        }
+        // Same as RpcTransportRaw, nothing is sent for empty writes.
+        if (size == 0) return OK;
+        if (size > UINT32_MAX) return BAD_VALUE;
+
+        RecordHeader record{
+                .size = static_cast<uint32_t>(size),
+                .numFds = 0,
+        };
+
+        if (ancillaryFds != nullptr && !ancillaryFds->empty()) {
+            // The FDs go out before the record is published, so that they are
+            // always on the socket by the time the reader sees the record.
+            uint8_t tag = kFdBatch;
+            iovec tagIov{&tag, sizeof(tag)};
+            bool sentFds = false;
+            auto send = [&](iovec* iovs, int niovs) -> ssize_t {
+                ssize_t ret = binder::os::sendMessageOnSocket(mSocket, iovs, niovs,
+                                                              sentFds ? nullptr : ancillaryFds);
+                sentFds |= ret > 0;
+                return ret;
+            };
+            if (status_t status = interruptableReadOrWrite(mSocket, fdTrigger, &tagIov, 1, send,
+                                                           "sendmsg", POLLOUT, altPoll);
+                status != OK) {
+                return status;
+            }
+            record.numFds = static_cast<uint32_t>(ancillaryFds->size());
+        }
+
+        return produce(fdTrigger, &record, sizeof(record), iovs, niovs, altPoll);
+    }
+
+    status_t interruptableReadFully(
+            FdTrigger* fdTrigger, iovec* iovs, int niovs,
+            const std::optional<SmallFunction<status_t()>>& altPoll,
+            std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) override {
+        MAYBE_WAIT_IN_FLAKE_MODE;
+
+        if (niovs < 0) {
+            return BAD_VALUE;
+        }
+
+        if (fdTrigger->isTriggered()) {
+            return DEAD_OBJECT;
+        }
+
+        for (int i = 0; i < niovs; i++) {
+            auto* dst = static_cast<uint8_t*>(iovs[i].iov_base);
+            size_t len = iovs[i].iov_len;
+            while (len > 0) {
+                if (mRxRecordRemaining == 0) {
+                    if (status_t status = startRecord(fdTrigger, altPoll, ancillaryFds);
+                        status != OK) {
+                        return status;
+                    }
+                }
+                size_t n = std::min(len, mRxRecordRemaining);
+                if (status_t status = consume(fdTrigger, altPoll, dst, n); status != OK) {
+                    return status;
+                }
+                mRxRecordRemaining -= n;
+                dst += n;
+                len -= n;
+            }
+        }
+        return OK;
+    }
+
+    bool isWaiting() override { return mSocket.isInPollingState(); }
+
+private:
+    // Copies the prefix and then the iovecs into the outgoing ring, waiting
+    // for space as needed.
+    status_t produce(FdTrigger* fdTrigger, const void* prefix, size_t prefixLen,
+                     const iovec* iovs, int niovs,
+                     const std::optional<SmallFunction<status_t()>>& altPoll) {
+        // index -1 is the prefix
+        int index = -1;
+        size_t offset = 0;
+        auto current = [&]() -> std::pair<const uint8_t*, size_t> {
+            if (index < 0) return {static_cast<const uint8_t*>(prefix), prefixLen};
+            return {static_cast<const uint8_t*>(iovs[index].iov_base), iovs[index].iov_len};
+        };
+
+        while (index < niovs) {
+            uint64_t tail = mTx->tail.load(std::memory_order_acquire);
+            uint64_t used = mTxHead - tail;
+            if (used > kRingSize) {
+                ALOGE("Invalid tail in shared ring: head %" PRIu64 " tail %" PRIu64, mTxHead,
+                      tail);
+                return DEAD_OBJECT;
+            }
+
+            if (used == kRingSize) {
+                auto hasSpace = [&] { return mTx->tail.load(std::memory_order_acquire) != tail; };
+                if (status_t status = waitForPeer(fdTrigger, mTx->producerWaiting, hasSpace,
+                                                  altPoll);
+                    status != OK) {
+                    return status;
+                }
+                continue;
+            }
+
+            // Copy as much as fits, so that the consumer is only told once.
+            size_t space = kRingSize - used;
+            uint64_t head = mTxHead;
+            while (space > 0 && index < niovs) {
+                auto [base, len] = current();
+                size_t n = std::min(space, len - offset);
+                copyToRing(head, base + offset, n);
+                head += n;
+                space -= n;
+                offset += n;
+                if (offset == len) {
+                    index++;
+                    offset = 0;
+                }
+            }
+            publishHead(head);
+        }
+        return OK;
+    }
+
+    void copyToRing(uint64_t position, const uint8_t* src, size_t n) {
+        size_t start = position & (kRingSize - 1);
+        size_t first = std::min(n, kRingSize - start);
+        memcpy(mTxData + start, src, first);
+        memcpy(mTxData, src + first, n - first);
+    }
+
+    void publishHead(uint64_t head) {
+        mTxHead = head;
+        mTx->head.store(head, std::memory_order_release);
+        // pairs with the fence in waitForPeer
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mTx->consumerWaiting.load(std::memory_order_relaxed)) ringDoorbell();
+    }
+
+    // Copies exactly |len| bytes out of the incoming ring, waiting for data
+    // as needed.
+    status_t consume(FdTrigger* fdTrigger,
+                     const std::optional<SmallFunction<status_t()>>& altPoll, uint8_t* dst,
+                     size_t len) {
+        while (len > 0) {
+            uint64_t head = mRx->head.load(std::memory_order_acquire);
+            uint64_t avail = head - mRxTail;
+            if (avail > kRingSize) {
+                ALOGE("Invalid head in shared ring: head %" PRIu64 " tail %" PRIu64, head,
+                      mRxTail);
+                return DEAD_OBJECT;
+            }
+
+            if (avail == 0) {
+                auto hasData = [&] { return mRx->head.load(std::memory_order_acquire) != head; };
+                if (status_t status =
+                            waitForPeer(fdTrigger, mRx->consumerWaiting, hasData, altPoll);
+                    status != OK) {
+                    return status;
+                }
+                continue;
+            }
+
+            size_t n = std::min<uint64_t>(len, avail);
+            size_t start = mRxTail & (kRingSize - 1);
+            size_t first = std::min(n, kRingSize - start);
+            memcpy(dst, mRxData + start, first);
+            memcpy(dst + first, mRxData, n - first);
+            dst += n;
+            len -= n;
+
+            mRxTail += n;
+            mRx->tail.store(mRxTail, std::memory_order_release);
+            // pairs with the fence in waitForPeer
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (mRx->producerWaiting.load(std::memory_order_relaxed)) ringDoorbell();
+        }
+        return OK;
+    }
+
+    status_t startRecord(FdTrigger* fdTrigger,
+                         const std::optional<SmallFunction<status_t()>>& altPoll,
+                         std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) {
+        RecordHeader record;
+        if (status_t status =
+                    consume(fdTrigger, altPoll, reinterpret_cast<uint8_t*>(&record),
+                            sizeof(record));
+            status != OK) {
+            return status;
+        }
+        if (record.size == 0) {
+            ALOGE("Empty record in shared ring");
+            return BAD_VALUE;
+        }
+
+        if (record.numFds > 0) {
+            if (ancillaryFds == nullptr) {
+                ALOGE("Received %" PRIu32 " FDs, but not expecting any", record.numFds);
+                return BAD_VALUE;
+            }
+            while (mRxFdBatches.empty()) {
+                if (status_t status = fdTrigger->triggerablePoll(mSocket, POLLIN); status != OK) {
+                    return status;
+                }
+                if (status_t status = drainSocket(); status != OK) return status;
+            }
+            std::vector<unique_fd> batch = std::move(mRxFdBatches.front());
+            mRxFdBatches.pop_front();
+            if (batch.size() != record.numFds) {
+                ALOGE("Expecting %" PRIu32 " FDs for record, but received %zu", record.numFds,
+                      batch.size());
+                return BAD_VALUE;
+            }
+            ancillaryFds->reserve(ancillaryFds->size() + batch.size());
+            for (auto& fd : batch) ancillaryFds->emplace_back(std::move(fd));
+        }
+
+        mRxRecordRemaining = record.size;
+        return OK;
+    }
+
+    // Blocks until |ready| returns true, or the other side rings the doorbell.
+    // Spurious wakeups are allowed.
+    template <typename Ready>
+    status_t waitForPeer(FdTrigger* fdTrigger, std::atomic<uint32_t>& waitingFlag, Ready ready,
+                         const std::optional<SmallFunction<status_t()>>& altPoll) {
+        if (altPoll) {
+            if (status_t status = (*altPoll)(); status != OK) return status;
+            if (fdTrigger->isTriggered()) {
+                return DEAD_OBJECT;
+            }
+            return OK;
+        }
+
+        waitingFlag.store(1, std::memory_order_relaxed);
+        // pairs with the fences after publishing head or tail
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto clearWaiting = make_scope_guard(
+                [&]() { waitingFlag.store(0, std::memory_order_relaxed); });
+        if (ready()) return OK;
+
+        if (status_t status = fdTrigger->triggerablePoll(mSocket, POLLIN); status != OK) {
+            return status;
+        }
+        return drainSocket();
+    }
+
+    // Reads pending doorbells and FD batches from the socket.
+    status_t drainSocket() {
+        uint8_t buf[64];
+        iovec iov{buf, sizeof(buf)};
+        std::vector<std::variant<unique_fd, borrowed_fd>> fds;
+        ssize_t ret = binder::os::receiveMessageFromSocket(mSocket, &iov, 1, &fds);
+        if (ret < 0) {
+            int savedErrno = errno;
+            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) return OK;
+            LOG_RPC_DETAIL("RpcTransport recvmsg(): %s", strerror(savedErrno));
+            return -savedErrno;
+        }
+        if (ret == 0) return DEAD_OBJECT;
+
+        // A single recvmsg never returns data past the first message with
+        // FDs, so at most one batch can be read here.
+        size_t numBatches = 0;
+        for (ssize_t i = 0; i < ret; i++) {
+            if (buf[i] == kFdBatch) {
+                numBatches++;
+            } else if (buf[i] != kDoorbell) {
+                ALOGE("Unexpected byte %" PRIu8 " on shared memory transport socket", buf[i]);
+                return BAD_VALUE;
+            }
+        }
+        if (numBatches > 1 || (numBatches == 0 && !fds.empty()) ||
+            (numBatches == 1 && fds.empty())) {
+            ALOGE("Received %zu FDs with %zu FD batches", fds.size(), numBatches);
+            return BAD_VALUE;
+        }
+        if (numBatches == 1) {
+            std::vector<unique_fd> batch;
+            batch.reserve(fds.size());
+            for (auto& fd : fds) {
+                batch.push_back(std::move(std::get<unique_fd>(fd)));
+            }
+            mRxFdBatches.push_back(std::move(batch));
+        }
+        return OK;
+    }
+
+    void ringDoorbell() {
+        // If the socket is full, the other side already has doorbells to read.
+        // If the other side is gone, that is noticed when waiting next.
+        uint8_t doorbell = kDoorbell;
+        (void)TEMP_FAILURE_RETRY(::send(mSocket.fd.get(), &doorbell, sizeof(doorbell),
+                                        MSG_NOSIGNAL | MSG_DONTWAIT));
+    }
+
+    android::RpcTransportFd mSocket;
+    Mapping mMapping;
+
+    RingControl* mTx;
+    uint8_t* mTxData;
+    // only written by this side, so this is a private copy
+    uint64_t mTxHead = 0;
+
+    RingControl* mRx;
+    uint8_t* mRxData;
+    // only written by this side, so this is a private copy
+    uint64_t mRxTail = 0;
+    size_t mRxRecordRemaining = 0;
+    std::deque<std::vector<unique_fd>> mRxFdBatches;
+};
+
+// RpcTransportCtx which sets up shared memory rings for each connection.
+class RpcTransportCtxShm : public RpcTransportCtx {
+public:
+    explicit RpcTransportCtxShm(bool isServer) : mIsServer(isServer) {}
+
+    std::unique_ptr<RpcTransport> newTransport(android::RpcTransportFd socket,
+                                               FdTrigger* fdTrigger) const override {
+        Mapping mapping = mIsServer ? acceptRings(socket, fdTrigger)
+                                    : offerRings(socket, fdTrigger);
+        if (mapping == nullptr) return nullptr;
+        return std::make_unique<RpcTransportShm>(std::move(socket), std::move(mapping),
+                                                 mIsServer);
+    }
+    std::vector<uint8_t> getCertificate(RpcCertificateFormat) const override { return {}; }
+
+private:
+    static Mapping mapRings(borrowed_fd fd) {
+        void* addr = mmap(nullptr, kMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+        if (addr == MAP_FAILED) {
+            ALOGE("Could not map shared rings: %s", strerror(errno));
+            return nullptr;
+        }
+        return Mapping(addr);
+    }
+
+    static Mapping offerRings(const android::RpcTransportFd& socket, FdTrigger* fdTrigger) {
+        unique_fd memfd(memfd_create("binder_rpc_shm", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+        if (!memfd.ok()) {
+            ALOGE("Could not create memfd: %s", strerror(errno));
+            return nullptr;
+        }
+        TEST_AND_RETURN(nullptr, 0 == TEMP_FAILURE_RETRY(ftruncate(memfd.get(), kMappingSize)));
+        TEST_AND_RETURN(nullptr,
+                        0 == fcntl(memfd.get(), F_ADD_SEALS,
+                                   F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL));
+
+        Mapping mapping = mapRings(memfd);
+        if (mapping == nullptr) return nullptr;
+        new (mapping.get()) SharedControl();
+
+        ShmHello hello{
+                .magic = kShmMagic,
+                .version = kShmVersion,
+                .ringSize = kRingSize,
+        };
+        iovec iov{&hello, sizeof(hello)};
+        std::vector<std::variant<unique_fd, borrowed_fd>> fds;
+        fds.emplace_back(borrowed_fd(memfd));
+        bool sentFds = false;
+        auto send = [&](iovec* iovs, int niovs) -> ssize_t {
+            ssize_t ret =
+                    binder::os::sendMessageOnSocket(socket, iovs, niovs, sentFds ? nullptr : &fds);
+            sentFds |= ret > 0;
+            return ret;
+        };
+        if (status_t status = interruptableReadOrWrite(socket, fdTrigger, &iov, 1, send, "sendmsg",
+                                                       POLLOUT, std::nullopt);
+            status != OK) {
+            ALOGE("Could not send shared rings: %s", statusToString(status).c_str());
+            return nullptr;
+        }
+        return mapping;
+    }
+
+    static Mapping acceptRings(const android::RpcTransportFd& socket, FdTrigger* fdTrigger) {
+        ShmHello hello;
+        iovec iov{&hello, sizeof(hello)};
+        std::vector<std::variant<unique_fd, borrowed_fd>> fds;
+        auto recv = [&](iovec* iovs, int niovs) -> ssize_t {
+            return binder::os::receiveMessageFromSocket(socket, iovs, niovs, &fds);
+        };
+        if (status_t status = interruptableReadOrWrite(socket, fdTrigger, &iov, 1, recv, "recvmsg",
+                                                       POLLIN, std::nullopt);
+            status != OK) {
+            ALOGE("Could not receive shared rings: %s", statusToString(status).c_str());
+            return nullptr;
+        }
+
+        if (hello.magic != kShmMagic || hello.version != kShmVersion ||
+            hello.ringSize != kRingSize) {
+            ALOGE("Unsupported shared rings: magic %" PRIx32 " version %" PRIu32
+                  " ring size %" PRIu64,
+                  hello.magic, hello.version, hello.ringSize);
+            return nullptr;
+        }
+        if (fds.size() != 1) {
+            ALOGE("Expecting exactly one memfd, but received %zu FDs", fds.size());
+            return nullptr;
+        }
+        const unique_fd& memfd = std::get<unique_fd>(fds[0]);
+
+        // The client must not be able to shrink the memory under us.
+        int seals = fcntl(memfd.get(), F_GET_SEALS);
+        if (seals < 0 || (seals & (F_SEAL_SHRINK | F_SEAL_GROW)) != (F_SEAL_SHRINK | F_SEAL_GROW)) {
+            ALOGE("Shared rings are not sealed: %d", seals);
+            return nullptr;
+        }
+        struct stat st;
+        if (fstat(memfd.get(), &st) != 0 || static_cast<size_t>(st.st_size) != kMappingSize) {
+            ALOGE("Shared rings have an unexpected size");
+            return nullptr;
+        }
+        return mapRings(memfd);
+    }
+
+    const bool mIsServer;
+};
+
+std::unique_ptr<RpcTransportCtx> RpcTransportCtxFactoryShm::newServerCtx() const {
+    return std::make_unique<RpcTransportCtxShm>(true);
+}
+
+std::unique_ptr<RpcTransportCtx> RpcTransportCtxFactoryShm::newClientCtx() const {
+    return std::make_unique<RpcTransportCtxShm>(false);
+}
+
+const char* RpcTransportCtxFactoryShm::toCString() const {
+    return "shm";
+}
+
+std::unique_ptr<RpcTransportCtxFactory> RpcTransportCtxFactoryShm::make() {
+    return std::unique_ptr<RpcTransportCtxFactoryShm>(new RpcTransportCtxFactoryShm());
+}
+
+} // namespace android
@@ -17,17 +17,25 @@
 #define LOG_TAG "RpcTransportTls"
 #include <log/log.h>
 
+#include <linux/tls.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <poll.h>
 #include <sys/socket.h>
 
 #include <openssl/bn.h>
+#include <openssl/hkdf.h>
+#include <openssl/mem.h>
 #include <openssl/ssl.h>
 
 #include <binder/RpcTlsUtils.h>
 #include <binder/RpcTransportTls.h>
 
 #include "FdTrigger.h"
+#include "OS.h"
+#include "RpcKernelTls.h"
 #include "RpcState.h"
+#include "RpcTransportUtils.h"
 #include "Utils.h"
 
 #include <sstream>
@@ -46,6 +54,25 @@ using namespace android::binder::impl;
 using android::binder::borrowed_fd;
 using android::binder::unique_fd;
 
+// HKDF-Expand-Label from RFC 8446, with an empty context.
+bool hkdfExpandLabel(uint8_t* out, size_t outLen, const EVP_MD* digest,
+                     bssl::Span<const uint8_t> secret, std::string_view label) {
+    constexpr std::string_view kPrefix = "tls13 ";
+    uint8_t info[2 + 1 + 255 + 1];
+    size_t labelLen = kPrefix.size() + label.size();
+    LOG_ALWAYS_FATAL_IF(labelLen > 255 || outLen > 0xffff);
+    size_t infoLen = 0;
+    info[infoLen++] = static_cast<uint8_t>(outLen >> 8);
+    info[infoLen++] = static_cast<uint8_t>(outLen);
+    info[infoLen++] = static_cast<uint8_t>(labelLen);
+    memcpy(info + infoLen, kPrefix.data(), kPrefix.size());
+    infoLen += kPrefix.size();
+    memcpy(info + infoLen, label.data(), label.size());
+    infoLen += label.size();
+    info[infoLen++] = 0; // context length
+    return HKDF_expand(out, outLen, digest, secret.data(), secret.size(), info, infoLen);
+}
+
 namespace {
 
 // Implement BIO for socket that ignores SIGPIPE.
@@ -282,12 +309,104 @@ private:
     bssl::UniquePtr<SSL> mSsl;
 };
 
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
+// Which directions of a connection are handled by kernel TLS.
+struct KernelTlsState {
+    bool tx = false;
+    bool rx = false;
+};
+
+// Derives the record key and IV for one direction from its traffic secret,
+// and installs them into the kernel.
+template <typename CryptoInfo>
+bool setKernelTlsKey(borrowed_fd fd, int direction, uint16_t cipherType, const EVP_MD* digest,
+                     bssl::Span<const uint8_t> secret, uint64_t sequence) {
+    CryptoInfo info;
+    bool derived = makeKernelTlsCryptoInfo(&info, cipherType, digest, secret, sequence);
+    bool ok = derived && 0 == setsockopt(fd.get(), SOL_TLS, direction, &info, sizeof(info));
+    if (derived && !ok) {
+        LOG_TLS_DETAIL("setsockopt(SOL_TLS, %d): %s", direction, strerror(errno));
+    }
+    OPENSSL_cleanse(&info, sizeof(info));
+    return ok;
+}
+
+bool setKernelTlsKey(borrowed_fd fd, int direction, uint16_t cipherId,
+                     bssl::Span<const uint8_t> secret, uint64_t sequence) {
+    switch (cipherId) {
+        case 0x1301: // TLS_AES_128_GCM_SHA256
+            return setKernelTlsKey<tls12_crypto_info_aes_gcm_128>(fd, direction,
+                                                                  TLS_CIPHER_AES_GCM_128,
+                                                                  EVP_sha256(), secret, sequence);
+        case 0x1302: // TLS_AES_256_GCM_SHA384
+            return setKernelTlsKey<tls12_crypto_info_aes_gcm_256>(fd, direction,
+                                                                  TLS_CIPHER_AES_GCM_256,
+                                                                  EVP_sha384(), secret, sequence);
+        case 0x1303: // TLS_CHACHA20_POLY1305_SHA256
+            return setKernelTlsKey<tls12_crypto_info_chacha20_poly1305>(
+                    fd, direction, TLS_CIPHER_CHACHA20_POLY1305, EVP_sha256(), secret, sequence);
+        default:
+            LOG_TLS_DETAIL("kTLS: unsupported cipher 0x%04x", cipherId);
+            return false;
+    }
+}
+
+// Moves record handling for a connection which finished its handshake into
+// the kernel. Either direction may fail independently, and is then left to
+// BoringSSL. Afterwards, BoringSSL must not be used for directions which
+// moved.
+KernelTlsState enableKernelTls(Ssl* ssl, const android::RpcTransportFd& socket, bool offloadRx) {
+    KernelTlsState state;
+
+    auto [cipher, cipherErrorQueue] = ssl->call(SSL_get_current_cipher);
+    cipherErrorQueue.clear();
+    if (cipher == nullptr) return state;
+    uint16_t cipherId = SSL_CIPHER_get_protocol_id(cipher);
+
+    bssl::Span<const uint8_t> readSecret, writeSecret;
+    auto [haveSecrets, secretsErrorQueue] =
+            ssl->call(bssl::SSL_get_traffic_secrets, &readSecret, &writeSecret);
+    secretsErrorQueue.clear();
+    if (!haveSecrets) return state;
+
+    // Any data BoringSSL has already read would be lost to the kernel.
+    auto [pending, pendingErrorQueue] = ssl->call(SSL_has_pending);
+    pendingErrorQueue.clear();
+    if (pending) offloadRx = false;
+
+    if (0 != setsockopt(socket.fd.get(), SOL_TCP, TCP_ULP, "tls", sizeof("tls"))) {
+        // Typically, the socket is not TCP (e.g. unix or vsock), or the kernel
+        // doesn't have kTLS.
+        LOG_TLS_DETAIL("kTLS: setsockopt(TCP_ULP): %s", strerror(errno));
+        return state;
+    }
+
+    auto [writeSequence, writeErrorQueue] = ssl->call(SSL_get_write_sequence);
+    writeErrorQueue.clear();
+    state.tx = setKernelTlsKey(socket.fd, TLS_TX, cipherId, writeSecret, writeSequence);
+
+    if (offloadRx) {
+        auto [readSequence, readErrorQueue] = ssl->call(SSL_get_read_sequence);
+        readErrorQueue.clear();
+        state.rx = setKernelTlsKey(socket.fd, TLS_RX, cipherId, readSecret, readSequence);
+    }
+
+    LOG_TLS_DETAIL("kTLS: tx %d rx %d for cipher 0x%04x", state.tx, state.rx, cipherId);
+    return state;
+}
+
 } // namespace
 
 class RpcTransportTls : public RpcTransport {
 public:
-    RpcTransportTls(RpcTransportFd socket, Ssl ssl)
-          : mSocket(std::move(socket)), mSsl(std::move(ssl)) {}
+    RpcTransportTls(RpcTransportFd socket, Ssl ssl, KernelTlsState kernelTls)
+          : mSocket(std::move(socket)), mSsl(std::move(ssl)), mKernelTls(kernelTls) {}
     status_t pollRead(void) override;
     status_t interruptableWriteFully(
             FdTrigger* fdTrigger, iovec* iovs, int niovs,
@@ -299,14 +418,34 @@ public:
             std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) override;
 
     bool isWaiting() override { return mSocket.isInPollingState(); };
+    borrowed_fd pollFd() override { return mSocket.fd; }
 
 private:
     android::RpcTransportFd mSocket;
     Ssl mSsl;
+    // Directions which the kernel encrypts, and where mSsl must not be used.
+    KernelTlsState mKernelTls;
 };
 
 // Error code is errno.
 status_t RpcTransportTls::pollRead(void) {
+    if (mKernelTls.rx) {
+        uint8_t buf;
+        ssize_t ret = TEMP_FAILURE_RETRY(
+                ::recv(mSocket.fd.get(), &buf, sizeof(buf), MSG_PEEK | MSG_DONTWAIT));
+        if (ret < 0) {
+            int savedErrno = errno;
+            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+                return WOULD_BLOCK;
+            }
+            LOG_TLS_DETAIL("kTLS: poll(): %s", strerror(savedErrno));
+            return -savedErrno;
+        } else if (ret == 0) {
+            return DEAD_OBJECT;
+        }
+        return OK;
+    }
+
     uint8_t buf;
     auto [ret, errorQueue] = mSsl.call(SSL_peek, &buf, sizeof(buf));
     if (ret < 0) {
@@ -330,6 +469,16 @@ status_t RpcTransportTls::interruptableWriteFully(
         const std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) {
     (void)ancillaryFds;
 
+    if (mKernelTls.tx) {
+        // The kernel encrypts, so this is the same as RpcTransportRaw
+        // (without file descriptors).
+        auto send = [&](iovec* iovs, int niovs) -> ssize_t {
+            return binder::os::sendMessageOnSocket(mSocket, iovs, niovs, nullptr);
+        };
+        return interruptableReadOrWrite(mSocket, fdTrigger, iovs, niovs, send, "sendmsg", POLLOUT,
+                                        altPoll);
+    }
+
     MAYBE_WAIT_IN_FLAKE_MODE;
 
     if (niovs < 0) return BAD_VALUE;
@@ -376,6 +525,17 @@ status_t RpcTransportTls::interruptableReadFully(
         std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) {
     (void)ancillaryFds;
 
+    if (mKernelTls.rx) {
+        // The kernel decrypts, so this is the same as RpcTransportRaw
+        // (without file descriptors). Non-data records (e.g. alerts) fail
+        // recvmsg with EIO, which ends the session.
+        auto recv = [&](iovec* iovs, int niovs) -> ssize_t {
+            return binder::os::receiveMessageFromSocket(mSocket, iovs, niovs, nullptr);
+        };
+        return interruptableReadOrWrite(mSocket, fdTrigger, iovs, niovs, recv, "recvmsg", POLLIN,
+                                        altPoll);
+    }
+
     MAYBE_WAIT_IN_FLAKE_MODE;
 
     if (niovs < 0) return BAD_VALUE;
@@ -452,7 +612,8 @@ public:
     template <typename Impl,
               typename = std::enable_if_t<std::is_base_of_v<RpcTransportCtxTls, Impl>>>
     static std::unique_ptr<RpcTransportCtxTls> create(
-            std::shared_ptr<RpcCertificateVerifier> verifier, RpcAuth* auth);
+            std::shared_ptr<RpcCertificateVerifier> verifier, RpcAuth* auth,
+            RpcTransportCtxFactoryTls::Options options);
     std::unique_ptr<RpcTransport> newTransport(RpcTransportFd fd,
                                                FdTrigger* fdTrigger) const override;
     std::vector<uint8_t> getCertificate(RpcCertificateFormat) const override;
@@ -460,8 +621,10 @@ public:
 protected:
     static ssl_verify_result_t sslCustomVerify(SSL* ssl, uint8_t* outAlert);
     virtual void preHandshake(Ssl* ssl) const = 0;
+    virtual bool isServer() const = 0;
     bssl::UniquePtr<SSL_CTX> mCtx;
     std::shared_ptr<RpcCertificateVerifier> mCertVerifier;
+    bool mKernelTls = false;
 };
 
 std::vector<uint8_t> RpcTransportCtxTls::getCertificate(RpcCertificateFormat format) const {
@@ -494,7 +657,8 @@ ssl_verify_result_t RpcTransportCtxTls::sslCustomVerify(SSL* ssl, uint8_t* outAl
 // provided as a template argument so that this function can initialize an |Impl| object.
 template <typename Impl, typename>
 std::unique_ptr<RpcTransportCtxTls> RpcTransportCtxTls::create(
-        std::shared_ptr<RpcCertificateVerifier> verifier, RpcAuth* auth) {
+        std::shared_ptr<RpcCertificateVerifier> verifier, RpcAuth* auth,
+        RpcTransportCtxFactoryTls::Options options) {
     bssl::UniquePtr<SSL_CTX> ctx(SSL_CTX_new(TLS_method()));
     TEST_AND_RETURN(nullptr, ctx != nullptr);
 
@@ -517,10 +681,16 @@ std::unique_ptr<RpcTransportCtxTls> RpcTransportCtxTls::create(
     }
 
     auto ret = std::make_unique<Impl>();
+    // Session tickets are never used, and once the client decrypts in the kernel,
+    // they would arrive as records it can't handle.
+    if (options.kernelTls && static_cast<RpcTransportCtxTls*>(ret.get())->isServer()) {
+        TEST_AND_RETURN(nullptr, SSL_CTX_set_num_tickets(ctx.get(), 0));
+    }
     // RpcTransportCtxTls* -> void*
     TEST_AND_RETURN(nullptr, SSL_CTX_set_app_data(ctx.get(), reinterpret_cast<void*>(ret.get())));
     ret->mCtx = std::move(ctx);
     ret->mCertVerifier = std::move(verifier);
+    ret->mKernelTls = options.kernelTls;
     return ret;
 }
 
@@ -532,7 +702,14 @@ std::unique_ptr<RpcTransport> RpcTransportCtxTls::newTransport(android::RpcTrans
 
     preHandshake(&wrapped);
     TEST_AND_RETURN(nullptr, setFdAndDoHandshake(&wrapped, socket, fdTrigger));
-    return std::make_unique<RpcTransportTls>(std::move(socket), std::move(wrapped));
+
+    KernelTlsState kernelTls;
+    if (mKernelTls) {
+        // Clients may still get post-handshake messages from servers without
+        // kernel TLS, which only BoringSSL can process.
+        kernelTls = enableKernelTls(&wrapped, socket, isServer() /*offloadRx*/);
+    }
+    return std::make_unique<RpcTransportTls>(std::move(socket), std::move(wrapped), kernelTls);
 }
 
 class RpcTransportCtxTlsServer : public RpcTransportCtxTls {
@@ -540,6 +717,7 @@ protected:
     void preHandshake(Ssl* ssl) const override {
         ssl->call(SSL_set_accept_state).errorQueue.clear();
     }
+    bool isServer() const override { return true; }
 };
 
 class RpcTransportCtxTlsClient : public RpcTransportCtxTls {
@@ -547,16 +725,17 @@ protected:
     void preHandshake(Ssl* ssl) const override {
         ssl->call(SSL_set_connect_state).errorQueue.clear();
     }
+    bool isServer() const override { return false; }
 };
 
 std::unique_ptr<RpcTransportCtx> RpcTransportCtxFactoryTls::newServerCtx() const {
     return android::RpcTransportCtxTls::create<RpcTransportCtxTlsServer>(mCertVerifier,
-                                                                         mAuth.get());
+                                                                         mAuth.get(), mOptions);
 }
 
 std::unique_ptr<RpcTransportCtx> RpcTransportCtxFactoryTls::newClientCtx() const {
     return android::RpcTransportCtxTls::create<RpcTransportCtxTlsClient>(mCertVerifier,
-                                                                         mAuth.get());
+                                                                         mAuth.get(), mOptions);
 }
 
 const char* RpcTransportCtxFactoryTls::toCString() const {
@@ -565,6 +744,12 @@ const char* RpcTransportCtxFactoryTls::toCString() const {
 
 std::unique_ptr<RpcTransportCtxFactory> RpcTransportCtxFactoryTls::make(
         std::shared_ptr<RpcCertificateVerifier> verifier, std::unique_ptr<RpcAuth> auth) {
+    return make(std::move(verifier), std::move(auth), Options{});
+}
+
+std::unique_ptr<RpcTransportCtxFactory> RpcTransportCtxFactoryTls::make(
+        std::shared_ptr<RpcCertificateVerifier> verifier, std::unique_ptr<RpcAuth> auth,
+        Options options) {
     if (verifier == nullptr) {
         ALOGE("%s: Must provide a certificate verifier", __PRETTY_FUNCTION__);
         return nullptr;
@@ -574,7 +759,7 @@ std::unique_ptr<RpcTransportCtxFactory> RpcTransportCtxFactoryTls::make(
         return nullptr;
     }
     return std::unique_ptr<RpcTransportCtxFactoryTls>(
-            new RpcTransportCtxFactoryTls(std::move(verifier), std::move(auth)));
+            new RpcTransportCtxFactoryTls(std::move(verifier), std::move(auth), options));
 }
 
 } // namespace android
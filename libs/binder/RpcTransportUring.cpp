@@ -0,0 +1,393 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RpcUringTransport"
+#include <log/log.h>
+
+#include <inttypes.h>
+#include <liburing.h>
+#include <poll.h>
+#include <stddef.h>
+#include <sys/socket.h>
+
+#include <binder/Functional.h>
+#include <binder/RpcTransportUring.h>
+
+#include "FdTrigger.h"
+#include "OS.h"
+#include "RpcState.h"
+#include "RpcTransportUtils.h"
+#include "Utils.h"
+
+namespace android {
+
+using namespace android::binder::impl;
+using android::binder::borrowed_fd;
+using android::binder::unique_fd;
+
+namespace {
+
+// Enough for the trigger poll, a linked socket poll and transfer, and a cancel.
+constexpr unsigned kRingEntries = 4;
+
+// Indices of the files registered with each ring.
+constexpr int kSocketIndex = 0;
+constexpr int kTriggerIndex = 1;
+
+// user_data of the requests submitted to each ring.
+enum : uint64_t {
+    kTagTrigger = 1,
+    kTagSocketPoll = 2,
+    kTagTransfer = 3,
+    kTagCancel = 4,
+};
+
+} // namespace
+
+// RpcTransport with TLS disabled, which waits on the socket through io_uring.
+//
+// Reads and writes are first tried directly on the (non-blocking) socket, in
+// the same way as RpcTransportRaw. Only when that would block, a poll on the
+// socket is submitted together with a linked sendmsg/recvmsg, so that waiting
+// and transferring the data takes a single system call, rather than a poll
+// followed by another sendmsg/recvmsg. A poll on the FdTrigger is kept armed
+// on the ring for the lifetime of the transport, so that shutdown still
+// interrupts any wait.
+class RpcTransportUring : public RpcTransport {
+public:
+    RpcTransportUring(android::RpcTransportFd socket, FdTrigger* fdTrigger)
+          : mSocket(std::move(socket)) {
+        mRingReady = initRing(fdTrigger);
+    }
+    ~RpcTransportUring() {
+        if (mRingReady) io_uring_queue_exit(&mRing);
+    }
+
+    status_t pollRead(void) override {
+        uint8_t buf;
+        ssize_t ret = TEMP_FAILURE_RETRY(
+                ::recv(mSocket.fd.get(), &buf, sizeof(buf), MSG_PEEK | MSG_DONTWAIT));
+        if (ret < 0) {
+            int savedErrno = errno;
+            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+                return WOULD_BLOCK;
+            }
+
+            LOG_RPC_DETAIL("RpcTransport poll(): %s", strerror(savedErrno));
+            return -savedErrno;
+        } else if (ret == 0) {
+            return DEAD_OBJECT;
+        }
+
+        return OK;
+    }
+
+    status_t interruptableWriteFully(
+            FdTrigger* fdTrigger, iovec* iovs, int niovs,
+            const std::optional<SmallFunction<status_t()>>& altPoll,
+            const std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) override {
+        bool sentFds = false;
+        auto send = [&](iovec* iovs, int niovs) -> ssize_t {
+            ssize_t ret = binder::os::sendMessageOnSocket(mSocket, iovs, niovs,
+                                                          sentFds ? nullptr : ancillaryFds);
+            sentFds |= ret > 0;
+            return ret;
+        };
+        // File descriptors are only ever sent with a direct sendmsg.
+        auto canLink = [&] { return sentFds || ancillaryFds == nullptr || ancillaryFds->empty(); };
+        auto onLinked = [&](ssize_t ret) { sentFds |= ret > 0; };
+        return readOrWrite(fdTrigger, iovs, niovs, send, canLink, onLinked, "sendmsg", POLLOUT,
+                           altPoll);
+    }
+
+    status_t interruptableReadFully(
+            FdTrigger* fdTrigger, iovec* iovs, int niovs,
+            const std::optional<SmallFunction<status_t()>>& altPoll,
+            std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) override {
+        auto recv = [&](iovec* iovs, int niovs) -> ssize_t {
+            return binder::os::receiveMessageFromSocket(mSocket, iovs, niovs, ancillaryFds);
+        };
+        // File descriptors are only ever received with a direct recvmsg.
+        auto canLink = [&] { return ancillaryFds == nullptr; };
+        auto onLinked = [](ssize_t) {};
+        return readOrWrite(fdTrigger, iovs, niovs, recv, canLink, onLinked, "recvmsg", POLLIN,
+                           altPoll);
+    }
+
+    bool isWaiting() override { return mSocket.isInPollingState(); }
+    borrowed_fd pollFd() override { return mSocket.fd; }
+
+private:
+    bool initRing(FdTrigger* fdTrigger) {
+        if (fdTrigger == nullptr) return false;
+
+        if (int ret = io_uring_queue_init(kRingEntries, &mRing, 0); ret < 0) {
+            ALOGW("io_uring unavailable, falling back to poll: %s", strerror(-ret));
+            return false;
+        }
+
+        int files[] = {mSocket.fd.get(), fdTrigger->readFd().get()};
+        if (int ret = io_uring_register_files(&mRing, files, countof(files)); ret < 0) {
+            ALOGW("Could not register files with io_uring, falling back to poll: %s",
+                  strerror(-ret));
+            io_uring_queue_exit(&mRing);
+            return false;
+        }
+
+        // The trigger can only fire once, so this poll never needs to be
+        // re-armed. It is submitted along with the first wait.
+        io_uring_sqe* sqe = io_uring_get_sqe(&mRing);
+        io_uring_prep_poll_add(sqe, kTriggerIndex, POLLIN);
+        sqe->flags |= IOSQE_FIXED_FILE;
+        sqe->user_data = kTagTrigger;
+
+        mTrigger = fdTrigger;
+        return true;
+    }
+
+    // Waits until the socket has |event|, or until the trigger fires. If
+    // |msg| is not null, |msg| is sent or received as soon as the socket is
+    // ready, as part of the same wait, and the result of that (bytes or
+    // -errno) is returned in |transferResult|.
+    status_t waitForSocket(int16_t event, msghdr* msg, ssize_t* transferResult) {
+        io_uring_sqe* sqe = io_uring_get_sqe(&mRing);
+        LOG_ALWAYS_FATAL_IF(sqe == nullptr, "io_uring submission queue full");
+        io_uring_prep_poll_add(sqe, kSocketIndex, event);
+        sqe->flags |= IOSQE_FIXED_FILE;
+        sqe->user_data = kTagSocketPoll;
+        size_t inFlight = 1;
+
+        if (msg != nullptr) {
+            *transferResult = -ECANCELED;
+            sqe->flags |= IOSQE_IO_LINK;
+            sqe = io_uring_get_sqe(&mRing);
+            LOG_ALWAYS_FATAL_IF(sqe == nullptr, "io_uring submission queue full");
+            if (event == POLLOUT) {
+                io_uring_prep_sendmsg(sqe, kSocketIndex, msg, MSG_NOSIGNAL);
+            } else {
+                io_uring_prep_recvmsg(sqe, kSocketIndex, msg, 0);
+            }
+            sqe->flags |= IOSQE_FIXED_FILE;
+            sqe->user_data = kTagTransfer;
+            inFlight++;
+        }
+
+        LOG_ALWAYS_FATAL_IF(mSocket.isInPollingState() == true,
+                            "Only one thread should be polling on Fd!");
+        mSocket.setPollingState(true);
+        auto pollingStateGuard = make_scope_guard([&]() { mSocket.setPollingState(false); });
+
+        // The requests above reference |msg|, so they must all complete before
+        // returning, even if the trigger fires.
+        int pollResult = -ECANCELED;
+        bool cancelled = false;
+        while (inFlight > 0) {
+            int ret = io_uring_submit_and_wait(&mRing, 1);
+            if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+                LOG_ALWAYS_FATAL("io_uring_submit_and_wait: %s", strerror(-ret));
+            }
+
+            io_uring_cqe* cqe;
+            while (io_uring_peek_cqe(&mRing, &cqe) == 0) {
+                uint64_t tag = cqe->user_data;
+                int res = cqe->res;
+                io_uring_cqe_seen(&mRing, cqe);
+
+                switch (tag) {
+                    case kTagTrigger:
+                        mTriggerFired = true;
+                        break;
+                    case kTagSocketPoll:
+                        pollResult = res;
+                        inFlight--;
+                        break;
+                    case kTagTransfer:
+                        *transferResult = res;
+                        inFlight--;
+                        break;
+                    case kTagCancel:
+                        break;
+                    default:
+                        LOG_ALWAYS_FATAL("Unknown io_uring completion %" PRIu64, tag);
+                }
+            }
+
+            if (mTriggerFired && inFlight > 0 && !cancelled) {
+                // Cancelling the poll also cancels the transfer linked to it.
+                sqe = io_uring_get_sqe(&mRing);
+                LOG_ALWAYS_FATAL_IF(sqe == nullptr, "io_uring submission queue full");
+                io_uring_prep_cancel(sqe, reinterpret_cast<void*>(kTagSocketPoll), 0);
+                sqe->user_data = kTagCancel;
+                cancelled = true;
+            }
+        }
+
+        if (mTriggerFired) return DEAD_OBJECT;
+
+        // Data made it through, so let the caller process it, even if the
+        // socket is also in an error state.
+        if (msg != nullptr && *transferResult >= 0) return OK;
+
+        if (pollResult < 0) return pollResult;
+        if (pollResult & POLLNVAL) return BAD_VALUE;
+        if (pollResult & POLLERR) {
+            LOG_RPC_DETAIL("io_uring poll FD %d results in revents = %d", mSocket.fd.get(),
+                           pollResult);
+            return DEAD_OBJECT;
+        }
+        if (pollResult & event) return OK;
+        return DEAD_OBJECT;
+    }
+
+    // Same as interruptableReadOrWrite, but waits through waitForSocket.
+    template <typename SendOrReceive, typename CanLink, typename OnLinked>
+    status_t readOrWrite(FdTrigger* fdTrigger, iovec* iovs, int niovs,
+                         SendOrReceive sendOrReceiveFun, CanLink canLink, OnLinked onLinked,
+                         const char* funName, int16_t event,
+                         const std::optional<SmallFunction<status_t()>>& altPoll) {
+        if (!mRingReady || fdTrigger != mTrigger) {
+            return interruptableReadOrWrite(mSocket, fdTrigger, iovs, niovs, sendOrReceiveFun,
+                                            funName, event, altPoll);
+        }
+
+        MAYBE_WAIT_IN_FLAKE_MODE;
+
+        if (niovs < 0) {
+            return BAD_VALUE;
+        }
+
+        if (fdTrigger->isTriggered()) {
+            return DEAD_OBJECT;
+        }
+
+        // See interruptableReadOrWrite.
+        while (niovs > 0 && iovs[niovs - 1].iov_len == 0) {
+            niovs--;
+        }
+        if (niovs == 0) {
+            return OK;
+        }
+
+        bool havePolled = false;
+        ssize_t processSize = sendOrReceiveFun(iovs, niovs);
+        while (true) {
+            if (processSize < 0) {
+                int savedErrno = errno;
+
+                // Still return the error on later passes, since it would expose
+                // a problem with polling
+                if (havePolled || (savedErrno != EAGAIN && savedErrno != EWOULDBLOCK)) {
+                    LOG_RPC_DETAIL("RpcTransport %s(): %s", funName, strerror(savedErrno));
+                    return -savedErrno;
+                }
+            } else if (processSize == 0) {
+                return DEAD_OBJECT;
+            } else {
+                while (processSize > 0 && niovs > 0) {
+                    auto& iov = iovs[0];
+                    if (static_cast<size_t>(processSize) < iov.iov_len) {
+                        // Advance the base of the current iovec
+                        iov.iov_base = reinterpret_cast<char*>(iov.iov_base) + processSize;
+                        iov.iov_len -= processSize;
+                        break;
+                    }
+
+                    // The current iovec was fully written
+                    processSize -= iov.iov_len;
+                    iovs++;
+                    niovs--;
+                }
+                if (niovs == 0) {
+                    LOG_ALWAYS_FATAL_IF(processSize > 0,
+                                        "Reached the end of iovecs "
+                                        "with %zd bytes remaining",
+                                        processSize);
+                    return OK;
+                }
+            }
+
+            if (altPoll) {
+                if (status_t status = (*altPoll)(); status != OK) return status;
+                if (fdTrigger->isTriggered()) {
+                    return DEAD_OBJECT;
+                }
+                processSize = sendOrReceiveFun(iovs, niovs);
+                continue;
+            }
+
+            if (!canLink()) {
+                if (status_t status = waitForSocket(event, nullptr, nullptr); status != OK) {
+                    return status;
+                }
+                havePolled = true;
+                processSize = sendOrReceiveFun(iovs, niovs);
+                continue;
+            }
+
+            msghdr msg{
+                    .msg_iov = iovs,
+                    .msg_iovlen = static_cast<decltype(msg.msg_iovlen)>(niovs),
+            };
+            ssize_t transferResult;
+            if (status_t status = waitForSocket(event, &msg, &transferResult); status != OK) {
+                return status;
+            }
+            havePolled = true;
+            onLinked(transferResult);
+            if (transferResult < 0) {
+                errno = static_cast<int>(-transferResult);
+                processSize = -1;
+            } else {
+                processSize = transferResult;
+            }
+        }
+    }
+
+    android::RpcTransportFd mSocket;
+    // Only valid when mRingReady
+    io_uring mRing;
+    bool mRingReady = false;
+    FdTrigger* mTrigger = nullptr;
+    bool mTriggerFired = false;
+};
+
+// RpcTransportCtx with TLS disabled, using io_uring.
+class RpcTransportCtxUring : public RpcTransportCtx {
+public:
+    std::unique_ptr<RpcTransport> newTransport(android::RpcTransportFd socket,
+                                               FdTrigger* fdTrigger) const override {
+        return std::make_unique<RpcTransportUring>(std::move(socket), fdTrigger);
+    }
+    std::vector<uint8_t> getCertificate(RpcCertificateFormat) const override { return {}; }
+};
+
+std::unique_ptr<RpcTransportCtx> RpcTransportCtxFactoryUring::newServerCtx() const {
+    return std::make_unique<RpcTransportCtxUring>();
+}
+
+std::unique_ptr<RpcTransportCtx> RpcTransportCtxFactoryUring::newClientCtx() const {
+    return std::make_unique<RpcTransportCtxUring>();
+}
+
+const char* RpcTransportCtxFactoryUring::toCString() const {
+    return "uring";
+}
+
+std::unique_ptr<RpcTransportCtxFactory> RpcTransportCtxFactoryUring::make() {
+    return std::unique_ptr<RpcTransportCtxFactoryUring>(new RpcTransportCtxFactoryUring());
+}
+
+} // namespace android
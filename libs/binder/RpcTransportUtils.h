@@ -18,6 +18,8 @@
 #include <binder/unique_fd.h>
 #include <poll.h>
 
+#include <chrono>
+
 #include "FdTrigger.h"
 #include "RpcState.h"
 
@@ -55,6 +57,15 @@ status_t interruptableReadOrWrite(
         return OK;
     }
 
+    // Reads of a session with RpcSession::setBusyPollReads retry for a while
+    // before polling, until spinDeadline, and then busyPoll is cleared.
+    RpcBusyPoll* busyPoll =
+            (event == POLLIN && !altPoll && socket.busyPoll != nullptr &&
+             socket.busyPoll->spinDuration.count() > 0)
+            ? socket.busyPoll.get()
+            : nullptr;
+    std::optional<std::chrono::steady_clock::time_point> spinDeadline;
+
     bool havePolled = false;
     while (true) {
         ssize_t processSize = sendOrReceiveFun(iovs, niovs);
@@ -89,10 +100,24 @@ status_t interruptableReadOrWrite(
                                     "Reached the end of iovecs "
                                     "with %zd bytes remaining",
                                     processSize);
+                if (busyPoll && spinDeadline) busyPoll->hits++;
                 return OK;
             }
         }
 
+        if (busyPoll) {
+            auto now = std::chrono::steady_clock::now();
+            if (!spinDeadline) spinDeadline = now + busyPoll->spinDuration;
+            if (now < *spinDeadline) {
+                if (fdTrigger->isTriggered()) {
+                    return DEAD_OBJECT;
+                }
+                continue;
+            }
+            busyPoll->misses++;
+            busyPoll = nullptr;
+        }
+
         if (altPoll) {
             if (status_t status = (*altPoll)(); status != OK) return status;
             if (fdTrigger->isTriggered()) {
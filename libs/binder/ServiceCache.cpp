@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ServiceCache"
+
+#include "ServiceCache.h"
+
+#include <android-base/properties.h>
+#include <android-base/strings.h>
+#include <binder/ProcessState.h>
+#include <utils/Log.h>
+
+namespace android {
+
+using binder::Status;
+
+ServiceCache::ServiceCache(const sp<os::IServiceManager>& sm, std::set<std::string> cachableNames,
+                           size_t maxEntries)
+      : mServiceManager(sm), mCachableNames(std::move(cachableNames)), mMaxEntries(maxEntries) {}
+
+std::set<std::string> ServiceCache::getConfiguredNames() {
+    std::set<std::string> names;
+#if defined(__ANDROID__) && !defined(__ANDROID_VENDOR__) && !defined(__ANDROID_RECOVERY__)
+    const std::string configured = base::GetProperty("ro.binder.cached_services", "");
+    if (configured.empty()) {
+        // Services in system_server, which only go away when it restarts.
+        return {
+                "account",       "activity",           "alarm",         "appops",
+                "audio",         "batterystats",       "connectivity",  "content",
+                "device_policy", "display",            "dropbox",       "input",
+                "input_method",  "jobscheduler",       "location",      "mount",
+                "netstats",      "notification",       "package",       "package_native",
+                "permission",    "permission_checker", "permissionmgr", "platform_compat",
+                "power",         "role",               "sensorservice", "telephony.registry",
+                "uimode",        "user",               "webviewupdate", "window",
+        };
+    }
+    for (std::string& name : base::Split(configured, ",")) {
+        name = base::Trim(name);
+        if (!name.empty()) names.insert(std::move(name));
+    }
+#endif
+    return names;
+}
+
+sp<IBinder> ServiceCache::lookup(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = mEntries.find(name);
+    if (it == mEntries.end()) return nullptr;
+    return it->second;
+}
+
+void ServiceCache::maybeAdd(const std::string& name, const sp<IBinder>& binder) {
+    if (binder == nullptr || binder->remoteBinder() == nullptr) return;
+    if (mCachableNames.count(name) == 0) return;
+    if (ProcessState::self()->getThreadPoolMaxTotalThreadCount() == 0) return;
+
+    if (!registerForNotifications(name)) return;
+    // Fails if the service died in the meantime.
+    if (binder->linkToDeath(sp<ServiceCache>::fromExisting(this)) != OK) return;
+
+    std::lock_guard<std::mutex> lock(mLock);
+    auto [it, inserted] = mEntries.emplace(name, binder);
+    if (!inserted) {
+        // Another thread added it first, and linked to it.
+        binder->unlinkToDeath(sp<ServiceCache>::fromExisting(this));
+        return;
+    }
+    mInsertionOrder.push_back(name);
+    while (mEntries.size() > mMaxEntries) {
+        const std::string oldest = mInsertionOrder.front();
+        eraseLocked(oldest);
+    }
+}
+
+void ServiceCache::remove(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mLock);
+    eraseLocked(name);
+}
+
+Status ServiceCache::onRegistration(const std::string& name, const sp<IBinder>& binder) {
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = mEntries.find(name);
+    if (it == mEntries.end() || it->second == binder) return Status::ok();
+    // Registered again, e.g. by a new system_server. Look it up the next
+    // time rather than trusting a callback ordering.
+    eraseLocked(name);
+    return Status::ok();
+}
+
+void ServiceCache::binderDied(const wp<IBinder>& who) {
+    std::lock_guard<std::mutex> lock(mLock);
+    for (auto it = mEntries.begin(); it != mEntries.end();) {
+        if (it->second.get() == who.unsafe_get()) {
+            std::erase(mInsertionOrder, it->first);
+            it = mEntries.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+bool ServiceCache::registerForNotifications(const std::string& name) {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mRegisteredForNotifications.count(name) != 0) return true;
+    }
+    // servicemanager calls back right away since the service is registered,
+    // so this must not hold mLock.
+    if (Status status = mServiceManager->registerForNotifications(
+                name, sp<os::IServiceCallback>::fromExisting(this));
+        !status.isOk()) {
+        ALOGW("Not caching %s, can't register for notifications: %s", name.c_str(),
+              status.toString8().c_str());
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mLock);
+    mRegisteredForNotifications.insert(name);
+    return true;
+}
+
+void ServiceCache::eraseLocked(const std::string& name) {
+    auto it = mEntries.find(name);
+    if (it == mEntries.end()) return;
+    it->second->unlinkToDeath(sp<ServiceCache>::fromExisting(this));
+    mEntries.erase(it);
+    std::erase(mInsertionOrder, name);
+}
+
+} // namespace android
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include <android/os/BnServiceCallback.h>
+#include <android/os/IServiceManager.h>
+#include <binder/IBinder.h>
+
+namespace android {
+
+/**
+ * Process-local cache of service lookups. Processes look up the same services
+ * over and over (e.g. during boot and app startup), and every lookup would
+ * otherwise be a round trip to servicemanager.
+ *
+ * Only a configured set of services is cached, by default those of
+ * system_server, see getConfiguredNames. They must not be lazy, since holding
+ * a strong reference from here would keep a lazy service from ever shutting
+ * down. At most maxEntries of them are cached at once, the oldest entry being
+ * evicted first.
+ *
+ * An entry is dropped when its service dies, and when servicemanager reports
+ * a new registration under the same name. The cache itself is the one death
+ * recipient and registration callback for all of its entries. Since both
+ * notifications need incoming binder threads, nothing is cached in processes
+ * without a threadpool.
+ */
+class ServiceCache : public os::BnServiceCallback, public IBinder::DeathRecipient {
+public:
+    static constexpr size_t kDefaultMaxEntries = 64;
+
+    ServiceCache(const sp<os::IServiceManager>& sm, std::set<std::string> cachableNames,
+                 size_t maxEntries = kDefaultMaxEntries);
+
+    /**
+     * The names listed, separated by commas, in ro.binder.cached_services, or
+     * the services of system_server, which are never lazy, if it is unset.
+     * Empty in vendor and recovery processes, which don't cache.
+     */
+    static std::set<std::string> getConfiguredNames();
+
+    /** Returns the cached binder for name, or nullptr. */
+    sp<IBinder> lookup(const std::string& name);
+
+    /** Caches the result of looking up name, if it may be cached. */
+    void maybeAdd(const std::string& name, const sp<IBinder>& binder);
+
+    /** Drops the entry for name, e.g. before it is registered again. */
+    void remove(const std::string& name);
+
+    // IServiceCallback
+    binder::Status onRegistration(const std::string& name, const sp<IBinder>& binder) override;
+
+    // DeathRecipient
+    void binderDied(const wp<IBinder>& who) override;
+
+private:
+    bool registerForNotifications(const std::string& name);
+    void eraseLocked(const std::string& name);
+
+    const sp<os::IServiceManager> mServiceManager;
+    const std::set<std::string> mCachableNames;
+    const size_t mMaxEntries;
+
+    std::mutex mLock;
+    std::map<std::string, sp<IBinder>> mEntries;
+    std::deque<std::string> mInsertionOrder; // for eviction
+    std::set<std::string> mRegisteredForNotifications;
+};
+
+} // namespace android
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "TransactionStats"
+
+#include <binder/Parcel.h>
+#include <binder/RpcThreads.h>
+#include <binder/TransactionStats.h>
+#include <utils/String8.h>
+
+#include <inttypes.h>
+
+#include <chrono>
+#include <map>
+#include <tuple>
+
+#include "Utils.h"
+
+namespace android::binder::debug {
+
+std::atomic<uint32_t> TransactionStats::sSamplingInterval = 0;
+std::atomic<uint32_t> TransactionStats::sConfiguredInterval = 1;
+
+namespace {
+
+using Direction = TransactionStats::Direction;
+using Entry = TransactionStats::Entry;
+using Key = std::tuple<String16, uint32_t, Direction>;
+
+// Must be a power of two. Threads which see more distinct transactions than
+// this stop recording new ones.
+constexpr size_t kSlotsPerThread = 128;
+
+// Only the owning thread writes these, so a relaxed load and store is enough
+// (and avoids a locked instruction per counter). Other threads only read them.
+void add(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+struct Slot {
+    // Published with release once the key below has been written. The key
+    // is never changed afterwards.
+    std::atomic<bool> used = false;
+    size_t hash = 0;
+    String16 descriptor;
+    uint32_t code = 0;
+    Direction direction = Direction::OUTGOING;
+
+    std::atomic<uint64_t> count = 0;
+    std::atomic<uint64_t> totalNs = 0;
+    std::atomic<uint64_t> maxNs = 0;
+    std::atomic<uint64_t> dataBytes = 0;
+    std::atomic<uint64_t> replyBytes = 0;
+    std::array<std::atomic<uint64_t>, TransactionStats::kNumBuckets> histogram{};
+};
+
+struct ThreadTable {
+    std::array<Slot, kSlotsPerThread> slots;
+    bool loggedFull = false;
+};
+
+void mergeInto(std::map<Key, Entry>* merged, const Slot& slot) {
+    Entry& entry = (*merged)[Key(slot.descriptor, slot.code, slot.direction)];
+    entry.descriptor = slot.descriptor;
+    entry.code = slot.code;
+    entry.direction = slot.direction;
+    entry.count += slot.count.load(std::memory_order_relaxed);
+    entry.totalNs += slot.totalNs.load(std::memory_order_relaxed);
+    entry.maxNs = std::max(entry.maxNs, slot.maxNs.load(std::memory_order_relaxed));
+    entry.dataBytes += slot.dataBytes.load(std::memory_order_relaxed);
+    entry.replyBytes += slot.replyBytes.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < TransactionStats::kNumBuckets; i++) {
+        entry.histogram[i] += slot.histogram[i].load(std::memory_order_relaxed);
+    }
+}
+
+void mergeInto(std::map<Key, Entry>* merged, const ThreadTable& table) {
+    for (const Slot& slot : table.slots) {
+        if (slot.used.load(std::memory_order_acquire)) mergeInto(merged, slot);
+    }
+}
+
+struct Registry {
+    RpcMutex mutex;
+    std::vector<ThreadTable*> live;
+    // statistics of threads which exited
+    std::map<Key, Entry> retired;
+};
+
+Registry& registry() {
+    // Never destroyed, since threads may exit during static destruction.
+    static Registry* sRegistry = new Registry;
+    return *sRegistry;
+}
+
+struct ThreadState {
+    ~ThreadState() {
+        if (table == nullptr) return;
+        Registry& r = registry();
+        RpcMutexLockGuard _l(r.mutex);
+        mergeInto(&r.retired, *table);
+        std::erase(r.live, table);
+        delete table;
+    }
+
+    ThreadTable* getOrCreateTable() {
+        if (table == nullptr) [[unlikely]] {
+            table = new ThreadTable;
+            Registry& r = registry();
+            RpcMutexLockGuard _l(r.mutex);
+            r.live.push_back(table);
+        }
+        return table;
+    }
+
+    ThreadTable* table = nullptr;
+    uint32_t skipped = 0;
+};
+
+ThreadState& threadState() {
+#ifdef BINDER_RPC_SINGLE_THREADED
+    static ThreadState sState;
+    return sState;
+#else
+    thread_local ThreadState tState;
+    return tState;
+#endif
+}
+
+size_t bucketFor(uint64_t durationNs) {
+    uint64_t us = durationNs / 1000;
+    size_t bucket = us == 0 ? 0 : 64 - __builtin_clzll(us);
+    return std::min(bucket, TransactionStats::kNumBuckets - 1);
+}
+
+// Upper bound of the bucket containing the given fraction of transactions.
+std::string percentile(const Entry& entry, double fraction) {
+    uint64_t target = static_cast<uint64_t>(fraction * static_cast<double>(entry.count));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < TransactionStats::kNumBuckets - 1; i++) {
+        seen += entry.histogram[i];
+        if (seen > target) return std::to_string(1ULL << i) + "us";
+    }
+    return ">" + std::to_string(1ULL << (TransactionStats::kNumBuckets - 2)) + "us";
+}
+
+} // namespace
+
+void TransactionStats::setEnabled(bool enabled) {
+    sSamplingInterval.store(enabled ? sConfiguredInterval.load(std::memory_order_relaxed) : 0,
+                            std::memory_order_relaxed);
+}
+
+void TransactionStats::setSamplingInterval(uint32_t interval) {
+    LOG_ALWAYS_FATAL_IF(interval == 0, "Sampling interval must be at least 1");
+    sConfiguredInterval.store(interval, std::memory_order_relaxed);
+    sSamplingInterval.store(interval, std::memory_order_relaxed);
+}
+
+bool TransactionStats::shouldSampleSlow() {
+    uint32_t interval = sSamplingInterval.load(std::memory_order_relaxed);
+    if (interval == 0) return false;
+
+    ThreadState& state = threadState();
+    if (state.skipped + 1 < interval) {
+        state.skipped++;
+        return false;
+    }
+    state.skipped = 0;
+    return true;
+}
+
+uint64_t TransactionStats::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+
+void TransactionStats::record(Direction direction, std::u16string_view descriptor, uint32_t code,
+                              uint64_t durationNs, size_t dataBytes, size_t replyBytes) {
+    ThreadTable* table = threadState().getOrCreateTable();
+
+    size_t hash = std::hash<std::u16string_view>{}(descriptor) ^
+            (static_cast<size_t>(code) * 31 + static_cast<size_t>(direction));
+
+    for (size_t probe = 0; probe < kSlotsPerThread; probe++) {
+        Slot& slot = table->slots[(hash + probe) & (kSlotsPerThread - 1)];
+
+        // Only this thread writes the key, so no acquire is needed.
+        if (!slot.used.load(std::memory_order_relaxed)) {
+            slot.hash = hash;
+            slot.descriptor = String16(descriptor.data(), descriptor.size());
+            slot.code = code;
+            slot.direction = direction;
+            slot.used.store(true, std::memory_order_release);
+        } else if (slot.hash != hash || slot.code != code || slot.direction != direction ||
+                   std::u16string_view(slot.descriptor.c_str(), slot.descriptor.size()) !=
+                           descriptor) {
+            continue;
+        }
+
+        add(slot.count, 1);
+        add(slot.totalNs, durationNs);
+        if (durationNs > slot.maxNs.load(std::memory_order_relaxed)) {
+            slot.maxNs.store(durationNs, std::memory_order_relaxed);
+        }
+        add(slot.dataBytes, dataBytes);
+        add(slot.replyBytes, replyBytes);
+        add(slot.histogram[bucketFor(durationNs)], 1);
+        return;
+    }
+
+    ALOGW_IF(!table->loggedFull,
+             "More than %zu distinct transactions on this thread, not recording new ones.",
+             kSlotsPerThread);
+    table->loggedFull = true;
+}
+
+std::u16string_view TransactionStats::peekDescriptor(const Parcel& data) {
+    size_t len = 0;
+    const char16_t* descriptor = data.peekInterfaceToken(&len);
+    if (descriptor == nullptr) return {};
+    return std::u16string_view(descriptor, len);
+}
+
+std::vector<TransactionStats::Entry> TransactionStats::snapshot() {
+    Registry& r = registry();
+    RpcMutexLockGuard _l(r.mutex);
+
+    std::map<Key, Entry> merged = r.retired;
+    for (const ThreadTable* table : r.live) {
+        mergeInto(&merged, *table);
+    }
+
+    std::vector<Entry> entries;
+    entries.reserve(merged.size());
+    for (auto& [key, entry] : merged) {
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+
+std::string TransactionStats::dump() {
+    std::vector<Entry> entries = snapshot();
+
+    std::string ret = "Binder transaction statistics (" + std::to_string(entries.size()) +
+            " entries, sampling 1/" +
+            std::to_string(sConfiguredInterval.load(std::memory_order_relaxed)) +
+            (isEnabled() ? "" : ", disabled") + "):\n";
+    for (const Entry& entry : entries) {
+        char line[256];
+        snprintf(line, sizeof(line),
+                 " %s code %" PRIu32 ": count %" PRIu64 " avg %" PRIu64 "us max %" PRIu64
+                 "us data %" PRIu64 "B reply %" PRIu64 "B",
+                 entry.direction == Direction::OUTGOING ? "out" : "in", entry.code, entry.count,
+                 entry.count == 0 ? 0 : entry.totalNs / entry.count / 1000, entry.maxNs / 1000,
+                 entry.dataBytes, entry.replyBytes);
+        ret += " ";
+        ret += entry.descriptor.empty() ? "<unknown>" : String8(entry.descriptor).c_str();
+        ret += line;
+        ret += " p50 " + percentile(entry, 0.5) + " p90 " + percentile(entry, 0.9) + " p99 " +
+                percentile(entry, 0.99) + "\n";
+    }
+    return ret;
+}
+
+} // namespace android::binder::debug
@@ -253,6 +253,9 @@ private:
             // Whether the work source should be propagated.
             bool                mPropagateWorkSource;
             bool                mIsLooper;
+            // see ProcessState::setThreadPoolCpuPolicy
+            bool mIsReservedForHighPriority;
+            bool mIsOnHighPriorityCpus;
             bool mIsFlushing;
             bool mHasExplicitIdentity;
             int32_t             mStrictModePolicy;
@@ -25,7 +25,7 @@
 namespace android {
 // ----------------------------------------------------------------------------
 
-class SimpleBestFitAllocator;
+class SegregatedFitAllocator;
 
 // ----------------------------------------------------------------------------
 
@@ -43,6 +43,24 @@ public:
 
     sp<IMemoryHeap> getMemoryHeap() const { return heap(); }
 
+    // Usage of the heap, in bytes.
+    struct Stats {
+        size_t heapSize = 0;
+        size_t allocatedSize = 0;
+        size_t freeSize = 0;
+        // freeSize minus this is the memory lost to fragmentation, for
+        // allocations of that size
+        size_t largestFreeChunk = 0;
+        size_t allocations = 0;
+        size_t freeChunks = 0;
+    };
+    Stats getStats() const;
+
+    // The pages within a freed allocation are always given back to the
+    // kernel. If enabled, so are the pages it shared with neighbouring chunks
+    // which are free too, at the cost of more madvise calls. Off by default.
+    void setReleaseFreePages(bool release);
+
 protected:
     virtual ~MemoryDealer();
 
@@ -50,10 +68,10 @@ private:
     friend class Allocation;
     virtual void                deallocate(size_t offset);
     const sp<IMemoryHeap>&      heap() const;
-    SimpleBestFitAllocator*     allocator() const;
+    SegregatedFitAllocator*     allocator() const;
 
     sp<IMemoryHeap>             mHeap;
-    SimpleBestFitAllocator*     mAllocator;
+    SegregatedFitAllocator*     mAllocator;
 };
 
 
@@ -57,6 +57,7 @@ namespace binder {
 class Status;
 namespace debug {
 class RecordedTransaction;
+class TransactionStats;
 }
 }
 
@@ -85,6 +86,7 @@ public:
     // auto i = p.dataPosition(); p.writeInt32(0); p.setDataPosition(i); p.writeInt32(1);).
     // Writing over objects, such as file descriptors and binders, is not supported.
     void                setDataPosition(size_t pos) const;
+    // Makes room for size bytes, so that writing a message of a known size doesn't grow the data.
     status_t            setDataCapacity(size_t size);
 
     status_t            setData(const uint8_t* buffer, size_t len);
@@ -1447,8 +1449,20 @@ private:
     // this
     size_t getBlobAshmemSize() const;
 
+    // Whether a large blob can be passed in shared memory rather than inline.
+    bool canWriteBlobFileDescriptor() const;
+    status_t writeBlobMemfd(binder::unique_fd fd, size_t len, bool mutableCopy,
+                            WritableBlob* outBlob);
+    status_t readBlobMemfd(int fd, size_t len, bool isMutable, ReadableBlob* outBlob) const;
+
+    // Reads the descriptor of the interface token at the start of this
+    // parcel, if there is one, without changing the data position.
+    const char16_t* peekInterfaceToken(size_t* outLen) const;
+
     // Needed so that we can save object metadata to the disk
     friend class android::binder::debug::RecordedTransaction;
+    // Needed to attribute transactions to interfaces
+    friend class android::binder::debug::TransactionStats;
 };
 
 // ---------------------------------------------------------------------------
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 
@@ -92,16 +93,7 @@ public:
     std::set<String16> getStringVectorKeys() const;
     std::set<String16> getPersistableBundleKeys() const;
 
-    friend bool operator==(const PersistableBundle& lhs, const PersistableBundle& rhs) {
-        return (lhs.mBoolMap == rhs.mBoolMap && lhs.mIntMap == rhs.mIntMap &&
-                lhs.mLongMap == rhs.mLongMap && lhs.mDoubleMap == rhs.mDoubleMap &&
-                lhs.mStringMap == rhs.mStringMap && lhs.mBoolVectorMap == rhs.mBoolVectorMap &&
-                lhs.mIntVectorMap == rhs.mIntVectorMap &&
-                lhs.mLongVectorMap == rhs.mLongVectorMap &&
-                lhs.mDoubleVectorMap == rhs.mDoubleVectorMap &&
-                lhs.mStringVectorMap == rhs.mStringVectorMap &&
-                lhs.mPersistableBundleMap == rhs.mPersistableBundleMap);
-    }
+    friend bool operator==(const PersistableBundle& lhs, const PersistableBundle& rhs);
 
     friend bool operator!=(const PersistableBundle& lhs, const PersistableBundle& rhs) {
         return !(lhs == rhs);
@@ -110,6 +102,36 @@ public:
 private:
     status_t writeToParcelInner(Parcel* parcel) const;
     status_t readFromParcelInner(const Parcel* parcel, size_t length);
+    status_t readEntries(const Parcel* parcel);
+
+    /*
+     * A bundle read into an empty PersistableBundle is kept in its parcelled
+     * form, with an index of its keys sorted by key. Values are only decoded by
+     * the getters, and the parcelled form is written as is by writeToParcel.
+     * Setters and erase decode all values into the maps first.
+     */
+    struct LazyEntry {
+        String16 key;
+        int32_t type;
+        // of the value in LazyData::data
+        size_t offset;
+        size_t size;
+    };
+    struct LazyData {
+        // the entry count and entries, as they follow the magic number
+        std::vector<uint8_t> data;
+        std::vector<LazyEntry> entries;
+    };
+    void decodeLazyData();
+    // Sets 'out' to the value of 'key', if it has the type 'type'.
+    bool getLazyParcel(const String16& key, int32_t type, Parcel* out) const;
+    template <typename T>
+    bool getLazyValue(const String16& key, int32_t type, T* out,
+                      status_t (Parcel::*read)(T*) const) const;
+    std::set<String16> getLazyKeys(int32_t type) const;
+
+    // if set, the maps are empty
+    std::shared_ptr<const LazyData> mLazyData;
 
     std::map<String16, bool> mBoolMap;
     std::map<String16, int32_t> mIntMap;
@@ -22,7 +22,10 @@
 
 #include <pthread.h>
 
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 // ---------------------------------------------------------------------------
 namespace android {
@@ -126,6 +129,41 @@ public:
      */
     bool isThreadPoolStarted() const;
 
+    struct ThreadPoolCpuPolicy {
+        // CPUs which threadpool threads run on, e.g. the little cores of a
+        // big.LITTLE system. If empty, threads join with their own affinity,
+        // and move back to the affinity of the thread which set this policy
+        // after a transaction on highPriorityCpus.
+        std::vector<int> poolCpus;
+        // CPUs which transactions from high priority callers run on, e.g. the
+        // big cores. A thread which receives such a transaction moves there
+        // until it has replied. If empty, threads never move, and no thread
+        // is reserved.
+        std::vector<int> highPriorityCpus;
+        // How many threads stay on highPriorityCpus, even when idle, so that
+        // some threads are always warm there. The first threads which join
+        // are reserved.
+        size_t reservedThreads = 0;
+        // Callers whose priority is inherited with a nice value at or below
+        // this, or with a real-time scheduling policy, are high priority.
+        int highPriorityNice = -4; // ANDROID_PRIORITY_DISPLAY
+    };
+    // Places threadpool threads on sets of CPUs. Returns INVALID_OPERATION
+    // once the threadpool started or any thread joined it, and BAD_VALUE for
+    // invalid CPUs.
+    status_t setThreadPoolCpuPolicy(const ThreadPoolCpuPolicy& policy);
+
+    struct ThreadPoolCpuStats {
+        // transactions executed on each CPU, indexed by CPU number
+        std::vector<uint64_t> transactionsPerCpu;
+        uint64_t highPriorityTransactions = 0;
+        // times a thread moved to ThreadPoolCpuPolicy::highPriorityCpus
+        uint64_t migrations = 0;
+    };
+    // Where transactions ran, since setThreadPoolCpuPolicy. Empty without a
+    // policy.
+    ThreadPoolCpuStats getThreadPoolCpuStats() const;
+
     enum class DriverFeature {
         ONEWAY_SPAM_DETECTION,
         EXTENDED_ERROR,
@@ -151,11 +189,43 @@ private:
     String8 makeBinderThreadName();
 
     struct handle_entry {
-        IBinder* binder;
+        // Written under mLock, but read without it by getStrongProxyForHandle
+        // between beginHandleRead and endHandleRead.
+        std::atomic<IBinder*> binder;
         RefBase::weakref_type* refs;
     };
 
+    // Entries are allocated in chunks which never move, and the directory of
+    // chunks is replaced as a whole when one is added, so that they can be
+    // read without mLock. Old directories are freed with ProcessState.
+    static constexpr size_t kHandleChunkSize = 256;
+    struct HandleChunk {
+        handle_entry entries[kHandleChunkSize] = {};
+    };
+    struct HandleDirectory {
+        std::vector<HandleChunk*> chunks;
+    };
+
     handle_entry* lookupHandleLocked(int32_t handle);
+    // A proxy for the handle if one is alive, without taking mLock.
+    sp<IBinder> tryGetLiveProxyForHandle(int32_t handle);
+    // Lookups without mLock are read sections like in RCU: entries which they
+    // may see are only freed after a grace period, in which every section
+    // which began before it has ended.
+    size_t beginHandleRead();
+    void endHandleRead(size_t reader);
+    void waitForHandleReadersLocked();
+
+    // see setThreadPoolCpuPolicy
+    struct CpuPolicy;
+    // Moves a thread which joins the threadpool to its CPUs. Returns whether
+    // it is one of the reserved threads, which must call cpuPolicyLeave.
+    bool cpuPolicyJoin();
+    void cpuPolicyLeave();
+    // Called before executing a transaction. Returns whether the thread moved
+    // to the high priority CPUs, and must call cpuPolicyEndTransaction.
+    bool cpuPolicyBeginTransaction(bool onHighPriorityCpus);
+    void cpuPolicyEndTransaction();
 
     String8 mDriverName;
     int mDriverFD;
@@ -180,13 +250,21 @@ private:
 
     mutable std::mutex mLock; // protects everything below.
 
-    Vector<handle_entry> mHandleToObject;
+    std::atomic<const HandleDirectory*> mHandleToObject;
+    std::vector<std::unique_ptr<HandleChunk>> mHandleChunks;
+    std::vector<std::unique_ptr<const HandleDirectory>> mHandleDirectories;
+    // read sections in progress, by parity of mHandleReadEpoch when they began
+    std::atomic<size_t> mHandleReadEpoch;
+    std::atomic<size_t> mHandleReaders[2];
 
     bool mForked;
     bool mThreadPoolStarted;
     volatile int32_t mThreadPoolSeq;
 
     CallRestriction mCallRestriction;
+
+    // Set before the threadpool starts, and not changed after
+    std::unique_ptr<CpuPolicy> mCpuPolicy;
 };
 
 } // namespace android
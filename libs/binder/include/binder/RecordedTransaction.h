@@ -33,6 +33,12 @@ public:
     // Filled with the first transaction from fd.
 
     static std::optional<RecordedTransaction> fromFile(const binder::unique_fd& fd);
+    // Filled with the first transaction in [data, data + size), e.g. from a
+    // recording which was mapped into memory. On success, outConsumed is set
+    // to the number of bytes the transaction took up, so that it can be
+    // called again at data + *outConsumed for the next one.
+    static std::optional<RecordedTransaction> fromBuffer(const uint8_t* data, size_t size,
+                                                         size_t* outConsumed);
     // Filled with the arguments.
     static std::optional<RecordedTransaction> fromDetails(const String16& interfaceName,
                                                           uint32_t code, uint32_t flags,
@@ -55,8 +61,10 @@ public:
 private:
     RecordedTransaction() = default;
 
-    android::status_t writeChunk(const binder::borrowed_fd, uint32_t chunkType, size_t byteCount,
-                                 const uint8_t* data) const;
+    static android::status_t appendChunk(std::vector<std::byte>* buffer, uint32_t chunkType,
+                                         size_t byteCount, const uint8_t* data);
+    // Returns false if the chunk is invalid.
+    bool applyChunk(uint32_t chunkType, const uint8_t* data, uint32_t dataSize);
 
 #pragma clang diagnostic push
 #pragma clang diagnostic error "-Wpadded"
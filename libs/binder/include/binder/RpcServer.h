@@ -30,6 +30,7 @@
 namespace android {
 
 class FdTrigger;
+class RpcEventLoop;
 class RpcServerTrusty;
 class RpcSocketAddress;
 
@@ -133,6 +134,23 @@ public:
     void setMaxThreads(size_t threads);
     size_t getMaxThreads();
 
+    /**
+     * By default, each incoming connection of a session has its own thread,
+     * which waits for and executes commands from it. If this is set to a
+     * non-zero value, that many threads are shared by all connections of all
+     * sessions of this server instead, and wait for any of them to become
+     * readable with epoll. Idle sessions then don't need any threads, but
+     * commands are only executed in parallel up to this number of threads.
+     *
+     * Connections whose transport can't be waited on this way (see
+     * RpcTransport::pollFd) still get their own thread.
+     *
+     * This must be called before join() or start(). Not supported on
+     * single-threaded libbinder.
+     */
+    void setEventThreads(size_t threads);
+    size_t getEventThreads();
+
     /**
      * By default, the latest protocol version which is supported by a client is
      * used. However, this can be used in order to prevent newer protocol
@@ -264,6 +282,7 @@ private:
 
     const std::unique_ptr<RpcTransportCtx> mCtx;
     size_t mMaxThreads = 1;
+    size_t mEventThreads = 0;
     std::optional<uint32_t> mProtocolVersion;
     // A mode is supported if the N'th bit is on, where N is the mode enum's value.
     std::bitset<8> mSupportedFileDescriptorTransportModes = std::bitset<8>().set(
@@ -282,6 +301,8 @@ private:
     std::function<void(binder::borrowed_fd)> mServerSocketModifier;
     std::map<std::vector<uint8_t>, sp<RpcSession>> mSessions;
     std::unique_ptr<FdTrigger> mShutdownTrigger;
+    // see setEventThreads, alive while mShutdownTrigger is
+    std::shared_ptr<RpcEventLoop> mEventLoop;
     RpcConditionVariable mShutdownCv;
     std::function<status_t(const RpcServer& server, RpcTransportFd* out)> mAcceptFn;
 };
@@ -22,13 +22,16 @@
 #include <utils/Errors.h>
 #include <utils/RefBase.h>
 
+#include <chrono>
 #include <map>
+#include <memory>
 #include <optional>
 #include <vector>
 
 namespace android {
 
 class Parcel;
+class RpcEventLoop;
 class RpcServer;
 class RpcServerTrusty;
 class RpcSocketAddress;
@@ -78,6 +81,37 @@ public:
     void setMaxIncomingThreads(size_t threads);
     size_t getMaxIncomingThreads();
 
+    /**
+     * Instead of a thread for each of the setMaxIncomingThreads connections,
+     * serve them on a pool of threads which grows and shrinks with the load.
+     * |minThreads| are started right away. Whenever all threads are busy
+     * with calls, another one is started, up to setMaxIncomingThreads, and
+     * threads beyond |minThreads| exit after waiting for calls for
+     * |idleTimeout| (never, if it is zero). This must be called before
+     * setting up this connection as a client.
+     *
+     * Only supported by transports which can be polled for data (e.g. raw
+     * sockets and TLS). With others, all threads are started as usual.
+     */
+    void setAdaptiveIncomingThreads(size_t minThreads, std::chrono::milliseconds idleTimeout);
+
+    struct IncomingThreadStats {
+        // currently running, and waiting for calls
+        size_t threads = 0;
+        size_t idleThreads = 0;
+        size_t peakThreads = 0;
+        uint64_t spawned = 0;
+        // exited after idleTimeout
+        uint64_t retired = 0;
+        // times that the last waiting thread took a call, but no other one could be started
+        uint64_t exhausted = 0;
+    };
+    /**
+     * Counters of the pool of setAdaptiveIncomingThreads. All zero if they
+     * are not used.
+     */
+    IncomingThreadStats getIncomingThreadStats();
+
     /**
      * Set the maximum number of outgoing connections allowed to be made.
      * By default, this is |kDefaultMaxOutgoingConnections|. This must be called before setting up
@@ -114,6 +148,46 @@ public:
     void setFileDescriptorTransportMode(FileDescriptorTransportMode mode);
     FileDescriptorTransportMode getFileDescriptorTransportMode();
 
+    /**
+     * Coalesce oneway transactions so that several of them can go out in a
+     * single write. While one thread is writing a batch, oneway transactions
+     * from other threads are appended to the next batch instead of doing
+     * their own write. At most |maxBatchBytes| are kept pending; once that is
+     * exceeded, transactions are written directly. Before writing a batch,
+     * the writing thread waits up to |flushDeadline| for more transactions
+     * to arrive, or until |maxBatchBytes| are pending.
+     *
+     * By default, |maxBatchBytes| is 0, which disables batching. Oneway
+     * transactions which carry file descriptors are never batched.
+     *
+     * Note, if writing a batch fails, the session is shut down, but the error
+     * is not reported to the callers whose transactions were in the batch.
+     */
+    void setOnewayBatching(size_t maxBatchBytes, std::chrono::microseconds flushDeadline);
+
+    /**
+     * When a read on a connection of this session would block, keep retrying
+     * it for up to |spinDuration| before waiting with poll, so that replies
+     * which come quickly (e.g. between VMs) don't pay for sleeping and waking
+     * up. If |socketBusyPoll| is not zero, it is also set as SO_BUSY_POLL on
+     * the sockets, for the kernel to poll the device while reading. Both are
+     * zero by default. This must be called before setting up this session as
+     * a client, and only affects the connections it sets up.
+     *
+     * Note, spinning keeps a CPU busy for up to |spinDuration| on every read,
+     * including the incoming threads waiting for calls.
+     */
+    void setBusyPollReads(std::chrono::microseconds spinDuration,
+                          std::chrono::microseconds socketBusyPoll);
+
+    struct BusyPollStats {
+        // reads which completed while spinning
+        uint64_t hits = 0;
+        // reads which waited with poll after spinning
+        uint64_t misses = 0;
+    };
+    BusyPollStats getBusyPollStats();
+
     /**
      * This should be called once per thread, matching 'join' in the remote
      * process.
@@ -218,6 +292,7 @@ public:
 
 private:
     friend sp<RpcSession>;
+    friend RpcEventLoop;
     friend RpcServer;
     friend RpcServerTrusty;
     friend RpcState;
@@ -280,6 +355,10 @@ private:
     PreJoinSetupResult preJoinSetup(std::unique_ptr<RpcTransport> rpcTransport);
     // join on thread passed to preJoinThreadOwnership
     static void join(sp<RpcSession>&& session, PreJoinSetupResult&& result);
+    // Instead of join, for connections served by RpcEventLoop. Executes the
+    // commands which can be read from the connection without waiting, on the
+    // calling thread. Returns an error if the connection should be closed.
+    [[nodiscard]] status_t executeReadyCommands(const sp<RpcConnection>& connection);
 
     [[nodiscard]] status_t setupClient(
             const std::function<status_t(const std::vector<uint8_t>& sessionId, bool incoming)>&
@@ -374,12 +453,34 @@ private:
 
     bool mStartedSetup = false;
     size_t mMaxIncomingThreads = 0;
+    // see setAdaptiveIncomingThreads, zero if not used
+    size_t mAdaptiveMinIncomingThreads = 0;
+    std::chrono::milliseconds mIncomingIdleTimeout{0};
+    // see setBusyPollReads, given to each connection
+    std::shared_ptr<RpcBusyPoll> mBusyPoll;
+    std::chrono::microseconds mSocketBusyPoll{0};
+    // serving the incoming connections if adaptive, set during setupClient
+    std::shared_ptr<RpcEventLoop> mIncomingEventLoop;
     size_t mMaxOutgoingConnections = kDefaultMaxOutgoingConnections;
     std::optional<uint32_t> mProtocolVersion;
     FileDescriptorTransportMode mFileDescriptorTransportMode = FileDescriptorTransportMode::NONE;
 
     RpcConditionVariable mAvailableConnectionCv; // for mWaitingThreads
 
+    // see setOnewayBatching, only used by RpcState
+    struct OnewayBatch {
+        RpcMutex mutex; // for all below
+        RpcConditionVariable cv;
+        size_t maxBytes = 0;
+        std::chrono::microseconds flushDeadline{0};
+        // whether a thread is currently writing batches
+        bool flushing = false;
+        // whether a frame didn't fit in pending, so that it is flushed now
+        bool full = false;
+        // serialized wire frames waiting to be written
+        std::vector<uint8_t> pending;
+    } mOnewayBatch;
+
     std::unique_ptr<RpcTransport> mBootstrapTransport;
 
     struct ThreadState {
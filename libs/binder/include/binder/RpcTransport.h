@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <optional>
@@ -41,13 +43,17 @@ struct RpcTransportFd;
 
 // for 'friend'
 class RpcTransportRaw;
+class RpcTransportShm;
 class RpcTransportTls;
 class RpcTransportTipcAndroid;
 class RpcTransportTipcTrusty;
+class RpcTransportUring;
 class RpcTransportCtxRaw;
+class RpcTransportCtxShm;
 class RpcTransportCtxTls;
 class RpcTransportCtxTipcAndroid;
 class RpcTransportCtxTipcTrusty;
+class RpcTransportCtxUring;
 
 // Represents a socket connection.
 // No thread-safety is guaranteed for these APIs.
@@ -103,6 +109,18 @@ public:
      */
     [[nodiscard]] virtual bool isWaiting() = 0;
 
+    /**
+     * A file descriptor which becomes readable when there may be data for
+     * pollRead(), so that many transports can be waited on at once (for
+     * instance, with epoll). Since a transport may buffer data itself, call
+     * pollRead() until it returns WOULD_BLOCK before waiting on this again.
+     *
+     * Return:
+     *   the descriptor, owned by the transport, or -1 if the transport can
+     *   only be waited on by reading from it
+     */
+    [[nodiscard]] virtual binder::borrowed_fd pollFd() { return -1; }
+
 private:
     // limit the classes which can implement RpcTransport. Being able to change this
     // interface is important to allow development of RPC binder. In the past, we
@@ -114,9 +132,11 @@ private:
     // to add more transports.
 
     friend class ::android::RpcTransportRaw;
+    friend class ::android::RpcTransportShm;
     friend class ::android::RpcTransportTls;
     friend class ::android::RpcTransportTipcAndroid;
     friend class ::android::RpcTransportTipcTrusty;
+    friend class ::android::RpcTransportUring;
 
     RpcTransport() = default;
 };
@@ -145,9 +165,11 @@ public:
 private:
     // see comment on RpcTransport
     friend class ::android::RpcTransportCtxRaw;
+    friend class ::android::RpcTransportCtxShm;
     friend class ::android::RpcTransportCtxTls;
     friend class ::android::RpcTransportCtxTipcAndroid;
     friend class ::android::RpcTransportCtxTipcTrusty;
+    friend class ::android::RpcTransportCtxUring;
 
     RpcTransportCtx() = default;
 };
@@ -171,6 +193,17 @@ protected:
     RpcTransportCtxFactory() = default;
 };
 
+// Busy polling of reads on the connections of a session, see
+// RpcSession::setBusyPollReads.
+struct RpcBusyPoll {
+    // how long to retry a read which would block before polling
+    std::chrono::microseconds spinDuration{0};
+    // reads which completed while spinning
+    std::atomic<uint64_t> hits{0};
+    // reads which still had to poll after spinDuration
+    std::atomic<uint64_t> misses{0};
+};
+
 struct RpcTransportFd final {
 private:
     mutable bool isPolling{false};
@@ -179,23 +212,29 @@ private:
 
 public:
     binder::unique_fd fd;
+    // if set, reads spin before polling
+    std::shared_ptr<RpcBusyPoll> busyPoll;
 
     RpcTransportFd() = default;
     explicit RpcTransportFd(binder::unique_fd&& descriptor)
           : isPolling(false), fd(std::move(descriptor)) {}
 
     RpcTransportFd(RpcTransportFd &&transportFd) noexcept
-          : isPolling(transportFd.isPolling), fd(std::move(transportFd.fd)) {}
+          : isPolling(transportFd.isPolling),
+            fd(std::move(transportFd.fd)),
+            busyPoll(std::move(transportFd.busyPoll)) {}
 
     RpcTransportFd &operator=(RpcTransportFd &&transportFd) noexcept {
         fd = std::move(transportFd.fd);
         isPolling = transportFd.isPolling;
+        busyPoll = std::move(transportFd.busyPoll);
         return *this;
     }
 
     RpcTransportFd& operator=(binder::unique_fd&& descriptor) noexcept {
         fd = std::move(descriptor);
         isPolling = false;
+        busyPoll = nullptr;
         return *this;
     }
 
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/String16.h>
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace android {
+
+class Parcel;
+
+namespace binder::debug {
+
+// Opt-in latency and payload size statistics for the binder transactions of
+// this process, keyed by interface descriptor, transaction code and direction.
+//
+// Outgoing transactions are measured in BpBinder::transact (kernel binder and
+// RPC alike), from the start of the call until the reply is received.
+// Incoming transactions are measured in BBinder::transact, around
+// onTransact().
+//
+// Every thread records into its own table, without locks or atomic
+// read-modify-write operations, so this can be left enabled in production.
+// snapshot() merges the tables on demand.
+class TransactionStats {
+public:
+    // Bucket 0 counts transactions which took less than 1us. Bucket i counts
+    // transactions which took [2^(i-1), 2^i) us. The last bucket has no upper
+    // bound.
+    static constexpr size_t kNumBuckets = 24;
+
+    enum class Direction : uint8_t {
+        OUTGOING,
+        INCOMING,
+    };
+
+    struct Entry {
+        String16 descriptor; // empty if it couldn't be determined
+        uint32_t code = 0;
+        Direction direction = Direction::OUTGOING;
+        uint64_t count = 0;
+        uint64_t totalNs = 0;
+        uint64_t maxNs = 0;
+        uint64_t dataBytes = 0;
+        uint64_t replyBytes = 0;
+        std::array<uint64_t, kNumBuckets> histogram{};
+    };
+
+    // Starts or stops recording. Already recorded statistics are kept.
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return sSamplingInterval.load(std::memory_order_relaxed) != 0; }
+
+    // Only records one in every 'interval' transactions of each thread (and
+    // enables recording). Must be at least 1. The default is 1.
+    static void setSamplingInterval(uint32_t interval);
+
+    // Merged statistics of all threads, including exited ones, sorted by
+    // descriptor, code and direction. Since recording threads don't
+    // synchronize with this, an entry may lag behind by the transactions
+    // being recorded concurrently.
+    static std::vector<Entry> snapshot();
+
+    // Returns a human-readable table of snapshot().
+    static std::string dump();
+
+    // For libbinder. Returns true if the transaction which the calling thread
+    // is about to make or serve should be measured. Only call record() if so.
+    static inline bool shouldSample() {
+        if (!isEnabled()) [[likely]] return false;
+        return shouldSampleSlow();
+    }
+    static uint64_t nowNs();
+    static void record(Direction direction, std::u16string_view descriptor, uint32_t code,
+                       uint64_t durationNs, size_t dataBytes, size_t replyBytes);
+    // The interface descriptor of an outgoing AIDL transaction, read from
+    // its interface token, or empty.
+    static std::u16string_view peekDescriptor(const Parcel& data);
+
+private:
+    static bool shouldSampleSlow();
+
+    // 0 if disabled
+    static std::atomic<uint32_t> sSamplingInterval;
+    // what setEnabled(true) restores
+    static std::atomic<uint32_t> sConfiguredInterval;
+};
+
+} // namespace binder::debug
+
+} // namespace android
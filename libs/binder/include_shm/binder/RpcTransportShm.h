@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Wraps the transport layer of RPC. Implementation moves data through shared
+// memory rings, and uses a unix domain socket for wakeups.
+// Note: don't use directly. You probably want newServerRpcTransportCtx / newClientRpcTransportCtx.
+
+#pragma once
+
+#include <memory>
+
+#include <binder/RpcTransport.h>
+
+namespace android {
+
+// RpcTransportCtxFactory for processes on the same host, connected over unix
+// domain sockets.
+//
+// When a connection is set up, the client creates a sealed memfd holding one
+// single-producer single-consumer ring per direction, and passes it to the
+// server over the socket. Afterwards, data is copied once into the ring,
+// rather than through the kernel, and the socket only carries wakeups (when
+// the other side is waiting) and file descriptors.
+//
+// Both sides of every connection must use this factory, and the sockets must
+// be unix domain sockets. Bootstrap sessions
+// (RpcSession::setupUnixDomainSocketBootstrapClient) and null debugging
+// clients are not supported.
+class RpcTransportCtxFactoryShm : public RpcTransportCtxFactory {
+public:
+    static std::unique_ptr<RpcTransportCtxFactory> make();
+
+    std::unique_ptr<RpcTransportCtx> newServerCtx() const override;
+    std::unique_ptr<RpcTransportCtx> newClientCtx() const override;
+    const char* toCString() const override;
+
+private:
+    RpcTransportCtxFactoryShm() = default;
+};
+
+} // namespace android
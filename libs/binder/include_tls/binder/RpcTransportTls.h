@@ -27,8 +27,22 @@ namespace android {
 // RpcTransportCtxFactory with TLS enabled with self-signed certificate.
 class RpcTransportCtxFactoryTls : public RpcTransportCtxFactory {
 public:
+    struct Options {
+        // After the handshake, install the session keys into kernel TLS, so
+        // that records are encrypted (and, for servers, decrypted) by the
+        // kernel, and reads and writes go through the plain socket. This only
+        // takes effect on TCP sockets, when the kernel supports the negotiated
+        // cipher. Otherwise, BoringSSL keeps handling all records.
+        //
+        // Clients keep decrypting in BoringSSL, since servers which don't
+        // have this enabled may still send post-handshake messages.
+        bool kernelTls = false;
+    };
+
     static std::unique_ptr<RpcTransportCtxFactory> make(std::shared_ptr<RpcCertificateVerifier>,
                                                         std::unique_ptr<RpcAuth>);
+    static std::unique_ptr<RpcTransportCtxFactory> make(std::shared_ptr<RpcCertificateVerifier>,
+                                                        std::unique_ptr<RpcAuth>, Options);
 
     std::unique_ptr<RpcTransportCtx> newServerCtx() const override;
     std::unique_ptr<RpcTransportCtx> newClientCtx() const override;
@@ -36,11 +50,12 @@ public:
 
 private:
     RpcTransportCtxFactoryTls(std::shared_ptr<RpcCertificateVerifier> verifier,
-                              std::unique_ptr<RpcAuth> auth)
-          : mCertVerifier(std::move(verifier)), mAuth(std::move(auth)){};
+                              std::unique_ptr<RpcAuth> auth, Options options)
+          : mCertVerifier(std::move(verifier)), mAuth(std::move(auth)), mOptions(options){};
 
     std::shared_ptr<RpcCertificateVerifier> mCertVerifier;
     std::unique_ptr<RpcAuth> mAuth;
+    Options mOptions;
 };
 
 } // namespace android
@@ -1207,6 +1207,122 @@ binder_status_t AParcel_marshal(const AParcel* parcel, uint8_t* buffer, size_t s
 binder_status_t AParcel_unmarshal(AParcel* parcel, const uint8_t* buffer, size_t len)
         __INTRODUCED_IN(33);
 
+/**
+ * This is called to get the underlying data from an arrayData object.
+ *
+ * The implementation of this function should allocate a contiguous array of size 'length' and
+ * return that underlying buffer to be filled out. If there is an error or length is 0, null may be
+ * returned. If length is -1, this should allocate some representation of a null array.
+ *
+ * See also AParcel_readBoolBuffer
+ *
+ * \param arrayData some external representation of an array of bool.
+ * \param length the length to allocate arrayData to.
+ * \param outBuffer a buffer of bool of size 'length' (if length is >= 0, if length is 0, this may
+ * be nullptr).
+ *
+ * \return whether or not the allocation was successful (or whether a null array is represented when
+ * length is -1).
+ */
+typedef bool (*AParcel_boolBufferAllocator)(void* arrayData, int32_t length, bool** outBuffer);
+
+/**
+ * Writes an array of bool from a contiguous buffer to the next location in a non-null parcel.
+ *
+ * This writes the same data as AParcel_writeBoolArray, without calling back for every element.
+ *
+ * Available since API level 36.
+ *
+ * \param parcel the parcel to write to.
+ * \param arrayData an array of size 'length' (or null if length is -1, may be null if length is 0).
+ * \param length the length of arrayData or -1 to represent a null array.
+ *
+ * \return STATUS_OK on successful write.
+ */
+binder_status_t AParcel_writeBoolBuffer(AParcel* parcel, const bool* arrayData, int32_t length)
+        __INTRODUCED_IN(36);
+
+/**
+ * Reads an array of bool into a contiguous buffer from the next location in a non-null parcel.
+ *
+ * This reads the same data as AParcel_readBoolArray. First, allocator will be called with the
+ * length of the array. If the allocation succeeds and the length is greater than zero, the buffer
+ * returned by the allocator will be filled with the corresponding data, without calling back for
+ * every element.
+ *
+ * Available since API level 36.
+ *
+ * \param parcel the parcel to read from.
+ * \param arrayData some external representation of an array.
+ * \param allocator the callback that will be called to allocate the array.
+ *
+ * \return STATUS_OK on successful read.
+ */
+binder_status_t AParcel_readBoolBuffer(const AParcel* parcel, void* arrayData,
+                                       AParcel_boolBufferAllocator allocator) __INTRODUCED_IN(36);
+
+/**
+ * This is called once to allocate all of the strings of an array read by
+ * AParcel_readStringArrayArena.
+ *
+ * If length is -1, then a 'null' array (or equivalent) should be created, and no buffers are
+ * returned. Otherwise, 'outArena' should be set to a buffer of 'arenaSize' bytes, which will hold
+ * all of the strings, each with a null-terminator, and 'outElements' to an array of 'length'
+ * pointers, which will be set to the strings in the arena, or to null for 'null' strings.
+ * 'outLengths' may be set to an array of 'length' lengths, which will be set to the length of every
+ * string (not including the null-terminator), or to -1 for 'null' strings, or to null if they are
+ * not needed. If length or arenaSize are 0, the corresponding buffers may be null.
+ *
+ * See also AParcel_readStringArrayArena
+ *
+ * \param arrayData some external representation of an array.
+ * \param length the length of the array, or -1 for a 'null' array.
+ * \param arenaSize the number of bytes needed for all of the strings.
+ * \param outArena a buffer of size 'arenaSize'.
+ * \param outElements a buffer of size 'length'.
+ * \param outLengths a buffer of size 'length', or null.
+ *
+ * \return true if the allocation succeeded, false otherwise. If length is -1, a true return here
+ * means that a 'null' value (or equivalent) was successfully stored.
+ */
+typedef bool (*AParcel_stringArrayArenaAllocator)(void* arrayData, int32_t length,
+                                                  size_t arenaSize, char** outArena,
+                                                  const char*** outElements, int32_t** outLengths);
+
+/**
+ * Reads utf-8 string array data from the next location in a non-null parcel into a single buffer.
+ *
+ * This reads the same data as AParcel_readStringArray, but only calls the allocator once, with the
+ * total size of the strings. See AParcel_stringArrayArenaAllocator.
+ *
+ * Available since API level 36.
+ *
+ * \param parcel the parcel to read from.
+ * \param arrayData some external representation of an array.
+ * \param allocator the callback that will be called with arrayData once the size of the output
+ * array and of all of its strings is known.
+ *
+ * \return STATUS_OK on successful read.
+ */
+binder_status_t AParcel_readStringArrayArena(const AParcel* parcel, void* arrayData,
+                                             AParcel_stringArrayArenaAllocator allocator)
+        __INTRODUCED_IN(36);
+
+/**
+ * Makes room in the parcel for the given number of bytes, so that writing a message of a known
+ * size, such as the arguments of a transaction, doesn't need to grow the parcel on the way. This
+ * doesn't change the data of the parcel.
+ *
+ * Available since API level 36.
+ *
+ * \param parcel The parcel of which to set the capacity.
+ * \param capacity The number of bytes to make room for.
+ *
+ * \return STATUS_OK on success. If capacity is negative, then STATUS_BAD_VALUE will be returned.
+ * STATUS_NO_MEMORY is returned if the parcel can't be grown.
+ */
+binder_status_t AParcel_setDataCapacity(AParcel* parcel, int32_t capacity) __INTRODUCED_IN(36);
+
 __END_DECLS
 
 /** @} */
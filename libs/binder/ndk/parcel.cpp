@@ -23,6 +23,7 @@
 #include <utils/Unicode.h>
 
 #include <limits>
+#include <vector>
 
 #include "ibinder_internal.h"
 #include "parcel_internal.h"
@@ -96,27 +97,31 @@ binder_status_t WriteArray(AParcel* parcel, const T* array, int32_t length) {
     return STATUS_OK;
 }
 
-// Each element in a char16_t array is converted to an int32_t (not packed).
-template <>
-binder_status_t WriteArray<char16_t>(AParcel* parcel, const char16_t* array, int32_t length) {
+// Each element in a char16_t or bool array is converted to an int32_t (not packed).
+template <typename T>
+binder_status_t WriteWidenedArray(AParcel* parcel, const T* array, int32_t length) {
     binder_status_t status = WriteAndValidateArraySize(parcel, array == nullptr, length);
     if (status != STATUS_OK) return status;
     if (length <= 0) return STATUS_OK;
 
     int32_t size = 0;
-    if (__builtin_smul_overflow(sizeof(char16_t), length, &size)) return STATUS_NO_MEMORY;
+    if (__builtin_smul_overflow(sizeof(int32_t), length, &size)) return STATUS_NO_MEMORY;
 
-    Parcel* rawParcel = parcel->get();
+    int32_t* const data = static_cast<int32_t*>(parcel->get()->writeInplace(size));
+    if (data == nullptr) return STATUS_NO_MEMORY;
 
     for (int32_t i = 0; i < length; i++) {
-        status = rawParcel->writeChar(array[i]);
-
-        if (status != STATUS_OK) return PruneStatusT(status);
+        data[i] = static_cast<int32_t>(array[i]);
     }
 
     return STATUS_OK;
 }
 
+template <>
+binder_status_t WriteArray<char16_t>(AParcel* parcel, const char16_t* array, int32_t length) {
+    return WriteWidenedArray<char16_t>(parcel, array, length);
+}
+
 template <typename T>
 binder_status_t ReadArray(const AParcel* parcel, void* arrayData,
                           ContiguousArrayAllocator<T> allocator) {
@@ -150,10 +155,9 @@ binder_status_t ReadArray(const AParcel* parcel, void* arrayData,
     return STATUS_OK;
 }
 
-// Each element in a char16_t array is converted to an int32_t (not packed)
-template <>
-binder_status_t ReadArray<char16_t>(const AParcel* parcel, void* arrayData,
-                                    ContiguousArrayAllocator<char16_t> allocator) {
+template <typename T>
+binder_status_t ReadWidenedArray(const AParcel* parcel, void* arrayData,
+                                 ContiguousArrayAllocator<T> allocator) {
     const Parcel* rawParcel = parcel->get();
 
     int32_t length;
@@ -161,7 +165,7 @@ binder_status_t ReadArray<char16_t>(const AParcel* parcel, void* arrayData,
         return status;
     }
 
-    char16_t* array;
+    T* array;
     if (!allocator(arrayData, length, &array)) {
         if (length < 0) {
             return STATUS_UNEXPECTED_NULL;
@@ -174,17 +178,24 @@ binder_status_t ReadArray<char16_t>(const AParcel* parcel, void* arrayData,
     if (array == nullptr) return STATUS_NO_MEMORY;
 
     int32_t size = 0;
-    if (__builtin_smul_overflow(sizeof(char16_t), length, &size)) return STATUS_NO_MEMORY;
+    if (__builtin_smul_overflow(sizeof(int32_t), length, &size)) return STATUS_NO_MEMORY;
 
-    for (int32_t i = 0; i < length; i++) {
-        status_t status = rawParcel->readChar(array + i);
+    const int32_t* data = static_cast<const int32_t*>(rawParcel->readInplace(size));
+    if (data == nullptr) return STATUS_NO_MEMORY;
 
-        if (status != STATUS_OK) return PruneStatusT(status);
+    for (int32_t i = 0; i < length; i++) {
+        array[i] = static_cast<T>(data[i]);
     }
 
     return STATUS_OK;
 }
 
+template <>
+binder_status_t ReadArray<char16_t>(const AParcel* parcel, void* arrayData,
+                                    ContiguousArrayAllocator<char16_t> allocator) {
+    return ReadWidenedArray<char16_t>(parcel, arrayData, allocator);
+}
+
 template <typename T>
 binder_status_t WriteArray(AParcel* parcel, const void* arrayData, int32_t length,
                            ArrayGetter<T> getter, status_t (Parcel::*write)(T)) {
@@ -461,6 +472,73 @@ binder_status_t AParcel_readStringArray(const AParcel* parcel, void* arrayData,
     return STATUS_OK;
 }
 
+binder_status_t AParcel_readStringArrayArena(const AParcel* parcel, void* arrayData,
+                                             AParcel_stringArrayArenaAllocator allocator) {
+    int32_t length;
+    if (binder_status_t status = ReadAndValidateArraySize(parcel, &length); status != STATUS_OK) {
+        return status;
+    }
+
+    if (length == -1) {
+        if (!allocator(arrayData, -1, 0, nullptr, nullptr, nullptr)) return STATUS_NO_MEMORY;
+        return STATUS_OK;  // null string array
+    }
+
+    // The strings stay in place in the parcel, so they are only parsed once, to size the arena.
+    struct InplaceString {
+        const char16_t* str16;
+        size_t len16;
+        size_t len8;
+    };
+    std::vector<InplaceString> strings(length);
+    size_t arenaSize = 0;
+    for (InplaceString& string : strings) {
+        string.str16 = parcel->get()->readString16Inplace(&string.len16);
+        if (string.str16 == nullptr) continue;  // null string
+
+        ssize_t len8 = string.len16 == 0 ? 0 : utf16_to_utf8_length(string.str16, string.len16);
+        if (len8 < 0 || len8 >= std::numeric_limits<int32_t>::max()) {
+            ALOGW("Invalid string length: %zd", len8);
+            return STATUS_BAD_VALUE;
+        }
+        string.len8 = static_cast<size_t>(len8);
+        if (__builtin_add_overflow(arenaSize, string.len8 + 1, &arenaSize)) {
+            return STATUS_NO_MEMORY;
+        }
+    }
+
+    char* arena = nullptr;
+    const char** elements = nullptr;
+    int32_t* lengths = nullptr;
+    if (!allocator(arrayData, length, arenaSize, &arena, &elements, &lengths)) {
+        return STATUS_NO_MEMORY;
+    }
+    if ((arenaSize > 0 && arena == nullptr) || (length > 0 && elements == nullptr)) {
+        ALOGW("AParcel_stringArrayArenaAllocator failed to allocate.");
+        return STATUS_NO_MEMORY;
+    }
+
+    for (int32_t i = 0; i < length; i++) {
+        const InplaceString& string = strings[i];
+        if (string.str16 == nullptr) {
+            elements[i] = nullptr;
+            if (lengths != nullptr) lengths[i] = -1;
+            continue;
+        }
+
+        if (string.len16 == 0) {
+            arena[0] = '\0';
+        } else {
+            utf16_to_utf8(string.str16, string.len16, arena, string.len8 + 1);
+        }
+        elements[i] = arena;
+        if (lengths != nullptr) lengths[i] = static_cast<int32_t>(string.len8);
+        arena += string.len8 + 1;
+    }
+
+    return STATUS_OK;
+}
+
 binder_status_t AParcel_writeParcelableArray(AParcel* parcel, const void* arrayData, int32_t length,
                                              AParcel_writeParcelableElement elementWriter) {
     // we have no clue if arrayData represents a null object or not, we can only infer from length
@@ -621,6 +699,10 @@ binder_status_t AParcel_writeBoolArray(AParcel* parcel, const void* arrayData, i
     return WriteArray<bool>(parcel, arrayData, length, getter, &Parcel::writeBool);
 }
 
+binder_status_t AParcel_writeBoolBuffer(AParcel* parcel, const bool* arrayData, int32_t length) {
+    return WriteWidenedArray<bool>(parcel, arrayData, length);
+}
+
 binder_status_t AParcel_writeCharArray(AParcel* parcel, const char16_t* arrayData, int32_t length) {
     return WriteArray<char16_t>(parcel, arrayData, length);
 }
@@ -665,6 +747,11 @@ binder_status_t AParcel_readBoolArray(const AParcel* parcel, void* arrayData,
     return ReadArray<bool>(parcel, arrayData, allocator, setter, &Parcel::readBool);
 }
 
+binder_status_t AParcel_readBoolBuffer(const AParcel* parcel, void* arrayData,
+                                       AParcel_boolBufferAllocator allocator) {
+    return ReadWidenedArray<bool>(parcel, arrayData, allocator);
+}
+
 binder_status_t AParcel_readCharArray(const AParcel* parcel, void* arrayData,
                                       AParcel_charArrayAllocator allocator) {
     return ReadArray<char16_t>(parcel, arrayData, allocator);
@@ -688,6 +775,13 @@ int32_t AParcel_getDataSize(const AParcel* parcel) {
     return parcel->get()->dataSize();
 }
 
+binder_status_t AParcel_setDataCapacity(AParcel* parcel, int32_t capacity) {
+    if (capacity < 0) {
+        return STATUS_BAD_VALUE;
+    }
+    return PruneStatusT(parcel->get()->setDataCapacity(capacity));
+}
+
 binder_status_t AParcel_appendFrom(const AParcel* from, AParcel* to, int32_t start, int32_t size) {
     status_t status = to->get()->appendFrom(from->get(), start, size);
     return PruneStatusT(status);
@@ -801,6 +801,80 @@ TEST(NdkBinder, ConvertToPlatformParcel) {
     EXPECT_EQ(42, pparcel->readInt32());
 }
 
+TEST(NdkBinder, BoolBufferMatchesBoolArray) {
+    ndk::ScopedAParcel parcel = ndk::ScopedAParcel(AParcel_create());
+    const bool written[] = {true, false, false, true, true};
+    ASSERT_EQ(STATUS_OK, AParcel_writeBoolBuffer(parcel.get(), written, std::size(written)));
+    ASSERT_EQ(STATUS_OK, AParcel_writeBoolBuffer(parcel.get(), nullptr, -1));
+
+    AParcel_setDataPosition(parcel.get(), 0);
+    std::vector<bool> read;
+    ASSERT_EQ(STATUS_OK, ::ndk::AParcel_readVector(parcel.get(), &read));
+    EXPECT_EQ(std::vector<bool>(std::begin(written), std::end(written)), read);
+
+    AParcel_setDataPosition(parcel.get(), 0);
+    std::vector<uint8_t> buffer;  // not std::vector<bool>, for a contiguous buffer
+    auto allocator = [](void* arrayData, int32_t length, bool** outBuffer) {
+        if (length < 0) return false;
+        auto vec = static_cast<std::vector<uint8_t>*>(arrayData);
+        vec->resize(length);
+        *outBuffer = reinterpret_cast<bool*>(vec->data());
+        return true;
+    };
+    ASSERT_EQ(STATUS_OK, AParcel_readBoolBuffer(parcel.get(), &buffer, allocator));
+    EXPECT_EQ(std::vector<uint8_t>({1, 0, 0, 1, 1}), buffer);
+    EXPECT_EQ(STATUS_UNEXPECTED_NULL, AParcel_readBoolBuffer(parcel.get(), &buffer, allocator));
+}
+
+TEST(NdkBinder, SetDataCapacity) {
+    ndk::ScopedAParcel parcel = ndk::ScopedAParcel(AParcel_create());
+    EXPECT_EQ(STATUS_BAD_VALUE, AParcel_setDataCapacity(parcel.get(), -1));
+    ASSERT_EQ(STATUS_OK, AParcel_setDataCapacity(parcel.get(), 1000));
+    EXPECT_EQ(0, AParcel_getDataSize(parcel.get()));
+
+    ASSERT_EQ(STATUS_OK, AParcel_writeInt32(parcel.get(), 42));
+    AParcel_setDataPosition(parcel.get(), 0);
+    int32_t value = 0;
+    ASSERT_EQ(STATUS_OK, AParcel_readInt32(parcel.get(), &value));
+    EXPECT_EQ(42, value);
+}
+
+TEST(NdkBinder, ReadStringArrayIntoArena) {
+    ndk::ScopedAParcel parcel = ndk::ScopedAParcel(AParcel_create());
+    const std::optional<std::vector<std::optional<std::string>>> written =
+            std::vector<std::optional<std::string>>{"foo", std::nullopt, "", "\u00e9t\u00e9"};
+    ASSERT_EQ(STATUS_OK, ::ndk::AParcel_writeVector(parcel.get(), written));
+
+    struct Arena {
+        std::vector<char> arena;
+        std::vector<const char*> elements;
+        std::vector<int32_t> lengths;
+    } arena;
+    auto allocator = [](void* arrayData, int32_t length, size_t arenaSize, char** outArena,
+                        const char*** outElements, int32_t** outLengths) {
+        if (length < 0) return false;
+        auto a = static_cast<Arena*>(arrayData);
+        a->arena.resize(arenaSize);
+        a->elements.resize(length);
+        a->lengths.resize(length);
+        *outArena = a->arena.data();
+        *outElements = a->elements.data();
+        *outLengths = a->lengths.data();
+        return true;
+    };
+
+    AParcel_setDataPosition(parcel.get(), 0);
+    ASSERT_EQ(STATUS_OK, AParcel_readStringArrayArena(parcel.get(), &arena, allocator));
+    ASSERT_EQ(4u, arena.elements.size());
+    // "\u00e9t\u00e9" is 5 bytes of UTF-8, and every string has a null-terminator
+    EXPECT_EQ(4u + 1u + 6u, arena.arena.size());
+    EXPECT_STREQ("foo", arena.elements[0]);
+    EXPECT_EQ(nullptr, arena.elements[1]);
+    EXPECT_STREQ("", arena.elements[2]);
+    EXPECT_STREQ("\u00e9t\u00e9", arena.elements[3]);
+    EXPECT_EQ(std::vector<int32_t>({3, -1, 0, 5}), arena.lengths);
+}
+
 TEST(NdkBinder, GetAndVerifyScopedAIBinder_Weak) {
     for (const ndk::SpAIBinder& binder :
          {// remote
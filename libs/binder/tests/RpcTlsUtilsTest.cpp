@@ -18,6 +18,10 @@
 #include <binder/RpcTlsUtils.h>
 #include <gtest/gtest.h>
 
+#include <vector>
+
+#include "../RpcKernelTls.h"
+
 namespace android {
 
 std::string toDebugString(EVP_PKEY* pkey) {
@@ -111,4 +115,66 @@ INSTANTIATE_TEST_CASE_P(RpcTlsUtilsTest, RpcTlsUtilsKeyAndCertTest,
                                                          RpcCertificateFormat::DER)),
                         RpcTlsUtilsKeyAndCertTest::PrintParamInfo);
 
+// Traffic secrets and the keys derived from them, from the simple 1-RTT
+// handshake in RFC 8448, which has the example traces for RFC 8446. Both use
+// TLS_AES_128_GCM_SHA256.
+constexpr uint8_t kServerHandshakeTrafficSecret[] = {
+        0xb6, 0x7b, 0x7d, 0x69, 0x0c, 0xc1, 0x6c, 0x4e, 0x75, 0xe5, 0x42,
+        0x13, 0xcb, 0x2d, 0x37, 0xb4, 0xe9, 0xc9, 0x12, 0xbc, 0xde, 0xd9,
+        0x10, 0x5d, 0x42, 0xbe, 0xfd, 0x59, 0xd3, 0x91, 0xad, 0x38,
+};
+constexpr uint8_t kServerHandshakeKey[] = {
+        0x3f, 0xce, 0x51, 0x60, 0x09, 0xc2, 0x17, 0x27,
+        0xd0, 0xf2, 0xe4, 0xe8, 0x6e, 0xe4, 0x03, 0xbc,
+};
+constexpr uint8_t kServerHandshakeIv[] = {
+        0x5d, 0x31, 0x3e, 0xb2, 0x67, 0x12, 0x76, 0xee, 0x13, 0x00, 0x0b, 0x30,
+};
+constexpr uint8_t kServerApplicationTrafficSecret[] = {
+        0xa1, 0x1a, 0xf9, 0xf0, 0x55, 0x31, 0xf8, 0x56, 0xad, 0x47, 0x11,
+        0x6b, 0x45, 0xa9, 0x50, 0x32, 0x82, 0x04, 0xb4, 0xf4, 0x4b, 0xfb,
+        0x6b, 0x3a, 0x4b, 0x4f, 0x1f, 0x3f, 0xcb, 0x63, 0x16, 0x43,
+};
+constexpr uint8_t kServerApplicationKey[] = {
+        0x9f, 0x02, 0x28, 0x3b, 0x6c, 0x9c, 0x07, 0xef,
+        0xc2, 0x6b, 0xb9, 0xf2, 0xac, 0x92, 0xe3, 0x56,
+};
+constexpr uint8_t kServerApplicationIv[] = {
+        0xcf, 0x78, 0x2b, 0x88, 0xdd, 0x83, 0x54, 0x9a, 0xad, 0xf1, 0xe9, 0x84,
+};
+
+template <size_t N>
+std::vector<uint8_t> toVector(const uint8_t (&bytes)[N]) {
+    return std::vector<uint8_t>(bytes, bytes + N);
+}
+
+TEST(RpcKernelTlsTest, HkdfExpandLabel) {
+    std::vector<uint8_t> key(sizeof(kServerHandshakeKey));
+    ASSERT_TRUE(hkdfExpandLabel(key.data(), key.size(), EVP_sha256(),
+                                kServerHandshakeTrafficSecret, "key"));
+    EXPECT_EQ(toVector(kServerHandshakeKey), key);
+
+    std::vector<uint8_t> iv(sizeof(kServerHandshakeIv));
+    ASSERT_TRUE(hkdfExpandLabel(iv.data(), iv.size(), EVP_sha256(), kServerHandshakeTrafficSecret,
+                                "iv"));
+    EXPECT_EQ(toVector(kServerHandshakeIv), iv);
+}
+
+TEST(RpcKernelTlsTest, CryptoInfo) {
+    tls12_crypto_info_aes_gcm_128 info;
+    ASSERT_TRUE(makeKernelTlsCryptoInfo(&info, TLS_CIPHER_AES_GCM_128, EVP_sha256(),
+                                        kServerApplicationTrafficSecret, 0x0102030405060708));
+    EXPECT_EQ(TLS_1_3_VERSION, info.info.version);
+    EXPECT_EQ(TLS_CIPHER_AES_GCM_128, info.info.cipher_type);
+    EXPECT_EQ(toVector(kServerApplicationKey), toVector(info.key));
+
+    // The kernel takes the IV split into the salt and the rest.
+    std::vector<uint8_t> iv = toVector(info.salt);
+    iv.insert(iv.end(), std::begin(info.iv), std::end(info.iv));
+    EXPECT_EQ(toVector(kServerApplicationIv), iv);
+
+    // The sequence number is big endian.
+    EXPECT_EQ((std::vector<uint8_t>{1, 2, 3, 4, 5, 6, 7, 8}), toVector(info.rec_seq));
+}
+
 } // namespace android
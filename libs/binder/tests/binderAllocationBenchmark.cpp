@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/logging.h>
+#include <android/binder_ibinder.h>
+#include <android/binder_manager.h>
+#include <android/binder_parcel.h>
+#include <android/binder_status.h>
+#include <benchmark/benchmark.h>
+#include <binder/IBinder.h>
+#include <binder/IPCThreadState.h>
+#include <binder/IServiceManager.h>
+#include <binder/Parcel.h>
+#include <binder/Status.h>
+
+#include <malloc.h>
+#include <string>
+#include <vector>
+
+// Usage: atest binderAllocationBenchmark
+//
+// Reports the heap allocations ("allocs") and allocated bytes ("bytes") of
+// one operation on each of the hot paths of libbinder, next to the time it
+// takes. binderAllocationLimits checks the cases which must not allocate at
+// all, this is for tracking the others over time, e.g. with:
+//   binderAllocationBenchmark --benchmark_out=allocs.json --benchmark_out_format=json
+
+using android::IBinder;
+using android::IPCThreadState;
+using android::Parcel;
+using android::sp;
+using android::status_t;
+using android::String16;
+using android::String8;
+using android::binder::Status;
+
+// Only allocations of the benchmark thread are counted, and only while it is
+// running the operation, not the benchmark itself.
+static thread_local bool tCounting = false;
+static thread_local size_t tAllocations = 0;
+static thread_local size_t tBytes = 0;
+
+static const decltype(__malloc_hook) orig_malloc_hook = __malloc_hook;
+static const decltype(__realloc_hook) orig_realloc_hook = __realloc_hook;
+
+static void* counting_malloc_hook(size_t bytes, const void* arg) {
+    if (tCounting) {
+        tAllocations++;
+        tBytes += bytes;
+    }
+    return orig_malloc_hook(bytes, arg);
+}
+
+static void* counting_realloc_hook(void* ptr, size_t bytes, const void* arg) {
+    if (tCounting) {
+        tAllocations++;
+        tBytes += bytes;
+    }
+    return orig_realloc_hook(ptr, bytes, arg);
+}
+
+// Runs op for the benchmark, and reports its allocations per iteration.
+template <typename F>
+static void MeasureAllocations(benchmark::State& state, F&& op) {
+    tAllocations = 0;
+    tBytes = 0;
+    while (state.KeepRunning()) {
+        tCounting = true;
+        op();
+        tCounting = false;
+    }
+    state.counters["allocs"] = benchmark::Counter(tAllocations, benchmark::Counter::kAvgIterations);
+    state.counters["bytes"] = benchmark::Counter(tBytes, benchmark::Counter::kAvgIterations);
+}
+
+// exported symbol, to force compiler not to optimize away what we read here
+const void* imaginary_use;
+
+// Parcel
+
+template <typename T, status_t (Parcel::*Write)(T), status_t (Parcel::*Read)(T*) const>
+static void BM_ParcelPrimitive(benchmark::State& state) {
+    Parcel p;
+    T value{};
+    MeasureAllocations(state, [&] {
+        p.setDataPosition(0);
+        (p.*Write)(value);
+        p.setDataPosition(0);
+        (p.*Read)(&value);
+    });
+}
+
+template <typename T, status_t (Parcel::*Write)(const T&), status_t (Parcel::*Read)(T*) const>
+static void BM_ParcelObject(benchmark::State& state, T value) {
+    Parcel p;
+    T out{};
+    MeasureAllocations(state, [&] {
+        p.setDataPosition(0);
+        (p.*Write)(value);
+        p.setDataPosition(0);
+        (p.*Read)(&out);
+    });
+}
+
+static void BM_ParcelNullStrongBinder(benchmark::State& state) {
+    Parcel p;
+    sp<IBinder> binder;
+    MeasureAllocations(state, [&] {
+        p.setDataPosition(0);
+        p.writeStrongBinder(nullptr);
+        p.setDataPosition(0);
+        p.readNullableStrongBinder(&binder);
+    });
+}
+BENCHMARK(BM_ParcelNullStrongBinder);
+
+static void BM_ParcelOnStack(benchmark::State& state) {
+    MeasureAllocations(state, [&] {
+        Parcel p;
+        imaginary_use = p.data();
+    });
+}
+BENCHMARK(BM_ParcelOnStack);
+
+// A new parcel for each message, as the proxies and stubs of transactions use.
+static void BM_ParcelSmallMessage(benchmark::State& state) {
+    MeasureAllocations(state, [&] {
+        Parcel p;
+        p.writeInt32(0);
+        p.writeInt64(0);
+        imaginary_use = p.data();
+    });
+}
+BENCHMARK(BM_ParcelSmallMessage);
+
+// A message of 1KB, with or without making room for it first.
+static void BM_ParcelLargeMessage(benchmark::State& state) {
+    const bool hint = state.range(0) != 0;
+    MeasureAllocations(state, [&] {
+        Parcel p;
+        if (hint) {
+            p.setDataCapacity(1024);
+        }
+        for (int i = 0; i < 128; i++) {
+            p.writeInt64(i);
+        }
+        imaginary_use = p.data();
+    });
+}
+BENCHMARK(BM_ParcelLargeMessage)->ArgName("hint")->Arg(0)->Arg(1);
+
+// Status
+
+static void BM_StatusOk(benchmark::State& state) {
+    MeasureAllocations(state, [&] {
+        Status status = Status::ok();
+        imaginary_use = &status;
+    });
+}
+BENCHMARK(BM_StatusOk);
+
+static void BM_StatusException(benchmark::State& state) {
+    MeasureAllocations(state, [&] {
+        Status status = Status::fromExceptionCode(Status::EX_ILLEGAL_ARGUMENT);
+        imaginary_use = &status;
+    });
+}
+BENCHMARK(BM_StatusException);
+
+static void BM_StatusServiceSpecificWithMessage(benchmark::State& state) {
+    MeasureAllocations(state, [&] {
+        Status status = Status::fromServiceSpecificError(1, "a message");
+        imaginary_use = &status;
+    });
+}
+BENCHMARK(BM_StatusServiceSpecificWithMessage);
+
+// Transactions, to the service manager, which is handle 0
+
+static void BM_BpBinderTransact(benchmark::State& state) {
+    sp<IBinder> binder = android::defaultServiceManager()->checkService(String16("manager"));
+    CHECK(binder != nullptr);
+    Parcel data, reply;
+    MeasureAllocations(state, [&] {
+        binder->transact(IBinder::PING_TRANSACTION, data, &reply);
+    });
+}
+BENCHMARK(BM_BpBinderTransact);
+
+static void BM_IPCThreadStateTransact(benchmark::State& state) {
+    IPCThreadState* self = IPCThreadState::self();
+    Parcel data, reply;
+    MeasureAllocations(state, [&] {
+        self->transact(0 /*handle*/, IBinder::PING_TRANSACTION, data, &reply, 0 /*flags*/);
+    });
+}
+BENCHMARK(BM_IPCThreadStateTransact);
+
+// NDK
+
+static void BM_NdkParcel(benchmark::State& state) {
+    MeasureAllocations(state, [&] {
+        AParcel* parcel = AParcel_create();
+        int32_t value = 0;
+        AParcel_writeInt32(parcel, value);
+        AParcel_setDataPosition(parcel, 0);
+        AParcel_readInt32(parcel, &value);
+        AParcel_delete(parcel);
+    });
+}
+BENCHMARK(BM_NdkParcel);
+
+static void BM_NdkStatus(benchmark::State& state) {
+    MeasureAllocations(state, [&] {
+        AStatus_delete(AStatus_fromServiceSpecificErrorWithMessage(1, "a message"));
+    });
+}
+BENCHMARK(BM_NdkStatus);
+
+static void BM_NdkPing(benchmark::State& state) {
+    AIBinder* binder = AServiceManager_checkService("manager");
+    CHECK(binder != nullptr);
+    MeasureAllocations(state, [&] { AIBinder_ping(binder); });
+    AIBinder_decStrong(binder);
+}
+BENCHMARK(BM_NdkPing);
+
+static void RegisterParcelBenchmarks() {
+    using benchmark::RegisterBenchmark;
+    RegisterBenchmark("BM_Parcel/bool",
+                      BM_ParcelPrimitive<bool, &Parcel::writeBool, &Parcel::readBool>);
+    RegisterBenchmark("BM_Parcel/int32",
+                      BM_ParcelPrimitive<int32_t, &Parcel::writeInt32, &Parcel::readInt32>);
+    RegisterBenchmark("BM_Parcel/int64",
+                      BM_ParcelPrimitive<int64_t, &Parcel::writeInt64, &Parcel::readInt64>);
+    RegisterBenchmark("BM_Parcel/uint64",
+                      BM_ParcelPrimitive<uint64_t, &Parcel::writeUint64, &Parcel::readUint64>);
+    RegisterBenchmark("BM_Parcel/float",
+                      BM_ParcelPrimitive<float, &Parcel::writeFloat, &Parcel::readFloat>);
+    RegisterBenchmark("BM_Parcel/double",
+                      BM_ParcelPrimitive<double, &Parcel::writeDouble, &Parcel::readDouble>);
+    RegisterBenchmark("BM_Parcel/String16",
+                      BM_ParcelObject<String16, &Parcel::writeString16, &Parcel::readString16>,
+                      String16("a binder string"));
+    RegisterBenchmark("BM_Parcel/String8",
+                      BM_ParcelObject<String8, &Parcel::writeString8, &Parcel::readString8>,
+                      String8("a binder string"));
+    RegisterBenchmark("BM_Parcel/Utf8AsUtf16",
+                      BM_ParcelObject<std::string, &Parcel::writeUtf8AsUtf16,
+                                      &Parcel::readUtf8FromUtf16>,
+                      std::string("a binder string"));
+    RegisterBenchmark("BM_Parcel/ByteVector",
+                      BM_ParcelObject<std::vector<uint8_t>, &Parcel::writeByteVector,
+                                      &Parcel::readByteVector>,
+                      std::vector<uint8_t>(64));
+    RegisterBenchmark("BM_Parcel/Int32Vector",
+                      BM_ParcelObject<std::vector<int32_t>, &Parcel::writeInt32Vector,
+                                      &Parcel::readInt32Vector>,
+                      std::vector<int32_t>(64));
+    RegisterBenchmark("BM_Parcel/String16Vector",
+                      BM_ParcelObject<std::vector<String16>, &Parcel::writeString16Vector,
+                                      &Parcel::readString16Vector>,
+                      std::vector<String16>(8, String16("a binder string")));
+}
+
+int main(int argc, char** argv) {
+    if (getenv("LIBC_HOOKS_ENABLE") == nullptr) {
+        CHECK(0 == setenv("LIBC_HOOKS_ENABLE", "1", true /*overwrite*/));
+        execv(argv[0], argv);
+        return 1;
+    }
+    __malloc_hook = counting_malloc_hook;
+    __realloc_hook = counting_realloc_hook;
+
+    RegisterParcelBenchmarks();
+    ::benchmark::Initialize(&argc, argv);
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    ::benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
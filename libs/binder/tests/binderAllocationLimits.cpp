@@ -213,15 +213,22 @@ TEST(BinderAllocation, SmallTransaction) {
     String16 empty_descriptor = String16("");
     sp<IServiceManager> manager = defaultServiceManager();
 
-    size_t mallocs = 0;
-    const auto on_malloc = OnMalloc([&](size_t bytes) {
-        mallocs++;
-        // Parcel should allocate a small amount by default
-        EXPECT_EQ(bytes, 128);
-    });
-    manager->checkService(empty_descriptor);
+    {
+        size_t mallocs = 0;
+        const auto on_malloc = OnMalloc([&](size_t bytes) {
+            mallocs++;
+            // Parcel should allocate a small amount by default
+            EXPECT_EQ(bytes, 256);
+        });
+        manager->checkService(empty_descriptor);
 
-    EXPECT_EQ(mallocs, 1);
+        // None if the thread has a small buffer left by an earlier parcel.
+        EXPECT_LE(mallocs, 1);
+    }
+
+    // The buffer of the first transaction is reused.
+    const auto m = ScopeDisallowMalloc();
+    manager->checkService(empty_descriptor);
 }
 
 TEST(RpcBinderAllocation, SetupRpcServer) {
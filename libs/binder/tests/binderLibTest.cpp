@@ -20,6 +20,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <atomic>
 #include <chrono>
 #include <fstream>
 #include <thread>
@@ -38,6 +39,7 @@
 #include <binder/IServiceManager.h>
 #include <binder/RpcServer.h>
 #include <binder/RpcSession.h>
+#include <binder/TransactionStats.h>
 #include <binder/unique_fd.h>
 #include <utils/Flattenable.h>
 
@@ -47,6 +49,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 
+#include "../ServiceCache.h"
 #include "../binder_module.h"
 
 #define ARRAY_SIZE(array) (sizeof array / sizeof array[0])
@@ -122,6 +125,7 @@ enum BinderLibTestTranscationCode {
     BINDER_LIB_TEST_GET_MAX_THREAD_COUNT,
     BINDER_LIB_TEST_SET_MAX_THREAD_COUNT,
     BINDER_LIB_TEST_IS_THREADPOOL_STARTED,
+    BINDER_LIB_TEST_GET_THREADPOOL_CPU_STATS,
     BINDER_LIB_TEST_LOCK_UNLOCK,
     BINDER_LIB_TEST_PROCESS_LOCK,
     BINDER_LIB_TEST_UNLOCK_AFTER_MS,
@@ -449,6 +453,26 @@ class TestDeathRecipient : public IBinder::DeathRecipient, public BinderLibTestE
         };
 };
 
+// Records the callbacks a ServiceCache registers, instead of passing them to servicemanager.
+class ServiceCacheTestServiceManager : public os::IServiceManagerDefault {
+public:
+    binder::Status registerForNotifications(const std::string& name,
+                                            const sp<os::IServiceCallback>& callback) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        mCallbacks.emplace_back(name, callback);
+        return binder::Status::ok();
+    }
+
+    std::vector<std::pair<std::string, sp<os::IServiceCallback>>> callbacks() {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mCallbacks;
+    }
+
+private:
+    std::mutex mLock;
+    std::vector<std::pair<std::string, sp<os::IServiceCallback>>> mCallbacks;
+};
+
 TEST_F(BinderLibTest, CannotUseBinderAfterFork) {
     // EXPECT_DEATH works by forking the process
     EXPECT_DEATH({ ProcessState::self(); }, "libbinder ProcessState can not be used after fork");
@@ -487,6 +511,44 @@ TEST_F(BinderLibTest, NopTransactionClear) {
                 StatusEq(NO_ERROR));
 }
 
+TEST_F(BinderLibTest, TransactionStatsRecordsOutgoingCalls) {
+    using android::binder::debug::TransactionStats;
+    auto countCalls = [] {
+        for (const auto& entry : TransactionStats::snapshot()) {
+            if (entry.descriptor == binderLibTestServiceName &&
+                entry.code == BINDER_LIB_TEST_NOP_TRANSACTION &&
+                entry.direction == TransactionStats::Direction::OUTGOING) {
+                uint64_t histogramCount = 0;
+                for (uint64_t bucket : entry.histogram) histogramCount += bucket;
+                EXPECT_EQ(entry.count, histogramCount);
+                EXPECT_GE(entry.totalNs, entry.maxNs);
+                return entry.count;
+            }
+        }
+        return uint64_t(0);
+    };
+    uint64_t before = countCalls();
+
+    TransactionStats::setSamplingInterval(1);
+    auto disable = make_scope_guard([] { TransactionStats::setEnabled(false); });
+    constexpr size_t kCalls = 10;
+    for (size_t i = 0; i < kCalls; i++) {
+        Parcel data, reply;
+        data.writeInterfaceToken(binderLibTestServiceName);
+        EXPECT_THAT(m_server->transact(BINDER_LIB_TEST_NOP_TRANSACTION, data, &reply),
+                    StatusEq(NO_ERROR));
+    }
+    EXPECT_EQ(before + kCalls, countCalls());
+
+    TransactionStats::setEnabled(false);
+    Parcel data, reply;
+    data.writeInterfaceToken(binderLibTestServiceName);
+    EXPECT_THAT(m_server->transact(BINDER_LIB_TEST_NOP_TRANSACTION, data, &reply),
+                StatusEq(NO_ERROR));
+    EXPECT_EQ(before + kCalls, countCalls());
+    EXPECT_NE(std::string::npos, TransactionStats::dump().find("test.binderLib"));
+}
+
 TEST_F(BinderLibTest, Freeze) {
     Parcel data, reply, replypid;
     std::ifstream freezer_file("/sys/fs/cgroup/uid_0/cgroup.freeze");
@@ -806,6 +868,113 @@ TEST_F(BinderLibTest, DeathNotificationThread)
     EXPECT_THAT(callback->getResult(), StatusEq(NO_ERROR));
 }
 
+TEST_F(BinderLibTest, ServiceCacheHit) {
+    auto sm = sp<ServiceCacheTestServiceManager>::make();
+    auto cache = sp<ServiceCache>::make(sm, std::set<std::string>{"cached"});
+    sp<IBinder> server = addServer();
+    ASSERT_NE(nullptr, server);
+
+    EXPECT_EQ(nullptr, cache->lookup("cached"));
+    cache->maybeAdd("cached", server);
+    EXPECT_EQ(server, cache->lookup("cached"));
+
+    // Only the configured names are cached
+    cache->maybeAdd("uncached", server);
+    EXPECT_EQ(nullptr, cache->lookup("uncached"));
+
+    // Nor are local binders, which can't be linked to
+    cache->remove("cached");
+    EXPECT_EQ(nullptr, cache->lookup("cached"));
+    cache->maybeAdd("cached", sp<BBinder>::make());
+    EXPECT_EQ(nullptr, cache->lookup("cached"));
+}
+
+TEST_F(BinderLibTest, ServiceCacheEvictsOldestEntry) {
+    auto sm = sp<ServiceCacheTestServiceManager>::make();
+    auto cache = sp<ServiceCache>::make(sm, std::set<std::string>{"first", "second", "third"},
+                                        2 /* maxEntries */);
+    sp<IBinder> server = addServer();
+    ASSERT_NE(nullptr, server);
+
+    cache->maybeAdd("first", server);
+    cache->maybeAdd("second", server);
+    EXPECT_EQ(server, cache->lookup("first"));
+    EXPECT_EQ(server, cache->lookup("second"));
+
+    cache->maybeAdd("third", server);
+    EXPECT_EQ(nullptr, cache->lookup("first"));
+    EXPECT_EQ(server, cache->lookup("second"));
+    EXPECT_EQ(server, cache->lookup("third"));
+
+    // An evicted name is cached again, evicting the next oldest
+    cache->maybeAdd("first", server);
+    EXPECT_EQ(server, cache->lookup("first"));
+    EXPECT_EQ(nullptr, cache->lookup("second"));
+    EXPECT_EQ(server, cache->lookup("third"));
+}
+
+TEST_F(BinderLibTest, ServiceCacheRegistersOneCallback) {
+    auto sm = sp<ServiceCacheTestServiceManager>::make();
+    auto cache = sp<ServiceCache>::make(sm, std::set<std::string>{"first", "second"});
+    sp<IBinder> server = addServer();
+    ASSERT_NE(nullptr, server);
+
+    cache->maybeAdd("first", server);
+    cache->maybeAdd("second", server);
+    cache->remove("first");
+    cache->maybeAdd("first", server);
+
+    // The cache itself is the callback, once per name
+    auto callbacks = sm->callbacks();
+    ASSERT_EQ(2u, callbacks.size());
+    EXPECT_EQ("first", callbacks[0].first);
+    EXPECT_EQ("second", callbacks[1].first);
+    EXPECT_EQ(IInterface::asBinder(callbacks[0].second), IInterface::asBinder(cache));
+    EXPECT_EQ(IInterface::asBinder(callbacks[1].second), IInterface::asBinder(cache));
+}
+
+TEST_F(BinderLibTest, ServiceCacheInvalidatedOnReregistration) {
+    auto sm = sp<ServiceCacheTestServiceManager>::make();
+    auto cache = sp<ServiceCache>::make(sm, std::set<std::string>{"cached"});
+    sp<IBinder> server = addServer();
+    ASSERT_NE(nullptr, server);
+    sp<IBinder> replacement = addServer();
+    ASSERT_NE(nullptr, replacement);
+
+    cache->maybeAdd("cached", server);
+    auto callbacks = sm->callbacks();
+    ASSERT_EQ(1u, callbacks.size());
+
+    // servicemanager calls back for the current registration too
+    EXPECT_TRUE(callbacks[0].second->onRegistration("cached", server).isOk());
+    EXPECT_EQ(server, cache->lookup("cached"));
+
+    EXPECT_TRUE(callbacks[0].second->onRegistration("cached", replacement).isOk());
+    EXPECT_EQ(nullptr, cache->lookup("cached"));
+}
+
+TEST_F(BinderLibTest, ServiceCacheInvalidatedOnDeath) {
+    auto sm = sp<ServiceCacheTestServiceManager>::make();
+    auto cache = sp<ServiceCache>::make(sm, std::set<std::string>{"cached"});
+    sp<TestDeathRecipient> testDeathRecipient = sp<TestDeathRecipient>::make();
+    sp<IBinder> server = addServer();
+    ASSERT_NE(nullptr, server);
+
+    cache->maybeAdd("cached", server);
+    EXPECT_EQ(server, cache->lookup("cached"));
+    // Linked after the cache, so it is notified after the cache
+    EXPECT_THAT(server->linkToDeath(testDeathRecipient), StatusEq(NO_ERROR));
+
+    {
+        Parcel data, reply;
+        EXPECT_THAT(server->transact(BINDER_LIB_TEST_EXIT_TRANSACTION, data, &reply, TF_ONE_WAY),
+                    StatusEq(OK));
+    }
+    IPCThreadState::self()->flushCommands();
+    EXPECT_THAT(testDeathRecipient->waitEvent(5), StatusEq(NO_ERROR));
+    EXPECT_EQ(nullptr, cache->lookup("cached"));
+}
+
 TEST_F(BinderLibTest, PassFile) {
     int ret;
     int pipefd[2];
@@ -1411,6 +1580,50 @@ TEST_F(BinderLibTest, ThreadPoolStarted) {
     EXPECT_TRUE(reply.readBool());
 }
 
+TEST_F(BinderLibTest, ThreadPoolCpuStats) {
+    sp<IBinder> server = addServer();
+    ASSERT_TRUE(server != nullptr);
+    for (size_t i = 0; i < 2; i++) {
+        Parcel data, reply;
+        EXPECT_THAT(server->transact(BINDER_LIB_TEST_NOP_TRANSACTION, data, &reply),
+                    StatusEq(NO_ERROR));
+    }
+
+    Parcel data, reply;
+    EXPECT_THAT(server->transact(BINDER_LIB_TEST_GET_THREADPOOL_CPU_STATS, data, &reply),
+                StatusEq(NO_ERROR));
+    // including this one
+    EXPECT_GE(reply.readUint64(), 3u);
+    EXPECT_EQ(0u, reply.readUint64());
+    EXPECT_EQ(0u, reply.readUint64());
+
+    // the policy can't change once threads joined the threadpool
+    EXPECT_THAT(ProcessState::self()->setThreadPoolCpuPolicy({}), StatusEq(INVALID_OPERATION));
+}
+
+TEST_F(BinderLibTest, ConcurrentProxyLookups) {
+    sp<IBinder> server = addServer();
+    ASSERT_TRUE(server != nullptr);
+
+    // reading a handle from a parcel looks up its proxy
+    std::atomic<size_t> mismatches = 0;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < 4; i++) {
+        threads.emplace_back([&] {
+            Parcel p;
+            for (size_t j = 0; j < 1000; j++) {
+                p.setDataPosition(0);
+                p.writeStrongBinder(server);
+                p.setDataPosition(0);
+                if (p.readStrongBinder() != server) mismatches++;
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(0u, mismatches);
+    EXPECT_THAT(server->pingBinder(), StatusEq(NO_ERROR));
+}
+
 size_t epochMillis() {
     using std::chrono::duration_cast;
     using std::chrono::milliseconds;
@@ -1912,6 +2125,16 @@ public:
                 reply->writeBool(ProcessState::self()->isThreadPoolStarted());
                 return NO_ERROR;
             }
+            case BINDER_LIB_TEST_GET_THREADPOOL_CPU_STATS: {
+                ProcessState::ThreadPoolCpuStats stats =
+                        ProcessState::self()->getThreadPoolCpuStats();
+                uint64_t transactions = 0;
+                for (uint64_t count : stats.transactionsPerCpu) transactions += count;
+                reply->writeUint64(transactions);
+                reply->writeUint64(stats.highPriorityTransactions);
+                reply->writeUint64(stats.migrations);
+                return NO_ERROR;
+            }
             case BINDER_LIB_TEST_PROCESS_LOCK: {
                 m_blockMutex.lock();
                 return NO_ERROR;
@@ -2059,6 +2282,10 @@ int run_server(int index, int readypipefd, bool usePoll)
              }
         }
     } else {
+        // Only counts where transactions run, since test callers aren't high priority.
+        ProcessState::ThreadPoolCpuPolicy cpuPolicy;
+        cpuPolicy.highPriorityCpus = {0};
+        if (ProcessState::self()->setThreadPoolCpuPolicy(cpuPolicy) != NO_ERROR) return 1;
         ProcessState::self()->setThreadPoolMaxThreadCount(kKernelThreads);
         ProcessState::self()->startThreadPool();
         IPCThreadState::self()->joinThreadPool();
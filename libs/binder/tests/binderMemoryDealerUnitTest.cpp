@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <binder/MemoryDealer.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace android;
+
+TEST(MemoryDealer, WholeHeap) {
+    auto dealer = sp<MemoryDealer>::make(101 * 4096, "Test dealer");
+    const size_t heapSize = dealer->getStats().heapSize;
+    sp<IMemory> all = dealer->allocate(heapSize);
+    ASSERT_NE(all, nullptr);
+    EXPECT_EQ(all->offset(), 0);
+    EXPECT_EQ(dealer->allocate(1), nullptr);
+    all.clear();
+    EXPECT_NE(dealer->allocate(heapSize), nullptr);
+}
+
+TEST(MemoryDealer, StatsAndMerging) {
+    auto dealer = sp<MemoryDealer>::make(64 * 1024, "Test dealer");
+    dealer->setReleaseFreePages(true);
+    const size_t align = MemoryDealer::getAllocationAlignment();
+
+    std::vector<sp<IMemory>> memories;
+    for (size_t i = 0; i < 64; i++) {
+        sp<IMemory> memory = dealer->allocate(500);
+        ASSERT_NE(memory, nullptr);
+        memset(memory->unsecurePointer(), 1, memory->size());
+        memories.push_back(memory);
+    }
+
+    MemoryDealer::Stats stats = dealer->getStats();
+    EXPECT_EQ(stats.heapSize, 64u * 1024);
+    EXPECT_EQ(stats.allocations, 64u);
+    EXPECT_EQ(stats.allocatedSize, 64u * ((500 + align - 1) / align * align));
+    EXPECT_EQ(stats.freeSize, stats.heapSize - stats.allocatedSize);
+    EXPECT_EQ(stats.freeChunks, 1u);
+    EXPECT_EQ(stats.largestFreeChunk, stats.freeSize);
+
+    // every other one, so that the free chunks don't merge
+    for (size_t i = 0; i < memories.size(); i += 2) {
+        memories[i].clear();
+    }
+    stats = dealer->getStats();
+    EXPECT_EQ(stats.allocations, 32u);
+    EXPECT_EQ(stats.freeChunks, 33u);
+    EXPECT_LT(stats.largestFreeChunk, stats.freeSize);
+
+    memories.clear();
+    stats = dealer->getStats();
+    EXPECT_EQ(stats.allocations, 0u);
+    EXPECT_EQ(stats.allocatedSize, 0u);
+    EXPECT_EQ(stats.freeChunks, 1u);
+    EXPECT_EQ(stats.largestFreeChunk, stats.heapSize);
+}
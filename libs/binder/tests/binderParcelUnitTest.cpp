@@ -16,21 +16,26 @@
 
 #include <binder/IPCThreadState.h>
 #include <binder/Parcel.h>
+#include <binder/PersistableBundle.h>
+#include <binder/RpcSession.h>
 #include <binder/Status.h>
 #include <cutils/ashmem.h>
 #include <gtest/gtest.h>
+#include <sys/mman.h>
 
 using android::BBinder;
 using android::IBinder;
 using android::IPCThreadState;
 using android::OK;
 using android::Parcel;
+using android::RpcSession;
 using android::sp;
 using android::status_t;
 using android::String16;
 using android::String8;
 using android::binder::Status;
 using android::binder::unique_fd;
+using android::os::PersistableBundle;
 
 TEST(Parcel, NonNullTerminatedString8) {
     String8 kTestString = String8("test-is-good");
@@ -284,6 +289,32 @@ void parcelOpSameLength(const std::function<void(Parcel*)>& a, const std::functi
     EXPECT_EQ(end, p.dataPosition());
 }
 
+TEST(Parcel, SmallParcelsReuseTheBuffersOfTheThread) {
+    const uint8_t* data;
+    {
+        Parcel p;
+        ASSERT_EQ(OK, p.writeInt32(1));
+        EXPECT_EQ(256u, p.dataCapacity());
+        data = p.data();
+    }
+
+    Parcel p;
+    ASSERT_EQ(OK, p.writeInt32(2));
+    EXPECT_EQ(data, p.data());
+}
+
+TEST(Parcel, SetDataCapacityMakesRoomForTheMessage) {
+    Parcel p;
+    ASSERT_EQ(OK, p.setDataCapacity(1000));
+    const uint8_t* data = p.data();
+    EXPECT_EQ(1000u, p.dataCapacity());
+    for (int32_t i = 0; i < 250; i++) {
+        ASSERT_EQ(OK, p.writeInt32(i));
+    }
+    EXPECT_EQ(data, p.data());
+    EXPECT_EQ(1000u, p.dataSize());
+}
+
 TEST(Parcel, InverseInterfaceToken) {
     const String16 token = String16("asdf");
     parcelOpSameLength([&] (Parcel* p) {
@@ -375,3 +406,139 @@ TEST(Parcel, GetOpenAshmemSize) {
         ASSERT_EQ((kSize * (i + 1)), p.getOpenAshmemSize());
     }
 }
+
+static sp<RpcSession> makeSessionWithFdMode(RpcSession::FileDescriptorTransportMode mode) {
+    sp<RpcSession> session = RpcSession::make();
+    session->setFileDescriptorTransportMode(mode);
+    return session;
+}
+
+TEST(Parcel, RpcBlobUsesSealedMemfd) {
+    constexpr size_t kSize = 1024 * 1024;
+
+    Parcel p;
+    p.markForRpc(makeSessionWithFdMode(RpcSession::FileDescriptorTransportMode::UNIX));
+
+    Parcel::WritableBlob writable;
+    ASSERT_EQ(OK, p.writeBlob(kSize, false /*mutableCopy*/, &writable));
+    memset(writable.data(), 'a', kSize);
+    writable.release();
+    // the contents are not copied into the parcel
+    EXPECT_LT(p.dataSize(), kSize);
+
+    p.setDataPosition(0);
+    Parcel::ReadableBlob readable;
+    ASSERT_EQ(OK, p.readBlob(kSize, &readable));
+    EXPECT_EQ(std::string(kSize, 'a'),
+              std::string(static_cast<const char*>(readable.data()), readable.size()));
+    EXPECT_FALSE(readable.isMutable());
+
+    // the receiver can't map an immutable blob for writing
+    int fd = readable.fd();
+    EXPECT_EQ(MAP_FAILED, mmap(nullptr, kSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    readable.release();
+}
+
+TEST(Parcel, RpcBlobWithoutFdSupportIsInplace) {
+    constexpr size_t kSize = 1024 * 1024;
+
+    Parcel p;
+    p.markForRpc(makeSessionWithFdMode(RpcSession::FileDescriptorTransportMode::NONE));
+
+    Parcel::WritableBlob writable;
+    ASSERT_EQ(OK, p.writeBlob(kSize, false /*mutableCopy*/, &writable));
+    memset(writable.data(), 'b', kSize);
+    writable.release();
+    EXPECT_GE(p.dataSize(), kSize);
+
+    p.setDataPosition(0);
+    Parcel::ReadableBlob readable;
+    ASSERT_EQ(OK, p.readBlob(kSize, &readable));
+    EXPECT_EQ('b', static_cast<const char*>(readable.data())[kSize - 1]);
+    readable.release();
+}
+
+TEST(Parcel, PersistableBundleReadLazily) {
+    PersistableBundle nested;
+    nested.putInt(String16("n"), 7);
+
+    PersistableBundle bundle;
+    bundle.putBoolean(String16("bool"), true);
+    bundle.putLong(String16("long"), -3);
+    bundle.putString(String16("string"), String16("value"));
+    bundle.putIntVector(String16("ints"), {1, 2, 3});
+    bundle.putStringVector(String16("strings"), {String16("a"), String16()});
+    bundle.putPersistableBundle(String16("nested"), nested);
+
+    Parcel p;
+    ASSERT_EQ(OK, bundle.writeToParcel(&p));
+    p.setDataPosition(0);
+    PersistableBundle read;
+    ASSERT_EQ(OK, read.readFromParcel(&p));
+    EXPECT_EQ(p.dataSize(), p.dataPosition());
+
+    EXPECT_EQ(bundle.size(), read.size());
+    EXPECT_EQ(std::set<String16>({String16("ints")}), read.getIntVectorKeys());
+    int64_t longValue = 0;
+    EXPECT_TRUE(read.getLong(String16("long"), &longValue));
+    EXPECT_EQ(-3, longValue);
+    int32_t intValue = 0;
+    EXPECT_FALSE(read.getInt(String16("long"), &intValue));  // wrong type
+    EXPECT_FALSE(read.getInt(String16("missing"), &intValue));
+    String16 stringValue;
+    EXPECT_TRUE(read.getString(String16("string"), &stringValue));
+    EXPECT_EQ(String16("value"), stringValue);
+    std::vector<String16> strings;
+    EXPECT_TRUE(read.getStringVector(String16("strings"), &strings));
+    EXPECT_EQ(std::vector<String16>({String16("a"), String16()}), strings);
+    PersistableBundle nestedValue;
+    EXPECT_TRUE(read.getPersistableBundle(String16("nested"), &nestedValue));
+    EXPECT_EQ(nested, nestedValue);
+    EXPECT_EQ(bundle, read);
+
+    // forwarded as it was read
+    Parcel forwarded;
+    ASSERT_EQ(OK, read.writeToParcel(&forwarded));
+    ASSERT_EQ(p.dataSize(), forwarded.dataSize());
+    EXPECT_EQ(0, memcmp(p.data(), forwarded.data(), p.dataSize()));
+
+    // and still changeable
+    read.putInt(String16("long"), 4);
+    EXPECT_TRUE(read.getInt(String16("long"), &intValue));
+    EXPECT_EQ(4, intValue);
+    EXPECT_FALSE(read.getLong(String16("long"), &longValue));
+    EXPECT_TRUE(read.getString(String16("string"), &stringValue));
+    EXPECT_EQ(bundle.size(), read.size());
+}
+
+TEST(Parcel, PersistableBundleReadLazilyFindsKeyOfEachType) {
+    // BAD! assumption of wire format for test: a key with two types, as only a
+    // parcel can hold it.
+    Parcel p;
+    p.writeInt32(0); // length, patched below
+    p.writeInt32(0x4C444E44); // BUNDLE_MAGIC_NATIVE
+    const size_t start = p.dataPosition();
+    p.writeInt32(3);
+    p.writeString16(String16("key"));
+    p.writeInt32(6); // VAL_LONG
+    p.writeInt64(-3);
+    p.writeString16(String16("key"));
+    p.writeInt32(1); // VAL_INTEGER
+    p.writeInt32(5);
+    p.writeString16(String16("key"));
+    p.writeInt32(1); // VAL_INTEGER
+    p.writeInt32(7);
+    const size_t end = p.dataPosition();
+    p.setDataPosition(0);
+    p.writeInt32(static_cast<int32_t>(end - start));
+    p.setDataPosition(0);
+
+    PersistableBundle read;
+    ASSERT_EQ(OK, read.readFromParcel(&p));
+    int32_t intValue = 0;
+    EXPECT_TRUE(read.getInt(String16("key"), &intValue));
+    EXPECT_EQ(7, intValue); // the last one wins, as when decoded
+    int64_t longValue = 0;
+    EXPECT_TRUE(read.getLong(String16("key"), &longValue));
+    EXPECT_EQ(-3, longValue);
+}
@@ -138,3 +138,42 @@ TEST(BinderRecordedTransaction, PayloadsExceedPageBoundaries) {
         EXPECT_EQ(retrievedTransaction->getReplyParcel().readInt32(), 99);
     }
 }
+
+TEST(BinderRecordedTransaction, FromBufferWalksRecording) {
+    android::String16 interfaceName("SampleInterface");
+    timespec ts = {1232456, 567890};
+
+    auto file = std::tmpfile();
+    auto fd = unique_fd(fcntl(fileno(file), F_DUPFD, 1));
+    constexpr uint32_t kCount = 3;
+    for (uint32_t i = 0; i < kCount; i++) {
+        Parcel d;
+        d.writeInt32(i);
+        Parcel r;
+        auto transaction = RecordedTransaction::fromDetails(interfaceName, i, 0, ts, d, r, 0);
+        ASSERT_TRUE(transaction.has_value());
+        ASSERT_EQ(android::NO_ERROR, transaction->dumpToFile(fd));
+    }
+
+    off_t size = lseek(fd.get(), 0, SEEK_END);
+    ASSERT_GT(size, 0);
+    // uint64_t, since fromBuffer needs 8-byte alignment
+    std::vector<uint64_t> buffer((size + 7) / 8);
+    ASSERT_EQ(size, pread(fd.get(), buffer.data(), size, 0));
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer.data());
+    size_t offset = 0;
+    for (uint32_t i = 0; i < kCount; i++) {
+        size_t consumed = 0;
+        auto retrievedTransaction = RecordedTransaction::fromBuffer(data + offset, size - offset,
+                                                                    &consumed);
+        ASSERT_TRUE(retrievedTransaction.has_value());
+        EXPECT_EQ(retrievedTransaction->getCode(), i);
+        EXPECT_EQ(retrievedTransaction->getDataParcel().readInt32(), static_cast<int32_t>(i));
+        offset += consumed;
+    }
+    EXPECT_EQ(static_cast<size_t>(size), offset);
+
+    size_t consumed = 0;
+    EXPECT_FALSE(RecordedTransaction::fromBuffer(data + offset, size - offset, &consumed));
+}
@@ -0,0 +1,508 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Turns binder recordings (see RecordedTransaction.cpp) into repeatable
+// benchmarks.
+//
+// 'pack' converts a recording into an indexed container, optionally with each
+// transaction LZ4 compressed. 'replay' maps a recording or container and sends
+// its transactions to a service again, at the recorded pace (or faster), and
+// reports the latency of each one.
+//
+// Container format (all integers little endian):
+//
+// ┌──────────────────────────────────────────────┐
+// │ PackHeader (magic, version, flags)           │
+// ├──────────────────────────────────────────────┤
+// │ Frame * count                                │
+// │   FrameHeader (uncompressedSize, storedSize) │
+// │   stored bytes, padded to 8 bytes            │
+// ├──────────────────────────────────────────────┤
+// │ IndexEntry * count                           │
+// ├──────────────────────────────────────────────┤
+// │ PackTrailer (indexOffset, count, magic)      │
+// └──────────────────────────────────────────────┘
+//
+// Each frame holds exactly one transaction in the recording format, so any
+// transaction can be found from the trailer without reading the others.
+
+#include <binder/Binder.h>
+#include <binder/IServiceManager.h>
+#include <binder/Parcel.h>
+#include <binder/RecordedTransaction.h>
+#include <binder/unique_fd.h>
+
+#include <lz4.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../file.h"
+
+using android::defaultServiceManager;
+using android::IBinder;
+using android::OK;
+using android::Parcel;
+using android::sp;
+using android::status_t;
+using android::String16;
+using android::binder::unique_fd;
+using android::binder::WriteFully;
+using android::binder::debug::RecordedTransaction;
+
+namespace {
+
+constexpr uint32_t kPackMagic = 0x4b505242;  // 'BRPK'
+constexpr uint32_t kIndexMagic = 0x58495242; // 'BRIX'
+constexpr uint32_t kPackVersion = 1;
+constexpr uint32_t kPackFlagLz4 = 1 << 0;
+
+struct PackHeader {
+    uint32_t magic = kPackMagic;
+    uint32_t version = kPackVersion;
+    uint32_t flags = 0;
+    uint32_t reserved = 0;
+};
+static_assert(sizeof(PackHeader) % 8 == 0);
+
+struct FrameHeader {
+    uint32_t uncompressedSize = 0;
+    uint32_t storedSize = 0;
+};
+static_assert(sizeof(FrameHeader) % 8 == 0);
+
+struct IndexEntry {
+    uint64_t frameOffset = 0;
+    int64_t timestampNs = 0;
+    uint32_t code = 0;
+    uint32_t flags = 0;
+};
+static_assert(sizeof(IndexEntry) % 8 == 0);
+
+struct PackTrailer {
+    uint64_t indexOffset = 0;
+    uint32_t count = 0;
+    uint32_t magic = kIndexMagic;
+};
+static_assert(sizeof(PackTrailer) % 8 == 0);
+
+size_t padded8(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+int64_t toNs(timespec ts) {
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// A recording or container, mapped read-only.
+class MappedRecording {
+public:
+    static std::optional<MappedRecording> open(const char* path) {
+        unique_fd fd(::open(path, O_RDONLY | O_CLOEXEC));
+        if (!fd.ok()) {
+            std::cerr << "Failed to open " << path << ": " << strerror(errno) << std::endl;
+            return std::nullopt;
+        }
+        struct stat st;
+        if (fstat(fd.get(), &st) != 0 || st.st_size <= 0) {
+            std::cerr << "Failed to get the size of " << path << std::endl;
+            return std::nullopt;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+        if (map == MAP_FAILED) {
+            std::cerr << "Failed to map " << path << ": " << strerror(errno) << std::endl;
+            return std::nullopt;
+        }
+        madvise(map, size, MADV_SEQUENTIAL);
+
+        MappedRecording recording(static_cast<const uint8_t*>(map), size);
+        if (!recording.loadIndex()) return std::nullopt;
+        return recording;
+    }
+
+    MappedRecording(MappedRecording&& other) noexcept
+          : mData(std::exchange(other.mData, nullptr)),
+            mSize(other.mSize),
+            mFlags(other.mFlags),
+            mPacked(other.mPacked),
+            mIndex(std::move(other.mIndex)),
+            mRawSizes(std::move(other.mRawSizes)) {}
+    ~MappedRecording() {
+        if (mData != nullptr) munmap(const_cast<uint8_t*>(mData), mSize);
+    }
+
+    size_t count() const { return mIndex.size(); }
+    const IndexEntry& entry(size_t i) const { return mIndex[i]; }
+    bool compressed() const { return (mFlags & kPackFlagLz4) != 0; }
+    bool packed() const { return mPacked; }
+
+    // The bytes of transaction i in the recording format.
+    std::optional<std::pair<const uint8_t*, size_t>> rawTransaction(size_t i) {
+        const IndexEntry& e = mIndex[i];
+        if (!mPacked) return std::make_pair(mData + e.frameOffset, mRawSizes[i]);
+
+        FrameHeader frame;
+        memcpy(&frame, mData + e.frameOffset, sizeof(frame));
+        const uint8_t* stored = mData + e.frameOffset + sizeof(FrameHeader);
+        if (!compressed()) return std::make_pair(stored, static_cast<size_t>(frame.storedSize));
+
+        // uint64_t, since RecordedTransaction::fromBuffer needs 8-byte alignment
+        mScratch.resize(padded8(frame.uncompressedSize) / sizeof(uint64_t));
+        int ret = LZ4_decompress_safe(reinterpret_cast<const char*>(stored),
+                                      reinterpret_cast<char*>(mScratch.data()),
+                                      static_cast<int>(frame.storedSize),
+                                      static_cast<int>(frame.uncompressedSize));
+        if (ret < 0 || static_cast<uint32_t>(ret) != frame.uncompressedSize) {
+            std::cerr << "Failed to decompress transaction " << i << std::endl;
+            return std::nullopt;
+        }
+        return std::make_pair(reinterpret_cast<const uint8_t*>(mScratch.data()),
+                              static_cast<size_t>(frame.uncompressedSize));
+    }
+
+    std::optional<RecordedTransaction> transaction(size_t i) {
+        auto raw = rawTransaction(i);
+        if (!raw) return std::nullopt;
+        size_t consumed;
+        return RecordedTransaction::fromBuffer(raw->first, raw->second, &consumed);
+    }
+
+private:
+    MappedRecording(const uint8_t* data, size_t size) : mData(data), mSize(size) {}
+
+    bool loadIndex() {
+        PackHeader header;
+        if (mSize >= sizeof(header)) memcpy(&header, mData, sizeof(header));
+        if (mSize < sizeof(header) || header.magic != kPackMagic) return scanRecording();
+
+        if (header.version != kPackVersion) {
+            std::cerr << "Unsupported container version " << header.version << std::endl;
+            return false;
+        }
+        mPacked = true;
+        mFlags = header.flags;
+
+        PackTrailer trailer;
+        if (mSize < sizeof(header) + sizeof(trailer)) {
+            std::cerr << "Container is truncated" << std::endl;
+            return false;
+        }
+        memcpy(&trailer, mData + mSize - sizeof(trailer), sizeof(trailer));
+        uint64_t indexSize = static_cast<uint64_t>(trailer.count) * sizeof(IndexEntry);
+        if (trailer.magic != kIndexMagic || trailer.indexOffset < sizeof(header) ||
+            trailer.indexOffset + indexSize != mSize - sizeof(trailer)) {
+            std::cerr << "Container index is invalid" << std::endl;
+            return false;
+        }
+        mIndex.resize(trailer.count);
+        memcpy(mIndex.data(), mData + trailer.indexOffset, indexSize);
+
+        for (size_t i = 0; i < mIndex.size(); i++) {
+            const IndexEntry& e = mIndex[i];
+            FrameHeader frame;
+            if (e.frameOffset < sizeof(header) || e.frameOffset % 8 != 0 ||
+                e.frameOffset + sizeof(frame) > trailer.indexOffset) {
+                std::cerr << "Frame " << i << " is out of bounds" << std::endl;
+                return false;
+            }
+            memcpy(&frame, mData + e.frameOffset, sizeof(frame));
+            if (e.frameOffset + sizeof(frame) + frame.storedSize > trailer.indexOffset ||
+                (!compressed() && frame.storedSize != frame.uncompressedSize)) {
+                std::cerr << "Frame " << i << " is invalid" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Plain recordings have no index, so it is built by walking them once.
+    bool scanRecording() {
+        size_t offset = 0;
+        while (offset < mSize) {
+            size_t consumed;
+            auto t = RecordedTransaction::fromBuffer(mData + offset, mSize - offset, &consumed);
+            if (!t) break;
+            mIndex.push_back({.frameOffset = offset,
+                              .timestampNs = toNs(t->getTimestamp()),
+                              .code = t->getCode(),
+                              .flags = t->getFlags()});
+            mRawSizes.push_back(consumed);
+            offset += consumed;
+        }
+        if (offset != mSize) {
+            std::cerr << "Ignoring " << (mSize - offset) << " trailing bytes which are not a "
+                      << "valid transaction" << std::endl;
+        }
+        if (mIndex.empty()) {
+            std::cerr << "No valid transaction found" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    const uint8_t* mData;
+    size_t mSize;
+    uint32_t mFlags = 0;
+    bool mPacked = false;
+    std::vector<IndexEntry> mIndex;
+    std::vector<size_t> mRawSizes; // only for plain recordings
+    std::vector<uint64_t> mScratch;
+};
+
+int pack(const char* input, const char* output, bool lz4) {
+    auto recording = MappedRecording::open(input);
+    if (!recording) return 1;
+    if (recording->packed()) {
+        std::cerr << input << " is already packed" << std::endl;
+        return 1;
+    }
+
+    unique_fd out(::open(output, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+    if (!out.ok()) {
+        std::cerr << "Failed to open " << output << ": " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    PackHeader header{.flags = lz4 ? kPackFlagLz4 : 0};
+    if (!WriteFully(out, &header, sizeof(header))) {
+        std::cerr << "Failed to write " << output << std::endl;
+        return 1;
+    }
+    uint64_t offset = sizeof(header);
+
+    std::vector<IndexEntry> index;
+    std::vector<char> compressed;
+    size_t rawTotal = 0;
+    for (size_t i = 0; i < recording->count(); i++) {
+        auto raw = recording->rawTransaction(i);
+        if (!raw) return 1;
+        auto [data, size] = *raw;
+        rawTotal += size;
+
+        const void* stored = data;
+        FrameHeader frame{.uncompressedSize = static_cast<uint32_t>(size),
+                          .storedSize = static_cast<uint32_t>(size)};
+        if (lz4) {
+            compressed.resize(LZ4_compressBound(static_cast<int>(size)));
+            int ret = LZ4_compress_default(reinterpret_cast<const char*>(data), compressed.data(),
+                                           static_cast<int>(size),
+                                           static_cast<int>(compressed.size()));
+            if (ret <= 0) {
+                std::cerr << "Failed to compress transaction " << i << std::endl;
+                return 1;
+            }
+            frame.storedSize = static_cast<uint32_t>(ret);
+            stored = compressed.data();
+        }
+
+        IndexEntry entry = recording->entry(i);
+        entry.frameOffset = offset;
+        index.push_back(entry);
+
+        static const uint8_t kZeros[8] = {};
+        size_t padding = padded8(frame.storedSize) - frame.storedSize;
+        if (!WriteFully(out, &frame, sizeof(frame)) ||
+            !WriteFully(out, stored, frame.storedSize) || !WriteFully(out, kZeros, padding)) {
+            std::cerr << "Failed to write " << output << std::endl;
+            return 1;
+        }
+        offset += sizeof(frame) + frame.storedSize + padding;
+    }
+
+    PackTrailer trailer{.indexOffset = offset, .count = static_cast<uint32_t>(index.size())};
+    if (!WriteFully(out, index.data(), index.size() * sizeof(IndexEntry)) ||
+        !WriteFully(out, &trailer, sizeof(trailer))) {
+        std::cerr << "Failed to write " << output << std::endl;
+        return 1;
+    }
+
+    std::cout << "Packed " << index.size() << " transactions, " << rawTotal << " bytes into "
+              << (offset + index.size() * sizeof(IndexEntry) + sizeof(trailer)) << " bytes"
+              << std::endl;
+    return 0;
+}
+
+int info(const char* input) {
+    auto recording = MappedRecording::open(input);
+    if (!recording) return 1;
+
+    std::cout << (recording->packed() ? "container" : "recording")
+              << (recording->compressed() ? " (lz4)" : "") << ", " << recording->count()
+              << " transactions" << std::endl;
+    int64_t firstNs = recording->entry(0).timestampNs;
+    for (size_t i = 0; i < recording->count(); i++) {
+        const IndexEntry& e = recording->entry(i);
+        std::cout << i << ": +" << (e.timestampNs - firstNs) / 1000 << "us code " << e.code
+                  << " flags 0x" << std::hex << e.flags << std::dec << std::endl;
+    }
+    return 0;
+}
+
+struct ReplayOptions {
+    // 0 replays without waiting between transactions
+    double speed = 1.0;
+    const char* csvPath = nullptr;
+};
+
+int replay(const char* input, const char* serviceName, const ReplayOptions& options) {
+    auto recording = MappedRecording::open(input);
+    if (!recording) return 1;
+
+    sp<IBinder> binder = defaultServiceManager()->checkService(String16(serviceName));
+    if (binder == nullptr) {
+        std::cerr << "Service " << serviceName << " not found" << std::endl;
+        return 1;
+    }
+
+    std::ofstream csvFile;
+    if (options.csvPath != nullptr) {
+        csvFile.open(options.csvPath);
+        if (!csvFile) {
+            std::cerr << "Failed to open " << options.csvPath << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& csv = options.csvPath != nullptr ? csvFile : std::cout;
+    csv << "index,code,flags,recorded_status,status,latency_ns" << std::endl;
+
+    using std::chrono::steady_clock;
+    const steady_clock::time_point start = steady_clock::now();
+    const int64_t firstNs = recording->entry(0).timestampNs;
+
+    std::vector<uint64_t> latencies;
+    size_t skipped = 0;
+    size_t mismatched = 0;
+    for (size_t i = 0; i < recording->count(); i++) {
+        auto transaction = recording->transaction(i);
+        if (!transaction) return 1;
+
+        // Binders and file descriptors from the recording don't exist anymore.
+        if (!transaction->getObjectOffsets().empty()) {
+            skipped++;
+            continue;
+        }
+
+        if (options.speed > 0) {
+            auto offset = std::chrono::nanoseconds(static_cast<int64_t>(
+                    static_cast<double>(recording->entry(i).timestampNs - firstNs) /
+                    options.speed));
+            std::this_thread::sleep_until(start + offset);
+        }
+
+        Parcel data;
+        data.setData(transaction->getDataParcel().data(), transaction->getDataParcel().dataSize());
+        Parcel reply;
+        steady_clock::time_point before = steady_clock::now();
+        status_t status =
+                binder->transact(transaction->getCode(), data, &reply, transaction->getFlags());
+        uint64_t latencyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     steady_clock::now() - before)
+                                     .count();
+
+        latencies.push_back(latencyNs);
+        if (status != transaction->getReturnedStatus()) mismatched++;
+        csv << i << "," << transaction->getCode() << "," << transaction->getFlags() << ","
+            << transaction->getReturnedStatus() << "," << status << "," << latencyNs << "\n";
+    }
+    csv.flush();
+
+    std::cerr << "Replayed " << latencies.size() << " transactions (" << skipped
+              << " skipped because they contain objects, " << mismatched
+              << " with a different status than recorded)" << std::endl;
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double p) {
+            return latencies[std::min(latencies.size() - 1,
+                                      static_cast<size_t>(p * latencies.size()))];
+        };
+        std::cerr << "latency ns: p50 " << percentile(0.5) << " p90 " << percentile(0.9)
+                  << " p99 " << percentile(0.99) << " max " << latencies.back() << std::endl;
+    }
+    return 0;
+}
+
+void printHelp(const char* toolName) {
+    std::cout << "Usage:\n\n"
+              << toolName << " pack <recording> <output> [--lz4]\n"
+              << "    Writes an indexed (and optionally compressed) copy of a recording.\n"
+              << toolName << " info <recording or container>\n"
+              << "    Lists the transactions.\n"
+              << toolName
+              << " replay <recording or container> <service> [--speed <factor>] [--asap] "
+                 "[--csv <path>]\n"
+              << "    Sends the transactions to the service again, by default with the\n"
+              << "    recorded spacing. --speed 2 halves the gaps, --asap removes them.\n"
+              << "    Per-transaction latency goes to stdout, or the --csv file.\n\n"
+              << "*Use the record_binder tool for recording binder transactions." << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printHelp(argv[0]);
+        return 1;
+    }
+    std::string command = argv[1];
+
+    if (command == "pack" && (argc == 4 || argc == 5)) {
+        bool lz4 = argc == 5 && std::string(argv[4]) == "--lz4";
+        if (argc == 5 && !lz4) {
+            printHelp(argv[0]);
+            return 1;
+        }
+        return pack(argv[2], argv[3], lz4);
+    }
+    if (command == "info" && argc == 3) {
+        return info(argv[2]);
+    }
+    if (command == "replay" && argc >= 4) {
+        ReplayOptions options;
+        for (int i = 4; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--asap") {
+                options.speed = 0;
+            } else if (arg == "--speed" && i + 1 < argc) {
+                options.speed = atof(argv[++i]);
+                if (options.speed <= 0) {
+                    std::cerr << "--speed must be positive" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--csv" && i + 1 < argc) {
+                options.csvPath = argv[++i];
+            } else {
+                printHelp(argv[0]);
+                return 1;
+            }
+        }
+        return replay(argv[2], argv[3], options);
+    }
+
+    printHelp(argv[0]);
+    return 1;
+}
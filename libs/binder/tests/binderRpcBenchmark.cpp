@@ -16,6 +16,7 @@
 
 #include <BnBinderRpcBenchmark.h>
 #include <android-base/logging.h>
+#include <android-base/thread_annotations.h>
 #include <benchmark/benchmark.h>
 #include <binder/Binder.h>
 #include <binder/IPCThreadState.h>
@@ -28,10 +29,16 @@
 #include <binder/RpcTlsTestUtils.h>
 #include <binder/RpcTlsUtils.h>
 #include <binder/RpcTransportRaw.h>
+#include <binder/RpcTransportShm.h>
 #include <binder/RpcTransportTls.h>
+#include <binder/RpcTransportUring.h>
 #include <openssl/ssl.h>
 
+#include <algorithm>
+#include <chrono>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #include <signal.h>
 #include <sys/prctl.h>
@@ -54,7 +61,9 @@ using android::RpcServer;
 using android::RpcSession;
 using android::RpcTransportCtxFactory;
 using android::RpcTransportCtxFactoryRaw;
+using android::RpcTransportCtxFactoryShm;
 using android::RpcTransportCtxFactoryTls;
+using android::RpcTransportCtxFactoryUring;
 using android::sp;
 using android::status_t;
 using android::statusToString;
@@ -118,14 +127,22 @@ enum Transport {
     KERNEL,
     RPC,
     RPC_TLS,
+    RPC_URING,
+    RPC_SHM,
 };
 
+// Number of concurrent calls the servers support, for the multi-threaded
+// benchmarks.
+constexpr int kMaxClientThreads = 8;
+
 static const std::initializer_list<int64_t> kTransportList = {
 #ifdef __BIONIC__
         Transport::KERNEL,
 #endif
         Transport::RPC,
         Transport::RPC_TLS,
+        Transport::RPC_URING,
+        Transport::RPC_SHM,
 };
 
 std::unique_ptr<RpcTransportCtxFactory> makeFactoryTls() {
@@ -145,6 +162,10 @@ static sp<IBinder> gRpcBinder;
 // Skip certificate validation to simplify the setup process.
 static sp<RpcSession> gSessionTls = RpcSession::make(makeFactoryTls());
 static sp<IBinder> gRpcTlsBinder;
+static sp<RpcSession> gSessionUring = RpcSession::make(RpcTransportCtxFactoryUring::make());
+static sp<IBinder> gRpcUringBinder;
+static sp<RpcSession> gSessionShm = RpcSession::make(RpcTransportCtxFactoryShm::make());
+static sp<IBinder> gRpcShmBinder;
 #ifdef __BIONIC__
 static const String16 kKernelBinderInstance = String16(u"binderRpcBenchmark-control");
 static sp<IBinder> gKernelBinder;
@@ -161,6 +182,10 @@ static sp<IBinder> getBinderForOptions(benchmark::State& state) {
             return gRpcBinder;
         case RPC_TLS:
             return gRpcTlsBinder;
+        case RPC_URING:
+            return gRpcUringBinder;
+        case RPC_SHM:
+            return gRpcShmBinder;
         default:
             LOG(FATAL) << "Unknown transport value: " << transport;
             return nullptr;
@@ -181,6 +206,12 @@ static void SetLabel(benchmark::State& state) {
         case RPC_TLS:
             state.SetLabel("rpc_tls");
             break;
+        case RPC_URING:
+            state.SetLabel("rpc_uring");
+            break;
+        case RPC_SHM:
+            state.SetLabel("rpc_shm");
+            break;
         default:
             LOG(FATAL) << "Unknown transport value: " << transport;
     }
@@ -250,6 +281,76 @@ BENCHMARK(BM_throughputForTransportAndBytes)
         ->ArgsProduct({kTransportList,
                        {64, 1024, 2048, 4096, 8182, 16364, 32728, 65535, 65536, 65537}});
 
+// Mean times hide tail regressions, so this reports percentiles of the
+// individual call latencies as counters. Together with --benchmark_out and
+// --benchmark_out_format=csv|json, this gives latency and scaling curves across
+// transports, payload sizes and client thread counts.
+//
+// The percentiles are over the calls of all of the threads of a run: each
+// thread adds its latencies here, and the last one to finish reports them.
+// The other threads don't set the counters, so the sum across threads is the
+// reported value.
+static std::mutex gLatenciesMutex;
+static std::vector<int64_t> gLatenciesNs GUARDED_BY(gLatenciesMutex);
+static int gLatencyThreadsDone GUARDED_BY(gLatenciesMutex) = 0;
+
+static void ReportLatencyPercentiles(benchmark::State& state,
+                                     const std::vector<int64_t>& latenciesNs) {
+    std::vector<int64_t> allLatenciesNs;
+    {
+        std::lock_guard<std::mutex> l(gLatenciesMutex);
+        gLatenciesNs.insert(gLatenciesNs.end(), latenciesNs.begin(), latenciesNs.end());
+        if (++gLatencyThreadsDone < state.threads()) return;
+        gLatencyThreadsDone = 0;
+        allLatenciesNs.swap(gLatenciesNs);
+    }
+    if (allLatenciesNs.empty()) return;
+    std::sort(allLatenciesNs.begin(), allLatenciesNs.end());
+
+    auto percentile = [&](double p) {
+        size_t index = std::min(allLatenciesNs.size() - 1,
+                                static_cast<size_t>(p * allLatenciesNs.size() / 100));
+        return static_cast<double>(allLatenciesNs[index]);
+    };
+    state.counters["p50_ns"] = percentile(50);
+    state.counters["p90_ns"] = percentile(90);
+    state.counters["p99_ns"] = percentile(99);
+    state.counters["p99.9_ns"] = percentile(99.9);
+}
+
+void BM_latencyForTransportAndBytes(benchmark::State& state) {
+    sp<IBinder> binder = getBinderForOptions(state);
+    sp<IBinderRpcBenchmark> iface = interface_cast<IBinderRpcBenchmark>(binder);
+    CHECK(iface != nullptr);
+
+    std::vector<uint8_t> bytes = std::vector<uint8_t>(state.range(1));
+    for (size_t i = 0; i < bytes.size(); i++) {
+        bytes[i] = i % 256;
+    }
+
+    // Growing the vector while timing would add to the latencies.
+    std::vector<int64_t> latenciesNs;
+    latenciesNs.reserve(state.max_iterations);
+    while (state.KeepRunning()) {
+        std::vector<uint8_t> out;
+        auto start = std::chrono::steady_clock::now();
+        Status ret = iface->repeatBytes(bytes, &out);
+        auto end = std::chrono::steady_clock::now();
+        CHECK(ret.isOk()) << ret;
+        latenciesNs.push_back(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    }
+
+    // bytes go both ways
+    state.SetBytesProcessed(state.iterations() * bytes.size() * 2);
+    ReportLatencyPercentiles(state, latenciesNs);
+    SetLabel(state);
+}
+BENCHMARK(BM_latencyForTransportAndBytes)
+        ->ArgsProduct({kTransportList, {64, 4096, 65536, 1 << 20}})
+        ->ThreadRange(1, kMaxClientThreads)
+        ->UseRealTime();
+
 void BM_collectProxies(benchmark::State& state) {
     sp<IBinder> binder = getBinderForOptions(state);
     sp<IBinderRpcBenchmark> iface = interface_cast<IBinderRpcBenchmark>(binder);
@@ -305,6 +406,7 @@ void forkRpcServer(const char* addr, const sp<RpcServer>& server) {
     if (0 == fork()) {
         prctl(PR_SET_PDEATHSIG, SIGHUP); // racey, okay
         server->setRootObject(sp<MyBinderRpcBenchmark>::make());
+        server->setMaxThreads(kMaxClientThreads);
         CHECK_EQ(OK, server->setupUnixDomainServer(addr));
         server->join();
         exit(1);
@@ -356,6 +458,18 @@ int main(int argc, char** argv) {
     setupClient(gSessionTls, tlsAddr.c_str());
     gRpcTlsBinder = gSessionTls->getRootObject();
 
+    std::string uringAddr = tmp + "/binderRpcUringBenchmark";
+    (void)unlink(uringAddr.c_str());
+    forkRpcServer(uringAddr.c_str(), RpcServer::make(RpcTransportCtxFactoryUring::make()));
+    setupClient(gSessionUring, uringAddr.c_str());
+    gRpcUringBinder = gSessionUring->getRootObject();
+
+    std::string shmAddr = tmp + "/binderRpcShmBenchmark";
+    (void)unlink(shmAddr.c_str());
+    forkRpcServer(shmAddr.c_str(), RpcServer::make(RpcTransportCtxFactoryShm::make()));
+    setupClient(gSessionShm, shmAddr.c_str());
+    gRpcShmBinder = gSessionShm->getRootObject();
+
     ::benchmark::RunSpecifiedBenchmarks();
     return 0;
 }
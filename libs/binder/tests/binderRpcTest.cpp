@@ -20,8 +20,10 @@
 #endif
 
 #include <chrono>
+#include <condition_variable>
 #include <cstdlib>
 #include <iostream>
+#include <mutex>
 #include <thread>
 #include <type_traits>
 
@@ -561,6 +563,85 @@ TEST_P(BinderRpc, OnewayStressTest) {
     saturateThreadPool(kNumServerThreads, proc.rootIface);
 }
 
+TEST_P(BinderRpc, OnewayBatchingStressTest) {
+    if (clientOrServerSingleThreaded()) {
+        GTEST_SKIP() << "This test requires multiple threads";
+    }
+
+    constexpr size_t kNumClientThreads = 10;
+    constexpr size_t kNumServerThreads = 10;
+    constexpr size_t kNumCalls = 1000;
+
+    auto proc = createRpcTestSocketServerProcess({.numThreads = kNumServerThreads});
+    proc.proc->sessions.at(0).session->setOnewayBatching(4096, std::chrono::microseconds(100));
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < kNumClientThreads; i++) {
+        threads.push_back(std::thread([&] {
+            for (size_t j = 0; j < kNumCalls; j++) {
+                EXPECT_OK(proc.rootIface->sendString("a"));
+            }
+        }));
+    }
+
+    for (auto& t : threads) t.join();
+
+    saturateThreadPool(kNumServerThreads, proc.rootIface);
+}
+
+TEST_P(BinderRpc, OnewayBatchingPreservesOrder) {
+    if (clientOrServerSingleThreaded()) {
+        GTEST_SKIP() << "This test requires multiple threads";
+    }
+
+    constexpr size_t kNumQueued = 10;
+    constexpr size_t kNumExtraServerThreads = 4;
+
+    auto proc = createRpcTestSocketServerProcess({.numThreads = 1 + kNumExtraServerThreads});
+    proc.proc->sessions.at(0).session->setOnewayBatching(4096, std::chrono::milliseconds(1));
+
+    for (size_t i = 0; i + 1 < kNumQueued; i++) {
+        proc.rootIface->blockingSendIntOneway(i);
+    }
+    for (size_t i = 0; i + 1 < kNumQueued; i++) {
+        int n;
+        proc.rootIface->blockingRecvInt(&n);
+        EXPECT_EQ(n, i);
+    }
+
+    saturateThreadPool(1 + kNumExtraServerThreads, proc.rootIface);
+}
+
+TEST_P(BinderRpc, OnewayBatchingFlushesFullBatchBeforeDeadline) {
+    if (clientOrServerSingleThreaded()) {
+        GTEST_SKIP() << "This test requires multiple threads";
+    }
+
+    constexpr auto kFlushDeadline = 2s;
+
+    auto proc = createRpcTestSocketServerProcess({});
+    proc.proc->sessions.at(0).session->setOnewayBatching(1024, kFlushDeadline);
+
+    // Two of these don't fit in one batch, so whichever call waits to flush
+    // its batch is woken up by the other one instead of the deadline.
+    const std::string str(300, 'a');
+    auto sendString = [&] {
+        auto start = std::chrono::steady_clock::now();
+        EXPECT_OK(proc.rootIface->sendString(str));
+        return std::chrono::steady_clock::now() - start;
+    };
+
+    std::chrono::steady_clock::duration otherElapsed;
+    std::thread other([&] { otherElapsed = sendString(); });
+    auto elapsed = sendString();
+    other.join();
+
+    EXPECT_LT(elapsed, kFlushDeadline / 2);
+    EXPECT_LT(otherElapsed, kFlushDeadline / 2);
+
+    saturateThreadPool(1, proc.rootIface);
+}
+
 TEST_P(BinderRpc, OnewayCallQueueingWithFds) {
     if (!supportsFdTransport()) {
         GTEST_SKIP() << "Would fail trivially (which is tested elsewhere)";
@@ -1305,6 +1386,19 @@ static std::vector<BinderRpc::ParamType> getBinderRpcParams() {
         }
     }
 
+    // The shared memory and io_uring transports only change how bytes move
+    // over a unix domain socket, so one configuration each is enough.
+    for (const auto& security : {RpcSecurity::SHM, RpcSecurity::URING}) {
+        ret.push_back(BinderRpc::ParamType{
+                .type = SocketType::UNIX,
+                .security = security,
+                .clientVersion = RPC_WIRE_PROTOCOL_VERSION,
+                .serverVersion = RPC_WIRE_PROTOCOL_VERSION,
+                .singleThreaded = false,
+                .noKernel = false,
+        });
+    }
+
     return ret;
 }
 
@@ -1473,6 +1567,224 @@ INSTANTIATE_TEST_CASE_P(BinderRpc, BinderRpcServerOnly,
                                            ::testing::ValuesIn(testVersions())),
                         BinderRpcServerOnly::PrintTestParam);
 
+TEST(BinderRpc, EventThreadsServeManySessions) {
+    if constexpr (!kEnableRpcThreads) {
+        GTEST_SKIP() << "Test skipped because threads were disabled at build time";
+    }
+
+    auto addr = allocateSocketAddress();
+    auto server = RpcServer::make();
+    server->setEventThreads(2);
+    server->setRootObject(sp<BBinder>::make());
+    ASSERT_EQ(OK, server->setupUnixDomainServer(addr.c_str()));
+    server->start();
+
+    // more sessions than event threads, which stay connected while idle
+    std::vector<sp<RpcSession>> sessions;
+    for (size_t i = 0; i < 10; i++) {
+        auto session = RpcSession::make();
+        ASSERT_EQ(OK, session->setupUnixDomainClient(addr.c_str()));
+        sessions.push_back(session);
+    }
+    for (size_t repeat = 0; repeat < 2; repeat++) {
+        for (const auto& session : sessions) {
+            auto root = session->getRootObject();
+            ASSERT_NE(nullptr, root);
+            EXPECT_EQ(OK, root->pingBinder());
+        }
+    }
+    EXPECT_EQ(sessions.size(), server->listSessions().size());
+
+    for (const auto& session : sessions) {
+        EXPECT_TRUE(session->shutdownAndWait(true));
+    }
+    EXPECT_TRUE(server->shutdown());
+}
+
+TEST(BinderRpc, AdaptiveIncomingThreadsGrowAndRetire) {
+    if constexpr (!kEnableRpcThreads) {
+        GTEST_SKIP() << "Test skipped because threads were disabled at build time";
+    }
+
+    constexpr size_t kNumCalls = 3;
+
+    // calls back the binder which it is given
+    class Caller : public BBinder {
+        status_t onTransact(uint32_t code, const Parcel& data, Parcel* reply,
+                            uint32_t flags) override {
+            sp<IBinder> callback;
+            if (status_t status = data.readStrongBinder(&callback); status != OK) return status;
+            Parcel callbackData, callbackReply;
+            return callback->transact(code, callbackData, &callbackReply, flags);
+        }
+    };
+    // returns once all calls arrived, so they must be served in parallel
+    class Barrier : public BBinder {
+    public:
+        status_t onTransact(uint32_t, const Parcel&, Parcel*, uint32_t) override {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mArrived++;
+            mCv.notify_all();
+            bool all = mCv.wait_for(lock, 10s, [&] { return mArrived >= kNumCalls; });
+            return all ? OK : TIMED_OUT;
+        }
+
+    private:
+        std::mutex mMutex;
+        std::condition_variable mCv;
+        size_t mArrived = 0;
+    };
+
+    auto addr = allocateSocketAddress();
+    auto server = RpcServer::make();
+    server->setMaxThreads(kNumCalls);
+    server->setRootObject(sp<Caller>::make());
+    ASSERT_EQ(OK, server->setupUnixDomainServer(addr.c_str()));
+    server->start();
+
+    auto session = RpcSession::make();
+    session->setMaxIncomingThreads(kNumCalls);
+    session->setAdaptiveIncomingThreads(1, 100ms);
+    ASSERT_EQ(OK, session->setupUnixDomainClient(addr.c_str()));
+
+    RpcSession::IncomingThreadStats stats = session->getIncomingThreadStats();
+    EXPECT_EQ(1u, stats.threads);
+    EXPECT_EQ(1u, stats.spawned);
+
+    auto root = session->getRootObject();
+    ASSERT_NE(nullptr, root);
+    sp<IBinder> barrier = sp<Barrier>::make();
+    std::vector<std::thread> threads;
+    std::vector<status_t> statuses(kNumCalls, UNKNOWN_ERROR);
+    for (size_t i = 0; i < kNumCalls; i++) {
+        threads.push_back(std::thread([&, i] {
+            Parcel data, reply;
+            data.markForBinder(root);
+            statuses[i] = data.writeStrongBinder(barrier);
+            if (statuses[i] != OK) return;
+            statuses[i] = root->transact(IBinder::FIRST_CALL_TRANSACTION, data, &reply);
+        }));
+    }
+    for (auto& thread : threads) thread.join();
+    for (status_t status : statuses) EXPECT_EQ(OK, status) << statusToString(status);
+
+    stats = session->getIncomingThreadStats();
+    EXPECT_EQ(kNumCalls, stats.peakThreads);
+    EXPECT_EQ(kNumCalls, stats.spawned);
+    EXPECT_GE(stats.exhausted, 1u);
+
+    // idle threads beyond the minimum exit
+    for (size_t tries = 0; tries < 100 && stats.threads > 1; tries++) {
+        std::this_thread::sleep_for(50ms);
+        stats = session->getIncomingThreadStats();
+    }
+    EXPECT_EQ(1u, stats.threads);
+    EXPECT_EQ(kNumCalls - 1, stats.retired);
+
+    EXPECT_TRUE(session->shutdownAndWait(true));
+    EXPECT_TRUE(server->shutdown());
+}
+
+TEST(BinderRpc, BusyPollReads) {
+    if constexpr (!kEnableRpcThreads) {
+        GTEST_SKIP() << "Test skipped because threads were disabled at build time";
+    }
+
+    // replies after a while to any call other than a ping
+    class Slow : public BBinder {
+        status_t onTransact(uint32_t, const Parcel&, Parcel*, uint32_t) override {
+            std::this_thread::sleep_for(200ms);
+            return OK;
+        }
+    };
+
+    auto addr = allocateSocketAddress();
+    auto server = RpcServer::make();
+    server->setRootObject(sp<Slow>::make());
+    ASSERT_EQ(OK, server->setupUnixDomainServer(addr.c_str()));
+    server->start();
+
+    auto session = RpcSession::make();
+    session->setBusyPollReads(20ms, 0us);
+    ASSERT_EQ(OK, session->setupUnixDomainClient(addr.c_str()));
+    auto root = session->getRootObject();
+    ASSERT_NE(nullptr, root);
+
+    for (size_t i = 0; i < 10; i++) EXPECT_EQ(OK, root->pingBinder());
+    RpcSession::BusyPollStats stats = session->getBusyPollStats();
+    EXPECT_GE(stats.hits, 1u);
+
+    Parcel data, reply;
+    data.markForBinder(root);
+    EXPECT_EQ(OK, root->transact(IBinder::FIRST_CALL_TRANSACTION, data, &reply));
+    EXPECT_GT(session->getBusyPollStats().misses, stats.misses);
+
+    EXPECT_TRUE(session->shutdownAndWait(true));
+    EXPECT_TRUE(server->shutdown());
+}
+
+TEST(BinderRpc, KernelTlsRoundTrip) {
+    if constexpr (!kEnableRpcThreads) {
+        GTEST_SKIP() << "Test skipped because threads were disabled at build time";
+    }
+
+    // replies with the bytes it is sent
+    class Echo : public BBinder {
+        status_t onTransact(uint32_t, const Parcel& data, Parcel* reply, uint32_t) override {
+            std::vector<uint8_t> bytes;
+            if (status_t status = data.readByteVector(&bytes); status != OK) return status;
+            return reply->writeByteVector(bytes);
+        }
+    };
+
+    // Where the kernel doesn't have kTLS, this checks that BoringSSL keeps
+    // handling the records instead.
+    RpcTransportCtxFactoryTls::Options options{.kernelTls = true};
+    auto serverVerifier = std::make_shared<RpcCertificateVerifierSimple>();
+    auto server = RpcServer::make(
+            RpcTransportCtxFactoryTls::make(serverVerifier, std::make_unique<RpcAuthSelfSigned>(),
+                                            options));
+    server->setRootObject(sp<Echo>::make());
+    unsigned int port;
+    ASSERT_EQ(OK, server->setupInetServer(kLocalInetAddress, 0, &port));
+
+    auto clientVerifier = std::make_shared<RpcCertificateVerifierSimple>();
+    auto session = RpcSession::make(
+            RpcTransportCtxFactoryTls::make(clientVerifier, std::make_unique<RpcAuthSelfSigned>(),
+                                            options));
+    ASSERT_EQ(OK,
+              serverVerifier->addTrustedPeerCertificate(RpcCertificateFormat::PEM,
+                                                        session->getCertificate(
+                                                                RpcCertificateFormat::PEM)));
+    ASSERT_EQ(OK,
+              clientVerifier->addTrustedPeerCertificate(RpcCertificateFormat::PEM,
+                                                        server->getCertificate(
+                                                                RpcCertificateFormat::PEM)));
+    server->start();
+
+    ASSERT_EQ(OK, session->setupInetClient(kLocalInetAddress, port));
+    auto root = session->getRootObject();
+    ASSERT_NE(nullptr, root);
+
+    // up to several TLS records (of at most 16KB) each way
+    for (size_t size : {size_t{1}, size_t{16 * 1024 + 1}, size_t{256 * 1024}}) {
+        std::vector<uint8_t> bytes(size);
+        for (size_t i = 0; i < size; i++) {
+            bytes[i] = i % 256;
+        }
+        Parcel data, reply;
+        data.markForBinder(root);
+        ASSERT_EQ(OK, data.writeByteVector(bytes));
+        ASSERT_EQ(OK, root->transact(IBinder::FIRST_CALL_TRANSACTION, data, &reply));
+        std::vector<uint8_t> echoed;
+        ASSERT_EQ(OK, reply.readByteVector(&echoed));
+        EXPECT_EQ(bytes, echoed) << "size " << size;
+    }
+
+    EXPECT_TRUE(session->shutdownAndWait(true));
+    EXPECT_TRUE(server->shutdown());
+}
+
 class RpcTransportTestUtils {
 public:
     // Only parameterized only server version because `RpcSession` is bypassed
@@ -46,7 +46,9 @@
 #include <binder/ProcessState.h>
 #include <binder/RpcTlsTestUtils.h>
 #include <binder/RpcTlsUtils.h>
+#include <binder/RpcTransportShm.h>
 #include <binder/RpcTransportTls.h>
+#include <binder/RpcTransportUring.h>
 
 #include <signal.h>
 
@@ -67,7 +69,10 @@ namespace android {
 
 constexpr char kLocalInetAddress[] = "127.0.0.1";
 
-enum class RpcSecurity { RAW, TLS };
+// SHM and URING are alternative transports rather than security modes, but
+// they are selected the same way. They are left out of RpcSecurityValues() and
+// only exercised by the BinderRpc suite, over unix domain sockets.
+enum class RpcSecurity { RAW, TLS, SHM, URING };
 
 static inline std::vector<RpcSecurity> RpcSecurityValues() {
     return {RpcSecurity::RAW, RpcSecurity::TLS};
@@ -203,6 +208,10 @@ static inline std::unique_ptr<RpcTransportCtxFactory> newTlsFactory(
             }
             return RpcTransportCtxFactoryTls::make(std::move(verifier), std::move(auth));
         }
+        case RpcSecurity::SHM:
+            return RpcTransportCtxFactoryShm::make();
+        case RpcSecurity::URING:
+            return RpcTransportCtxFactoryUring::make();
         default:
             LOG_ALWAYS_FATAL("Unknown RpcSecurity %d", rpcSecurity);
     }
@@ -144,6 +144,9 @@ public:
         if (socketType() == SocketType::UNIX_BOOTSTRAP && rpcSecurity() == RpcSecurity::TLS) {
             GTEST_SKIP() << "Unix bootstrap not supported over a TLS transport";
         }
+        if (rpcSecurity() == RpcSecurity::SHM && socketType() != SocketType::UNIX) {
+            GTEST_SKIP() << "The shm transport only supports unix domain socket servers";
+        }
     }
 
     BinderRpcTestProcessSession createRpcTestSocketServerProcess(const BinderRpcOptions& options) {
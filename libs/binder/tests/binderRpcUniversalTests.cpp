@@ -207,6 +207,35 @@ TEST_P(BinderRpc, RepeatBinder) {
     EXPECT_EQ(0, MyBinderRpcSession::gNum);
 }
 
+TEST_P(BinderRpc, RepeatManyBinders) {
+    auto proc = createRpcTestSocketServerProcess({});
+
+    // enough to spread over all node shards
+    constexpr size_t kNumBinders = 100;
+
+    std::vector<sp<IBinder>> inBinders;
+    for (size_t i = 0; i < kNumBinders; i++) {
+        inBinders.push_back(sp<MyBinderRpcSession>::make("foo"));
+    }
+
+    // send each of them twice, so the second time uses the existing address
+    for (size_t repeat = 0; repeat < 2; repeat++) {
+        for (const auto& inBinder : inBinders) {
+            sp<IBinder> outBinder;
+            EXPECT_OK(proc.rootIface->repeatBinder(inBinder, &outBinder));
+            EXPECT_EQ(inBinder, outBinder);
+        }
+    }
+
+    inBinders.clear();
+
+    // Force reading a reply, to process any pending dec refs from the other
+    // process.
+    EXPECT_EQ(OK, proc.rootBinder->pingBinder());
+
+    EXPECT_EQ(0, MyBinderRpcSession::gNum);
+}
+
 TEST_P(BinderRpc, RepeatTheirBinder) {
     auto proc = createRpcTestSocketServerProcess({});
 
@@ -7,7 +7,9 @@
 #include <cstdlib>
 #include <cstdio>
 
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <vector>
 #include <tuple>
 
@@ -51,6 +53,19 @@ public:
 
 static uint64_t warn_latency = std::numeric_limits<uint64_t>::max();
 
+// Result of one run, as written by --csv and --json (latencies are in ns).
+struct RunSummary {
+    int workers = 0;
+    int payload_size = 0;
+    double iterations_per_sec = 0;
+    uint64_t average = 0;
+    uint64_t p50 = 0;
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+    uint64_t p999 = 0;
+    uint64_t worst = 0;
+};
+
 struct ProcResults {
     vector<uint64_t> data;
 
@@ -63,6 +78,25 @@ struct ProcResults {
     uint64_t worst() {
         return *max_element(data.begin(), data.end());
     }
+    // data must be sorted
+    uint64_t percentile(double p) {
+        size_t index = min(data.size() - 1, size_t(p * data.size() / 100));
+        return data[index];
+    }
+    void summarize(RunSummary* summary) {
+        if (data.size() == 0) return;
+        sort(data.begin(), data.end());
+        uint64_t total_time = 0;
+        for (uint64_t elem : data) {
+            total_time += elem;
+        }
+        summary->average = total_time / data.size();
+        summary->p50 = percentile(50);
+        summary->p90 = percentile(90);
+        summary->p99 = percentile(99);
+        summary->p999 = percentile(99.9);
+        summary->worst = data.back();
+    }
     void dump() {
         if (data.size() == 0) {
             // This avoids index-out-of-bounds below.
@@ -99,10 +133,12 @@ struct ProcResults {
         double percentile_90 = data[(90 * data.size()) / 100] / 1.0E6;
         double percentile_95 = data[(95 * data.size()) / 100] / 1.0E6;
         double percentile_99 = data[(99 * data.size()) / 100] / 1.0E6;
+        double percentile_99_9 = percentile(99.9) / 1.0E6;
         cout << "50%: " << percentile_50 << " ";
         cout << "90%: " << percentile_90 << " ";
         cout << "95%: " << percentile_95 << " ";
-        cout << "99%: " << percentile_99 << endl;
+        cout << "99%: " << percentile_99 << " ";
+        cout << "99.9%: " << percentile_99_9 << endl;
     }
 };
 
@@ -293,12 +329,16 @@ void signal_all(vector<Pipe>& v)
     }
 }
 
-void run_main(int iterations,
-              int workers,
-              int payload_size,
-              int cs_pair,
-              bool training_round=false)
+RunSummary run_main(int iterations,
+                    int workers,
+                    int payload_size,
+                    int cs_pair,
+                    bool training_round=false)
 {
+    RunSummary summary;
+    summary.workers = workers;
+    summary.payload_size = payload_size;
+
     vector<Pipe> pipes;
     // Create all the workers and wait for them to spawn.
     for (int i = 0; i < workers; i++) {
@@ -324,6 +364,7 @@ void run_main(int iterations,
     // Calculate overall throughput.
     double iterations_per_sec = double(iterations * workers) / (chrono::duration_cast<chrono::nanoseconds>(end - start).count() / 1.0E9);
     cout << "iterations per sec: " << iterations_per_sec << endl;
+    summary.iterations_per_sec = iterations_per_sec;
 
     // Collect all results from the workers.
     cout << "collecting results" << endl;
@@ -350,9 +391,56 @@ void run_main(int iterations,
         cout << "Max latency during training: " << tot_results.worst() / 1.0E6 << "ms" << endl;
     } else {
         tot_results.dump();
+        tot_results.summarize(&summary);
+    }
+    return summary;
+}
+
+vector<int> parse_list(const char* arg)
+{
+    vector<int> values;
+    stringstream ss(arg);
+    string item;
+    while (getline(ss, item, ',')) {
+        values.push_back(atoi(item.c_str()));
+    }
+    return values;
+}
+
+void write_csv(const string& path, const vector<RunSummary>& summaries)
+{
+    ofstream out(path);
+    ASSERT_TRUE(out.good());
+    out << "workers,payload_size,iterations_per_sec,average_ns,p50_ns,p90_ns,p99_ns,p99_9_ns,"
+           "worst_ns" << endl;
+    for (const RunSummary& s : summaries) {
+        out << s.workers << "," << s.payload_size << "," << s.iterations_per_sec << ","
+            << s.average << "," << s.p50 << "," << s.p90 << "," << s.p99 << "," << s.p999 << ","
+            << s.worst << endl;
     }
 }
 
+void write_json(const string& path, const vector<RunSummary>& summaries)
+{
+    ofstream out(path);
+    ASSERT_TRUE(out.good());
+    out << "[" << endl;
+    for (size_t i = 0; i < summaries.size(); i++) {
+        const RunSummary& s = summaries[i];
+        out << "  {\"workers\": " << s.workers
+            << ", \"payload_size\": " << s.payload_size
+            << ", \"iterations_per_sec\": " << s.iterations_per_sec
+            << ", \"average_ns\": " << s.average
+            << ", \"p50_ns\": " << s.p50
+            << ", \"p90_ns\": " << s.p90
+            << ", \"p99_ns\": " << s.p99
+            << ", \"p99_9_ns\": " << s.p999
+            << ", \"worst_ns\": " << s.worst << "}"
+            << (i + 1 < summaries.size() ? "," : "") << endl;
+    }
+    out << "]" << endl;
+}
+
 int main(int argc, char *argv[])
 {
     int workers = 2;
@@ -361,6 +449,10 @@ int main(int argc, char *argv[])
     bool cs_pair = false;
     bool training_round = false;
     int max_time_us;
+    vector<int> sweep_workers;
+    vector<int> sweep_sizes;
+    string csv_path;
+    string json_path;
 
     // Parse arguments.
     for (int i = 1; i < argc; i++) {
@@ -372,8 +464,25 @@ int main(int argc, char *argv[])
             cout << "\t-s N    : Specify payload size." << endl;
             cout << "\t-t      : Run training round." << endl;
             cout << "\t-w N    : Specify total number of workers." << endl;
+            cout << "\t--sweep-workers N,M,... : Run once for each number of workers." << endl;
+            cout << "\t--sweep-sizes N,M,...   : Run once for each payload size." << endl;
+            cout << "\t--csv FILE  : Write throughput and latency percentiles as CSV." << endl;
+            cout << "\t--json FILE : Write throughput and latency percentiles as JSON." << endl;
             return 0;
         }
+        if (string(argv[i]) == "--sweep-workers" || string(argv[i]) == "--sweep-sizes" ||
+            string(argv[i]) == "--csv" || string(argv[i]) == "--json") {
+            if (i + 1 == argc) {
+                cout << argv[i] << " requires an argument\n" << endl;
+                exit(EXIT_FAILURE);
+            }
+            if (string(argv[i]) == "--sweep-workers") sweep_workers = parse_list(argv[i+1]);
+            if (string(argv[i]) == "--sweep-sizes") sweep_sizes = parse_list(argv[i+1]);
+            if (string(argv[i]) == "--csv") csv_path = argv[i+1];
+            if (string(argv[i]) == "--json") json_path = argv[i+1];
+            i++;
+            continue;
+        }
         if (string(argv[i]) == "-w") {
             if (i + 1 == argc) {
                 cout << "-w requires an argument\n" << endl;
@@ -438,6 +547,20 @@ int main(int argc, char *argv[])
         cout << "Completed training round" << endl << endl;
     }
 
-    run_main(iterations, workers, payload_size, cs_pair);
+    if (sweep_workers.empty()) sweep_workers.push_back(workers);
+    if (sweep_sizes.empty()) sweep_sizes.push_back(payload_size);
+
+    vector<RunSummary> summaries;
+    for (int w : sweep_workers) {
+        for (int sz : sweep_sizes) {
+            if (sweep_workers.size() > 1 || sweep_sizes.size() > 1) {
+                cout << "workers: " << w << " payload size: " << sz << endl;
+            }
+            summaries.push_back(run_main(iterations, w, sz, cs_pair));
+        }
+    }
+
+    if (!csv_path.empty()) write_csv(csv_path, summaries);
+    if (!json_path.empty()) write_json(json_path, summaries);
     return 0;
 }
@@ -14,189 +14,370 @@
  * limitations under the License.
  */
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
-#include <android-base/parseint.h>
 #include <android-base/strings.h>
+#include <android-base/unique_fd.h>
 #include <binder/Binder.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <sys/types.h>
-#include <fstream>
-#include <regex>
+
+#include <array>
+#include <charconv>
+#include <optional>
+#include <unordered_map>
 
 #include <binderdebug/BinderDebug.h>
 
 namespace android {
 
-static std::string contextToString(BinderDebugContext context) {
-    switch (context) {
-        case BinderDebugContext::BINDER:
-            return "binder";
-        case BinderDebugContext::HWBINDER:
-            return "hwbinder";
-        case BinderDebugContext::VNDBINDER:
-            return "vndbinder";
-        default:
-            return std::string();
-    }
-}
-
-static status_t scanBinderContext(pid_t pid, const std::string& contextName,
-                                  std::function<void(const std::string&)> eachLine) {
-    std::ifstream ifs("/dev/binderfs/binder_logs/proc/" + std::to_string(pid));
-    if (!ifs.is_open()) {
-        ifs.open("/d/binder/proc/" + std::to_string(pid));
-        if (!ifs.is_open()) {
-            return -errno;
+namespace {
+
+constexpr size_t kContextCount = 3;
+
+size_t contextIndex(BinderDebugContext context) {
+    return static_cast<size_t>(context);
+}
+
+std::optional<BinderDebugContext> contextFromName(std::string_view name) {
+    if (name == "binder") return BinderDebugContext::BINDER;
+    if (name == "hwbinder") return BinderDebugContext::HWBINDER;
+    if (name == "vndbinder") return BinderDebugContext::VNDBINDER;
+    return std::nullopt;
+}
+
+// The state of one context of a process.
+struct ParsedContext {
+    BinderPidInfo pidInfo;
+    // desc -> node, of the references which the process holds
+    std::unordered_map<int32_t, int32_t> nodeOfDesc;
+    // node -> processes which hold a reference to it, of the nodes which the process owns
+    std::unordered_map<int32_t, std::vector<pid_t>> pidsOfNode;
+};
+
+using ParsedContexts = std::array<ParsedContext, kContextCount>;
+
+template <typename T>
+bool parseNumber(std::string_view token, T* value, int base = 10) {
+    const char* end = token.data() + token.size();
+    const auto [ptr, error] = std::from_chars(token.data(), end, *value, base);
+    return error == std::errc() && ptr == end;
+}
+
+// Splits line at spaces into tokens, which point into line.
+void tokenize(std::string_view line, std::vector<std::string_view>* tokens) {
+    tokens->clear();
+    size_t start = line.find_first_not_of(' ');
+    while (start != std::string_view::npos) {
+        const size_t end = line.find(' ', start);
+        tokens->push_back(line.substr(start, end - start));
+        start = line.find_first_not_of(' ', end);
+    }
+}
+
+// Examples of what we are looking at:
+// node 66730: u00007590061890e0 c0000759036130950 pri 0:120 hs 1 hw 1 ls 0 lw 0 is 2 iw 2 tr 1 proc 2300 1790
+void parseNode(const std::vector<std::string_view>& tokens, ParsedContext* context) {
+    std::optional<int32_t> node;
+    // remove the colon
+    if (int32_t number; tokens.size() > 1 && base::EndsWith(tokens[1], ":") &&
+        parseNumber(tokens[1].substr(0, tokens[1].size() - 1), &number)) {
+        node = number;
+    }
+
+    uint64_t ptr = 0;
+    std::vector<pid_t> pids;
+    bool pidsSection = false;
+    for (std::string_view token : tokens) {
+        if (pidsSection) {
+            // The last numbers in the line after "proc" are all client PIDs
+            pid_t pid;
+            if (!parseNumber(token, &pid)) {
+                LOG(ERROR) << "Failed to parse pid int: " << token;
+                break;
+            }
+            pids.push_back(pid);
+        } else if (token == "proc") {
+            pidsSection = true;
+        } else if (base::StartsWith(token, "u") && !parseNumber(token.substr(1), &ptr, 16)) {
+            LOG(ERROR) << "Failed to parse pointer: " << token;
+            return;
         }
     }
+    if (pids.empty()) {
+        return;
+    }
+
+    if (ptr == 0) {
+        LOG(ERROR) << "We failed to parse the pointer, so we can't add the refPids";
+    } else {
+        auto& refPids = context->pidInfo.refPids[ptr];
+        refPids.insert(refPids.end(), pids.begin(), pids.end());
+    }
+    if (node) {
+        context->pidsOfNode[*node] = std::move(pids);
+    }
+}
+
+// ref 52493: desc 910 node 52492 s 1 w 1 d 0000000000000000
+void parseRef(const std::vector<std::string_view>& tokens, ParsedContext* context) {
+    // References to dead nodes read "desc 910 dead node 52492", and have no clients to look for.
+    if (tokens.size() < 6 || tokens[2] != "desc" || tokens[4] != "node") {
+        return;
+    }
+    int32_t desc;
+    int32_t node;
+    if (!parseNumber(tokens[3], &desc) || !parseNumber(tokens[5], &node)) {
+        LOG(ERROR) << "Failed to parse binder_logs ref entry: " << tokens[3] << " " << tokens[5];
+        return;
+    }
+    context->nodeOfDesc[desc] = node;
+}
+
+// thread 2999: l 00 need_return 1 tr 0
+void parseThread(std::string_view line, ParsedContext* context) {
+    const size_t pos = line.find("l ");
+    if (pos == std::string_view::npos || pos + 3 >= line.size()) {
+        return;
+    }
+    // "1" is waiting in binder driver
+    // "2" is poll. It's impossible to tell if these are in use.
+    //     and HIDL default code doesn't use it.
+    const bool isInUse = line[pos + 2] != '1';
+    // "0" is a thread that has called into binder
+    // "1" is looper thread
+    // "2" is main looper thread
+    const bool isBinderThread = line[pos + 3] != '0';
+    if (!isBinderThread) {
+        return;
+    }
+    if (isInUse) {
+        context->pidInfo.threadUsage++;
+    }
+    context->pidInfo.threadCount++;
+}
+
+// Parses the contents of a binder_logs proc file without copying its lines. If only is set, the
+// other contexts are skipped.
+void parseContexts(std::string_view contents, std::optional<BinderDebugContext> only,
+                   ParsedContexts* contexts) {
+    ParsedContext* context = nullptr;
+    std::vector<std::string_view> tokens;
+    while (!contents.empty()) {
+        const size_t end = contents.find('\n');
+        const std::string_view line = contents.substr(0, end);
+        contents.remove_prefix(end == std::string_view::npos ? contents.size() : end + 1);
 
-    bool isDesiredContext = false;
-    std::string line;
-    while (getline(ifs, line)) {
         if (base::StartsWith(line, "context")) {
-            isDesiredContext = base::Split(line, " ").back() == contextName;
+            const auto current = contextFromName(line.substr(line.rfind(' ') + 1));
+            const bool wanted = current && (!only || *only == *current);
+            context = wanted ? &(*contexts)[contextIndex(*current)] : nullptr;
             continue;
         }
-        if (!isDesiredContext) {
+        if (context == nullptr) {
             continue;
         }
-        eachLine(line);
+        if (base::StartsWith(line, "  node")) {
+            tokenize(line, &tokens);
+            parseNode(tokens, context);
+        } else if (base::StartsWith(line, "  ref")) {
+            tokenize(line, &tokens);
+            parseRef(tokens, context);
+        } else if (base::StartsWith(line, "  thread")) {
+            parseThread(line, context);
+        }
+    }
+}
+
+status_t openLog(pid_t pid, base::unique_fd* fd, struct stat* st) {
+    const std::string pidString = std::to_string(pid);
+    fd->reset(open(("/dev/binderfs/binder_logs/proc/" + pidString).c_str(), O_RDONLY | O_CLOEXEC));
+    if (!fd->ok()) {
+        fd->reset(open(("/d/binder/proc/" + pidString).c_str(), O_RDONLY | O_CLOEXEC));
+        if (!fd->ok()) {
+            return -errno;
+        }
+    }
+    if (fstat(fd->get(), st) != 0) {
+        return -errno;
     }
     return OK;
 }
 
-// Examples of what we are looking at:
-// node 66730: u00007590061890e0 c0000759036130950 pri 0:120 hs 1 hw 1 ls 0 lw 0 is 2 iw 2 tr 1 proc 2300 1790
-// thread 2999: l 00 need_return 1 tr 0
+status_t readLog(const base::unique_fd& fd, std::string* contents) {
+    if (!base::ReadFdToString(fd, contents)) {
+        return -errno;
+    }
+    return OK;
+}
+
+status_t readContexts(pid_t pid, std::optional<BinderDebugContext> only, ParsedContexts* contexts) {
+    base::unique_fd fd;
+    struct stat st;
+    if (status_t status = openLog(pid, &fd, &st); status != OK) {
+        return status;
+    }
+    std::string contents;
+    if (status_t status = readLog(fd, &contents); status != OK) {
+        return status;
+    }
+    parseContexts(contents, only, contexts);
+    return OK;
+}
+
+void appendClientPids(const ParsedContext& client, const ParsedContext& service, int32_t handle,
+                      std::vector<pid_t>* pids) {
+    const auto node = client.nodeOfDesc.find(handle);
+    if (node == client.nodeOfDesc.end()) {
+        return;
+    }
+    const auto clients = service.pidsOfNode.find(node->second);
+    if (clients == service.pidsOfNode.end()) {
+        return;
+    }
+    pids->insert(pids->end(), clients->second.begin(), clients->second.end());
+}
+
+} // namespace
+
+status_t parseBinderPidInfo(std::string_view contents, BinderDebugContext context,
+                            BinderPidInfo* pidInfo) {
+    ParsedContexts contexts;
+    parseContexts(contents, context, &contexts);
+    *pidInfo = std::move(contexts[contextIndex(context)].pidInfo);
+    return OK;
+}
+
 status_t getBinderPidInfo(BinderDebugContext context, pid_t pid, BinderPidInfo* pidInfo) {
-    std::smatch match;
-    static const std::regex kReferencePrefix("^\\s*node \\d+:\\s+u([0-9a-f]+)\\s+c([0-9a-f]+)\\s+");
-    static const std::regex kThreadPrefix("^\\s*thread \\d+:\\s+l\\s+(\\d)(\\d)");
-    std::string contextStr = contextToString(context);
-    status_t ret = scanBinderContext(pid, contextStr, [&](const std::string& line) {
-        if (base::StartsWith(line, "  node")) {
-            std::vector<std::string> splitString = base::Tokenize(line, " ");
-            bool pids = false;
-            uint64_t ptr = 0;
-            for (const auto& token : splitString) {
-                if (base::StartsWith(token, "u")) {
-                    const std::string ptrString = "0x" + token.substr(1);
-                    if (!::android::base::ParseUint(ptrString.c_str(), &ptr)) {
-                        LOG(ERROR) << "Failed to parse pointer: " << ptrString;
-                        return;
-                    }
-                } else {
-                    // The last numbers in the line after "proc" are all client PIDs
-                    if (token == "proc") {
-                        pids = true;
-                    } else if (pids) {
-                        int32_t pid;
-                        if (!::android::base::ParseInt(token, &pid)) {
-                            LOG(ERROR) << "Failed to parse pid int: " << token;
-                            return;
-                        }
-                        if (ptr == 0) {
-                            LOG(ERROR) << "We failed to parse the pointer, so we can't add the refPids";
-                            return;
-                        }
-                        pidInfo->refPids[ptr].push_back(pid);
-                    }
-                }
-            }
-        } else if (base::StartsWith(line, "  thread")) {
-            auto pos = line.find("l ");
-            if (pos != std::string::npos) {
-                // "1" is waiting in binder driver
-                // "2" is poll. It's impossible to tell if these are in use.
-                //     and HIDL default code doesn't use it.
-                bool isInUse = line.at(pos + 2) != '1';
-                // "0" is a thread that has called into binder
-                // "1" is looper thread
-                // "2" is main looper thread
-                bool isBinderThread = line.at(pos + 3) != '0';
-                if (!isBinderThread) {
-                    return;
-                }
-                if (isInUse) {
-                    pidInfo->threadUsage++;
-                }
-
-                pidInfo->threadCount++;
-            }
-        }
-    });
-    return ret;
+    ParsedContexts contexts;
+    if (status_t status = readContexts(pid, context, &contexts); status != OK) {
+        return status;
+    }
+    *pidInfo = std::move(contexts[contextIndex(context)].pidInfo);
+    return OK;
 }
 
-// Examples of what we are looking at:
-// ref 52493: desc 910 node 52492 s 1 w 1 d 0000000000000000
-// node 29413: u00007803fc982e80 c000078042c982210 pri 0:139 hs 1 hw 1 ls 0 lw 0 is 2 iw 2 tr 1 proc 488 683
 status_t getBinderClientPids(BinderDebugContext context, pid_t pid, pid_t servicePid,
                              int32_t handle, std::vector<pid_t>* pids) {
-    std::smatch match;
-    static const std::regex kNodeNumber("^\\s+ref \\d+:\\s+desc\\s+(\\d+)\\s+node\\s+(\\d+).*");
-    std::string contextStr = contextToString(context);
-    int32_t node;
-    status_t ret = scanBinderContext(pid, contextStr, [&](const std::string& line) {
-        if (!base::StartsWith(line, "  ref")) return;
+    ParsedContexts client;
+    if (status_t status = readContexts(pid, context, &client); status != OK) {
+        return status;
+    }
+    ParsedContexts service;
+    if (status_t status = readContexts(servicePid, context, &service); status != OK) {
+        return status;
+    }
+    appendClientPids(client[contextIndex(context)], service[contextIndex(context)], handle, pids);
+    return OK;
+}
 
-        std::vector<std::string> splitString = base::Tokenize(line, " ");
-        if (splitString.size() < 12) {
-            LOG(ERROR) << "Failed to parse binder_logs ref entry. Expecting size greater than 11, but got: " << splitString.size();
-            return;
-        }
-        int32_t desc;
-        if (!::android::base::ParseInt(splitString[3].c_str(), &desc)) {
-            LOG(ERROR) << "Failed to parse desc int: " << splitString[3];
-            return;
-        }
-        if (handle != desc) {
-            return;
-        }
-        if (!::android::base::ParseInt(splitString[5].c_str(), &node)) {
-            LOG(ERROR) << "Failed to parse node int: " << splitString[5];
-            return;
+status_t getBinderPidInfos(BinderDebugContext context, const std::vector<pid_t>& pids,
+                           std::map<pid_t, BinderPidInfo>* pidInfos) {
+    status_t result = OK;
+    for (pid_t pid : pids) {
+        BinderPidInfo pidInfo;
+        if (status_t status = getBinderPidInfo(context, pid, &pidInfo); status != OK) {
+            if (result == OK) result = status;
+            continue;
         }
-        LOG(INFO) << "Parsed the node: " << node;
-    });
-    if (ret != OK) {
-        return ret;
+        (*pidInfos)[pid] = std::move(pidInfo);
     }
+    return result;
+}
 
-    ret = scanBinderContext(servicePid, contextStr, [&](const std::string& line) {
-        if (!base::StartsWith(line, "  node")) return;
+struct BinderDebugCache::ParsedLog {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    ParsedContexts contexts;
 
-        std::vector<std::string> splitString = base::Tokenize(line, " ");
-        if (splitString.size() < 21) {
-            LOG(ERROR) << "Failed to parse binder_logs node entry. Expecting size greater than 20, but got: " << splitString.size();
-            return;
-        }
+    bool isCurrent(const struct stat& st) const {
+        return dev == st.st_dev && ino == st.st_ino && size == st.st_size &&
+                mtime.tv_sec == st.st_mtim.tv_sec && mtime.tv_nsec == st.st_mtim.tv_nsec;
+    }
+};
 
-        // remove the colon
-        const std::string nodeString = splitString[1].substr(0, splitString[1].size() - 1);
-        int32_t matchedNode;
-        if (!::android::base::ParseInt(nodeString.c_str(), &matchedNode)) {
-            LOG(ERROR) << "Failed to parse node int: " << nodeString;
-            return;
-        }
+BinderDebugCache::BinderDebugCache() = default;
+BinderDebugCache::~BinderDebugCache() = default;
 
-        if (node != matchedNode) {
-            return;
+void BinderDebugCache::clear() {
+    mLogs.clear();
+}
+
+status_t BinderDebugCache::getParsedLog(pid_t pid, const ParsedLog** log) {
+    base::unique_fd fd;
+    struct stat st;
+    if (status_t status = openLog(pid, &fd, &st); status != OK) {
+        mLogs.erase(pid);
+        return status;
+    }
+    // The inode changes when the pid is reused by another process, and the size and mtime when
+    // a regular file is rewritten.
+    auto it = mLogs.find(pid);
+    if (it != mLogs.end() && it->second->isCurrent(st)) {
+        *log = it->second.get();
+        return OK;
+    }
+
+    std::string contents;
+    if (status_t status = readLog(fd, &contents); status != OK) {
+        return status;
+    }
+    auto parsed = std::make_unique<ParsedLog>();
+    parsed->dev = st.st_dev;
+    parsed->ino = st.st_ino;
+    parsed->size = st.st_size;
+    parsed->mtime = st.st_mtim;
+    parseContexts(contents, std::nullopt, &parsed->contexts);
+    *log = parsed.get();
+    mLogs[pid] = std::move(parsed);
+    return OK;
+}
+
+status_t BinderDebugCache::getBinderPidInfo(BinderDebugContext context, pid_t pid,
+                                            BinderPidInfo* pidInfo) {
+    const ParsedLog* log;
+    if (status_t status = getParsedLog(pid, &log); status != OK) {
+        return status;
+    }
+    *pidInfo = log->contexts[contextIndex(context)].pidInfo;
+    return OK;
+}
+
+status_t BinderDebugCache::getBinderClientPids(BinderDebugContext context, pid_t pid,
+                                               pid_t servicePid, int32_t handle,
+                                               std::vector<pid_t>* pids) {
+    const ParsedLog* client;
+    if (status_t status = getParsedLog(pid, &client); status != OK) {
+        return status;
+    }
+    // When both are the same process, a second lookup could replace the log of the client.
+    const ParsedLog* service = client;
+    if (servicePid != pid) {
+        if (status_t status = getParsedLog(servicePid, &service); status != OK) {
+            return status;
         }
-        bool pidsSection = false;
-        for (const auto& token : splitString) {
-            if (token == "proc") {
-                pidsSection = true;
-            } else if (pidsSection == true) {
-                int32_t pid;
-                if (!::android::base::ParseInt(token.c_str(), &pid)) {
-                    LOG(ERROR) << "Failed to parse PID int: " << token;
-                    return;
-                }
-                pids->push_back(pid);
-            }
+    }
+    appendClientPids(client->contexts[contextIndex(context)],
+                     service->contexts[contextIndex(context)], handle, pids);
+    return OK;
+}
+
+status_t BinderDebugCache::getBinderPidInfos(BinderDebugContext context,
+                                             const std::vector<pid_t>& pids,
+                                             std::map<pid_t, BinderPidInfo>* pidInfos) {
+    status_t result = OK;
+    for (pid_t pid : pids) {
+        BinderPidInfo pidInfo;
+        if (status_t status = getBinderPidInfo(context, pid, &pidInfo); status != OK) {
+            if (result == OK) result = status;
+            continue;
         }
-    });
-    return ret;
+        (*pidInfos)[pid] = std::move(pidInfo);
+    }
+    return result;
 }
 
 } // namespace  android
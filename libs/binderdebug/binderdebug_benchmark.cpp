@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/stringprintf.h>
+#include <benchmark/benchmark.h>
+#include <binderdebug/BinderDebug.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace android {
+
+namespace {
+
+constexpr char kLogsDir[] = "/dev/binderfs/binder_logs/proc";
+
+// The pids of the processes which use binder, whose logs are the real input of dumps.
+std::vector<pid_t> binderPids() {
+    std::vector<pid_t> pids;
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(kLogsDir), closedir);
+    if (!dir) {
+        return pids;
+    }
+    while (const dirent* entry = readdir(dir.get())) {
+        pid_t pid;
+        if (base::ParseInt(entry->d_name, &pid)) {
+            pids.push_back(pid);
+        }
+    }
+    return pids;
+}
+
+// A log the size of that of system_server on a busy device.
+std::string syntheticLog() {
+    std::string log = "binder proc state:\nproc 1000\ncontext binder\n";
+    for (int i = 0; i < 64; i++) {
+        base::StringAppendF(&log, "  thread %d: l %d1 need_return 0 tr 0\n", 2000 + i, i % 2);
+    }
+    for (int i = 0; i < 8000; i++) {
+        base::StringAppendF(&log,
+                            "  node %d: u%016x c%016x pri 0:120 hs 1 hw 1 ls 0 lw 0 is 2 iw 2 tr 1 "
+                            "proc %d %d\n",
+                            10000 + i, 0x1000 + i * 16, 0x2000 + i * 16, 300 + i % 500,
+                            800 + i % 300);
+    }
+    for (int i = 0; i < 4000; i++) {
+        base::StringAppendF(&log, "  ref %d: desc %d node %d s 1 w 1 d 0000000000000000\n",
+                            30000 + i, i, 40000 + i);
+    }
+    return log;
+}
+
+void BM_parseSyntheticLog(benchmark::State& state) {
+    const std::string log = syntheticLog();
+    for (auto _ : state) {
+        BinderPidInfo pidInfo;
+        parseBinderPidInfo(log, BinderDebugContext::BINDER, &pidInfo);
+        benchmark::DoNotOptimize(pidInfo);
+    }
+    state.SetBytesProcessed(state.iterations() * log.size());
+}
+BENCHMARK(BM_parseSyntheticLog);
+
+// Parses the logs of all processes, read once up front so that only parsing is measured.
+void BM_parseRealLogs(benchmark::State& state) {
+    std::vector<std::string> logs;
+    size_t bytes = 0;
+    for (pid_t pid : binderPids()) {
+        std::string log;
+        if (base::ReadFileToString(base::StringPrintf("%s/%d", kLogsDir, pid), &log)) {
+            bytes += log.size();
+            logs.push_back(std::move(log));
+        }
+    }
+    if (logs.empty()) {
+        state.SkipWithError("No binder logs, does the benchmark run as root?");
+        return;
+    }
+    for (auto _ : state) {
+        for (const std::string& log : logs) {
+            BinderPidInfo pidInfo;
+            parseBinderPidInfo(log, BinderDebugContext::BINDER, &pidInfo);
+            benchmark::DoNotOptimize(pidInfo);
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_parseRealLogs);
+
+void BM_getBinderPidInfos(benchmark::State& state) {
+    const std::vector<pid_t> pids = binderPids();
+    for (auto _ : state) {
+        std::map<pid_t, BinderPidInfo> pidInfos;
+        getBinderPidInfos(BinderDebugContext::BINDER, pids, &pidInfos);
+        benchmark::DoNotOptimize(pidInfos);
+    }
+}
+BENCHMARK(BM_getBinderPidInfos);
+
+// What a dump looking up the clients of the services of every process costs: each log is read
+// once, and then found in the cache.
+void BM_cachedClientPids(benchmark::State& state) {
+    const std::vector<pid_t> pids = binderPids();
+    for (auto _ : state) {
+        BinderDebugCache cache;
+        for (pid_t servicePid : pids) {
+            std::vector<pid_t> clientPids;
+            cache.getBinderClientPids(BinderDebugContext::BINDER, getpid(), servicePid,
+                                      0 /*handle*/, &clientPids);
+            benchmark::DoNotOptimize(clientPids);
+        }
+    }
+}
+BENCHMARK(BM_cachedClientPids);
+
+void BM_uncachedClientPids(benchmark::State& state) {
+    const std::vector<pid_t> pids = binderPids();
+    for (auto _ : state) {
+        for (pid_t servicePid : pids) {
+            std::vector<pid_t> clientPids;
+            getBinderClientPids(BinderDebugContext::BINDER, getpid(), servicePid, 0 /*handle*/,
+                                &clientPids);
+            benchmark::DoNotOptimize(clientPids);
+        }
+    }
+}
+BENCHMARK(BM_uncachedClientPids);
+
+} // namespace
+
+} // namespace android
+
+BENCHMARK_MAIN();
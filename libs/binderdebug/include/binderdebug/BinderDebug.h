@@ -18,14 +18,16 @@
 #include <utils/Errors.h>
 
 #include <map>
+#include <memory>
+#include <string_view>
 #include <vector>
 
 namespace android {
 
 struct BinderPidInfo {
     std::map<uint64_t, std::vector<pid_t>> refPids; // cookie -> processes which hold binder
-    uint32_t threadUsage;                           // number of threads in use
-    uint32_t threadCount;                           // number of threads total
+    uint32_t threadUsage = 0;                       // number of threads in use
+    uint32_t threadCount = 0;                       // number of threads total
 };
 
 enum class BinderDebugContext {
@@ -44,4 +46,46 @@ status_t getBinderPidInfo(BinderDebugContext context, pid_t pid, BinderPidInfo*
 status_t getBinderClientPids(BinderDebugContext context, pid_t pid, pid_t servicePid,
                              int32_t handle, std::vector<pid_t>* pids);
 
+/**
+ * getBinderPidInfo for each of pids. pidInfos gets an entry for each pid whose file could be read.
+ * Returns the error of the first pid whose file could not be read, or OK.
+ */
+status_t getBinderPidInfos(BinderDebugContext context, const std::vector<pid_t>& pids,
+                           std::map<pid_t, BinderPidInfo>* pidInfos);
+
+/**
+ * Parses the contents of a binder_logs proc file that was read elsewhere, e.g. from a bugreport.
+ */
+status_t parseBinderPidInfo(std::string_view contents, BinderDebugContext context,
+                            BinderPidInfo* pidInfo);
+
+/**
+ * Keeps the parsed binder_logs file of each pid, so that callers which query many services of the
+ * same processes read and parse each file once. A file is parsed again if its inode, size or mtime
+ * changes. binderfs doesn't update the size nor the mtime of the logs though, so a cache holds a
+ * snapshot of each process: keep one for the duration of a single dump, not longer.
+ *
+ * Not thread safe.
+ */
+class BinderDebugCache {
+public:
+    BinderDebugCache();
+    ~BinderDebugCache();
+
+    status_t getBinderPidInfo(BinderDebugContext context, pid_t pid, BinderPidInfo* pidInfo);
+    status_t getBinderClientPids(BinderDebugContext context, pid_t pid, pid_t servicePid,
+                                 int32_t handle, std::vector<pid_t>* pids);
+    status_t getBinderPidInfos(BinderDebugContext context, const std::vector<pid_t>& pids,
+                               std::map<pid_t, BinderPidInfo>* pidInfos);
+
+    void clear();
+
+private:
+    struct ParsedLog;
+
+    status_t getParsedLog(pid_t pid, const ParsedLog** log);
+
+    std::map<pid_t, std::unique_ptr<ParsedLog>> mLogs;
+};
+
 } // namespace  android
@@ -60,6 +60,54 @@ TEST(BinderDebugTests, BinderThreads) {
     EXPECT_GE(pidInfo.threadCount, 1);
 }
 
+TEST(BinderDebugTests, CacheMatchesUncached) {
+    BinderPidInfo pidInfo;
+    ASSERT_EQ(OK, getBinderPidInfo(BinderDebugContext::BINDER, getpid(), &pidInfo));
+
+    BinderDebugCache cache;
+    std::map<pid_t, BinderPidInfo> pidInfos;
+    ASSERT_EQ(OK, cache.getBinderPidInfos(BinderDebugContext::BINDER, {getpid()}, &pidInfos));
+    ASSERT_EQ(1u, pidInfos.count(getpid()));
+    EXPECT_EQ(pidInfo.refPids, pidInfos[getpid()].refPids);
+    EXPECT_EQ(pidInfo.threadCount, pidInfos[getpid()].threadCount);
+}
+
+TEST(BinderDebugTests, BatchReportsMissingPids) {
+    std::map<pid_t, BinderPidInfo> pidInfos;
+    EXPECT_NE(OK, getBinderPidInfos(BinderDebugContext::BINDER, {getpid(), -1}, &pidInfos));
+    EXPECT_EQ(1u, pidInfos.size());
+    EXPECT_EQ(1u, pidInfos.count(getpid()));
+}
+
+TEST(BinderDebugTests, ParseContents) {
+    constexpr char kContents[] =
+            "binder proc state:\n"
+            "proc 1234\n"
+            "context hwbinder\n"
+            "  thread 10: l 12 need_return 0 tr 0\n"
+            "context binder\n"
+            "  thread 11: l 12 need_return 0 tr 0\n"
+            "  thread 12: l 01 need_return 0 tr 0\n"
+            "  thread 13: l 11 need_return 0 tr 0\n"
+            "  thread 14: l 00 need_return 0 tr 0\n"
+            "  node 66730: u00007590061890e0 c0000759036130950 pri 0:120 hs 1 hw 1 ls 0 lw 0 is 2 "
+            "iw 2 tr 1 proc 2300 1790\n"
+            "  ref 52493: desc 910 node 52492 s 1 w 1 d 0000000000000000\n"
+            "  ref 52494: desc 911 dead node 52495 s 1 w 1 d 0000000000000000\n";
+
+    BinderPidInfo pidInfo;
+    ASSERT_EQ(OK, parseBinderPidInfo(kContents, BinderDebugContext::BINDER, &pidInfo));
+    EXPECT_EQ(3u, pidInfo.threadCount);
+    EXPECT_EQ(1u, pidInfo.threadUsage);
+    ASSERT_EQ(1u, pidInfo.refPids.size());
+    EXPECT_EQ((std::vector<pid_t>{2300, 1790}), pidInfo.refPids[0x7590061890e0]);
+
+    BinderPidInfo vndPidInfo;
+    ASSERT_EQ(OK, parseBinderPidInfo(kContents, BinderDebugContext::VNDBINDER, &vndPidInfo));
+    EXPECT_EQ(0u, vndPidInfo.threadCount);
+    EXPECT_TRUE(vndPidInfo.refPids.empty());
+}
+
 extern "C" {
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
@@ -22,8 +22,11 @@
 #include <dirent.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <sys/syscall.h>
 #include <sys/sysinfo.h>
+#include <unistd.h>
 
+#include <atomic>
 #include <mutex>
 #include <numeric>
 #include <optional>
@@ -63,6 +66,11 @@ static unique_fd gConcurrentMapFd;
 static unique_fd gUidLastUpdateMapFd;
 static unique_fd gPidTisMapFd;
 
+// The number of entries read from a map by each BPF_MAP_LOOKUP_BATCH.
+static constexpr uint32_t kMapBatchSize = 64;
+// Cleared once a batched lookup fails with EINVAL, on kernels which don't support them.
+static std::atomic<bool> gBatchedLookupSupported = true;
+
 static std::optional<std::vector<uint32_t>> readNumbersFromFile(const std::string &path) {
     std::string data;
 
@@ -337,10 +345,74 @@ std::optional<std::vector<std::vector<uint64_t>>> getUidCpuFreqTimes(uint32_t ui
     return out;
 }
 
-static std::optional<bool> uidUpdatedSince(uint32_t uid, uint64_t lastUpdate,
-                                           uint64_t *newLastUpdate) {
+// Calls fn(key, values) for each entry of mapFd, where values points at the valuesPerKey values of
+// the entry (one for each CPU of a per-CPU map), reading the map kMapBatchSize entries at a time
+// with BPF_MAP_LOOKUP_BATCH instead of two syscalls per entry. Returns false on error, or if fn
+// does, and no value if batched lookups aren't supported, in which case fn hasn't been called.
+template <class Key, class Value, class Fn>
+static std::optional<bool> forEachMapEntryBatched(const unique_fd &mapFd, uint32_t valuesPerKey,
+                                                  Fn fn) {
+    // The kernel copies the values of per-CPU maps with a stride of 8 bytes.
+    static_assert(sizeof(Value) % 8 == 0);
+    if (!gBatchedLookupSupported) return {};
+
+    std::vector<Key> keys(kMapBatchSize);
+    std::vector<Value> values(kMapBatchSize * valuesPerKey);
+    // The position in the map, which is opaque and at most as large as a key of a hash map.
+    uint64_t inBatch = 0, outBatch = 0;
+    bool first = true;
+    while (true) {
+        union bpf_attr attr = {};
+        attr.batch.in_batch = first ? 0 : reinterpret_cast<uint64_t>(&inBatch);
+        attr.batch.out_batch = reinterpret_cast<uint64_t>(&outBatch);
+        attr.batch.keys = reinterpret_cast<uint64_t>(keys.data());
+        attr.batch.values = reinterpret_cast<uint64_t>(values.data());
+        attr.batch.count = kMapBatchSize;
+        attr.batch.map_fd = mapFd.get();
+        bool done = false;
+        if (syscall(__NR_bpf, BPF_MAP_LOOKUP_BATCH, &attr, sizeof(attr)) != 0) {
+            if (errno != ENOENT) {
+                if (first && errno == EINVAL) {
+                    gBatchedLookupSupported = false;
+                    return {};
+                }
+                return false;
+            }
+            // The entries up to the end of the map have been read.
+            done = true;
+        }
+        for (uint32_t i = 0; i < attr.batch.count; ++i) {
+            if (!fn(keys[i], &values[i * valuesPerKey])) return false;
+        }
+        if (done) return true;
+        inBatch = outBatch;
+        first = false;
+    }
+}
+
+// Reads the last update times of all of the uids, when batched lookups are supported.
+static std::optional<std::unordered_map<uint32_t, uint64_t>> readUidLastUpdates() {
+    std::unordered_map<uint32_t, uint64_t> lastUpdates;
+    auto ok = forEachMapEntryBatched<uint32_t, uint64_t>(
+            gUidLastUpdateMapFd, 1, [&](uint32_t uid, const uint64_t *lastUpdate) {
+                lastUpdates[uid] = *lastUpdate;
+                return true;
+            });
+    if (!ok.value_or(false)) return {};
+    return lastUpdates;
+}
+
+// Whether uid was updated since lastUpdate, taking its last update time from lastUpdates when it's
+// there, and from the map otherwise.
+static std::optional<bool> uidUpdatedSince(
+        uint32_t uid, uint64_t lastUpdate, uint64_t *newLastUpdate,
+        const std::optional<std::unordered_map<uint32_t, uint64_t>> &lastUpdates) {
     uint64_t uidLastUpdate;
-    if (findMapEntry(gUidLastUpdateMapFd, &uid, &uidLastUpdate)) return {};
+    if (lastUpdates && lastUpdates->count(uid)) {
+        uidLastUpdate = lastUpdates->at(uid);
+    } else if (findMapEntry(gUidLastUpdateMapFd, &uid, &uidLastUpdate)) {
+        return {};
+    }
     // Updates that occurred during the previous read may have been missed. To mitigate
     // this, don't ignore entries updated up to 1s before *lastUpdate
     constexpr uint64_t NSEC_PER_SEC = 1000000000;
@@ -377,29 +449,50 @@ getUidsUpdatedCpuFreqTimes(uint64_t *lastUpdate) {
     for (const auto &freqList : gPolicyFreqs) mapFormat.emplace_back(freqList.size(), 0);
 
     uint64_t newLastUpdate = lastUpdate ? *lastUpdate : 0;
-    std::vector<tis_val_t> vals(gNCpus);
-    do {
-        if (lastUpdate) {
-            auto uidUpdated = uidUpdatedSince(key.uid, *lastUpdate, &newLastUpdate);
-            if (!uidUpdated.has_value()) return {};
-            if (!*uidUpdated) continue;
-        }
-        if (findMapEntry(gTisMapFd, &key, vals.data())) return {};
-        if (map.find(key.uid) == map.end()) map.emplace(key.uid, mapFormat);
-
+    std::optional<std::unordered_map<uint32_t, uint64_t>> lastUpdates;
+    if (lastUpdate) lastUpdates = readUidLastUpdates();
+    const auto addTimes = [&](const time_key_t &key, const tis_val_t *vals) {
+        auto &times = map.try_emplace(key.uid, mapFormat).first->second;
         auto offset = key.bucket * FREQS_PER_ENTRY;
         auto nextOffset = (key.bucket + 1) * FREQS_PER_ENTRY;
         for (uint32_t i = 0; i < gNPolicies; ++i) {
             if (offset >= gPolicyFreqs[i].size()) continue;
-            auto begin = map[key.uid][i].begin() + offset;
+            auto begin = times[i].begin() + offset;
             auto end = nextOffset < gPolicyFreqs[i].size() ? begin + FREQS_PER_ENTRY :
-                map[key.uid][i].end();
+                times[i].end();
             for (const auto &cpu : gPolicyCpus[i]) {
                 std::transform(begin, end, std::begin(vals[gCpuIndexMap[cpu]].ar), begin,
                                std::plus<uint64_t>());
             }
         }
-        prevKey = key;
+    };
+
+    auto batched = forEachMapEntryBatched<time_key_t, tis_val_t>(
+            gTisMapFd, gNCpus, [&](const time_key_t &key, const tis_val_t *vals) {
+                if (lastUpdate) {
+                    auto uidUpdated =
+                            uidUpdatedSince(key.uid, *lastUpdate, &newLastUpdate, lastUpdates);
+                    if (!uidUpdated.has_value()) return false;
+                    if (!*uidUpdated) return true;
+                }
+                addTimes(key, vals);
+                return true;
+            });
+    if (batched.has_value()) {
+        if (!*batched) return {};
+        if (lastUpdate && newLastUpdate > *lastUpdate) *lastUpdate = newLastUpdate;
+        return map;
+    }
+
+    std::vector<tis_val_t> vals(gNCpus);
+    do {
+        if (lastUpdate) {
+            auto uidUpdated = uidUpdatedSince(key.uid, *lastUpdate, &newLastUpdate, lastUpdates);
+            if (!uidUpdated.has_value()) return {};
+            if (!*uidUpdated) continue;
+        }
+        if (findMapEntry(gTisMapFd, &key, vals.data())) return {};
+        addTimes(key, vals.data());
     } while (prevKey = key, !getNextMapKey(gTisMapFd, &prevKey, &key));
     if (errno != ENOENT) return {};
     if (lastUpdate && newLastUpdate > *lastUpdate) *lastUpdate = newLastUpdate;
@@ -488,25 +581,16 @@ std::optional<std::unordered_map<uint32_t, concurrent_time_t>> getUidsUpdatedCon
     concurrent_time_t retFormat = {.active = std::vector<uint64_t>(gNCpus, 0)};
     for (const auto &cpuList : gPolicyCpus) retFormat.policy.emplace_back(cpuList.size(), 0);
 
-    std::vector<concurrent_val_t> vals(gNCpus);
-    std::vector<uint64_t>::iterator activeBegin, activeEnd, policyBegin, policyEnd;
-
     uint64_t newLastUpdate = lastUpdate ? *lastUpdate : 0;
-    do {
-        if (key.bucket > (gNCpus - 1) / CPUS_PER_ENTRY) return {};
-        if (lastUpdate) {
-            auto uidUpdated = uidUpdatedSince(key.uid, *lastUpdate, &newLastUpdate);
-            if (!uidUpdated.has_value()) return {};
-            if (!*uidUpdated) continue;
-        }
-        if (findMapEntry(gConcurrentMapFd, &key, vals.data())) return {};
-        if (ret.find(key.uid) == ret.end()) ret.emplace(key.uid, retFormat);
-
+    std::optional<std::unordered_map<uint32_t, uint64_t>> lastUpdates;
+    if (lastUpdate) lastUpdates = readUidLastUpdates();
+    const auto addTimes = [&](const time_key_t &key, const concurrent_val_t *vals) {
+        auto &times = ret.try_emplace(key.uid, retFormat).first->second;
         auto offset = key.bucket * CPUS_PER_ENTRY;
         auto nextOffset = (key.bucket + 1) * CPUS_PER_ENTRY;
 
-        activeBegin = ret[key.uid].active.begin();
-        activeEnd = nextOffset < gNCpus ? activeBegin + CPUS_PER_ENTRY : ret[key.uid].active.end();
+        auto activeBegin = times.active.begin();
+        auto activeEnd = nextOffset < gNCpus ? activeBegin + CPUS_PER_ENTRY : times.active.end();
 
         for (uint32_t cpu = 0; cpu < gNCpus; ++cpu) {
             std::transform(activeBegin, activeEnd, std::begin(vals[cpu].active), activeBegin,
@@ -515,17 +599,46 @@ std::optional<std::unordered_map<uint32_t, concurrent_time_t>> getUidsUpdatedCon
 
         for (uint32_t policy = 0; policy < gNPolicies; ++policy) {
             if (offset >= gPolicyCpus[policy].size()) continue;
-            policyBegin = ret[key.uid].policy[policy].begin() + offset;
-            policyEnd = nextOffset < gPolicyCpus[policy].size() ? policyBegin + CPUS_PER_ENTRY
-                                                                : ret[key.uid].policy[policy].end();
+            auto policyBegin = times.policy[policy].begin() + offset;
+            auto policyEnd = nextOffset < gPolicyCpus[policy].size()
+                    ? policyBegin + CPUS_PER_ENTRY
+                    : times.policy[policy].end();
 
             for (const auto &cpu : gPolicyCpus[policy]) {
                 std::transform(policyBegin, policyEnd, std::begin(vals[gCpuIndexMap[cpu]].policy),
                                policyBegin, std::plus<uint64_t>());
             }
         }
-    } while (prevKey = key, !getNextMapKey(gConcurrentMapFd, &prevKey, &key));
-    if (errno != ENOENT) return {};
+    };
+    // Returns no value on error, and whether the times of key are wanted otherwise.
+    const auto wanted = [&](const time_key_t &key) -> std::optional<bool> {
+        if (key.bucket > (gNCpus - 1) / CPUS_PER_ENTRY) return {};
+        if (lastUpdate) {
+            return uidUpdatedSince(key.uid, *lastUpdate, &newLastUpdate, lastUpdates);
+        }
+        return true;
+    };
+
+    auto batched = forEachMapEntryBatched<time_key_t, concurrent_val_t>(
+            gConcurrentMapFd, gNCpus, [&](const time_key_t &key, const concurrent_val_t *vals) {
+                auto isWanted = wanted(key);
+                if (!isWanted.has_value()) return false;
+                if (*isWanted) addTimes(key, vals);
+                return true;
+            });
+    if (batched.has_value()) {
+        if (!*batched) return {};
+    } else {
+        std::vector<concurrent_val_t> vals(gNCpus);
+        do {
+            auto isWanted = wanted(key);
+            if (!isWanted.has_value()) return {};
+            if (!*isWanted) continue;
+            if (findMapEntry(gConcurrentMapFd, &key, vals.data())) return {};
+            addTimes(key, vals.data());
+        } while (prevKey = key, !getNextMapKey(gConcurrentMapFd, &prevKey, &key));
+        if (errno != ENOENT) return {};
+    }
     for (const auto &[key, value] : ret) {
         if (!verifyConcurrentTimes(value)) {
             auto val = getUidConcurrentTimes(key, false);
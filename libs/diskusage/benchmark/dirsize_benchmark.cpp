@@ -0,0 +1,83 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <diskusage/dirsize.h>
+
+namespace {
+
+// The trees have directories of 100 files, in groups of 100 directories.
+constexpr int FILES_PER_DIR = 100;
+constexpr int DIRS_PER_GROUP = 100;
+
+// Returns a tree of |fileCount| small files, which is created on the first call for each count
+// and removed with its files when the benchmark exits.
+std::string getTree(int fileCount) {
+    static std::map<int, std::unique_ptr<TemporaryDir>> trees;
+    std::unique_ptr<TemporaryDir>& tree = trees[fileCount];
+    if (tree == nullptr) {
+        tree = std::make_unique<TemporaryDir>();
+        for (int file = 0; file < fileCount; file++) {
+            int dir = file / FILES_PER_DIR;
+            std::string group = android::base::StringPrintf("%s/%d", tree->path,
+                                                            dir / DIRS_PER_GROUP);
+            std::string path = android::base::StringPrintf("%s/%d", group.c_str(), dir);
+            if (file % FILES_PER_DIR == 0) {
+                mkdir(group.c_str(), 0700);
+                mkdir(path.c_str(), 0700);
+            }
+            android::base::WriteStringToFile("x", path + "/" + std::to_string(file));
+        }
+    }
+    return tree->path;
+}
+
+} // namespace
+
+static void BM_calculateDirSize(benchmark::State& state) {
+    std::string tree = getTree(state.range(0));
+    for (auto _ : state) {
+        int fd = open(tree.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        benchmark::DoNotOptimize(calculate_dir_size(fd));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_calculateDirSize)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_calculateDirSizeParallel(benchmark::State& state) {
+    std::string tree = getTree(state.range(0));
+    for (auto _ : state) {
+        int fd = open(tree.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        benchmark::DoNotOptimize(calculate_dir_size_parallel(fd, state.range(1)));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_calculateDirSizeParallel)
+        ->ArgsProduct({{10000, 1000000}, {2, 4, 8}})
+        ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -16,34 +16,96 @@
  */
 
 #include <dirent.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
 #include <diskusage/dirsize.h>
 
+/* The size of the buffers which the directories are read into. */
+#define DIR_BUFFER_SIZE (32 * 1024)
+
+/* The most directories which are queued for the threads of a parallel walk
+ * at once, each one of them holding an fd. The others are walked inline. */
+#define MAX_QUEUED_DIRS 64
+
+struct dir_walk {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int queue[MAX_QUEUED_DIRS];
+    int queued;
+    /* The threads which are walking a directory. */
+    int busy;
+    int64_t size;
+};
+
 int64_t stat_size(struct stat *s)
 {
     return s->st_blocks * 512;
 }
 
-int64_t calculate_dir_size(int dfd)
+/* Returns the size of |name| in |dfd|, and whether it is a directory in
+ * |is_dir| if it isn't NULL. Only the fields which are needed are asked for. */
+static int64_t entry_size(int dfd, const char *name, int *is_dir)
 {
-    int64_t size = 0;
-    struct stat s;
-    DIR *d;
-    struct dirent *de;
+    struct statx stx;
+    unsigned int mask = STATX_BLOCKS | (is_dir != NULL ? STATX_TYPE : 0);
+    if (statx(dfd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, mask, &stx) == 0) {
+        if (is_dir != NULL) {
+            *is_dir = S_ISDIR(stx.stx_mode);
+        }
+        return stx.stx_blocks * 512;
+    }
+    if (errno == ENOSYS) {
+        struct stat s;
+        if (fstatat(dfd, name, &s, AT_SYMLINK_NOFOLLOW) == 0) {
+            if (is_dir != NULL) {
+                *is_dir = S_ISDIR(s.st_mode);
+            }
+            return stat_size(&s);
+        }
+    }
+    if (is_dir != NULL) {
+        *is_dir = 0;
+    }
+    return 0;
+}
+
+/* Hands |dfd| to the threads of |walk| if there is room in its queue. */
+static int queue_dir(struct dir_walk *walk, int dfd)
+{
+    int queued = 0;
+    pthread_mutex_lock(&walk->lock);
+    if (walk->queued < MAX_QUEUED_DIRS) {
+        walk->queue[walk->queued++] = dfd;
+        pthread_cond_signal(&walk->cond);
+        queued = 1;
+    }
+    pthread_mutex_unlock(&walk->lock);
+    return queued;
+}
 
-    d = fdopendir(dfd);
-    if (d == NULL) {
+/* Returns the size of the entries of |dfd|, which is closed. The directories
+ * in it are queued to |walk| when it isn't NULL, and walked inline otherwise. */
+static int64_t walk_dir(int dfd, struct dir_walk *walk)
+{
+    int64_t size = 0;
+    char *buf = malloc(DIR_BUFFER_SIZE);
+    if (buf == NULL) {
         close(dfd);
         return 0;
     }
 
-    while ((de = readdir(d))) {
-        const char *name = de->d_name;
-        if (de->d_type == DT_DIR) {
-            int subfd;
+    long n;
+    while ((n = syscall(SYS_getdents64, dfd, buf, DIR_BUFFER_SIZE)) > 0) {
+        for (long pos = 0; pos < n;) {
+            struct dirent *de = (struct dirent *) (buf + pos);
+            const char *name = de->d_name;
+            pos += de->d_reclen;
 
             /* always skip "." and ".." */
             if (name[0] == '.') {
@@ -53,19 +115,96 @@ int64_t calculate_dir_size(int dfd)
                     continue;
             }
 
-            if (fstatat(dfd, name, &s, AT_SYMLINK_NOFOLLOW) == 0) {
-                size += stat_size(&s);
+            int is_dir = de->d_type == DT_DIR;
+            if (de->d_type == DT_UNKNOWN) {
+                size += entry_size(dfd, name, &is_dir);
+            } else if (!is_dir) {
+                size += entry_size(dfd, name, NULL);
+            }
+            if (!is_dir) {
+                continue;
+            }
+
+            int subfd = openat(dfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (subfd < 0) {
+                if (de->d_type == DT_DIR) {
+                    size += entry_size(dfd, name, NULL);
+                }
+                continue;
             }
-            subfd = openat(dfd, name, O_RDONLY | O_DIRECTORY);
-            if (subfd >= 0) {
-                size += calculate_dir_size(subfd);
+            /* The directory is open anyway, so stat it without a lookup. */
+            if (de->d_type == DT_DIR) {
+                struct stat s;
+                if (fstat(subfd, &s) == 0) {
+                    size += stat_size(&s);
+                }
             }
-        } else {
-            if (fstatat(dfd, name, &s, AT_SYMLINK_NOFOLLOW) == 0) {
-                size += stat_size(&s);
+            if (walk == NULL || !queue_dir(walk, subfd)) {
+                size += walk_dir(subfd, walk);
             }
         }
     }
-    closedir(d);
+
+    free(buf);
+    close(dfd);
     return size;
 }
+
+int64_t calculate_dir_size(int dfd)
+{
+    return walk_dir(dfd, NULL);
+}
+
+static void *walk_queued_dirs(void *arg)
+{
+    struct dir_walk *walk = arg;
+    pthread_mutex_lock(&walk->lock);
+    while (1) {
+        while (walk->queued == 0 && walk->busy > 0) {
+            pthread_cond_wait(&walk->cond, &walk->lock);
+        }
+        if (walk->queued == 0) {
+            /* Nothing is queued, and nothing can be queued anymore. */
+            break;
+        }
+        int dfd = walk->queue[--walk->queued];
+        walk->busy++;
+        pthread_mutex_unlock(&walk->lock);
+
+        int64_t size = walk_dir(dfd, walk);
+
+        pthread_mutex_lock(&walk->lock);
+        walk->size += size;
+        if (--walk->busy == 0 && walk->queued == 0) {
+            pthread_cond_broadcast(&walk->cond);
+        }
+    }
+    pthread_mutex_unlock(&walk->lock);
+    return NULL;
+}
+
+int64_t calculate_dir_size_parallel(int dfd, int threads)
+{
+    if (threads <= 1) {
+        return calculate_dir_size(dfd);
+    }
+
+    struct dir_walk walk = {
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .cond = PTHREAD_COND_INITIALIZER,
+        .queue = {dfd},
+        .queued = 1,
+    };
+    pthread_t *workers = calloc(threads - 1, sizeof(pthread_t));
+    int started = 0;
+    while (workers != NULL && started < threads - 1 &&
+           pthread_create(&workers[started], NULL, walk_queued_dirs, &walk) == 0) {
+        started++;
+    }
+    walk_queued_dirs(&walk);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    return walk.size;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <ftl/small_map.h>
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace android {
+namespace {
+
+// Keys spread like display IDs, which mostly differ in their high bits.
+std::uint64_t key(std::int64_t i) {
+  return static_cast<std::uint64_t>(i) << 40 | 0x1234;
+}
+
+template <typename Map>
+Map makeMap(std::int64_t size) {
+  Map map;
+  for (std::int64_t i = 0; i < size; i++) {
+    map.try_emplace(key(i), static_cast<int>(i));
+  }
+  return map;
+}
+
+template <typename Map>
+void BM_Get(benchmark::State& state) {
+  const std::int64_t size = state.range(0);
+  const Map map = makeMap<Map>(size);
+  std::int64_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(key(i)));
+    if (++i == size) i = 0;
+  }
+}
+
+template <typename Map>
+void BM_EmplaceAndErase(benchmark::State& state) {
+  const std::int64_t size = state.range(0);
+  Map map = makeMap<Map>(size);
+  std::int64_t i = 0;
+  for (auto _ : state) {
+    map.erase(key(i));
+    map.try_emplace(key(i), 0);
+    if (++i == size) i = 0;
+  }
+}
+
+using LinearMap = ftl::SmallMap<std::uint64_t, int, 4>;
+using HashedMap = ftl::HashedSmallMap<std::uint64_t, int, 4>;
+using UnorderedMap = std::unordered_map<std::uint64_t, int>;
+
+BENCHMARK(BM_Get<LinearMap>)->RangeMultiplier(4)->Range(1, 1024);
+BENCHMARK(BM_Get<HashedMap>)->RangeMultiplier(4)->Range(1, 1024);
+BENCHMARK(BM_Get<UnorderedMap>)->RangeMultiplier(4)->Range(1, 1024);
+BENCHMARK(BM_EmplaceAndErase<LinearMap>)->RangeMultiplier(4)->Range(1, 1024);
+BENCHMARK(BM_EmplaceAndErase<HashedMap>)->RangeMultiplier(4)->Range(1, 1024);
+BENCHMARK(BM_EmplaceAndErase<UnorderedMap>)->RangeMultiplier(4)->Range(1, 1024);
+
+}  // namespace
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -19,6 +19,7 @@
 #include <gtest/gtest.h>
 
 #include <cctype>
+#include <random>
 #include <string>
 #include <string_view>
 
@@ -442,4 +443,80 @@ TEST(SmallMap, KeyEqual) {
   EXPECT_EQ(map, SmallMap(ftl::init::map<int, char, KeyEqual>(1, '1')(2, '2')));
 }
 
+TEST(SmallMap, Hashed) {
+  ftl::HashedSmallMap<int, std::string, 4> map;
+
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(map.try_emplace(i, std::to_string(i)).second);
+  }
+  EXPECT_FALSE(map.try_emplace(42, "?").second);
+  EXPECT_EQ(map.size(), 100u);
+  EXPECT_TRUE(map.dynamic());
+
+  for (int i = 0; i < 100; i++) {
+    ASSERT_NE(map.find(i), map.end());
+    EXPECT_EQ(map.find(i)->second, std::to_string(i));
+  }
+  EXPECT_FALSE(map.contains(100));
+  EXPECT_EQ(map.find(-1), map.end());
+
+  // Erase the even keys, which moves the last mappings into their positions.
+  for (int i = 0; i < 100; i += 2) {
+    EXPECT_TRUE(map.erase(i));
+    EXPECT_FALSE(map.erase(i));
+  }
+  EXPECT_EQ(map.size(), 50u);
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(map.contains(i), i % 2 == 1) << i;
+  }
+
+  EXPECT_EQ(map.try_replace(51, "fifty-one")->second, "fifty-one");
+  EXPECT_FALSE(map.emplace_or_replace(53, "fifty-three").second);
+  EXPECT_EQ(map.find(51)->second, "fifty-one");
+  EXPECT_EQ(map.find(53)->second, "fifty-three");
+
+  // Copies keep their own index.
+  const auto copy = map;
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.contains(51));
+  EXPECT_EQ(copy.find(51)->second, "fifty-one");
+
+  SmallMap<int, std::string, 4> linear = copy;
+  EXPECT_EQ(linear, copy);
+}
+
+TEST(SmallMap, HashedMatchesLinear) {
+  // Collisions of all of the keys exercise the probing and the shifting of erasure.
+  struct CollidingHash {
+    std::size_t operator()(int) const { return 0; }
+  };
+
+  SmallMap<int, int, 8> linear;
+  ftl::HashedSmallMap<int, int, 8> hashed;
+  ftl::HashedSmallMap<int, int, 8, CollidingHash> colliding;
+
+  std::mt19937 random(123);
+  std::uniform_int_distribution<int> keys(0, 200);
+  for (int i = 0; i < 5000; i++) {
+    const int key = keys(random);
+    if (random() % 3 == 0) {
+      const bool erased = linear.erase(key);
+      EXPECT_EQ(hashed.erase(key), erased);
+      EXPECT_EQ(colliding.erase(key), erased);
+    } else {
+      const bool emplaced = linear.emplace_or_replace(key, i).second;
+      EXPECT_EQ(hashed.emplace_or_replace(key, i).second, emplaced);
+      EXPECT_EQ(colliding.emplace_or_replace(key, i).second, emplaced);
+    }
+
+    const int other = keys(random);
+    EXPECT_EQ(hashed.get(other), linear.get(other));
+    EXPECT_EQ(colliding.get(other), linear.get(other));
+  }
+
+  EXPECT_EQ(hashed, linear);
+  EXPECT_EQ(colliding, linear);
+}
+
 }  // namespace android::test
@@ -38,6 +38,7 @@
 #include <memory>
 #include <string>
 #include <thread>
+#include <unordered_set>
 
 // TODO(b/159240322): Extend this to x86 ABI.
 #if defined(__LP64__)
@@ -462,11 +463,73 @@ void GraphicsEnv::setTargetStatsArray(const GpuStatsInfo::Stats stats, const uin
     std::lock_guard<std::mutex> lock(mStatsLock);
     if (!readyToSendGpuStatsLocked()) return;
 
+    // GpuService drops the target stats of the apps whose driver stats it doesn't have, so the
+    // target stats are only filtered once the driver stats were sent.
+    std::vector<uint64_t> unsentValues;
+    uint32_t count = valueCount;
+    if (mDriverStatsSent) {
+        takeUnsentTargetStatsLocked(stats, values, valueCount, &unsentValues);
+        if (unsentValues.empty()) return;
+        values = unsentValues.data();
+        count = static_cast<uint32_t>(unsentValues.size());
+    }
+
     const sp<IGpuService> gpuService = getGpuService();
     if (gpuService) {
         gpuService->setTargetStatsArray(mGpuStats.appPackageName, mGpuStats.driverVersionCode,
-                                        stats, values, valueCount);
+                                        stats, values, count);
+    }
+}
+
+void GraphicsEnv::takeUnsentTargetStatsLocked(const GpuStatsInfo::Stats stats,
+                                              const uint64_t* values, const uint32_t valueCount,
+                                              std::vector<uint64_t>* outValues) {
+    if (valueCount == 0) return;
+
+    switch (stats) {
+        case GpuStatsInfo::Stats::CREATED_VULKAN_API_VERSION: {
+            // GpuService keeps the last version.
+            const uint64_t value = values[valueCount - 1];
+            if (mSentTargetStats.test(stats) && mSentVulkanApiVersion == value) return;
+            mSentVulkanApiVersion = value;
+            outValues->push_back(value);
+            break;
+        }
+        case GpuStatsInfo::Stats::VULKAN_DEVICE_FEATURES_ENABLED: {
+            // GpuService merges the feature bits, so only the new bits are sent.
+            uint64_t newFeatures = 0;
+            for (uint32_t i = 0; i < valueCount; i++) {
+                newFeatures |= values[i];
+            }
+            newFeatures &= ~mSentVulkanDeviceFeatures;
+            if (mSentTargetStats.test(stats) && newFeatures == 0) return;
+            mSentVulkanDeviceFeatures |= newFeatures;
+            outValues->push_back(newFeatures);
+            break;
+        }
+        case GpuStatsInfo::Stats::VULKAN_INSTANCE_EXTENSION:
+        case GpuStatsInfo::Stats::VULKAN_DEVICE_EXTENSION: {
+            // GpuService keeps the first MAX_NUM_EXTENSIONS unique extensions.
+            std::unordered_set<uint64_t>& sentExtensions =
+                    stats == GpuStatsInfo::Stats::VULKAN_INSTANCE_EXTENSION
+                    ? mSentVulkanInstanceExtensions
+                    : mSentVulkanDeviceExtensions;
+            for (uint32_t i = 0; i < valueCount &&
+                 sentExtensions.size() < GpuStatsAppInfo::MAX_NUM_EXTENSIONS;
+                 i++) {
+                if (sentExtensions.insert(values[i]).second) {
+                    outValues->push_back(values[i]);
+                }
+            }
+            break;
+        }
+        default:
+            // The other target stats are flags.
+            if (mSentTargetStats.test(stats)) return;
+            outValues->push_back(values[0]);
+            break;
     }
+    mSentTargetStats.set(stats);
 }
 
 void GraphicsEnv::sendGpuStatsLocked(GpuStatsInfo::Api api, bool isDriverLoaded,
@@ -507,6 +570,7 @@ void GraphicsEnv::sendGpuStatsLocked(GpuStatsInfo::Api api, bool isDriverLoaded,
                                 mGpuStats.driverVersionCode, mGpuStats.driverBuildTime,
                                 mGpuStats.appPackageName, mGpuStats.vulkanVersion, driver,
                                 isIntendedDriverLoaded, driverLoadingTime);
+        mDriverStatsSent = true;
     }
 }
 
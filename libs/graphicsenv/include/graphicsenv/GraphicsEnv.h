@@ -19,8 +19,10 @@
 
 #include <graphicsenv/GpuStatsInfo.h>
 
+#include <bitset>
 #include <mutex>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 struct android_namespace_t;
@@ -150,6 +152,10 @@ private:
     bool readyToSendGpuStatsLocked();
     // Send the initial complete GpuStats to GpuService.
     void sendGpuStatsLocked(GpuStatsInfo::Api api, bool isDriverLoaded, int64_t driverLoadingTime);
+    // Append the values of the target stats which change the stats of GpuService to outValues,
+    // and record them as sent.
+    void takeUnsentTargetStatsLocked(const GpuStatsInfo::Stats stats, const uint64_t* values,
+                                     const uint32_t valueCount, std::vector<uint64_t>* outValues);
 
     GraphicsEnv() = default;
 
@@ -193,6 +199,16 @@ private:
     bool mActivityLaunched = false;
     // Information bookkept for GpuStats.
     GpuStatsInfo mGpuStats;
+    // Whether the driver stats were sent to GpuService.
+    bool mDriverStatsSent = false;
+    // The target stats which were sent to GpuService since the driver stats were. Apps report
+    // most of them at each context, device or swapchain creation, and they are only sent when
+    // they change the stats of GpuService.
+    std::bitset<GpuStatsInfo::Stats::VULKAN_DEVICE_EXTENSION + 1> mSentTargetStats;
+    uint64_t mSentVulkanApiVersion = 0;
+    uint64_t mSentVulkanDeviceFeatures = 0;
+    std::unordered_set<uint64_t> mSentVulkanInstanceExtensions;
+    std::unordered_set<uint64_t> mSentVulkanDeviceExtensions;
 
     /**
      * Debug layers.
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <private/gui/AdaptiveBufferCount.h>
+
+#include <algorithm>
+
+namespace android::gui {
+
+void AdaptiveBufferCount::setRequestedCount(int requestedCount) {
+    mRequestedCount = std::max(requestedCount, 1);
+    mCount = mRequestedCount;
+    mCleanWindows = 0;
+    mRequiredCleanWindows = 1;
+    startWindow();
+}
+
+bool AdaptiveBufferCount::onDequeueStarted(int dequeuedCount) {
+    if (dequeuedCount < mCount || mCount == mRequestedCount) {
+        return false;
+    }
+    mRequiredCleanWindows = std::min(mRequiredCleanWindows * 2, kMaxCleanWindows);
+    mCleanWindows = 0;
+    startWindow();
+    return setCount(mRequestedCount);
+}
+
+bool AdaptiveBufferCount::onDequeueFinished(int dequeuedCount, nsecs_t duration, bool allocated) {
+    mPeakDequeuedCount = std::max(mPeakDequeuedCount, dequeuedCount);
+    if (allocated || duration < kBlockedDequeueDuration) {
+        return false;
+    }
+    mBlocked = true;
+    if (mCount == mRequestedCount) {
+        return false;
+    }
+    mRequiredCleanWindows = std::min(mRequiredCleanWindows * 2, kMaxCleanWindows);
+    mCleanWindows = 0;
+    startWindow();
+    return setCount(mCount + 1);
+}
+
+bool AdaptiveBufferCount::onQueued(int dequeuedCount, nsecs_t now) {
+    const bool wasIdle = mLastQueueTime >= 0 && now - mLastQueueTime >= kIdleDuration;
+    mLastQueueTime = now;
+    if (wasIdle) {
+        startWindow();
+        return setCount(std::max(dequeuedCount, 1));
+    }
+
+    if (++mFrames < kWindowFrames) {
+        return false;
+    }
+    const bool clean = !mBlocked && mPeakDequeuedCount < mCount;
+    const int peakDequeuedCount = mPeakDequeuedCount;
+    startWindow();
+    if (!clean) {
+        mCleanWindows = 0;
+        return false;
+    }
+    if (++mCleanWindows < mRequiredCleanWindows) {
+        return false;
+    }
+    mCleanWindows = 0;
+    return setCount(std::max({mCount - 1, peakDequeuedCount, dequeuedCount, 1}));
+}
+
+bool AdaptiveBufferCount::setCount(int count) {
+    count = std::clamp(count, 1, mRequestedCount);
+    if (count == mCount) {
+        return false;
+    }
+    mCount = count;
+    return true;
+}
+
+void AdaptiveBufferCount::startWindow() {
+    mFrames = 0;
+    mPeakDequeuedCount = 0;
+    mBlocked = false;
+}
+
+} // namespace android::gui
@@ -35,6 +35,7 @@
 #include <utils/Singleton.h>
 #include <utils/Trace.h>
 
+#include <private/gui/AdaptiveBufferCount.h>
 #include <private/gui/ComposerService.h>
 #include <private/gui/ComposerServiceAIDL.h>
 
@@ -1121,6 +1122,14 @@ public:
         int maxBufferCount;
         status_t status = BufferQueueProducer::setMaxDequeuedBufferCount(maxDequeuedBufferCount,
                                                                          &maxBufferCount);
+        if (status == OK) {
+            std::lock_guard lock(mAdaptiveMutex);
+            mRequestedMaxDequeuedBufferCount = maxDequeuedBufferCount;
+            mAppliedMaxDequeuedBufferCount = maxDequeuedBufferCount;
+            if (mAdaptiveBufferCount) {
+                mAdaptiveBufferCount->setRequestedCount(maxDequeuedBufferCount);
+            }
+        }
         // if we can't determine the max buffer count, then just skip growing the history size
         if (status == OK) {
             size_t newFrameHistorySize = maxBufferCount + 2; // +2 because triple buffer rendering
@@ -1144,8 +1153,148 @@ public:
         return BufferQueueProducer::query(what, value);
     }
 
+    // The overrides below count the buffers which the producer holds, and let the adaptive buffer
+    // count follow them.
+
+    status_t dequeueBuffer(int* outSlot, sp<Fence>* outFence, uint32_t width, uint32_t height,
+                           PixelFormat format, uint64_t usage, uint64_t* outBufferAge,
+                           FrameEventHistoryDelta* outTimestamps) override {
+        if (mAdaptive) {
+            std::lock_guard lock(mAdaptiveMutex);
+            if (mAdaptiveBufferCount && mAdaptiveBufferCount->onDequeueStarted(mDequeuedCount)) {
+                applyAdaptiveBufferCountLocked();
+            }
+        }
+
+        const nsecs_t start = systemTime();
+        const status_t status =
+                BufferQueueProducer::dequeueBuffer(outSlot, outFence, width, height, format, usage,
+                                                   outBufferAge, outTimestamps);
+        if (status < 0) {
+            return status;
+        }
+        const int dequeuedCount = ++mDequeuedCount;
+
+        if (mAdaptive) {
+            std::lock_guard lock(mAdaptiveMutex);
+            const bool allocated = status & BUFFER_NEEDS_REALLOCATION;
+            if (mAdaptiveBufferCount &&
+                mAdaptiveBufferCount->onDequeueFinished(dequeuedCount, systemTime() - start,
+                                                        allocated)) {
+                applyAdaptiveBufferCountLocked();
+            }
+        }
+        return status;
+    }
+
+    status_t queueBuffer(int slot, const QueueBufferInput& input,
+                         QueueBufferOutput* output) override {
+        const status_t status = BufferQueueProducer::queueBuffer(slot, input, output);
+        if (status != OK) {
+            return status;
+        }
+        const int dequeuedCount = --mDequeuedCount;
+
+        if (mAdaptive) {
+            bool lowered = false;
+            {
+                std::lock_guard lock(mAdaptiveMutex);
+                if (mAdaptiveBufferCount &&
+                    mAdaptiveBufferCount->onQueued(dequeuedCount, systemTime())) {
+                    lowered = applyAdaptiveBufferCountLocked();
+                }
+            }
+            // Lowering the count frees empty slots first, so free the buffers themselves, which
+            // are reallocated if the producer needs them again.
+            if (lowered) {
+                if (sp<BLASTBufferQueue> bbq = mBLASTBufferQueue.promote()) {
+                    bbq->mBufferItemConsumer->discardFreeBuffers();
+                }
+            }
+        }
+        return status;
+    }
+
+    status_t cancelBuffer(int slot, const sp<Fence>& fence) override {
+        const status_t status = BufferQueueProducer::cancelBuffer(slot, fence);
+        if (status == OK) {
+            mDequeuedCount--;
+        }
+        return status;
+    }
+
+    status_t detachBuffer(int slot) override {
+        const status_t status = BufferQueueProducer::detachBuffer(slot);
+        if (status == OK) {
+            mDequeuedCount--;
+        }
+        return status;
+    }
+
+    status_t attachBuffer(int* outSlot, const sp<GraphicBuffer>& buffer) override {
+        const status_t status = BufferQueueProducer::attachBuffer(outSlot, buffer);
+        if (status >= 0) {
+            mDequeuedCount++;
+        }
+        return status;
+    }
+
+    status_t disconnect(int api, DisconnectMode mode) override {
+        const status_t status = BufferQueueProducer::disconnect(api, mode);
+        if (status == OK) {
+            // Disconnecting frees the buffers which the producer held.
+            mDequeuedCount = 0;
+        }
+        return status;
+    }
+
+    void setAdaptiveBufferCountEnabled(bool enabled) {
+        std::lock_guard lock(mAdaptiveMutex);
+        if (enabled == mAdaptiveBufferCount.has_value()) {
+            return;
+        }
+        if (enabled) {
+            mAdaptiveBufferCount.emplace(mRequestedMaxDequeuedBufferCount);
+        } else {
+            mAdaptiveBufferCount.reset();
+            int maxBufferCount;
+            if (BufferQueueProducer::setMaxDequeuedBufferCount(mRequestedMaxDequeuedBufferCount,
+                                                               &maxBufferCount) == OK) {
+                mAppliedMaxDequeuedBufferCount = mRequestedMaxDequeuedBufferCount;
+            }
+        }
+        mAdaptive = enabled;
+    }
+
 private:
+    // Returns whether the count was lowered.
+    bool applyAdaptiveBufferCountLocked() REQUIRES(mAdaptiveMutex) {
+        int maxBufferCount;
+        const int count = mAdaptiveBufferCount->getCount();
+        ATRACE_FORMAT("adaptive max dequeued buffer count %d", count);
+        const status_t status = BufferQueueProducer::setMaxDequeuedBufferCount(count,
+                                                                               &maxBufferCount);
+        if (status != OK) {
+            ALOGW("Failed to set the adaptive max dequeued buffer count to %d: %s", count,
+                  statusToString(status).c_str());
+            return false;
+        }
+        const bool lowered = count < mAppliedMaxDequeuedBufferCount;
+        mAppliedMaxDequeuedBufferCount = count;
+        return lowered;
+    }
+
     const wp<BLASTBufferQueue> mBLASTBufferQueue;
+
+    // The buffers which the producer has dequeued or attached, and not queued, canceled nor
+    // detached yet.
+    std::atomic<int> mDequeuedCount = 0;
+
+    std::atomic<bool> mAdaptive = false;
+    std::mutex mAdaptiveMutex;
+    int mRequestedMaxDequeuedBufferCount GUARDED_BY(mAdaptiveMutex) = 1;
+    int mAppliedMaxDequeuedBufferCount GUARDED_BY(mAdaptiveMutex) = 1;
+    std::optional<gui::AdaptiveBufferCount> mAdaptiveBufferCount GUARDED_BY(mAdaptiveMutex);
 };
 
 // Similar to BufferQueue::createBufferQueue but creates an adapter specific bufferqueue producer.
@@ -1173,6 +1322,11 @@ void BLASTBufferQueue::createBufferQueue(sp<IGraphicBufferProducer>* outProducer
     *outConsumer = consumer;
 }
 
+void BLASTBufferQueue::setAdaptiveBufferCountEnabled(bool enabled) {
+    // mProducer is always created by createBufferQueue.
+    static_cast<BBQBufferQueueProducer*>(mProducer.get())->setAdaptiveBufferCountEnabled(enabled);
+}
+
 void BLASTBufferQueue::resizeFrameEventHistory(size_t newSize) {
     // This can be null during creation of the buffer queue, but resizing won't do anything at that
     // point in time, so just ignore. This can go away once the class relationships and lifetimes of
@@ -19,6 +19,7 @@
 #include <cinttypes>
 #include <cstdint>
 
+#include <android-base/properties.h>
 #include <gui/DisplayEventDispatcher.h>
 #include <gui/DisplayEventReceiver.h>
 #include <utils/Log.h>
@@ -35,6 +36,12 @@ static const size_t EVENT_BUFFER_SIZE = 100;
 
 static constexpr nsecs_t WAITING_FOR_VSYNC_TIMEOUT = ms2ns(300);
 
+static bool sharedVsyncChannelEnabled() {
+    static const bool enabled =
+            base::GetBoolProperty("debug.sf.enable_shared_vsync_channel", false);
+    return enabled;
+}
+
 DisplayEventDispatcher::DisplayEventDispatcher(const sp<Looper>& looper,
                                                gui::ISurfaceComposer::VsyncSource vsyncSource,
                                                EventRegistrationFlags eventRegistration,
@@ -61,6 +68,16 @@ status_t DisplayEventDispatcher::initialize() {
         }
     }
 
+    // Vsync events are then delivered through a second fd, any other events still arrive on the
+    // receiver's fd. Without a looper, the owner polls getFd(), so the channel is not used.
+    if (mLooper != nullptr && sharedVsyncChannelEnabled() &&
+        mReceiver.enableSharedVsyncChannel() == OK) {
+        int rc = mLooper->addFd(mReceiver.getSharedVsyncFd(), 0, Looper::EVENT_INPUT, this, NULL);
+        if (rc < 0) {
+            return UNKNOWN_ERROR;
+        }
+    }
+
     return OK;
 }
 
@@ -69,6 +86,9 @@ void DisplayEventDispatcher::dispose() {
 
     if (!mReceiver.initCheck() && mLooper != nullptr) {
         mLooper->removeFd(mReceiver.getFd());
+        if (mReceiver.getSharedVsyncFd() >= 0) {
+            mLooper->removeFd(mReceiver.getSharedVsyncFd());
+        }
     }
 }
 
@@ -209,6 +229,16 @@ bool DisplayEventDispatcher::processPendingEvents(nsecs_t* outTimestamp,
     if (n < 0) {
         ALOGW("Failed to get events from display event dispatcher, status=%d", status_t(n));
     }
+
+    // Keep the most recent of the vsyncs from the queue and from the shared vsync channel.
+    DisplayEventReceiver::Event ev;
+    if (mReceiver.consumeSharedVsync(&ev) && (!gotVsync || ev.header.timestamp >= *outTimestamp)) {
+        gotVsync = true;
+        *outTimestamp = ev.header.timestamp;
+        *outDisplayId = ev.header.displayId;
+        *outCount = ev.vsync.count;
+        *outVsyncEventData = ev.vsync.vsyncData;
+    }
     return gotVsync;
 }
 
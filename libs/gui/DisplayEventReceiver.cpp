@@ -26,6 +26,7 @@
 #include <private/gui/ComposerServiceAIDL.h>
 
 #include <private/gui/BitTube.h>
+#include <private/gui/SharedVsyncChannel.h>
 
 // ---------------------------------------------------------------------------
 
@@ -107,6 +108,39 @@ status_t DisplayEventReceiver::getLatestVsyncEventData(
     return NO_INIT;
 }
 
+status_t DisplayEventReceiver::enableSharedVsyncChannel() {
+    if (mEventConnection == nullptr) {
+        return mInitError.has_value() ? mInitError.value() : NO_INIT;
+    }
+    if (mSharedVsyncChannel != nullptr) {
+        return NO_ERROR;
+    }
+
+    auto channel = std::make_unique<gui::SharedVsyncChannel>();
+    auto status = mEventConnection->getSharedVsyncChannel(channel.get());
+    if (!status.isOk()) {
+        ALOGW("Failed to get shared vsync channel: %s", status.toString8().c_str());
+        return status.transactionError();
+    }
+    mSharedVsyncChannel = std::move(channel);
+    return NO_ERROR;
+}
+
+int DisplayEventReceiver::getSharedVsyncFd() const {
+    return mSharedVsyncChannel != nullptr ? mSharedVsyncChannel->getFd() : -1;
+}
+
+bool DisplayEventReceiver::consumeSharedVsync(Event* outEvent) {
+    gui::SharedVsyncChannel::Vsync vsync;
+    if (mSharedVsyncChannel == nullptr || !mSharedVsyncChannel->consume(&vsync)) {
+        return false;
+    }
+    outEvent->header = {DISPLAY_EVENT_VSYNC, vsync.displayId, vsync.timestamp};
+    outEvent->vsync.count = vsync.count;
+    outEvent->vsync.vsyncData = vsync.vsyncData;
+    return true;
+}
+
 ssize_t DisplayEventReceiver::getEvents(DisplayEventReceiver::Event* events,
         size_t count) {
     return DisplayEventReceiver::getEvents(mDataChannel.get(), events, count);
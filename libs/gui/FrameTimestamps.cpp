@@ -272,11 +272,10 @@ void ProducerFrameEventHistory::applyDelta(
         const FrameEventHistoryDelta& delta) {
     mCompositorTiming = delta.mCompositorTiming;
 
-    // Deltas should have enough reserved capacity for the consumer-side, therefore if there's a
-    // different capacity, we re-sized on the consumer side and now need to resize on the producer
-    // side.
-    if (delta.mDeltas.capacity() > mFrames.capacity()) {
-        resize(delta.mDeltas.capacity());
+    // If the consumer's history is larger, it was re-sized on the consumer side and now needs to
+    // be resized on the producer side.
+    if (delta.mHistorySize > mFrames.size()) {
+        resize(delta.mHistorySize);
     }
 
     for (auto& d : delta.mDeltas) {
@@ -423,7 +422,7 @@ void ConsumerFrameEventHistory::addQueue(const NewFrameEventsEntry& newEntry) {
     newTimestamps.requestedPresentTime = newEntry.requestedPresentTime;
     newTimestamps.acquireFence = newEntry.acquireFence;
     newTimestamps.valid = true;
-    mFrames[mQueueOffset] = newTimestamps;
+    mFrames[mQueueOffset] = std::move(newTimestamps);
 
     // Note: We avoid sending the acquire fence back to the caller since
     // they have the original one already, so there is no need to set the
@@ -517,9 +516,10 @@ void ConsumerFrameEventHistory::getAndResetDelta(
     mProducerWantsEvents = true;
     delta->mCompositorTiming = mCompositorTiming;
 
+    delta->mHistorySize = mFrames.size();
+
     // Write these in order of frame number so that it is easy to
     // add them to a FenceTimeline in the proper order producer side.
-    delta->mDeltas.reserve(mFramesDirty.size());
     auto earliestFrame = std::min_element(
             mFrames.begin(), mFrames.end(), &FrameNumberLessThan);
     for (auto frame = earliestFrame; frame != mFrames.end(); ++frame) {
@@ -729,6 +729,7 @@ FrameEventHistoryDelta& FrameEventHistoryDelta::operator=(
         ALOGE("FrameEventHistoryDelta assign clobbering history.");
     }
     mDeltas = std::move(src.mDeltas);
+    mHistorySize = src.mHistorySize;
     return *this;
 }
 
@@ -787,9 +788,10 @@ status_t FrameEventHistoryDelta::unflatten(
     if (deltaCount > UINT8_MAX) {
         return BAD_VALUE;
     }
-    mDeltas.resize(deltaCount);
-    for (auto& d : mDeltas) {
-        status_t status = d.unflatten(buffer, size, fds, count);
+    mDeltas.clear();
+    mHistorySize = deltaCount;
+    for (uint32_t i = 0; i < deltaCount; i++) {
+        status_t status = mDeltas.emplace_back().unflatten(buffer, size, fds, count);
         if (status != NO_ERROR) {
             return status;
         }
@@ -797,11 +799,11 @@ status_t FrameEventHistoryDelta::unflatten(
     return NO_ERROR;
 }
 
-std::vector<FrameEventsDelta>::const_iterator FrameEventHistoryDelta::begin() const {
+FrameEventHistoryDelta::Deltas::const_iterator FrameEventHistoryDelta::begin() const {
     return mDeltas.begin();
 }
 
-std::vector<FrameEventsDelta>::const_iterator FrameEventHistoryDelta::end() const {
+FrameEventHistoryDelta::Deltas::const_iterator FrameEventHistoryDelta::end() const {
     return mDeltas.end();
 }
 
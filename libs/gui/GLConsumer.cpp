@@ -23,6 +23,8 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <GLES2/gl2.h>
@@ -35,6 +37,7 @@
 
 #include <gui/BufferItem.h>
 #include <gui/DebugEGLImageTracker.h>
+#include <gui/EGLImageCache.h>
 #include <gui/GLConsumer.h>
 #include <gui/ISurfaceComposer.h>
 #include <gui/SurfaceComposerClient.h>
@@ -42,6 +45,8 @@
 #include <private/gui/ComposerService.h>
 #include <private/gui/SyncFeatures.h>
 
+#include <LibGuiProperties.sysprop.h>
+
 #include <utils/Log.h>
 #include <utils/String8.h>
 #include <utils/Trace.h>
@@ -80,6 +85,7 @@ static const mat4 mtxIdentity;
 
 Mutex GLConsumer::sStaticInitLock;
 sp<GraphicBuffer> GLConsumer::sReleasedTexImageBuffer;
+Mutex GLConsumer::sEglImageCacheLock;
 
 static bool hasEglProtectedContentImpl() {
     EGLDisplay dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
@@ -321,6 +327,25 @@ sp<GraphicBuffer> GLConsumer::getDebugTexImageBuffer() {
     return sReleasedTexImageBuffer;
 }
 
+EGLImageCache<sp<GLConsumer::EglImage>>& GLConsumer::getEglImageCacheLocked() {
+    // Never destroyed, so that no EGLImage is destroyed after EGL at exit. The cached images keep
+    // their buffers alive after their slots are freed, so the cache is opt-in.
+    static auto* cache = new EGLImageCache<sp<EglImage>>(static_cast<size_t>(
+            std::max(sysprop::LibGuiProperties::egl_image_cache_size().value_or(0), 0)));
+    return *cache;
+}
+
+sp<GLConsumer::EglImage> GLConsumer::getEglImage(const sp<GraphicBuffer>& graphicBuffer) {
+    Mutex::Autolock _l(sEglImageCacheLock);
+    auto& cache = getEglImageCacheLocked();
+    sp<EglImage> image = cache.get(graphicBuffer->getId());
+    if (image == nullptr) {
+        image = new EglImage(graphicBuffer);
+        cache.put(graphicBuffer->getId(), image);
+    }
+    return image;
+}
+
 status_t GLConsumer::acquireBufferLocked(BufferItem *item,
         nsecs_t presentWhen, uint64_t maxFrameNumber) {
     status_t err = ConsumerBase::acquireBufferLocked(item, presentWhen,
@@ -334,7 +359,7 @@ status_t GLConsumer::acquireBufferLocked(BufferItem *item,
     // replaces any old EglImage with a new one (using the new buffer).
     if (item->mGraphicBuffer != nullptr) {
         int slot = item->mSlot;
-        mEglSlots[slot].mEglImage = new EglImage(item->mGraphicBuffer);
+        mEglSlots[slot].mEglImage = getEglImage(item->mGraphicBuffer);
     }
 
     return NO_ERROR;
@@ -914,6 +939,16 @@ void GLConsumer::freeBufferLocked(int slotIndex) {
 void GLConsumer::abandonLocked() {
     GLC_LOGV("abandonLocked");
     mCurrentTextureImage.clear();
+    {
+        // Don't keep the buffers of this BufferQueue alive for reuse.
+        Mutex::Autolock _l(sEglImageCacheLock);
+        auto& cache = getEglImageCacheLocked();
+        for (const auto& slot : mSlots) {
+            if (slot.mGraphicBuffer != nullptr) {
+                cache.erase(slot.mGraphicBuffer->getId());
+            }
+        }
+    }
     ConsumerBase::abandonLocked();
 }
 
@@ -930,6 +965,13 @@ void GLConsumer::dumpLocked(String8& result, const char* prefix) const
        mCurrentCrop.top, mCurrentCrop.right, mCurrentCrop.bottom,
        mCurrentTransform);
 
+    {
+        Mutex::Autolock _l(sEglImageCacheLock);
+        std::string cacheDump;
+        getEglImageCacheLocked().dump(cacheDump, prefix);
+        result.append(cacheDump.c_str());
+    }
+
     ConsumerBase::dumpLocked(result, prefix);
 }
 
@@ -38,7 +38,8 @@ enum class Tag : uint32_t {
     ON_RELEASE_BUFFER,
     ON_TRANSACTION_QUEUE_STALLED,
     ON_TRUSTED_PRESENTATION_CHANGED,
-    LAST = ON_TRUSTED_PRESENTATION_CHANGED,
+    ON_BUFFER_EVICTED,
+    LAST = ON_BUFFER_EVICTED,
 };
 
 } // Anonymous namespace
@@ -270,6 +271,7 @@ status_t ListenerStats::writeToParcel(Parcel* output) const {
             return err;
         }
     }
+    SAFE_PARCEL(output->writeParcelableVector, releasedBuffers);
     return NO_ERROR;
 }
 
@@ -284,6 +286,22 @@ status_t ListenerStats::readFromParcel(const Parcel* input) {
         }
         transactionStats.push_back(stats);
     }
+    SAFE_PARCEL(input->readParcelableVector, &releasedBuffers);
+    return NO_ERROR;
+}
+
+status_t ReleasedBufferStats::writeToParcel(Parcel* output) const {
+    SAFE_PARCEL(output->writeParcelable, callbackId);
+    SAFE_PARCEL(output->write, releaseFence ? *releaseFence : *Fence::NO_FENCE);
+    SAFE_PARCEL(output->writeUint32, currentMaxAcquiredBufferCount);
+    return NO_ERROR;
+}
+
+status_t ReleasedBufferStats::readFromParcel(const Parcel* input) {
+    SAFE_PARCEL(input->readParcelable, &callbackId);
+    releaseFence = sp<Fence>::make();
+    SAFE_PARCEL(input->read, *releaseFence);
+    SAFE_PARCEL(input->readUint32, &currentMaxAcquiredBufferCount);
     return NO_ERROR;
 }
 
@@ -330,6 +348,11 @@ public:
         callRemoteAsync<decltype(&ITransactionCompletedListener::onTrustedPresentationChanged)>(
                 Tag::ON_TRUSTED_PRESENTATION_CHANGED, id, inTrustedPresentationState);
     }
+
+    void onBufferEvicted(uint64_t cacheId) override {
+        callRemoteAsync<decltype(&ITransactionCompletedListener::onBufferEvicted)>(
+                Tag::ON_BUFFER_EVICTED, cacheId);
+    }
 };
 
 // Out-of-line virtual method definitions to trigger vtable emission in this translation unit (see
@@ -356,6 +379,8 @@ status_t BnTransactionCompletedListener::onTransact(uint32_t code, const Parcel&
         case Tag::ON_TRUSTED_PRESENTATION_CHANGED:
             return callLocalAsync(data, reply,
                                   &ITransactionCompletedListener::onTrustedPresentationChanged);
+        case Tag::ON_BUFFER_EVICTED:
+            return callLocalAsync(data, reply, &ITransactionCompletedListener::onBufferEvicted);
     }
 }
 
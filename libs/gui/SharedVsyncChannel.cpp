@@ -0,0 +1,180 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "SharedVsyncChannel"
+
+#include <private/gui/SharedVsyncChannel.h>
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <new>
+
+#include <binder/Parcel.h>
+#include <utils/Log.h>
+
+namespace android {
+namespace gui {
+
+SharedVsyncChannel::~SharedVsyncChannel() {
+    if (mPage != nullptr) {
+        munmap(mPage, sizeof(Page));
+    }
+}
+
+std::unique_ptr<SharedVsyncChannel> SharedVsyncChannel::create() {
+    auto channel = std::make_unique<SharedVsyncChannel>();
+    channel->mPageFd.reset(memfd_create("SharedVsyncChannel", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    if (!channel->mPageFd.ok()) {
+        ALOGE("Could not create memfd: %s", strerror(errno));
+        return nullptr;
+    }
+    if (TEMP_FAILURE_RETRY(ftruncate(channel->mPageFd.get(), sizeof(Page))) != 0) {
+        ALOGE("Could not size memfd: %s", strerror(errno));
+        return nullptr;
+    }
+    if (channel->map(PROT_READ | PROT_WRITE) != NO_ERROR) {
+        return nullptr;
+    }
+
+    // The page is shared by all the connections of an EventThread, so none of them may be able to
+    // write to it. This is only possible once the writer holds the one writable mapping.
+    if (fcntl(channel->mPageFd.get(), F_ADD_SEALS,
+              F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_FUTURE_WRITE | F_SEAL_SEAL) != 0) {
+        ALOGE("Could not seal memfd: %s", strerror(errno));
+        return nullptr;
+    }
+
+    new (channel->mPage) Page();
+    return channel;
+}
+
+status_t SharedVsyncChannel::makeReader(SharedVsyncChannel* outReader,
+                                        base::unique_fd* outWakeFd) const {
+    outReader->mPageFd.reset(fcntl(mPageFd.get(), F_DUPFD_CLOEXEC, 0));
+    if (!outReader->mPageFd.ok()) {
+        int error = errno;
+        ALOGE("Could not dup memfd: %s", strerror(error));
+        return -error;
+    }
+    outReader->mWakeFd.reset(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+    if (!outReader->mWakeFd.ok()) {
+        int error = errno;
+        ALOGE("Could not create eventfd: %s", strerror(error));
+        return -error;
+    }
+    outWakeFd->reset(fcntl(outReader->mWakeFd.get(), F_DUPFD_CLOEXEC, 0));
+    if (!outWakeFd->ok()) {
+        int error = errno;
+        ALOGE("Could not dup eventfd: %s", strerror(error));
+        return -error;
+    }
+    return NO_ERROR;
+}
+
+void SharedVsyncChannel::publish(const Vsync& vsync) {
+    LOG_ALWAYS_FATAL_IF(mPage == nullptr, "%s on a reader", __func__);
+    const uint32_t sequence = mPage->sequence.load(std::memory_order_relaxed);
+    mPage->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&mPage->vsync, &vsync, sizeof(Vsync));
+    mPage->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+status_t SharedVsyncChannel::wake(int wakeFd) {
+    const uint64_t value = 1;
+    if (TEMP_FAILURE_RETRY(::write(wakeFd, &value, sizeof(value))) < 0) {
+        return -errno;
+    }
+    return NO_ERROR;
+}
+
+bool SharedVsyncChannel::consume(Vsync* outVsync) {
+    if (mPage == nullptr) {
+        return false;
+    }
+    uint64_t value;
+    if (TEMP_FAILURE_RETRY(::read(mWakeFd.get(), &value, sizeof(value))) < 0) {
+        // EAGAIN means that this reader has not been woken up
+        ALOGE_IF(errno != EAGAIN, "Could not read eventfd: %s", strerror(errno));
+        return false;
+    }
+    read(outVsync);
+    return true;
+}
+
+void SharedVsyncChannel::read(Vsync* outVsync) const {
+    uint32_t before, after;
+    do {
+        before = mPage->sequence.load(std::memory_order_acquire);
+        std::memcpy(outVsync, &mPage->vsync, sizeof(Vsync));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = mPage->sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+}
+
+int SharedVsyncChannel::getFd() const {
+    return mWakeFd.get();
+}
+
+status_t SharedVsyncChannel::map(int prot) {
+    void* addr = mmap(nullptr, sizeof(Page), prot, MAP_SHARED, mPageFd.get(), 0);
+    if (addr == MAP_FAILED) {
+        int error = errno;
+        ALOGE("Could not map vsync page: %s", strerror(error));
+        return -error;
+    }
+    mPage = static_cast<Page*>(addr);
+    return NO_ERROR;
+}
+
+status_t SharedVsyncChannel::writeToParcel(Parcel* parcel) const {
+    if (!mPageFd.ok() || !mWakeFd.ok()) return -EINVAL;
+
+    status_t result = parcel->writeDupFileDescriptor(mPageFd.get());
+    if (result != NO_ERROR) {
+        return result;
+    }
+    return parcel->writeDupFileDescriptor(mWakeFd.get());
+}
+
+status_t SharedVsyncChannel::readFromParcel(const Parcel* parcel) {
+    mPageFd.reset(fcntl(parcel->readFileDescriptor(), F_DUPFD_CLOEXEC, 0));
+    if (!mPageFd.ok()) {
+        int error = errno;
+        ALOGE("SharedVsyncChannel::readFromParcel: can't dup file descriptor (%s)",
+              strerror(error));
+        return -error;
+    }
+    mWakeFd.reset(fcntl(parcel->readFileDescriptor(), F_DUPFD_CLOEXEC, 0));
+    if (!mWakeFd.ok()) {
+        int error = errno;
+        ALOGE("SharedVsyncChannel::readFromParcel: can't dup file descriptor (%s)",
+              strerror(error));
+        return -error;
+    }
+    if (mPage != nullptr) {
+        munmap(mPage, sizeof(Page));
+        mPage = nullptr;
+    }
+    return map(PROT_READ);
+}
+
+} // namespace gui
+} // namespace android
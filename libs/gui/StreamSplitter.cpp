@@ -33,6 +33,8 @@
 
 #include <system/window.h>
 
+#include <algorithm>
+
 namespace android {
 
 status_t StreamSplitter::createSplitter(
@@ -58,13 +60,13 @@ status_t StreamSplitter::createSplitter(
 
 StreamSplitter::StreamSplitter(const sp<IGraphicBufferConsumer>& inputQueue)
       : mIsAbandoned(false), mMutex(), mReleaseCondition(),
-        mOutstandingBuffers(0), mInput(inputQueue), mOutputs(), mBuffers() {}
+        mOutstandingBuffers(0), mMaxOutstandingBuffers(MAX_OUTSTANDING_BUFFERS),
+        mInput(inputQueue), mOutputs(), mBuffers() {}
 
 StreamSplitter::~StreamSplitter() {
     mInput->consumerDisconnect();
-    Vector<sp<IGraphicBufferProducer> >::iterator output = mOutputs.begin();
-    for (; output != mOutputs.end(); ++output) {
-        (*output)->disconnect(NATIVE_WINDOW_API_CPU);
+    for (const auto& output : mOutputs) {
+        output.producer->disconnect(NATIVE_WINDOW_API_CPU);
     }
 
     if (mBuffers.size() > 0) {
@@ -74,10 +76,21 @@ StreamSplitter::~StreamSplitter() {
 
 status_t StreamSplitter::addOutput(
         const sp<IGraphicBufferProducer>& outputQueue) {
+    return addOutput(outputQueue, OutputConfig());
+}
+
+status_t StreamSplitter::addOutput(
+        const sp<IGraphicBufferProducer>& outputQueue,
+        const OutputConfig& config) {
     if (outputQueue == nullptr) {
         ALOGE("addOutput: outputQueue must not be NULL");
         return BAD_VALUE;
     }
+    if (config.maxOutstandingBuffers < 1) {
+        ALOGE("addOutput: maxOutstandingBuffers must be at least 1 (%d)",
+                config.maxOutstandingBuffers);
+        return BAD_VALUE;
+    }
 
     Mutex::Autolock lock(mMutex);
 
@@ -91,8 +104,48 @@ status_t StreamSplitter::addOutput(
         return status;
     }
 
-    mOutputs.push_back(outputQueue);
+    Output output;
+    output.producer = outputQueue;
+    output.config = config;
+    mOutputs.push_back(output);
+
+    int maxBlockingBuffers = 0;
+    int maxDroppingBuffers = 0;
+    for (const auto& o : mOutputs) {
+        if (o.config.dropPolicy == DropPolicy::Block) {
+            maxBlockingBuffers = std::max(maxBlockingBuffers,
+                    o.config.maxOutstandingBuffers);
+        } else {
+            maxDroppingBuffers += o.config.maxOutstandingBuffers;
+        }
+    }
+    if (maxBlockingBuffers == 0) {
+        maxBlockingBuffers = MAX_OUTSTANDING_BUFFERS;
+    }
+    mMaxOutstandingBuffers = maxBlockingBuffers + maxDroppingBuffers;
+
+    return NO_ERROR;
+}
+
+status_t StreamSplitter::getOutputStats(
+        const sp<IGraphicBufferProducer>& outputQueue, OutputStats* outStats) {
+    if (outStats == nullptr) {
+        ALOGE("getOutputStats: outStats must not be NULL");
+        return BAD_VALUE;
+    }
 
+    Mutex::Autolock lock(mMutex);
+    const Output* output = findOutputLocked(outputQueue);
+    if (output == nullptr) {
+        ALOGE("getOutputStats: outputQueue is not an output");
+        return BAD_VALUE;
+    }
+
+    *outStats = output->stats;
+    if (output->releasedBuffers > 0) {
+        outStats->averageLatency = output->totalLatency /
+                static_cast<nsecs_t>(output->releasedBuffers);
+    }
     return NO_ERROR;
 }
 
@@ -108,11 +161,12 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
     // The current policy is that if any one consumer is consuming buffers too
     // slowly, the splitter will stall the rest of the outputs by not acquiring
     // any more buffers from the input. This will cause back pressure on the
-    // input queue, slowing down its producer.
+    // input queue, slowing down its producer. Outputs with DropPolicy::Drop are
+    // the exception: they are skipped instead, see below.
 
     // If there are too many outstanding buffers, we block until a buffer is
-    // released back to the input in onBufferReleased
-    while (mOutstandingBuffers >= MAX_OUTSTANDING_BUFFERS) {
+    // released in onBufferReleased
+    while (mustWaitLocked()) {
         mReleaseCondition.wait(mMutex);
 
         // If the splitter is abandoned while we are waiting, the release
@@ -139,8 +193,9 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
             "detaching buffer from input failed (%d)", status);
 
     // Initialize our reference count for this buffer
-    mBuffers.add(bufferItem.mGraphicBuffer->getId(),
-            new BufferTracker(bufferItem.mGraphicBuffer));
+    sp<BufferTracker> tracker = new BufferTracker(bufferItem.mGraphicBuffer);
+    tracker->setQueueTime(systemTime());
+    mBuffers.add(bufferItem.mGraphicBuffer->getId(), tracker);
 
     IGraphicBufferProducer::QueueBufferInput queueInput(
             bufferItem.mTimestamp, bufferItem.mIsAutoTimestamp,
@@ -149,17 +204,26 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
             bufferItem.mTransform, bufferItem.mFence);
 
     // Attach and queue the buffer to each of the outputs
-    Vector<sp<IGraphicBufferProducer> >::iterator output = mOutputs.begin();
-    for (; output != mOutputs.end(); ++output) {
+    for (auto& output : mOutputs) {
+        // If this output can't take another buffer, it just misses this one,
+        // as if it had already released it
+        if (output.config.dropPolicy == DropPolicy::Drop &&
+                output.outstandingBuffers >= output.config.maxOutstandingBuffers) {
+            ALOGV("dropped buffer %#" PRIx64 " for output %p",
+                    bufferItem.mGraphicBuffer->getId(), output.producer.get());
+            output.stats.droppedBuffers++;
+            tracker->incrementReleaseCountLocked();
+            continue;
+        }
+
         int slot;
-        status = (*output)->attachBuffer(&slot, bufferItem.mGraphicBuffer);
+        status = output.producer->attachBuffer(&slot, bufferItem.mGraphicBuffer);
         if (status == NO_INIT) {
             // If we just discovered that this output has been abandoned, note
             // that, increment the release count so that we still release this
             // buffer eventually, and move on to the next output
             onAbandonedLocked();
-            mBuffers.editValueFor(bufferItem.mGraphicBuffer->getId())->
-                    incrementReleaseCountLocked();
+            tracker->incrementReleaseCountLocked();
             continue;
         } else {
             LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
@@ -167,22 +231,29 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
         }
 
         IGraphicBufferProducer::QueueBufferOutput queueOutput;
-        status = (*output)->queueBuffer(slot, queueInput, &queueOutput);
+        status = output.producer->queueBuffer(slot, queueInput, &queueOutput);
         if (status == NO_INIT) {
             // If we just discovered that this output has been abandoned, note
             // that, increment the release count so that we still release this
             // buffer eventually, and move on to the next output
             onAbandonedLocked();
-            mBuffers.editValueFor(bufferItem.mGraphicBuffer->getId())->
-                    incrementReleaseCountLocked();
+            tracker->incrementReleaseCountLocked();
             continue;
         } else {
             LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
                     "queueing buffer to output failed (%d)", status);
         }
 
+        output.outstandingBuffers++;
+        output.stats.queuedBuffers++;
+
         ALOGV("queued buffer %#" PRIx64 " to output %p",
-                bufferItem.mGraphicBuffer->getId(), output->get());
+                bufferItem.mGraphicBuffer->getId(), output.producer.get());
+    }
+
+    // If every output dropped the buffer, it goes straight back to the input
+    if (tracker->getReleaseCountLocked() >= mOutputs.size()) {
+        releaseToInputLocked(tracker);
     }
 }
 
@@ -207,7 +278,19 @@ void StreamSplitter::onBufferReleasedByOutput(
     ALOGV("detached buffer %#" PRIx64 " from output %p",
           buffer->getId(), from.get());
 
-    const sp<BufferTracker>& tracker = mBuffers.editValueFor(buffer->getId());
+    sp<BufferTracker> tracker = mBuffers.editValueFor(buffer->getId());
+
+    if (Output* output = findOutputLocked(from)) {
+        const nsecs_t latency = systemTime() - tracker->getQueueTime();
+        output->outstandingBuffers--;
+        output->releasedBuffers++;
+        output->totalLatency += latency;
+        output->stats.maxLatency = std::max(output->stats.maxLatency, latency);
+
+        // An onFrameAvailable call may be waiting for this output, rather than
+        // for a buffer to be released to the input
+        mReleaseCondition.signal();
+    }
 
     // Merge the release fence of the incoming buffer so that the fence we send
     // back to the input includes all of the outputs' fences
@@ -221,6 +304,35 @@ void StreamSplitter::onBufferReleasedByOutput(
         return;
     }
 
+    releaseToInputLocked(tracker);
+}
+
+bool StreamSplitter::mustWaitLocked() const {
+    if (mOutstandingBuffers >= mMaxOutstandingBuffers) {
+        return true;
+    }
+    for (const auto& output : mOutputs) {
+        if (output.config.dropPolicy == DropPolicy::Block &&
+                output.outstandingBuffers >= output.config.maxOutstandingBuffers) {
+            return true;
+        }
+    }
+    return false;
+}
+
+StreamSplitter::Output* StreamSplitter::findOutputLocked(
+        const sp<IGraphicBufferProducer>& outputQueue) {
+    for (auto& output : mOutputs) {
+        if (output.producer == outputQueue) {
+            return &output;
+        }
+    }
+    return nullptr;
+}
+
+void StreamSplitter::releaseToInputLocked(const sp<BufferTracker>& tracker) {
+    const sp<GraphicBuffer>& buffer = tracker->getBuffer();
+
     // If we've been abandoned, we can't return the buffer to the input, so just
     // stop tracking it and move on
     if (mIsAbandoned) {
@@ -230,7 +342,7 @@ void StreamSplitter::onBufferReleasedByOutput(
 
     // Attach and release the buffer back to the input
     int consumerSlot;
-    status = mInput->attachBuffer(&consumerSlot, tracker->getBuffer());
+    status_t status = mInput->attachBuffer(&consumerSlot, buffer);
     LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
             "attaching buffer to input failed (%d)", status);
 
@@ -276,7 +388,8 @@ void StreamSplitter::OutputListener::binderDied(const wp<IBinder>& /* who */) {
 }
 
 StreamSplitter::BufferTracker::BufferTracker(const sp<GraphicBuffer>& buffer)
-      : mBuffer(buffer), mMergedFence(Fence::NO_FENCE), mReleaseCount(0) {}
+      : mBuffer(buffer), mMergedFence(Fence::NO_FENCE), mReleaseCount(0),
+        mQueueTime(0) {}
 
 StreamSplitter::BufferTracker::~BufferTracker() {}
 
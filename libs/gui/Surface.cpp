@@ -75,6 +75,10 @@ bool isInterceptorRegistrationOp(int op) {
             op == NATIVE_WINDOW_SET_QUERY_INTERCEPTOR;
 }
 
+bool isBatchBufferOp(int op) {
+    return op == NATIVE_WINDOW_DEQUEUE_BUFFERS || op == NATIVE_WINDOW_CANCEL_BUFFERS;
+}
+
 } // namespace
 
 Surface::Surface(const sp<IGraphicBufferProducer>& bufferProducer, bool controlledByApp,
@@ -514,6 +518,13 @@ int Surface::hook_perform(ANativeWindow* window, int operation, ...) {
     // exclusive ownership.
     if (!isInterceptorRegistrationOp(operation)) {
         std::shared_lock<std::shared_mutex> lock(c->mInterceptorMutex);
+        // The buffer interceptors only see one buffer at a time, so callers
+        // of the batch operations have to fall back to them.
+        if (isBatchBufferOp(operation) &&
+            (c->mDequeueInterceptor != nullptr || c->mCancelInterceptor != nullptr)) {
+            va_end(args);
+            return INVALID_OPERATION;
+        }
         if (c->mPerformInterceptor != nullptr) {
             result = c->mPerformInterceptor(window, Surface::performInternal,
                                             c->mPerformInterceptorData, operation, args);
@@ -802,7 +813,8 @@ int Surface::dequeueBuffers(std::vector<BatchBuffer>* buffers) {
     for (const auto& output : dequeueOutput) {
         // Collect slots that needs requesting buffer
         sp<GraphicBuffer>& gbuf(mSlots[output.slot].buffer);
-        if ((result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) || gbuf == nullptr) {
+        if ((output.result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) ||
+            gbuf == nullptr) {
             if (mReportRemovedBuffers && (gbuf != nullptr)) {
                 mRemovedBuffers.push_back(gbuf);
             }
@@ -903,6 +915,7 @@ int Surface::cancelBuffers(const std::vector<BatchBuffer>& buffers) {
     using CancelBufferInput = IGraphicBufferProducer::CancelBufferInput;
     ATRACE_CALL();
     ALOGV("Surface::cancelBuffers");
+    Mutex::Autolock lock(mMutex);
 
     if (mSharedBufferMode) {
         ALOGE("%s: batch operation is not supported in shared buffer mode!",
@@ -1475,6 +1488,12 @@ int Surface::perform(int operation, va_list args)
     case NATIVE_WINDOW_SET_FRAME_TIMELINE_INFO:
         res = dispatchSetFrameTimelineInfo(args);
         break;
+    case NATIVE_WINDOW_DEQUEUE_BUFFERS:
+        res = dispatchDequeueBuffers(args);
+        break;
+    case NATIVE_WINDOW_CANCEL_BUFFERS:
+        res = dispatchCancelBuffers(args);
+        break;
     default:
         res = NAME_NOT_FOUND;
         break;
@@ -1833,6 +1852,36 @@ int Surface::dispatchSetFrameTimelineInfo(va_list args) {
     return setFrameTimelineInfo(nativeWindowFtlInfo.frameNumber, ftlInfo);
 }
 
+int Surface::dispatchDequeueBuffers(va_list args) {
+    size_t count = va_arg(args, size_t);
+    ANativeWindowBuffer** buffers = va_arg(args, ANativeWindowBuffer**);
+    int* fenceFds = va_arg(args, int*);
+
+    std::vector<BatchBuffer> batch(count);
+    int result = dequeueBuffers(&batch);
+    if (result != OK) {
+        return result;
+    }
+    for (size_t i = 0; i < count; i++) {
+        buffers[i] = batch[i].buffer;
+        fenceFds[i] = batch[i].fenceFd;
+    }
+    return OK;
+}
+
+int Surface::dispatchCancelBuffers(va_list args) {
+    size_t count = va_arg(args, size_t);
+    ANativeWindowBuffer* const* buffers = va_arg(args, ANativeWindowBuffer* const*);
+    const int* fenceFds = va_arg(args, const int*);
+
+    std::vector<BatchBuffer> batch(count);
+    for (size_t i = 0; i < count; i++) {
+        batch[i].buffer = buffers[i];
+        batch[i].fenceFd = fenceFds[i];
+    }
+    return cancelBuffers(batch);
+}
+
 bool Surface::transformToDisplayInverse() const {
     return (mTransform & NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY) ==
             NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY;
@@ -347,6 +347,14 @@ void TransactionCompletedListener::addSurfaceControlToCallbacks(
 }
 
 void TransactionCompletedListener::onTransactionCompleted(ListenerStats listenerStats) {
+    for (const auto& releasedBuffer : listenerStats.releasedBuffers) {
+        onReleaseBuffer(releasedBuffer.callbackId, releasedBuffer.releaseFence,
+                        releasedBuffer.currentMaxAcquiredBufferCount);
+    }
+    if (listenerStats.transactionStats.empty()) {
+        return;
+    }
+
     std::unordered_map<CallbackId, CallbackTranslation, CallbackIdHash> callbacksMap;
     std::multimap<int32_t, sp<JankDataListener>> jankListenersMap;
     {
@@ -664,6 +672,7 @@ public:
         }
     }
 
+
 private:
     client_cache_t findLeastRecentlyUsedBuffer() REQUIRES(mMutex) {
         auto itr = mBuffers.begin();
@@ -702,6 +711,12 @@ void removeDeadBufferCallback(void* /*context*/, uint64_t graphicBufferId) {
     BufferCache::getInstance().uncache(graphicBufferId);
 }
 
+void TransactionCompletedListener::onBufferEvicted(uint64_t cacheId) {
+    // SurfaceFlinger keeps the buffer until it is uncached, so that the transactions sent with its
+    // cache id before now still find it. If it is no longer cached here, it was uncached already.
+    BufferCache::getInstance().uncache(cacheId);
+}
+
 // ---------------------------------------------------------------------------
 
 SurfaceComposerClient::Transaction::Transaction() {
@@ -817,7 +832,7 @@ status_t SurfaceComposerClient::Transaction::readFromParcel(const Parcel* parcel
         if (composerState.read(*parcel) == BAD_VALUE) {
             return BAD_VALUE;
         }
-        composerStates[surfaceControlHandle] = composerState;
+        composerStates[surfaceControlHandle] = std::move(composerState);
     }
 
     InputWindowCommands inputWindowCommands;
@@ -854,9 +869,9 @@ status_t SurfaceComposerClient::Transaction::readFromParcel(const Parcel* parcel
     mIsAutoTimestamp = isAutoTimestamp;
     mFrameTimelineInfo = frameTimelineInfo;
     mDisplayStates = displayStates;
-    mListenerCallbacks = listenerCallbacks;
-    mComposerStates = composerStates;
-    mInputWindowCommands = inputWindowCommands;
+    mListenerCallbacks = std::move(listenerCallbacks);
+    mComposerStates = std::move(composerStates);
+    mInputWindowCommands = std::move(inputWindowCommands);
     mApplyToken = applyToken;
     mUncacheBuffers = std::move(uncacheBuffers);
     mMergedTransactionIds = std::move(mergedTransactionIds);
@@ -963,15 +978,23 @@ SurfaceComposerClient::Transaction& SurfaceComposerClient::Transaction::merge(Tr
     }
     mMergedTransactionIds.insert(mMergedTransactionIds.begin(), other.mId);
 
-    for (auto const& [handle, composerState] : other.mComposerStates) {
-        if (mComposerStates.count(handle) == 0) {
-            mComposerStates[handle] = composerState;
+    // other is cleared below, so its states are moved rather than copied. The
+    // states of layers which aren't in this transaction yet are spliced over
+    // as whole nodes, which doesn't allocate either.
+    mComposerStates.reserve(mComposerStates.size() + other.mComposerStates.size());
+    for (auto it = other.mComposerStates.begin(); it != other.mComposerStates.end();) {
+        auto next = std::next(it);
+        auto current = mComposerStates.find(it->first);
+        if (current == mComposerStates.end()) {
+            mComposerStates.insert(other.mComposerStates.extract(it));
         } else {
-            if (composerState.state.what & layer_state_t::eBufferChanged) {
-                releaseBufferIfOverwriting(mComposerStates[handle].state);
+            layer_state_t& state = it->second.state;
+            if (state.what & layer_state_t::eBufferChanged) {
+                releaseBufferIfOverwriting(current->second.state);
             }
-            mComposerStates[handle].state.merge(composerState.state);
+            current->second.state.merge(std::move(state));
         }
+        it = next;
     }
 
     for (auto const& state : other.mDisplayStates) {
@@ -1336,17 +1359,14 @@ void SurfaceComposerClient::Transaction::setEarlyWakeupEnd() {
 layer_state_t* SurfaceComposerClient::Transaction::getLayerState(const sp<SurfaceControl>& sc) {
     auto handle = sc->getLayerStateHandle();
 
-    if (mComposerStates.count(handle) == 0) {
-        // we don't have it, add an initialized layer_state to our list
-        ComposerState s;
-
-        s.state.surface = handle;
-        s.state.layerId = sc->getLayerId();
-
-        mComposerStates[handle] = s;
+    auto [it, inserted] = mComposerStates.try_emplace(handle);
+    if (inserted) {
+        // we didn't have it, initialize the new layer_state
+        it->second.state.surface = std::move(handle);
+        it->second.state.layerId = sc->getLayerId();
     }
 
-    return &(mComposerStates[handle].state);
+    return &(it->second.state);
 }
 
 void SurfaceComposerClient::Transaction::registerSurfaceControlForCallback(
@@ -14,11 +14,16 @@
  * limitations under the License.
  */
 
+#define LOG_TAG "WindowInfosListenerReporter"
+
 #include <android/gui/ISurfaceComposer.h>
 #include <gui/AidlStatusUtil.h>
 #include <gui/WindowInfosListenerReporter.h>
+#include <log/log.h>
 #include "gui/WindowInfosUpdate.h"
 
+#include <cinttypes>
+
 namespace android {
 
 using gui::DisplayInfo;
@@ -52,9 +57,9 @@ status_t WindowInfosListenerReporter::addWindowInfosListener(
             mWindowInfosListeners.insert(windowInfosListener);
         }
 
-        if (outInitialInfo != nullptr) {
-            outInitialInfo->first = mLastWindowInfos;
-            outInitialInfo->second = mLastDisplayInfos;
+        if (outInitialInfo != nullptr && mLastUpdate != nullptr) {
+            outInitialInfo->first = mLastUpdate->windowInfos;
+            outInitialInfo->second = mLastUpdate->displayInfos;
         }
     }
 
@@ -76,8 +81,7 @@ status_t WindowInfosListenerReporter::removeWindowInfosListener(
             status = statusTFromBinderStatus(s);
             // Clear the last stored state since we're disabling updates and don't want to hold
             // stale values
-            mLastWindowInfos.clear();
-            mLastDisplayInfos.clear();
+            mLastUpdate.reset();
         }
 
         if (status == OK) {
@@ -92,6 +96,7 @@ binder::Status WindowInfosListenerReporter::onWindowInfosChanged(
         const gui::WindowInfosUpdate& update) {
     std::unordered_set<sp<WindowInfosListener>, gui::SpHash<WindowInfosListener>>
             windowInfosListeners;
+    std::shared_ptr<const gui::WindowInfosUpdate> fullUpdate;
 
     {
         std::scoped_lock lock(mListenersMutex);
@@ -99,12 +104,26 @@ binder::Status WindowInfosListenerReporter::onWindowInfosChanged(
             windowInfosListeners.insert(listener);
         }
 
-        mLastWindowInfos = update.windowInfos;
-        mLastDisplayInfos = update.displayInfos;
+        if (!update.isDelta()) {
+            fullUpdate = std::make_shared<const gui::WindowInfosUpdate>(update);
+        } else if (mLastUpdate != nullptr) {
+            if (auto applied = mLastUpdate->applyDelta(update)) {
+                fullUpdate = std::make_shared<const gui::WindowInfosUpdate>(std::move(*applied));
+            }
+        }
+        if (fullUpdate != nullptr) {
+            mLastUpdate = fullUpdate;
+        }
     }
 
-    for (auto listener : windowInfosListeners) {
-        listener->onWindowInfosChanged(update);
+    if (fullUpdate != nullptr) {
+        for (auto listener : windowInfosListeners) {
+            listener->onWindowInfosChanged(*fullUpdate);
+        }
+    } else if (!windowInfosListeners.empty()) {
+        ALOGW("Window infos delta for generation %" PRId64 " does not apply, resyncing",
+              update.baseGeneration);
+        mWindowInfosPublisher->requestWindowInfosResync(mListenerId);
     }
 
     mWindowInfosPublisher->ackWindowInfosReceived(update.vsyncId, mListenerId);
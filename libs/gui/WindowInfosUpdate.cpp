@@ -17,8 +17,102 @@
 #include <gui/WindowInfosUpdate.h>
 #include <private/gui/ParcelUtils.h>
 
+#include <cinttypes>
+#include <unordered_map>
+#include <unordered_set>
+
 namespace android::gui {
 
+namespace {
+
+// WindowInfo::operator== leaves out some of the fields which are parcelled, but a delta must only
+// leave out windows which are unchanged for the listeners.
+bool isSameWindow(const WindowInfo& lhs, const WindowInfo& rhs) {
+    return lhs == rhs && lhs.alpha == rhs.alpha &&
+            lhs.touchableRegionCropHandle == rhs.touchableRegionCropHandle &&
+            lhs.windowToken == rhs.windowToken && lhs.focusTransferTarget == rhs.focusTransferTarget;
+}
+
+} // namespace
+
+std::optional<WindowInfosUpdate> WindowInfosUpdate::makeDelta(
+        const WindowInfosUpdate& base, const std::unordered_set<int32_t>* changedWindowIds) const {
+    if (isDelta() || base.isDelta() || base.generation < 0) {
+        return std::nullopt;
+    }
+
+    std::unordered_map<int32_t, const WindowInfo*> baseWindows;
+    baseWindows.reserve(base.windowInfos.size());
+    for (const auto& windowInfo : base.windowInfos) {
+        if (!baseWindows.emplace(windowInfo.id, &windowInfo).second) {
+            return std::nullopt;
+        }
+    }
+
+    WindowInfosUpdate delta({}, displayInfos, vsyncId, timestamp);
+    delta.generation = generation;
+    delta.baseGeneration = base.generation;
+    delta.windowIds.reserve(windowInfos.size());
+    std::unordered_set<int32_t> ids;
+    ids.reserve(windowInfos.size());
+    for (const auto& windowInfo : windowInfos) {
+        if (!ids.insert(windowInfo.id).second) {
+            return std::nullopt;
+        }
+        delta.windowIds.push_back(windowInfo.id);
+
+        const auto it = baseWindows.find(windowInfo.id);
+        if (it == baseWindows.end() ||
+            ((changedWindowIds == nullptr || changedWindowIds->count(windowInfo.id) != 0) &&
+             !isSameWindow(*it->second, windowInfo))) {
+            delta.windowInfos.push_back(windowInfo);
+        }
+    }
+
+    if (delta.windowInfos.size() == windowInfos.size()) {
+        return std::nullopt;
+    }
+    return delta;
+}
+
+std::optional<WindowInfosUpdate> WindowInfosUpdate::applyDelta(
+        const WindowInfosUpdate& delta) const {
+    if (isDelta() || !delta.isDelta() || delta.baseGeneration != generation) {
+        return std::nullopt;
+    }
+
+    std::unordered_map<int32_t, const WindowInfo*> baseWindows;
+    baseWindows.reserve(windowInfos.size());
+    for (const auto& windowInfo : windowInfos) {
+        baseWindows.emplace(windowInfo.id, &windowInfo);
+    }
+
+    WindowInfosUpdate update({}, delta.displayInfos, delta.vsyncId, delta.timestamp);
+    update.generation = delta.generation;
+    update.windowInfos.reserve(delta.windowIds.size());
+    auto changed = delta.windowInfos.begin();
+    for (int32_t id : delta.windowIds) {
+        if (changed != delta.windowInfos.end() && changed->id == id) {
+            update.windowInfos.push_back(*changed++);
+            continue;
+        }
+        const auto it = baseWindows.find(id);
+        if (it == baseWindows.end()) {
+            ALOGE("%s: window %d of generation %" PRId64 " is not in generation %" PRId64,
+                  __func__, id, delta.generation, generation);
+            return std::nullopt;
+        }
+        update.windowInfos.push_back(*it->second);
+    }
+
+    if (changed != delta.windowInfos.end()) {
+        ALOGE("%s: window %d of generation %" PRId64 " is out of order", __func__, changed->id,
+              delta.generation);
+        return std::nullopt;
+    }
+    return update;
+}
+
 status_t WindowInfosUpdate::readFromParcel(const android::Parcel* parcel) {
     if (parcel == nullptr) {
         ALOGE("%s: Null parcel", __func__);
@@ -44,6 +138,12 @@ status_t WindowInfosUpdate::readFromParcel(const android::Parcel* parcel) {
     SAFE_PARCEL(parcel->readInt64, &vsyncId);
     SAFE_PARCEL(parcel->readInt64, &timestamp);
 
+    SAFE_PARCEL(parcel->readInt64, &generation);
+    SAFE_PARCEL(parcel->readInt64, &baseGeneration);
+    if (isDelta()) {
+        SAFE_PARCEL(parcel->readInt32Vector, &windowIds);
+    }
+
     return OK;
 }
 
@@ -66,6 +166,12 @@ status_t WindowInfosUpdate::writeToParcel(android::Parcel* parcel) const {
     SAFE_PARCEL(parcel->writeInt64, vsyncId);
     SAFE_PARCEL(parcel->writeInt64, timestamp);
 
+    SAFE_PARCEL(parcel->writeInt64, generation);
+    SAFE_PARCEL(parcel->writeInt64, baseGeneration);
+    if (isDelta()) {
+        SAFE_PARCEL(parcel->writeInt32Vector, windowIds);
+    }
+
     return OK;
 }
 
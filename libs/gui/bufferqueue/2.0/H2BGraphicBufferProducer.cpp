@@ -75,13 +75,39 @@ bool h2b(HQueueBufferOutput const& from, BQueueBufferOutput* to) {
     return true;
 }
 
+bool isValidSlot(int slot) {
+    return slot >= 0 && slot < BufferQueueDefs::NUM_BUFFER_SLOTS;
+}
+
 } // unnamed namespace
 
 // H2BGraphicBufferProducer
 // ========================
 
+void H2BGraphicBufferProducer::clearSlot(int slot) {
+    if (isValidSlot(slot)) {
+        std::lock_guard lock(mSlotsMutex);
+        mSlots[slot].clear();
+    }
+}
+
+void H2BGraphicBufferProducer::clearSlots() {
+    std::lock_guard lock(mSlotsMutex);
+    for (sp<GraphicBuffer>& buffer : mSlots) {
+        buffer.clear();
+    }
+}
+
 status_t H2BGraphicBufferProducer::requestBuffer(int slot,
                                                  sp<GraphicBuffer>* bBuffer) {
+    if (isValidSlot(slot)) {
+        std::lock_guard lock(mSlotsMutex);
+        if (mSlots[slot]) {
+            *bBuffer = mSlots[slot];
+            return OK;
+        }
+    }
+
     bool converted{};
     status_t bStatus{};
     Return<void> transResult = mBase->requestBuffer(slot,
@@ -104,6 +130,10 @@ status_t H2BGraphicBufferProducer::requestBuffer(int slot,
         LOG(ERROR) << "requestBuffer: corrupted transaction.";
         return FAILED_TRANSACTION;
     }
+    if (bStatus == OK && *bBuffer && isValidSlot(slot)) {
+        std::lock_guard lock(mSlotsMutex);
+        mSlots[slot] = *bBuffer;
+    }
     return bStatus;
 }
 
@@ -173,6 +203,11 @@ status_t H2BGraphicBufferProducer::dequeueBuffer(
         LOG(ERROR) << "dequeueBuffer: corrupted transaction.";
         return FAILED_TRANSACTION;
     }
+    if (bStatus >= 0 && (bStatus & RELEASE_ALL_BUFFERS)) {
+        clearSlots();
+    } else if (bStatus >= 0 && (bStatus & BUFFER_NEEDS_REALLOCATION)) {
+        clearSlot(*slot);
+    }
     return bStatus;
 }
 
@@ -188,6 +223,9 @@ status_t H2BGraphicBufferProducer::detachBuffer(int slot) {
         LOG(ERROR) << "detachBuffer: corrupted transaction.";
         return FAILED_TRANSACTION;
     }
+    if (bStatus == OK) {
+        clearSlot(slot);
+    }
     return bStatus;
 }
 
@@ -243,6 +281,15 @@ status_t H2BGraphicBufferProducer::attachBuffer(
         LOG(ERROR) << "attachBuffer: corrupted transaction.";
         return FAILED_TRANSACTION;
     }
+    if (bStatus == IGraphicBufferProducer::RELEASE_ALL_BUFFERS) {
+        clearSlots();
+    }
+    if ((bStatus == OK || bStatus == IGraphicBufferProducer::RELEASE_ALL_BUFFERS) &&
+            isValidSlot(*outSlot)) {
+        // The slot holds the attached buffer, whose request is implicit.
+        std::lock_guard lock(mSlotsMutex);
+        mSlots[*outSlot] = buffer;
+    }
     return bStatus;
 }
 
@@ -351,6 +398,8 @@ status_t H2BGraphicBufferProducer::connect(
         LOG(ERROR) << "connect: corrupted transaction.";
         return FAILED_TRANSACTION;
     }
+    // The slots of a previous connection are stale.
+    clearSlots();
     return bStatus;
 
 }
@@ -364,6 +413,10 @@ status_t H2BGraphicBufferProducer::disconnect(int api, DisconnectMode mode) {
         return UNKNOWN_ERROR;
     }
 
+    // Even if the transaction fails, the buffers are not ours to return
+    // anymore.
+    clearSlots();
+
     status_t bStatus{};
     Return<HStatus> transResult = mBase->disconnect(hConnectionType);
     if (!transResult.isOk()) {
@@ -147,7 +147,8 @@ bool b2h(sp<BFence> const& from, HFenceWrapper* to) {
 
 bool h2b(native_handle_t const* from, sp<BFence>* to) {
     if (!from || from->numFds == 0) {
-        *to = new ::android::Fence();
+        // Most buffers are queued without a fence, which needs no allocation.
+        *to = BFence::NO_FENCE;
         return true;
     }
     if (from->numFds != 1 || from->numInts != 0) {
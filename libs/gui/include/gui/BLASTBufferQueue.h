@@ -129,6 +129,13 @@ public:
      */
     void setTransactionHangCallback(std::function<void(const std::string&)> callback);
 
+    /**
+     * Lets the queue lower the max dequeued buffer count below the count the producer asked for,
+     * while the producer doesn't need that many buffers, and free the surplus buffers. The count
+     * goes back up as soon as the producer waits for buffers. Off by default.
+     */
+    void setAdaptiveBufferCountEnabled(bool enabled);
+
     virtual ~BLASTBufferQueue();
 
 private:
@@ -46,6 +46,7 @@ using gui::VsyncEventData;
 
 namespace gui {
 class BitTube;
+class SharedVsyncChannel;
 } // namespace gui
 
 static inline constexpr uint32_t fourcc(char c1, char c2, char c3, char c4) {
@@ -187,9 +188,31 @@ public:
      */
     status_t getLatestVsyncEventData(ParcelableVsyncEventData* outVsyncEventData) const;
 
+    /*
+     * enableSharedVsyncChannel() moves the delivery of Event::VSync from the
+     * queue to a page shared with the other receivers, which SurfaceFlinger
+     * writes once per vsync instead of once per receiver. Other events are
+     * still read with getEvents. Returns NAME_NOT_FOUND if it isn't supported.
+     */
+    status_t enableSharedVsyncChannel();
+
+    /*
+     * getSharedVsyncFd returns the file descriptor to use to be woken up for
+     * vsync events once the shared vsync channel is enabled, or -1.
+     * OWNERSHIP IS RETAINED by DisplayEventReceiver.
+     */
+    int getSharedVsyncFd() const;
+
+    /*
+     * consumeSharedVsync returns true and the latest Event::VSync if one was
+     * delivered through the shared vsync channel since the last call.
+     */
+    bool consumeSharedVsync(Event* outEvent);
+
 private:
     sp<IDisplayEventConnection> mEventConnection;
     std::unique_ptr<gui::BitTube> mDataChannel;
+    std::unique_ptr<gui::SharedVsyncChannel> mSharedVsyncChannel;
     std::optional<status_t> mInitError;
 };
 
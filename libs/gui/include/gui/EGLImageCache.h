@@ -0,0 +1,136 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/stringprintf.h>
+
+#include <cinttypes>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace android {
+
+// A size-bounded cache of the images imported from GraphicBuffers, keyed by GraphicBuffer id, which
+// evicts the least recently used image when it is full.
+//
+// ImageRef is a reference counted pointer to the image, e.g. sp<> or std::shared_ptr<>, so that an
+// evicted image is only destroyed once its last user drops it. The cache only bounds the number of
+// images which are kept alive for reuse, not those which are still in use.
+//
+// The cache is not thread-safe, its owner must serialize the calls.
+template <typename ImageRef>
+class EGLImageCache {
+public:
+    struct Stats {
+        size_t size = 0;
+        size_t capacity = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    // A capacity of 0 disables the cache: it keeps no images, but still counts the misses.
+    explicit EGLImageCache(size_t capacity) : mCapacity(capacity) {}
+
+    EGLImageCache(const EGLImageCache&) = delete;
+    EGLImageCache& operator=(const EGLImageCache&) = delete;
+
+    // Returns the image of the buffer, and makes it the most recently used, or nullptr.
+    ImageRef get(uint64_t bufferId) {
+        const auto it = mImages.find(bufferId);
+        if (it == mImages.end()) {
+            mStats.misses++;
+            return nullptr;
+        }
+        mStats.hits++;
+        mLru.splice(mLru.begin(), mLru, it->second.lruPosition);
+        return it->second.image;
+    }
+
+    // Adds or replaces the image of the buffer, and makes it the most recently used. If the cache
+    // is full, the least recently used image is evicted.
+    void put(uint64_t bufferId, ImageRef image) {
+        if (mCapacity == 0) {
+            return;
+        }
+        if (const auto it = mImages.find(bufferId); it != mImages.end()) {
+            it->second.image = std::move(image);
+            mLru.splice(mLru.begin(), mLru, it->second.lruPosition);
+            return;
+        }
+        if (mImages.size() >= mCapacity) {
+            mImages.erase(mLru.back());
+            mLru.pop_back();
+            mStats.evictions++;
+        }
+        mLru.push_front(bufferId);
+        mImages.emplace(bufferId, Entry{std::move(image), mLru.begin()});
+    }
+
+    // Removes the image of the buffer, e.g. because the buffer is gone, and returns it. This is
+    // not counted as an eviction.
+    ImageRef erase(uint64_t bufferId) {
+        const auto it = mImages.find(bufferId);
+        if (it == mImages.end()) {
+            return nullptr;
+        }
+        ImageRef image = std::move(it->second.image);
+        mLru.erase(it->second.lruPosition);
+        mImages.erase(it);
+        return image;
+    }
+
+    void clear() {
+        mImages.clear();
+        mLru.clear();
+    }
+
+    Stats getStats() const {
+        Stats stats = mStats;
+        stats.size = mImages.size();
+        stats.capacity = mCapacity;
+        return stats;
+    }
+
+    void dump(std::string& result, const char* prefix) const {
+        const Stats stats = getStats();
+        base::StringAppendF(&result,
+                            "%sEGLImage cache: %zu/%zu images, %" PRIu64 " hits, %" PRIu64
+                            " misses, %" PRIu64 " evictions\n",
+                            prefix, stats.size, stats.capacity, stats.hits, stats.misses,
+                            stats.evictions);
+    }
+
+private:
+    struct Entry {
+        ImageRef image;
+        std::list<uint64_t>::iterator lruPosition;
+    };
+
+    const size_t mCapacity;
+
+    // The buffer ids, from the most to the least recently used.
+    std::list<uint64_t> mLru;
+    std::unordered_map<uint64_t, Entry> mImages;
+
+    Stats mStats;
+};
+
+} // namespace android
@@ -18,6 +18,7 @@
 #define ANDROID_GUI_FRAMETIMESTAMPS_H
 
 #include <android/gui/FrameEvent.h>
+#include <ftl/small_vector.h>
 
 #include <gui/CompositorTiming.h>
 #include <ui/FenceTime.h>
@@ -320,14 +321,24 @@ public:
     status_t unflatten(void const*& buffer, size_t& size, int const*& fds,
             size_t& count);
 
-    std::vector<FrameEventsDelta>::const_iterator begin() const;
-    std::vector<FrameEventsDelta>::const_iterator end() const;
+    // There is at most one delta per frame in the history, so the deltas of
+    // the default history size are stored inline, and a delta is made for
+    // each frame without allocating.
+    using Deltas = ftl::SmallVector<FrameEventsDelta, 8>;
+
+    Deltas::const_iterator begin() const;
+    Deltas::const_iterator end() const;
 
 private:
     static constexpr size_t minFlattenedSize();
 
-    std::vector<FrameEventsDelta> mDeltas;
+    Deltas mDeltas;
     CompositorTiming mCompositorTiming;
+
+    // The size of the consumer's history, so that the producer follows when
+    // it grows. Only the delta count is sent through Binder, which is at
+    // most that size.
+    size_t mHistorySize{0};
 };
 
 
@@ -35,6 +35,8 @@ namespace android {
 
 
 class String8;
+template <typename ImageRef>
+class EGLImageCache;
 
 /*
  * GLConsumer consumes buffers of graphics data from a BufferQueue,
@@ -348,6 +350,20 @@ private:
         Rect mCropRect;
     };
 
+    // getEglImage returns the EglImage of the buffer from the cache shared by
+    // all GLConsumers, or a new one, which is then cached. This way a buffer
+    // which comes back to a slot, e.g. after it was detached, or after its
+    // slot was freed, reuses its EGLImage instead of creating another one.
+    // A buffer is only ever acquired by one GLConsumer at a time, so each
+    // EglImage is still only used under the mutex of one GLConsumer.
+    static sp<EglImage> getEglImage(const sp<GraphicBuffer>& graphicBuffer);
+
+    // The cache used by getEglImage, with its size set by the
+    // ro.lib_gui.egl_image_cache_size property. It is disabled by default,
+    // since it keeps the buffers of the cached images alive.
+    // This method must be called with sEglImageCacheLock locked.
+    static EGLImageCache<sp<EglImage>>& getEglImageCacheLocked();
+
     // freeBufferLocked frees up the given buffer slot. If the slot has been
     // initialized this will release the reference to the GraphicBuffer in that
     // slot and destroy the EGLImage in that slot.  Otherwise it has no effect.
@@ -503,6 +519,9 @@ private:
     // protects static initialization
     static Mutex sStaticInitLock;
 
+    // protects the EglImage cache shared by all GLConsumers
+    static Mutex sEglImageCacheLock;
+
     // mReleasedTexImageBuffer is a buffer placeholder used when in single buffer
     // mode and releaseTexImage() has been called
     static sp<GraphicBuffer> sReleasedTexImageBuffer;
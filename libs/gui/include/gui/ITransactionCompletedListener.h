@@ -184,6 +184,25 @@ public:
     std::vector<SurfaceStats> surfaceStats;
 };
 
+// A buffer released outside of the transaction stats, e.g. because a newer buffer replaced it
+// before it was latched. It is handled as ITransactionCompletedListener::onReleaseBuffer would.
+class ReleasedBufferStats : public Parcelable {
+public:
+    status_t writeToParcel(Parcel* output) const override;
+    status_t readFromParcel(const Parcel* input) override;
+
+    ReleasedBufferStats() = default;
+    ReleasedBufferStats(const ReleaseCallbackId& callbackId, const sp<Fence>& releaseFence,
+                        uint32_t currentMaxAcquiredBufferCount)
+          : callbackId(callbackId),
+            releaseFence(releaseFence),
+            currentMaxAcquiredBufferCount(currentMaxAcquiredBufferCount) {}
+
+    ReleaseCallbackId callbackId;
+    sp<Fence> releaseFence;
+    uint32_t currentMaxAcquiredBufferCount = 0;
+};
+
 class ListenerStats : public Parcelable {
 public:
     status_t writeToParcel(Parcel* output) const override;
@@ -195,6 +214,9 @@ public:
 
     sp<IBinder> listener;
     std::vector<TransactionStats> transactionStats;
+    // Released with the same call instead of one onReleaseBuffer call each. They are handled
+    // before transactionStats.
+    std::vector<ReleasedBufferStats> releasedBuffers;
 };
 
 class ITransactionCompletedListener : public IInterface {
@@ -209,6 +231,11 @@ public:
     virtual void onTransactionQueueStalled(const String8& name) = 0;
 
     virtual void onTrustedPresentationChanged(int id, bool inTrustedPresentationState) = 0;
+
+    // SurfaceFlinger evicted the buffer with this cache id of the process from its cache. The
+    // process must uncache it, which SurfaceFlinger waits for to drop the buffer, and send it
+    // again the next time it is used.
+    virtual void onBufferEvicted(uint64_t cacheId) = 0;
 };
 
 class BnTransactionCompletedListener : public SafeBnInterface<ITransactionCompletedListener> {
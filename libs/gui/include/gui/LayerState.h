@@ -221,6 +221,15 @@ struct layer_state_t {
     layer_state_t();
 
     void merge(const layer_state_t& other);
+    // Like the above, but moves the regions, buffers and handles out of other
+    // instead of copying them.
+    void merge(layer_state_t&& other);
+
+    // Starts the parcels in which only the fields of changed properties follow, after a mask of
+    // those properties. read() takes a parcel without it to hold every field, as parcels did
+    // before. It can't be the start of a strong binder, which is where those parcels start.
+    static constexpr int32_t kFieldMaskParcelTag = 0x4c53464d; // 'LSFM'
+
     status_t write(Parcel& output) const;
     status_t read(const Parcel& input);
     // Compares two layer_state_t structs and returns a set of change flags describing all the
@@ -410,6 +419,10 @@ struct layer_state_t {
 
     TrustedPresentationThresholds trustedPresentationThresholds;
     TrustedPresentationListener trustedPresentationListener;
+
+private:
+    template <typename LayerState>
+    void mergeFrom(LayerState&& other);
 };
 
 class ComposerState {
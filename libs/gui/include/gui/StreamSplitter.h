@@ -24,6 +24,9 @@
 #include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
 #include <utils/StrongPointer.h>
+#include <utils/Timers.h>
+
+#include <vector>
 
 namespace android {
 
@@ -39,6 +42,34 @@ class IGraphicBufferProducer;
 // again only once all of the outputs have released it.
 class StreamSplitter : public BnConsumerListener {
 public:
+    // DropPolicy is what the splitter does when an output has as many
+    // outstanding buffers as it allows.
+    enum class DropPolicy {
+        // The splitter stops acquiring buffers from the input until the output
+        // releases one, which holds back the input and all of the other
+        // outputs.
+        Block,
+        // The splitter skips the output for the buffers queued to the input in
+        // the meantime, so only the output misses frames.
+        Drop,
+    };
+
+    struct OutputConfig {
+        // The maximum number of buffers queued to, or acquired from, the
+        // output at a time.
+        int maxOutstandingBuffers = MAX_OUTSTANDING_BUFFERS;
+        DropPolicy dropPolicy = DropPolicy::Block;
+    };
+
+    struct OutputStats {
+        uint64_t queuedBuffers = 0;
+        uint64_t droppedBuffers = 0;
+        // The time from queueing a buffer to the output until the output
+        // released it, over the buffers it released.
+        nsecs_t averageLatency = 0;
+        nsecs_t maxLatency = 0;
+    };
+
     // createSplitter creates a new splitter, outSplitter, using inputQueue as
     // the input BufferQueue. Output BufferQueues must be added using addOutput
     // before queueing any buffers to the input.
@@ -63,6 +94,20 @@ public:
     // of other error codes.
     status_t addOutput(const sp<IGraphicBufferProducer>& outputQueue);
 
+    // Same as above, but the output has its own maximum number of outstanding
+    // buffers and policy for when it reaches it. E.g. an output whose consumer
+    // may stall, such as an encoder, can use DropPolicy::Drop so that it does
+    // not hold back the other outputs. BAD_VALUE is also returned if the
+    // maximum number of outstanding buffers is less than 1.
+    status_t addOutput(const sp<IGraphicBufferProducer>& outputQueue,
+            const OutputConfig& config);
+
+    // getOutputStats returns the buffer counts and latencies of an output.
+    // BAD_VALUE is returned if outputQueue is not an output of the splitter or
+    // if outStats is NULL.
+    status_t getOutputStats(const sp<IGraphicBufferProducer>& outputQueue,
+            OutputStats* outStats);
+
     // setName sets the consumer name of the input queue
     void setName(const String8& name);
 
@@ -104,6 +149,12 @@ private:
     // acquire. This must be called with mMutex locked.
     void onAbandonedLocked();
 
+    // Returns whether onFrameAvailable must wait before acquiring another
+    // buffer, because there are too many outstanding buffers, or because an
+    // output which blocks has as many as it allows.
+    // This must be called with mMutex locked.
+    bool mustWaitLocked() const;
+
     // This is a thin wrapper class that lets us determine which BufferQueue
     // the IProducerListener::onBufferReleased callback is associated with. We
     // create one of these per output BufferQueue, and then pass the producer
@@ -138,6 +189,11 @@ private:
         // Returns the new value
         // Only called while mMutex is held
         size_t incrementReleaseCountLocked() { return ++mReleaseCount; }
+        size_t getReleaseCountLocked() const { return mReleaseCount; }
+
+        // The time when the buffer was queued to the outputs
+        nsecs_t getQueueTime() const { return mQueueTime; }
+        void setQueueTime(nsecs_t queueTime) { mQueueTime = queueTime; }
 
     private:
         // Only destroy through LightRefBase
@@ -151,6 +207,19 @@ private:
         sp<GraphicBuffer> mBuffer; // One instance that holds this native handle
         sp<Fence> mMergedFence;
         size_t mReleaseCount;
+        nsecs_t mQueueTime;
+    };
+
+    struct Output {
+        sp<IGraphicBufferProducer> producer;
+        OutputConfig config;
+
+        // The buffers queued to the output which it hasn't released yet
+        int outstandingBuffers = 0;
+
+        OutputStats stats;
+        uint64_t releasedBuffers = 0;
+        nsecs_t totalLatency = 0;
     };
 
     // Only called from createSplitter
@@ -161,6 +230,15 @@ private:
 
     static const int MAX_OUTSTANDING_BUFFERS = 2;
 
+    // Returns the output whose producer is outputQueue, or nullptr.
+    // This must be called with mMutex locked.
+    Output* findOutputLocked(const sp<IGraphicBufferProducer>& outputQueue);
+
+    // Attaches and releases a buffer which all of the outputs have released
+    // back to the input, and allows a blocked onFrameAvailable to proceed.
+    // This must be called with mMutex locked.
+    void releaseToInputLocked(const sp<BufferTracker>& tracker);
+
     // mIsAbandoned is set to true when an output dies. Once the StreamSplitter
     // has been abandoned, it will continue to detach buffers from other
     // outputs, but it will disconnect from the input and not attempt to
@@ -170,8 +248,14 @@ private:
     Mutex mMutex;
     Condition mReleaseCondition;
     int mOutstandingBuffers;
+
+    // The outstanding buffers after which onFrameAvailable waits: the most
+    // that an output which blocks allows, plus what each output which drops
+    // allows, so that outputs which drop never hold back the others.
+    int mMaxOutstandingBuffers;
+
     sp<IGraphicBufferConsumer> mInput;
-    Vector<sp<IGraphicBufferProducer> > mOutputs;
+    std::vector<Output> mOutputs;
 
     // Map of GraphicBuffer IDs (GraphicBuffer::getId()) to buffer tracking
     // objects (which are mostly for counting how many outputs have released the
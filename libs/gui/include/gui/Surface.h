@@ -302,6 +302,8 @@ private:
     int dispatchGetLastQueuedBuffer(va_list args);
     int dispatchGetLastQueuedBuffer2(va_list args);
     int dispatchSetFrameTimelineInfo(va_list args);
+    int dispatchDequeueBuffers(va_list args);
+    int dispatchCancelBuffers(va_list args);
 
     std::mutex mNameMutex;
     std::string mName;
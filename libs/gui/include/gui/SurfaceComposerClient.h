@@ -972,6 +972,8 @@ public:
 
     void onTrustedPresentationChanged(int id, bool presentedWithinThresholds) override;
 
+    void onBufferEvicted(uint64_t cacheId) override;
+
 private:
     ReleaseBufferCallback popReleaseBufferCallbackLocked(const ReleaseCallbackId&) REQUIRES(mMutex);
     static sp<TransactionCompletedListener> sInstance;
@@ -20,6 +20,9 @@
 #include <gui/DisplayInfo.h>
 #include <gui/WindowInfo.h>
 
+#include <optional>
+#include <unordered_set>
+
 namespace android::gui {
 
 struct WindowInfosUpdate : public Parcelable {
@@ -37,6 +40,31 @@ struct WindowInfosUpdate : public Parcelable {
     int64_t vsyncId;
     int64_t timestamp;
 
+    // Identifies the updates sent to a listener, for deltas. Updates which weren't sent yet have
+    // none (-1).
+    int64_t generation = -1;
+
+    // The generation of the update which this delta applies to, or -1 for a full update. A delta
+    // only has the windows which were added or changed since then in windowInfos, and the ids of
+    // all its windows in windowIds, in order. The windows which aren't in windowInfos are
+    // unchanged, and those which aren't in windowIds were removed. displayInfos is always full.
+    int64_t baseGeneration = -1;
+    std::vector<int32_t> windowIds;
+
+    bool isDelta() const { return baseGeneration >= 0; }
+
+    // Returns a delta which turns the full update base into this full update, or nullopt if it
+    // wouldn't be smaller than this update. Windows must have unique ids. If changedWindowIds is
+    // given, only the windows it holds are compared, and the others which are in base are assumed
+    // unchanged.
+    std::optional<WindowInfosUpdate> makeDelta(
+            const WindowInfosUpdate& base,
+            const std::unordered_set<int32_t>* changedWindowIds = nullptr) const;
+
+    // Returns the full update made by applying delta to this full update, or nullopt if delta
+    // doesn't apply to it, e.g. because an update in between was missed.
+    std::optional<WindowInfosUpdate> applyDelta(const WindowInfosUpdate& delta) const;
+
     status_t writeToParcel(android::Parcel*) const override;
     status_t readFromParcel(const android::Parcel*) override;
 };
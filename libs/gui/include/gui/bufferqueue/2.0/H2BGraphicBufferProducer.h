@@ -17,11 +17,15 @@
 #ifndef ANDROID_HARDWARE_GRAPHICS_BUFFERQUEUE_V2_0_H2BGRAPHICBUFFERPRODUCER_H
 #define ANDROID_HARDWARE_GRAPHICS_BUFFERQUEUE_V2_0_H2BGRAPHICBUFFERPRODUCER_H
 
+#include <gui/BufferQueueDefs.h>
 #include <gui/IGraphicBufferProducer.h>
 #include <gui/IProducerListener.h>
 #include <hidl/HybridInterface.h>
 #include <ui/Fence.h>
 
+#include <array>
+#include <mutex>
+
 #include <android/hardware/graphics/bufferqueue/2.0/IGraphicBufferProducer.h>
 
 namespace android {
@@ -95,6 +99,17 @@ struct H2BGraphicBufferProducer
     virtual void getFrameTimestamps(FrameEventHistoryDelta* outDelta) override;
     virtual status_t getUniqueId(uint64_t* outId) const override;
     virtual status_t getConsumerUsage(uint64_t* outUsage) const override;
+
+private:
+    void clearSlot(int slot);
+    void clearSlots();
+
+    // The buffers which requestBuffer returned, by slot. BufferQueue reports
+    // BUFFER_NEEDS_REALLOCATION whenever the buffer of a slot changed, so
+    // until then, requesting the buffer of the slot again needs neither a
+    // transaction nor importing its handle again. Guarded by mSlotsMutex.
+    std::mutex mSlotsMutex;
+    std::array<sp<GraphicBuffer>, BufferQueueDefs::NUM_BUFFER_SLOTS> mSlots;
 };
 
 }  // namespace utils
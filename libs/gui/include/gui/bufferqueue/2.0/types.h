@@ -70,7 +70,8 @@ protected:
 // Does not clone the fd---only copy the fd. The returned HFenceWrapper should
 // not outlive the input Fence object.
 bool b2h(sp<BFence> const& from, HFenceWrapper* to);
-// Clones the fd and puts it in a new Fence object.
+// Clones the fd and puts it in a new Fence object, or returns
+// BFence::NO_FENCE if there is no fd.
 bool h2b(native_handle_t const* from, sp<BFence>* to);
 
 // ConnectionType
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/Timers.h>
+
+#include <cstdint>
+
+namespace android::gui {
+
+// Picks the max dequeued buffer count of a producer, between 1 and the count the producer asked
+// for, from how many buffers the producer actually has in flight.
+//
+// The count is lowered by one after a window of frames in which the producer never waited in
+// dequeueBuffer and never held as many buffers as the count allows, and down to what the producer
+// holds after it was idle. It is raised by one whenever a dequeue waits for the consumer, and to
+// the requested count right away whenever the producer is about to dequeue more buffers than the
+// count allows, since such a dequeue would block forever. Each raise doubles the number of clean
+// windows which the next lowering needs, so that a producer which needs its buffers only now and
+// then doesn't keep losing them.
+//
+// Not thread safe.
+class AdaptiveBufferCount {
+public:
+    // A dequeue which doesn't allocate, and takes longer than this, waited for the consumer to
+    // release a buffer.
+    static constexpr nsecs_t kBlockedDequeueDuration = ms2ns(2);
+    static constexpr uint32_t kWindowFrames = 120;
+    static constexpr uint32_t kMaxCleanWindows = 16;
+    // A gap this long between two frames means that the producer was idle.
+    static constexpr nsecs_t kIdleDuration = s2ns(1);
+
+    explicit AdaptiveBufferCount(int requestedCount) { setRequestedCount(requestedCount); }
+
+    // Starts over from the requested count.
+    void setRequestedCount(int requestedCount);
+
+    int getRequestedCount() const { return mRequestedCount; }
+    int getCount() const { return mCount; }
+
+    // Each of the following returns whether the count changed.
+
+    // Before a dequeue, while the producer holds dequeuedCount buffers.
+    bool onDequeueStarted(int dequeuedCount);
+    // After a dequeue, which allocated a buffer if allocated is set.
+    bool onDequeueFinished(int dequeuedCount, nsecs_t duration, bool allocated);
+    // After a queue, at now, while the producer holds dequeuedCount buffers.
+    bool onQueued(int dequeuedCount, nsecs_t now);
+
+private:
+    bool setCount(int count);
+    void startWindow();
+
+    int mRequestedCount = 1;
+    int mCount = 1;
+
+    // The current window.
+    uint32_t mFrames = 0;
+    int mPeakDequeuedCount = 0;
+    bool mBlocked = false;
+
+    uint32_t mCleanWindows = 0;
+    uint32_t mRequiredCleanWindows = 1;
+    nsecs_t mLastQueueTime = -1;
+};
+
+} // namespace android::gui
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+#include <binder/Parcelable.h>
+#include <gui/VsyncEventData.h>
+#include <ui/DisplayId.h>
+#include <utils/Errors.h>
+#include <utils/Timers.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace android {
+
+class Parcel;
+
+namespace gui {
+
+// A vsync channel which replaces the VSYNC events of a DisplayEventConnection's BitTube.
+//
+// The latest vsync is published once to a page which is shared by all connections of an
+// EventThread, and the connections which requested it are only woken up through their own
+// eventfd. The page is protected by a seqlock, since its writer must never wait for readers.
+//
+// Like BitTube, the same class is used on both ends: SurfaceFlinger creates the writer with
+// create(), and hands a reader to each connection with makeReader().
+class SharedVsyncChannel : public Parcelable {
+public:
+    struct Vsync {
+        nsecs_t timestamp = 0;
+        PhysicalDisplayId displayId;
+        uint32_t count = 0;
+        VsyncEventData vsyncData = {};
+    };
+
+    // creates an uninitialized SharedVsyncChannel (to unparcel into)
+    SharedVsyncChannel() = default;
+    ~SharedVsyncChannel() override;
+
+    SharedVsyncChannel(const SharedVsyncChannel&) = delete;
+    SharedVsyncChannel& operator=(const SharedVsyncChannel&) = delete;
+
+    // Creates the writer end, with a new page. Returns nullptr if the page can't be made read-only
+    // for the readers.
+    static std::unique_ptr<SharedVsyncChannel> create();
+
+    // Makes the reader end for one connection, and returns the send end of its wake up fd.
+    status_t makeReader(SharedVsyncChannel* outReader, base::unique_fd* outWakeFd) const;
+
+    // Writer: replaces the contents of the page.
+    void publish(const Vsync& vsync);
+
+    // Writer: wakes up the reader of wakeFd, after the vsync it should read has been published.
+    static status_t wake(int wakeFd);
+
+    // Reader: returns true and the latest vsync if this reader has been woken up since the last
+    // call, or false.
+    bool consume(Vsync* outVsync);
+
+    // Reader: the fd to poll for wake ups.
+    int getFd() const;
+
+    // implement the Parcelable protocol. Only readers can be parcelled.
+    status_t writeToParcel(Parcel* parcel) const override;
+    status_t readFromParcel(const Parcel* parcel) override;
+
+private:
+    struct Page {
+        // odd while the writer is updating vsync
+        std::atomic<uint32_t> sequence;
+        Vsync vsync;
+    };
+    static_assert(std::is_trivially_copyable_v<Vsync>);
+
+    status_t map(int prot);
+    void read(Vsync* outVsync) const;
+
+    base::unique_fd mPageFd;
+    base::unique_fd mWakeFd;
+    Page* mPage = nullptr;
+};
+
+} // namespace gui
+} // namespace android
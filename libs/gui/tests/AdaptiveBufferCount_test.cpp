@@ -0,0 +1,126 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <private/gui/AdaptiveBufferCount.h>
+
+namespace android::gui {
+
+class AdaptiveBufferCountTest : public ::testing::Test {
+protected:
+    static constexpr nsecs_t kFrameDuration = ms2ns(16);
+
+    // Renders a window of frames, each of which dequeues one buffer without waiting.
+    void renderWindow(AdaptiveBufferCount& count) {
+        for (uint32_t i = 0; i < AdaptiveBufferCount::kWindowFrames; i++) {
+            renderFrame(count, 0);
+        }
+    }
+
+    bool renderFrame(AdaptiveBufferCount& count, nsecs_t dequeueDuration) {
+        bool changed = count.onDequeueStarted(0);
+        changed |= count.onDequeueFinished(1, dequeueDuration, false /*allocated*/);
+        mTime += kFrameDuration;
+        changed |= count.onQueued(0, mTime);
+        return changed;
+    }
+
+    nsecs_t mTime = 0;
+};
+
+TEST_F(AdaptiveBufferCountTest, LowersAfterCleanWindows) {
+    AdaptiveBufferCount count(3);
+    EXPECT_EQ(3, count.getCount());
+
+    renderWindow(count);
+    EXPECT_EQ(2, count.getCount());
+    renderWindow(count);
+    EXPECT_EQ(1, count.getCount());
+    renderWindow(count);
+    EXPECT_EQ(1, count.getCount());
+}
+
+TEST_F(AdaptiveBufferCountTest, RaisesWhenDequeueWaits) {
+    AdaptiveBufferCount count(3);
+    renderWindow(count);
+    renderWindow(count);
+    ASSERT_EQ(1, count.getCount());
+
+    EXPECT_TRUE(renderFrame(count, AdaptiveBufferCount::kBlockedDequeueDuration));
+    EXPECT_EQ(2, count.getCount());
+
+    // The next lowering needs twice as many clean windows.
+    renderWindow(count);
+    EXPECT_EQ(2, count.getCount());
+    renderWindow(count);
+    EXPECT_EQ(1, count.getCount());
+}
+
+TEST_F(AdaptiveBufferCountTest, AllocationsAreNotWaits) {
+    AdaptiveBufferCount count(3);
+    renderWindow(count);
+    renderWindow(count);
+    ASSERT_EQ(1, count.getCount());
+
+    EXPECT_FALSE(count.onDequeueFinished(1, ms2ns(10), true /*allocated*/));
+    EXPECT_EQ(1, count.getCount());
+}
+
+TEST_F(AdaptiveBufferCountTest, RaisesToTheRequestedCountBeforeExceedingTheCount) {
+    AdaptiveBufferCount count(3);
+    renderWindow(count);
+    renderWindow(count);
+    ASSERT_EQ(1, count.getCount());
+
+    // The producer holds one buffer and asks for another, which would block forever.
+    EXPECT_TRUE(count.onDequeueStarted(1));
+    EXPECT_EQ(3, count.getCount());
+}
+
+TEST_F(AdaptiveBufferCountTest, KeepsWhatTheProducerHolds) {
+    // The producer renders into two buffers at once.
+    AdaptiveBufferCount count(3);
+    for (int window = 0; window < 3; window++) {
+        for (uint32_t i = 0; i < AdaptiveBufferCount::kWindowFrames; i++) {
+            count.onDequeueStarted(1);
+            count.onDequeueFinished(2, 0, false /*allocated*/);
+            mTime += kFrameDuration;
+            count.onQueued(1, mTime);
+        }
+        EXPECT_EQ(2, count.getCount());
+    }
+}
+
+TEST_F(AdaptiveBufferCountTest, LowersAfterIdle) {
+    AdaptiveBufferCount count(3);
+    renderFrame(count, 0);
+    mTime += AdaptiveBufferCount::kIdleDuration;
+    EXPECT_TRUE(renderFrame(count, 0));
+    EXPECT_EQ(1, count.getCount());
+}
+
+TEST_F(AdaptiveBufferCountTest, SetRequestedCountStartsOver) {
+    AdaptiveBufferCount count(3);
+    renderWindow(count);
+    renderWindow(count);
+    ASSERT_EQ(1, count.getCount());
+
+    count.setRequestedCount(2);
+    EXPECT_EQ(2, count.getRequestedCount());
+    EXPECT_EQ(2, count.getCount());
+}
+
+} // namespace android::gui
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MockConsumer.h"
+
+#include <benchmark/benchmark.h>
+#include <gui/BufferItem.h>
+#include <gui/BufferQueue.h>
+#include <gui/bufferqueue/2.0/B2HGraphicBufferProducer.h>
+#include <gui/bufferqueue/2.0/H2BGraphicBufferProducer.h>
+#include <log/log.h>
+#include <system/window.h>
+
+// Usage: atest libgui_bufferqueue_bridge_benchmark
+//
+// Measures the frames a producer passes to its consumer through a
+// BufferQueue, either directly, or through the HIDL converters which media
+// codecs go through: H2BGraphicBufferProducer on the producer side, and
+// B2HGraphicBufferProducer on the side of the BufferQueue. Both are in the
+// process, so only the conversions are measured, not the transport.
+
+namespace android {
+
+namespace {
+
+using hardware::graphics::bufferqueue::V2_0::utils::B2HGraphicBufferProducer;
+using hardware::graphics::bufferqueue::V2_0::utils::H2BGraphicBufferProducer;
+
+constexpr uint32_t kWidth = 1920;
+constexpr uint32_t kHeight = 1080;
+constexpr PixelFormat kFormat = PIXEL_FORMAT_RGBA_8888;
+constexpr uint64_t kUsage = GRALLOC_USAGE_SW_READ_OFTEN;
+
+// Passes frames through a BufferQueue, requesting the buffer of each frame,
+// as a producer without its own table of slots does.
+void BM_QueueFrame(benchmark::State& state) {
+    const bool bridged = state.range(0) != 0;
+
+    sp<IGraphicBufferProducer> bufferQueueProducer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&bufferQueueProducer, &consumer);
+    consumer->consumerConnect(sp<MockConsumer>::make(), false);
+    sp<IGraphicBufferProducer> producer = bufferQueueProducer;
+    if (bridged) {
+        producer = sp<H2BGraphicBufferProducer>::make(
+                sp<B2HGraphicBufferProducer>::make(bufferQueueProducer));
+    }
+    IGraphicBufferProducer::QueueBufferOutput output;
+    LOG_ALWAYS_FATAL_IF(producer->connect(nullptr, NATIVE_WINDOW_API_MEDIA, false, &output) != OK,
+                        "Failed to connect the producer");
+
+    const IGraphicBufferProducer::QueueBufferInput input(0, false, HAL_DATASPACE_UNKNOWN,
+                                                         Rect(kWidth, kHeight),
+                                                         NATIVE_WINDOW_SCALING_MODE_FREEZE, 0,
+                                                         Fence::NO_FENCE);
+    for (auto _ : state) {
+        int slot;
+        sp<Fence> fence;
+        uint64_t age;
+        const status_t status = producer->dequeueBuffer(&slot, &fence, kWidth, kHeight, kFormat,
+                                                        kUsage, &age, nullptr);
+        LOG_ALWAYS_FATAL_IF(status < 0, "Failed to dequeue a buffer: %d", status);
+        sp<GraphicBuffer> buffer;
+        producer->requestBuffer(slot, &buffer);
+        producer->queueBuffer(slot, input, &output);
+
+        BufferItem item;
+        consumer->acquireBuffer(&item, 0);
+        consumer->releaseBuffer(item.mSlot, item.mFrameNumber, EGL_NO_DISPLAY, EGL_NO_SYNC_KHR,
+                                Fence::NO_FENCE);
+    }
+    state.SetItemsProcessed(state.iterations());
+    producer->disconnect(NATIVE_WINDOW_API_MEDIA);
+}
+BENCHMARK(BM_QueueFrame)->ArgName("bridged")->Arg(0)->Arg(1);
+
+} // namespace
+} // namespace android
+
+int main(int argc, char** argv) {
+    ::benchmark::Initialize(&argc, argv);
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    ::benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -25,6 +25,8 @@
 #include <gui/BufferQueue.h>
 #include <gui/IProducerListener.h>
 #include <gui/Surface.h>
+#include <gui/bufferqueue/2.0/B2HGraphicBufferProducer.h>
+#include <gui/bufferqueue/2.0/H2BGraphicBufferProducer.h>
 
 #include <ui/GraphicBuffer.h>
 
@@ -1335,6 +1337,40 @@ TEST_F(BufferQueueTest, TestProducerConnectDisconnect) {
     ASSERT_EQ(NO_INIT, mProducer->disconnect(NATIVE_WINDOW_API_CPU));
 }
 
+TEST_F(BufferQueueTest, HidlBridgedProducerReusesTheBufferOfASlot) {
+    using hardware::graphics::bufferqueue::V2_0::utils::B2HGraphicBufferProducer;
+    using hardware::graphics::bufferqueue::V2_0::utils::H2BGraphicBufferProducer;
+
+    createBufferQueue();
+    sp<MockConsumer> mc(new MockConsumer);
+    ASSERT_EQ(OK, mConsumer->consumerConnect(mc, false));
+    sp<IGraphicBufferProducer> producer =
+            sp<H2BGraphicBufferProducer>::make(sp<B2HGraphicBufferProducer>::make(mProducer));
+    IGraphicBufferProducer::QueueBufferOutput output;
+    ASSERT_EQ(OK, producer->connect(nullptr, NATIVE_WINDOW_API_CPU, false, &output));
+
+    int slot;
+    sp<Fence> fence;
+    uint64_t age;
+    sp<GraphicBuffer> buffer;
+    sp<GraphicBuffer> again;
+    ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+              producer->dequeueBuffer(&slot, &fence, 1, 1, 0, GRALLOC_USAGE_SW_READ_OFTEN, &age,
+                                      nullptr));
+    ASSERT_EQ(OK, producer->requestBuffer(slot, &buffer));
+    ASSERT_EQ(OK, producer->requestBuffer(slot, &again));
+    EXPECT_EQ(buffer, again);
+    ASSERT_EQ(OK, producer->cancelBuffer(slot, Fence::NO_FENCE));
+
+    // A buffer of another size reallocates the slot, whose buffer is requested again.
+    ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+              producer->dequeueBuffer(&slot, &fence, 2, 2, 0, GRALLOC_USAGE_SW_READ_OFTEN, &age,
+                                      nullptr));
+    ASSERT_EQ(OK, producer->requestBuffer(slot, &again));
+    EXPECT_NE(buffer, again);
+    EXPECT_EQ(2u, again->getWidth());
+}
+
 TEST_F(BufferQueueTest, TestBqSetFrameRateFlagBuildTimeIsSet) {
     ASSERT_EQ(flags::bq_setframerate(), COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_SETFRAMERATE));
 }
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <gui/EGLImageCache.h>
+
+#include <memory>
+
+namespace android {
+
+namespace test {
+
+using Cache = EGLImageCache<std::shared_ptr<int>>;
+
+TEST(EGLImageCacheTest, returnsCachedImages) {
+    Cache cache(2);
+    EXPECT_EQ(nullptr, cache.get(1));
+
+    auto image = std::make_shared<int>(1);
+    cache.put(1, image);
+    EXPECT_EQ(image, cache.get(1));
+
+    const auto stats = cache.getStats();
+    EXPECT_EQ(1u, stats.size);
+    EXPECT_EQ(2u, stats.capacity);
+    EXPECT_EQ(1u, stats.hits);
+    EXPECT_EQ(1u, stats.misses);
+    EXPECT_EQ(0u, stats.evictions);
+}
+
+TEST(EGLImageCacheTest, evictsLeastRecentlyUsedImage) {
+    Cache cache(2);
+    cache.put(1, std::make_shared<int>(1));
+    cache.put(2, std::make_shared<int>(2));
+    ASSERT_NE(nullptr, cache.get(1));
+
+    std::weak_ptr<int> evicted = cache.get(2);
+    auto inUse = cache.get(1);
+    cache.put(3, std::make_shared<int>(3));
+
+    EXPECT_EQ(nullptr, cache.get(2));
+    EXPECT_TRUE(evicted.expired());
+    EXPECT_EQ(inUse, cache.get(1));
+    EXPECT_NE(nullptr, cache.get(3));
+    EXPECT_EQ(1u, cache.getStats().evictions);
+}
+
+TEST(EGLImageCacheTest, keepsEvictedImagesWhichAreInUse) {
+    Cache cache(1);
+    auto image = std::make_shared<int>(1);
+    cache.put(1, image);
+    cache.put(2, std::make_shared<int>(2));
+
+    EXPECT_EQ(nullptr, cache.get(1));
+    EXPECT_EQ(1, image.use_count());
+    EXPECT_EQ(1, *image);
+}
+
+TEST(EGLImageCacheTest, eraseIsNotAnEviction) {
+    Cache cache(2);
+    auto image = std::make_shared<int>(1);
+    cache.put(1, image);
+
+    EXPECT_EQ(image, cache.erase(1));
+    EXPECT_EQ(nullptr, cache.erase(1));
+    EXPECT_EQ(nullptr, cache.get(1));
+
+    const auto stats = cache.getStats();
+    EXPECT_EQ(0u, stats.size);
+    EXPECT_EQ(0u, stats.evictions);
+}
+
+TEST(EGLImageCacheTest, zeroCapacityDisablesCache) {
+    Cache cache(0);
+    cache.put(1, std::make_shared<int>(1));
+
+    EXPECT_EQ(nullptr, cache.get(1));
+    EXPECT_EQ(0u, cache.getStats().size);
+    EXPECT_EQ(1u, cache.getStats().misses);
+}
+
+} // namespace test
+} // namespace android
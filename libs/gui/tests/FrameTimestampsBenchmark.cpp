@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+#include <gui/FrameTimestamps.h>
+
+#include <malloc.h>
+#include <vector>
+
+// Usage: atest libgui_frame_timestamps_benchmark
+//
+// Measures the frame timestamps of one frame, the way a Surface and its
+// consumer exchange them on each queueBuffer: the consumer records the
+// events of a frame and makes a delta, which is parceled and applied by the
+// producer. Next to the time, the heap allocations ("allocs") of one frame
+// are reported, which should stay at 0.
+
+namespace android {
+
+namespace {
+
+// Only allocations of the benchmark thread are counted, and only while it is
+// running the operation, not the benchmark itself.
+thread_local bool tCounting = false;
+thread_local size_t tAllocations = 0;
+
+const decltype(__malloc_hook) orig_malloc_hook = __malloc_hook;
+const decltype(__realloc_hook) orig_realloc_hook = __realloc_hook;
+
+void* counting_malloc_hook(size_t bytes, const void* arg) {
+    if (tCounting) tAllocations++;
+    return orig_malloc_hook(bytes, arg);
+}
+
+void* counting_realloc_hook(void* ptr, size_t bytes, const void* arg) {
+    if (tCounting) tAllocations++;
+    return orig_realloc_hook(ptr, bytes, arg);
+}
+
+// What happens to a frame on the consumer side until it is released, two
+// frames later.
+void addFrameEvents(ConsumerFrameEventHistory& history, uint64_t frameNumber) {
+    const nsecs_t time = static_cast<nsecs_t>(frameNumber) * 8'333'333;
+    history.addQueue({frameNumber, time, time, FenceTime::NO_FENCE});
+    history.addLatch(frameNumber, time + 1);
+    history.addPreComposition(frameNumber, time + 2);
+    history.addPostComposition(frameNumber, FenceTime::NO_FENCE, FenceTime::NO_FENCE, {});
+    if (frameNumber > 2) {
+        history.addRelease(frameNumber - 2, time + 3,
+                          std::shared_ptr<FenceTime>(FenceTime::NO_FENCE));
+    }
+}
+
+void BM_GetAndResetDelta(benchmark::State& state) {
+    ConsumerFrameEventHistory history;
+    uint64_t frameNumber = 1;
+    tAllocations = 0;
+    for (auto _ : state) {
+        tCounting = true;
+        addFrameEvents(history, frameNumber++);
+        FrameEventHistoryDelta delta;
+        history.getAndResetDelta(&delta);
+        benchmark::DoNotOptimize(delta);
+        tCounting = false;
+    }
+    state.counters["allocs"] = benchmark::Counter(tAllocations, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_GetAndResetDelta);
+
+// The whole exchange, with range(0) frames per delta, e.g. when a producer
+// only asks for timestamps every few frames.
+void BM_FrameTimestampsRoundTrip(benchmark::State& state) {
+    ConsumerFrameEventHistory consumer;
+    ProducerFrameEventHistory producer;
+    std::vector<uint8_t> buffer(4096);
+    std::vector<int> fds(64);
+    uint64_t frameNumber = 1;
+    tAllocations = 0;
+    for (auto _ : state) {
+        tCounting = true;
+        for (int64_t i = 0; i < state.range(0); i++) {
+            addFrameEvents(consumer, frameNumber++);
+        }
+        FrameEventHistoryDelta delta;
+        consumer.getAndResetDelta(&delta);
+
+        void* data = buffer.data();
+        size_t size = buffer.size();
+        int* fdData = fds.data();
+        size_t fdCount = fds.size();
+        CHECK(delta.flatten(data, size, fdData, fdCount) == NO_ERROR);
+
+        const void* constData = buffer.data();
+        size = buffer.size();
+        const int* constFdData = fds.data();
+        fdCount = fds.size();
+        FrameEventHistoryDelta received;
+        CHECK(received.unflatten(constData, size, constFdData, fdCount) == NO_ERROR);
+        producer.applyDelta(received);
+        tCounting = false;
+    }
+    state.counters["allocs"] = benchmark::Counter(tAllocations, benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FrameTimestampsRoundTrip)->Arg(1)->Arg(4);
+
+} // namespace
+} // namespace android
+
+int main(int argc, char** argv) {
+    if (getenv("LIBC_HOOKS_ENABLE") == nullptr) {
+        CHECK(0 == setenv("LIBC_HOOKS_ENABLE", "1", true /*overwrite*/));
+        execv(argv[0], argv);
+        return 1;
+    }
+    __malloc_hook = android::counting_malloc_hook;
+    __realloc_hook = android::counting_realloc_hook;
+
+    ::benchmark::Initialize(&argc, argv);
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    ::benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <binder/Parcel.h>
+
+#include <gui/LayerState.h>
+
+namespace android {
+
+namespace test {
+
+namespace {
+
+layer_state_t makeStateWithEveryField() {
+    layer_state_t state;
+    state.layerId = 42;
+    state.what = ~uint64_t(0);
+    state.x = 1.5f;
+    state.y = 2.5f;
+    state.z = 3;
+    state.layerStack = ui::LayerStack::fromValue(4);
+    state.flags = layer_state_t::eLayerSecure;
+    state.mask = layer_state_t::eLayerSecure;
+    state.crop = Rect(1, 2, 3, 4);
+    state.color = half4(0.1f, 0.2f, 0.3f, 0.4f);
+    state.windowInfoHandle->editInfo()->name = "window";
+    state.transparentRegion = Region(Rect(5, 6, 7, 8));
+    state.bufferTransform = 2;
+    state.dataspace = ui::Dataspace::DISPLAY_P3;
+    state.api = 1;
+    state.cornerRadius = 9.f;
+    state.backgroundBlurRadius = 10;
+    state.metadata.setInt32(gui::METADATA_OWNER_UID, 11);
+    state.shadowRadius = 12.f;
+    state.frameRateSelectionPriority = 13;
+    state.frameRate = 60.f;
+    state.blurRegions.push_back({.blurRadius = 14, .left = 1, .top = 2, .right = 3, .bottom = 4});
+    state.bufferCrop = Rect(15, 16, 17, 18);
+    state.destinationFrame = Rect(19, 20, 21, 22);
+    state.isTrustedOverlay = true;
+    state.dropInputMode = gui::DropInputMode::ALL;
+    state.currentHdrSdrRatio = 2.f;
+    state.desiredHdrSdrRatio = 3.f;
+    state.cachingHint = gui::CachingHint::Disabled;
+    return state;
+}
+
+void expectEveryField(const layer_state_t& state) {
+    EXPECT_EQ(42, state.layerId);
+    EXPECT_EQ(~uint64_t(0), state.what);
+    EXPECT_EQ(1.5f, state.x);
+    EXPECT_EQ(2.5f, state.y);
+    EXPECT_EQ(3, state.z);
+    EXPECT_EQ(ui::LayerStack::fromValue(4), state.layerStack);
+    EXPECT_EQ(static_cast<uint32_t>(layer_state_t::eLayerSecure), state.flags);
+    EXPECT_EQ(static_cast<uint32_t>(layer_state_t::eLayerSecure), state.mask);
+    EXPECT_EQ(Rect(1, 2, 3, 4), state.crop);
+    EXPECT_EQ(half4(0.1f, 0.2f, 0.3f, 0.4f), state.color);
+    EXPECT_EQ("window", state.windowInfoHandle->getInfo()->name);
+    EXPECT_TRUE(state.transparentRegion.hasSameRects(Region(Rect(5, 6, 7, 8))));
+    EXPECT_EQ(2u, state.bufferTransform);
+    EXPECT_EQ(ui::Dataspace::DISPLAY_P3, state.dataspace);
+    EXPECT_EQ(1, state.api);
+    EXPECT_EQ(9.f, state.cornerRadius);
+    EXPECT_EQ(10u, state.backgroundBlurRadius);
+    EXPECT_EQ(11, state.metadata.getInt32(gui::METADATA_OWNER_UID, 0));
+    EXPECT_EQ(12.f, state.shadowRadius);
+    EXPECT_EQ(13, state.frameRateSelectionPriority);
+    EXPECT_EQ(60.f, state.frameRate);
+    ASSERT_EQ(1u, state.blurRegions.size());
+    EXPECT_EQ(14u, state.blurRegions[0].blurRadius);
+    EXPECT_EQ(3, state.blurRegions[0].right);
+    EXPECT_EQ(Rect(15, 16, 17, 18), state.bufferCrop);
+    EXPECT_EQ(Rect(19, 20, 21, 22), state.destinationFrame);
+    EXPECT_TRUE(state.isTrustedOverlay);
+    EXPECT_EQ(gui::DropInputMode::ALL, state.dropInputMode);
+    EXPECT_EQ(2.f, state.currentHdrSdrRatio);
+    EXPECT_EQ(3.f, state.desiredHdrSdrRatio);
+    EXPECT_EQ(gui::CachingHint::Disabled, state.cachingHint);
+}
+
+} // namespace
+
+TEST(LayerStateTest, ParcellingWithEveryFieldChanged) {
+    const layer_state_t state = makeStateWithEveryField();
+
+    Parcel p;
+    ASSERT_EQ(OK, state.write(p));
+    p.setDataPosition(0);
+
+    layer_state_t parceled;
+    ASSERT_EQ(OK, parceled.read(p));
+    expectEveryField(parceled);
+    EXPECT_EQ(p.dataSize(), p.dataPosition());
+}
+
+TEST(LayerStateTest, ParcellingLeavesUnchangedFieldsAtDefaults) {
+    layer_state_t state = makeStateWithEveryField();
+    state.what = layer_state_t::ePositionChanged;
+
+    Parcel p;
+    ASSERT_EQ(OK, state.write(p));
+    p.setDataPosition(0);
+
+    layer_state_t parceled;
+    ASSERT_EQ(OK, parceled.read(p));
+    EXPECT_EQ(1.5f, parceled.x);
+    EXPECT_EQ(2.5f, parceled.y);
+    EXPECT_EQ(layer_state_t().cornerRadius, parceled.cornerRadius);
+    EXPECT_EQ(layer_state_t().crop, parceled.crop);
+    EXPECT_EQ(p.dataSize(), p.dataPosition());
+}
+
+TEST(LayerStateTest, ReadsParcelWithoutFieldMask) {
+    const layer_state_t state = makeStateWithEveryField();
+    Parcel tagged;
+    ASSERT_EQ(OK, state.write(tagged));
+
+    // The layout without the tag and the mask holds every field, in the same order.
+    tagged.setDataPosition(0);
+    int32_t tag = 0;
+    sp<IBinder> surface;
+    int32_t layerId = 0;
+    uint64_t what = 0;
+    uint64_t fields = 0;
+    ASSERT_EQ(OK, tagged.readInt32(&tag));
+    ASSERT_EQ(layer_state_t::kFieldMaskParcelTag, tag);
+    ASSERT_EQ(OK, tagged.readNullableStrongBinder(&surface));
+    ASSERT_EQ(OK, tagged.readInt32(&layerId));
+    ASSERT_EQ(OK, tagged.readUint64(&what));
+    ASSERT_EQ(OK, tagged.readUint64(&fields));
+    ASSERT_EQ(~uint64_t(0), fields);
+
+    Parcel untagged;
+    ASSERT_EQ(OK, untagged.writeStrongBinder(surface));
+    ASSERT_EQ(OK, untagged.writeInt32(layerId));
+    ASSERT_EQ(OK, untagged.writeUint64(what));
+    const size_t rest = tagged.dataPosition();
+    ASSERT_EQ(OK, untagged.appendFrom(&tagged, rest, tagged.dataSize() - rest));
+    untagged.setDataPosition(0);
+
+    layer_state_t parceled;
+    ASSERT_EQ(OK, parceled.read(untagged));
+    expectEveryField(parceled);
+    EXPECT_EQ(untagged.dataSize(), untagged.dataPosition());
+}
+
+} // namespace test
+} // namespace android
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <binder/Parcel.h>
+
+#include <gui/ITransactionCompletedListener.h>
+
+#include <unistd.h>
+
+namespace android {
+
+namespace test {
+
+TEST(ListenerStatsTest, ParcellingReleasedBuffers) {
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    close(fds[1]);
+
+    ListenerStats stats;
+    stats.releasedBuffers.emplace_back(ReleaseCallbackId(1, 2), sp<Fence>::make(fds[0]), 3);
+    stats.releasedBuffers.emplace_back(ReleaseCallbackId(4, 5), Fence::NO_FENCE, 6);
+
+    Parcel p;
+    ASSERT_EQ(OK, stats.writeToParcel(&p));
+    p.setDataPosition(0);
+
+    ListenerStats parceled;
+    ASSERT_EQ(OK, parceled.readFromParcel(&p));
+    EXPECT_EQ(p.dataSize(), p.dataPosition());
+    EXPECT_TRUE(parceled.transactionStats.empty());
+
+    ASSERT_EQ(2u, parceled.releasedBuffers.size());
+    EXPECT_EQ(ReleaseCallbackId(1, 2), parceled.releasedBuffers[0].callbackId);
+    ASSERT_NE(nullptr, parceled.releasedBuffers[0].releaseFence);
+    EXPECT_TRUE(parceled.releasedBuffers[0].releaseFence->isValid());
+    EXPECT_EQ(3u, parceled.releasedBuffers[0].currentMaxAcquiredBufferCount);
+    EXPECT_EQ(ReleaseCallbackId(4, 5), parceled.releasedBuffers[1].callbackId);
+    ASSERT_NE(nullptr, parceled.releasedBuffers[1].releaseFence);
+    EXPECT_FALSE(parceled.releasedBuffers[1].releaseFence->isValid());
+    EXPECT_EQ(6u, parceled.releasedBuffers[1].currentMaxAcquiredBufferCount);
+}
+
+TEST(ListenerStatsTest, ParcellingTransactionStatsWithReleasedBuffers) {
+    ListenerStats stats;
+    stats.transactionStats.emplace_back();
+    stats.transactionStats.back().latchTime = 7;
+    stats.releasedBuffers.emplace_back(ReleaseCallbackId(1, 2), Fence::NO_FENCE, 3);
+
+    Parcel p;
+    ASSERT_EQ(OK, stats.writeToParcel(&p));
+    p.setDataPosition(0);
+
+    ListenerStats parceled;
+    ASSERT_EQ(OK, parceled.readFromParcel(&p));
+    EXPECT_EQ(p.dataSize(), p.dataPosition());
+    ASSERT_EQ(1u, parceled.transactionStats.size());
+    EXPECT_EQ(7, parceled.transactionStats[0].latchTime);
+    ASSERT_EQ(1u, parceled.releasedBuffers.size());
+    EXPECT_EQ(ReleaseCallbackId(1, 2), parceled.releasedBuffers[0].callbackId);
+}
+
+} // namespace test
+
+} // namespace android
@@ -222,4 +222,74 @@ TEST_F(StreamSplitterTest, OutputAbandonment) {
                                            nullptr, nullptr));
 }
 
+TEST_F(StreamSplitterTest, DroppingOutputDoesNotHoldBackOthers) {
+    const int NUM_FRAMES = 3;
+
+    sp<IGraphicBufferProducer> inputProducer;
+    sp<IGraphicBufferConsumer> inputConsumer;
+    BufferQueue::createBufferQueue(&inputProducer, &inputConsumer);
+
+    // The consumer of this output never acquires anything
+    sp<IGraphicBufferProducer> stalledProducer;
+    sp<IGraphicBufferConsumer> stalledConsumer;
+    BufferQueue::createBufferQueue(&stalledProducer, &stalledConsumer);
+    ASSERT_EQ(OK, stalledConsumer->consumerConnect(new FakeListener, false));
+
+    sp<IGraphicBufferProducer> outputProducer;
+    sp<IGraphicBufferConsumer> outputConsumer;
+    BufferQueue::createBufferQueue(&outputProducer, &outputConsumer);
+    ASSERT_EQ(OK, outputConsumer->consumerConnect(new FakeListener, false));
+
+    sp<StreamSplitter> splitter;
+    status_t status = StreamSplitter::createSplitter(inputConsumer, &splitter);
+    ASSERT_EQ(OK, status);
+    StreamSplitter::OutputConfig config;
+    config.maxOutstandingBuffers = 1;
+    config.dropPolicy = StreamSplitter::DropPolicy::Drop;
+    ASSERT_EQ(OK, splitter->addOutput(stalledProducer, config));
+    ASSERT_EQ(OK, splitter->addOutput(outputProducer));
+
+    IGraphicBufferProducer::QueueBufferOutput qbOutput;
+    ASSERT_EQ(OK,
+              inputProducer->connect(new StubProducerListener, NATIVE_WINDOW_API_CPU, false,
+                                     &qbOutput));
+
+    for (int frame = 0; frame < NUM_FRAMES; ++frame) {
+        int slot;
+        sp<Fence> fence;
+        status_t result =
+                inputProducer->dequeueBuffer(&slot, &fence, 0, 0, 0, GRALLOC_USAGE_SW_WRITE_OFTEN,
+                                             nullptr, nullptr);
+        ASSERT_GE(result, OK);
+        if (result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+            sp<GraphicBuffer> buffer;
+            ASSERT_EQ(OK, inputProducer->requestBuffer(slot, &buffer));
+        }
+
+        // This would block in onFrameAvailable if the stalled output held
+        // back the splitter
+        IGraphicBufferProducer::QueueBufferInput qbInput(frame, false,
+                HAL_DATASPACE_UNKNOWN, Rect(0, 0, 1, 1),
+                NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE);
+        ASSERT_EQ(OK, inputProducer->queueBuffer(slot, qbInput, &qbOutput));
+
+        BufferItem item;
+        ASSERT_EQ(OK, outputConsumer->acquireBuffer(&item, 0));
+        ASSERT_EQ(OK, outputConsumer->releaseBuffer(item.mSlot, item.mFrameNumber,
+                EGL_NO_DISPLAY, EGL_NO_SYNC_KHR, Fence::NO_FENCE));
+    }
+
+    StreamSplitter::OutputStats stats;
+    ASSERT_EQ(OK, splitter->getOutputStats(stalledProducer, &stats));
+    EXPECT_EQ(1u, stats.queuedBuffers);
+    EXPECT_EQ(static_cast<uint64_t>(NUM_FRAMES - 1), stats.droppedBuffers);
+
+    ASSERT_EQ(OK, splitter->getOutputStats(outputProducer, &stats));
+    EXPECT_EQ(static_cast<uint64_t>(NUM_FRAMES), stats.queuedBuffers);
+    EXPECT_EQ(0u, stats.droppedBuffers);
+    EXPECT_GE(stats.maxLatency, stats.averageLatency);
+
+    EXPECT_EQ(BAD_VALUE, splitter->getOutputStats(inputProducer, &stats));
+}
+
 } // namespace android
@@ -2214,4 +2214,93 @@ TEST_F(SurfaceTest, BatchIllegalOperations) {
     ASSERT_EQ(NO_ERROR, surface->disconnect(NATIVE_WINDOW_API_CPU));
 }
 
+TEST_F(SurfaceTest, BatchOperationsThroughNativeWindow) {
+    const int BUFFER_COUNT = 16;
+    const int BATCH_SIZE = 8;
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+
+    sp<CpuConsumer> cpuConsumer = new CpuConsumer(consumer, 1);
+    sp<Surface> surface = new Surface(producer);
+    sp<ANativeWindow> window(surface);
+    sp<StubProducerListener> listener = new StubProducerListener();
+
+    ASSERT_EQ(OK, surface->connect(NATIVE_WINDOW_API_CPU, /*listener*/listener,
+            /*reportBufferRemoval*/false));
+
+    ASSERT_EQ(NO_ERROR, native_window_set_buffer_count(window.get(), BUFFER_COUNT));
+
+    ANativeWindowBuffer* buffers[BATCH_SIZE];
+    int fences[BATCH_SIZE];
+
+    // Batch dequeued buffers can be queued individually
+    ASSERT_EQ(NO_ERROR, native_window_dequeue_buffers(window.get(), BATCH_SIZE, buffers, fences));
+    for (size_t i = 0; i < BATCH_SIZE; i++) {
+        ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), buffers[i], fences[i]));
+    }
+
+    // Batch dequeued buffers can be batch cancelled
+    ASSERT_EQ(NO_ERROR, native_window_dequeue_buffers(window.get(), BATCH_SIZE, buffers, fences));
+    ASSERT_EQ(NO_ERROR, native_window_cancel_buffers(window.get(), BATCH_SIZE, buffers, fences));
+
+    // The batch operations would bypass a dequeue interceptor, so they are refused
+    auto interceptor = [](ANativeWindow* window, ANativeWindow_dequeueBufferFn dequeueBuffer,
+                          void* /*data*/, ANativeWindowBuffer** buffer, int* fenceFd) {
+        return dequeueBuffer(window, buffer, fenceFd);
+    };
+    ASSERT_EQ(NO_ERROR, ANativeWindow_setDequeueBufferInterceptor(window.get(), interceptor,
+                                                                  nullptr));
+    ASSERT_EQ(INVALID_OPERATION,
+              native_window_dequeue_buffers(window.get(), BATCH_SIZE, buffers, fences));
+
+    ASSERT_EQ(NO_ERROR, surface->disconnect(NATIVE_WINDOW_API_CPU));
+}
+
+TEST_F(SurfaceTest, FailedBatchCancelCanBeRetriedOneAtATime) {
+    const int BUFFER_COUNT = 16;
+    const int BATCH_SIZE = 8;
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+
+    sp<CpuConsumer> cpuConsumer = new CpuConsumer(consumer, 1);
+    sp<Surface> surface = new Surface(producer);
+    sp<ANativeWindow> window(surface);
+    sp<StubProducerListener> listener = new StubProducerListener();
+
+    ASSERT_EQ(OK, surface->connect(NATIVE_WINDOW_API_CPU, /*listener*/listener,
+            /*reportBufferRemoval*/false));
+
+    ASSERT_EQ(NO_ERROR, native_window_set_buffer_count(window.get(), BUFFER_COUNT));
+
+    ANativeWindowBuffer* buffers[BATCH_SIZE + 1];
+    int fences[BATCH_SIZE + 1];
+    ASSERT_EQ(NO_ERROR, native_window_dequeue_buffers(window.get(), BATCH_SIZE, buffers, fences));
+
+    // A batch with a buffer the window doesn't know fails, after cancelling the rest
+    buffers[BATCH_SIZE] = nullptr;
+    fences[BATCH_SIZE] = -1;
+    ASSERT_EQ(BAD_VALUE,
+              native_window_cancel_buffers(window.get(), BATCH_SIZE + 1, buffers, fences));
+
+    // Cancelling them again one at a time, as the Vulkan swapchain does after any batch failure,
+    // doesn't take the buffers from the queue a second time
+    for (size_t i = 0; i < BATCH_SIZE; i++) {
+        window->cancelBuffer(window.get(), buffers[i], -1);
+    }
+
+    // All of the buffers are back in the queue
+    ANativeWindowBuffer* allBuffers[BUFFER_COUNT - 1];
+    int allFences[BUFFER_COUNT - 1];
+    ASSERT_EQ(NO_ERROR,
+              native_window_dequeue_buffers(window.get(), BUFFER_COUNT - 1, allBuffers,
+                                            allFences));
+    ASSERT_EQ(NO_ERROR,
+              native_window_cancel_buffers(window.get(), BUFFER_COUNT - 1, allBuffers,
+                                           allFences));
+
+    ASSERT_EQ(NO_ERROR, surface->disconnect(NATIVE_WINDOW_API_CPU));
+}
+
 } // namespace android
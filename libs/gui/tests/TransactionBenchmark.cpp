@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <binder/Binder.h>
+#include <binder/Parcel.h>
+#include <binder/ProcessState.h>
+#include <gui/ISurfaceComposerClient.h>
+#include <gui/SurfaceComposerClient.h>
+#include <gui/SurfaceControl.h>
+
+#include <vector>
+
+// Usage: atest libgui_transaction_benchmark
+//
+// Measures the transactions of large layer trees: building, merging and
+// parceling them, and applying them to SurfaceFlinger. Only the apply
+// benchmark needs SurfaceFlinger, the others use layers it doesn't know.
+
+namespace android {
+
+namespace {
+
+using Transaction = SurfaceComposerClient::Transaction;
+
+std::vector<sp<SurfaceControl>> makeLayers(size_t count) {
+    std::vector<sp<SurfaceControl>> layers;
+    layers.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        layers.push_back(sp<SurfaceControl>::make(nullptr, sp<BBinder>::make(),
+                                                  static_cast<int32_t>(i), "benchmark"));
+    }
+    return layers;
+}
+
+// What a launcher changes on each of its layers per frame.
+void fill(Transaction& t, const std::vector<sp<SurfaceControl>>& layers, float value) {
+    for (const auto& layer : layers) {
+        t.setPosition(layer, value, value);
+        t.setAlpha(layer, 0.5f);
+        t.setCrop(layer, Rect(0, 0, 100, 100));
+    }
+}
+
+void BM_TransactionBuild(benchmark::State& state) {
+    const auto layers = makeLayers(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        Transaction t;
+        fill(t, layers, 1.f);
+        benchmark::DoNotOptimize(t);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransactionBuild)->Arg(100)->Arg(1000);
+
+// Merges a transaction into one which changes the same layers, or, if
+// range(1) is 0, other layers.
+void BM_TransactionMerge(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    const auto layers = makeLayers(count);
+    const auto otherLayers = state.range(1) ? layers : makeLayers(count);
+    for (auto _ : state) {
+        state.PauseTiming();
+        Transaction t;
+        fill(t, layers, 1.f);
+        Transaction other;
+        fill(other, otherLayers, 2.f);
+        state.ResumeTiming();
+
+        t.merge(std::move(other));
+        benchmark::DoNotOptimize(t);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransactionMerge)->Args({100, 0})->Args({100, 1})->Args({1000, 0})->Args({1000, 1});
+
+// The dozens of small merges of a single frame, into one large transaction.
+void BM_TransactionMergeMany(benchmark::State& state) {
+    const auto layers = makeLayers(static_cast<size_t>(state.range(0)));
+    constexpr size_t kMerges = 32;
+    for (auto _ : state) {
+        state.PauseTiming();
+        Transaction t;
+        fill(t, layers, 1.f);
+        std::vector<Transaction> others(kMerges);
+        for (size_t i = 0; i < kMerges; i++) {
+            others[i].setPosition(layers[i % layers.size()], 2.f, 2.f);
+        }
+        state.ResumeTiming();
+
+        for (auto& other : others) {
+            t.merge(std::move(other));
+        }
+        benchmark::DoNotOptimize(t);
+    }
+}
+BENCHMARK(BM_TransactionMergeMany)->Arg(100)->Arg(1000);
+
+void BM_TransactionParcel(benchmark::State& state) {
+    const auto layers = makeLayers(static_cast<size_t>(state.range(0)));
+    Transaction t;
+    fill(t, layers, 1.f);
+    for (auto _ : state) {
+        Parcel parcel;
+        t.writeToParcel(&parcel);
+        parcel.setDataPosition(0);
+        Transaction read;
+        read.readFromParcel(&parcel);
+        benchmark::DoNotOptimize(read);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransactionParcel)->Arg(100)->Arg(1000);
+
+// Applies synchronously, so this includes SurfaceFlinger committing it.
+void BM_TransactionApply(benchmark::State& state) {
+    sp<SurfaceComposerClient> client = sp<SurfaceComposerClient>::make();
+    if (client->initCheck() != NO_ERROR) {
+        state.SkipWithError("can't connect to SurfaceFlinger");
+        return;
+    }
+    std::vector<sp<SurfaceControl>> layers;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        layers.push_back(client->createSurface(String8("TransactionBenchmark"), 0, 0,
+                                               PIXEL_FORMAT_RGBA_8888,
+                                               ISurfaceComposerClient::eFXSurfaceEffect));
+        if (layers.back() == nullptr) {
+            state.SkipWithError("can't create layers");
+            return;
+        }
+    }
+    float value = 0.f;
+    for (auto _ : state) {
+        Transaction t;
+        fill(t, layers, value++);
+        t.apply(true /*synchronous*/);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransactionApply)->Arg(100)->Arg(1000);
+
+} // namespace
+
+} // namespace android
+
+int main(int argc, char** argv) {
+    android::ProcessState::self()->startThreadPool();
+    ::benchmark::Initialize(&argc, argv);
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    ::benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -20,6 +20,7 @@
 #include <binder/Parcel.h>
 
 #include <gui/WindowInfo.h>
+#include <gui/WindowInfosUpdate.h>
 
 using std::chrono_literals::operator""s;
 
@@ -28,6 +29,7 @@ namespace android {
 using gui::InputApplicationInfo;
 using gui::TouchOcclusionMode;
 using gui::WindowInfo;
+using gui::WindowInfosUpdate;
 using ui::Size;
 
 namespace test {
@@ -116,5 +118,101 @@ TEST(InputApplicationInfo, Parcelling) {
     ASSERT_EQ(i, i2);
 }
 
+static WindowInfo makeWindowInfo(int32_t id, const std::string& name) {
+    WindowInfo info;
+    info.token = sp<BBinder>::make();
+    info.id = id;
+    info.name = name;
+    return info;
+}
+
+TEST(WindowInfosUpdate, DeltaOnlyHasChangedWindows) {
+    WindowInfosUpdate base({makeWindowInfo(1, "a"), makeWindowInfo(2, "b"), makeWindowInfo(3, "c")},
+                           {}, /*vsyncId=*/1, /*timestamp=*/10);
+    base.generation = 5;
+
+    // Window 2 is removed, window 3 changes, window 4 is added and window 1 moves to the top.
+    WindowInfosUpdate update({base.windowInfos[2], makeWindowInfo(4, "d"), base.windowInfos[0]},
+                             {}, /*vsyncId=*/2, /*timestamp=*/20);
+    update.generation = 6;
+    update.windowInfos[0].alpha = 0.5f;
+
+    auto delta = update.makeDelta(base);
+    ASSERT_TRUE(delta.has_value());
+    ASSERT_TRUE(delta->isDelta());
+    EXPECT_EQ(5, delta->baseGeneration);
+    EXPECT_EQ(6, delta->generation);
+    EXPECT_EQ((std::vector<int32_t>{3, 4, 1}), delta->windowIds);
+    ASSERT_EQ(2u, delta->windowInfos.size());
+    EXPECT_EQ(3, delta->windowInfos[0].id);
+    EXPECT_EQ(4, delta->windowInfos[1].id);
+
+    Parcel p;
+    ASSERT_EQ(OK, delta->writeToParcel(&p));
+    p.setDataPosition(0);
+    WindowInfosUpdate parcelled;
+    ASSERT_EQ(OK, parcelled.readFromParcel(&p));
+    EXPECT_EQ(delta->windowIds, parcelled.windowIds);
+    EXPECT_EQ(delta->baseGeneration, parcelled.baseGeneration);
+
+    auto applied = base.applyDelta(parcelled);
+    ASSERT_TRUE(applied.has_value());
+    EXPECT_FALSE(applied->isDelta());
+    EXPECT_EQ(6, applied->generation);
+    EXPECT_EQ(2, applied->vsyncId);
+    ASSERT_EQ(update.windowInfos.size(), applied->windowInfos.size());
+    for (size_t i = 0; i < update.windowInfos.size(); i++) {
+        EXPECT_EQ(update.windowInfos[i], applied->windowInfos[i]);
+        EXPECT_EQ(update.windowInfos[i].alpha, applied->windowInfos[i].alpha);
+    }
+}
+
+TEST(WindowInfosUpdate, NoDeltaWhenEveryWindowChanged) {
+    WindowInfosUpdate base({makeWindowInfo(1, "a")}, {}, 1, 10);
+    base.generation = 0;
+    WindowInfosUpdate update({makeWindowInfo(1, "b")}, {}, 2, 20);
+    update.generation = 1;
+    EXPECT_FALSE(update.makeDelta(base).has_value());
+}
+
+TEST(WindowInfosUpdate, DeltaOnlyComparesChangedWindows) {
+    WindowInfosUpdate base({makeWindowInfo(1, "a"), makeWindowInfo(2, "b"), makeWindowInfo(3, "c")},
+                           {}, 1, 10);
+    base.generation = 0;
+    WindowInfosUpdate update({base.windowInfos[0], base.windowInfos[1], makeWindowInfo(4, "d")}, {},
+                             2, 20);
+    update.generation = 1;
+    update.windowInfos[1].alpha = 0.5f;
+
+    // Window 1 is said to have changed but didn't, and new windows are sent even if they aren't
+    // in the hint.
+    const std::unordered_set<int32_t> changedWindowIds{1, 2};
+    auto delta = update.makeDelta(base, &changedWindowIds);
+    ASSERT_TRUE(delta.has_value());
+    ASSERT_EQ(2u, delta->windowInfos.size());
+    EXPECT_EQ(2, delta->windowInfos[0].id);
+    EXPECT_EQ(4, delta->windowInfos[1].id);
+
+    // Window 2 is trusted to be unchanged when it isn't in the hint.
+    const std::unordered_set<int32_t> noChangedWindowIds;
+    delta = update.makeDelta(base, &noChangedWindowIds);
+    ASSERT_TRUE(delta.has_value());
+    ASSERT_EQ(1u, delta->windowInfos.size());
+    EXPECT_EQ(4, delta->windowInfos[0].id);
+}
+
+TEST(WindowInfosUpdate, DeltaOfAnotherGenerationDoesNotApply) {
+    WindowInfosUpdate base({makeWindowInfo(1, "a"), makeWindowInfo(2, "b")}, {}, 1, 10);
+    base.generation = 0;
+    WindowInfosUpdate update({base.windowInfos[0], makeWindowInfo(2, "c")}, {}, 2, 20);
+    update.generation = 1;
+    auto delta = update.makeDelta(base);
+    ASSERT_TRUE(delta.has_value());
+
+    WindowInfosUpdate missed = base;
+    missed.generation = 3;
+    EXPECT_FALSE(missed.applyDelta(*delta).has_value());
+}
+
 } // namespace test
 } // namespace android
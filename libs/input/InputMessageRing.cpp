@@ -0,0 +1,186 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "InputMessageRing"
+
+#include "InputMessageRing.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+
+#include <cutils/ashmem.h>
+#include <input/InputTransport.h>
+#include <log/log.h>
+
+namespace android {
+
+namespace {
+
+// The records of the ring are a 32-bit size followed by the message, aligned so that the size of
+// the next record is never split by the end of the ring.
+constexpr uint32_t kRecordAlignment = 8;
+
+// The size of the record which tells the reader to go on at the start of the ring, since the next
+// message did not fit before its end.
+constexpr uint32_t kWrapMarker = UINT32_MAX;
+
+constexpr uint32_t recordSize(size_t messageSize) {
+    return (sizeof(uint32_t) + messageSize + kRecordAlignment - 1) & ~(kRecordAlignment - 1);
+}
+
+static_assert(InputMessageRing::kCapacity % kRecordAlignment == 0);
+static_assert((InputMessageRing::kCapacity & (InputMessageRing::kCapacity - 1)) == 0,
+              "The positions wrap around at a multiple of the capacity");
+static_assert(recordSize(sizeof(InputMessage)) <= InputMessageRing::kCapacity / 4);
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "The atomics of the shared memory must not rely on a lock of the process");
+
+} // namespace
+
+// The positions are on their own cache lines, since each is written by a different end.
+struct InputMessageRing::Header {
+    alignas(64) std::atomic<uint32_t> readPosition;
+    alignas(64) std::atomic<uint32_t> writePosition;
+    // Whether the writer sent a wakeup which the reader did not take yet.
+    alignas(64) std::atomic<uint32_t> wakeupPending;
+};
+
+size_t InputMessageRing::memorySize() {
+    return sizeof(Header) + kCapacity;
+}
+
+base::unique_fd InputMessageRing::allocate(const std::string& name) {
+    // The memory of a new region is zeroed, as is the header of an empty ring.
+    base::unique_fd fd(ashmem_create_region(name.c_str(), memorySize()));
+    if (!fd.ok()) {
+        ALOGE("'%s' ~ Could not allocate input message ring: %s", name.c_str(), strerror(errno));
+    }
+    return fd;
+}
+
+std::shared_ptr<InputMessageRing> InputMessageRing::map(int fd) {
+    const int size = ashmem_get_size_region(fd);
+    if (size < 0 || static_cast<size_t>(size) != memorySize()) {
+        ALOGE("Input message ring has size %d instead of %zu", size, memorySize());
+        return nullptr;
+    }
+    void* memory = mmap(nullptr, memorySize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        ALOGE("Could not map input message ring: %s", strerror(errno));
+        return nullptr;
+    }
+    // using 'new' to access a non-public constructor
+    return std::shared_ptr<InputMessageRing>(
+            new InputMessageRing(memory, static_cast<Header*>(memory),
+                                 static_cast<uint8_t*>(memory) + sizeof(Header)));
+}
+
+InputMessageRing::InputMessageRing(void* memory, Header* header, uint8_t* data)
+      : mMemory(memory),
+        mHeader(header),
+        mData(data),
+        mReadPosition(header->readPosition.load()),
+        mWritePosition(header->writePosition.load()) {}
+
+InputMessageRing::~InputMessageRing() {
+    munmap(mMemory, memorySize());
+}
+
+status_t InputMessageRing::write(const InputMessage& msg, size_t size, bool* outWakeUpReader) {
+    std::scoped_lock lock(mMutex);
+    const uint32_t used = mWritePosition - mHeader->readPosition.load(std::memory_order_acquire);
+    if (used > kCapacity) {
+        ALOGE("Input message ring was read past its end");
+        return BAD_VALUE;
+    }
+
+    uint32_t offset = mWritePosition % kCapacity;
+    const uint32_t record = recordSize(size);
+    const uint32_t padding = record > kCapacity - offset ? kCapacity - offset : 0;
+    if (used + padding + record > kCapacity) {
+        return WOULD_BLOCK;
+    }
+
+    if (padding != 0) {
+        memcpy(mData + offset, &kWrapMarker, sizeof(kWrapMarker));
+        mWritePosition += padding;
+        offset = 0;
+    }
+    const uint32_t messageSize = static_cast<uint32_t>(size);
+    memcpy(mData + offset, &messageSize, sizeof(messageSize));
+    memcpy(mData + offset + sizeof(messageSize), &msg, size);
+    mWritePosition += record;
+
+    // Sequentially consistent, as is the request for a wakeup of the reader, so that either the
+    // writer sees the request, or the reader sees the message when it checks the ring again.
+    mHeader->writePosition.store(mWritePosition);
+    *outWakeUpReader = mHeader->wakeupPending.exchange(1) == 0;
+    return OK;
+}
+
+status_t InputMessageRing::read(InputMessage* msg, size_t* outSize) {
+    std::scoped_lock lock(mMutex);
+    while (true) {
+        const uint32_t available = mHeader->writePosition.load() - mReadPosition;
+        if (available == 0) {
+            return WOULD_BLOCK;
+        }
+        if (available > kCapacity) {
+            ALOGE("Input message ring was written past its end");
+            return BAD_VALUE;
+        }
+
+        const uint32_t offset = mReadPosition % kCapacity;
+        uint32_t messageSize;
+        memcpy(&messageSize, mData + offset, sizeof(messageSize));
+        if (messageSize == kWrapMarker) {
+            const uint32_t padding = kCapacity - offset;
+            if (padding > available) {
+                ALOGE("Input message ring wraps around past its write position");
+                return BAD_VALUE;
+            }
+            mReadPosition += padding;
+            mHeader->readPosition.store(mReadPosition, std::memory_order_release);
+            continue;
+        }
+
+        if (messageSize > sizeof(InputMessage) ||
+            recordSize(messageSize) > std::min(available, kCapacity - offset)) {
+            ALOGE("Input message ring holds a message of invalid size %" PRIu32, messageSize);
+            return BAD_VALUE;
+        }
+        memcpy(msg, mData + offset + sizeof(messageSize), messageSize);
+        mReadPosition += recordSize(messageSize);
+        mHeader->readPosition.store(mReadPosition, std::memory_order_release);
+        *outSize = messageSize;
+        return OK;
+    }
+}
+
+bool InputMessageRing::hasMessages() const {
+    std::scoped_lock lock(mMutex);
+    return mHeader->writePosition.load() != mReadPosition;
+}
+
+void InputMessageRing::requestWakeup() {
+    mHeader->wakeupPending.store(0);
+}
+
+} // namespace android
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+#include <utils/Errors.h>
+
+namespace android {
+
+struct InputMessage;
+
+/*
+ * A ring of input messages in memory shared by the two ends of an input channel, which one end
+ * writes and the other reads, so that the messages are not copied through the socket one
+ * datagram at a time. The socket then only carries the wakeups of the reader.
+ *
+ * The writer asks for a wakeup of the reader when it writes a message while none is pending, and
+ * the reader only takes the pending wakeup once it found the ring empty, before checking it again.
+ * The socket of a reader thus stays readable while the ring holds messages, unless a message was
+ * written while the reader was emptying it, in which case the reader receives it without waking up.
+ *
+ * The positions read from the shared memory are validated, since the other end may not be trusted.
+ * The channels which share a ring in a process serialize their accesses to it.
+ */
+class InputMessageRing {
+public:
+    // The size of the messages the ring holds, as the socket buffer of a channel.
+    static constexpr uint32_t kCapacity = 32 * 1024;
+
+    // Allocates the shared memory of a new, empty ring.
+    static base::unique_fd allocate(const std::string& name);
+
+    // Maps the ring of the shared memory, or returns nullptr if it is not one.
+    static std::shared_ptr<InputMessageRing> map(int fd);
+
+    ~InputMessageRing();
+
+    InputMessageRing(const InputMessageRing&) = delete;
+    InputMessageRing& operator=(const InputMessageRing&) = delete;
+
+    // Writes a message of the given size, and tells whether the reader must be woken up for it.
+    //
+    // Returns OK on success.
+    // Returns WOULD_BLOCK if the ring is full.
+    // Returns BAD_VALUE if the reader corrupted the ring.
+    status_t write(const InputMessage& msg, size_t size, bool* outWakeUpReader) EXCLUDES(mMutex);
+
+    // Reads the oldest message, and its size.
+    //
+    // Returns OK on success.
+    // Returns WOULD_BLOCK if the ring is empty.
+    // Returns BAD_VALUE if the writer corrupted the ring.
+    status_t read(InputMessage* msg, size_t* outSize) EXCLUDES(mMutex);
+
+    bool hasMessages() const EXCLUDES(mMutex);
+
+    // Called by the reader once it took the pending wakeup, so that the next message written
+    // wakes it up again.
+    void requestWakeup();
+
+private:
+    struct Header;
+
+    static size_t memorySize();
+
+    InputMessageRing(void* memory, Header* header, uint8_t* data);
+
+    void* const mMemory;
+    Header* const mHeader;
+    uint8_t* const mData;
+
+    mutable std::mutex mMutex;
+    // The positions of the next record to read and to write, in bytes since the ring was
+    // allocated. Each end only trusts its own, and validates the one of the other end.
+    uint32_t mReadPosition GUARDED_BY(mMutex);
+    uint32_t mWritePosition GUARDED_BY(mMutex);
+};
+
+} // namespace android
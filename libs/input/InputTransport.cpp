@@ -28,6 +28,8 @@
 #include <input/InputTransport.h>
 #include <input/TraceTools.h>
 
+#include "InputMessageRing.h"
+
 namespace input_flags = com::android::input::flags;
 
 namespace {
@@ -123,6 +125,10 @@ namespace android {
 // behind processing touches.
 static const size_t SOCKET_BUFFER_SIZE = 32 * 1024;
 
+// The datagram which wakes up the client of a channel whose messages go through shared memory. It
+// is shorter than any message, so that the client tells it apart from the messages of the socket.
+static const uint8_t RING_WAKEUP = 0;
+
 // Nanoseconds per milliseconds.
 static const nsecs_t NANOS_PER_MS = 1000000;
 
@@ -202,6 +208,21 @@ bool InputMessage::isValid(size_t actualSize) const {
             }
             return valid;
         }
+        case Type::MOTION_BATCH: {
+            const bool valid = body.motionBatch.pointerCount > 0 &&
+                    body.motionBatch.pointerCount <= MAX_POINTERS &&
+                    body.motionBatch.sampleCount > 0 &&
+                    body.motionBatch.sampleCount <= Body::MotionBatch::MAX_SAMPLES &&
+                    body.motionBatch.sampleCount * body.motionBatch.pointerCount <=
+                            Body::MotionBatch::MAX_COORDS;
+            if (!valid) {
+                ALOGE("Received invalid MOTION_BATCH: sampleCount = %" PRIu32
+                      ", pointerCount = %" PRIu32,
+                      body.motionBatch.sampleCount, body.motionBatch.pointerCount);
+            }
+            return valid;
+        }
+        case Type::VERSION:
         case Type::FINISHED:
         case Type::FOCUS:
         case Type::CAPTURE:
@@ -244,6 +265,10 @@ size_t InputMessage::size() const {
             return sizeof(Header) + body.timeline.size();
         case Type::TOUCH_MODE:
             return sizeof(Header) + body.touchMode.size();
+        case Type::MOTION_BATCH:
+            return sizeof(Header) + body.motionBatch.size();
+        case Type::VERSION:
+            return sizeof(Header) + body.version.size();
     }
     return sizeof(Header);
 }
@@ -392,6 +417,71 @@ void InputMessage::getSanitizedCopy(InputMessage* msg) const {
         case InputMessage::Type::TOUCH_MODE: {
             msg->body.touchMode.eventId = body.touchMode.eventId;
             msg->body.touchMode.isInTouchMode = body.touchMode.isInTouchMode;
+            break;
+        }
+        case InputMessage::Type::MOTION_BATCH: {
+            const Body::MotionBatch& batch = body.motionBatch;
+            Body::MotionBatch& outBatch = msg->body.motionBatch;
+            outBatch.sampleCount = batch.sampleCount;
+            outBatch.pointerCount = batch.pointerCount;
+            outBatch.deviceId = batch.deviceId;
+            outBatch.source = batch.source;
+            outBatch.displayId = batch.displayId;
+            outBatch.action = batch.action;
+            outBatch.actionButton = batch.actionButton;
+            outBatch.flags = batch.flags;
+            outBatch.metaState = batch.metaState;
+            outBatch.buttonState = batch.buttonState;
+            outBatch.classification = batch.classification;
+            outBatch.edgeFlags = batch.edgeFlags;
+            outBatch.downTime = batch.downTime;
+
+            outBatch.dsdx = batch.dsdx;
+            outBatch.dtdx = batch.dtdx;
+            outBatch.dtdy = batch.dtdy;
+            outBatch.dsdy = batch.dsdy;
+            outBatch.tx = batch.tx;
+            outBatch.ty = batch.ty;
+
+            outBatch.xPrecision = batch.xPrecision;
+            outBatch.yPrecision = batch.yPrecision;
+            outBatch.xCursorPosition = batch.xCursorPosition;
+            outBatch.yCursorPosition = batch.yCursorPosition;
+
+            outBatch.dsdxRaw = batch.dsdxRaw;
+            outBatch.dtdxRaw = batch.dtdxRaw;
+            outBatch.dtdyRaw = batch.dtdyRaw;
+            outBatch.dsdyRaw = batch.dsdyRaw;
+            outBatch.txRaw = batch.txRaw;
+            outBatch.tyRaw = batch.tyRaw;
+
+            const size_t pointerCount = std::min<size_t>(batch.pointerCount, MAX_POINTERS);
+            for (size_t i = 0; i < pointerCount; i++) {
+                outBatch.pointerProperties[i].id = batch.pointerProperties[i].id;
+                outBatch.pointerProperties[i].toolType = batch.pointerProperties[i].toolType;
+            }
+            const size_t sampleCount =
+                    std::min<size_t>(batch.sampleCount, Body::MotionBatch::MAX_SAMPLES);
+            for (size_t i = 0; i < sampleCount; i++) {
+                outBatch.samples[i].seq = batch.samples[i].seq;
+                outBatch.samples[i].eventId = batch.samples[i].eventId;
+                outBatch.samples[i].eventTime = batch.samples[i].eventTime;
+                outBatch.samples[i].hmac = batch.samples[i].hmac;
+            }
+            const size_t coordCount =
+                    std::min(sampleCount * pointerCount, Body::MotionBatch::MAX_COORDS);
+            for (size_t i = 0; i < coordCount; i++) {
+                outBatch.coords[i].bits = batch.coords[i].bits;
+                const uint32_t count = BitSet64::count(batch.coords[i].bits);
+                memcpy(&outBatch.coords[i].values[0], &batch.coords[i].values[0],
+                       count * sizeof(batch.coords[i].values[0]));
+                outBatch.coords[i].isResampled = batch.coords[i].isResampled;
+            }
+            break;
+        }
+        case InputMessage::Type::VERSION: {
+            msg->body.version.version = body.version.version;
+            break;
         }
     }
 }
@@ -412,8 +502,19 @@ std::unique_ptr<InputChannel> InputChannel::create(const std::string& name,
 
 std::unique_ptr<InputChannel> InputChannel::create(
         android::os::InputChannelCore&& parceledChannel) {
-    return InputChannel::create(parceledChannel.name, parceledChannel.fd.release(),
-                                parceledChannel.token);
+    std::unique_ptr<InputChannel> channel =
+            InputChannel::create(parceledChannel.name, parceledChannel.fd.release(),
+                                 parceledChannel.token);
+    if (channel && parceledChannel.ring) {
+        channel->mRing = InputMessageRing::map(parceledChannel.ring->get());
+        if (!channel->mRing) {
+            ALOGE("channel '%s' ~ Could not map the ring of the parceled channel",
+                  channel->getName().c_str());
+            return nullptr;
+        }
+        channel->ring = std::move(parceledChannel.ring);
+    }
+    return channel;
 }
 
 InputChannel::InputChannel(const std::string name, android::base::unique_fd fd, sp<IBinder> token) {
@@ -431,7 +532,8 @@ InputChannel::~InputChannel() {
 
 status_t InputChannel::openInputChannelPair(const std::string& name,
                                             std::unique_ptr<InputChannel>& outServerChannel,
-                                            std::unique_ptr<InputChannel>& outClientChannel) {
+                                            std::unique_ptr<InputChannel>& outClientChannel,
+                                            bool useSharedMemory) {
     int sockets[2];
     if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sockets)) {
         status_t result = -errno;
@@ -457,6 +559,22 @@ status_t InputChannel::openInputChannelPair(const std::string& name,
     std::string clientChannelName = name + " (client)";
     android::base::unique_fd clientFd(sockets[1]);
     outClientChannel = InputChannel::create(clientChannelName, std::move(clientFd), token);
+
+    if (useSharedMemory) {
+        android::base::unique_fd ringFd = InputMessageRing::allocate(name);
+        std::shared_ptr<InputMessageRing> ring =
+                ringFd.ok() ? InputMessageRing::map(ringFd.get()) : nullptr;
+        if (!ring) {
+            ALOGW("channel '%s' ~ Sending messages through the socket instead of shared memory",
+                  name.c_str());
+            return OK;
+        }
+        outServerChannel->mRing = ring;
+        outServerChannel->mWritesRing = true;
+        outServerChannel->ring.emplace(dupChannelFd(ringFd.get()));
+        outClientChannel->mRing = std::move(ring);
+        outClientChannel->ring.emplace(std::move(ringFd));
+    }
     return OK;
 }
 
@@ -468,15 +586,53 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
     const size_t msgLength = msg->size();
     InputMessage cleanMsg;
     msg->getSanitizedCopy(&cleanMsg);
+
+    status_t status;
+    if (writesRing()) {
+        bool wakeUpReader = false;
+        status = mRing->write(cleanMsg, msgLength, &wakeUpReader);
+        // Without a wakeup, the socket doesn't tell that the client is gone. A dead client never
+        // empties the ring, so report it rather than waiting for it.
+        if (status == WOULD_BLOCK && isPeerClosed()) {
+            status = DEAD_OBJECT;
+        }
+        if (status == OK && wakeUpReader) {
+            status = sendDatagram(&RING_WAKEUP, sizeof(RING_WAKEUP));
+            // A full socket already wakes up the client.
+            if (status == WOULD_BLOCK) {
+                status = OK;
+            }
+        }
+    } else {
+        status = sendDatagram(&cleanMsg, msgLength);
+    }
+
+    if (status != OK) {
+        ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ error sending message of type %s, %s",
+                 name.c_str(), ftl::enum_string(msg->header.type).c_str(),
+                 statusToString(status).c_str());
+        return status;
+    }
+
+    ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ sent message of type %s", name.c_str(),
+             ftl::enum_string(msg->header.type).c_str());
+
+    return OK;
+}
+
+bool InputChannel::isPeerClosed() const {
+    struct pollfd pfds = {.fd = fd.get(), .events = 0};
+    return ::poll(&pfds, /*nfds=*/1, /*timeout=*/0) > 0 && (pfds.revents & (POLLHUP | POLLERR));
+}
+
+status_t InputChannel::sendDatagram(const void* data, size_t size) {
     ssize_t nWrite;
     do {
-        nWrite = ::send(getFd(), &cleanMsg, msgLength, MSG_DONTWAIT | MSG_NOSIGNAL);
+        nWrite = ::send(getFd(), data, size, MSG_DONTWAIT | MSG_NOSIGNAL);
     } while (nWrite == -1 && errno == EINTR);
 
     if (nWrite < 0) {
         int error = errno;
-        ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ error sending message of type %s, %s",
-                 name.c_str(), ftl::enum_string(msg->header.type).c_str(), strerror(error));
         if (error == EAGAIN || error == EWOULDBLOCK) {
             return WOULD_BLOCK;
         }
@@ -486,24 +642,62 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
         return -error;
     }
 
-    if (size_t(nWrite) != msgLength) {
-        ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
-                 "channel '%s' ~ error sending message type %s, send was incomplete", name.c_str(),
-                 ftl::enum_string(msg->header.type).c_str());
+    if (size_t(nWrite) != size) {
+        ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ send was incomplete", name.c_str());
         return DEAD_OBJECT;
     }
+    return OK;
+}
 
-    ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ sent message of type %s", name.c_str(),
+status_t InputChannel::receiveMessage(InputMessage* msg) {
+    const status_t status = readsRing() ? receiveRingMessage(msg) : receiveSocketMessage(msg);
+    if (status != OK) {
+        return status;
+    }
+
+    ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ received message of type %s", name.c_str(),
              ftl::enum_string(msg->header.type).c_str());
+    if (ATRACE_ENABLED()) {
+        // Add an additional trace point to include data about the received message.
+        std::string message = StringPrintf("receiveMessage(inputChannel=%s, seq=0x%" PRIx32
+                                           ", type=0x%" PRIx32 ")",
+                                           name.c_str(), msg->header.seq, msg->header.type);
+        ATRACE_NAME(message.c_str());
+    }
+    return OK;
+}
 
+status_t InputChannel::receiveRingMessage(InputMessage* msg) {
+    size_t size;
+    status_t status = mRing->read(msg, &size);
+    if (status == WOULD_BLOCK) {
+        // The ring is empty: take the wakeups sent for it, unless the socket holds a message, then
+        // check the ring again for a message sent meanwhile, which did not ask for a wakeup.
+        status = receiveSocketMessage(msg);
+        if (status != WOULD_BLOCK) {
+            return status;
+        }
+        mRing->requestWakeup();
+        status = mRing->read(msg, &size);
+    }
+    if (status != OK) {
+        return status;
+    }
+
+    if (!msg->isValid(size)) {
+        ALOGE("channel '%s' ~ received invalid message of size %zu from shared memory",
+              name.c_str(), size);
+        return BAD_VALUE;
+    }
     return OK;
 }
 
-status_t InputChannel::receiveMessage(InputMessage* msg) {
+status_t InputChannel::receiveSocketMessage(InputMessage* msg) {
     ssize_t nRead;
     do {
         nRead = ::recv(getFd(), msg, sizeof(InputMessage), MSG_DONTWAIT);
-    } while (nRead == -1 && errno == EINTR);
+    } while ((nRead == -1 && errno == EINTR) ||
+             (readsRing() && nRead == static_cast<ssize_t>(sizeof(RING_WAKEUP))));
 
     if (nRead < 0) {
         int error = errno;
@@ -528,20 +722,14 @@ status_t InputChannel::receiveMessage(InputMessage* msg) {
         ALOGE("channel '%s' ~ received invalid message of size %zd", name.c_str(), nRead);
         return BAD_VALUE;
     }
-
-    ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ received message of type %s", name.c_str(),
-             ftl::enum_string(msg->header.type).c_str());
-    if (ATRACE_ENABLED()) {
-        // Add an additional trace point to include data about the received message.
-        std::string message = StringPrintf("receiveMessage(inputChannel=%s, seq=0x%" PRIx32
-                                           ", type=0x%" PRIx32 ")",
-                                           name.c_str(), msg->header.seq, msg->header.type);
-        ATRACE_NAME(message.c_str());
-    }
     return OK;
 }
 
 bool InputChannel::probablyHasInput() const {
+    if (readsRing()) {
+        // The socket may only hold wakeups, which are not input.
+        return mRing->hasMessages();
+    }
     struct pollfd pfds = {.fd = fd.get(), .events = POLLIN};
     if (::poll(&pfds, /*nfds=*/1, /*timeout=*/0) <= 0) {
         // This can be a false negative because EINTR and ENOMEM are not handled. The latter should
@@ -561,6 +749,16 @@ void InputChannel::waitForMessage(std::chrono::milliseconds timeout) const {
     if (timeout < 0ms) {
         LOG(FATAL) << "Timeout cannot be negative, received " << timeout.count();
     }
+    if (readsRing()) {
+        if (mRing->hasMessages()) {
+            return;
+        }
+        // A pending wakeup may still be in the socket, in which case this returns early.
+        mRing->requestWakeup();
+        if (mRing->hasMessages()) {
+            return;
+        }
+    }
     struct pollfd pfds = {.fd = fd.get(), .events = POLLIN};
     int ret;
     std::chrono::time_point<std::chrono::steady_clock> stopTime =
@@ -575,13 +773,26 @@ void InputChannel::waitForMessage(std::chrono::milliseconds timeout) const {
 
 std::unique_ptr<InputChannel> InputChannel::dup() const {
     base::unique_fd newFd(dupChannelFd(fd.get()));
-    return InputChannel::create(getName(), std::move(newFd), getConnectionToken());
+    std::unique_ptr<InputChannel> channel =
+            InputChannel::create(getName(), std::move(newFd), getConnectionToken());
+    if (channel && mRing) {
+        channel->mRing = mRing;
+        channel->mWritesRing = mWritesRing;
+        channel->ring.emplace(dupChannelFd(ring->get()));
+    }
+    return channel;
 }
 
 void InputChannel::copyTo(android::os::InputChannelCore& outChannel) const {
     outChannel.name = getName();
     outChannel.fd.reset(dupChannelFd(fd.get()));
     outChannel.token = getConnectionToken();
+    // The channel which receives a ring reads it, so the server sends its messages through the
+    // socket in other processes.
+    outChannel.ring.reset();
+    if (readsRing()) {
+        outChannel.ring.emplace(dupChannelFd(ring->get()));
+    }
 }
 
 void InputChannel::moveChannel(std::unique_ptr<InputChannel> from,
@@ -589,6 +800,10 @@ void InputChannel::moveChannel(std::unique_ptr<InputChannel> from,
     outChannel.name = from->getName();
     outChannel.fd = android::os::ParcelFileDescriptor(std::move(from->fd));
     outChannel.token = from->getConnectionToken();
+    outChannel.ring.reset();
+    if (from->readsRing()) {
+        outChannel.ring = std::move(from->ring);
+    }
 }
 
 sp<IBinder> InputChannel::getConnectionToken() const {
@@ -735,6 +950,139 @@ status_t InputPublisher::publishMotionEvent(
     return mChannel->sendMessage(&msg);
 }
 
+status_t InputPublisher::publishMotionSamples(
+        int32_t deviceId, int32_t source, int32_t displayId, int32_t action, int32_t actionButton,
+        int32_t flags, int32_t edgeFlags, int32_t metaState, int32_t buttonState,
+        MotionClassification classification, const ui::Transform& transform, float xPrecision,
+        float yPrecision, float xCursorPosition, float yCursorPosition,
+        const ui::Transform& rawTransform, nsecs_t downTime, uint32_t pointerCount,
+        const PointerProperties* pointerProperties, const std::vector<MotionSample>& samples,
+        size_t* outPublishedCount) {
+    *outPublishedCount = 0;
+    if (action != AMOTION_EVENT_ACTION_MOVE && action != AMOTION_EVENT_ACTION_HOVER_MOVE) {
+        ALOGE("channel '%s' publisher ~ Only move events can be batched, not %s.",
+              mChannel->getName().c_str(), MotionEvent::actionToString(action).c_str());
+        return BAD_VALUE;
+    }
+    if (pointerCount > MAX_POINTERS || pointerCount < 1) {
+        ALOGE("channel '%s' publisher ~ Invalid number of pointers provided: %" PRIu32 ".",
+              mChannel->getName().c_str(), pointerCount);
+        return BAD_VALUE;
+    }
+
+    // The consumer reassembles the samples into one event either way, but each message costs a
+    // write and a wakeup, which add up when the consumer falls behind.
+    const size_t maxBatchSize = mConsumerVersion >= InputMessage::VERSION_MOTION_BATCH
+            ? std::min(InputMessage::Body::MotionBatch::MAX_SAMPLES,
+                       InputMessage::Body::MotionBatch::MAX_COORDS / pointerCount)
+            : 1;
+    while (*outPublishedCount < samples.size()) {
+        const MotionSample* first = &samples[*outPublishedCount];
+        const size_t batchSize = std::min(samples.size() - *outPublishedCount, maxBatchSize);
+        const status_t status = batchSize > 1
+                ? publishMotionBatch(deviceId, source, displayId, action, actionButton, flags,
+                                     edgeFlags, metaState, buttonState, classification, transform,
+                                     xPrecision, yPrecision, xCursorPosition, yCursorPosition,
+                                     rawTransform, downTime, pointerCount, pointerProperties,
+                                     first, batchSize)
+                : publishMotionEvent(first->seq, first->eventId, deviceId, source, displayId,
+                                     first->hmac, action, actionButton, flags, edgeFlags,
+                                     metaState, buttonState, classification, transform,
+                                     xPrecision, yPrecision, xCursorPosition, yCursorPosition,
+                                     rawTransform, downTime, first->eventTime, pointerCount,
+                                     pointerProperties, first->pointerCoords);
+        if (status != OK) {
+            return status;
+        }
+        *outPublishedCount += batchSize;
+    }
+    return OK;
+}
+
+status_t InputPublisher::publishMotionBatch(
+        int32_t deviceId, int32_t source, int32_t displayId, int32_t action, int32_t actionButton,
+        int32_t flags, int32_t edgeFlags, int32_t metaState, int32_t buttonState,
+        MotionClassification classification, const ui::Transform& transform, float xPrecision,
+        float yPrecision, float xCursorPosition, float yCursorPosition,
+        const ui::Transform& rawTransform, nsecs_t downTime, uint32_t pointerCount,
+        const PointerProperties* pointerProperties, const MotionSample* samples,
+        size_t sampleCount) {
+    ATRACE_NAME_IF(ATRACE_ENABLED(),
+                   StringPrintf("publishMotionBatch(inputChannel=%s, action=%s, samples=%zu)",
+                                mChannel->getName().c_str(),
+                                MotionEvent::actionToString(action).c_str(), sampleCount));
+    ALOGD_IF(debugTransportPublisher(),
+             "channel '%s' publisher ~ %s: firstSeq=%u, deviceId=%d, source=%s, action=%s, "
+             "flags=0x%x, sampleCount=%zu, pointerCount=%" PRIu32,
+             mChannel->getName().c_str(), __func__, samples[0].seq, deviceId,
+             inputEventSourceToString(source).c_str(), MotionEvent::actionToString(action).c_str(),
+             flags, sampleCount, pointerCount);
+
+    for (size_t i = 0; i < sampleCount; i++) {
+        if (!samples[i].seq) {
+            ALOGE("Attempted to publish a motion event with sequence number 0.");
+            return BAD_VALUE;
+        }
+    }
+
+    InputMessage msg;
+    msg.header.type = InputMessage::Type::MOTION_BATCH;
+    msg.header.seq = samples[0].seq;
+    InputMessage::Body::MotionBatch& batch = msg.body.motionBatch;
+    batch.sampleCount = sampleCount;
+    batch.pointerCount = pointerCount;
+    batch.deviceId = deviceId;
+    batch.source = source;
+    batch.displayId = displayId;
+    batch.action = action;
+    batch.actionButton = actionButton;
+    batch.flags = flags;
+    batch.edgeFlags = edgeFlags;
+    batch.metaState = metaState;
+    batch.buttonState = buttonState;
+    batch.classification = classification;
+    batch.dsdx = transform.dsdx();
+    batch.dtdx = transform.dtdx();
+    batch.dtdy = transform.dtdy();
+    batch.dsdy = transform.dsdy();
+    batch.tx = transform.tx();
+    batch.ty = transform.ty();
+    batch.xPrecision = xPrecision;
+    batch.yPrecision = yPrecision;
+    batch.xCursorPosition = xCursorPosition;
+    batch.yCursorPosition = yCursorPosition;
+    batch.dsdxRaw = rawTransform.dsdx();
+    batch.dtdxRaw = rawTransform.dtdx();
+    batch.dtdyRaw = rawTransform.dtdy();
+    batch.dsdyRaw = rawTransform.dsdy();
+    batch.txRaw = rawTransform.tx();
+    batch.tyRaw = rawTransform.ty();
+    batch.downTime = downTime;
+    for (uint32_t i = 0; i < pointerCount; i++) {
+        batch.pointerProperties[i] = pointerProperties[i];
+    }
+    for (size_t i = 0; i < sampleCount; i++) {
+        batch.samples[i].seq = samples[i].seq;
+        batch.samples[i].eventId = samples[i].eventId;
+        batch.samples[i].eventTime = samples[i].eventTime;
+        batch.samples[i].hmac = samples[i].hmac;
+        std::copy_n(samples[i].pointerCoords, pointerCount, &batch.coords[i * pointerCount]);
+    }
+
+    if (verifyEvents()) {
+        for (size_t i = 0; i < sampleCount; i++) {
+            Result<void> result =
+                    mInputVerifier.processMovement(deviceId, source, action, pointerCount,
+                                                   pointerProperties, samples[i].pointerCoords,
+                                                   flags);
+            if (!result.ok()) {
+                LOG(FATAL) << "Bad stream: " << result.error();
+            }
+        }
+    }
+    return mChannel->sendMessage(&msg);
+}
+
 status_t InputPublisher::publishFocusEvent(uint32_t seq, int32_t eventId, bool hasFocus) {
     ATRACE_NAME_IF(ATRACE_ENABLED(),
                    StringPrintf("publishFocusEvent(inputChannel=%s, hasFocus=%s)",
@@ -805,6 +1153,13 @@ status_t InputPublisher::publishTouchModeEvent(uint32_t seq, int32_t eventId, bo
 android::base::Result<InputPublisher::ConsumerResponse> InputPublisher::receiveConsumerResponse() {
     InputMessage msg;
     status_t result = mChannel->receiveMessage(&msg);
+    // The version of the consumer is not a response, and only changes what the publisher sends.
+    while (result == OK && msg.header.type == InputMessage::Type::VERSION) {
+        ALOGD_IF(debugTransportPublisher(), "channel '%s' publisher ~ %s: version=%" PRIu32,
+                 mChannel->getName().c_str(), __func__, msg.body.version.version);
+        mConsumerVersion = msg.body.version.version;
+        result = mChannel->receiveMessage(&msg);
+    }
     if (result) {
         if (debugTransportPublisher() && result != WOULD_BLOCK) {
             LOG(INFO) << "channel '" << mChannel->getName() << "' publisher ~ " << __func__ << ": "
@@ -845,7 +1200,16 @@ InputConsumer::InputConsumer(const std::shared_ptr<InputChannel>& channel)
 
 InputConsumer::InputConsumer(const std::shared_ptr<InputChannel>& channel,
                              bool enableTouchResampling)
-      : mResampleTouch(enableTouchResampling), mChannel(channel), mMsgDeferred(false) {}
+      : mResampleTouch(enableTouchResampling), mChannel(channel), mMsgDeferred(false) {
+    // Tell the publisher which messages it may send.
+    InputMessage msg;
+    msg.header.type = InputMessage::Type::VERSION;
+    msg.header.seq = 0;
+    msg.body.version.version = InputMessage::CURRENT_VERSION;
+    const status_t status = mChannel->sendMessage(&msg);
+    ALOGW_IF(status != OK, "channel '%s' consumer ~ Could not send the version: %s",
+             mChannel->getName().c_str(), statusToString(status).c_str());
+}
 
 InputConsumer::~InputConsumer() {
 }
@@ -872,7 +1236,7 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
             mMsgDeferred = false;
         } else {
             // Receive a fresh message.
-            status_t result = mChannel->receiveMessage(&mMsg);
+            status_t result = receiveMessage(&mMsg);
             if (result == OK) {
                 const auto [_, inserted] =
                         mConsumeTimes.emplace(mMsg.header.seq, systemTime(SYSTEM_TIME_MONOTONIC));
@@ -975,6 +1339,8 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
                 break;
             }
 
+            case InputMessage::Type::MOTION_BATCH:
+            case InputMessage::Type::VERSION:
             case InputMessage::Type::FINISHED:
             case InputMessage::Type::TIMELINE: {
                 LOG_ALWAYS_FATAL("Consumed a %s message, which should never be seen by "
@@ -1027,6 +1393,64 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
     return OK;
 }
 
+status_t InputConsumer::receiveMessage(InputMessage* msg) {
+    if (mUnbatchedMessages.empty()) {
+        status_t result = mChannel->receiveMessage(msg);
+        if (result != OK || msg->header.type != InputMessage::Type::MOTION_BATCH) {
+            return result;
+        }
+
+        // Split the batch into the motion messages the publisher would have sent otherwise, so
+        // that the samples are batched and resampled as any others.
+        const InputMessage::Body::MotionBatch& batch = msg->body.motionBatch;
+        for (uint32_t i = 0; i < batch.sampleCount; i++) {
+            InputMessage& sample = mUnbatchedMessages.emplace_back();
+            sample.header.type = InputMessage::Type::MOTION;
+            sample.header.seq = batch.samples[i].seq;
+            InputMessage::Body::Motion& motion = sample.body.motion;
+            motion.eventId = batch.samples[i].eventId;
+            motion.pointerCount = batch.pointerCount;
+            motion.eventTime = batch.samples[i].eventTime;
+            motion.deviceId = batch.deviceId;
+            motion.source = batch.source;
+            motion.displayId = batch.displayId;
+            motion.hmac = batch.samples[i].hmac;
+            motion.action = batch.action;
+            motion.actionButton = batch.actionButton;
+            motion.flags = batch.flags;
+            motion.metaState = batch.metaState;
+            motion.buttonState = batch.buttonState;
+            motion.classification = batch.classification;
+            motion.edgeFlags = batch.edgeFlags;
+            motion.downTime = batch.downTime;
+            motion.dsdx = batch.dsdx;
+            motion.dtdx = batch.dtdx;
+            motion.dtdy = batch.dtdy;
+            motion.dsdy = batch.dsdy;
+            motion.tx = batch.tx;
+            motion.ty = batch.ty;
+            motion.xPrecision = batch.xPrecision;
+            motion.yPrecision = batch.yPrecision;
+            motion.xCursorPosition = batch.xCursorPosition;
+            motion.yCursorPosition = batch.yCursorPosition;
+            motion.dsdxRaw = batch.dsdxRaw;
+            motion.dtdxRaw = batch.dtdxRaw;
+            motion.dtdyRaw = batch.dtdyRaw;
+            motion.dsdyRaw = batch.dsdyRaw;
+            motion.txRaw = batch.txRaw;
+            motion.tyRaw = batch.tyRaw;
+            for (uint32_t j = 0; j < batch.pointerCount; j++) {
+                motion.pointers[j].properties = batch.pointerProperties[j];
+                motion.pointers[j].coords = batch.coords[i * batch.pointerCount + j];
+            }
+        }
+    }
+
+    *msg = mUnbatchedMessages.front();
+    mUnbatchedMessages.pop_front();
+    return OK;
+}
+
 status_t InputConsumer::consumeBatch(InputEventFactoryInterface* factory,
         nsecs_t frameTime, uint32_t* outSeq, InputEvent** outEvent) {
     status_t result;
@@ -1082,6 +1506,8 @@ status_t InputConsumer::consumeSamples(InputEventFactoryInterface* factory,
             addSample(motionEvent, &msg);
         } else {
             initializeMotionEvent(motionEvent, &msg);
+            // One more sample for the resampled one.
+            motionEvent->reserveSamples(mResampleTouch ? count + 1 : count);
         }
         chain = msg.header.seq;
     }
@@ -1286,6 +1712,13 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
     oldLastResample.initializeFrom(touchState.lastResample);
     touchState.lastResample.eventTime = sampleTime;
     touchState.lastResample.idBits.clear();
+
+    // The coordinates of the pointers to interpolate, gathered so that they are all resampled in a
+    // single loop over contiguous arrays, which the compiler vectorizes.
+    size_t lerpCount = 0;
+    std::array<size_t, MAX_POINTERS> lerpIndices;
+    std::array<float, 2 * MAX_POINTERS> currentXY;
+    std::array<float, 2 * MAX_POINTERS> otherXY;
     for (size_t i = 0; i < pointerCount; i++) {
         uint32_t id = event->getPointerId(i);
         touchState.lastResample.idToIndex[id] = i;
@@ -1310,15 +1743,12 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
         resampledCoords.isResampled = true;
         if (other->idBits.hasBit(id) && shouldResampleTool(event->getToolType(i))) {
             const PointerCoords& otherCoords = other->getPointerById(id);
-            resampledCoords.setAxisValue(AMOTION_EVENT_AXIS_X,
-                                         lerp(currentCoords.getX(), otherCoords.getX(), alpha));
-            resampledCoords.setAxisValue(AMOTION_EVENT_AXIS_Y,
-                                         lerp(currentCoords.getY(), otherCoords.getY(), alpha));
-            ALOGD_IF(debugResampling(),
-                     "[%d] - out (%0.3f, %0.3f), cur (%0.3f, %0.3f), "
-                     "other (%0.3f, %0.3f), alpha %0.3f",
-                     id, resampledCoords.getX(), resampledCoords.getY(), currentCoords.getX(),
-                     currentCoords.getY(), otherCoords.getX(), otherCoords.getY(), alpha);
+            lerpIndices[lerpCount] = i;
+            currentXY[2 * lerpCount] = currentCoords.getX();
+            currentXY[2 * lerpCount + 1] = currentCoords.getY();
+            otherXY[2 * lerpCount] = otherCoords.getX();
+            otherXY[2 * lerpCount + 1] = otherCoords.getY();
+            lerpCount++;
         } else {
             ALOGD_IF(debugResampling(), "[%d] - out (%0.3f, %0.3f), cur (%0.3f, %0.3f)", id,
                      resampledCoords.getX(), resampledCoords.getY(), currentCoords.getX(),
@@ -1326,6 +1756,22 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
         }
     }
 
+    std::array<float, 2 * MAX_POINTERS> resampledXY;
+    for (size_t i = 0; i < 2 * lerpCount; i++) {
+        resampledXY[i] = lerp(currentXY[i], otherXY[i], alpha);
+    }
+    for (size_t i = 0; i < lerpCount; i++) {
+        PointerCoords& resampledCoords = touchState.lastResample.pointers[lerpIndices[i]];
+        resampledCoords.setAxisValue(AMOTION_EVENT_AXIS_X, resampledXY[2 * i]);
+        resampledCoords.setAxisValue(AMOTION_EVENT_AXIS_Y, resampledXY[2 * i + 1]);
+        ALOGD_IF(debugResampling(),
+                 "[%d] - out (%0.3f, %0.3f), cur (%0.3f, %0.3f), "
+                 "other (%0.3f, %0.3f), alpha %0.3f",
+                 event->getPointerId(lerpIndices[i]), resampledXY[2 * i], resampledXY[2 * i + 1],
+                 currentXY[2 * i], currentXY[2 * i + 1], otherXY[2 * i], otherXY[2 * i + 1],
+                 alpha);
+    }
+
     event->addSample(sampleTime, touchState.lastResample.pointers);
 }
 
@@ -1441,7 +1887,7 @@ int32_t InputConsumer::getPendingBatchSource() const {
 }
 
 bool InputConsumer::probablyHasInput() const {
-    return hasPendingBatch() || mChannel->probablyHasInput();
+    return hasPendingBatch() || !mUnbatchedMessages.empty() || mChannel->probablyHasInput();
 }
 
 ssize_t InputConsumer::findBatch(int32_t deviceId, int32_t source) const {
@@ -1627,6 +2073,16 @@ std::string InputConsumer::dump() const {
                                                        toString(msg.body.touchMode.isInTouchMode));
                     break;
                 }
+                case InputMessage::Type::MOTION_BATCH: {
+                    out += android::base::StringPrintf("sampleCount=%" PRIu32,
+                                                       msg.body.motionBatch.sampleCount);
+                    break;
+                }
+                case InputMessage::Type::VERSION: {
+                    out += android::base::StringPrintf("version=%" PRIu32,
+                                                       msg.body.version.version);
+                    break;
+                }
             }
             out += "\n";
         }
@@ -1634,6 +2090,7 @@ std::string InputConsumer::dump() const {
     if (mBatches.empty()) {
         out += "    <empty>\n";
     }
+    out += android::base::StringPrintf("Unbatched messages: %zu\n", mUnbatchedMessages.size());
     out += "mSeqChains:\n";
     for (const SeqChain& chain : mSeqChains) {
         out += android::base::StringPrintf("    chain: seq = %" PRIu32 " chain=%" PRIu32, chain.seq,
@@ -108,6 +108,33 @@ base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::load(const std::
     return Errorf("Load KeyCharacterMap failed {}.", status);
 }
 
+base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::load(const std::string& filename,
+                                                                     Format format,
+                                                                     const KeyMapCache& cache) {
+    // The file is stamped before it is parsed, so that its entry is parsed again if it is
+    // modified meanwhile.
+    const std::optional<KeyMapCache::Stamp> stamp = KeyMapCache::getStamp(filename);
+    if (!stamp) {
+        return load(filename, format);
+    }
+    std::shared_ptr<KeyCharacterMap> map =
+            std::shared_ptr<KeyCharacterMap>(new KeyCharacterMap(filename));
+    if (cache.read(KeyMapCache::Kind::KEY_CHARACTER_MAP, filename, *stamp,
+                   [&](KeyMapCache::Reader& reader) {
+                       return map->readFromCache(format, reader);
+                   })) {
+        return map;
+    }
+
+    auto ret = load(filename, format);
+    if (ret.ok()) {
+        KeyMapCache::Writer writer;
+        (*ret)->writeToCache(format, writer);
+        cache.write(KeyMapCache::Kind::KEY_CHARACTER_MAP, filename, *stamp, writer);
+    }
+    return ret;
+}
+
 base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::loadContents(
         const std::string& filename, const char* contents, Format format) {
     Tokenizer* tokenizer;
@@ -169,6 +196,64 @@ status_t KeyCharacterMap::reloadBaseFromFile() {
     return load(t.get(), KeyCharacterMap::Format::BASE);
 }
 
+void KeyCharacterMap::writeToCache(Format format, KeyMapCache::Writer& writer) const {
+    // The format is recorded since the parser validates the type of the map against it.
+    writer.writeInt32(static_cast<int32_t>(format));
+    writer.writeInt32(static_cast<int32_t>(mType));
+    writer.writeInt32(mKeys.size());
+    for (const auto& [keyCode, key] : mKeys) {
+        writer.writeInt32(keyCode);
+        writer.writeInt32(key.label);
+        writer.writeInt32(key.number);
+        writer.writeInt32(key.behaviors.size());
+        for (const Behavior& behavior : key.behaviors) {
+            writer.writeInt32(behavior.metaState);
+            writer.writeInt32(behavior.character);
+            writer.writeInt32(behavior.fallbackKeyCode);
+            writer.writeInt32(behavior.replacementKeyCode);
+        }
+    }
+    for (const auto* keys : {&mKeyRemapping, &mKeysByScanCode, &mKeysByUsageCode}) {
+        writer.writeInt32(keys->size());
+        for (const auto& [from, toAndroidKeyCode] : *keys) {
+            writer.writeInt32(from);
+            writer.writeInt32(toAndroidKeyCode);
+        }
+    }
+}
+
+bool KeyCharacterMap::readFromCache(Format format, KeyMapCache::Reader& reader) {
+    if (reader.readInt32() != static_cast<int32_t>(format)) {
+        return false;
+    }
+    mType = static_cast<KeyboardType>(reader.readInt32());
+    for (size_t i = reader.readCount(/*wordsPerElement=*/4); i > 0; i--) {
+        const int32_t keyCode = reader.readInt32();
+        Key key{.label = static_cast<char16_t>(reader.readInt32()),
+                .number = static_cast<char16_t>(reader.readInt32())};
+        for (size_t j = reader.readCount(/*wordsPerElement=*/4); j > 0; j--) {
+            const int32_t metaState = reader.readInt32();
+            const char16_t character = reader.readInt32();
+            const int32_t fallbackKeyCode = reader.readInt32();
+            const int32_t replacementKeyCode = reader.readInt32();
+            key.behaviors.push_back({
+                    .metaState = metaState,
+                    .character = character,
+                    .fallbackKeyCode = fallbackKeyCode,
+                    .replacementKeyCode = replacementKeyCode,
+            });
+        }
+        mKeys.insert_or_assign(keyCode, std::move(key));
+    }
+    for (auto* keys : {&mKeyRemapping, &mKeysByScanCode, &mKeysByUsageCode}) {
+        for (size_t i = reader.readCount(/*wordsPerElement=*/2); i > 0; i--) {
+            const int32_t from = reader.readInt32();
+            keys->insert_or_assign(from, reader.readInt32());
+        }
+    }
+    return !reader.hasError() && mKeys.size() <= MAX_KEYS;
+}
+
 void KeyCharacterMap::combine(const KeyCharacterMap& overlay) {
     if (mLayoutOverlayApplied) {
         reloadBaseFromFile();
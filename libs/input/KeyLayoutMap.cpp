@@ -163,6 +163,36 @@ base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(const std::string
     return ret;
 }
 
+base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(const std::string& filename,
+                                                               const KeyMapCache& cache) {
+    // The file is stamped before it is parsed, so that its entry is parsed again if it is
+    // modified meanwhile.
+    const std::optional<KeyMapCache::Stamp> stamp = KeyMapCache::getStamp(filename);
+    if (!stamp) {
+        return load(filename);
+    }
+    std::shared_ptr<KeyLayoutMap> map = std::shared_ptr<KeyLayoutMap>(new KeyLayoutMap());
+    if (cache.read(KeyMapCache::Kind::KEY_LAYOUT, filename, *stamp,
+                   [&map](KeyMapCache::Reader& reader) { return map->readFromCache(reader); })) {
+        // The kernel configs may differ from the ones of the build which wrote the entry.
+        if (!kernelConfigsArePresent(map->mRequiredKernelConfigs)) {
+            ALOGI("Not loading %s because the required kernel configs are not set",
+                  filename.c_str());
+            return Errorf("Missing kernel config");
+        }
+        map->mLoadFileName = filename;
+        return map;
+    }
+
+    auto ret = load(filename);
+    if (ret.ok()) {
+        KeyMapCache::Writer writer;
+        (*ret)->writeToCache(writer);
+        cache.write(KeyMapCache::Kind::KEY_LAYOUT, filename, *stamp, writer);
+    }
+    return ret;
+}
+
 base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(Tokenizer* tokenizer) {
     std::shared_ptr<KeyLayoutMap> map = std::shared_ptr<KeyLayoutMap>(new KeyLayoutMap());
     status_t status = OK;
@@ -296,6 +326,82 @@ std::optional<int32_t> KeyLayoutMap::findUsageCodeForLed(int32_t ledCode) const
     return std::nullopt;
 }
 
+void KeyLayoutMap::writeToCache(KeyMapCache::Writer& writer) const {
+    for (const auto* keys : {&mKeysByScanCode, &mKeysByUsageCode}) {
+        writer.writeInt32(keys->size());
+        for (const auto& [code, key] : *keys) {
+            writer.writeInt32(code);
+            writer.writeInt32(key.keyCode);
+            writer.writeInt32(key.flags);
+        }
+    }
+    writer.writeInt32(mAxes.size());
+    for (const auto& [scanCode, axisInfo] : mAxes) {
+        writer.writeInt32(scanCode);
+        writer.writeInt32(axisInfo.mode);
+        writer.writeInt32(axisInfo.axis);
+        writer.writeInt32(axisInfo.highAxis);
+        writer.writeInt32(axisInfo.splitValue);
+        writer.writeInt32(axisInfo.flatOverride);
+    }
+    for (const auto* leds : {&mLedsByScanCode, &mLedsByUsageCode}) {
+        writer.writeInt32(leds->size());
+        for (const auto& [code, led] : *leds) {
+            writer.writeInt32(code);
+            writer.writeInt32(led.ledCode);
+        }
+    }
+    writer.writeInt32(mSensorsByAbsCode.size());
+    for (const auto& [absCode, sensor] : mSensorsByAbsCode) {
+        writer.writeInt32(absCode);
+        writer.writeInt32(static_cast<int32_t>(sensor.sensorType));
+        writer.writeInt32(sensor.sensorDataIndex);
+    }
+    writer.writeInt32(mRequiredKernelConfigs.size());
+    for (const std::string& config : mRequiredKernelConfigs) {
+        writer.writeString(config);
+    }
+}
+
+bool KeyLayoutMap::readFromCache(KeyMapCache::Reader& reader) {
+    for (auto* keys : {&mKeysByScanCode, &mKeysByUsageCode}) {
+        for (size_t i = reader.readCount(/*wordsPerElement=*/3); i > 0; i--) {
+            const int32_t code = reader.readInt32();
+            const int32_t keyCode = reader.readInt32();
+            const uint32_t flags = reader.readInt32();
+            keys->insert_or_assign(code, Key{.keyCode = keyCode, .flags = flags});
+        }
+    }
+    for (size_t i = reader.readCount(/*wordsPerElement=*/6); i > 0; i--) {
+        const int32_t scanCode = reader.readInt32();
+        AxisInfo axisInfo;
+        axisInfo.mode = static_cast<AxisInfo::Mode>(reader.readInt32());
+        axisInfo.axis = reader.readInt32();
+        axisInfo.highAxis = reader.readInt32();
+        axisInfo.splitValue = reader.readInt32();
+        axisInfo.flatOverride = reader.readInt32();
+        mAxes.insert_or_assign(scanCode, axisInfo);
+    }
+    for (auto* leds : {&mLedsByScanCode, &mLedsByUsageCode}) {
+        for (size_t i = reader.readCount(/*wordsPerElement=*/2); i > 0; i--) {
+            const int32_t code = reader.readInt32();
+            leds->insert_or_assign(code, Led{.ledCode = reader.readInt32()});
+        }
+    }
+    for (size_t i = reader.readCount(/*wordsPerElement=*/3); i > 0; i--) {
+        const int32_t absCode = reader.readInt32();
+        const auto sensorType = static_cast<InputDeviceSensorType>(reader.readInt32());
+        const int32_t sensorDataIndex = reader.readInt32();
+        mSensorsByAbsCode.insert_or_assign(absCode,
+                                           Sensor{.sensorType = sensorType,
+                                                  .sensorDataIndex = sensorDataIndex});
+    }
+    for (size_t i = reader.readCount(/*wordsPerElement=*/1); i > 0; i--) {
+        mRequiredKernelConfigs.insert(reader.readString());
+    }
+    return !reader.hasError();
+}
+
 // --- KeyLayoutMap::Parser ---
 
 KeyLayoutMap::Parser::Parser(KeyLayoutMap* map, Tokenizer* tokenizer) :
@@ -0,0 +1,270 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "KeyMapCache"
+
+#include <input/KeyMapCache.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <android-base/file.h>
+#include <android-base/scopeguard.h>
+#include <android-base/stringprintf.h>
+#include <android-base/unique_fd.h>
+#include <cutils/properties.h>
+#include <log/log.h>
+
+#include <cstring>
+#include <memory>
+
+namespace android {
+
+namespace {
+
+#if defined(__ANDROID__)
+constexpr const char* DEFAULT_DIRECTORY = "/data/system/keymap_cache";
+#else
+constexpr const char* DEFAULT_DIRECTORY = "";
+#endif
+
+constexpr uint32_t MAGIC = 0x4b4d4331; // 'KMC1'
+
+// The version of the entries, which must be incremented whenever the maps are serialized
+// differently, so that the entries written by an older build are parsed again.
+constexpr uint32_t VERSION = 2;
+
+struct EntryHeader {
+    uint32_t magic;
+    uint32_t version;
+    int32_t kind;
+    // The number of words which follow the header: the path of the source file, the fingerprint
+    // of the build which wrote the entry, then the map.
+    uint32_t numWords;
+    uint32_t checksum;
+    uint32_t reserved;
+    KeyMapCache::Stamp stamp;
+};
+
+static_assert(sizeof(EntryHeader) % sizeof(int32_t) == 0);
+
+uint32_t computeChecksum(std::span<const int32_t> words) {
+    // FNV-1a over the words, to detect the entries which were corrupted on the storage.
+    uint32_t checksum = 2166136261u;
+    for (const int32_t word : words) {
+        checksum = (checksum ^ static_cast<uint32_t>(word)) * 16777619u;
+    }
+    return checksum;
+}
+
+} // namespace
+
+// --- KeyMapCache::Writer ---
+
+void KeyMapCache::Writer::writeInt32(int32_t value) {
+    mWords.push_back(value);
+}
+
+void KeyMapCache::Writer::writeString(const std::string& value) {
+    writeInt32(static_cast<int32_t>(value.size()));
+    const size_t start = mWords.size();
+    mWords.resize(start + (value.size() + sizeof(int32_t) - 1) / sizeof(int32_t), 0);
+    memcpy(mWords.data() + start, value.data(), value.size());
+}
+
+// --- KeyMapCache::Reader ---
+
+KeyMapCache::Reader::Reader(std::span<const int32_t> words) : mWords(words) {}
+
+int32_t KeyMapCache::Reader::readInt32() {
+    if (mError || mPosition == mWords.size()) {
+        mError = true;
+        return 0;
+    }
+    return mWords[mPosition++];
+}
+
+std::string KeyMapCache::Reader::readString() {
+    const int32_t size = readInt32();
+    if (mError || size < 0) {
+        mError = true;
+        return {};
+    }
+    const size_t numWords = (static_cast<size_t>(size) + sizeof(int32_t) - 1) / sizeof(int32_t);
+    if (numWords > mWords.size() - mPosition) {
+        mError = true;
+        return {};
+    }
+    std::string value(reinterpret_cast<const char*>(mWords.data() + mPosition), size);
+    mPosition += numWords;
+    return value;
+}
+
+size_t KeyMapCache::Reader::readCount(size_t wordsPerElement) {
+    const int32_t count = readInt32();
+    if (mError || count < 0 ||
+        static_cast<size_t>(count) > (mWords.size() - mPosition) / wordsPerElement) {
+        mError = true;
+        return 0;
+    }
+    return count;
+}
+
+// --- KeyMapCache ---
+
+const KeyMapCache* KeyMapCache::getDefault() {
+    static const std::unique_ptr<const KeyMapCache> sCache =
+            []() -> std::unique_ptr<const KeyMapCache> {
+        char directory[PROPERTY_VALUE_MAX];
+        property_get("ro.input.keymap_cache_dir", directory, DEFAULT_DIRECTORY);
+        if (directory[0] == '\0') {
+            return nullptr;
+        }
+        char fingerprint[PROPERTY_VALUE_MAX];
+        property_get("ro.build.fingerprint", fingerprint, "");
+        return std::make_unique<const KeyMapCache>(directory, fingerprint);
+    }();
+    return sCache.get();
+}
+
+std::optional<KeyMapCache::Stamp> KeyMapCache::getStamp(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return std::nullopt;
+    }
+    return Stamp{
+            .modificationTime = st.st_mtim.tv_sec * 1'000'000'000LL + st.st_mtim.tv_nsec,
+            .size = st.st_size,
+            .inode = static_cast<int64_t>(st.st_ino),
+            .device = static_cast<int64_t>(st.st_dev),
+    };
+}
+
+KeyMapCache::KeyMapCache(std::string directory, std::string buildFingerprint)
+      : mDirectory(std::move(directory)), mBuildFingerprint(std::move(buildFingerprint)) {}
+
+std::string KeyMapCache::getEntryPath(Kind kind, const std::string& path) const {
+    // Two files whose paths have the same hash share their entry, which is then parsed again
+    // whenever the other one was loaded last, since the entry records the path.
+    return base::StringPrintf("%s/%s_%016zx", mDirectory.c_str(),
+                              kind == Kind::KEY_LAYOUT ? "kl" : "kcm",
+                              std::hash<std::string>{}(path));
+}
+
+bool KeyMapCache::read(Kind kind, const std::string& path, const Stamp& stamp,
+                       const std::function<bool(Reader&)>& readMap) const {
+    const std::string entryPath = getEntryPath(kind, path);
+    base::unique_fd fd(open(entryPath.c_str(), O_RDONLY | O_CLOEXEC));
+    if (!fd.ok()) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd.get(), &st) != 0 || st.st_size < static_cast<off_t>(sizeof(EntryHeader)) ||
+        (st.st_size - sizeof(EntryHeader)) % sizeof(int32_t) != 0) {
+        ALOGW("Ignoring the invalid key map cache entry %s.", entryPath.c_str());
+        return false;
+    }
+    const size_t size = st.st_size;
+    void* const memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+    if (memory == MAP_FAILED) {
+        ALOGW("Could not map the key map cache entry %s: %s", entryPath.c_str(), strerror(errno));
+        return false;
+    }
+    auto unmap = base::make_scope_guard([memory, size] { munmap(memory, size); });
+
+    EntryHeader header;
+    memcpy(&header, memory, sizeof(header));
+    const std::span<const int32_t> words(reinterpret_cast<const int32_t*>(
+                                                 static_cast<const uint8_t*>(memory) +
+                                                 sizeof(EntryHeader)),
+                                         (size - sizeof(EntryHeader)) / sizeof(int32_t));
+    if (header.magic != MAGIC || header.version != VERSION ||
+        header.kind != static_cast<int32_t>(kind) || header.numWords != words.size()) {
+        ALOGW("Ignoring the invalid key map cache entry %s.", entryPath.c_str());
+        return false;
+    }
+    if (header.stamp != stamp) {
+        // The file was modified since it was parsed.
+        return false;
+    }
+    if (header.checksum != computeChecksum(words)) {
+        ALOGW("Ignoring the corrupted key map cache entry %s.", entryPath.c_str());
+        return false;
+    }
+
+    Reader reader(words);
+    if (reader.readString() != path) {
+        return false;
+    }
+    if (reader.readString() != mBuildFingerprint) {
+        // The entry was written by another build, whose files or parser may differ.
+        return false;
+    }
+    if (!readMap(reader) || reader.hasError() || !reader.isAtEnd()) {
+        ALOGW("Could not read the key map cache entry %s.", entryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void KeyMapCache::write(Kind kind, const std::string& path, const Stamp& stamp,
+                        const Writer& writer) const {
+    Writer entryWriter;
+    entryWriter.writeString(path);
+    entryWriter.writeString(mBuildFingerprint);
+    std::vector<int32_t>& words = entryWriter.mWords;
+    words.insert(words.end(), writer.mWords.begin(), writer.mWords.end());
+
+    const EntryHeader header{
+            .magic = MAGIC,
+            .version = VERSION,
+            .kind = static_cast<int32_t>(kind),
+            .numWords = static_cast<uint32_t>(words.size()),
+            .checksum = computeChecksum(words),
+            .reserved = 0,
+            .stamp = stamp,
+    };
+
+    if (mkdir(mDirectory.c_str(), 0770) != 0 && errno != EEXIST) {
+        ALOGW("Could not create the key map cache directory %s: %s", mDirectory.c_str(),
+              strerror(errno));
+        return;
+    }
+
+    // The entry is written to a temporary file which then replaces it, so that it is never read
+    // while it is incomplete.
+    const std::string entryPath = getEntryPath(kind, path);
+    const std::string temporaryPath = entryPath + ".tmp";
+    base::unique_fd fd(
+            open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640));
+    if (!fd.ok()) {
+        ALOGW("Could not create the key map cache entry %s: %s", temporaryPath.c_str(),
+              strerror(errno));
+        return;
+    }
+    if (!base::WriteFully(fd.get(), &header, sizeof(header)) ||
+        !base::WriteFully(fd.get(), words.data(), words.size() * sizeof(int32_t)) ||
+        rename(temporaryPath.c_str(), entryPath.c_str()) != 0) {
+        ALOGW("Could not write the key map cache entry %s: %s", entryPath.c_str(),
+              strerror(errno));
+        unlink(temporaryPath.c_str());
+    }
+}
+
+} // namespace android
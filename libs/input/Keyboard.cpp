@@ -25,12 +25,28 @@
 #include <input/InputEventLabels.h>
 #include <input/KeyCharacterMap.h>
 #include <input/KeyLayoutMap.h>
+#include <input/KeyMapCache.h>
 #include <input/Keyboard.h>
 #include <log/log.h>
 #include <utils/Errors.h>
 
 namespace android {
 
+// The maps of the devices are read from the cache when it is enabled, since the same files are
+// loaded again each time a device is added.
+static base::Result<std::shared_ptr<KeyLayoutMap>> loadCachedKeyLayoutMap(
+        const std::string& path) {
+    const KeyMapCache* cache = KeyMapCache::getDefault();
+    return cache != nullptr ? KeyLayoutMap::load(path, *cache) : KeyLayoutMap::load(path);
+}
+
+static base::Result<std::shared_ptr<KeyCharacterMap>> loadCachedKeyCharacterMap(
+        const std::string& path) {
+    const KeyMapCache* cache = KeyMapCache::getDefault();
+    return cache != nullptr ? KeyCharacterMap::load(path, KeyCharacterMap::Format::BASE, *cache)
+                            : KeyCharacterMap::load(path, KeyCharacterMap::Format::BASE);
+}
+
 static std::string getPath(const InputDeviceIdentifier& deviceIdentifier, const std::string& name,
                            InputDeviceConfigurationFileType type) {
     return name.empty()
@@ -118,7 +134,7 @@ status_t KeyMap::loadKeyLayout(const InputDeviceIdentifier& deviceIdentifier,
         return NAME_NOT_FOUND;
     }
 
-    base::Result<std::shared_ptr<KeyLayoutMap>> ret = KeyLayoutMap::load(path);
+    base::Result<std::shared_ptr<KeyLayoutMap>> ret = loadCachedKeyLayoutMap(path);
     if (ret.ok()) {
         keyLayoutMap = *ret;
         keyLayoutFile = path;
@@ -132,7 +148,7 @@ status_t KeyMap::loadKeyLayout(const InputDeviceIdentifier& deviceIdentifier,
                                                                   InputDeviceConfigurationFileType::
                                                                           KEY_LAYOUT,
                                                                   "_fallback"));
-    ret = KeyLayoutMap::load(fallbackPath);
+    ret = loadCachedKeyLayoutMap(fallbackPath);
     if (!ret.ok()) {
         return ret.error().code();
     }
@@ -149,8 +165,7 @@ status_t KeyMap::loadKeyCharacterMap(const InputDeviceIdentifier& deviceIdentifi
         return NAME_NOT_FOUND;
     }
 
-    base::Result<std::shared_ptr<KeyCharacterMap>> ret =
-            KeyCharacterMap::load(path, KeyCharacterMap::Format::BASE);
+    base::Result<std::shared_ptr<KeyCharacterMap>> ret = loadCachedKeyCharacterMap(path);
     if (!ret.ok()) {
         return ret.error().code();
     }
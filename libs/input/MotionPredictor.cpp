@@ -64,7 +64,14 @@ MotionPredictor::MotionPredictor(nsecs_t predictionTimestampOffsetNanos,
                                  ReportAtomFunction reportAtomFunction)
       : mPredictionTimestampOffsetNanos(predictionTimestampOffsetNanos),
         mCheckMotionPredictionEnabled(std::move(checkMotionPredictionEnabled)),
-        mReportAtomFunction(reportAtomFunction) {}
+        mReportAtomFunction(reportAtomFunction) {
+    // Initialise the model ahead of the first gesture, which would otherwise pay for loading and
+    // warming it up.
+    if (mCheckMotionPredictionEnabled()) {
+        mModel = TfLiteMotionPredictorModel::create();
+        LOG_ALWAYS_FATAL_IF(!mModel);
+    }
+}
 
 android::base::Result<void> MotionPredictor::record(const MotionEvent& event) {
     if (mLastEvent && mLastEvent->getDeviceId() != event.getDeviceId()) {
@@ -82,7 +89,8 @@ android::base::Result<void> MotionPredictor::record(const MotionEvent& event) {
         return {};
     }
 
-    // Initialise the model now that it's likely to be used.
+    // Initialise the model now that it's likely to be used, if prediction was disabled when the
+    // predictor was created.
     if (!mModel) {
         mModel = TfLiteMotionPredictorModel::create();
         LOG_ALWAYS_FATAL_IF(!mModel);
@@ -154,7 +162,10 @@ std::unique_ptr<MotionEvent> MotionPredictor::predict(nsecs_t timestamp) {
 
     LOG_ALWAYS_FATAL_IF(!mModel);
     mBuffers->copyTo(*mModel);
+    const nsecs_t inferenceStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
     LOG_ALWAYS_FATAL_IF(!mModel->invoke());
+    const nsecs_t inferenceLatency = systemTime(SYSTEM_TIME_MONOTONIC) - inferenceStartTime;
+    ALOGD_IF(isDebug(), "inference latency: %" PRId64 " ns", inferenceLatency);
 
     // Read out the predictions.
     const std::span<const float> predictedR = mModel->outputR();
@@ -40,6 +40,7 @@
 
 #include "tensorflow/lite/core/api/error_reporter.h"
 #include "tensorflow/lite/core/api/op_resolver.h"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/kernels/builtin_op_kernels.h"
 #include "tensorflow/lite/model.h"
@@ -100,6 +101,14 @@ int64_t parseXMLInt64(const tinyxml2::XMLElement& configRoot, const char* elemen
     return value;
 }
 
+int64_t parseOptionalXMLInt64(const tinyxml2::XMLElement& configRoot, const char* elementName,
+                              int64_t defaultValue) {
+    if (!configRoot.FirstChildElement(elementName)) {
+        return defaultValue;
+    }
+    return parseXMLInt64(configRoot, elementName);
+}
+
 float parseXMLFloat(const tinyxml2::XMLElement& configRoot, const char* elementName) {
     const tinyxml2::XMLElement* element = configRoot.FirstChildElement(elementName);
     LOG_ALWAYS_FATAL_IF(!element, "Could not find '%s' element", elementName);
@@ -281,7 +290,11 @@ std::unique_ptr<TfLiteMotionPredictorModel> TfLiteMotionPredictorModel::create()
     Config config{
             .predictionInterval = parseXMLInt64(*configRoot, "prediction-interval"),
             .distanceNoiseFloor = parseXMLFloat(*configRoot, "distance-noise-floor"),
+            .xnnpackThreads = static_cast<int32_t>(
+                    parseOptionalXMLInt64(*configRoot, "xnnpack-threads", /*defaultValue=*/0)),
     };
+    LOG_ALWAYS_FATAL_IF(config.xnnpackThreads < 0, "Invalid xnnpack-threads: %d",
+                        config.xnnpackThreads);
 
     return std::unique_ptr<TfLiteMotionPredictorModel>(
             new TfLiteMotionPredictorModel(std::move(modelBuffer), std::move(config)));
@@ -305,14 +318,36 @@ TfLiteMotionPredictorModel::TfLiteMotionPredictorModel(
         LOG_ALWAYS_FATAL("Failed to build interpreter");
     }
 
+    applyDelegate();
+
     mRunner = mInterpreter->GetSignatureRunner(SIGNATURE_KEY);
     LOG_ALWAYS_FATAL_IF(!mRunner, "Failed to find runner for signature '%s'", SIGNATURE_KEY);
 
     allocateTensors();
+    warmUp();
 }
 
 TfLiteMotionPredictorModel::~TfLiteMotionPredictorModel() {}
 
+void TfLiteMotionPredictorModel::applyDelegate() {
+    if (mConfig.xnnpackThreads == 0) {
+        return;
+    }
+
+    TfLiteXNNPackDelegateOptions options = TfLiteXNNPackDelegateOptionsDefault();
+    options.num_threads = mConfig.xnnpackThreads;
+    mDelegate = {TfLiteXNNPackDelegateCreate(&options), &TfLiteXNNPackDelegateDelete};
+    if (!mDelegate) {
+        ALOGW("Failed to create the XNNPACK delegate, running on the builtin kernels");
+        return;
+    }
+
+    // The interpreter keeps running on the builtin kernels if the delegate cannot be applied.
+    if (mInterpreter->ModifyGraphWithDelegate(mDelegate.get()) != kTfLiteOk) {
+        ALOGW("Failed to apply the XNNPACK delegate, running on the builtin kernels");
+    }
+}
+
 void TfLiteMotionPredictorModel::allocateTensors() {
     if (mRunner->AllocateTensors() != kTfLiteOk) {
         LOG_ALWAYS_FATAL("Failed to allocate tensors");
@@ -358,6 +393,17 @@ void TfLiteMotionPredictorModel::attachOutputTensors() {
     mOutputPressure = findOutputTensor(OUTPUT_PRESSURE, mRunner);
 }
 
+void TfLiteMotionPredictorModel::warmUp() {
+    ATRACE_BEGIN("TfLiteMotionPredictorModel::warmUp");
+    for (const std::span<float> input :
+         {inputR(), inputPhi(), inputPressure(), inputTilt(), inputOrientation()}) {
+        std::fill(input.begin(), input.end(), 0);
+    }
+    const bool invoked = invoke();
+    ATRACE_END();
+    LOG_ALWAYS_FATAL_IF(!invoked, "Failed to warm up the model");
+}
+
 bool TfLiteMotionPredictorModel::invoke() {
     ATRACE_BEGIN("TfLiteMotionPredictorModel::invoke");
     TfLiteStatus result = mRunner->Invoke();
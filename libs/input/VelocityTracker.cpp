@@ -176,7 +176,7 @@ std::unique_ptr<VelocityTrackerStrategy> VelocityTracker::createStrategy(
 
         case VelocityTracker::Strategy::LSQ2:
             ALOGI_IF(DEBUG_STRATEGY && !DEBUG_IMPULSE, "Initializing lsq2 strategy");
-            return std::make_unique<LeastSquaresVelocityTrackerStrategy>(2);
+            return std::make_unique<IncrementalLeastSquaresVelocityTrackerStrategy>();
 
         case VelocityTracker::Strategy::LSQ3:
             return std::make_unique<LeastSquaresVelocityTrackerStrategy>(3);
@@ -756,6 +756,118 @@ float LeastSquaresVelocityTrackerStrategy::chooseWeight(int32_t pointerId, uint3
     }
 }
 
+// --- IncrementalLeastSquaresVelocityTrackerStrategy ---
+
+IncrementalLeastSquaresVelocityTrackerStrategy::IncrementalLeastSquaresVelocityTrackerStrategy()
+      : AccumulatingVelocityTrackerStrategy(HORIZON /*horizonNanos*/,
+                                            true /*maintainHorizonDuringAdd*/) {}
+
+IncrementalLeastSquaresVelocityTrackerStrategy::~IncrementalLeastSquaresVelocityTrackerStrategy() {}
+
+void IncrementalLeastSquaresVelocityTrackerStrategy::MomentSums::add(const Movement& movement,
+                                                                     double weight) {
+    const double ti = (movement.eventTime - originTime) * 1E-9;
+    const double ti2 = ti * ti;
+    const double yi = movement.position;
+    count += weight;
+    t += weight * ti;
+    t2 += weight * ti2;
+    t3 += weight * ti2 * ti;
+    t4 += weight * ti2 * ti2;
+    y += weight * yi;
+    ty += weight * ti * yi;
+    t2y += weight * ti2 * yi;
+}
+
+void IncrementalLeastSquaresVelocityTrackerStrategy::addMovement(nsecs_t eventTime,
+                                                                 int32_t pointerId,
+                                                                 float position) {
+    // Keeps the same movements as AccumulatingVelocityTrackerStrategy::addMovement, and updates
+    // the sums along with them.
+    auto [ringBufferIt, _] = mMovements.try_emplace(pointerId, HISTORY_SIZE);
+    RingBuffer<Movement>& movements = ringBufferIt->second;
+    MomentSums& sums = mSums[pointerId];
+
+    if (movements.size() != 0 && movements.back().eventTime == eventTime) {
+        sums.add(movements.back(), -1);
+        movements.popBack();
+    }
+    if (movements.size() == movements.capacity()) {
+        sums.add(movements.front(), -1);
+        movements.popFront();
+    }
+    if (movements.size() == 0) {
+        sums = {.originTime = eventTime};
+    }
+
+    const Movement movement{eventTime, position};
+    movements.pushBack(movement);
+    sums.add(movement, 1);
+
+    while (eventTime - movements.front().eventTime > mHorizonNanos) {
+        sums.add(movements.front(), -1);
+        movements.popFront();
+    }
+
+    if (eventTime - sums.originTime > REBASE_INTERVAL) {
+        sums = {.originTime = movements.front().eventTime};
+        for (const Movement& m : movements) {
+            sums.add(m, 1);
+        }
+    }
+}
+
+void IncrementalLeastSquaresVelocityTrackerStrategy::clearPointer(int32_t pointerId) {
+    AccumulatingVelocityTrackerStrategy::clearPointer(pointerId);
+    mSums.erase(pointerId);
+}
+
+std::optional<float> IncrementalLeastSquaresVelocityTrackerStrategy::getVelocity(
+        int32_t pointerId) const {
+    const auto movementIt = mMovements.find(pointerId);
+    if (movementIt == mMovements.end() || movementIt->second.size() < 2) {
+        return std::nullopt; // not enough data
+    }
+    const RingBuffer<Movement>& movements = movementIt->second;
+    const MomentSums& sums = mSums.at(pointerId);
+
+    // Shifts the sums so that the times are relative to the latest movement, as in
+    // solveUnweightedLeastSquaresDeg2, so that the velocity is the linear coefficient of the fit.
+    const double n = movements.size();
+    const double tn = (movements.back().eventTime - sums.originTime) * 1E-9;
+    const double tn2 = tn * tn;
+    const double sxi = sums.t - n * tn;
+    const double sxi2 = sums.t2 - 2 * tn * sums.t + n * tn2;
+    const double sxi3 = sums.t3 - 3 * tn * sums.t2 + 3 * tn2 * sums.t - n * tn2 * tn;
+    const double sxi4 = sums.t4 - 4 * tn * sums.t3 + 6 * tn2 * sums.t2 - 4 * tn2 * tn * sums.t +
+            n * tn2 * tn2;
+    const double syi = sums.y;
+    const double sxiyi = sums.ty - tn * sums.y;
+    const double sxi2yi = sums.t2y - 2 * tn * sums.ty + tn2 * sums.y;
+
+    const double Sxx = sxi2 - sxi * sxi / n;
+    const double Sxy = sxiyi - sxi * syi / n;
+    if (movements.size() == 2) {
+        // There are too few movements for a quadratic fit, so the fit is linear, as when
+        // LeastSquaresVelocityTrackerStrategy lowers its degree.
+        if (Sxx < 1E-12) {
+            return std::nullopt;
+        }
+        return Sxy / Sxx;
+    }
+
+    const double Sxx2 = sxi3 - sxi * sxi2 / n;
+    const double Sx2y = sxi2yi - sxi2 * syi / n;
+    const double Sx2x2 = sxi4 - sxi2 * sxi2 / n;
+
+    const double denominator = Sxx * Sx2x2 - Sxx2 * Sxx2;
+    if (denominator == 0) {
+        ALOGW("division by 0 when computing velocity, Sxx=%f, Sx2x2=%f, Sxx2=%f", Sxx, Sx2x2, Sxx2);
+        return std::nullopt;
+    }
+    return (Sxy * Sx2x2 - Sx2y * Sxx2) / denominator;
+}
+
 // --- IntegratingVelocityTrackerStrategy ---
 
 IntegratingVelocityTrackerStrategy::IntegratingVelocityTrackerStrategy(uint32_t degree) :
@@ -21,6 +21,7 @@
 #include <unistd.h>
 #include <time.h>
 #include <errno.h>
+#include <poll.h>
 
 #include <binder/Binder.h>
 #include <binder/Parcel.h>
@@ -45,6 +46,19 @@ bool operator==(const InputChannel& left, const InputChannel& right) {
     return left.getName() == right.getName() &&
             left.getConnectionToken() == right.getConnectionToken() && lhs.st_ino == rhs.st_ino;
 }
+
+bool isReadable(const InputChannel& channel) {
+    struct pollfd pfds = {.fd = channel.getFd(), .events = POLLIN};
+    return ::poll(&pfds, /*nfds=*/1, /*timeout=*/0) == 1 && (pfds.revents & POLLIN) != 0;
+}
+
+InputMessage makeKeyMessage(uint32_t seq) {
+    InputMessage msg = {};
+    msg.header.type = InputMessage::Type::KEY;
+    msg.header.seq = seq;
+    msg.body.key.action = AKEY_EVENT_ACTION_DOWN;
+    return msg;
+}
 } // namespace
 
 class InputChannelTest : public testing::Test {
@@ -241,4 +255,129 @@ TEST_F(InputChannelTest, DuplicateChannelAndAssertEqual) {
     EXPECT_EQ(*serverChannel == *dupChan, true) << "inputchannel should be equal after duplication";
 }
 
+TEST_F(InputChannelTest, SharedMemory_ServerMessagesGoThroughTheRing) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    ASSERT_EQ(OK,
+              InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel,
+                                                 /*useSharedMemory=*/true));
+
+    EXPECT_FALSE(isReadable(*clientChannel));
+    EXPECT_FALSE(clientChannel->probablyHasInput());
+
+    for (uint32_t seq = 1; seq <= 3; seq++) {
+        const InputMessage msg = makeKeyMessage(seq);
+        EXPECT_EQ(OK, serverChannel->sendMessage(&msg));
+    }
+    EXPECT_TRUE(isReadable(*clientChannel)) << "the client should be woken up for the messages";
+    EXPECT_TRUE(clientChannel->probablyHasInput());
+
+    InputMessage msg;
+    for (uint32_t seq = 1; seq <= 3; seq++) {
+        ASSERT_EQ(OK, clientChannel->receiveMessage(&msg));
+        EXPECT_EQ(InputMessage::Type::KEY, msg.header.type);
+        EXPECT_EQ(seq, msg.header.seq) << "the messages should be received in order";
+    }
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&msg));
+    EXPECT_FALSE(clientChannel->probablyHasInput());
+    EXPECT_FALSE(isReadable(*clientChannel)) << "the client should have taken its wakeup";
+
+    // The client is woken up again once it emptied the ring.
+    const InputMessage nextMsg = makeKeyMessage(4);
+    EXPECT_EQ(OK, serverChannel->sendMessage(&nextMsg));
+    EXPECT_TRUE(isReadable(*clientChannel));
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&msg));
+    EXPECT_EQ(4u, msg.header.seq);
+
+    // The replies of the client go through the socket.
+    InputMessage reply = {};
+    reply.header.type = InputMessage::Type::FINISHED;
+    reply.header.seq = 4;
+    reply.body.finished.handled = true;
+    EXPECT_EQ(OK, clientChannel->sendMessage(&reply));
+    ASSERT_EQ(OK, serverChannel->receiveMessage(&msg));
+    EXPECT_EQ(InputMessage::Type::FINISHED, msg.header.type);
+    EXPECT_EQ(4u, msg.header.seq);
+}
+
+TEST_F(InputChannelTest, SharedMemory_SendMessage_WhenRingIsFull_ReturnsWouldBlock) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    ASSERT_EQ(OK,
+              InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel,
+                                                 /*useSharedMemory=*/true));
+
+    InputMessage serverMsg = {};
+    serverMsg.header.type = InputMessage::Type::MOTION;
+    serverMsg.body.motion.pointerCount = MAX_POINTERS;
+
+    uint32_t sent = 0;
+    status_t status;
+    while ((status = serverChannel->sendMessage(&serverMsg)) == OK) {
+        serverMsg.header.seq = ++sent;
+        ASSERT_LT(sent, 1000u) << "the ring should fill up";
+    }
+    EXPECT_EQ(WOULD_BLOCK, status);
+    EXPECT_GT(sent, 1u);
+
+    InputMessage clientMsg;
+    for (uint32_t received = 0; received < sent; received++) {
+        ASSERT_EQ(OK, clientChannel->receiveMessage(&clientMsg));
+        EXPECT_EQ(received, clientMsg.header.seq);
+        EXPECT_EQ(MAX_POINTERS, clientMsg.body.motion.pointerCount);
+    }
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&clientMsg));
+
+    // The ring takes messages again once the client read them.
+    EXPECT_EQ(OK, serverChannel->sendMessage(&serverMsg));
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&clientMsg));
+    EXPECT_EQ(sent, clientMsg.header.seq);
+}
+
+TEST_F(InputChannelTest, SharedMemory_SendMessage_WhenClientIsClosed_ReturnsDeadObject) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    ASSERT_EQ(OK,
+              InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel,
+                                                 /*useSharedMemory=*/true));
+
+    InputMessage serverMsg = {};
+    serverMsg.header.type = InputMessage::Type::MOTION;
+    serverMsg.body.motion.pointerCount = MAX_POINTERS;
+
+    // The first message wakes up the client, which then goes away without reading it.
+    ASSERT_EQ(OK, serverChannel->sendMessage(&serverMsg));
+    clientChannel.reset();
+
+    // The next messages don't send wakeups, so they go into the ring until it is full, rather
+    // than waiting for a client which is gone.
+    uint32_t sent = 1;
+    status_t status;
+    while ((status = serverChannel->sendMessage(&serverMsg)) == OK) {
+        serverMsg.header.seq = ++sent;
+        ASSERT_LT(sent, 1000u) << "the ring should fill up";
+    }
+    EXPECT_EQ(DEAD_OBJECT, status);
+    EXPECT_GT(sent, 1u);
+}
+
+TEST_F(InputChannelTest, SharedMemory_ParceledClientReadsTheRing) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    ASSERT_EQ(OK,
+              InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel,
+                                                 /*useSharedMemory=*/true));
+
+    android::os::InputChannelCore parceledChannel;
+    InputChannel::moveChannel(std::move(clientChannel), parceledChannel);
+    ASSERT_TRUE(parceledChannel.ring.has_value());
+    std::unique_ptr<InputChannel> receivedChannel =
+            InputChannel::create(std::move(parceledChannel));
+    ASSERT_NE(nullptr, receivedChannel);
+
+    const InputMessage serverMsg = makeKeyMessage(1);
+    EXPECT_EQ(OK, serverChannel->sendMessage(&serverMsg));
+
+    InputMessage clientMsg;
+    ASSERT_EQ(OK, receivedChannel->receiveMessage(&clientMsg));
+    EXPECT_EQ(1u, clientMsg.header.seq);
+    EXPECT_EQ(WOULD_BLOCK, receivedChannel->receiveMessage(&clientMsg));
+}
+
 } // namespace android
@@ -190,6 +190,28 @@ void publishMotionEvent(InputPublisher& publisher, const PublishMotionArgs& a) {
     ASSERT_EQ(OK, status) << "publisher publishMotionEvent should return OK";
 }
 
+// Publishes the moves as the samples of one motion event, with the other fields of the first one.
+status_t publishMotionSamples(InputPublisher& publisher,
+                              const std::vector<PublishMotionArgs>& moves,
+                              size_t* outPublishedCount) {
+    std::vector<InputPublisher::MotionSample> samples;
+    for (const PublishMotionArgs& move : moves) {
+        samples.push_back({.seq = move.seq,
+                           .eventId = move.eventId,
+                           .hmac = move.hmac,
+                           .eventTime = move.eventTime,
+                           .pointerCoords = move.pointerCoords.data()});
+    }
+    const PublishMotionArgs& a = moves.front();
+    return publisher.publishMotionSamples(a.deviceId, a.source, a.displayId, a.action,
+                                          a.actionButton, a.flags, a.edgeFlags, a.metaState,
+                                          a.buttonState, a.classification, a.transform,
+                                          a.xPrecision, a.yPrecision, a.xCursorPosition,
+                                          a.yCursorPosition, a.rawTransform, a.downTime,
+                                          a.pointerCount, a.pointerProperties.data(), samples,
+                                          outPublishedCount);
+}
+
 void sendAndVerifyFinishedSignal(InputConsumer& consumer, InputPublisher& publisher, uint32_t seq,
                                  nsecs_t publishTime) {
     status_t status = consumer.sendFinishedSignal(seq, false);
@@ -670,6 +692,142 @@ TEST_F(InputPublisherAndConsumerTest,
             << "publisher publishMotionEvent should return BAD_VALUE";
 }
 
+TEST_F(InputPublisherAndConsumerTest, PublishMotionSamples_EndToEnd) {
+    const nsecs_t downTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    // The publisher also receives the version of the consumer with the finished signal.
+    publishAndConsumeMotionDown(downTime);
+
+    std::vector<PublishMotionArgs> moves;
+    for (uint32_t i = 0; i < 3; i++) {
+        moves.emplace_back(AMOTION_EVENT_ACTION_MOVE, downTime,
+                           std::vector<Pointer>{Pointer{.id = 0, .x = 20.f + i, .y = 30.f + i}},
+                           /*seq=*/100 + i);
+    }
+    size_t publishedCount;
+    ASSERT_EQ(OK, publishMotionSamples(*mPublisher, moves, &publishedCount));
+    EXPECT_EQ(moves.size(), publishedCount);
+
+    uint32_t consumeSeq;
+    InputEvent* event;
+    ASSERT_EQ(OK,
+              mConsumer->consume(&mEventFactory, /*consumeBatches=*/true, -1, &consumeSeq, &event));
+    ASSERT_EQ(InputEventType::MOTION, event->getType());
+    const MotionEvent& motionEvent = static_cast<const MotionEvent&>(*event);
+    EXPECT_EQ(moves.back().seq, consumeSeq);
+    ASSERT_EQ(moves.size() - 1, motionEvent.getHistorySize());
+    for (size_t i = 0; i < moves.size(); i++) {
+        SCOPED_TRACE(i);
+        const PointerCoords& coords = moves[i].pointerCoords[0];
+        if (i < motionEvent.getHistorySize()) {
+            EXPECT_EQ(moves[i].eventTime, motionEvent.getHistoricalEventTime(i));
+            EXPECT_EQ(coords.getX(), motionEvent.getHistoricalRawPointerCoords(0, i)->getX());
+        } else {
+            EXPECT_EQ(moves[i].eventTime, motionEvent.getEventTime());
+            EXPECT_EQ(coords.getX(), motionEvent.getRawPointerCoords(0)->getX());
+        }
+    }
+
+    // Each sample is finished.
+    ASSERT_EQ(OK, mConsumer->sendFinishedSignal(consumeSeq, /*handled=*/true));
+    for (const PublishMotionArgs& move : moves) {
+        Result<InputPublisher::ConsumerResponse> result = mPublisher->receiveConsumerResponse();
+        ASSERT_TRUE(result.ok());
+        ASSERT_TRUE(std::holds_alternative<InputPublisher::Finished>(*result));
+        EXPECT_EQ(move.seq, std::get<InputPublisher::Finished>(*result).seq);
+    }
+
+    // Provide a consistent input stream - cancel the gesture that was started above
+    publishAndConsumeMotionEvent(AMOTION_EVENT_ACTION_CANCEL, downTime,
+                                 {Pointer{.id = 0, .x = 22, .y = 32}});
+}
+
+class InputPublisherTest : public testing::Test {
+protected:
+    std::unique_ptr<InputPublisher> mPublisher;
+    std::unique_ptr<InputChannel> mClientChannel;
+    const nsecs_t mDownTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    std::vector<PublishMotionArgs> mMoves;
+
+    void SetUp() override {
+        std::unique_ptr<InputChannel> serverChannel;
+        ASSERT_EQ(OK,
+                  InputChannel::openInputChannelPair("channel name", serverChannel,
+                                                     mClientChannel));
+        mPublisher = std::make_unique<InputPublisher>(std::move(serverChannel));
+
+        const std::vector<Pointer> pointers = {Pointer{.id = 0, .x = 20, .y = 30}};
+        publishMotionEvent(*mPublisher,
+                           PublishMotionArgs(AMOTION_EVENT_ACTION_DOWN, mDownTime, pointers,
+                                             /*seq=*/1));
+        for (uint32_t i = 0; i < 3; i++) {
+            mMoves.emplace_back(AMOTION_EVENT_ACTION_MOVE, mDownTime, pointers, /*seq=*/2 + i);
+        }
+    }
+
+    void sendConsumerVersion(uint32_t version) {
+        InputMessage msg;
+        msg.header.type = InputMessage::Type::VERSION;
+        msg.header.seq = 0;
+        msg.body.version.version = version;
+        ASSERT_EQ(OK, mClientChannel->sendMessage(&msg));
+        // The version is not a response.
+        Result<InputPublisher::ConsumerResponse> result = mPublisher->receiveConsumerResponse();
+        ASSERT_FALSE(result.ok());
+        ASSERT_EQ(WOULD_BLOCK, result.error().code());
+    }
+
+    void receiveMessage(InputMessage::Type type, uint32_t seq, InputMessage* msg) {
+        ASSERT_EQ(OK, mClientChannel->receiveMessage(msg));
+        EXPECT_EQ(type, msg->header.type);
+        EXPECT_EQ(seq, msg->header.seq);
+    }
+};
+
+TEST_F(InputPublisherTest, PublishMotionSamples_SendsOneMessage) {
+    ASSERT_NO_FATAL_FAILURE(sendConsumerVersion(InputMessage::CURRENT_VERSION));
+    size_t publishedCount;
+    ASSERT_EQ(OK, publishMotionSamples(*mPublisher, mMoves, &publishedCount));
+    EXPECT_EQ(mMoves.size(), publishedCount);
+
+    InputMessage msg;
+    ASSERT_NO_FATAL_FAILURE(receiveMessage(InputMessage::Type::MOTION, /*seq=*/1, &msg));
+    ASSERT_NO_FATAL_FAILURE(receiveMessage(InputMessage::Type::MOTION_BATCH, mMoves[0].seq, &msg));
+    const InputMessage::Body::MotionBatch& batch = msg.body.motionBatch;
+    ASSERT_EQ(mMoves.size(), batch.sampleCount);
+    EXPECT_EQ(1u, batch.pointerCount);
+    for (size_t i = 0; i < mMoves.size(); i++) {
+        SCOPED_TRACE(i);
+        EXPECT_EQ(mMoves[i].seq, batch.samples[i].seq);
+        EXPECT_EQ(mMoves[i].eventId, batch.samples[i].eventId);
+        EXPECT_EQ(mMoves[i].eventTime, batch.samples[i].eventTime);
+        EXPECT_EQ(mMoves[i].pointerCoords[0], batch.coords[i]);
+    }
+    EXPECT_EQ(WOULD_BLOCK, mClientChannel->receiveMessage(&msg));
+}
+
+TEST_F(InputPublisherTest, PublishMotionSamples_ToConsumerWithoutBatches_SendsMessagePerSample) {
+    size_t publishedCount;
+    ASSERT_EQ(OK, publishMotionSamples(*mPublisher, mMoves, &publishedCount));
+    EXPECT_EQ(mMoves.size(), publishedCount);
+
+    InputMessage msg;
+    ASSERT_NO_FATAL_FAILURE(receiveMessage(InputMessage::Type::MOTION, /*seq=*/1, &msg));
+    for (const PublishMotionArgs& move : mMoves) {
+        ASSERT_NO_FATAL_FAILURE(receiveMessage(InputMessage::Type::MOTION, move.seq, &msg));
+        EXPECT_EQ(move.eventTime, msg.body.motion.eventTime);
+    }
+    EXPECT_EQ(WOULD_BLOCK, mClientChannel->receiveMessage(&msg));
+}
+
+TEST_F(InputPublisherTest, PublishMotionSamples_WhenActionIsNotAMove_ReturnsError) {
+    std::vector<PublishMotionArgs> ups;
+    ups.emplace_back(AMOTION_EVENT_ACTION_UP, mDownTime,
+                     std::vector<Pointer>{Pointer{.id = 0, .x = 20, .y = 30}}, /*seq=*/2);
+    size_t publishedCount;
+    EXPECT_EQ(BAD_VALUE, publishMotionSamples(*mPublisher, ups, &publishedCount));
+    EXPECT_EQ(0u, publishedCount);
+}
+
 TEST_F(InputPublisherAndConsumerTest, PublishMultipleEvents_EndToEnd) {
     const nsecs_t downTime = systemTime(SYSTEM_TIME_MONOTONIC);
 
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <input/KeyMapCache.h>
+
+#include <android-base/file.h>
+#include <android/keycodes.h>
+#include <gtest/gtest.h>
+#include <input/KeyCharacterMap.h>
+#include <input/KeyLayoutMap.h>
+#include <linux/input.h>
+
+#include <filesystem>
+
+namespace android {
+
+namespace {
+
+constexpr const char* KEY_LAYOUT = R"(
+key 16 Q
+key 17 W
+key usage 0x0c0067 WINDOW
+axis 0x00 X flat 20
+led 0x00 NUM_LOCK
+)";
+
+constexpr const char* MODIFIED_KEY_LAYOUT = R"(
+key 16 A
+)";
+
+int32_t mapScanCode(const KeyLayoutMap& map, int32_t scanCode) {
+    int32_t keyCode;
+    uint32_t flags;
+    map.mapKey(scanCode, /*usageCode=*/0, &keyCode, &flags);
+    return keyCode;
+}
+
+} // namespace
+
+class KeyMapCacheTest : public testing::Test {
+protected:
+    KeyMapCacheTest() : mCache(mCacheDir.path, "build") {}
+
+    std::string writeFile(const std::string& name, const std::string& contents) {
+        const std::string path = std::string(mFileDir.path) + "/" + name;
+        EXPECT_TRUE(base::WriteStringToFile(contents, path));
+        return path;
+    }
+
+    size_t getNumEntries() const {
+        const std::filesystem::directory_iterator entries(mCacheDir.path);
+        return std::distance(std::filesystem::begin(entries), std::filesystem::end(entries));
+    }
+
+    void corruptEntries() const {
+        for (const auto& entry : std::filesystem::directory_iterator(mCacheDir.path)) {
+            ASSERT_TRUE(base::WriteStringToFile("corrupted", entry.path()));
+        }
+    }
+
+    TemporaryDir mFileDir;
+    TemporaryDir mCacheDir;
+    const KeyMapCache mCache;
+};
+
+TEST_F(KeyMapCacheTest, KeyLayoutMapIsReadFromItsEntry) {
+    const std::string path = writeFile("test.kl", KEY_LAYOUT);
+    ASSERT_TRUE(KeyLayoutMap::load(path, mCache).ok());
+    ASSERT_EQ(1u, getNumEntries());
+
+    base::Result<std::shared_ptr<KeyLayoutMap>> ret = KeyLayoutMap::load(path, mCache);
+    ASSERT_TRUE(ret.ok());
+    const KeyLayoutMap& map = **ret;
+    EXPECT_EQ(path, map.getLoadFileName());
+    EXPECT_EQ(AKEYCODE_Q, mapScanCode(map, KEY_Q));
+    EXPECT_EQ(AKEYCODE_W, mapScanCode(map, KEY_W));
+    EXPECT_EQ(std::vector<int32_t>{0x0c0067}, map.findUsageCodesForKey(AKEYCODE_WINDOW));
+    EXPECT_EQ(std::make_optional(0x00), map.findScanCodeForLed(ALED_NUM_LOCK));
+    const std::optional<AxisInfo> axisInfo = map.mapAxis(0x00);
+    ASSERT_TRUE(axisInfo.has_value());
+    EXPECT_EQ(AMOTION_EVENT_AXIS_X, axisInfo->axis);
+    EXPECT_EQ(20, axisInfo->flatOverride);
+}
+
+TEST_F(KeyMapCacheTest, ModifiedFileIsParsedAgain) {
+    const std::string path = writeFile("test.kl", KEY_LAYOUT);
+    ASSERT_TRUE(KeyLayoutMap::load(path, mCache).ok());
+
+    writeFile("test.kl", MODIFIED_KEY_LAYOUT);
+    base::Result<std::shared_ptr<KeyLayoutMap>> ret = KeyLayoutMap::load(path, mCache);
+    ASSERT_TRUE(ret.ok());
+    EXPECT_EQ(AKEYCODE_A, mapScanCode(**ret, KEY_Q));
+    EXPECT_EQ(AKEYCODE_UNKNOWN, mapScanCode(**ret, KEY_W));
+}
+
+TEST_F(KeyMapCacheTest, CorruptedEntryIsParsedAgain) {
+    const std::string path = writeFile("test.kl", KEY_LAYOUT);
+    ASSERT_TRUE(KeyLayoutMap::load(path, mCache).ok());
+    corruptEntries();
+
+    base::Result<std::shared_ptr<KeyLayoutMap>> ret = KeyLayoutMap::load(path, mCache);
+    ASSERT_TRUE(ret.ok());
+    EXPECT_EQ(AKEYCODE_Q, mapScanCode(**ret, KEY_Q));
+
+    // The entry was replaced with the parsed map.
+    ret = KeyLayoutMap::load(path, mCache);
+    ASSERT_TRUE(ret.ok());
+    EXPECT_EQ(AKEYCODE_Q, mapScanCode(**ret, KEY_Q));
+}
+
+TEST_F(KeyMapCacheTest, EntryOfOtherBuildIsNotRead) {
+    // The files of the system images keep their stamp across OTAs.
+    const std::string path = writeFile("test.kl", KEY_LAYOUT);
+    const std::optional<KeyMapCache::Stamp> stamp = KeyMapCache::getStamp(path);
+    ASSERT_TRUE(stamp.has_value());
+    KeyMapCache::Writer writer;
+    writer.writeInt32(1);
+    mCache.write(KeyMapCache::Kind::KEY_LAYOUT, path, *stamp, writer);
+
+    const auto readMap = [](KeyMapCache::Reader& reader) { return reader.readInt32() == 1; };
+    EXPECT_TRUE(mCache.read(KeyMapCache::Kind::KEY_LAYOUT, path, *stamp, readMap));
+    const KeyMapCache updatedCache(mCacheDir.path, "updated build");
+    EXPECT_FALSE(updatedCache.read(KeyMapCache::Kind::KEY_LAYOUT, path, *stamp, readMap));
+}
+
+TEST_F(KeyMapCacheTest, InvalidFileIsNotCached) {
+    const std::string path = base::GetExecutableDirectory() + "/data/bad_axis_label.kl";
+    ASSERT_FALSE(KeyLayoutMap::load(path, mCache).ok());
+    EXPECT_EQ(0u, getNumEntries());
+}
+
+TEST_F(KeyMapCacheTest, KeyCharacterMapIsReadFromItsEntry) {
+    const std::string path = base::GetExecutableDirectory() + "/data/german.kcm";
+    base::Result<std::shared_ptr<KeyCharacterMap>> parsed =
+            KeyCharacterMap::load(path, KeyCharacterMap::Format::OVERLAY);
+    ASSERT_TRUE(parsed.ok());
+    ASSERT_TRUE(KeyCharacterMap::load(path, KeyCharacterMap::Format::OVERLAY, mCache).ok());
+    ASSERT_EQ(1u, getNumEntries());
+
+    base::Result<std::shared_ptr<KeyCharacterMap>> cached =
+            KeyCharacterMap::load(path, KeyCharacterMap::Format::OVERLAY, mCache);
+    ASSERT_TRUE(cached.ok());
+    EXPECT_EQ(**parsed, **cached);
+}
+
+TEST_F(KeyMapCacheTest, KeyCharacterMapIsValidatedAgainstTheLoadedFormat) {
+    // The parser rejects an overlay loaded as a base map, whether it is cached or not.
+    const std::string path = base::GetExecutableDirectory() + "/data/german.kcm";
+    ASSERT_TRUE(KeyCharacterMap::load(path, KeyCharacterMap::Format::OVERLAY, mCache).ok());
+    EXPECT_FALSE(KeyCharacterMap::load(path, KeyCharacterMap::Format::BASE, mCache).ok());
+}
+
+} // namespace android
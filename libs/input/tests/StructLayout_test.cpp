@@ -107,6 +107,48 @@ void TestInputMessageAlignment() {
   CHECK_OFFSET(InputMessage::Body::TouchMode, eventId, 0);
   CHECK_OFFSET(InputMessage::Body::TouchMode, isInTouchMode, 4);
   CHECK_OFFSET(InputMessage::Body::TouchMode, empty, 5);
+
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, sampleCount, 0);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, pointerCount, 4);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, deviceId, 8);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, source, 12);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, displayId, 16);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, action, 20);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, actionButton, 24);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, flags, 28);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, metaState, 32);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, buttonState, 36);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, classification, 40);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, empty1, 41);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, edgeFlags, 44);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, downTime, 48);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, dsdx, 56);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, dtdx, 60);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, dtdy, 64);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, dsdy, 68);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, tx, 72);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, ty, 76);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, xPrecision, 80);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, yPrecision, 84);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, xCursorPosition, 88);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, yCursorPosition, 92);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, dsdxRaw, 96);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, dtdxRaw, 100);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, dtdyRaw, 104);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, dsdyRaw, 108);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, txRaw, 112);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, tyRaw, 116);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, pointerProperties, 120);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, samples, 248);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch, coords, 632);
+
+  CHECK_OFFSET(InputMessage::Body::MotionBatch::Sample, seq, 0);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch::Sample, eventId, 4);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch::Sample, eventTime, 8);
+  CHECK_OFFSET(InputMessage::Body::MotionBatch::Sample, hmac, 16);
+
+  CHECK_OFFSET(InputMessage::Body::Version, version, 0);
+  CHECK_OFFSET(InputMessage::Body::Version, empty, 4);
 }
 
 void TestHeaderSize() {
@@ -126,6 +168,12 @@ void TestBodySize() {
     static_assert(sizeof(InputMessage::Body::Capture) == 8);
     static_assert(sizeof(InputMessage::Body::Drag) == 16);
     static_assert(sizeof(InputMessage::Body::TouchMode) == 8);
+    static_assert(sizeof(InputMessage::Body::MotionBatch::Sample) == 48);
+    static_assert(sizeof(InputMessage::Body::MotionBatch) ==
+                  offsetof(InputMessage::Body::MotionBatch, coords) +
+                          sizeof(PointerCoords) * InputMessage::Body::MotionBatch::MAX_COORDS);
+    static_assert(sizeof(InputMessage::Body::MotionBatch) == 2400);
+    static_assert(sizeof(InputMessage::Body::Version) == 8);
     // Timeline
     static_assert(GraphicsTimeline::SIZE == 2);
     static_assert(sizeof(InputMessage::Body::Timeline) == 24);
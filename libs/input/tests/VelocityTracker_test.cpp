@@ -1335,6 +1335,21 @@ TEST_F(VelocityTrackerTest, LeastSquaresVelocityTrackerStrategy_Parabolic3) {
     computeAndCheckQuadraticVelocity(motions, 0E3);
 }
 
+/*
+ * Parabola :: y = 1000 * x^2, over long enough for the sums of the strategy to be rebased, and
+ * for the first movements to be dropped from them.
+ */
+TEST_F(VelocityTrackerTest, LeastSquaresVelocityTrackerStrategy_LongParabolic) {
+    std::vector<PlanarMotionEventEntry> motions;
+    for (int i = 0; i <= 125; i++) {
+        const float position = 1000 * (i * 0.008) * (i * 0.008);
+        motions.push_back({i * 8ms, {{position, position}}});
+    }
+    motions.push_back(motions.back()); // ACTION_UP
+    // The velocity is the derivative at the last movement, 2000 * 1 s.
+    computeAndCheckQuadraticVelocity(motions, 2E3);
+}
+
 // Recorded by hand on sailfish, but only the diffs are taken to test cumulative axis velocity.
 TEST_F(VelocityTrackerTest, AxisScrollVelocity) {
     std::vector<std::pair<std::chrono::nanoseconds, float>> motions = {
@@ -26,6 +26,7 @@
 #include <stdexcept>
 
 #include <math/quat.h>
+#include <math/TSimdHelpers.h>
 #include <math/TVecHelpers.h>
 
 #include  <utils/String8.h>
@@ -189,6 +190,10 @@ CONSTEXPR MATRIX PURE fastInverse3(const MATRIX& x) {
     // Importantly, our matrices are column-major!
 
     MATRIX inverted(MATRIX::NO_INIT);
+    if (MATRIX::NUM_ROWS == 3 && !simd::isConstantEvaluated() &&
+            simd::inverse3x3(x.asArray(), &inverted[0][0])) {
+        return inverted;
+    }
 
     const T a = x[0][0];
     const T b = x[1][0];
@@ -253,6 +258,11 @@ CONSTEXPR MATRIX_R PURE multiply(const MATRIX_A& lhs, const MATRIX_B& rhs) {
             "invalid dimension of matrix multiply result.");
 
     MATRIX_R res(MATRIX_R::NO_INIT);
+    if (MATRIX_A::NUM_ROWS == 4 && MATRIX_A::NUM_COLS == 4 && MATRIX_B::NUM_COLS == 4 &&
+            !simd::isConstantEvaluated() &&
+            simd::multiply4x4(lhs.asArray(), rhs.asArray(), &res[0][0])) {
+        return res;
+    }
     for (size_t col = 0; col < MATRIX_R::NUM_COLS; ++col) {
         res[col] = lhs * rhs[col];
     }
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MATH_SIMD_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MATH_SIMD_SSE2 1
+#endif
+
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define MATH_HAS_IS_CONSTANT_EVALUATED 1
+#endif
+#endif
+
+namespace android {
+namespace details {
+// -------------------------------------------------------------------------------------
+
+/*
+ * No user serviceable parts here.
+ *
+ * Don't use this file directly, instead include ui/mat*.h or math/half.h
+ */
+
+/*
+ * SIMD kernels of the float matrices and of the half conversions.
+ *
+ * Each lane goes through the same float operations as the generic templates, in the same
+ * order, so that the results are the same. The kernels return false when they are not available,
+ * in which case the callers use the generic templates. They never run in constant expressions.
+ */
+
+namespace simd {
+
+// True in constant expressions, and when that can't be known, so that the kernels don't run.
+inline constexpr bool isConstantEvaluated() noexcept {
+#if MATH_HAS_IS_CONSTANT_EVALUATED
+    return __builtin_is_constant_evaluated();
+#else
+    return true;
+#endif
+}
+
+#if MATH_SIMD_NEON
+
+typedef float32x4_t float4_t;
+typedef uint32x4_t uint4_t;
+
+inline float4_t load4(const float* p) { return vld1q_f32(p); }
+inline float4_t set4(float x, float y, float z) { return (float4_t){ x, y, z, 0.0f }; }
+inline float4_t splat4(float v) { return vdupq_n_f32(v); }
+inline float4_t zero4() { return vdupq_n_f32(0.0f); }
+inline void store4(float* p, float4_t v) { vst1q_f32(p, v); }
+inline float4_t add4(float4_t a, float4_t b) { return vaddq_f32(a, b); }
+inline float4_t sub4(float4_t a, float4_t b) { return vsubq_f32(a, b); }
+inline float4_t mul4(float4_t a, float4_t b) { return vmulq_f32(a, b); }
+inline float4_t div4(float4_t a, float4_t b) {
+#if defined(__aarch64__)
+    return vdivq_f32(a, b);
+#else
+    float va[4], vb[4];
+    vst1q_f32(va, a);
+    vst1q_f32(vb, b);
+    const float r[4] = { va[0] / vb[0], va[1] / vb[1], va[2] / vb[2], va[3] / vb[3] };
+    return vld1q_f32(r);
+#endif
+}
+// (y, z, x) and (z, x, y), the last lane is left undefined.
+inline float4_t yzx4(float4_t v) {
+    return vsetq_lane_f32(vgetq_lane_f32(v, 0), vextq_f32(v, v, 1), 2);
+}
+inline float4_t zxy4(float4_t v) {
+    return vsetq_lane_f32(vgetq_lane_f32(v, 2), vextq_f32(v, v, 3), 0);
+}
+
+inline uint4_t loadHalf4(const uint16_t* p) { return vmovl_u16(vld1_u16(p)); }
+inline void storeHalf4(uint16_t* p, uint4_t v) { vst1_u16(p, vmovn_u32(v)); }
+inline uint4_t load4(const uint32_t* p) { return vld1q_u32(p); }
+inline void store4(uint32_t* p, uint4_t v) { vst1q_u32(p, v); }
+inline uint4_t splat4(uint32_t v) { return vdupq_n_u32(v); }
+inline uint4_t and4(uint4_t a, uint4_t b) { return vandq_u32(a, b); }
+inline uint4_t or4(uint4_t a, uint4_t b) { return vorrq_u32(a, b); }
+inline uint4_t add4(uint4_t a, uint4_t b) { return vaddq_u32(a, b); }
+inline uint4_t equal4(uint4_t a, uint4_t b) { return vceqq_u32(a, b); }
+// The comparison of the values as signed integers.
+inline uint4_t greaterThan4(uint4_t a, uint4_t b) {
+    return vcgtq_s32(vreinterpretq_s32_u32(a), vreinterpretq_s32_u32(b));
+}
+// mask ? a : b
+inline uint4_t select4(uint4_t mask, uint4_t a, uint4_t b) { return vbslq_u32(mask, a, b); }
+template <int n> inline uint4_t shiftLeft4(uint4_t v) { return vshlq_n_u32(v, n); }
+template <int n> inline uint4_t shiftRight4(uint4_t v) { return vshrq_n_u32(v, n); }
+
+#elif MATH_SIMD_SSE2
+
+typedef __m128 float4_t;
+typedef __m128i uint4_t;
+
+inline float4_t load4(const float* p) { return _mm_loadu_ps(p); }
+inline float4_t set4(float x, float y, float z) { return _mm_set_ps(0.0f, z, y, x); }
+inline float4_t splat4(float v) { return _mm_set1_ps(v); }
+inline float4_t zero4() { return _mm_setzero_ps(); }
+inline void store4(float* p, float4_t v) { _mm_storeu_ps(p, v); }
+inline float4_t add4(float4_t a, float4_t b) { return _mm_add_ps(a, b); }
+inline float4_t sub4(float4_t a, float4_t b) { return _mm_sub_ps(a, b); }
+inline float4_t mul4(float4_t a, float4_t b) { return _mm_mul_ps(a, b); }
+inline float4_t div4(float4_t a, float4_t b) { return _mm_div_ps(a, b); }
+// (y, z, x) and (z, x, y), the last lane is left undefined.
+inline float4_t yzx4(float4_t v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1)); }
+inline float4_t zxy4(float4_t v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 1, 0, 2)); }
+
+inline uint4_t loadHalf4(const uint16_t* p) {
+    return _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)),
+                              _mm_setzero_si128());
+}
+inline void storeHalf4(uint16_t* p, uint4_t v) {
+    // The values fit in 16 bits, sign extending them keeps them through the signed saturation.
+    const __m128i extended = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packs_epi32(extended, extended));
+}
+inline uint4_t load4(const uint32_t* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+inline void store4(uint32_t* p, uint4_t v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+inline uint4_t splat4(uint32_t v) { return _mm_set1_epi32(static_cast<int32_t>(v)); }
+inline uint4_t and4(uint4_t a, uint4_t b) { return _mm_and_si128(a, b); }
+inline uint4_t or4(uint4_t a, uint4_t b) { return _mm_or_si128(a, b); }
+inline uint4_t add4(uint4_t a, uint4_t b) { return _mm_add_epi32(a, b); }
+inline uint4_t equal4(uint4_t a, uint4_t b) { return _mm_cmpeq_epi32(a, b); }
+// The comparison of the values as signed integers.
+inline uint4_t greaterThan4(uint4_t a, uint4_t b) { return _mm_cmpgt_epi32(a, b); }
+// mask ? a : b
+inline uint4_t select4(uint4_t mask, uint4_t a, uint4_t b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+template <int n> inline uint4_t shiftLeft4(uint4_t v) { return _mm_slli_epi32(v, n); }
+template <int n> inline uint4_t shiftRight4(uint4_t v) { return _mm_srli_epi32(v, n); }
+
+#endif
+
+#if MATH_SIMD_NEON || MATH_SIMD_SSE2
+
+// The column-major 4x4 matrix m times the vector v, accumulated from zero one column at a time.
+inline float4_t transform4(const float* m, const float* v) {
+    float4_t r = zero4();
+    for (size_t col = 0; col < 4; ++col) {
+        r = add4(r, mul4(load4(m + col * 4), splat4(v[col])));
+    }
+    return r;
+}
+
+// TMat44 * TVec4
+inline bool transform4x4(const float* lhs4x4, const float* rhs4, float* res4) {
+    store4(res4, transform4(lhs4x4, rhs4));
+    return true;
+}
+
+// TMat44 * TMat44, one column of rhs at a time.
+inline bool multiply4x4(const float* lhs4x4, const float* rhs4x4, float* res4x4) {
+    for (size_t col = 0; col < 4; ++col) {
+        store4(res4x4 + col * 4, transform4(lhs4x4, rhs4x4 + col * 4));
+    }
+    return true;
+}
+
+// The cross product of the 3 first lanes, as lane 0 = u.y * v.z - u.z * v.y and so on.
+inline float4_t cross4(float4_t u, float4_t v) {
+    return sub4(mul4(yzx4(u), zxy4(v)), mul4(zxy4(u), yzx4(v)));
+}
+
+// fastInverse3() of the column-major 3x3 matrix m: the rows of the adjugate are the cross
+// products of the columns, whose products and differences are the ones of fastInverse3().
+inline bool inverse3x3(const float* m, float* res) {
+    const float4_t c0 = set4(m[0], m[1], m[2]);
+    const float4_t c1 = set4(m[3], m[4], m[5]);
+    const float4_t c2 = set4(m[6], m[7], m[8]);
+    float rows[3][4];
+    store4(rows[0], cross4(c1, c2));
+    store4(rows[1], cross4(c2, c0));
+    store4(rows[2], cross4(c0, c1));
+
+    const float det = m[0] * rows[0][0] + m[3] * rows[1][0] + m[6] * rows[2][0];
+    const float4_t d = splat4(det);
+    for (size_t row = 0; row < 3; ++row) {
+        store4(rows[row], div4(load4(rows[row]), d));
+    }
+    for (size_t col = 0; col < 3; ++col) {
+        for (size_t row = 0; row < 3; ++row) {
+            res[col * 3 + row] = rows[row][col];
+        }
+    }
+    return true;
+}
+
+// half::ftoh() of the 4 floats.
+inline uint4_t floatToHalf4(uint4_t bits) {
+    const uint4_t s = shiftLeft4<15>(shiftRight4<31>(bits));
+    const uint4_t exponent = and4(shiftRight4<23>(bits), splat4(0xFFu));
+    const uint4_t m = and4(bits, splat4(0x7FFFFFu));
+
+    // e = exponent - 127 + 15, as a signed value.
+    const uint4_t e = add4(exponent, splat4(static_cast<uint32_t>(-127 + 15)));
+    uint4_t h = add4(or4(shiftLeft4<10>(e), shiftRight4<13>(m)),
+                     shiftRight4<12>(and4(m, splat4(0x1000u))));
+    // underflow flushes to 0, overflow sets the exponent bits of 0x31 which fit in the half.
+    h = select4(greaterThan4(e, splat4(0u)), h, splat4(0u));
+    h = select4(greaterThan4(e, splat4(0x1Eu)), splat4(0x4400u), h);
+    const uint4_t nan = select4(equal4(m, splat4(0u)), splat4(0u), splat4(0x200u));
+    h = select4(equal4(exponent, splat4(0xFFu)), or4(splat4(0x7C00u), nan), h);
+    return or4(and4(h, splat4(0x7FFFu)), s);
+}
+
+// half::htof() of the 4 halves.
+inline uint4_t halfToFloat4(uint4_t bits) {
+    const uint4_t s = shiftLeft4<31>(shiftRight4<15>(bits));
+    const uint4_t e = and4(shiftRight4<10>(bits), splat4(0x1Fu));
+    const uint4_t m = and4(bits, splat4(0x3FFu));
+
+    uint4_t f = or4(shiftLeft4<23>(add4(e, splat4(static_cast<uint32_t>(-15 + 127)))), shiftLeft4<13>(m));
+    // denormals are treated as 0.
+    f = select4(equal4(e, splat4(0u)), splat4(0u), f);
+    const uint4_t nan = select4(equal4(m, splat4(0u)), splat4(0u), splat4(0x400000u));
+    f = select4(equal4(e, splat4(0x1Fu)), or4(splat4(0x7F800000u), nan), f);
+    return or4(f, s);
+}
+
+// The number of the first floats converted, the others are left to the caller.
+inline size_t floatToHalf(const float* src, uint16_t* dst, size_t count) {
+    const size_t n = count & ~size_t(3);
+    for (size_t i = 0; i < n; i += 4) {
+        uint32_t bits[4];
+        memcpy(bits, src + i, sizeof(bits));
+        storeHalf4(dst + i, floatToHalf4(load4(bits)));
+    }
+    return n;
+}
+
+// The number of the first halves converted, the others are left to the caller.
+inline size_t halfToFloat(const uint16_t* src, float* dst, size_t count) {
+    const size_t n = count & ~size_t(3);
+    for (size_t i = 0; i < n; i += 4) {
+        uint32_t bits[4];
+        store4(bits, halfToFloat4(loadHalf4(src + i)));
+        memcpy(dst + i, bits, sizeof(bits));
+    }
+    return n;
+}
+
+#else
+
+inline bool transform4x4(const float*, const float*, float*) { return false; }
+inline bool multiply4x4(const float*, const float*, float*) { return false; }
+inline bool inverse3x3(const float*, float*) { return false; }
+inline size_t floatToHalf(const float*, uint16_t*, size_t) { return 0; }
+inline size_t halfToFloat(const uint16_t*, float*, size_t) { return 0; }
+
+#endif
+
+// The matrices of other types are left to the generic templates.
+template <typename A, typename B, typename R>
+inline bool transform4x4(const A*, const B*, R*) { return false; }
+template <typename A, typename B, typename R>
+inline bool multiply4x4(const A*, const B*, R*) { return false; }
+template <typename A, typename R>
+inline bool inverse3x3(const A*, R*) { return false; }
+
+}  // namespace simd
+
+// -------------------------------------------------------------------------------------
+}  // namespace details
+}  // namespace android
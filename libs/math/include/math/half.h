@@ -16,12 +16,15 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include <functional>
 #include <iosfwd>
 #include <limits>
 #include <type_traits>
 
+#include <math/TSimdHelpers.h>
+
 #ifndef LIKELY
 #define LIKELY_DEFINED_LOCAL
 #ifdef __cplusplus
@@ -156,6 +159,26 @@ inline CONSTEXPR android::half operator"" _hf(long double v) {
     return android::half(android::half::binary, android::half::ftoh(static_cast<float>(v)).bits);
 }
 
+static_assert(sizeof(half) == sizeof(uint16_t), "half must be stored as its bits");
+
+/*
+ * Converts count floats to halves, and count halves to floats, with the same results as the
+ * conversions of half one value at a time but with SIMD instructions when they are available.
+ */
+inline void convertToHalf(const float* src, half* dst, size_t count) noexcept {
+    size_t i = details::simd::floatToHalf(src, reinterpret_cast<uint16_t*>(dst), count);
+    for (; i < count; ++i) {
+        dst[i] = half(src[i]);
+    }
+}
+
+inline void convertToFloat(const half* src, float* dst, size_t count) noexcept {
+    size_t i = details::simd::halfToFloat(reinterpret_cast<const uint16_t*>(src), dst, count);
+    for (; i < count; ++i) {
+        dst[i] = float(src[i]);
+    }
+}
+
 } // namespace android
 
 namespace std {
@@ -19,6 +19,7 @@
 #include <math/mat3.h>
 #include <math/quat.h>
 #include <math/TMatHelpers.h>
+#include <math/TSimdHelpers.h>
 #include <math/vec3.h>
 #include <math/vec4.h>
 
@@ -524,6 +525,10 @@ template <typename T, typename U>
 CONSTEXPR typename TMat44<T>::col_type PURE operator *(const TMat44<T>& lhs, const TVec4<U>& rhs) {
     // Result is initialized to zero.
     typename TMat44<T>::col_type result;
+    if (!simd::isConstantEvaluated() &&
+            simd::transform4x4(lhs.asArray(), &rhs[0], &result[0])) {
+        return result;
+    }
     for (size_t col = 0; col < TMat44<T>::NUM_COLS; ++col) {
         result += lhs[col] * rhs[col];
     }
@@ -18,6 +18,9 @@
 
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include <vector>
 
 #include <math/half.h>
 #include <math/vec4.h>
@@ -95,6 +98,38 @@ TEST_F(HalfTest, Vec) {
 }
 
 
+TEST_F(HalfTest, BulkConversions) {
+    // All of the halves, which exercise the SIMD conversions and the remaining values.
+    std::vector<uint16_t> bits(0x10000 + 3);
+    for (size_t i = 0; i < bits.size(); ++i) {
+        bits[i] = uint16_t(i);
+    }
+    const half* halves = reinterpret_cast<const half*>(bits.data());
+    std::vector<float> floats(bits.size());
+    convertToFloat(halves, floats.data(), bits.size());
+    for (size_t i = 0; i < bits.size(); ++i) {
+        const float f = float(halves[i]);
+        EXPECT_EQ(0, memcmp(&f, &floats[i], sizeof(f))) << "half " << std::hex << bits[i];
+    }
+
+    // Floats of all of the exponents, with the mantissas around the rounding bit of the halves.
+    floats.clear();
+    for (uint32_t exponent = 0; exponent < 0x200; ++exponent) {
+        for (uint32_t mantissa : { 0x0u, 0x1u, 0xFFFu, 0x1000u, 0x1FFFu, 0x7FEFFFu, 0x7FF000u,
+                                   0x7FFFFFu, 0x2AAAAAu }) {
+            const uint32_t bits = (exponent << 23) | mantissa;
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            floats.push_back(f);
+        }
+    }
+    std::vector<half> converted(floats.size());
+    convertToHalf(floats.data(), converted.data(), floats.size());
+    for (size_t i = 0; i < floats.size(); ++i) {
+        EXPECT_EQ(half(floats[i]).getBits(), converted[i].getBits()) << "float " << floats[i];
+    }
+}
+
 TEST_F(HalfTest, Hash) {
     float4 f4a(1,2,3,4);
     float4 f4b(2,2,3,4);
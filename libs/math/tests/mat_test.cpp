@@ -150,6 +150,37 @@ TEST_F(MatTest, MiscOps) {
     }
 }
 
+TEST_F(MatTest, ProductsMatchScalarOrder) {
+    // The products may use SIMD kernels, whose results are the ones of the generic templates:
+    // each component is accumulated from zero, one column of the matrix at a time.
+    const mat4 m0(vec4(0.1f, 1.7f, -3.3f, 0.25f), vec4(2.2f, -0.7f, 0.9f, 1.3f),
+                  vec4(-1.9f, 0.45f, 3.1f, -0.6f), vec4(0.8f, -2.4f, 1.05f, 1.0f));
+    const mat4 m1(vec4(1.5f, -0.3f, 0.7f, 2.1f), vec4(-1.2f, 0.35f, 2.6f, -0.9f),
+                  vec4(0.55f, 1.9f, -0.15f, 0.4f), vec4(-2.7f, 0.6f, 1.25f, 1.0f));
+    auto transform = [](const mat4& m, const vec4& v) {
+        vec4 r;
+        for (size_t row = 0; row < 4; ++row) {
+            float sum = 0;
+            for (size_t col = 0; col < 4; ++col) {
+                const float product = m[col][row] * v[col];
+                sum = sum + product;
+            }
+            r[row] = sum;
+        }
+        return r;
+    };
+
+    const vec4 v(0.3f, -1.1f, 2.9f, 1.0f);
+    EXPECT_EQ(transform(m0, v), m0 * v);
+    const mat4 product = m0 * m1;
+    for (size_t col = 0; col < 4; ++col) {
+        EXPECT_EQ(transform(m0, m1[col]), product[col]);
+    }
+    mat4 m2 = m0;
+    m2 *= m1;
+    EXPECT_EQ(product, m2);
+}
+
 TEST_F(MatTest, ElementAccess) {
     mat4 m(vec4(1, 2, 3, 4), vec4(5, 6, 7, 8), vec4(9, 10, 11, 12), vec4(13, 14, 15, 16));
     for (size_t c=0 ; c<4 ; c++) {
@@ -270,6 +301,22 @@ TEST_F(Mat3Test, MiscOps) {
     EXPECT_EQ(m1, m1*identity);
 }
 
+TEST_F(Mat3Test, InverseMatchesScalarOrder) {
+    // The inverse may use SIMD kernels, whose results are the ones of the analytic inverse.
+    const mat3 m(vec3(0.41f, 0.21f, 0.02f), vec3(0.36f, 0.72f, 0.12f), vec3(0.18f, 0.07f, 0.95f));
+    const float a = m[0][0], b = m[1][0], c = m[2][0];
+    const float d = m[0][1], e = m[1][1], f = m[2][1];
+    const float g = m[0][2], h = m[1][2], i = m[2][2];
+    const float A = e * i - f * h;
+    const float B = f * g - d * i;
+    const float C = d * h - e * g;
+    const float det = a * A + b * B + c * C;
+    const mat3 expected(vec3(A, B, C) / det,
+                        vec3(c * h - b * i, a * i - c * g, b * g - a * h) / det,
+                        vec3(b * f - c * e, c * d - a * f, a * e - b * d) / det);
+    EXPECT_EQ(expected, inverse(m));
+}
+
 //------------------------------------------------------------------------------
 // MAT 2
 //------------------------------------------------------------------------------
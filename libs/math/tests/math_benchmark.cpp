@@ -0,0 +1,100 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <math/half.h>
+#include <math/mat3.h>
+#include <math/mat4.h>
+
+namespace android {
+
+static const mat4 kTransform(vec4(0.9f, 0.1f, -0.2f, 0.0f), vec4(-0.1f, 1.1f, 0.3f, 0.0f),
+                             vec4(0.2f, -0.3f, 0.8f, 0.0f), vec4(12.0f, -7.0f, 3.0f, 1.0f));
+
+static void BM_Mat4TimesMat4(benchmark::State& state) {
+    mat4 m = kTransform;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m);
+        mat4 r = m * kTransform;
+        benchmark::DoNotOptimize(r);
+    }
+}
+BENCHMARK(BM_Mat4TimesMat4);
+
+static void BM_Mat4TimesVec4(benchmark::State& state) {
+    // The points of a batch of samples, as the sensors and the layers transform them.
+    std::vector<vec4> points(state.range(0));
+    for (size_t i = 0; i < points.size(); ++i) {
+        points[i] = vec4(float(i), float(i) * 0.5f, 1.0f - float(i), 1.0f);
+    }
+    std::vector<vec4> transformed(points.size());
+    for (auto _ : state) {
+        for (size_t i = 0; i < points.size(); ++i) {
+            transformed[i] = kTransform * points[i];
+        }
+        benchmark::DoNotOptimize(transformed.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Mat4TimesVec4)->Arg(1)->Arg(64)->Arg(4096);
+
+static void BM_Mat3Inverse(benchmark::State& state) {
+    mat3 m(vec3(0.41f, 0.21f, 0.02f), vec3(0.36f, 0.72f, 0.12f), vec3(0.18f, 0.07f, 0.95f));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m);
+        mat3 r = inverse(m);
+        benchmark::DoNotOptimize(r);
+    }
+}
+BENCHMARK(BM_Mat3Inverse);
+
+static void BM_FloatToHalf(benchmark::State& state) {
+    std::vector<float> floats(state.range(0));
+    for (size_t i = 0; i < floats.size(); ++i) {
+        floats[i] = float(i) / float(floats.size()) * 4.0f - 2.0f;
+    }
+    std::vector<half> halves(floats.size());
+    for (auto _ : state) {
+        convertToHalf(floats.data(), halves.data(), floats.size());
+        benchmark::DoNotOptimize(halves.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FloatToHalf)->Arg(256)->Arg(65536);
+
+static void BM_HalfToFloat(benchmark::State& state) {
+    std::vector<half> halves(state.range(0));
+    for (size_t i = 0; i < halves.size(); ++i) {
+        halves[i] = half(float(i) / float(halves.size()) * 4.0f - 2.0f);
+    }
+    std::vector<float> floats(halves.size());
+    for (auto _ : state) {
+        convertToFloat(halves.data(), floats.data(), halves.size());
+        benchmark::DoNotOptimize(floats.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HalfToFloat)->Arg(256)->Arg(65536);
+
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -545,6 +545,13 @@ enum AHardwareBufferStatus AHardwareBuffer_setDataSpace(AHardwareBuffer* buffer,
     return filterStatus(mapper.setDataspace(gb->handle, static_cast<ui::Dataspace>(dataspace)));
 }
 
+enum AHardwareBufferStatus AHardwareBuffer_setCpuMappingCached(AHardwareBuffer* buffer,
+                                                               bool cached) {
+    GraphicBuffer* gb = AHardwareBuffer_to_GraphicBuffer(buffer);
+    if (!gb) return AHARDWAREBUFFER_STATUS_BAD_VALUE;
+    return filterStatus(gb->setCpuMappingCached(cached));
+}
+
 // ----------------------------------------------------------------------------
 // VNDK functions
 // ----------------------------------------------------------------------------
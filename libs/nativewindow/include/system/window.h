@@ -257,6 +257,8 @@ enum {
     NATIVE_WINDOW_SET_QUERY_INTERCEPTOR           = 47,    /* private */
     NATIVE_WINDOW_SET_FRAME_TIMELINE_INFO         = 48,    /* private */
     NATIVE_WINDOW_GET_LAST_QUEUED_BUFFER2         = 49,    /* private */
+    NATIVE_WINDOW_DEQUEUE_BUFFERS                 = 50,    /* private */
+    NATIVE_WINDOW_CANCEL_BUFFERS                  = 51,    /* private */
     // clang-format on
 };
 
@@ -1182,6 +1184,34 @@ static inline int native_window_set_frame_timeline_info(
     return window->perform(window, NATIVE_WINDOW_SET_FRAME_TIMELINE_INFO, frameTimelineInfo);
 }
 
+/*
+ * native_window_dequeue_buffers(..., count, outBuffers, outFenceFds)
+ * Dequeues count buffers at once, like count calls to dequeueBuffer, but with
+ * a single round trip to the consumer. On error, none of the buffers are
+ * dequeued. Windows which can't batch the operation, e.g. because buffer
+ * interceptors are installed, return INVALID_OPERATION or NAME_NOT_FOUND, and
+ * callers should then dequeue the buffers one at a time.
+ */
+static inline int native_window_dequeue_buffers(struct ANativeWindow* window, size_t count,
+                                                struct ANativeWindowBuffer** outBuffers,
+                                                int* outFenceFds) {
+    return window->perform(window, NATIVE_WINDOW_DEQUEUE_BUFFERS, count, outBuffers,
+                           outFenceFds);
+}
+
+/*
+ * native_window_cancel_buffers(..., count, buffers, fenceFds)
+ * Cancels count dequeued buffers at once, like count calls to cancelBuffer,
+ * and takes ownership of the fences. Windows which can't batch the operation
+ * return INVALID_OPERATION or NAME_NOT_FOUND without touching the buffers or
+ * the fences, and callers should then cancel the buffers one at a time.
+ */
+static inline int native_window_cancel_buffers(struct ANativeWindow* window, size_t count,
+                                               struct ANativeWindowBuffer* const* buffers,
+                                               const int* fenceFds) {
+    return window->perform(window, NATIVE_WINDOW_CANCEL_BUFFERS, count, buffers, fenceFds);
+}
+
 // ------------------------------------------------------------------------------------------------
 // Candidates for APEX visibility
 // These functions are planned to be made stable for APEX modules, but have not
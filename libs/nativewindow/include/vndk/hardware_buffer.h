@@ -22,6 +22,7 @@
 
 #include <cutils/native_handle.h>
 #include <errno.h>
+#include <stdbool.h>
 
 __BEGIN_DECLS
 
@@ -176,6 +177,25 @@ enum AHardwareBufferStatus AHardwareBuffer_setDataSpace(AHardwareBuffer* _Nonnul
                                                         enum ADataSpace dataSpace)
         __INTRODUCED_IN(__ANDROID_API_V__);
 
+/**
+ * Keeps the CPU mapping of the given AHardwareBuffer from one AHardwareBuffer_lock or
+ * AHardwareBuffer_lockAndGetInfo to the next, rather than mapping the buffer again for each lock,
+ * so that a lock and unlock pair only syncs the CPU caches with the buffer. This is meant for
+ * clients which lock the same buffer for each frame.
+ *
+ * Only single-plane, uncompressed and unprotected buffers which were allocated with CPU usage
+ * keep their mapping. Other buffers, and AHardwareBuffer_lockPlanes, lock as usual. The mapping is
+ * released when the buffer is freed, or when caching is disabled.
+ *
+ * @param buffer The non-null buffer, which must not be locked
+ * @param cached Whether to keep the CPU mapping
+ * @return AHARDWAREBUFFER_STATUS_OK on success,
+ *         AHARDWAREBUFFER_STATUS_UNSUPPORTED if the buffer is locked.
+ */
+enum AHardwareBufferStatus AHardwareBuffer_setCpuMappingCached(AHardwareBuffer* _Nonnull buffer,
+                                                               bool cached)
+        __INTRODUCED_IN(__ANDROID_API_V__);
+
 __END_DECLS
 
 #endif /* ANDROID_VNDK_NATIVEWINDOW_AHARDWAREBUFFER_H */
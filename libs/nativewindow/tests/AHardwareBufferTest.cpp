@@ -255,4 +255,44 @@ TEST(AHardwareBufferTest, GetSetDataspace) {
     }
 
     AHardwareBuffer_release(buffer);
-}
\ No newline at end of file
+}
+
+TEST(AHardwareBufferTest, CachedCpuMappingKeepsContents) {
+    AHardwareBuffer_Desc desc{
+            .width = 64,
+            .height = 48,
+            .layers = 1,
+            .format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM,
+            .usage = AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN,
+            .stride = 0,
+    };
+
+    AHardwareBuffer* buffer = nullptr;
+    ASSERT_EQ(0, AHardwareBuffer_allocate(&desc, &buffer));
+    EXPECT_EQ(AHARDWAREBUFFER_STATUS_OK, AHardwareBuffer_setCpuMappingCached(buffer, true));
+
+    // Whether or not the buffer qualifies, locks and unlocks go on as usual.
+    void* address = nullptr;
+    ASSERT_EQ(0,
+              AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr,
+                                   &address));
+    static_cast<uint8_t*>(address)[0] = 42;
+    ASSERT_EQ(0, AHardwareBuffer_unlock(buffer, nullptr));
+
+    void* cachedAddress = nullptr;
+    ASSERT_EQ(0,
+              AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, -1, nullptr,
+                                   &cachedAddress));
+    EXPECT_EQ(42, static_cast<uint8_t*>(cachedAddress)[0]);
+    ASSERT_EQ(0, AHardwareBuffer_unlock(buffer, nullptr));
+
+    // Writes through the cached mapping reach the mapper's mapping.
+    EXPECT_EQ(AHARDWAREBUFFER_STATUS_OK, AHardwareBuffer_setCpuMappingCached(buffer, false));
+    ASSERT_EQ(0,
+              AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, -1, nullptr,
+                                   &address));
+    EXPECT_EQ(42, static_cast<uint8_t*>(address)[0]);
+    ASSERT_EQ(0, AHardwareBuffer_unlock(buffer, nullptr));
+
+    AHardwareBuffer_release(buffer);
+}
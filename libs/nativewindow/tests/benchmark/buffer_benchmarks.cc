@@ -15,6 +15,7 @@
 #include <android-base/macros.h>
 #include <android/hardware_buffer.h>
 #include <benchmark/benchmark.h>
+#include <vndk/hardware_buffer.h>
 
 constexpr AHardwareBuffer_Desc k720pDesc = {.width = 1280,
                                             .height = 720,
@@ -71,4 +72,33 @@ static void BM_AHardwareBuffer_Desc(benchmark::State& state) {
 }
 BENCHMARK(BM_AHardwareBuffer_Desc);
 
+// Locks and unlocks a buffer for writing, as CPU renderers do for each frame, with the CPU mapping
+// kept across locks or not.
+static void BM_AHardwareBuffer_LockUnlock(benchmark::State& state) {
+    AHardwareBuffer_Desc desc = k720pDesc;
+    desc.usage |= AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN;
+    AHardwareBuffer* buffer = nullptr;
+    int status = AHardwareBuffer_allocate(&desc, &buffer);
+    if (UNLIKELY(status != 0)) {
+        state.SkipWithError("Unable to allocate buffer.");
+        return;
+    }
+    AHardwareBuffer_setCpuMappingCached(buffer, state.range(0) != 0);
+
+    for (auto _ : state) {
+        void* address = nullptr;
+        int status = AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1,
+                                          nullptr, &address);
+        if (UNLIKELY(status != 0)) {
+            state.SkipWithError("Unable to lock buffer.");
+            break;
+        }
+        static_cast<uint8_t*>(address)[0]++;
+        AHardwareBuffer_unlock(buffer, nullptr);
+    }
+
+    AHardwareBuffer_release(buffer);
+}
+BENCHMARK(BM_AHardwareBuffer_LockUnlock)->ArgName("cached")->Arg(0)->Arg(1);
+
 BENCHMARK_MAIN();
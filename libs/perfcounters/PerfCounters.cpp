@@ -0,0 +1,258 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PerfCounters"
+
+#include <perfcounters/PerfCounters.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <new>
+
+#include <android-base/stringprintf.h>
+#include <log/log.h>
+
+namespace android::perfcounters {
+
+namespace {
+
+template <typename Slot>
+void copyName(Slot& slot, std::string_view name) {
+    const size_t length = std::min(name.size(), kMaxNameLength - 1);
+    memcpy(slot.name, name.data(), length);
+    slot.name[length] = '\0';
+}
+
+template <typename Slot>
+bool hasName(const Slot& slot, std::string_view name) {
+    return std::string_view(slot.name) == name.substr(0, kMaxNameLength - 1);
+}
+
+// The name of the slot, which a misbehaving process may have left unterminated.
+template <typename Slot>
+std::string readName(const Slot& slot) {
+    return std::string(slot.name, strnlen(slot.name, kMaxNameLength));
+}
+
+} // namespace
+
+size_t detail::nextShard() {
+    static std::atomic<size_t> sNextShard = 0;
+    return sNextShard.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+}
+
+uint64_t Counter::get() const {
+    if (!mSlot) {
+        return 0;
+    }
+    uint64_t value = 0;
+    for (const auto& shard : mSlot->shards) {
+        value += shard.value.load(std::memory_order_relaxed);
+    }
+    return value;
+}
+
+Registry& Registry::getInstance() {
+    // Never destroyed, since metrics may still be recorded by threads which outlive static
+    // destruction.
+    static Registry* const sInstance = new Registry();
+    return *sInstance;
+}
+
+std::unique_ptr<Registry> Registry::createForTest() {
+    return std::unique_ptr<Registry>(new Registry());
+}
+
+Registry::Registry() {
+    mFd.reset(memfd_create(kRegionName, MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    if (!mFd.ok()) {
+        ALOGE("Registry: memfd creation failed (%s)", strerror(errno));
+        return;
+    }
+    // Readers can neither shrink the memory under the process nor grow it.
+    if (ftruncate(mFd.get(), sizeof(layout::Region)) != 0 ||
+        fcntl(mFd.get(), F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+        ALOGE("Registry: can't size the memory (%s)", strerror(errno));
+        mFd.reset();
+        return;
+    }
+    void* memory =
+            mmap(nullptr, sizeof(layout::Region), PROT_READ | PROT_WRITE, MAP_SHARED, mFd.get(), 0);
+    if (memory == MAP_FAILED) {
+        ALOGE("Registry: can't map the memory (%s)", strerror(errno));
+        mFd.reset();
+        return;
+    }
+
+    // The memory of a new memfd is zeroed, which is the initial state of every slot.
+    mRegion = static_cast<layout::Region*>(memory);
+    mRegion->magic = layout::kMagic;
+    mRegion->version = layout::kVersion;
+}
+
+Registry::~Registry() {
+    if (mRegion) {
+        munmap(mRegion, sizeof(layout::Region));
+    }
+}
+
+Counter Registry::getCounter(std::string_view name) {
+    if (!mRegion) {
+        return {};
+    }
+
+    std::lock_guard lock(mMutex);
+    const uint32_t count = mRegion->counterCount.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; i++) {
+        if (hasName(mRegion->counters[i], name)) {
+            return Counter(&mRegion->counters[i]);
+        }
+    }
+    if (count == kMaxCounters) {
+        ALOGE("Registry: no room for counter %.*s", static_cast<int>(name.size()), name.data());
+        return {};
+    }
+
+    layout::CounterSlot& slot = mRegion->counters[count];
+    copyName(slot, name);
+    mRegion->counterCount.store(count + 1, std::memory_order_release);
+    return Counter(&slot);
+}
+
+Histogram Registry::getHistogram(std::string_view name) {
+    if (!mRegion) {
+        return {};
+    }
+
+    std::lock_guard lock(mMutex);
+    const uint32_t count = mRegion->histogramCount.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; i++) {
+        if (hasName(mRegion->histograms[i], name)) {
+            return Histogram(&mRegion->histograms[i]);
+        }
+    }
+    if (count == kMaxHistograms) {
+        ALOGE("Registry: no room for histogram %.*s", static_cast<int>(name.size()), name.data());
+        return {};
+    }
+
+    layout::HistogramSlot& slot = mRegion->histograms[count];
+    copyName(slot, name);
+    mRegion->histogramCount.store(count + 1, std::memory_order_release);
+    return Histogram(&slot);
+}
+
+std::unique_ptr<Reader> Reader::open(base::unique_fd fd) {
+    struct stat st;
+    if (fstat(fd.get(), &st) != 0 || st.st_size < static_cast<off_t>(sizeof(layout::Region))) {
+        ALOGE("Reader: the memory is too small for a region");
+        return nullptr;
+    }
+    void* memory = mmap(nullptr, sizeof(layout::Region), PROT_READ, MAP_SHARED, fd.get(), 0);
+    if (memory == MAP_FAILED) {
+        ALOGE("Reader: can't map the memory (%s)", strerror(errno));
+        return nullptr;
+    }
+
+    const auto* region = static_cast<const layout::Region*>(memory);
+    if (region->magic != layout::kMagic || region->version != layout::kVersion) {
+        ALOGE("Reader: unsupported region version %u", region->version);
+        munmap(memory, sizeof(layout::Region));
+        return nullptr;
+    }
+    return std::unique_ptr<Reader>(new Reader(region));
+}
+
+std::unique_ptr<Reader> Reader::openForPid(pid_t pid) {
+    const std::string fdDir = base::StringPrintf("/proc/%d/fd", pid);
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(fdDir.c_str()), closedir);
+    if (!dir) {
+        ALOGE("Reader: can't list the fds of %d (%s)", pid, strerror(errno));
+        return nullptr;
+    }
+
+    // The link of a memfd reads as "/memfd:<name> (deleted)".
+    const std::string target = base::StringPrintf("/memfd:%s (deleted)", kRegionName);
+    while (const dirent* entry = readdir(dir.get())) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        const std::string path = fdDir + "/" + entry->d_name;
+        char link[PATH_MAX];
+        const ssize_t length = readlink(path.c_str(), link, sizeof(link));
+        if (length < 0 || std::string_view(link, static_cast<size_t>(length)) != target) {
+            continue;
+        }
+        base::unique_fd fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+        if (!fd.ok()) {
+            ALOGE("Reader: can't open the region of %d (%s)", pid, strerror(errno));
+            return nullptr;
+        }
+        return open(std::move(fd));
+    }
+    return nullptr;
+}
+
+Reader::~Reader() {
+    munmap(const_cast<layout::Region*>(mRegion), sizeof(layout::Region));
+}
+
+std::vector<CounterValue> Reader::readCounters() const {
+    const uint32_t count = std::min<uint32_t>(mRegion->counterCount.load(std::memory_order_acquire),
+                                              kMaxCounters);
+    std::vector<CounterValue> values;
+    values.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        const layout::CounterSlot& slot = mRegion->counters[i];
+        uint64_t value = 0;
+        for (const auto& shard : slot.shards) {
+            value += shard.value.load(std::memory_order_relaxed);
+        }
+        values.push_back({readName(slot), value});
+    }
+    return values;
+}
+
+std::vector<HistogramValue> Reader::readHistograms() const {
+    const uint32_t count =
+            std::min<uint32_t>(mRegion->histogramCount.load(std::memory_order_acquire),
+                               kMaxHistograms);
+    std::vector<HistogramValue> values;
+    values.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        const layout::HistogramSlot& slot = mRegion->histograms[i];
+        HistogramValue value{readName(slot), 0, 0, {}};
+        for (const auto& shard : slot.shards) {
+            value.count += shard.count.load(std::memory_order_relaxed);
+            value.sum += shard.sum.load(std::memory_order_relaxed);
+            for (size_t bucket = 0; bucket < kHistogramBucketCount; bucket++) {
+                value.buckets[bucket] += shard.buckets[bucket].load(std::memory_order_relaxed);
+            }
+        }
+        values.push_back(std::move(value));
+    }
+    return values;
+}
+
+} // namespace android::perfcounters
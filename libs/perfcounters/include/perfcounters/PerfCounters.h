@@ -0,0 +1,222 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+
+// Counters and histograms which a process registers by name, and which live in a region of shared
+// memory, so that a collector can read them at any time without IPC, and without taking any lock
+// of the process.
+//
+// Recording is lock-free: each metric is split in kShardCount shards on separate cache lines, and
+// each thread adds to the shard it was assigned to, so that threads rarely contend on a cache line.
+// The collector sums the shards. Registration takes a lock, so the metrics should be looked up once
+// and kept, e.g. as members.
+//
+// The region is a sealed memfd named kRegionName, which a collector with access to the process can
+// open through /proc/<pid>/fd, or which the process can pass to it.
+namespace android::perfcounters {
+
+constexpr char kRegionName[] = "perfcounters";
+
+constexpr size_t kShardCount = 4;
+// Including the terminating null character. Longer names are truncated.
+constexpr size_t kMaxNameLength = 64;
+constexpr size_t kMaxCounters = 128;
+constexpr size_t kMaxHistograms = 32;
+// Bucket 0 holds the value 0, and bucket i holds the values in [2^(i-1), 2^i). The last bucket
+// also holds all of the larger values.
+constexpr size_t kHistogramBucketCount = 40;
+
+namespace layout {
+
+// The layout of the shared memory. kVersion changes whenever the layout does.
+constexpr uint32_t kMagic = 0x544e4350; // "PCNT"
+constexpr uint32_t kVersion = 1;
+
+struct alignas(64) CounterShard {
+    std::atomic<uint64_t> value;
+};
+
+struct CounterSlot {
+    char name[kMaxNameLength];
+    std::array<CounterShard, kShardCount> shards;
+};
+
+struct alignas(64) HistogramShard {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::array<std::atomic<uint64_t>, kHistogramBucketCount> buckets;
+};
+
+struct HistogramSlot {
+    char name[kMaxNameLength];
+    std::array<HistogramShard, kShardCount> shards;
+};
+
+struct Region {
+    uint32_t magic;
+    uint32_t version;
+    // The slots below these counts are registered. The name of a slot is written before the count
+    // is released.
+    std::atomic<uint32_t> counterCount;
+    std::atomic<uint32_t> histogramCount;
+    std::array<CounterSlot, kMaxCounters> counters;
+    std::array<HistogramSlot, kMaxHistograms> histograms;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                      std::atomic<uint32_t>::is_always_lock_free,
+              "the metrics are shared between processes");
+
+} // namespace layout
+
+namespace detail {
+
+size_t nextShard();
+
+inline size_t threadShard() {
+    static thread_local const size_t shard = nextShard();
+    return shard;
+}
+
+} // namespace detail
+
+// A monotonic counter. A default constructed Counter records nothing.
+class Counter {
+public:
+    Counter() = default;
+
+    void add(uint64_t delta = 1) {
+        if (mSlot) {
+            mSlot->shards[detail::threadShard()].value.fetch_add(delta, std::memory_order_relaxed);
+        }
+    }
+
+    // The sum of the shards, for the process itself.
+    uint64_t get() const;
+
+private:
+    friend class Registry;
+    explicit Counter(layout::CounterSlot* slot) : mSlot(slot) {}
+
+    layout::CounterSlot* mSlot = nullptr;
+};
+
+// A histogram of power of two buckets. The unit of the values is up to the caller, and should be
+// part of the name, e.g. "surfaceflinger.frame_duration_us". A default constructed Histogram
+// records nothing.
+class Histogram {
+public:
+    Histogram() = default;
+
+    void record(uint64_t value) {
+        if (!mSlot) {
+            return;
+        }
+        layout::HistogramShard& shard = mSlot->shards[detail::threadShard()];
+        shard.buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+        shard.count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static size_t bucketOf(uint64_t value) {
+        const size_t bucket = value == 0 ? 0 : 64 - static_cast<size_t>(__builtin_clzll(value));
+        return bucket < kHistogramBucketCount ? bucket : kHistogramBucketCount - 1;
+    }
+
+private:
+    friend class Registry;
+    explicit Histogram(layout::HistogramSlot* slot) : mSlot(slot) {}
+
+    layout::HistogramSlot* mSlot = nullptr;
+};
+
+// The metrics of the process.
+class Registry {
+public:
+    // The registry of the process, whose memory is created on first use.
+    static Registry& getInstance();
+
+    // Returns the metric of the name, and registers it on its first use. Once kMaxCounters or
+    // kMaxHistograms are registered, or if the memory could not be created, the returned metric
+    // records nothing.
+    Counter getCounter(std::string_view name) EXCLUDES(mMutex);
+    Histogram getHistogram(std::string_view name) EXCLUDES(mMutex);
+
+    // The memfd of the region, or -1 if it could not be created.
+    int getFd() const { return mFd.get(); }
+
+    // For tests, which need their own region.
+    static std::unique_ptr<Registry> createForTest();
+
+    ~Registry();
+
+private:
+    Registry();
+
+    base::unique_fd mFd;
+    layout::Region* mRegion = nullptr;
+    std::mutex mMutex;
+};
+
+struct CounterValue {
+    std::string name;
+    uint64_t value;
+};
+
+struct HistogramValue {
+    std::string name;
+    uint64_t count;
+    uint64_t sum;
+    std::array<uint64_t, kHistogramBucketCount> buckets;
+};
+
+// Maps the region of a process read-only. The values are read without any synchronization with the
+// process, so the shards of a metric may be read at slightly different times.
+class Reader {
+public:
+    // Returns nullptr if the fd is not a region of a compatible version.
+    static std::unique_ptr<Reader> open(base::unique_fd fd);
+    // Finds the region among the fds of the process.
+    static std::unique_ptr<Reader> openForPid(pid_t pid);
+
+    ~Reader();
+
+    std::vector<CounterValue> readCounters() const;
+    std::vector<HistogramValue> readHistograms() const;
+
+private:
+    explicit Reader(const layout::Region* region) : mRegion(region) {}
+
+    const layout::Region* const mRegion;
+};
+
+} // namespace android::perfcounters
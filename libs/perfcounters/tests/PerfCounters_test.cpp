@@ -0,0 +1,153 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <perfcounters/PerfCounters.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace android::perfcounters {
+namespace {
+
+base::unique_fd dupFd(const Registry& registry) {
+    return base::unique_fd(fcntl(registry.getFd(), F_DUPFD_CLOEXEC, 0));
+}
+
+TEST(PerfCountersTest, CountersAreSharedByName) {
+    auto registry = Registry::createForTest();
+    ASSERT_GE(registry->getFd(), 0);
+
+    Counter first = registry->getCounter("test.first");
+    Counter again = registry->getCounter("test.first");
+    Counter second = registry->getCounter("test.second");
+    first.add();
+    again.add(2);
+    second.add(5);
+
+    EXPECT_EQ(3u, first.get());
+    EXPECT_EQ(5u, second.get());
+
+    auto reader = Reader::open(dupFd(*registry));
+    ASSERT_NE(nullptr, reader);
+    const auto counters = reader->readCounters();
+    ASSERT_EQ(2u, counters.size());
+    EXPECT_EQ("test.first", counters[0].name);
+    EXPECT_EQ(3u, counters[0].value);
+    EXPECT_EQ("test.second", counters[1].name);
+    EXPECT_EQ(5u, counters[1].value);
+}
+
+TEST(PerfCountersTest, ReaderSumsTheShardsOfAllThreads) {
+    constexpr size_t kThreadCount = 8;
+    constexpr uint64_t kIncrements = 10000;
+
+    auto registry = Registry::createForTest();
+    Counter counter = registry->getCounter("test.counter");
+    Histogram histogram = registry->getHistogram("test.histogram");
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < kThreadCount; i++) {
+        threads.emplace_back([&] {
+            for (uint64_t j = 0; j < kIncrements; j++) {
+                counter.add();
+                histogram.record(3);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto reader = Reader::open(dupFd(*registry));
+    ASSERT_NE(nullptr, reader);
+    const auto counters = reader->readCounters();
+    ASSERT_EQ(1u, counters.size());
+    EXPECT_EQ(kThreadCount * kIncrements, counters[0].value);
+
+    const auto histograms = reader->readHistograms();
+    ASSERT_EQ(1u, histograms.size());
+    EXPECT_EQ("test.histogram", histograms[0].name);
+    EXPECT_EQ(kThreadCount * kIncrements, histograms[0].count);
+    EXPECT_EQ(3 * kThreadCount * kIncrements, histograms[0].sum);
+    EXPECT_EQ(kThreadCount * kIncrements, histograms[0].buckets[Histogram::bucketOf(3)]);
+}
+
+TEST(PerfCountersTest, HistogramBuckets) {
+    EXPECT_EQ(0u, Histogram::bucketOf(0));
+    EXPECT_EQ(1u, Histogram::bucketOf(1));
+    EXPECT_EQ(2u, Histogram::bucketOf(2));
+    EXPECT_EQ(2u, Histogram::bucketOf(3));
+    EXPECT_EQ(3u, Histogram::bucketOf(4));
+    EXPECT_EQ(kHistogramBucketCount - 1, Histogram::bucketOf(UINT64_MAX));
+}
+
+TEST(PerfCountersTest, MetricsBeyondTheCapacityRecordNothing) {
+    auto registry = Registry::createForTest();
+    for (size_t i = 0; i < kMaxCounters; i++) {
+        registry->getCounter("test.counter" + std::to_string(i)).add();
+    }
+
+    Counter overflow = registry->getCounter("test.overflow");
+    overflow.add();
+    EXPECT_EQ(0u, overflow.get());
+
+    auto reader = Reader::open(dupFd(*registry));
+    ASSERT_NE(nullptr, reader);
+    EXPECT_EQ(kMaxCounters, reader->readCounters().size());
+}
+
+TEST(PerfCountersTest, LongNamesAreTruncated) {
+    auto registry = Registry::createForTest();
+    const std::string name(2 * kMaxNameLength, 'a');
+    registry->getCounter(name).add();
+    registry->getCounter(name).add();
+
+    auto reader = Reader::open(dupFd(*registry));
+    ASSERT_NE(nullptr, reader);
+    const auto counters = reader->readCounters();
+    ASSERT_EQ(1u, counters.size());
+    EXPECT_EQ(name.substr(0, kMaxNameLength - 1), counters[0].name);
+    EXPECT_EQ(2u, counters[0].value);
+}
+
+TEST(PerfCountersTest, OpenForPidFindsTheRegionOfTheProcess) {
+    Registry::getInstance().getCounter("test.instance").add();
+
+    auto reader = Reader::openForPid(getpid());
+    ASSERT_NE(nullptr, reader);
+    bool found = false;
+    for (const auto& counter : reader->readCounters()) {
+        found |= counter.name == "test.instance" && counter.value >= 1;
+    }
+    EXPECT_TRUE(found);
+}
+
+TEST(PerfCountersTest, OpenRejectsOtherMemory) {
+    base::unique_fd fd(memfd_create("not_perfcounters", MFD_CLOEXEC));
+    ASSERT_TRUE(fd.ok());
+    ASSERT_EQ(0, ftruncate(fd.get(), sizeof(layout::Region)));
+    EXPECT_EQ(nullptr, Reader::open(std::move(fd)));
+}
+
+} // namespace
+} // namespace android::perfcounters
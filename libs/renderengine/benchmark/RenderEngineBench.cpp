@@ -15,6 +15,7 @@
  */
 
 #include <RenderEngineBench.h>
+#include <Scene.h>
 #include <android-base/file.h>
 #include <benchmark/benchmark.h>
 #include <gui/SurfaceComposerClient.h>
@@ -23,8 +24,10 @@
 #include <renderengine/LayerSettings.h>
 #include <renderengine/RenderEngine.h>
 #include <renderengine/impl/ExternalTexture.h>
+#include <utils/Timers.h>
 
 #include <mutex>
+#include <string>
 
 using namespace android;
 using namespace android::renderengine;
@@ -134,32 +137,46 @@ static std::shared_ptr<ExternalTexture> copyBuffer(RenderEngine& re,
 /**
  * Helper for timing calls to drawLayers.
  *
- * Caller needs to create RenderEngine and the LayerSettings, and this takes
- * care of setting up the display, starting and stopping the timer, calling
- * drawLayers, and saving (if --save is used).
+ * Caller needs to create RenderEngine, the DisplaySettings and the LayerSettings,
+ * and this takes care of starting and stopping the timer, calling drawLayers,
+ * and saving (if --save is used).
  *
  * This times both the CPU and GPU work initiated by drawLayers. All work done
- * outside of the for loop is excluded from the timing measurements.
+ * outside of the for loop is excluded from the timing measurements. The
+ * cpu_ms counter is the time until drawLayers returns its fence, including the
+ * time spent on the RenderEngine thread if it is threaded, and gpu_wait_ms the
+ * time the fence then took to signal, i.e. how long the GPU lagged behind.
  */
-static void benchDrawLayers(RenderEngine& re, const std::vector<LayerSettings>& layers,
-                            benchmark::State& benchState, const char* saveFileName) {
+static void benchDrawLayers(RenderEngine& re, const DisplaySettings& display,
+                            const std::vector<LayerSettings>& layers, benchmark::State& benchState,
+                            const char* saveFileName) {
     auto [width, height] = getDisplaySize();
     auto outputBuffer = allocateBuffer(re, width, height);
 
-    const Rect displayRect(0, 0, static_cast<int32_t>(width), static_cast<int32_t>(height));
-    DisplaySettings display{
-            .physicalDisplay = displayRect,
-            .clip = displayRect,
-            .maxLuminance = 500,
-    };
+    nsecs_t cpuTime = 0;
+    nsecs_t gpuWaitTime = 0;
 
     // This loop starts and stops the timer.
     for (auto _ : benchState) {
+        const nsecs_t start = systemTime();
         sp<Fence> waitFence =
                 re.drawLayers(display, layers, outputBuffer, base::unique_fd()).get().value();
+        const nsecs_t submitted = systemTime();
         waitFence->waitForever(LOG_TAG);
+
+        cpuTime += submitted - start;
+        const nsecs_t signalTime = waitFence->getSignalTime();
+        if (signalTime != Fence::SIGNAL_TIME_INVALID && signalTime > submitted) {
+            gpuWaitTime += signalTime - submitted;
+        }
     }
 
+    benchState.counters["cpu_ms"] = benchmark::Counter(static_cast<double>(cpuTime) / 1e6,
+                                                       benchmark::Counter::kAvgIterations);
+    benchState.counters["gpu_wait_ms"] =
+            benchmark::Counter(static_cast<double>(gpuWaitTime) / 1e6,
+                               benchmark::Counter::kAvgIterations);
+
     if (renderenginebench::save() && saveFileName) {
         // Copy to a CPU-accessible buffer so we can encode it.
         outputBuffer = copyBuffer(re, outputBuffer, GRALLOC_USAGE_SW_READ_OFTEN, "to_encode");
@@ -172,6 +189,34 @@ static void benchDrawLayers(RenderEngine& re, const std::vector<LayerSettings>&
     }
 }
 
+static void benchDrawLayers(RenderEngine& re, const std::vector<LayerSettings>& layers,
+                            benchmark::State& benchState, const char* saveFileName) {
+    auto [width, height] = getDisplaySize();
+    const Rect displayRect(0, 0, static_cast<int32_t>(width), static_cast<int32_t>(height));
+    DisplaySettings display{
+            .physicalDisplay = displayRect,
+            .clip = displayRect,
+            .maxLuminance = 500,
+    };
+    benchDrawLayers(re, display, layers, benchState, saveFileName);
+}
+
+/**
+ * Decodes the source image into a GPU-only buffer the size of the display.
+ */
+static std::shared_ptr<ExternalTexture> loadSourceImage(RenderEngine& re) {
+    // Initially use cpu access so we can decode into it with AImageDecoder.
+    auto [width, height] = getDisplaySize();
+    auto srcBuffer =
+            allocateBuffer(re, width, height, GRALLOC_USAGE_SW_WRITE_OFTEN, "decoded_source");
+    std::string srcImage = base::GetExecutableDirectory();
+    srcImage.append("/resources/homescreen.png");
+    renderenginebench::decode(srcImage.c_str(), srcBuffer->getBuffer());
+
+    // Now copy into GPU-only buffer for more realistic timing.
+    return copyBuffer(re, srcBuffer, 0, "source");
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //  Benchmarks
 ///////////////////////////////////////////////////////////////////////////////
@@ -182,18 +227,8 @@ void BM_blur(benchmark::State& benchState, Args&&... args) {
     auto re = createRenderEngine(static_cast<RenderEngine::Threaded>(std::get<0>(args_tuple)),
                                  static_cast<RenderEngine::GraphicsApi>(std::get<1>(args_tuple)));
 
-    // Initially use cpu access so we can decode into it with AImageDecoder.
     auto [width, height] = getDisplaySize();
-    auto srcBuffer =
-            allocateBuffer(*re, width, height, GRALLOC_USAGE_SW_WRITE_OFTEN, "decoded_source");
-    {
-        std::string srcImage = base::GetExecutableDirectory();
-        srcImage.append("/resources/homescreen.png");
-        renderenginebench::decode(srcImage.c_str(), srcBuffer->getBuffer());
-
-        // Now copy into GPU-only buffer for more realistic timing.
-        srcBuffer = copyBuffer(*re, srcBuffer, 0, "source");
-    }
+    auto srcBuffer = loadSourceImage(*re);
 
     const FloatRect layerRect(0, 0, width, height);
     LayerSettings layer{
@@ -226,3 +261,52 @@ void BM_blur(benchmark::State& benchState, Args&&... args) {
 
 BENCHMARK_CAPTURE(BM_blur, SkiaGLThreaded, RenderEngine::Threaded::YES,
                   RenderEngine::GraphicsApi::GL);
+
+/**
+ * Draws a scene loaded from resources/scenes, see Scene.h. The layers have no
+ * frame numbers, so every frame is drawn as if its content changed, without
+ * reusing the blurs of previous frames.
+ */
+static void BM_scene(benchmark::State& benchState, const renderenginebench::Scene& scene,
+                     RenderEngine::Threaded threaded, RenderEngine::GraphicsApi graphicsApi) {
+    auto re = createRenderEngine(threaded, graphicsApi);
+    auto srcBuffer = loadSourceImage(*re);
+
+    std::vector<LayerSettings> layers = scene.layers;
+    for (size_t index : scene.imageLayers) {
+        layers[index].source.buffer.buffer = srcBuffer;
+    }
+    benchDrawLayers(*re, scene.display, layers, benchState, scene.name.c_str());
+}
+
+namespace renderenginebench {
+
+void registerSceneBenchmarks() {
+    auto [width, height] = getDisplaySize();
+    const std::string directory = base::GetExecutableDirectory() + "/resources/scenes";
+    const std::vector<Scene> scenes = loadScenes(directory, width, height);
+    ALOGW_IF(scenes.empty(), "No scenes found in %s", directory.c_str());
+
+    struct Backend {
+        const char* name;
+        RenderEngine::Threaded threaded;
+        RenderEngine::GraphicsApi graphicsApi;
+    };
+    constexpr Backend kBackends[] = {
+            {"SkiaGLThreaded", RenderEngine::Threaded::YES, RenderEngine::GraphicsApi::GL},
+            {"SkiaGL", RenderEngine::Threaded::NO, RenderEngine::GraphicsApi::GL},
+            {"SkiaVkThreaded", RenderEngine::Threaded::YES, RenderEngine::GraphicsApi::VK},
+            {"SkiaVk", RenderEngine::Threaded::NO, RenderEngine::GraphicsApi::VK},
+    };
+
+    for (const Scene& scene : scenes) {
+        for (const Backend& backend : kBackends) {
+            if (!RenderEngine::canSupport(backend.graphicsApi)) continue;
+            const std::string name = "BM_scene/" + scene.name + "/" + backend.name;
+            benchmark::RegisterBenchmark(name.c_str(), BM_scene, scene, backend.threaded,
+                                         backend.graphicsApi);
+        }
+    }
+}
+
+} // namespace renderenginebench
@@ -42,6 +42,12 @@ void parseFlagsForHelp(int argc, char** argv);
  */
 bool save();
 
+/**
+ * Register a benchmark for each scene in resources/scenes, on each graphics
+ * API the device supports, threaded and unthreaded.
+ */
+void registerSceneBenchmarks();
+
 /**
  * Decode the image at 'path' into 'buffer'.
  *
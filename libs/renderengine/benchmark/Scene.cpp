@@ -0,0 +1,282 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Scene.h"
+
+#include <android-base/file.h>
+#include <android-base/parsedouble.h>
+#include <android-base/strings.h>
+#include <log/log.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+
+namespace renderenginebench {
+
+using aidl::android::hardware::graphics::composer3::DimmingStage;
+using renderengine::DisplaySettings;
+using renderengine::LayerSettings;
+
+namespace {
+
+constexpr const char* kSceneExtension = ".scene";
+
+// Matches the shadows drawn by the shader cache warm-up, which are those of the system UI.
+const vec4 kShadowAmbientColor = vec4(0, 0, 0, 0.00935997f);
+const vec4 kShadowSpotColor = vec4(0, 0, 0, 0.0455841f);
+const vec3 kShadowLightPos = vec3(500.f, -1500.f, 1500.f);
+constexpr float kShadowLightRadius = 2500.0f;
+
+using Attributes = std::map<std::string, std::string>;
+
+class Parser {
+public:
+    Parser(const std::string& name, uint32_t displayWidth, uint32_t displayHeight)
+          : mName(name), mWidth(displayWidth), mHeight(displayHeight) {}
+
+    std::optional<Scene> parse(const std::string& contents) {
+        Scene scene;
+        scene.name = mName;
+        const Rect displayRect(0, 0, static_cast<int32_t>(mWidth), static_cast<int32_t>(mHeight));
+        scene.display = DisplaySettings{
+                .physicalDisplay = displayRect,
+                .clip = displayRect,
+                .maxLuminance = 500,
+                .outputDataspace = ui::Dataspace::SRGB,
+        };
+
+        for (const std::string& rawLine : base::Split(contents, "\n")) {
+            mLine++;
+            const std::string line = base::Trim(rawLine);
+            if (line.empty() || line[0] == '#') continue;
+
+            std::vector<std::string> tokens = base::Tokenize(line, " \t");
+            const std::string keyword = tokens[0];
+            Attributes attributes;
+            for (size_t i = 1; i < tokens.size(); i++) {
+                const size_t equals = tokens[i].find('=');
+                if (equals == std::string::npos) {
+                    attributes[tokens[i]] = "";
+                } else {
+                    attributes[tokens[i].substr(0, equals)] = tokens[i].substr(equals + 1);
+                }
+            }
+
+            bool ok;
+            if (keyword == "display") {
+                ok = parseDisplay(attributes, scene.display);
+            } else if (keyword == "layer") {
+                LayerSettings& layer = scene.layers.emplace_back();
+                bool isImage = false;
+                ok = parseLayer(attributes, layer, isImage);
+                if (isImage) {
+                    scene.imageLayers.push_back(scene.layers.size() - 1);
+                }
+            } else {
+                ok = error("unknown keyword " + keyword);
+            }
+            if (!ok) return std::nullopt;
+        }
+
+        if (scene.layers.empty()) {
+            error("no layers");
+            return std::nullopt;
+        }
+        return scene;
+    }
+
+private:
+    bool error(const std::string& message) const {
+        ALOGE("Scene %s, line %d: %s", mName.c_str(), mLine, message.c_str());
+        return false;
+    }
+
+    bool parseFloats(const std::string& key, const std::string& value, float* out,
+                     size_t count) const {
+        const std::vector<std::string> parts = base::Split(value, ",");
+        if (parts.size() != count) {
+            return error("expected " + std::to_string(count) + " values for " + key);
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (!base::ParseFloat(parts[i], &out[i])) {
+                return error("invalid value " + parts[i] + " for " + key);
+            }
+        }
+        return true;
+    }
+
+    bool parseDataspace(const std::string& value, ui::Dataspace& dataspace) const {
+        static const std::map<std::string, ui::Dataspace> kDataspaces = {
+                {"srgb", ui::Dataspace::SRGB},
+                {"display_p3", ui::Dataspace::DISPLAY_P3},
+                {"bt2020_pq", ui::Dataspace::BT2020_ITU_PQ},
+                {"bt2020_hlg", ui::Dataspace::BT2020_ITU_HLG},
+                {"scrgb", ui::Dataspace::V0_SCRGB},
+        };
+        const auto it = kDataspaces.find(value);
+        if (it == kDataspaces.end()) {
+            return error("unknown dataspace " + value);
+        }
+        dataspace = it->second;
+        return true;
+    }
+
+    bool parseDisplay(const Attributes& attributes, DisplaySettings& display) const {
+        for (const auto& [key, value] : attributes) {
+            bool ok = true;
+            if (key == "max_luminance") {
+                ok = parseFloats(key, value, &display.maxLuminance, 1);
+            } else if (key == "target_luminance") {
+                ok = parseFloats(key, value, &display.targetLuminanceNits, 1);
+            } else if (key == "current_luminance") {
+                ok = parseFloats(key, value, &display.currentLuminanceNits, 1);
+            } else if (key == "dataspace") {
+                ok = parseDataspace(value, display.outputDataspace);
+            } else if (key == "dimming_stage") {
+                if (value == "none") {
+                    display.dimmingStage = DimmingStage::NONE;
+                } else if (value == "linear") {
+                    display.dimmingStage = DimmingStage::LINEAR;
+                } else if (value == "gamma_oetf") {
+                    display.dimmingStage = DimmingStage::GAMMA_OETF;
+                } else {
+                    ok = error("unknown dimming stage " + value);
+                }
+            } else {
+                ok = error("unknown display attribute " + key);
+            }
+            if (!ok) return false;
+        }
+        return true;
+    }
+
+    bool parseLayer(const Attributes& attributes, LayerSettings& layer, bool& isImage) const {
+        layer.alpha = half(1.0f);
+        layer.sourceDataspace = ui::Dataspace::SRGB;
+
+        bool hasBounds = false;
+        float radius = 0.f;
+        float shadowLength = 0.f;
+        for (const auto& [key, value] : attributes) {
+            bool ok = true;
+            if (key == "name") {
+                layer.name = value;
+            } else if (key == "bounds") {
+                float bounds[4];
+                ok = parseFloats(key, value, bounds, 4);
+                layer.geometry.boundaries =
+                        FloatRect(bounds[0] * mWidth, bounds[1] * mHeight, bounds[2] * mWidth,
+                                  bounds[3] * mHeight);
+                hasBounds = true;
+            } else if (key == "image") {
+                isImage = true;
+            } else if (key == "color") {
+                float color[3];
+                ok = parseFloats(key, value, color, 3);
+                layer.source.solidColor = half3(color[0], color[1], color[2]);
+            } else if (key == "alpha") {
+                float alpha;
+                ok = parseFloats(key, value, &alpha, 1);
+                layer.alpha = half(alpha);
+            } else if (key == "dataspace") {
+                ok = parseDataspace(value, layer.sourceDataspace);
+            } else if (key == "radius") {
+                ok = parseFloats(key, value, &radius, 1);
+            } else if (key == "blur") {
+                float blur;
+                ok = parseFloats(key, value, &blur, 1);
+                layer.backgroundBlurRadius = static_cast<int>(blur);
+            } else if (key == "skip") {
+                layer.skipContentDraw = true;
+            } else if (key == "shadow") {
+                ok = parseFloats(key, value, &shadowLength, 1);
+            } else if (key == "opaque") {
+                layer.source.buffer.isOpaque = true;
+            } else if (key == "filter") {
+                layer.source.buffer.useTextureFiltering = true;
+            } else if (key == "max_luminance") {
+                ok = parseFloats(key, value, &layer.source.buffer.maxLuminanceNits, 1);
+            } else if (key == "white_point") {
+                ok = parseFloats(key, value, &layer.whitePointNits, 1);
+            } else {
+                ok = error("unknown layer attribute " + key);
+            }
+            if (!ok) return false;
+        }
+
+        if (!hasBounds) {
+            return error("layer without bounds");
+        }
+        if (radius > 0.f) {
+            layer.geometry.roundedCornersRadius = vec2(radius, radius);
+            layer.geometry.roundedCornersCrop = layer.geometry.boundaries;
+        }
+        if (shadowLength > 0.f) {
+            layer.shadow = ShadowSettings{
+                    .boundaries = layer.geometry.boundaries,
+                    .ambientColor = kShadowAmbientColor,
+                    .spotColor = kShadowSpotColor,
+                    .lightPos = kShadowLightPos,
+                    .lightRadius = kShadowLightRadius,
+                    .length = shadowLength,
+            };
+        }
+        return true;
+    }
+
+    const std::string& mName;
+    const uint32_t mWidth;
+    const uint32_t mHeight;
+    int mLine = 0;
+};
+
+} // namespace
+
+std::optional<Scene> parseScene(const std::string& name, const std::string& contents,
+                                uint32_t displayWidth, uint32_t displayHeight) {
+    return Parser(name, displayWidth, displayHeight).parse(contents);
+}
+
+std::vector<Scene> loadScenes(const std::string& directory, uint32_t displayWidth,
+                              uint32_t displayHeight) {
+    std::vector<std::filesystem::path> paths;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (entry.path().extension() == kSceneExtension) {
+            paths.push_back(entry.path());
+        }
+    }
+    if (error) {
+        ALOGE("Failed to list scenes in %s: %s", directory.c_str(), error.message().c_str());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<Scene> scenes;
+    for (const auto& path : paths) {
+        std::string contents;
+        if (!base::ReadFileToString(path, &contents)) {
+            ALOGE("Failed to read scene %s", path.c_str());
+            continue;
+        }
+        if (auto scene = parseScene(path.stem(), contents, displayWidth, displayHeight)) {
+            scenes.push_back(std::move(*scene));
+        }
+    }
+    return scenes;
+}
+
+} // namespace renderenginebench
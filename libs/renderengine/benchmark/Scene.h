@@ -0,0 +1,62 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <renderengine/DisplaySettings.h>
+#include <renderengine/LayerSettings.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace android;
+
+namespace renderenginebench {
+
+/**
+ * A layer stack to benchmark, as SurfaceFlinger would hand it to RenderEngine for a frame.
+ *
+ * Scenes are read from text files with one directive per line, each made of a keyword followed by
+ * key=value attributes. Lines starting with '#' are comments.
+ *
+ *   display [max_luminance=N] [target_luminance=N] [current_luminance=N] [dataspace=D]
+ *           [dimming_stage=none|linear|gamma_oetf]
+ *   layer [name=S] bounds=L,T,R,B [image] [color=R,G,B] [alpha=A] [dataspace=D] [radius=N]
+ *         [blur=N] [skip] [shadow=N] [opaque] [filter] [max_luminance=N] [white_point=N]
+ *
+ * The layers are listed from back to front. Their bounds are fractions of the display size, so
+ * that a scene captured on one device runs on any other, while radii and shadow lengths are in
+ * pixels. A layer with the image attribute draws the benchmark's source image, the others draw
+ * their solid color. D is one of srgb, display_p3, bt2020_pq, bt2020_hlg or scrgb.
+ */
+struct Scene {
+    std::string name;
+    DisplaySettings display;
+    std::vector<LayerSettings> layers;
+    // The layers which draw the source image, whose buffer the benchmark fills in.
+    std::vector<size_t> imageLayers;
+};
+
+// Returns nullopt, and logs why, if the contents are not a valid scene.
+std::optional<Scene> parseScene(const std::string& name, const std::string& contents,
+                                uint32_t displayWidth, uint32_t displayHeight);
+
+// Loads the *.scene files of the directory, sorted by name, skipping the invalid ones.
+std::vector<Scene> loadScenes(const std::string& directory, uint32_t displayWidth,
+                              uint32_t displayHeight);
+
+} // namespace renderenginebench
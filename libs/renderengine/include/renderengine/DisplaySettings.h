@@ -18,6 +18,7 @@
 
 #include <aidl/android/hardware/graphics/composer3/DimmingStage.h>
 #include <aidl/android/hardware/graphics/composer3/RenderIntent.h>
+#include <ftl/enum.h>
 #include <iosfwd>
 
 #include <math/mat4.h>
@@ -34,6 +35,19 @@
 namespace android {
 namespace renderengine {
 
+// The classes of work which a threaded RenderEngine draws, from the most to the least urgent. The
+// work of a more urgent class starts ahead of the less urgent work queued before it.
+enum class RenderPriority {
+    // The client composition of a display, which is needed by its next present.
+    COMPOSITION,
+    // The layers which the planner of CompositionEngine caches ahead of their use.
+    CACHE,
+    // Screenshots and region sampling, which no display waits on.
+    CAPTURE,
+
+    ftl_last = CAPTURE
+};
+
 // DisplaySettings contains the settings that are applicable when drawing all
 // layers for a given display.
 struct DisplaySettings {
@@ -89,6 +103,15 @@ struct DisplaySettings {
             aidl::android::hardware::graphics::composer3::RenderIntent::TONE_MAP_COLORIMETRIC;
 
     std::vector<renderengine::BorderRenderInfo> borderInfoList;
+
+    // The region of the output buffer to redraw, in buffer coordinates. The buffer keeps its
+    // content outside of it, which the caller must know to be up to date. The invalid region
+    // redraws the whole buffer. Displays with blurs are always redrawn whole, since a blur reads
+    // the content around the region it covers.
+    Region damage = Region::INVALID_REGION;
+
+    // The class of the work, which orders it among the work queued on a threaded RenderEngine.
+    RenderPriority priority = RenderPriority::COMPOSITION;
 };
 
 static inline bool operator==(const DisplaySettings& lhs, const DisplaySettings& rhs) {
@@ -101,7 +124,8 @@ static inline bool operator==(const DisplaySettings& lhs, const DisplaySettings&
             lhs.orientation == rhs.orientation &&
             lhs.targetLuminanceNits == rhs.targetLuminanceNits &&
             lhs.dimmingStage == rhs.dimmingStage && lhs.renderIntent == rhs.renderIntent &&
-            lhs.borderInfoList == rhs.borderInfoList;
+            lhs.borderInfoList == rhs.borderInfoList && lhs.damage.hasSameRects(rhs.damage) &&
+            lhs.priority == rhs.priority;
 }
 
 static const char* orientation_to_string(uint32_t orientation) {
@@ -146,6 +170,9 @@ static inline void PrintTo(const DisplaySettings& settings, ::std::ostream* os)
         << aidl::android::hardware::graphics::composer3::toString(settings.dimmingStage).c_str();
     *os << "\n    .renderIntent = "
         << aidl::android::hardware::graphics::composer3::toString(settings.renderIntent).c_str();
+    *os << "\n    .damage = ";
+    PrintTo(settings.damage, os);
+    *os << "\n    .priority = " << ftl::enum_string(settings.priority);
     *os << "\n}";
 }
 
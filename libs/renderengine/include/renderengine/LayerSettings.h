@@ -62,6 +62,11 @@ struct Buffer {
     bool isOpaque = false;
 
     float maxLuminanceNits = 0.0;
+
+    // Frame number of the content of the buffer, which changes whenever the producer queues a new
+    // frame into it, or 0 if it is unknown. RenderEngine only reuses what it drew from a buffer,
+    // e.g. a blur, for the same frame.
+    uint64_t frameNumber = 0;
 };
 
 // Metadata describing the layer geometry.
@@ -152,7 +157,8 @@ static inline bool operator==(const Buffer& lhs, const Buffer& rhs) {
             lhs.useTextureFiltering == rhs.useTextureFiltering &&
             lhs.textureTransform == rhs.textureTransform &&
             lhs.usePremultipliedAlpha == rhs.usePremultipliedAlpha &&
-            lhs.isOpaque == rhs.isOpaque && lhs.maxLuminanceNits == rhs.maxLuminanceNits;
+            lhs.isOpaque == rhs.isOpaque && lhs.maxLuminanceNits == rhs.maxLuminanceNits &&
+            lhs.frameNumber == rhs.frameNumber;
 }
 
 static inline bool operator==(const Geometry& lhs, const Geometry& rhs) {
@@ -198,6 +204,7 @@ static inline void PrintTo(const Buffer& settings, ::std::ostream* os) {
     *os << "\n    .usePremultipliedAlpha = " << settings.usePremultipliedAlpha;
     *os << "\n    .isOpaque = " << settings.isOpaque;
     *os << "\n    .maxLuminanceNits = " << settings.maxLuminanceNits;
+    *os << "\n    .frameNumber = " << settings.frameNumber;
     *os << "\n}";
 }
 
@@ -49,11 +49,33 @@
  */
 #define PROPERTY_DEBUG_RENDERENGINE_CAPTURE_FILENAME "debug.renderengine.capture_filename"
 
+/**
+ * Sets how many imports of buffers which are not mapped the SkiaGL version of the RE keeps for
+ * reuse, each holding an EGLImage and its buffer. 0, the default, disables this cache.
+ */
+#define PROPERTY_DEBUG_RENDERENGINE_EGL_IMAGE_CACHE_SIZE "debug.renderengine.egl_image_cache_size"
+
+/**
+ * Sets how many megabytes of imports of mapped buffers the Skia versions of the RE keep. Past the
+ * budget, the least recently drawn imports which no current layer uses are released, and imported
+ * again if the buffer is drawn later. 0, the default, keeps the imports of all mapped buffers.
+ */
+#define PROPERTY_DEBUG_RENDERENGINE_TEXTURE_CACHE_BUDGET_MB \
+    "debug.renderengine.texture_cache_budget_mb"
+
 /**
  * Allows recording of Skia drawing commands with systrace.
  */
 #define PROPERTY_SKIA_ATRACE_ENABLED "debug.renderengine.skia_atrace_enabled"
 
+/**
+ * Names the file, within the cache directory of the process, to which the Skia versions of the RE
+ * persist the shader programs, or the Vulkan pipeline cache, once the shader cache is primed, so
+ * that the next boot with the same driver loads them instead of compiling them. Unset, the
+ * default, disables persisting them. Names which are not plain file names are ignored.
+ */
+#define PROPERTY_PERSISTENT_SHADER_CACHE_FILE "debug.renderengine.persistent_shader_cache_file"
+
 struct ANativeWindowBuffer;
 
 namespace android {
@@ -138,7 +160,9 @@ public:
     // drawing any layers.
     //
     // Assumptions when calling this method:
-    // 1. There is exactly one caller - i.e. multi-threading is not supported.
+    // 1. There is exactly one caller - i.e. multi-threading is not supported. The threaded
+    // RenderEngine is the exception: it queues the drawing on its own thread, so it may be called
+    // from several threads at the same time.
     // 2. Additional threads may be calling the {bind,cache}ExternalTexture
     // methods above. But the main thread is responsible for holding resources
     // such that Image destruction does not occur while this method is called.
@@ -194,6 +218,11 @@ public:
 
     virtual void setEnableTracing(bool /*tracingEnabled*/) {}
 
+    // Releases the GPU resources which RenderEngine only keeps for reuse, e.g. the imports of the
+    // buffers which the last frame did not draw, so that the device recovers memory when it runs
+    // low. The implementation may defer the work to its own thread.
+    virtual void trimMemory() {}
+
 protected:
     RenderEngine() : RenderEngine(Threaded::NO) {}
 
@@ -53,6 +53,7 @@ public:
     MOCK_METHOD0(getContextPriority, int());
     MOCK_METHOD0(supportsBackgroundBlur, bool());
     MOCK_METHOD1(onActiveDisplaySizeChanged, void(ui::Size));
+    MOCK_METHOD0(trimMemory, void());
 
 protected:
     // mock renderengine still needs to implement these, but callers should never need to call them.
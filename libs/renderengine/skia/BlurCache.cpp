@@ -0,0 +1,120 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BlurCache.h"
+
+#include <android-base/stringprintf.h>
+#include <renderengine/ExternalTexture.h>
+
+#include <cinttypes>
+
+namespace android {
+namespace renderengine {
+namespace skia {
+
+std::shared_ptr<const BlurCache::Content> BlurCache::Content::make(
+        const GrRecordingContext* context, const DisplaySettings& display,
+        std::span<const LayerSettings> layersBelow, float displayDimmingRatio,
+        const SkImage& input) {
+    std::shared_ptr<Content> content(new Content());
+    content->mContext = context;
+    content->mDisplay = display;
+    content->mDisplayDimmingRatio = displayDimmingRatio;
+    content->mInputInfo = input.imageInfo();
+    content->mInputIsProtected = input.isProtected();
+
+    content->mLayers.reserve(layersBelow.size());
+    content->mBufferIds.reserve(layersBelow.size());
+    for (const LayerSettings& layer : layersBelow) {
+        uint64_t bufferId = 0;
+        if (layer.source.buffer.buffer) {
+            if (layer.source.buffer.frameNumber == 0) {
+                return nullptr;
+            }
+            bufferId = layer.source.buffer.buffer->getId();
+        }
+        LayerSettings& snapshot = content->mLayers.emplace_back(layer);
+        snapshot.source.buffer.buffer = nullptr;
+        snapshot.source.buffer.fence = nullptr;
+        content->mBufferIds.push_back(bufferId);
+    }
+    return content;
+}
+
+bool BlurCache::Content::operator==(const Content& other) const {
+    return mContext == other.mContext && mBufferIds == other.mBufferIds &&
+            mDisplayDimmingRatio == other.mDisplayDimmingRatio && mInputInfo == other.mInputInfo &&
+            mInputIsProtected == other.mInputIsProtected && mLayers == other.mLayers &&
+            mDisplay == other.mDisplay;
+}
+
+sk_sp<SkImage> BlurCache::get(const Content& content, uint32_t radius, const SkRect& blurRect) {
+    for (auto it = mEntries.begin(); it != mEntries.end(); it++) {
+        if (it->radius != radius || it->blurRect != blurRect ||
+            (it->content.get() != &content && !(*it->content == content))) {
+            continue;
+        }
+        mStats.hits++;
+        mEntries.splice(mEntries.begin(), mEntries, it);
+        return mEntries.front().blur;
+    }
+    mStats.misses++;
+    return nullptr;
+}
+
+void BlurCache::put(std::shared_ptr<const Content> content, uint32_t radius,
+                    const SkRect& blurRect, sk_sp<SkImage> blur) {
+    if (!content || !blur) {
+        return;
+    }
+    const size_t bytes = blur->imageInfo().computeMinByteSize();
+    if (bytes > mBudgetBytes) {
+        return;
+    }
+
+    while (mBytes + bytes > mBudgetBytes) {
+        mBytes -= mEntries.back().bytes;
+        mEntries.pop_back();
+        mStats.evictions++;
+    }
+    mEntries.push_front({std::move(content), radius, blurRect, std::move(blur), bytes});
+    mBytes += bytes;
+}
+
+void BlurCache::clear() {
+    mEntries.clear();
+    mBytes = 0;
+}
+
+BlurCache::Stats BlurCache::getStats() const {
+    Stats stats = mStats;
+    stats.bytes = mBytes;
+    stats.budgetBytes = mBudgetBytes;
+    return stats;
+}
+
+void BlurCache::dump(std::string& result) const {
+    const Stats stats = getStats();
+    base::StringAppendF(&result,
+                        "RenderEngine blur cache: %zu blurs, %zu/%zu bytes, %" PRIu64
+                        " hits, %" PRIu64 " misses, %" PRIu64 " evictions\n",
+                        mEntries.size(), stats.bytes, stats.budgetBytes, stats.hits, stats.misses,
+                        stats.evictions);
+}
+
+} // namespace skia
+} // namespace renderengine
+} // namespace android
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <SkImage.h>
+#include <SkImageInfo.h>
+#include <SkRect.h>
+#include <SkRefCnt.h>
+#include <renderengine/DisplaySettings.h>
+#include <renderengine/LayerSettings.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+class GrRecordingContext;
+
+namespace android {
+namespace renderengine {
+namespace skia {
+
+// A cache of the blurs generated for recent frames, bounded by the memory of the blurred images,
+// which evicts the least recently used blur when it is full. The blur of content which did not
+// change since, such as a notification shade over a static wallpaper, is then not generated again.
+//
+// The content is identified by the settings of the display and of the layers drawn below the blur,
+// their buffers by id and frame number. Content drawn from a buffer whose frame number is unknown
+// is never cached, since the producer may have drawn a new frame into the same buffer.
+//
+// The cache is not thread-safe, its owner must serialize the calls.
+class BlurCache {
+public:
+    // What the input of a blur holds, for the blurs of the layers above it.
+    class Content {
+    public:
+        // Returns nullptr if the content cannot be identified.
+        static std::shared_ptr<const Content> make(const GrRecordingContext* context,
+                                                   const DisplaySettings& display,
+                                                   std::span<const LayerSettings> layersBelow,
+                                                   float displayDimmingRatio,
+                                                   const SkImage& input);
+
+        bool operator==(const Content&) const;
+
+    private:
+        Content() = default;
+
+        const GrRecordingContext* mContext = nullptr;
+        DisplaySettings mDisplay;
+        // The settings of the layers, without their buffers and fences, which are identified by
+        // mBufferIds instead, so that the cache does not keep them alive.
+        std::vector<LayerSettings> mLayers;
+        std::vector<uint64_t> mBufferIds;
+        float mDisplayDimmingRatio = 1.f;
+        SkImageInfo mInputInfo;
+        bool mInputIsProtected = false;
+    };
+
+    struct Stats {
+        size_t bytes = 0;
+        size_t budgetBytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    // A budget of 0 disables the cache: it keeps no blurs, but still counts the misses.
+    explicit BlurCache(size_t budgetBytes) : mBudgetBytes(budgetBytes) {}
+
+    BlurCache(const BlurCache&) = delete;
+    BlurCache& operator=(const BlurCache&) = delete;
+
+    // Returns the blur of the content, and makes it the most recently used, or nullptr.
+    sk_sp<SkImage> get(const Content&, uint32_t radius, const SkRect& blurRect);
+
+    // Adds the blur of the content, and makes it the most recently used. The least recently used
+    // blurs are evicted until the cache fits its budget. A blur larger than the budget is not kept.
+    void put(std::shared_ptr<const Content>, uint32_t radius, const SkRect& blurRect,
+             sk_sp<SkImage> blur);
+
+    void clear();
+
+    Stats getStats() const;
+    void dump(std::string& result) const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const Content> content;
+        uint32_t radius;
+        SkRect blurRect;
+        sk_sp<SkImage> blur;
+        size_t bytes;
+    };
+
+    const size_t mBudgetBytes;
+
+    // From the most to the least recently used.
+    std::list<Entry> mEntries;
+    size_t mBytes = 0;
+
+    Stats mStats;
+};
+
+} // namespace skia
+} // namespace renderengine
+} // namespace android
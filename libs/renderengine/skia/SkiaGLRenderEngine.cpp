@@ -25,6 +25,7 @@
 #include <EGL/eglext.h>
 #include <GrContextOptions.h>
 #include <GrTypes.h>
+#include <android-base/properties.h>
 #include <android-base/stringprintf.h>
 #include <gl/GrGLInterface.h>
 #include <include/gpu/ganesh/gl/GrGLDirectContext.h>
@@ -269,7 +270,9 @@ SkiaGLRenderEngine::SkiaGLRenderEngine(const RenderEngineCreationArgs& args, EGL
                                        EGLContext ctxt, EGLSurface placeholder,
                                        EGLContext protectedContext, EGLSurface protectedPlaceholder)
       : SkiaRenderEngine(args.threaded, static_cast<PixelFormat>(args.pixelFormat),
-                         args.supportsBackgroundBlur),
+                         args.supportsBackgroundBlur,
+                         base::GetUintProperty<
+                                 size_t>(PROPERTY_DEBUG_RENDERENGINE_EGL_IMAGE_CACHE_SIZE, 0)),
         mEGLDisplay(display),
         mEGLContext(ctxt),
         mPlaceholderSurface(placeholder),
@@ -52,6 +52,8 @@
 #include <SkString.h>
 #include <SkSurface.h>
 #include <SkTileMode.h>
+#include <android-base/file.h>
+#include <android-base/properties.h>
 #include <android-base/stringprintf.h>
 #include <common/FlagManager.h>
 #include <gui/FenceMonitor.h>
@@ -64,13 +66,23 @@
 #include <ui/DebugUtils.h>
 #include <ui/GraphicBuffer.h>
 #include <ui/HdrRenderTypeUtils.h>
+#include <ui/PixelFormat.h>
+#include <unistd.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
+#include <cerrno>
 #include <cmath>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <deque>
 #include <memory>
 #include <numeric>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
 
 #include "Cache.h"
 #include "ColorSpaces.h"
@@ -211,6 +223,13 @@ static inline std::pair<SkRRect, SkRRect> getBoundsAndClip(const android::FloatR
     return {SkRRect::MakeRect(bounds), clip};
 }
 
+// The memory which the import of the buffer holds, for the budget of the texture cache.
+static size_t estimateTextureBytes(const GraphicBuffer& buffer) {
+    // bytesPerPixel is 0 for YUV formats, which take less than 2 bytes per pixel.
+    const uint32_t bytesPerPixel = std::max(android::bytesPerPixel(buffer.getPixelFormat()), 2u);
+    return static_cast<size_t>(buffer.getStride()) * buffer.getHeight() * bytesPerPixel;
+}
+
 static inline bool layerHasBlur(const android::renderengine::LayerSettings& layer,
                                 bool colorTransformModifiesAlpha) {
     if (layer.backgroundBlurRadius > 0 || layer.blurRegions.size()) {
@@ -222,6 +241,108 @@ static inline bool layerHasBlur(const android::renderengine::LayerSettings& laye
     return false;
 }
 
+// Whether drawing the layer replaces everything below it within its bounds, so that the layers
+// below are hidden there.
+static bool layerIsOccluder(const android::renderengine::LayerSettings& layer,
+                            bool colorTransformModifiesAlpha) {
+    if (layer.skipContentDraw || layer.shadow.length > 0 || layer.stretchEffect.hasEffect() ||
+        layer.geometry.roundedCornersRadius.x > 0 || layer.geometry.roundedCornersRadius.y > 0) {
+        return false;
+    }
+    if (layer.disableBlending) {
+        return true;
+    }
+    const android::mat4& colorTransform = layer.colorTransform;
+    const bool colorTransformKeepsAlpha = colorTransform[0][3] == 0 &&
+            colorTransform[1][3] == 0 && colorTransform[2][3] == 0 && colorTransform[3][3] == 1;
+    const bool opaqueContent = !layer.source.buffer.buffer || layer.source.buffer.isOpaque;
+    return opaqueContent && layer.alpha == 1.0f && colorTransformKeepsAlpha &&
+            !colorTransformModifiesAlpha;
+}
+
+// Removes the occluded part from the visible rect if what remains is still a rect.
+static void trimVisibleRect(SkRect& visible, const SkRect& occluder) {
+    if (!SkRect::Intersects(visible, occluder)) {
+        return;
+    }
+    if (occluder.fLeft <= visible.fLeft && occluder.fRight >= visible.fRight) {
+        if (occluder.fTop <= visible.fTop) {
+            visible.fTop = occluder.fBottom;
+        } else if (occluder.fBottom >= visible.fBottom) {
+            visible.fBottom = occluder.fTop;
+        }
+    } else if (occluder.fTop <= visible.fTop && occluder.fBottom >= visible.fBottom) {
+        if (occluder.fLeft <= visible.fLeft) {
+            visible.fLeft = occluder.fRight;
+        } else if (occluder.fRight >= visible.fRight) {
+            visible.fRight = occluder.fLeft;
+        }
+    }
+}
+
+namespace {
+
+struct LayerVisibility {
+    // Whether the layer is entirely hidden by the layers drawn after it.
+    bool culled = false;
+    // In device space, the part of the layer which is not hidden by the layers drawn after it, if
+    // that is less than all of it.
+    std::optional<SkRect> visibleRect;
+};
+
+} // namespace
+
+// Finds which parts of the layers are hidden by the occluders drawn after them. The layers with
+// blurs and shadows are always drawn, and so are the layers below a blur, which samples them where
+// they are hidden as well.
+static std::vector<LayerVisibility> computeLayerVisibilities(
+        const std::vector<android::renderengine::LayerSettings>& layers,
+        const SkMatrix& displayMatrix, bool colorTransformModifiesAlpha) {
+    std::vector<LayerVisibility> visibilities(layers.size());
+    if (!displayMatrix.rectStaysRect()) {
+        return visibilities;
+    }
+
+    std::vector<SkRect> occluders;
+    for (size_t i = layers.size(); i-- > 0;) {
+        const auto& layer = layers[i];
+        if (layerHasBlur(layer, colorTransformModifiesAlpha)) {
+            occluders.clear();
+            continue;
+        }
+
+        SkMatrix matrix = displayMatrix;
+        matrix.preConcat(getSkM44(layer.geometry.positionTransform).asM33());
+        if (!matrix.rectStaysRect()) {
+            continue;
+        }
+        const SkRect deviceBounds = matrix.mapRect(getSkRect(layer.geometry.boundaries));
+
+        LayerVisibility& visibility = visibilities[i];
+        if (layer.shadow.length <= 0 && !occluders.empty()) {
+            // Outset by a pixel for the antialiased edges of rounded corners, since the occluders
+            // are drawn without antialiasing.
+            const SkRect drawnRect = deviceBounds.makeOutset(1.f, 1.f);
+            SkRect visibleRect = drawnRect;
+            for (const SkRect& occluder : occluders) {
+                if (occluder.contains(visibleRect)) {
+                    visibility.culled = true;
+                    break;
+                }
+                trimVisibleRect(visibleRect, occluder);
+            }
+            if (!visibility.culled && visibleRect != drawnRect) {
+                visibility.visibleRect = visibleRect;
+            }
+        }
+
+        if (!visibility.culled && layerIsOccluder(layer, colorTransformModifiesAlpha)) {
+            occluders.push_back(deviceBounds);
+        }
+    }
+    return visibilities;
+}
+
 static inline SkColor getSkColor(const android::vec4& color) {
     return SkColorSetARGB(color.a * 255, color.r * 255, color.g * 255, color.b * 255);
 }
@@ -244,15 +365,58 @@ namespace skia {
 
 using base::StringAppendF;
 
+namespace {
+
+// Identifies the files written by SkSLCacheMonitor::persist, and the version of their layout, which
+// is the driver key, then the number of entries, then the key and data of each entry, all strings
+// being prefixed by their size.
+constexpr uint32_t kPersistentCacheMagic = 0x52455343; // "RESC"
+constexpr uint32_t kPersistentCacheVersion = 1;
+
+void appendUint32(std::string& out, uint32_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void appendBytes(std::string& out, const void* data, size_t size) {
+    appendUint32(out, static_cast<uint32_t>(size));
+    out.append(static_cast<const char*>(data), size);
+}
+
+bool readUint32(std::string_view& in, uint32_t& value) {
+    if (in.size() < sizeof(value)) return false;
+    memcpy(&value, in.data(), sizeof(value));
+    in.remove_prefix(sizeof(value));
+    return true;
+}
+
+bool readBytes(std::string_view& in, std::string_view& bytes) {
+    uint32_t size;
+    if (!readUint32(in, size) || in.size() < size) return false;
+    bytes = in.substr(0, size);
+    in.remove_prefix(size);
+    return true;
+}
+
+} // namespace
+
 std::future<void> SkiaRenderEngine::primeCache(bool shouldPrimeUltraHDR) {
+    prebuildCommonRuntimeEffects();
     Cache::primeShaderCache(this, shouldPrimeUltraHDR);
+
+    // Vulkan only hands its pipeline cache to the persistent cache when asked to.
+    if (mGrContext) {
+        mGrContext->storeVkPipelineCacheData();
+    }
+    mSkSLCacheMonitor.persist();
     return {};
 }
 
 sk_sp<SkData> SkiaRenderEngine::SkSLCacheMonitor::load(const SkData& key) {
-    // This "cache" does not actually cache anything. It just allows us to
-    // monitor Skia's internal cache. So this method always returns null.
-    return nullptr;
+    // Without a file, this "cache" does not actually cache anything. It just allows us to
+    // monitor Skia's internal cache, and so returns null.
+    const auto it = mEntries.find(
+            std::string(static_cast<const char*>(key.data()), key.size()));
+    return it == mEntries.end() ? nullptr : it->second;
 }
 
 void SkiaRenderEngine::SkSLCacheMonitor::store(const SkData& key, const SkData& data,
@@ -260,6 +424,98 @@ void SkiaRenderEngine::SkSLCacheMonitor::store(const SkData& key, const SkData&
     mShadersCachedSinceLastCall++;
     mTotalShadersCompiled++;
     ATRACE_FORMAT("SF cache: %i shaders", mTotalShadersCompiled);
+
+    if (mPath.empty() || mPersisted) {
+        return;
+    }
+    std::string entryKey(static_cast<const char*>(key.data()), key.size());
+    if (mEntries.size() >= kMaxPersistentEntries && mEntries.find(entryKey) == mEntries.end()) {
+        return;
+    }
+    mEntries.insert_or_assign(std::move(entryKey), SkData::MakeWithCopy(data.data(), data.size()));
+    mEntriesChanged = true;
+}
+
+bool SkiaRenderEngine::SkSLCacheMonitor::setPersistentFile(const std::string& fileName,
+                                                           std::string driverKey) {
+    ATRACE_CALL();
+    // The name comes from a debug property, so it must not lead out of the directory.
+    if (fileName.empty() || fileName == "." || fileName == ".." ||
+        fileName.find('/') != std::string::npos) {
+        ALOGE("Ignoring the persistent shader cache file name %s", fileName.c_str());
+        return false;
+    }
+    mPath = mDirectory + "/" + fileName;
+    mDriverKey = std::move(driverKey);
+    mEntries.clear();
+    mEntriesChanged = false;
+    mPersisted = false;
+
+    std::string contents;
+    if (!base::ReadFileToString(mPath, &contents)) {
+        ALOGD("No persistent shader cache at %s", mPath.c_str());
+        return true;
+    }
+
+    std::string_view in = contents;
+    uint32_t magic, version, count;
+    std::string_view driverKeyBytes;
+    if (!readUint32(in, magic) || magic != kPersistentCacheMagic || !readUint32(in, version) ||
+        version != kPersistentCacheVersion || !readBytes(in, driverKeyBytes) ||
+        !readUint32(in, count) || count > kMaxPersistentEntries) {
+        ALOGW("Ignoring the malformed persistent shader cache at %s", mPath.c_str());
+        return true;
+    }
+    if (driverKeyBytes != mDriverKey) {
+        ALOGD("Ignoring the persistent shader cache at %s, which was written for another driver",
+              mPath.c_str());
+        return true;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        std::string_view key, data;
+        if (!readBytes(in, key) || !readBytes(in, data)) {
+            ALOGW("Ignoring the truncated persistent shader cache at %s", mPath.c_str());
+            mEntries.clear();
+            return true;
+        }
+        mEntries.insert_or_assign(std::string(key), SkData::MakeWithCopy(data.data(), data.size()));
+    }
+    ALOGD("Loaded %zu entries from the persistent shader cache at %s", mEntries.size(),
+          mPath.c_str());
+    return true;
+}
+
+void SkiaRenderEngine::SkSLCacheMonitor::persist() {
+    if (mPath.empty() || mPersisted) {
+        return;
+    }
+    mPersisted = true;
+    if (!mEntriesChanged) {
+        return;
+    }
+    ATRACE_CALL();
+
+    std::string out;
+    appendUint32(out, kPersistentCacheMagic);
+    appendUint32(out, kPersistentCacheVersion);
+    appendBytes(out, mDriverKey.data(), mDriverKey.size());
+    appendUint32(out, static_cast<uint32_t>(mEntries.size()));
+    for (const auto& [key, data] : mEntries) {
+        appendBytes(out, key.data(), key.size());
+        appendBytes(out, data->data(), data->size());
+    }
+
+    // Written to a temporary file first, so that a crash midway does not leave a truncated cache.
+    const std::string tempPath = mPath + ".tmp";
+    if (!base::WriteStringToFile(out, tempPath) || rename(tempPath.c_str(), mPath.c_str()) != 0) {
+        ALOGW("Failed to write the persistent shader cache to %s (%d)", mPath.c_str(), errno);
+        unlink(tempPath.c_str());
+        return;
+    }
+    mEntriesChanged = false;
+    ALOGD("Wrote %zu entries to the persistent shader cache at %s", mEntries.size(),
+          mPath.c_str());
 }
 
 int SkiaRenderEngine::reportShadersCompiled() {
@@ -271,8 +527,15 @@ void SkiaRenderEngine::setEnableTracing(bool tracingEnabled) {
 }
 
 SkiaRenderEngine::SkiaRenderEngine(Threaded threaded, PixelFormat pixelFormat,
-                                   bool supportsBackgroundBlur)
-      : RenderEngine(threaded), mDefaultPixelFormat(pixelFormat) {
+                                   bool supportsBackgroundBlur, size_t uncachedTextureCacheSize)
+      : RenderEngine(threaded),
+        mDefaultPixelFormat(pixelFormat),
+        mTextureCacheBudgetBytes(
+                base::GetUintProperty<size_t>(PROPERTY_DEBUG_RENDERENGINE_TEXTURE_CACHE_BUDGET_MB,
+                                              0) *
+                1024 * 1024),
+        mUncachedTextureCache(uncachedTextureCacheSize),
+        mBlurCache(supportsBackgroundBlur ? kBlurCacheBudgetBytes : 0) {
     if (supportsBackgroundBlur) {
         ALOGD("Background Blurs Enabled");
         mBlurFilter = new KawaseBlurFilter();
@@ -289,6 +552,8 @@ void SkiaRenderEngine::finishRenderingAndAbandonContext() {
     if (mBlurFilter) {
         delete mBlurFilter;
     }
+    // The cached blurs must be released before their contexts are abandoned.
+    mBlurCache.clear();
 
     if (mGrContext) {
         mGrContext->flushAndSubmit(GrSyncCpu::kYes);
@@ -385,6 +650,18 @@ void SkiaRenderEngine::ensureGrContextsCreated() {
     options.fReducedShaderVariations = true;
     options.fPersistentCache = &mSkSLCacheMonitor;
     std::tie(mGrContext, mProtectedGrContext) = createDirectContexts(options);
+
+    // Skia only loads programs and pipeline caches lazily, so the file may be set after the
+    // contexts are created, which tells which backend the entries are for. The driver ships with
+    // the vendor image, or as an updatable package.
+    const std::string cacheFile = base::GetProperty(PROPERTY_PERSISTENT_SHADER_CACHE_FILE, "");
+    if (!cacheFile.empty() && mGrContext) {
+        const std::string driverKey =
+                base::StringPrintf("%d|%s|%s", static_cast<int>(mGrContext->backend()),
+                                   base::GetProperty("ro.vendor.build.fingerprint", "").c_str(),
+                                   base::GetProperty("ro.gfx.driver.0", "").c_str());
+        mSkSLCacheMonitor.setPersistentFile(cacheFile, driverKey);
+    }
 }
 
 void SkiaRenderEngine::mapExternalTextureBuffer(const sp<GraphicBuffer>& buffer,
@@ -423,11 +700,24 @@ void SkiaRenderEngine::mapExternalTextureBuffer(const sp<GraphicBuffer>& buffer,
         if (FlagManager::getInstance().renderable_buffer_usage()) {
             isRenderable = buffer->getUsage() & GRALLOC_USAGE_HW_RENDER;
         }
+        // The imports of buffers which weren't mapped are only for sampling.
         std::shared_ptr<AutoBackendTexture::LocalRef> imageTextureRef =
-                std::make_shared<AutoBackendTexture::LocalRef>(grContext,
-                                                               buffer->toAHardwareBuffer(),
-                                                               isRenderable, mTextureCleanupMgr);
-        cache.insert({buffer->getId(), imageTextureRef});
+                mUncachedTextureCache.erase(buffer->getId());
+        if (imageTextureRef == nullptr || isRenderable) {
+            imageTextureRef =
+                    std::make_shared<AutoBackendTexture::LocalRef>(grContext,
+                                                                   buffer->toAHardwareBuffer(),
+                                                                   isRenderable,
+                                                                   mTextureCleanupMgr);
+        }
+        mTextureLru.push_front(buffer->getId());
+        const size_t bytes = estimateTextureBytes(*buffer);
+        mTextureCacheBytes += bytes;
+        cache.insert({buffer->getId(),
+                      CachedTexture{.ref = std::move(imageTextureRef),
+                                    .isRenderable = isRenderable,
+                                    .bytes = bytes,
+                                    .lruPosition = mTextureLru.begin()}});
     }
 }
 
@@ -457,7 +747,13 @@ void SkiaRenderEngine::unmapExternalTextureBuffer(sp<GraphicBuffer>&& buffer) {
         useProtectedContext(buffer->getUsage() & GRALLOC_USAGE_PROTECTED);
 
         if (iter->second == 0) {
-            mTextureCache.erase(buffer->getId());
+            if (const auto it = mTextureCache.find(buffer->getId()); it != mTextureCache.end()) {
+                if (it->second.ref) {
+                    mTextureLru.erase(it->second.lruPosition);
+                    mTextureCacheBytes -= it->second.bytes;
+                }
+                mTextureCache.erase(it);
+            }
             mGraphicBufferExternalRefs.erase(buffer->getId());
         }
 
@@ -474,7 +770,35 @@ std::shared_ptr<AutoBackendTexture::LocalRef> SkiaRenderEngine::getOrCreateBacke
     // Do not lookup the buffer in the cache for protected contexts
     if (!isProtected()) {
         if (const auto& it = mTextureCache.find(buffer->getId()); it != mTextureCache.end()) {
-            return it->second;
+            CachedTexture& texture = it->second;
+            if (texture.ref) {
+                mTextureCacheStats.hits++;
+                mTextureLru.splice(mTextureLru.begin(), mTextureLru, texture.lruPosition);
+            } else {
+                // Imported again after being evicted.
+                mTextureCacheStats.misses++;
+                texture.ref = std::make_shared<
+                        AutoBackendTexture::LocalRef>(getActiveGrContext(),
+                                                      buffer->toAHardwareBuffer(),
+                                                      texture.isRenderable, mTextureCleanupMgr);
+                mTextureLru.push_front(it->first);
+                texture.lruPosition = mTextureLru.begin();
+                mTextureCacheBytes += texture.bytes;
+            }
+            texture.lastDraw = mDrawCount;
+            return texture.ref;
+        }
+        mTextureCacheStats.misses++;
+        if (!isOutputBuffer && !(buffer->getUsage() & GRALLOC_USAGE_PROTECTED)) {
+            auto textureRef = mUncachedTextureCache.get(buffer->getId());
+            if (textureRef == nullptr) {
+                textureRef =
+                        std::make_shared<AutoBackendTexture::LocalRef>(getActiveGrContext(),
+                                                                       buffer->toAHardwareBuffer(),
+                                                                       false, mTextureCleanupMgr);
+                mUncachedTextureCache.put(buffer->getId(), textureRef);
+            }
+            return textureRef;
         }
     }
     return std::make_shared<AutoBackendTexture::LocalRef>(getActiveGrContext(),
@@ -482,6 +806,38 @@ std::shared_ptr<AutoBackendTexture::LocalRef> SkiaRenderEngine::getOrCreateBacke
                                                           isOutputBuffer, mTextureCleanupMgr);
 }
 
+void SkiaRenderEngine::trimTextureCacheLocked(size_t budgetBytes) {
+    auto it = mTextureLru.end();
+    while (mTextureCacheBytes > budgetBytes && it != mTextureLru.begin()) {
+        --it;
+        CachedTexture& texture = mTextureCache.at(*it);
+        // The rest of the list was used at least as recently.
+        if (texture.lastDraw == mDrawCount) break;
+        if (texture.ref.use_count() > 1) continue;
+
+        // The release of the texture waits for cleanupPostRender if a draw still uses it.
+        texture.ref.reset();
+        mTextureCacheBytes -= texture.bytes;
+        it = mTextureLru.erase(it);
+        mTextureCacheStats.evictions++;
+    }
+}
+
+void SkiaRenderEngine::trimMemory() {
+    ATRACE_CALL();
+    std::lock_guard<std::mutex> lock(mRenderingMutex);
+
+    // Keeps the textures of the last frame, which the next one most likely draws again.
+    trimTextureCacheLocked(0);
+    mUncachedTextureCache.clear();
+    mBlurCache.clear();
+
+    // Only the active context may be used, the other one is released when switching to it.
+    if (auto context = getActiveGrContext()) {
+        context->purgeUnlockedResources(GrPurgeResourceOptions::kAllResources);
+    }
+}
+
 bool SkiaRenderEngine::canSkipPostRenderCleanup() const {
     std::lock_guard<std::mutex> lock(mRenderingMutex);
     return mTextureCleanupMgr.isEmpty();
@@ -516,14 +872,7 @@ sk_sp<SkShader> SkiaRenderEngine::createRuntimeEffectShader(
                                       .undoPremultipliedAlpha = parameters.undoPremultipliedAlpha,
                                       .fakeOutputDataspace = parameters.fakeOutputDataspace};
 
-        auto effectIter = mRuntimeEffects.find(effect);
-        sk_sp<SkRuntimeEffect> runtimeEffect = nullptr;
-        if (effectIter == mRuntimeEffects.end()) {
-            runtimeEffect = buildRuntimeEffect(effect);
-            mRuntimeEffects.insert({effect, runtimeEffect});
-        } else {
-            runtimeEffect = effectIter->second;
-        }
+        sk_sp<SkRuntimeEffect> runtimeEffect = getRuntimeEffect(effect);
 
         mat4 colorTransform = parameters.layer.colorTransform;
 
@@ -673,6 +1022,7 @@ void SkiaRenderEngine::drawLayersInternal(
 
     // any AutoBackendTexture deletions will now be deferred until cleanupPostRender is called
     DeferTextureCleanup dtc(mTextureCleanupMgr);
+    mDrawCount++;
 
     auto surfaceTextureRef = getOrCreateBackendTexture(buffer->getBuffer(), true);
 
@@ -742,10 +1092,39 @@ void SkiaRenderEngine::drawLayersInternal(
     }
 
     AutoSaveRestore surfaceAutoSaveRestore(canvas);
+    // Only redraw the damage when the caller knows the buffer to be up to date outside of it. A
+    // blur reads the content around what it covers, so the displays with blurs are redrawn whole.
+    const bool redrawsDamageOnly = !(display.damage.isRect() &&
+                                     display.damage.getBounds() == Rect::INVALID_RECT) &&
+            std::none_of(layers.begin(), layers.end(), [ctModifiesAlpha](const auto& layer) {
+                return layerHasBlur(layer, ctModifiesAlpha);
+            });
+    if (redrawsDamageOnly) {
+        SkRegion damage;
+        for (const auto& r : display.damage) {
+            damage.op({r.left, r.top, r.right, r.bottom}, SkRegion::kUnion_Op);
+        }
+        canvas->clipRegion(damage);
+    }
     // Clear the entire canvas with a transparent black to prevent ghost images.
     canvas->clear(SK_ColorTRANSPARENT);
     initCanvas(canvas, display);
 
+    // Skip the layers which are hidden by the opaque layers drawn after them, e.g. the activities
+    // below a full screen one, and clip the partly hidden ones, to save their fill on the GPU.
+    const std::vector<LayerVisibility> visibilities =
+            computeLayerVisibilities(layers, canvas->getTotalMatrix(), ctModifiesAlpha);
+    if (ATRACE_ENABLED()) {
+        ATRACE_INT("RE culled layers",
+                   std::count_if(visibilities.begin(), visibilities.end(),
+                                 [](const auto& visibility) { return visibility.culled; }));
+        ATRACE_INT("RE clipped layers",
+                   std::count_if(visibilities.begin(), visibilities.end(),
+                                 [](const auto& visibility) {
+                                     return visibility.visibleRect.has_value();
+                                 }));
+    }
+
     if (kPrintLayerSettings) {
         logSettings(display);
     }
@@ -756,6 +1135,11 @@ void SkiaRenderEngine::drawLayersInternal(
             logSettings(layer);
         }
 
+        const LayerVisibility& visibility = visibilities[&layer - layers.data()];
+        if (visibility.culled) {
+            continue;
+        }
+
         sk_sp<SkImage> blurInput;
         if (blurCompositionLayer == &layer) {
             LOG_ALWAYS_FATAL_IF(activeSurface == dstSurface);
@@ -805,6 +1189,13 @@ void SkiaRenderEngine::drawLayersInternal(
             canvas->drawAnnotation(SkRect::MakeEmpty(), layer.name.c_str(),
                                    SkData::MakeWithCString(layerSettings.str().c_str()));
         }
+        if (visibility.visibleRect) {
+            const SkMatrix matrix = canvas->getTotalMatrix();
+            canvas->resetMatrix();
+            canvas->clipRect(*visibility.visibleRect);
+            canvas->setMatrix(matrix);
+        }
+
         // Layers have a local transform that should be applied to them
         canvas->concat(getSkM44(layer.geometry.positionTransform).asM33());
 
@@ -843,10 +1234,28 @@ void SkiaRenderEngine::drawLayersInternal(
 
             // TODO(b/182216890): Filter out empty layers earlier
             if (blurRect.width() > 0 && blurRect.height() > 0) {
+                // Reuse the blurs of a previous frame if the content below did not change since.
+                const auto blurContent =
+                        BlurCache::Content::make(grContext, display,
+                                                 std::span(layers.data(), &layer),
+                                                 displayDimmingRatio, *blurInput);
+                const auto generateBlur = [&](uint32_t blurRadius) REQUIRES(mRenderingMutex) {
+                    sk_sp<SkImage> blurredImage =
+                            blurContent ? mBlurCache.get(*blurContent, blurRadius, blurRect)
+                                        : nullptr;
+                    if (!blurredImage) {
+                        blurredImage =
+                                mBlurFilter->generate(grContext, blurRadius, blurInput, blurRect);
+                        if (blurredImage != blurInput) {
+                            mBlurCache.put(blurContent, blurRadius, blurRect, blurredImage);
+                        }
+                    }
+                    return blurredImage;
+                };
+
                 if (layer.backgroundBlurRadius > 0) {
                     ATRACE_NAME("BackgroundBlur");
-                    auto blurredImage = mBlurFilter->generate(grContext, layer.backgroundBlurRadius,
-                                                              blurInput, blurRect);
+                    auto blurredImage = generateBlur(layer.backgroundBlurRadius);
 
                     cachedBlurs[layer.backgroundBlurRadius] = blurredImage;
 
@@ -858,9 +1267,7 @@ void SkiaRenderEngine::drawLayersInternal(
                 for (auto region : layer.blurRegions) {
                     if (cachedBlurs[region.blurRadius] == nullptr) {
                         ATRACE_NAME("BlurRegion");
-                        cachedBlurs[region.blurRadius] =
-                                mBlurFilter->generate(grContext, region.blurRadius, blurInput,
-                                                      blurRect);
+                        cachedBlurs[region.blurRadius] = generateBlur(region.blurRadius);
                     }
 
                     mBlurFilter->drawBlurRegion(canvas, getBlurRRect(region), region.blurRadius,
@@ -1161,6 +1568,10 @@ void SkiaRenderEngine::drawLayersInternal(
 
     auto drawFence = sp<Fence>::make(flushAndSubmit(grContext));
 
+    if (mTextureCacheBudgetBytes > 0) {
+        trimTextureCacheLocked(mTextureCacheBudgetBytes);
+    }
+
     if (ATRACE_ENABLED()) {
         static gui::FenceMonitor sMonitor("RE Completion");
         sMonitor.queueFence(drawFence);
@@ -1263,9 +1674,16 @@ void SkiaRenderEngine::dump(std::string& result) {
         StringAppendF(&result, "Dumping buffer ids...\n");
         // TODO(178539829): It would be nice to know which layer these are coming from and what
         // the texture sizes are.
-        for (const auto& [id, unused] : mTextureCache) {
-            StringAppendF(&result, "- 0x%" PRIx64 "\n", id);
+        for (const auto& [id, texture] : mTextureCache) {
+            StringAppendF(&result, "- 0x%" PRIx64 "%s\n", id, texture.ref ? "" : " (evicted)");
         }
+        StringAppendF(&result,
+                      "RenderEngine texture cache: %zu/%zu bytes, %" PRIu64 " hits, %" PRIu64
+                      " misses, %" PRIu64 " evictions\n",
+                      mTextureCacheBytes, mTextureCacheBudgetBytes, mTextureCacheStats.hits,
+                      mTextureCacheStats.misses, mTextureCacheStats.evictions);
+        mUncachedTextureCache.dump(result, "RenderEngine uncached ");
+        mBlurCache.dump(result);
         StringAppendF(&result, "\n");
 
         SkiaMemoryReporter gpuProtectedReporter(gpuResourceMap, true);
@@ -1279,8 +1697,9 @@ void SkiaRenderEngine::dump(std::string& result) {
         gpuProtectedReporter.logOutput(result, true);
 
         StringAppendF(&result, "\n");
-        StringAppendF(&result, "RenderEngine runtime effects: %zu\n", mRuntimeEffects.size());
-        for (const auto& [linearEffect, unused] : mRuntimeEffects) {
+        const std::vector<shaders::LinearEffect> linearEffects = getBuiltLinearEffects();
+        StringAppendF(&result, "RenderEngine runtime effects: %zu\n", linearEffects.size());
+        for (const auto& linearEffect : linearEffects) {
             StringAppendF(&result, "- inputDataspace: %s\n",
                           dataspaceDetails(
                                   static_cast<android_dataspace>(linearEffect.inputDataspace))
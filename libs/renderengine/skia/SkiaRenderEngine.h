@@ -24,14 +24,18 @@
 #include <GrDirectContext.h>
 #include <SkSurface.h>
 #include <android-base/thread_annotations.h>
+#include <gui/EGLImageCache.h>
 #include <renderengine/ExternalTexture.h>
 #include <renderengine/RenderEngine.h>
 #include <sys/types.h>
 
+#include <list>
 #include <mutex>
+#include <string>
 #include <unordered_map>
 
 #include "AutoBackendTexture.h"
+#include "BlurCache.h"
 #include "GrContextOptions.h"
 #include "SkImageInfo.h"
 #include "SkiaRenderEngine.h"
@@ -59,7 +63,8 @@ class BlurFilter;
 class SkiaRenderEngine : public RenderEngine {
 public:
     static std::unique_ptr<SkiaRenderEngine> create(const RenderEngineCreationArgs& args);
-    SkiaRenderEngine(Threaded, PixelFormat pixelFormat, bool supportsBackgroundBlur);
+    SkiaRenderEngine(Threaded, PixelFormat pixelFormat, bool supportsBackgroundBlur,
+                     size_t uncachedTextureCacheSize);
     ~SkiaRenderEngine() override;
 
     std::future<void> primeCache(bool shouldPrimeUltraHDR) override final;
@@ -71,6 +76,7 @@ public:
     int reportShadersCompiled();
 
     virtual void setEnableTracing(bool tracingEnabled) override final;
+    void trimMemory() override final;
 
     void useProtectedContext(bool useProtectedContext) override;
     bool supportsProtectedContent() const override {
@@ -98,16 +104,37 @@ protected:
     bool isProtected() const { return mInProtectedContext; }
 
     // Implements PersistentCache as a way to monitor what SkSL shaders Skia has
-    // cached.
+    // cached. Once given a file, it also keeps what Skia stores while the cache is primed, which
+    // is the program binaries for GL and the pipeline cache for Vulkan, and persists it to the
+    // file, so that the shaders compiled on a previous boot with the same driver do not need to
+    // be compiled again.
     class SkSLCacheMonitor : public GrContextOptions::PersistentCache {
     public:
-        SkSLCacheMonitor() = default;
+        // The most entries kept, primeCache storing a few hundred.
+        static constexpr size_t kMaxPersistentEntries = 1024;
+        // The cache directory of SurfaceFlinger, which holds the persisted file.
+        static constexpr const char* kPersistentCacheDirectory = "/data/misc/surfaceflinger";
+
+        explicit SkSLCacheMonitor(std::string directory = kPersistentCacheDirectory)
+              : mDirectory(std::move(directory)) {}
         ~SkSLCacheMonitor() override = default;
 
         sk_sp<SkData> load(const SkData& key) override;
 
         void store(const SkData& key, const SkData& data, const SkString& description) override;
 
+        // Reads the entries persisted to the file of the given name within the directory,
+        // unless they were written for another driver, as identified by driverKey. Returns
+        // false, persisting nothing, if the name is not that of a file within the directory.
+        bool setPersistentFile(const std::string& fileName, std::string driverKey);
+
+        // Writes the entries to the file, if any was stored since the file was read, and stops
+        // keeping the entries stored from then on, which depend on the content shown rather than
+        // on the shaders primeCache warms up.
+        void persist();
+
+        size_t persistentEntryCount() const { return mEntries.size(); }
+
         int shadersCachedSinceLastCall() {
             const int shadersCachedSinceLastCall = mShadersCachedSinceLastCall;
             mShadersCachedSinceLastCall = 0;
@@ -119,6 +146,13 @@ protected:
     private:
         int mShadersCachedSinceLastCall = 0;
         int mTotalShadersCompiled = 0;
+
+        const std::string mDirectory;
+        std::string mPath;
+        std::string mDriverKey;
+        std::unordered_map<std::string, sk_sp<SkData>> mEntries;
+        bool mEntriesChanged = false;
+        bool mPersisted = false;
     };
 
 private:
@@ -129,6 +163,9 @@ private:
 
     std::shared_ptr<AutoBackendTexture::LocalRef> getOrCreateBackendTexture(
             const sp<GraphicBuffer>& buffer, bool isOutputBuffer) REQUIRES(mRenderingMutex);
+    // Evicts the least recently used textures of mTextureCache, down to the given budget. The
+    // textures which the last drawLayers call used, or which are still referenced, are kept.
+    void trimTextureCacheLocked(size_t budgetBytes) REQUIRES(mRenderingMutex);
     void initCanvas(SkCanvas* canvas, const DisplaySettings& display);
     void drawShadow(SkCanvas* canvas, const SkRRect& casterRRect,
                     const ShadowSettings& shadowSettings);
@@ -166,10 +203,36 @@ private:
     // For GL, this cache is shared between protected and unprotected contexts. For Vulkan, it is
     // only used for the unprotected context, because Vulkan does not allow sharing between
     // contexts, and protected is less common.
-    std::unordered_map<GraphicBufferId, std::shared_ptr<AutoBackendTexture::LocalRef>> mTextureCache
+    struct CachedTexture {
+        // Null once evicted, until the buffer is drawn again.
+        std::shared_ptr<AutoBackendTexture::LocalRef> ref;
+        bool isRenderable;
+        size_t bytes;
+        // The drawLayers call which last used the texture.
+        uint64_t lastDraw = 0;
+        // The position in mTextureLru, unless evicted.
+        std::list<GraphicBufferId>::iterator lruPosition;
+    };
+    std::unordered_map<GraphicBufferId, CachedTexture> mTextureCache GUARDED_BY(mRenderingMutex);
+    // The ids of the textures of mTextureCache which are not evicted, from the most to the least
+    // recently used.
+    std::list<GraphicBufferId> mTextureLru GUARDED_BY(mRenderingMutex);
+    // The bytes held by the textures of mTextureLru, and the budget they are trimmed to after each
+    // drawLayers call, if not 0.
+    size_t mTextureCacheBytes GUARDED_BY(mRenderingMutex) = 0;
+    const size_t mTextureCacheBudgetBytes;
+    uint64_t mDrawCount GUARDED_BY(mRenderingMutex) = 0;
+    struct TextureCacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+    TextureCacheStats mTextureCacheStats GUARDED_BY(mRenderingMutex);
+    // The most recently used imports of input buffers which are not in mTextureCache, e.g. because
+    // they were mapped while in the protected context, so that they are not imported again for
+    // each frame. It is only used for the unprotected context, and disabled if its size is 0.
+    EGLImageCache<std::shared_ptr<AutoBackendTexture::LocalRef>> mUncachedTextureCache
             GUARDED_BY(mRenderingMutex);
-    std::unordered_map<shaders::LinearEffect, sk_sp<SkRuntimeEffect>, shaders::LinearEffectHasher>
-            mRuntimeEffects;
     AutoBackendTexture::CleanupManager mTextureCleanupMgr GUARDED_BY(mRenderingMutex);
 
     StretchShaderFactory mStretchShaderFactory;
@@ -177,6 +240,11 @@ private:
     sp<Fence> mLastDrawFence;
     BlurFilter* mBlurFilter = nullptr;
 
+    // Enough for the blurs of a few full screen layers, which are downscaled by
+    // BlurFilter::kInputScale.
+    static constexpr size_t kBlurCacheBudgetBytes = 8 * 1024 * 1024;
+    BlurCache mBlurCache GUARDED_BY(mRenderingMutex);
+
     // Object to capture commands send to Skia.
     std::unique_ptr<SkiaCapture> mCapture;
 
@@ -34,6 +34,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -65,10 +66,20 @@ struct DestroySemaphoreInfo {
     // done with the semaphore and the GPU has finished work on the semaphore. SkiaVkRenderEngine
     // calls delete_semaphore* after sending the semaphore to Skia and exporting it if need be.
     int mRefs = 2;
+    // Whether the semaphore may be signaled again once the GPU is done with it. It may not if its
+    // payload could not be exported, so that a signal operation may still be pending on it.
+    bool mReusable = true;
+    // The semaphores waited on by the flushed work, which are free once the GPU is done with it.
+    std::vector<VkSemaphore> mWaitSemaphores;
 
     DestroySemaphoreInfo(VkSemaphore semaphore) : mSemaphore(semaphore) {}
 };
 
+// Guards the semaphore pools of the VulkanInterfaces, which are shared by all the engines of the
+// process. Skia calls the finished procs which release semaphores from the thread driving its
+// context, which is the RenderEngine thread, so the lock is normally uncontended.
+static std::mutex sSemaphorePoolMutex;
+
 namespace {
 void onVkDeviceFault(void* callbackContext, const std::string& description,
                      const std::vector<VkDeviceFaultAddressInfoEXT>& addressInfos,
@@ -98,6 +109,19 @@ struct VulkanInterface {
     std::vector<std::string> instanceExtensionNames;
     std::vector<std::string> deviceExtensionNames;
 
+    // Creating and destroying the semaphores of each draw shows up in every frame, so the
+    // semaphores are kept for reuse once the GPU is done with them. A binary semaphore is back to
+    // the unsignaled state once its temporarily imported payload has been waited on, or once its
+    // payload has been exported to a sync fd, so either kind can be reused as is.
+    static constexpr size_t kMaxPooledSemaphores = 16;
+    std::vector<VkSemaphore> exportableSemaphorePool;
+    std::vector<VkSemaphore> importSemaphorePool;
+    // The semaphores which Skia was told to wait on, in work not flushed yet. They go back to the
+    // pool once the GPU finishes the next flushAndSubmit, which submits the waits at the latest.
+    std::vector<VkSemaphore> pendingWaitSemaphores;
+    uint64_t semaphoresCreated = 0;
+    uint64_t semaphoresReused = 0;
+
     GrVkBackendContext getBackendContext() {
         GrVkBackendContext backendContext;
         backendContext.fInstance = instance;
@@ -115,7 +139,37 @@ struct VulkanInterface {
         return backendContext;
     };
 
+    VkSemaphore acquirePooledSemaphore(std::vector<VkSemaphore>& pool) {
+        std::lock_guard lock(sSemaphorePoolMutex);
+        if (pool.empty()) {
+            semaphoresCreated++;
+            return VK_NULL_HANDLE;
+        }
+        semaphoresReused++;
+        const VkSemaphore semaphore = pool.back();
+        pool.pop_back();
+        return semaphore;
+    }
+
+    // The GPU must be done with the semaphore.
+    void releasePooledSemaphore(std::vector<VkSemaphore>& pool, VkSemaphore semaphore) {
+        {
+            std::lock_guard lock(sSemaphorePoolMutex);
+            if (pool.size() < kMaxPooledSemaphores) {
+                pool.push_back(semaphore);
+                return;
+            }
+        }
+        destroySemaphore(semaphore);
+    }
+
+    // Returns a pooled semaphore if there is one.
     VkSemaphore createExportableSemaphore() {
+        if (VkSemaphore semaphore = acquirePooledSemaphore(exportableSemaphorePool);
+            semaphore != VK_NULL_HANDLE) {
+            return semaphore;
+        }
+
         VkExportSemaphoreCreateInfo exportInfo;
         exportInfo.sType = VK_STRUCTURE_TYPE_EXPORT_SEMAPHORE_CREATE_INFO;
         exportInfo.pNext = nullptr;
@@ -136,18 +190,22 @@ struct VulkanInterface {
         return semaphore;
     }
 
-    // syncFd cannot be <= 0
+    // syncFd cannot be <= 0. The import takes ownership of syncFd only if it succeeds. Returns a
+    // pooled semaphore if there is one.
     VkSemaphore importSemaphoreFromSyncFd(int syncFd) {
-        VkSemaphoreCreateInfo semaphoreInfo;
-        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-        semaphoreInfo.pNext = nullptr;
-        semaphoreInfo.flags = 0;
-
-        VkSemaphore semaphore;
-        VkResult err = funcs.vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore);
-        if (VK_SUCCESS != err) {
-            ALOGE("%s: failed to create import semaphore", __func__);
-            return VK_NULL_HANDLE;
+        VkSemaphore semaphore = acquirePooledSemaphore(importSemaphorePool);
+        VkResult err;
+        if (semaphore == VK_NULL_HANDLE) {
+            VkSemaphoreCreateInfo semaphoreInfo;
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            semaphoreInfo.pNext = nullptr;
+            semaphoreInfo.flags = 0;
+
+            err = funcs.vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore);
+            if (VK_SUCCESS != err) {
+                ALOGE("%s: failed to create import semaphore", __func__);
+                return VK_NULL_HANDLE;
+            }
         }
 
         VkImportSemaphoreFdInfoKHR importInfo;
@@ -160,7 +218,8 @@ struct VulkanInterface {
 
         err = funcs.vkImportSemaphoreFdKHR(device, &importInfo);
         if (VK_SUCCESS != err) {
-            funcs.vkDestroySemaphore(device, semaphore, nullptr);
+            // A failed import leaves the semaphore as it was.
+            releasePooledSemaphore(importSemaphorePool, semaphore);
             ALOGE("%s: failed to import semaphore", __func__);
             return VK_NULL_HANDLE;
         }
@@ -188,6 +247,28 @@ struct VulkanInterface {
     void destroySemaphore(VkSemaphore semaphore) {
         funcs.vkDestroySemaphore(device, semaphore, nullptr);
     }
+
+    // Called once Skia and the GPU are done with the flush which signals info->mSemaphore.
+    void releaseSemaphores(const DestroySemaphoreInfo& info) {
+        if (info.mReusable) {
+            releasePooledSemaphore(exportableSemaphorePool, info.mSemaphore);
+        } else {
+            destroySemaphore(info.mSemaphore);
+        }
+        for (VkSemaphore waitSemaphore : info.mWaitSemaphores) {
+            releasePooledSemaphore(importSemaphorePool, waitSemaphore);
+        }
+    }
+
+    void destroyPooledSemaphores() {
+        std::lock_guard lock(sSemaphorePoolMutex);
+        for (auto* pool : {&exportableSemaphorePool, &importSemaphorePool, &pendingWaitSemaphores}) {
+            for (VkSemaphore semaphore : *pool) {
+                destroySemaphore(semaphore);
+            }
+            pool->clear();
+        }
+    }
 };
 
 namespace {
@@ -615,6 +696,7 @@ void teardownVulkanInterface(VulkanInterface* interface) {
 
     if (interface->device != VK_NULL_HANDLE) {
         interface->funcs.vkDeviceWaitIdle(interface->device);
+        interface->destroyPooledSemaphores();
         interface->funcs.vkDestroyDevice(interface->device, nullptr);
         interface->device = VK_NULL_HANDLE;
     }
@@ -699,7 +781,7 @@ std::unique_ptr<SkiaVkRenderEngine> SkiaVkRenderEngine::create(
 
 SkiaVkRenderEngine::SkiaVkRenderEngine(const RenderEngineCreationArgs& args)
       : SkiaRenderEngine(args.threaded, static_cast<PixelFormat>(args.pixelFormat),
-                         args.supportsBackgroundBlur) {}
+                         args.supportsBackgroundBlur, 0 /* uncachedTextureCacheSize */) {}
 
 SkiaVkRenderEngine::~SkiaVkRenderEngine() {
     finishRenderingAndAbandonContext();
@@ -732,7 +814,7 @@ static void delete_semaphore(void* semaphore) {
     DestroySemaphoreInfo* info = reinterpret_cast<DestroySemaphoreInfo*>(semaphore);
     --info->mRefs;
     if (!info->mRefs) {
-        sVulkanInterface.destroySemaphore(info->mSemaphore);
+        sVulkanInterface.releaseSemaphores(*info);
         delete info;
     }
 }
@@ -741,7 +823,7 @@ static void delete_semaphore_protected(void* semaphore) {
     DestroySemaphoreInfo* info = reinterpret_cast<DestroySemaphoreInfo*>(semaphore);
     --info->mRefs;
     if (!info->mRefs) {
-        sProtectedContentVulkanInterface.destroySemaphore(info->mSemaphore);
+        sProtectedContentVulkanInterface.releaseSemaphores(*info);
         delete info;
     }
 }
@@ -764,11 +846,27 @@ void SkiaVkRenderEngine::waitFence(GrDirectContext* grContext, base::borrowed_fd
     }
 
     base::unique_fd fenceDup(dupedFd);
-    VkSemaphore waitSemaphore =
-            getVulkanInterface(isProtected()).importSemaphoreFromSyncFd(fenceDup.release());
+    VulkanInterface& vi = getVulkanInterface(isProtected());
+    VkSemaphore waitSemaphore = vi.importSemaphoreFromSyncFd(fenceDup.get());
+    if (waitSemaphore == VK_NULL_HANDLE) {
+        sync_wait(fenceFd.get(), -1);
+        return;
+    }
+    // The semaphore now owns the fd.
+    (void)fenceDup.release();
+
     GrBackendSemaphore beSemaphore;
     beSemaphore.initVulkan(waitSemaphore);
-    grContext->wait(1, &beSemaphore, true /* delete after wait */);
+    if (!grContext->wait(1, &beSemaphore, false /* delete after wait */)) {
+        // Skia did not take the semaphore, whose imported payload is then never waited on.
+        ALOGE("%s: failed to wait on semaphore, waiting on the CPU instead", __func__);
+        sync_wait(fenceFd.get(), -1);
+        vi.destroySemaphore(waitSemaphore);
+        return;
+    }
+
+    std::lock_guard lock(sSemaphorePoolMutex);
+    vi.pendingWaitSemaphores.push_back(waitSemaphore);
 }
 
 base::unique_fd SkiaVkRenderEngine::flushAndSubmit(GrDirectContext* grContext) {
@@ -782,6 +880,10 @@ base::unique_fd SkiaVkRenderEngine::flushAndSubmit(GrDirectContext* grContext) {
     DestroySemaphoreInfo* destroySemaphoreInfo = nullptr;
     if (semaphore != VK_NULL_HANDLE) {
         destroySemaphoreInfo = new DestroySemaphoreInfo(semaphore);
+        {
+            std::lock_guard lock(sSemaphorePoolMutex);
+            destroySemaphoreInfo->mWaitSemaphores.swap(vi.pendingWaitSemaphores);
+        }
         flushInfo.fNumSemaphores = 1;
         flushInfo.fSignalSemaphores = &backendSemaphore;
         flushInfo.fFinishedProc = isProtected() ? delete_semaphore_protected : delete_semaphore;
@@ -793,6 +895,7 @@ base::unique_fd SkiaVkRenderEngine::flushAndSubmit(GrDirectContext* grContext) {
     if (semaphore != VK_NULL_HANDLE) {
         if (GrSemaphoresSubmitted::kYes == submitted) {
             drawFenceFd = vi.exportSemaphoreSyncFd(semaphore);
+            destroySemaphoreInfo->mReusable = drawFenceFd >= 0;
         }
         // Now that drawFenceFd has been created, we can delete our reference to this semaphore
         flushInfo.fFinishedProc(destroySemaphoreInfo);
@@ -821,6 +924,16 @@ void SkiaVkRenderEngine::appendBackendSpecificInfoToDump(std::string& result) {
         return;
     }
 
+    {
+        std::lock_guard lock(sSemaphorePoolMutex);
+        StringAppendF(&result,
+                      "\n Semaphores: %" PRIu64 " created, %" PRIu64
+                      " reused, %zu exportable and %zu import pooled\n",
+                      sVulkanInterface.semaphoresCreated, sVulkanInterface.semaphoresReused,
+                      sVulkanInterface.exportableSemaphorePool.size(),
+                      sVulkanInterface.importSemaphorePool.size());
+    }
+
     StringAppendF(&result, "\n Instance extensions:\n");
     for (const auto& name : sVulkanInterface.instanceExtensionNames) {
         StringAppendF(&result, "\n %s\n", name.c_str());
@@ -25,6 +25,9 @@
 
 #include <math/mat4.h>
 
+#include <mutex>
+#include <unordered_map>
+
 namespace android {
 namespace renderengine {
 namespace skia {
@@ -40,6 +43,53 @@ sk_sp<SkRuntimeEffect> buildRuntimeEffect(const shaders::LinearEffect& linearEff
     return shader;
 }
 
+namespace {
+
+std::mutex sRuntimeEffectsMutex;
+
+std::unordered_map<shaders::LinearEffect, sk_sp<SkRuntimeEffect>, shaders::LinearEffectHasher>&
+getRuntimeEffects() {
+    static auto& sRuntimeEffects =
+            *new std::unordered_map<shaders::LinearEffect, sk_sp<SkRuntimeEffect>,
+                                    shaders::LinearEffectHasher>();
+    return sRuntimeEffects;
+}
+
+} // namespace
+
+sk_sp<SkRuntimeEffect> getRuntimeEffect(const shaders::LinearEffect& linearEffect) {
+    {
+        std::lock_guard lock(sRuntimeEffectsMutex);
+        const auto it = getRuntimeEffects().find(linearEffect);
+        if (it != getRuntimeEffects().end()) {
+            return it->second;
+        }
+    }
+
+    // Built without holding the lock, so that a RenderEngine building an effect does not hold up
+    // another one looking up a different effect. If both build the same one, the first one wins.
+    sk_sp<SkRuntimeEffect> runtimeEffect = buildRuntimeEffect(linearEffect);
+    std::lock_guard lock(sRuntimeEffectsMutex);
+    return getRuntimeEffects().try_emplace(linearEffect, std::move(runtimeEffect)).first->second;
+}
+
+void prebuildCommonRuntimeEffects() {
+    ATRACE_CALL();
+    for (const shaders::LinearEffect& linearEffect : shaders::getCommonLinearEffects()) {
+        getRuntimeEffect(linearEffect);
+    }
+}
+
+std::vector<shaders::LinearEffect> getBuiltLinearEffects() {
+    std::lock_guard lock(sRuntimeEffectsMutex);
+    std::vector<shaders::LinearEffect> linearEffects;
+    linearEffects.reserve(getRuntimeEffects().size());
+    for (const auto& [linearEffect, unused] : getRuntimeEffects()) {
+        linearEffects.push_back(linearEffect);
+    }
+    return linearEffects;
+}
+
 sk_sp<SkShader> createLinearEffectShader(
         sk_sp<SkShader> shader, const shaders::LinearEffect& linearEffect,
         sk_sp<SkRuntimeEffect> runtimeEffect, const mat4& colorTransform, float maxDisplayLuminance,
@@ -50,10 +100,11 @@ sk_sp<SkShader> createLinearEffectShader(
 
     effectBuilder.child("child") = shader;
 
-    const auto uniforms =
-            shaders::buildLinearEffectUniforms(linearEffect, colorTransform, maxDisplayLuminance,
-                                               currentDisplayLuminanceNits, maxLuminance, buffer,
-                                               renderIntent);
+    // Reused across calls, as each layer drawn with a linear effect needs its uniforms each frame.
+    thread_local std::vector<tonemap::ShaderUniform> uniforms;
+    shaders::buildLinearEffectUniforms(uniforms, linearEffect, colorTransform, maxDisplayLuminance,
+                                       currentDisplayLuminanceNits, maxLuminance, buffer,
+                                       renderIntent);
 
     for (const auto& uniform : uniforms) {
         effectBuilder.uniform(uniform.name.c_str()).set(uniform.value.data(), uniform.value.size());
@@ -19,6 +19,7 @@
 #include <math/mat4.h>
 
 #include <optional>
+#include <vector>
 
 #include <shaders/shaders.h>
 #include "SkRuntimeEffect.h"
@@ -31,6 +32,17 @@ namespace skia {
 
 sk_sp<SkRuntimeEffect> buildRuntimeEffect(const shaders::LinearEffect& linearEffect);
 
+// Returns the runtime effect of the linear effect, which is only built the first time it is needed
+// by any RenderEngine of the process, since runtime effects do not depend on the GPU context.
+sk_sp<SkRuntimeEffect> getRuntimeEffect(const shaders::LinearEffect& linearEffect);
+
+// Builds the runtime effects of shaders::getCommonLinearEffects() which were not built yet, so that
+// the first frame drawing one of them does not wait for its SkSL to be generated and compiled.
+void prebuildCommonRuntimeEffects();
+
+// The linear effects whose runtime effect was built, for dumpsys.
+std::vector<shaders::LinearEffect> getBuiltLinearEffects();
+
 // Generates a shader resulting from applying the a linear effect created from
 // LinearEffectArgs::buildEffect to an inputShader.
 // Optionally, a color transform may also be provided, which combines with the
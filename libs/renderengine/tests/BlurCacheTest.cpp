@@ -0,0 +1,135 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "BlurCacheTest"
+
+#include <SkImage.h>
+#include <SkImageInfo.h>
+#include <SkSurface.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <renderengine/impl/ExternalTexture.h>
+#include <renderengine/mock/RenderEngine.h>
+
+#include "../skia/BlurCache.h"
+
+namespace android::renderengine::skia {
+
+using testing::NiceMock;
+
+struct BlurCacheTest : public ::testing::Test {
+    static sk_sp<SkImage> makeImage(int width, int height) {
+        const auto info = SkImageInfo::MakeN32Premul(width, height);
+        return SkSurfaces::Raster(info)->makeImageSnapshot();
+    }
+
+    std::shared_ptr<const BlurCache::Content> makeContent(
+            const std::vector<LayerSettings>& layers) const {
+        return BlurCache::Content::make(nullptr, mDisplay, layers, 1.f, *mInput);
+    }
+
+    LayerSettings makeBufferLayer(uint64_t frameNumber) {
+        LayerSettings layer;
+        layer.source.buffer.buffer = mBuffer;
+        layer.source.buffer.frameNumber = frameNumber;
+        return layer;
+    }
+
+    NiceMock<mock::RenderEngine> mRenderEngine;
+    const std::shared_ptr<ExternalTexture> mBuffer =
+            std::make_shared<impl::ExternalTexture>(sp<GraphicBuffer>::make(), mRenderEngine,
+                                                    impl::ExternalTexture::Usage::READABLE);
+    const DisplaySettings mDisplay{.physicalDisplay = Rect(100, 100), .clip = Rect(100, 100)};
+    const sk_sp<SkImage> mInput = makeImage(100, 100);
+    const SkRect mBlurRect = SkRect::MakeWH(100, 100);
+};
+
+TEST_F(BlurCacheTest, returnsBlurOfSameContent) {
+    BlurCache cache(1024 * 1024);
+    const std::vector<LayerSettings> layers = {makeBufferLayer(1)};
+    const sk_sp<SkImage> blur = makeImage(25, 25);
+
+    cache.put(makeContent(layers), 10, mBlurRect, blur);
+
+    // The content is compared by value, not by identity.
+    const auto content = makeContent(layers);
+    ASSERT_NE(nullptr, content);
+    EXPECT_EQ(blur, cache.get(*content, 10, mBlurRect));
+    EXPECT_EQ(nullptr, cache.get(*content, 20, mBlurRect));
+    EXPECT_EQ(nullptr, cache.get(*content, 10, SkRect::MakeWH(50, 50)));
+
+    const auto stats = cache.getStats();
+    EXPECT_EQ(1u, stats.hits);
+    EXPECT_EQ(2u, stats.misses);
+}
+
+TEST_F(BlurCacheTest, missesWhenContentChanges) {
+    BlurCache cache(1024 * 1024);
+    cache.put(makeContent({makeBufferLayer(1)}), 10, mBlurRect, makeImage(25, 25));
+
+    // A new frame queued into the same buffer.
+    EXPECT_EQ(nullptr, cache.get(*makeContent({makeBufferLayer(2)}), 10, mBlurRect));
+
+    LayerSettings movedLayer = makeBufferLayer(1);
+    movedLayer.geometry.boundaries = FloatRect(0, 0, 50, 50);
+    EXPECT_EQ(nullptr, cache.get(*makeContent({movedLayer}), 10, mBlurRect));
+
+    EXPECT_EQ(nullptr, cache.get(*makeContent({}), 10, mBlurRect));
+}
+
+TEST_F(BlurCacheTest, doesNotIdentifyBufferOfUnknownFrame) {
+    EXPECT_EQ(nullptr, makeContent({makeBufferLayer(0)}));
+
+    LayerSettings colorLayer;
+    colorLayer.source.solidColor = half3(1.f, 0.f, 0.f);
+    EXPECT_NE(nullptr, makeContent({colorLayer}));
+}
+
+TEST_F(BlurCacheTest, evictsLeastRecentlyUsedBlursOverBudget) {
+    const sk_sp<SkImage> blur = makeImage(25, 25);
+    const size_t blurBytes = blur->imageInfo().computeMinByteSize();
+    BlurCache cache(2 * blurBytes);
+
+    const auto content1 = makeContent({makeBufferLayer(1)});
+    const auto content2 = makeContent({makeBufferLayer(2)});
+    const auto content3 = makeContent({makeBufferLayer(3)});
+    cache.put(content1, 10, mBlurRect, blur);
+    cache.put(content2, 10, mBlurRect, blur);
+
+    // Makes the first blur the most recently used, so that the second one is evicted.
+    EXPECT_EQ(blur, cache.get(*content1, 10, mBlurRect));
+    cache.put(content3, 10, mBlurRect, blur);
+
+    EXPECT_EQ(blur, cache.get(*content1, 10, mBlurRect));
+    EXPECT_EQ(nullptr, cache.get(*content2, 10, mBlurRect));
+    EXPECT_EQ(blur, cache.get(*content3, 10, mBlurRect));
+
+    const auto stats = cache.getStats();
+    EXPECT_EQ(2 * blurBytes, stats.bytes);
+    EXPECT_EQ(1u, stats.evictions);
+}
+
+TEST_F(BlurCacheTest, doesNotKeepBlurLargerThanBudget) {
+    BlurCache cache(16);
+    const auto content = makeContent({});
+    cache.put(content, 10, mBlurRect, makeImage(25, 25));
+
+    EXPECT_EQ(nullptr, cache.get(*content, 10, mBlurRect));
+    EXPECT_EQ(0u, cache.getStats().bytes);
+}
+
+} // namespace android::renderengine::skia
@@ -1508,6 +1508,76 @@ TEST_P(RenderEngineTest, drawLayers_fillRedBufferAndEmptyBuffer) {
     expectBufferColor(fullscreenRect(), 0, 0, 0, 0);
 }
 
+TEST_P(RenderEngineTest, drawLayers_skipsLayersHiddenByOpaqueLayer) {
+    if (!GetParam()->apiSupported()) {
+        GTEST_SKIP();
+    }
+    initializeRenderEngine();
+    renderengine::DisplaySettings settings;
+    settings.physicalDisplay = fullscreenRect();
+    settings.clip = fullscreenRect();
+    settings.outputDataspace = ui::Dataspace::V0_SRGB_LINEAR;
+
+    const Rect topHalf(DEFAULT_DISPLAY_WIDTH, DEFAULT_DISPLAY_HEIGHT / 2);
+    const Rect bottomHalf(0, DEFAULT_DISPLAY_HEIGHT / 2, DEFAULT_DISPLAY_WIDTH,
+                          DEFAULT_DISPLAY_HEIGHT);
+
+    // A red layer only visible below the green one...
+    const renderengine::LayerSettings partlyHiddenLayer{
+            .geometry.boundaries = fullscreenRect().toFloatRect(),
+            .source.solidColor = half3(1.0f, 0.0f, 0.0f),
+            .alpha = 1.f,
+    };
+    // ...a rounded blue layer entirely hidden by it...
+    const renderengine::LayerSettings hiddenLayer{
+            .geometry.boundaries = FloatRect(8, 8, DEFAULT_DISPLAY_WIDTH - 8,
+                                             DEFAULT_DISPLAY_HEIGHT / 2 - 8),
+            .geometry.roundedCornersRadius = {4.0f, 4.0f},
+            .source.solidColor = half3(0.0f, 0.0f, 1.0f),
+            .alpha = 1.f,
+    };
+    // ...and the opaque green layer over the top half.
+    const renderengine::LayerSettings opaqueLayer{
+            .geometry.boundaries = topHalf.toFloatRect(),
+            .source.solidColor = half3(0.0f, 1.0f, 0.0f),
+            .alpha = 1.f,
+    };
+
+    std::vector<renderengine::LayerSettings> layers{partlyHiddenLayer, hiddenLayer, opaqueLayer};
+    invokeDraw(settings, layers);
+    expectBufferColor(topHalf, 0, 255, 0, 255);
+    expectBufferColor(bottomHalf, 255, 0, 0, 255);
+}
+
+TEST_P(RenderEngineTest, drawLayers_redrawsOnlyDamage) {
+    if (!GetParam()->apiSupported()) {
+        GTEST_SKIP();
+    }
+    initializeRenderEngine();
+    renderengine::DisplaySettings settings;
+    settings.physicalDisplay = fullscreenRect();
+    settings.clip = fullscreenRect();
+    settings.outputDataspace = ui::Dataspace::V0_SRGB_LINEAR;
+
+    renderengine::LayerSettings layer{
+            .geometry.boundaries = fullscreenRect().toFloatRect(),
+            .source.solidColor = half3(1.0f, 0.0f, 0.0f),
+            .alpha = 1.f,
+    };
+    std::vector<renderengine::LayerSettings> layers{layer};
+    invokeDraw(settings, layers);
+
+    const Rect topHalf(DEFAULT_DISPLAY_WIDTH, DEFAULT_DISPLAY_HEIGHT / 2);
+    const Rect bottomHalf(0, DEFAULT_DISPLAY_HEIGHT / 2, DEFAULT_DISPLAY_WIDTH,
+                          DEFAULT_DISPLAY_HEIGHT);
+    settings.damage = Region(topHalf);
+    layers[0].source.solidColor = half3(0.0f, 1.0f, 0.0f);
+    invokeDraw(settings, layers);
+
+    expectBufferColor(topHalf, 0, 255, 0, 255);
+    expectBufferColor(bottomHalf, 255, 0, 0, 255);
+}
+
 TEST_P(RenderEngineTest, drawLayers_withoutBuffers_withColorTransform) {
     if (!GetParam()->apiSupported()) {
         GTEST_SKIP();
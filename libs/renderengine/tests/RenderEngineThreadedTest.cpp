@@ -23,9 +23,13 @@
 #include <ui/PixelFormat.h>
 #include "../threaded/RenderEngineThreaded.h"
 
+#include <future>
+#include <thread>
+
 namespace android {
 
 using testing::_;
+using testing::ElementsAre;
 using testing::Eq;
 using testing::Mock;
 using testing::Return;
@@ -56,6 +60,13 @@ TEST_F(RenderEngineThreadedTest, primeCache) {
     mThreadedRE->getContextPriority();
 }
 
+TEST_F(RenderEngineThreadedTest, trimMemory) {
+    EXPECT_CALL(*mRenderEngine, trimMemory());
+    mThreadedRE->trimMemory();
+    // call ANY synchronous function to ensure that trimMemory has completed.
+    mThreadedRE->getContextPriority();
+}
+
 TEST_F(RenderEngineThreadedTest, getMaxTextureSize_returns20) {
     size_t size = 20;
     EXPECT_CALL(*mRenderEngine, getMaxTextureSize()).WillOnce(Return(size));
@@ -168,6 +179,39 @@ TEST_F(RenderEngineThreadedTest, drawLayers) {
     ASSERT_TRUE(result.ok());
 }
 
+TEST_F(RenderEngineThreadedTest, drawLayers_fromSeveralThreads) {
+    renderengine::DisplaySettings settings;
+    std::vector<renderengine::LayerSettings> layers;
+    std::shared_ptr<renderengine::ExternalTexture> buffer = std::make_shared<
+            renderengine::impl::
+                    ExternalTexture>(sp<GraphicBuffer>::make(), *mRenderEngine,
+                                     renderengine::impl::ExternalTexture::Usage::READABLE |
+                                             renderengine::impl::ExternalTexture::Usage::WRITEABLE);
+
+    constexpr int kThreadCount = 4;
+    EXPECT_CALL(*mRenderEngine, useProtectedContext(false)).Times(kThreadCount);
+    EXPECT_CALL(*mRenderEngine, drawLayersInternal)
+            .Times(kThreadCount)
+            .WillRepeatedly([&](const std::shared_ptr<std::promise<FenceResult>>&& resultPromise,
+                                const renderengine::DisplaySettings&,
+                                const std::vector<renderengine::LayerSettings>&,
+                                const std::shared_ptr<renderengine::ExternalTexture>&,
+                                base::unique_fd&&) { resultPromise->set_value(Fence::NO_FENCE); });
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreadCount; i++) {
+        threads.emplace_back([&] {
+            ftl::Future<FenceResult> future =
+                    mThreadedRE->drawLayers(settings, layers, buffer, base::unique_fd());
+            ASSERT_TRUE(future.valid());
+            EXPECT_TRUE(future.get().ok());
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
 TEST_F(RenderEngineThreadedTest, drawLayers_protectedLayer) {
     renderengine::DisplaySettings settings;
     auto layerBuffer = sp<GraphicBuffer>::make();
@@ -229,4 +273,55 @@ TEST_F(RenderEngineThreadedTest, drawLayers_protectedOutputBuffer) {
     ASSERT_TRUE(result.ok());
 }
 
+TEST_F(RenderEngineThreadedTest, drawLayers_compositionRunsAheadOfQueuedCapture) {
+    const renderengine::DisplaySettings composition;
+    const renderengine::DisplaySettings capture{.priority =
+                                                        renderengine::RenderPriority::CAPTURE};
+    std::vector<renderengine::LayerSettings> layers;
+    std::shared_ptr<renderengine::ExternalTexture> buffer = std::make_shared<
+            renderengine::impl::
+                    ExternalTexture>(sp<GraphicBuffer>::make(), *mRenderEngine,
+                                     renderengine::impl::ExternalTexture::Usage::READABLE |
+                                             renderengine::impl::ExternalTexture::Usage::WRITEABLE);
+
+    // The first draw holds the thread until both of the others are queued.
+    std::promise<void> started;
+    std::promise<void> unblock;
+    std::future<void> unblocked = unblock.get_future();
+    std::vector<renderengine::RenderPriority> order;
+
+    EXPECT_CALL(*mRenderEngine, useProtectedContext(false)).Times(3);
+    EXPECT_CALL(*mRenderEngine, drawLayersInternal)
+            .Times(3)
+            .WillRepeatedly([&](const std::shared_ptr<std::promise<FenceResult>>&& resultPromise,
+                                const renderengine::DisplaySettings& display,
+                                const std::vector<renderengine::LayerSettings>&,
+                                const std::shared_ptr<renderengine::ExternalTexture>&,
+                                base::unique_fd&&) {
+                if (order.empty()) {
+                    started.set_value();
+                    unblocked.wait();
+                }
+                order.push_back(display.priority);
+                resultPromise->set_value(Fence::NO_FENCE);
+            });
+
+    ftl::Future<FenceResult> first =
+            mThreadedRE->drawLayers(composition, layers, buffer, base::unique_fd());
+    started.get_future().wait();
+    ftl::Future<FenceResult> second =
+            mThreadedRE->drawLayers(capture, layers, buffer, base::unique_fd());
+    ftl::Future<FenceResult> third =
+            mThreadedRE->drawLayers(composition, layers, buffer, base::unique_fd());
+    unblock.set_value();
+
+    EXPECT_TRUE(first.get().ok());
+    EXPECT_TRUE(second.get().ok());
+    EXPECT_TRUE(third.get().ok());
+    EXPECT_THAT(order,
+                ElementsAre(renderengine::RenderPriority::COMPOSITION,
+                            renderengine::RenderPriority::COMPOSITION,
+                            renderengine::RenderPriority::CAPTURE));
+}
+
 } // namespace android
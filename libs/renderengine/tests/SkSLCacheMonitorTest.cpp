@@ -0,0 +1,134 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "SkSLCacheMonitorTest"
+
+#include <SkData.h>
+#include <SkString.h>
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../skia/SkiaRenderEngine.h"
+
+namespace android::renderengine::skia {
+
+// SkSLCacheMonitor is only visible to the subclasses of SkiaRenderEngine.
+struct SkiaRenderEngineAccess : public SkiaRenderEngine {
+    using SkiaRenderEngine::SkSLCacheMonitor;
+};
+using SkSLCacheMonitor = SkiaRenderEngineAccess::SkSLCacheMonitor;
+
+struct SkSLCacheMonitorTest : public ::testing::Test {
+    static sk_sp<SkData> makeData(const std::string& contents) {
+        return SkData::MakeWithCopy(contents.data(), contents.size());
+    }
+
+    static void store(SkSLCacheMonitor& monitor, const std::string& key,
+                      const std::string& data) {
+        monitor.store(*makeData(key), *makeData(data), SkString());
+    }
+
+    static bool loads(SkSLCacheMonitor& monitor, const std::string& key,
+                      const std::string& data) {
+        const sk_sp<SkData> loaded = monitor.load(*makeData(key));
+        return loaded && loaded->equals(makeData(data).get());
+    }
+
+    TemporaryDir mDirectory;
+};
+
+TEST_F(SkSLCacheMonitorTest, cachesNothingWithoutFile) {
+    SkSLCacheMonitor monitor(mDirectory.path);
+    store(monitor, "key", "data");
+
+    EXPECT_EQ(nullptr, monitor.load(*makeData("key")));
+    EXPECT_EQ(1, monitor.totalShadersCompiled());
+}
+
+TEST_F(SkSLCacheMonitorTest, loadsPersistedEntries) {
+    {
+        SkSLCacheMonitor monitor(mDirectory.path);
+        ASSERT_TRUE(monitor.setPersistentFile("shaders", "driver"));
+        store(monitor, "key1", "data1");
+        store(monitor, "key2", "data2");
+        EXPECT_TRUE(loads(monitor, "key1", "data1"));
+        monitor.persist();
+    }
+
+    SkSLCacheMonitor monitor(mDirectory.path);
+    ASSERT_TRUE(monitor.setPersistentFile("shaders", "driver"));
+    EXPECT_EQ(2u, monitor.persistentEntryCount());
+    EXPECT_TRUE(loads(monitor, "key1", "data1"));
+    EXPECT_TRUE(loads(monitor, "key2", "data2"));
+}
+
+TEST_F(SkSLCacheMonitorTest, ignoresEntriesOfOtherDriver) {
+    {
+        SkSLCacheMonitor monitor(mDirectory.path);
+        ASSERT_TRUE(monitor.setPersistentFile("shaders", "driver"));
+        store(monitor, "key", "data");
+        monitor.persist();
+    }
+
+    SkSLCacheMonitor monitor(mDirectory.path);
+    ASSERT_TRUE(monitor.setPersistentFile("shaders", "updated driver"));
+    EXPECT_EQ(0u, monitor.persistentEntryCount());
+    EXPECT_EQ(nullptr, monitor.load(*makeData("key")));
+}
+
+TEST_F(SkSLCacheMonitorTest, stopsKeepingEntriesOncePersisted) {
+    SkSLCacheMonitor monitor(mDirectory.path);
+    ASSERT_TRUE(monitor.setPersistentFile("shaders", "driver"));
+    store(monitor, "primed", "data");
+    monitor.persist();
+
+    store(monitor, "content", "data");
+    EXPECT_EQ(1u, monitor.persistentEntryCount());
+    EXPECT_TRUE(loads(monitor, "primed", "data"));
+    EXPECT_EQ(nullptr, monitor.load(*makeData("content")));
+    EXPECT_EQ(2, monitor.totalShadersCompiled());
+}
+
+TEST_F(SkSLCacheMonitorTest, capsEntries) {
+    SkSLCacheMonitor monitor(mDirectory.path);
+    ASSERT_TRUE(monitor.setPersistentFile("shaders", "driver"));
+    for (size_t i = 0; i <= SkSLCacheMonitor::kMaxPersistentEntries; i++) {
+        store(monitor, std::to_string(i), "data");
+    }
+    EXPECT_EQ(SkSLCacheMonitor::kMaxPersistentEntries, monitor.persistentEntryCount());
+
+    // An entry already kept is still replaced.
+    store(monitor, "0", "new data");
+    EXPECT_TRUE(loads(monitor, "0", "new data"));
+}
+
+TEST_F(SkSLCacheMonitorTest, rejectsFileNamesOutsideDirectory) {
+    SkSLCacheMonitor monitor(mDirectory.path);
+    EXPECT_FALSE(monitor.setPersistentFile("", "driver"));
+    EXPECT_FALSE(monitor.setPersistentFile(".", "driver"));
+    EXPECT_FALSE(monitor.setPersistentFile("..", "driver"));
+    EXPECT_FALSE(monitor.setPersistentFile("../shaders", "driver"));
+    EXPECT_FALSE(monitor.setPersistentFile("/data/local/tmp/shaders", "driver"));
+
+    store(monitor, "key", "data");
+    monitor.persist();
+    EXPECT_EQ(nullptr, monitor.load(*makeData("key")));
+}
+
+} // namespace android::renderengine::skia
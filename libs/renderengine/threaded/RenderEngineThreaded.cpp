@@ -19,6 +19,7 @@
 #include "RenderEngineThreaded.h"
 
 #include <sched.h>
+#include <algorithm>
 #include <chrono>
 #include <future>
 
@@ -99,12 +100,7 @@ void RenderEngineThreaded::threadMain(CreateInstanceFactory factory) NO_THREAD_S
     while (mRunning) {
         const auto getNextTask = [this]() -> std::optional<Work> {
             std::scoped_lock lock(mThreadMutex);
-            if (!mFunctionCalls.empty()) {
-                Work task = mFunctionCalls.front();
-                mFunctionCalls.pop();
-                return std::make_optional<Work>(task);
-            }
-            return std::nullopt;
+            return popWorkLocked();
         };
 
         const auto task = getNextTask();
@@ -115,7 +111,7 @@ void RenderEngineThreaded::threadMain(CreateInstanceFactory factory) NO_THREAD_S
 
         std::unique_lock<std::mutex> lock(mThreadMutex);
         mCondition.wait(lock, [this]() REQUIRES(mThreadMutex) {
-            return !mRunning || !mFunctionCalls.empty();
+            return !mRunning || hasWorkLocked();
         });
     }
 
@@ -123,6 +119,59 @@ void RenderEngineThreaded::threadMain(CreateInstanceFactory factory) NO_THREAD_S
     mRenderEngine.reset();
 }
 
+void RenderEngineThreaded::queueWorkLocked(Work work, RenderPriority priority) const {
+    mFunctionCalls[static_cast<size_t>(priority)].push(
+            {std::move(work), systemTime(SYSTEM_TIME_MONOTONIC)});
+}
+
+std::optional<RenderEngineThreaded::Work> RenderEngineThreaded::popWorkLocked() {
+    const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    // Work is only preempted between requests, by taking the most urgent class first, unless a
+    // less urgent one has waited for too long.
+    std::queue<QueuedWork>* next = nullptr;
+    for (auto& queue : mFunctionCalls) {
+        if (queue.empty()) continue;
+        if (!next) {
+            next = &queue;
+        } else if (now - queue.front().queueTime > kMaxPreemptedDelay &&
+                   queue.front().queueTime < next->front().queueTime) {
+            next = &queue;
+        }
+    }
+    if (!next) {
+        return std::nullopt;
+    }
+
+    const nsecs_t latency = now - next->front().queueTime;
+    QueueLatency& stats = mQueueLatencies[static_cast<size_t>(next - mFunctionCalls.data())];
+    stats.count++;
+    stats.total += latency;
+    stats.max = std::max(stats.max, latency);
+
+    Work work = std::move(next->front().work);
+    next->pop();
+    return work;
+}
+
+bool RenderEngineThreaded::hasWorkLocked() const {
+    return std::any_of(mFunctionCalls.begin(), mFunctionCalls.end(),
+                       [](const auto& queue) { return !queue.empty(); });
+}
+
+void RenderEngineThreaded::dumpQueueLatencies(std::string& result) {
+    std::lock_guard lock(mThreadMutex);
+    base::StringAppendF(&result, "RenderEngineThreaded queue latency since last dump:\n");
+    for (const RenderPriority priority : ftl::enum_range<RenderPriority>()) {
+        QueueLatency& stats = mQueueLatencies[static_cast<size_t>(priority)];
+        const float average = stats.count > 0 ? ns2us(stats.total / stats.count) / 1000.f : 0.f;
+        base::StringAppendF(&result, "    %s: %zu requests, average %.3fms, max %.3fms\n",
+                            ftl::enum_string(priority).c_str(), stats.count, average,
+                            ns2us(stats.max) / 1000.f);
+        stats = {};
+    }
+}
+
 void RenderEngineThreaded::waitUntilInitialized() const {
     if (!mIsInitialized) {
         std::unique_lock<std::mutex> lock(mInitializedMutex);
@@ -138,7 +187,7 @@ std::future<void> RenderEngineThreaded::primeCache(bool shouldPrimeUltraHDR) {
     // for the futures.
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push(
+        queueWorkLocked(
                 [resultPromise, shouldPrimeUltraHDR](renderengine::RenderEngine& instance) {
                     ATRACE_NAME("REThreaded::primeCache");
                     if (setSchedFifo(false) != NO_ERROR) {
@@ -163,7 +212,7 @@ void RenderEngineThreaded::dump(std::string& result) {
     std::future<std::string> resultFuture = resultPromise.get_future();
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([&resultPromise, &result](renderengine::RenderEngine& instance) {
+        queueWorkLocked([&resultPromise, &result](renderengine::RenderEngine& instance) {
             ATRACE_NAME("REThreaded::dump");
             std::string localResult = result;
             instance.dump(localResult);
@@ -173,6 +222,7 @@ void RenderEngineThreaded::dump(std::string& result) {
     mCondition.notify_one();
     // Note: This is an rvalue.
     result.assign(resultFuture.get());
+    dumpQueueLatencies(result);
 }
 
 void RenderEngineThreaded::mapExternalTextureBuffer(const sp<GraphicBuffer>& buffer,
@@ -182,7 +232,7 @@ void RenderEngineThreaded::mapExternalTextureBuffer(const sp<GraphicBuffer>& buf
     // for the futures.
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([=](renderengine::RenderEngine& instance) {
+        queueWorkLocked([=](renderengine::RenderEngine& instance) {
             ATRACE_NAME("REThreaded::mapExternalTextureBuffer");
             instance.mapExternalTextureBuffer(buffer, isRenderable);
         });
@@ -196,7 +246,7 @@ void RenderEngineThreaded::unmapExternalTextureBuffer(sp<GraphicBuffer>&& buffer
     // for the futures.
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push(
+        queueWorkLocked(
                 [=, buffer = std::move(buffer)](renderengine::RenderEngine& instance) mutable {
                     ATRACE_NAME("REThreaded::unmapExternalTextureBuffer");
                     instance.unmapExternalTextureBuffer(std::move(buffer));
@@ -229,7 +279,7 @@ void RenderEngineThreaded::cleanupPostRender() {
     // for the futures.
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([=](renderengine::RenderEngine& instance) {
+        queueWorkLocked([=](renderengine::RenderEngine& instance) {
             ATRACE_NAME("REThreaded::cleanupPostRender");
             instance.cleanupPostRender();
         });
@@ -260,13 +310,14 @@ ftl::Future<FenceResult> RenderEngineThreaded::drawLayers(
     {
         std::lock_guard lock(mThreadMutex);
         mNeedsPostRenderCleanup = true;
-        mFunctionCalls.push(
+        queueWorkLocked(
                 [resultPromise, display, layers, buffer, fd](renderengine::RenderEngine& instance) {
                     ATRACE_NAME("REThreaded::drawLayers");
                     instance.updateProtectedContext(layers, buffer);
                     instance.drawLayersInternal(std::move(resultPromise), display, layers, buffer,
                                                 base::unique_fd(fd));
-                });
+                },
+                display.priority);
     }
     mCondition.notify_one();
     return resultFuture;
@@ -277,7 +328,7 @@ int RenderEngineThreaded::getContextPriority() {
     std::future<int> resultFuture = resultPromise.get_future();
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([&resultPromise](renderengine::RenderEngine& instance) {
+        queueWorkLocked([&resultPromise](renderengine::RenderEngine& instance) {
             ATRACE_NAME("REThreaded::getContextPriority");
             int priority = instance.getContextPriority();
             resultPromise.set_value(priority);
@@ -297,7 +348,7 @@ void RenderEngineThreaded::onActiveDisplaySizeChanged(ui::Size size) {
     // for the futures.
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([size](renderengine::RenderEngine& instance) {
+        queueWorkLocked([size](renderengine::RenderEngine& instance) {
             ATRACE_NAME("REThreaded::onActiveDisplaySizeChanged");
             instance.onActiveDisplaySizeChanged(size);
         });
@@ -310,7 +361,7 @@ std::optional<pid_t> RenderEngineThreaded::getRenderEngineTid() const {
     std::future<pid_t> tidFuture = tidPromise.get_future();
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([&tidPromise](renderengine::RenderEngine& instance) {
+        queueWorkLocked([&tidPromise](renderengine::RenderEngine& instance) {
             tidPromise.set_value(gettid());
         });
     }
@@ -324,13 +375,26 @@ void RenderEngineThreaded::setEnableTracing(bool tracingEnabled) {
     // for the futures.
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([tracingEnabled](renderengine::RenderEngine& instance) {
+        queueWorkLocked([tracingEnabled](renderengine::RenderEngine& instance) {
             ATRACE_NAME("REThreaded::setEnableTracing");
             instance.setEnableTracing(tracingEnabled);
         });
     }
     mCondition.notify_one();
 }
+
+void RenderEngineThreaded::trimMemory() {
+    // This function is designed so it can run asynchronously, so we do not need to wait
+    // for the futures.
+    {
+        std::lock_guard lock(mThreadMutex);
+        queueWorkLocked([](renderengine::RenderEngine& instance) {
+            ATRACE_NAME("REThreaded::trimMemory");
+            instance.trimMemory();
+        });
+    }
+    mCondition.notify_one();
+}
 } // namespace threaded
 } // namespace renderengine
 } // namespace android
@@ -17,6 +17,9 @@
 #pragma once
 
 #include <android-base/thread_annotations.h>
+#include <ftl/enum.h>
+#include <utils/Timers.h>
+#include <array>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
@@ -33,7 +36,9 @@ using CreateInstanceFactory = std::function<std::unique_ptr<renderengine::Render
 /**
  * This class extends a basic RenderEngine class. It contains a thread. Each time a function of
  * this class is called, we create a lambda function that is put on a queue. The main thread then
- * executes the functions in order.
+ * executes the functions in order, except that drawLayers is queued by the RenderPriority of its
+ * DisplaySettings, and the more urgent queues are drained first. Everything other than drawing is
+ * queued along with the composition.
  */
 class RenderEngineThreaded : public RenderEngine {
 public:
@@ -61,6 +66,7 @@ public:
     void onActiveDisplaySizeChanged(ui::Size size) override;
     std::optional<pid_t> getRenderEngineTid() const override;
     void setEnableTracing(bool tracingEnabled) override;
+    void trimMemory() override;
 
 protected:
     void mapExternalTextureBuffer(const sp<GraphicBuffer>& buffer, bool isRenderable) override;
@@ -75,6 +81,14 @@ protected:
 private:
     void threadMain(CreateInstanceFactory factory);
     void waitUntilInitialized() const;
+
+    using Work = std::function<void(renderengine::RenderEngine&)>;
+    void queueWorkLocked(Work, RenderPriority = RenderPriority::COMPOSITION) const
+            REQUIRES(mThreadMutex);
+    std::optional<Work> popWorkLocked() REQUIRES(mThreadMutex);
+    bool hasWorkLocked() const REQUIRES(mThreadMutex);
+    void dumpQueueLatencies(std::string& result) EXCLUDES(mThreadMutex);
+
     static status_t setSchedFifo(bool enabled);
 
     // No-op. This method is only called on leaf implementations of RenderEngine.
@@ -90,10 +104,27 @@ private:
     std::atomic<bool> mRunning = true;
     std::atomic<bool> mNeedsPostRenderCleanup = false;
 
-    using Work = std::function<void(renderengine::RenderEngine&)>;
-    mutable std::queue<Work> mFunctionCalls GUARDED_BY(mThreadMutex);
+    // Work of a less urgent class runs ahead of the more urgent work once it has been queued for
+    // this long, so that a busy display does not starve screenshots.
+    static constexpr nsecs_t kMaxPreemptedDelay = ms2ns(100);
+
+    struct QueuedWork {
+        Work work;
+        nsecs_t queueTime;
+    };
+    static constexpr size_t kPriorityCount = ftl::enum_size_v<RenderPriority>;
+    mutable std::array<std::queue<QueuedWork>, kPriorityCount> mFunctionCalls
+            GUARDED_BY(mThreadMutex);
     mutable std::condition_variable mCondition;
 
+    // How long the work of each class waited in its queue, since the last dump.
+    struct QueueLatency {
+        size_t count = 0;
+        nsecs_t total = 0;
+        nsecs_t max = 0;
+    };
+    std::array<QueueLatency, kPriorityCount> mQueueLatencies GUARDED_BY(mThreadMutex);
+
     // Used to allow select thread safe methods to be accessed without requiring the
     // method to be invoked on the RenderEngine thread
     std::atomic_bool mIsInitialized = false;
@@ -27,6 +27,7 @@
 #include <binder/IInterface.h>
 
 #include <sensor/BitTube.h>
+#include <sensor/SensorEventRing.h>
 
 namespace android {
 // ----------------------------------------------------------------------------
@@ -38,6 +39,7 @@ enum {
     FLUSH_SENSOR,
     CONFIGURE_CHANNEL,
     DESTROY,
+    CREATE_EVENT_RING,
 };
 
 class BpSensorEventConnection : public BpInterface<ISensorEventConnection>
@@ -98,6 +100,19 @@ public:
         return reply.readInt32();
     }
 
+    virtual sp<SensorEventRing> createEventRing(int32_t capacity, nsecs_t maxBatchLatencyNs) {
+        Parcel data, reply;
+        data.writeInterfaceToken(ISensorEventConnection::getInterfaceDescriptor());
+        data.writeInt32(capacity);
+        data.writeInt64(maxBatchLatencyNs);
+        if (remote()->transact(CREATE_EVENT_RING, data, &reply) != NO_ERROR ||
+            reply.readInt32() != NO_ERROR) {
+            return nullptr;
+        }
+        sp<SensorEventRing> ring = new SensorEventRing(reply);
+        return ring->initCheck() == NO_ERROR ? ring : nullptr;
+    }
+
     virtual void onLastStrongRef(const void* id) {
         destroy();
         BpInterface<ISensorEventConnection>::onLastStrongRef(id);
@@ -166,6 +181,18 @@ status_t BnSensorEventConnection::onTransact(
             destroy();
             return NO_ERROR;
         }
+        case CREATE_EVENT_RING: {
+            CHECK_INTERFACE(ISensorEventConnection, data, reply);
+            int32_t capacity = data.readInt32();
+            nsecs_t maxBatchLatencyNs = data.readInt64();
+            sp<SensorEventRing> ring = createEventRing(capacity, maxBatchLatencyNs);
+            if (ring == nullptr) {
+                reply->writeInt32(INVALID_OPERATION);
+                return NO_ERROR;
+            }
+            reply->writeInt32(NO_ERROR);
+            return ring->writeToParcel(reply);
+        }
 
     }
     return BBinder::onTransact(code, data, reply, flags);
@@ -45,6 +45,7 @@ enum {
     GET_RUNTIME_SENSOR_LIST,
     ENABLE_REPLAY_DATA_INJECTION,
     ENABLE_HAL_BYPASS_REPLAY_DATA_INJECTION,
+    CREATE_SHARED_SENSOR_DIRECT_CONNECTION,
 };
 
 class BpSensorServer : public BpInterface<ISensorServer>
@@ -193,6 +194,28 @@ public:
         return interface_cast<ISensorEventConnection>(reply.readStrongBinder());
     }
 
+    virtual sp<ISensorEventConnection> createSharedSensorDirectConnection(
+            const String16& opPackageName, int deviceId, int32_t sensorHandle, int32_t rateLevel,
+            native_handle_t** memory) {
+        Parcel data, reply;
+        *memory = nullptr;
+        data.writeInterfaceToken(ISensorServer::getInterfaceDescriptor());
+        data.writeString16(opPackageName);
+        data.writeInt32(deviceId);
+        data.writeInt32(sensorHandle);
+        data.writeInt32(rateLevel);
+        if (remote()->transact(CREATE_SHARED_SENSOR_DIRECT_CONNECTION, data, &reply) != NO_ERROR) {
+            return nullptr;
+        }
+        sp<ISensorEventConnection> ch =
+                interface_cast<ISensorEventConnection>(reply.readStrongBinder());
+        if (ch == nullptr) {
+            return nullptr;
+        }
+        *memory = reply.readNativeHandle();
+        return *memory != nullptr ? ch : nullptr;
+    }
+
     virtual int setOperationParameter(int32_t handle, int32_t type,
                                       const Vector<float> &floats,
                                       const Vector<int32_t> &ints) {
@@ -308,6 +331,25 @@ status_t BnSensorServer::onTransact(
             reply->writeStrongBinder(IInterface::asBinder(ch));
             return NO_ERROR;
         }
+        case CREATE_SHARED_SENSOR_DIRECT_CONNECTION: {
+            CHECK_INTERFACE(ISensorServer, data, reply);
+            const String16& opPackageName = data.readString16();
+            const int deviceId = data.readInt32();
+            int32_t sensorHandle = data.readInt32();
+            int32_t rateLevel = data.readInt32();
+            native_handle_t *memory = nullptr;
+            sp<ISensorEventConnection> ch = createSharedSensorDirectConnection(
+                    opPackageName, deviceId, sensorHandle, rateLevel, &memory);
+            reply->writeStrongBinder(IInterface::asBinder(ch));
+            if (memory != nullptr) {
+                if (ch != nullptr) {
+                    reply->writeNativeHandle(memory);
+                }
+                native_handle_close(memory);
+                native_handle_delete(memory);
+            }
+            return NO_ERROR;
+        }
         case SET_OPERATION_PARAMETER: {
             CHECK_INTERFACE(ISensorServer, data, reply);
             int32_t handle;
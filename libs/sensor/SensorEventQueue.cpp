@@ -54,7 +54,18 @@ void SensorEventQueue::onFirstRef()
 
 int SensorEventQueue::getFd() const
 {
-    return mSensorChannel->getFd();
+    return mEventRing != nullptr ? mEventRing->getFd() : mSensorChannel->getFd();
+}
+
+status_t SensorEventQueue::enableEventRing(size_t capacity, nsecs_t maxBatchLatencyNs) {
+    Mutex::Autolock _l(mLock);
+    if (mLooper != nullptr || mEventRing != nullptr) {
+        return INVALID_OPERATION;
+    }
+    mEventRing = mSensorEventConnection->createEventRing(
+            static_cast<int32_t>(std::min(capacity, SensorEventRing::MAX_CAPACITY)),
+            maxBatchLatencyNs);
+    return mEventRing != nullptr ? NO_ERROR : INVALID_OPERATION;
 }
 
 
@@ -64,6 +75,9 @@ ssize_t SensorEventQueue::write(const sp<BitTube>& tube,
 }
 
 ssize_t SensorEventQueue::read(ASensorEvent* events, size_t numEvents) {
+    if (mEventRing != nullptr) {
+        return mEventRing->read(events, numEvents);
+    }
     if (mAvailable == 0) {
         ssize_t err = BitTube::recvObjects(mSensorChannel,
                 mRecBuffer, MAX_RECEIVE_BUFFER_EVENT_COUNT);
@@ -0,0 +1,252 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Sensors"
+
+#include <sensor/SensorEventRing.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#include <android/sensor.h>
+#include <binder/Parcel.h>
+#include <log/log.h>
+
+namespace android {
+// ----------------------------------------------------------------------------
+
+// The positions of the writer and of the reader, in separate cache lines, which are followed by
+// the events in the shared memory. The positions only increase, and index the events modulo the
+// capacity of the ring.
+struct SensorEventRing::Header {
+    alignas(64) std::atomic<uint64_t> writeIndex;
+    alignas(64) std::atomic<uint64_t> readIndex;
+};
+
+SensorEventRing::SensorEventRing(size_t capacity, nsecs_t maxBatchLatencyNs)
+    : mCapacity(std::clamp(capacity, MIN_CAPACITY, MAX_CAPACITY)),
+      mMaxBatchLatencyNs(std::max(maxBatchLatencyNs, nsecs_t(0))), mMemoryFd(-1), mEventFd(-1),
+      mStatus(NO_INIT), mHeader(nullptr), mEvents(nullptr), mMappedSize(0), mWriteIndex(0),
+      mFirstPendingTime(0)
+{
+    const size_t size = sizeof(Header) + mCapacity * sizeof(ASensorEvent);
+    mMemoryFd = memfd_create("sensor_event_ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (mMemoryFd < 0) {
+        mStatus = -errno;
+        ALOGE("SensorEventRing: memfd creation failed (%s)", strerror(errno));
+        return;
+    }
+    // The reader can neither shrink the memory under the writer nor grow it.
+    if (ftruncate(mMemoryFd, size) != 0 ||
+        fcntl(mMemoryFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+        mStatus = -errno;
+        ALOGE("SensorEventRing: can't size the memory (%s)", strerror(errno));
+        return;
+    }
+    mEventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (mEventFd < 0) {
+        mStatus = -errno;
+        ALOGE("SensorEventRing: eventfd creation failed (%s)", strerror(errno));
+        return;
+    }
+    mStatus = map(size);
+    if (mStatus == NO_ERROR) {
+        new (mHeader) Header{};
+    }
+}
+
+SensorEventRing::SensorEventRing(const Parcel& data)
+    : mCapacity(0), mMaxBatchLatencyNs(0), mMemoryFd(-1), mEventFd(-1), mStatus(NO_INIT),
+      mHeader(nullptr), mEvents(nullptr), mMappedSize(0), mWriteIndex(0), mFirstPendingTime(0)
+{
+    mMemoryFd = fcntl(data.readFileDescriptor(), F_DUPFD_CLOEXEC, 0);
+    mEventFd = fcntl(data.readFileDescriptor(), F_DUPFD_CLOEXEC, 0);
+    const uint32_t capacity = data.readUint32();
+    if (mMemoryFd < 0 || mEventFd < 0) {
+        mStatus = -EBADF;
+        ALOGE("SensorEventRing(Parcel): can't dup filedescriptors");
+        return;
+    }
+    if (capacity < MIN_CAPACITY || capacity > MAX_CAPACITY) {
+        mStatus = BAD_VALUE;
+        ALOGE("SensorEventRing(Parcel): invalid capacity %" PRIu32, capacity);
+        return;
+    }
+    mCapacity = capacity;
+    const size_t size = sizeof(Header) + mCapacity * sizeof(ASensorEvent);
+    struct stat st;
+    if (fstat(mMemoryFd, &st) != 0 || st.st_size < static_cast<off_t>(size)) {
+        mStatus = BAD_VALUE;
+        ALOGE("SensorEventRing(Parcel): the memory is too small for %zu events", mCapacity);
+        return;
+    }
+    mStatus = map(size);
+}
+
+SensorEventRing::~SensorEventRing()
+{
+    if (mHeader != nullptr)
+        munmap(mHeader, mMappedSize);
+
+    if (mMemoryFd >= 0)
+        close(mMemoryFd);
+
+    if (mEventFd >= 0)
+        close(mEventFd);
+}
+
+status_t SensorEventRing::map(size_t size) {
+    static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                  "the positions of the ring are shared between processes");
+    static_assert(sizeof(Header) % alignof(ASensorEvent) == 0);
+
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, mMemoryFd, 0);
+    if (memory == MAP_FAILED) {
+        const int error = errno;
+        ALOGE("SensorEventRing: can't map the memory (%s)", strerror(error));
+        return -error;
+    }
+    mHeader = static_cast<Header*>(memory);
+    mEvents = reinterpret_cast<ASensorEvent*>(static_cast<uint8_t*>(memory) + sizeof(Header));
+    mMappedSize = size;
+    return NO_ERROR;
+}
+
+status_t SensorEventRing::initCheck() const
+{
+    return mStatus;
+}
+
+int SensorEventRing::getFd() const
+{
+    return mEventFd;
+}
+
+void SensorEventRing::wake() {
+    const uint64_t value = 1;
+    ssize_t size;
+    do {
+        size = ::write(mEventFd, &value, sizeof(value));
+    } while (size < 0 && errno == EINTR);
+    // EAGAIN means that the reader has not read the previous wake ups, which is the same.
+    mFirstPendingTime = 0;
+}
+
+ssize_t SensorEventRing::write(ASensorEvent const* events, size_t count, bool wakeNow) {
+    if (mStatus != NO_ERROR) {
+        return mStatus;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    const uint64_t readIndex = mHeader->readIndex.load(std::memory_order_acquire);
+    const uint64_t used = mWriteIndex - readIndex;
+    if (used > mCapacity) {
+        // The reader stored a position it could not have read up to.
+        ALOGE("SensorEventRing: invalid read position %" PRIu64 " for write position %" PRIu64,
+              readIndex, mWriteIndex);
+        return -EINVAL;
+    }
+    if (count > mCapacity - used) {
+        return -EAGAIN;
+    }
+
+    const size_t start = mWriteIndex % mCapacity;
+    const size_t firstCount = std::min(count, mCapacity - start);
+    memcpy(&mEvents[start], events, firstCount * sizeof(ASensorEvent));
+    memcpy(&mEvents[0], events + firstCount, (count - firstCount) * sizeof(ASensorEvent));
+    mWriteIndex += count;
+    mHeader->writeIndex.store(mWriteIndex, std::memory_order_release);
+
+    const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    if (mFirstPendingTime == 0) {
+        mFirstPendingTime = now;
+    }
+    if (wakeNow || used + count >= mCapacity / 2 ||
+        now - mFirstPendingTime >= mMaxBatchLatencyNs) {
+        wake();
+    }
+    return static_cast<ssize_t>(count);
+}
+
+void SensorEventRing::wakeIfDue() {
+    if (mFirstPendingTime != 0 &&
+        systemTime(SYSTEM_TIME_MONOTONIC) - mFirstPendingTime >= mMaxBatchLatencyNs) {
+        wake();
+    }
+}
+
+ssize_t SensorEventRing::read(ASensorEvent* events, size_t count) {
+    if (mStatus != NO_ERROR) {
+        return mStatus;
+    }
+    const uint64_t readIndex = mHeader->readIndex.load(std::memory_order_relaxed);
+    uint64_t writeIndex = mHeader->writeIndex.load(std::memory_order_acquire);
+    if (writeIndex == readIndex) {
+        // Consume the wake ups before checking again for the events written since, so that the
+        // reader is woken up again for the events which follow.
+        uint64_t value;
+        ssize_t size;
+        do {
+            size = ::read(mEventFd, &value, sizeof(value));
+        } while (size < 0 && errno == EINTR);
+        writeIndex = mHeader->writeIndex.load(std::memory_order_acquire);
+        if (writeIndex == readIndex) {
+            return 0;
+        }
+    }
+    if (writeIndex - readIndex > mCapacity) {
+        ALOGE("SensorEventRing: invalid write position %" PRIu64 " for read position %" PRIu64,
+              writeIndex, readIndex);
+        return -EINVAL;
+    }
+
+    count = std::min(count, static_cast<size_t>(writeIndex - readIndex));
+    const size_t start = readIndex % mCapacity;
+    const size_t firstCount = std::min(count, mCapacity - start);
+    memcpy(events, &mEvents[start], firstCount * sizeof(ASensorEvent));
+    memcpy(events + firstCount, &mEvents[0], (count - firstCount) * sizeof(ASensorEvent));
+    mHeader->readIndex.store(readIndex + count, std::memory_order_release);
+    return static_cast<ssize_t>(count);
+}
+
+status_t SensorEventRing::writeToParcel(Parcel* reply) const
+{
+    if (mStatus != NO_ERROR)
+        return mStatus;
+
+    status_t result = reply->writeDupFileDescriptor(mMemoryFd);
+    if (result == NO_ERROR) {
+        result = reply->writeDupFileDescriptor(mEventFd);
+    }
+    if (result == NO_ERROR) {
+        result = reply->writeUint32(static_cast<uint32_t>(mCapacity));
+    }
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+}; // namespace android
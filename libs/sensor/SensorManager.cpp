@@ -431,6 +431,29 @@ int SensorManager::createDirectChannel(
     return nativeHandle;
 }
 
+int SensorManager::createSharedDirectChannel(
+        int sensorHandle, int rateLevel, native_handle_t **memory) {
+    static constexpr int DEFAULT_DEVICE_ID = 0;
+    Mutex::Autolock _l(mLock);
+    if (assertStateLocked() != NO_ERROR) {
+        return NO_INIT;
+    }
+
+    if (memory == nullptr || rateLevel <= SENSOR_DIRECT_RATE_STOP) {
+        return BAD_VALUE;
+    }
+
+    sp<ISensorEventConnection> conn = mSensorServer->createSharedSensorDirectConnection(
+            mOpPackageName, DEFAULT_DEVICE_ID, sensorHandle, rateLevel, memory);
+    if (conn == nullptr) {
+        return NO_MEMORY;
+    }
+
+    int nativeHandle = mDirectConnectionHandle++;
+    mDirectConnection.emplace(nativeHandle, conn);
+    return nativeHandle;
+}
+
 void SensorManager::destroyDirectChannel(int channelNativeHandle) {
     Mutex::Autolock _l(mLock);
     if (assertStateLocked() == NO_ERROR) {
@@ -30,6 +30,7 @@ namespace android {
 
 class BitTube;
 class Parcel;
+class SensorEventRing;
 
 class ISensorEventConnection : public IInterface
 {
@@ -42,6 +43,9 @@ public:
     virtual status_t setEventRate(int handle, nsecs_t ns) = 0;
     virtual status_t flush() = 0;
     virtual int32_t configureChannel(int32_t handle, int32_t rateLevel) = 0;
+    // Creates a ring through which the events of the connection are delivered instead of its
+    // channel. Returns nullptr if the connection does not support it.
+    virtual sp<SensorEventRing> createEventRing(int32_t capacity, nsecs_t maxBatchLatencyNs) = 0;
 protected:
     virtual void destroy() = 0; // synchronously release resource hold by remote object
 };
@@ -55,6 +55,14 @@ public:
             int deviceId, uint32_t size, int32_t type, int32_t format,
             const native_handle_t *resource) = 0;
 
+    // Creates a direct connection to a direct channel of the service which reports the sensor
+    // at the rate level, and which is shared with the other clients of the same sensor and rate.
+    // memory is set to the native handle of the read-only shared memory of the channel, which the
+    // caller owns.
+    virtual sp<ISensorEventConnection> createSharedSensorDirectConnection(
+            const String16& opPackageName, int deviceId, int32_t sensorHandle, int32_t rateLevel,
+            native_handle_t** memory) = 0;
+
     virtual int setOperationParameter(
             int32_t handle, int32_t type, const Vector<float> &floats, const Vector<int32_t> &ints) = 0;
 };
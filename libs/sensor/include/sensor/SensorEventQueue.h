@@ -25,6 +25,7 @@
 #include <utils/Mutex.h>
 
 #include <sensor/BitTube.h>
+#include <sensor/SensorEventRing.h>
 
 // ----------------------------------------------------------------------------
 #define WAKE_UP_SENSOR_EVENT_NEEDS_ACK (1U << 31)
@@ -71,6 +72,11 @@ public:
 
     int getFd() const;
 
+    // Receives the events through a ring in shared memory instead of the socket of the queue,
+    // waking up at the latest maxBatchLatencyNs after the events are sent. It must be called
+    // before the sensors are enabled and the file-descriptor of the queue is polled.
+    status_t enableEventRing(size_t capacity, nsecs_t maxBatchLatencyNs);
+
     static ssize_t write(const sp<BitTube>& tube,
             ASensorEvent const* events, size_t numEvents);
 
@@ -104,6 +110,7 @@ private:
     sp<Looper> getLooper() const;
     sp<ISensorEventConnection> mSensorEventConnection;
     sp<BitTube> mSensorChannel;
+    sp<SensorEventRing> mEventRing;
     mutable Mutex mLock;
     mutable sp<Looper> mLooper;
     ASensorEvent* mRecBuffer;
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <utils/Errors.h>
+#include <utils/RefBase.h>
+#include <utils/Timers.h>
+
+struct ASensorEvent;
+
+namespace android {
+// ----------------------------------------------------------------------------
+class Parcel;
+
+/**
+ * A ring of sensor events in memory shared between the sensor service and a client, which can be
+ * used by a SensorEventQueue instead of its BitTube. The events are copied once into the ring
+ * rather than through a socket, and the client is woken up through an eventfd, at most once per
+ * the batch latency of the ring.
+ *
+ * The ring has a single writer, the sensor service, and a single reader, the client. The writer
+ * does not trust the read position the reader stores in the shared memory.
+ */
+class SensorEventRing : public RefBase
+{
+public:
+    // The bounds of the number of events of a ring.
+    static constexpr size_t MIN_CAPACITY = 256;
+    static constexpr size_t MAX_CAPACITY = 16384;
+
+    // creates a ring of the given number of events, whose reader is woken up at the latest
+    // maxBatchLatencyNs after the first event it has not been woken up for.
+    SensorEventRing(size_t capacity, nsecs_t maxBatchLatencyNs);
+
+    explicit SensorEventRing(const Parcel& data);
+    virtual ~SensorEventRing();
+
+    // check state after construction
+    status_t initCheck() const;
+
+    // get the file-descriptor which becomes readable when the reader is woken up.
+    int getFd() const;
+
+    size_t getCapacity() const { return mCapacity; }
+
+    // Writes the events. All of them are written or the call fails with -EAGAIN when the ring does
+    // not have the space for them. The reader is woken up at once if wakeNow is set, when the ring
+    // is half full or when the batch latency has elapsed, and its wake up is deferred otherwise.
+    ssize_t write(ASensorEvent const* events, size_t count, bool wakeNow);
+
+    // Wakes up the reader if events were written more than the batch latency ago and it was not
+    // woken up for them yet. The writer calls it by getWakeDeadline(), since the deferred wake ups
+    // are otherwise only sent with the next events.
+    void wakeIfDue();
+
+    // Returns the monotonic time at which the deferred wake up of the reader is due, or 0 if
+    // there is none.
+    nsecs_t getWakeDeadline() const {
+        return mFirstPendingTime == 0 ? 0 : mFirstPendingTime + mMaxBatchLatencyNs;
+    }
+
+    // Reads up to count events. Returns 0 when the ring is empty, after which the file-descriptor
+    // is no longer readable until the next wake up.
+    ssize_t read(ASensorEvent* events, size_t count);
+
+    // parcels this ring, for its reader.
+    status_t writeToParcel(Parcel* reply) const;
+
+private:
+    struct Header;
+
+    status_t map(size_t size);
+    void wake();
+
+    size_t mCapacity;
+    nsecs_t mMaxBatchLatencyNs;
+    int mMemoryFd;
+    int mEventFd;
+    status_t mStatus;
+    Header* mHeader;
+    ASensorEvent* mEvents;
+    size_t mMappedSize;
+
+    // The position of the writer, used by the writer instead of the one in the shared memory.
+    uint64_t mWriteIndex;
+    // The time of the first event the reader was not woken up for, or 0 if there is none.
+    nsecs_t mFirstPendingTime;
+};
+
+// ----------------------------------------------------------------------------
+}; // namespace android
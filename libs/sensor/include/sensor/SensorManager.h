@@ -71,6 +71,12 @@ public:
     int createDirectChannel(size_t size, int channelType, const native_handle_t *channelData);
     int createDirectChannel(
         int deviceId, size_t size, int channelType, const native_handle_t *channelData);
+    // Creates a channel which reports the sensor at the rate level into memory shared by the
+    // service with the other clients of the same sensor and rate. It is configured with
+    // configureDirectChannel() like the other channels, but only for this sensor and rate. The
+    // caller owns the read-only memory handle. While any client of the channel has no access to
+    // the sensor, or is capped below the rate, the sensor is not reported into it.
+    int createSharedDirectChannel(int sensorHandle, int rateLevel, native_handle_t **memory);
     void destroyDirectChannel(int channelNativeHandle);
     int configureDirectChannel(int channelNativeHandle, int sensorHandle, int rateLevel);
     int setOperationParameter(int handle, int type, const Vector<float> &floats, const Vector<int32_t> &ints);
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <poll.h>
+#include <stdint.h>
+
+#include <gtest/gtest.h>
+
+#include <android/sensor.h>
+#include <binder/Parcel.h>
+#include <sensor/SensorEventRing.h>
+
+namespace android {
+
+class SensorEventRingTest : public ::testing::Test {
+protected:
+    void createRing(nsecs_t maxBatchLatencyNs) {
+        mWriter = new SensorEventRing(SensorEventRing::MIN_CAPACITY, maxBatchLatencyNs);
+        ASSERT_EQ(NO_ERROR, mWriter->initCheck());
+
+        // The reader maps the ring from the parcel, as in the process of the client.
+        Parcel parcel;
+        ASSERT_EQ(NO_ERROR, mWriter->writeToParcel(&parcel));
+        parcel.setDataPosition(0);
+        mReader = new SensorEventRing(parcel);
+        ASSERT_EQ(NO_ERROR, mReader->initCheck());
+    }
+
+    static ASensorEvent makeEvent(int64_t timestamp) {
+        ASensorEvent event = {};
+        event.type = ASENSOR_TYPE_ACCELEROMETER;
+        event.timestamp = timestamp;
+        return event;
+    }
+
+    bool isReaderWokenUp() const {
+        struct pollfd fd = {.fd = mReader->getFd(), .events = POLLIN};
+        return poll(&fd, 1, /*timeout=*/0) == 1;
+    }
+
+    sp<SensorEventRing> mWriter;
+    sp<SensorEventRing> mReader;
+};
+
+TEST_F(SensorEventRingTest, EventsAreReadInOrder) {
+    createRing(/*maxBatchLatencyNs=*/0);
+    ASSERT_EQ(SensorEventRing::MIN_CAPACITY, mReader->getCapacity());
+
+    // Go around the end of the ring a few times.
+    ASensorEvent events[100];
+    int64_t timestamp = 0;
+    for (int batch = 0; batch < 10; batch++) {
+        for (ASensorEvent& event : events) {
+            event = makeEvent(timestamp++);
+        }
+        ASSERT_EQ(100, mWriter->write(events, 100, /*wakeNow=*/false));
+
+        ASensorEvent received[100];
+        ASSERT_EQ(60, mReader->read(received, 60));
+        ASSERT_EQ(40, mReader->read(received + 60, 100));
+        for (int i = 0; i < 100; i++) {
+            EXPECT_EQ(events[i].timestamp, received[i].timestamp);
+        }
+    }
+}
+
+TEST_F(SensorEventRingTest, ReaderIsWokenUpUntilItHasReadTheEvents) {
+    createRing(/*maxBatchLatencyNs=*/0);
+    EXPECT_FALSE(isReaderWokenUp());
+
+    ASensorEvent event = makeEvent(1);
+    ASSERT_EQ(1, mWriter->write(&event, 1, /*wakeNow=*/false));
+    EXPECT_TRUE(isReaderWokenUp());
+
+    ASSERT_EQ(1, mReader->read(&event, 1));
+    EXPECT_TRUE(isReaderWokenUp());
+    ASSERT_EQ(0, mReader->read(&event, 1));
+    EXPECT_FALSE(isReaderWokenUp());
+}
+
+TEST_F(SensorEventRingTest, WakeUpIsDeferredForTheBatchLatency) {
+    createRing(/*maxBatchLatencyNs=*/s2ns(100));
+
+    ASensorEvent event = makeEvent(1);
+    ASSERT_EQ(1, mWriter->write(&event, 1, /*wakeNow=*/false));
+    mWriter->wakeIfDue();
+    EXPECT_FALSE(isReaderWokenUp());
+
+    // The events are still readable before the reader is woken up for them.
+    ASSERT_EQ(1, mReader->read(&event, 1));
+
+    ASSERT_EQ(1, mWriter->write(&event, 1, /*wakeNow=*/true));
+    EXPECT_TRUE(isReaderWokenUp());
+}
+
+TEST_F(SensorEventRingTest, ReaderIsWokenUpWhenTheRingIsHalfFull) {
+    createRing(/*maxBatchLatencyNs=*/s2ns(100));
+
+    ASensorEvent events[SensorEventRing::MIN_CAPACITY / 2] = {};
+    ASSERT_EQ(ssize_t(SensorEventRing::MIN_CAPACITY / 2 - 1),
+              mWriter->write(events, SensorEventRing::MIN_CAPACITY / 2 - 1, /*wakeNow=*/false));
+    EXPECT_FALSE(isReaderWokenUp());
+    ASSERT_EQ(1, mWriter->write(events, 1, /*wakeNow=*/false));
+    EXPECT_TRUE(isReaderWokenUp());
+}
+
+TEST_F(SensorEventRingTest, WriteFailsWhenTheEventsDoNotFit) {
+    createRing(/*maxBatchLatencyNs=*/0);
+
+    ASensorEvent events[SensorEventRing::MIN_CAPACITY] = {};
+    ASSERT_EQ(ssize_t(SensorEventRing::MIN_CAPACITY - 1),
+              mWriter->write(events, SensorEventRing::MIN_CAPACITY - 1, /*wakeNow=*/false));
+    EXPECT_EQ(-EAGAIN, mWriter->write(events, 2, /*wakeNow=*/false));
+    EXPECT_EQ(1, mWriter->write(events, 1, /*wakeNow=*/false));
+
+    ASSERT_EQ(2, mReader->read(events, 2));
+    EXPECT_EQ(2, mWriter->write(events, 2, /*wakeNow=*/false));
+}
+
+TEST_F(SensorEventRingTest, InvalidParcelIsRejected) {
+    Parcel parcel;
+    parcel.writeInt32(0);
+    parcel.setDataPosition(0);
+    sp<SensorEventRing> ring = new SensorEventRing(parcel);
+    EXPECT_NE(NO_ERROR, ring->initCheck());
+    ASensorEvent event;
+    EXPECT_GT(0, ring->read(&event, 1));
+}
+
+} // namespace android
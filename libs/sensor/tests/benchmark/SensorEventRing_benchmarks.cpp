@@ -0,0 +1,111 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <android/sensor.h>
+#include <binder/Parcel.h>
+#include <sensor/BitTube.h>
+#include <sensor/SensorEventQueue.h>
+#include <sensor/SensorEventRing.h>
+
+namespace android {
+
+namespace {
+
+// The sensor service sends each event of a 400 Hz sensor to 20 clients, which receive it.
+constexpr size_t CLIENT_COUNT = 20;
+constexpr nsecs_t SAMPLING_PERIOD_NS = s2ns(1) / 400;
+
+// The socket buffer size of the connections of the sensor service.
+constexpr size_t SOCKET_BUFFER_SIZE = 100 * 1024;
+
+ASensorEvent makeEvent() {
+    ASensorEvent event = {};
+    event.type = ASENSOR_TYPE_ACCELEROMETER;
+    event.timestamp = systemTime(SYSTEM_TIME_MONOTONIC);
+    return event;
+}
+
+} // namespace
+
+static void benchmarkBitTubeFanOut(benchmark::State& state) {
+    std::vector<sp<BitTube>> tubes;
+    for (size_t i = 0; i < CLIENT_COUNT; i++) {
+        tubes.push_back(new BitTube(SOCKET_BUFFER_SIZE));
+    }
+    ASensorEvent event = makeEvent();
+    ASensorEvent received[SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT];
+    for (auto _ : state) {
+        event.timestamp += SAMPLING_PERIOD_NS;
+        for (const sp<BitTube>& tube : tubes) {
+            SensorEventQueue::write(tube, &event, 1);
+        }
+        // Each client is woken up for each event.
+        for (const sp<BitTube>& tube : tubes) {
+            BitTube::recvObjects(tube, received, SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * CLIENT_COUNT);
+}
+
+// The argument is the batch latency of the rings, in milliseconds.
+static void benchmarkEventRingFanOut(benchmark::State& state) {
+    const nsecs_t maxBatchLatencyNs = ms2ns(state.range(0));
+    // The clients are woken up once per batch latency, and then read all of the events of the
+    // period. The benchmark runs faster than the sensor, so the wake ups are sent explicitly.
+    const int64_t eventsPerWakeUp = std::max(int64_t(1), maxBatchLatencyNs / SAMPLING_PERIOD_NS);
+
+    std::vector<sp<SensorEventRing>> writers;
+    std::vector<sp<SensorEventRing>> readers;
+    for (size_t i = 0; i < CLIENT_COUNT; i++) {
+        sp<SensorEventRing> writer =
+                new SensorEventRing(SensorEventRing::MIN_CAPACITY, maxBatchLatencyNs);
+        Parcel parcel;
+        writer->writeToParcel(&parcel);
+        parcel.setDataPosition(0);
+        writers.push_back(writer);
+        readers.push_back(new SensorEventRing(parcel));
+    }
+    ASensorEvent event = makeEvent();
+    ASensorEvent received[SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT];
+    int64_t eventCount = 0;
+    for (auto _ : state) {
+        event.timestamp += SAMPLING_PERIOD_NS;
+        const bool wakeNow = ++eventCount % eventsPerWakeUp == 0;
+        for (const sp<SensorEventRing>& writer : writers) {
+            writer->write(&event, 1, wakeNow);
+        }
+        if (!wakeNow) {
+            continue;
+        }
+        for (const sp<SensorEventRing>& reader : readers) {
+            while (reader->read(received, SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT) > 0) {
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * CLIENT_COUNT);
+}
+
+BENCHMARK(benchmarkBitTubeFanOut);
+BENCHMARK(benchmarkEventRingFanOut)->Arg(0)->Arg(20);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -73,7 +73,7 @@ struct LinearEffect {
 static inline bool operator==(const LinearEffect& lhs, const LinearEffect& rhs) {
     return lhs.inputDataspace == rhs.inputDataspace && lhs.outputDataspace == rhs.outputDataspace &&
             lhs.undoPremultipliedAlpha == rhs.undoPremultipliedAlpha &&
-            lhs.fakeOutputDataspace == rhs.fakeOutputDataspace;
+            lhs.fakeOutputDataspace == rhs.fakeOutputDataspace && lhs.type == rhs.type;
 }
 
 struct LinearEffectHasher {
@@ -86,7 +86,8 @@ struct LinearEffectHasher {
         size_t result = std::hash<ui::Dataspace>{}(le.inputDataspace);
         result = HashCombine(result, std::hash<ui::Dataspace>{}(le.outputDataspace));
         result = HashCombine(result, std::hash<bool>{}(le.undoPremultipliedAlpha));
-        return HashCombine(result, std::hash<ui::Dataspace>{}(le.fakeOutputDataspace));
+        result = HashCombine(result, std::hash<ui::Dataspace>{}(le.fakeOutputDataspace));
+        return HashCombine(result, std::hash<int>{}(le.type));
     }
 };
 
@@ -96,6 +97,11 @@ struct LinearEffectHasher {
 // 2. Apply color transform matrices in linear space
 std::string buildLinearEffectSkSL(const LinearEffect& linearEffect);
 
+// The linear effects which SurfaceFlinger commonly draws to an sRGB or Display P3 output: the
+// tone mapping of opaque HDR video, and the dimming and color transforms of SDR content. Their
+// shaders are worth building before the first frame which needs them.
+const std::vector<LinearEffect>& getCommonLinearEffects();
+
 // Generates a list of uniforms to set on the LinearEffect shader above.
 std::vector<tonemap::ShaderUniform> buildLinearEffectUniforms(
         const LinearEffect& linearEffect, const mat4& colorTransform, float maxDisplayLuminance,
@@ -103,4 +109,13 @@ std::vector<tonemap::ShaderUniform> buildLinearEffectUniforms(
         aidl::android::hardware::graphics::composer3::RenderIntent renderIntent =
                 aidl::android::hardware::graphics::composer3::RenderIntent::TONE_MAP_COLORIMETRIC);
 
+// Same as above, but fills in the given uniforms, so that a caller setting up the effect for each
+// frame reuses their storage rather than allocating them again.
+void buildLinearEffectUniforms(
+        std::vector<tonemap::ShaderUniform>& uniforms, const LinearEffect& linearEffect,
+        const mat4& colorTransform, float maxDisplayLuminance, float currentDisplayLuminanceNits,
+        float maxLuminance, AHardwareBuffer* buffer = nullptr,
+        aidl::android::hardware::graphics::composer3::RenderIntent renderIntent =
+                aidl::android::hardware::graphics::composer3::RenderIntent::TONE_MAP_COLORIMETRIC);
+
 } // namespace android::shaders
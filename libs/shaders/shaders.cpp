@@ -18,6 +18,7 @@
 
 #include <tonemap/tonemap.h>
 
+#include <algorithm>
 #include <cmath>
 #include <optional>
 
@@ -221,11 +222,10 @@ void generateEffectiveOOTF(bool undoPremultipliedAlpha, LinearEffect::SkSLType t
 }
 
 template <typename T, std::enable_if_t<std::is_trivially_copyable<T>::value, bool> = true>
-std::vector<uint8_t> buildUniformValue(T value) {
-    std::vector<uint8_t> result;
-    result.resize(sizeof(value));
-    std::memcpy(result.data(), &value, sizeof(value));
-    return result;
+void setUniform(tonemap::ShaderUniform& uniform, const char* name, T value) {
+    uniform.name = name;
+    uniform.value.resize(sizeof(value));
+    std::memcpy(uniform.value.data(), &value, sizeof(value));
 }
 
 } // namespace
@@ -271,31 +271,65 @@ ColorSpace toColorSpace(ui::Dataspace dataspace) {
     }
 }
 
+const std::vector<LinearEffect>& getCommonLinearEffects() {
+    static const std::vector<LinearEffect> sEffects = [] {
+        std::vector<LinearEffect> effects;
+        for (const auto outputDataspace : {ui::Dataspace::V0_SRGB, ui::Dataspace::DISPLAY_P3}) {
+            for (const auto inputDataspace :
+                 {ui::Dataspace::BT2020_PQ, ui::Dataspace::BT2020_ITU_PQ,
+                  ui::Dataspace::BT2020_HLG, ui::Dataspace::BT2020_ITU_HLG}) {
+                effects.push_back({.inputDataspace = inputDataspace,
+                                   .outputDataspace = outputDataspace,
+                                   .undoPremultipliedAlpha = false});
+            }
+            for (const auto inputDataspace : {ui::Dataspace::V0_SRGB, ui::Dataspace::DISPLAY_P3}) {
+                for (const bool undoPremultipliedAlpha : {false, true}) {
+                    effects.push_back({.inputDataspace = inputDataspace,
+                                       .outputDataspace = outputDataspace,
+                                       .undoPremultipliedAlpha = undoPremultipliedAlpha});
+                }
+            }
+        }
+        return effects;
+    }();
+    return sEffects;
+}
+
 // Generates a list of uniforms to set on the LinearEffect shader above.
 std::vector<tonemap::ShaderUniform> buildLinearEffectUniforms(
         const LinearEffect& linearEffect, const mat4& colorTransform, float maxDisplayLuminance,
         float currentDisplayLuminanceNits, float maxLuminance, AHardwareBuffer* buffer,
         aidl::android::hardware::graphics::composer3::RenderIntent renderIntent) {
     std::vector<tonemap::ShaderUniform> uniforms;
+    buildLinearEffectUniforms(uniforms, linearEffect, colorTransform, maxDisplayLuminance,
+                              currentDisplayLuminanceNits, maxLuminance, buffer, renderIntent);
+    return uniforms;
+}
+
+void buildLinearEffectUniforms(
+        std::vector<tonemap::ShaderUniform>& uniforms, const LinearEffect& linearEffect,
+        const mat4& colorTransform, float maxDisplayLuminance, float currentDisplayLuminanceNits,
+        float maxLuminance, AHardwareBuffer* buffer,
+        aidl::android::hardware::graphics::composer3::RenderIntent renderIntent) {
+    constexpr size_t kGamutUniformCount = 3;
+    if (uniforms.size() < kGamutUniformCount) {
+        uniforms.resize(kGamutUniformCount);
+    }
 
     auto inputColorSpace = toColorSpace(linearEffect.inputDataspace);
     auto outputColorSpace = toColorSpace(linearEffect.outputDataspace);
 
-    uniforms.push_back(
-            {.name = "in_rgbToXyz",
-             .value = buildUniformValue<mat3>(ColorSpace::linearExtendedSRGB().getRGBtoXYZ())});
-    uniforms.push_back({.name = "in_xyzToSrcRgb",
-                        .value = buildUniformValue<mat3>(inputColorSpace.getXYZtoRGB())});
+    setUniform<mat3>(uniforms[0], "in_rgbToXyz", ColorSpace::linearExtendedSRGB().getRGBtoXYZ());
+    setUniform<mat3>(uniforms[1], "in_xyzToSrcRgb", inputColorSpace.getXYZtoRGB());
     // Transforms xyz colors to linear source colors, then applies the color transform, then
     // transforms to linear extended RGB for skia to color manage.
-    uniforms.push_back({.name = "in_colorTransform",
-                        .value = buildUniformValue<mat4>(
-                                mat4(ColorSpace::linearExtendedSRGB().getXYZtoRGB()) *
-                                // TODO: the color transform ideally should be applied
-                                // in the source colorspace, but doing that breaks
-                                // renderengine tests
-                                mat4(outputColorSpace.getRGBtoXYZ()) * colorTransform *
-                                mat4(outputColorSpace.getXYZtoRGB()))});
+    setUniform<mat4>(uniforms[2], "in_colorTransform",
+                     mat4(ColorSpace::linearExtendedSRGB().getXYZtoRGB()) *
+                             // TODO: the color transform ideally should be applied
+                             // in the source colorspace, but doing that breaks
+                             // renderengine tests
+                             mat4(outputColorSpace.getRGBtoXYZ()) * colorTransform *
+                             mat4(outputColorSpace.getXYZtoRGB()));
 
     tonemap::Metadata metadata{.displayMaxLuminance = maxDisplayLuminance,
                                // If the input luminance is unknown, use display luminance (aka,
@@ -309,11 +343,11 @@ std::vector<tonemap::ShaderUniform> buildLinearEffectUniforms(
                                .buffer = buffer,
                                .renderIntent = renderIntent};
 
-    for (const auto uniform : tonemap::getToneMapper()->generateShaderSkSLUniforms(metadata)) {
-        uniforms.push_back(uniform);
-    }
-
-    return uniforms;
+    std::vector<tonemap::ShaderUniform> toneMapperUniforms =
+            tonemap::getToneMapper()->generateShaderSkSLUniforms(metadata);
+    uniforms.resize(kGamutUniformCount + toneMapperUniforms.size());
+    std::move(toneMapperUniforms.begin(), toneMapperUniforms.end(),
+              uniforms.begin() + kGamutUniformCount);
 }
 
 } // namespace android::shaders
@@ -26,6 +26,7 @@ namespace android {
 
 using testing::Contains;
 using testing::HasSubstr;
+using testing::Pointwise;
 
 struct ShadersTest : public ::testing::Test {};
 
@@ -39,6 +40,11 @@ MATCHER_P(UniformNameEq, name, "") {
     return arg.name == name;
 }
 
+MATCHER(UniformsEq, "") {
+    const auto& [lhs, rhs] = arg;
+    return lhs.name == rhs.name && lhs.value == rhs.value;
+}
+
 template <typename T, std::enable_if_t<std::is_trivially_copyable<T>::value, bool> = true>
 std::vector<uint8_t> buildUniformValue(T value) {
     std::vector<uint8_t> result;
@@ -93,4 +99,28 @@ TEST_F(ShadersTest, buildLinearEffectUniforms_selectsGamutTransformMatrices) {
     EXPECT_THAT(uniforms, Contains(UniformNameEq("in_colorTransform")));
 }
 
+TEST_F(ShadersTest, buildLinearEffectUniforms_overwritesReusedUniforms) {
+    const shaders::LinearEffect hdrEffect{.inputDataspace = ui::Dataspace::BT2020_ITU_PQ,
+                                          .outputDataspace = ui::Dataspace::DISPLAY_P3};
+    const shaders::LinearEffect sdrEffect{.inputDataspace = ui::Dataspace::V0_SRGB,
+                                          .outputDataspace = ui::Dataspace::V0_SRGB};
+
+    std::vector<tonemap::ShaderUniform> uniforms;
+    shaders::buildLinearEffectUniforms(uniforms, hdrEffect, mat4(), 500.f, 500.f, 1000.f);
+    shaders::buildLinearEffectUniforms(uniforms, sdrEffect, mat4::scale(vec4(.5, .5, .5, 1.)),
+                                       200.f, 100.f, 0.f);
+
+    EXPECT_THAT(uniforms,
+                Pointwise(UniformsEq(),
+                          shaders::buildLinearEffectUniforms(sdrEffect,
+                                                             mat4::scale(vec4(.5, .5, .5, 1.)),
+                                                             200.f, 100.f, 0.f)));
+}
+
+TEST_F(ShadersTest, getCommonLinearEffects_includesHdrVideo) {
+    const shaders::LinearEffect hdrVideo{.inputDataspace = ui::Dataspace::BT2020_ITU_PQ,
+                                         .outputDataspace = ui::Dataspace::DISPLAY_P3};
+    EXPECT_THAT(shaders::getCommonLinearEffects(), Contains(hdrVideo));
+}
+
 } // namespace android
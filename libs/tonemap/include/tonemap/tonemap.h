@@ -21,6 +21,9 @@
 #include <android/hardware_buffer.h>
 #include <math/vec3.h>
 
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -148,6 +151,44 @@ public:
             aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
             aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
             const std::vector<Color>& colors, const Metadata& metadata) = 0;
+
+    // The largest relative difference between the gains of lookupTonemapGainFromLut() and those of
+    // lookupTonemapGain().
+    static constexpr double kLutGainTolerance = 1e-3;
+
+    // Same as lookupTonemapGain(), but interpolates the gains from a table of the tone curve, which
+    // is built the first time it is needed for the dataspaces and metadata, and kept for the most
+    // recently used ones. This is much cheaper per color than evaluating the curve, for callers
+    // tone mapping many colors, at the cost of a difference of up to kLutGainTolerance.
+    //
+    // The table is keyed by the dataspaces and by the luminances of the metadata, so this must only
+    // be used if the tone curve does not depend on the buffer or render intent of the metadata.
+    std::vector<Gain> lookupTonemapGainFromLut(
+            aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+            aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+            const std::vector<Color>& colors, const Metadata& metadata);
+
+protected:
+    // What the tone curve of lookupTonemapGain() is a function of.
+    enum class ToneCurveInput {
+        // The largest channel of linearRGB.
+        MaxRGB,
+        // The y channel of xyz.
+        Luminance,
+    };
+    virtual ToneCurveInput getToneCurveInput() const = 0;
+
+private:
+    struct GainLut;
+
+    std::shared_ptr<const GainLut> getGainLut(
+            aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+            aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+            const Metadata& metadata);
+
+    std::mutex mGainLutsMutex;
+    // From the most to the least recently used.
+    std::list<std::shared_ptr<const GainLut>> mGainLuts;
 };
 
 // Retrieves a tonemapper instance.
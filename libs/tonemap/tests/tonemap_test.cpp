@@ -85,4 +85,37 @@ TEST_F(TonemapTest, generateTonemapGainShaderSkSL_containsEntryPointForHLG) {
     EXPECT_THAT(shader, HasSubstr("float libtonemap_LookupTonemapGain(vec3 linearRGB, vec3 xyz)"));
 }
 
+TEST_F(TonemapTest, lookupTonemapGainFromLut_matchesLookupTonemapGain) {
+    using aidl::android::hardware::graphics::common::Dataspace;
+
+    std::vector<tonemap::Color> colors;
+    for (float nits = 0.f; nits <= 12000.f; nits = nits < 1.f ? nits + 0.01f : nits * 1.01f) {
+        colors.push_back({.linearRGB = vec3(nits, nits * 0.5f, nits * 0.2f),
+                          .xyz = vec3(nits * 0.4f, nits * 0.6f, nits * 0.3f)});
+    }
+
+    for (const auto sourceDataspace : {Dataspace::BT2020_ITU_PQ, Dataspace::BT2020_ITU_HLG}) {
+        for (const float currentDisplayLuminance : {50.f, 500.f}) {
+            const tonemap::Metadata metadata{.displayMaxLuminance = 500.f,
+                                             .contentMaxLuminance = 1000.f,
+                                             .currentDisplayLuminance = currentDisplayLuminance};
+            const auto expected =
+                    tonemap::getToneMapper()->lookupTonemapGain(sourceDataspace,
+                                                                Dataspace::DISPLAY_P3, colors,
+                                                                metadata);
+            const auto gains =
+                    tonemap::getToneMapper()->lookupTonemapGainFromLut(sourceDataspace,
+                                                                       Dataspace::DISPLAY_P3,
+                                                                       colors, metadata);
+
+            ASSERT_EQ(expected.size(), gains.size());
+            for (size_t i = 0; i < gains.size(); i++) {
+                EXPECT_NEAR(expected[i], gains[i],
+                            expected[i] * tonemap::ToneMapper::kLutGainTolerance)
+                        << "at " << colors[i].linearRGB.r << " nits";
+            }
+        }
+    }
+}
+
 } // namespace android
@@ -17,7 +17,9 @@
 #include <tonemap/tonemap.h>
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <mutex>
 #include <type_traits>
 
@@ -65,6 +67,9 @@ float computeHlgGamma(float currentDisplayBrightnessNits) {
 }
 
 class ToneMapperO : public ToneMapper {
+protected:
+    ToneCurveInput getToneCurveInput() const override { return ToneCurveInput::Luminance; }
+
 public:
     std::string generateTonemapGainShaderSkSL(
             aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
@@ -457,6 +462,9 @@ private:
         return nits <= 1.0 / 12.0 ? std::sqrt(3.0 * nits) : a * std::log(12.0 * nits - b) + c;
     }
 
+protected:
+    ToneCurveInput getToneCurveInput() const override { return ToneCurveInput::MaxRGB; }
+
 public:
     std::string generateTonemapGainShaderSkSL(
             aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
@@ -728,8 +736,124 @@ public:
     }
 };
 
+// The gain tables sample the tone curve at kLutMaxNits * (i / (kLutSize - 1))^2 nits, which is
+// denser at low luminance, where the curves bend the most relative to the input. Inputs in the
+// first kLutExactCells cells, where the gain of HLG curves is singular at 0 nits, or above
+// kLutMaxNits, are evaluated exactly instead. These bounds keep the gains within
+// kLutGainTolerance of the curves.
+constexpr size_t kLutSize = 4096;
+constexpr size_t kLutExactCells = 16;
+constexpr float kLutMaxNits = 10000.f;
+constexpr size_t kMaxGainLuts = 4;
+
 } // namespace
 
+struct ToneMapper::GainLut {
+    aidl::android::hardware::graphics::common::Dataspace sourceDataspace;
+    aidl::android::hardware::graphics::common::Dataspace destinationDataspace;
+    float displayMaxLuminance;
+    float contentMaxLuminance;
+    float currentDisplayLuminance;
+    std::vector<float> gains;
+
+    bool matches(aidl::android::hardware::graphics::common::Dataspace source,
+                 aidl::android::hardware::graphics::common::Dataspace destination,
+                 const Metadata& metadata) const {
+        return sourceDataspace == source && destinationDataspace == destination &&
+                displayMaxLuminance == metadata.displayMaxLuminance &&
+                contentMaxLuminance == metadata.contentMaxLuminance &&
+                currentDisplayLuminance == metadata.currentDisplayLuminance;
+    }
+};
+
+std::shared_ptr<const ToneMapper::GainLut> ToneMapper::getGainLut(
+        aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+        aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+        const Metadata& metadata) {
+    std::lock_guard lock(mGainLutsMutex);
+    for (auto it = mGainLuts.begin(); it != mGainLuts.end(); it++) {
+        if ((*it)->matches(sourceDataspace, destinationDataspace, metadata)) {
+            mGainLuts.splice(mGainLuts.begin(), mGainLuts, it);
+            return mGainLuts.front();
+        }
+    }
+
+    // Gray samples, so that the curve sees the same input whichever channels it is a function of.
+    std::vector<Color> samples(kLutSize);
+    for (size_t i = 0; i < kLutSize; i++) {
+        const float position = static_cast<float>(i) / (kLutSize - 1);
+        const float nits = kLutMaxNits * position * position;
+        samples[i] = {.linearRGB = vec3(nits), .xyz = vec3(nits)};
+    }
+    const std::vector<Gain> gains =
+            lookupTonemapGain(sourceDataspace, destinationDataspace, samples, metadata);
+
+    auto lut = std::make_shared<GainLut>(
+            GainLut{.sourceDataspace = sourceDataspace,
+                    .destinationDataspace = destinationDataspace,
+                    .displayMaxLuminance = metadata.displayMaxLuminance,
+                    .contentMaxLuminance = metadata.contentMaxLuminance,
+                    .currentDisplayLuminance = metadata.currentDisplayLuminance,
+                    .gains = std::vector<float>(gains.begin(), gains.end())});
+    mGainLuts.push_front(std::move(lut));
+    if (mGainLuts.size() > kMaxGainLuts) {
+        mGainLuts.pop_back();
+    }
+    return mGainLuts.front();
+}
+
+std::vector<ToneMapper::Gain> ToneMapper::lookupTonemapGainFromLut(
+        aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+        aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+        const std::vector<Color>& colors, const Metadata& metadata) {
+    const std::shared_ptr<const GainLut> lut =
+            getGainLut(sourceDataspace, destinationDataspace, metadata);
+    const float* const table = lut->gains.data();
+
+    std::vector<Gain> gains(colors.size());
+    std::vector<size_t> exactIndices;
+    std::vector<Color> exactColors;
+
+    // Without virtual calls or per-dataspace branches, each color costs a square root and a lerp.
+    const auto interpolate = [&](auto getInput) {
+        constexpr float kScale = kLutSize - 1;
+        for (size_t i = 0; i < colors.size(); i++) {
+            const float position = std::sqrt(std::max(getInput(colors[i]), 0.f) / kLutMaxNits) *
+                    kScale;
+            if (position < kLutExactCells || position >= kScale) {
+                exactIndices.push_back(i);
+                continue;
+            }
+            const size_t cell = static_cast<size_t>(position);
+            const float fraction = position - static_cast<float>(cell);
+            gains[i] = table[cell] + (table[cell + 1] - table[cell]) * fraction;
+        }
+    };
+    switch (getToneCurveInput()) {
+        case ToneCurveInput::MaxRGB:
+            interpolate([](const Color& color) {
+                return std::max({color.linearRGB.r, color.linearRGB.g, color.linearRGB.b});
+            });
+            break;
+        case ToneCurveInput::Luminance:
+            interpolate([](const Color& color) { return color.xyz.y; });
+            break;
+    }
+
+    if (!exactIndices.empty()) {
+        exactColors.reserve(exactIndices.size());
+        for (size_t index : exactIndices) {
+            exactColors.push_back(colors[index]);
+        }
+        const std::vector<Gain> exactGains =
+                lookupTonemapGain(sourceDataspace, destinationDataspace, exactColors, metadata);
+        for (size_t i = 0; i < exactIndices.size(); i++) {
+            gains[exactIndices[i]] = exactGains[i];
+        }
+    }
+    return gains;
+}
+
 ToneMapper* getToneMapper() {
     static std::once_flag sOnce;
     static std::unique_ptr<ToneMapper> sToneMapper;
@@ -14,6 +14,11 @@
  * limitations under the License.
  */
 
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+
 #include <ui/ColorSpace.h>
 
 using namespace std::placeholders;
@@ -360,15 +365,20 @@ std::unique_ptr<float3[]> ColorSpace::createLUT(uint32_t size, const ColorSpace&
     float3* data = lut.get();
 
     ColorSpaceConnector connector(src, dst);
+    const mat3& transform = connector.getTransform();
+
+    // Each axis only has size distinct values, which are decoded once rather than for each entry,
+    // as ColorSpaceConnector::transform() decodes them.
+    std::unique_ptr<float[]> linear(new float[size]);
+    for (uint32_t i = 0; i < size; i++) {
+        linear[i] = src.getEOTF()(src.getClamper()(static_cast<float>(i) * m));
+    }
 
     for (uint32_t z = 0; z < size; z++) {
         for (int32_t y = int32_t(size - 1); y >= 0; y--) {
             for (uint32_t x = 0; x < size; x++) {
-                *data++ = connector.transform({
-                    static_cast<float>(x) * m,
-                    static_cast<float>(y) * m,
-                    static_cast<float>(z) * m,
-                });
+                *data++ = apply(dst.fromLinear(transform * float3{linear[x], linear[y], linear[z]}),
+                                dst.getClamper());
             }
         }
     }
@@ -417,4 +427,110 @@ ColorSpaceConnector::ColorSpaceConnector(
     }
 }
 
+// Rounds a normalized value to the nearest 8 bit value.
+static uint8_t quantize(float v) {
+    return static_cast<uint8_t>(clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static uint32_t floatBits(float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+static float bitsFloat(uint32_t bits) {
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+ColorSpacePixelConverter::ColorSpacePixelConverter(
+        const ColorSpace& src,
+        const ColorSpace& dst) noexcept
+        : mTransform(ColorSpaceConnector(src, dst).getTransform()) {
+    for (size_t i = 0; i < mToLinear.size(); i++) {
+        mToLinear[i] = src.getEOTF()(src.getClamper()(static_cast<float>(i) / 255.0f));
+    }
+
+    const auto encodeExactly = [&dst](float linear) {
+        return quantize(dst.getClamper()(dst.getOETF()(linear)));
+    };
+
+    // The positive floats are ordered as their bits, which the thresholds are searched over.
+    const uint32_t oneBits = floatBits(1.0f);
+    for (size_t value = 0; value < 255; value++) {
+        if (encodeExactly(1.0f) <= value) {
+            mThresholds[value] = std::numeric_limits<float>::infinity();
+            continue;
+        }
+        uint32_t low = 0;
+        uint32_t high = oneBits;
+        while (low < high) {
+            const uint32_t middle = low + (high - low) / 2;
+            if (encodeExactly(bitsFloat(middle)) > value) {
+                high = middle;
+            } else {
+                low = middle + 1;
+            }
+        }
+        mThresholds[value] = bitsFloat(low);
+    }
+    mThresholds[255] = std::numeric_limits<float>::infinity();
+
+    uint8_t value = 0;
+    for (size_t i = 0; i <= BUCKET_COUNT; i++) {
+        const float linear = static_cast<float>(i) / static_cast<float>(BUCKET_COUNT);
+        while (linear >= mThresholds[value]) {
+            value++;
+        }
+        mBuckets[i] = value;
+    }
+}
+
+inline uint8_t ColorSpacePixelConverter::encode(float linear) const noexcept {
+    linear = linear > 0.0f ? (linear < 1.0f ? linear : 1.0f) : 0.0f;
+    // The scale by a power of 2 is exact, so the linear value is at least the lowest one of its
+    // bucket, and encodes to at least the value of the bucket.
+    uint8_t value = mBuckets[static_cast<size_t>(linear * static_cast<float>(BUCKET_COUNT))];
+    while (linear >= mThresholds[value]) {
+        value++;
+    }
+    return value;
+}
+
+void ColorSpacePixelConverter::convert(const uint8_t* src, uint8_t* dst,
+                                       size_t count) const noexcept {
+    // The pixels are converted in batches, with their components in separate arrays, so that the
+    // compiler vectorizes the products by the transform.
+    constexpr size_t BATCH_SIZE = 16;
+    float r[BATCH_SIZE], g[BATCH_SIZE], b[BATCH_SIZE];
+    float outR[BATCH_SIZE], outG[BATCH_SIZE], outB[BATCH_SIZE];
+    const mat3& M(mTransform);
+
+    for (size_t start = 0; start < count; start += BATCH_SIZE) {
+        const size_t n = std::min(BATCH_SIZE, count - start);
+        const uint8_t* in = src + start * 4;
+        uint8_t* out = dst + start * 4;
+
+        for (size_t i = 0; i < n; i++) {
+            r[i] = mToLinear[in[i * 4 + 0]];
+            g[i] = mToLinear[in[i * 4 + 1]];
+            b[i] = mToLinear[in[i * 4 + 2]];
+        }
+        // The same products and sums, in the same order, as mat3 * float3.
+        for (size_t i = 0; i < n; i++) {
+            outR[i] = M[0][0] * r[i] + M[1][0] * g[i] + M[2][0] * b[i];
+            outG[i] = M[0][1] * r[i] + M[1][1] * g[i] + M[2][1] * b[i];
+            outB[i] = M[0][2] * r[i] + M[1][2] * g[i] + M[2][2] * b[i];
+        }
+        for (size_t i = 0; i < n; i++) {
+            const uint8_t alpha = in[i * 4 + 3];
+            out[i * 4 + 0] = encode(outR[i]);
+            out[i * 4 + 1] = encode(outG[i]);
+            out[i * 4 + 2] = encode(outB[i]);
+            out[i * 4 + 3] = alpha;
+        }
+    }
+}
+
 }; // namespace android
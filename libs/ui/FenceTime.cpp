@@ -20,10 +20,17 @@
 
 #include <cutils/compiler.h>  // For CC_[UN]LIKELY
 #include <utils/Log.h>
+#include <errno.h>
 #include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 #include <memory>
+#include <thread>
 
 namespace android {
 
@@ -177,6 +184,50 @@ nsecs_t FenceTime::getCachedSignalTime() const {
     return mSignalTime.load(std::memory_order_acquire);
 }
 
+void FenceTime::resolveSignalTimes(const std::vector<std::shared_ptr<FenceTime>>& fences) {
+    // Hold references to the pending fences, so that their fds stay open while polling.
+    std::vector<std::pair<FenceTime*, sp<Fence>>> pending;
+    std::vector<pollfd> pollFds;
+    pending.reserve(fences.size());
+    pollFds.reserve(fences.size());
+    for (const auto& fenceTime : fences) {
+        if (!fenceTime) {
+            continue;
+        }
+        sp<Fence> fence = fenceTime->getPendingFence();
+        if (!fence) {
+            continue;
+        }
+        if (fence->get() < 0) {
+            // Test fences have no fd to poll.
+            fenceTime->getSignalTime();
+            continue;
+        }
+        pollFds.push_back({.fd = fence->get(), .events = POLLIN, .revents = 0});
+        pending.emplace_back(fenceTime.get(), std::move(fence));
+    }
+    if (pollFds.empty()) {
+        return;
+    }
+
+    const int ready = TEMP_FAILURE_RETRY(poll(pollFds.data(), pollFds.size(), 0));
+    if (ready < 0) {
+        ALOGE("resolveSignalTimes: poll failed: %s", strerror(errno));
+    }
+    for (size_t i = 0; i < pending.size(); i++) {
+        // Also query the fences which poll() reported an error for, or all of them if poll()
+        // failed, so that they resolve to SIGNAL_TIME_INVALID as they would without batching.
+        if (ready < 0 || pollFds[i].revents != 0) {
+            pending[i].first->getSignalTime();
+        }
+    }
+}
+
+sp<Fence> FenceTime::getPendingFence() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mFence;
+}
+
 FenceTime::Snapshot FenceTime::getSnapshot() const {
     // Quick check without the lock.
     nsecs_t signalTime = mSignalTime.load(std::memory_order_relaxed);
@@ -301,32 +352,127 @@ void FenceTimeline::push(const std::shared_ptr<FenceTime>& fence) {
             // we are removing it from the timeline.
             front->getSignalTime();
         }
-        mQueue.pop();
+        mQueue.pop_front();
     }
-    mQueue.push(fence);
+    mQueue.push_back(fence);
 }
 
 void FenceTimeline::updateSignalTimes() {
     std::lock_guard<std::mutex> lock(mMutex);
+    std::vector<std::shared_ptr<FenceTime>> fences;
+    fences.reserve(mQueue.size());
+    for (const auto& weakFence : mQueue) {
+        if (std::shared_ptr<FenceTime> fence = weakFence.lock()) {
+            fences.push_back(std::move(fence));
+        }
+    }
+    FenceTime::resolveSignalTimes(fences);
+
     while (!mQueue.empty()) {
         std::shared_ptr<FenceTime> fence = mQueue.front().lock();
         if (!fence) {
             // The shared_ptr no longer exists and no one cares about the
             // timestamp anymore.
-            mQueue.pop();
+            mQueue.pop_front();
             continue;
-        } else if (fence->getSignalTime() != Fence::SIGNAL_TIME_PENDING) {
+        } else if (fence->getCachedSignalTime() != Fence::SIGNAL_TIME_PENDING) {
             // The fence has signaled and we've removed the sp<Fence> ref.
-            mQueue.pop();
+            mQueue.pop_front();
             continue;
         } else {
-            // The fence didn't signal yet. Break since the later ones
-            // shouldn't have signaled either.
+            // The fence didn't signal yet. Keep the later ones even if they
+            // signaled out of order: their signal time is cached already.
             break;
         }
     }
 }
 
+// ============================================================================
+// FenceResolver
+// ============================================================================
+ANDROID_SINGLETON_STATIC_INSTANCE(FenceResolver);
+
+FenceResolver::FenceResolver() : mWakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+    LOG_ALWAYS_FATAL_IF(!mWakeFd.ok(), "Failed to create eventfd: %s", strerror(errno));
+    // The resolver lives as long as the process does.
+    std::thread(&FenceResolver::threadMain, this).detach();
+}
+
+void FenceResolver::track(const std::shared_ptr<FenceTime>& fence) {
+    if (!fence || fence->getCachedSignalTime() != Fence::SIGNAL_TIME_PENDING) {
+        return;
+    }
+
+    {
+        std::lock_guard lock(mMutex);
+        if (mFences.size() >= MAX_ENTRIES) {
+            // The oldest fence is the least likely to still be of interest.
+            mFences.pop_front();
+        }
+        mFences.push_back(fence);
+        if (mWakePending) {
+            return;
+        }
+        mWakePending = true;
+    }
+
+    const uint64_t increment = 1;
+    if (TEMP_FAILURE_RETRY(write(mWakeFd.get(), &increment, sizeof(increment))) < 0) {
+        ALOGE("FenceResolver: Failed to wake up: %s", strerror(errno));
+    }
+}
+
+void FenceResolver::threadMain() {
+    pthread_setname_np(pthread_self(), "FenceResolver");
+
+    std::vector<std::weak_ptr<FenceTime>> fenceTimes;
+    // Hold references to the fences, so that their fds stay open while polling.
+    std::vector<sp<Fence>> fences;
+    std::vector<pollfd> pollFds;
+    while (true) {
+        fenceTimes.clear();
+        fences.clear();
+        pollFds.clear();
+        pollFds.push_back({.fd = mWakeFd.get(), .events = POLLIN, .revents = 0});
+        {
+            std::lock_guard lock(mMutex);
+            for (auto it = mFences.begin(); it != mFences.end();) {
+                const std::shared_ptr<FenceTime> fenceTime = it->lock();
+                sp<Fence> fence = fenceTime ? fenceTime->getPendingFence() : nullptr;
+                if (!fence || fence->get() < 0) {
+                    // The fence signaled, no one cares about it anymore, or it cannot be polled.
+                    it = mFences.erase(it);
+                    continue;
+                }
+                pollFds.push_back({.fd = fence->get(), .events = POLLIN, .revents = 0});
+                fenceTimes.push_back(*it);
+                fences.push_back(std::move(fence));
+                ++it;
+            }
+        }
+
+        if (TEMP_FAILURE_RETRY(poll(pollFds.data(), pollFds.size(), -1)) < 0) {
+            ALOGE("FenceResolver: poll failed: %s", strerror(errno));
+            continue;
+        }
+
+        if (pollFds[0].revents != 0) {
+            std::lock_guard lock(mMutex);
+            uint64_t count;
+            (void)read(mWakeFd.get(), &count, sizeof(count));
+            mWakePending = false;
+        }
+        for (size_t i = 1; i < pollFds.size(); i++) {
+            if (pollFds[i].revents == 0) {
+                continue;
+            }
+            if (const std::shared_ptr<FenceTime> fenceTime = fenceTimes[i - 1].lock()) {
+                fenceTime->getSignalTime();
+            }
+        }
+    }
+}
+
 // ============================================================================
 // FenceToFenceTimeMap
 // ============================================================================
@@ -22,6 +22,27 @@ namespace android {
 
 GrallocMapper::~GrallocMapper() {}
 
+status_t GrallocMapper::getBufferMetadata(buffer_handle_t bufferHandle,
+                                          GraphicBufferMapper::BufferMetadata* outMetadata) const {
+    status_t error;
+    if ((error = getBufferId(bufferHandle, &outMetadata->bufferId)) != OK ||
+        (error = getName(bufferHandle, &outMetadata->name)) != OK ||
+        (error = getWidth(bufferHandle, &outMetadata->width)) != OK ||
+        (error = getHeight(bufferHandle, &outMetadata->height)) != OK ||
+        (error = getLayerCount(bufferHandle, &outMetadata->layerCount)) != OK ||
+        (error = getPixelFormatRequested(bufferHandle, &outMetadata->pixelFormatRequested)) != OK ||
+        (error = getPixelFormatFourCC(bufferHandle, &outMetadata->pixelFormatFourCC)) != OK ||
+        (error = getPixelFormatModifier(bufferHandle, &outMetadata->pixelFormatModifier)) != OK ||
+        (error = getUsage(bufferHandle, &outMetadata->usage)) != OK ||
+        (error = getAllocationSize(bufferHandle, &outMetadata->allocationSize)) != OK ||
+        (error = getProtectedContent(bufferHandle, &outMetadata->protectedContent)) != OK ||
+        (error = getCompression(bufferHandle, &outMetadata->compression)) != OK ||
+        (error = getPlaneLayouts(bufferHandle, &outMetadata->planeLayouts)) != OK) {
+        return error;
+    }
+    return OK;
+}
+
 GrallocAllocator::~GrallocAllocator() {}
 
 } // namespace android
@@ -28,6 +28,8 @@
 #include <ui/FatVector.h>
 #include <vndksupport/linker.h>
 
+#include <tuple>
+
 using namespace aidl::android::hardware::graphics::allocator;
 using namespace aidl::android::hardware::graphics::common;
 using namespace ::android::hardware::graphics::mapper;
@@ -177,6 +179,65 @@ static AIMapper_Error setStandardMetadata(AIMapper *mapper, buffer_handle_t buff
                                           sizeRequired);
 }
 
+// Standard metadata which is only set when the buffer is allocated. Dataspace, blend mode and HDR
+// metadata are left out, since any process which imported the buffer may set them.
+template <StandardMetadataType... Types>
+struct ImmutableMetadata {
+    template <StandardMetadataType T>
+    static constexpr size_t indexOf() {
+        constexpr StandardMetadataType kTypes[] = {Types...};
+        for (size_t i = 0; i < sizeof...(Types); i++) {
+            if (kTypes[i] == T) return i;
+        }
+        return sizeof...(Types);
+    }
+
+    template <StandardMetadataType T>
+    static constexpr bool contains() {
+        return indexOf<T>() < sizeof...(Types);
+    }
+
+    std::tuple<decltype(getStandardMetadata<Types>(nullptr, nullptr))...> values;
+};
+
+struct Gralloc5Mapper::CachedMetadata {
+    using Values = ImmutableMetadata<
+            StandardMetadataType::BUFFER_ID, StandardMetadataType::NAME,
+            StandardMetadataType::WIDTH, StandardMetadataType::HEIGHT,
+            StandardMetadataType::LAYER_COUNT, StandardMetadataType::PIXEL_FORMAT_REQUESTED,
+            StandardMetadataType::PIXEL_FORMAT_FOURCC, StandardMetadataType::PIXEL_FORMAT_MODIFIER,
+            StandardMetadataType::USAGE, StandardMetadataType::ALLOCATION_SIZE,
+            StandardMetadataType::PROTECTED_CONTENT, StandardMetadataType::COMPRESSION,
+            StandardMetadataType::PLANE_LAYOUTS, StandardMetadataType::STRIDE>;
+
+    std::mutex mutex;
+    // Filled on first use. Values which failed to be fetched are fetched again on the next use.
+    Values values GUARDED_BY(mutex);
+};
+
+template <StandardMetadataType T>
+auto Gralloc5Mapper::getMetadata(buffer_handle_t bufferHandle) const {
+    if constexpr (CachedMetadata::Values::contains<T>()) {
+        if (const std::shared_ptr<CachedMetadata> cached = findCachedMetadata(bufferHandle)) {
+            std::lock_guard lock(cached->mutex);
+            auto& value =
+                    std::get<CachedMetadata::Values::indexOf<T>()>(cached->values.values);
+            if (!value.has_value()) {
+                value = getStandardMetadata<T>(mMapper, bufferHandle);
+            }
+            return value;
+        }
+    }
+    return getStandardMetadata<T>(mMapper, bufferHandle);
+}
+
+std::shared_ptr<Gralloc5Mapper::CachedMetadata> Gralloc5Mapper::findCachedMetadata(
+        buffer_handle_t bufferHandle) const {
+    std::lock_guard lock(mMetadataCacheMutex);
+    const auto it = mMetadataCache.find(bufferHandle);
+    return it != mMetadataCache.end() ? it->second : nullptr;
+}
+
 Gralloc5Allocator::Gralloc5Allocator(const Gralloc5Mapper &mapper) : mMapper(mapper) {
     mAllocator = getInstance().allocator;
 }
@@ -528,10 +589,19 @@ std::string Gralloc5Mapper::dumpBuffers(bool less) const {
 
 status_t Gralloc5Mapper::importBuffer(const native_handle_t *rawHandle,
                                       buffer_handle_t *outBufferHandle) const {
-    return mMapper->v5.importBuffer(rawHandle, outBufferHandle);
+    auto status = mMapper->v5.importBuffer(rawHandle, outBufferHandle);
+    if (status == AIMAPPER_ERROR_NONE) {
+        std::lock_guard lock(mMetadataCacheMutex);
+        mMetadataCache.insert_or_assign(*outBufferHandle, std::make_shared<CachedMetadata>());
+    }
+    return status;
 }
 
 void Gralloc5Mapper::freeBuffer(buffer_handle_t bufferHandle) const {
+    {
+        std::lock_guard lock(mMetadataCacheMutex);
+        mMetadataCache.erase(bufferHandle);
+    }
     mMapper->v5.freeBuffer(bufferHandle);
 }
 
@@ -540,14 +610,14 @@ status_t Gralloc5Mapper::validateBufferSize(buffer_handle_t bufferHandle, uint32
                                             uint32_t layerCount, uint64_t usage,
                                             uint32_t stride) const {
     {
-        auto value = getStandardMetadata<StandardMetadataType::WIDTH>(mMapper, bufferHandle);
+        auto value = getMetadata<StandardMetadataType::WIDTH>(bufferHandle);
         if (width != value) {
             ALOGW("Width didn't match, expected %d got %" PRId64, width, value.value_or(-1));
             return BAD_VALUE;
         }
     }
     {
-        auto value = getStandardMetadata<StandardMetadataType::HEIGHT>(mMapper, bufferHandle);
+        auto value = getMetadata<StandardMetadataType::HEIGHT>(bufferHandle);
         if (height != value) {
             ALOGW("Height didn't match, expected %d got %" PRId64, height, value.value_or(-1));
             return BAD_VALUE;
@@ -556,9 +626,7 @@ status_t Gralloc5Mapper::validateBufferSize(buffer_handle_t bufferHandle, uint32
     {
         auto expected = static_cast<APixelFormat>(format);
         if (expected != APixelFormat::IMPLEMENTATION_DEFINED) {
-            auto value =
-                    getStandardMetadata<StandardMetadataType::PIXEL_FORMAT_REQUESTED>(mMapper,
-                                                                                      bufferHandle);
+            auto value = getMetadata<StandardMetadataType::PIXEL_FORMAT_REQUESTED>(bufferHandle);
             if (expected != value) {
                 ALOGW("Format didn't match, expected %d got %s", format,
                       value.has_value() ? toString(*value).c_str() : "<null>");
@@ -567,7 +635,7 @@ status_t Gralloc5Mapper::validateBufferSize(buffer_handle_t bufferHandle, uint32
         }
     }
     {
-        auto value = getStandardMetadata<StandardMetadataType::LAYER_COUNT>(mMapper, bufferHandle);
+        auto value = getMetadata<StandardMetadataType::LAYER_COUNT>(bufferHandle);
         if (layerCount != value) {
             ALOGW("Layer count didn't match, expected %d got %" PRId64, layerCount,
                   value.value_or(-1));
@@ -586,7 +654,7 @@ status_t Gralloc5Mapper::validateBufferSize(buffer_handle_t bufferHandle, uint32
     //     }
     // }
     {
-        auto value = getStandardMetadata<StandardMetadataType::STRIDE>(mMapper, bufferHandle);
+        auto value = getMetadata<StandardMetadataType::STRIDE>(bufferHandle);
         if (stride != value) {
             ALOGW("Stride didn't match, expected %" PRIu32 " got %" PRId32, stride,
                   value.value_or(-1));
@@ -749,7 +817,7 @@ status_t Gralloc5Mapper::isSupported(uint32_t width, uint32_t height, PixelForma
 }
 
 status_t Gralloc5Mapper::getBufferId(buffer_handle_t bufferHandle, uint64_t *outBufferId) const {
-    auto value = getStandardMetadata<StandardMetadataType::BUFFER_ID>(mMapper, bufferHandle);
+    auto value = getMetadata<StandardMetadataType::BUFFER_ID>(bufferHandle);
     if (value.has_value()) {
         *outBufferId = *value;
         return OK;
@@ -758,7 +826,7 @@ status_t Gralloc5Mapper::getBufferId(buffer_handle_t bufferHandle, uint64_t *out
 }
 
 status_t Gralloc5Mapper::getName(buffer_handle_t bufferHandle, std::string *outName) const {
-    auto value = getStandardMetadata<StandardMetadataType::NAME>(mMapper, bufferHandle);
+    auto value = getMetadata<StandardMetadataType::NAME>(bufferHandle);
     if (value.has_value()) {
         *outName = *value;
         return OK;
@@ -767,7 +835,7 @@ status_t Gralloc5Mapper::getName(buffer_handle_t bufferHandle, std::string *outN
 }
 
 status_t Gralloc5Mapper::getWidth(buffer_handle_t bufferHandle, uint64_t *outWidth) const {
-    auto value = getStandardMetadata<StandardMetadataType::WIDTH>(mMapper, bufferHandle);
+    auto value = getMetadata<StandardMetadataType::WIDTH>(bufferHandle);
     if (value.has_value()) {
         *outWidth = *value;
         return OK;
@@ -776,7 +844,7 @@ status_t Gralloc5Mapper::getWidth(buffer_handle_t bufferHandle, uint64_t *outWid
 }
 
 status_t Gralloc5Mapper::getHeight(buffer_handle_t bufferHandle, uint64_t *outHeight) const {
-    auto value = getStandardMetadata<StandardMetadataType::HEIGHT>(mMapper, bufferHandle);
+    auto value = getMetadata<StandardMetadataType::HEIGHT>(bufferHandle);
     if (value.has_value()) {
         *outHeight = *value;
         return OK;
@@ -786,7 +854,7 @@ status_t Gralloc5Mapper::getHeight(buffer_handle_t bufferHandle, uint64_t *outHe
 
 status_t Gralloc5Mapper::getLayerCount(buffer_handle_t bufferHandle,
                                        uint64_t *outLayerCount) const {
-    auto value = getStandardMetadata<StandardMetadataType::LAYER_COUNT>(mMapper, bufferHandle);
+    auto value = getMetadata<StandardMetadataType::LAYER_COUNT>(bufferHandle);
     if (value.has_value()) {
         *outLayerCount = *value;
         return OK;
@@ -796,8 +864,7 @@ status_t Gralloc5Mapper::getLayerCount(buffer_handle_t bufferHandle,
 
 status_t Gralloc5Mapper::getPixelFormatRequested(buffer_handle_t bufferHandle,
                                                  ui::PixelFormat *outPixelFormatRequested) const {
-    auto value = getStandardMetadata<StandardMetadataType::PIXEL_FORMAT_REQUESTED>(mMapper,
-                                                                                   bufferHandle);
+    auto value = getMetadata<StandardMetadataType::PIXEL_FORMAT_REQUESTED>(bufferHandle);
     if (value.has_value()) {
         *outPixelFormatRequested = static_cast<ui::PixelFormat>(*value);
         return OK;
@@ -807,8 +874,7 @@ status_t Gralloc5Mapper::getPixelFormatRequested(buffer_handle_t bufferHandle,
 
 status_t Gralloc5Mapper::getPixelFormatFourCC(buffer_handle_t bufferHandle,
                                               uint32_t *outPixelFormatFourCC) const {
-    auto value =
-            getStandardMetadata<StandardMetadataType::PIXEL_FORMAT_FOURCC>(mMapper, bufferHandle);
+    auto value = getMetadata<StandardMetadataType::PIXEL_FORMAT_FOURCC>(bufferHandle);
     if (value.has_value()) {
         *outPixelFormatFourCC = *value;
         return OK;
@@ -818,8 +884,7 @@ status_t Gralloc5Mapper::getPixelFormatFourCC(buffer_handle_t bufferHandle,
 
 status_t Gralloc5Mapper::getPixelFormatModifier(buffer_handle_t bufferHandle,
                                                 uint64_t *outPixelFormatModifier) const {
-    auto value =
-            getStandardMetadata<StandardMetadataType::PIXEL_FORMAT_MODIFIER>(mMapper, bufferHandle);
+    auto value = getMetadata<StandardMetadataType::PIXEL_FORMAT_MODIFIER>(bufferHandle);
     if (value.has_value()) {
         *outPixelFormatModifier = *value;
         return OK;
@@ -828,7 +893,7 @@ status_t Gralloc5Mapper::getPixelFormatModifier(buffer_handle_t bufferHandle,
 }
 
 status_t Gralloc5Mapper::getUsage(buffer_handle_t bufferHandle, uint64_t *outUsage) const {
-    auto value = getStandardMetadata<StandardMetadataType::USAGE>(mMapper, bufferHandle);
+    auto value = getMetadata<StandardMetadataType::USAGE>(bufferHandle);
     if (value.has_value()) {
         *outUsage = static_cast<uint64_t>(*value);
         return OK;
@@ -838,7 +903,7 @@ status_t Gralloc5Mapper::getUsage(buffer_handle_t bufferHandle, uint64_t *outUsa
 
 status_t Gralloc5Mapper::getAllocationSize(buffer_handle_t bufferHandle,
                                            uint64_t *outAllocationSize) const {
-    auto value = getStandardMetadata<StandardMetadataType::ALLOCATION_SIZE>(mMapper, bufferHandle);
+    auto value = getMetadata<StandardMetadataType::ALLOCATION_SIZE>(bufferHandle);
     if (value.has_value()) {
         *outAllocationSize = *value;
         return OK;
@@ -848,8 +913,7 @@ status_t Gralloc5Mapper::getAllocationSize(buffer_handle_t bufferHandle,
 
 status_t Gralloc5Mapper::getProtectedContent(buffer_handle_t bufferHandle,
                                              uint64_t *outProtectedContent) const {
-    auto value =
-            getStandardMetadata<StandardMetadataType::PROTECTED_CONTENT>(mMapper, bufferHandle);
+    auto value = getMetadata<StandardMetadataType::PROTECTED_CONTENT>(bufferHandle);
     if (value.has_value()) {
         *outProtectedContent = *value;
         return OK;
@@ -860,7 +924,7 @@ status_t Gralloc5Mapper::getProtectedContent(buffer_handle_t bufferHandle,
 status_t Gralloc5Mapper::getCompression(
         buffer_handle_t bufferHandle,
         aidl::android::hardware::graphics::common::ExtendableType *outCompression) const {
-    auto value = getStandardMetadata<StandardMetadataType::COMPRESSION>(mMapper, bufferHandle);
+    auto value = getMetadata<StandardMetadataType::COMPRESSION>(bufferHandle);
     if (value.has_value()) {
         *outCompression = *value;
         return OK;
@@ -870,7 +934,7 @@ status_t Gralloc5Mapper::getCompression(
 
 status_t Gralloc5Mapper::getCompression(buffer_handle_t bufferHandle,
                                         ui::Compression *outCompression) const {
-    auto value = getStandardMetadata<StandardMetadataType::COMPRESSION>(mMapper, bufferHandle);
+    auto value = getMetadata<StandardMetadataType::COMPRESSION>(bufferHandle);
     if (!value.has_value()) {
         return UNKNOWN_TRANSACTION;
     }
@@ -939,7 +1003,7 @@ status_t Gralloc5Mapper::getChromaSiting(buffer_handle_t bufferHandle,
 
 status_t Gralloc5Mapper::getPlaneLayouts(buffer_handle_t bufferHandle,
                                          std::vector<ui::PlaneLayout> *outPlaneLayouts) const {
-    auto value = getStandardMetadata<StandardMetadataType::PLANE_LAYOUTS>(mMapper, bufferHandle);
+    auto value = getMetadata<StandardMetadataType::PLANE_LAYOUTS>(bufferHandle);
     if (value.has_value()) {
         *outPlaneLayouts = *value;
         return OK;
@@ -947,6 +1011,48 @@ status_t Gralloc5Mapper::getPlaneLayouts(buffer_handle_t bufferHandle,
     return UNKNOWN_TRANSACTION;
 }
 
+status_t Gralloc5Mapper::getBufferMetadata(buffer_handle_t bufferHandle,
+                                          GraphicBufferMapper::BufferMetadata *outMetadata) const {
+    auto bufferId = getMetadata<StandardMetadataType::BUFFER_ID>(bufferHandle);
+    auto name = getMetadata<StandardMetadataType::NAME>(bufferHandle);
+    auto width = getMetadata<StandardMetadataType::WIDTH>(bufferHandle);
+    auto height = getMetadata<StandardMetadataType::HEIGHT>(bufferHandle);
+    auto layerCount = getMetadata<StandardMetadataType::LAYER_COUNT>(bufferHandle);
+    auto pixelFormatRequested =
+            getMetadata<StandardMetadataType::PIXEL_FORMAT_REQUESTED>(bufferHandle);
+    auto pixelFormatFourCC = getMetadata<StandardMetadataType::PIXEL_FORMAT_FOURCC>(bufferHandle);
+    auto pixelFormatModifier =
+            getMetadata<StandardMetadataType::PIXEL_FORMAT_MODIFIER>(bufferHandle);
+    auto usage = getMetadata<StandardMetadataType::USAGE>(bufferHandle);
+    auto allocationSize = getMetadata<StandardMetadataType::ALLOCATION_SIZE>(bufferHandle);
+    auto protectedContent = getMetadata<StandardMetadataType::PROTECTED_CONTENT>(bufferHandle);
+    auto compression = getMetadata<StandardMetadataType::COMPRESSION>(bufferHandle);
+    auto planeLayouts = getMetadata<StandardMetadataType::PLANE_LAYOUTS>(bufferHandle);
+    if (!bufferId || !name || !width || !height || !layerCount || !pixelFormatRequested ||
+        !pixelFormatFourCC || !pixelFormatModifier || !usage || !allocationSize ||
+        !protectedContent || !compression || !planeLayouts) {
+        return UNKNOWN_TRANSACTION;
+    }
+    if (!gralloc4::isStandardCompression(*compression)) {
+        return BAD_TYPE;
+    }
+
+    outMetadata->bufferId = *bufferId;
+    outMetadata->name = std::move(*name);
+    outMetadata->width = *width;
+    outMetadata->height = *height;
+    outMetadata->layerCount = *layerCount;
+    outMetadata->pixelFormatRequested = static_cast<ui::PixelFormat>(*pixelFormatRequested);
+    outMetadata->pixelFormatFourCC = *pixelFormatFourCC;
+    outMetadata->pixelFormatModifier = *pixelFormatModifier;
+    outMetadata->usage = static_cast<uint64_t>(*usage);
+    outMetadata->allocationSize = *allocationSize;
+    outMetadata->protectedContent = *protectedContent;
+    outMetadata->compression = gralloc4::getStandardCompressionValue(*compression);
+    outMetadata->planeLayouts = std::move(*planeLayouts);
+    return OK;
+}
+
 status_t Gralloc5Mapper::getDataspace(buffer_handle_t bufferHandle,
                                       ui::Dataspace *outDataspace) const {
     auto value = getStandardMetadata<StandardMetadataType::DATASPACE>(mMapper, bufferHandle);
@@ -21,6 +21,14 @@
 
 #include <cutils/atomic.h>
 
+#include <linux/dma-buf.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <optional>
+
 #include <grallocusage/GrallocUsageConversion.h>
 #include <sync/sync.h>
 #include <ui/GraphicBufferAllocator.h>
@@ -171,6 +179,10 @@ GraphicBuffer::~GraphicBuffer()
 
 void GraphicBuffer::free_handle()
 {
+    {
+        std::lock_guard lock(mCachedCpuMappingMutex);
+        unmapCachedCpuMapping();
+    }
     if (mOwner == ownHandle) {
         mBufferMapper.freeBuffer(handle);
     } else if (mOwner == ownData) {
@@ -391,6 +403,16 @@ status_t GraphicBuffer::lockAsync(uint64_t inProducerUsage, uint64_t inConsumerU
     const uint64_t usage = static_cast<uint64_t>(
             android_convertGralloc1To0Usage(inProducerUsage, inConsumerUsage));
 
+    // A lock for writing needs a writable mapping.
+    const bool writable = (usage & USAGE_SW_WRITE_MASK) == 0 || (getUsage() & USAGE_SW_WRITE_MASK);
+    {
+        std::lock_guard lock(mCachedCpuMappingMutex);
+        if (mCachedCpuMapping && writable && mapCachedCpuMapping() == OK) {
+            return lockCachedCpuMapping(usage, vaddr, fenceFd, outBytesPerPixel,
+                                        outBytesPerStride);
+        }
+    }
+
     auto result = getBufferMapper().lock(handle, usage, rect, base::unique_fd{fenceFd});
 
     if (!result.has_value()) {
@@ -437,9 +459,173 @@ status_t GraphicBuffer::lockAsyncYCbCr(uint32_t inUsage, const Rect& rect,
 
 status_t GraphicBuffer::unlockAsync(int *fenceFd)
 {
+    {
+        std::lock_guard lock(mCachedCpuMappingMutex);
+        if (mCachedCpuMapping && mCachedCpuMapping->lockCount != 0) {
+            return unlockCachedCpuMapping(fenceFd);
+        }
+    }
     return getBufferMapper().unlockAsync(handle, fenceFd);
 }
 
+struct GraphicBuffer::CachedCpuMapping {
+    // Whether the buffer qualifies, once the first lock checked it.
+    std::optional<bool> supported;
+    // The only fd of the handle, which is the dma-buf of the buffer.
+    int fd = -1;
+    void* base = MAP_FAILED;
+    size_t size = 0;
+    size_t planeOffset = 0;
+    int32_t bytesPerPixel = -1;
+    int32_t bytesPerStride = -1;
+    // The number of locks not unlocked yet, which may be concurrent reads.
+    uint32_t lockCount = 0;
+    // The DMA_BUF_SYNC_READ and DMA_BUF_SYNC_WRITE flags of all these locks, ended together by
+    // the last unlock.
+    uint64_t syncFlags = 0;
+};
+
+static status_t syncDmaBuf(int fd, uint64_t flags) {
+    struct dma_buf_sync sync = {.flags = flags};
+    if (TEMP_FAILURE_RETRY(ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync)) != 0) {
+        return -errno;
+    }
+    return OK;
+}
+
+status_t GraphicBuffer::setCpuMappingCached(bool cached) {
+    std::lock_guard lock(mCachedCpuMappingMutex);
+    if (mCachedCpuMapping && mCachedCpuMapping->lockCount != 0) {
+        ALOGE("setCpuMappingCached called while the buffer is locked");
+        return INVALID_OPERATION;
+    }
+    if (!cached) {
+        unmapCachedCpuMapping();
+        mCachedCpuMapping.reset();
+    } else if (!mCachedCpuMapping) {
+        mCachedCpuMapping = std::make_unique<CachedCpuMapping>();
+    }
+    return OK;
+}
+
+status_t GraphicBuffer::mapCachedCpuMapping() {
+    CachedCpuMapping& mapping = *mCachedCpuMapping;
+    if (mapping.supported.has_value()) {
+        return *mapping.supported ? OK : INVALID_OPERATION;
+    }
+    mapping.supported = false;
+
+    const uint64_t cpuUsage = usage & (USAGE_SW_READ_MASK | USAGE_SW_WRITE_MASK);
+    if (getBufferMapperVersion() < GraphicBufferMapper::GRALLOC_4 || !handle ||
+        handle->numFds != 1 || layerCount != 1 || cpuUsage == 0 || (usage & USAGE_PROTECTED)) {
+        return INVALID_OPERATION;
+    }
+
+    ui::Compression compression;
+    if (getBufferMapper().getCompression(handle, &compression) != OK ||
+        compression != ui::Compression::NONE) {
+        return INVALID_OPERATION;
+    }
+    auto planeLayouts = getBufferMapper().getPlaneLayouts(handle);
+    if (!planeLayouts.has_value() || planeLayouts.value().size() != 1) {
+        return INVALID_OPERATION;
+    }
+    const ui::PlaneLayout& planeLayout = planeLayouts.value().front();
+
+    // Mappers may pass other fds with the buffer, e.g. for its metadata, so only a handle with a
+    // single fd whose size, which a dma-buf reports on lseek, is the allocation size known to the
+    // mapper is taken to be the buffer itself. The plane must lie within it.
+    uint64_t allocationSize = 0;
+    if (getBufferMapper().getAllocationSize(handle, &allocationSize) != OK) {
+        return INVALID_OPERATION;
+    }
+    const int fd = handle->data[0];
+    const off_t size = lseek(fd, 0, SEEK_END);
+    if (size <= 0 || static_cast<uint64_t>(size) != allocationSize ||
+        planeLayout.offsetInBytes < 0 || planeLayout.totalSizeInBytes <= 0 ||
+        planeLayout.offsetInBytes + planeLayout.totalSizeInBytes > size) {
+        return INVALID_OPERATION;
+    }
+
+    const int prot = ((usage & USAGE_SW_READ_MASK) ? PROT_READ : 0) |
+            ((usage & USAGE_SW_WRITE_MASK) ? PROT_WRITE : 0);
+    void* base = mmap(nullptr, static_cast<size_t>(size), prot, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        return INVALID_OPERATION;
+    }
+    // Only dma-bufs can be synced.
+    if (syncDmaBuf(fd, DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ) != OK) {
+        munmap(base, static_cast<size_t>(size));
+        return INVALID_OPERATION;
+    }
+    syncDmaBuf(fd, DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ);
+
+    mapping.fd = fd;
+    mapping.base = base;
+    mapping.size = static_cast<size_t>(size);
+    mapping.planeOffset = static_cast<size_t>(planeLayout.offsetInBytes);
+    resolveLegacyByteLayoutFromPlaneLayout(planeLayouts.value(), &mapping.bytesPerPixel,
+                                           &mapping.bytesPerStride);
+    mapping.supported = true;
+    return OK;
+}
+
+status_t GraphicBuffer::lockCachedCpuMapping(uint64_t lockUsage, void** vaddr, int fenceFd,
+                                             int32_t* outBytesPerPixel,
+                                             int32_t* outBytesPerStride) {
+    ATRACE_CALL();
+    CachedCpuMapping& mapping = *mCachedCpuMapping;
+    base::unique_fd fence(fenceFd);
+    if (fence.ok() && sync_wait(fence.get(), -1) != 0) {
+        const status_t status = -errno;
+        ALOGE("Failed to wait for the fence of the lock: %s", strerror(-status));
+        return status;
+    }
+
+    uint64_t flags = 0;
+    if (lockUsage & USAGE_SW_READ_MASK) flags |= DMA_BUF_SYNC_READ;
+    if (lockUsage & USAGE_SW_WRITE_MASK) flags |= DMA_BUF_SYNC_WRITE;
+    if (flags == 0) flags = DMA_BUF_SYNC_RW;
+    if (status_t status = syncDmaBuf(mapping.fd, DMA_BUF_SYNC_START | flags); status != OK) {
+        ALOGE("Failed to sync the buffer for the CPU: %s", strerror(-status));
+        return status;
+    }
+    mapping.lockCount++;
+    mapping.syncFlags |= flags;
+
+    *vaddr = static_cast<uint8_t*>(mapping.base) + mapping.planeOffset;
+    if (outBytesPerPixel) *outBytesPerPixel = mapping.bytesPerPixel;
+    if (outBytesPerStride) *outBytesPerStride = mapping.bytesPerStride;
+    return OK;
+}
+
+status_t GraphicBuffer::unlockCachedCpuMapping(int* fenceFd) {
+    ATRACE_CALL();
+    CachedCpuMapping& mapping = *mCachedCpuMapping;
+    // The sync completes the CPU access, so there is no fence to wait for.
+    if (fenceFd) *fenceFd = -1;
+    if (--mapping.lockCount != 0) return OK;
+    const status_t status = syncDmaBuf(mapping.fd, DMA_BUF_SYNC_END | mapping.syncFlags);
+    mapping.syncFlags = 0;
+    if (status != OK) {
+        ALOGE("Failed to sync the buffer for the device: %s", strerror(-status));
+    }
+    return status;
+}
+
+void GraphicBuffer::unmapCachedCpuMapping() {
+    if (!mCachedCpuMapping) return;
+    CachedCpuMapping& mapping = *mCachedCpuMapping;
+    if (mapping.lockCount != 0) {
+        syncDmaBuf(mapping.fd, DMA_BUF_SYNC_END | mapping.syncFlags);
+    }
+    if (mapping.base != MAP_FAILED) {
+        munmap(mapping.base, mapping.size);
+    }
+    // The next lock checks the new handle, if any.
+    *mCachedCpuMapping = CachedCpuMapping();
+}
+
 status_t GraphicBuffer::isSupported(uint32_t inWidth, uint32_t inHeight, PixelFormat inFormat,
                                     uint32_t inLayerCount, uint64_t inUsage,
                                     bool* outSupported) const {
@@ -590,8 +776,9 @@ status_t GraphicBuffer::unflatten(void const*& buffer, size_t& size, int const*&
 
     if (handle != nullptr) {
         buffer_handle_t importedHandle;
-        status_t err = mBufferMapper.importBuffer(handle, uint32_t(width), uint32_t(height),
-                uint32_t(layerCount), format, usage, uint32_t(stride), &importedHandle);
+        status_t err = mBufferMapper.importBuffer(handle, mId, mGenerationNumber, uint32_t(width),
+                                                  uint32_t(height), uint32_t(layerCount), format,
+                                                  usage, uint32_t(stride), &importedHandle);
         if (err != NO_ERROR) {
             width = height = stride = format = usage_deprecated = 0;
             layerCount = 0;
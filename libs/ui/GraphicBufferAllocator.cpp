@@ -23,6 +23,8 @@
 #include <limits.h>
 #include <stdio.h>
 
+#include <algorithm>
+
 #include <grallocusage/GrallocUsageConversion.h>
 
 #include <android-base/stringprintf.h>
@@ -83,6 +85,98 @@ uint64_t GraphicBufferAllocator::getTotalSize() const {
     return total;
 }
 
+void GraphicBufferAllocator::setRecyclingPoolLimits(size_t maxBytes, nsecs_t ttl) {
+    std::vector<buffer_handle_t> released;
+    {
+        Mutex::Autolock _l(sLock);
+        mPool.maxBytes = maxBytes;
+        mPool.ttl = ttl;
+        trimPoolLocked(maxBytes, systemTime(), &released);
+    }
+    releaseBuffers(released);
+}
+
+void GraphicBufferAllocator::trimRecyclingPool() {
+    std::vector<buffer_handle_t> released;
+    {
+        Mutex::Autolock _l(sLock);
+        trimPoolLocked(mPool.maxBytes, systemTime(), &released);
+    }
+    releaseBuffers(released);
+}
+
+buffer_handle_t GraphicBufferAllocator::takeFromPoolLocked(const AllocationRequest& request,
+                                                           uint32_t* outStride) {
+    for (auto it = mPool.buffers.rbegin(); it != mPool.buffers.rend(); ++it) {
+        alloc_rec_t& rec = sAllocList.editValueFor(it->handle);
+        if (rec.width != request.width || rec.height != request.height ||
+            rec.format != request.format || rec.layerCount != request.layerCount ||
+            rec.usage != request.usage) {
+            continue;
+        }
+
+        const buffer_handle_t handle = it->handle;
+        rec.pooled = false;
+        rec.requestorName = request.requestorName;
+        *outStride = rec.stride;
+        mPool.bytes -= rec.size;
+        mPool.hits++;
+        mPool.buffers.erase(std::next(it).base());
+        return handle;
+    }
+
+    mPool.misses++;
+    return nullptr;
+}
+
+bool GraphicBufferAllocator::addToPoolLocked(buffer_handle_t handle,
+                                             std::vector<buffer_handle_t>* outReleased) {
+    const ssize_t index = sAllocList.indexOfKey(handle);
+    if (mPool.maxBytes == 0 || index < 0) {
+        return false;
+    }
+    alloc_rec_t& rec = sAllocList.editValueAt(index);
+    if (!rec.recyclable || rec.size > mPool.maxBytes) {
+        return false;
+    }
+
+    const nsecs_t now = systemTime();
+    rec.pooled = true;
+    mPool.buffers.push_back({handle, now});
+    mPool.bytes += rec.size;
+    mPool.peakBytes = std::max(mPool.peakBytes, mPool.bytes);
+    trimPoolLocked(mPool.maxBytes, now, outReleased);
+    return true;
+}
+
+void GraphicBufferAllocator::trimPoolLocked(size_t maxBytes, nsecs_t now,
+                                            std::vector<buffer_handle_t>* outReleased) {
+    while (!mPool.buffers.empty()) {
+        const PooledBuffer& oldest = mPool.buffers.front();
+        const bool expired = now - oldest.freeTime > mPool.ttl;
+        if (!expired && maxBytes > 0 && mPool.bytes <= maxBytes) {
+            break;
+        }
+
+        if (expired) {
+            mPool.expirations++;
+        } else {
+            mPool.evictions++;
+        }
+        const ssize_t index = sAllocList.indexOfKey(oldest.handle);
+        mPool.bytes -= sAllocList.valueAt(index).size;
+        sAllocList.removeItemsAt(index);
+        outReleased->push_back(oldest.handle);
+        mPool.buffers.pop_front();
+    }
+}
+
+void GraphicBufferAllocator::releaseBuffers(const std::vector<buffer_handle_t>& handles) {
+    for (buffer_handle_t handle : handles) {
+        mMapper.freeBuffer(handle);
+    }
+}
+
 void GraphicBufferAllocator::dump(std::string& result, bool less) const {
     Mutex::Autolock _l(sLock);
     KeyedVector<buffer_handle_t, alloc_rec_t>& list(sAllocList);
@@ -96,13 +190,24 @@ void GraphicBufferAllocator::dump(std::string& result, bool less) const {
         std::string sizeStr = (rec.size)
                 ? base::StringPrintf("%7.2f KiB", static_cast<double>(rec.size) / 1024.0)
                 : "unknown";
-        StringAppendF(&result, "%14p | %11s | %4u (%4u) x %4u | %6u | %8X | 0x%8" PRIx64 " | %s\n",
+        StringAppendF(&result, "%14p | %11s | %4u (%4u) x %4u | %6u | %8X | 0x%8" PRIx64 " | %s%s\n",
                       list.keyAt(i), sizeStr.c_str(), rec.width, rec.stride, rec.height,
-                      rec.layerCount, rec.format, rec.usage, rec.requestorName.c_str());
+                      rec.layerCount, rec.format, rec.usage, rec.requestorName.c_str(),
+                      rec.pooled ? " (pooled)" : "");
         total += rec.size;
     }
     StringAppendF(&result, "Total allocated by GraphicBufferAllocator (estimate): %.2f KB\n",
                   static_cast<double>(total) / 1024.0);
+    if (mPool.maxBytes > 0 || mPool.hits > 0 || mPool.misses > 0) {
+        StringAppendF(&result,
+                      "Recycling pool: %zu buffers, %.2f KB (peak %.2f KB) of %.2f KB, ttl %" PRId64
+                      " ms, %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " evictions, %" PRIu64
+                      " expirations\n",
+                      mPool.buffers.size(), static_cast<double>(mPool.bytes) / 1024.0,
+                      static_cast<double>(mPool.peakBytes) / 1024.0,
+                      static_cast<double>(mPool.maxBytes) / 1024.0, ns2ms(mPool.ttl), mPool.hits,
+                      mPool.misses, mPool.evictions, mPool.expirations);
+    }
 
     result.append(mAllocator->dumpDebugInfo(less));
 }
@@ -134,6 +239,27 @@ auto GraphicBufferAllocator::allocate(const AllocationRequest& request) -> Alloc
         return AllocationResult(BAD_VALUE);
     }
 
+    // Buffers allocated with additional options are not recycled, since the pool does not know
+    // what the options do.
+    const bool recyclable = request.recyclable && request.importBuffer && request.extras.empty();
+    if (recyclable) {
+        std::vector<buffer_handle_t> released;
+        buffer_handle_t handle = nullptr;
+        uint32_t stride = 0;
+        {
+            Mutex::Autolock _l(sLock);
+            if (mPool.maxBytes > 0) {
+                trimPoolLocked(mPool.maxBytes, systemTime(), &released);
+                handle = takeFromPoolLocked(request, &stride);
+            }
+        }
+        releaseBuffers(released);
+        if (handle) {
+            ATRACE_NAME("recycled");
+            return AllocationResult(handle, stride);
+        }
+    }
+
     auto result = mAllocator->allocate(request);
     if (result.status == UNKNOWN_TRANSACTION) {
         if (!request.extras.empty()) {
@@ -181,6 +307,7 @@ auto GraphicBufferAllocator::allocate(const AllocationRequest& request) -> Alloc
     rec.usage = request.usage;
     rec.size = bufSize;
     rec.requestorName = request.requestorName;
+    rec.recyclable = recyclable;
     list.add(result.handle, rec);
 
     return result;
@@ -280,6 +407,17 @@ status_t GraphicBufferAllocator::free(buffer_handle_t handle)
 {
     ATRACE_CALL();
 
+    std::vector<buffer_handle_t> released;
+    bool pooled;
+    {
+        Mutex::Autolock _l(sLock);
+        pooled = addToPoolLocked(handle, &released);
+    }
+    releaseBuffers(released);
+    if (pooled) {
+        return NO_ERROR;
+    }
+
     // We allocated a buffer from the allocator and imported it into the
     // mapper to get the handle.  We just need to free the handle now.
     mMapper.freeBuffer(handle);
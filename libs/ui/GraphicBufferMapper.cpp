@@ -20,6 +20,8 @@
 
 #include <ui/GraphicBufferMapper.h>
 
+#include <sys/stat.h>
+
 #include <grallocusage/GrallocUsageConversion.h>
 
 // We would eliminate the non-conforming zero-length array, but we can't since
@@ -39,6 +41,7 @@
 #include <ui/Gralloc5.h>
 #include <ui/GraphicBuffer.h>
 
+#include <android-base/stringprintf.h>
 #include <system/graphics.h>
 
 using unique_fd = ::android::base::unique_fd;
@@ -119,6 +122,98 @@ status_t GraphicBufferMapper::importBuffer(const native_handle_t* rawHandle, uin
     return NO_ERROR;
 }
 
+status_t GraphicBufferMapper::importBuffer(const native_handle_t* rawHandle, uint64_t bufferId,
+                                           uint32_t generation, uint32_t width, uint32_t height,
+                                           uint32_t layerCount, PixelFormat format, uint64_t usage,
+                                           uint32_t stride, buffer_handle_t* outHandle) {
+    const ImportKey key{bufferId, generation};
+    std::vector<uint64_t> identity;
+    {
+        std::lock_guard lock(mImportCacheMutex);
+        mImportStats.imports++;
+        if (!mImportCacheEnabled || !getBufferIdentity(rawHandle, &identity)) {
+            identity.clear();
+        } else if (const auto it = mImportCache.find(key); it != mImportCache.end()) {
+            CachedImport& cached = it->second;
+            if (cached.identity == identity && cached.width == width && cached.height == height &&
+                cached.layerCount == layerCount && cached.format == format &&
+                cached.usage == usage && cached.stride == stride) {
+                ATRACE_NAME("importBuffer (cached)");
+                cached.references++;
+                mImportStats.cacheHits++;
+                *outHandle = cached.handle;
+                return NO_ERROR;
+            }
+            // Leave the cached buffer be, and import this one without caching it.
+            mImportStats.cacheMismatches++;
+            identity.clear();
+        }
+    }
+
+    status_t error = importBuffer(rawHandle, width, height, layerCount, format, usage, stride,
+                                  outHandle);
+    if (error != NO_ERROR || identity.empty()) {
+        return error;
+    }
+
+    std::lock_guard lock(mImportCacheMutex);
+    // Another thread may have cached the same buffer in the meantime, in which case this handle is
+    // not shared.
+    const auto [it, inserted] =
+            mImportCache.try_emplace(key,
+                                     CachedImport{*outHandle, std::move(identity), width, height,
+                                                  layerCount, format, usage, stride, 1});
+    if (inserted) {
+        mCachedHandles.emplace(*outHandle, key);
+    }
+    return NO_ERROR;
+}
+
+bool GraphicBufferMapper::getBufferIdentity(const native_handle_t* rawHandle,
+                                            std::vector<uint64_t>* outIdentity) {
+    if (rawHandle->numFds < 1) {
+        return false;
+    }
+
+    outIdentity->reserve(2 * rawHandle->numFds + rawHandle->numInts);
+    for (int i = 0; i < rawHandle->numFds; i++) {
+        struct stat st;
+        if (fstat(rawHandle->data[i], &st) != 0) {
+            return false;
+        }
+        outIdentity->push_back(static_cast<uint64_t>(st.st_dev));
+        outIdentity->push_back(static_cast<uint64_t>(st.st_ino));
+    }
+    for (int i = 0; i < rawHandle->numInts; i++) {
+        outIdentity->push_back(static_cast<uint32_t>(rawHandle->data[rawHandle->numFds + i]));
+    }
+    return true;
+}
+
+void GraphicBufferMapper::setImportCacheEnabled(bool enabled) {
+    std::lock_guard lock(mImportCacheMutex);
+    mImportCacheEnabled = enabled;
+}
+
+auto GraphicBufferMapper::getImportStats() const -> ImportStats {
+    std::lock_guard lock(mImportCacheMutex);
+    ImportStats stats = mImportStats;
+    stats.cachedBuffers = mImportCache.size();
+    for (const auto& [_, cached] : mImportCache) {
+        stats.cachedReferences += cached.references;
+    }
+    return stats;
+}
+
+void GraphicBufferMapper::dumpImportStats(std::string& result) const {
+    const ImportStats stats = getImportStats();
+    base::StringAppendF(&result,
+                        "GraphicBufferMapper imports: %" PRIu64 " (%" PRIu64 " cache hits, %" PRIu64
+                        " mismatches), %zu cached buffers with %zu references\n",
+                        stats.imports, stats.cacheHits, stats.cacheMismatches, stats.cachedBuffers,
+                        stats.cachedReferences);
+}
+
 status_t GraphicBufferMapper::importBufferNoValidate(const native_handle_t* rawHandle,
                                                      buffer_handle_t* outHandle) {
     return mMapper->importBuffer(rawHandle, outHandle);
@@ -134,6 +229,18 @@ status_t GraphicBufferMapper::freeBuffer(buffer_handle_t handle)
 {
     ATRACE_CALL();
 
+    {
+        std::lock_guard lock(mImportCacheMutex);
+        if (const auto it = mCachedHandles.find(handle); it != mCachedHandles.end()) {
+            const auto cached = mImportCache.find(it->second);
+            if (--cached->second.references > 0) {
+                return NO_ERROR;
+            }
+            mImportCache.erase(cached);
+            mCachedHandles.erase(it);
+        }
+    }
+
     mMapper->freeBuffer(handle);
 
     return NO_ERROR;
@@ -325,6 +432,11 @@ ui::Result<std::vector<ui::PlaneLayout>> GraphicBufferMapper::getPlaneLayouts(
     }
 }
 
+status_t GraphicBufferMapper::getBufferMetadata(buffer_handle_t bufferHandle,
+                                                BufferMetadata* outMetadata) {
+    return mMapper->getBufferMetadata(bufferHandle, outMetadata);
+}
+
 status_t GraphicBufferMapper::getDataspace(buffer_handle_t bufferHandle,
                                            ui::Dataspace* outDataspace) {
     return mMapper->getDataspace(bufferHandle, outDataspace);
@@ -19,6 +19,14 @@
 #include <inttypes.h>
 #include <limits.h>
 
+#include <algorithm>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <android-base/stringprintf.h>
 
 #include <utils/Log.h>
@@ -57,6 +65,142 @@ enum {
     op_xor  = region_operator<Rect>::op_xor
 };
 
+// The vectorized helpers below load a Rect as four int32 lanes: left, top, right, bottom.
+static_assert(sizeof(Rect) == 4 * sizeof(int32_t));
+
+static inline bool contains(const Rect& outer, const Rect& inner) {
+    return outer.left <= inner.left && outer.top <= inner.top &&
+            outer.right >= inner.right && outer.bottom >= inner.bottom;
+}
+
+// Computes the operations between a region and a rect whose result is known without sweeping
+// through the rects of the region: nothing, a single rect or one of the operands. This covers
+// most of the operations done with the rects of layers and displays. Returns false if the region
+// needs to be swept.
+static inline bool trivial_boolean_operation(uint32_t op, Region& dst, const Region& lhs,
+                                             const Rect& rect) {
+    // dst may be lhs, and rect may belong to either of them.
+    const Rect rhs(rect);
+    const Rect bounds = lhs.getBounds();
+    const bool lhsEmpty = bounds.isEmpty();
+    const bool rhsEmpty = rhs.isEmpty();
+    Rect overlap;
+    switch (op) {
+        case op_and:
+            if (lhsEmpty || rhsEmpty || !bounds.intersect(rhs, &overlap)) {
+                dst.clear();
+            } else if (contains(rhs, bounds)) {
+                dst = lhs;
+            } else if (lhs.isRect()) {
+                dst.set(overlap);
+            } else {
+                return false;
+            }
+            return true;
+        case op_or:
+            if (rhsEmpty) {
+                if (lhsEmpty) {
+                    dst.clear();
+                } else {
+                    dst = lhs;
+                }
+            } else if (lhsEmpty || contains(rhs, bounds)) {
+                dst.set(rhs);
+            } else if (!lhs.isRect()) {
+                return false;
+            } else if (contains(bounds, rhs)) {
+                dst = lhs;
+            } else if (bounds.left == rhs.left && bounds.right == rhs.right &&
+                       bounds.top <= rhs.bottom && rhs.top <= bounds.bottom) {
+                dst.set(Rect(bounds.left, std::min(bounds.top, rhs.top), bounds.right,
+                             std::max(bounds.bottom, rhs.bottom)));
+            } else if (bounds.top == rhs.top && bounds.bottom == rhs.bottom &&
+                       bounds.left <= rhs.right && rhs.left <= bounds.right) {
+                dst.set(Rect(std::min(bounds.left, rhs.left), bounds.top,
+                             std::max(bounds.right, rhs.right), bounds.bottom));
+            } else {
+                return false;
+            }
+            return true;
+        case op_nand:
+            if (lhsEmpty || contains(rhs, bounds)) {
+                dst.clear();
+            } else if (rhsEmpty || !bounds.intersect(rhs, &overlap)) {
+                dst = lhs;
+            } else {
+                return false;
+            }
+            return true;
+        case op_xor:
+            if (rhsEmpty) {
+                if (lhsEmpty) {
+                    dst.clear();
+                } else {
+                    dst = lhs;
+                }
+            } else if (lhsEmpty) {
+                dst.set(rhs);
+            } else {
+                return false;
+            }
+            return true;
+    }
+    return false;
+}
+
+// Returns whether each of the count rects of both spans has the same left and right edges.
+static inline bool same_columns(const Rect* p, const Rect* q, size_t count) {
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    // Only the lanes of the left and right edges have to compare equal.
+    const uint32x4_t rows = {0, ~0u, 0, ~0u};
+    for (; count; count--, p++, q++) {
+        const uint32x4_t equal = vceqq_s32(vld1q_s32(&p->left), vld1q_s32(&q->left));
+        if (vminvq_u32(vorrq_u32(equal, rows)) == 0) {
+            return false;
+        }
+    }
+    return true;
+#elif defined(__SSE2__)
+    // Only the bytes of the left and right edges have to compare equal.
+    constexpr int kColumns = 0x0f0f;
+    for (; count; count--, p++, q++) {
+        const __m128i equal =
+                _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+                                _mm_loadu_si128(reinterpret_cast<const __m128i*>(q)));
+        if ((_mm_movemask_epi8(equal) & kColumns) != kColumns) {
+            return false;
+        }
+    }
+    return true;
+#else
+    for (; count; count--, p++, q++) {
+        if ((p->left != q->left) || (p->right != q->right)) {
+            return false;
+        }
+    }
+    return true;
+#endif
+}
+
+static inline void offset_rects(Rect* rects, size_t count, int dx, int dy) {
+#if defined(__ARM_NEON)
+    const int32x4_t offset = {dx, dy, dx, dy};
+    for (; count; count--, rects++) {
+        vst1q_s32(&rects->left, vaddq_s32(vld1q_s32(&rects->left), offset));
+    }
+#elif defined(__SSE2__)
+    const __m128i offset = _mm_setr_epi32(dx, dy, dx, dy);
+    for (; count; count--, rects++) {
+        __m128i* const rect = reinterpret_cast<__m128i*>(rects);
+        _mm_storeu_si128(rect, _mm_add_epi32(_mm_loadu_si128(rect), offset));
+    }
+#else
+    for (; count; count--, rects++) {
+        rects->offsetBy(dx, dy);
+    }
+#endif
+}
+
 enum {
     direction_LTR,
     direction_RTL
@@ -329,6 +473,11 @@ Region& Region::subtractSelf(const Rect& r) {
     return operationSelf(r, op_nand);
 }
 Region& Region::operationSelf(const Rect& r, uint32_t op) {
+#if !VALIDATE_WITH_CORECG && !defined(VALIDATE_REGIONS)
+    if (r.isValid() && trivial_boolean_operation(op, *this, *this, r)) {
+        return *this;
+    }
+#endif
     Region lhs(*this);
     boolean_operation(op, *this, lhs, r);
     return *this;
@@ -353,6 +502,11 @@ Region& Region::subtractSelf(const Region& rhs) {
     return operationSelf(rhs, op_nand);
 }
 Region& Region::operationSelf(const Region& rhs, uint32_t op) {
+#if !VALIDATE_WITH_CORECG && !defined(VALIDATE_REGIONS)
+    if (rhs.isRect() && trivial_boolean_operation(op, *this, *this, rhs.getBounds())) {
+        return *this;
+    }
+#endif
     Region lhs(*this);
     boolean_operation(op, *this, lhs, rhs);
     return *this;
@@ -535,15 +689,7 @@ void Region::rasterizer::flushSpan()
         Rect const* p = span.data();
         Rect const* q = head;
         if (p->top == q->bottom) {
-            merge = true;
-            while (q != tail) {
-                if ((p->left != q->left) || (p->right != q->right)) {
-                    merge = false;
-                    break;
-                }
-                p++;
-                q++;
-            }
+            merge = same_columns(p, q, span.size());
         }
     }
     if (merge) {
@@ -653,6 +799,20 @@ void Region::boolean_operation(uint32_t op, Region& dst,
     validate(dst, "boolean_operation (before): dst");
 #endif
 
+#if !VALIDATE_WITH_CORECG && !defined(VALIDATE_REGIONS)
+    if (rhs.isRect()) {
+        Rect rect(rhs.getBounds());
+        rect.offsetBy(dx, dy);
+        if (trivial_boolean_operation(op, dst, lhs, rect)) {
+            return;
+        }
+    } else if (lhs.isRect() && !(dx | dy) && (op == op_and || op == op_or)) {
+        if (trivial_boolean_operation(op, dst, rhs, lhs.getBounds())) {
+            return;
+        }
+    }
+#endif
+
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
@@ -767,6 +927,12 @@ void Region::boolean_operation(uint32_t op, Region& dst,
 #if VALIDATE_WITH_CORECG || defined(VALIDATE_REGIONS)
     boolean_operation(op, dst, lhs, Region(rhs), dx, dy);
 #else
+    Rect rect(rhs);
+    rect.offsetBy(dx, dy);
+    if (trivial_boolean_operation(op, dst, lhs, rect)) {
+        return;
+    }
+
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
@@ -799,13 +965,7 @@ void Region::translate(Region& reg, int dx, int dy)
 #if defined(VALIDATE_REGIONS)
         validate(reg, "translate (before)");
 #endif
-        size_t count = reg.mStorage.size();
-        Rect* rects = reg.mStorage.data();
-        while (count) {
-            rects->offsetBy(dx, dy);
-            rects++;
-            count--;
-        }
+        offset_rects(reg.mStorage.data(), reg.mStorage.size(), dx, dy);
 #if defined(VALIDATE_REGIONS)
         validate(reg, "translate (after)");
 #endif
@@ -21,6 +21,7 @@
 
 #include <android-base/stringprintf.h>
 #include <cutils/compiler.h>
+#include <ui/FatVector.h>
 #include <ui/Region.h>
 #include <ui/Transform.h>
 #include <utils/String8.h>
@@ -251,8 +252,24 @@ Rect Transform::makeBounds(int w, int h) const {
     return transform( Rect(w, h) );
 }
 
-Rect Transform::transform(const Rect& bounds, bool roundOutwards) const {
+// The rect of the bounds of the mapped corners of a rect, rounded as transform(const Rect&).
+static Rect roundBounds(float left, float top, float right, float bottom, bool roundOutwards) {
     Rect r;
+    if (roundOutwards) {
+        r.left   = static_cast<int32_t>(floorf(left));
+        r.top    = static_cast<int32_t>(floorf(top));
+        r.right  = static_cast<int32_t>(ceilf(right));
+        r.bottom = static_cast<int32_t>(ceilf(bottom));
+    } else {
+        r.left   = static_cast<int32_t>(floorf(left + 0.5f));
+        r.top    = static_cast<int32_t>(floorf(top + 0.5f));
+        r.right  = static_cast<int32_t>(floorf(right + 0.5f));
+        r.bottom = static_cast<int32_t>(floorf(bottom + 0.5f));
+    }
+    return r;
+}
+
+Rect Transform::transform(const Rect& bounds, bool roundOutwards) const {
     vec2 lt( bounds.left,  bounds.top    );
     vec2 rt( bounds.right, bounds.top    );
     vec2 lb( bounds.left,  bounds.bottom );
@@ -263,19 +280,62 @@ Rect Transform::transform(const Rect& bounds, bool roundOutwards) const {
     lb = transform(lb);
     rb = transform(rb);
 
-    if (roundOutwards) {
-        r.left   = static_cast<int32_t>(floorf(std::min({lt[0], rt[0], lb[0], rb[0]})));
-        r.top    = static_cast<int32_t>(floorf(std::min({lt[1], rt[1], lb[1], rb[1]})));
-        r.right  = static_cast<int32_t>(ceilf(std::max({lt[0], rt[0], lb[0], rb[0]})));
-        r.bottom = static_cast<int32_t>(ceilf(std::max({lt[1], rt[1], lb[1], rb[1]})));
-    } else {
-        r.left   = static_cast<int32_t>(floorf(std::min({lt[0], rt[0], lb[0], rb[0]}) + 0.5f));
-        r.top    = static_cast<int32_t>(floorf(std::min({lt[1], rt[1], lb[1], rb[1]}) + 0.5f));
-        r.right  = static_cast<int32_t>(floorf(std::max({lt[0], rt[0], lb[0], rb[0]}) + 0.5f));
-        r.bottom = static_cast<int32_t>(floorf(std::max({lt[1], rt[1], lb[1], rb[1]}) + 0.5f));
+    return roundBounds(std::min({lt[0], rt[0], lb[0], rb[0]}),
+                       std::min({lt[1], rt[1], lb[1], rb[1]}),
+                       std::max({lt[0], rt[0], lb[0], rb[0]}),
+                       std::max({lt[1], rt[1], lb[1], rb[1]}), roundOutwards);
+}
+
+void Transform::transform(const vec2* src, vec2* dst, size_t count) const {
+    const mat33& M(mMatrix);
+    const float a = M[0][0], b = M[1][0], x = M[2][0];
+    const float c = M[0][1], d = M[1][1], y = M[2][1];
+    for (size_t i = 0; i < count; i++) {
+        const vec2 v = src[i];
+        dst[i] = vec2(a*v[0] + b*v[1] + x, c*v[0] + d*v[1] + y);
     }
+}
 
-    return r;
+// Maps rects with a transform which preserves them: the x of the mapped corners is sx times their
+// x, or their y when rotated by 90 degrees, plus tx, since the other coefficient is zero. The
+// bounds of the mapped corners are then the ones of 2 opposite corners.
+template <bool kRotated, bool kRoundOutwards>
+static void mapRects(const Rect* src, Rect* dst, size_t count, float sx, float sy, float tx,
+                     float ty) {
+    for (size_t i = 0; i < count; i++) {
+        const Rect& r = src[i];
+        const float x0 = sx * static_cast<float>(kRotated ? r.top : r.left) + tx;
+        const float x1 = sx * static_cast<float>(kRotated ? r.bottom : r.right) + tx;
+        const float y0 = sy * static_cast<float>(kRotated ? r.left : r.top) + ty;
+        const float y1 = sy * static_cast<float>(kRotated ? r.right : r.bottom) + ty;
+        dst[i] = roundBounds(std::min(x0, x1), std::min(y0, y1), std::max(x0, x1),
+                             std::max(y0, y1), kRoundOutwards);
+    }
+}
+
+void Transform::transform(const Rect* src, Rect* dst, size_t count, bool roundOutwards) const {
+    // The coefficients are compared to zero exactly rather than with the tolerance of the type, so
+    // that the rects map to the same bounds as with transform(const Rect&).
+    const mat33& M(mMatrix);
+    const float tx = M[2][0];
+    const float ty = M[2][1];
+    if (M[1][0] == 0.0f && M[0][1] == 0.0f) {
+        if (roundOutwards) {
+            mapRects<false, true>(src, dst, count, M[0][0], M[1][1], tx, ty);
+        } else {
+            mapRects<false, false>(src, dst, count, M[0][0], M[1][1], tx, ty);
+        }
+    } else if (M[0][0] == 0.0f && M[1][1] == 0.0f) {
+        if (roundOutwards) {
+            mapRects<true, true>(src, dst, count, M[1][0], M[0][1], tx, ty);
+        } else {
+            mapRects<true, false>(src, dst, count, M[1][0], M[0][1], tx, ty);
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            dst[i] = transform(src[i], roundOutwards);
+        }
+    }
 }
 
 FloatRect Transform::transform(const FloatRect& bounds) const {
@@ -302,10 +362,12 @@ Region Transform::transform(const Region& reg) const {
     Region out;
     if (CC_UNLIKELY(type() > TRANSLATE)) {
         if (CC_LIKELY(preserveRects())) {
-            Region::const_iterator it = reg.begin();
-            Region::const_iterator const end = reg.end();
-            while (it != end) {
-                out.orSelf(transform(*it++));
+            size_t count;
+            const Rect* rects = reg.getArray(&count);
+            FatVector<Rect> mapped(count);
+            transform(rects, mapped.data(), count);
+            for (const Rect& rect : mapped) {
+                out.orSelf(rect);
             }
         } else {
             out.set(transform(reg.bounds()));
@@ -17,24 +17,31 @@
 #ifndef ANDROID_FENCE_TIME_H
 #define ANDROID_FENCE_TIME_H
 
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
 #include <ui/Fence.h>
 #include <utils/Flattenable.h>
 #include <utils/Mutex.h>
+#include <utils/Singleton.h>
 #include <utils/Timers.h>
 
 #include <atomic>
+#include <deque>
 #include <mutex>
 #include <queue>
 #include <unordered_map>
+#include <vector>
 
 namespace android {
 
+class FenceResolver;
 class FenceToFenceTimeMap;
 
 // A wrapper around fence that only implements isValid and getSignalTime.
 // It automatically closes the fence in a thread-safe manner once the signal
 // time is known.
 class FenceTime {
+friend class FenceResolver;
 friend class FenceToFenceTimeMap;
 public:
     // An atomic snapshot of the FenceTime that is flattenable.
@@ -109,6 +116,11 @@ public:
     // Gets the cached timestamp without attempting to query the Fence.
     nsecs_t getCachedSignalTime() const;
 
+    // Resolves the signal times of several FenceTimes at once: a single poll() finds the fences
+    // which have signaled, and only their timestamps are queried. Fences which are still pending
+    // cost no further syscall.
+    static void resolveSignalTimes(const std::vector<std::shared_ptr<FenceTime>>& fences);
+
     // Returns a snapshot of the FenceTime in its current state.
     Snapshot getSnapshot() const;
 
@@ -126,6 +138,9 @@ private:
     // never return SIGNAL_TIME_INVALID and isValid will always return true.
     FenceTime(const sp<Fence>& fence, bool forceValidForTest);
 
+    // Returns the fence if the signal time is still pending, or nullptr.
+    sp<Fence> getPendingFence() const;
+
     enum class State {
         VALID,
         INVALID,
@@ -165,11 +180,44 @@ public:
     static constexpr size_t MAX_ENTRIES = 64;
 
     void push(const std::shared_ptr<FenceTime>& fence);
+
+    // Resolves the signal times of all of the queued fences with FenceTime::resolveSignalTimes,
+    // and drops the leading ones which have signaled.
     void updateSignalTimes();
 
 private:
     mutable std::mutex mMutex;
-    std::queue<std::weak_ptr<FenceTime>> mQueue GUARDED_BY(mMutex);
+    std::deque<std::weak_ptr<FenceTime>> mQueue GUARDED_BY(mMutex);
+};
+
+// Resolves the signal times of FenceTimes on a background thread, which waits on all of their
+// fences at once, so that later calls to FenceTime::getSignalTime return the cached time rather
+// than query the fence again. This lets the different users of the same FenceTime, e.g. the
+// FrameEventHistory, TimeStats and FrameTimeline of SurfaceFlinger, find the time already
+// resolved.
+//
+// Like FenceTimeline, FenceResolver only keeps weak references to a limited number of FenceTimes,
+// so users of FenceTime must make sure they can work even if FenceResolver did nothing.
+class FenceResolver : public Singleton<FenceResolver> {
+public:
+    static constexpr size_t MAX_ENTRIES = 256;
+
+    // Resolves the signal time of the fence once it signals.
+    void track(const std::shared_ptr<FenceTime>& fence);
+
+private:
+    friend class Singleton<FenceResolver>;
+
+    FenceResolver();
+
+    void threadMain();
+
+    // An eventfd which wakes up the thread when fences are tracked.
+    const base::unique_fd mWakeFd;
+
+    std::mutex mMutex;
+    std::deque<std::weak_ptr<FenceTime>> mFences GUARDED_BY(mMutex);
+    bool mWakePending GUARDED_BY(mMutex) = false;
 };
 
 // Used by test code to create or get FenceTimes for a given Fence.
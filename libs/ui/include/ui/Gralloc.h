@@ -24,6 +24,7 @@
 #include <ui/Rect.h>
 #include <utils/StrongPointer.h>
 #include "GraphicBufferAllocator.h"
+#include "GraphicBufferMapper.h"
 
 #include <string>
 
@@ -155,6 +156,9 @@ public:
                                      std::vector<ui::PlaneLayout>* /*outPlaneLayouts*/) const {
         return INVALID_OPERATION;
     }
+    // Gets the immutable metadata through the getters above, by default.
+    virtual status_t getBufferMetadata(buffer_handle_t bufferHandle,
+                                       GraphicBufferMapper::BufferMetadata* outMetadata) const;
     virtual status_t getDataspace(buffer_handle_t /*bufferHandle*/,
                                   ui::Dataspace* /*outDataspace*/) const {
         return INVALID_OPERATION;
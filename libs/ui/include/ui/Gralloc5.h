@@ -17,9 +17,15 @@
 #pragma once
 
 #include <aidl/android/hardware/graphics/allocator/IAllocator.h>
+#include <aidl/android/hardware/graphics/common/StandardMetadataType.h>
+#include <android-base/thread_annotations.h>
 #include <android/hardware/graphics/mapper/IMapper.h>
 #include <ui/Gralloc.h>
 
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
 namespace android {
 
 class Gralloc5Mapper : public GrallocMapper {
@@ -119,6 +125,10 @@ public:
             buffer_handle_t bufferHandle,
             std::vector<ui::PlaneLayout> *outPlaneLayouts) const override;
 
+    [[nodiscard]] status_t getBufferMetadata(
+            buffer_handle_t bufferHandle,
+            GraphicBufferMapper::BufferMetadata *outMetadata) const override;
+
     [[nodiscard]] status_t getDataspace(buffer_handle_t bufferHandle,
                                         ui::Dataspace *outDataspace) const override;
 
@@ -159,7 +169,20 @@ public:
 private:
     void unlockBlocking(buffer_handle_t bufferHandle) const;
 
+    // The immutable metadata of a buffer imported through this mapper, until it is freed.
+    struct CachedMetadata;
+
+    std::shared_ptr<CachedMetadata> findCachedMetadata(buffer_handle_t bufferHandle) const;
+
+    // Gets the metadata from the cache if it is immutable, or through the mapper.
+    template <aidl::android::hardware::graphics::common::StandardMetadataType T>
+    auto getMetadata(buffer_handle_t bufferHandle) const;
+
     AIMapper *mMapper = nullptr;
+
+    mutable std::mutex mMetadataCacheMutex;
+    mutable std::unordered_map<buffer_handle_t, std::shared_ptr<CachedMetadata>> mMetadataCache
+            GUARDED_BY(mMetadataCacheMutex);
 };
 
 class Gralloc5Allocator : public GrallocAllocator {
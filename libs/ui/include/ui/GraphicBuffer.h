@@ -20,10 +20,13 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <android-base/thread_annotations.h>
 #include <android/hardware_buffer.h>
 #include <ui/ANativeObjectBase.h>
 #include <ui/GraphicBufferAllocator.h>
@@ -209,6 +212,14 @@ public:
             android_ycbcr *ycbcr, int fenceFd);
     status_t unlockAsync(int *fenceFd);
 
+    // Keeps the CPU mapping of the buffer from one lock to the next, rather than mapping it through
+    // the mapper for each lock, and only syncs the CPU caches with the buffer when it is locked and
+    // unlocked. This only applies to single-plane, uncompressed and unprotected dma-buf buffers
+    // with CPU usage, and only to lock() and lockAsync(): other buffers and locks still go through
+    // the mapper. The mapping is released when the buffer is freed, or when caching is disabled.
+    // Must not be called while the buffer is locked.
+    status_t setCpuMappingCached(bool cached);
+
     status_t isSupported(uint32_t inWidth, uint32_t inHeight, PixelFormat inFormat,
                          uint32_t inLayerCount, uint64_t inUsage, bool* outSupported) const;
 
@@ -265,6 +276,14 @@ private:
 
     void free_handle();
 
+    struct CachedCpuMapping;
+    status_t mapCachedCpuMapping() REQUIRES(mCachedCpuMappingMutex);
+    status_t lockCachedCpuMapping(uint64_t lockUsage, void** vaddr, int fenceFd,
+                                  int32_t* outBytesPerPixel, int32_t* outBytesPerStride)
+            REQUIRES(mCachedCpuMappingMutex);
+    status_t unlockCachedCpuMapping(int* fenceFd) REQUIRES(mCachedCpuMappingMutex);
+    void unmapCachedCpuMapping() REQUIRES(mCachedCpuMappingMutex);
+
     GraphicBufferMapper& mBufferMapper;
     ssize_t mInitCheck;
 
@@ -295,6 +314,10 @@ private:
     // and informs SurfaceFlinger that it should drop its strong pointer reference to the buffer.
     std::vector<std::pair<GraphicBufferDeathCallback, void* /*mDeathCallbackContext*/>>
             mDeathCallbacks;
+
+    // Set by setCpuMappingCached(). The mutex also serializes concurrent locks of the mapping.
+    std::mutex mCachedCpuMappingMutex;
+    std::unique_ptr<CachedCpuMapping> mCachedCpuMapping GUARDED_BY(mCachedCpuMappingMutex);
 };
 
 }; // namespace android
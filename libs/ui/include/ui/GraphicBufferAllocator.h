@@ -20,6 +20,7 @@
 
 #include <stdint.h>
 
+#include <deque>
 #include <memory>
 #include <string>
 #include <vector>
@@ -32,6 +33,7 @@
 #include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
 #include <utils/Singleton.h>
+#include <utils/Timers.h>
 
 namespace android {
 
@@ -57,6 +59,11 @@ public:
         uint64_t usage;
         std::string requestorName;
         std::vector<AdditionalOptions> extras;
+        // Whether the buffer may be kept in the recycling pool once it is freed, and handed out
+        // again for a later recyclable request with the same dimensions, format and usage. Only
+        // set this for buffers which never leave the process, since a recycled buffer keeps its
+        // contents and is shared with whoever still holds the previous handle.
+        bool recyclable = false;
     };
 
     struct AllocationResult {
@@ -104,6 +111,20 @@ public:
 
     uint64_t getTotalSize() const;
 
+    /**
+     * Keeps freed recyclable buffers (see AllocationRequest::recyclable) in a process-local pool
+     * of at most maxBytes, for up to ttl, so that a recyclable request for the same dimensions,
+     * format and usage does not go through gralloc. Expired buffers are released on the next
+     * allocation or free, or by trimRecyclingPool(). A maxBytes of 0 disables the pool, which is
+     * the default, and releases its buffers.
+     */
+    void setRecyclingPoolLimits(size_t maxBytes, nsecs_t ttl);
+
+    /**
+     * Releases the buffers which have been in the recycling pool for longer than its ttl.
+     */
+    void trimRecyclingPool();
+
     void dump(std::string& res, bool less = true) const;
     static void dumpToSystemLog(bool less = true);
 
@@ -117,8 +138,39 @@ protected:
         uint64_t usage;
         size_t size;
         std::string requestorName;
+        bool recyclable = false;
+        bool pooled = false;
     };
 
+    struct PooledBuffer {
+        buffer_handle_t handle;
+        nsecs_t freeTime;
+    };
+
+    struct RecyclingPool {
+        size_t maxBytes = 0;
+        nsecs_t ttl = 0;
+        // Oldest first.
+        std::deque<PooledBuffer> buffers;
+        size_t bytes = 0;
+        size_t peakBytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t expirations = 0;
+    };
+
+    // Takes the most recently freed pooled buffer matching the request out of the pool, or returns
+    // nullptr. Must hold sLock.
+    buffer_handle_t takeFromPoolLocked(const AllocationRequest& request, uint32_t* outStride);
+    // Puts a freed buffer in the pool if it is recyclable and fits, and returns whether it did. Must
+    // hold sLock.
+    bool addToPoolLocked(buffer_handle_t handle, std::vector<buffer_handle_t>* outReleased);
+    // Removes buffers from the pool until it holds at most maxBytes, and none older than its ttl,
+    // and moves them to outReleased so that they are freed once sLock is released. Must hold sLock.
+    void trimPoolLocked(size_t maxBytes, nsecs_t now, std::vector<buffer_handle_t>* outReleased);
+    void releaseBuffers(const std::vector<buffer_handle_t>& handles);
+
     status_t allocateHelper(uint32_t w, uint32_t h, PixelFormat format, uint32_t layerCount,
                             uint64_t usage, buffer_handle_t* handle, uint32_t* stride,
                             std::string requestorName, bool importBuffer);
@@ -132,6 +184,9 @@ protected:
 
     GraphicBufferMapper& mMapper;
     std::unique_ptr<const GrallocAllocator> mAllocator;
+
+    // Guarded by sLock.
+    RecyclingPool mPool;
 };
 
 // ---------------------------------------------------------------------------
@@ -21,7 +21,11 @@
 #include <sys/types.h>
 
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
+#include <android-base/thread_annotations.h>
 #include <android-base/unique_fd.h>
 #include <ui/GraphicTypes.h>
 #include <ui/PixelFormat.h>
@@ -67,8 +71,39 @@ public:
                           uint32_t layerCount, PixelFormat format, uint64_t usage, uint32_t stride,
                           buffer_handle_t* outHandle);
 
+    // Same as above, for a buffer which crosses process boundaries as the GraphicBuffer with the
+    // given ID and generation number. While the import cache is enabled, importing a buffer which
+    // is already imported in this process with the same parameters returns the same outHandle,
+    // without going through the mapper again, and each outHandle must be freed with freeBuffer as
+    // many times as it was returned. The underlying buffer is checked to be the same, so a
+    // reused or forged ID only misses the cache.
+    status_t importBuffer(const native_handle_t* rawHandle, uint64_t bufferId, uint32_t generation,
+                          uint32_t width, uint32_t height, uint32_t layerCount, PixelFormat format,
+                          uint64_t usage, uint32_t stride, buffer_handle_t* outHandle);
+
     status_t importBufferNoValidate(const native_handle_t* rawHandle, buffer_handle_t* outHandle);
 
+    // Enables the import cache of importBuffer with a buffer ID. Since the GraphicBuffers of a
+    // buffer then share one handle, this must only be enabled in processes which do not lock the
+    // same buffer through several GraphicBuffers at once. Handles which are already shared stay
+    // valid once it is disabled.
+    void setImportCacheEnabled(bool enabled);
+
+    struct ImportStats {
+        // Calls to importBuffer with a buffer ID.
+        uint64_t imports = 0;
+        // Imports which returned an already imported handle.
+        uint64_t cacheHits = 0;
+        // Imports of a buffer ID which was cached for another underlying buffer.
+        uint64_t cacheMismatches = 0;
+        // Buffers in the cache, and the references to them.
+        size_t cachedBuffers = 0;
+        size_t cachedReferences = 0;
+    };
+
+    ImportStats getImportStats() const;
+    void dumpImportStats(std::string& result) const;
+
     status_t freeBuffer(buffer_handle_t handle);
 
     void getTransportSize(buffer_handle_t handle,
@@ -170,6 +205,34 @@ public:
     status_t setSmpte2094_10(buffer_handle_t bufferHandle,
                              std::optional<std::vector<uint8_t>> smpte2094_10);
 
+    /**
+     * The metadata which is set once the buffer is allocated, and cannot change afterwards.
+     */
+    struct BufferMetadata {
+        uint64_t bufferId = 0;
+        std::string name;
+        uint64_t width = 0;
+        uint64_t height = 0;
+        uint64_t layerCount = 0;
+        ui::PixelFormat pixelFormatRequested = ui::PixelFormat::RGBA_8888;
+        uint32_t pixelFormatFourCC = 0;
+        uint64_t pixelFormatModifier = 0;
+        uint64_t usage = 0;
+        uint64_t allocationSize = 0;
+        uint64_t protectedContent = 0;
+        ui::Compression compression = ui::Compression::NONE;
+        std::vector<ui::PlaneLayout> planeLayouts;
+    };
+
+    /**
+     * Gets all of the BufferMetadata of the buffer at once, rather than through a call per item.
+     * Gralloc 5 caches it per imported buffer, so only the first call for a buffer goes through
+     * the mapper.
+     *
+     * This function is supported by gralloc 4.0+.
+     */
+    status_t getBufferMetadata(buffer_handle_t bufferHandle, BufferMetadata* outMetadata);
+
     const GrallocMapper& getGrallocMapper() const {
         return reinterpret_cast<const GrallocMapper&>(*mMapper);
     }
@@ -181,9 +244,49 @@ private:
 
     GraphicBufferMapper();
 
+    struct ImportKey {
+        uint64_t bufferId;
+        uint32_t generation;
+
+        bool operator==(const ImportKey& other) const {
+            return bufferId == other.bufferId && generation == other.generation;
+        }
+    };
+
+    struct ImportKeyHash {
+        size_t operator()(const ImportKey& key) const {
+            return std::hash<uint64_t>{}(key.bufferId ^
+                                         (static_cast<uint64_t>(key.generation) << 48));
+        }
+    };
+
+    struct CachedImport {
+        buffer_handle_t handle;
+        // The identity of the buffer: the device and inode of each of its fds, and its ints.
+        std::vector<uint64_t> identity;
+        // The parameters which the import was validated with.
+        uint32_t width;
+        uint32_t height;
+        uint32_t layerCount;
+        PixelFormat format;
+        uint64_t usage;
+        uint32_t stride;
+        size_t references;
+    };
+
+    static bool getBufferIdentity(const native_handle_t* rawHandle,
+                                  std::vector<uint64_t>* outIdentity);
+
     std::unique_ptr<const GrallocMapper> mMapper;
 
     Version mMapperVersion;
+
+    mutable std::mutex mImportCacheMutex;
+    bool mImportCacheEnabled GUARDED_BY(mImportCacheMutex) = false;
+    std::unordered_map<ImportKey, CachedImport, ImportKeyHash> mImportCache
+            GUARDED_BY(mImportCacheMutex);
+    std::unordered_map<buffer_handle_t, ImportKey> mCachedHandles GUARDED_BY(mImportCacheMutex);
+    ImportStats mImportStats GUARDED_BY(mImportCacheMutex);
 };
 
 // ---------------------------------------------------------------------------
@@ -96,6 +96,11 @@ public:
     Rect    transform(const Rect& bounds,
                       bool roundOutwards = false) const;
     FloatRect transform(const FloatRect& bounds) const;
+    // Maps count points, or count rects, from src to dst as the functions above map each of them,
+    // with the type of the transform classified once for the whole array. dst may be src.
+    void    transform(const vec2* src, vec2* dst, size_t count) const;
+    void    transform(const Rect* src, Rect* dst, size_t count,
+                      bool roundOutwards = false) const;
     Transform& operator = (const Transform& other);
     Transform operator * (const Transform& rhs) const;
     Transform operator * (float value) const;
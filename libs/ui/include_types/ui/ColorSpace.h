@@ -19,6 +19,8 @@
 
 #include <array>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
@@ -300,6 +302,38 @@ private:
     mat3 mTransform;
 };
 
+/**
+ * Converts RGBA 8888 pixels from a color space to another. The RGB
+ * components of each pixel are converted as ColorSpaceConnector::transform()
+ * converts them once normalized, and rounded to the nearest 8 bit values.
+ * The alpha of the pixels is kept.
+ *
+ * The transfer functions are evaluated once, by the constructor, into lookup
+ * tables: the linear values of the 256 source values, and the linear values
+ * from which each destination value is encoded. The destination values must
+ * thus not decrease as the linear values increase, and the linear values
+ * out of [0..1] must encode as 0 and 1 do, as with the standard color spaces.
+ */
+class ColorSpacePixelConverter {
+public:
+    ColorSpacePixelConverter(const ColorSpace& src, const ColorSpace& dst) noexcept;
+
+    // Converts count pixels from src to dst. dst may be src.
+    void convert(const uint8_t* src, uint8_t* dst, size_t count) const noexcept;
+
+private:
+    static constexpr size_t BUCKET_COUNT = 4096;
+
+    uint8_t encode(float linear) const noexcept;
+
+    mat3 mTransform;
+    std::array<float, 256> mToLinear;
+    // The lowest linear value which encodes to more than each value, +inf for 255.
+    std::array<float, 256> mThresholds;
+    // The encoded value of the lowest linear value of each bucket of [0..1].
+    std::array<uint8_t, BUCKET_COUNT + 1> mBuckets;
+};
+
 }; // namespace android
 
 #endif // ANDROID_UI_COLOR_SPACE
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ui/FenceTime.h>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+
+namespace android {
+
+// Pipes stand in for sync fences: their read end polls as ready once the write end is written to,
+// but sync_file_info fails on them, so they resolve to SIGNAL_TIME_INVALID once they are queried.
+class FenceTimeTest : public testing::Test {
+protected:
+    std::shared_ptr<FenceTime> makeFenceTime() {
+        int fds[2];
+        EXPECT_EQ(0, pipe(fds));
+        mWriteFds.emplace_back(fds[1]);
+        return std::make_shared<FenceTime>(sp<Fence>::make(fds[0]));
+    }
+
+    void signal(size_t index) {
+        const char byte = 0;
+        ASSERT_EQ(1, write(mWriteFds[index].get(), &byte, 1));
+    }
+
+    std::vector<base::unique_fd> mWriteFds;
+};
+
+TEST_F(FenceTimeTest, ResolveSignalTimesOnlyQueriesReadyFences) {
+    const std::vector<std::shared_ptr<FenceTime>> fences = {makeFenceTime(), makeFenceTime(),
+                                                            FenceTime::NO_FENCE};
+
+    FenceTime::resolveSignalTimes(fences);
+    EXPECT_EQ(Fence::SIGNAL_TIME_PENDING, fences[0]->getCachedSignalTime());
+    EXPECT_EQ(Fence::SIGNAL_TIME_PENDING, fences[1]->getCachedSignalTime());
+
+    signal(1);
+    FenceTime::resolveSignalTimes(fences);
+    EXPECT_EQ(Fence::SIGNAL_TIME_PENDING, fences[0]->getCachedSignalTime());
+    EXPECT_EQ(Fence::SIGNAL_TIME_INVALID, fences[1]->getCachedSignalTime());
+}
+
+TEST_F(FenceTimeTest, TimelineKeepsPendingFences) {
+    FenceTimeline timeline;
+    const std::shared_ptr<FenceTime> first = makeFenceTime();
+    const std::shared_ptr<FenceTime> second = makeFenceTime();
+    timeline.push(first);
+    timeline.push(second);
+
+    // The later fence resolves even though the earlier one is still pending.
+    signal(1);
+    timeline.updateSignalTimes();
+    EXPECT_EQ(Fence::SIGNAL_TIME_PENDING, first->getCachedSignalTime());
+    EXPECT_EQ(Fence::SIGNAL_TIME_INVALID, second->getCachedSignalTime());
+
+    signal(0);
+    timeline.updateSignalTimes();
+    EXPECT_EQ(Fence::SIGNAL_TIME_INVALID, first->getCachedSignalTime());
+}
+
+TEST_F(FenceTimeTest, ResolverResolvesTrackedFences) {
+    const std::shared_ptr<FenceTime> fence = makeFenceTime();
+    FenceResolver::getInstance().track(fence);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(Fence::SIGNAL_TIME_PENDING, fence->getCachedSignalTime());
+
+    signal(0);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (fence->getCachedSignalTime() == Fence::SIGNAL_TIME_PENDING &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(Fence::SIGNAL_TIME_INVALID, fence->getCachedSignalTime());
+}
+
+} // namespace android
@@ -53,6 +53,11 @@ public:
                     allocate)
                 .WillOnce(DoAll(SetArgPointee<6>(stride), Return(err)));
     }
+    void setUpAllocateExpectations(status_t err, uint32_t stride, buffer_handle_t handle) {
+        EXPECT_CALL(*(reinterpret_cast<const mock::MockGrallocAllocator*>(mAllocator.get())),
+                    allocate)
+                .WillOnce(DoAll(SetArgPointee<6>(stride), SetArgPointee<7>(handle), Return(err)));
+    }
     std::unique_ptr<const GrallocAllocator>& getAllocator() { return mAllocator; }
 };
 
@@ -113,4 +118,49 @@ TEST_F(GraphicBufferAllocatorTest, AllocateLargeStride) {
     ASSERT_EQ(NO_ERROR, err);
     ASSERT_EQ(expectedStride, stride);
 }
+
+GraphicBufferAllocator::AllocationRequest recyclableRequest(uint32_t width) {
+    return GraphicBufferAllocator::AllocationRequest{
+            .importBuffer = true,
+            .width = width,
+            .height = kTestHeight,
+            .format = PIXEL_FORMAT_RGBA_8888,
+            .layerCount = kTestLayerCount,
+            .usage = kTestUsage,
+            .requestorName = "GraphicBufferAllocatorTest",
+            .recyclable = true,
+    };
+}
+
+TEST_F(GraphicBufferAllocatorTest, RecyclesFreedBuffer) {
+    // The handles are never passed to the mapper, since they stay in the pool.
+    const auto pooledHandle = reinterpret_cast<buffer_handle_t>(0x1000);
+    const auto otherHandle = reinterpret_cast<buffer_handle_t>(0x2000);
+    mAllocator.setRecyclingPoolLimits(16 * kTestWidth * 4, ms2ns(60'000));
+
+    mAllocator.setUpAllocateExpectations(NO_ERROR, kTestWidth, pooledHandle);
+    auto result = mAllocator.allocate(recyclableRequest(kTestWidth));
+    ASSERT_EQ(NO_ERROR, result.status);
+    ASSERT_EQ(pooledHandle, result.handle);
+    ASSERT_EQ(NO_ERROR, mAllocator.free(result.handle));
+
+    // A request with other dimensions goes to gralloc.
+    mAllocator.setUpAllocateExpectations(NO_ERROR, 2 * kTestWidth, otherHandle);
+    result = mAllocator.allocate(recyclableRequest(2 * kTestWidth));
+    ASSERT_EQ(NO_ERROR, result.status);
+    EXPECT_EQ(otherHandle, result.handle);
+
+    // A matching request takes the freed buffer, without going to gralloc.
+    result = mAllocator.allocate(recyclableRequest(kTestWidth));
+    ASSERT_EQ(NO_ERROR, result.status);
+    EXPECT_EQ(pooledHandle, result.handle);
+    EXPECT_EQ(kTestWidth, result.stride);
+
+    ASSERT_EQ(NO_ERROR, mAllocator.free(pooledHandle));
+    ASSERT_EQ(NO_ERROR, mAllocator.free(otherHandle));
+    std::string dump;
+    mAllocator.dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("Recycling pool: 2 buffers")) << dump;
+    EXPECT_NE(std::string::npos, dump.find("1 hits, 2 misses")) << dump;
+}
 } // namespace android
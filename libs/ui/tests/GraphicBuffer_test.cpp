@@ -17,8 +17,12 @@
 #define LOG_TAG "GraphicBufferTest"
 
 #include <ui/GraphicBuffer.h>
+#include <ui/GraphicBufferMapper.h>
 
 #include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <vector>
 
 namespace android {
 
@@ -66,4 +70,96 @@ TEST_F(GraphicBufferTest, AllocateBadDimensions) {
     ASSERT_EQ(BAD_VALUE, gb2->initCheck());
 }
 
+namespace {
+
+// Unflattens a copy of the given buffer, as if it were received from another process.
+sp<GraphicBuffer> unflattenCopy(const sp<GraphicBuffer>& gb) {
+    std::vector<uint8_t> flattened(gb->getFlattenedSize());
+    std::vector<int> fds(gb->getFdCount());
+    void* buffer = flattened.data();
+    size_t size = flattened.size();
+    int* fdPtr = fds.data();
+    size_t fdCount = fds.size();
+    if (gb->flatten(buffer, size, fdPtr, fdCount) != NO_ERROR) {
+        return nullptr;
+    }
+
+    // unflatten() takes ownership of the fds.
+    for (int& fd : fds) {
+        fd = dup(fd);
+    }
+    const void* constBuffer = flattened.data();
+    size = flattened.size();
+    const int* constFds = fds.data();
+    fdCount = fds.size();
+    sp<GraphicBuffer> copy = sp<GraphicBuffer>::make();
+    if (copy->unflatten(constBuffer, size, constFds, fdCount) != NO_ERROR) {
+        return nullptr;
+    }
+    return copy;
+}
+
+} // namespace
+
+TEST_F(GraphicBufferTest, GetBufferMetadataMatchesGetters) {
+    PixelFormat format = PIXEL_FORMAT_RGBA_8888;
+    sp<GraphicBuffer> gb = sp<GraphicBuffer>::make(kTestWidth, kTestHeight, format,
+                                                   kTestLayerCount, kTestUsage, std::string("test"));
+    ASSERT_EQ(NO_ERROR, gb->initCheck());
+
+    GraphicBufferMapper& mapper = GraphicBufferMapper::get();
+    if (mapper.getMapperVersion() < GraphicBufferMapper::GRALLOC_4) {
+        GTEST_SKIP() << "Buffer metadata needs gralloc 4 or later";
+    }
+
+    GraphicBufferMapper::BufferMetadata metadata;
+    ASSERT_EQ(OK, mapper.getBufferMetadata(gb->handle, &metadata));
+    EXPECT_EQ(kTestWidth, metadata.width);
+    EXPECT_EQ(kTestHeight, metadata.height);
+    EXPECT_EQ(kTestLayerCount, metadata.layerCount);
+    EXPECT_EQ(ui::PixelFormat::RGBA_8888, metadata.pixelFormatRequested);
+    EXPECT_EQ(kTestUsage, metadata.usage & kTestUsage);
+
+    // A second query is served from the same, unchanged metadata.
+    GraphicBufferMapper::BufferMetadata again;
+    ASSERT_EQ(OK, mapper.getBufferMetadata(gb->handle, &again));
+    EXPECT_EQ(metadata.bufferId, again.bufferId);
+    EXPECT_EQ(metadata.planeLayouts, again.planeLayouts);
+
+    uint64_t bufferId = 0;
+    ASSERT_EQ(OK, mapper.getBufferId(gb->handle, &bufferId));
+    EXPECT_EQ(metadata.bufferId, bufferId);
+}
+
+TEST_F(GraphicBufferTest, ImportCacheSharesHandles) {
+    GraphicBufferMapper& mapper = GraphicBufferMapper::get();
+    mapper.setImportCacheEnabled(true);
+
+    PixelFormat format = PIXEL_FORMAT_RGBA_8888;
+    sp<GraphicBuffer> gb = sp<GraphicBuffer>::make(kTestWidth, kTestHeight, format,
+                                                   kTestLayerCount, kTestUsage, std::string("test"));
+    ASSERT_EQ(NO_ERROR, gb->initCheck());
+
+    const GraphicBufferMapper::ImportStats before = mapper.getImportStats();
+    sp<GraphicBuffer> first = unflattenCopy(gb);
+    sp<GraphicBuffer> second = unflattenCopy(gb);
+    ASSERT_NE(nullptr, first);
+    ASSERT_NE(nullptr, second);
+    EXPECT_EQ(first->handle, second->handle);
+    EXPECT_NE(gb->handle, first->handle);
+
+    const GraphicBufferMapper::ImportStats stats = mapper.getImportStats();
+    EXPECT_EQ(before.imports + 2, stats.imports);
+    EXPECT_EQ(before.cacheHits + 1, stats.cacheHits);
+    EXPECT_EQ(before.cachedBuffers + 1, stats.cachedBuffers);
+
+    // The handle stays imported until each of its GraphicBuffers is gone.
+    first.clear();
+    EXPECT_EQ(before.cachedBuffers + 1, mapper.getImportStats().cachedBuffers);
+    second.clear();
+    EXPECT_EQ(before.cachedBuffers, mapper.getImportStats().cachedBuffers);
+
+    mapper.setImportCacheEnabled(false);
+}
+
 } // namespace android
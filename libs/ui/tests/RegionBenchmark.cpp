@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+
+// Usage: atest RegionBenchmark
+//
+// Measures the boolean operations of Region the way SurfaceFlinger does them
+// for the layers of a frame: mostly between a region and a rect, and between
+// regions made of a grid of rects.
+
+namespace android {
+
+namespace {
+
+// A region made of count x count rects of 10x10 pixels, with gaps of 10
+// pixels between them.
+Region makeGrid(int count) {
+    Region region;
+    for (int y = 0; y < count; y++) {
+        for (int x = 0; x < count; x++) {
+            region.orSelf(Rect(x * 20, y * 20, x * 20 + 10, y * 20 + 10));
+        }
+    }
+    return region;
+}
+
+void BM_RectIntersectRect(benchmark::State& state) {
+    const Region region(Rect(0, 0, 1080, 2400));
+    const Rect rect(100, 200, 1180, 2600);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(region.intersect(rect));
+    }
+}
+BENCHMARK(BM_RectIntersectRect);
+
+void BM_RectMergeAdjacentRect(benchmark::State& state) {
+    const Region region(Rect(0, 0, 1080, 1200));
+    const Rect rect(0, 1200, 1080, 2400);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(region.merge(rect));
+    }
+}
+BENCHMARK(BM_RectMergeAdjacentRect);
+
+void BM_RectSubtractRect(benchmark::State& state) {
+    const Region region(Rect(0, 0, 1080, 2400));
+    const Rect rect(100, 200, 980, 2200);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(region.subtract(rect));
+    }
+}
+BENCHMARK(BM_RectSubtractRect);
+
+void BM_GridIntersectRect(benchmark::State& state) {
+    const int count = static_cast<int>(state.range(0));
+    const Region region = makeGrid(count);
+    const Rect rect(5, 5, count * 20 - 15, count * 20 - 15);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(region.intersect(rect));
+    }
+}
+BENCHMARK(BM_GridIntersectRect)->Arg(4)->Arg(16);
+
+void BM_GridInsideRect(benchmark::State& state) {
+    const int count = static_cast<int>(state.range(0));
+    const Region region = makeGrid(count);
+    const Rect rect(0, 0, count * 20, count * 20);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(region.intersect(rect));
+    }
+}
+BENCHMARK(BM_GridInsideRect)->Arg(4)->Arg(16);
+
+void BM_GridMergeGrid(benchmark::State& state) {
+    const Region lhs = makeGrid(static_cast<int>(state.range(0)));
+    const Region rhs = lhs.translate(0, 10);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs.merge(rhs));
+    }
+}
+BENCHMARK(BM_GridMergeGrid)->Arg(4)->Arg(16);
+
+void BM_GridSubtractGrid(benchmark::State& state) {
+    const Region lhs = makeGrid(static_cast<int>(state.range(0)));
+    const Region rhs = lhs.translate(5, 5);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs.subtract(rhs));
+    }
+}
+BENCHMARK(BM_GridSubtractGrid)->Arg(4)->Arg(16);
+
+void BM_GridTranslate(benchmark::State& state) {
+    Region region = makeGrid(static_cast<int>(state.range(0)));
+    int offset = 1;
+    for (auto _ : state) {
+        region.translateSelf(offset, -offset);
+        offset = -offset;
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_GridTranslate)->Arg(4)->Arg(16);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -179,5 +179,91 @@ TEST_F(RegionTest, RegionHash) {
     EXPECT_NE(std::hash<Region>{}(region1), std::hash<Region>{}(region2));
 }
 
+TEST_F(RegionTest, RectOperationsWithoutSweep) {
+    const Region region(Rect(0, 0, 100, 100));
+
+    EXPECT_TRUE(region.intersect(Rect(100, 0, 200, 100)).isEmpty());
+    EXPECT_EQ(Rect(50, 50, 100, 100), region.intersect(Rect(50, 50, 150, 150)).getBounds());
+    EXPECT_TRUE(region.intersect(Rect(50, 50, 150, 150)).isRect());
+    EXPECT_TRUE(region.intersect(Rect(-10, -10, 110, 110)).hasSameRects(region));
+
+    const Region column = region.merge(Rect(0, 100, 100, 200));
+    EXPECT_TRUE(column.isRect());
+    EXPECT_EQ(Rect(0, 0, 100, 200), column.getBounds());
+    const Region row = region.merge(Rect(50, 0, 150, 100));
+    EXPECT_TRUE(row.isRect());
+    EXPECT_EQ(Rect(0, 0, 150, 100), row.getBounds());
+    EXPECT_TRUE(region.merge(Rect(10, 10, 20, 20)).hasSameRects(region));
+    EXPECT_TRUE(region.merge(Rect()).hasSameRects(region));
+
+    EXPECT_TRUE(region.subtract(Rect(0, 0, 100, 100)).isEmpty());
+    EXPECT_TRUE(region.subtract(Rect(100, 100, 200, 200)).hasSameRects(region));
+    EXPECT_TRUE(region.mergeExclusive(Rect()).hasSameRects(region));
+
+    // Regions made of one rect take the same paths.
+    EXPECT_TRUE(region.intersect(Region(Rect(200, 200, 300, 300))).isEmpty());
+    EXPECT_TRUE(Region(region).orSelf(Region(Rect(0, 100, 100, 200))).hasSameRects(column));
+}
+
+TEST_F(RegionTest, RectOperationsWithRegion) {
+    Region region;
+    region.orSelf(Rect(0, 0, 10, 10));
+    region.orSelf(Rect(20, 20, 30, 30));
+    ASSERT_FALSE(region.isRect());
+
+    EXPECT_TRUE(region.intersect(Rect(0, 0, 30, 30)).hasSameRects(region));
+    EXPECT_TRUE(region.intersect(Rect(40, 40, 50, 50)).isEmpty());
+    const Region partial = region.intersect(Rect(5, 5, 25, 25));
+    EXPECT_EQ(Rect(5, 5, 25, 25), partial.getBounds());
+    EXPECT_FALSE(partial.isRect());
+
+    EXPECT_TRUE(region.merge(Rect(-5, -5, 35, 35)).isRect());
+    EXPECT_TRUE(region.subtract(Rect(-5, -5, 35, 35)).isEmpty());
+    EXPECT_TRUE(region.subtract(Rect(10, 0, 20, 10)).hasSameRects(region));
+    EXPECT_TRUE(Region(Rect(-5, -5, 35, 35)).intersect(region).hasSameRects(region));
+
+    Region self(region);
+    self.andSelf(self);
+    EXPECT_TRUE(self.hasSameRects(region));
+}
+
+TEST_F(RegionTest, SpansMergeVertically) {
+    Region top;
+    top.orSelf(Rect(0, 0, 10, 10));
+    top.orSelf(Rect(20, 0, 30, 10));
+    Region bottom;
+    bottom.orSelf(Rect(0, 10, 10, 20));
+    bottom.orSelf(Rect(20, 10, 30, 20));
+
+    size_t count;
+    const Region merged = top.merge(bottom);
+    const Rect* rects = merged.getArray(&count);
+    ASSERT_EQ(2u, count);
+    EXPECT_EQ(Rect(0, 0, 10, 20), rects[0]);
+    EXPECT_EQ(Rect(20, 0, 30, 20), rects[1]);
+
+    bottom.translateSelf(1, 0);
+    top.merge(bottom).getArray(&count);
+    EXPECT_EQ(4u, count);
+}
+
+TEST_F(RegionTest, TranslateOffsetsAllRects) {
+    Region region;
+    region.orSelf(Rect(0, 0, 10, 10));
+    region.orSelf(Rect(20, 20, 30, 30));
+    region.orSelf(Rect(40, 0, 50, 10));
+
+    const Region translated = region.translate(5, -5);
+    size_t count;
+    const Rect* rects = region.getArray(&count);
+    size_t translatedCount;
+    const Rect* translatedRects = translated.getArray(&translatedCount);
+    ASSERT_EQ(count, translatedCount);
+    for (size_t i = 0; i < count; i++) {
+        EXPECT_EQ(Rect(rects[i]).offsetBy(5, -5), translatedRects[i]);
+    }
+    EXPECT_EQ(Rect(5, -5, 55, 25), translated.getBounds());
+}
+
 }; // namespace android
 
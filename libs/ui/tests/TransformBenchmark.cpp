@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+#include <ui/Transform.h>
+
+#include <vector>
+
+// Usage: atest TransformBenchmark
+//
+// Measures the mapping of the bounds and the regions of the layers of a frame
+// through the transform of the display, one rect at a time and in batches.
+
+namespace android {
+
+namespace {
+
+using ui::Transform;
+
+// The bounds of count layers of a frame, which overlap each other.
+std::vector<Rect> makeLayerBounds(int count) {
+    std::vector<Rect> bounds;
+    for (int i = 0; i < count; i++) {
+        bounds.emplace_back(i * 7, i * 13, 540 + i * 11, 1200 + i * 17);
+    }
+    return bounds;
+}
+
+// A region made of count x count rects of 10x10 pixels, with gaps of 10
+// pixels between them.
+Region makeGrid(int count) {
+    Region region;
+    for (int y = 0; y < count; y++) {
+        for (int x = 0; x < count; x++) {
+            region.orSelf(Rect(x * 20, y * 20, x * 20 + 10, y * 20 + 10));
+        }
+    }
+    return region;
+}
+
+Transform makeDisplayTransform() {
+    Transform scale;
+    scale.set(0.75f, 0, 0, 0.75f);
+    return Transform(Transform::ROT_90, 2400, 1080) * scale;
+}
+
+void BM_TransformEachRect(benchmark::State& state) {
+    const Transform transform = makeDisplayTransform();
+    const std::vector<Rect> bounds = makeLayerBounds(static_cast<int>(state.range(0)));
+    std::vector<Rect> mapped(bounds.size());
+    for (auto _ : state) {
+        for (size_t i = 0; i < bounds.size(); i++) {
+            mapped[i] = transform.transform(bounds[i]);
+        }
+        benchmark::DoNotOptimize(mapped.data());
+    }
+}
+BENCHMARK(BM_TransformEachRect)->Arg(16)->Arg(256);
+
+void BM_TransformRects(benchmark::State& state) {
+    const Transform transform = makeDisplayTransform();
+    const std::vector<Rect> bounds = makeLayerBounds(static_cast<int>(state.range(0)));
+    std::vector<Rect> mapped(bounds.size());
+    for (auto _ : state) {
+        transform.transform(bounds.data(), mapped.data(), bounds.size());
+        benchmark::DoNotOptimize(mapped.data());
+    }
+}
+BENCHMARK(BM_TransformRects)->Arg(16)->Arg(256);
+
+void BM_TransformRegion(benchmark::State& state) {
+    const Transform transform = makeDisplayTransform();
+    const Region region = makeGrid(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(transform.transform(region));
+    }
+}
+BENCHMARK(BM_TransformRegion)->Arg(4)->Arg(16);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
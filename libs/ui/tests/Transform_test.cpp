@@ -18,6 +18,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 namespace android::ui {
 
 TEST(TransformTest, inverseRotation_hasCorrectType) {
@@ -46,4 +48,43 @@ TEST(TransformTest, inverseRotation_hasCorrectType) {
     testRotationFlagsForInverse(Transform::FLIP_V, Transform::FLIP_V, false);
 }
 
+TEST(TransformTest, batchTransform_matchesEachTransform) {
+    const std::vector<Rect> rects = {Rect(0, 0, 1080, 2400), Rect(10, 20, 31, 45),
+                                     Rect(-7, -3, 5, 9), Rect(3, 3, 3, 3)};
+    std::vector<Transform> transforms;
+    for (auto rotation : {Transform::ROT_0, Transform::ROT_90, Transform::ROT_180,
+                          Transform::ROT_270, Transform::FLIP_H, Transform::FLIP_V}) {
+        transforms.emplace_back(rotation, 1080, 2400);
+    }
+    Transform scale;
+    scale.set(0.33f, 0, 0, 1.7f);
+    scale.set(12.5f, -3.25f);
+    transforms.push_back(scale);
+    transforms.push_back(transforms[1] * scale);
+    Transform skew;
+    skew.set(0.9f, 0.2f, -0.3f, 1.1f);
+    transforms.push_back(skew);
+
+    for (const Transform& t : transforms) {
+        for (bool roundOutwards : {false, true}) {
+            std::vector<Rect> mapped(rects.size());
+            t.transform(rects.data(), mapped.data(), rects.size(), roundOutwards);
+            for (size_t i = 0; i < rects.size(); i++) {
+                EXPECT_EQ(t.transform(rects[i], roundOutwards), mapped[i]);
+            }
+        }
+
+        std::vector<vec2> points;
+        for (const Rect& r : rects) {
+            points.emplace_back(r.left, r.top);
+            points.emplace_back(r.right + 0.5f, r.bottom - 0.25f);
+        }
+        std::vector<vec2> mapped = points;
+        t.transform(mapped.data(), mapped.data(), mapped.size());
+        for (size_t i = 0; i < points.size(); i++) {
+            EXPECT_EQ(t.transform(points[i]), mapped[i]);
+        }
+    }
+}
+
 } // namespace android::ui
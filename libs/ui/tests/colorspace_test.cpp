@@ -19,6 +19,9 @@
 #include <math.h>
 #include <stdlib.h>
 
+#include <utility>
+#include <vector>
+
 #include <ui/ColorSpace.h>
 
 #include <gtest/gtest.h>
@@ -183,4 +186,61 @@ TEST_F(ColorSpaceTest, LUT) {
 
 }
 
+TEST_F(ColorSpaceTest, LUTMatchesConnector) {
+    const uint32_t size = 9;
+    auto lut = ColorSpace::createLUT(size, ColorSpace::DisplayP3(), ColorSpace::extendedSRGB());
+    ColorSpaceConnector connector(ColorSpace::DisplayP3(), ColorSpace::extendedSRGB());
+    const float m = 1.0f / float(size - 1);
+    for (uint32_t z = 0; z < size; z++) {
+        for (uint32_t y = 0; y < size; y++) {
+            for (uint32_t x = 0; x < size; x++) {
+                float3 expected = connector.transform({x * m, y * m, z * m});
+                float3 r = lut.get()[z * size * size + (size - 1 - y) * size + x];
+                ASSERT_EQ(expected, r) << x << ", " << y << ", " << z;
+            }
+        }
+    }
+}
+
+TEST_F(ColorSpaceTest, PixelConverterMatchesConnector) {
+    const auto quantize = [](float v) {
+        return static_cast<uint8_t>(clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+    };
+    const std::pair<ColorSpace, ColorSpace> pairs[] = {
+        {ColorSpace::DisplayP3(), ColorSpace::sRGB()},
+        {ColorSpace::sRGB(), ColorSpace::DisplayP3()},
+        {ColorSpace::BT2020(), ColorSpace::extendedSRGB()},
+        {ColorSpace::sRGB(), ColorSpace::AdobeRGB()},
+        {ColorSpace::sRGB(), ColorSpace::ProPhotoRGB()},
+    };
+    for (const auto& [src, dst] : pairs) {
+        ColorSpaceConnector connector(src, dst);
+        ColorSpacePixelConverter converter(src, dst);
+
+        std::vector<uint8_t> pixels;
+        for (int r = 0; r < 256; r++) {
+            for (int g = 0; g < 256; g += 15) {
+                for (int b = 0; b < 256; b += 17) {
+                    pixels.insert(pixels.end(), {uint8_t(r), uint8_t(g), uint8_t(b), uint8_t(g)});
+                }
+            }
+        }
+        std::vector<uint8_t> converted(pixels.size());
+        converter.convert(pixels.data(), converted.data(), pixels.size() / 4);
+
+        for (size_t i = 0; i < pixels.size(); i += 4) {
+            float3 expected = connector.transform(
+                    {pixels[i] / 255.0f, pixels[i + 1] / 255.0f, pixels[i + 2] / 255.0f});
+            ASSERT_EQ(quantize(expected.r), converted[i]) << src.getName() << " " << i;
+            ASSERT_EQ(quantize(expected.g), converted[i + 1]) << src.getName() << " " << i;
+            ASSERT_EQ(quantize(expected.b), converted[i + 2]) << src.getName() << " " << i;
+            ASSERT_EQ(pixels[i + 3], converted[i + 3]);
+        }
+
+        // In place.
+        converter.convert(pixels.data(), pixels.data(), pixels.size() / 4);
+        EXPECT_EQ(converted, pixels);
+    }
+}
+
 }; // namespace android
@@ -0,0 +1,373 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <ultrahdr/jpegencoderhelper.h>
+#include <ultrahdr/jpegr.h>
+#include <ultrahdr/threadpool.h>
+
+namespace android::ultrahdr {
+
+namespace {
+
+// HD, 12 MP and 50 MP images.
+constexpr int kImageSizes[][2] = {{1920, 1080}, {4032, 3024}, {8160, 6120}};
+constexpr int kThreadCounts[] = {1, 2, 4};
+constexpr int kQuality = 95;
+constexpr int kMapQuality = 85;
+
+// Exposes the stages of the encoding and decoding pipelines.
+class JpegRStages : public JpegR {
+public:
+  using JpegR::applyGainMap;
+  using JpegR::convertYuv;
+  using JpegR::generateGainMap;
+  using JpegR::toneMap;
+};
+
+// Reads a field of /proc/self/status in KiB, 0 if it is not there.
+long readStatusKb(const char* field) {
+  FILE* file = fopen("/proc/self/status", "r");
+  if (file == nullptr) {
+    return 0;
+  }
+  char line[128];
+  long value = 0;
+  const size_t length = strlen(field);
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    if (strncmp(line, field, length) == 0 && line[length] == ':') {
+      value = strtol(line + length + 1, nullptr, 10);
+      break;
+    }
+  }
+  fclose(file);
+  return value;
+}
+
+/*
+ * Measures the peak of the resident memory of the process over the iterations of a benchmark, on
+ * top of the memory which is resident when it starts: the inputs, and the outputs which are
+ * allocated up front.
+ */
+class PeakRss {
+public:
+  PeakRss() {
+    // Resets the peak to the current resident memory, see proc(5).
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if (file != nullptr) {
+      fputs("5", file);
+      fclose(file);
+    }
+    mStartKb = readStatusKb("VmRSS");
+  }
+
+  void report(benchmark::State& state) const {
+    state.counters["peak_rss_kb"] =
+            static_cast<double>(std::max(readStatusKb("VmHWM") - mStartKb, 0L));
+  }
+
+private:
+  long mStartKb;
+};
+
+std::unique_ptr<uint8_t[]> allocate(size_t size) {
+  std::unique_ptr<uint8_t[]> data(new uint8_t[size]);
+  // Makes the pages resident, so that they do not count in the peak of the benchmark.
+  memset(data.get(), 0, size);
+  return data;
+}
+
+/*
+ * The inputs of the benchmarks for an image size: a synthetic HDR image, its SDR rendition and
+ * gain map, and their compressed forms.
+ */
+struct Images {
+  Images(int width, int height);
+
+  int width, height;
+  std::unique_ptr<uint8_t[]> p010Data, yuv420Data, mapData;
+  jpegr_uncompressed_struct p010, yuv420, map;
+  ultrahdr_metadata_struct metadata;
+  std::vector<uint8_t> sdrJpegData, mapJpegData, jpegrData;
+  jpegr_compressed_struct sdrJpeg, mapJpeg, jpegrImage;
+};
+
+Images::Images(int width, int height) : width(width), height(height) {
+  JpegRStages stages;
+
+  // Smooth gradients in 10-bit P010, with a highlight in the middle for the gain map.
+  p010Data = allocate(width * height * 3);
+  uint16_t* y = reinterpret_cast<uint16_t*>(p010Data.get());
+  uint16_t* uv = y + width * height;
+  for (int row = 0; row < height; row++) {
+    for (int x = 0; x < width; x++) {
+      int luma = 64 + (x + row) * 876 / (width + height);
+      if (abs(x - width / 2) < width / 8 && abs(row - height / 2) < height / 8) {
+        luma = 940;
+      }
+      y[row * width + x] = luma << 6;
+    }
+  }
+  for (int row = 0; row < height / 2; row++) {
+    for (int x = 0; x < width / 2; x++) {
+      uv[row * width + 2 * x] = (64 + x * 896 / width) << 6;
+      uv[row * width + 2 * x + 1] = (64 + row * 1792 / height) << 6;
+    }
+  }
+  p010 = {p010Data.get(), width, height, ULTRAHDR_COLORGAMUT_BT2100, uv, width, width};
+
+  yuv420Data = allocate(width * height * 3 / 2);
+  yuv420 = {yuv420Data.get(), width, height, ULTRAHDR_COLORGAMUT_BT709,
+            yuv420Data.get() + width * height, width, width / 2};
+  stages.toneMap(&p010, &yuv420);
+
+  JpegEncoderHelper sdrEncoder;
+  sdrEncoder.compressImage(yuv420Data.get(), yuv420Data.get() + width * height, width, height,
+                           width, width / 2, kQuality, nullptr, 0);
+  const uint8_t* sdrJpegPtr = static_cast<uint8_t*>(sdrEncoder.getCompressedImagePtr());
+  sdrJpegData.assign(sdrJpegPtr, sdrJpegPtr + sdrEncoder.getCompressedImageSize());
+  sdrJpeg = {sdrJpegData.data(), static_cast<int>(sdrJpegData.size()),
+             static_cast<int>(sdrJpegData.size()), ULTRAHDR_COLORGAMUT_BT709};
+
+  map = {nullptr, 0, 0, ULTRAHDR_COLORGAMUT_UNSPECIFIED};
+  metadata = {};
+  stages.generateGainMap(&yuv420, &p010, ULTRAHDR_TF_HLG, &metadata, &map);
+  metadata.version = kJpegrVersion;
+  mapData.reset(static_cast<uint8_t*>(map.data));
+  JpegEncoderHelper mapEncoder;
+  mapEncoder.compressImage(mapData.get(), nullptr, map.width, map.height, map.width, 0,
+                           kMapQuality, nullptr, 0);
+  const uint8_t* mapJpegPtr = static_cast<uint8_t*>(mapEncoder.getCompressedImagePtr());
+  mapJpegData.assign(mapJpegPtr, mapJpegPtr + mapEncoder.getCompressedImageSize());
+  mapJpeg = {mapJpegData.data(), static_cast<int>(mapJpegData.size()),
+             static_cast<int>(mapJpegData.size()), ULTRAHDR_COLORGAMUT_UNSPECIFIED};
+
+  jpegrData.resize(width * height * 3);
+  jpegrImage = {jpegrData.data(), 0, static_cast<int>(jpegrData.size()),
+                ULTRAHDR_COLORGAMUT_UNSPECIFIED};
+  stages.encodeJPEGR(&p010, &yuv420, ULTRAHDR_TF_HLG, &jpegrImage, kQuality, nullptr);
+}
+
+// The inputs of the last image size, which the benchmarks of a size share.
+Images& getImages(int width, int height) {
+  static std::unique_ptr<Images> images;
+  if (images == nullptr || images->width != width || images->height != height) {
+    images.reset();
+    images = std::make_unique<Images>(width, height);
+  }
+  return *images;
+}
+
+// Runs the work of the benchmark on the threads of its argument, and reports its peak memory and
+// the pixels it processes.
+template <typename Work>
+void run(benchmark::State& state, Work work) {
+  ThreadPool::getInstance().configure({.parallelism = static_cast<size_t>(state.range(2)),
+                                       .cpus = {}});
+  PeakRss peakRss;
+  for (auto _ : state) {
+    if (work() != NO_ERROR) {
+      state.SkipWithError("the operation failed");
+      break;
+    }
+  }
+  peakRss.report(state);
+  state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(1));
+}
+
+void imageSizesAndThreads(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"width", "height", "threads"});
+  for (const auto& size : kImageSizes) {
+    for (int threads : kThreadCounts) {
+      b->Args({size[0], size[1], threads});
+    }
+  }
+  b->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+} // namespace
+
+static void BM_EncodeApi0(benchmark::State& state) {
+  Images& images = getImages(state.range(0), state.range(1));
+  std::unique_ptr<uint8_t[]> data = allocate(images.jpegrData.size());
+  jpegr_compressed_struct dest = {data.get(), 0, static_cast<int>(images.jpegrData.size()),
+                                  ULTRAHDR_COLORGAMUT_UNSPECIFIED};
+  JpegR jpegr;
+  run(state, [&] {
+    return jpegr.encodeJPEGR(&images.p010, ULTRAHDR_TF_HLG, &dest, kQuality, nullptr);
+  });
+}
+BENCHMARK(BM_EncodeApi0)->Apply(imageSizesAndThreads);
+
+static void BM_EncodeApi1(benchmark::State& state) {
+  Images& images = getImages(state.range(0), state.range(1));
+  std::unique_ptr<uint8_t[]> data = allocate(images.jpegrData.size());
+  jpegr_compressed_struct dest = {data.get(), 0, static_cast<int>(images.jpegrData.size()),
+                                  ULTRAHDR_COLORGAMUT_UNSPECIFIED};
+  JpegR jpegr;
+  run(state, [&] {
+    return jpegr.encodeJPEGR(&images.p010, &images.yuv420, ULTRAHDR_TF_HLG, &dest, kQuality,
+                             nullptr);
+  });
+}
+BENCHMARK(BM_EncodeApi1)->Apply(imageSizesAndThreads);
+
+static void BM_EncodeApi2(benchmark::State& state) {
+  Images& images = getImages(state.range(0), state.range(1));
+  std::unique_ptr<uint8_t[]> data = allocate(images.jpegrData.size());
+  jpegr_compressed_struct dest = {data.get(), 0, static_cast<int>(images.jpegrData.size()),
+                                  ULTRAHDR_COLORGAMUT_UNSPECIFIED};
+  JpegR jpegr;
+  run(state, [&] {
+    return jpegr.encodeJPEGR(&images.p010, &images.yuv420, &images.sdrJpeg, ULTRAHDR_TF_HLG,
+                             &dest);
+  });
+}
+BENCHMARK(BM_EncodeApi2)->Apply(imageSizesAndThreads);
+
+static void BM_EncodeApi3(benchmark::State& state) {
+  Images& images = getImages(state.range(0), state.range(1));
+  std::unique_ptr<uint8_t[]> data = allocate(images.jpegrData.size());
+  jpegr_compressed_struct dest = {data.get(), 0, static_cast<int>(images.jpegrData.size()),
+                                  ULTRAHDR_COLORGAMUT_UNSPECIFIED};
+  JpegR jpegr;
+  run(state, [&] {
+    return jpegr.encodeJPEGR(&images.p010, &images.sdrJpeg, ULTRAHDR_TF_HLG, &dest);
+  });
+}
+BENCHMARK(BM_EncodeApi3)->Apply(imageSizesAndThreads);
+
+static void BM_EncodeApi4(benchmark::State& state) {
+  Images& images = getImages(state.range(0), state.range(1));
+  std::unique_ptr<uint8_t[]> data = allocate(images.jpegrData.size());
+  jpegr_compressed_struct dest = {data.get(), 0, static_cast<int>(images.jpegrData.size()),
+                                  ULTRAHDR_COLORGAMUT_UNSPECIFIED};
+  JpegR jpegr;
+  run(state, [&] {
+    return jpegr.encodeJPEGR(&images.sdrJpeg, &images.mapJpeg, &images.metadata, &dest);
+  });
+}
+BENCHMARK(BM_EncodeApi4)->Apply(imageSizesAndThreads);
+
+static void BM_Decode(benchmark::State& state, ultrahdr_output_format format) {
+  Images& images = getImages(state.range(0), state.range(1));
+  std::unique_ptr<uint8_t[]> data = allocate(images.width * images.height * 8);
+  jpegr_uncompressed_struct dest = {data.get(), 0, 0, ULTRAHDR_COLORGAMUT_UNSPECIFIED};
+  JpegR jpegr;
+  run(state, [&] {
+    return jpegr.decodeJPEGR(&images.jpegrImage, &dest, FLT_MAX, nullptr, format);
+  });
+}
+BENCHMARK_CAPTURE(BM_Decode, sdr, ULTRAHDR_OUTPUT_SDR)->Apply(imageSizesAndThreads);
+BENCHMARK_CAPTURE(BM_Decode, hdr_linear, ULTRAHDR_OUTPUT_HDR_LINEAR)->Apply(imageSizesAndThreads);
+BENCHMARK_CAPTURE(BM_Decode, hdr_pq, ULTRAHDR_OUTPUT_HDR_PQ)->Apply(imageSizesAndThreads);
+BENCHMARK_CAPTURE(BM_Decode, hdr_hlg, ULTRAHDR_OUTPUT_HDR_HLG)->Apply(imageSizesAndThreads);
+
+// Decodes in strips of rows, which are dropped as they come.
+static void BM_DecodeRows(benchmark::State& state, ultrahdr_output_format format) {
+  Images& images = getImages(state.range(0), state.range(1));
+  JpegR jpegr;
+  JpegR::RowsWriter writer = [](size_t, size_t rowCount, const void* pixels) {
+    benchmark::DoNotOptimize(pixels);
+    benchmark::DoNotOptimize(rowCount);
+    return static_cast<status_t>(NO_ERROR);
+  };
+  run(state, [&] {
+    return jpegr.decodeJPEGRRows(&images.jpegrImage, writer, FLT_MAX, nullptr, format);
+  });
+}
+BENCHMARK_CAPTURE(BM_DecodeRows, hdr_linear, ULTRAHDR_OUTPUT_HDR_LINEAR)
+        ->Apply(imageSizesAndThreads);
+BENCHMARK_CAPTURE(BM_DecodeRows, hdr_hlg, ULTRAHDR_OUTPUT_HDR_HLG)->Apply(imageSizesAndThreads);
+
+static void BM_GenerateGainMap(benchmark::State& state) {
+  Images& images = getImages(state.range(0), state.range(1));
+  JpegRStages jpegr;
+  run(state, [&] {
+    ultrahdr_metadata_struct metadata{};
+    jpegr_uncompressed_struct map = {nullptr, 0, 0, ULTRAHDR_COLORGAMUT_UNSPECIFIED};
+    status_t status = jpegr.generateGainMap(&images.yuv420, &images.p010, ULTRAHDR_TF_HLG,
+                                            &metadata, &map);
+    delete[] static_cast<uint8_t*>(map.data);
+    return status;
+  });
+}
+BENCHMARK(BM_GenerateGainMap)->Apply(imageSizesAndThreads);
+
+static void BM_ApplyGainMap(benchmark::State& state, ultrahdr_output_format format) {
+  Images& images = getImages(state.range(0), state.range(1));
+  std::unique_ptr<uint8_t[]> data = allocate(images.width * images.height * 8);
+  jpegr_uncompressed_struct dest = {data.get(), 0, 0, ULTRAHDR_COLORGAMUT_UNSPECIFIED};
+  JpegRStages jpegr;
+  run(state, [&] {
+    return jpegr.applyGainMap(&images.yuv420, &images.map, &images.metadata, format,
+                              images.metadata.maxContentBoost, &dest);
+  });
+}
+BENCHMARK_CAPTURE(BM_ApplyGainMap, hdr_linear, ULTRAHDR_OUTPUT_HDR_LINEAR)
+        ->Apply(imageSizesAndThreads);
+BENCHMARK_CAPTURE(BM_ApplyGainMap, hdr_pq, ULTRAHDR_OUTPUT_HDR_PQ)->Apply(imageSizesAndThreads);
+BENCHMARK_CAPTURE(BM_ApplyGainMap, hdr_hlg, ULTRAHDR_OUTPUT_HDR_HLG)->Apply(imageSizesAndThreads);
+
+static void BM_ToneMap(benchmark::State& state) {
+  Images& images = getImages(state.range(0), state.range(1));
+  std::unique_ptr<uint8_t[]> data = allocate(images.width * images.height * 3 / 2);
+  jpegr_uncompressed_struct dest = {data.get(), images.width, images.height,
+                                    ULTRAHDR_COLORGAMUT_BT709,
+                                    data.get() + images.width * images.height, images.width,
+                                    images.width / 2};
+  JpegRStages jpegr;
+  run(state, [&] { return jpegr.toneMap(&images.p010, &dest); });
+}
+BENCHMARK(BM_ToneMap)->Apply(imageSizesAndThreads);
+
+// Converts a copy of the SDR image in place, back and forth between the gamuts.
+static void BM_ConvertYuv(benchmark::State& state, ultrahdr_color_gamut srcGamut,
+                          ultrahdr_color_gamut destGamut) {
+  Images& images = getImages(state.range(0), state.range(1));
+  const size_t size = images.width * images.height * 3 / 2;
+  std::unique_ptr<uint8_t[]> data = allocate(size);
+  memcpy(data.get(), images.yuv420Data.get(), size);
+  jpegr_uncompressed_struct image = {data.get(), images.width, images.height, srcGamut,
+                                     data.get() + images.width * images.height, images.width,
+                                     images.width / 2};
+  JpegRStages jpegr;
+  bool forward = true;
+  run(state, [&] {
+    status_t status = forward ? jpegr.convertYuv(&image, srcGamut, destGamut)
+                              : jpegr.convertYuv(&image, destGamut, srcGamut);
+    forward = !forward;
+    return status;
+  });
+}
+BENCHMARK_CAPTURE(BM_ConvertYuv, bt709_p3, ULTRAHDR_COLORGAMUT_BT709, ULTRAHDR_COLORGAMUT_P3)
+        ->Apply(imageSizesAndThreads);
+BENCHMARK_CAPTURE(BM_ConvertYuv, bt709_bt2100, ULTRAHDR_COLORGAMUT_BT709,
+                  ULTRAHDR_COLORGAMUT_BT2100)
+        ->Apply(imageSizesAndThreads);
+BENCHMARK_CAPTURE(BM_ConvertYuv, p3_bt2100, ULTRAHDR_COLORGAMUT_P3, ULTRAHDR_COLORGAMUT_BT2100)
+        ->Apply(imageSizesAndThreads);
+
+} // namespace android::ultrahdr
+
+BENCHMARK_MAIN();
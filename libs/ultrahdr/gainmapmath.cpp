@@ -15,9 +15,20 @@
  */
 
 #include <cmath>
+#include <cstring>
 #include <vector>
 #include <ultrahdr/gainmapmath.h>
 
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define USE_SIMD_ROW_KERNELS 1
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#define USE_SIMD_ROW_KERNELS 1
+#else
+#define USE_SIMD_ROW_KERNELS 0
+#endif
+
 namespace android::ultrahdr {
 
 static const std::vector<float> kPqOETF = [] {
@@ -393,41 +404,71 @@ Color pqInvOetfLUT(Color e_gamma) {
 ////////////////////////////////////////////////////////////////////////////////
 // Color conversions
 
+// The rows of the matrices, which are shared with the SIMD kernels.
+static const float kBt709ToP3[] = {
+   0.82254f,  0.17755f,  0.00006f,
+   0.03312f,  0.96684f, -0.00001f,
+   0.01706f,  0.07240f,  0.91049f,
+};
+
+static const float kBt709ToBt2100[] = {
+   0.62740f,  0.32930f,  0.04332f,
+   0.06904f,  0.91958f,  0.01138f,
+   0.01636f,  0.08799f,  0.89555f,
+};
+
+static const float kP3ToBt709[] = {
+   1.22482f, -0.22490f, -0.00007f,
+  -0.04196f,  1.04199f,  0.00001f,
+  -0.01961f, -0.07865f,  1.09831f,
+};
+
+static const float kP3ToBt2100[] = {
+   0.75378f,  0.19862f,  0.04754f,
+   0.04576f,  0.94177f,  0.01250f,
+  -0.00121f,  0.01757f,  0.98359f,
+};
+
+static const float kBt2100ToBt709[] = {
+   1.66045f, -0.58764f, -0.07286f,
+  -0.12445f,  1.13282f, -0.00837f,
+  -0.01811f, -0.10057f,  1.11878f,
+};
+
+static const float kBt2100ToP3[] = {
+   1.34369f, -0.28223f, -0.06135f,
+  -0.06533f,  1.07580f, -0.01051f,
+   0.00283f, -0.01957f,  1.01679f,
+};
+
+static Color applyGamutConversion(const float* m, Color e) {
+  return {{{ m[0] * e.r + m[1] * e.g + m[2] * e.b,
+             m[3] * e.r + m[4] * e.g + m[5] * e.b,
+             m[6] * e.r + m[7] * e.g + m[8] * e.b }}};
+}
+
 Color bt709ToP3(Color e) {
- return {{{ 0.82254f * e.r + 0.17755f * e.g + 0.00006f * e.b,
-            0.03312f * e.r + 0.96684f * e.g + -0.00001f * e.b,
-            0.01706f * e.r + 0.07240f * e.g + 0.91049f * e.b }}};
+  return applyGamutConversion(kBt709ToP3, e);
 }
 
 Color bt709ToBt2100(Color e) {
- return {{{ 0.62740f * e.r + 0.32930f * e.g + 0.04332f * e.b,
-            0.06904f * e.r + 0.91958f * e.g + 0.01138f * e.b,
-            0.01636f * e.r + 0.08799f * e.g + 0.89555f * e.b }}};
+  return applyGamutConversion(kBt709ToBt2100, e);
 }
 
 Color p3ToBt709(Color e) {
- return {{{ 1.22482f * e.r + -0.22490f * e.g + -0.00007f * e.b,
-            -0.04196f * e.r + 1.04199f * e.g + 0.00001f * e.b,
-            -0.01961f * e.r + -0.07865f * e.g + 1.09831f * e.b }}};
+  return applyGamutConversion(kP3ToBt709, e);
 }
 
 Color p3ToBt2100(Color e) {
- return {{{ 0.75378f * e.r + 0.19862f * e.g + 0.04754f * e.b,
-            0.04576f * e.r + 0.94177f * e.g + 0.01250f * e.b,
-            -0.00121f * e.r + 0.01757f * e.g + 0.98359f * e.b }}};
+  return applyGamutConversion(kP3ToBt2100, e);
 }
 
 Color bt2100ToBt709(Color e) {
- return {{{ 1.66045f * e.r + -0.58764f * e.g + -0.07286f * e.b,
-            -0.12445f * e.r + 1.13282f * e.g + -0.00837f * e.b,
-            -0.01811f * e.r + -0.10057f * e.g + 1.11878f * e.b }}};
+  return applyGamutConversion(kBt2100ToBt709, e);
 }
 
 Color bt2100ToP3(Color e) {
- return {{{ 1.34369f * e.r + -0.28223f * e.g + -0.06135f * e.b,
-            -0.06533f * e.r + 1.07580f * e.g + -0.01051f * e.b,
-            0.00283f * e.r + -0.01957f * e.g + 1.01679f * e.b
- }}};
+  return applyGamutConversion(kBt2100ToP3, e);
 }
 
 // TODO: confirm we always want to convert like this before calculating
@@ -481,40 +522,71 @@ ColorTransformFn getHdrConversionFn(ultrahdr_color_gamut sdr_gamut,
 // file, given that we uses BT.709 encoding for sRGB and BT.601 encoding for Display-P3, to match
 // DataSpace.
 
+// The rows of the matrices, which are shared with the SIMD kernels.
+static const float kYuv709To601[] = {
+   1.000000f,  0.101579f,  0.196076f,
+   0.000000f,  0.989854f, -0.110653f,
+   0.000000f, -0.072453f,  0.983398f,
+};
+
+static const float kYuv709To2100[] = {
+   1.000000f, -0.016969f,  0.096312f,
+   0.000000f,  0.995306f, -0.051192f,
+   0.000000f,  0.011507f,  1.002637f,
+};
+
+static const float kYuv601To709[] = {
+   1.000000f, -0.118188f, -0.212685f,
+   0.000000f,  1.018640f,  0.114618f,
+   0.000000f,  0.075049f,  1.025327f,
+};
+
+static const float kYuv601To2100[] = {
+   1.000000f, -0.128245f, -0.115879f,
+   0.000000f,  1.010016f,  0.061592f,
+   0.000000f,  0.086969f,  1.029350f,
+};
+
+static const float kYuv2100To709[] = {
+   1.000000f,  0.018149f, -0.095132f,
+   0.000000f,  1.004123f,  0.051267f,
+   0.000000f, -0.011524f,  0.996782f,
+};
+
+static const float kYuv2100To601[] = {
+   1.000000f,  0.117887f,  0.105521f,
+   0.000000f,  0.995211f, -0.059549f,
+   0.000000f, -0.084085f,  0.976518f,
+};
+
+static Color applyYuvConversion(const float* m, Color e_gamma) {
+  return {{{ m[0] * e_gamma.y + m[1] * e_gamma.u + m[2] * e_gamma.v,
+             m[3] * e_gamma.y + m[4] * e_gamma.u + m[5] * e_gamma.v,
+             m[6] * e_gamma.y + m[7] * e_gamma.u + m[8] * e_gamma.v }}};
+}
+
 Color yuv709To601(Color e_gamma) {
-  return {{{ 1.0f * e_gamma.y +  0.101579f * e_gamma.u +  0.196076f * e_gamma.v,
-             0.0f * e_gamma.y +  0.989854f * e_gamma.u + -0.110653f * e_gamma.v,
-             0.0f * e_gamma.y + -0.072453f * e_gamma.u +  0.983398f * e_gamma.v }}};
+  return applyYuvConversion(kYuv709To601, e_gamma);
 }
 
 Color yuv709To2100(Color e_gamma) {
-  return {{{ 1.0f * e_gamma.y + -0.016969f * e_gamma.u +  0.096312f * e_gamma.v,
-             0.0f * e_gamma.y +  0.995306f * e_gamma.u + -0.051192f * e_gamma.v,
-             0.0f * e_gamma.y +  0.011507f * e_gamma.u +  1.002637f * e_gamma.v }}};
+  return applyYuvConversion(kYuv709To2100, e_gamma);
 }
 
 Color yuv601To709(Color e_gamma) {
-  return {{{ 1.0f * e_gamma.y + -0.118188f * e_gamma.u + -0.212685f * e_gamma.v,
-             0.0f * e_gamma.y +  1.018640f * e_gamma.u +  0.114618f * e_gamma.v,
-             0.0f * e_gamma.y +  0.075049f * e_gamma.u +  1.025327f * e_gamma.v }}};
+  return applyYuvConversion(kYuv601To709, e_gamma);
 }
 
 Color yuv601To2100(Color e_gamma) {
-  return {{{ 1.0f * e_gamma.y + -0.128245f * e_gamma.u + -0.115879f * e_gamma.v,
-             0.0f * e_gamma.y +  1.010016f * e_gamma.u +  0.061592f * e_gamma.v,
-             0.0f * e_gamma.y +  0.086969f * e_gamma.u +  1.029350f * e_gamma.v }}};
+  return applyYuvConversion(kYuv601To2100, e_gamma);
 }
 
 Color yuv2100To709(Color e_gamma) {
-  return {{{ 1.0f * e_gamma.y +  0.018149f * e_gamma.u + -0.095132f * e_gamma.v,
-             0.0f * e_gamma.y +  1.004123f * e_gamma.u +  0.051267f * e_gamma.v,
-             0.0f * e_gamma.y + -0.011524f * e_gamma.u +  0.996782f * e_gamma.v }}};
+  return applyYuvConversion(kYuv2100To709, e_gamma);
 }
 
 Color yuv2100To601(Color e_gamma) {
-  return {{{ 1.0f * e_gamma.y +  0.117887f * e_gamma.u +  0.105521f * e_gamma.v,
-             0.0f * e_gamma.y +  0.995211f * e_gamma.u + -0.059549f * e_gamma.v,
-             0.0f * e_gamma.y + -0.084085f * e_gamma.u +  0.976518f * e_gamma.v }}};
+  return applyYuvConversion(kYuv2100To601, e_gamma);
 }
 
 void transformYuv420(jr_uncompressed_ptr image, size_t x_chroma, size_t y_chroma,
@@ -772,4 +844,668 @@ uint64_t colorToRgbaF16(Color e_gamma) {
        | (((uint64_t) floatToHalf(1.0f)) << 48);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// SIMD row kernels
+//
+// Each lane of the kernels goes through the same float operations as the scalar functions above,
+// in the same order, so their results are bit-exact. This relies on the build not contracting the
+// multiplications and additions. The tables are looked up one lane at a time.
+
+#if USE_SIMD_ROW_KERNELS
+
+namespace {
+
+#if defined(__ARM_NEON)
+typedef float32x4_t Float4;
+typedef uint8x16_t Bytes16;
+
+inline Float4 splat(float value) { return vdupq_n_f32(value); }
+inline Float4 add(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+inline Float4 sub(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+inline Float4 mul(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+inline Float4 div(Float4 a, Float4 b) { return vdivq_f32(a, b); }
+inline void store(float* dest, Float4 v) { vst1q_f32(dest, v); }
+
+// (v < 0) ? 0 : (v > max) ? max : v, as clampPixelFloat().
+inline Float4 clamp(Float4 v, Float4 max) {
+  const Float4 zero = vdupq_n_f32(0.0f);
+  return vbslq_f32(vcltq_f32(v, zero), zero, vbslq_f32(vcgtq_f32(v, max), max, v));
+}
+
+inline Bytes16 load16(const void* src) { return vld1q_u8(static_cast<const uint8_t*>(src)); }
+inline Bytes16 load8(const void* src) {
+  return vcombine_u8(vld1_u8(static_cast<const uint8_t*>(src)), vdup_n_u8(0));
+}
+inline Bytes16 load4(const void* src) {
+  uint32_t value;
+  memcpy(&value, src, sizeof(value));
+  return vreinterpretq_u8_u32(vsetq_lane_u32(value, vdupq_n_u32(0), 0));
+}
+inline Bytes16 bitwiseOr(Bytes16 a, Bytes16 b) { return vorrq_u8(a, b); }
+
+// Picks the bytes of the table, the bytes of the mask which are 0x80 set the byte to 0.
+inline Bytes16 shuffle(Bytes16 table, const uint8_t* mask) {
+  return vqtbl1q_u8(table, vld1q_u8(mask));
+}
+
+// The lanes of 32 bits of the bytes, as floats.
+inline Float4 toFloat(Bytes16 lanes) { return vcvtq_f32_u32(vreinterpretq_u32_u8(lanes)); }
+// The 10 bits values of P010 lanes of 32 bits.
+inline Bytes16 p010Value(Bytes16 lanes) {
+  return vreinterpretq_u8_u32(vshrq_n_u32(vreinterpretq_u32_u8(lanes), 6));
+}
+
+// CLIP3(static_cast<uint32_t>(v + 0.5), 0, max), with the addition and conversion in double, for
+// v >= 0: v is truncated and rounded up when its fraction, which is exact, is at least 0.5.
+inline void roundIndices(Float4 v, uint32_t max, uint32_t* indices) {
+  const uint32x4_t whole = vcvtq_u32_f32(v);
+  const Float4 fraction = vsubq_f32(v, vcvtq_f32_u32(whole));
+  // The lanes of the comparison are ~0 when true, subtracting them adds 1.
+  const uint32x4_t rounded = vsubq_u32(whole, vcgeq_f32(fraction, vdupq_n_f32(0.5f)));
+  vst1q_u32(indices, vminq_u32(rounded, vdupq_n_u32(max)));
+}
+
+inline Float4 load(const float* src) { return vld1q_f32(src); }
+
+// Lanes of 32 bits unsigned integers, the comparisons are of the values below 2^31.
+typedef uint32x4_t Uint4;
+
+inline Uint4 splatU32(uint32_t value) { return vdupq_n_u32(value); }
+inline Uint4 andU32(Uint4 a, Uint4 b) { return vandq_u32(a, b); }
+inline Uint4 orU32(Uint4 a, Uint4 b) { return vorrq_u32(a, b); }
+inline Uint4 addU32(Uint4 a, Uint4 b) { return vaddq_u32(a, b); }
+inline Uint4 subU32(Uint4 a, Uint4 b) { return vsubq_u32(a, b); }
+inline Uint4 greaterThanU32(Uint4 a, Uint4 b) { return vcgtq_u32(a, b); }
+template <int n> inline Uint4 shiftLeftU32(Uint4 v) { return vshlq_n_u32(v, n); }
+template <int n> inline Uint4 shiftRightU32(Uint4 v) { return vshrq_n_u32(v, n); }
+// static_cast<uint32_t>() of the lanes, for the values below 2^31.
+inline Uint4 truncateToU32(Float4 v) { return vcvtq_u32_f32(v); }
+inline Float4 u32ToFloat(Uint4 v) { return vcvtq_f32_u32(v); }
+inline Uint4 floatBits(Float4 v) { return vreinterpretq_u32_f32(v); }
+inline Float4 bitsToFloat(Uint4 v) { return vreinterpretq_f32_u32(v); }
+inline void storeU32(uint32_t* dest, Uint4 v) { vst1q_u32(dest, v); }
+// Stores a[0], b[0], a[1], b[1]...
+inline void storeInterleavedU32(uint32_t* dest, Uint4 a, Uint4 b) {
+  vst2q_u32(dest, (uint32x4x2_t){{ a, b }});
+}
+#else // __SSE4_1__
+typedef __m128 Float4;
+typedef __m128i Bytes16;
+
+inline Float4 splat(float value) { return _mm_set1_ps(value); }
+inline Float4 add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+inline Float4 sub(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+inline Float4 mul(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+inline Float4 div(Float4 a, Float4 b) { return _mm_div_ps(a, b); }
+inline void store(float* dest, Float4 v) { _mm_storeu_ps(dest, v); }
+
+// (v < 0) ? 0 : (v > max) ? max : v, as clampPixelFloat().
+inline Float4 clamp(Float4 v, Float4 max) {
+  const Float4 zero = _mm_setzero_ps();
+  return _mm_blendv_ps(_mm_blendv_ps(v, max, _mm_cmpgt_ps(v, max)), zero, _mm_cmplt_ps(v, zero));
+}
+
+inline Bytes16 load16(const void* src) {
+  return _mm_loadu_si128(static_cast<const __m128i*>(src));
+}
+inline Bytes16 load8(const void* src) {
+  return _mm_loadl_epi64(static_cast<const __m128i*>(src));
+}
+inline Bytes16 load4(const void* src) {
+  int32_t value;
+  memcpy(&value, src, sizeof(value));
+  return _mm_cvtsi32_si128(value);
+}
+inline Bytes16 bitwiseOr(Bytes16 a, Bytes16 b) { return _mm_or_si128(a, b); }
+
+// Picks the bytes of the table, the bytes of the mask which are 0x80 set the byte to 0.
+inline Bytes16 shuffle(Bytes16 table, const uint8_t* mask) {
+  return _mm_shuffle_epi8(table, _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask)));
+}
+
+// The lanes of 32 bits of the bytes, as floats.
+inline Float4 toFloat(Bytes16 lanes) { return _mm_cvtepi32_ps(lanes); }
+// The 10 bits values of P010 lanes of 32 bits.
+inline Bytes16 p010Value(Bytes16 lanes) { return _mm_srli_epi32(lanes, 6); }
+
+// CLIP3(static_cast<uint32_t>(v + 0.5), 0, max), with the addition and conversion in double, for
+// v >= 0: v is truncated and rounded up when its fraction, which is exact, is at least 0.5.
+inline void roundIndices(Float4 v, uint32_t max, uint32_t* indices) {
+  const __m128i whole = _mm_cvttps_epi32(v);
+  const Float4 fraction = _mm_sub_ps(v, _mm_cvtepi32_ps(whole));
+  // The lanes of the comparison are ~0 when true, subtracting them adds 1.
+  const __m128i rounded =
+          _mm_sub_epi32(whole, _mm_castps_si128(_mm_cmpge_ps(fraction, _mm_set1_ps(0.5f))));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(indices),
+                   _mm_min_epu32(rounded, _mm_set1_epi32(static_cast<int32_t>(max))));
+}
+
+inline Float4 load(const float* src) { return _mm_loadu_ps(src); }
+
+// Lanes of 32 bits unsigned integers, the comparisons are of the values below 2^31.
+typedef __m128i Uint4;
+
+inline Uint4 splatU32(uint32_t value) { return _mm_set1_epi32(static_cast<int32_t>(value)); }
+inline Uint4 andU32(Uint4 a, Uint4 b) { return _mm_and_si128(a, b); }
+inline Uint4 orU32(Uint4 a, Uint4 b) { return _mm_or_si128(a, b); }
+inline Uint4 addU32(Uint4 a, Uint4 b) { return _mm_add_epi32(a, b); }
+inline Uint4 subU32(Uint4 a, Uint4 b) { return _mm_sub_epi32(a, b); }
+inline Uint4 greaterThanU32(Uint4 a, Uint4 b) { return _mm_cmpgt_epi32(a, b); }
+template <int n> inline Uint4 shiftLeftU32(Uint4 v) { return _mm_slli_epi32(v, n); }
+template <int n> inline Uint4 shiftRightU32(Uint4 v) { return _mm_srli_epi32(v, n); }
+// static_cast<uint32_t>() of the lanes, for the values below 2^31.
+inline Uint4 truncateToU32(Float4 v) { return _mm_cvttps_epi32(v); }
+inline Float4 u32ToFloat(Uint4 v) { return _mm_cvtepi32_ps(v); }
+inline Uint4 floatBits(Float4 v) { return _mm_castps_si128(v); }
+inline Float4 bitsToFloat(Uint4 v) { return _mm_castsi128_ps(v); }
+inline void storeU32(uint32_t* dest, Uint4 v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), v);
+}
+// Stores a[0], b[0], a[1], b[1]...
+inline void storeInterleavedU32(uint32_t* dest, Uint4 a, Uint4 b) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpacklo_epi32(a, b));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 4), _mm_unpackhi_epi32(a, b));
+}
+#endif
+
+struct Color4 {
+  union {
+    struct {
+      Float4 r;
+      Float4 g;
+      Float4 b;
+    };
+    struct {
+      Float4 y;
+      Float4 u;
+      Float4 v;
+    };
+  };
+};
+
+// The masks of shuffle() which pick, in each of the 4 lanes of 32 bits:
+constexpr uint8_t Z = 0x80;
+// the byte 4 * lane + offset.
+const uint8_t kEvery4thByte[4][16] = {
+  { 0, Z, Z, Z, 4, Z, Z, Z,  8, Z, Z, Z, 12, Z, Z, Z },
+  { 1, Z, Z, Z, 5, Z, Z, Z,  9, Z, Z, Z, 13, Z, Z, Z },
+  { 2, Z, Z, Z, 6, Z, Z, Z, 10, Z, Z, Z, 14, Z, Z, Z },
+  { 3, Z, Z, Z, 7, Z, Z, Z, 11, Z, Z, Z, 15, Z, Z, Z },
+};
+// the byte 2 * lane + offset.
+const uint8_t kEvery2ndByte[2][16] = {
+  { 0, Z, Z, Z, 2, Z, Z, Z, 4, Z, Z, Z, 6, Z, Z, Z },
+  { 1, Z, Z, Z, 3, Z, Z, Z, 5, Z, Z, Z, 7, Z, Z, Z },
+};
+// the value of 16 bits 4 * lane + offset of 16 values, from their first 8 values for the first 2
+// lanes, and from their last 8 values for the last 2 lanes.
+const uint8_t kEvery4thHalfLow[4][16] = {
+  { 0, 1, Z, Z,  8,  9, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z },
+  { 2, 3, Z, Z, 10, 11, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z },
+  { 4, 5, Z, Z, 12, 13, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z },
+  { 6, 7, Z, Z, 14, 15, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z },
+};
+const uint8_t kEvery4thHalfHigh[4][16] = {
+  { Z, Z, Z, Z, Z, Z, Z, Z, 0, 1, Z, Z,  8,  9, Z, Z },
+  { Z, Z, Z, Z, Z, Z, Z, Z, 2, 3, Z, Z, 10, 11, Z, Z },
+  { Z, Z, Z, Z, Z, Z, Z, Z, 4, 5, Z, Z, 12, 13, Z, Z },
+  { Z, Z, Z, Z, Z, Z, Z, Z, 6, 7, Z, Z, 14, 15, Z, Z },
+};
+// the byte 4 * offset + lane.
+const uint8_t kConsecutiveBytes[4][16] = {
+  {  0, Z, Z, Z,  1, Z, Z, Z,  2, Z, Z, Z,  3, Z, Z, Z },
+  {  4, Z, Z, Z,  5, Z, Z, Z,  6, Z, Z, Z,  7, Z, Z, Z },
+  {  8, Z, Z, Z,  9, Z, Z, Z, 10, Z, Z, Z, 11, Z, Z, Z },
+  { 12, Z, Z, Z, 13, Z, Z, Z, 14, Z, Z, Z, 15, Z, Z, Z },
+};
+// the byte 2 * offset + lane / 2.
+const uint8_t kDoubledBytes[4][16] = {
+  { 0, Z, Z, Z, 0, Z, Z, Z, 1, Z, Z, Z, 1, Z, Z, Z },
+  { 2, Z, Z, Z, 2, Z, Z, Z, 3, Z, Z, Z, 3, Z, Z, Z },
+  { 4, Z, Z, Z, 4, Z, Z, Z, 5, Z, Z, Z, 5, Z, Z, Z },
+  { 6, Z, Z, Z, 6, Z, Z, Z, 7, Z, Z, Z, 7, Z, Z, Z },
+};
+
+// The value of 16 bits 4 * lane + offset of the 16 values of src.
+inline Float4 loadEvery4thP010Value(const uint16_t* src, size_t offset) {
+  const Bytes16 low = shuffle(load16(src), kEvery4thHalfLow[offset]);
+  const Bytes16 high = shuffle(load16(src + 8), kEvery4thHalfHigh[offset]);
+  return toFloat(p010Value(bitwiseOr(low, high)));
+}
+
+// sampleYuv420() of the 4 map pixels from x, with a map scale factor of 4.
+Color4 sampleYuv420x4(jr_uncompressed_ptr image, size_t x, size_t y) {
+  const uint8_t* luma_data = reinterpret_cast<uint8_t*>(image->data);
+  const size_t luma_stride = image->luma_stride;
+  const uint8_t* chroma_data = reinterpret_cast<uint8_t*>(image->chroma_data);
+  const size_t chroma_stride = image->chroma_stride;
+  const size_t offset_cr = chroma_stride * (image->height / 2);
+
+  const Float4 k255 = splat(255.0f);
+  const Float4 k128 = splat(128.0f);
+  Color4 e = {{{ splat(0.0f), splat(0.0f), splat(0.0f) }}};
+  for (size_t dy = 0; dy < 4; ++dy) {
+    const size_t image_y = y * 4 + dy;
+    const size_t pixel_chroma_idx = x * 2 + (image_y / 2) * chroma_stride;
+    const Bytes16 y_uint = load16(luma_data + x * 4 + image_y * luma_stride);
+    const Bytes16 u_uint = load8(chroma_data + pixel_chroma_idx);
+    const Bytes16 v_uint = load8(chroma_data + offset_cr + pixel_chroma_idx);
+    for (size_t dx = 0; dx < 4; ++dx) {
+      e.y = add(e.y, div(toFloat(shuffle(y_uint, kEvery4thByte[dx])), k255));
+      e.u = add(e.u, div(sub(toFloat(shuffle(u_uint, kEvery2ndByte[dx / 2])), k128), k255));
+      e.v = add(e.v, div(sub(toFloat(shuffle(v_uint, kEvery2ndByte[dx / 2])), k128), k255));
+    }
+  }
+
+  const Float4 k16 = splat(16.0f);
+  return {{{ div(e.y, k16), div(e.u, k16), div(e.v, k16) }}};
+}
+
+// sampleP010() of the 4 map pixels from x, with a map scale factor of 4.
+Color4 sampleP010x4(jr_uncompressed_ptr image, size_t x, size_t y) {
+  const uint16_t* luma_data = reinterpret_cast<uint16_t*>(image->data);
+  const size_t luma_stride = image->luma_stride == 0 ? image->width : image->luma_stride;
+  const uint16_t* chroma_data = reinterpret_cast<uint16_t*>(image->chroma_data);
+  const size_t chroma_stride = image->chroma_stride;
+
+  const Float4 k64 = splat(64.0f);
+  const Float4 k876 = splat(876.0f);
+  const Float4 k896 = splat(896.0f);
+  const Float4 kHalf = splat(0.5f);
+  Color4 e = {{{ splat(0.0f), splat(0.0f), splat(0.0f) }}};
+  for (size_t dy = 0; dy < 4; ++dy) {
+    const size_t image_y = y * 4 + dy;
+    const uint16_t* luma_row = luma_data + image_y * luma_stride + x * 4;
+    // The U and V values of the pixel pairs of the 16 pixels.
+    const uint16_t* chroma_row = chroma_data + (image_y >> 1) * chroma_stride + x * 4;
+    for (size_t dx = 0; dx < 4; ++dx) {
+      const size_t u_offset = dx & ~0x1;
+      const Float4 y_uint = loadEvery4thP010Value(luma_row, dx);
+      const Float4 u_uint = loadEvery4thP010Value(chroma_row, u_offset);
+      const Float4 v_uint = loadEvery4thP010Value(chroma_row, u_offset + 1);
+      e.y = add(e.y, div(sub(y_uint, k64), k876));
+      e.u = add(e.u, sub(div(sub(u_uint, k64), k896), kHalf));
+      e.v = add(e.v, sub(div(sub(v_uint, k64), k896), kHalf));
+    }
+  }
+
+  const Float4 k16 = splat(16.0f);
+  return {{{ div(e.y, k16), div(e.u, k16), div(e.v, k16) }}};
+}
+
+// The coefficients of srgbYuvToRgb(), p3YuvToRgb() and bt2100YuvToRgb().
+struct YuvToRgbCoeffs {
+  float cr, gCb, gCr, cb;
+};
+
+bool getYuvToRgbCoeffs(ColorTransformFn fn, YuvToRgbCoeffs* coeffs) {
+  if (fn == srgbYuvToRgb) {
+    *coeffs = { kSrgbCr, kSrgbGCb, kSrgbGCr, kSrgbCb };
+  } else if (fn == p3YuvToRgb) {
+    *coeffs = { kP3Cr, kP3GCb, kP3GCr, kP3Cb };
+  } else if (fn == bt2100YuvToRgb) {
+    *coeffs = { kBt2100Cr, kBt2100GCb, kBt2100GCr, kBt2100Cb };
+  } else {
+    return false;
+  }
+  return true;
+}
+
+Color4 yuvToRgb(Color4 e_gamma, const YuvToRgbCoeffs& coeffs) {
+  const Float4 one = splat(kMaxPixelFloat);
+  return {{{ clamp(add(e_gamma.y, mul(splat(coeffs.cr), e_gamma.v)), one),
+             clamp(sub(sub(e_gamma.y, mul(splat(coeffs.gCb), e_gamma.u)),
+                       mul(splat(coeffs.gCr), e_gamma.v)), one),
+             clamp(add(e_gamma.y, mul(splat(coeffs.cb), e_gamma.u)), one) }}};
+}
+
+// The coefficients of srgbLuminance(), p3Luminance() and bt2100Luminance().
+bool getLuminanceCoeffs(ColorCalculationFn fn, float coeffs[3]) {
+  if (fn == srgbLuminance) {
+    coeffs[0] = kSrgbR; coeffs[1] = kSrgbG; coeffs[2] = kSrgbB;
+  } else if (fn == p3Luminance) {
+    coeffs[0] = kP3R; coeffs[1] = kP3G; coeffs[2] = kP3B;
+  } else if (fn == bt2100Luminance) {
+    coeffs[0] = kBt2100R; coeffs[1] = kBt2100G; coeffs[2] = kBt2100B;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+Float4 luminance(Color4 e, const float coeffs[3]) {
+  return add(add(mul(splat(coeffs[0]), e.r), mul(splat(coeffs[1]), e.g)),
+             mul(splat(coeffs[2]), e.b));
+}
+
+// The tables of the LUT transfer functions, or null for the others.
+const std::vector<float>* getTransferFunctionTable(ColorTransformFn fn) {
+  if (fn == static_cast<ColorTransformFn>(srgbInvOetfLUT)) return &kSrgbInvOETF;
+  if (fn == static_cast<ColorTransformFn>(hlgInvOetfLUT)) return &kHlgInvOETF;
+  if (fn == static_cast<ColorTransformFn>(pqInvOetfLUT)) return &kPqInvOETF;
+  if (fn == static_cast<ColorTransformFn>(hlgOetfLUT)) return &kHlgOETF;
+  if (fn == static_cast<ColorTransformFn>(pqOetfLUT)) return &kPqOETF;
+  return nullptr;
+}
+
+Float4 lookUp(const std::vector<float>& table, Float4 e) {
+  const uint32_t max = static_cast<uint32_t>(table.size() - 1);
+  uint32_t indices[4];
+  roundIndices(mul(e, splat(static_cast<float>(max))), max, indices);
+  const float values[4] = { table[indices[0]], table[indices[1]], table[indices[2]],
+                            table[indices[3]] };
+  return load(values);
+}
+
+Color4 lookUp(const std::vector<float>& table, Color4 e) {
+  return {{{ lookUp(table, e.r), lookUp(table, e.g), lookUp(table, e.b) }}};
+}
+
+// The matrices of the gamut conversions, or null for identityConversion().
+bool getGamutConversion(ColorTransformFn fn, const float** matrix) {
+  if (fn == identityConversion) *matrix = nullptr;
+  else if (fn == bt709ToP3) *matrix = kBt709ToP3;
+  else if (fn == bt709ToBt2100) *matrix = kBt709ToBt2100;
+  else if (fn == p3ToBt709) *matrix = kP3ToBt709;
+  else if (fn == p3ToBt2100) *matrix = kP3ToBt2100;
+  else if (fn == bt2100ToBt709) *matrix = kBt2100ToBt709;
+  else if (fn == bt2100ToP3) *matrix = kBt2100ToP3;
+  else return false;
+  return true;
+}
+
+Color4 applyGamutConversion(const float* m, Color4 e) {
+  if (m == nullptr) return e;
+  return {{{ add(add(mul(splat(m[0]), e.r), mul(splat(m[1]), e.g)), mul(splat(m[2]), e.b)),
+             add(add(mul(splat(m[3]), e.r), mul(splat(m[4]), e.g)), mul(splat(m[5]), e.b)),
+             add(add(mul(splat(m[6]), e.r), mul(splat(m[7]), e.g)), mul(splat(m[8]), e.b)) }}};
+}
+
+// The matrices of the YUV conversions.
+bool getYuvConversion(ColorTransformFn fn, const float** matrix) {
+  if (fn == yuv709To601) *matrix = kYuv709To601;
+  else if (fn == yuv709To2100) *matrix = kYuv709To2100;
+  else if (fn == yuv601To709) *matrix = kYuv601To709;
+  else if (fn == yuv601To2100) *matrix = kYuv601To2100;
+  else if (fn == yuv2100To709) *matrix = kYuv2100To709;
+  else if (fn == yuv2100To601) *matrix = kYuv2100To601;
+  else return false;
+  return true;
+}
+
+// getYuv420Pixel() of the 16 pixels from x, in 4 colors of 4 pixels.
+void getYuv420Pixelsx16(jr_uncompressed_ptr image, size_t x, size_t y, Color4 e_gamma[4]) {
+  const uint8_t* luma_data = reinterpret_cast<uint8_t*>(image->data);
+  const uint8_t* chroma_data = reinterpret_cast<uint8_t*>(image->chroma_data);
+  const size_t chroma_stride = image->chroma_stride;
+  const size_t offset_cr = chroma_stride * (image->height / 2);
+  const size_t pixel_chroma_idx = x / 2 + (y / 2) * chroma_stride;
+
+  const Bytes16 y_uint = load16(luma_data + x + y * image->luma_stride);
+  const Bytes16 u_uint = load8(chroma_data + pixel_chroma_idx);
+  const Bytes16 v_uint = load8(chroma_data + offset_cr + pixel_chroma_idx);
+  const Float4 k255 = splat(255.0f);
+  const Float4 k128 = splat(128.0f);
+  for (size_t i = 0; i < 4; ++i) {
+    e_gamma[i].y = div(toFloat(shuffle(y_uint, kConsecutiveBytes[i])), k255);
+    e_gamma[i].u = div(sub(toFloat(shuffle(u_uint, kDoubledBytes[i])), k128), k255);
+    e_gamma[i].v = div(sub(toFloat(shuffle(v_uint, kDoubledBytes[i])), k128), k255);
+  }
+}
+
+// The weights of the 4 pixels of the row of a map pixel, from its weight table: the lanes of each
+// of the 4 vectors are one weight of the 4 pixels.
+struct MapWeights4 {
+  Float4 w[4];
+};
+
+MapWeights4 getMapWeights4(const float* weights) {
+  MapWeights4 result;
+  for (size_t i = 0; i < 4; ++i) {
+    const float w[4] = { weights[i], weights[4 + i], weights[8 + i], weights[12 + i] };
+    result.w[i] = load(w);
+  }
+  return result;
+}
+
+// sampleMap() of the weight tables for the 4 pixels of the map pixel x_lower, in the row of the
+// map pixels y_lower and y_upper.
+Float4 sampleMapx4(const uint8_t* map_data, int map_width, int x_lower, int y_lower, int y_upper,
+                   const MapWeights4& weights) {
+  const int x_upper = std::min(x_lower + 1, map_width - 1);
+  const float e1 = mapUintToFloat(map_data[x_lower + y_lower * map_width]);
+  const float e2 = mapUintToFloat(map_data[x_lower + y_upper * map_width]);
+  const float e3 = mapUintToFloat(map_data[x_upper + y_lower * map_width]);
+  const float e4 = mapUintToFloat(map_data[x_upper + y_upper * map_width]);
+  return add(add(add(mul(splat(e1), weights.w[0]), mul(splat(e2), weights.w[1])),
+                 mul(splat(e3), weights.w[2])),
+             mul(splat(e4), weights.w[3]));
+}
+
+// GainLUT::getGainFactor() of the lanes.
+Float4 getGainFactors(const float* gainFactors, Float4 gain) {
+  const uint32_t max = static_cast<uint32_t>(kGainFactorNumEntries - 1);
+  uint32_t indices[4];
+  roundIndices(mul(gain, splat(static_cast<float>(max))), max, indices);
+  const float values[4] = { gainFactors[indices[0]], gainFactors[indices[1]],
+                            gainFactors[indices[2]], gainFactors[indices[3]] };
+  return load(values);
+}
+
+// floatToHalf() of the lanes, in their low 16 bits.
+Uint4 floatToHalfx4(Float4 f) {
+  const Uint4 b = addU32(floatBits(f), splatU32(0x00001000));
+
+  const Uint4 e = shiftRightU32<23>(andU32(b, splatU32(0x7F800000)));
+  const Uint4 m = andU32(b, splatU32(0x007FFFFF));
+
+  const Uint4 sign = shiftRightU32<16>(andU32(b, splatU32(0x80000000)));
+  const Uint4 normalized =
+          andU32(greaterThanU32(e, splatU32(112)),
+                 orU32(andU32(shiftLeftU32<10>(subU32(e, splatU32(112))), splatU32(0x7C00)),
+                       shiftRightU32<13>(m)));
+  // The shift right of 0x007FF000 + m, which is below 2^24, by 125 - e is the truncation of its
+  // product by the float 2^(e - 125), both of which are exact.
+  const Float4 scale = bitsToFloat(shiftLeftU32<23>(addU32(e, splatU32(2))));
+  const Uint4 shifted = truncateToU32(mul(u32ToFloat(addU32(splatU32(0x007FF000), m)), scale));
+  const Uint4 denormalized =
+          andU32(andU32(greaterThanU32(splatU32(113), e), greaterThanU32(e, splatU32(101))),
+                 shiftRightU32<1>(addU32(shifted, splatU32(1))));
+  const Uint4 saturated = andU32(greaterThanU32(e, splatU32(143)), splatU32(0x7FFF));
+  return orU32(orU32(sign, normalized), orU32(denormalized, saturated));
+}
+
+// colorToRgbaF16() of the 4 pixels.
+void storeRgbaF16(uint64_t* dest, Color4 e) {
+  const Uint4 alpha = splatU32(static_cast<uint32_t>(floatToHalf(1.0f)) << 16);
+  const Uint4 rg = orU32(floatToHalfx4(e.r), shiftLeftU32<16>(floatToHalfx4(e.g)));
+  const Uint4 ba = orU32(floatToHalfx4(e.b), alpha);
+  storeInterleavedU32(reinterpret_cast<uint32_t*>(dest), rg, ba);
+}
+
+// colorToRgba1010102() of the 4 pixels.
+void storeRgba1010102(uint32_t* dest, Color4 e_gamma) {
+  const Float4 k1023 = splat(1023.0f);
+  const Uint4 mask = splatU32(0x3ff);
+  const Uint4 r = andU32(mask, truncateToU32(mul(e_gamma.r, k1023)));
+  const Uint4 g = andU32(mask, truncateToU32(mul(e_gamma.g, k1023)));
+  const Uint4 b = andU32(mask, truncateToU32(mul(e_gamma.b, k1023)));
+  storeU32(dest, orU32(orU32(r, shiftLeftU32<10>(g)),
+                       orU32(shiftLeftU32<20>(b), splatU32(0x3u << 30))));
+}
+
+// The bytes CLIP3(v * 255 + offset + 0.5, 0, 255) of the 4 lanes, every step bytes from dest.
+void storeBytes(uint8_t* dest, size_t step, Float4 v, float offset) {
+  const Float4 k255 = splat(255.0f);
+  uint32_t values[4];
+  storeU32(values, truncateToU32(clamp(add(add(mul(v, k255), splat(offset)), splat(0.5f)), k255)));
+  for (size_t i = 0; i < 4; ++i) {
+    dest[i * step] = static_cast<uint8_t>(values[i]);
+  }
+}
+
+} // namespace
+
+size_t generateGainMapRow(jr_uncompressed_ptr yuv420_image, jr_uncompressed_ptr p010_image,
+                          const GainMapGenerationFns& fns, ultrahdr_metadata_ptr metadata,
+                          size_t y, size_t width, uint8_t* dest) {
+  static_assert(kMapDimensionScaleFactor == 4, "the kernels sample blocks of 4x4 pixels");
+  YuvToRgbCoeffs sdrYuvToRgb, hdrYuvToRgb;
+  float luminanceCoeffs[3];
+  const float* hdrGamutConversion;
+  const std::vector<float>* sdrInvOetfTable = getTransferFunctionTable(fns.sdrInvOetf);
+  const std::vector<float>* hdrInvOetfTable = getTransferFunctionTable(fns.hdrInvOetf);
+  if (!getYuvToRgbCoeffs(fns.sdrYuvToRgbFn, &sdrYuvToRgb) ||
+      !getYuvToRgbCoeffs(fns.hdrYuvToRgbFn, &hdrYuvToRgb) ||
+      !getLuminanceCoeffs(fns.luminanceFn, luminanceCoeffs) ||
+      !getGamutConversion(fns.hdrGamutConversionFn, &hdrGamutConversion) ||
+      sdrInvOetfTable == nullptr ||
+      (hdrInvOetfTable == nullptr && fns.hdrInvOetf != identityConversion)) {
+    return 0;
+  }
+
+  const size_t count = width & ~static_cast<size_t>(3);
+  for (size_t x = 0; x < count; x += 4) {
+    Color4 sdr_yuv_gamma = sampleYuv420x4(yuv420_image, x, y);
+    Color4 sdr_rgb_gamma = yuvToRgb(sdr_yuv_gamma, sdrYuvToRgb);
+    Color4 sdr_rgb = lookUp(*sdrInvOetfTable, sdr_rgb_gamma);
+    Float4 sdr_y_nits = mul(luminance(sdr_rgb, luminanceCoeffs), splat(kSdrWhiteNits));
+
+    Color4 hdr_yuv_gamma = sampleP010x4(p010_image, x, y);
+    Color4 hdr_rgb_gamma = yuvToRgb(hdr_yuv_gamma, hdrYuvToRgb);
+    Color4 hdr_rgb = hdrInvOetfTable != nullptr ? lookUp(*hdrInvOetfTable, hdr_rgb_gamma)
+                                                : hdr_rgb_gamma;
+    hdr_rgb = applyGamutConversion(hdrGamutConversion, hdr_rgb);
+    Float4 hdr_y_nits = mul(luminance(hdr_rgb, luminanceCoeffs), splat(fns.hdrWhiteNits));
+
+    float sdr_nits[4], hdr_nits[4];
+    store(sdr_nits, sdr_y_nits);
+    store(hdr_nits, hdr_y_nits);
+    for (size_t i = 0; i < 4; ++i) {
+      dest[x + i] = encodeGain(sdr_nits[i], hdr_nits[i], metadata, fns.log2MinBoost,
+                               fns.log2MaxBoost);
+    }
+  }
+  return count;
+}
+
+size_t applyGainMapRow(jr_uncompressed_ptr yuv420_image, size_t first_row,
+                       jr_uncompressed_ptr gainmap_image, const GainMapApplicationFns& fns,
+                       ShepardsIDW& weightTables, size_t y, size_t width, void* dest) {
+  static_assert(kMapDimensionScaleFactor == 4, "the kernels upsample the map by 4");
+  YuvToRgbCoeffs sdrYuvToRgb;
+  const std::vector<float>* sdrInvOetfTable = getTransferFunctionTable(fns.sdrInvOetf);
+  const bool linearOutput = fns.outputFormat == ULTRAHDR_OUTPUT_HDR_LINEAR;
+  const std::vector<float>* hdrOetfTable =
+          linearOutput ? nullptr : getTransferFunctionTable(fns.hdrOetf);
+  if (!getYuvToRgbCoeffs(fns.sdrYuvToRgbFn, &sdrYuvToRgb) || sdrInvOetfTable == nullptr ||
+      fns.gainLUT == nullptr || (!linearOutput && hdrOetfTable == nullptr) ||
+      (!linearOutput && fns.outputFormat != ULTRAHDR_OUTPUT_HDR_HLG &&
+       fns.outputFormat != ULTRAHDR_OUTPUT_HDR_PQ)) {
+    return 0;
+  }
+
+  // The pixels of the row share the map rows, and the weights of the map pixels but the last one.
+  const int map_width = gainmap_image->width;
+  const int y_lower = std::min(static_cast<int>(y / kMapDimensionScaleFactor),
+                               gainmap_image->height - 1);
+  const int y_upper = std::min(static_cast<int>(y / kMapDimensionScaleFactor) + 1,
+                               gainmap_image->height - 1);
+  const size_t weights_offset = (y % kMapDimensionScaleFactor) * kMapDimensionScaleFactor * 4;
+  const bool no_bottom = y_lower == y_upper;
+  const MapWeights4 weights = getMapWeights4(
+          (no_bottom ? weightTables.mWeightsNB : weightTables.mWeights) + weights_offset);
+  const MapWeights4 last_weights = getMapWeights4(
+          (no_bottom ? weightTables.mWeightsC : weightTables.mWeightsNR) + weights_offset);
+  const uint8_t* map_data = reinterpret_cast<uint8_t*>(gainmap_image->data);
+  const float* gainFactors = fns.gainLUT->getGainFactors();
+  const Float4 displayBoost = splat(fns.displayBoost);
+
+  const size_t count = width & ~static_cast<size_t>(15);
+  for (size_t x = 0; x < count; x += 16) {
+    Color4 sdr_yuv_gamma[4];
+    getYuv420Pixelsx16(yuv420_image, x, y - first_row, sdr_yuv_gamma);
+    for (size_t i = 0; i < 4; ++i) {
+      const size_t pixel_x = x + i * 4;
+      Color4 rgb_gamma_sdr = yuvToRgb(sdr_yuv_gamma[i], sdrYuvToRgb);
+      Color4 rgb_sdr = lookUp(*sdrInvOetfTable, rgb_gamma_sdr);
+
+      const int x_lower = static_cast<int>(pixel_x / kMapDimensionScaleFactor);
+      Float4 gain = sampleMapx4(map_data, map_width, x_lower, y_lower, y_upper,
+                                x_lower == map_width - 1 ? last_weights : weights);
+      Float4 gainFactor = getGainFactors(gainFactors, gain);
+      Color4 rgb_hdr = {{{ div(mul(rgb_sdr.r, gainFactor), displayBoost),
+                           div(mul(rgb_sdr.g, gainFactor), displayBoost),
+                           div(mul(rgb_sdr.b, gainFactor), displayBoost) }}};
+
+      if (linearOutput) {
+        storeRgbaF16(reinterpret_cast<uint64_t*>(dest) + pixel_x, rgb_hdr);
+      } else {
+        storeRgba1010102(reinterpret_cast<uint32_t*>(dest) + pixel_x,
+                         lookUp(*hdrOetfTable, rgb_hdr));
+      }
+    }
+  }
+  return count;
+}
+
+size_t transformYuv420Row(jr_uncompressed_ptr image, size_t y_chroma, ColorTransformFn fn) {
+  const float* matrix;
+  if (!getYuvConversion(fn, &matrix)) {
+    return 0;
+  }
+
+  uint8_t* luma_data = reinterpret_cast<uint8_t*>(image->data);
+  uint8_t* chroma_data = reinterpret_cast<uint8_t*>(image->chroma_data);
+  uint8_t* luma_rows[2] = { luma_data + y_chroma * 2 * image->luma_stride,
+                            luma_data + (y_chroma * 2 + 1) * image->luma_stride };
+  uint8_t* u_row = chroma_data + y_chroma * image->chroma_stride;
+  uint8_t* v_row = u_row + image->chroma_stride * image->height / 2;
+  const Float4 k255 = splat(255.0f);
+  const Float4 k128 = splat(128.0f);
+
+  const size_t count = (image->width / 2) & ~static_cast<size_t>(3);
+  for (size_t x = 0; x < count; x += 4) {
+    const Float4 u = div(sub(toFloat(shuffle(load4(u_row + x), kConsecutiveBytes[0])), k128),
+                         k255);
+    const Float4 v = div(sub(toFloat(shuffle(load4(v_row + x), kConsecutiveBytes[0])), k128),
+                         k255);
+    // The pixels of transformYuv420(), in its order: the even and odd columns of the 2 rows.
+    Color4 yuv[4];
+    for (size_t dy = 0; dy < 2; ++dy) {
+      const Bytes16 y_uint = load8(luma_rows[dy] + x * 2);
+      for (size_t dx = 0; dx < 2; ++dx) {
+        Color4 e_gamma = {{{ div(toFloat(shuffle(y_uint, kEvery2ndByte[dx])), k255), u, v }}};
+        yuv[dy * 2 + dx] = applyGamutConversion(matrix, e_gamma);
+        storeBytes(luma_rows[dy] + x * 2 + dx, 2, yuv[dy * 2 + dx].y, 0.0f);
+      }
+    }
+
+    const Float4 k4 = splat(4.0f);
+    storeBytes(u_row + x, 1, div(add(add(add(yuv[0].u, yuv[1].u), yuv[2].u), yuv[3].u), k4),
+               128.0f);
+    storeBytes(v_row + x, 1, div(add(add(add(yuv[0].v, yuv[1].v), yuv[2].v), yuv[3].v), k4),
+               128.0f);
+  }
+  return count;
+}
+
+#else // !USE_SIMD_ROW_KERNELS
+
+size_t generateGainMapRow(jr_uncompressed_ptr, jr_uncompressed_ptr, const GainMapGenerationFns&,
+                          ultrahdr_metadata_ptr, size_t, size_t, uint8_t*) {
+  return 0;
+}
+
+size_t applyGainMapRow(jr_uncompressed_ptr, size_t, jr_uncompressed_ptr,
+                       const GainMapApplicationFns&, ShepardsIDW&, size_t, size_t, void*) {
+  return 0;
+}
+
+size_t transformYuv420Row(jr_uncompressed_ptr, size_t, ColorTransformFn) {
+  return 0;
+}
+
+#endif // USE_SIMD_ROW_KERNELS
+
 } // namespace android::ultrahdr
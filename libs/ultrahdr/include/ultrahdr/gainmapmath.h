@@ -178,6 +178,9 @@ struct GainLUT {
     return mGainTable[idx];
   }
 
+  // The gain factors of the gains from 0 to 1, in kGainFactorNumEntries steps.
+  const float* getGainFactors() const { return mGainTable; }
+
 private:
   float mGainTable[kGainFactorNumEntries];
 };
@@ -424,6 +427,15 @@ Color yuv2100To601(Color e_gamma);
 void transformYuv420(jr_uncompressed_ptr image, size_t x_chroma, size_t y_chroma,
                      ColorTransformFn fn);
 
+/*
+ * Performs transformYuv420() at the first chroma pixels of the row y_chroma, with SIMD kernels
+ * which give the same pixels, for one of the YUV conversions above.
+ *
+ * Returns the number of chroma pixels transformed, the others are left to the caller. It is 0 when
+ * the kernels are not available for the CPU or for the conversion.
+ */
+size_t transformYuv420Row(jr_uncompressed_ptr image, size_t y_chroma, ColorTransformFn fn);
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // Gain map calculations
@@ -486,6 +498,34 @@ float sampleMap(jr_uncompressed_ptr map, float map_scale_factor, size_t x, size_
 float sampleMap(jr_uncompressed_ptr map, size_t map_scale_factor, size_t x, size_t y,
                 ShepardsIDW& weightTables);
 
+/*
+ * The conversions of the gain map generation, from the pixels of the SDR and HDR images to their
+ * luminances.
+ */
+struct GainMapGenerationFns {
+  ColorTransformFn sdrYuvToRgbFn;
+  ColorTransformFn sdrInvOetf;
+  ColorCalculationFn luminanceFn;
+  ColorTransformFn hdrYuvToRgbFn;
+  ColorTransformFn hdrInvOetf;
+  ColorTransformFn hdrGamutConversionFn;
+  float hdrWhiteNits;
+  float log2MinBoost;
+  float log2MaxBoost;
+};
+
+/*
+ * Generate the gain values of the first pixels of the row y of the map, with SIMD kernels which
+ * give the same values as encodeGain() of the luminances of sampleYuv420() and sampleP010()
+ * through the conversions, for a map scale factor of kMapDimensionScaleFactor.
+ *
+ * Returns the number of pixels generated, the others are left to the caller. It is 0 when the
+ * kernels are not available for the CPU or for one of the conversions.
+ */
+size_t generateGainMapRow(jr_uncompressed_ptr yuv420_image, jr_uncompressed_ptr p010_image,
+                          const GainMapGenerationFns& fns, ultrahdr_metadata_ptr metadata,
+                          size_t y, size_t width, uint8_t* dest);
+
 /*
  * Convert from Color to RGBA1010102.
  *
@@ -500,6 +540,37 @@ uint32_t colorToRgba1010102(Color e_gamma);
  */
 uint64_t colorToRgbaF16(Color e_gamma);
 
+/*
+ * The conversions of the gain map application, from the pixels of the SDR image to the output.
+ */
+struct GainMapApplicationFns {
+  ColorTransformFn sdrYuvToRgbFn;
+  ColorTransformFn sdrInvOetf;
+  // Null when the gain is applied without the LUT.
+  GainLUT* gainLUT;
+  float displayBoost;
+  ultrahdr_output_format outputFormat;
+  // The OETF of the HLG and PQ outputs.
+  ColorTransformFn hdrOetf;
+};
+
+/*
+ * Apply the gain map to the first pixels of the row y of the SDR image, with SIMD kernels which
+ * give the same pixels as the conversions, applyGainLUT() of the sampleMap() of the weight tables
+ * divided by the display boost, and colorToRgbaF16() or colorToRgba1010102() for the output format,
+ * for a map scale factor of kMapDimensionScaleFactor. The pixels of dest are uint64_t for
+ * ULTRAHDR_OUTPUT_HDR_LINEAR and uint32_t otherwise.
+ *
+ * yuv420_image holds a strip of the rows of the SDR image from its row first_row, which is even,
+ * and the gain map covers the whole image.
+ *
+ * Returns the number of pixels written, the others are left to the caller. It is 0 when the
+ * kernels are not available for the CPU or for one of the conversions.
+ */
+size_t applyGainMapRow(jr_uncompressed_ptr yuv420_image, size_t first_row,
+                       jr_uncompressed_ptr gainmap_image, const GainMapApplicationFns& fns,
+                       ShepardsIDW& weightTables, size_t y, size_t width, void* dest);
+
 } // namespace android::ultrahdr
 
 #endif // ANDROID_ULTRAHDR_RECOVERYMAPMATH_H
@@ -24,6 +24,7 @@ extern "C" {
 #include <jpeglib.h>
 }
 #include <utils/Errors.h>
+#include <memory>
 #include <vector>
 
 // constraint on max width and max height is only due to device alloc constraints
@@ -111,9 +112,42 @@ public:
     bool getCompressedImageParameters(const void* image, int length, size_t* pWidth,
                                       size_t* pHeight, std::vector<uint8_t>* iccData,
                                       std::vector<uint8_t>* exifData);
+    /*
+     * Starts decompressing a YUV420 JPEG image to raw YUV420 planar format in strips of
+     * stripHeight rows, rounded up to a multiple of the MCU height of 16 rows, so that only a
+     * strip of the image is held at once. After calling this method, call decompressRows() for
+     * each strip. The dimensions, the XMP, EXIF and ICC data are available right away. The image
+     * must stay valid until all of the rows are decompressed.
+     * Returns false if the image can not be decompressed to YUV420.
+     */
+    bool startDecompressRows(const void* image, int length, size_t stripHeight);
+    /*
+     * Decompresses the next strip of rows of the image started by startDecompressRows(), and sets
+     * rowCount to its number of rows, which is 0 once all of the rows are decompressed.
+     * Returns false if decompressing the rows fails.
+     */
+    bool decompressRows(size_t* rowCount);
+    /*
+     * Returns the buffer of the last strip of decompressed rows: the Y plane of
+     * getDecompressedRowsStride() bytes per row, followed by the U and V planes of half of the
+     * rows of half of the stride, with room for the rows of a whole strip in each plane.
+     */
+    void* getDecompressedRowsPtr();
+    /*
+     * Returns the bytes per row of the Y plane of the strips of decompressed rows.
+     */
+    size_t getDecompressedRowsStride();
+    /*
+     * Returns the rows for which each plane of the strips of decompressed rows has room.
+     */
+    size_t getDecompressedRowsCapacity();
 
 private:
+    struct RowDecompression;
+
     bool decode(const void* image, int length, bool decodeToRGBA);
+    // Saves the XMP, EXIF and ICC data of the markers of the image.
+    void saveMetadata(jpeg_decompress_struct* cinfo);
     // Returns false if errors occur.
     bool decompress(jpeg_decompress_struct* cinfo, const uint8_t* dest, bool isSingleChannel);
     bool decompressYUV(jpeg_decompress_struct* cinfo, const uint8_t* dest);
@@ -137,6 +171,13 @@ private:
 
     // Position of EXIF package, default value is -1 which means no EXIF package appears.
     ssize_t mExifPos = -1;
+
+    // The state of startDecompressRows(), until all of the rows are decompressed.
+    std::unique_ptr<RowDecompression> mRowDecompression;
+    // The buffer that holds the last strip of decompressed rows.
+    std::vector<JOCTET> mRowsBuffer;
+    size_t mRowsStride = 0;
+    size_t mRowsCapacity = 0;
 };
 } /* namespace android::ultrahdr  */
 
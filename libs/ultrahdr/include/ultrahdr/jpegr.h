@@ -18,6 +18,7 @@
 #define ANDROID_ULTRAHDR_JPEGR_H
 
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 #include "ultrahdr/jpegdecoderhelper.h"
@@ -281,6 +282,40 @@ public:
                          jr_uncompressed_ptr gainmap_image_ptr = nullptr,
                          ultrahdr_metadata_ptr metadata = nullptr);
 
+    /*
+     * Writes the rows decoded by decodeJPEGRRows(), which come in order from the top of the image.
+     *
+     * @param row the first row of the strip of rows
+     * @param row_count the number of rows of the strip
+     * @param pixels the pixels of the rows, in the color format of the output format, without
+     *               padding between the rows. They are only valid during the call.
+     * @return NO_ERROR to go on decoding, or the error code which decodeJPEGRRows() returns.
+     */
+    typedef std::function<status_t(size_t row, size_t row_count, const void* pixels)> RowsWriter;
+
+    /*
+     * Decompresses JPEGR image to an HDR image like decodeJPEGR(), in strips of rows which are
+     * passed to the writer as they are decoded. Only a strip of the primary image and of the output
+     * is held in memory besides the gain map, whatever the size of the image. The dimensions of the
+     * output are given by getJPEGRInfo().
+     *
+     * @param jpegr_image_ptr compressed JPEGR image.
+     * @param writer the writer of the strips of decoded rows.
+     * @param max_display_boost (optional) the maximum available boost supported by a display,
+     *                          the value must be greater than or equal to 1.0.
+     * @param exif destination of the decoded EXIF metadata, as for decodeJPEGR().
+     * @param output_format flag for setting output color format, as for decodeJPEGR(), but for
+     *                      {@code JPEGR_OUTPUT_SDR} which is not supported.
+     * @param gainmap_image_ptr destination of the decoded gain map, as for decodeJPEGR().
+     * @param metadata destination of the decoded metadata, as for decodeJPEGR().
+     * @return NO_ERROR if decoding succeeds, error code if error occurs.
+     */
+    status_t decodeJPEGRRows(jr_compressed_ptr jpegr_image_ptr, const RowsWriter& writer,
+                             float max_display_boost = FLT_MAX, jr_exif_ptr exif = nullptr,
+                             ultrahdr_output_format output_format = ULTRAHDR_OUTPUT_HDR_LINEAR,
+                             jr_uncompressed_ptr gainmap_image_ptr = nullptr,
+                             ultrahdr_metadata_ptr metadata = nullptr);
+
     /*
      * Gets Info from JPEGR file without decoding it.
      *
@@ -338,7 +373,63 @@ protected:
                           ultrahdr_output_format output_format, float max_display_boost,
                           jr_uncompressed_ptr dest);
 
+    /*
+     * This method will tone map a HDR image to an SDR image.
+     *
+     * @param src pointer to uncompressed HDR image struct. HDR image is expected to be
+     *            in p010 color format
+     * @param dest pointer to store tonemapped SDR image
+     */
+    status_t toneMap(jr_uncompressed_ptr src, jr_uncompressed_ptr dest);
+
+    /*
+     * This method will convert a YUV420 image from one YUV encoding to another in-place (eg.
+     * Bt.709 to Bt.601 YUV encoding).
+     *
+     * src_encoding and dest_encoding indicate the encoding via the YUV conversion defined for that
+     * gamut. P3 indicates Rec.601, since this is how DataSpace encodes Display-P3 YUV data.
+     *
+     * @param image the YUV420 image to convert
+     * @param src_encoding input YUV encoding
+     * @param dest_encoding output YUV encoding
+     * @return NO_ERROR if calculation succeeds, error code if error occurs.
+     */
+    status_t convertYuv(jr_uncompressed_ptr image, ultrahdr_color_gamut src_encoding,
+                        ultrahdr_color_gamut dest_encoding);
+
 private:
+    /*
+     * This method is called in the decoding pipeline. It will decode the primary image in strips
+     * of rows, and apply the gain map to each strip as it is decoded, so that the whole primary
+     * image is never held in memory.
+     *
+     * @param primary_jpeg_image_ptr compressed primary image.
+     * @param gainmap_jpeg_image_ptr compressed gain map.
+     * @param max_display_boost the maximum available boost supported by a display.
+     * @param exif (nullable) destination of the decoded EXIF metadata.
+     * @param output_format the HDR output color format.
+     * @param gainmap_image_ptr (nullable) destination of the decoded gain map.
+     * @param metadata (nullable) destination of the decoded metadata.
+     * @param dest (nullable) destination of the whole HDR image.
+     * @param writer (nullable) writer of the strips of HDR rows, when dest is null.
+     * @return NO_ERROR if decoding succeeds, error code if error occurs.
+     */
+    status_t decodeGainMapRows(jr_compressed_ptr primary_jpeg_image_ptr,
+                               jr_compressed_ptr gainmap_jpeg_image_ptr, float max_display_boost,
+                               jr_exif_ptr exif, ultrahdr_output_format output_format,
+                               jr_uncompressed_ptr gainmap_image_ptr,
+                               ultrahdr_metadata_ptr metadata, jr_uncompressed_ptr dest,
+                               const RowsWriter* writer);
+
+    /*
+     * This method copies the EXIF package of a decoded JPEG image.
+     *
+     * @param jpeg_dec_obj_ptr decoder of the JPEG image.
+     * @param exif (nullable) destination of the EXIF package.
+     * @return NO_ERROR if copying succeeds, error code if error occurs.
+     */
+    status_t copyExif(JpegDecoderHelper* jpeg_dec_obj_ptr, jr_exif_ptr exif);
+
     /*
      * This method is called in the encoding pipeline. It will encode the gain map.
      *
@@ -386,30 +477,6 @@ private:
                            jr_compressed_ptr gainmap_jpg_image_ptr, jr_exif_ptr pExif, void* pIcc,
                            size_t icc_size, ultrahdr_metadata_ptr metadata, jr_compressed_ptr dest);
 
-    /*
-     * This method will tone map a HDR image to an SDR image.
-     *
-     * @param src pointer to uncompressed HDR image struct. HDR image is expected to be
-     *            in p010 color format
-     * @param dest pointer to store tonemapped SDR image
-     */
-    status_t toneMap(jr_uncompressed_ptr src, jr_uncompressed_ptr dest);
-
-    /*
-     * This method will convert a YUV420 image from one YUV encoding to another in-place (eg.
-     * Bt.709 to Bt.601 YUV encoding).
-     *
-     * src_encoding and dest_encoding indicate the encoding via the YUV conversion defined for that
-     * gamut. P3 indicates Rec.601, since this is how DataSpace encodes Display-P3 YUV data.
-     *
-     * @param image the YUV420 image to convert
-     * @param src_encoding input YUV encoding
-     * @param dest_encoding output YUV encoding
-     * @return NO_ERROR if calculation succeeds, error code if error occurs.
-     */
-    status_t convertYuv(jr_uncompressed_ptr image, ultrahdr_color_gamut src_encoding,
-                        ultrahdr_color_gamut dest_encoding);
-
     /*
      * This method will check the validity of the input arguments.
      *
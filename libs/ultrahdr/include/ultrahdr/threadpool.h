@@ -0,0 +1,105 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_ULTRAHDR_THREADPOOL_H
+#define ANDROID_ULTRAHDR_THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android::ultrahdr {
+
+/*
+ * The configuration of a thread pool.
+ */
+struct ThreadPoolConfig {
+  // The number of threads which run the jobs, with the thread which runs parallelFor(). 0 for the
+  // number of CPUs, at most kDefaultMaxParallelism.
+  size_t parallelism = 0;
+  // The CPUs which the workers of the pool run on, none to leave them to the scheduler.
+  std::vector<int> cpus;
+};
+
+/*
+ * A pool of persistent threads, which run jobs over the rows of images.
+ *
+ * The rows of a job are split in chunks, and the chunks in contiguous ranges, one for each thread
+ * of the pool. Each thread runs the chunks of its range in order, and steals chunks from the end of
+ * the ranges of the other threads once its range is done. The jobs of several threads run at once.
+ */
+class ThreadPool {
+public:
+  static constexpr size_t kDefaultMaxParallelism = 4;
+
+  /*
+   * The pool of the process, which the encoding and decoding share. Its workers are started on the
+   * first call, with the default configuration.
+   */
+  static ThreadPool& getInstance();
+
+  explicit ThreadPool(const ThreadPoolConfig& config = ThreadPoolConfig());
+  ~ThreadPool();
+
+  /*
+   * Replaces the workers of the pool by the workers of the configuration. The jobs which are running
+   * are completed by their calling threads in the meantime.
+   */
+  void configure(const ThreadPoolConfig& config);
+
+  size_t getParallelism() const;
+
+  /*
+   * Runs fn(rowStart, rowEnd) for each chunk of chunkSize rows of [0, rowCount), on the calling
+   * thread and the workers of the pool, and returns once all of the chunks have run.
+   */
+  void parallelFor(size_t rowCount, size_t chunkSize,
+                   const std::function<void(size_t rowStart, size_t rowEnd)>& fn);
+
+private:
+  struct Job;
+
+  void stopWorkers();
+  void startWorkersLocked(const ThreadPoolConfig& config);
+  void runWorker(std::vector<int> cpus);
+
+  // Guards configure(), which joins the workers without holding mMutex.
+  std::mutex mConfigureMutex;
+
+  mutable std::mutex mMutex;
+  std::condition_variable mJobPosted;
+  // The jobs which may still have chunks to run.
+  std::deque<std::shared_ptr<Job>> mJobs;
+  std::vector<std::thread> mWorkers;
+  size_t mParallelism = 1;
+  bool mStopping = false;
+};
+
+/*
+ * The number of rows of the chunks of a job over rowCount rows of rowBytes bytes, which is a
+ * multiple of alignment: the rows which fit in half of the cache of a CPU, as long as each of the
+ * threads of the pool gets a few chunks.
+ */
+size_t getChunkSizeInRows(size_t rowBytes, size_t rowCount, size_t alignment, size_t parallelism);
+
+} // namespace android::ultrahdr
+
+#endif // ANDROID_ULTRAHDR_THREADPOOL_H
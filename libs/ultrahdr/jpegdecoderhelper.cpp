@@ -20,6 +20,7 @@
 
 #include <errno.h>
 #include <setjmp.h>
+#include <algorithm>
 #include <string>
 
 using namespace std;
@@ -97,6 +98,20 @@ static void jpegrerror_exit(j_common_ptr cinfo) {
     longjmp(err->setjmp_buffer, 1);
 }
 
+/*
+ * The decompressor of startDecompressRows(), which lives until all of the rows are decompressed.
+ * Its error manager and source manager are referenced by the decompressor, so they live with it.
+ */
+struct JpegDecoderHelper::RowDecompression {
+    RowDecompression(const void* image, int length)
+          : mgr(static_cast<const uint8_t*>(image), length) {}
+    ~RowDecompression() { jpeg_destroy_decompress(&cinfo); }
+
+    jpeg_decompress_struct cinfo;
+    jpegrerror_mgr myerr;
+    jpegr_source_mgr mgr;
+};
+
 JpegDecoderHelper::JpegDecoderHelper() {}
 
 JpegDecoderHelper::~JpegDecoderHelper() {}
@@ -203,30 +218,7 @@ bool JpegDecoderHelper::extractEXIF(const void* image, int length) {
     return true;
 }
 
-bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA) {
-    bool status = true;
-    jpeg_decompress_struct cinfo;
-    jpegrerror_mgr myerr;
-    cinfo.err = jpeg_std_error(&myerr.pub);
-    myerr.pub.error_exit = jpegrerror_exit;
-    if (setjmp(myerr.setjmp_buffer)) {
-        jpeg_destroy_decompress(&cinfo);
-        return false;
-    }
-
-    jpeg_create_decompress(&cinfo);
-
-    jpeg_save_markers(&cinfo, kAPP0Marker, 0xFFFF);
-    jpeg_save_markers(&cinfo, kAPP1Marker, 0xFFFF);
-    jpeg_save_markers(&cinfo, kAPP2Marker, 0xFFFF);
-
-    jpegr_source_mgr mgr(static_cast<const uint8_t*>(image), length);
-    cinfo.src = &mgr;
-    if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
-        jpeg_destroy_decompress(&cinfo);
-        return false;
-    }
-
+void JpegDecoderHelper::saveMetadata(jpeg_decompress_struct* cinfo) {
     // Save XMP data, EXIF data, and ICC data.
     // Here we only handle the first XMP / EXIF / ICC package.
     // We assume that all packages are starting with two bytes marker (eg FF E1 for EXIF package),
@@ -236,7 +228,7 @@ bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA)
     bool xmpAppears = false;
     bool iccAppears = false;
     size_t pos = 2;  // position after SOI
-    for (jpeg_marker_struct* marker = cinfo.marker_list;
+    for (jpeg_marker_struct* marker = cinfo->marker_list;
          marker && !(exifAppears && xmpAppears && iccAppears);
          marker = marker->next) {
          pos += 4;
@@ -266,6 +258,33 @@ bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA)
             iccAppears = true;
         }
     }
+}
+
+bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA) {
+    bool status = true;
+    jpeg_decompress_struct cinfo;
+    jpegrerror_mgr myerr;
+    cinfo.err = jpeg_std_error(&myerr.pub);
+    myerr.pub.error_exit = jpegrerror_exit;
+    if (setjmp(myerr.setjmp_buffer)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+
+    jpeg_save_markers(&cinfo, kAPP0Marker, 0xFFFF);
+    jpeg_save_markers(&cinfo, kAPP1Marker, 0xFFFF);
+    jpeg_save_markers(&cinfo, kAPP2Marker, 0xFFFF);
+
+    jpegr_source_mgr mgr(static_cast<const uint8_t*>(image), length);
+    cinfo.src = &mgr;
+    if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    saveMetadata(&cinfo);
 
     mWidth = cinfo.image_width;
     mHeight = cinfo.image_height;
@@ -335,6 +354,122 @@ bool JpegDecoderHelper::decompress(jpeg_decompress_struct* cinfo, const uint8_t*
                                                         : decompressYUV(cinfo, dest));
 }
 
+bool JpegDecoderHelper::startDecompressRows(const void* image, int length, size_t stripHeight) {
+    if (image == nullptr || length <= 0) {
+        ALOGE("Image size can not be handled: %d", length);
+        return false;
+    }
+    mXMPBuffer.clear();
+    mRowsBuffer.clear();
+    mRowDecompression.reset(new RowDecompression(image, length));
+    jpeg_decompress_struct* cinfo = &mRowDecompression->cinfo;
+    jpegrerror_mgr* myerr = &mRowDecompression->myerr;
+    cinfo->err = jpeg_std_error(&myerr->pub);
+    myerr->pub.error_exit = jpegrerror_exit;
+    if (setjmp(myerr->setjmp_buffer)) {
+        mRowDecompression.reset();
+        return false;
+    }
+
+    jpeg_create_decompress(cinfo);
+
+    jpeg_save_markers(cinfo, kAPP0Marker, 0xFFFF);
+    jpeg_save_markers(cinfo, kAPP1Marker, 0xFFFF);
+    jpeg_save_markers(cinfo, kAPP2Marker, 0xFFFF);
+
+    cinfo->src = &mRowDecompression->mgr;
+    if (jpeg_read_header(cinfo, TRUE) != JPEG_HEADER_OK) {
+        mRowDecompression.reset();
+        return false;
+    }
+
+    saveMetadata(cinfo);
+
+    mWidth = cinfo->image_width;
+    mHeight = cinfo->image_height;
+    if (mWidth > kMaxWidth || mHeight > kMaxHeight) {
+        mRowDecompression.reset();
+        return false;
+    }
+    if (cinfo->jpeg_color_space != JCS_YCbCr || cinfo->comp_info[0].h_samp_factor != 2 ||
+        cinfo->comp_info[0].v_samp_factor != 2 || cinfo->comp_info[1].h_samp_factor != 1 ||
+        cinfo->comp_info[1].v_samp_factor != 1 || cinfo->comp_info[2].h_samp_factor != 1 ||
+        cinfo->comp_info[2].v_samp_factor != 1) {
+        ALOGE("%s: decoding rows only supports YUV with 4:2:0 subsampling", __func__);
+        mRowDecompression.reset();
+        return false;
+    }
+
+    // The rows are decompressed to the buffer directly, so it holds whole MCU rows.
+    mRowsStride = ALIGNM(cinfo->image_width, kCompressBatchSize);
+    mRowsCapacity = ALIGNM(std::max(stripHeight, static_cast<size_t>(1)), kCompressBatchSize);
+    mRowsBuffer.resize(mRowsStride * mRowsCapacity * 3 / 2, 0);
+
+    cinfo->out_color_space = cinfo->jpeg_color_space;
+    cinfo->raw_data_out = TRUE;
+    cinfo->dct_method = JDCT_ISLOW;
+    jpeg_start_decompress(cinfo);
+    return true;
+}
+
+bool JpegDecoderHelper::decompressRows(size_t* rowCount) {
+    *rowCount = 0;
+    if (mRowDecompression == nullptr) {
+        return true;
+    }
+    jpeg_decompress_struct* cinfo = &mRowDecompression->cinfo;
+    if (setjmp(mRowDecompression->myerr.setjmp_buffer)) {
+        mRowDecompression.reset();
+        return false;
+    }
+
+    JSAMPROW y[kCompressBatchSize];
+    JSAMPROW cb[kCompressBatchSize / 2];
+    JSAMPROW cr[kCompressBatchSize / 2];
+    JSAMPARRAY planes[3]{y, cb, cr};
+
+    uint8_t* y_plane = mRowsBuffer.data();
+    uint8_t* u_plane = y_plane + mRowsStride * mRowsCapacity;
+    uint8_t* v_plane = u_plane + mRowsStride * mRowsCapacity / 4;
+    const size_t chroma_stride = mRowsStride / 2;
+    while (*rowCount < mRowsCapacity && cinfo->output_scanline < cinfo->image_height) {
+        const size_t row = *rowCount;
+        for (int i = 0; i < kCompressBatchSize; ++i) {
+            y[i] = y_plane + (row + i) * mRowsStride;
+        }
+        for (int i = 0; i < kCompressBatchSize / 2; ++i) {
+            cb[i] = u_plane + (row / 2 + i) * chroma_stride;
+            cr[i] = v_plane + (row / 2 + i) * chroma_stride;
+        }
+        const size_t remaining = cinfo->image_height - cinfo->output_scanline;
+        int processed = jpeg_read_raw_data(cinfo, planes, kCompressBatchSize);
+        if (processed != kCompressBatchSize) {
+            ALOGE("Number of processed lines does not equal input lines.");
+            mRowDecompression.reset();
+            return false;
+        }
+        *rowCount += std::min(remaining, static_cast<size_t>(kCompressBatchSize));
+    }
+
+    if (cinfo->output_scanline >= cinfo->image_height) {
+        jpeg_finish_decompress(cinfo);
+        mRowDecompression.reset();
+    }
+    return true;
+}
+
+void* JpegDecoderHelper::getDecompressedRowsPtr() {
+    return mRowsBuffer.data();
+}
+
+size_t JpegDecoderHelper::getDecompressedRowsStride() {
+    return mRowsStride;
+}
+
+size_t JpegDecoderHelper::getDecompressedRowsCapacity() {
+    return mRowsCapacity;
+}
+
 bool JpegDecoderHelper::getCompressedImageParameters(const void* image, int length, size_t* pWidth,
                                                      size_t* pHeight, std::vector<uint8_t>* iccData,
                                                      std::vector<uint8_t>* exifData) {
@@ -15,17 +15,14 @@
  */
 
 #include <cmath>
-#include <condition_variable>
-#include <deque>
 #include <memory>
-#include <mutex>
-#include <thread>
 
 #include <ultrahdr/gainmapmath.h>
 #include <ultrahdr/icc.h>
 #include <ultrahdr/jpegr.h>
 #include <ultrahdr/jpegrutils.h>
 #include <ultrahdr/multipictureformat.h>
+#include <ultrahdr/threadpool.h>
 
 #include <image_io/base/data_segment_data_source.h>
 #include <image_io/jpeg/jpeg_info.h>
@@ -58,20 +55,6 @@ namespace android::ultrahdr {
 // JPEG compress quality (0 ~ 100) for gain map
 static const int kMapCompressQuality = 85;
 
-#define CONFIG_MULTITHREAD 1
-int GetCPUCoreCount() {
-  int cpuCoreCount = 1;
-#if CONFIG_MULTITHREAD
-#if defined(_SC_NPROCESSORS_ONLN)
-  cpuCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
-#else
-  // _SC_NPROC_ONLN must be defined...
-  cpuCoreCount = sysconf(_SC_NPROC_ONLN);
-#endif
-#endif
-  return cpuCoreCount;
-}
-
 /*
  * Helper function copies the JPEG image from without EXIF.
  *
@@ -599,6 +582,170 @@ status_t JpegR::getJPEGRInfo(jr_compressed_ptr jpegr_image_ptr, jr_info_ptr jpeg
   return status;
 }
 
+/*
+ * Checks that the gain map and its metadata apply to a primary image of image_width x image_height.
+ */
+static status_t checkGainMapApplication(size_t image_width, size_t image_height,
+                                        jr_uncompressed_ptr gainmap_image_ptr,
+                                        ultrahdr_metadata_ptr metadata) {
+  if (metadata->version.compare(kJpegrVersion)) {
+    ALOGE("Unsupported metadata version: %s", metadata->version.c_str());
+    return ERROR_JPEGR_UNSUPPORTED_METADATA;
+  }
+  if (metadata->gamma != 1.0f) {
+    ALOGE("Unsupported metadata gamma: %f", metadata->gamma);
+    return ERROR_JPEGR_UNSUPPORTED_METADATA;
+  }
+  if (metadata->offsetSdr != 0.0f || metadata->offsetHdr != 0.0f) {
+    ALOGE("Unsupported metadata offset sdr, hdr: %f, %f", metadata->offsetSdr, metadata->offsetHdr);
+    return ERROR_JPEGR_UNSUPPORTED_METADATA;
+  }
+  if (metadata->hdrCapacityMin != metadata->minContentBoost ||
+      metadata->hdrCapacityMax != metadata->maxContentBoost) {
+    ALOGE("Unsupported metadata hdr capacity min, max: %f, %f", metadata->hdrCapacityMin,
+          metadata->hdrCapacityMax);
+    return ERROR_JPEGR_UNSUPPORTED_METADATA;
+  }
+
+  // TODO: remove once map scaling factor is computed based on actual map dims
+  size_t map_width = image_width / kMapDimensionScaleFactor;
+  size_t map_height = image_height / kMapDimensionScaleFactor;
+  if (map_width != gainmap_image_ptr->width || map_height != gainmap_image_ptr->height) {
+    ALOGE("gain map dimensions and primary image dimensions are not to scale, computed gain map "
+          "resolution is %dx%d, received gain map resolution is %dx%d",
+          (int)map_width, (int)map_height, gainmap_image_ptr->width, gainmap_image_ptr->height);
+    return ERROR_JPEGR_INVALID_INPUT_TYPE;
+  }
+  return NO_ERROR;
+}
+
+/*
+ * The tables and conversions of the application of a gain map, which the strips of rows of the
+ * image share.
+ */
+struct GainMapApplication {
+  GainMapApplication(ultrahdr_metadata_ptr metadata, ultrahdr_output_format output_format,
+                     float max_display_boost)
+        : idwTable(kMapDimensionScaleFactor),
+          gainLUT(metadata, std::min(max_display_boost, metadata->maxContentBoost)) {
+    // Assuming the sdr image is a decoded JPEG, we should always use Rec.601 YUV coefficients
+    fns.sdrYuvToRgbFn = p3YuvToRgb;
+    // We are assuming the SDR base image is always sRGB transfer.
+#if USE_SRGB_INVOETF_LUT
+    fns.sdrInvOetf = srgbInvOetfLUT;
+#else
+    fns.sdrInvOetf = srgbInvOetf;
+#endif
+#if USE_APPLY_GAIN_LUT
+    fns.gainLUT = &gainLUT;
+#else
+    fns.gainLUT = nullptr;
+#endif
+    fns.displayBoost = std::min(max_display_boost, metadata->maxContentBoost);
+    fns.outputFormat = output_format;
+    fns.hdrOetf = identityConversion;
+    if (output_format == ULTRAHDR_OUTPUT_HDR_HLG) {
+#if USE_HLG_OETF_LUT
+      fns.hdrOetf = hlgOetfLUT;
+#else
+      fns.hdrOetf = hlgOetf;
+#endif
+    } else if (output_format == ULTRAHDR_OUTPUT_HDR_PQ) {
+#if USE_PQ_OETF_LUT
+      fns.hdrOetf = pqOetfLUT;
+#else
+      fns.hdrOetf = pqOetf;
+#endif
+    }
+  }
+  GainMapApplication(const GainMapApplication&) = delete;
+  GainMapApplication& operator=(const GainMapApplication&) = delete;
+
+  ShepardsIDW idwTable;
+  GainLUT gainLUT;
+  GainMapApplicationFns fns;
+};
+
+static size_t getOutputPixelBytes(ultrahdr_output_format output_format) {
+  return output_format == ULTRAHDR_OUTPUT_HDR_LINEAR ? 8 : 4;
+}
+
+/*
+ * Applies the gain map to the row_count rows of yuv420_image_ptr, which is a strip of the primary
+ * image from its row first_row, and writes the HDR rows to dest, which holds the rows of the strip.
+ */
+static void applyGainMapRows(GainMapApplication& application, jr_uncompressed_ptr yuv420_image_ptr,
+                             size_t first_row, size_t row_count,
+                             jr_uncompressed_ptr gainmap_image_ptr, ultrahdr_metadata_ptr metadata,
+                             void* dest) {
+  // The chunks are of whole blocks of the rows which share the rows of the map.
+  ThreadPool& threadPool = ThreadPool::getInstance();
+  const size_t width = yuv420_image_ptr->width;
+  const size_t pixelBytes = getOutputPixelBytes(application.fns.outputFormat);
+  const size_t rowBytes = width * 3 / 2 + width * pixelBytes;
+  const size_t chunkRows = getChunkSizeInRows(rowBytes, row_count, kMapDimensionScaleFactor,
+                                              threadPool.getParallelism());
+
+  const GainMapApplicationFns& fns = application.fns;
+  ShepardsIDW& idwTable = application.idwTable;
+  std::function<void(size_t, size_t)> applyRecMap = [yuv420_image_ptr, first_row,
+                                                     gainmap_image_ptr, metadata, dest, width,
+                                                     pixelBytes, &idwTable,
+                                                     &fns](size_t rowStart,
+                                                           size_t rowEnd) -> void {
+    for (size_t y = first_row + rowStart; y < first_row + rowEnd; ++y) {
+      uint8_t* row = reinterpret_cast<uint8_t*>(dest) + (y - first_row) * width * pixelBytes;
+      // The SIMD kernels apply the map to most of the row, and give the same pixels as the loop
+      // below.
+      size_t x = applyGainMapRow(yuv420_image_ptr, first_row, gainmap_image_ptr, fns, idwTable, y,
+                                 width, row);
+      for (; x < width; ++x) {
+        Color yuv_gamma_sdr = getYuv420Pixel(yuv420_image_ptr, x, y - first_row);
+        Color rgb_gamma_sdr = fns.sdrYuvToRgbFn(yuv_gamma_sdr);
+        Color rgb_sdr = fns.sdrInvOetf(rgb_gamma_sdr);
+        float gain;
+        // TODO: determine map scaling factor based on actual map dims
+        size_t map_scale_factor = kMapDimensionScaleFactor;
+        // TODO: If map_scale_factor is guaranteed to be an integer, then remove the following.
+        // Currently map_scale_factor is of type size_t, but it could be changed to a float
+        // later.
+        if (map_scale_factor != floorf(map_scale_factor)) {
+          gain = sampleMap(gainmap_image_ptr, map_scale_factor, x, y);
+        } else {
+          gain = sampleMap(gainmap_image_ptr, map_scale_factor, x, y, idwTable);
+        }
+
+#if USE_APPLY_GAIN_LUT
+        Color rgb_hdr = applyGainLUT(rgb_sdr, gain, *fns.gainLUT);
+#else
+        Color rgb_hdr = applyGain(rgb_sdr, gain, metadata, fns.displayBoost);
+#endif
+        rgb_hdr = rgb_hdr / fns.displayBoost;
+
+        switch (fns.outputFormat) {
+          case ULTRAHDR_OUTPUT_HDR_LINEAR: {
+            uint64_t rgba_f16 = colorToRgbaF16(rgb_hdr);
+            reinterpret_cast<uint64_t*>(row)[x] = rgba_f16;
+            break;
+          }
+          case ULTRAHDR_OUTPUT_HDR_HLG:
+          case ULTRAHDR_OUTPUT_HDR_PQ: {
+            Color rgb_gamma_hdr = fns.hdrOetf(rgb_hdr);
+            uint32_t rgba_1010102 = colorToRgba1010102(rgb_gamma_hdr);
+            reinterpret_cast<uint32_t*>(row)[x] = rgba_1010102;
+            break;
+          }
+          default: {
+          }
+            // Should be impossible to hit after input validation.
+        }
+      }
+    }
+  };
+
+  threadPool.parallelFor(row_count, chunkRows, applyRecMap);
+}
+
 /* Decode API */
 status_t JpegR::decodeJPEGR(jr_compressed_ptr jpegr_image_ptr, jr_uncompressed_ptr dest,
                             float max_display_boost, jr_exif_ptr exif,
@@ -635,47 +782,103 @@ status_t JpegR::decodeJPEGR(jr_compressed_ptr jpegr_image_ptr, jr_uncompressed_p
     }
   }
 
+  if (output_format != ULTRAHDR_OUTPUT_SDR) {
+    return decodeGainMapRows(&primary_jpeg_image, &gainmap_jpeg_image, max_display_boost, exif,
+                             output_format, gainmap_image_ptr, metadata, dest, nullptr);
+  }
+
   JpegDecoderHelper jpeg_dec_obj_yuv420;
   if (!jpeg_dec_obj_yuv420.decompressImage(primary_jpeg_image.data, primary_jpeg_image.length,
-                                           (output_format == ULTRAHDR_OUTPUT_SDR))) {
+                                           true)) {
     return ERROR_JPEGR_DECODE_ERROR;
   }
+  if ((jpeg_dec_obj_yuv420.getDecompressedImageWidth() *
+       jpeg_dec_obj_yuv420.getDecompressedImageHeight() * 4) >
+      jpeg_dec_obj_yuv420.getDecompressedImageSize()) {
+    return ERROR_JPEGR_CALCULATION_ERROR;
+  }
+  JPEGR_CHECK(copyExif(&jpeg_dec_obj_yuv420, exif));
 
-  if (output_format == ULTRAHDR_OUTPUT_SDR) {
-    if ((jpeg_dec_obj_yuv420.getDecompressedImageWidth() *
-         jpeg_dec_obj_yuv420.getDecompressedImageHeight() * 4) >
-        jpeg_dec_obj_yuv420.getDecompressedImageSize()) {
-      return ERROR_JPEGR_CALCULATION_ERROR;
-    }
-  } else {
-    if ((jpeg_dec_obj_yuv420.getDecompressedImageWidth() *
-         jpeg_dec_obj_yuv420.getDecompressedImageHeight() * 3 / 2) >
-        jpeg_dec_obj_yuv420.getDecompressedImageSize()) {
-      return ERROR_JPEGR_CALCULATION_ERROR;
-    }
+  dest->width = jpeg_dec_obj_yuv420.getDecompressedImageWidth();
+  dest->height = jpeg_dec_obj_yuv420.getDecompressedImageHeight();
+  memcpy(dest->data, jpeg_dec_obj_yuv420.getDecompressedImagePtr(),
+         dest->width * dest->height * 4);
+  return NO_ERROR;
+}
+
+status_t JpegR::decodeJPEGRRows(jr_compressed_ptr jpegr_image_ptr, const RowsWriter& writer,
+                                float max_display_boost, jr_exif_ptr exif,
+                                ultrahdr_output_format output_format,
+                                jr_uncompressed_ptr gainmap_image_ptr,
+                                ultrahdr_metadata_ptr metadata) {
+  if (jpegr_image_ptr == nullptr || jpegr_image_ptr->data == nullptr) {
+    ALOGE("received nullptr for compressed jpegr image");
+    return ERROR_JPEGR_INVALID_NULL_PTR;
+  }
+  if (!writer) {
+    ALOGE("received empty writer for the decoded rows");
+    return ERROR_JPEGR_INVALID_NULL_PTR;
+  }
+  if (max_display_boost < 1.0f) {
+    ALOGE("received bad value for max_display_boost %f", max_display_boost);
+    return ERROR_JPEGR_INVALID_INPUT_TYPE;
+  }
+  if (exif != nullptr && exif->data == nullptr) {
+    ALOGE("received nullptr address for exif data");
+    return ERROR_JPEGR_INVALID_INPUT_TYPE;
+  }
+  if (output_format <= ULTRAHDR_OUTPUT_SDR || output_format > ULTRAHDR_OUTPUT_MAX) {
+    ALOGE("received bad value for output format %d", output_format);
+    return ERROR_JPEGR_INVALID_INPUT_TYPE;
   }
 
+  jpegr_compressed_struct primary_jpeg_image, gainmap_jpeg_image;
+  status_t status =
+          extractPrimaryImageAndGainMap(jpegr_image_ptr, &primary_jpeg_image, &gainmap_jpeg_image);
+  if (status != NO_ERROR) {
+    ALOGE("received invalid compressed jpegr image");
+    return status;
+  }
+  return decodeGainMapRows(&primary_jpeg_image, &gainmap_jpeg_image, max_display_boost, exif,
+                           output_format, gainmap_image_ptr, metadata, nullptr, &writer);
+}
+
+status_t JpegR::copyExif(JpegDecoderHelper* jpeg_dec_obj_ptr, jr_exif_ptr exif) {
   if (exif != nullptr) {
     if (exif->data == nullptr) {
       return ERROR_JPEGR_INVALID_NULL_PTR;
     }
-    if (exif->length < jpeg_dec_obj_yuv420.getEXIFSize()) {
+    if (exif->length < jpeg_dec_obj_ptr->getEXIFSize()) {
       return ERROR_JPEGR_BUFFER_TOO_SMALL;
     }
-    memcpy(exif->data, jpeg_dec_obj_yuv420.getEXIFPtr(), jpeg_dec_obj_yuv420.getEXIFSize());
-    exif->length = jpeg_dec_obj_yuv420.getEXIFSize();
+    memcpy(exif->data, jpeg_dec_obj_ptr->getEXIFPtr(), jpeg_dec_obj_ptr->getEXIFSize());
+    exif->length = jpeg_dec_obj_ptr->getEXIFSize();
   }
+  return NO_ERROR;
+}
 
-  if (output_format == ULTRAHDR_OUTPUT_SDR) {
-    dest->width = jpeg_dec_obj_yuv420.getDecompressedImageWidth();
-    dest->height = jpeg_dec_obj_yuv420.getDecompressedImageHeight();
-    memcpy(dest->data, jpeg_dec_obj_yuv420.getDecompressedImagePtr(),
-           dest->width * dest->height * 4);
-    return NO_ERROR;
+// The rows of the strips which the primary image is decoded in, and which the gain map is applied
+// to at once. A multiple of the MCU height and of the map scale factor.
+static const size_t kDecodeStripSzInRows = 64;
+
+status_t JpegR::decodeGainMapRows(jr_compressed_ptr primary_jpeg_image_ptr,
+                                  jr_compressed_ptr gainmap_jpeg_image_ptr,
+                                  float max_display_boost, jr_exif_ptr exif,
+                                  ultrahdr_output_format output_format,
+                                  jr_uncompressed_ptr gainmap_image_ptr,
+                                  ultrahdr_metadata_ptr metadata, jr_uncompressed_ptr dest,
+                                  const RowsWriter* writer) {
+  JpegDecoderHelper jpeg_dec_obj_yuv420;
+  if (!jpeg_dec_obj_yuv420.startDecompressRows(primary_jpeg_image_ptr->data,
+                                               primary_jpeg_image_ptr->length,
+                                               kDecodeStripSzInRows)) {
+    return ERROR_JPEGR_DECODE_ERROR;
   }
+  JPEGR_CHECK(copyExif(&jpeg_dec_obj_yuv420, exif));
 
   JpegDecoderHelper jpeg_dec_obj_gm;
-  if (!jpeg_dec_obj_gm.decompressImage(gainmap_jpeg_image.data, gainmap_jpeg_image.length)) {
+  if (!jpeg_dec_obj_gm.decompressImage(gainmap_jpeg_image_ptr->data,
+                                       gainmap_jpeg_image_ptr->length)) {
     return ERROR_JPEGR_DECODE_ERROR;
   }
   if ((jpeg_dec_obj_gm.getDecompressedImageWidth() * jpeg_dec_obj_gm.getDecompressedImageHeight()) >
@@ -713,19 +916,49 @@ status_t JpegR::decodeJPEGR(jr_compressed_ptr jpegr_image_ptr, jr_uncompressed_p
     metadata->hdrCapacityMax = uhdr_metadata.hdrCapacityMax;
   }
 
-  jpegr_uncompressed_struct yuv420_image;
-  yuv420_image.data = jpeg_dec_obj_yuv420.getDecompressedImagePtr();
-  yuv420_image.width = jpeg_dec_obj_yuv420.getDecompressedImageWidth();
-  yuv420_image.height = jpeg_dec_obj_yuv420.getDecompressedImageHeight();
-  yuv420_image.colorGamut = IccHelper::readIccColorGamut(jpeg_dec_obj_yuv420.getICCPtr(),
+  const size_t image_width = jpeg_dec_obj_yuv420.getDecompressedImageWidth();
+  const size_t image_height = jpeg_dec_obj_yuv420.getDecompressedImageHeight();
+  JPEGR_CHECK(checkGainMapApplication(image_width, image_height, &gainmap_image, &uhdr_metadata));
+
+  // The strip of the primary image, whose planes have room for the rows of a whole strip.
+  jpegr_uncompressed_struct yuv420_strip;
+  yuv420_strip.data = jpeg_dec_obj_yuv420.getDecompressedRowsPtr();
+  yuv420_strip.width = image_width;
+  yuv420_strip.height = jpeg_dec_obj_yuv420.getDecompressedRowsCapacity();
+  yuv420_strip.colorGamut = IccHelper::readIccColorGamut(jpeg_dec_obj_yuv420.getICCPtr(),
                                                          jpeg_dec_obj_yuv420.getICCSize());
-  yuv420_image.luma_stride = yuv420_image.width;
-  uint8_t* data = reinterpret_cast<uint8_t*>(yuv420_image.data);
-  yuv420_image.chroma_data = data + yuv420_image.luma_stride * yuv420_image.height;
-  yuv420_image.chroma_stride = yuv420_image.width >> 1;
+  yuv420_strip.luma_stride = jpeg_dec_obj_yuv420.getDecompressedRowsStride();
+  uint8_t* data = reinterpret_cast<uint8_t*>(yuv420_strip.data);
+  yuv420_strip.chroma_data = data + yuv420_strip.luma_stride * yuv420_strip.height;
+  yuv420_strip.chroma_stride = yuv420_strip.luma_stride >> 1;
+
+  // The rows are written to dest directly, or to a strip of output rows for the writer.
+  const size_t row_bytes = image_width * getOutputPixelBytes(output_format);
+  std::unique_ptr<uint8_t[]> output_strip;
+  if (dest != nullptr) {
+    dest->width = image_width;
+    dest->height = image_height;
+  } else {
+    output_strip.reset(new uint8_t[row_bytes * yuv420_strip.height]);
+  }
 
-  JPEGR_CHECK(applyGainMap(&yuv420_image, &gainmap_image, &uhdr_metadata, output_format,
-                           max_display_boost, dest));
+  GainMapApplication application(&uhdr_metadata, output_format, max_display_boost);
+  size_t row = 0;
+  while (row < image_height) {
+    size_t row_count;
+    if (!jpeg_dec_obj_yuv420.decompressRows(&row_count) || row_count == 0) {
+      return ERROR_JPEGR_DECODE_ERROR;
+    }
+    uint8_t* output = dest != nullptr
+            ? reinterpret_cast<uint8_t*>(dest->data) + row * row_bytes
+            : output_strip.get();
+    applyGainMapRows(application, &yuv420_strip, row, row_count, &gainmap_image, &uhdr_metadata,
+                     output);
+    if (writer != nullptr) {
+      JPEGR_CHECK((*writer)(row, row_count, output));
+    }
+    row += row_count;
+  }
   return NO_ERROR;
 }
 
@@ -746,64 +979,6 @@ status_t JpegR::compressGainMap(jr_uncompressed_ptr gainmap_image_ptr,
   return NO_ERROR;
 }
 
-const int kJobSzInRows = 16;
-static_assert(kJobSzInRows > 0 && kJobSzInRows % kMapDimensionScaleFactor == 0,
-              "align job size to kMapDimensionScaleFactor");
-
-class JobQueue {
-public:
-  bool dequeueJob(size_t& rowStart, size_t& rowEnd);
-  void enqueueJob(size_t rowStart, size_t rowEnd);
-  void markQueueForEnd();
-  void reset();
-
-private:
-  bool mQueuedAllJobs = false;
-  std::deque<std::tuple<size_t, size_t>> mJobs;
-  std::mutex mMutex;
-  std::condition_variable mCv;
-};
-
-bool JobQueue::dequeueJob(size_t& rowStart, size_t& rowEnd) {
-  std::unique_lock<std::mutex> lock{mMutex};
-  while (true) {
-    if (mJobs.empty()) {
-      if (mQueuedAllJobs) {
-        return false;
-      } else {
-        mCv.wait_for(lock, std::chrono::milliseconds(100));
-      }
-    } else {
-      auto it = mJobs.begin();
-      rowStart = std::get<0>(*it);
-      rowEnd = std::get<1>(*it);
-      mJobs.erase(it);
-      return true;
-    }
-  }
-  return false;
-}
-
-void JobQueue::enqueueJob(size_t rowStart, size_t rowEnd) {
-  std::unique_lock<std::mutex> lock{mMutex};
-  mJobs.push_back(std::make_tuple(rowStart, rowEnd));
-  lock.unlock();
-  mCv.notify_one();
-}
-
-void JobQueue::markQueueForEnd() {
-  std::unique_lock<std::mutex> lock{mMutex};
-  mQueuedAllJobs = true;
-  lock.unlock();
-  mCv.notify_all();
-}
-
-void JobQueue::reset() {
-  std::unique_lock<std::mutex> lock{mMutex};
-  mJobs.clear();
-  mQueuedAllJobs = false;
-}
-
 status_t JpegR::generateGainMap(jr_uncompressed_ptr yuv420_image_ptr,
                                 jr_uncompressed_ptr p010_image_ptr,
                                 ultrahdr_transfer_function hdr_tf, ultrahdr_metadata_ptr metadata,
@@ -921,58 +1096,56 @@ status_t JpegR::generateGainMap(jr_uncompressed_ptr yuv420_image_ptr,
       return ERROR_JPEGR_INVALID_COLORGAMUT;
   }
 
-  std::mutex mutex;
-  const int threads = std::clamp(GetCPUCoreCount(), 1, 4);
-  size_t rowStep = threads == 1 ? image_height : kJobSzInRows;
-  JobQueue jobQueue;
-
-  std::function<void()> generateMap = [yuv420_image_ptr, p010_image_ptr, metadata, dest, hdrInvOetf,
-                                       hdrGamutConversionFn, luminanceFn, sdrYuvToRgbFn,
-                                       hdrYuvToRgbFn, hdr_white_nits, log2MinBoost, log2MaxBoost,
-                                       &jobQueue]() -> void {
-    size_t rowStart, rowEnd;
-    while (jobQueue.dequeueJob(rowStart, rowEnd)) {
-      for (size_t y = rowStart; y < rowEnd; ++y) {
-        for (size_t x = 0; x < dest->width; ++x) {
-          Color sdr_yuv_gamma = sampleYuv420(yuv420_image_ptr, kMapDimensionScaleFactor, x, y);
-          Color sdr_rgb_gamma = sdrYuvToRgbFn(sdr_yuv_gamma);
-          // We are assuming the SDR input is always sRGB transfer.
+  GainMapGenerationFns fns;
+  fns.sdrYuvToRgbFn = sdrYuvToRgbFn;
+  // We are assuming the SDR input is always sRGB transfer.
 #if USE_SRGB_INVOETF_LUT
-          Color sdr_rgb = srgbInvOetfLUT(sdr_rgb_gamma);
+  fns.sdrInvOetf = srgbInvOetfLUT;
 #else
-          Color sdr_rgb = srgbInvOetf(sdr_rgb_gamma);
+  fns.sdrInvOetf = srgbInvOetf;
 #endif
-          float sdr_y_nits = luminanceFn(sdr_rgb) * kSdrWhiteNits;
-
-          Color hdr_yuv_gamma = sampleP010(p010_image_ptr, kMapDimensionScaleFactor, x, y);
-          Color hdr_rgb_gamma = hdrYuvToRgbFn(hdr_yuv_gamma);
-          Color hdr_rgb = hdrInvOetf(hdr_rgb_gamma);
-          hdr_rgb = hdrGamutConversionFn(hdr_rgb);
-          float hdr_y_nits = luminanceFn(hdr_rgb) * hdr_white_nits;
-
-          size_t pixel_idx = x + y * dest->width;
-          reinterpret_cast<uint8_t*>(dest->data)[pixel_idx] =
-                  encodeGain(sdr_y_nits, hdr_y_nits, metadata, log2MinBoost, log2MaxBoost);
-        }
+  fns.luminanceFn = luminanceFn;
+  fns.hdrYuvToRgbFn = hdrYuvToRgbFn;
+  fns.hdrInvOetf = hdrInvOetf;
+  fns.hdrGamutConversionFn = hdrGamutConversionFn;
+  fns.hdrWhiteNits = hdr_white_nits;
+  fns.log2MinBoost = log2MinBoost;
+  fns.log2MaxBoost = log2MaxBoost;
+
+  // The chunks are of map rows, each of them samples kMapDimensionScaleFactor rows of the images.
+  ThreadPool& threadPool = ThreadPool::getInstance();
+  const size_t rowBytes = kMapDimensionScaleFactor * (image_width * 3 / 2 + image_width * 3);
+  const size_t chunkRows =
+          getChunkSizeInRows(rowBytes, map_height, 1, threadPool.getParallelism());
+
+  std::function<void(size_t, size_t)> generateMap = [yuv420_image_ptr, p010_image_ptr, metadata,
+                                                     dest, &fns](size_t rowStart,
+                                                                 size_t rowEnd) -> void {
+    for (size_t y = rowStart; y < rowEnd; ++y) {
+      uint8_t* row = reinterpret_cast<uint8_t*>(dest->data) + y * dest->width;
+      // The SIMD kernels generate most of the row, and give the same values as the loop below.
+      size_t x = generateGainMapRow(yuv420_image_ptr, p010_image_ptr, fns, metadata, y,
+                                    dest->width, row);
+      for (; x < dest->width; ++x) {
+        Color sdr_yuv_gamma = sampleYuv420(yuv420_image_ptr, kMapDimensionScaleFactor, x, y);
+        Color sdr_rgb_gamma = fns.sdrYuvToRgbFn(sdr_yuv_gamma);
+        Color sdr_rgb = fns.sdrInvOetf(sdr_rgb_gamma);
+        float sdr_y_nits = fns.luminanceFn(sdr_rgb) * kSdrWhiteNits;
+
+        Color hdr_yuv_gamma = sampleP010(p010_image_ptr, kMapDimensionScaleFactor, x, y);
+        Color hdr_rgb_gamma = fns.hdrYuvToRgbFn(hdr_yuv_gamma);
+        Color hdr_rgb = fns.hdrInvOetf(hdr_rgb_gamma);
+        hdr_rgb = fns.hdrGamutConversionFn(hdr_rgb);
+        float hdr_y_nits = fns.luminanceFn(hdr_rgb) * fns.hdrWhiteNits;
+
+        row[x] = encodeGain(sdr_y_nits, hdr_y_nits, metadata, fns.log2MinBoost,
+                            fns.log2MaxBoost);
       }
     }
   };
 
   // generate map
-  std::vector<std::thread> workers;
-  for (int th = 0; th < threads - 1; th++) {
-    workers.push_back(std::thread(generateMap));
-  }
-
-  rowStep = (threads == 1 ? image_height : kJobSzInRows) / kMapDimensionScaleFactor;
-  for (size_t rowStart = 0; rowStart < map_height;) {
-    size_t rowEnd = std::min(rowStart + rowStep, map_height);
-    jobQueue.enqueueJob(rowStart, rowEnd);
-    rowStart = rowEnd;
-  }
-  jobQueue.markQueueForEnd();
-  generateMap();
-  std::for_each(workers.begin(), workers.end(), [](std::thread& t) { t.join(); });
+  threadPool.parallelFor(map_height, chunkRows, generateMap);
 
   map_data.release();
   return NO_ERROR;
@@ -987,134 +1160,14 @@ status_t JpegR::applyGainMap(jr_uncompressed_ptr yuv420_image_ptr,
       yuv420_image_ptr->chroma_data == nullptr || gainmap_image_ptr->data == nullptr) {
     return ERROR_JPEGR_INVALID_NULL_PTR;
   }
-  if (metadata->version.compare(kJpegrVersion)) {
-    ALOGE("Unsupported metadata version: %s", metadata->version.c_str());
-    return ERROR_JPEGR_UNSUPPORTED_METADATA;
-  }
-  if (metadata->gamma != 1.0f) {
-    ALOGE("Unsupported metadata gamma: %f", metadata->gamma);
-    return ERROR_JPEGR_UNSUPPORTED_METADATA;
-  }
-  if (metadata->offsetSdr != 0.0f || metadata->offsetHdr != 0.0f) {
-    ALOGE("Unsupported metadata offset sdr, hdr: %f, %f", metadata->offsetSdr, metadata->offsetHdr);
-    return ERROR_JPEGR_UNSUPPORTED_METADATA;
-  }
-  if (metadata->hdrCapacityMin != metadata->minContentBoost ||
-      metadata->hdrCapacityMax != metadata->maxContentBoost) {
-    ALOGE("Unsupported metadata hdr capacity min, max: %f, %f", metadata->hdrCapacityMin,
-          metadata->hdrCapacityMax);
-    return ERROR_JPEGR_UNSUPPORTED_METADATA;
-  }
-
-  // TODO: remove once map scaling factor is computed based on actual map dims
-  size_t image_width = yuv420_image_ptr->width;
-  size_t image_height = yuv420_image_ptr->height;
-  size_t map_width = image_width / kMapDimensionScaleFactor;
-  size_t map_height = image_height / kMapDimensionScaleFactor;
-  if (map_width != gainmap_image_ptr->width || map_height != gainmap_image_ptr->height) {
-    ALOGE("gain map dimensions and primary image dimensions are not to scale, computed gain map "
-          "resolution is %dx%d, received gain map resolution is %dx%d",
-          (int)map_width, (int)map_height, gainmap_image_ptr->width, gainmap_image_ptr->height);
-    return ERROR_JPEGR_INVALID_INPUT_TYPE;
-  }
+  JPEGR_CHECK(checkGainMapApplication(yuv420_image_ptr->width, yuv420_image_ptr->height,
+                                      gainmap_image_ptr, metadata));
 
   dest->width = yuv420_image_ptr->width;
   dest->height = yuv420_image_ptr->height;
-  ShepardsIDW idwTable(kMapDimensionScaleFactor);
-  float display_boost = std::min(max_display_boost, metadata->maxContentBoost);
-  GainLUT gainLUT(metadata, display_boost);
-
-  JobQueue jobQueue;
-  std::function<void()> applyRecMap = [yuv420_image_ptr, gainmap_image_ptr, metadata, dest,
-                                       &jobQueue, &idwTable, output_format, &gainLUT,
-                                       display_boost]() -> void {
-    size_t width = yuv420_image_ptr->width;
-    size_t height = yuv420_image_ptr->height;
-
-    size_t rowStart, rowEnd;
-    while (jobQueue.dequeueJob(rowStart, rowEnd)) {
-      for (size_t y = rowStart; y < rowEnd; ++y) {
-        for (size_t x = 0; x < width; ++x) {
-          Color yuv_gamma_sdr = getYuv420Pixel(yuv420_image_ptr, x, y);
-          // Assuming the sdr image is a decoded JPEG, we should always use Rec.601 YUV coefficients
-          Color rgb_gamma_sdr = p3YuvToRgb(yuv_gamma_sdr);
-          // We are assuming the SDR base image is always sRGB transfer.
-#if USE_SRGB_INVOETF_LUT
-          Color rgb_sdr = srgbInvOetfLUT(rgb_gamma_sdr);
-#else
-          Color rgb_sdr = srgbInvOetf(rgb_gamma_sdr);
-#endif
-          float gain;
-          // TODO: determine map scaling factor based on actual map dims
-          size_t map_scale_factor = kMapDimensionScaleFactor;
-          // TODO: If map_scale_factor is guaranteed to be an integer, then remove the following.
-          // Currently map_scale_factor is of type size_t, but it could be changed to a float
-          // later.
-          if (map_scale_factor != floorf(map_scale_factor)) {
-            gain = sampleMap(gainmap_image_ptr, map_scale_factor, x, y);
-          } else {
-            gain = sampleMap(gainmap_image_ptr, map_scale_factor, x, y, idwTable);
-          }
-
-#if USE_APPLY_GAIN_LUT
-          Color rgb_hdr = applyGainLUT(rgb_sdr, gain, gainLUT);
-#else
-          Color rgb_hdr = applyGain(rgb_sdr, gain, metadata, display_boost);
-#endif
-          rgb_hdr = rgb_hdr / display_boost;
-          size_t pixel_idx = x + y * width;
-
-          switch (output_format) {
-            case ULTRAHDR_OUTPUT_HDR_LINEAR: {
-              uint64_t rgba_f16 = colorToRgbaF16(rgb_hdr);
-              reinterpret_cast<uint64_t*>(dest->data)[pixel_idx] = rgba_f16;
-              break;
-            }
-            case ULTRAHDR_OUTPUT_HDR_HLG: {
-#if USE_HLG_OETF_LUT
-              ColorTransformFn hdrOetf = hlgOetfLUT;
-#else
-              ColorTransformFn hdrOetf = hlgOetf;
-#endif
-              Color rgb_gamma_hdr = hdrOetf(rgb_hdr);
-              uint32_t rgba_1010102 = colorToRgba1010102(rgb_gamma_hdr);
-              reinterpret_cast<uint32_t*>(dest->data)[pixel_idx] = rgba_1010102;
-              break;
-            }
-            case ULTRAHDR_OUTPUT_HDR_PQ: {
-#if USE_PQ_OETF_LUT
-              ColorTransformFn hdrOetf = pqOetfLUT;
-#else
-              ColorTransformFn hdrOetf = pqOetf;
-#endif
-              Color rgb_gamma_hdr = hdrOetf(rgb_hdr);
-              uint32_t rgba_1010102 = colorToRgba1010102(rgb_gamma_hdr);
-              reinterpret_cast<uint32_t*>(dest->data)[pixel_idx] = rgba_1010102;
-              break;
-            }
-            default: {
-            }
-              // Should be impossible to hit after input validation.
-          }
-        }
-      }
-    }
-  };
-
-  const int threads = std::clamp(GetCPUCoreCount(), 1, 4);
-  std::vector<std::thread> workers;
-  for (int th = 0; th < threads - 1; th++) {
-    workers.push_back(std::thread(applyRecMap));
-  }
-  const int rowStep = threads == 1 ? yuv420_image_ptr->height : kJobSzInRows;
-  for (int rowStart = 0; rowStart < yuv420_image_ptr->height;) {
-    int rowEnd = std::min(rowStart + rowStep, yuv420_image_ptr->height);
-    jobQueue.enqueueJob(rowStart, rowEnd);
-    rowStart = rowEnd;
-  }
-  jobQueue.markQueueForEnd();
-  applyRecMap();
-  std::for_each(workers.begin(), workers.end(), [](std::thread& t) { t.join(); });
+  GainMapApplication application(metadata, output_format, max_display_boost);
+  applyGainMapRows(application, yuv420_image_ptr, 0, yuv420_image_ptr->height, gainmap_image_ptr,
+                   metadata, dest->data);
   return NO_ERROR;
 }
 
@@ -1491,11 +1544,24 @@ status_t JpegR::convertYuv(jr_uncompressed_ptr image, ultrahdr_color_gamut src_e
     return ERROR_JPEGR_INVALID_COLORGAMUT;
   }
 
-  for (size_t y = 0; y < image->height / 2; ++y) {
-    for (size_t x = 0; x < image->width / 2; ++x) {
-      transformYuv420(image, x, y, conversionFn);
+  // The chunks are of chroma rows, each of them is transformed in place with its 2 luma rows, so
+  // that the chunks touch distinct pixels.
+  ThreadPool& threadPool = ThreadPool::getInstance();
+  const size_t rowCount = image->height / 2;
+  const size_t chunkRows =
+          getChunkSizeInRows(image->width * 3, rowCount, 1, threadPool.getParallelism());
+
+  std::function<void(size_t, size_t)> transformRows = [image, conversionFn](size_t rowStart,
+                                                                         size_t rowEnd) -> void {
+    for (size_t y = rowStart; y < rowEnd; ++y) {
+      // The SIMD kernels transform most of the row, and give the same pixels as the loop below.
+      size_t x = transformYuv420Row(image, y, conversionFn);
+      for (; x < image->width / 2; ++x) {
+        transformYuv420(image, x, y, conversionFn);
+      }
     }
-  }
+  };
+  threadPool.parallelFor(rowCount, chunkRows, transformRows);
 
   return NO_ERROR;
 }
@@ -15,6 +15,9 @@
  */
 
 #include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include <ultrahdr/gainmapmath.h>
@@ -683,6 +686,40 @@ TEST_F(GainMapMathTest, TransformYuv420) {
   }
 }
 
+TEST_F(GainMapMathTest, TransformYuv420Row) {
+  // 18 chroma pixels per row, for the kernels to leave the last pixels to transformYuv420().
+  const size_t width = 36, height = 8;
+  std::mt19937 random(1);
+  std::vector<uint8_t> pixels(width * height * 3 / 2);
+  for (uint8_t& pixel : pixels) pixel = random();
+
+  ColorTransformFn transforms[] = { yuv709To601, yuv709To2100, yuv601To709, yuv601To2100,
+                                    yuv2100To709, yuv2100To601 };
+  for (const ColorTransformFn& transform : transforms) {
+    std::vector<uint8_t> expected = pixels;
+    std::vector<uint8_t> actual = pixels;
+    jpegr_uncompressed_struct expected_image = { expected.data(), width, height,
+                                                 ULTRAHDR_COLORGAMUT_BT709,
+                                                 expected.data() + width * height, width,
+                                                 width / 2 };
+    jpegr_uncompressed_struct actual_image = expected_image;
+    actual_image.data = actual.data();
+    actual_image.chroma_data = actual.data() + width * height;
+
+    for (size_t y = 0; y < height / 2; y++) {
+      for (size_t x = 0; x < width / 2; x++) {
+        transformYuv420(&expected_image, x, y, transform);
+      }
+      size_t count = transformYuv420Row(&actual_image, y, transform);
+      ASSERT_LE(count, width / 2);
+      for (size_t x = count; x < width / 2; x++) {
+        transformYuv420(&actual_image, x, y, transform);
+      }
+    }
+    EXPECT_EQ(expected, actual);
+  }
+}
+
 TEST_F(GainMapMathTest, HlgOetf) {
   EXPECT_FLOAT_EQ(hlgOetf(0.0f), 0.0f);
   EXPECT_NEAR(hlgOetf(0.04167f), 0.35357f, ComparisonEpsilon());
@@ -1270,6 +1307,131 @@ TEST_F(GainMapMathTest, GenerateMapLuminancePq) {
               bt2100Luminance(RgbBlue()) * kPqMaxNits, LuminanceEpsilon());
 }
 
+TEST_F(GainMapMathTest, GenerateGainMapRow) {
+  // 18 map pixels per row, for the kernels to leave the last pixels to the scalar functions.
+  const size_t width = 72, height = 8;
+  std::mt19937 random(1);
+  std::vector<uint8_t> yuv420_pixels(width * height * 3 / 2);
+  for (uint8_t& pixel : yuv420_pixels) pixel = random();
+  std::vector<uint16_t> p010_pixels(width * height * 3 / 2);
+  for (uint16_t& pixel : p010_pixels) pixel = (random() & 0x3ff) << 6;
+  jpegr_uncompressed_struct yuv420_image = { yuv420_pixels.data(), width, height,
+                                             ULTRAHDR_COLORGAMUT_BT709,
+                                             yuv420_pixels.data() + width * height, width,
+                                             width / 2 };
+  jpegr_uncompressed_struct p010_image = { p010_pixels.data(), width, height,
+                                           ULTRAHDR_COLORGAMUT_BT2100,
+                                           p010_pixels.data() + width * height, width, width };
+
+  const ColorTransformFn yuvToRgbFns[] = { srgbYuvToRgb, p3YuvToRgb, bt2100YuvToRgb };
+  const ColorCalculationFn luminanceFns[] = { srgbLuminance, p3Luminance, bt2100Luminance };
+  const ultrahdr_color_gamut gamuts[] = { ULTRAHDR_COLORGAMUT_BT709, ULTRAHDR_COLORGAMUT_P3,
+                                          ULTRAHDR_COLORGAMUT_BT2100 };
+  const ColorTransformFn invOetfFns[] = { identityConversion, hlgInvOetfLUT, pqInvOetfLUT };
+  for (size_t sdr = 0; sdr < 3; sdr++) {
+    for (size_t hdr = 0; hdr < 3; hdr++) {
+      for (ColorTransformFn hdrInvOetf : invOetfFns) {
+        ultrahdr_metadata_struct metadata = { .maxContentBoost = 10.0f,
+                                              .minContentBoost = 1.0f };
+        GainMapGenerationFns fns = {
+          .sdrYuvToRgbFn = yuvToRgbFns[sdr],
+          .sdrInvOetf = srgbInvOetfLUT,
+          .luminanceFn = luminanceFns[sdr],
+          .hdrYuvToRgbFn = yuvToRgbFns[hdr],
+          .hdrInvOetf = hdrInvOetf,
+          .hdrGamutConversionFn = getHdrConversionFn(gamuts[sdr], gamuts[hdr]),
+          .hdrWhiteNits = kHlgMaxNits,
+          .log2MinBoost = log2(metadata.minContentBoost),
+          .log2MaxBoost = log2(metadata.maxContentBoost),
+        };
+        for (size_t y = 0; y < height / 4; y++) {
+          uint8_t row[width / 4];
+          size_t count = generateGainMapRow(&yuv420_image, &p010_image, fns, &metadata, y,
+                                            width / 4, row);
+          ASSERT_LE(count, width / 4);
+          for (size_t x = 0; x < count; x++) {
+            Color sdr_rgb = fns.sdrInvOetf(fns.sdrYuvToRgbFn(sampleYuv420(&yuv420_image, 4, x, y)));
+            float sdr_y_nits = fns.luminanceFn(sdr_rgb) * kSdrWhiteNits;
+            Color hdr_rgb = fns.hdrInvOetf(fns.hdrYuvToRgbFn(sampleP010(&p010_image, 4, x, y)));
+            hdr_rgb = fns.hdrGamutConversionFn(hdr_rgb);
+            float hdr_y_nits = fns.luminanceFn(hdr_rgb) * fns.hdrWhiteNits;
+            EXPECT_EQ(row[x], encodeGain(sdr_y_nits, hdr_y_nits, &metadata, fns.log2MinBoost,
+                                         fns.log2MaxBoost)) << "x " << x << ", y " << y;
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_F(GainMapMathTest, ApplyGainMapRow) {
+  // 20 map pixels per row, for the kernels to apply the last column of the map.
+  const size_t width = 80, height = 8;
+  std::mt19937 random(1);
+  std::vector<uint8_t> yuv420_pixels(width * height * 3 / 2);
+  for (uint8_t& pixel : yuv420_pixels) pixel = random();
+  std::vector<uint8_t> map_pixels(width * height / 16);
+  for (uint8_t& pixel : map_pixels) pixel = random();
+  jpegr_uncompressed_struct yuv420_image = { yuv420_pixels.data(), width, height,
+                                             ULTRAHDR_COLORGAMUT_P3,
+                                             yuv420_pixels.data() + width * height, width,
+                                             width / 2 };
+  jpegr_uncompressed_struct map = { map_pixels.data(), width / 4, height / 4,
+                                    ULTRAHDR_COLORGAMUT_UNSPECIFIED };
+  // The bottom half of the rows, as a strip of the image.
+  std::vector<uint8_t> strip_pixels(yuv420_pixels.begin() + width * height / 2,
+                                    yuv420_pixels.begin() + width * height);
+  for (size_t plane = 0; plane < 2; plane++) {
+    const uint8_t* chroma = yuv420_pixels.data() + width * height * (4 + plane) / 4;
+    strip_pixels.insert(strip_pixels.end(), chroma + width * height / 8,
+                        chroma + width * height / 4);
+  }
+  jpegr_uncompressed_struct strip_image = { strip_pixels.data(), width, height / 2,
+                                            ULTRAHDR_COLORGAMUT_P3,
+                                            strip_pixels.data() + width * height / 2, width,
+                                            width / 2 };
+
+  ultrahdr_metadata_struct metadata = { .maxContentBoost = 8.0f,
+                                        .minContentBoost = 1.0f / 8.0f };
+  ShepardsIDW idwTable(kMapDimensionScaleFactor);
+  GainLUT gainLUT(&metadata, 4.0f);
+  const ultrahdr_output_format formats[] = { ULTRAHDR_OUTPUT_HDR_LINEAR, ULTRAHDR_OUTPUT_HDR_HLG,
+                                             ULTRAHDR_OUTPUT_HDR_PQ };
+  for (ultrahdr_output_format format : formats) {
+    GainMapApplicationFns fns = {
+      .sdrYuvToRgbFn = p3YuvToRgb,
+      .sdrInvOetf = srgbInvOetfLUT,
+      .gainLUT = &gainLUT,
+      .displayBoost = 4.0f,
+      .outputFormat = format,
+      .hdrOetf = format == ULTRAHDR_OUTPUT_HDR_PQ ? static_cast<ColorTransformFn>(pqOetfLUT)
+                                                  : static_cast<ColorTransformFn>(hlgOetfLUT),
+    };
+    for (size_t y = 0; y < height; y++) {
+      uint64_t row[width];
+      size_t count = applyGainMapRow(&yuv420_image, 0, &map, fns, idwTable, y, width, row);
+      ASSERT_LE(count, width);
+      if (y >= height / 2) {
+        uint64_t strip_row[width];
+        ASSERT_EQ(count, applyGainMapRow(&strip_image, height / 2, &map, fns, idwTable, y, width,
+                                         strip_row));
+        EXPECT_EQ(0, memcmp(row, strip_row, count * sizeof(uint64_t))) << "y " << y;
+      }
+      for (size_t x = 0; x < count; x++) {
+        Color rgb_sdr = fns.sdrInvOetf(fns.sdrYuvToRgbFn(getYuv420Pixel(&yuv420_image, x, y)));
+        float gain = sampleMap(&map, kMapDimensionScaleFactor, x, y, idwTable);
+        Color rgb_hdr = applyGainLUT(rgb_sdr, gain, gainLUT) / fns.displayBoost;
+        if (format == ULTRAHDR_OUTPUT_HDR_LINEAR) {
+          EXPECT_EQ(row[x], colorToRgbaF16(rgb_hdr)) << "x " << x << ", y " << y;
+        } else {
+          EXPECT_EQ(reinterpret_cast<uint32_t*>(row)[x], colorToRgba1010102(fns.hdrOetf(rgb_hdr)))
+                  << "x " << x << ", y " << y;
+        }
+      }
+    }
+  }
+}
+
 TEST_F(GainMapMathTest, ApplyMap) {
   ultrahdr_metadata_struct metadata = { .maxContentBoost = 8.0f,
                                      .minContentBoost = 1.0f / 8.0f };
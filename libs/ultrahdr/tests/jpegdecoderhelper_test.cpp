@@ -123,6 +123,49 @@ TEST_F(JpegDecoderHelperTest, decodeGreyImage) {
     ASSERT_GT(decoder.getDecompressedImageSize(), static_cast<uint32_t>(0));
 }
 
+TEST_F(JpegDecoderHelperTest, decompressYuvImageRows) {
+    JpegDecoderHelper decoder;
+    ASSERT_TRUE(decoder.decompressImage(mYuvIccImage.buffer.get(), mYuvIccImage.size));
+    const uint8_t* image = static_cast<uint8_t*>(decoder.getDecompressedImagePtr());
+
+    JpegDecoderHelper rowDecoder;
+    ASSERT_TRUE(rowDecoder.startDecompressRows(mYuvIccImage.buffer.get(), mYuvIccImage.size, 40));
+    EXPECT_EQ(rowDecoder.getDecompressedImageWidth(), IMAGE_WIDTH);
+    EXPECT_EQ(rowDecoder.getDecompressedImageHeight(), IMAGE_HEIGHT);
+    EXPECT_EQ(IccHelper::readIccColorGamut(rowDecoder.getICCPtr(), rowDecoder.getICCSize()),
+              ULTRAHDR_COLORGAMUT_BT709);
+    EXPECT_GT(rowDecoder.getEXIFSize(), 0);
+    const size_t capacity = rowDecoder.getDecompressedRowsCapacity();
+    const size_t stride = rowDecoder.getDecompressedRowsStride();
+    EXPECT_EQ(capacity, 48);
+
+    size_t row = 0, rowCount;
+    while (rowDecoder.decompressRows(&rowCount) && rowCount > 0) {
+        ASSERT_LE(row + rowCount, IMAGE_HEIGHT);
+        const uint8_t* rows = static_cast<uint8_t*>(rowDecoder.getDecompressedRowsPtr());
+        for (size_t y = 0; y < rowCount; y++) {
+            EXPECT_EQ(0, memcmp(rows + y * stride, image + (row + y) * IMAGE_WIDTH, IMAGE_WIDTH))
+                    << "row " << row + y;
+        }
+        for (size_t plane = 0; plane < 2; plane++) {
+            const uint8_t* rowsPlane = rows + stride * capacity * (4 + plane) / 4;
+            const uint8_t* imagePlane = image + IMAGE_WIDTH * IMAGE_HEIGHT * (4 + plane) / 4;
+            for (size_t y = 0; y < rowCount / 2; y++) {
+                EXPECT_EQ(0, memcmp(rowsPlane + y * stride / 2,
+                                    imagePlane + (row / 2 + y) * IMAGE_WIDTH / 2, IMAGE_WIDTH / 2))
+                        << "chroma row " << row / 2 + y;
+            }
+        }
+        row += rowCount;
+    }
+    EXPECT_EQ(row, IMAGE_HEIGHT);
+}
+
+TEST_F(JpegDecoderHelperTest, decompressGreyImageRows) {
+    JpegDecoderHelper decoder;
+    EXPECT_FALSE(decoder.startDecompressRows(mGreyImage.buffer.get(), mGreyImage.size, 16));
+}
+
 TEST_F(JpegDecoderHelperTest, getCompressedImageParameters) {
     size_t width = 0, height = 0;
     std::vector<uint8_t> icc, exif;
@@ -309,6 +309,19 @@ void decodeJpegRImg(jr_compressed_ptr img, [[maybe_unused]] const char* outFileN
   ASSERT_EQ(OK, jpegHdr.decodeJPEGR(img, &destImage));
   ASSERT_EQ(kImageWidth, destImage.width);
   ASSERT_EQ(kImageHeight, destImage.height);
+
+  // The rows decoded in strips are the rows of the image.
+  std::unique_ptr<uint8_t[]> rowsData = std::make_unique<uint8_t[]>(outSize);
+  size_t nextRow = 0;
+  ASSERT_EQ(OK, jpegHdr.decodeJPEGRRows(img, [&](size_t row, size_t rowCount, const void* pixels) {
+    EXPECT_EQ(nextRow, row);
+    EXPECT_LE(row + rowCount, info.height);
+    memcpy(rowsData.get() + row * info.width * 8, pixels, rowCount * info.width * 8);
+    nextRow = row + rowCount;
+    return OK;
+  }));
+  ASSERT_EQ(info.height, nextRow);
+  ASSERT_EQ(0, memcmp(data.get(), rowsData.get(), outSize));
 #ifdef DUMP_OUTPUT
   if (!writeFile(outFileName, destImage.data, outSize)) {
     std::cerr << "unable to write output file" << std::endl;
@@ -1340,6 +1353,15 @@ TEST(JpegRTest, DecodeAPIWithInvalidArgs) {
                                 static_cast<ultrahdr_output_format>(ULTRAHDR_OUTPUT_MAX + 1)),
             OK)
           << "fail, API allows invalid output format";
+
+  // test rows writer
+  JpegR::RowsWriter writer = [](size_t, size_t, const void*) { return OK; };
+  ASSERT_NE(uHdrLib.decodeJPEGRRows(jpgImg.getImageHandle(), nullptr), OK)
+          << "fail, API allows empty rows writer";
+  ASSERT_NE(uHdrLib.decodeJPEGRRows(jpgImg.getImageHandle(), writer, FLT_MAX, nullptr,
+                                    ULTRAHDR_OUTPUT_SDR),
+            OK)
+          << "fail, API allows sdr output for rows";
 }
 
 TEST(JpegRTest, writeXmpThenRead) {
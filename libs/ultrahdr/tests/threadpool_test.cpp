@@ -0,0 +1,110 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <ultrahdr/threadpool.h>
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace android::ultrahdr {
+
+// Runs a job over rowCount rows, and expects each row to run once.
+static void expectRowsRunOnce(ThreadPool& pool, size_t rowCount, size_t chunkSize) {
+  std::vector<std::atomic<int>> runs(rowCount);
+  pool.parallelFor(rowCount, chunkSize, [&](size_t rowStart, size_t rowEnd) {
+    EXPECT_LT(rowStart, rowEnd);
+    EXPECT_LE(rowEnd, rowCount);
+    EXPECT_LE(rowEnd - rowStart, chunkSize);
+    for (size_t y = rowStart; y < rowEnd; y++) {
+      runs[y]++;
+    }
+  });
+  for (size_t y = 0; y < rowCount; y++) {
+    EXPECT_EQ(1, runs[y].load()) << "row " << y << " of " << rowCount << " by " << chunkSize;
+  }
+}
+
+TEST(ThreadPoolTest, EachRowRunsOnce) {
+  ThreadPool pool({.parallelism = 4, .cpus = {}});
+  EXPECT_EQ(4, pool.getParallelism());
+  for (size_t rowCount : {0, 1, 15, 16, 17, 1000}) {
+    for (size_t chunkSize : {1, 3, 16, 2000}) {
+      expectRowsRunOnce(pool, rowCount, chunkSize);
+    }
+  }
+}
+
+TEST(ThreadPoolTest, JobsRunOnTheWorkers) {
+  ThreadPool pool({.parallelism = 3, .cpus = {}});
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  // Keep the threads busy enough for the workers to join the job.
+  pool.parallelFor(300, 1, [&](size_t, size_t) {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.insert(std::this_thread::get_id());
+  });
+  EXPECT_EQ(1, threads.count(std::this_thread::get_id()));
+  EXPECT_LT(1, threads.size());
+  EXPECT_GE(3, threads.size());
+}
+
+TEST(ThreadPoolTest, JobsOfSeveralThreadsRunAtOnce) {
+  ThreadPool pool({.parallelism = 4, .cpus = {}});
+  std::vector<std::thread> callers;
+  for (int i = 0; i < 8; i++) {
+    callers.push_back(std::thread([&pool] {
+      for (int job = 0; job < 20; job++) {
+        expectRowsRunOnce(pool, 200, 7);
+      }
+    }));
+  }
+  for (std::thread& caller : callers) {
+    caller.join();
+  }
+}
+
+TEST(ThreadPoolTest, ConfigureReplacesTheWorkers) {
+  ThreadPool pool({.parallelism = 2, .cpus = {}});
+  expectRowsRunOnce(pool, 100, 4);
+
+  pool.configure({.parallelism = 1, .cpus = {}});
+  EXPECT_EQ(1, pool.getParallelism());
+  std::set<std::thread::id> threads;
+  pool.parallelFor(100, 4, [&](size_t, size_t) { threads.insert(std::this_thread::get_id()); });
+  EXPECT_EQ(std::set<std::thread::id>{std::this_thread::get_id()}, threads);
+
+  pool.configure({.parallelism = 3, .cpus = {0}});
+  EXPECT_EQ(3, pool.getParallelism());
+  expectRowsRunOnce(pool, 100, 4);
+}
+
+TEST(ThreadPoolTest, ChunkSizeIsAligned) {
+  for (size_t rowBytes : {1, 1000, 100000, 10000000}) {
+    for (size_t alignment : {1, 4}) {
+      size_t rows = getChunkSizeInRows(rowBytes, 3000, alignment, 4);
+      EXPECT_LE(alignment, rows);
+      EXPECT_EQ(0, rows % alignment);
+      // Each of the threads gets a few chunks.
+      EXPECT_GE(3000 / 16 + alignment, rows);
+    }
+  }
+}
+
+} // namespace android::ultrahdr
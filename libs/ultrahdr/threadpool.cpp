@@ -0,0 +1,271 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ultrahdr/threadpool.h>
+
+#include <sched.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include <utils/Log.h>
+
+namespace android::ultrahdr {
+
+#define CONFIG_MULTITHREAD 1
+static int GetCPUCoreCount() {
+  int cpuCoreCount = 1;
+#if CONFIG_MULTITHREAD
+#if defined(_SC_NPROCESSORS_ONLN)
+  cpuCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+  // _SC_NPROC_ONLN must be defined...
+  cpuCoreCount = sysconf(_SC_NPROC_ONLN);
+#endif
+#endif
+  return cpuCoreCount;
+}
+
+// The cache size when the system does not report it.
+static const size_t kDefaultCacheSize = 256 * 1024;
+
+static size_t getCacheSize() {
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+  long cacheSize = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  if (cacheSize > 0) {
+    return static_cast<size_t>(cacheSize);
+  }
+#endif
+  return kDefaultCacheSize;
+}
+
+// The chunks of each thread, for the threads which finish early to balance the others.
+static const size_t kMinChunksPerThread = 4;
+
+size_t getChunkSizeInRows(size_t rowBytes, size_t rowCount, size_t alignment, size_t parallelism) {
+  static const size_t cacheSize = getCacheSize();
+  size_t rows = cacheSize / 2 / std::max(rowBytes, static_cast<size_t>(1));
+  if (parallelism > 1) {
+    size_t chunkCount = parallelism * kMinChunksPerThread;
+    rows = std::min(rows, (rowCount + chunkCount - 1) / chunkCount);
+  }
+  rows -= rows % alignment;
+  return std::max(rows, alignment);
+}
+
+/*
+ * The chunks of a job. The range of each thread is packed in an atomic, the index of its first
+ * chunk in the low 32 bits and the index after its last chunk in the high 32 bits: the thread
+ * takes chunks from the start of its range, and the others steal them from its end.
+ */
+struct ThreadPool::Job {
+  struct alignas(64) Range {
+    std::atomic<uint64_t> chunks;
+  };
+
+  Job(size_t rowCount, size_t chunkSize, size_t parallelism,
+      const std::function<void(size_t, size_t)>* fn)
+        : mRowCount(rowCount), mChunkSize(chunkSize), mFn(fn),
+          mRanges(new Range[parallelism]), mRangeCount(parallelism) {
+    const size_t chunkCount = (rowCount + chunkSize - 1) / chunkSize;
+    for (size_t i = 0; i < parallelism; i++) {
+      const uint64_t first = chunkCount * i / parallelism;
+      const uint64_t end = chunkCount * (i + 1) / parallelism;
+      mRanges[i].chunks.store(first | (end << 32), std::memory_order_relaxed);
+    }
+    mRemainingChunks.store(chunkCount, std::memory_order_relaxed);
+  }
+
+  // Runs chunks until all of them are taken, the thread takes the chunks of range first.
+  void run(size_t range) {
+    size_t chunk;
+    while (takeFirstChunk(range, &chunk) || stealChunk(range, &chunk)) {
+      const size_t rowStart = chunk * mChunkSize;
+      (*mFn)(rowStart, std::min(rowStart + mChunkSize, mRowCount));
+      if (mRemainingChunks.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDone.notify_all();
+      }
+    }
+  }
+
+  void waitUntilDone() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDone.wait(lock, [this] { return mRemainingChunks.load(std::memory_order_acquire) == 0; });
+  }
+
+  // The range of the next thread which joins the job.
+  size_t joinRange() {
+    return mNextRange.fetch_add(1, std::memory_order_relaxed) % mRangeCount;
+  }
+
+private:
+  bool takeFirstChunk(size_t range, size_t* chunk) {
+    std::atomic<uint64_t>& chunks = mRanges[range].chunks;
+    uint64_t value = chunks.load(std::memory_order_relaxed);
+    while (static_cast<uint32_t>(value) < (value >> 32)) {
+      if (chunks.compare_exchange_weak(value, value + 1, std::memory_order_acquire)) {
+        *chunk = static_cast<uint32_t>(value);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool stealChunk(size_t range, size_t* chunk) {
+    for (size_t i = 1; i < mRangeCount; i++) {
+      std::atomic<uint64_t>& chunks = mRanges[(range + i) % mRangeCount].chunks;
+      uint64_t value = chunks.load(std::memory_order_relaxed);
+      while (static_cast<uint32_t>(value) < (value >> 32)) {
+        const uint64_t end = (value >> 32) - 1;
+        if (chunks.compare_exchange_weak(value, (value & 0xffffffff) | (end << 32),
+                                         std::memory_order_acquire)) {
+          *chunk = end;
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  const size_t mRowCount;
+  const size_t mChunkSize;
+  // The function of parallelFor(), which is not called once the chunks are done.
+  const std::function<void(size_t, size_t)>* const mFn;
+  const std::unique_ptr<Range[]> mRanges;
+  const size_t mRangeCount;
+  // The range of the calling thread is the first one.
+  std::atomic<size_t> mNextRange{1};
+  std::atomic<size_t> mRemainingChunks;
+  std::mutex mMutex;
+  std::condition_variable mDone;
+};
+
+ThreadPool& ThreadPool::getInstance() {
+  // Never destroyed, so that the workers are not joined while the process exits.
+  static ThreadPool* instance = new ThreadPool();
+  return *instance;
+}
+
+ThreadPool::ThreadPool(const ThreadPoolConfig& config) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  startWorkersLocked(config);
+}
+
+ThreadPool::~ThreadPool() {
+  stopWorkers();
+}
+
+void ThreadPool::configure(const ThreadPoolConfig& config) {
+  std::lock_guard<std::mutex> configureLock(mConfigureMutex);
+  stopWorkers();
+  std::lock_guard<std::mutex> lock(mMutex);
+  startWorkersLocked(config);
+}
+
+void ThreadPool::stopWorkers() {
+  std::vector<std::thread> workers;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+    mParallelism = 1;
+    workers.swap(mWorkers);
+  }
+  mJobPosted.notify_all();
+  std::for_each(workers.begin(), workers.end(), [](std::thread& t) { t.join(); });
+  std::lock_guard<std::mutex> lock(mMutex);
+  mStopping = false;
+}
+
+size_t ThreadPool::getParallelism() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mParallelism;
+}
+
+void ThreadPool::startWorkersLocked(const ThreadPoolConfig& config) {
+  mParallelism = config.parallelism;
+  if (mParallelism == 0) {
+    mParallelism = std::clamp(GetCPUCoreCount(), 1, static_cast<int>(kDefaultMaxParallelism));
+  }
+  for (size_t i = 1; i < mParallelism; i++) {
+    mWorkers.push_back(std::thread(&ThreadPool::runWorker, this, config.cpus));
+  }
+}
+
+void ThreadPool::runWorker(std::vector<int> cpus) {
+#if defined(__linux__)
+  if (!cpus.empty()) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int cpu : cpus) {
+      CPU_SET(cpu, &cpuSet);
+    }
+    if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0) {
+      ALOGW("Failed to set the CPU affinity of the worker");
+    }
+  }
+#endif
+
+  std::unique_lock<std::mutex> lock(mMutex);
+  while (true) {
+    mJobPosted.wait(lock, [this] { return mStopping || !mJobs.empty(); });
+    if (mStopping) {
+      return;
+    }
+    std::shared_ptr<Job> job = mJobs.front();
+    lock.unlock();
+    job->run(job->joinRange());
+    lock.lock();
+    // All of the chunks of the job are taken, the job is left to the threads which run them.
+    auto it = std::find(mJobs.begin(), mJobs.end(), job);
+    if (it != mJobs.end()) {
+      mJobs.erase(it);
+    }
+  }
+}
+
+void ThreadPool::parallelFor(size_t rowCount, size_t chunkSize,
+                             const std::function<void(size_t rowStart, size_t rowEnd)>& fn) {
+  chunkSize = std::max(chunkSize, static_cast<size_t>(1));
+  if (rowCount == 0) {
+    return;
+  }
+  const size_t parallelism = getParallelism();
+  if (parallelism == 1 || rowCount <= chunkSize) {
+    for (size_t rowStart = 0; rowStart < rowCount; rowStart += chunkSize) {
+      fn(rowStart, std::min(rowStart + chunkSize, rowCount));
+    }
+    return;
+  }
+
+  auto job = std::make_shared<Job>(rowCount, chunkSize, parallelism, &fn);
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mJobs.push_back(job);
+  }
+  mJobPosted.notify_all();
+  job->run(0);
+  job->waitUntilDone();
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto it = std::find(mJobs.begin(), mJobs.end(), job);
+  if (it != mJobs.end()) {
+    mJobs.erase(it);
+  }
+}
+
+} // namespace android::ultrahdr
@@ -25,7 +25,9 @@
 #include <log/log.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <chrono>
+#include <limits>
 
 namespace android {
 
@@ -33,7 +35,7 @@ namespace android {
 static const uint32_t blobCacheMagic = ('_' << 24) + ('B' << 16) + ('b' << 8) + '$';
 
 // BlobCache::Header::mBlobCacheVersion value
-static const uint32_t blobCacheVersion = 3;
+static const uint32_t blobCacheVersion = 4;
 
 // BlobCache::Header::mDeviceVersion value
 static const uint32_t blobCacheDeviceVersion = 1;
@@ -149,9 +151,15 @@ size_t BlobCache::get(const void* key, size_t keySize, void* value, size_t value
     auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), cacheEntry);
     if (index == mCacheEntries.end() || cacheEntry < *index) {
         ALOGV("get: no cache entry found for key of size %zu", keySize);
+        mStats.misses++;
         return 0;
     }
 
+    mStats.hits++;
+    if (index->getHitCount() < std::numeric_limits<uint32_t>::max()) {
+        index->setHitCount(index->getHitCount() + 1);
+    }
+
     // The key was found. Return the value if the caller's buffer is large
     // enough.
     std::shared_ptr<Blob> valueBlob(index->getValue());
@@ -215,6 +223,7 @@ int BlobCache::flatten(void* buffer, size_t size) const {
         EntryHeader* eheader = reinterpret_cast<EntryHeader*>(&byteBuffer[byteOffset]);
         eheader->mKeySize = keySize;
         eheader->mValueSize = valueSize;
+        eheader->mHitCount = e.getHitCount();
 
         memcpy(eheader->mData, keyBlob->getData(), keySize);
         memcpy(eheader->mData + keySize, valueBlob->getData(), valueSize);
@@ -280,7 +289,16 @@ int BlobCache::unflatten(void const* buffer, size_t size) {
         }
 
         const uint8_t* data = eheader->mData;
-        set(data, keySize, data + keySize, valueSize);
+        InsertResult result = set(data, keySize, data + keySize, valueSize);
+        if (result == InsertResult::kInserted || result == InsertResult::kDidClean) {
+            // Restore the hit count of the entry
+            std::shared_ptr<Blob> cacheKey(new Blob(data, keySize, false));
+            CacheEntry cacheEntry(cacheKey, nullptr);
+            auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), cacheEntry);
+            if (index != mCacheEntries.end() && !(cacheEntry < *index)) {
+                index->setHitCount(eheader->mHitCount);
+            }
+        }
 
         byteOffset += totalSize;
     }
@@ -299,14 +317,40 @@ long int BlobCache::blob_random() {
 void BlobCache::clean() {
     ATRACE_NAME("BlobCache::clean");
 
-    // Remove a random cache entry until the total cache size gets below half
-    // the maximum total cache size.
-    while (mTotalSize > mMaxTotalSize / 2) {
-        size_t i = size_t(blob_random() % (mCacheEntries.size()));
+    // Order the entries by hit count, then randomly among the entries with as
+    // many hits.
+    std::vector<std::pair<uint64_t, size_t>> evictionOrder;
+    evictionOrder.reserve(mCacheEntries.size());
+    for (size_t i = 0; i < mCacheEntries.size(); i++) {
+        uint64_t hitCount = mCacheEntries[i].getHitCount();
+        uint64_t tieBreak = static_cast<uint32_t>(blob_random());
+        evictionOrder.emplace_back((hitCount << 32) | tieBreak, i);
+    }
+    std::sort(evictionOrder.begin(), evictionOrder.end());
+
+    // Remove the entries with the fewest hits until the total cache size gets
+    // below half the maximum total cache size.
+    std::vector<bool> evicted(mCacheEntries.size(), false);
+    for (const auto& [order, i] : evictionOrder) {
+        if (mTotalSize <= mMaxTotalSize / 2) {
+            break;
+        }
         const CacheEntry& entry(mCacheEntries[i]);
         mTotalSize -= entry.getKey()->getSize() + entry.getValue()->getSize();
-        mCacheEntries.erase(mCacheEntries.begin() + i);
+        evicted[i] = true;
+        mStats.evictions++;
     }
+
+    // Keep the remaining entries sorted by key, with half of their hits.
+    size_t kept = 0;
+    for (size_t i = 0; i < mCacheEntries.size(); i++) {
+        if (!evicted[i]) {
+            mCacheEntries[kept] = mCacheEntries[i];
+            mCacheEntries[kept].setHitCount(mCacheEntries[kept].getHitCount() / 2);
+            kept++;
+        }
+    }
+    mCacheEntries.resize(kept);
 }
 
 bool BlobCache::isCleanable() const {
@@ -342,13 +386,14 @@ size_t BlobCache::Blob::getSize() const {
     return mSize;
 }
 
-BlobCache::CacheEntry::CacheEntry() {}
+BlobCache::CacheEntry::CacheEntry() : mHitCount(0) {}
 
 BlobCache::CacheEntry::CacheEntry(const std::shared_ptr<Blob>& key,
-                                  const std::shared_ptr<Blob>& value)
-      : mKey(key), mValue(value) {}
+                                  const std::shared_ptr<Blob>& value, uint32_t hitCount)
+      : mKey(key), mValue(value), mHitCount(hitCount) {}
 
-BlobCache::CacheEntry::CacheEntry(const CacheEntry& ce) : mKey(ce.mKey), mValue(ce.mValue) {}
+BlobCache::CacheEntry::CacheEntry(const CacheEntry& ce)
+      : mKey(ce.mKey), mValue(ce.mValue), mHitCount(ce.mHitCount) {}
 
 bool BlobCache::CacheEntry::operator<(const CacheEntry& rhs) const {
     return *mKey < *rhs.mKey;
@@ -357,6 +402,7 @@ bool BlobCache::CacheEntry::operator<(const CacheEntry& rhs) const {
 const BlobCache::CacheEntry& BlobCache::CacheEntry::operator=(const CacheEntry& rhs) {
     mKey = rhs.mKey;
     mValue = rhs.mValue;
+    mHitCount = rhs.mHitCount;
     return *this;
 }
 
@@ -372,4 +418,12 @@ void BlobCache::CacheEntry::setValue(const std::shared_ptr<Blob>& value) {
     mValue = value;
 }
 
+uint32_t BlobCache::CacheEntry::getHitCount() const {
+    return mHitCount;
+}
+
+void BlobCache::CacheEntry::setHitCount(uint32_t hitCount) {
+    mHitCount = hitCount;
+}
+
 } // namespace android
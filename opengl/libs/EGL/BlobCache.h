@@ -18,6 +18,7 @@
 #define ANDROID_BLOB_CACHE_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <memory>
 #include <vector>
@@ -122,6 +123,22 @@ public:
         mTotalSize = 0;
     }
 
+    // Stats counts the lookups and evictions of the cache since it was
+    // created.
+    struct Stats {
+        // hits is the number of calls to get which found their key.
+        size_t hits = 0;
+
+        // misses is the number of calls to get which didn't find their key.
+        size_t misses = 0;
+
+        // evictions is the number of entries evicted to make room for new ones.
+        size_t evictions = 0;
+    };
+
+    // getStats returns the counters of the cache.
+    Stats getStats() const { return mStats; }
+
 protected:
     // mMaxTotalSize is the maximum size that all cache entries can occupy. This
     // includes space for both keys and values. When a call to BlobCache::set
@@ -138,8 +155,11 @@ private:
     // A random function helper to get around MinGW not having nrand48()
     long int blob_random();
 
-    // clean evicts a randomly chosen set of entries from the cache such that
-    // the total size of all remaining entries is less than mMaxTotalSize/2.
+    // clean evicts the entries with the fewest hits from the cache, chosen
+    // randomly among the entries with as many hits, such that the total size
+    // of all remaining entries is less than mMaxTotalSize/2. The hit counts of
+    // the remaining entries are then halved, so that the entries which were
+    // hot in the past make room for new ones over time.
     void clean();
 
     // isCleanable returns true if the cache is full enough for the clean method
@@ -177,7 +197,8 @@ private:
     class CacheEntry {
     public:
         CacheEntry();
-        CacheEntry(const std::shared_ptr<Blob>& key, const std::shared_ptr<Blob>& value);
+        CacheEntry(const std::shared_ptr<Blob>& key, const std::shared_ptr<Blob>& value,
+                   uint32_t hitCount = 0);
         CacheEntry(const CacheEntry& ce);
 
         bool operator<(const CacheEntry& rhs) const;
@@ -188,12 +209,19 @@ private:
 
         void setValue(const std::shared_ptr<Blob>& value);
 
+        uint32_t getHitCount() const;
+        void setHitCount(uint32_t hitCount);
+
     private:
         // mKey is the key that identifies the cache entry.
         std::shared_ptr<Blob> mKey;
 
         // mValue is the cached data associated with the key.
         std::shared_ptr<Blob> mValue;
+
+        // mHitCount is the number of times the entry was found by get, which
+        // clean uses to pick the entries to evict.
+        uint32_t mHitCount;
     };
 
     // A Header is the header for the entire BlobCache serialization format. No
@@ -237,6 +265,10 @@ private:
         // mValueSize is the size of the entry value in bytes.
         size_t mValueSize;
 
+        // mHitCount is the hit count of the entry, so that it carries over to
+        // the next execution of the program.
+        uint32_t mHitCount;
+
         // mData contains both the key and value data for the cache entry.  The
         // key comes first followed immediately by the value.
         uint8_t mData[];
@@ -263,6 +295,9 @@ private:
     // mCacheEntries stores all the cache entries that are resident in memory.
     // Cache entries are added to it by the 'set' method.
     std::vector<CacheEntry> mCacheEntries;
+
+    // mStats counts the lookups and evictions of the cache.
+    Stats mStats;
 };
 
 } // namespace android
@@ -294,6 +294,50 @@ TEST_F(BlobCacheTest, ExceedingTotalLimitHalvesCacheSize) {
     ASSERT_EQ(maxEntries / 2 + 1, numCached);
 }
 
+TEST_F(BlobCacheTest, ExceedingTotalLimitKeepsHotEntries) {
+    // Fill up the entire cache with 1 char key/value pairs, and hit the first
+    // two entries.
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries; i++) {
+        uint8_t k = i;
+        ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set(&k, 1, "x", 1));
+    }
+    for (uint8_t k = 0; k < 2; k++) {
+        ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    }
+    // Insert one more entry, causing a cache overflow.
+    {
+        uint8_t k = maxEntries;
+        ASSERT_EQ(BlobCache::InsertResult::kDidClean, mBC->set(&k, 1, "x", 1));
+    }
+    // The hot entries and the new entry are still cached.
+    for (uint8_t k : {uint8_t(0), uint8_t(1), uint8_t(maxEntries)}) {
+        ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    }
+}
+
+TEST_F(BlobCacheTest, StatsCountHitsMissesAndEvictions) {
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries; i++) {
+        uint8_t k = i;
+        ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set(&k, 1, "x", 1));
+    }
+    uint8_t k = 0;
+    ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    ASSERT_EQ(size_t(0), mBC->get("y", 1, nullptr, 0));
+
+    BlobCache::Stats stats = mBC->getStats();
+    ASSERT_EQ(size_t(2), stats.hits);
+    ASSERT_EQ(size_t(1), stats.misses);
+    ASSERT_EQ(size_t(0), stats.evictions);
+
+    // Overflowing the cache evicts entries until at most half of it is used.
+    k = maxEntries;
+    ASSERT_EQ(BlobCache::InsertResult::kDidClean, mBC->set(&k, 1, "x", 1));
+    ASSERT_EQ(size_t(maxEntries - maxEntries / 2), mBC->getStats().evictions);
+}
+
 TEST_F(BlobCacheTest, InvalidKeySize) {
     ASSERT_EQ(BlobCache::InsertResult::kInvalidKeySize, mBC->set("", 0, "efgh", 4));
 }
@@ -355,6 +399,30 @@ TEST_F(BlobCacheFlattenTest, FlattenFullCache) {
     }
 }
 
+TEST_F(BlobCacheFlattenTest, FlattenKeepsHitCounts) {
+    // Fill up the entire cache with 1 char key/value pairs, and hit the first
+    // two entries.
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries; i++) {
+        uint8_t k = i;
+        mBC->set(&k, 1, &k, 1);
+    }
+    for (uint8_t k = 0; k < 2; k++) {
+        ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    }
+
+    roundTrip();
+
+    // Overflowing the deserialized cache keeps the hot entries.
+    uint8_t k = maxEntries;
+    ASSERT_EQ(BlobCache::InsertResult::kDidClean, mBC2->set(&k, 1, &k, 1));
+    for (uint8_t k : {uint8_t(0), uint8_t(1), uint8_t(maxEntries)}) {
+        uint8_t v = 0xee;
+        ASSERT_EQ(size_t(1), mBC2->get(&k, 1, &v, 1));
+        ASSERT_EQ(k, v);
+    }
+}
+
 TEST_F(BlobCacheFlattenTest, FlattenDoesntChangeCache) {
     // Fill up the entire cache with 1 char key/value pairs.
     const int maxEntries = MAX_TOTAL_SIZE / 2;
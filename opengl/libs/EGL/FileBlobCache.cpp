@@ -25,6 +25,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <android-base/properties.h>
 #include <log/log.h>
 #include <utils/Trace.h>
 
@@ -124,6 +125,12 @@ FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxT
 void FileBlobCache::writeToFile() {
     ATRACE_CALL();
 
+    if (base::GetBoolProperty("debug.egl.blobcache.stats", false)) {
+        Stats stats = getStats();
+        ALOGI("blob cache stats: %zu hits, %zu misses, %zu evictions", stats.hits, stats.misses,
+              stats.evictions);
+    }
+
     if (mFilename.length() > 0) {
         size_t cacheSize = getFlattenedSize();
         size_t headerSize = cacheFileHeaderSize;
@@ -156,7 +156,7 @@ int Loader::driver_t::set(void* hnd, int32_t api)
 }
 
 Loader::Loader()
-    : getProcAddress(nullptr)
+    : getProcAddress(nullptr), gles1_dso(nullptr), gles1_pending(false)
 {
 }
 
@@ -209,6 +209,12 @@ static void uninit_api(char const* const* api, __eglMustCastToProperFunctionPoin
 void Loader::unload_system_driver(egl_connection_t* cnx) {
     ATRACE_CALL();
 
+    {
+        std::lock_guard<std::mutex> lock(gles1_lock);
+        gles1_dso = nullptr;
+        gles1_pending = false;
+    }
+
     uninit_api(gl_names,
                (__eglMustCastToProperFunctionPointerType*)&cnx
                        ->hooks[egl_connection_t::GLESv2_INDEX]
@@ -367,6 +373,12 @@ void* Loader::open(egl_connection_t* cnx) {
 
 void Loader::close(egl_connection_t* cnx)
 {
+    {
+        std::lock_guard<std::mutex> lock(gles1_lock);
+        gles1_dso = nullptr;
+        gles1_pending = false;
+    }
+
     driver_t* hnd = (driver_t*) cnx->dso;
     delete hnd;
     cnx->dso = nullptr;
@@ -374,6 +386,19 @@ void Loader::close(egl_connection_t* cnx)
     cnx->angleLoaded = false;
 }
 
+void Loader::init_gles1_api(egl_connection_t* cnx) {
+    std::lock_guard<std::mutex> lock(gles1_lock);
+    if (!gles1_pending) {
+        return;
+    }
+
+    init_api(gles1_dso, gl_names_1, gl_names,
+        (__eglMustCastToProperFunctionPointerType*)
+            &cnx->hooks[egl_connection_t::GLESv1_INDEX]->gl,
+        getProcAddress);
+    gles1_pending = false;
+}
+
 void Loader::init_api(void* dso,
         char const * const * api,
         char const * const * ref_api,
@@ -726,10 +751,10 @@ void Loader::initialize_api(void* dso, egl_connection_t* cnx, uint32_t mask) {
     }
 
     if (mask & GLESv1_CM) {
-        init_api(dso, gl_names_1, gl_names,
-            (__eglMustCastToProperFunctionPointerType*)
-                &cnx->hooks[egl_connection_t::GLESv1_INDEX]->gl,
-            getProcAddress);
+        // The entry points are resolved by init_gles1_api()
+        std::lock_guard<std::mutex> lock(gles1_lock);
+        gles1_dso = dso;
+        gles1_pending = true;
     }
 
     if (mask & GLESv2) {
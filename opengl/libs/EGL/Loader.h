@@ -20,6 +20,8 @@
 #include <EGL/egl.h>
 #include <stdint.h>
 
+#include <mutex>
+
 namespace android {
 
 struct egl_connection_t;
@@ -43,6 +45,12 @@ class Loader {
 
     getProcAddressType getProcAddress;
 
+    // Few apps create a GLESv1_CM context, so the GLESv1_CM entry points are
+    // only resolved for the first one, from the library of gles1_dso.
+    std::mutex gles1_lock;
+    void* gles1_dso;
+    bool gles1_pending;
+
 public:
     static Loader& getInstance();
     ~Loader();
@@ -50,6 +58,10 @@ public:
     void* open(egl_connection_t* cnx);
     void close(egl_connection_t* cnx);
 
+    // Resolves the GLESv1_CM entry points of the driver, if they aren't yet.
+    // This must be called before making a GLESv1_CM context current.
+    void init_gles1_api(egl_connection_t* cnx);
+
 private:
     Loader();
     driver_t* attempt_to_load_angle(egl_connection_t* cnx);
@@ -58,6 +58,19 @@ void freeHotCacheEntry(android::MultifileHotCache& entry) {
     }
 }
 
+// The index entry of an entry file, with no hits yet
+android::MultifileIndexEntry toIndexEntry(uint32_t entryHash, EGLsizeiANDROID valueSize,
+                                          const struct stat& st) {
+    android::MultifileIndexEntry indexEntry;
+    memset(&indexEntry, 0, sizeof(indexEntry));
+    indexEntry.entryHash = entryHash;
+    indexEntry.valueSize = valueSize;
+    indexEntry.fileSize = static_cast<uint64_t>(st.st_size);
+    indexEntry.modifiedSec = st.st_mtim.tv_sec;
+    indexEntry.modifiedNsec = st.st_mtim.tv_nsec;
+    return indexEntry;
+}
+
 } // namespace
 
 namespace android {
@@ -74,6 +87,7 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
         mTotalCacheEntries(0),
         mHotCacheLimit(0),
         mHotCacheSize(0),
+        mIndexDirty(false),
         mWorkerThreadIdle(true) {
     if (baseDir.empty()) {
         ALOGV("INIT: no baseDir provided in MultifileBlobCache constructor, returning early.");
@@ -134,13 +148,20 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
     }
 
     if (statusGood) {
+        // The index of the last session lets the entries whose files haven't changed since be
+        // tracked without reading them
+        std::unordered_map<uint32_t, MultifileIndexEntry> index = readIndex();
+        std::vector<MultifileIndexEntry> trackedEntries;
+
         // Read all the files and gather details, then preload their contents
         DIR* dir;
         struct dirent* entry;
         if ((dir = opendir(mMultifileDirName.c_str())) != nullptr) {
             while ((entry = readdir(dir)) != nullptr) {
                 if (entry->d_name == "."s || entry->d_name == ".."s ||
-                    strcmp(entry->d_name, kMultifileBlobCacheStatusFile) == 0) {
+                    strcmp(entry->d_name, kMultifileBlobCacheStatusFile) == 0 ||
+                    strcmp(entry->d_name, kMultifileBlobCacheIndexFile) == 0 ||
+                    strcmp(entry->d_name, kMultifileBlobCacheIndexTempFile) == 0) {
                     continue;
                 }
 
@@ -169,6 +190,29 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
                     continue;
                 }
 
+                // Note: Converting from off_t (signed) to size_t (unsigned)
+                size_t fileSize = static_cast<size_t>(st.st_size);
+
+                // If the index has the same file, track it as is, and check it on first use
+                auto indexIter = index.find(entryHash);
+                if (indexIter != index.end() && fileSize > sizeof(MultifileHeader) &&
+                    indexIter->second.fileSize == fileSize &&
+                    indexIter->second.modifiedSec == st.st_mtim.tv_sec &&
+                    indexIter->second.modifiedNsec == st.st_mtim.tv_nsec &&
+                    indexIter->second.valueSize > 0) {
+                    ALOGV("INIT: Entry %u matches the index, tracking it now.", entryHash);
+                    MultifileIndexEntry indexEntry = indexIter->second;
+                    trackEntry(entryHash, indexEntry.valueSize, fileSize, st.st_atime);
+                    increaseTotalCacheSize(fileSize);
+                    mUncheckedEntries.insert(entryHash);
+                    {
+                        std::lock_guard<std::mutex> lock(mIndexMutex);
+                        mIndex[entryHash] = indexEntry;
+                    }
+                    trackedEntries.push_back(indexEntry);
+                    continue;
+                }
+
                 // Open the file so we can read its header
                 int fd = open(fullPath.c_str(), O_RDONLY);
                 if (fd == -1) {
@@ -198,9 +242,6 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
                     continue;
                 }
 
-                // Note: Converting from off_t (signed) to size_t (unsigned)
-                size_t fileSize = static_cast<size_t>(st.st_size);
-
                 // Memory map the file
                 uint8_t* mappedEntry = reinterpret_cast<uint8_t*>(
                         mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0));
@@ -214,9 +255,14 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
                 }
 
                 // Ensure we have a good CRC
-                if (header.crc !=
-                    crc32c(mappedEntry + sizeof(MultifileHeader),
-                           fileSize - sizeof(MultifileHeader))) {
+                bool crcGood = header.crc ==
+                        crc32c(mappedEntry + sizeof(MultifileHeader),
+                               fileSize - sizeof(MultifileHeader));
+
+                // The entry is mapped again if it goes into the hot cache
+                munmap(mappedEntry, fileSize);
+
+                if (!crcGood) {
                     ALOGV("INIT: Entry %u failed CRC check! Removing.", entryHash);
                     if (remove(fullPath.c_str()) != 0) {
                         ALOGE("Error removing %s: %s", fullPath.c_str(), std::strerror(errno));
@@ -244,27 +290,31 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
                 // Track the total size
                 increaseTotalCacheSize(fileSize);
 
-                // Preload the entry for fast retrieval
-                if ((mHotCacheSize + fileSize) < mHotCacheLimit) {
-                    ALOGV("INIT: Populating hot cache with fd = %i, cacheEntry = %p for "
-                          "entryHash %u",
-                          fd, mappedEntry, entryHash);
-
-                    // Track the details of the preload so they can be retrieved later
-                    if (!addToHotCache(entryHash, fd, mappedEntry, fileSize)) {
-                        ALOGE("INIT Failed to add %u to hot cache", entryHash);
-                        munmap(mappedEntry, fileSize);
-                        return;
-                    }
-                } else {
-                    // If we're not keeping it in hot cache, unmap it now
-                    munmap(mappedEntry, fileSize);
+                // Keep the hit count of the entry if the index had an older version of it
+                MultifileIndexEntry indexEntry = toIndexEntry(entryHash, header.valueSize, st);
+                if (indexIter != index.end()) {
+                    indexEntry.hitCount = indexIter->second.hitCount;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mIndexMutex);
+                    mIndex[entryHash] = indexEntry;
+                    mIndexDirty = true;
                 }
+                trackedEntries.push_back(indexEntry);
             }
             closedir(dir);
+
+            // Write the index again if it had entries which are gone
+            if (trackedEntries.size() != index.size()) {
+                std::lock_guard<std::mutex> lock(mIndexMutex);
+                mIndexDirty = true;
+            }
         } else {
             ALOGE("Unable to open filename: %s", mMultifileDirName.c_str());
         }
+
+        // Preload the entries most used last session for fast retrieval
+        warmHotCache(std::move(trackedEntries));
     } else {
         // If the multifile directory does not exist, create it and start from scratch
         if (mkdir(mMultifileDirName.c_str(), 0755) != 0 && (errno != EEXIST)) {
@@ -299,6 +349,8 @@ MultifileBlobCache::~MultifileBlobCache() {
     if (mTaskThread.joinable()) {
         mTaskThread.join();
     }
+
+    writeIndex();
 }
 
 // Set will add the entry to hot cache and start a deferred process to write it to disk
@@ -344,6 +396,13 @@ void MultifileBlobCache::set(const void* key, EGLsizeiANDROID keySize, const voi
 
     // Track the size and access time for quick recall
     trackEntry(entryHash, valueSize, fileSize, time(0));
+    mUncheckedEntries.erase(entryHash);
+
+    // Count the hits from now on, the worker thread adds the file to the index once written
+    {
+        std::lock_guard<std::mutex> lock(mIndexMutex);
+        mIndex[entryHash].entryHash = entryHash;
+    }
 
     // Update the overall cache size
     increaseTotalCacheSize(fileSize);
@@ -473,6 +532,20 @@ EGLsizeiANDROID MultifileBlobCache::get(const void* key, EGLsizeiANDROID keySize
         cacheEntry = mHotCache[entryHash].entryBuffer;
     }
 
+    // The entries tracked from the index weren't read by the initialization, check them on first use
+    if (mUncheckedEntries.find(entryHash) != mUncheckedEntries.end()) {
+        MultifileHeader* header = reinterpret_cast<MultifileHeader*>(cacheEntry);
+        if (header->magic != kMultifileMagic ||
+            header->crc !=
+                    crc32c(cacheEntry + sizeof(MultifileHeader),
+                           fileSize - sizeof(MultifileHeader))) {
+            ALOGW("GET: Entry %u has bad magic or failed CRC check! Removing.", entryHash);
+            removeEntry(entryHash);
+            return 0;
+        }
+        mUncheckedEntries.erase(entryHash);
+    }
+
     // Ensure the header matches
     MultifileHeader* header = reinterpret_cast<MultifileHeader*>(cacheEntry);
     if (header->keySize != keySize || header->valueSize != valueSize) {
@@ -496,6 +569,16 @@ EGLsizeiANDROID MultifileBlobCache::get(const void* key, EGLsizeiANDROID keySize
     uint8_t* cachedValue = cacheEntry + (keySize + sizeof(MultifileHeader));
     memcpy(value, cachedValue, cachedValueSize);
 
+    // Count the hit, for the next initialization to preload the entries most used
+    {
+        std::lock_guard<std::mutex> lock(mIndexMutex);
+        auto indexIter = mIndex.find(entryHash);
+        if (indexIter != mIndex.end()) {
+            indexIter->second.hitCount++;
+            mIndexDirty = true;
+        }
+    }
+
     return cachedValueSize;
 }
 
@@ -508,6 +591,9 @@ void MultifileBlobCache::finish() {
     ALOGV("FINISH: Waiting for work to complete.");
     waitForWorkComplete();
 
+    // Write out the hits and the entries since the worker thread last wrote the index
+    writeIndex();
+
     // Close all entries in the hot cache
     for (auto hotCacheIter = mHotCache.begin(); hotCacheIter != mHotCache.end();) {
         uint32_t entryHash = hotCacheIter->first;
@@ -626,6 +712,170 @@ bool MultifileBlobCache::checkStatus(const std::string& baseDir) {
     return true;
 }
 
+// Read the index written by the last session, which is empty if missing or damaged
+std::unordered_map<uint32_t, MultifileIndexEntry> MultifileBlobCache::readIndex() {
+    std::unordered_map<uint32_t, MultifileIndexEntry> index;
+    std::string indexPath = mMultifileDirName + "/" + kMultifileBlobCacheIndexFile;
+
+    int fd = open(indexPath.c_str(), O_RDONLY);
+    if (fd == -1) {
+        ALOGV("INDEX(READ): Index file (%s) missing", indexPath.c_str());
+        return index;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(MultifileIndexHeader))) {
+        ALOGE("INDEX(READ): Index file (%s) has invalid stats!", indexPath.c_str());
+        close(fd);
+        return index;
+    }
+
+    size_t fileSize = static_cast<size_t>(st.st_size);
+    uint8_t* mappedIndex =
+            reinterpret_cast<uint8_t*>(mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0));
+    close(fd);
+    if (mappedIndex == MAP_FAILED) {
+        ALOGE("INDEX(READ): Failed to mmap index, error: %s", std::strerror(errno));
+        return index;
+    }
+
+    MultifileIndexHeader header;
+    memcpy(&header, mappedIndex, sizeof(header));
+    size_t entriesSize = fileSize - sizeof(header);
+    if (header.magic != kMultifileMagic ||
+        entriesSize != header.entryCount * sizeof(MultifileIndexEntry) ||
+        header.crc != crc32c(mappedIndex + sizeof(header), entriesSize)) {
+        ALOGE("INDEX(READ): Index file (%s) is damaged, ignoring it", indexPath.c_str());
+        munmap(mappedIndex, fileSize);
+        return index;
+    }
+
+    for (uint32_t i = 0; i < header.entryCount; i++) {
+        MultifileIndexEntry indexEntry;
+        memcpy(&indexEntry, mappedIndex + sizeof(header) + i * sizeof(indexEntry),
+               sizeof(indexEntry));
+        index[indexEntry.entryHash] = indexEntry;
+    }
+    munmap(mappedIndex, fileSize);
+
+    ALOGV("INDEX(READ): Read %u entries from %s", header.entryCount, indexPath.c_str());
+    return index;
+}
+
+// Write the index to a temporary file, then replace the index with it, so that a partial write
+// never replaces a good index
+bool MultifileBlobCache::writeIndex() {
+    std::vector<MultifileIndexEntry> entries;
+    {
+        std::lock_guard<std::mutex> lock(mIndexMutex);
+        if (!mIndexDirty) {
+            return true;
+        }
+        entries.reserve(mIndex.size());
+        for (const auto& [entryHash, indexEntry] : mIndex) {
+            entries.push_back(indexEntry);
+        }
+        mIndexDirty = false;
+        mIndexWriteTime = std::chrono::steady_clock::now();
+    }
+
+    MultifileIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kMultifileMagic;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.crc = crc32c(reinterpret_cast<const uint8_t*>(entries.data()),
+                        entries.size() * sizeof(MultifileIndexEntry));
+
+    std::string tempPath = mMultifileDirName + "/" + kMultifileBlobCacheIndexTempFile;
+    std::string indexPath = mMultifileDirName + "/" + kMultifileBlobCacheIndexFile;
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        ALOGE("INDEX(WRITE): Unable to create index file: %s, error: %s", tempPath.c_str(),
+              std::strerror(errno));
+        return false;
+    }
+
+    size_t entriesSize = entries.size() * sizeof(MultifileIndexEntry);
+    bool written = write(fd, &header, sizeof(header)) == sizeof(header) &&
+            write(fd, entries.data(), entriesSize) == static_cast<ssize_t>(entriesSize);
+    close(fd);
+    if (!written || rename(tempPath.c_str(), indexPath.c_str()) != 0) {
+        ALOGE("INDEX(WRITE): Error writing index file: %s, error %s", indexPath.c_str(),
+              std::strerror(errno));
+        remove(tempPath.c_str());
+        return false;
+    }
+
+    ALOGV("INDEX(WRITE): Wrote %zu entries to %s", entries.size(), indexPath.c_str());
+    return true;
+}
+
+// Track the file of an entry once written, with the hits of the entry so far
+void MultifileBlobCache::updateIndex(uint32_t entryHash, EGLsizeiANDROID valueSize,
+                                     const struct stat& st) {
+    MultifileIndexEntry indexEntry = toIndexEntry(entryHash, valueSize, st);
+    std::lock_guard<std::mutex> lock(mIndexMutex);
+    auto indexIter = mIndex.find(entryHash);
+    if (indexIter != mIndex.end()) {
+        indexEntry.hitCount = indexIter->second.hitCount;
+    }
+    mIndex[entryHash] = indexEntry;
+    mIndexDirty = true;
+}
+
+// Preload the entries with the most hits, then the most recently used ones, into the hot cache,
+// and have the worker thread read their files ahead of their first use
+void MultifileBlobCache::warmHotCache(std::vector<MultifileIndexEntry> entries) {
+    std::sort(entries.begin(), entries.end(),
+              [this](const MultifileIndexEntry& lhs, const MultifileIndexEntry& rhs) {
+                  if (lhs.hitCount != rhs.hitCount) {
+                      return lhs.hitCount > rhs.hitCount;
+                  }
+                  return mEntryStats[lhs.entryHash].accessTime >
+                          mEntryStats[rhs.entryHash].accessTime;
+              });
+
+    for (const MultifileIndexEntry& indexEntry : entries) {
+        uint32_t entryHash = indexEntry.entryHash;
+        size_t fileSize = static_cast<size_t>(indexEntry.fileSize);
+        if ((mHotCacheSize + fileSize) >= mHotCacheLimit) {
+            continue;
+        }
+
+        std::string fullPath = mMultifileDirName + "/" + std::to_string(entryHash);
+        int fd = open(fullPath.c_str(), O_RDONLY);
+        if (fd == -1) {
+            ALOGE("Cache error - failed to open fullPath: %s, error: %s", fullPath.c_str(),
+                  std::strerror(errno));
+            continue;
+        }
+
+        uint8_t* mappedEntry =
+                reinterpret_cast<uint8_t*>(mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0));
+
+        // We can close the file now and the mmap will remain
+        close(fd);
+
+        if (mappedEntry == MAP_FAILED) {
+            ALOGE("Failed to mmap cacheEntry, error: %s", std::strerror(errno));
+            continue;
+        }
+
+        ALOGV("INIT: Populating hot cache with fd = %i, cacheEntry = %p for entryHash %u", fd,
+              mappedEntry, entryHash);
+        if (!addToHotCache(entryHash, fd, mappedEntry, fileSize)) {
+            ALOGE("INIT Failed to add %u to hot cache", entryHash);
+            munmap(mappedEntry, fileSize);
+            continue;
+        }
+
+        // The mapping only faults its pages in on first use, read them ahead in the background
+        DeferredTask task(TaskCommand::Prefetch);
+        task.initPrefetch(fullPath);
+        queueTask(std::move(task));
+    }
+}
+
 void MultifileBlobCache::trackEntry(uint32_t entryHash, EGLsizeiANDROID valueSize, size_t fileSize,
                                     time_t accessTime) {
     mEntries.insert(entryHash);
@@ -636,6 +886,32 @@ bool MultifileBlobCache::contains(uint32_t hashEntry) const {
     return mEntries.find(hashEntry) != mEntries.end();
 }
 
+// Stop tracking an entry and remove its file
+bool MultifileBlobCache::removeEntry(uint32_t entryHash) {
+    auto entryStatsIter = mEntryStats.find(entryHash);
+    if (entryStatsIter == mEntryStats.end()) {
+        return false;
+    }
+
+    removeFromHotCache(entryHash);
+    decreaseTotalCacheSize(entryStatsIter->second.fileSize);
+    mEntryStats.erase(entryStatsIter);
+    mEntries.erase(entryHash);
+    mUncheckedEntries.erase(entryHash);
+    {
+        std::lock_guard<std::mutex> lock(mIndexMutex);
+        mIndex.erase(entryHash);
+        mIndexDirty = true;
+    }
+
+    std::string entryPath = mMultifileDirName + "/" + std::to_string(entryHash);
+    if (remove(entryPath.c_str()) != 0) {
+        ALOGE("Error removing %s: %s", entryPath.c_str(), std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
 MultifileEntryStats MultifileBlobCache::getEntryStats(uint32_t entryHash) {
     return mEntryStats[entryHash];
 }
@@ -741,6 +1017,12 @@ bool MultifileBlobCache::applyLRU(size_t cacheSizeLimit, size_t cacheEntryLimit)
         cacheEntryIter++;
 
         // Delete the entry from our tracking
+        mUncheckedEntries.erase(entryHash);
+        {
+            std::lock_guard<std::mutex> lock(mIndexMutex);
+            mIndex.erase(entryHash);
+            mIndexDirty = true;
+        }
         size_t count = mEntryStats.erase(entryHash);
         if (count != 1) {
             ALOGE("LRU: Failed to remove entryHash (%u) from mEntryStats", entryHash);
@@ -851,6 +1133,12 @@ void MultifileBlobCache::processTask(DeferredTask& task) {
             }
 
             ALOGV("DEFERRED: Completed write for: %s", fullPath.c_str());
+
+            // Track the written file in the index
+            struct stat st;
+            if (fstat(fd, &st) == 0) {
+                updateIndex(entryHash, header->valueSize, st);
+            }
             close(fd);
 
             // Erase the entry from mDeferredWrites
@@ -872,6 +1160,18 @@ void MultifileBlobCache::processTask(DeferredTask& task) {
 
             return;
         }
+        case TaskCommand::Prefetch: {
+            // Read the file ahead into the page cache, which the hot cache maps it from
+            std::string& fullPath = task.getFullPath();
+            int fd = open(fullPath.c_str(), O_RDONLY);
+            if (fd == -1) {
+                ALOGV("DEFERRED: Unable to open %s to prefetch it", fullPath.c_str());
+                return;
+            }
+            posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+            close(fd);
+            return;
+        }
         default: {
             ALOGE("DEFERRED: Unhandled task type");
             return;
@@ -884,6 +1184,12 @@ void MultifileBlobCache::processTask(DeferredTask& task) {
 void MultifileBlobCache::processTasksImpl(bool* exitThread) {
     while (true) {
         std::unique_lock<std::mutex> lock(mWorkerMutex);
+        if (mTasks.empty() && shouldWriteIndex()) {
+            // Write out the index once the writes queued so far are done
+            lock.unlock();
+            writeIndex();
+            continue;
+        }
         if (mTasks.empty()) {
             ALOGV("WORKER: No tasks available, waiting");
             mWorkerThreadIdle = true;
@@ -910,6 +1216,14 @@ void MultifileBlobCache::processTasksImpl(bool* exitThread) {
     }
 }
 
+// The worker thread writes the index at most once per kIndexWriteInterval, finish() writes the rest
+constexpr std::chrono::seconds kIndexWriteInterval = 1s;
+
+bool MultifileBlobCache::shouldWriteIndex() {
+    std::lock_guard<std::mutex> lock(mIndexMutex);
+    return mIndexDirty && std::chrono::steady_clock::now() - mIndexWriteTime >= kIndexWriteInterval;
+}
+
 // Process tasks until the exit task is submitted
 void MultifileBlobCache::processTasks() {
     while (true) {
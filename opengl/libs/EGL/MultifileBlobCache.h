@@ -22,6 +22,8 @@
 
 #include <android-base/thread_annotations.h>
 #include <cutils/properties.h>
+#include <sys/stat.h>
+#include <chrono>
 #include <future>
 #include <map>
 #include <queue>
@@ -29,6 +31,7 @@
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "FileBlobCache.h"
 
@@ -36,6 +39,8 @@ namespace android {
 
 constexpr uint32_t kMultifileBlobCacheVersion = 1;
 constexpr char kMultifileBlobCacheStatusFile[] = "cache.status";
+constexpr char kMultifileBlobCacheIndexFile[] = "cache.index";
+constexpr char kMultifileBlobCacheIndexTempFile[] = "cache.index.tmp";
 
 struct MultifileHeader {
     uint32_t magic;
@@ -57,6 +62,23 @@ struct MultifileStatus {
     char buildId[PROP_VALUE_MAX];
 };
 
+struct MultifileIndexHeader {
+    uint32_t magic;
+    uint32_t crc;
+    uint32_t entryCount;
+};
+
+// The details of an entry in the index, which let the next initialization track the entry without
+// reading its file, as long as the size and modification time of the file match
+struct MultifileIndexEntry {
+    uint32_t entryHash;
+    uint32_t hitCount;
+    EGLsizeiANDROID valueSize;
+    uint64_t fileSize;
+    int64_t modifiedSec;
+    int64_t modifiedNsec;
+};
+
 struct MultifileHotCache {
     int entryFd;
     uint8_t* entryBuffer;
@@ -66,6 +88,7 @@ struct MultifileHotCache {
 enum class TaskCommand {
     Invalid = 0,
     WriteToDisk,
+    Prefetch,
     Exit,
 };
 
@@ -85,6 +108,11 @@ public:
         mBufferSize = bufferSize;
     }
 
+    void initPrefetch(std::string fullPath) {
+        mCommand = TaskCommand::Prefetch;
+        mFullPath = std::move(fullPath);
+    }
+
     uint32_t getEntryHash() { return mEntryHash; }
     std::string& getFullPath() { return mFullPath; }
     uint8_t* getBuffer() { return mBuffer; }
@@ -93,7 +121,7 @@ public:
 private:
     TaskCommand mCommand;
 
-    // Parameters for WriteToDisk
+    // Parameters for WriteToDisk, and the path for Prefetch
     uint32_t mEntryHash;
     std::string mFullPath;
     uint8_t* mBuffer;
@@ -132,6 +160,12 @@ private:
     bool createStatus(const std::string& baseDir);
     bool checkStatus(const std::string& baseDir);
 
+    std::unordered_map<uint32_t, MultifileIndexEntry> readIndex();
+    bool writeIndex();
+    bool shouldWriteIndex();
+    void updateIndex(uint32_t entryHash, EGLsizeiANDROID valueSize, const struct stat& st);
+    void warmHotCache(std::vector<MultifileIndexEntry> entries);
+
     size_t getFileSize(uint32_t entryHash);
     size_t getValueSize(uint32_t entryHash);
 
@@ -155,6 +189,9 @@ private:
     std::unordered_map<uint32_t, MultifileEntryStats> mEntryStats;
     std::unordered_map<uint32_t, MultifileHotCache> mHotCache;
 
+    // The entries tracked from the index, whose files haven't been checked yet
+    std::unordered_set<uint32_t> mUncheckedEntries;
+
     size_t mMaxKeySize;
     size_t mMaxValueSize;
     size_t mMaxTotalSize;
@@ -165,6 +202,13 @@ private:
     size_t mHotCacheEntryLimit;
     size_t mHotCacheSize;
 
+    // The index of the entries, which the main thread updates on hits and removals, and the worker
+    // thread once their files are written. The worker thread writes it out once idle.
+    std::mutex mIndexMutex;
+    std::unordered_map<uint32_t, MultifileIndexEntry> mIndex GUARDED_BY(mIndexMutex);
+    bool mIndexDirty GUARDED_BY(mIndexMutex);
+    std::chrono::steady_clock::time_point mIndexWriteTime GUARDED_BY(mIndexMutex);
+
     // Below are the components used for deferred writes
 
     // Track whether we have pending writes for an entry
@@ -22,6 +22,7 @@
 #include <gtest/gtest.h>
 #include <stdio.h>
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
 
@@ -53,6 +54,7 @@ protected:
 
     int getFileDescriptorCount();
     std::vector<std::string> getCacheEntries();
+    std::vector<MultifileIndexEntry> getIndexEntries();
 
     void clearProperties();
 
@@ -322,7 +324,9 @@ std::vector<std::string> MultifileBlobCacheTest::getCacheEntries() {
                 if (entry->d_name == "."s || entry->d_name == ".."s) {
                     continue;
                 }
-                if (strcmp(entry->d_name, kMultifileBlobCacheStatusFile) == 0) {
+                if (strcmp(entry->d_name, kMultifileBlobCacheStatusFile) == 0 ||
+                    strcmp(entry->d_name, kMultifileBlobCacheIndexFile) == 0 ||
+                    strcmp(entry->d_name, kMultifileBlobCacheIndexTempFile) == 0) {
                     continue;
                 }
                 cacheEntries.push_back(multifileDirName + "/" + entry->d_name);
@@ -503,4 +507,115 @@ TEST_F(MultifileBlobCacheTest, MismatchedBuildIdClears) {
     ASSERT_EQ(getCacheEntries().size(), 0);
 }
 
+std::vector<MultifileIndexEntry> MultifileBlobCacheTest::getIndexEntries() {
+    std::stringstream indexFile;
+    indexFile << &mTempFile->path[0] << ".multifile/" << kMultifileBlobCacheIndexFile;
+    std::ifstream fs(indexFile.str(), std::ios::binary);
+
+    MultifileIndexHeader header;
+    std::vector<MultifileIndexEntry> entries;
+    if (fs.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        entries.resize(header.entryCount);
+        fs.read(reinterpret_cast<char*>(entries.data()),
+                entries.size() * sizeof(MultifileIndexEntry));
+    }
+    return entries;
+}
+
+// Verify the index tracks the entries and their hits across sessions
+TEST_F(MultifileBlobCacheTest, IndexTracksEntriesAndHits) {
+    char buf[4];
+    mMBC->set("abcd", 4, "efgh", 4);
+    mMBC->set("ijkl", 4, "mnop", 4);
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(size_t(4), mMBC->get("abcd", 4, buf, 4));
+    }
+
+    // Close the cache so everything writes out
+    mMBC->finish();
+    mMBC.reset();
+
+    std::vector<MultifileIndexEntry> entries = getIndexEntries();
+    ASSERT_EQ(2, entries.size());
+    std::sort(entries.begin(), entries.end(),
+              [](const MultifileIndexEntry& lhs, const MultifileIndexEntry& rhs) {
+                  return lhs.hitCount > rhs.hitCount;
+              });
+    EXPECT_EQ(3, entries[0].hitCount);
+    EXPECT_EQ(0, entries[1].hitCount);
+    EXPECT_EQ(4, entries[0].valueSize);
+
+    // Open the cache again, the entries are tracked from the index
+    mMBC.reset(new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, kMaxTotalEntries,
+                                      &mTempFile->path[0]));
+    ASSERT_EQ(2, mMBC->getTotalEntries());
+    ASSERT_EQ(size_t(4), mMBC->get("abcd", 4, buf, 4));
+    ASSERT_EQ('e', buf[0]);
+    ASSERT_EQ(size_t(4), mMBC->get("ijkl", 4, buf, 4));
+    ASSERT_EQ('m', buf[0]);
+
+    // The hits add up across sessions
+    mMBC->finish();
+    mMBC.reset();
+    entries = getIndexEntries();
+    ASSERT_EQ(2, entries.size());
+    EXPECT_EQ(5, entries[0].hitCount + entries[1].hitCount);
+}
+
+// Verify an entry which changed behind the index is checked on first use
+TEST_F(MultifileBlobCacheTest, EntryModifiedBehindIndexIsRemoved) {
+    mMBC->set("abcd", 4, "efgh", 4);
+
+    // Close the cache so everything writes out
+    mMBC->finish();
+    mMBC.reset();
+
+    std::vector<std::string> cacheEntries = getCacheEntries();
+    ASSERT_EQ(1, cacheEntries.size());
+
+    // Stomp on the value, keeping the size and modification time of the file
+    struct stat st;
+    ASSERT_EQ(0, stat(cacheEntries[0].c_str(), &st));
+    {
+        std::fstream fs(cacheEntries[0]);
+        fs.seekp(-1, std::ios_base::end);
+        fs.write("X", 1);
+    }
+    struct timespec times[2] = {st.st_atim, st.st_mtim};
+    ASSERT_EQ(0, utimensat(AT_FDCWD, cacheEntries[0].c_str(), times, 0));
+
+    // Open the cache again, the entry is tracked from the index but fails its check
+    mMBC.reset(new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, kMaxTotalEntries,
+                                      &mTempFile->path[0]));
+    ASSERT_EQ(1, mMBC->getTotalEntries());
+    char buf[4];
+    ASSERT_EQ(size_t(0), mMBC->get("abcd", 4, buf, 4));
+    ASSERT_EQ(0, mMBC->getTotalEntries());
+    ASSERT_EQ(0, getCacheEntries().size());
+}
+
+// Verify a damaged index falls back to reading the entries
+TEST_F(MultifileBlobCacheTest, DamagedIndexIsIgnored) {
+    mMBC->set("abcd", 4, "efgh", 4);
+
+    // Close the cache so everything writes out
+    mMBC->finish();
+    mMBC.reset();
+
+    std::stringstream indexFile;
+    indexFile << &mTempFile->path[0] << ".multifile/" << kMultifileBlobCacheIndexFile;
+    {
+        std::fstream fs(indexFile.str());
+        fs.seekp(-1, std::ios_base::end);
+        fs.write("X", 1);
+    }
+
+    mMBC.reset(new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, kMaxTotalEntries,
+                                      &mTempFile->path[0]));
+    char buf[4];
+    ASSERT_EQ(size_t(4), mMBC->get("abcd", 4, buf, 4));
+    ASSERT_EQ('e', buf[0]);
+    ASSERT_EQ('h', buf[3]);
+}
+
 } // namespace android
@@ -121,14 +121,16 @@ void egl_display_t::removeObject(egl_object_t* object) {
 }
 
 bool egl_display_t::getObject(egl_object_t* object) const {
-    std::lock_guard<std::mutex> _l(lock);
-    if (objects.find(object) != objects.end()) {
-        if (object->getDisplay() == this) {
-            object->incRef();
-            return true;
+    // Every EGL and GL call on an object validates it, so this takes no lock. The object is
+    // only dereferenced once it's found, and removeObject() waits for this to take its
+    // reference.
+    return objects.find(object, [&] {
+        if (object->getDisplay() != this) {
+            return false;
         }
-    }
-    return false;
+        object->incRef();
+        return true;
+    });
 }
 
 EGLDisplay egl_display_t::getFromNativeDisplay(EGLNativeDisplayType disp,
@@ -470,12 +472,12 @@ EGLBoolean egl_display_t::terminate() {
         // delete them.
         size_t count = objects.size();
         ALOGW_IF(count, "eglTerminate() called w/ %zu objects remaining", count);
-        for (auto o : objects) {
-            o->destroy();
-        }
 
-        // this marks all object handles are "terminated"
-        objects.clear();
+        // this marks all object handles are "terminated", and waits for the lookups which
+        // may still take a reference to them
+        for (void* o : objects.clear()) {
+            static_cast<egl_object_t*>(o)->destroy();
+        }
     }
 
     { // scope for refLock
@@ -29,9 +29,9 @@
 #endif
 #include <mutex>
 #include <string>
-#include <unordered_set>
 
 #include "../hooks.h"
+#include "egl_object_set.h"
 #include "egldefs.h"
 
 namespace android {
@@ -128,7 +128,8 @@ private:
     mutable std::mutex lock;
     mutable std::mutex refLock;
     mutable std::condition_variable refCond;
-    std::unordered_set<egl_object_t*> objects;
+    // Changed under lock, looked up without it.
+    egl_object_set_t objects;
     std::string mVendorString;
     std::string mVersionString;
     std::string mClientApiString;
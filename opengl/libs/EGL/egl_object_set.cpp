@@ -0,0 +1,167 @@
+/*
+ ** Copyright 2024, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#include "egl_object_set.h"
+
+#include <sched.h>
+
+namespace android {
+
+namespace {
+
+constexpr size_t kMinCapacity = 64;
+
+// Marks the slot of an erased object, so that the lookups of the objects after it in the
+// probe sequence still find them. No handle can be equal to it.
+char sErased;
+void* const kErased = &sErased;
+
+} // namespace
+
+egl_object_set_t::table_t::table_t(size_t capacity)
+      : mask(capacity - 1), slots(new std::atomic<void*>[capacity]) {
+    for (size_t i = 0; i < capacity; i++) {
+        slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+size_t egl_object_set_t::table_t::indexOf(const void* object) const {
+    // Objects are allocated with at least 16 byte alignment, so the low bits carry nothing.
+    const uint64_t hash = (reinterpret_cast<uintptr_t>(object) >> 4) * 0x9e3779b97f4a7c15ull;
+    return static_cast<size_t>(hash >> 32) & mask;
+}
+
+bool egl_object_set_t::table_t::contains(const void* object) const {
+    if (object == nullptr || object == kErased) {
+        return false;
+    }
+    // The table always has empty slots, so the probe ends.
+    for (size_t i = indexOf(object);; i = (i + 1) & mask) {
+        const void* const slot = slots[i].load(std::memory_order_seq_cst);
+        if (slot == object) {
+            return true;
+        }
+        if (slot == nullptr) {
+            return false;
+        }
+    }
+}
+
+egl_object_set_t::egl_object_set_t()
+      : mTable(new table_t(kMinCapacity)), mEpoch(0), mReaders{0, 0}, mSize(0), mErased(0) {}
+
+egl_object_set_t::~egl_object_set_t() {
+    delete mTable.load(std::memory_order_relaxed);
+}
+
+void egl_object_set_t::insert(void* object) {
+    table_t* table = mTable.load(std::memory_order_relaxed);
+    // Keep the table at most half full, counting erased slots, so that probes stay short.
+    if ((mSize + mErased + 1) * 2 > table->mask + 1) {
+        size_t capacity = kMinCapacity;
+        while ((mSize + 1) * 4 > capacity) {
+            capacity *= 2;
+        }
+        rehash(capacity);
+        table = mTable.load(std::memory_order_relaxed);
+    }
+    size_t i = table->indexOf(object);
+    void* slot = table->slots[i].load(std::memory_order_relaxed);
+    while (slot != nullptr && slot != kErased) {
+        i = (i + 1) & table->mask;
+        slot = table->slots[i].load(std::memory_order_relaxed);
+    }
+    if (slot == kErased) {
+        mErased--;
+    }
+    // Release, so that a thread which is handed the new handle finds the object.
+    table->slots[i].store(object, std::memory_order_release);
+    mSize++;
+}
+
+void egl_object_set_t::erase(void* object) {
+    if (object == nullptr) {
+        return;
+    }
+    table_t* const table = mTable.load(std::memory_order_relaxed);
+    for (size_t i = table->indexOf(object);; i = (i + 1) & table->mask) {
+        void* const slot = table->slots[i].load(std::memory_order_relaxed);
+        if (slot == nullptr) {
+            return;
+        }
+        if (slot == object) {
+            table->slots[i].store(kErased, std::memory_order_seq_cst);
+            mSize--;
+            mErased++;
+            break;
+        }
+    }
+    // A lookup which found the object has taken its reference once this returns.
+    waitForReaders();
+}
+
+std::vector<void*> egl_object_set_t::clear() {
+    table_t* const table = mTable.load(std::memory_order_relaxed);
+    std::vector<void*> objects;
+    objects.reserve(mSize);
+    for (size_t i = 0; i <= table->mask; i++) {
+        void* const slot = table->slots[i].load(std::memory_order_relaxed);
+        if (slot != nullptr && slot != kErased) {
+            objects.push_back(slot);
+        }
+    }
+    mTable.store(new table_t(kMinCapacity), std::memory_order_seq_cst);
+    mSize = 0;
+    mErased = 0;
+    waitForReaders();
+    delete table;
+    return objects;
+}
+
+void egl_object_set_t::rehash(size_t capacity) {
+    table_t* const table = mTable.load(std::memory_order_relaxed);
+    table_t* const rehashed = new table_t(capacity);
+    for (size_t i = 0; i <= table->mask; i++) {
+        void* const object = table->slots[i].load(std::memory_order_relaxed);
+        if (object == nullptr || object == kErased) {
+            continue;
+        }
+        size_t j = rehashed->indexOf(object);
+        while (rehashed->slots[j].load(std::memory_order_relaxed) != nullptr) {
+            j = (j + 1) & rehashed->mask;
+        }
+        rehashed->slots[j].store(object, std::memory_order_relaxed);
+    }
+    mTable.store(rehashed, std::memory_order_seq_cst);
+    mErased = 0;
+    // Lookups may still be probing the old table.
+    waitForReaders();
+    delete table;
+}
+
+void egl_object_set_t::waitForReaders() const {
+    // New lookups count themselves in the other reader count once the epoch changes, so each
+    // count drains even while the display is busy. Draining both covers the lookups which
+    // started before the last change of the epoch.
+    for (int i = 0; i < 2; i++) {
+        const uint32_t epoch = mEpoch.fetch_add(1, std::memory_order_seq_cst) & 1;
+        while (mReaders[epoch].load(std::memory_order_seq_cst) != 0) {
+            sched_yield();
+        }
+    }
+}
+
+} // namespace android
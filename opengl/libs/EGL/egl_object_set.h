@@ -0,0 +1,86 @@
+/*
+ ** Copyright 2024, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#ifndef ANDROID_EGL_OBJECT_SET_H
+#define ANDROID_EGL_OBJECT_SET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace android {
+
+// The handles of the live objects of a display. Every EGL and GL entry point which takes a
+// handle looks it up, so lookups take no lock and never dereference the handle, which may be
+// garbage. Changes must be serialized by the caller.
+//
+// Lookups announce themselves in one of two reader counts. Removing a handle waits until the
+// lookups which may have seen it are done, so an object which a lookup found stays allocated
+// until the lookup returns.
+class egl_object_set_t {
+public:
+    egl_object_set_t();
+    ~egl_object_set_t();
+
+    egl_object_set_t(const egl_object_set_t&) = delete;
+    egl_object_set_t& operator=(const egl_object_set_t&) = delete;
+
+    // Calls found() if the set contains the object, and returns what it returned, or false.
+    template <typename F>
+    bool find(const void* object, F&& found) const {
+        const uint32_t epoch = mEpoch.load(std::memory_order_seq_cst) & 1;
+        mReaders[epoch].fetch_add(1, std::memory_order_seq_cst);
+        const table_t* table = mTable.load(std::memory_order_seq_cst);
+        const bool result = table->contains(object) && found();
+        mReaders[epoch].fetch_sub(1, std::memory_order_release);
+        return result;
+    }
+
+    void insert(void* object);
+    void erase(void* object);
+
+    // Empties the set, and returns the objects it contained.
+    std::vector<void*> clear();
+
+    size_t size() const { return mSize; }
+
+private:
+    struct table_t {
+        explicit table_t(size_t capacity);
+
+        bool contains(const void* object) const;
+        size_t indexOf(const void* object) const;
+
+        const size_t mask;
+        std::unique_ptr<std::atomic<void*>[]> slots;
+    };
+
+    void rehash(size_t capacity);
+    void waitForReaders() const;
+
+    std::atomic<table_t*> mTable;
+    mutable std::atomic<uint32_t> mEpoch;
+    mutable std::atomic<uint32_t> mReaders[2];
+    size_t mSize;
+    size_t mErased;
+};
+
+} // namespace android
+
+#endif // ANDROID_EGL_OBJECT_SET_H
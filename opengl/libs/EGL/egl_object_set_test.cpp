@@ -0,0 +1,130 @@
+/*
+ ** Copyright 2024, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#include "egl_object_set.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace android {
+
+namespace {
+
+bool contains(const egl_object_set_t& set, const void* object) {
+    return set.find(object, [] { return true; });
+}
+
+} // namespace
+
+TEST(EGLObjectSetTest, FindsTheObjectsWhichWereInserted) {
+    egl_object_set_t set;
+    int first, second, other;
+    set.insert(&first);
+    set.insert(&second);
+
+    EXPECT_EQ(2u, set.size());
+    EXPECT_TRUE(contains(set, &first));
+    EXPECT_TRUE(contains(set, &second));
+    EXPECT_FALSE(contains(set, &other));
+    EXPECT_FALSE(contains(set, nullptr));
+}
+
+TEST(EGLObjectSetTest, FindReturnsWhatTheCallbackReturned) {
+    egl_object_set_t set;
+    int object;
+    set.insert(&object);
+
+    EXPECT_FALSE(set.find(&object, [] { return false; }));
+}
+
+TEST(EGLObjectSetTest, EraseRemovesOnlyTheObject) {
+    egl_object_set_t set;
+    std::vector<std::unique_ptr<int>> objects;
+    for (int i = 0; i < 1000; i++) {
+        objects.push_back(std::make_unique<int>(i));
+        set.insert(objects.back().get());
+    }
+    for (size_t i = 0; i < objects.size(); i += 2) {
+        set.erase(objects[i].get());
+    }
+
+    EXPECT_EQ(500u, set.size());
+    for (size_t i = 0; i < objects.size(); i++) {
+        EXPECT_EQ(i % 2 != 0, contains(set, objects[i].get())) << i;
+    }
+}
+
+TEST(EGLObjectSetTest, ClearReturnsTheObjects) {
+    egl_object_set_t set;
+    int first, second;
+    set.insert(&first);
+    set.insert(&second);
+    set.erase(&first);
+
+    const std::vector<void*> objects = set.clear();
+    EXPECT_EQ(std::vector<void*>{&second}, objects);
+    EXPECT_EQ(0u, set.size());
+    EXPECT_FALSE(contains(set, &second));
+}
+
+TEST(EGLObjectSetTest, ErasedObjectsAreNotFoundAfterEraseReturns) {
+    constexpr int kReaderCount = 4;
+    constexpr int kObjectCount = 2000;
+
+    egl_object_set_t set;
+    std::vector<std::unique_ptr<std::atomic<bool>>> objects;
+    for (int i = 0; i < kObjectCount; i++) {
+        objects.push_back(std::make_unique<std::atomic<bool>>(true));
+    }
+    set.insert(objects[0].get());
+
+    std::atomic<bool> done = false;
+    std::atomic<int> lookupsOfErasedObjects = 0;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < kReaderCount; i++) {
+        readers.emplace_back([&] {
+            while (!done) {
+                for (const auto& object : objects) {
+                    set.find(object.get(), [&] {
+                        // erase() clears the flag once it returns.
+                        lookupsOfErasedObjects += !object->load() ? 1 : 0;
+                        return true;
+                    });
+                }
+            }
+        });
+    }
+
+    // The erased slots pile up, so inserting rehashes the table under the readers.
+    for (int i = 1; i < kObjectCount; i++) {
+        set.insert(objects[i].get());
+        set.erase(objects[i - 1].get());
+        *objects[i - 1] = false;
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(0, lookupsOfErasedObjects);
+    EXPECT_EQ(1u, set.size());
+}
+
+} // namespace android
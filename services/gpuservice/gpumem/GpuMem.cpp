@@ -23,7 +23,9 @@
 #include <android-base/stringprintf.h>
 #include <libbpf.h>
 #include <bpf/WaitForProgsLoaded.h>
+#include <linux/bpf.h>
 #include <log/log.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 #include <utils/Timers.h>
 #include <utils/Trace.h>
@@ -79,25 +81,65 @@ void GpuMem::initialize() {
 
 void GpuMem::setGpuMemTotalMap(bpf::BpfMapRO<uint64_t, uint64_t>& map) {
     mGpuMemTotalMap = std::move(map);
+
+    std::lock_guard<std::mutex> lock(mSnapshotLock);
+    mSnapshotTime = 0;
+    mBatchLookupSupported = true;
 }
 
-// Dump the snapshots of global and per process memory usage on all gpus
-void GpuMem::dump(const Vector<String16>& /* args */, std::string* result) {
+void GpuMem::setSnapshotInterval(nsecs_t interval) {
+    std::lock_guard<std::mutex> lock(mSnapshotLock);
+    mSnapshotInterval = interval;
+}
+
+void GpuMem::updateSnapshotLocked() {
+    const nsecs_t now = systemTime();
+    if (mSnapshotTime && now - mSnapshotTime < mSnapshotInterval) return;
+
     ATRACE_CALL();
+    mSnapshot.clear();
+    if (mBatchLookupSupported && !readGpuMemTotalsBatched(&mSnapshot)) {
+        mBatchLookupSupported = false;
+        mSnapshot.clear();
+    }
+    if (!mBatchLookupSupported) {
+        readGpuMemTotalsByKey(&mSnapshot);
+    }
+    mSnapshotTime = now;
+}
 
-    if (!mInitialized.load() || !mGpuMemTotalMap.isValid()) {
-        result->append("Failed to initialize GPU memory eBPF\n");
-        return;
+bool GpuMem::readGpuMemTotalsBatched(std::vector<GpuMemTotal>* totals) {
+    uint64_t keys[kLookupBatchSize];
+    uint64_t values[kLookupBatchSize];
+    // The batch token of hash maps is a bucket index, which fits in the size of a key.
+    uint64_t batch = 0;
+    bool first = true;
+    while (true) {
+        union bpf_attr attr = {};
+        attr.batch.in_batch = first ? 0 : reinterpret_cast<uintptr_t>(&batch);
+        attr.batch.out_batch = reinterpret_cast<uintptr_t>(&batch);
+        attr.batch.keys = reinterpret_cast<uintptr_t>(keys);
+        attr.batch.values = reinterpret_cast<uintptr_t>(values);
+        attr.batch.count = kLookupBatchSize;
+        attr.batch.map_fd = mGpuMemTotalMap.getMap().get();
+
+        // ENOENT means that the lookup reached the end of the map, possibly with entries.
+        const int ret = syscall(__NR_bpf, BPF_MAP_LOOKUP_BATCH, &attr, sizeof(attr));
+        if (ret < 0 && errno != ENOENT) return false;
+
+        for (uint32_t i = 0; i < attr.batch.count; i++) {
+            totals->push_back({static_cast<uint32_t>(keys[i] >> 32),
+                               static_cast<uint32_t>(keys[i]), values[i]});
+        }
+        if (ret < 0) return true;
+        first = false;
     }
+}
 
+void GpuMem::readGpuMemTotalsByKey(std::vector<GpuMemTotal>* totals) {
     auto res = mGpuMemTotalMap.getFirstKey();
-    if (!res.ok()) {
-        result->append("GPU memory total usage map is empty\n");
-        return;
-    }
+    if (!res.ok()) return;
     uint64_t key = res.value();
-    // unordered_map<gpu_id, vector<pair<pid, size>>>
-    std::unordered_map<uint32_t, std::vector<std::pair<uint32_t, uint64_t>>> dumpMap;
     while (true) {
         uint32_t gpu_id = key >> 32;
         uint32_t pid = key;
@@ -106,12 +148,36 @@ void GpuMem::dump(const Vector<String16>& /* args */, std::string* result) {
         if (!res.ok()) break;
         uint64_t size = res.value();
 
-        dumpMap[gpu_id].emplace_back(pid, size);
+        totals->push_back({gpu_id, pid, size});
 
         res = mGpuMemTotalMap.getNextKey(key);
         if (!res.ok()) break;
         key = res.value();
     }
+}
+
+// Dump the snapshots of global and per process memory usage on all gpus
+void GpuMem::dump(const Vector<String16>& /* args */, std::string* result) {
+    ATRACE_CALL();
+
+    if (!mInitialized.load() || !mGpuMemTotalMap.isValid()) {
+        result->append("Failed to initialize GPU memory eBPF\n");
+        return;
+    }
+
+    // unordered_map<gpu_id, vector<pair<pid, size>>>
+    std::unordered_map<uint32_t, std::vector<std::pair<uint32_t, uint64_t>>> dumpMap;
+    {
+        std::lock_guard<std::mutex> lock(mSnapshotLock);
+        updateSnapshotLocked();
+        if (mSnapshot.empty()) {
+            result->append("GPU memory total usage map is empty\n");
+            return;
+        }
+        for (const auto& total : mSnapshot) {
+            dumpMap[total.gpuId].emplace_back(total.pid, total.size);
+        }
+    }
 
     for (auto& gpu : dumpMap) {
         if (gpu.second.empty()) continue;
@@ -136,21 +202,17 @@ void GpuMem::dump(const Vector<String16>& /* args */, std::string* result) {
 
 void GpuMem::traverseGpuMemTotals(const std::function<void(int64_t ts, uint32_t gpuId, uint32_t pid,
                                                            uint64_t size)>& callback) {
-    auto res = mGpuMemTotalMap.getFirstKey();
-    if (!res.ok()) return;
-    uint64_t key = res.value();
-    while (true) {
-        uint32_t gpu_id = key >> 32;
-        uint32_t pid = key;
-
-        res = mGpuMemTotalMap.readValue(key);
-        if (!res.ok()) break;
-        uint64_t size = res.value();
+    std::vector<GpuMemTotal> totals;
+    nsecs_t ts;
+    {
+        std::lock_guard<std::mutex> lock(mSnapshotLock);
+        updateSnapshotLocked();
+        totals = mSnapshot;
+        ts = mSnapshotTime;
+    }
 
-        callback(systemTime(), gpu_id, pid, size);
-        res = mGpuMemTotalMap.getNextKey(key);
-        if (!res.ok()) break;
-        key = res.value();
+    for (const auto& total : totals) {
+        callback(ts, total.gpuId, total.pid, total.size);
     }
 }
 
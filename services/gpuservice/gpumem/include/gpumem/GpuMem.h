@@ -16,11 +16,15 @@
 
 #pragma once
 
+#include <android-base/thread_annotations.h>
 #include <bpf/BpfMap.h>
 #include <utils/String16.h>
+#include <utils/Timers.h>
 #include <utils/Vector.h>
 
 #include <functional>
+#include <mutex>
+#include <vector>
 
 namespace android {
 
@@ -39,18 +43,44 @@ public:
     void traverseGpuMemTotals(const std::function<void(int64_t ts, uint32_t gpuId, uint32_t pid,
                                                        uint64_t size)>& callback);
 
+    // Set how long the snapshot of the gpu memory total map is reused by dumps and traversals
+    // before the map is read again, 0 to read it every time.
+    void setSnapshotInterval(nsecs_t interval);
+
 private:
     // Friend class for testing.
     friend class TestableGpuMem;
 
+    struct GpuMemTotal {
+        uint32_t gpuId;
+        uint32_t pid;
+        uint64_t size;
+    };
+
     // set gpu memory total map
     void setGpuMemTotalMap(bpf::BpfMapRO<uint64_t, uint64_t>& map);
+    // read the gpu memory total map again if the snapshot is older than the snapshot interval
+    void updateSnapshotLocked() REQUIRES(mSnapshotLock);
+    // read the gpu memory total map a batch of entries per syscall, returns false if the kernel
+    // doesn't support batched lookups
+    bool readGpuMemTotalsBatched(std::vector<GpuMemTotal>* totals) REQUIRES(mSnapshotLock);
+    // read the gpu memory total map one entry per syscall
+    void readGpuMemTotalsByKey(std::vector<GpuMemTotal>* totals) REQUIRES(mSnapshotLock);
 
     // indicate whether ebpf has been initialized
     std::atomic<bool> mInitialized = false;
     // bpf map for GPU memory total data
     android::bpf::BpfMapRO<uint64_t, uint64_t> mGpuMemTotalMap;
 
+    std::mutex mSnapshotLock;
+    // last read entries of the gpu memory total map
+    std::vector<GpuMemTotal> mSnapshot GUARDED_BY(mSnapshotLock);
+    // time of the last read, 0 if the snapshot is not valid
+    nsecs_t mSnapshotTime GUARDED_BY(mSnapshotLock) = 0;
+    nsecs_t mSnapshotInterval GUARDED_BY(mSnapshotLock) = kDefaultSnapshotInterval;
+    // whether the kernel supports BPF_MAP_LOOKUP_BATCH for the map
+    bool mBatchLookupSupported GUARDED_BY(mSnapshotLock) = true;
+
     // gpu memory tracepoint event category
     static constexpr char kGpuMemTraceGroup[] = "gpu_mem";
     // gpu memory total tracepoint
@@ -62,6 +92,10 @@ private:
     static constexpr char kGpuMemTotalMapPath[] = "/sys/fs/bpf/map_gpuMem_gpu_mem_total_map";
     // 30 seconds timeout for trying to attach bpf program to tracepoint
     static constexpr int kGpuWaitTimeout = 30;
+    // 1 second reuse of the snapshot of the gpu memory total map
+    static constexpr nsecs_t kDefaultSnapshotInterval = 1000000000;
+    // number of entries read per batched lookup
+    static constexpr uint32_t kLookupBatchSize = 64;
 };
 
 } // namespace android
@@ -24,15 +24,18 @@
 #include <binder/PermissionCache.h>
 #include <bpf/WaitForProgsLoaded.h>
 #include <libbpf.h>
+#include <linux/bpf.h>
 #include <log/log.h>
 #include <random>
 #include <stats_event.h>
 #include <statslog.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 #include <utils/Timers.h>
 #include <utils/Trace.h>
 
 #include <bit>
+#include <cerrno>
 #include <chrono>
 #include <cstdint>
 #include <limits>
@@ -76,6 +79,73 @@ bool getBpfMap(const char* mapPath, bpf::BpfMap<Key, Value>* out) {
     return true;
 }
 
+// The number of entries read or deleted per syscall by batched map operations.
+constexpr uint32_t kMapBatchSize = 64;
+
+// Reads the entries of |map| to feed |callback|, a batch of entries per
+// syscall. Returns false, possibly after feeding some entries, if the kernel
+// doesn't support batched lookups.
+template <class Key, class Value>
+bool lookupBatched(const bpf::BpfMap<Key, Value>& map,
+                   const std::function<void(const Key&, const Value&)>& callback) {
+    Key keys[kMapBatchSize];
+    Value values[kMapBatchSize];
+    // The batch token of hash maps is a bucket index.
+    uint64_t batch = 0;
+    bool first = true;
+    while (true) {
+        union bpf_attr attr = {};
+        attr.batch.in_batch = first ? 0 : reinterpret_cast<uintptr_t>(&batch);
+        attr.batch.out_batch = reinterpret_cast<uintptr_t>(&batch);
+        attr.batch.keys = reinterpret_cast<uintptr_t>(keys);
+        attr.batch.values = reinterpret_cast<uintptr_t>(values);
+        attr.batch.count = kMapBatchSize;
+        attr.batch.map_fd = map.getMap().get();
+
+        // ENOENT means that the lookup reached the end of the map, possibly with entries.
+        const int ret = syscall(__NR_bpf, BPF_MAP_LOOKUP_BATCH, &attr, sizeof(attr));
+        if (ret < 0 && errno != ENOENT) {
+            return false;
+        }
+        for (uint32_t i = 0; i < attr.batch.count; ++i) {
+            callback(keys[i], values[i]);
+        }
+        if (ret < 0) {
+            return true;
+        }
+        first = false;
+    }
+}
+
+// Deletes |keys| from |map|, a batch of keys per syscall. Keys which are no
+// longer in the map are skipped. Returns the number of deleted keys, or -1 if
+// the kernel doesn't support batched deletions.
+template <class Key, class Value>
+ssize_t deleteBatched(const bpf::BpfMap<Key, Value>& map, const std::vector<Key>& keys) {
+    ssize_t numDeleted = 0;
+    size_t i = 0;
+    while (i < keys.size()) {
+        union bpf_attr attr = {};
+        attr.batch.keys = reinterpret_cast<uintptr_t>(keys.data() + i);
+        attr.batch.count = static_cast<uint32_t>(std::min<size_t>(keys.size() - i, kMapBatchSize));
+        attr.batch.map_fd = map.getMap().get();
+
+        // The deletion stops at the first key which fails, and |count| is set
+        // to the number of keys deleted before it.
+        const int ret = syscall(__NR_bpf, BPF_MAP_DELETE_BATCH, &attr, sizeof(attr));
+        numDeleted += attr.batch.count;
+        i += attr.batch.count;
+        if (ret < 0) {
+            if (errno != ENOENT) {
+                return numDeleted ? numDeleted : -1;
+            }
+            // Skip the key which was deleted by someone else.
+            ++i;
+        }
+    }
+    return numDeleted;
+}
+
 template <typename SourceType>
 inline int32_t cast_int32(SourceType) = delete;
 
@@ -191,13 +261,9 @@ void GpuWork::dump(const Vector<String16>& /* args */, std::string* result) {
         // thus the returned value is not being concurrently accessed by the BPF
         // program (no atomic reads needed below).
 
-        mGpuWorkMap.iterateWithValue(
-                [&dumpMap](const GpuIdUid& key, const UidTrackingInfo& value,
-                           const android::bpf::BpfMap<GpuIdUid, UidTrackingInfo>&)
-                        -> base::Result<void> {
-                    dumpMap[key] = value;
-                    return {};
-                });
+        readMap([&dumpMap](const GpuIdUid& key, const UidTrackingInfo& value) {
+            dumpMap[key] = value;
+        });
     }
 
     // Dump work information.
@@ -291,11 +357,8 @@ AStatsManager_PullAtomCallbackReturn GpuWork::pullWorkAtoms(AStatsEventList* dat
     // the returned value is not being concurrently accessed by the BPF program
     // (no atomic reads needed below).
 
-    mGpuWorkMap.iterateWithValue([&workMap](const GpuIdUid& key, const UidTrackingInfo& value,
-                                            const android::bpf::BpfMap<GpuIdUid, UidTrackingInfo>&)
-                                         -> base::Result<void> {
+    readMap([&workMap](const GpuIdUid& key, const UidTrackingInfo& value) {
         workMap[key] = value;
-        return {};
     });
 
     // Get a list of just the UIDs; the order does not matter.
@@ -387,7 +450,7 @@ AStatsManager_PullAtomCallbackReturn GpuWork::pullWorkAtoms(AStatsEventList* dat
     if (duration > std::numeric_limits<int32_t>::max() || duration < 0) {
         // This is essentially impossible. If it does somehow happen, give up,
         // but still clear the map.
-        clearMap();
+        clearReadEntries(workMap);
         return AStatsManager_PULL_SKIP;
     }
 
@@ -424,7 +487,7 @@ AStatsManager_PullAtomCallbackReturn GpuWork::pullWorkAtoms(AStatsEventList* dat
                                           static_cast<int32_t>(total_inactive_duration_ms));
         }
     }
-    clearMap();
+    clearReadEntries(workMap);
     return AStatsManager_PULL_SUCCESS;
 }
 
@@ -480,6 +543,57 @@ void GpuWork::clearMapIfNeeded() {
     clearMap();
 }
 
+void GpuWork::readMap(const std::function<void(const GpuIdUid&, const UidTrackingInfo&)>& callback) {
+    ATRACE_CALL();
+
+    if (mBatchedMapOpsSupported && lookupBatched(mGpuWorkMap, callback)) {
+        return;
+    }
+    // The entries fed before the batched lookup failed are fed again below, which the callers'
+    // de-duplication handles.
+    mBatchedMapOpsSupported = false;
+    mGpuWorkMap.iterateWithValue([&callback](const GpuIdUid& key, const UidTrackingInfo& value,
+                                             const android::bpf::BpfMap<GpuIdUid, UidTrackingInfo>&)
+                                         -> base::Result<void> {
+        callback(key, value);
+        return {};
+    });
+}
+
+template <class WorkMap>
+void GpuWork::clearReadEntries(const WorkMap& workMap) {
+    if (!mBatchedMapOpsSupported || !mInitialized.load() || !mGpuWorkMap.isValid() ||
+        !mGpuWorkGlobalDataMap.isValid()) {
+        clearMap();
+        return;
+    }
+
+    std::vector<GpuIdUid> keys;
+    keys.reserve(workMap.size());
+    for (const auto& entry : workMap) {
+        keys.push_back(entry.first);
+    }
+    const ssize_t numDeleted = deleteBatched(mGpuWorkMap, keys);
+    if (numDeleted < 0) {
+        mBatchedMapOpsSupported = false;
+        clearMap();
+        return;
+    }
+
+    // The entries added since the map was read are kept, so the counter is
+    // only reduced by the number of deleted entries.
+    base::Result<GlobalData> globalData = mGpuWorkGlobalDataMap.readValue(0);
+    if (globalData.ok()) {
+        uint64_t& numEntries = globalData.value().num_map_entries;
+        numEntries -= std::min<uint64_t>(numEntries, static_cast<uint64_t>(numDeleted));
+        mGpuWorkGlobalDataMap.writeValue(0, globalData.value(), BPF_ANY);
+    } else {
+        ALOGW("Could not read BPF global data map entry");
+    }
+
+    mPreviousMapClearTimePoint = std::chrono::steady_clock::now();
+}
+
 void GpuWork::clearMap() {
     if (!mInitialized.load() || !mGpuWorkMap.isValid() || !mGpuWorkGlobalDataMap.isValid()) {
         ALOGW("Map clearing could not occur because we are not initialized properly");
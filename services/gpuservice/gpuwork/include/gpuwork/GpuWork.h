@@ -72,6 +72,16 @@ private:
     // Clears the |mGpuWorkMap| map.
     void clearMap() REQUIRES(mMutex);
 
+    // Reads the entries of the |mGpuWorkMap| map to feed |callback|. An entry
+    // may be fed more than once.
+    void readMap(const std::function<void(const GpuIdUid&, const UidTrackingInfo&)>& callback)
+            REQUIRES(mMutex);
+
+    // Deletes the entries of |workMap|, which were read from the |mGpuWorkMap|
+    // map, from it, keeping the entries which were added since.
+    template <class WorkMap>
+    void clearReadEntries(const WorkMap& workMap) REQUIRES(mMutex);
+
     // Waits for required permissions to become set. This seems to be needed
     // because platform service permissions might not be set when a service
     // first starts. See b/214085769.
@@ -109,6 +119,10 @@ private:
     // Whether our |pullAtomCallback| function is registered.
     bool mStatsdRegistered GUARDED_BY(mMutex) = false;
 
+    // Whether the kernel supports batched lookups and deletions on the
+    // |mGpuWorkMap| map.
+    bool mBatchedMapOpsSupported GUARDED_BY(mMutex) = true;
+
     // The number of randomly chosen (i.e. sampled) UIDs to log stats for.
     static constexpr size_t kNumSampledUids = 10;
 
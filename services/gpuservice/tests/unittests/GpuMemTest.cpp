@@ -24,9 +24,12 @@
 #include <gpumem/GpuMem.h>
 #include <gtest/gtest.h>
 #include <inttypes.h>
+#include <utils/Timers.h>
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
+#include <limits>
+
 #include "TestableGpuMem.h"
 
 namespace android {
@@ -34,6 +37,7 @@ namespace {
 
 using base::StringPrintf;
 using testing::HasSubstr;
+using testing::Not;
 
 constexpr uint32_t TEST_MAP_SIZE = 10;
 constexpr uint64_t TEST_GLOBAL_KEY = 0;
@@ -166,5 +170,25 @@ TEST_F(GpuMemTest, traverseGpuMemTotals) {
     EXPECT_EQ(sCount, TEST_KEY_COUNT);
 }
 
+TEST_F(GpuMemTest, snapshotIsReusedWithinInterval) {
+    ASSERT_RESULT_OK(mTestMap.writeValue(TEST_PROC_KEY_1, TEST_PROC_VAL_1, BPF_ANY));
+    mTestableGpuMem.setGpuMemTotalMap(mTestMap);
+    mGpuMem->setSnapshotInterval(std::numeric_limits<nsecs_t>::max());
+
+    const std::string procTotal1 =
+            StringPrintf("Proc %u total: %" PRIu64 "\n", (uint32_t)TEST_PROC_KEY_1, TEST_PROC_VAL_1);
+    const std::string procTotal2 =
+            StringPrintf("Proc %u total: %" PRIu64 "\n", (uint32_t)TEST_PROC_KEY_2, TEST_PROC_VAL_2);
+    EXPECT_THAT(dumpsys(), HasSubstr(procTotal1));
+
+    // The map isn't read again until the snapshot expires.
+    ASSERT_RESULT_OK(mTestMap.writeValue(TEST_PROC_KEY_2, TEST_PROC_VAL_2, BPF_ANY));
+    EXPECT_THAT(dumpsys(), Not(HasSubstr(procTotal2)));
+
+    mGpuMem->setSnapshotInterval(0);
+    EXPECT_THAT(dumpsys(), HasSubstr(procTotal1));
+    EXPECT_THAT(dumpsys(), HasSubstr(procTotal2));
+}
+
 } // namespace
 } // namespace android
@@ -22,6 +22,8 @@
 #include <android-base/stringprintf.h>
 #include <input/PrintTools.h>
 
+#include <algorithm>
+
 namespace android {
 
 using android::base::StringPrintf;
@@ -147,7 +149,9 @@ void InputDeviceMetricsCollector::notifyKey(const NotifyKeyArgs& args) {
         std::scoped_lock lock(mLock);
         reportCompletedSessions();
         const SourceProvider getSources = [&args](const MetricsDeviceInfo& info) {
-            return std::set{getUsageSourceForKeyArgs(info.keyboardType, args)};
+            UsageSources sources;
+            sources.set(ftl::to_underlying(getUsageSourceForKeyArgs(info.keyboardType, args)));
+            return sources;
         };
         onInputDeviceUsage(DeviceId{args.deviceId}, nanoseconds(args.eventTime), getSources);
     }
@@ -155,14 +159,26 @@ void InputDeviceMetricsCollector::notifyKey(const NotifyKeyArgs& args) {
 }
 
 void InputDeviceMetricsCollector::notifyMotion(const NotifyMotionArgs& args) {
-    {
-        std::scoped_lock lock(mLock);
-        reportCompletedSessions();
-        onInputDeviceUsage(DeviceId{args.deviceId}, nanoseconds(args.eventTime),
-                           [&args](const auto&) { return getUsageSourcesForMotionArgs(args); });
-    }
+    onMotion(args);
+    mNextListener.notifyMotion(args);
+}
 
-    mNextListener.notify(args);
+void InputDeviceMetricsCollector::notifyMotion(NotifyMotionArgs&& args) {
+    onMotion(args);
+    mNextListener.notifyMotion(std::move(args));
+}
+
+void InputDeviceMetricsCollector::onMotion(const NotifyMotionArgs& args) {
+    std::scoped_lock lock(mLock);
+    reportCompletedSessions();
+    onInputDeviceUsage(DeviceId{args.deviceId}, nanoseconds(args.eventTime), [&args](const auto&) {
+        LOG_ALWAYS_FATAL_IF(args.getPointerCount() < 1, "Received motion args without pointers");
+        UsageSources sources;
+        for (size_t i = 0; i < args.getPointerCount(); i++) {
+            sources.set(ftl::to_underlying(getUsageSourceForMotionPointer(args, i)));
+        }
+        return sources;
+    });
 }
 
 void InputDeviceMetricsCollector::notifySwitch(const NotifySwitchArgs& args) {
@@ -283,9 +299,8 @@ void InputDeviceMetricsCollector::onInputDeviceUsage(DeviceId deviceId, nanoseco
 
     auto [sessionIt, _] =
             mActiveUsageSessions.try_emplace(deviceId, mUsageSessionTimeout, eventTime);
-    for (InputDeviceUsageSource source : getSources(infoIt->second)) {
-        sessionIt->second.recordUsage(eventTime, source);
-    }
+    sessionIt->second.recordUsage(eventTime, getSources(infoIt->second));
+    mNextSessionExpiryTime = std::min(mNextSessionExpiryTime, eventTime + mUsageSessionTimeout);
 }
 
 void InputDeviceMetricsCollector::onInputDeviceInteraction(const Interaction& interaction) {
@@ -295,6 +310,8 @@ void InputDeviceMetricsCollector::onInputDeviceInteraction(const Interaction& in
     }
 
     activeSessionIt->second.recordInteraction(interaction);
+    mNextSessionExpiryTime = std::min(mNextSessionExpiryTime,
+                                      std::get<nanoseconds>(interaction) + mUsageSessionTimeout);
 }
 
 void InputDeviceMetricsCollector::reportCompletedSessions() {
@@ -304,26 +321,27 @@ void InputDeviceMetricsCollector::reportCompletedSessions() {
         onInputDeviceInteraction(*interaction);
     }
 
+    // Nothing expires before mNextSessionExpiryTime, which is the common case for an event.
     const auto currentTime = mLogger.getCurrentTime();
-    std::vector<DeviceId> completedUsageSessions;
-
-    // Process usages for all active session to determine if any sessions have expired.
-    for (auto& [deviceId, activeSession] : mActiveUsageSessions) {
-        if (activeSession.checkIfCompletedAt(currentTime)) {
-            completedUsageSessions.emplace_back(deviceId);
-        }
+    if (currentTime < mNextSessionExpiryTime) {
+        return;
     }
 
-    // Close out and log all expired usage sessions.
-    for (DeviceId deviceId : completedUsageSessions) {
+    // Process usages for all active session to determine if any sessions have expired, and close
+    // out and log the expired usage sessions.
+    mNextSessionExpiryTime = nanoseconds::max();
+    for (auto it = mActiveUsageSessions.begin(); it != mActiveUsageSessions.end();) {
+        auto& [deviceId, activeSession] = *it;
+        if (!activeSession.checkIfCompletedAt(currentTime)) {
+            mNextSessionExpiryTime =
+                    std::min(mNextSessionExpiryTime, activeSession.getNextExpiryTime());
+            ++it;
+            continue;
+        }
         const auto infoIt = mLoggedDeviceInfos.find(deviceId);
         LOG_ALWAYS_FATAL_IF(infoIt == mLoggedDeviceInfos.end());
-
-        auto activeSessionIt = mActiveUsageSessions.find(deviceId);
-        LOG_ALWAYS_FATAL_IF(activeSessionIt == mActiveUsageSessions.end());
-        auto& [_, activeSession] = *activeSessionIt;
         mLogger.logInputDeviceUsageReported(infoIt->second, activeSession.finishSession());
-        mActiveUsageSessions.erase(activeSessionIt);
+        it = mActiveUsageSessions.erase(it);
     }
 }
 
@@ -334,13 +352,19 @@ InputDeviceMetricsCollector::ActiveSession::ActiveSession(nanoseconds usageSessi
       : mUsageSessionTimeout(usageSessionTimeout), mDeviceSession({startTime, startTime}) {}
 
 void InputDeviceMetricsCollector::ActiveSession::recordUsage(nanoseconds eventTime,
-                                                             InputDeviceUsageSource source) {
+                                                             const UsageSources& sources) {
     // We assume that event times for subsequent events are always monotonically increasing for each
     // input device.
-    auto [activeSourceIt, inserted] =
-            mActiveSessionsBySource.try_emplace(source, eventTime, eventTime);
-    if (!inserted) {
-        activeSourceIt->second.end = eventTime;
+    for (size_t i = 0; i < USAGE_SOURCE_COUNT; i++) {
+        if (!sources.test(i)) {
+            continue;
+        }
+        auto& sourceSession = mActiveSessionsBySource[i];
+        if (sourceSession) {
+            sourceSession->end = eventTime;
+        } else {
+            sourceSession = UsageSession{eventTime, eventTime};
+        }
     }
     mDeviceSession.end = eventTime;
 }
@@ -364,44 +388,61 @@ void InputDeviceMetricsCollector::ActiveSession::recordInteraction(const Interac
 
 bool InputDeviceMetricsCollector::ActiveSession::checkIfCompletedAt(nanoseconds timestamp) {
     const auto sessionExpiryTime = timestamp - mUsageSessionTimeout;
-    std::vector<InputDeviceUsageSource> completedSourceSessionsForDevice;
-    for (auto& [source, session] : mActiveSessionsBySource) {
-        if (session.end <= sessionExpiryTime) {
-            completedSourceSessionsForDevice.emplace_back(source);
+    bool hasActiveSourceSession = false;
+    for (size_t i = 0; i < USAGE_SOURCE_COUNT; i++) {
+        auto& session = mActiveSessionsBySource[i];
+        if (!session) {
+            continue;
+        }
+        if (session->end <= sessionExpiryTime) {
+            mSourceUsageBreakdown.emplace_back(static_cast<InputDeviceUsageSource>(i),
+                                               session->end - session->start);
+            session.reset();
+        } else {
+            hasActiveSourceSession = true;
         }
-    }
-    for (InputDeviceUsageSource source : completedSourceSessionsForDevice) {
-        auto it = mActiveSessionsBySource.find(source);
-        const auto& [_, session] = *it;
-        mSourceUsageBreakdown.emplace_back(source, session.end - session.start);
-        mActiveSessionsBySource.erase(it);
     }
 
-    std::vector<Uid> completedUidSessionsForDevice;
-    for (auto& [uid, session] : mActiveSessionsByUid) {
+    for (auto it = mActiveSessionsByUid.begin(); it != mActiveSessionsByUid.end();) {
+        const auto& [uid, session] = *it;
         if (session.end <= sessionExpiryTime) {
-            completedUidSessionsForDevice.emplace_back(uid);
+            mUidUsageBreakdown.emplace_back(uid, session.end - session.start);
+            it = mActiveSessionsByUid.erase(it);
+        } else {
+            ++it;
         }
     }
-    for (Uid uid : completedUidSessionsForDevice) {
-        auto it = mActiveSessionsByUid.find(uid);
-        const auto& [_, session] = *it;
-        mUidUsageBreakdown.emplace_back(uid, session.end - session.start);
-        mActiveSessionsByUid.erase(it);
-    }
 
     // This active session has expired if there are no more active source sessions tracked.
-    return mActiveSessionsBySource.empty();
+    return !hasActiveSourceSession;
+}
+
+nanoseconds InputDeviceMetricsCollector::ActiveSession::getNextExpiryTime() const {
+    nanoseconds lastUsageTime = nanoseconds::max();
+    for (const auto& session : mActiveSessionsBySource) {
+        if (session) {
+            lastUsageTime = std::min(lastUsageTime, session->end);
+        }
+    }
+    for (const auto& [_, session] : mActiveSessionsByUid) {
+        lastUsageTime = std::min(lastUsageTime, session.end);
+    }
+    return lastUsageTime == nanoseconds::max() ? lastUsageTime
+                                               : lastUsageTime + mUsageSessionTimeout;
 }
 
 InputDeviceMetricsLogger::DeviceUsageReport
 InputDeviceMetricsCollector::ActiveSession::finishSession() {
     const auto deviceUsageDuration = mDeviceSession.end - mDeviceSession.start;
 
-    for (const auto& [source, sourceSession] : mActiveSessionsBySource) {
-        mSourceUsageBreakdown.emplace_back(source, sourceSession.end - sourceSession.start);
+    for (size_t i = 0; i < USAGE_SOURCE_COUNT; i++) {
+        auto& sourceSession = mActiveSessionsBySource[i];
+        if (sourceSession) {
+            mSourceUsageBreakdown.emplace_back(static_cast<InputDeviceUsageSource>(i),
+                                               sourceSession->end - sourceSession->start);
+            sourceSession.reset();
+        }
     }
-    mActiveSessionsBySource.clear();
 
     for (const auto& [uid, uidSession] : mActiveSessionsByUid) {
         mUidUsageBreakdown.emplace_back(uid, uidSession.end - uidSession.start);
@@ -25,10 +25,13 @@
 #include <ftl/mixins.h>
 #include <gui/WindowInfo.h>
 #include <input/InputDevice.h>
+#include <array>
+#include <bitset>
 #include <chrono>
 #include <functional>
 #include <map>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <vector>
 
@@ -110,6 +113,7 @@ public:
     void notifyConfigurationChanged(const NotifyConfigurationChangedArgs& args) override;
     void notifyKey(const NotifyKeyArgs& args) override;
     void notifyMotion(const NotifyMotionArgs& args) override;
+    void notifyMotion(NotifyMotionArgs&& args) override;
     void notifySwitch(const NotifySwitchArgs& args) override;
     void notifySensor(const NotifySensorArgs& args) override;
     void notifyVibratorState(const NotifyVibratorStateArgs& args) override;
@@ -140,6 +144,12 @@ private:
     using Uid = gui::Uid;
     using MetricsDeviceInfo = InputDeviceMetricsLogger::MetricsDeviceInfo;
 
+    static_assert(ftl::to_underlying(InputDeviceUsageSource::ftl_first) == 0);
+    static constexpr size_t USAGE_SOURCE_COUNT =
+            ftl::to_underlying(InputDeviceUsageSource::ftl_last) + 1;
+    // The usage sources of an event, indexed by their value.
+    using UsageSources = std::bitset<USAGE_SOURCE_COUNT>;
+
     std::map<DeviceId, MetricsDeviceInfo> mLoggedDeviceInfos GUARDED_BY(mLock);
 
     using Interaction = std::tuple<DeviceId, std::chrono::nanoseconds, std::set<Uid>>;
@@ -149,9 +159,11 @@ private:
     public:
         explicit ActiveSession(std::chrono::nanoseconds usageSessionTimeout,
                                std::chrono::nanoseconds startTime);
-        void recordUsage(std::chrono::nanoseconds eventTime, InputDeviceUsageSource source);
+        void recordUsage(std::chrono::nanoseconds eventTime, const UsageSources& sources);
         void recordInteraction(const Interaction&);
         bool checkIfCompletedAt(std::chrono::nanoseconds timestamp);
+        // The earliest time at which one of the source or uid sessions expires.
+        std::chrono::nanoseconds getNextExpiryTime() const;
         InputDeviceMetricsLogger::DeviceUsageReport finishSession();
 
     private:
@@ -163,7 +175,8 @@ private:
         const std::chrono::nanoseconds mUsageSessionTimeout;
         UsageSession mDeviceSession{};
 
-        std::map<InputDeviceUsageSource, UsageSession> mActiveSessionsBySource{};
+        // Indexed by the value of the usage source, so that recording a usage does not allocate.
+        std::array<std::optional<UsageSession>, USAGE_SOURCE_COUNT> mActiveSessionsBySource{};
         InputDeviceMetricsLogger::SourceUsageBreakdown mSourceUsageBreakdown{};
 
         std::map<Uid, UsageSession> mActiveSessionsByUid{};
@@ -173,13 +186,18 @@ private:
     // The input devices that currently have active usage sessions.
     std::map<DeviceId, ActiveSession> mActiveUsageSessions GUARDED_BY(mLock);
 
+    // No usage session expires before this time, so the sessions are only checked once it is
+    // reached, rather than for every event.
+    std::chrono::nanoseconds mNextSessionExpiryTime GUARDED_BY(mLock) =
+            std::chrono::nanoseconds::max();
+
     void onInputDevicesChanged(const std::vector<InputDeviceInfo>& infos) REQUIRES(mLock);
     void onInputDeviceRemoved(DeviceId deviceId, const MetricsDeviceInfo& info) REQUIRES(mLock);
-    using SourceProvider =
-            std::function<std::set<InputDeviceUsageSource>(const MetricsDeviceInfo&)>;
+    using SourceProvider = std::function<UsageSources(const MetricsDeviceInfo&)>;
     void onInputDeviceUsage(DeviceId deviceId, std::chrono::nanoseconds eventTime,
                             const SourceProvider& getSources) REQUIRES(mLock);
     void onInputDeviceInteraction(const Interaction&) REQUIRES(mLock);
+    void onMotion(const NotifyMotionArgs& args) EXCLUDES(mLock);
     void reportCompletedSessions() REQUIRES(mLock);
 };
 
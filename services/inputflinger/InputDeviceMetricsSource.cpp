@@ -50,68 +50,58 @@ InputDeviceUsageSource getUsageSourceForKeyArgs(int32_t keyboardType,
     return InputDeviceUsageSource::BUTTONS;
 }
 
-std::set<InputDeviceUsageSource> getUsageSourcesForMotionArgs(const NotifyMotionArgs& motionArgs) {
-    LOG_ALWAYS_FATAL_IF(motionArgs.getPointerCount() < 1, "Received motion args without pointers");
-    std::set<InputDeviceUsageSource> sources;
-
-    for (uint32_t i = 0; i < motionArgs.getPointerCount(); i++) {
-        const auto toolType = motionArgs.pointerProperties[i].toolType;
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_MOUSE)) {
-            if (toolType == ToolType::MOUSE) {
-                sources.emplace(InputDeviceUsageSource::MOUSE);
-                continue;
-            }
-            if (toolType == ToolType::FINGER) {
-                sources.emplace(InputDeviceUsageSource::TOUCHPAD);
-                continue;
-            }
-            if (isStylusToolType(toolType)) {
-                sources.emplace(InputDeviceUsageSource::STYLUS_INDIRECT);
-                continue;
-            }
-        }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_MOUSE_RELATIVE) &&
-            toolType == ToolType::MOUSE) {
-            sources.emplace(InputDeviceUsageSource::MOUSE_CAPTURED);
-            continue;
-        }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_TOUCHPAD) &&
-            toolType == ToolType::FINGER) {
-            sources.emplace(InputDeviceUsageSource::TOUCHPAD_CAPTURED);
-            continue;
+InputDeviceUsageSource getUsageSourceForMotionPointer(const NotifyMotionArgs& motionArgs,
+                                                      size_t pointerIndex) {
+    const auto toolType = motionArgs.pointerProperties[pointerIndex].toolType;
+    if (isFromSource(motionArgs.source, AINPUT_SOURCE_MOUSE)) {
+        if (toolType == ToolType::MOUSE) {
+            return InputDeviceUsageSource::MOUSE;
         }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_BLUETOOTH_STYLUS) &&
-            isStylusToolType(toolType)) {
-            sources.emplace(InputDeviceUsageSource::STYLUS_FUSED);
-            continue;
+        if (toolType == ToolType::FINGER) {
+            return InputDeviceUsageSource::TOUCHPAD;
         }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_STYLUS) && isStylusToolType(toolType)) {
-            sources.emplace(InputDeviceUsageSource::STYLUS_DIRECT);
-            continue;
+        if (isStylusToolType(toolType)) {
+            return InputDeviceUsageSource::STYLUS_INDIRECT;
         }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_TOUCH_NAVIGATION)) {
-            sources.emplace(InputDeviceUsageSource::TOUCH_NAVIGATION);
-            continue;
-        }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_JOYSTICK)) {
-            sources.emplace(InputDeviceUsageSource::JOYSTICK);
-            continue;
-        }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_ROTARY_ENCODER)) {
-            sources.emplace(InputDeviceUsageSource::ROTARY_ENCODER);
-            continue;
-        }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_TRACKBALL)) {
-            sources.emplace(InputDeviceUsageSource::TRACKBALL);
-            continue;
-        }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_TOUCHSCREEN)) {
-            sources.emplace(InputDeviceUsageSource::TOUCHSCREEN);
-            continue;
-        }
-        sources.emplace(InputDeviceUsageSource::UNKNOWN);
     }
+    if (isFromSource(motionArgs.source, AINPUT_SOURCE_MOUSE_RELATIVE) &&
+        toolType == ToolType::MOUSE) {
+        return InputDeviceUsageSource::MOUSE_CAPTURED;
+    }
+    if (isFromSource(motionArgs.source, AINPUT_SOURCE_TOUCHPAD) && toolType == ToolType::FINGER) {
+        return InputDeviceUsageSource::TOUCHPAD_CAPTURED;
+    }
+    if (isFromSource(motionArgs.source, AINPUT_SOURCE_BLUETOOTH_STYLUS) &&
+        isStylusToolType(toolType)) {
+        return InputDeviceUsageSource::STYLUS_FUSED;
+    }
+    if (isFromSource(motionArgs.source, AINPUT_SOURCE_STYLUS) && isStylusToolType(toolType)) {
+        return InputDeviceUsageSource::STYLUS_DIRECT;
+    }
+    if (isFromSource(motionArgs.source, AINPUT_SOURCE_TOUCH_NAVIGATION)) {
+        return InputDeviceUsageSource::TOUCH_NAVIGATION;
+    }
+    if (isFromSource(motionArgs.source, AINPUT_SOURCE_JOYSTICK)) {
+        return InputDeviceUsageSource::JOYSTICK;
+    }
+    if (isFromSource(motionArgs.source, AINPUT_SOURCE_ROTARY_ENCODER)) {
+        return InputDeviceUsageSource::ROTARY_ENCODER;
+    }
+    if (isFromSource(motionArgs.source, AINPUT_SOURCE_TRACKBALL)) {
+        return InputDeviceUsageSource::TRACKBALL;
+    }
+    if (isFromSource(motionArgs.source, AINPUT_SOURCE_TOUCHSCREEN)) {
+        return InputDeviceUsageSource::TOUCHSCREEN;
+    }
+    return InputDeviceUsageSource::UNKNOWN;
+}
 
+std::set<InputDeviceUsageSource> getUsageSourcesForMotionArgs(const NotifyMotionArgs& motionArgs) {
+    LOG_ALWAYS_FATAL_IF(motionArgs.getPointerCount() < 1, "Received motion args without pointers");
+    std::set<InputDeviceUsageSource> sources;
+    for (uint32_t i = 0; i < motionArgs.getPointerCount(); i++) {
+        sources.emplace(getUsageSourceForMotionPointer(motionArgs, i));
+    }
     return sources;
 }
 
@@ -54,6 +54,9 @@ enum class InputDeviceUsageSource : int32_t {
 /** Returns the InputDeviceUsageSource that corresponds to the key event. */
 InputDeviceUsageSource getUsageSourceForKeyArgs(int32_t keyboardType, const NotifyKeyArgs&);
 
+/** Returns the InputDeviceUsageSource that corresponds to a pointer of the motion event. */
+InputDeviceUsageSource getUsageSourceForMotionPointer(const NotifyMotionArgs&, size_t pointerIndex);
+
 /** Returns the InputDeviceUsageSources that correspond to the motion event. */
 std::set<InputDeviceUsageSource> getUsageSourcesForMotionArgs(const NotifyMotionArgs&);
 
@@ -80,7 +80,11 @@ void InputFilter::notifyKey(const NotifyKeyArgs& args) {
 }
 
 void InputFilter::notifyMotion(const NotifyMotionArgs& args) {
-    mNextListener.notify(args);
+    mNextListener.notifyMotion(args);
+}
+
+void InputFilter::notifyMotion(NotifyMotionArgs&& args) {
+    mNextListener.notifyMotion(std::move(args));
 }
 
 void InputFilter::notifySwitch(const NotifySwitchArgs& args) {
@@ -59,6 +59,14 @@ void InputListenerInterface::notify(const NotifyArgs& generalArgs) {
     std::visit(v, generalArgs);
 }
 
+void InputListenerInterface::notify(NotifyArgs&& generalArgs) {
+    if (auto* motionArgs = std::get_if<NotifyMotionArgs>(&generalArgs); motionArgs != nullptr) {
+        notifyMotion(std::move(*motionArgs));
+        return;
+    }
+    notify(std::as_const(generalArgs));
+}
+
 // --- QueuedInputListener ---
 
 QueuedInputListener::QueuedInputListener(InputListenerInterface& innerListener)
@@ -80,6 +88,10 @@ void QueuedInputListener::notifyMotion(const NotifyMotionArgs& args) {
     mArgsQueue.emplace_back(args);
 }
 
+void QueuedInputListener::notifyMotion(NotifyMotionArgs&& args) {
+    mArgsQueue.emplace_back(std::move(args));
+}
+
 void QueuedInputListener::notifySwitch(const NotifySwitchArgs& args) {
     mArgsQueue.emplace_back(args);
 }
@@ -101,8 +113,8 @@ void QueuedInputListener::notifyPointerCaptureChanged(const NotifyPointerCapture
 }
 
 void QueuedInputListener::flush() {
-    for (const NotifyArgs& args : mArgsQueue) {
-        mInnerListener.notify(args);
+    for (NotifyArgs& args : mArgsQueue) {
+        mInnerListener.notify(std::move(args));
     }
     mArgsQueue.clear();
 }
@@ -116,63 +128,70 @@ void TracedInputListener::notifyInputDevicesChanged(const NotifyInputDevicesChan
     constexpr static auto& fnName = __func__;
     ATRACE_NAME_IF(ATRACE_ENABLED(),
                    StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    mInnerListener.notifyInputDevicesChanged(args);
 }
 
 void TracedInputListener::notifyConfigurationChanged(const NotifyConfigurationChangedArgs& args) {
     constexpr static auto& fnName = __func__;
     ATRACE_NAME_IF(ATRACE_ENABLED(),
                    StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    mInnerListener.notifyConfigurationChanged(args);
 }
 
 void TracedInputListener::notifyKey(const NotifyKeyArgs& args) {
     constexpr static auto& fnName = __func__;
     ATRACE_NAME_IF(ATRACE_ENABLED(),
                    StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    mInnerListener.notifyKey(args);
 }
 
 void TracedInputListener::notifyMotion(const NotifyMotionArgs& args) {
     constexpr static auto& fnName = __func__;
     ATRACE_NAME_IF(ATRACE_ENABLED(),
                    StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    mInnerListener.notifyMotion(args);
+}
+
+void TracedInputListener::notifyMotion(NotifyMotionArgs&& args) {
+    constexpr static auto& fnName = __func__;
+    ATRACE_NAME_IF(ATRACE_ENABLED(),
+                   StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
+    mInnerListener.notifyMotion(std::move(args));
 }
 
 void TracedInputListener::notifySwitch(const NotifySwitchArgs& args) {
     constexpr static auto& fnName = __func__;
     ATRACE_NAME_IF(ATRACE_ENABLED(),
                    StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    mInnerListener.notifySwitch(args);
 }
 
 void TracedInputListener::notifySensor(const NotifySensorArgs& args) {
     constexpr static auto& fnName = __func__;
     ATRACE_NAME_IF(ATRACE_ENABLED(),
                    StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    mInnerListener.notifySensor(args);
 }
 
 void TracedInputListener::notifyVibratorState(const NotifyVibratorStateArgs& args) {
     constexpr static auto& fnName = __func__;
     ATRACE_NAME_IF(ATRACE_ENABLED(),
                    StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    mInnerListener.notifyVibratorState(args);
 }
 
 void TracedInputListener::notifyDeviceReset(const NotifyDeviceResetArgs& args) {
     constexpr static auto& fnName = __func__;
     ATRACE_NAME_IF(ATRACE_ENABLED(),
                    StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    mInnerListener.notifyDeviceReset(args);
 }
 
 void TracedInputListener::notifyPointerCaptureChanged(const NotifyPointerCaptureChangedArgs& args) {
     constexpr static auto& fnName = __func__;
     ATRACE_NAME_IF(ATRACE_ENABLED(),
                    StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    mInnerListener.notifyPointerCaptureChanged(args);
 }
 
 } // namespace android
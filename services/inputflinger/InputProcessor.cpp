@@ -432,23 +432,25 @@ void InputProcessor::notifyKey(const NotifyKeyArgs& args) {
 }
 
 void InputProcessor::notifyMotion(const NotifyMotionArgs& args) {
+    notifyMotion(NotifyMotionArgs(args));
+}
+
+void InputProcessor::notifyMotion(NotifyMotionArgs&& args) {
     { // acquire lock
         std::scoped_lock lock(mLock);
         // MotionClassifier is only used for touch events, for now
         const bool sendToMotionClassifier = mMotionClassifier && isTouchEvent(args);
-        if (!sendToMotionClassifier) {
-            mQueuedListener.notifyMotion(args);
-        } else {
-            NotifyMotionArgs newArgs(args);
-            const MotionClassification newClassification = mMotionClassifier->classify(newArgs);
+        if (sendToMotionClassifier) {
+            // The classification is set in place, since the event is handed over to this stage.
+            const MotionClassification newClassification = mMotionClassifier->classify(args);
             LOG_ALWAYS_FATAL_IF(args.classification != MotionClassification::NONE &&
                                         newClassification != MotionClassification::NONE,
                                 "Conflicting classifications %s (new) and %s (old)!",
                                 motionClassificationToString(newClassification),
                                 motionClassificationToString(args.classification));
-            newArgs.classification = newClassification;
-            mQueuedListener.notifyMotion(newArgs);
+            args.classification = newClassification;
         }
+        mQueuedListener.notifyMotion(std::move(args));
     } // release lock
     mQueuedListener.flush();
 }
@@ -249,6 +249,7 @@ public:
     void notifyConfigurationChanged(const NotifyConfigurationChangedArgs& args) override;
     void notifyKey(const NotifyKeyArgs& args) override;
     void notifyMotion(const NotifyMotionArgs& args) override;
+    void notifyMotion(NotifyMotionArgs&& args) override;
     void notifySwitch(const NotifySwitchArgs& args) override;
     void notifySensor(const NotifySensorArgs& args) override;
     void notifyVibratorState(const NotifyVibratorStateArgs& args) override;
@@ -119,18 +119,22 @@ void PointerChoreographer::notifyKey(const NotifyKeyArgs& args) {
 }
 
 void PointerChoreographer::notifyMotion(const NotifyMotionArgs& args) {
-    NotifyMotionArgs newArgs = processMotion(args);
+    notifyMotion(NotifyMotionArgs(args));
+}
+
+void PointerChoreographer::notifyMotion(NotifyMotionArgs&& args) {
+    processMotion(args);
 
-    mNextListener.notify(newArgs);
+    mNextListener.notifyMotion(std::move(args));
 }
 
-NotifyMotionArgs PointerChoreographer::processMotion(const NotifyMotionArgs& args) {
+void PointerChoreographer::processMotion(NotifyMotionArgs& args) {
     std::scoped_lock _l(mLock);
 
     if (isFromMouse(args)) {
-        return processMouseEventLocked(args);
+        processMouseEventLocked(args);
     } else if (isFromTouchpad(args)) {
-        return processTouchpadEventLocked(args);
+        processTouchpadEventLocked(args);
     } else if (isFromDrawingTablet(args)) {
         processDrawingTabletEventLocked(args);
     } else if (mStylusPointerIconEnabled && isStylusHoverEvent(args)) {
@@ -138,10 +142,9 @@ NotifyMotionArgs PointerChoreographer::processMotion(const NotifyMotionArgs& arg
     } else if (isFromSource(args.source, AINPUT_SOURCE_TOUCHSCREEN)) {
         processTouchscreenAndStylusEventLocked(args);
     }
-    return args;
 }
 
-NotifyMotionArgs PointerChoreographer::processMouseEventLocked(const NotifyMotionArgs& args) {
+void PointerChoreographer::processMouseEventLocked(NotifyMotionArgs& args) {
     if (args.getPointerCount() != 1) {
         LOG(FATAL) << "Only mouse events with a single pointer are currently supported: "
                    << args.dump();
@@ -157,20 +160,17 @@ NotifyMotionArgs PointerChoreographer::processMouseEventLocked(const NotifyMotio
     }
 
     const auto [x, y] = pc.getPosition();
-    NotifyMotionArgs newArgs(args);
-    newArgs.pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_X, x);
-    newArgs.pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_Y, y);
-    newArgs.xCursorPosition = x;
-    newArgs.yCursorPosition = y;
-    newArgs.displayId = displayId;
-    return newArgs;
+    args.pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_X, x);
+    args.pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_Y, y);
+    args.xCursorPosition = x;
+    args.yCursorPosition = y;
+    args.displayId = displayId;
 }
 
-NotifyMotionArgs PointerChoreographer::processTouchpadEventLocked(const NotifyMotionArgs& args) {
+void PointerChoreographer::processTouchpadEventLocked(NotifyMotionArgs& args) {
     auto [displayId, pc] = ensureMouseControllerLocked(args.displayId);
 
-    NotifyMotionArgs newArgs(args);
-    newArgs.displayId = displayId;
+    args.displayId = displayId;
     if (args.getPointerCount() == 1 && args.classification == MotionClassification::NONE) {
         // This is a movement of the mouse pointer.
         const float deltaX = args.pointerCoords[0].getAxisValue(AMOTION_EVENT_AXIS_RELATIVE_X);
@@ -181,10 +181,10 @@ NotifyMotionArgs PointerChoreographer::processTouchpadEventLocked(const NotifyMo
         }
 
         const auto [x, y] = pc.getPosition();
-        newArgs.pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_X, x);
-        newArgs.pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_Y, y);
-        newArgs.xCursorPosition = x;
-        newArgs.yCursorPosition = y;
+        args.pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_X, x);
+        args.pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_Y, y);
+        args.xCursorPosition = x;
+        args.yCursorPosition = y;
     } else {
         // This is a trackpad gesture with fake finger(s) that should not move the mouse pointer.
         if (canUnfadeOnDisplay(displayId)) {
@@ -192,16 +192,15 @@ NotifyMotionArgs PointerChoreographer::processTouchpadEventLocked(const NotifyMo
         }
 
         const auto [x, y] = pc.getPosition();
-        for (uint32_t i = 0; i < newArgs.getPointerCount(); i++) {
-            newArgs.pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_X,
-                                                  args.pointerCoords[i].getX() + x);
-            newArgs.pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_Y,
-                                                  args.pointerCoords[i].getY() + y);
+        for (uint32_t i = 0; i < args.getPointerCount(); i++) {
+            args.pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_X,
+                                               args.pointerCoords[i].getX() + x);
+            args.pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_Y,
+                                               args.pointerCoords[i].getY() + y);
         }
-        newArgs.xCursorPosition = x;
-        newArgs.yCursorPosition = y;
+        args.xCursorPosition = x;
+        args.yCursorPosition = y;
     }
-    return newArgs;
 }
 
 void PointerChoreographer::processDrawingTabletEventLocked(const android::NotifyMotionArgs& args) {
@@ -100,6 +100,7 @@ public:
     void notifyConfigurationChanged(const NotifyConfigurationChangedArgs& args) override;
     void notifyKey(const NotifyKeyArgs& args) override;
     void notifyMotion(const NotifyMotionArgs& args) override;
+    void notifyMotion(NotifyMotionArgs&& args) override;
     void notifySwitch(const NotifySwitchArgs& args) override;
     void notifySensor(const NotifySensorArgs& args) override;
     void notifyVibratorState(const NotifyVibratorStateArgs& args) override;
@@ -120,9 +121,10 @@ private:
     InputDeviceInfo* findInputDeviceLocked(DeviceId deviceId) REQUIRES(mLock);
     bool canUnfadeOnDisplay(int32_t displayId) REQUIRES(mLock);
 
-    NotifyMotionArgs processMotion(const NotifyMotionArgs& args);
-    NotifyMotionArgs processMouseEventLocked(const NotifyMotionArgs& args) REQUIRES(mLock);
-    NotifyMotionArgs processTouchpadEventLocked(const NotifyMotionArgs& args) REQUIRES(mLock);
+    // Rewrites the event in place, as it is passed on to the next stage.
+    void processMotion(NotifyMotionArgs& args);
+    void processMouseEventLocked(NotifyMotionArgs& args) REQUIRES(mLock);
+    void processTouchpadEventLocked(NotifyMotionArgs& args) REQUIRES(mLock);
     void processDrawingTabletEventLocked(const NotifyMotionArgs& args) REQUIRES(mLock);
     void processTouchscreenAndStylusEventLocked(const NotifyMotionArgs& args) REQUIRES(mLock);
     void processStylusHoverEventLocked(const NotifyMotionArgs& args) REQUIRES(mLock);
@@ -94,6 +94,7 @@ public:
     void notifyConfigurationChanged(const NotifyConfigurationChangedArgs& args) override;
     void notifyKey(const NotifyKeyArgs& args) override;
     void notifyMotion(const NotifyMotionArgs& args) override;
+    void notifyMotion(NotifyMotionArgs&& args) override;
     void notifySwitch(const NotifySwitchArgs& args) override;
     void notifySensor(const NotifySensorArgs& args) override;
     void notifyVibratorState(const NotifyVibratorStateArgs& args) override;
@@ -119,10 +120,10 @@ private:
     // Use a separate palm rejector for every touch device.
     std::map<int32_t /*deviceId*/, PalmRejector> mPalmRejectors GUARDED_BY(mLock);
     // TODO(b/210159205): delete this when simultaneous stylus and touch is supported
-    void notifyMotionLocked(const NotifyMotionArgs& args) REQUIRES(mLock);
+    void notifyMotionLocked(NotifyMotionArgs&& args) REQUIRES(mLock);
 
     // Call this function for outbound events so that they can be logged when logging is enabled.
-    void enqueueOutboundMotionLocked(const NotifyMotionArgs& args) REQUIRES(mLock);
+    void enqueueOutboundMotionLocked(NotifyMotionArgs&& args) REQUIRES(mLock);
 
     void onInputDevicesChanged(const std::vector<InputDeviceInfo>& inputDevices);
 };
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android/os/IInputConstants.h>
+#include <input/InputTransport.h>
+#include <log/log.h>
+
+using android::os::IInputConstants;
+
+namespace android {
+
+namespace {
+
+// A trace of ten fingers moving on a 240 Hz touchscreen, consumed at 60 Hz, so that each frame
+// batches four samples.
+constexpr size_t POINTER_COUNT = 10;
+constexpr nsecs_t SAMPLE_INTERVAL = 1'000'000'000 / 240;
+constexpr nsecs_t FRAME_INTERVAL = 1'000'000'000 / 60;
+constexpr size_t SAMPLES_PER_FRAME = FRAME_INTERVAL / SAMPLE_INTERVAL;
+
+// The resampling of the consumer samples the touches this long before the frame.
+constexpr nsecs_t RESAMPLE_LATENCY = 5'000'000;
+
+class TouchTrace {
+public:
+    explicit TouchTrace(bool resample, size_t pointerCount = POINTER_COUNT,
+                        bool batchSamples = false)
+          : mResample(resample),
+            mPointerCount(pointerCount),
+            mBatchSamples(batchSamples),
+            mDownTime(systemTime(SYSTEM_TIME_MONOTONIC)),
+            mEventTime(mDownTime) {
+        std::unique_ptr<InputChannel> serverChannel, clientChannel;
+        InputChannel::openInputChannelPair("benchmark", serverChannel, clientChannel);
+        mPublisher = std::make_unique<InputPublisher>(std::move(serverChannel));
+        mConsumer = std::make_unique<InputConsumer>(std::move(clientChannel), resample);
+
+        for (size_t i = 0; i < mPointerCount; i++) {
+            mPointerProperties[i].clear();
+            mPointerProperties[i].id = i;
+            mPointerProperties[i].toolType = ToolType::FINGER;
+        }
+        publish(AMOTION_EVENT_ACTION_DOWN);
+        // Also receives the version of the consumer, which the batches need.
+        consumeFrame();
+    }
+
+    // Publishes the samples of a frame, then consumes them as a single event.
+    void publishAndConsumeFrame() {
+        if (mBatchSamples) {
+            publishBatch();
+        } else {
+            for (size_t i = 0; i < SAMPLES_PER_FRAME; i++) {
+                mEventTime += SAMPLE_INTERVAL;
+                publish(AMOTION_EVENT_ACTION_MOVE);
+            }
+        }
+        consumeFrame();
+    }
+
+private:
+    void setCoords(PointerCoords* pointerCoords) const {
+        const float offset = float(mEventTime - mDownTime) / SAMPLE_INTERVAL;
+        for (size_t i = 0; i < mPointerCount; i++) {
+            pointerCoords[i].clear();
+            pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_X, 100 * i + offset);
+            pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_Y, 200 + 2 * offset);
+            pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, 1);
+            pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MAJOR, 10);
+        }
+    }
+
+    // Publishes the moves of a frame as the samples of one event, as the dispatcher does when the
+    // consumer fell behind.
+    void publishBatch() {
+        PointerCoords pointerCoords[SAMPLES_PER_FRAME][POINTER_COUNT];
+        mSamples.clear();
+        for (size_t i = 0; i < SAMPLES_PER_FRAME; i++) {
+            mEventTime += SAMPLE_INTERVAL;
+            setCoords(pointerCoords[i]);
+            mSamples.push_back({.seq = ++mSeq,
+                                .eventId = IInputConstants::INVALID_INPUT_EVENT_ID,
+                                .hmac = INVALID_HMAC,
+                                .eventTime = mEventTime,
+                                .pointerCoords = pointerCoords[i]});
+        }
+
+        ui::Transform identityTransform;
+        size_t publishedCount;
+        const status_t status =
+                mPublisher->publishMotionSamples(/*deviceId=*/1, AINPUT_SOURCE_TOUCHSCREEN,
+                                                 ADISPLAY_ID_DEFAULT, AMOTION_EVENT_ACTION_MOVE,
+                                                 /*actionButton=*/0, /*flags=*/0,
+                                                 /*edgeFlags=*/0, AMETA_NONE, /*buttonState=*/0,
+                                                 MotionClassification::NONE, identityTransform,
+                                                 /*xPrecision=*/0, /*yPrecision=*/0,
+                                                 AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                                                 AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                                                 identityTransform, mDownTime, mPointerCount,
+                                                 mPointerProperties, mSamples, &publishedCount);
+        LOG_ALWAYS_FATAL_IF(status != OK, "Failed to publish motion samples: %d", status);
+    }
+
+    void publish(int32_t action) {
+        PointerCoords pointerCoords[POINTER_COUNT];
+        setCoords(pointerCoords);
+
+        ui::Transform identityTransform;
+        const status_t status =
+                mPublisher->publishMotionEvent(++mSeq, IInputConstants::INVALID_INPUT_EVENT_ID,
+                                               /*deviceId=*/1, AINPUT_SOURCE_TOUCHSCREEN,
+                                               ADISPLAY_ID_DEFAULT, INVALID_HMAC, action,
+                                               /*actionButton=*/0, /*flags=*/0, /*edgeFlags=*/0,
+                                               AMETA_NONE, /*buttonState=*/0,
+                                               MotionClassification::NONE, identityTransform,
+                                               /*xPrecision=*/0, /*yPrecision=*/0,
+                                               AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                                               AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                                               identityTransform, mDownTime, mEventTime,
+                                               mPointerCount, mPointerProperties, pointerCoords);
+        LOG_ALWAYS_FATAL_IF(status != OK, "Failed to publish motion event: %d", status);
+    }
+
+    void consumeFrame() {
+        // With resampling, the frame is late enough for the consumer to predict the touches past
+        // the last sample, as it does between the samples of a 240 Hz touchscreen.
+        const nsecs_t frameTime =
+                mEventTime + (mResample ? RESAMPLE_LATENCY + SAMPLE_INTERVAL / 2 : 0);
+        uint32_t seq;
+        InputEvent* event;
+        const status_t status = mConsumer->consume(&mFactory, /*consumeBatches=*/true, frameTime,
+                                                   &seq, &event);
+        LOG_ALWAYS_FATAL_IF(status != OK, "Failed to consume motion event: %d", status);
+        benchmark::DoNotOptimize(event);
+
+        mConsumer->sendFinishedSignal(seq, /*handled=*/true);
+        while (mPublisher->receiveConsumerResponse().ok()) {
+            // Drains the finished signals of the samples.
+        }
+    }
+
+    const bool mResample;
+    const size_t mPointerCount;
+    const bool mBatchSamples;
+    const nsecs_t mDownTime;
+    nsecs_t mEventTime;
+    uint32_t mSeq = 0;
+
+    std::unique_ptr<InputPublisher> mPublisher;
+    std::unique_ptr<InputConsumer> mConsumer;
+    PreallocatedInputEventFactory mFactory;
+    PointerProperties mPointerProperties[POINTER_COUNT];
+    std::vector<InputPublisher::MotionSample> mSamples;
+};
+
+static void benchmarkConsumeBatch(benchmark::State& state) {
+    TouchTrace trace(/*resample=*/false);
+    for (auto _ : state) {
+        trace.publishAndConsumeFrame();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLES_PER_FRAME);
+}
+
+static void benchmarkConsumeResampledBatch(benchmark::State& state) {
+    TouchTrace trace(/*resample=*/true);
+    for (auto _ : state) {
+        trace.publishAndConsumeFrame();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLES_PER_FRAME);
+}
+
+// One finger, as most scrolls, whose moves are published one message each, or as one batch.
+static void benchmarkPublishSamples(benchmark::State& state) {
+    TouchTrace trace(/*resample=*/false, /*pointerCount=*/1, /*batchSamples=*/false);
+    for (auto _ : state) {
+        trace.publishAndConsumeFrame();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLES_PER_FRAME);
+}
+
+static void benchmarkPublishBatchedSamples(benchmark::State& state) {
+    TouchTrace trace(/*resample=*/false, /*pointerCount=*/1, /*batchSamples=*/true);
+    for (auto _ : state) {
+        trace.publishAndConsumeFrame();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLES_PER_FRAME);
+}
+
+} // namespace
+
+BENCHMARK(benchmarkConsumeBatch);
+BENCHMARK(benchmarkConsumeResampledBatch);
+BENCHMARK(benchmarkPublishSamples);
+BENCHMARK(benchmarkPublishBatchedSamples);
+
+} // namespace android
@@ -16,6 +16,7 @@
 
 #include <benchmark/benchmark.h>
 
+#include <NotifyArgsBuilders.h>
 #include <android/os/IInputConstants.h>
 #include <binder/Binder.h>
 #include <gui/constants.h>
@@ -23,6 +24,9 @@
 #include "../tests/FakeApplicationHandle.h"
 #include "../tests/FakeInputDispatcherPolicy.h"
 #include "../tests/FakeWindowHandle.h"
+#include "AllocationCounter.h"
+
+#include <algorithm>
 
 using android::base::Result;
 using android::gui::WindowInfo;
@@ -196,11 +200,430 @@ static void benchmarkOnWindowInfosChanged(benchmark::State& state) {
     dispatcher.stop();
 }
 
+/**
+ * Reports the throughput of a benchmark, along with the percentiles of the latencies of its events,
+ * from their notification until a window consumed them, and the allocations made per event.
+ */
+class DispatchStats {
+public:
+    // Starts counting the allocations, so it must be created once the benchmark is set up.
+    explicit DispatchStats(benchmark::State& state)
+          : mState(state), mStartAllocationCount(getAllocationCount()) {}
+
+    // Records events which were notified at the given time, and were consumed just now.
+    void recordEvents(nsecs_t notifyTime, size_t eventCount = 1) {
+        mLatencies.push_back(now() - notifyTime);
+        mEventCount += eventCount;
+    }
+
+    void report() {
+        const size_t allocationCount = getAllocationCount() - mStartAllocationCount;
+        mState.SetItemsProcessed(mEventCount);
+        if (mEventCount == 0) {
+            return;
+        }
+        std::sort(mLatencies.begin(), mLatencies.end());
+        const auto percentileMicros = [this](size_t percentile) {
+            return mLatencies[(mLatencies.size() - 1) * percentile / 100] / 1000.0;
+        };
+        mState.counters["p50_us"] = percentileMicros(50);
+        mState.counters["p90_us"] = percentileMicros(90);
+        mState.counters["p99_us"] = percentileMicros(99);
+        mState.counters["allocs_per_event"] = static_cast<double>(allocationCount) / mEventCount;
+    }
+
+private:
+    benchmark::State& mState;
+    const size_t mStartAllocationCount;
+    std::vector<nsecs_t> mLatencies;
+    size_t mEventCount = 0;
+};
+
+// Sets the windows, from front to back, along with the displays they are on.
+static void setWindows(InputDispatcher& dispatcher,
+                       const std::vector<sp<FakeWindowHandle>>& windows) {
+    std::vector<gui::WindowInfo> windowInfos;
+    std::vector<gui::DisplayInfo> displayInfos;
+    for (const sp<FakeWindowHandle>& window : windows) {
+        windowInfos.push_back(*window->getInfo());
+        const int32_t displayId = window->getInfo()->displayId;
+        if (std::none_of(displayInfos.begin(), displayInfos.end(),
+                         [displayId](const gui::DisplayInfo& info) {
+                             return info.displayId == displayId;
+                         })) {
+            gui::DisplayInfo& info = displayInfos.emplace_back();
+            info.displayId = displayId;
+            info.logicalWidth = FakeWindowHandle::WIDTH;
+            info.logicalHeight = FakeWindowHandle::HEIGHT;
+        }
+    }
+    dispatcher.onWindowInfosChanged({windowInfos, displayInfos, /*vsyncId=*/0, /*timestamp=*/0});
+}
+
+static sp<FakeWindowHandle> createWindow(InputDispatcher& dispatcher, const std::string& name,
+                                         int32_t displayId = DISPLAY_ID) {
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    return sp<FakeWindowHandle>::make(application, dispatcher, name, displayId);
+}
+
+static sp<FakeWindowHandle> createSpyWindow(InputDispatcher& dispatcher, const std::string& name) {
+    sp<FakeWindowHandle> spy = createWindow(dispatcher, name);
+    spy->setSpy(true);
+    spy->setTrustedOverlay(true);
+    return spy;
+}
+
+static NotifyMotionArgs generateTouchArgs(int32_t action, float x, float y,
+                                          int32_t displayId = DISPLAY_ID) {
+    return MotionArgsBuilder(action, AINPUT_SOURCE_TOUCHSCREEN)
+            .deviceId(DEVICE_ID)
+            .displayId(displayId)
+            .pointer(PointerBuilder(/*id=*/0, ToolType::FINGER).x(x).y(y))
+            .build();
+}
+
+// Notifies the motion as happening now, and returns the time it was notified at.
+static nsecs_t notifyMotionNow(InputDispatcher& dispatcher, NotifyMotionArgs& args) {
+    args.eventTime = now();
+    dispatcher.notifyMotion(args);
+    return args.eventTime;
+}
+
+// Consumes the events of the window, until the motion event with the given action.
+static void consumeMotionUntil(FakeWindowHandle& window, int32_t action) {
+    while (true) {
+        std::unique_ptr<InputEvent> event = window.consume(100ms);
+        LOG_ALWAYS_FATAL_IF(event == nullptr, "%s: did not receive %s", window.getName().c_str(),
+                            MotionEvent::actionToString(action).c_str());
+        if (event->getType() == InputEventType::MOTION &&
+            static_cast<const MotionEvent&>(*event).getActionMasked() == action) {
+            return;
+        }
+    }
+}
+
+// Notifies the motion, and records it once the window consumed the event with the given action.
+static void notifyAndConsumeMotion(InputDispatcher& dispatcher, NotifyMotionArgs& args,
+                                   FakeWindowHandle& window, int32_t action,
+                                   DispatchStats& stats) {
+    const nsecs_t notifyTime = notifyMotionNow(dispatcher, args);
+    consumeMotionUntil(window, action);
+    stats.recordEvents(notifyTime);
+}
+
+// Taps the window, and records the DOWN and the UP once the window consumed each of them.
+static void tap(InputDispatcher& dispatcher, FakeWindowHandle& window, NotifyMotionArgs& downArgs,
+                NotifyMotionArgs& upArgs, DispatchStats& stats) {
+    downArgs.downTime = now();
+    notifyAndConsumeMotion(dispatcher, downArgs, window, AMOTION_EVENT_ACTION_DOWN, stats);
+    upArgs.downTime = downArgs.downTime;
+    notifyAndConsumeMotion(dispatcher, upArgs, window, AMOTION_EVENT_ACTION_UP, stats);
+}
+
+/**
+ * Taps the window at the bottom of a stack of windows which overlap each other, but not the tap,
+ * as on a desktop.
+ */
+static void benchmarkNotifyMotionWithManyWindows(benchmark::State& state) {
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    std::vector<sp<FakeWindowHandle>> windows;
+    for (int32_t i = 1; i < state.range(0); i++) {
+        sp<FakeWindowHandle> window = createWindow(dispatcher, "Window " + std::to_string(i));
+        window->setFrame(Rect(10 * i + 10, 10 * i + 10, 10 * i + 210, 10 * i + 210));
+        windows.push_back(window);
+    }
+    sp<FakeWindowHandle> bottomWindow = createWindow(dispatcher, "Bottom Window");
+    windows.push_back(bottomWindow);
+    setWindows(dispatcher, windows);
+
+    NotifyMotionArgs downArgs = generateTouchArgs(AMOTION_EVENT_ACTION_DOWN, 10, 10);
+    NotifyMotionArgs upArgs = generateTouchArgs(AMOTION_EVENT_ACTION_UP, 10, 10);
+
+    DispatchStats stats(state);
+    for (auto _ : state) {
+        tap(dispatcher, *bottomWindow, downArgs, upArgs, stats);
+    }
+    stats.report();
+
+    dispatcher.stop();
+}
+
+/**
+ * Taps a window below spy windows, which all receive the touches.
+ */
+static void benchmarkNotifyMotionWithSpyWindows(benchmark::State& state) {
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    std::vector<sp<FakeWindowHandle>> windows;
+    for (int32_t i = 0; i < state.range(0); i++) {
+        windows.push_back(createSpyWindow(dispatcher, "Spy " + std::to_string(i)));
+    }
+    sp<FakeWindowHandle> window = createWindow(dispatcher, "Fake Window");
+    windows.push_back(window);
+    setWindows(dispatcher, windows);
+
+    NotifyMotionArgs downArgs = generateTouchArgs(AMOTION_EVENT_ACTION_DOWN, 100, 100);
+    NotifyMotionArgs upArgs = generateTouchArgs(AMOTION_EVENT_ACTION_UP, 100, 100);
+
+    DispatchStats stats(state);
+    for (auto _ : state) {
+        tap(dispatcher, *window, downArgs, upArgs, stats);
+        for (size_t i = 0; i < windows.size() - 1; i++) {
+            consumeMotionUntil(*windows[i], AMOTION_EVENT_ACTION_UP);
+        }
+    }
+    stats.report();
+
+    dispatcher.stop();
+}
+
+/**
+ * Taps a window on each display in turn.
+ */
+static void benchmarkNotifyMotionOnManyDisplays(benchmark::State& state) {
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    std::vector<sp<FakeWindowHandle>> windows;
+    std::vector<NotifyMotionArgs> downArgs;
+    std::vector<NotifyMotionArgs> upArgs;
+    for (int32_t displayId = 0; displayId < state.range(0); displayId++) {
+        windows.push_back(
+                createWindow(dispatcher, "Window " + std::to_string(displayId), displayId));
+        downArgs.push_back(generateTouchArgs(AMOTION_EVENT_ACTION_DOWN, 100, 100, displayId));
+        upArgs.push_back(generateTouchArgs(AMOTION_EVENT_ACTION_UP, 100, 100, displayId));
+    }
+    setWindows(dispatcher, windows);
+
+    DispatchStats stats(state);
+    for (auto _ : state) {
+        for (size_t i = 0; i < windows.size(); i++) {
+            tap(dispatcher, *windows[i], downArgs[i], upArgs[i], stats);
+        }
+    }
+    stats.report();
+
+    dispatcher.stop();
+}
+
+/**
+ * Touches two windows side by side with one finger each, so that the touches are split between
+ * them.
+ */
+static void benchmarkNotifySplitMotion(benchmark::State& state) {
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    sp<FakeWindowHandle> leftWindow = createWindow(dispatcher, "Left Window");
+    leftWindow->setFrame(Rect(0, 0, FakeWindowHandle::WIDTH / 2, FakeWindowHandle::HEIGHT));
+    sp<FakeWindowHandle> rightWindow = createWindow(dispatcher, "Right Window");
+    rightWindow->setFrame(Rect(FakeWindowHandle::WIDTH / 2, 0, FakeWindowHandle::WIDTH,
+                               FakeWindowHandle::HEIGHT));
+    setWindows(dispatcher, {leftWindow, rightWindow});
+
+    const auto generateSplitArgs = [](int32_t action, float offset) {
+        return MotionArgsBuilder(action, AINPUT_SOURCE_TOUCHSCREEN)
+                .deviceId(DEVICE_ID)
+                .displayId(DISPLAY_ID)
+                .pointer(PointerBuilder(/*id=*/0, ToolType::FINGER).x(100).y(100 + offset))
+                .pointer(PointerBuilder(/*id=*/1, ToolType::FINGER).x(400).y(100 + offset))
+                .build();
+    };
+    NotifyMotionArgs downArgs = generateTouchArgs(AMOTION_EVENT_ACTION_DOWN, 100, 100);
+    NotifyMotionArgs pointerDownArgs = generateSplitArgs(
+            AMOTION_EVENT_ACTION_POINTER_DOWN | (1 << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT),
+            0);
+    NotifyMotionArgs moveArgs = generateSplitArgs(AMOTION_EVENT_ACTION_MOVE, 10);
+    NotifyMotionArgs pointerUpArgs = generateSplitArgs(
+            AMOTION_EVENT_ACTION_POINTER_UP | (1 << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT), 10);
+    NotifyMotionArgs upArgs = generateTouchArgs(AMOTION_EVENT_ACTION_UP, 100, 110);
+
+    DispatchStats stats(state);
+    for (auto _ : state) {
+        const nsecs_t downTime = now();
+        for (NotifyMotionArgs* args : {&downArgs, &pointerDownArgs, &moveArgs, &pointerUpArgs,
+                                       &upArgs}) {
+            args->downTime = downTime;
+        }
+
+        notifyAndConsumeMotion(dispatcher, downArgs, *leftWindow, AMOTION_EVENT_ACTION_DOWN, stats);
+        // The right window receives its part of the touches as a gesture of its own.
+        notifyAndConsumeMotion(dispatcher, pointerDownArgs, *rightWindow, AMOTION_EVENT_ACTION_DOWN,
+                               stats);
+        notifyAndConsumeMotion(dispatcher, moveArgs, *rightWindow, AMOTION_EVENT_ACTION_MOVE,
+                               stats);
+        notifyAndConsumeMotion(dispatcher, pointerUpArgs, *rightWindow, AMOTION_EVENT_ACTION_UP,
+                               stats);
+        notifyAndConsumeMotion(dispatcher, upArgs, *leftWindow, AMOTION_EVENT_ACTION_UP, stats);
+    }
+    stats.report();
+
+    dispatcher.stop();
+}
+
+/**
+ * Moves a mouse across a row of windows, so that each hover move exits a window and enters the
+ * next one.
+ */
+static void benchmarkNotifyHoverAcrossWindows(benchmark::State& state) {
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    const int32_t windowCount = state.range(0);
+    const int32_t windowWidth = FakeWindowHandle::WIDTH / windowCount;
+    std::vector<sp<FakeWindowHandle>> windows;
+    std::vector<NotifyMotionArgs> hoverArgs;
+    for (int32_t i = 0; i < windowCount; i++) {
+        sp<FakeWindowHandle> window = createWindow(dispatcher, "Window " + std::to_string(i));
+        window->setFrame(Rect(i * windowWidth, 0, (i + 1) * windowWidth, FakeWindowHandle::HEIGHT));
+        windows.push_back(window);
+        hoverArgs.push_back(MotionArgsBuilder(AMOTION_EVENT_ACTION_HOVER_MOVE, AINPUT_SOURCE_MOUSE)
+                                    .deviceId(DEVICE_ID)
+                                    .displayId(DISPLAY_ID)
+                                    .pointer(PointerBuilder(/*id=*/0, ToolType::MOUSE)
+                                                     .x(i * windowWidth + windowWidth / 2.f)
+                                                     .y(100))
+                                    .build());
+    }
+    setWindows(dispatcher, windows);
+    NotifyMotionArgs hoverExitArgs = hoverArgs.back();
+    hoverExitArgs.action = AMOTION_EVENT_ACTION_HOVER_EXIT;
+
+    DispatchStats stats(state);
+    for (auto _ : state) {
+        for (int32_t i = 0; i < windowCount; i++) {
+            const nsecs_t notifyTime = notifyMotionNow(dispatcher, hoverArgs[i]);
+            if (i > 0) {
+                consumeMotionUntil(*windows[i - 1], AMOTION_EVENT_ACTION_HOVER_EXIT);
+            }
+            consumeMotionUntil(*windows[i], AMOTION_EVENT_ACTION_HOVER_ENTER);
+            stats.recordEvents(notifyTime);
+        }
+        notifyAndConsumeMotion(dispatcher, hoverExitArgs, *windows.back(),
+                               AMOTION_EVENT_ACTION_HOVER_EXIT, stats);
+    }
+    stats.report();
+
+    dispatcher.stop();
+}
+
+/**
+ * Moves a finger on a 240 Hz touchscreen, while the window consumes the movements at 60 Hz, four
+ * samples at a time. The latency is the one of the batch, from its first sample.
+ */
+static void benchmarkNotifyBatchedMotion(benchmark::State& state) {
+    constexpr size_t SAMPLES_PER_FRAME = 4;
+
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    sp<FakeWindowHandle> window = createWindow(dispatcher, "Fake Window");
+    setWindows(dispatcher, {window});
+
+    NotifyMotionArgs downArgs = generateTouchArgs(AMOTION_EVENT_ACTION_DOWN, 100, 100);
+    downArgs.downTime = now();
+    notifyMotionNow(dispatcher, downArgs);
+    consumeMotionUntil(*window, AMOTION_EVENT_ACTION_DOWN);
+    NotifyMotionArgs moveArgs = generateTouchArgs(AMOTION_EVENT_ACTION_MOVE, 100, 100);
+    moveArgs.downTime = downArgs.downTime;
+
+    DispatchStats stats(state);
+    float y = 100;
+    for (auto _ : state) {
+        nsecs_t frameStartTime = 0;
+        for (size_t i = 0; i < SAMPLES_PER_FRAME; i++) {
+            // Moves down the display and back up to the top, so that the touch stays in the window.
+            y = y < FakeWindowHandle::HEIGHT - 100 ? y + 1 : 100;
+            moveArgs.pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_Y, y);
+            const nsecs_t notifyTime = notifyMotionNow(dispatcher, moveArgs);
+            if (i == 0) {
+                frameStartTime = notifyTime;
+            }
+        }
+        // The samples which the dispatcher has not sent yet are consumed in a batch of their own.
+        size_t sampleCount = 0;
+        while (sampleCount < SAMPLES_PER_FRAME) {
+            std::unique_ptr<InputEvent> event = window->consume(100ms);
+            LOG_ALWAYS_FATAL_IF(event == nullptr, "Did not receive the samples of the frame");
+            sampleCount += static_cast<const MotionEvent&>(*event).getHistorySize() + 1;
+        }
+        stats.recordEvents(frameStartTime, SAMPLES_PER_FRAME);
+    }
+    stats.report();
+
+    NotifyMotionArgs upArgs = generateTouchArgs(AMOTION_EVENT_ACTION_UP, 100, y);
+    upArgs.downTime = downArgs.downTime;
+    notifyMotionNow(dispatcher, upArgs);
+    consumeMotionUntil(*window, AMOTION_EVENT_ACTION_UP);
+
+    dispatcher.stop();
+}
+
+/**
+ * Taps a window below a spy window which consumes its events only after the given number of taps,
+ * so that the events awaiting it pile up in the dispatcher.
+ */
+static void benchmarkNotifyMotionWithSlowConsumer(benchmark::State& state) {
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    sp<FakeWindowHandle> slowSpy = createSpyWindow(dispatcher, "Slow Spy");
+    // The spy must not be considered as not responding while it lags behind.
+    slowSpy->setDispatchingTimeout(5s);
+    sp<FakeWindowHandle> window = createWindow(dispatcher, "Fake Window");
+    setWindows(dispatcher, {slowSpy, window});
+
+    NotifyMotionArgs downArgs = generateTouchArgs(AMOTION_EVENT_ACTION_DOWN, 100, 100);
+    NotifyMotionArgs upArgs = generateTouchArgs(AMOTION_EVENT_ACTION_UP, 100, 100);
+
+    const int64_t tapsPerConsumption = state.range(0);
+    int64_t pendingTaps = 0;
+    DispatchStats stats(state);
+    for (auto _ : state) {
+        tap(dispatcher, *window, downArgs, upArgs, stats);
+        if (++pendingTaps == tapsPerConsumption) {
+            for (; pendingTaps > 0; pendingTaps--) {
+                consumeMotionUntil(*slowSpy, AMOTION_EVENT_ACTION_UP);
+            }
+        }
+    }
+    stats.report();
+
+    for (; pendingTaps > 0; pendingTaps--) {
+        consumeMotionUntil(*slowSpy, AMOTION_EVENT_ACTION_UP);
+    }
+    dispatcher.stop();
+}
+
 } // namespace
 
 BENCHMARK(benchmarkNotifyMotion);
 BENCHMARK(benchmarkInjectMotion);
 BENCHMARK(benchmarkOnWindowInfosChanged);
+BENCHMARK(benchmarkNotifyMotionWithManyWindows)->Arg(1)->Arg(16)->Arg(64);
+BENCHMARK(benchmarkNotifyMotionWithSpyWindows)->Arg(1)->Arg(4)->Arg(16);
+BENCHMARK(benchmarkNotifyMotionOnManyDisplays)->Arg(1)->Arg(4);
+BENCHMARK(benchmarkNotifySplitMotion);
+BENCHMARK(benchmarkNotifyHoverAcrossWindows)->Arg(4)->Arg(16);
+BENCHMARK(benchmarkNotifyBatchedMotion);
+BENCHMARK(benchmarkNotifyMotionWithSlowConsumer)->Arg(1)->Arg(8)->Arg(32);
 
 } // namespace android::inputdispatcher
 
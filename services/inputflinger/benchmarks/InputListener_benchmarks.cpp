@@ -0,0 +1,140 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <InputListener.h>
+#include <NotifyArgsBuilders.h>
+#include <gui/constants.h>
+#include "../InputProcessor.h"
+#include "../UnwantedInteractionBlocker.h"
+#include "AllocationCounter.h"
+
+namespace android {
+
+namespace {
+
+// A touchscreen reporting ten fingers, as the reader notifies them at 240 Hz.
+constexpr size_t POINTER_COUNT = 10;
+constexpr nsecs_t SAMPLE_INTERVAL = 1'000'000'000 / 240;
+
+// Each copy of an event allocates its vectors of pointer properties and of pointer coordinates.
+constexpr size_t ALLOCATIONS_PER_COPY = 2;
+
+/**
+ * The last stage of the pipeline, which takes over the events as the dispatcher queues them.
+ */
+class ConsumingListener : public InputListenerInterface {
+public:
+    void notifyInputDevicesChanged(const NotifyInputDevicesChangedArgs&) override {}
+    void notifyConfigurationChanged(const NotifyConfigurationChangedArgs&) override {}
+    void notifyKey(const NotifyKeyArgs&) override {}
+    void notifyMotion(const NotifyMotionArgs& args) override {
+        mLastArgs = NotifyMotionArgs(args);
+    }
+    void notifyMotion(NotifyMotionArgs&& args) override { mLastArgs = std::move(args); }
+    void notifySwitch(const NotifySwitchArgs&) override {}
+    void notifySensor(const NotifySensorArgs&) override {}
+    void notifyVibratorState(const NotifyVibratorStateArgs&) override {}
+    void notifyDeviceReset(const NotifyDeviceResetArgs&) override {}
+    void notifyPointerCaptureChanged(const NotifyPointerCaptureChangedArgs&) override {}
+
+private:
+    NotifyMotionArgs mLastArgs;
+};
+
+/**
+ * The stages of the pipeline which do not need a policy, traced as in the InputManager.
+ */
+class Pipeline {
+public:
+    Pipeline()
+          : mTracedConsumer("InputDispatcher", mConsumer),
+            mProcessor(mTracedConsumer),
+            mTracedProcessor("InputProcessor", mProcessor),
+            mBlocker(mTracedProcessor, /*enablePalmRejection=*/false),
+            mTracedBlocker("UnwantedInteractionBlocker", mBlocker) {
+        MotionArgsBuilder builder(AMOTION_EVENT_ACTION_DOWN, AINPUT_SOURCE_TOUCHSCREEN);
+        builder.deviceId(1).displayId(ADISPLAY_ID_DEFAULT).downTime(mEventTime);
+        for (size_t i = 0; i < POINTER_COUNT; i++) {
+            builder.pointer(PointerBuilder(i, ToolType::FINGER).x(100 * i).y(200));
+        }
+        mArgs = builder.eventTime(mEventTime).build();
+        mTracedBlocker.notifyMotion(mArgs);
+        mArgs.action = AMOTION_EVENT_ACTION_MOVE;
+    }
+
+    InputListenerInterface& getFirstStage() { return mTracedBlocker; }
+
+    // Returns the next sample of the moving fingers.
+    const NotifyMotionArgs& nextSample() {
+        mEventTime += SAMPLE_INTERVAL;
+        mArgs.eventTime = mEventTime;
+        for (PointerCoords& coords : mArgs.pointerCoords) {
+            coords.setAxisValue(AMOTION_EVENT_AXIS_Y, coords.getY() + 1);
+        }
+        return mArgs;
+    }
+
+private:
+    ConsumingListener mConsumer;
+    TracedInputListener mTracedConsumer;
+    InputProcessor mProcessor;
+    TracedInputListener mTracedProcessor;
+    UnwantedInteractionBlocker mBlocker;
+    TracedInputListener mTracedBlocker;
+
+    nsecs_t mEventTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    NotifyMotionArgs mArgs;
+};
+
+void reportCopies(benchmark::State& state, size_t startAllocationCount, size_t ownCopies) {
+    const size_t allocationCount = getAllocationCount() - startAllocationCount;
+    const double copies = static_cast<double>(allocationCount) / ALLOCATIONS_PER_COPY;
+    state.counters["copies_per_event"] = copies / state.iterations() - ownCopies;
+    state.SetItemsProcessed(state.iterations());
+}
+
+// The reader hands its events over to the pipeline.
+static void benchmarkNotifyMotionMoved(benchmark::State& state) {
+    Pipeline pipeline;
+    InputListenerInterface& firstStage = pipeline.getFirstStage();
+    const size_t startAllocationCount = getAllocationCount();
+    for (auto _ : state) {
+        // The copy stands for the event the reader creates.
+        NotifyMotionArgs args(pipeline.nextSample());
+        firstStage.notifyMotion(std::move(args));
+    }
+    reportCopies(state, startAllocationCount, /*ownCopies=*/1);
+}
+
+// The events are notified by reference, as the callers which keep them do.
+static void benchmarkNotifyMotionByReference(benchmark::State& state) {
+    Pipeline pipeline;
+    InputListenerInterface& firstStage = pipeline.getFirstStage();
+    const size_t startAllocationCount = getAllocationCount();
+    for (auto _ : state) {
+        firstStage.notifyMotion(pipeline.nextSample());
+    }
+    reportCopies(state, startAllocationCount, /*ownCopies=*/0);
+}
+
+} // namespace
+
+BENCHMARK(benchmarkNotifyMotionMoved);
+BENCHMARK(benchmarkNotifyMotionByReference);
+
+} // namespace android
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <list>
+#include <memory>
+#include <vector>
+
+#include <gestures/GestureConverter.h>
+#include <gestures/HardwareStateConverter.h>
+#include <gui/constants.h>
+#include <linux/input-event-codes.h>
+
+#include "../tests/FakeEventHub.h"
+#include "../tests/FakeInputReaderPolicy.h"
+#include "../tests/FakePointerController.h"
+#include "../tests/InstrumentedInputReader.h"
+#include "../tests/TestInputListener.h"
+#include "AllocationCounter.h"
+#include "MultiTouchMotionAccumulator.h"
+
+namespace android {
+
+namespace {
+
+constexpr int32_t DEVICE_ID = END_RESERVED_ID + 1000;
+constexpr int32_t EVENTHUB_ID = 1;
+constexpr size_t SLOT_COUNT = 10;
+
+// A two finger scroll, as a touchpad reports it at 125 Hz.
+constexpr nsecs_t SYNC_INTERVAL = 8'000'000;
+constexpr size_t SESSION_SYNC_COUNT = 250;
+
+/**
+ * A touchpad of the reader, whose device is used by the converters.
+ */
+class Touchpad {
+public:
+    Touchpad()
+          : mFakeEventHub(std::make_shared<FakeEventHub>()),
+            mFakePolicy(sp<FakeInputReaderPolicy>::make()),
+            mReader(mFakeEventHub, mFakePolicy, mFakeListener) {
+        InputDeviceIdentifier identifier;
+        identifier.name = "touchpad";
+        identifier.location = "USB1";
+        mDevice = std::make_shared<InputDevice>(mReader.getContext(), DEVICE_ID,
+                                                /*generation=*/2, identifier);
+        mReader.pushNextDevice(mDevice);
+        mFakeEventHub->addDevice(EVENTHUB_ID, identifier.name, InputDeviceClass::TOUCHPAD,
+                                 identifier.bus);
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_SLOT, 0, SLOT_COUNT - 1, 0, 0, 0);
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_POSITION_X, -500, 500, 0, 0, 20);
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_POSITION_Y, -500, 500, 0, 0, 20);
+        mReader.loopOnce();
+
+        mFakePointerController = std::make_shared<FakePointerController>();
+        mFakePointerController->setBounds(0, 0, 800 - 1, 480 - 1);
+        mFakePointerController->setPosition(400, 240);
+        mFakePolicy->setPointerController(mFakePointerController);
+    }
+
+    InputReaderContext& getReaderContext() { return *mReader.getContext(); }
+    InputDevice& getDevice() { return *mDevice; }
+
+private:
+    std::shared_ptr<FakeEventHub> mFakeEventHub;
+    sp<FakeInputReaderPolicy> mFakePolicy;
+    TestInputListener mFakeListener;
+    InstrumentedInputReader mReader;
+    std::shared_ptr<InputDevice> mDevice;
+    std::shared_ptr<FakePointerController> mFakePointerController;
+};
+
+void addEvent(std::vector<RawEvent>& events, nsecs_t when, int32_t type, int32_t code,
+              int32_t value) {
+    RawEvent& event = events.emplace_back();
+    event.when = when;
+    event.readTime = when;
+    event.deviceId = EVENTHUB_ID;
+    event.type = type;
+    event.code = code;
+    event.value = value;
+}
+
+// Returns the events of the session, whose fingers are put down before the first sync and are
+// then scrolled down by one unit each sync.
+std::vector<RawEvent> makeScrollSession() {
+    std::vector<RawEvent> events;
+    nsecs_t when = 0;
+    for (int32_t slot = 0; slot < 2; slot++) {
+        addEvent(events, when, EV_ABS, ABS_MT_SLOT, slot);
+        addEvent(events, when, EV_ABS, ABS_MT_TRACKING_ID, 100 + slot);
+        addEvent(events, when, EV_ABS, ABS_MT_POSITION_X, -50 + 100 * slot);
+        addEvent(events, when, EV_ABS, ABS_MT_PRESSURE, 40);
+    }
+    addEvent(events, when, EV_KEY, BTN_TOUCH, 1);
+    addEvent(events, when, EV_KEY, BTN_TOOL_DOUBLETAP, 1);
+    for (size_t sync = 0; sync < SESSION_SYNC_COUNT; sync++) {
+        for (int32_t slot = 0; slot < 2; slot++) {
+            addEvent(events, when, EV_ABS, ABS_MT_SLOT, slot);
+            addEvent(events, when, EV_ABS, ABS_MT_POSITION_Y, -200 + sync);
+        }
+        addEvent(events, when, EV_MSC, MSC_TIMESTAMP, when / 1000);
+        addEvent(events, when, EV_SYN, SYN_REPORT, 0);
+        when += SYNC_INTERVAL;
+    }
+    return events;
+}
+
+// The reader converts the evdev frames of the session into the states of the gestures library.
+static void benchmarkHardwareStateConverter(benchmark::State& state) {
+    Touchpad touchpad;
+    InputDeviceContext deviceContext(touchpad.getDevice(), EVENTHUB_ID);
+    MultiTouchMotionAccumulator accumulator;
+    accumulator.configure(deviceContext, SLOT_COUNT, /*usingSlotsProtocol=*/true);
+    HardwareStateConverter converter(deviceContext, accumulator);
+    const std::vector<RawEvent> session = makeScrollSession();
+
+    // Convert the session once, for the converter to reserve its fingers.
+    for (const RawEvent& event : session) {
+        converter.processRawEvent(&event);
+    }
+    const size_t startAllocationCount = getAllocationCount();
+    for (auto _ : state) {
+        for (const RawEvent& event : session) {
+            SelfContainedHardwareState* schs = converter.processRawEvent(&event);
+            benchmark::DoNotOptimize(schs);
+        }
+    }
+    const size_t allocationCount = getAllocationCount() - startAllocationCount;
+    state.counters["allocations_per_sync"] =
+            static_cast<double>(allocationCount) / (state.iterations() * SESSION_SYNC_COUNT);
+    state.SetItemsProcessed(state.iterations() * SESSION_SYNC_COUNT);
+}
+
+// The gestures of the scroll are converted into the motion events which are notified.
+static void benchmarkGestureConverterScroll(benchmark::State& state) {
+    Touchpad touchpad;
+    InputDeviceContext deviceContext(touchpad.getDevice(), EVENTHUB_ID);
+    GestureConverter converter(touchpad.getReaderContext(), deviceContext, DEVICE_ID);
+    converter.setDisplayId(ADISPLAY_ID_DEFAULT);
+
+    nsecs_t when = 0;
+    const Gesture startGesture(kGestureScroll, 0, 0, /*dx=*/0, /*dy=*/-10);
+    std::list<NotifyArgs> args = converter.handleGesture(when, when, when, startGesture);
+    const size_t startAllocationCount = getAllocationCount();
+    for (auto _ : state) {
+        when += SYNC_INTERVAL;
+        const Gesture gesture(kGestureScroll, 0, 0, /*dx=*/0, /*dy=*/-1);
+        args = converter.handleGesture(when, when, when, gesture);
+        benchmark::DoNotOptimize(args);
+    }
+    // Each event is still allocated in a node of the list, with the vectors of its pointers.
+    const size_t allocationCount = getAllocationCount() - startAllocationCount;
+    state.counters["allocations_per_gesture"] =
+            static_cast<double>(allocationCount) / state.iterations();
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(benchmarkHardwareStateConverter);
+BENCHMARK(benchmarkGestureConverterScroll);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -42,6 +42,7 @@
 #include <cerrno>
 #include <cinttypes>
 #include <climits>
+#include <cmath>
 #include <cstddef>
 #include <ctime>
 #include <queue>
@@ -837,6 +838,54 @@ std::pair<bool /*cancelPointers*/, bool /*cancelNonPointers*/> expandCancellatio
     }
 }
 
+// Whether the motion of the next entry only differs from the motion of the first one by the fields
+// of a sample, so that both can be published as samples of one motion event.
+bool canBatchMotion(const DispatchEntry& first, const DispatchEntry& next) {
+    if (next.eventEntry->type != EventEntry::Type::MOTION) {
+        return false;
+    }
+    const MotionEntry& firstMotion = static_cast<const MotionEntry&>(*first.eventEntry);
+    const MotionEntry& nextMotion = static_cast<const MotionEntry&>(*next.eventEntry);
+    // The cursor position is NaN when there is no cursor.
+    const auto sameCursorPosition = [](float first, float next) {
+        return next == first || (std::isnan(next) && std::isnan(first));
+    };
+    return nextMotion.deviceId == firstMotion.deviceId &&
+            nextMotion.source == firstMotion.source &&
+            nextMotion.displayId == firstMotion.displayId &&
+            nextMotion.action == firstMotion.action &&
+            nextMotion.actionButton == firstMotion.actionButton &&
+            nextMotion.edgeFlags == firstMotion.edgeFlags &&
+            nextMotion.metaState == firstMotion.metaState &&
+            nextMotion.buttonState == firstMotion.buttonState &&
+            nextMotion.classification == firstMotion.classification &&
+            nextMotion.xPrecision == firstMotion.xPrecision &&
+            nextMotion.yPrecision == firstMotion.yPrecision &&
+            sameCursorPosition(firstMotion.xCursorPosition, nextMotion.xCursorPosition) &&
+            sameCursorPosition(firstMotion.yCursorPosition, nextMotion.yCursorPosition) &&
+            nextMotion.downTime == firstMotion.downTime &&
+            nextMotion.pointerProperties == firstMotion.pointerProperties &&
+            next.resolvedFlags == first.resolvedFlags && next.targetFlags == first.targetFlags &&
+            next.transform == first.transform && next.rawTransform == first.rawTransform &&
+            next.globalScaleFactor == first.globalScaleFactor;
+}
+
+// The number of the motion entries at the front of the queue which can be published as samples of
+// the same move.
+size_t getMotionBatchSize(const std::deque<std::unique_ptr<DispatchEntry>>& queue) {
+    const DispatchEntry& first = *queue.front();
+    const MotionEntry& motionEntry = static_cast<const MotionEntry&>(*first.eventEntry);
+    if (motionEntry.action != AMOTION_EVENT_ACTION_MOVE &&
+        motionEntry.action != AMOTION_EVENT_ACTION_HOVER_MOVE) {
+        return 1;
+    }
+    size_t size = 1;
+    while (size < queue.size() && canBatchMotion(first, *queue[size])) {
+        size++;
+    }
+    return size;
+}
+
 } // namespace
 
 // --- InputDispatcher ---
@@ -1357,7 +1406,8 @@ sp<WindowInfoHandle> InputDispatcher::findTouchedWindowAtLocked(int32_t displayI
                                                                 bool ignoreDragWindow) const {
     // Traverse windows from front to back to find touched window.
     const auto& windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+    for (const uint32_t index : getTouchCandidatesLocked(displayId, x, y)) {
+        const sp<WindowInfoHandle>& windowHandle = windowHandles[index];
         if (ignoreDragWindow && haveSameToken(windowHandle, mDragState->dragWindow)) {
             continue;
         }
@@ -1403,7 +1453,8 @@ std::vector<sp<WindowInfoHandle>> InputDispatcher::findTouchedSpyWindowsAtLocked
     // Traverse windows from front to back and gather the touched spy windows.
     std::vector<sp<WindowInfoHandle>> spyWindows;
     const auto& windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+    for (const uint32_t index : getTouchCandidatesLocked(displayId, x, y)) {
+        const sp<WindowInfoHandle>& windowHandle = windowHandles[index];
         const WindowInfo& info = *windowHandle->getInfo();
 
         if (!windowAcceptsTouchAt(info, displayId, x, y, isStylus, getTransformLocked(displayId))) {
@@ -3694,6 +3745,55 @@ status_t InputDispatcher::publishMotionEvent(Connection& connection,
                                 motionEntry.pointerProperties.data(), usingCoords);
 }
 
+status_t InputDispatcher::publishMotionSamples(Connection& connection, size_t entryCount,
+                                               size_t* outPublishedCount) const {
+    const DispatchEntry& first = *connection.outboundQueue.front();
+    const MotionEntry& firstMotion = static_cast<const MotionEntry&>(*first.eventEntry);
+
+    // TODO(b/316355518): Do not modify coords before dispatch.
+    // Scale the coords as publishMotionEvent does.
+    const bool scaleCoords = (firstMotion.source & AINPUT_SOURCE_CLASS_POINTER) &&
+            !first.targetFlags.test(InputTarget::Flags::ZERO_COORDS) &&
+            first.globalScaleFactor != 1.0f;
+    std::vector<std::vector<PointerCoords>> scaledCoords;
+    scaledCoords.reserve(scaleCoords ? entryCount : 0);
+
+    std::vector<InputPublisher::MotionSample> samples;
+    samples.reserve(entryCount);
+    for (size_t i = 0; i < entryCount; i++) {
+        const DispatchEntry& dispatchEntry = *connection.outboundQueue[i];
+        const MotionEntry& motionEntry = static_cast<const MotionEntry&>(*dispatchEntry.eventEntry);
+        const PointerCoords* usingCoords = motionEntry.pointerCoords.data();
+        if (scaleCoords) {
+            std::vector<PointerCoords>& coords =
+                    scaledCoords.emplace_back(motionEntry.pointerCoords);
+            for (PointerCoords& pointerCoords : coords) {
+                pointerCoords.scale(first.globalScaleFactor, /*windowXScale=*/1,
+                                    /*windowYScale=*/1);
+            }
+            usingCoords = coords.data();
+        }
+        samples.push_back({.seq = dispatchEntry.seq,
+                           .eventId = motionEntry.id,
+                           .hmac = getSignature(motionEntry, dispatchEntry),
+                           .eventTime = motionEntry.eventTime,
+                           .pointerCoords = usingCoords});
+    }
+
+    return connection.inputPublisher
+            .publishMotionSamples(firstMotion.deviceId, firstMotion.source, firstMotion.displayId,
+                                  firstMotion.action, firstMotion.actionButton,
+                                  first.resolvedFlags, firstMotion.edgeFlags,
+                                  firstMotion.metaState, firstMotion.buttonState,
+                                  firstMotion.classification, first.transform,
+                                  firstMotion.xPrecision, firstMotion.yPrecision,
+                                  firstMotion.xCursorPosition, firstMotion.yCursorPosition,
+                                  first.rawTransform, firstMotion.downTime,
+                                  firstMotion.getPointerCount(),
+                                  firstMotion.pointerProperties.data(), samples,
+                                  outPublishedCount);
+}
+
 void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
                                                const std::shared_ptr<Connection>& connection) {
     ATRACE_NAME_IF(ATRACE_ENABLED(),
@@ -3711,6 +3811,9 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
 
         // Publish the event.
         status_t status;
+        // The number of the entries at the front of the queue which were published, when several
+        // motions were published as samples of one move.
+        std::optional<size_t> publishedSampleCount;
         const EventEntry& eventEntry = *(dispatchEntry->eventEntry);
         switch (eventEntry.type) {
             case EventEntry::Type::KEY: {
@@ -3741,11 +3844,33 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
                     LOG(INFO) << "Publishing " << *dispatchEntry << " to "
                               << connection->getInputChannelName();
                 }
-                const MotionEntry& motionEntry = static_cast<const MotionEntry&>(eventEntry);
-                status = publishMotionEvent(*connection, *dispatchEntry);
+                const size_t batchSize = getMotionBatchSize(connection->outboundQueue);
+                if (batchSize == 1) {
+                    const MotionEntry& motionEntry = static_cast<const MotionEntry&>(eventEntry);
+                    status = publishMotionEvent(*connection, *dispatchEntry);
+                    if (mTracer) {
+                        mTracer->traceEventDispatch(*dispatchEntry, motionEntry.traceTracker.get());
+                    }
+                    break;
+                }
+
+                // The app fell behind, so send the moves it has yet to receive together.
+                for (size_t i = 1; i < batchSize; i++) {
+                    connection->outboundQueue[i]->deliveryTime = dispatchEntry->deliveryTime;
+                    connection->outboundQueue[i]->timeoutTime = dispatchEntry->timeoutTime;
+                }
+                size_t publishedCount;
+                status = publishMotionSamples(*connection, batchSize, &publishedCount);
                 if (mTracer) {
-                    mTracer->traceEventDispatch(*dispatchEntry, motionEntry.traceTracker.get());
+                    for (size_t i = 0; i < publishedCount; i++) {
+                        const DispatchEntry& entry = *connection->outboundQueue[i];
+                        mTracer->traceEventDispatch(entry,
+                                                    static_cast<const MotionEntry&>(
+                                                            *entry.eventEntry)
+                                                            .traceTracker.get());
+                    }
                 }
+                publishedSampleCount = publishedCount;
                 break;
             }
 
@@ -3794,6 +3919,19 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
             }
         }
 
+        // Re-enqueue the published events on the wait queue.
+        const size_t publishedCount = publishedSampleCount.value_or(status == OK ? 1 : 0);
+        for (size_t i = 0; i < publishedCount; i++) {
+            const nsecs_t timeoutTime = connection->outboundQueue.front()->timeoutTime;
+            connection->waitQueue.emplace_back(std::move(connection->outboundQueue.front()));
+            connection->outboundQueue.pop_front();
+            traceOutboundQueueLength(*connection);
+            if (connection->responsive) {
+                mAnrTracker.insert(timeoutTime, connection->getToken());
+            }
+            traceWaitQueueLength(*connection);
+        }
+
         // Check the result.
         if (status) {
             if (status == WOULD_BLOCK) {
@@ -3823,16 +3961,6 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
             }
             return;
         }
-
-        // Re-enqueue the event on the wait queue.
-        const nsecs_t timeoutTime = dispatchEntry->timeoutTime;
-        connection->waitQueue.emplace_back(std::move(dispatchEntry));
-        connection->outboundQueue.erase(connection->outboundQueue.begin());
-        traceOutboundQueueLength(*connection);
-        if (connection->responsive) {
-            mAnrTracker.insert(timeoutTime, connection->getToken());
-        }
-        traceWaitQueueLength(*connection);
     }
 }
 
@@ -3987,9 +4115,10 @@ int InputDispatcher::handleReceiveCallback(int events, sp<IBinder> connectionTok
         }
         if (gotOne) {
             runCommandsLockedInterruptable();
-            if (status == WOULD_BLOCK) {
-                return 1;
-            }
+        }
+        // The consumer may only have sent its version, which is not a response.
+        if (status == WOULD_BLOCK) {
+            return 1;
         }
 
         notify = status != DEAD_OBJECT || !connection->monitor;
@@ -5116,6 +5245,13 @@ ui::Transform InputDispatcher::getTransformLocked(int32_t displayId) const {
                                                 : kIdentityTransform;
 }
 
+std::span<const uint32_t> InputDispatcher::getTouchCandidatesLocked(int32_t displayId, float x,
+                                                                    float y) const {
+    const auto it = mWindowHitIndexByDisplay.find(displayId);
+    return it != mWindowHitIndexByDisplay.end() ? it->second.getCandidates(x, y)
+                                                : std::span<const uint32_t>();
+}
+
 bool InputDispatcher::canWindowReceiveMotionLocked(const sp<WindowInfoHandle>& window,
                                                    const MotionEntry& motionEntry) const {
     const WindowInfo& info = *window->getInfo();
@@ -5183,6 +5319,7 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
     if (windowInfoHandles.empty()) {
         // Remove all handles on a display if there are no windows left.
         mWindowHandlesByDisplay.erase(displayId);
+        mWindowHitIndexByDisplay.erase(displayId);
         return;
     }
 
@@ -5227,6 +5364,7 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
     }
 
     // Insert or replace
+    mWindowHitIndexByDisplay[displayId] = WindowHitIndex(newHandles, getTransformLocked(displayId));
     mWindowHandlesByDisplay[displayId] = newHandles;
 }
 
@@ -5926,7 +6064,9 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) const {
     dump += StringPrintf(INDENT2 "KeyRepeatTimeout: %" PRId64 "ms\n",
                          ns2ms(mConfig.keyRepeatTimeout));
     dump += mLatencyTracker.dump(INDENT2);
-    dump += mLatencyAggregator.dump(INDENT2);
+    dump += mLatencyAggregator.dump(INDENT2, [this](const sp<IBinder>& token) REQUIRES(mLock) {
+        return getConnectionNameLocked(token);
+    });
     dump += INDENT "InputTracer: ";
     dump += mTracer == nullptr ? "Disabled" : "Enabled";
 }
@@ -5957,7 +6097,11 @@ Result<std::unique_ptr<InputChannel>> InputDispatcher::createInputChannel(const
 
     std::unique_ptr<InputChannel> serverChannel;
     std::unique_ptr<InputChannel> clientChannel;
-    status_t result = InputChannel::openInputChannelPair(name, serverChannel, clientChannel);
+    // The socket still carries the responses of the client, and its hangup, which the looper
+    // reports, when the client is gone.
+    status_t result =
+            InputChannel::openInputChannelPair(name, serverChannel, clientChannel,
+                                               input_flags::input_channel_shared_memory());
 
     if (result) {
         return base::Error(result) << "Failed to open input channel pair with name " << name;
@@ -6056,6 +6200,7 @@ status_t InputDispatcher::removeInputChannelLocked(const sp<IBinder>& connection
     }
 
     removeConnectionLocked(connection);
+    mLatencyAggregator.removeConnection(connectionToken);
 
     if (connection->monitor) {
         removeMonitorChannelLocked(connectionToken);
@@ -32,6 +32,7 @@
 #include "Monitor.h"
 #include "TouchState.h"
 #include "TouchedWindow.h"
+#include "WindowHitIndex.h"
 #include "trace/InputTracerInterface.h"
 #include "trace/InputTracingBackendInterface.h"
 
@@ -99,6 +100,8 @@ public:
     void notifyInputDevicesChanged(const NotifyInputDevicesChangedArgs& args) override;
     void notifyConfigurationChanged(const NotifyConfigurationChangedArgs& args) override;
     void notifyKey(const NotifyKeyArgs& args) override;
+    // The events are copied to the inbound queue.
+    using InputDispatcherInterface::notifyMotion;
     void notifyMotion(const NotifyMotionArgs& args) override;
     void notifySwitch(const NotifySwitchArgs& args) override;
     void notifySensor(const NotifySensorArgs& args) override;
@@ -356,6 +359,9 @@ private:
             mWindowHandlesByDisplay GUARDED_BY(mLock);
     std::unordered_map<int32_t /*displayId*/, android::gui::DisplayInfo> mDisplayInfos
             GUARDED_BY(mLock);
+    // The hit testing index of the window handles of each display, rebuilt along with them.
+    std::unordered_map<int32_t /*displayId*/, WindowHitIndex> mWindowHitIndexByDisplay
+            GUARDED_BY(mLock);
     void setInputWindowsLocked(
             const std::vector<sp<android::gui::WindowInfoHandle>>& inputWindowHandles,
             int32_t displayId) REQUIRES(mLock);
@@ -363,6 +369,10 @@ private:
     const std::vector<sp<android::gui::WindowInfoHandle>>& getWindowHandlesLocked(
             int32_t displayId) const REQUIRES(mLock);
     ui::Transform getTransformLocked(int32_t displayId) const REQUIRES(mLock);
+    // Returns the positions in the window handles of the display of the windows which may be
+    // touched at the given location, from front to back.
+    std::span<const uint32_t> getTouchCandidatesLocked(int32_t displayId, float x, float y) const
+            REQUIRES(mLock);
 
     sp<android::gui::WindowInfoHandle> getWindowHandleLocked(
             const sp<IBinder>& windowHandleToken, std::optional<int32_t> displayId = {}) const
@@ -596,6 +606,10 @@ private:
                                     std::shared_ptr<const EventEntry>,
                                     const InputTarget& inputTarget) REQUIRES(mLock);
     status_t publishMotionEvent(Connection& connection, DispatchEntry& dispatchEntry) const;
+    // Publishes the motions of the first entryCount entries of the outbound queue, which are
+    // samples of one move, and sets outPublishedCount to the number of them which were published.
+    status_t publishMotionSamples(Connection& connection, size_t entryCount,
+                                  size_t* outPublishedCount) const;
     void startDispatchCycleLocked(nsecs_t currentTime,
                                   const std::shared_ptr<Connection>& connection) REQUIRES(mLock);
     void finishDispatchCycleLocked(nsecs_t currentTime,
@@ -19,6 +19,8 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+
 #include <android-base/stringprintf.h>
 #include <input/Input.h>
 #include <log/log.h>
@@ -42,6 +44,14 @@ static inline int64_t ns2hus(nsecs_t nanos) {
 // The value here has been determined empirically.
 static constexpr size_t MAX_EVENTS_FOR_STATISTICS = 20000;
 
+// The pending latencies are added to the sketches once there are this many of them, so that the
+// lock of the sketches is only tried once per batch.
+static constexpr size_t PENDING_LATENCIES_BATCH_SIZE = 64;
+
+// The maximum number of windows whose latencies are kept for the dump. The window that received
+// an event the longest time ago is forgotten to make room for a new one.
+static constexpr size_t MAX_WINDOWS_FOR_LATENCIES = 32;
+
 // Category (=namespace) name for the input settings that are applied at boot time
 static const char* INPUT_NATIVE_BOOT = "input_native_boot";
 // Feature flag name for the threshold of end-to-end touch latency that would trigger
@@ -123,24 +133,57 @@ AStatsManager_PullAtomCallbackReturn LatencyAggregator::pullAtomCallback(int32_t
 void LatencyAggregator::processTimeline(const InputEventTimeline& timeline) {
     processStatistics(timeline);
     processSlowEvent(timeline);
+    processWindowLatency(timeline);
 }
 
-void LatencyAggregator::processStatistics(const InputEventTimeline& timeline) {
-    std::scoped_lock lock(mLock);
-    // Before we do any processing, check that we have not yet exceeded MAX_SIZE
-    if (mNumSketchEventsProcessed >= MAX_EVENTS_FOR_STATISTICS) {
-        return;
+void LatencyAggregator::processWindowLatency(const InputEventTimeline& timeline) {
+    for (const auto& [connectionToken, connectionTimeline] : timeline.connectionTimelines) {
+        if (!connectionTimeline.isComplete()) {
+            continue;
+        }
+        auto it = mWindowLatencies.find(connectionToken);
+        if (it == mWindowLatencies.end()) {
+            if (mWindowLatencies.size() >= MAX_WINDOWS_FOR_LATENCIES) {
+                mWindowLatencies.erase(
+                        std::min_element(mWindowLatencies.begin(), mWindowLatencies.end(),
+                                         [](const auto& lhs, const auto& rhs) {
+                                             return lhs.second.lastEventTime <
+                                                     rhs.second.lastEventTime;
+                                         }));
+            }
+            it = mWindowLatencies.emplace(connectionToken, WindowLatency{}).first;
+        }
+        const nsecs_t presentTime =
+                connectionTimeline.graphicsTimeline[GraphicsTimeline::PRESENT_TIME];
+        it->second.endToEnd.add(presentTime - timeline.eventTime);
+        it->second.lastEventTime = timeline.eventTime;
     }
-    mNumSketchEventsProcessed++;
+}
 
-    std::array<std::unique_ptr<KllQuantile>, SketchIndex::SIZE>& sketches =
-            timeline.isDown ? mDownSketches : mMoveSketches;
+void LatencyAggregator::removeConnection(const sp<IBinder>& connectionToken) {
+    mWindowLatencies.erase(connectionToken);
+}
 
-    // Process common ones first
-    const nsecs_t eventToRead = timeline.readTime - timeline.eventTime;
-    sketches[SketchIndex::EVENT_TO_READ]->Add(ns2hus(eventToRead));
+bool LatencyAggregator::pushPendingLatencies(const PendingLatencies& latencies) {
+    const size_t write = mPendingWrite.load(std::memory_order_relaxed);
+    if (write - mPendingRead.load(std::memory_order_acquire) == PENDING_LATENCIES_CAPACITY) {
+        mNumDroppedLatencies.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    mPendingLatencies[write % PENDING_LATENCIES_CAPACITY] = latencies;
+    mPendingWrite.store(write + 1, std::memory_order_release);
+    return true;
+}
 
-    // Now process per-connection ones
+void LatencyAggregator::processStatistics(const InputEventTimeline& timeline) {
+    // Queue common ones first
+    PendingLatencies eventLatencies{.isDown = timeline.isDown, .isConnection = false};
+    eventLatencies.latencies[SketchIndex::EVENT_TO_READ] = timeline.readTime - timeline.eventTime;
+    if (!pushPendingLatencies(eventLatencies)) {
+        return;
+    }
+
+    // Now queue per-connection ones
     for (const auto& [connectionToken, connectionTimeline] : timeline.connectionTimelines) {
         if (!connectionTimeline.isComplete()) {
             continue;
@@ -158,17 +201,56 @@ void LatencyAggregator::processStatistics(const InputEventTimeline& timeline) {
         const nsecs_t gpuCompleteToPresent = presentTime - gpuCompletedTime;
         const nsecs_t endToEnd = presentTime - timeline.eventTime;
 
-        sketches[SketchIndex::READ_TO_DELIVER]->Add(ns2hus(readToDeliver));
-        sketches[SketchIndex::DELIVER_TO_CONSUME]->Add(ns2hus(deliverToConsume));
-        sketches[SketchIndex::CONSUME_TO_FINISH]->Add(ns2hus(consumeToFinish));
-        sketches[SketchIndex::CONSUME_TO_GPU_COMPLETE]->Add(ns2hus(consumeToGpuComplete));
-        sketches[SketchIndex::GPU_COMPLETE_TO_PRESENT]->Add(ns2hus(gpuCompleteToPresent));
-        sketches[SketchIndex::END_TO_END]->Add(ns2hus(endToEnd));
+        PendingLatencies connectionLatencies{.isDown = timeline.isDown, .isConnection = true};
+        connectionLatencies.latencies[SketchIndex::READ_TO_DELIVER] = readToDeliver;
+        connectionLatencies.latencies[SketchIndex::DELIVER_TO_CONSUME] = deliverToConsume;
+        connectionLatencies.latencies[SketchIndex::CONSUME_TO_FINISH] = consumeToFinish;
+        connectionLatencies.latencies[SketchIndex::CONSUME_TO_GPU_COMPLETE] = consumeToGpuComplete;
+        connectionLatencies.latencies[SketchIndex::GPU_COMPLETE_TO_PRESENT] = gpuCompleteToPresent;
+        connectionLatencies.latencies[SketchIndex::END_TO_END] = endToEnd;
+        pushPendingLatencies(connectionLatencies);
+    }
+
+    // Add the queued latencies to the sketches in batches, without waiting for the statsd pull,
+    // which adds them itself.
+    const size_t numPending = mPendingWrite.load(std::memory_order_relaxed) -
+            mPendingRead.load(std::memory_order_acquire);
+    if (numPending >= PENDING_LATENCIES_BATCH_SIZE && mLock.try_lock()) {
+        addPendingLatenciesLocked();
+        mLock.unlock();
     }
 }
 
+void LatencyAggregator::addPendingLatenciesLocked() {
+    const size_t write = mPendingWrite.load(std::memory_order_acquire);
+    for (size_t read = mPendingRead.load(std::memory_order_relaxed); read != write; read++) {
+        const PendingLatencies& pending = mPendingLatencies[read % PENDING_LATENCIES_CAPACITY];
+        std::array<std::unique_ptr<KllQuantile>, SketchIndex::SIZE>& sketches =
+                pending.isDown ? mDownSketches : mMoveSketches;
+        if (!pending.isConnection) {
+            // Before we do any processing, check that we have not yet exceeded MAX_SIZE
+            mSkipPendingConnections = mNumSketchEventsProcessed >= MAX_EVENTS_FOR_STATISTICS;
+            if (mSkipPendingConnections) {
+                continue;
+            }
+            mNumSketchEventsProcessed++;
+            sketches[SketchIndex::EVENT_TO_READ]->Add(
+                    ns2hus(pending.latencies[SketchIndex::EVENT_TO_READ]));
+            continue;
+        }
+        if (mSkipPendingConnections) {
+            continue;
+        }
+        for (size_t i = SketchIndex::READ_TO_DELIVER; i < SketchIndex::SIZE; i++) {
+            sketches[i]->Add(ns2hus(pending.latencies[i]));
+        }
+    }
+    mPendingRead.store(write, std::memory_order_release);
+}
+
 AStatsManager_PullAtomCallbackReturn LatencyAggregator::pullData(AStatsEventList* data) {
     std::scoped_lock lock(mLock);
+    addPendingLatenciesLocked();
     std::array<std::unique_ptr<SafeBytesField>, SketchIndex::SIZE> serializedDownData;
     std::array<std::unique_ptr<SafeBytesField>, SketchIndex::SIZE> serializedMoveData;
     for (size_t i = 0; i < SketchIndex::SIZE; i++) {
@@ -258,7 +340,9 @@ void LatencyAggregator::processSlowEvent(const InputEventTimeline& timeline) {
     }
 }
 
-std::string LatencyAggregator::dump(const char* prefix) const {
+std::string LatencyAggregator::dump(
+        const char* prefix,
+        const std::function<std::string(const sp<IBinder>&)>& getWindowName) const {
     std::scoped_lock lock(mLock);
     std::string sketchDump = StringPrintf("%s  Sketches:\n", prefix);
     for (size_t i = 0; i < SketchIndex::SIZE; i++) {
@@ -279,7 +363,26 @@ std::string LatencyAggregator::dump(const char* prefix) const {
             StringPrintf("%s  mLastSlowEventTime=%" PRId64 "\n", prefix, mLastSlowEventTime) +
             StringPrintf("%s  mNumEventsSinceLastSlowEventReport = %zu\n", prefix,
                          mNumEventsSinceLastSlowEventReport) +
-            StringPrintf("%s  mNumSkippedSlowEvents = %zu\n", prefix, mNumSkippedSlowEvents);
+            StringPrintf("%s  mNumSkippedSlowEvents = %zu\n", prefix, mNumSkippedSlowEvents) +
+            StringPrintf("%s  Pending latencies: %zu, dropped: %zu\n", prefix,
+                         mPendingWrite.load() - mPendingRead.load(), mNumDroppedLatencies.load()) +
+            dumpWindowLatencies(prefix, getWindowName);
+}
+
+std::string LatencyAggregator::dumpWindowLatencies(
+        const char* prefix,
+        const std::function<std::string(const sp<IBinder>&)>& getWindowName) const {
+    if (mWindowLatencies.empty()) {
+        return StringPrintf("%s  WindowLatencies: <none>\n", prefix);
+    }
+    std::string dump = StringPrintf("%s  WindowLatencies (event to present):\n", prefix);
+    for (const auto& [token, windowLatency] : mWindowLatencies) {
+        const LatencyHistogram& histogram = windowLatency.endToEnd;
+        dump += StringPrintf("%s    %s: count=%zu, p50=%.1fms, p99=%.1fms\n", prefix,
+                             getWindowName(token).c_str(), histogram.count(),
+                             histogram.quantile(0.5) * 1E-6, histogram.quantile(0.99) * 1E-6);
+    }
+    return dump;
 }
 
 } // namespace android::inputdispatcher
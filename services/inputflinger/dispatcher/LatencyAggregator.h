@@ -17,11 +17,17 @@
 #pragma once
 
 #include <android-base/thread_annotations.h>
+#include <binder/IBinder.h>
 #include <kll.h>
 #include <statslog.h>
 #include <utils/Timers.h>
 
+#include <atomic>
+#include <functional>
+#include <map>
+
 #include "InputEventTimeline.h"
+#include "LatencyHistogram.h"
 
 namespace android::inputdispatcher {
 
@@ -47,7 +53,11 @@ enum SketchIndex : size_t {
 // GraphicsTimeline::PRESENT_TIME
 
 /**
- * Keep sketches of the provided events and report slow events
+ * Keep sketches of the provided events and report slow events.
+ *
+ * The latencies of the events are queued without a lock, and only added to the sketches in
+ * batches, when the lock of the sketches is not held by the statsd pull, or on the pull itself.
+ * The end-to-end latencies of each window are also kept, for the dump.
  */
 class LatencyAggregator final : public InputEventTimelineProcessor {
 public:
@@ -57,7 +67,16 @@ public:
      */
     void processTimeline(const InputEventTimeline& timeline) override;
 
-    std::string dump(const char* prefix) const;
+    /**
+     * Forget the latencies of a window, once its connection is removed.
+     */
+    void removeConnection(const sp<IBinder>& connectionToken);
+
+    /**
+     * Dump the statistics, naming the windows with the provided function.
+     */
+    std::string dump(const char* prefix,
+                     const std::function<std::string(const sp<IBinder>&)>& getWindowName) const;
 
     ~LatencyAggregator();
 
@@ -77,11 +96,47 @@ private:
     // How many events have been received since the last time we reported a slow event
     size_t mNumEventsSinceLastSlowEventReport = 0;
 
+    // ---------- Per-window latency handling ----------
+    // Not protected by mLock, since the InputDispatcher only calls processTimeline,
+    // removeConnection and dump with its own lock held.
+    struct WindowLatency {
+        LatencyHistogram endToEnd;
+        nsecs_t lastEventTime = 0;
+    };
+    void processWindowLatency(const InputEventTimeline& timeline);
+    std::string dumpWindowLatencies(
+            const char* prefix,
+            const std::function<std::string(const sp<IBinder>&)>& getWindowName) const;
+    std::map<sp<IBinder>, WindowLatency> mWindowLatencies;
+
     // ---------- Statistics handling ----------
     // Statistics is pulled rather than pushed. It's pulled on a binder thread, and therefore will
     // be accessed by two different threads. The lock is needed to protect the pulled data.
     mutable std::mutex mLock;
     void processStatistics(const InputEventTimeline& timeline);
+
+    // The latencies of an event, or of one of its connections, waiting to be added to the
+    // sketches. Those of an event only have the EVENT_TO_READ latency.
+    struct PendingLatencies {
+        bool isDown;
+        bool isConnection;
+        std::array<nsecs_t, SketchIndex::SIZE> latencies;
+    };
+    static constexpr size_t PENDING_LATENCIES_CAPACITY = 1024;
+    // Written by processTimeline, and read with mLock held. The timelines are processed on the
+    // threads which call into the InputDispatcher, not only on the dispatcher thread, so the
+    // pending latencies are only a single producer, single consumer queue because the
+    // InputDispatcher processes them with its own lock held. Each position only grows, and the
+    // pending latencies are at [mPendingRead, mPendingWrite) modulo the capacity.
+    std::array<PendingLatencies, PENDING_LATENCIES_CAPACITY> mPendingLatencies;
+    std::atomic<size_t> mPendingRead = 0;
+    std::atomic<size_t> mPendingWrite = 0;
+    // The latencies dropped since the queue was full.
+    std::atomic<size_t> mNumDroppedLatencies = 0;
+    bool pushPendingLatencies(const PendingLatencies& latencies);
+    void addPendingLatenciesLocked() REQUIRES(mLock);
+    // Whether the connections of the last pending event are skipped, when the statistics are full.
+    bool mSkipPendingConnections GUARDED_BY(mLock) = false;
     // Sketches
     std::array<std::unique_ptr<dist_proc::aggregation::KllQuantile>, SketchIndex::SIZE>
             mDownSketches GUARDED_BY(mLock);
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace android::inputdispatcher {
+
+size_t LatencyHistogram::bucketIndex(uint64_t micros) {
+    if (micros < kSubBuckets) {
+        return micros;
+    }
+    // The buckets of [2^n, 2^(n+1)) are indexed by the kSubBucketBits bits after the highest bit.
+    const size_t highestBit = std::bit_width(micros) - 1;
+    const size_t shift = highestBit - kSubBucketBits;
+    return (shift + 1) * kSubBuckets + ((micros >> shift) - kSubBuckets);
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(size_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    const size_t shift = index / kSubBuckets - 1;
+    return (index % kSubBuckets + kSubBuckets) << shift;
+}
+
+void LatencyHistogram::add(nsecs_t latency) {
+    const uint64_t micros =
+            std::clamp<nsecs_t>(ns2us(latency), 0, (nsecs_t(1) << kMaxMicrosBits) - 1);
+    mBuckets[bucketIndex(micros)]++;
+    mCount++;
+}
+
+nsecs_t LatencyHistogram::quantile(float fraction) const {
+    if (mCount == 0) {
+        return 0;
+    }
+    const size_t rank = std::max<size_t>(1, std::ceil(std::clamp(fraction, 0.f, 1.f) * mCount));
+    size_t seen = 0;
+    for (size_t i = 0; i < kBuckets; i++) {
+        seen += mBuckets[i];
+        if (seen >= rank) {
+            return us2ns(i + 1 < kBuckets ? bucketLowerBound(i + 1) : bucketLowerBound(i));
+        }
+    }
+    return us2ns(bucketLowerBound(kBuckets - 1));
+}
+
+void LatencyHistogram::reset() {
+    mBuckets.fill(0);
+    mCount = 0;
+}
+
+} // namespace android::inputdispatcher
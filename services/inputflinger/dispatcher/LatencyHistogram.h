@@ -0,0 +1,58 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/Timers.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace android::inputdispatcher {
+
+/**
+ * A histogram of latencies with a fixed number of logarithmic buckets, so that adding a latency
+ * is constant time and does not allocate. The buckets are a microsecond wide below 8us, and then
+ * split each power of two into 8, so that the quantiles are within 12.5% of the latencies.
+ */
+class LatencyHistogram {
+public:
+    void add(nsecs_t latency);
+
+    size_t count() const { return mCount; }
+
+    // Returns the upper bound of the bucket of the latency that the given fraction of the latencies
+    // does not exceed, or 0 if there are no latencies.
+    nsecs_t quantile(float fraction) const;
+
+    void reset();
+
+private:
+    static constexpr size_t kSubBucketBits = 3;
+    static constexpr size_t kSubBuckets = 1 << kSubBucketBits;
+    // The latencies are clamped to 2^31 us, over half an hour.
+    static constexpr size_t kMaxMicrosBits = 31;
+    static constexpr size_t kBuckets = (kMaxMicrosBits - kSubBucketBits + 1) * kSubBuckets;
+
+    static size_t bucketIndex(uint64_t micros);
+    static uint64_t bucketLowerBound(size_t index);
+
+    std::array<uint32_t, kBuckets> mBuckets{};
+    size_t mCount = 0;
+};
+
+} // namespace android::inputdispatcher
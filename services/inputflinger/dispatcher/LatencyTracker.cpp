@@ -65,6 +65,12 @@ static void eraseByValue(std::multimap<K, V>& map, const V& value) {
 LatencyTracker::LatencyTracker(InputEventTimelineProcessor* processor)
       : mTimelineProcessor(processor) {
     LOG_ALWAYS_FATAL_IF(processor == nullptr);
+    auto& registry = perfcounters::Registry::getInstance();
+    mTrackedEventsCounter = registry.getCounter("inputflinger.latency.tracked_events");
+    mDuplicateEventsCounter = registry.getCounter("inputflinger.latency.duplicate_events");
+    mUnknownDeviceEventsCounter = registry.getCounter("inputflinger.latency.unknown_device_events");
+    mUnreliableReportsCounter = registry.getCounter("inputflinger.latency.unreliable_reports");
+    mReportedTimelinesCounter = registry.getCounter("inputflinger.latency.reported_timelines");
 }
 
 void LatencyTracker::trackListener(int32_t inputEventId, bool isDown, nsecs_t eventTime,
@@ -79,6 +85,7 @@ void LatencyTracker::trackListener(int32_t inputEventId, bool isDown, nsecs_t ev
         // rarely, so we won't lose much data
         mTimelines.erase(it);
         eraseByValue(mEventTimes, inputEventId);
+        mDuplicateEventsCounter.add();
         return;
     }
 
@@ -98,6 +105,7 @@ void LatencyTracker::trackListener(int32_t inputEventId, bool isDown, nsecs_t ev
     // but a possibility of it is handled in case of race conditions
     if (identifier == nullptr) {
         ALOGE("Could not find input device identifier. Dropping call to LatencyTracker.");
+        mUnknownDeviceEventsCounter.add();
         return;
     }
 
@@ -105,6 +113,7 @@ void LatencyTracker::trackListener(int32_t inputEventId, bool isDown, nsecs_t ev
                        InputEventTimeline(isDown, eventTime, readTime, identifier->vendor,
                                           identifier->product, sources));
     mEventTimes.emplace(eventTime, inputEventId);
+    mTrackedEventsCounter.add();
 }
 
 void LatencyTracker::trackFinishedEvent(int32_t inputEventId, const sp<IBinder>& connectionToken,
@@ -134,6 +143,7 @@ void LatencyTracker::trackFinishedEvent(int32_t inputEventId, const sp<IBinder>&
             // We are receiving unreliable data from the app. Just delete the entire connection
             // timeline for this event
             timeline.connectionTimelines.erase(connectionIt);
+            mUnreliableReportsCounter.add();
         }
     }
 }
@@ -161,6 +171,7 @@ void LatencyTracker::trackGraphicsLatency(
             // We are receiving unreliable data from the app. Just delete the entire connection
             // timeline for this event
             timeline.connectionTimelines.erase(connectionIt);
+            mUnreliableReportsCounter.add();
         }
     }
 }
@@ -181,6 +192,7 @@ void LatencyTracker::reportAndPruneMatureRecords(nsecs_t newEventTime) {
                                 oldestInputEventId);
             const InputEventTimeline& timeline = it->second;
             mTimelineProcessor->processTimeline(timeline);
+            mReportedTimelinesCounter.add();
             mTimelines.erase(it);
             mEventTimes.erase(mEventTimes.begin());
         } else {
@@ -23,6 +23,7 @@
 
 #include <binder/IBinder.h>
 #include <input/Input.h>
+#include <perfcounters/PerfCounters.h>
 
 #include "InputEventTimeline.h"
 #include "NotifyArgs.h"
@@ -82,6 +83,13 @@ private:
 
     InputEventTimelineProcessor* mTimelineProcessor;
     std::vector<InputDeviceInfo> mInputDevices;
+
+    // Counters which collectors read from shared memory.
+    perfcounters::Counter mTrackedEventsCounter;
+    perfcounters::Counter mDuplicateEventsCounter;
+    perfcounters::Counter mUnknownDeviceEventsCounter;
+    perfcounters::Counter mUnreliableReportsCounter;
+    perfcounters::Counter mReportedTimelinesCounter;
     void reportAndPruneMatureRecords(nsecs_t newEventTime);
 };
 
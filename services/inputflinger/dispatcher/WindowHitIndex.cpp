@@ -0,0 +1,118 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "WindowHitIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace android::inputdispatcher {
+
+namespace {
+
+// The bounds are clamped to this range, so that a touchable region which is meant to be unbounded
+// does not overflow the size of the grid. It is far larger than any display.
+constexpr int32_t kMaxCoordinate = 1 << 24;
+
+int32_t divideRoundingUp(int32_t value, int32_t divisor) {
+    return (value + divisor - 1) / divisor;
+}
+
+Rect clampBounds(const Rect& bounds) {
+    const auto clamp = [](int32_t value) {
+        return std::clamp(value, -kMaxCoordinate, kMaxCoordinate);
+    };
+    return Rect(clamp(bounds.left), clamp(bounds.top), clamp(bounds.right), clamp(bounds.bottom));
+}
+
+} // namespace
+
+WindowHitIndex::WindowHitIndex(const std::vector<sp<gui::WindowInfoHandle>>& windowHandles,
+                               const ui::Transform& displayTransform)
+      : mDisplayTransform(displayTransform) {
+    // The dispatcher hit tests the touchable regions in the logical display space, see
+    // windowAcceptsTouchAt.
+    std::vector<Rect> windowBounds;
+    windowBounds.reserve(windowHandles.size());
+    for (const sp<gui::WindowInfoHandle>& windowHandle : windowHandles) {
+        const Rect& bounds = windowBounds.emplace_back(clampBounds(
+                displayTransform.transform(windowHandle->getInfo()->touchableRegion).getBounds()));
+        if (!bounds.isEmpty()) {
+            mBounds = mBounds.isEmpty()
+                    ? bounds
+                    : Rect(std::min(mBounds.left, bounds.left), std::min(mBounds.top, bounds.top),
+                           std::max(mBounds.right, bounds.right),
+                           std::max(mBounds.bottom, bounds.bottom));
+        }
+    }
+    if (mBounds.isEmpty()) {
+        return;
+    }
+
+    mCellWidth = divideRoundingUp(mBounds.getWidth(), kGridSize);
+    mCellHeight = divideRoundingUp(mBounds.getHeight(), kGridSize);
+    mColumns = divideRoundingUp(mBounds.getWidth(), mCellWidth);
+    const int32_t rows = divideRoundingUp(mBounds.getHeight(), mCellHeight);
+
+    // Lists each window in the cells its bounds overlap, in two passes so that the candidates of
+    // all the cells share a single array, and stay ordered from front to back.
+    const auto forEachCell = [&](const Rect& bounds, auto&& function) {
+        const int32_t firstColumn = (bounds.left - mBounds.left) / mCellWidth;
+        const int32_t lastColumn = (bounds.right - 1 - mBounds.left) / mCellWidth;
+        const int32_t firstRow = (bounds.top - mBounds.top) / mCellHeight;
+        const int32_t lastRow = (bounds.bottom - 1 - mBounds.top) / mCellHeight;
+        for (int32_t row = firstRow; row <= lastRow; row++) {
+            for (int32_t column = firstColumn; column <= lastColumn; column++) {
+                function(row * mColumns + column);
+            }
+        }
+    };
+
+    mCellStarts.assign(rows * mColumns + 1, 0);
+    for (const Rect& bounds : windowBounds) {
+        if (!bounds.isEmpty()) {
+            forEachCell(bounds, [&](int32_t cell) { mCellStarts[cell + 1]++; });
+        }
+    }
+    for (size_t cell = 1; cell < mCellStarts.size(); cell++) {
+        mCellStarts[cell] += mCellStarts[cell - 1];
+    }
+
+    mCandidates.resize(mCellStarts.back());
+    std::vector<uint32_t> cellEnds(mCellStarts.begin(), mCellStarts.end() - 1);
+    for (uint32_t i = 0; i < windowBounds.size(); i++) {
+        if (!windowBounds[i].isEmpty()) {
+            forEachCell(windowBounds[i], [&](int32_t cell) { mCandidates[cellEnds[cell]++] = i; });
+        }
+    }
+}
+
+std::span<const uint32_t> WindowHitIndex::getCandidates(float x, float y) const {
+    // The floored point is in the bounds if and only if the point itself is, which also keeps
+    // points far outside of the display from overflowing when they are converted.
+    const vec2 p = mDisplayTransform.transform(x, y);
+    if (!(p.x >= mBounds.left && p.x < mBounds.right && p.y >= mBounds.top &&
+          p.y < mBounds.bottom)) {
+        return {};
+    }
+    const int32_t column = (static_cast<int32_t>(std::floor(p.x)) - mBounds.left) / mCellWidth;
+    const int32_t row = (static_cast<int32_t>(std::floor(p.y)) - mBounds.top) / mCellHeight;
+    const int32_t cell = row * mColumns + column;
+    return std::span(mCandidates).subspan(mCellStarts[cell],
+                                          mCellStarts[cell + 1] - mCellStarts[cell]);
+}
+
+} // namespace android::inputdispatcher
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <gui/WindowInfo.h>
+#include <ui/Rect.h>
+#include <ui/Transform.h>
+#include <utils/StrongPointer.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace android::inputdispatcher {
+
+/**
+ * A grid over the touchable regions of the windows of a display, so that hit testing a point only
+ * considers the windows whose touchable region bounds may contain it, instead of all the windows
+ * of the display.
+ *
+ * The bounds are indexed in the logical display space, in which the dispatcher hit tests the
+ * windows, so that the candidates of a point are exactly those whose bounds contain it there.
+ * The index is immutable, and must be rebuilt whenever the windows or the display change.
+ */
+class WindowHitIndex {
+public:
+    // The number of cells of the grid along each axis. A finer grid has fewer candidates per cell,
+    // but a window which covers the display is then listed in more cells.
+    static constexpr int32_t kGridSize = 16;
+
+    // An index without any window.
+    WindowHitIndex() = default;
+
+    WindowHitIndex(const std::vector<sp<gui::WindowInfoHandle>>& windowHandles,
+                   const ui::Transform& displayTransform);
+
+    // Returns the positions in the indexed window handles of the windows whose touchable region
+    // may contain the point of the display, from front to back. The point must still be hit
+    // tested against each of them.
+    std::span<const uint32_t> getCandidates(float x, float y) const;
+
+private:
+    ui::Transform mDisplayTransform;
+    // The union of the touchable region bounds of the windows.
+    Rect mBounds = Rect::EMPTY_RECT;
+    int32_t mCellWidth = 1;
+    int32_t mCellHeight = 1;
+    int32_t mColumns = 0;
+
+    // The candidates of the cell at row r and column c are at
+    // [mCellStarts[r * mColumns + c], mCellStarts[r * mColumns + c + 1]) in mCandidates.
+    std::vector<uint32_t> mCellStarts;
+    std::vector<uint32_t> mCandidates;
+};
+
+} // namespace android::inputdispatcher
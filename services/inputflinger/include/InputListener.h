@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <utility>
 #include <vector>
 
 #include <input/Input.h>
@@ -41,6 +42,12 @@ public:
     virtual void notifyConfigurationChanged(const NotifyConfigurationChangedArgs& args) = 0;
     virtual void notifyKey(const NotifyKeyArgs& args) = 0;
     virtual void notifyMotion(const NotifyMotionArgs& args) = 0;
+    /*
+     * Notifies about a motion event that the listener takes over, so that the stages which pass
+     * the events on, or rewrite them, move them to the next stage instead of copying their
+     * pointers. By default, the event is notified like any other.
+     */
+    virtual void notifyMotion(NotifyMotionArgs&& args) { notifyMotion(std::as_const(args)); }
     virtual void notifySwitch(const NotifySwitchArgs& args) = 0;
     virtual void notifySensor(const NotifySensorArgs& args) = 0;
     virtual void notifyVibratorState(const NotifyVibratorStateArgs& args) = 0;
@@ -48,6 +55,7 @@ public:
     virtual void notifyPointerCaptureChanged(const NotifyPointerCaptureChangedArgs& args) = 0;
 
     void notify(const NotifyArgs& args);
+    void notify(NotifyArgs&& args);
 };
 
 /*
@@ -63,6 +71,7 @@ public:
     virtual void notifyConfigurationChanged(const NotifyConfigurationChangedArgs& args) override;
     virtual void notifyKey(const NotifyKeyArgs& args) override;
     virtual void notifyMotion(const NotifyMotionArgs& args) override;
+    void notifyMotion(NotifyMotionArgs&& args) override;
     virtual void notifySwitch(const NotifySwitchArgs& args) override;
     virtual void notifySensor(const NotifySensorArgs& args) override;
     virtual void notifyDeviceReset(const NotifyDeviceResetArgs& args) override;
@@ -87,6 +96,7 @@ public:
     virtual void notifyConfigurationChanged(const NotifyConfigurationChangedArgs& args) override;
     virtual void notifyKey(const NotifyKeyArgs& args) override;
     virtual void notifyMotion(const NotifyMotionArgs& args) override;
+    void notifyMotion(NotifyMotionArgs&& args) override;
     virtual void notifySwitch(const NotifySwitchArgs& args) override;
     virtual void notifySensor(const NotifySensorArgs& args) override;
     virtual void notifyDeviceReset(const NotifyDeviceResetArgs& args) override;
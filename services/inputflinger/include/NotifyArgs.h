@@ -133,6 +133,10 @@ struct NotifyMotionArgs {
 
     NotifyMotionArgs(const NotifyMotionArgs& other) = default;
     NotifyMotionArgs& operator=(const android::NotifyMotionArgs&) = default;
+    // The stages of the pipeline move the events to the next one, rather than copying their
+    // pointers.
+    NotifyMotionArgs(NotifyMotionArgs&& other) = default;
+    NotifyMotionArgs& operator=(NotifyMotionArgs&&) = default;
 
     bool operator==(const NotifyMotionArgs& rhs) const;
 
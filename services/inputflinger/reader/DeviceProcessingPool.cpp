@@ -0,0 +1,78 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DeviceProcessingPool.h"
+
+#include <string>
+
+namespace android {
+
+DeviceProcessingPool::DeviceProcessingPool(size_t numThreads) {
+    mThreads.reserve(numThreads);
+    for (size_t i = 0; i < numThreads; i++) {
+        mThreads.push_back(std::make_unique<InputThread>(
+                "InputReaderWorker" + std::to_string(i), [this]() { threadLoop(); },
+                [this]() {
+                    std::scoped_lock lock(mLock);
+                    mExiting = true;
+                    mTaskPostedCondition.notify_all();
+                }));
+    }
+}
+
+DeviceProcessingPool::~DeviceProcessingPool() {
+    mThreads.clear();
+}
+
+void DeviceProcessingPool::post(std::function<void()> task) {
+    std::scoped_lock lock(mLock);
+    mTasks.push_back(std::move(task));
+    mTaskPostedCondition.notify_one();
+}
+
+void DeviceProcessingPool::waitForIdle() {
+    std::unique_lock lock(mLock);
+    base::ScopedLockAssertion assumeLocked(mLock);
+    mIdleCondition.wait(lock, [this]() REQUIRES(mLock) {
+        return mTasks.empty() && mNumRunningTasks == 0;
+    });
+}
+
+void DeviceProcessingPool::threadLoop() {
+    std::function<void()> task;
+    { // acquire lock
+        std::unique_lock lock(mLock);
+        base::ScopedLockAssertion assumeLocked(mLock);
+        mTaskPostedCondition.wait(lock,
+                                  [this]() REQUIRES(mLock) { return mExiting || !mTasks.empty(); });
+        if (mTasks.empty()) {
+            return;
+        }
+        task = std::move(mTasks.front());
+        mTasks.pop_front();
+        mNumRunningTasks++;
+    } // release lock
+
+    task();
+
+    std::scoped_lock lock(mLock);
+    mNumRunningTasks--;
+    if (mTasks.empty() && mNumRunningTasks == 0) {
+        mIdleCondition.notify_all();
+    }
+}
+
+} // namespace android
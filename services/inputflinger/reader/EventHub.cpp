@@ -218,6 +218,17 @@ static bool isV4lScanningEnabled() {
     return property_get_bool("ro.input.video_enabled", /*default_value=*/true);
 }
 
+/**
+ * Devices which report long streams of events, such as game controllers and high rate sensors,
+ * wake up the reader for every few events when their fds are polled level-triggered.
+ *
+ * Setting this to "true" polls the device fds edge-triggered instead, so that each event of the
+ * poll only reports devices with new events, and each of them is read until it has no more.
+ */
+static bool isEdgeTriggeredReadingEnabled() {
+    return property_get_bool("ro.input.evdev_edge_triggered", /*default_value=*/false);
+}
+
 static nsecs_t processEventTimestamp(const struct input_event& event) {
     // Use the time specified in the event instead of the current time
     // so that downstream code can get more accurate estimates of
@@ -889,7 +900,8 @@ EventHub::EventHub(void)
         mNeedToScanDevices(true),
         mPendingEventCount(0),
         mPendingEventIndex(0),
-        mPendingINotify(false) {
+        mPendingINotify(false),
+        mEdgeTriggeredReads(isEdgeTriggeredReadingEnabled()) {
     ensureProcessCanBlockSuspend();
 
     mEpollFd = epoll_create1(EPOLL_CLOEXEC);
@@ -1994,6 +2006,7 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
                 int32_t readSize =
                         read(device->fd, readBuffer.data(),
                              sizeof(decltype(readBuffer)::value_type) * readBuffer.size());
+                mReadCount++;
                 if (readSize == 0 || (readSize < 0 && errno == ENODEV)) {
                     // Device was removed before INotify noticed.
                     ALOGW("could not get event, removed? (fd: %d size: %" PRId32
@@ -2002,7 +2015,11 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
                     deviceChanged = true;
                     closeDeviceLocked(*device);
                 } else if (readSize < 0) {
-                    if (errno != EAGAIN && errno != EINTR) {
+                    if (errno == EINTR && mEdgeTriggeredReads) {
+                        // The device is not reported again until it has new events, so it must be
+                        // read again now.
+                        mPendingEventIndex -= 1;
+                    } else if (errno != EAGAIN && errno != EINTR) {
                         ALOGW("could not get event (errno=%d)", errno);
                     }
                 } else if ((readSize % sizeof(struct input_event)) != 0) {
@@ -2011,6 +2028,7 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
                     const int32_t deviceId = device->id == mBuiltInKeyboardId ? 0 : device->id;
 
                     const size_t count = size_t(readSize) / sizeof(struct input_event);
+                    mReadEventCount += count;
                     for (size_t i = 0; i < count; i++) {
                         struct input_event& iev = readBuffer[i];
                         device->trackInputEvent(iev);
@@ -2026,6 +2044,10 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
                     if (events.size() >= EVENT_BUFFER_SIZE) {
                         // The result buffer is full.  Reset the pending event index
                         // so we will try to read the device again on the next iteration.
+                        // This also keeps reading an edge-triggered device until it has no more
+                        // events, since a read can only fill the read buffer by filling the result
+                        // buffer as well. A shorter read emptied the device, which then reports
+                        // its next events as a new edge.
                         mPendingEventIndex -= 1;
                         break;
                     }
@@ -2101,6 +2123,7 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
         } else {
             // Some events occurred.
             mPendingEventCount = size_t(pollResult);
+            mWakeupCount++;
         }
     }
 
@@ -2159,10 +2182,10 @@ void EventHub::scanDevicesLocked() {
 
 // ----------------------------------------------------------------------------
 
-status_t EventHub::registerFdForEpoll(int fd) {
+status_t EventHub::registerFdForEpoll(int fd, bool edgeTriggered) {
     // TODO(b/121395353) - consider adding EPOLLRDHUP
     struct epoll_event eventItem = {};
-    eventItem.events = EPOLLIN | EPOLLWAKEUP;
+    eventItem.events = EPOLLIN | EPOLLWAKEUP | (edgeTriggered ? EPOLLET : 0);
     eventItem.data.fd = fd;
     if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &eventItem)) {
         ALOGE("Could not add fd to epoll instance: %s", strerror(errno));
@@ -2180,7 +2203,7 @@ status_t EventHub::unregisterFdFromEpoll(int fd) {
 }
 
 status_t EventHub::registerDeviceForEpollLocked(Device& device) {
-    status_t result = registerFdForEpoll(device.fd);
+    status_t result = registerFdForEpoll(device.fd, mEdgeTriggeredReads);
     if (result != OK) {
         ALOGE("Could not add input device fd to epoll for device %" PRId32, device.id);
         return result;
@@ -2850,6 +2873,11 @@ void EventHub::dump(std::string& dump) const {
         std::scoped_lock _l(mLock);
 
         dump += StringPrintf(INDENT "BuiltInKeyboardId: %d\n", mBuiltInKeyboardId);
+        dump += StringPrintf(INDENT "EdgeTriggeredReads: %s\n", toString(mEdgeTriggeredReads));
+        dump += StringPrintf(INDENT "Reads: %zu, events per read: %.2f\n", mReadCount,
+                             mReadCount == 0 ? 0.0 : double(mReadEventCount) / mReadCount);
+        dump += StringPrintf(INDENT "Wakeups: %zu, events per wakeup: %.2f\n", mWakeupCount,
+                             mWakeupCount == 0 ? 0.0 : double(mReadEventCount) / mWakeupCount);
 
         dump += INDENT "Devices:\n";
 
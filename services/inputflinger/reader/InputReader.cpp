@@ -19,6 +19,7 @@
 #include "InputReader.h"
 
 #include <android-base/stringprintf.h>
+#include <cutils/properties.h>
 #include <errno.h>
 #include <input/Keyboard.h>
 #include <input/VirtualKeyMap.h>
@@ -32,6 +33,9 @@
 #include <utils/Errors.h>
 #include <utils/Thread.h>
 
+#include <optional>
+#include <variant>
+
 #include "InputDevice.h"
 
 using android::base::StringPrintf;
@@ -58,6 +62,50 @@ static bool isSubDevice(const InputDeviceIdentifier& identifier1,
             identifier1.location == identifier2.location);
 }
 
+static std::unique_ptr<DeviceProcessingPool> createDeviceProcessingPool() {
+    const int32_t numThreads = property_get_int32("ro.input.reader_worker_threads", 0);
+    if (numThreads <= 0) {
+        return nullptr;
+    }
+    return std::make_unique<DeviceProcessingPool>(numThreads);
+}
+
+// Whether the device is processed on the worker threads of the reader, if there are some. Only the
+// touchpads are, since the gesture library makes them the slowest devices to process, and they
+// only share state with the other devices through the reader context.
+static bool isProcessedInParallel(const InputDevice& device) {
+    return device.getSources() == (AINPUT_SOURCE_MOUSE | AINPUT_SOURCE_TOUCHPAD);
+}
+
+static std::optional<nsecs_t> getEventTime(const NotifyArgs& args) {
+    return std::visit(
+            [](const auto& args) -> std::optional<nsecs_t> {
+                if constexpr (requires { args.eventTime; }) {
+                    return args.eventTime;
+                } else {
+                    return std::nullopt;
+                }
+            },
+            args);
+}
+
+// Merges the args generated on a worker thread into the others, in the order of their event times.
+// The args without an event time stay right after those that precede them.
+static void mergeByEventTime(std::list<NotifyArgs>& out, std::list<NotifyArgs>&& args) {
+    std::list<NotifyArgs> merged;
+    nsecs_t outTime = LLONG_MIN;
+    nsecs_t argsTime = LLONG_MIN;
+    while (!out.empty() && !args.empty()) {
+        outTime = getEventTime(out.front()).value_or(outTime);
+        argsTime = getEventTime(args.front()).value_or(argsTime);
+        std::list<NotifyArgs>& next = argsTime < outTime ? args : out;
+        merged.splice(merged.end(), next, next.begin());
+    }
+    merged.splice(merged.end(), out);
+    merged.splice(merged.end(), args);
+    out = std::move(merged);
+}
+
 static bool isStylusPointerGestureStart(const NotifyMotionArgs& motionArgs) {
     const auto actionMasked = MotionEvent::getActionMasked(motionArgs.action);
     if (actionMasked != AMOTION_EVENT_ACTION_HOVER_ENTER &&
@@ -78,6 +126,7 @@ InputReader::InputReader(std::shared_ptr<EventHubInterface> eventHub,
         mEventHub(eventHub),
         mPolicy(policy),
         mNextListener(listener),
+        mDeviceProcessingPool(createDeviceProcessingPool()),
         mGlobalMetaState(AMETA_NONE),
         mLedMetaState(AMETA_NONE),
         mGeneration(1),
@@ -171,8 +220,14 @@ void InputReader::loopOnce() {
     // resulting in a deadlock.  This situation is actually quite plausible because the
     // listener is actually the input dispatcher, which calls into the window manager,
     // which occasionally calls into the input reader.
-    for (const NotifyArgs& args : notifyArgs) {
-        mNextListener.notify(args);
+    // The events are moved to the listener, so the starts of the stylus gestures are found first.
+    std::vector<std::pair<int32_t /*deviceId*/, nsecs_t /*eventTime*/>> stylusGestureStarts;
+    for (NotifyArgs& args : notifyArgs) {
+        const auto* motionArgs = std::get_if<NotifyMotionArgs>(&args);
+        if (motionArgs != nullptr && isStylusPointerGestureStart(*motionArgs)) {
+            stylusGestureStarts.emplace_back(motionArgs->deviceId, motionArgs->eventTime);
+        }
+        mNextListener.notify(std::move(args));
     }
 
     // Notify the policy that input devices have changed.
@@ -183,11 +238,8 @@ void InputReader::loopOnce() {
     }
 
     // Notify the policy of the start of every new stylus gesture.
-    for (const auto& args : notifyArgs) {
-        const auto* motionArgs = std::get_if<NotifyMotionArgs>(&args);
-        if (motionArgs != nullptr && isStylusPointerGestureStart(*motionArgs)) {
-            mPolicy->notifyStylusGestureStarted(motionArgs->deviceId, motionArgs->eventTime);
-        }
+    for (const auto& [deviceId, eventTime] : stylusGestureStarts) {
+        mPolicy->notifyStylusGestureStarted(deviceId, eventTime);
     }
 }
 
@@ -197,18 +249,14 @@ std::list<NotifyArgs> InputReader::processEventsLocked(const RawEvent* rawEvents
         int32_t type = rawEvent->type;
         size_t batchSize = 1;
         if (type < EventHubInterface::FIRST_SYNTHETIC_EVENT) {
-            int32_t deviceId = rawEvent->deviceId;
-            while (batchSize < count) {
-                if (rawEvent[batchSize].type >= EventHubInterface::FIRST_SYNTHETIC_EVENT ||
-                    rawEvent[batchSize].deviceId != deviceId) {
-                    break;
-                }
+            // The events of the devices up to the next synthetic event, which may add or remove
+            // devices.
+            while (batchSize < count &&
+                   rawEvent[batchSize].type < EventHubInterface::FIRST_SYNTHETIC_EVENT) {
                 batchSize += 1;
             }
-            if (debugRawEvents()) {
-                ALOGD("BatchSize: %zu Count: %zu", batchSize, count);
-            }
-            out += processEventsForDeviceLocked(deviceId, rawEvent, batchSize);
+            out += mDeviceProcessingPool ? processDeviceEventsInParallelLocked(rawEvent, batchSize)
+                                         : processDeviceEventsLocked(rawEvent, batchSize);
         } else {
             switch (rawEvent->type) {
                 case EventHubInterface::DEVICE_ADDED:
@@ -231,6 +279,62 @@ std::list<NotifyArgs> InputReader::processEventsLocked(const RawEvent* rawEvents
     return out;
 }
 
+std::list<NotifyArgs> InputReader::processDeviceEventsLocked(const RawEvent* rawEvents,
+                                                             size_t count) {
+    std::list<NotifyArgs> out;
+    for (const RawEvent* rawEvent = rawEvents; count;) {
+        int32_t deviceId = rawEvent->deviceId;
+        size_t batchSize = 1;
+        while (batchSize < count && rawEvent[batchSize].deviceId == deviceId) {
+            batchSize += 1;
+        }
+        if (debugRawEvents()) {
+            ALOGD("BatchSize: %zu Count: %zu", batchSize, count);
+        }
+        out += processEventsForDeviceLocked(deviceId, rawEvent, batchSize);
+        count -= batchSize;
+        rawEvent += batchSize;
+    }
+    return out;
+}
+
+std::list<NotifyArgs> InputReader::processDeviceEventsInParallelLocked(const RawEvent* rawEvents,
+                                                                       size_t count) {
+    // Gather the events of each device processed in parallel, so that they are processed in
+    // order by a single task, and keep the others for the reader thread.
+    std::unordered_map<std::shared_ptr<InputDevice>, std::vector<RawEvent>> parallelEvents;
+    std::vector<RawEvent> events;
+    for (size_t i = 0; i < count; i++) {
+        const auto deviceIt = mDevices.find(rawEvents[i].deviceId);
+        if (deviceIt != mDevices.end() && !deviceIt->second->isIgnored() &&
+            isProcessedInParallel(*deviceIt->second)) {
+            parallelEvents[deviceIt->second].push_back(rawEvents[i]);
+        } else {
+            events.push_back(rawEvents[i]);
+        }
+    }
+    if (parallelEvents.empty()) {
+        return processDeviceEventsLocked(rawEvents, count);
+    }
+
+    // The reader thread holds mLock until the tasks are done, and the devices only access the
+    // reader through its context, which serializes them.
+    std::vector<std::list<NotifyArgs>> parallelOut(parallelEvents.size());
+    auto outIt = parallelOut.begin();
+    for (const auto& [device, deviceEvents] : parallelEvents) {
+        mDeviceProcessingPool->post([&device, &deviceEvents, &out = *outIt++]() {
+            out = device->process(deviceEvents.data(), deviceEvents.size());
+        });
+    }
+    std::list<NotifyArgs> out = processDeviceEventsLocked(events.data(), events.size());
+    mDeviceProcessingPool->waitForIdle();
+
+    for (std::list<NotifyArgs>& deviceOut : parallelOut) {
+        mergeByEventTime(out, std::move(deviceOut));
+    }
+    return out;
+}
+
 void InputReader::addDeviceLocked(nsecs_t when, int32_t eventHubId) {
     if (mDevices.find(eventHubId) != mDevices.end()) {
         ALOGW("Ignoring spurious device added event for eventHubId %d.", eventHubId);
@@ -1018,83 +1122,106 @@ void InputReader::monitor() {
 InputReader::ContextImpl::ContextImpl(InputReader* reader)
       : mReader(reader), mIdGenerator(IdGenerator::Source::INPUT_READER) {}
 
+std::unique_lock<std::recursive_mutex> InputReader::ContextImpl::lockForParallelProcessing() {
+    if (mReader->mDeviceProcessingPool == nullptr) {
+        return {};
+    }
+    return std::unique_lock(mParallelProcessingLock);
+}
+
 void InputReader::ContextImpl::updateGlobalMetaState() {
+    const auto lock = lockForParallelProcessing();
     // lock is already held by the input loop
     mReader->updateGlobalMetaStateLocked();
 }
 
 int32_t InputReader::ContextImpl::getGlobalMetaState() {
+    const auto lock = lockForParallelProcessing();
     // lock is already held by the input loop
     return mReader->getGlobalMetaStateLocked();
 }
 
 void InputReader::ContextImpl::updateLedMetaState(int32_t metaState) {
+    const auto lock = lockForParallelProcessing();
     // lock is already held by the input loop
     mReader->updateLedMetaStateLocked(metaState);
 }
 
 int32_t InputReader::ContextImpl::getLedMetaState() {
+    const auto lock = lockForParallelProcessing();
     // lock is already held by the input loop
     return mReader->getLedMetaStateLocked();
 }
 
 void InputReader::ContextImpl::setPreventingTouchpadTaps(bool prevent) {
+    const auto lock = lockForParallelProcessing();
     // lock is already held by the input loop
     mReader->mPreventingTouchpadTaps = prevent;
 }
 
 bool InputReader::ContextImpl::isPreventingTouchpadTaps() {
+    const auto lock = lockForParallelProcessing();
     // lock is already held by the input loop
     return mReader->mPreventingTouchpadTaps;
 }
 
 void InputReader::ContextImpl::setLastKeyDownTimestamp(nsecs_t when) {
+    const auto lock = lockForParallelProcessing();
     mReader->mLastKeyDownTimestamp = when;
 }
 
 nsecs_t InputReader::ContextImpl::getLastKeyDownTimestamp() {
+    const auto lock = lockForParallelProcessing();
     return mReader->mLastKeyDownTimestamp;
 }
 
 void InputReader::ContextImpl::disableVirtualKeysUntil(nsecs_t time) {
+    const auto lock = lockForParallelProcessing();
     // lock is already held by the input loop
     mReader->disableVirtualKeysUntilLocked(time);
 }
 
 bool InputReader::ContextImpl::shouldDropVirtualKey(nsecs_t now, int32_t keyCode,
                                                     int32_t scanCode) {
+    const auto lock = lockForParallelProcessing();
     // lock is already held by the input loop
     return mReader->shouldDropVirtualKeyLocked(now, keyCode, scanCode);
 }
 
 void InputReader::ContextImpl::fadePointer() {
+    const auto lock = lockForParallelProcessing();
     // lock is already held by the input loop
     mReader->fadePointerLocked();
 }
 
 std::shared_ptr<PointerControllerInterface> InputReader::ContextImpl::getPointerController(
         int32_t deviceId) {
+    const auto lock = lockForParallelProcessing();
     // lock is already held by the input loop
     return mReader->getPointerControllerLocked(deviceId);
 }
 
 void InputReader::ContextImpl::requestTimeoutAtTime(nsecs_t when) {
+    const auto lock = lockForParallelProcessing();
     // lock is already held by the input loop
     mReader->requestTimeoutAtTimeLocked(when);
 }
 
 int32_t InputReader::ContextImpl::bumpGeneration() {
+    const auto lock = lockForParallelProcessing();
     // lock is already held by the input loop
     return mReader->bumpGenerationLocked();
 }
 
 void InputReader::ContextImpl::getExternalStylusDevices(std::vector<InputDeviceInfo>& outDevices) {
+    const auto lock = lockForParallelProcessing();
     // lock is already held by whatever called refreshConfigurationLocked
     mReader->getExternalStylusDevicesLocked(outDevices);
 }
 
 std::list<NotifyArgs> InputReader::ContextImpl::dispatchExternalStylusState(
         const StylusState& state) {
+    const auto lock = lockForParallelProcessing();
     return mReader->dispatchExternalStylusStateLocked(state);
 }
 
@@ -1107,6 +1234,7 @@ EventHubInterface* InputReader::ContextImpl::getEventHub() {
 }
 
 int32_t InputReader::ContextImpl::getNextId() {
+    const auto lock = lockForParallelProcessing();
     return mIdGenerator.nextId();
 }
 
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "InputThread.h"
+
+namespace android {
+
+/**
+ * A small pool of threads on which the reader processes the raw events of some input devices,
+ * while it processes those of the other devices itself.
+ *
+ * The tasks are started in the order they are posted, but may run concurrently, so the tasks of a
+ * device must be posted as one.
+ */
+class DeviceProcessingPool {
+public:
+    explicit DeviceProcessingPool(size_t numThreads);
+    ~DeviceProcessingPool();
+
+    void post(std::function<void()> task) EXCLUDES(mLock);
+
+    // Waits until all the posted tasks have run.
+    void waitForIdle() EXCLUDES(mLock);
+
+private:
+    void threadLoop() EXCLUDES(mLock);
+
+    std::mutex mLock;
+    std::condition_variable mTaskPostedCondition;
+    std::condition_variable mIdleCondition;
+    std::deque<std::function<void()>> mTasks GUARDED_BY(mLock);
+    size_t mNumRunningTasks GUARDED_BY(mLock) = 0;
+    bool mExiting GUARDED_BY(mLock) = false;
+
+    // Last, so that the threads are stopped before the rest of the pool is destroyed.
+    std::vector<std::unique_ptr<InputThread>> mThreads;
+};
+
+} // namespace android
@@ -721,7 +721,7 @@ private:
     void closeDeviceLocked(Device& device) REQUIRES(mLock);
     void closeAllDevicesLocked() REQUIRES(mLock);
 
-    status_t registerFdForEpoll(int fd);
+    status_t registerFdForEpoll(int fd, bool edgeTriggered = false);
     status_t unregisterFdFromEpoll(int fd);
     status_t registerDeviceForEpollLocked(Device& device) REQUIRES(mLock);
     void registerVideoDeviceForEpollLocked(const TouchVideoDevice& videoDevice) REQUIRES(mLock);
@@ -809,6 +809,16 @@ private:
     size_t mPendingEventCount;
     size_t mPendingEventIndex;
     bool mPendingINotify;
+
+    // Whether the devices are polled edge-triggered, in which case a device is read until it has
+    // no more events each time it is reported.
+    const bool mEdgeTriggeredReads;
+
+    // The numbers of times the devices were read, of the events read from them, and of the
+    // wakeups with events to handle, to tell how well the events are batched.
+    size_t mReadCount = 0;
+    size_t mReadEventCount = 0;
+    size_t mWakeupCount = 0;
 };
 
 } // namespace android
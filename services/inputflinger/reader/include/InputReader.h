@@ -22,9 +22,11 @@
 #include <utils/Mutex.h>
 
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
+#include "DeviceProcessingPool.h"
 #include "EventHub.h"
 #include "InputListener.h"
 #include "InputReaderBase.h"
@@ -132,6 +134,13 @@ protected:
     class ContextImpl : public InputReaderContext {
         InputReader* mReader;
         IdGenerator mIdGenerator;
+        // Serializes the calls of the devices processed on the worker threads with those of the
+        // devices processed on the reader thread. Recursive, since dispatching the external stylus
+        // state calls back into the devices.
+        std::recursive_mutex mParallelProcessingLock;
+
+        // Locks mParallelProcessingLock, if the reader processes devices in parallel.
+        std::unique_lock<std::recursive_mutex> lockForParallelProcessing();
 
     public:
         explicit ContextImpl(InputReader* reader);
@@ -204,9 +213,17 @@ private:
     // records timestamp of the last key press on the physical keyboard
     nsecs_t mLastKeyDownTimestamp GUARDED_BY(mLock){0};
 
+    // The threads on which the touchpads are processed in parallel with the other devices, or
+    // nullptr if all the devices are processed on the reader thread.
+    const std::unique_ptr<DeviceProcessingPool> mDeviceProcessingPool;
+
     // low-level input event decoding and device management
     [[nodiscard]] std::list<NotifyArgs> processEventsLocked(const RawEvent* rawEvents, size_t count)
             REQUIRES(mLock);
+    [[nodiscard]] std::list<NotifyArgs> processDeviceEventsLocked(const RawEvent* rawEvents,
+                                                                  size_t count) REQUIRES(mLock);
+    [[nodiscard]] std::list<NotifyArgs> processDeviceEventsInParallelLocked(
+            const RawEvent* rawEvents, size_t count) REQUIRES(mLock);
 
     void addDeviceLocked(nsecs_t when, int32_t eventHubId) REQUIRES(mLock);
     void removeDeviceLocked(nsecs_t when, int32_t eventHubId) REQUIRES(mLock);
@@ -2301,6 +2301,34 @@ void TouchInputMapper::cookPointerData() {
         mCurrentCookedState.buttonState = mCurrentRawState.buttonState;
     }
 
+    // Adjust X,Y coords for device calibration and convert to the natural display coordinates.
+    // Both transforms are affine, so they are combined and applied to all the pointers at once,
+    // in a loop without branches that the compiler vectorizes.
+    ui::Transform calibration;
+    calibration.set(mAffineTransform.x_scale, mAffineTransform.x_ymix, mAffineTransform.y_xmix,
+                    mAffineTransform.y_scale);
+    calibration.set(mAffineTransform.x_offset, mAffineTransform.y_offset);
+    const ui::Transform rawToDisplay = mRawToDisplay * calibration;
+    const float dsdx = rawToDisplay.dsdx();
+    const float dtdx = rawToDisplay.dtdx();
+    const float dtdy = rawToDisplay.dtdy();
+    const float dsdy = rawToDisplay.dsdy();
+    const float tx = rawToDisplay.tx();
+    const float ty = rawToDisplay.ty();
+
+    std::array<float, MAX_POINTERS> displayX;
+    std::array<float, MAX_POINTERS> displayY;
+    for (uint32_t i = 0; i < currentPointerCount; i++) {
+        displayX[i] = mCurrentRawState.rawPointerData.pointers[i].x;
+        displayY[i] = mCurrentRawState.rawPointerData.pointers[i].y;
+    }
+    for (uint32_t i = 0; i < currentPointerCount; i++) {
+        const float x = displayX[i];
+        const float y = displayY[i];
+        displayX[i] = dsdx * x + dtdx * y + tx;
+        displayY[i] = dtdy * x + dsdy * y + ty;
+    }
+
     // Walk through the the active pointers and map device coordinates onto
     // display coordinates and adjust for display orientation.
     for (uint32_t i = 0; i < currentPointerCount; i++) {
@@ -2445,10 +2473,7 @@ void TouchInputMapper::cookPointerData() {
                 distance = 0;
         }
 
-        // Adjust X,Y coords for device calibration and convert to the natural display coordinates.
-        vec2 transformed = {in.x, in.y};
-        mAffineTransform.applyTo(transformed.x /*byRef*/, transformed.y /*byRef*/);
-        transformed = mRawToDisplay.transform(transformed);
+        const vec2 transformed = {displayX[i], displayY[i]};
 
         // Write output coords.
         PointerCoords& out = mCurrentCookedState.cookedPointerData.pointerCoords[i];
@@ -18,7 +18,6 @@
 
 #include <algorithm>
 #include <chrono>
-#include <iterator>
 #include <limits>
 #include <map>
 #include <mutex>
@@ -456,7 +455,7 @@ std::list<NotifyArgs> TouchpadInputMapper::process(const RawEvent* rawEvent) {
     if (mMotionAccumulator.getActiveSlotsCount() == 0) {
         mGestureStartTime = rawEvent->when;
     }
-    std::optional<SelfContainedHardwareState> state = mStateConverter.processRawEvent(rawEvent);
+    SelfContainedHardwareState* state = mStateConverter.processRawEvent(rawEvent);
     if (state) {
         updatePalmDetectionMetrics();
         return sendHardwareState(rawEvent->when, rawEvent->readTime, *state);
@@ -466,33 +465,37 @@ std::list<NotifyArgs> TouchpadInputMapper::process(const RawEvent* rawEvent) {
 }
 
 void TouchpadInputMapper::updatePalmDetectionMetrics() {
-    std::set<int32_t> currentTrackingIds;
+    // The tracking IDs are kept in vectors which are reused on each frame, rather than in sets,
+    // so that the frames do not allocate.
+    mCurrentFrameTrackingIds.clear();
     for (size_t i = 0; i < mMotionAccumulator.getSlotCount(); i++) {
         const MultiTouchMotionAccumulator::Slot& slot = mMotionAccumulator.getSlot(i);
         if (!slot.isInUse()) {
             continue;
         }
-        currentTrackingIds.insert(slot.getTrackingId());
+        mCurrentFrameTrackingIds.push_back(slot.getTrackingId());
         if (slot.getToolType() == ToolType::PALM) {
             mPalmTrackingIds.insert(slot.getTrackingId());
         }
     }
-    std::vector<int32_t> liftedTouches;
-    std::set_difference(mLastFrameTrackingIds.begin(), mLastFrameTrackingIds.end(),
-                        currentTrackingIds.begin(), currentTrackingIds.end(),
-                        std::inserter(liftedTouches, liftedTouches.begin()));
-    for (int32_t trackingId : liftedTouches) {
+    std::sort(mCurrentFrameTrackingIds.begin(), mCurrentFrameTrackingIds.end());
+    for (int32_t trackingId : mLastFrameTrackingIds) {
+        if (std::binary_search(mCurrentFrameTrackingIds.begin(), mCurrentFrameTrackingIds.end(),
+                               trackingId)) {
+            continue;
+        }
+        // The touch was lifted.
         if (mPalmTrackingIds.erase(trackingId) > 0) {
             MetricsAccumulator::getInstance().recordPalm(mMetricsId);
         } else {
             MetricsAccumulator::getInstance().recordFinger(mMetricsId);
         }
     }
-    mLastFrameTrackingIds = currentTrackingIds;
+    std::swap(mLastFrameTrackingIds, mCurrentFrameTrackingIds);
 }
 
 std::list<NotifyArgs> TouchpadInputMapper::sendHardwareState(nsecs_t when, nsecs_t readTime,
-                                                             SelfContainedHardwareState schs) {
+                                                             SelfContainedHardwareState& schs) {
     ALOGD_IF(DEBUG_TOUCHPAD_GESTURES, "New hardware state: %s", schs.state.String().c_str());
     mGestureInterpreter->PushHardwareState(&schs.state);
     return processGestures(when, readTime);
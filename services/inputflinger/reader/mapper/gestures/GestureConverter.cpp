@@ -18,6 +18,7 @@
 
 #include <optional>
 #include <sstream>
+#include <utility>
 
 #include <android-base/stringprintf.h>
 #include <com_android_input_flags.h>
@@ -365,7 +366,7 @@ std::list<NotifyArgs> GestureConverter::handleScroll(nsecs_t when, nsecs_t readT
                                mButtonState, /* pointerCount= */ 1, mFakeFingerCoords.data(),
                                xCursorPosition, yCursorPosition);
         args.flags |= AMOTION_EVENT_FLAG_IS_GENERATED_GESTURE;
-        out.push_back(args);
+        out.push_back(std::move(args));
     }
     float deltaX = gesture.details.scroll.dx;
     float deltaY = gesture.details.scroll.dy;
@@ -381,7 +382,7 @@ std::list<NotifyArgs> GestureConverter::handleScroll(nsecs_t when, nsecs_t readT
                            mButtonState, /* pointerCount= */ 1, mFakeFingerCoords.data(),
                            xCursorPosition, yCursorPosition);
     args.flags |= AMOTION_EVENT_FLAG_IS_GENERATED_GESTURE;
-    out.push_back(args);
+    out.push_back(std::move(args));
     return out;
 }
 
@@ -462,7 +463,7 @@ std::list<NotifyArgs> GestureConverter::endScroll(nsecs_t when, nsecs_t readTime
                            mButtonState, /* pointerCount= */ 1, mFakeFingerCoords.data(),
                            xCursorPosition, yCursorPosition);
     args.flags |= AMOTION_EVENT_FLAG_IS_GENERATED_GESTURE;
-    out.push_back(args);
+    out.push_back(std::move(args));
     mCurrentClassification = MotionClassification::NONE;
     out += enterHover(when, readTime, xCursorPosition, yCursorPosition);
     return out;
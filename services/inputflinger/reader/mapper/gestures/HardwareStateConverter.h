@@ -16,8 +16,8 @@
 
 #pragma once
 
-#include <optional>
 #include <set>
+#include <vector>
 
 #include <utils/Timers.h>
 
@@ -44,17 +44,21 @@ public:
     HardwareStateConverter(const InputDeviceContext& deviceContext,
                            MultiTouchMotionAccumulator& motionAccumulator);
 
-    std::optional<SelfContainedHardwareState> processRawEvent(const RawEvent* event);
+    // Returns the state of the touchpad when the event completes a sync, or nullptr otherwise. The
+    // state is kept by the converter, so that its fingers are not allocated each sync, and is only
+    // valid until the next event is processed.
+    SelfContainedHardwareState* processRawEvent(const RawEvent* event);
     void reset();
 
 private:
-    SelfContainedHardwareState produceHardwareState(nsecs_t when);
+    void produceHardwareState(nsecs_t when);
 
     const InputDeviceContext& mDeviceContext;
     CursorButtonAccumulator mCursorButtonAccumulator;
     MultiTouchMotionAccumulator& mMotionAccumulator;
     TouchButtonAccumulator mTouchButtonAccumulator;
     int32_t mMscTimestamp = 0;
+    SelfContainedHardwareState mState = {};
 };
 
 } // namespace android
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DeviceProcessingPool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace android {
+
+using namespace std::chrono_literals;
+
+TEST(DeviceProcessingPoolTest, RunsAllThePostedTasks) {
+    DeviceProcessingPool pool(/*numThreads=*/2);
+    std::atomic<int> numRunTasks = 0;
+    for (int i = 0; i < 10; i++) {
+        pool.post([&]() { numRunTasks++; });
+    }
+    pool.waitForIdle();
+    EXPECT_EQ(10, numRunTasks);
+}
+
+TEST(DeviceProcessingPoolTest, WaitsForTheRunningTasks) {
+    DeviceProcessingPool pool(/*numThreads=*/1);
+    std::atomic<bool> done = false;
+    pool.post([&]() {
+        std::this_thread::sleep_for(20ms);
+        done = true;
+    });
+    pool.waitForIdle();
+    EXPECT_TRUE(done);
+}
+
+TEST(DeviceProcessingPoolTest, RunsTasksConcurrently) {
+    DeviceProcessingPool pool(/*numThreads=*/2);
+    // Each task waits for the other to start, which only completes if they run concurrently.
+    std::atomic<int> numStartedTasks = 0;
+    std::atomic<int> numConcurrentTasks = 0;
+    for (int i = 0; i < 2; i++) {
+        pool.post([&]() {
+            numStartedTasks++;
+            const auto deadline = std::chrono::steady_clock::now() + 5s;
+            while (numStartedTasks < 2 && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+            if (numStartedTasks == 2) {
+                numConcurrentTasks++;
+            }
+        });
+    }
+    pool.waitForIdle();
+    EXPECT_EQ(2, numConcurrentTasks);
+}
+
+TEST(DeviceProcessingPoolTest, WaitingForIdleWithoutTasksReturns) {
+    DeviceProcessingPool pool(/*numThreads=*/1);
+    pool.waitForIdle();
+}
+
+} // namespace android
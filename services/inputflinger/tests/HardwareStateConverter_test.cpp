@@ -81,11 +81,11 @@ protected:
         event.type = type;
         event.code = code;
         event.value = value;
-        std::optional<SelfContainedHardwareState> schs = mConverter->processRawEvent(&event);
-        EXPECT_FALSE(schs.has_value());
+        const SelfContainedHardwareState* schs = mConverter->processRawEvent(&event);
+        EXPECT_EQ(nullptr, schs);
     }
 
-    std::optional<SelfContainedHardwareState> processSync(nsecs_t when) {
+    const SelfContainedHardwareState* processSync(nsecs_t when) {
         RawEvent event;
         event.when = when;
         event.readTime = READ_TIME;
@@ -124,9 +124,9 @@ TEST_F(HardwareStateConverterTest, OneFinger) {
 
     processAxis(time, EV_KEY, BTN_TOUCH, 1);
     processAxis(time, EV_KEY, BTN_TOOL_FINGER, 1);
-    std::optional<SelfContainedHardwareState> schs = processSync(time);
+    const SelfContainedHardwareState* schs = processSync(time);
 
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     const HardwareState& state = schs->state;
     EXPECT_NEAR(1.5, state.timestamp, EPSILON);
     EXPECT_EQ(0, state.buttons_down);
@@ -176,9 +176,9 @@ TEST_F(HardwareStateConverterTest, TwoFingers) {
 
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOUCH, 1);
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOOL_DOUBLETAP, 1);
-    std::optional<SelfContainedHardwareState> schs = processSync(ARBITRARY_TIME);
+    const SelfContainedHardwareState* schs = processSync(ARBITRARY_TIME);
 
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     ASSERT_EQ(2, schs->state.finger_cnt);
     const FingerState& finger1 = schs->state.fingers[0];
     EXPECT_EQ(123, finger1.tracking_id);
@@ -211,8 +211,8 @@ TEST_F_WITH_FLAGS(HardwareStateConverterTest, OnePalmDisableReportPalms,
 
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOUCH, 1);
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOOL_FINGER, 1);
-    std::optional<SelfContainedHardwareState> schs = processSync(ARBITRARY_TIME);
-    ASSERT_TRUE(schs.has_value());
+    const SelfContainedHardwareState* schs = processSync(ARBITRARY_TIME);
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(0, schs->state.touch_cnt);
     EXPECT_EQ(0, schs->state.finger_cnt);
 }
@@ -227,8 +227,8 @@ TEST_F_WITH_FLAGS(HardwareStateConverterTest, OnePalmEnableReportPalms,
 
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOUCH, 1);
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOOL_FINGER, 1);
-    std::optional<SelfContainedHardwareState> schs = processSync(ARBITRARY_TIME);
-    ASSERT_TRUE(schs.has_value());
+    const SelfContainedHardwareState* schs = processSync(ARBITRARY_TIME);
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(1, schs->state.touch_cnt);
     EXPECT_EQ(1, schs->state.finger_cnt);
     EXPECT_EQ(FingerState::ToolType::kPalm, schs->state.fingers[0].tool_type);
@@ -245,8 +245,8 @@ TEST_F_WITH_FLAGS(HardwareStateConverterTest, OneFingerTurningIntoAPalmDisableRe
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOUCH, 1);
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOOL_FINGER, 1);
 
-    std::optional<SelfContainedHardwareState> schs = processSync(ARBITRARY_TIME);
-    ASSERT_TRUE(schs.has_value());
+    const SelfContainedHardwareState* schs = processSync(ARBITRARY_TIME);
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(1, schs->state.touch_cnt);
     EXPECT_EQ(1, schs->state.finger_cnt);
 
@@ -255,7 +255,7 @@ TEST_F_WITH_FLAGS(HardwareStateConverterTest, OneFingerTurningIntoAPalmDisableRe
     processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_Y, 99);
 
     schs = processSync(ARBITRARY_TIME);
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(0, schs->state.touch_cnt);
     ASSERT_EQ(0, schs->state.finger_cnt);
 
@@ -263,7 +263,7 @@ TEST_F_WITH_FLAGS(HardwareStateConverterTest, OneFingerTurningIntoAPalmDisableRe
     processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_Y, 97);
 
     schs = processSync(ARBITRARY_TIME);
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(0, schs->state.touch_cnt);
     EXPECT_EQ(0, schs->state.finger_cnt);
 
@@ -271,7 +271,7 @@ TEST_F_WITH_FLAGS(HardwareStateConverterTest, OneFingerTurningIntoAPalmDisableRe
     processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_X, 55);
     processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_Y, 95);
     schs = processSync(ARBITRARY_TIME);
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(1, schs->state.touch_cnt);
     ASSERT_EQ(1, schs->state.finger_cnt);
     const FingerState& newFinger = schs->state.fingers[0];
@@ -291,8 +291,8 @@ TEST_F_WITH_FLAGS(HardwareStateConverterTest, OneFingerTurningIntoAPalmEnableRep
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOUCH, 1);
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOOL_FINGER, 1);
 
-    std::optional<SelfContainedHardwareState> schs = processSync(ARBITRARY_TIME);
-    ASSERT_TRUE(schs.has_value());
+    const SelfContainedHardwareState* schs = processSync(ARBITRARY_TIME);
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(1, schs->state.touch_cnt);
     EXPECT_EQ(1, schs->state.finger_cnt);
     EXPECT_EQ(FingerState::ToolType::kFinger, schs->state.fingers[0].tool_type);
@@ -302,7 +302,7 @@ TEST_F_WITH_FLAGS(HardwareStateConverterTest, OneFingerTurningIntoAPalmEnableRep
     processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_Y, 99);
 
     schs = processSync(ARBITRARY_TIME);
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(1, schs->state.touch_cnt);
     ASSERT_EQ(1, schs->state.finger_cnt);
     EXPECT_EQ(FingerState::ToolType::kPalm, schs->state.fingers[0].tool_type);
@@ -311,7 +311,7 @@ TEST_F_WITH_FLAGS(HardwareStateConverterTest, OneFingerTurningIntoAPalmEnableRep
     processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_Y, 97);
 
     schs = processSync(ARBITRARY_TIME);
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(1, schs->state.touch_cnt);
     EXPECT_EQ(1, schs->state.finger_cnt);
     EXPECT_EQ(FingerState::ToolType::kPalm, schs->state.fingers[0].tool_type);
@@ -320,7 +320,7 @@ TEST_F_WITH_FLAGS(HardwareStateConverterTest, OneFingerTurningIntoAPalmEnableRep
     processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_X, 55);
     processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_Y, 95);
     schs = processSync(ARBITRARY_TIME);
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(1, schs->state.touch_cnt);
     ASSERT_EQ(1, schs->state.finger_cnt);
     const FingerState& newFinger = schs->state.fingers[0];
@@ -332,18 +332,42 @@ TEST_F_WITH_FLAGS(HardwareStateConverterTest, OneFingerTurningIntoAPalmEnableRep
 
 TEST_F(HardwareStateConverterTest, ButtonPressed) {
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_LEFT, 1);
-    std::optional<SelfContainedHardwareState> schs = processSync(ARBITRARY_TIME);
+    const SelfContainedHardwareState* schs = processSync(ARBITRARY_TIME);
 
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(GESTURES_BUTTON_LEFT, schs->state.buttons_down);
 }
 
 TEST_F(HardwareStateConverterTest, MscTimestamp) {
     processAxis(ARBITRARY_TIME, EV_MSC, MSC_TIMESTAMP, 1200000);
-    std::optional<SelfContainedHardwareState> schs = processSync(ARBITRARY_TIME);
+    const SelfContainedHardwareState* schs = processSync(ARBITRARY_TIME);
 
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     EXPECT_NEAR(1.2, schs->state.msc_timestamp, EPSILON);
 }
 
+TEST_F(HardwareStateConverterTest, FingersAreReusedAcrossSyncs) {
+    processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_SLOT, 0);
+    processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_TRACKING_ID, 123);
+    processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_X, 50);
+    processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOUCH, 1);
+    processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOOL_FINGER, 1);
+    const SelfContainedHardwareState* schs = processSync(ARBITRARY_TIME);
+    ASSERT_NE(nullptr, schs);
+    const FingerState* fingers = schs->state.fingers;
+
+    processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_SLOT, 1);
+    processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_TRACKING_ID, 456);
+    processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_X, 150);
+    processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOOL_FINGER, 0);
+    processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOOL_DOUBLETAP, 1);
+    schs = processSync(ARBITRARY_TIME);
+    ASSERT_NE(nullptr, schs);
+    ASSERT_EQ(2, schs->state.finger_cnt);
+    // The fingers were stored in the same memory, which was reserved for all of the slots.
+    EXPECT_EQ(fingers, schs->state.fingers);
+    EXPECT_EQ(123, schs->state.fingers[0].tracking_id);
+    EXPECT_EQ(456, schs->state.fingers[1].tracking_id);
+}
+
 } // namespace android
@@ -232,6 +232,26 @@ TEST_F(InputDeviceMetricsCollectorTest, RemovingDeviceEndsUsageSession) {
     ASSERT_NO_FATAL_FAILURE(assertUsageLogged(TOUCHSCREEN_STYLUS_INFO, 21ns));
 }
 
+TEST_F(InputDeviceMetricsCollectorTest, LogsExpiredUsageSessionOnAnyNotification) {
+    mMetricsCollector.notifyInputDevicesChanged(
+            {/*id=*/0, {TOUCHSCREEN_STYLUS_INFO, SECOND_TOUCHSCREEN_STYLUS_INFO}});
+
+    // Device 1 was used, then Device 2 started a usage session that expires later.
+    mMetricsCollector.notifyMotion(generateMotionArgs(DEVICE_ID));
+    setCurrentTime(TIME + 100ns);
+    mMetricsCollector.notifyMotion(generateMotionArgs(DEVICE_ID_2));
+    setCurrentTime(TIME + 100ns + USAGE_TIMEOUT - 1ns);
+    mMetricsCollector.notifyConfigurationChanged({/*id=*/0, currentTime()});
+    ASSERT_NO_FATAL_FAILURE(assertUsageLogged(TOUCHSCREEN_STYLUS_INFO, 0ns));
+    ASSERT_NO_FATAL_FAILURE(assertUsageNotLogged());
+
+    // Device 2's session expires without any further usage of a device.
+    setCurrentTime(TIME + 100ns + USAGE_TIMEOUT);
+    mMetricsCollector.notifyConfigurationChanged({/*id=*/0, currentTime()});
+    ASSERT_NO_FATAL_FAILURE(assertUsageLogged(SECOND_TOUCHSCREEN_STYLUS_INFO, 0ns));
+    ASSERT_NO_FATAL_FAILURE(assertUsageNotLogged());
+}
+
 TEST_F(InputDeviceMetricsCollectorTest, TracksUsageFromDifferentDevicesIndependently) {
     mMetricsCollector.notifyInputDevicesChanged(
             {/*id=*/0, {TOUCHSCREEN_STYLUS_INFO, SECOND_TOUCHSCREEN_STYLUS_INFO}});
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../dispatcher/LatencyHistogram.h"
+
+#include <gtest/gtest.h>
+
+// atest inputflinger_tests:LatencyHistogramTest
+
+namespace android::inputdispatcher {
+
+TEST(LatencyHistogramTest, EmptyHistogramHasNoLatency) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(0u, histogram.count());
+    EXPECT_EQ(0, histogram.quantile(0.5));
+}
+
+TEST(LatencyHistogramTest, QuantilesAreTheUpperBoundsOfTheirBuckets) {
+    LatencyHistogram histogram;
+    // The buckets are a microsecond wide below 8us.
+    for (int i = 0; i < 5; i++) {
+        histogram.add(us2ns(i));
+    }
+    EXPECT_EQ(5u, histogram.count());
+    EXPECT_EQ(us2ns(1), histogram.quantile(0));
+    EXPECT_EQ(us2ns(3), histogram.quantile(0.5));
+    EXPECT_EQ(us2ns(5), histogram.quantile(1));
+}
+
+TEST(LatencyHistogramTest, QuantilesAreWithinTheRelativePrecision) {
+    LatencyHistogram histogram;
+    for (nsecs_t latency = us2ns(100); latency <= ms2ns(100); latency += us2ns(100)) {
+        histogram.add(latency);
+    }
+    EXPECT_EQ(1000u, histogram.count());
+    const nsecs_t p50 = histogram.quantile(0.5);
+    EXPECT_GE(p50, ms2ns(50));
+    EXPECT_LE(p50, ms2ns(50) * 1.125);
+    const nsecs_t p99 = histogram.quantile(0.99);
+    EXPECT_GE(p99, ms2ns(99));
+    EXPECT_LE(p99, ms2ns(99) * 1.125);
+}
+
+TEST(LatencyHistogramTest, ClampsLatencies) {
+    LatencyHistogram histogram;
+    histogram.add(-1);
+    EXPECT_EQ(us2ns(1), histogram.quantile(1));
+    histogram.add(s2ns(100'000));
+    EXPECT_EQ(2u, histogram.count());
+    EXPECT_GT(histogram.quantile(1), s2ns(1000));
+}
+
+TEST(LatencyHistogramTest, Reset) {
+    LatencyHistogram histogram;
+    histogram.add(ms2ns(10));
+    histogram.reset();
+    EXPECT_EQ(0u, histogram.count());
+    EXPECT_EQ(0, histogram.quantile(1));
+}
+
+} // namespace android::inputdispatcher
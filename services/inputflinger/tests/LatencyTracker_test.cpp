@@ -236,6 +236,38 @@ TEST_F(LatencyTrackerTest, WhenDuplicateEventsAreReported_DoesNotCrash) {
     assertReceivedTimelines({});
 }
 
+/**
+ * The tracker counts the events it tracks, drops and reports in the shared memory counters.
+ */
+TEST_F(LatencyTrackerTest, SharedCounters_CountTrackedDuplicateAndReportedEvents) {
+    auto& registry = perfcounters::Registry::getInstance();
+    const perfcounters::Counter tracked =
+            registry.getCounter("inputflinger.latency.tracked_events");
+    const perfcounters::Counter duplicates =
+            registry.getCounter("inputflinger.latency.duplicate_events");
+    const perfcounters::Counter reported =
+            registry.getCounter("inputflinger.latency.reported_timelines");
+    const uint64_t trackedBefore = tracked.get();
+    const uint64_t duplicatesBefore = duplicates.get();
+    const uint64_t reportedBefore = reported.get();
+
+    mTracker->trackListener(/*inputEventId=*/2, /*isDown=*/true, /*eventTime=*/1,
+                            /*readTime=*/3, DEVICE_ID, {InputDeviceUsageSource::UNKNOWN});
+    mTracker->trackListener(/*inputEventId=*/3, /*isDown=*/true, /*eventTime=*/1,
+                            /*readTime=*/3, DEVICE_ID, {InputDeviceUsageSource::UNKNOWN});
+    mTracker->trackListener(/*inputEventId=*/3, /*isDown=*/true, /*eventTime=*/2,
+                            /*readTime=*/3, DEVICE_ID, {InputDeviceUsageSource::UNKNOWN});
+    triggerEventReporting(/*eventTime=*/2);
+
+    // The event which triggers the reporting is tracked too.
+    EXPECT_EQ(trackedBefore + 3, tracked.get());
+    EXPECT_EQ(duplicatesBefore + 1, duplicates.get());
+    EXPECT_EQ(reportedBefore + 1, reported.get());
+    assertReceivedTimelines({InputEventTimeline{/*isDown=*/true, /*eventTime=*/1,
+                                                /*readTime=*/3, /*vendorId=*/0, /*productID=*/0,
+                                                /*sources=*/{InputDeviceUsageSource::UNKNOWN}}});
+}
+
 TEST_F(LatencyTrackerTest, MultipleEvents_AreReportedConsistently) {
     constexpr int32_t inputEventId1 = 1;
     InputEventTimeline timeline1(
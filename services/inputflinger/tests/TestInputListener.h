@@ -91,6 +91,7 @@ private:
 
     virtual void notifyKey(const NotifyKeyArgs& args) override;
 
+    using InputListenerInterface::notifyMotion;
     virtual void notifyMotion(const NotifyMotionArgs& args) override;
 
     virtual void notifySwitch(const NotifySwitchArgs& args) override;
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../dispatcher/WindowHitIndex.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+// atest inputflinger_tests:WindowHitIndexTest
+
+using android::gui::WindowInfo;
+using android::gui::WindowInfoHandle;
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+namespace android::inputdispatcher {
+
+namespace {
+
+sp<WindowInfoHandle> makeWindow(const Region& touchableRegion) {
+    WindowInfo info;
+    info.touchableRegion = touchableRegion;
+    return sp<WindowInfoHandle>::make(info);
+}
+
+std::vector<uint32_t> getCandidates(const WindowHitIndex& index, float x, float y) {
+    const std::span<const uint32_t> candidates = index.getCandidates(x, y);
+    return {candidates.begin(), candidates.end()};
+}
+
+} // namespace
+
+TEST(WindowHitIndexTest, EmptyIndexHasNoCandidates) {
+    EXPECT_THAT(getCandidates(WindowHitIndex(), 0, 0), IsEmpty());
+    EXPECT_THAT(getCandidates(WindowHitIndex({makeWindow(Region())}, ui::Transform()), 0, 0),
+                IsEmpty());
+}
+
+TEST(WindowHitIndexTest, ReturnsWindowsWhoseBoundsContainThePointFromFrontToBack) {
+    const std::vector<sp<WindowInfoHandle>> windows = {
+            makeWindow(Region(Rect(0, 0, 100, 100))),
+            makeWindow(Region(Rect(900, 900, 1000, 1000))),
+            makeWindow(Region(Rect(0, 0, 1000, 1000))),
+            makeWindow(Region(Rect(50, 50, 150, 150))),
+    };
+    const WindowHitIndex index(windows, ui::Transform());
+
+    EXPECT_THAT(getCandidates(index, 10, 10), ElementsAre(0, 2));
+    EXPECT_THAT(getCandidates(index, 75, 75), ElementsAre(0, 2, 3));
+    EXPECT_THAT(getCandidates(index, 950, 950), ElementsAre(1, 2));
+    EXPECT_THAT(getCandidates(index, 500, 500), ElementsAre(2));
+
+    // The right and bottom edges are outside of the windows, as in the dispatcher.
+    EXPECT_THAT(getCandidates(index, 999.5f, 999.5f), ElementsAre(1, 2));
+    EXPECT_THAT(getCandidates(index, 1000, 500), IsEmpty());
+    EXPECT_THAT(getCandidates(index, -0.5f, 500), IsEmpty());
+}
+
+TEST(WindowHitIndexTest, IndexesTheBoundsOfTheWholeRegion) {
+    Region region(Rect(0, 0, 10, 10));
+    region.orSelf(Rect(990, 990, 1000, 1000));
+    const WindowHitIndex index({makeWindow(region)}, ui::Transform());
+
+    // The candidates are found from the bounds, the dispatcher still hit tests the region.
+    EXPECT_THAT(getCandidates(index, 5, 5), ElementsAre(0));
+    EXPECT_THAT(getCandidates(index, 995, 995), ElementsAre(0));
+}
+
+TEST(WindowHitIndexTest, CandidatesIncludeTheWindowsTouchedInTheLogicalDisplaySpace) {
+    // A display rotated by 90 degrees, as the dispatcher hit tests its windows.
+    const ui::Transform displayTransform(ui::Transform::ROT_90, /*w=*/100, /*h=*/200);
+    const std::vector<sp<WindowInfoHandle>> windows = {
+            makeWindow(Region(Rect(0, 0, 10, 10))),
+            makeWindow(Region(Rect(40, 150, 60, 200))),
+            makeWindow(Region(Rect(0, 0, 100, 200))),
+    };
+    const WindowHitIndex index(windows, displayTransform);
+
+    for (float x = -5.5f; x < 110; x += 5) {
+        for (float y = -5.5f; y < 210; y += 5) {
+            const vec2 p = displayTransform.transform(x, y);
+            const std::vector<uint32_t> candidates = getCandidates(index, x, y);
+            for (uint32_t i = 0; i < windows.size(); i++) {
+                const Region touchableRegion =
+                        displayTransform.transform(windows[i]->getInfo()->touchableRegion);
+                if (touchableRegion.contains(std::floor(p.x), std::floor(p.y))) {
+                    EXPECT_THAT(candidates, testing::Contains(i)) << "at " << x << ", " << y;
+                }
+            }
+        }
+    }
+}
+
+TEST(WindowHitIndexTest, ClampsUnboundedRegions) {
+    const WindowHitIndex index({makeWindow(Region(Rect(INT32_MIN / 2, INT32_MIN / 2, INT32_MAX / 2,
+                                                       INT32_MAX / 2)))},
+                               ui::Transform());
+
+    EXPECT_THAT(getCandidates(index, 0, 0), ElementsAre(0));
+    EXPECT_THAT(getCandidates(index, 4000, -4000), ElementsAre(0));
+}
+
+} // namespace android::inputdispatcher
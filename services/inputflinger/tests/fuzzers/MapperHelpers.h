@@ -335,6 +335,7 @@ public:
     void notifyInputDevicesChanged(const NotifyInputDevicesChangedArgs& args) override {}
     void notifyConfigurationChanged(const NotifyConfigurationChangedArgs& args) override {}
     void notifyKey(const NotifyKeyArgs& args) override {}
+    using InputListenerInterface::notifyMotion;
     void notifyMotion(const NotifyMotionArgs& args) override {}
     void notifySwitch(const NotifySwitchArgs& args) override {}
     void notifySensor(const NotifySensorArgs& args) override{};
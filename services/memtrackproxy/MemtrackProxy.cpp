@@ -16,10 +16,20 @@
 
 #include "MemtrackProxy.h"
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
+#include <android-base/stringprintf.h>
 #include <android/binder_manager.h>
+#include <inttypes.h>
+#include <poll.h>
 #include <private/android_filesystem_config.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
+#include <algorithm>
+
+using ::android::base::StringAppendF;
+using ::android::base::unique_fd;
 using ::android::hardware::hidl_vec;
 using ::android::hardware::Return;
 
@@ -97,6 +107,22 @@ bool MemtrackProxy::CheckPid(pid_t calling_pid, pid_t request_pid) {
     return calling_pid == request_pid;
 }
 
+bool MemtrackProxy::IsSupportedType(MemtrackType type) {
+    return type == MemtrackType::OTHER || type == MemtrackType::GL ||
+            type == MemtrackType::GRAPHICS || type == MemtrackType::MULTIMEDIA ||
+            type == MemtrackType::CAMERA;
+}
+
+static unique_fd OpenPidfd(int pid) {
+    return unique_fd(static_cast<int>(syscall(__NR_pidfd_open, pid, 0)));
+}
+
+// A pidfd becomes readable once its process exits.
+static bool HasExited(const unique_fd& pidfd) {
+    pollfd pfd = {.fd = pidfd.get(), .events = POLLIN, .revents = 0};
+    return TEMP_FAILURE_RETRY(poll(&pfd, 1, 0)) != 0;
+}
+
 MemtrackProxy::MemtrackProxy() {
     memtrack_aidl_instance_ = MemtrackProxy::MemtrackAidlInstance();
 
@@ -120,12 +146,118 @@ ndk::ScopedAStatus MemtrackProxy::getMemory(int pid, MemtrackType type,
                 "than the calling PID");
     }
 
-    if (type != MemtrackType::OTHER && type != MemtrackType::GL && type != MemtrackType::GRAPHICS &&
-        type != MemtrackType::MULTIMEDIA && type != MemtrackType::CAMERA) {
+    if (!MemtrackProxy::IsSupportedType(type)) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    }
+
+    return getMemoryCached(pid, type, _aidl_return);
+}
+
+ndk::ScopedAStatus MemtrackProxy::getMemoryForPids(
+        const std::vector<int>& pids, MemtrackType type,
+        std::vector<std::vector<MemtrackRecord>>* _aidl_return) {
+    const bool trusted_uid = MemtrackProxy::CheckUid(AIBinder_getCallingUid());
+    const pid_t calling_pid = AIBinder_getCallingPid();
+    for (int pid : pids) {
+        if (pid < 0) {
+            return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+        }
+        if (!trusted_uid && !MemtrackProxy::CheckPid(calling_pid, pid)) {
+            return ndk::ScopedAStatus::fromExceptionCodeWithMessage(
+                    EX_SECURITY,
+                    "Only AID_ROOT, AID_SYSTEM and AID_SHELL can request getMemory() for PIDs "
+                    "other than the calling PID");
+        }
+    }
+
+    if (!MemtrackProxy::IsSupportedType(type)) {
         return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
     }
 
     _aidl_return->clear();
+    _aidl_return->resize(pids.size());
+    std::unordered_map<int, size_t> first_indices;
+    for (size_t i = 0; i < pids.size(); i++) {
+        const auto [first, inserted] = first_indices.try_emplace(pids[i], i);
+        if (!inserted) {
+            (*_aidl_return)[i] = (*_aidl_return)[first->second];
+            continue;
+        }
+        ndk::ScopedAStatus status = getMemoryCached(pids[i], type, &(*_aidl_return)[i]);
+        if (!status.isOk()) {
+            return status;
+        }
+    }
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus MemtrackProxy::getMemoryCached(int pid, MemtrackType type,
+                                                  std::vector<MemtrackRecord>* _aidl_return) {
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        if (auto process = cache_.find(pid); process != cache_.end()) {
+            if (HasExited(process->second.pidfd)) {
+                // The pid may be reused by a new process already.
+                cache_.erase(process);
+            } else if (auto entry = process->second.entries.find(type);
+                       entry != process->second.entries.end() &&
+                       now - entry->second.time < kCacheTtl) {
+                *_aidl_return = entry->second.records;
+                stats_.cache_hits++;
+                return ndk::ScopedAStatus::ok();
+            }
+        }
+        stats_.cache_misses++;
+    }
+
+    // Open the pidfd before querying the HAL, so that the records are not cached for a process
+    // which reused the pid of one which died in the meantime.
+    unique_fd pidfd = OpenPidfd(pid);
+
+    ndk::ScopedAStatus status = getMemoryFromHal(pid, type, _aidl_return);
+    const auto latency = std::chrono::steady_clock::now() - now;
+
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    stats_.hal_calls++;
+    stats_.hal_latency_total += latency;
+    stats_.hal_latency_max = std::max<std::chrono::nanoseconds>(stats_.hal_latency_max, latency);
+    if (!status.isOk()) {
+        stats_.hal_failures++;
+        return status;
+    }
+    if (!pidfd.ok() || HasExited(pidfd)) {
+        // Without a pidfd the death of the process cannot be told, so its records are not cached.
+        return status;
+    }
+
+    now += latency;
+    pruneCacheLocked(now);
+    ProcessCache& process = cache_[pid];
+    if (!process.pidfd.ok() || HasExited(process.pidfd)) {
+        process.pidfd = std::move(pidfd);
+        process.entries.clear();
+    }
+    process.entries[type] = {*_aidl_return, now};
+    return status;
+}
+
+void MemtrackProxy::pruneCacheLocked(std::chrono::steady_clock::time_point now) {
+    if (now - last_prune_time_ < kCacheTtl) {
+        return;
+    }
+    last_prune_time_ = now;
+    for (auto process = cache_.begin(); process != cache_.end();) {
+        auto& entries = process->second.entries;
+        std::erase_if(entries,
+                      [now](const auto& entry) { return now - entry.second.time >= kCacheTtl; });
+        process = entries.empty() ? cache_.erase(process) : std::next(process);
+    }
+}
+
+ndk::ScopedAStatus MemtrackProxy::getMemoryFromHal(int pid, MemtrackType type,
+                                                   std::vector<MemtrackRecord>* _aidl_return) {
+    _aidl_return->clear();
 
     if (memtrack_aidl_instance_) {
         return memtrack_aidl_instance_->getMemory(pid, type, _aidl_return);
@@ -193,6 +325,31 @@ ndk::ScopedAStatus MemtrackProxy::getGpuDeviceInfo(std::vector<DeviceInfo>* _aid
                                                             "Memtrack HAL service not available");
 }
 
+binder_status_t MemtrackProxy::dump(int fd, const char** /* args */, uint32_t /* num_args */) {
+    if (!MemtrackProxy::CheckUid(AIBinder_getCallingUid())) {
+        return STATUS_PERMISSION_DENIED;
+    }
+
+    std::string result = "MemtrackProxy:\n";
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        StringAppendF(&result, "  HAL: %s\n",
+                      memtrack_aidl_instance_ ? "AIDL"
+                                              : (memtrack_hidl_instance_ ? "HIDL" : "none"));
+        StringAppendF(&result, "  Cache: %zu processes, %" PRIu64 " hits, %" PRIu64 " misses\n",
+                      cache_.size(), stats_.cache_hits, stats_.cache_misses);
+        const auto average = stats_.hal_calls > 0 ? stats_.hal_latency_total / stats_.hal_calls
+                                                  : std::chrono::nanoseconds(0);
+        StringAppendF(&result,
+                      "  HAL calls: %" PRIu64 " (%" PRIu64 " failed), latency avg %.3f ms, "
+                      "max %.3f ms\n",
+                      stats_.hal_calls, stats_.hal_failures,
+                      std::chrono::duration<double, std::milli>(average).count(),
+                      std::chrono::duration<double, std::milli>(stats_.hal_latency_max).count());
+    }
+    return ::android::base::WriteStringToFd(result, fd) ? STATUS_OK : STATUS_UNKNOWN_ERROR;
+}
+
 } // namespace memtrack
 } // namespace hardware
 } // namespace android
@@ -21,8 +21,15 @@
 #include <aidl/android/hardware/memtrack/IMemtrack.h>
 #include <aidl/android/hardware/memtrack/MemtrackRecord.h>
 #include <aidl/android/hardware/memtrack/MemtrackType.h>
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
 #include <android/hardware/memtrack/1.0/IMemtrack.h>
 
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
 using ::android::sp;
 
 namespace V1_0_hidl = ::android::hardware::memtrack::V1_0;
@@ -38,19 +45,62 @@ __attribute__((warn_unused_result)) bool translate(const V1_0_hidl::MemtrackReco
 
 class MemtrackProxy : public BnMemtrack {
 public:
+    // How long the records of a process are served from the cache. Memory accounting queries all
+    // of the processes for all of the types at once, so this only needs to cover one snapshot.
+    static constexpr std::chrono::milliseconds kCacheTtl{250};
+
     MemtrackProxy();
     ndk::ScopedAStatus getMemory(int pid, MemtrackType type,
                                  std::vector<MemtrackRecord>* _aidl_return) override;
     ndk::ScopedAStatus getGpuDeviceInfo(std::vector<DeviceInfo>* _aidl_return) override;
 
+    // Same as getMemory() for each of the pids, with the records in the order of the pids. The
+    // permission and type checks are done once for the whole batch, and repeated pids are only
+    // queried once.
+    ndk::ScopedAStatus getMemoryForPids(const std::vector<int>& pids, MemtrackType type,
+                                        std::vector<std::vector<MemtrackRecord>>* _aidl_return);
+
+    binder_status_t dump(int fd, const char** args, uint32_t num_args) override;
+
 private:
+    // Cached records of a process, which are dropped once the process dies.
+    struct ProcessCache {
+        ::android::base::unique_fd pidfd;
+        struct Entry {
+            std::vector<MemtrackRecord> records;
+            std::chrono::steady_clock::time_point time;
+        };
+        std::map<MemtrackType, Entry> entries;
+    };
+
+    struct Stats {
+        uint64_t cache_hits = 0;
+        uint64_t cache_misses = 0;
+        uint64_t hal_calls = 0;
+        uint64_t hal_failures = 0;
+        std::chrono::nanoseconds hal_latency_total{0};
+        std::chrono::nanoseconds hal_latency_max{0};
+    };
+
     static sp<V1_0_hidl::IMemtrack> MemtrackHidlInstance();
     static std::shared_ptr<V1_aidl::IMemtrack> MemtrackAidlInstance();
     static bool CheckUid(uid_t calling_uid);
     static bool CheckPid(pid_t calling_pid, pid_t request_pid);
+    static bool IsSupportedType(MemtrackType type);
+
+    ndk::ScopedAStatus getMemoryCached(int pid, MemtrackType type,
+                                       std::vector<MemtrackRecord>* _aidl_return);
+    ndk::ScopedAStatus getMemoryFromHal(int pid, MemtrackType type,
+                                        std::vector<MemtrackRecord>* _aidl_return);
+    void pruneCacheLocked(std::chrono::steady_clock::time_point now) REQUIRES(cache_mutex_);
 
     sp<V1_0_hidl::IMemtrack> memtrack_hidl_instance_;
     std::shared_ptr<V1_aidl::IMemtrack> memtrack_aidl_instance_;
+
+    std::mutex cache_mutex_;
+    std::unordered_map<int, ProcessCache> cache_ GUARDED_BY(cache_mutex_);
+    std::chrono::steady_clock::time_point last_prune_time_ GUARDED_BY(cache_mutex_);
+    Stats stats_ GUARDED_BY(cache_mutex_);
 };
 
 } // namespace memtrack
@@ -21,10 +21,12 @@
 #include <android/binder_manager.h>
 #include <android/binder_process.h>
 #include <gtest/gtest.h>
+#include <memtrackproxy/MemtrackProxy.h>
 #include <unistd.h>
 
 using aidl::android::hardware::memtrack::DeviceInfo;
 using aidl::android::hardware::memtrack::IMemtrack;
+using aidl::android::hardware::memtrack::MemtrackProxy;
 using aidl::android::hardware::memtrack::MemtrackRecord;
 using aidl::android::hardware::memtrack::MemtrackType;
 
@@ -78,6 +80,38 @@ TEST_F(MemtrackProxyTest, GetMemoryForOtherPid) {
     }
 }
 
+TEST(MemtrackProxyLocalTest, GetMemoryForPidsMatchesGetMemory) {
+    auto memtrack_proxy = ndk::SharedRefBase::make<MemtrackProxy>();
+    const std::vector<int> pids = {getpid(), 1, getpid()};
+
+    for (MemtrackType type : ndk::enum_range<MemtrackType>()) {
+        std::vector<std::vector<MemtrackRecord>> batch;
+
+        auto status = memtrack_proxy->getMemoryForPids(pids, type, &batch);
+
+        // Test is run as root
+        ASSERT_TRUE(status.isOk());
+        ASSERT_EQ(batch.size(), pids.size());
+        EXPECT_EQ(batch[0], batch[2]);
+
+        // Served from the cache, so the records did not change in the meantime.
+        for (size_t i = 0; i < pids.size(); i++) {
+            std::vector<MemtrackRecord> records;
+            ASSERT_TRUE(memtrack_proxy->getMemory(pids[i], type, &records).isOk());
+            EXPECT_EQ(records, batch[i]);
+        }
+    }
+}
+
+TEST(MemtrackProxyLocalTest, GetMemoryForPidsWithInvalidPid) {
+    auto memtrack_proxy = ndk::SharedRefBase::make<MemtrackProxy>();
+    std::vector<std::vector<MemtrackRecord>> batch;
+
+    auto status = memtrack_proxy->getMemoryForPids({getpid(), -1}, MemtrackType::GL, &batch);
+
+    EXPECT_EQ(status.getExceptionCode(), EX_ILLEGAL_ARGUMENT);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -24,6 +24,8 @@
 #include <powermanager/PowerHalLoader.h>
 #include <utils/Log.h>
 
+#include <algorithm>
+
 using namespace android::hardware::power;
 
 namespace android {
@@ -59,6 +61,17 @@ void HalConnector::reset() {
 
 // -------------------------------------------------------------------------------------------------
 
+PowerHalController::~PowerHalController() {
+    {
+        std::lock_guard<std::mutex> lock(mDispatchMutex);
+        mDispatchStopping = true;
+    }
+    mDispatchCondition.notify_all();
+    if (mDispatchThread.joinable()) {
+        mDispatchThread.join();
+    }
+}
+
 void PowerHalController::init() {
     initHal();
 }
@@ -91,16 +104,114 @@ HalResult<T> PowerHalController::processHalResult(HalResult<T>&& result, const c
     return std::move(result);
 }
 
+void PowerHalController::enableAsyncDispatch(std::chrono::nanoseconds coalesceWindow) {
+    std::lock_guard<std::mutex> lock(mDispatchMutex);
+    mCoalesceWindow = coalesceWindow;
+    if (!mAsyncDispatch) {
+        mAsyncDispatch = true;
+        mDispatchThread = std::thread(&PowerHalController::runDispatchThread, this);
+    }
+}
+
+HalDispatchStats PowerHalController::getDispatchStats() {
+    std::lock_guard<std::mutex> lock(mDispatchMutex);
+    return mDispatchStats;
+}
+
+HalResult<void> PowerHalController::sendToHal(const DispatchRequest& request) {
+    std::shared_ptr<HalWrapper> handle = initHal();
+    if (request.isBoost) {
+        return processHalResult(handle->setBoost(static_cast<aidl::android::hardware::power::Boost>(
+                                                         request.value),
+                                                 request.arg),
+                                "setBoost");
+    }
+    return processHalResult(handle->setMode(static_cast<aidl::android::hardware::power::Mode>(
+                                                    request.value),
+                                            request.arg != 0),
+                            "setMode");
+}
+
+bool PowerHalController::queueRequest(DispatchRequest request) {
+    {
+        std::lock_guard<std::mutex> lock(mDispatchMutex);
+        if (!mAsyncDispatch) {
+            return false;
+        }
+        for (DispatchRequest& queued : mDispatchQueue) {
+            if (queued.isBoost == request.isBoost && queued.value == request.value &&
+                (request.isBoost ? queued.arg == request.arg : true)) {
+                // The latest state of a mode wins, while it keeps its place in the queue.
+                queued.arg = request.arg;
+                mDispatchStats.coalescedCount++;
+                return true;
+            }
+        }
+        if (request.isBoost) {
+            auto last = mLastBoostTimes.find({request.value, request.arg});
+            if (last != mLastBoostTimes.end() &&
+                request.queuedAt - last->second < mCoalesceWindow) {
+                mDispatchStats.coalescedCount++;
+                return true;
+            }
+        }
+        mDispatchQueue.push_back(request);
+    }
+    mDispatchCondition.notify_one();
+    return true;
+}
+
+void PowerHalController::runDispatchThread() {
+    std::unique_lock<std::mutex> lock(mDispatchMutex);
+    while (true) {
+        while (!mDispatchStopping && mDispatchQueue.empty()) {
+            mDispatchCondition.wait(lock);
+        }
+        // Send what is queued before stopping, so that no mode is left behind.
+        if (mDispatchQueue.empty()) {
+            return;
+        }
+        DispatchRequest request = mDispatchQueue.front();
+        mDispatchQueue.pop_front();
+        auto start = std::chrono::steady_clock::now();
+        if (request.isBoost) {
+            mLastBoostTimes[{request.value, request.arg}] = start;
+        }
+        lock.unlock();
+
+        sendToHal(request);
+
+        auto end = std::chrono::steady_clock::now();
+        lock.lock();
+        auto queueDelay = std::chrono::duration_cast<std::chrono::nanoseconds>(start -
+                                                                               request.queuedAt);
+        auto halDuration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+        mDispatchStats.dispatchedCount++;
+        mDispatchStats.totalQueueDelay += queueDelay;
+        mDispatchStats.maxQueueDelay = std::max(mDispatchStats.maxQueueDelay, queueDelay);
+        mDispatchStats.totalHalDuration += halDuration;
+        mDispatchStats.maxHalDuration = std::max(mDispatchStats.maxHalDuration, halDuration);
+    }
+}
+
 HalResult<void> PowerHalController::setBoost(aidl::android::hardware::power::Boost boost,
                                              int32_t durationMs) {
-    std::shared_ptr<HalWrapper> handle = initHal();
-    return processHalResult(handle->setBoost(boost, durationMs), "setBoost");
+    DispatchRequest request{true, static_cast<int32_t>(boost), durationMs,
+                            std::chrono::steady_clock::now()};
+    if (queueRequest(request)) {
+        return HalResult<void>::ok();
+    }
+    return sendToHal(request);
 }
 
 HalResult<void> PowerHalController::setMode(aidl::android::hardware::power::Mode mode,
                                             bool enabled) {
-    std::shared_ptr<HalWrapper> handle = initHal();
-    return processHalResult(handle->setMode(mode, enabled), "setMode");
+    DispatchRequest request{false, static_cast<int32_t>(mode), enabled ? 1 : 0,
+                            std::chrono::steady_clock::now()};
+    if (queueRequest(request)) {
+        return HalResult<void>::ok();
+    }
+    return sendToHal(request);
 }
 
 HalResult<std::shared_ptr<aidl::android::hardware::power::IPowerHintSession>>
@@ -22,9 +22,11 @@
 #include <powermanager/PowerHalController.h>
 #include <testUtil.h>
 #include <chrono>
+#include <thread>
 
 using aidl::android::hardware::power::Boost;
 using aidl::android::hardware::power::Mode;
+using android::power::HalDispatchStats;
 using android::power::HalResult;
 using android::power::PowerHalController;
 
@@ -71,6 +73,48 @@ static void runCachedBenchmark(benchmark::State& state,
     }
 }
 
+// Measures the latency seen by the callers with async dispatch, and reports the
+// latency of the worker which sends the requests to the HAL.
+template <class... Args0, class... Args1>
+static void runAsyncBenchmark(benchmark::State& state, std::chrono::nanoseconds coalesceWindow,
+                              HalResult<void> (PowerHalController::*fn)(Args0...),
+                              Args1&&... args1) {
+    PowerHalController controller;
+    // First call out of test, to cache HAL service and isSupported result.
+    (controller.*fn)(std::forward<Args1>(args1)...);
+    controller.enableAsyncDispatch(coalesceWindow);
+
+    int64_t calls = 0;
+    while (state.KeepRunning()) {
+        HalResult<void> ret = (controller.*fn)(std::forward<Args1>(args1)...);
+        state.PauseTiming();
+        calls++;
+        if (ret.isFailed()) {
+            state.SkipWithError("Power HAL request failed");
+        }
+        testDelaySpin(
+                std::chrono::duration_cast<std::chrono::duration<float>>(ONEWAY_API_DELAY).count());
+        state.ResumeTiming();
+    }
+
+    HalDispatchStats stats = controller.getDispatchStats();
+    while (stats.dispatchedCount + stats.coalescedCount < calls) {
+        std::this_thread::sleep_for(1ms);
+        stats = controller.getDispatchStats();
+    }
+    if (stats.dispatchedCount > 0) {
+        state.counters["avg_queue_delay_us"] =
+                std::chrono::duration<double, std::micro>(stats.totalQueueDelay).count() /
+                stats.dispatchedCount;
+        state.counters["avg_hal_us"] =
+                std::chrono::duration<double, std::micro>(stats.totalHalDuration).count() /
+                stats.dispatchedCount;
+    }
+    state.counters["max_queue_delay_us"] =
+            std::chrono::duration<double, std::micro>(stats.maxQueueDelay).count();
+    state.counters["coalesced"] = stats.coalescedCount;
+}
+
 static void BM_PowerHalControllerBenchmarks_init(benchmark::State& state) {
     while (state.KeepRunning()) {
         PowerHalController controller;
@@ -98,6 +142,16 @@ static void BM_PowerHalControllerBenchmarks_setBoostCached(benchmark::State& sta
     runCachedBenchmark(state, &PowerHalController::setBoost, boost, 0);
 }
 
+static void BM_PowerHalControllerBenchmarks_setBoostAsync(benchmark::State& state) {
+    Boost boost = static_cast<Boost>(state.range(0));
+    runAsyncBenchmark(state, 0ns, &PowerHalController::setBoost, boost, 0);
+}
+
+static void BM_PowerHalControllerBenchmarks_setBoostAsyncCoalesced(benchmark::State& state) {
+    Boost boost = static_cast<Boost>(state.range(0));
+    runAsyncBenchmark(state, 1ms, &PowerHalController::setBoost, boost, 0);
+}
+
 static void BM_PowerHalControllerBenchmarks_setMode(benchmark::State& state) {
     Mode mode = static_cast<Mode>(state.range(0));
     runBenchmark(state, &PowerHalController::setMode, mode, false);
@@ -108,9 +162,18 @@ static void BM_PowerHalControllerBenchmarks_setModeCached(benchmark::State& stat
     runCachedBenchmark(state, &PowerHalController::setMode, mode, false);
 }
 
+static void BM_PowerHalControllerBenchmarks_setModeAsync(benchmark::State& state) {
+    Mode mode = static_cast<Mode>(state.range(0));
+    runAsyncBenchmark(state, 0ns, &PowerHalController::setMode, mode, false);
+}
+
 BENCHMARK(BM_PowerHalControllerBenchmarks_init);
 BENCHMARK(BM_PowerHalControllerBenchmarks_initCached);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setBoost)->DenseRange(FIRST_BOOST, LAST_BOOST, 1);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setBoostCached)->DenseRange(FIRST_BOOST, LAST_BOOST, 1);
+BENCHMARK(BM_PowerHalControllerBenchmarks_setBoostAsync)->DenseRange(FIRST_BOOST, LAST_BOOST, 1);
+BENCHMARK(BM_PowerHalControllerBenchmarks_setBoostAsyncCoalesced)
+        ->DenseRange(FIRST_BOOST, LAST_BOOST, 1);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setMode)->DenseRange(FIRST_MODE, LAST_MODE, 1);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setModeCached)->DenseRange(FIRST_MODE, LAST_MODE, 1);
+BENCHMARK(BM_PowerHalControllerBenchmarks_setModeAsync)->DenseRange(FIRST_MODE, LAST_MODE, 1);
@@ -24,6 +24,7 @@
 #include <powermanager/PowerHalController.h>
 #include <utils/Log.h>
 
+#include <future>
 #include <thread>
 
 using aidl::android::hardware::power::Boost;
@@ -278,3 +279,46 @@ TEST_F(PowerHalControllerTest, TestMultiThreadWithFailureReconnectIsThreadSafe)
     int powerHalResetCount = mHalConnector->getResetCount();
     EXPECT_THAT(powerHalResetCount, Le(10));
 }
+
+TEST_F(PowerHalControllerTest, TestAsyncDispatchCoalescesRequestsWhileHalIsBusy) {
+    std::promise<void> halCalled;
+    std::promise<void> halReleased;
+    std::shared_future<void> released = halReleased.get_future().share();
+
+    {
+        InSequence seg;
+        EXPECT_CALL(*mMockHal.get(), powerHint(Eq(PowerHint::INTERACTION), Eq(100)))
+                .Times(Exactly(1))
+                .WillOnce([&](PowerHint, int32_t) {
+                    halCalled.set_value();
+                    released.wait();
+                    return hardware::Void();
+                });
+        EXPECT_CALL(*mMockHal.get(), powerHint(Eq(PowerHint::LAUNCH), Eq(0))).Times(Exactly(1));
+    }
+
+    mHalController->enableAsyncDispatch(1s);
+    auto result = mHalController->setBoost(Boost::INTERACTION, 100);
+    ASSERT_TRUE(result.isOk());
+    halCalled.get_future().wait();
+
+    // The HAL is still busy with the first boost, but none of these calls wait for it.
+    result = mHalController->setBoost(Boost::INTERACTION, 100);
+    ASSERT_TRUE(result.isOk());
+    result = mHalController->setMode(Mode::LAUNCH, true);
+    ASSERT_TRUE(result.isOk());
+    result = mHalController->setMode(Mode::LAUNCH, false);
+    ASSERT_TRUE(result.isOk());
+    halReleased.set_value();
+
+    HalDispatchStats stats = mHalController->getDispatchStats();
+    while (stats.dispatchedCount < 2) {
+        std::this_thread::sleep_for(1ms);
+        stats = mHalController->getDispatchStats();
+    }
+    EXPECT_EQ(stats.dispatchedCount, 2);
+    // The repeated boost and the first state of the mode were dropped.
+    EXPECT_EQ(stats.coalescedCount, 2);
+    EXPECT_GE(stats.maxQueueDelay, stats.totalQueueDelay / 2);
+    EXPECT_GE(stats.maxHalDuration, stats.totalHalDuration / 2);
+}
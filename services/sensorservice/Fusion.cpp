@@ -19,6 +19,7 @@
 #include <utils/Log.h>
 
 #include "Fusion.h"
+#include "FusionKernels.h"
 
 namespace android {
 
@@ -170,6 +171,9 @@ public:
     }
 };
 
+using fusion::multiply;
+using fusion::multiplyTransposed;
+
 // -----------------------------------------------------------------------
 
 Fusion::Fusion() {
@@ -187,6 +191,8 @@ Fusion::Fusion() {
     x0 = 0;
     x1 = 0;
 
+    mPredictionDecimation = 1;
+
     init();
 }
 
@@ -202,6 +208,10 @@ void Fusion::init(int mode) {
     mData = 0;
     mMode = mode;
 
+    mPendingCount = 0;
+    mPendingDT = 0;
+    mPendingRotation = 0;
+
     if (mMode != FUSION_NOGYRO) { //normal or game rotation
         mParam.gyroVar = DEFAULT_GYRO_VAR;
         mParam.gyroBiasVar = DEFAULT_GYRO_BIAS_VAR;
@@ -215,12 +225,28 @@ void Fusion::init(int mode) {
     }
 }
 
+void Fusion::setPredictionDecimation(size_t decimation) {
+    mPredictionDecimation = decimation > 0 ? decimation : 1;
+}
+
 void Fusion::initFusion(const vec4_t& q, float dT)
 {
     // initial estimate: E{ x(t0) }
     x0 = q;
     x1 = 0;
 
+    mPendingCount = 0;
+    mPendingDT = 0;
+    mPendingRotation = 0;
+
+    GQGt = getProcessNoise(dT);
+
+    // initial covariance: Var{ x(t0) }
+    // TODO: initialize P correctly
+    P = 0;
+}
+
+mat<mat33_t, 2, 2> Fusion::getProcessNoise(float dT) const {
     // process noise covariance matrix: G.Q.Gt, with
     //
     //  G = | -1 0 |        Q = | q00 q10 |
@@ -242,14 +268,12 @@ void Fusion::initFusion(const vec4_t& q, float dT)
     const float q10 = 0.5f * mParam.gyroBiasVar * dT2;
     const float q01 = q10;
 
-    GQGt[0][0] =  q00;      // rad^2
-    GQGt[1][0] = -q10;
-    GQGt[0][1] = -q01;
-    GQGt[1][1] =  q11;      // (rad/s)^2
-
-    // initial covariance: Var{ x(t0) }
-    // TODO: initialize P correctly
-    P = 0;
+    mat<mat33_t, 2, 2> noise;
+    noise[0][0] =  q00;      // rad^2
+    noise[1][0] = -q10;
+    noise[0][1] = -q01;
+    noise[1][1] =  q11;      // (rad/s)^2
+    return noise;
 }
 
 bool Fusion::hasEstimate() const {
@@ -314,7 +338,19 @@ void Fusion::handleGyro(const vec3_t& w, float dT) {
     if (!checkInitComplete(GYRO, w, dT))
         return;
 
-    predict(w, dT);
+    if (mPredictionDecimation <= 1) {
+        predict(w, dT);
+        return;
+    }
+
+    // The attitude is predicted for each sample, but the covariance only once
+    // per batch of samples, for their mean rate, or before the next update.
+    predictAttitude(getCorrectedRate(w), dT);
+    mPendingRotation += w*dT;
+    mPendingDT += dT;
+    if (++mPendingCount >= mPredictionDecimation) {
+        flushPrediction();
+    }
 }
 
 status_t Fusion::handleAcc(const vec3_t& a, float dT) {
@@ -329,6 +365,8 @@ status_t Fusion::handleAcc(const vec3_t& a, float dT) {
 
     const float l_inv = 1.0f/l;
 
+    flushPrediction();
+
     if ( mMode == FUSION_NOGYRO ) {
         //geo mag
         vec3_t w_dummy;
@@ -385,6 +423,7 @@ status_t Fusion::handleMag(const vec3_t& m) {
     const float l_inv = 1 / length(north);
     north *= l_inv;
 
+    flushPrediction();
     update(north, Bm,  mParam.magStdev*l_inv);
     return NO_ERROR;
 }
@@ -427,14 +466,35 @@ mat34_t Fusion::getF(const vec4_t& q) {
     return F;
 }
 
-void Fusion::predict(const vec3_t& w, float dT) {
-    const vec4_t q  = x0;
-    const vec3_t b  = x1;
-    vec3_t we = w - b;
+vec3_t Fusion::getCorrectedRate(const vec3_t& w) const {
+    vec3_t we = w - x1;
 
     if (length(we) < WVEC_EPS) {
         we = (we[0]>0.f)?WVEC_EPS:-WVEC_EPS;
     }
+    return we;
+}
+
+void Fusion::predict(const vec3_t& w, float dT) {
+    const vec3_t we(getCorrectedRate(w));
+    predictAttitude(we, dT);
+    predictCovariance(we, dT, GQGt);
+}
+
+void Fusion::flushPrediction() {
+    if (mPendingCount == 0)
+        return;
+
+    // the bias does not change between the updates
+    const vec3_t we(getCorrectedRate(mPendingRotation * (1 / mPendingDT)));
+    predictCovariance(we, mPendingDT, getProcessNoise(mPendingDT));
+
+    mPendingCount = 0;
+    mPendingDT = 0;
+    mPendingRotation = 0;
+}
+
+void Fusion::predictAttitude(const vec3_t& we, float dT) {
     // q(k+1) = O(we)*q(k)
     // --------------------
     //
@@ -442,8 +502,25 @@ void Fusion::predict(const vec3_t& w, float dT) {
     //        | -psi'                              cos(0.5*||w||*dT) |
     //
     // psi = sin(0.5*||w||*dT)*w / ||w||
-    //
-    //
+
+    const float hlwedT = 0.5f*length(we)*dT;
+    const float ilwe = 1.f/length(we);
+    const float k2 = cosf(hlwedT);
+    const vec3_t psi(sinf(hlwedT)*ilwe*we);
+    const mat33_t O33(crossMatrix(-psi, k2));
+    mat44_t O;
+    O[0].xyz = O33[0];  O[0].w = -psi.x;
+    O[1].xyz = O33[1];  O[1].w = -psi.y;
+    O[2].xyz = O33[2];  O[2].w = -psi.z;
+    O[3].xyz = psi;     O[3].w = k2;
+
+    x0 = multiply(O, x0);
+
+    if (x0.w < 0)
+        x0 = -x0;
+}
+
+void Fusion::predictCovariance(const vec3_t& we, float dT, const mat<mat33_t, 2, 2>& Q) {
     // P(k+1) = Phi(k)*P(k)*Phi(k)' + G*Q(k)*G'
     // ----------------------------------------
     //
@@ -464,30 +541,33 @@ void Fusion::predict(const vec3_t& w, float dT) {
     const mat33_t I33(1);
     const mat33_t I33dT(dT);
     const mat33_t wx(crossMatrix(we, 0));
-    const mat33_t wx2(wx*wx);
+    const mat33_t wx2(multiply(wx, wx));
     const float lwedT = length(we)*dT;
-    const float hlwedT = 0.5f*lwedT;
     const float ilwe = 1.f/length(we);
     const float k0 = (1-cosf(lwedT))*(ilwe*ilwe);
     const float k1 = sinf(lwedT);
-    const float k2 = cosf(hlwedT);
-    const vec3_t psi(sinf(hlwedT)*ilwe*we);
-    const mat33_t O33(crossMatrix(-psi, k2));
-    mat44_t O;
-    O[0].xyz = O33[0];  O[0].w = -psi.x;
-    O[1].xyz = O33[1];  O[1].w = -psi.y;
-    O[2].xyz = O33[2];  O[2].w = -psi.z;
-    O[3].xyz = psi;     O[3].w = k2;
 
     Phi[0][0] = I33 - wx*(k1*ilwe) + wx2*k0;
     Phi[1][0] = wx*k0 - I33dT - wx2*(ilwe*ilwe*ilwe)*(lwedT-k1);
 
-    x0 = O*q;
-
-    if (x0.w < 0)
-        x0 = -x0;
-
-    P = Phi*P*transpose(Phi) + GQGt;
+    // Phi*P is computed by blocks, skipping the zero and identity blocks of Phi:
+    //
+    // | Phi00 Phi10 | * | P00  P10 | = |  M    N  |
+    // |   0     I   |   | P10t P11 |   | P10t P11 |
+    //
+    // M = Phi00*P00 + Phi10*P10t
+    // N = Phi00*P10 + Phi10*P11
+    //
+    // then Phi*P*Phi' = | M*Phi00t + N*Phi10t  N   |
+    //                   |          Nt          P11 |
+    const mat33_t& Phi00(Phi[0][0]);
+    const mat33_t& Phi10(Phi[1][0]);
+    const mat33_t M(multiply(Phi00, P[0][0]) + multiplyTransposed(Phi10, P[1][0]));
+    const mat33_t N(multiply(Phi00, P[1][0]) + multiply(Phi10, P[1][1]));
+    P[0][0] = multiplyTransposed(M, Phi00) + multiplyTransposed(N, Phi10) + Q[0][0];
+    P[1][0] = N + Q[1][0];
+    P[1][1] += Q[1][1];
+    P[0][1] = transpose(P[1][0]);
 
     checkState();
 }
@@ -509,7 +589,7 @@ void Fusion::update(const vec3_t& z, const vec3_t& Bi, float sigma) {
     const mat33_t S(scaleCovariance(L, P[0][0]) + R);
     const mat33_t Si(invert(S));
     const mat33_t LtSi(transpose(L)*Si);
-    K[0] = P[0][0] * LtSi;
+    K[0] = multiply(P[0][0], LtSi);
     K[1] = transpose(P[1][0])*LtSi;
 
     // update...
@@ -519,11 +599,11 @@ void Fusion::update(const vec3_t& z, const vec3_t& Bi, float sigma) {
     // | K1 |                 | K1*L  0 |   | P01  P11 |   | K1*L*P00  K1*L*P10 |
     // Note: the Joseph form is numerically more stable and given by:
     //     P = (I-KH) * P * (I-KH)' + K*R*R'
-    const mat33_t K0L(K[0] * L);
-    const mat33_t K1L(K[1] * L);
-    P[0][0] -= K0L*P[0][0];
-    P[1][1] -= K1L*P[1][0];
-    P[1][0] -= K0L*P[1][0];
+    const mat33_t K0L(multiply(K[0], L));
+    const mat33_t K1L(multiply(K[1], L));
+    P[0][0] -= multiply(K0L, P[0][0]);
+    P[1][1] -= multiply(K1L, P[1][0]);
+    P[1][0] -= multiply(K0L, P[1][0]);
     P[0][1] = transpose(P[1][0]);
 
     const vec3_t e(z - Bb);
@@ -63,6 +63,8 @@ class Fusion {
 public:
     Fusion();
     void init(int mode = FUSION_9AXIS);
+    // Predicts the covariance once per the given number of gyro samples, rather than for each.
+    void setPredictionDecimation(size_t decimation);
     void handleGyro(const vec3_t& w, float dT);
     status_t handleAcc(const vec3_t& a, float dT);
     status_t handleMag(const vec3_t& m);
@@ -87,11 +89,23 @@ private:
     size_t mCount[3];
     int mMode;
 
+    // The gyro samples whose attitude was predicted, but not the covariance yet,
+    // and their integrated rate.
+    size_t mPredictionDecimation;
+    size_t mPendingCount;
+    float mPendingDT;
+    vec3_t mPendingRotation;
+
     enum { ACC=0x1, MAG=0x2, GYRO=0x4 };
     bool checkInitComplete(int, const vec3_t& w, float d = 0);
     void initFusion(const vec4_t& q0, float dT);
     void checkState();
     void predict(const vec3_t& w, float dT);
+    void predictAttitude(const vec3_t& we, float dT);
+    void predictCovariance(const vec3_t& we, float dT, const mat<mat33_t, 2, 2>& Q);
+    void flushPrediction();
+    vec3_t getCorrectedRate(const vec3_t& w) const;
+    mat<mat33_t, 2, 2> getProcessNoise(float dT) const;
     void update(const vec3_t& z, const vec3_t& Bi, float sigma);
     static mat34_t getF(const vec4_t& p);
     static vec3_t getOrthogonal(const vec3_t &v);
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FUSION_KERNELS_H
+#define ANDROID_FUSION_KERNELS_H
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "mat.h"
+#include "vec.h"
+
+// -----------------------------------------------------------------------
+// The 3x3 and 4x4 products of the fusion, which run for each gyro sample.
+// They use NEON when it is available, and the generic templates otherwise.
+
+namespace android {
+namespace fusion {
+
+#if defined(__ARM_NEON)
+
+namespace neon {
+
+// the 3 floats of the column are loaded in the first lanes, the last one is 0
+inline float32x4_t loadColumn(const vec3_t& v) {
+    return vsetq_lane_f32(v[2], vcombine_f32(vld1_f32(&v[0]), vdup_n_f32(0)), 2);
+}
+
+inline void storeColumn(vec3_t& v, float32x4_t c) {
+    vst1_f32(&v[0], vget_low_f32(c));
+    vst1q_lane_f32(&v[2], c, 2);
+}
+
+inline float32x4_t combine(const float32x4_t a[3], float x, float y, float z) {
+    float32x4_t r = vmulq_n_f32(a[0], x);
+    r = vmlaq_n_f32(r, a[1], y);
+    return vmlaq_n_f32(r, a[2], z);
+}
+
+}; // namespace neon
+
+// lhs*rhs
+inline mat33_t PURE multiply(const mat33_t& lhs, const mat33_t& rhs) {
+    const float32x4_t a[3] = {
+        neon::loadColumn(lhs[0]), neon::loadColumn(lhs[1]), neon::loadColumn(lhs[2]) };
+    mat33_t res;
+    for (size_t c=0 ; c<3 ; c++) {
+        neon::storeColumn(res[c], neon::combine(a, rhs[c][0], rhs[c][1], rhs[c][2]));
+    }
+    return res;
+}
+
+// lhs*transpose(rhs), without building the transpose
+inline mat33_t PURE multiplyTransposed(const mat33_t& lhs, const mat33_t& rhs) {
+    const float32x4_t a[3] = {
+        neon::loadColumn(lhs[0]), neon::loadColumn(lhs[1]), neon::loadColumn(lhs[2]) };
+    mat33_t res;
+    for (size_t c=0 ; c<3 ; c++) {
+        neon::storeColumn(res[c], neon::combine(a, rhs[0][c], rhs[1][c], rhs[2][c]));
+    }
+    return res;
+}
+
+// lhs*rhs
+inline vec4_t PURE multiply(const mat44_t& lhs, const vec4_t& rhs) {
+    float32x4_t r = vmulq_n_f32(vld1q_f32(&lhs[0][0]), rhs[0]);
+    r = vmlaq_n_f32(r, vld1q_f32(&lhs[1][0]), rhs[1]);
+    r = vmlaq_n_f32(r, vld1q_f32(&lhs[2][0]), rhs[2]);
+    r = vmlaq_n_f32(r, vld1q_f32(&lhs[3][0]), rhs[3]);
+    vec4_t res;
+    vst1q_f32(&res[0], r);
+    return res;
+}
+
+#else // !__ARM_NEON
+
+inline mat33_t PURE multiply(const mat33_t& lhs, const mat33_t& rhs) {
+    return lhs*rhs;
+}
+
+inline mat33_t PURE multiplyTransposed(const mat33_t& lhs, const mat33_t& rhs) {
+    return lhs*transpose(rhs);
+}
+
+inline vec4_t PURE multiply(const mat44_t& lhs, const vec4_t& rhs) {
+    return lhs*rhs;
+}
+
+#endif // __ARM_NEON
+
+}; // namespace fusion
+}; // namespace android
+
+#endif // ANDROID_FUSION_KERNELS_H
@@ -23,6 +23,7 @@
 #include "ISensorHalWrapper.h"
 
 #include "ISensorsWrapper.h"
+#include "RingBuffer.h"
 #include "SensorDeviceUtils.h"
 
 namespace android {
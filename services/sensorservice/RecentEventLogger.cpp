@@ -18,11 +18,15 @@
 #include "SensorServiceUtils.h"
 
 #include <android/util/ProtoOutputStream.h>
+#include <cutils/properties.h>
 #include <frameworks/base/core/proto/android/service/sensor_service.proto.h>
 #include <utils/Timers.h>
 
 #include <inttypes.h>
 
+#include <algorithm>
+#include <string>
+
 namespace android {
 namespace SensorServiceUtil {
 
@@ -30,40 +34,76 @@ namespace {
     constexpr size_t LOG_SIZE = 10;
     constexpr size_t LOG_SIZE_MED = 30;  // debugging for slower sensors
     constexpr size_t LOG_SIZE_LARGE = 50;  // larger samples for debugging
+    constexpr int32_t LOG_SIZE_MAX = 1000;
 }// unnamed namespace
 
 RecentEventLogger::RecentEventLogger(int sensorType) :
         mSensorType(sensorType), mEventSize(eventSizeBySensorType(mSensorType)),
-        mRecentEvents(logSizeBySensorType(sensorType)), mMaskData(false),
+        mLogSize(logSizeBySensorType(sensorType)), mSlotCount(std::max(mLogSize, size_t(1))),
+        mSlots(new Slot[mSlotCount]), mEventCount(0), mMaskData(false),
         mIsLastEventCurrent(false) {
     // blank
 }
 
 void RecentEventLogger::addEvent(const sensors_event_t& event) {
-    std::lock_guard<std::mutex> lk(mLock);
-    mRecentEvents.emplace(event);
+    const SensorEventLog log(event);
+    const uint64_t index = mEventCount.load(std::memory_order_relaxed);
+    Slot& slot = mSlots[index % mSlotCount];
+    slot.mSequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.mLog = log;
+    slot.mSequence.store(2 * (index + 1), std::memory_order_release);
+    mEventCount.store(index + 1, std::memory_order_release);
     mIsLastEventCurrent = true;
 }
 
 bool RecentEventLogger::isEmpty() const {
-    return mRecentEvents.size() == 0;
+    return size() == 0;
 }
 
 void RecentEventLogger::setLastEventStale() {
-    std::lock_guard<std::mutex> lk(mLock);
     mIsLastEventCurrent = false;
 }
 
+size_t RecentEventLogger::size() const {
+    return std::min(mEventCount.load(std::memory_order_acquire), uint64_t(mLogSize));
+}
+
+bool RecentEventLogger::readEvent(uint64_t index, SensorEventLog* log) const {
+    const Slot& slot = mSlots[index % mSlotCount];
+    const uint64_t sequence = slot.mSequence.load(std::memory_order_acquire);
+    if (sequence != 2 * (index + 1)) {
+        return false;
+    }
+    *log = slot.mLog;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // The event was overwritten while it was copied.
+    return slot.mSequence.load(std::memory_order_relaxed) == sequence;
+}
+
+std::vector<RecentEventLogger::SensorEventLog> RecentEventLogger::readEvents() const {
+    const uint64_t count = mEventCount.load(std::memory_order_acquire);
+    const size_t size = std::min(count, uint64_t(mLogSize));
+    std::vector<SensorEventLog> logs(size);
+    for (size_t i = 0; i < size; i++) {
+        // The older events are overwritten first.
+        if (!readEvent(count - 1 - i, &logs[i])) {
+            logs.resize(i);
+            break;
+        }
+    }
+    return logs;
+}
+
 std::string RecentEventLogger::dump() const {
-    std::lock_guard<std::mutex> lk(mLock);
+    const std::vector<SensorEventLog> recentEvents = readEvents();
 
     //TODO: replace String8 with std::string completely in this function
     String8 buffer;
 
-    buffer.appendFormat("last %zu events\n", mRecentEvents.size());
+    buffer.appendFormat("last %zu events\n", recentEvents.size());
     int j = 0;
-    for (int i = mRecentEvents.size() - 1; i >= 0; --i) {
-        const auto& ev = mRecentEvents[i];
+    for (const auto& ev : recentEvents) {
         struct tm * timeinfo = localtime(&(ev.mWallTime.tv_sec));
         buffer.appendFormat("\t%2d (ts=%.9f, wall=%02d:%02d:%02d.%03d) ",
                 ++j, ev.mEvent.timestamp/1e9, timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec,
@@ -95,11 +135,10 @@ std::string RecentEventLogger::dump() const {
  */
 void RecentEventLogger::dump(util::ProtoOutputStream* proto) const {
     using namespace service::SensorEventsProto;
-    std::lock_guard<std::mutex> lk(mLock);
+    const std::vector<SensorEventLog> recentEvents = readEvents();
 
-    proto->write(RecentEventsLog::RECENT_EVENTS_COUNT, int(mRecentEvents.size()));
-    for (int i = mRecentEvents.size() - 1; i >= 0; --i) {
-        const auto& ev = mRecentEvents[i];
+    proto->write(RecentEventsLog::RECENT_EVENTS_COUNT, int(recentEvents.size()));
+    for (const auto& ev : recentEvents) {
         const uint64_t token = proto->start(RecentEventsLog::EVENTS);
         proto->write(Event::TIMESTAMP_SEC, float(ev.mEvent.timestamp) / 1e9f);
         proto->write(Event::WALL_TIMESTAMP_MS, ev.mWallTime.tv_sec * 1000LL
@@ -129,29 +168,39 @@ void RecentEventLogger::setFormat(std::string format) {
 }
 
 bool RecentEventLogger::populateLastEventIfCurrent(sensors_event_t *event) const {
-    std::lock_guard<std::mutex> lk(mLock);
-
-    if (mIsLastEventCurrent && mRecentEvents.size()) {
-        // Index 0 contains the latest event emplace()'ed
-        *event = mRecentEvents[0].mEvent;
-        return true;
-    } else {
+    if (!mIsLastEventCurrent) {
         return false;
     }
+
+    SensorEventLog log;
+    uint64_t count;
+    do {
+        count = mEventCount.load(std::memory_order_acquire);
+        if (count == 0) {
+            return false;
+        }
+        // Retry with the next event if the last one was overwritten meanwhile.
+    } while (!readEvent(count - 1, &log));
+    *event = log.mEvent;
+    return true;
 }
 
 
 size_t RecentEventLogger::logSizeBySensorType(int sensorType) {
+    size_t logSize = LOG_SIZE;
     if (sensorType == SENSOR_TYPE_STEP_COUNTER ||
         sensorType == SENSOR_TYPE_SIGNIFICANT_MOTION ||
         sensorType == SENSOR_TYPE_ACCELEROMETER ||
         sensorType == SENSOR_TYPE_LIGHT) {
-        return LOG_SIZE_LARGE;
+        logSize = LOG_SIZE_LARGE;
+    } else if (sensorType == SENSOR_TYPE_PROXIMITY) {
+        logSize = LOG_SIZE_MED;
     }
-    if (sensorType == SENSOR_TYPE_PROXIMITY) {
-        return LOG_SIZE_MED;
-    }
-    return LOG_SIZE;
+
+    // e.g. sensors.recent_events.4=0 turns off the log of the gyroscopes
+    const std::string property = "sensors.recent_events." + std::to_string(sensorType);
+    const int32_t value = property_get_int32(property.c_str(), static_cast<int32_t>(logSize));
+    return static_cast<size_t>(std::clamp(value, int32_t(0), LOG_SIZE_MAX));
 }
 
 RecentEventLogger::SensorEventLog::SensorEventLog(const sensors_event_t& e) : mEvent(e) {
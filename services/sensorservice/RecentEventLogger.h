@@ -17,13 +17,14 @@
 #ifndef ANDROID_SENSOR_SERVICE_UTIL_RECENT_EVENT_LOGGER_H
 #define ANDROID_SENSOR_SERVICE_UTIL_RECENT_EVENT_LOGGER_H
 
-#include "RingBuffer.h"
 #include "SensorServiceUtils.h"
 
 #include <hardware/sensors.h>
 #include <utils/String8.h>
 
-#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 namespace android {
 namespace SensorServiceUtil {
@@ -33,9 +34,15 @@ namespace SensorServiceUtil {
 // generated from the sensor are stored in this buffer.  The buffer is NOT cleared when the sensor
 // unregisters and as a result very old data in the dumpsys output can be seen, which is an intended
 // behavior.
+//
+// The events are added without a lock, by one thread at a time, and the dumps read them with a
+// seqlock, so that logging costs little on the path of the events. The size of the buffer of a
+// sensor type can be set by the sensors.recent_events.<type> property, and 0 turns off the log of
+// the events of these sensors, except for the last event.
 class RecentEventLogger : public Dumpable {
 public:
     explicit RecentEventLogger(int sensorType);
+    // Only one thread at a time may add events, as the buffer has a single writer.
     void addEvent(const sensors_event_t& event);
 
     // Populate event with the last recorded sensor event if it is not stale. An event is
@@ -53,19 +60,37 @@ public:
 
 protected:
     struct SensorEventLog {
+        SensorEventLog() = default;
         explicit SensorEventLog(const sensors_event_t& e);
         timespec mWallTime;
         sensors_event_t mEvent;
     };
 
+    // A slot of the ring of events. Its sequence is odd while the event is written, and is
+    // otherwise twice the number of events written up to the one in the slot.
+    struct Slot {
+        std::atomic<uint64_t> mSequence = 0;
+        SensorEventLog mLog;
+    };
+
     const int mSensorType;
     const size_t mEventSize;
+    const size_t mLogSize;
 
-    mutable std::mutex mLock;
-    RingBuffer<SensorEventLog> mRecentEvents;
+    // At least one slot, for the last event.
+    const size_t mSlotCount;
+    std::unique_ptr<Slot[]> mSlots;
+    std::atomic<uint64_t> mEventCount;
 
     bool mMaskData;
-    bool mIsLastEventCurrent;
+    std::atomic_bool mIsLastEventCurrent;
+
+    // The number of events of the log, up to its size.
+    size_t size() const;
+    // Copies the event of the given index, and returns false if it was overwritten.
+    bool readEvent(uint64_t index, SensorEventLog* log) const;
+    // The events of the log, from the most recent.
+    std::vector<SensorEventLog> readEvents() const;
 
 private:
     static size_t logSizeBySensorType(int sensorType);
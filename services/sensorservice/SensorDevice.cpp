@@ -20,6 +20,7 @@
 #include <android/util/ProtoOutputStream.h>
 #include <com_android_frameworks_sensorservice_flags.h>
 #include <cutils/atomic.h>
+#include <cutils/properties.h>
 #include <frameworks/base/core/proto/android/service/sensor_service.proto.h>
 #include <hardware/sensors-base.h>
 #include <hardware/sensors.h>
@@ -34,6 +35,8 @@
 #include <mutex>
 #include <thread>
 
+#include <pthread.h>
+
 #include "AidlSensorHalWrapper.h"
 #include "HidlSensorHalWrapper.h"
 #include "android/hardware/sensors/2.0/types.h"
@@ -76,6 +79,11 @@ SensorDevice::SensorDevice() : mInHalBypassMode(false) {
     initializeSensorList();
 
     mIsDirectReportSupported = (mHalWrapper->unregisterDirectChannel(-1) != INVALID_OPERATION);
+
+    if (mHalWrapper->supportsMessageQueues() &&
+        property_get_bool("sensors.pipelined_poll", false)) {
+        startPipelinedPoll();
+    }
 }
 
 void SensorDevice::initializeSensorList() {
@@ -87,6 +95,7 @@ void SensorDevice::initializeSensorList() {
     const size_t count = list.size();
 
     mActivationCount.setCapacity(count);
+    mWakeUpSensorHandles.clear();
     Info model;
     for (size_t i = 0; i < count; i++) {
         sensor_t sensor = list[i];
@@ -125,6 +134,9 @@ void SensorDevice::initializeSensorList() {
             sensor.power = MIN_POWER_MA;
         }
         mSensorList.push_back(sensor);
+        if (sensor.flags & SENSOR_FLAG_WAKE_UP) {
+            mWakeUpSensorHandles.push_back(sensor.handle);
+        }
 
         mActivationCount.add(list[i].handle, model);
 
@@ -134,6 +146,7 @@ void SensorDevice::initializeSensorList() {
             mHalWrapper->activate(list[i].handle, 0 /* enabled */);
         }
     }
+    std::sort(mWakeUpSensorHandles.begin(), mWakeUpSensorHandles.end());
 }
 
 SensorDevice::~SensorDevice() {}
@@ -304,6 +317,15 @@ std::string SensorDevice::dump() const {
         result.appendFormat("}, selected = %.2f ms\n", info.bestBatchParams.mTBatch / 1e6f);
     }
 
+    if (mPipelinedPoll) {
+        result.appendFormat("Pipelined poll: wake up events %zu/%zu (max %zu, full %zu times), "
+                            "non wake up events %zu/%zu (max %zu, full %zu times)\n",
+                            mWakeUpEventFifo->size(), mWakeUpEventFifo->capacity(),
+                            mWakeUpEventFifo->getMaxSize(), mWakeUpEventFifo->getFullCount(),
+                            mEventFifo->size(), mEventFifo->capacity(), mEventFifo->getMaxSize(),
+                            mEventFifo->getFullCount());
+    }
+
     return result.c_str();
 }
 
@@ -370,7 +392,9 @@ ssize_t SensorDevice::poll(sensors_event_t* buffer, size_t count) {
     if (mInHalBypassMode) [[unlikely]] {
         eventsRead = getHalBypassInjectedEvents(buffer, count);
     } else {
-        if (mHalWrapper->supportsMessageQueues()) {
+        if (mPipelinedPoll) {
+            eventsRead = pollPipeline(buffer, count);
+        } else if (mHalWrapper->supportsMessageQueues()) {
             eventsRead = mHalWrapper->pollFmq(buffer, count);
         } else if (mHalWrapper->supportsPolling()) {
             eventsRead = mHalWrapper->poll(buffer, count);
@@ -947,5 +971,149 @@ ssize_t SensorDevice::getHalBypassInjectedEvents(sensors_event_t* buffer,
     return eventsToRead;
 }
 
+void SensorDevice::startPipelinedPoll() {
+    mWakeUpEventFifo =
+            std::make_unique<SensorServiceUtil::SensorEventFifo>(PIPELINE_WAKE_UP_FIFO_CAPACITY);
+    mEventFifo = std::make_unique<SensorServiceUtil::SensorEventFifo>(PIPELINE_FIFO_CAPACITY);
+    mPipelineRuns = std::make_unique<SensorServiceUtil::LockFreeFifo<PipelineRun>>(
+            PIPELINE_WAKE_UP_FIFO_CAPACITY + PIPELINE_FIFO_CAPACITY + 1);
+    mPipelinedPoll = true;
+    // The thread runs as long as the process, like the SensorDevice.
+    std::thread([this] {
+        pthread_setname_np(pthread_self(), "SensorHalReader");
+        readerThreadLoop();
+    }).detach();
+}
+
+void SensorDevice::readerThreadLoop() {
+    std::vector<sensors_event_t> buffer(SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT);
+    while (true) {
+        const ssize_t eventsRead = mHalWrapper->pollFmq(buffer.data(), buffer.size());
+        if (eventsRead <= 0) {
+            // Hand the wake up or the error over to poll(). After an error, wait for the
+            // reconnection to the HAL, after which poll() resumes the reader.
+            std::unique_lock lock(mPipelineLock);
+            if (eventsRead < 0) {
+                mReaderStatus = eventsRead;
+                mReaderPaused = true;
+            } else {
+                mReaderWokeUp = true;
+            }
+            mPipelineCv.notify_all();
+            mPipelineCv.wait(lock, [this] { return !mReaderPaused; });
+            continue;
+        }
+
+        // Each run of wake up or non wake up events goes in its FIFO, after the run itself.
+        size_t start = 0;
+        while (start < size_t(eventsRead)) {
+            const bool wakeUp = isWakeUpEvent(buffer[start]);
+            size_t end = start + 1;
+            while (end < size_t(eventsRead) && isWakeUpEvent(buffer[end]) == wakeUp) {
+                end++;
+            }
+            const PipelineRun run = {.wakeUp = wakeUp, .count = end - start};
+            mPipelineRuns->write(&run, 1);
+            writeToPipeline(wakeUp ? *mWakeUpEventFifo : *mEventFifo, &buffer[start],
+                            end - start);
+            start = end;
+        }
+    }
+}
+
+bool SensorDevice::isWakeUpEvent(const sensors_event_t& event) const {
+    // The meta data events, such as the flush complete events, are not sent by the sensor
+    // they are about.
+    if (event.type == SENSOR_TYPE_META_DATA || event.type == SENSOR_TYPE_DYNAMIC_SENSOR_META) {
+        return false;
+    }
+    return std::binary_search(mWakeUpSensorHandles.begin(), mWakeUpSensorHandles.end(),
+                              event.sensor);
+}
+
+bool SensorDevice::hasPipelinedEvents() const {
+    if (mPollRun.count == 0) {
+        return mPipelineRuns->size() > 0;
+    }
+    return (mPollRun.wakeUp ? *mWakeUpEventFifo : *mEventFifo).size() > 0;
+}
+
+void SensorDevice::writeToPipeline(SensorServiceUtil::SensorEventFifo& fifo,
+                                   const sensors_event_t* events, size_t count) {
+    while (true) {
+        const size_t eventsWritten = fifo.write(events, count);
+        events += eventsWritten;
+        count -= eventsWritten;
+
+        // Orders the write of the events before the check for a waiting poll(), which does the
+        // opposite.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mPollWaiting) {
+            std::lock_guard lock(mPipelineLock);
+            mPipelineCv.notify_all();
+        }
+        if (count == 0) {
+            return;
+        }
+
+        // The FIFO is full. Wait for poll() to read from it, while the HAL queues the events.
+        std::unique_lock lock(mPipelineLock);
+        mReaderWaiting = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        mPipelineCv.wait(lock, [&fifo] { return !fifo.isFull(); });
+        mReaderWaiting = false;
+    }
+}
+
+ssize_t SensorDevice::pollPipeline(sensors_event_t* buffer, size_t count) {
+    while (true) {
+        size_t eventsRead = 0;
+        while (eventsRead < count) {
+            if (mPollRun.count == 0 && mPipelineRuns->read(&mPollRun, 1) == 0) {
+                break;
+            }
+            SensorServiceUtil::SensorEventFifo& fifo =
+                    mPollRun.wakeUp ? *mWakeUpEventFifo : *mEventFifo;
+            const size_t runEventsRead = fifo.read(buffer + eventsRead,
+                                                   std::min(count - eventsRead, mPollRun.count));
+            eventsRead += runEventsRead;
+            mPollRun.count -= runEventsRead;
+            if (mPollRun.count > 0) {
+                // The reader thread didn't write the rest of the run yet.
+                break;
+            }
+        }
+        if (eventsRead > 0) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (mReaderWaiting) {
+                std::lock_guard lock(mPipelineLock);
+                mPipelineCv.notify_all();
+            }
+            return eventsRead;
+        }
+
+        std::unique_lock lock(mPipelineLock);
+        if (mReaderStatus != OK) {
+            const ssize_t status = mReaderStatus;
+            mReaderStatus = OK;
+            return status;
+        }
+        if (mReaderWokeUp) {
+            mReaderWokeUp = false;
+            return 0;
+        }
+        if (mReaderPaused && !mHalWrapper->mReconnecting) {
+            mReaderPaused = false;
+            mPipelineCv.notify_all();
+        }
+        mPollWaiting = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        mPipelineCv.wait(lock, [this] {
+            return hasPipelinedEvents() || mReaderStatus != OK || mReaderWokeUp;
+        });
+        mPollWaiting = false;
+    }
+}
+
 // ---------------------------------------------------------------------------
 }; // namespace android
@@ -35,6 +35,7 @@
 #include <utils/Timers.h>
 
 #include <algorithm> //std::max std::min
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
@@ -43,6 +44,7 @@
 #include <vector>
 
 #include "RingBuffer.h"
+#include "SensorEventFifo.h"
 
 // ---------------------------------------------------------------------------
 
@@ -236,6 +238,49 @@ private:
     std::queue<sensors_event_t> mHalBypassInjectedEventQueue;
     ssize_t getHalBypassInjectedEvents(sensors_event_t* buffer, size_t count);
     bool mInHalBypassMode;
+
+    // In the pipelined poll mode, a reader thread drains the event FMQ of the HAL into FIFOs
+    // which poll() reads from, so that the HAL can keep writing events while the service sends
+    // the previous ones to its clients. The wake up events have their own FIFO, and poll() reads
+    // the events of both FIFOs in the order of the HAL, as the runs FIFO tells.
+    static constexpr size_t PIPELINE_WAKE_UP_FIFO_CAPACITY = 1024;
+    static constexpr size_t PIPELINE_FIFO_CAPACITY = 4096;
+    // Consecutive events of the HAL which went to the same FIFO.
+    struct PipelineRun {
+        bool wakeUp;
+        size_t count;
+    };
+    bool mPipelinedPoll = false;
+    std::unique_ptr<SensorServiceUtil::SensorEventFifo> mWakeUpEventFifo;
+    std::unique_ptr<SensorServiceUtil::SensorEventFifo> mEventFifo;
+    // The reader thread writes each run before its events, so that poll() knows which FIFO to
+    // read next. Every run but the one being written has events left in a FIFO, so the runs
+    // always fit.
+    std::unique_ptr<SensorServiceUtil::LockFreeFifo<PipelineRun>> mPipelineRuns;
+    // The run poll() reads, with the number of its events left to read. Only poll() uses it.
+    PipelineRun mPollRun = {};
+    // The sorted handles of the wake up sensors of mSensorList.
+    std::vector<int32_t> mWakeUpSensorHandles;
+
+    // The reader thread and poll() only take this lock to wait for each other.
+    std::mutex mPipelineLock;
+    std::condition_variable mPipelineCv;
+    std::atomic_bool mPollWaiting = false;
+    std::atomic_bool mReaderWaiting = false;
+    // The reader was woken up without events, which poll() returns 0 for.
+    bool mReaderWokeUp = false;
+    // The error of the HAL, after which the reader waits for a poll() after the reconnection.
+    ssize_t mReaderStatus = OK;
+    bool mReaderPaused = false;
+
+    void startPipelinedPoll();
+    void readerThreadLoop();
+    bool isWakeUpEvent(const sensors_event_t& event) const;
+    // Whether poll() has events to read next, from the FIFO of its run.
+    bool hasPipelinedEvents() const;
+    void writeToPipeline(SensorServiceUtil::SensorEventFifo& fifo, const sensors_event_t* events,
+                         size_t count);
+    ssize_t pollPipeline(sensors_event_t* buffer, size_t count);
 };
 
 // ---------------------------------------------------------------------------
@@ -28,10 +28,12 @@ using util::ProtoOutputStream;
 
 SensorService::SensorDirectConnection::SensorDirectConnection(const sp<SensorService>& service,
         uid_t uid, const sensors_direct_mem_t *mem, int32_t halChannelHandle,
-        const String16& opPackageName, int deviceId)
+        const String16& opPackageName, int deviceId,
+        std::shared_ptr<SharedDirectChannel> sharedChannel)
         : mService(service), mUid(uid), mMem(*mem),
         mHalChannelHandle(halChannelHandle),
-        mOpPackageName(opPackageName), mDeviceId(deviceId), mDestroyed(false) {
+        mOpPackageName(opPackageName), mDeviceId(deviceId),
+        mSharedChannel(std::move(sharedChannel)), mDestroyed(false) {
     mUserId = multiuser_get_user_id(mUid);
     ALOGD_IF(DEBUG_CONNECTIONS, "Created SensorDirectConnection");
 }
@@ -50,7 +52,10 @@ void SensorService::SensorDirectConnection::destroy() {
 
     stopAll();
     mService->cleanupConnection(this);
-    if (mMem.handle != nullptr) {
+    if (mSharedChannel != nullptr) {
+        // The channel is unregistered once its last member is released.
+        mSharedChannel->removeMember(this);
+    } else if (mMem.handle != nullptr) {
         native_handle_close_with_tag(mMem.handle);
         native_handle_delete(const_cast<struct native_handle*>(mMem.handle));
     }
@@ -62,8 +67,9 @@ void SensorService::SensorDirectConnection::onFirstRef() {
 
 void SensorService::SensorDirectConnection::dump(String8& result) const {
     Mutex::Autolock _l(mConnectionLock);
-    result.appendFormat("\tPackage %s, HAL channel handle %d, total sensor activated %zu\n",
-            String8(mOpPackageName).c_str(), getHalChannelHandle(), mActivated.size());
+    result.appendFormat("\tPackage %s, HAL channel handle %d%s, total sensor activated %zu\n",
+            String8(mOpPackageName).c_str(), getHalChannelHandle(),
+            isShared() ? " (shared)" : "", mActivated.size());
     for (auto &i : mActivated) {
         result.appendFormat("\t\tSensor %#08x, rate %d\n", i.first, i.second);
     }
@@ -95,14 +101,32 @@ sp<BitTube> SensorService::SensorDirectConnection::getSensorChannel() const {
 }
 
 void SensorService::SensorDirectConnection::onSensorAccessChanged(bool hasAccess) {
+    // The shared memory stays mapped by the connection, so the channel stops reporting for all
+    // of its members until the access is regained.
     if (!hasAccess) {
+        if (isShared()) {
+            mSharedChannel->setMemberAccess(this, false);
+        }
         stopAll(true /* backupRecord */);
     } else {
+        if (isShared()) {
+            mSharedChannel->setMemberAccess(this, true);
+        }
         recoverAll();
     }
 }
 
 void SensorService::SensorDirectConnection::onMicSensorAccessChanged(bool isMicToggleOn) {
+    if (isShared()) {
+        // The rate of a shared channel can't be lowered for one member only.
+        std::shared_ptr<SensorInterface> si =
+                mService->getSensorInterfaceFromHandle(mSharedChannel->getSensorHandle());
+        if (si != nullptr && mService->isSensorInCappedSet(si->getSensor().getType()) &&
+                mSharedChannel->getRateLevel() > SENSOR_SERVICE_CAPPED_SAMPLING_RATE_LEVEL) {
+            mSharedChannel->setMemberRateCapped(this, isMicToggleOn);
+        }
+        return;
+    }
     if (isMicToggleOn) {
         capRates();
     } else {
@@ -139,6 +163,14 @@ status_t SensorService::SensorDirectConnection::flush() {
     return INVALID_OPERATION;
 }
 
+sp<SensorEventRing> SensorService::SensorDirectConnection::createEventRing(
+        int32_t capacity, nsecs_t maxBatchLatencyNs) {
+    // SensorDirectConnection already reports to its own shared memory, parameters not used
+    UNUSED(capacity);
+    UNUSED(maxBatchLatencyNs);
+    return nullptr;
+}
+
 int32_t SensorService::SensorDirectConnection::configureChannel(int handle, int rateLevel) {
 
     if (handle == -1 && rateLevel == SENSOR_DIRECT_RATE_STOP) {
@@ -167,12 +199,21 @@ int32_t SensorService::SensorDirectConnection::configureChannel(int handle, int
         return INVALID_OPERATION;
     }
 
+    if (isShared() && (handle != mSharedChannel->getSensorHandle()
+            || (rateLevel != SENSOR_DIRECT_RATE_STOP
+                    && rateLevel != mSharedChannel->getRateLevel()))) {
+        return INVALID_OPERATION;
+    }
+
     int requestedRateLevel = rateLevel;
     if (mService->isSensorInCappedSet(s.getType()) && rateLevel != SENSOR_DIRECT_RATE_STOP) {
         status_t err = mService->adjustRateLevelBasedOnMicAndPermission(&rateLevel, mOpPackageName);
         if (err != OK) {
             return err;
         }
+        if (isShared() && rateLevel != requestedRateLevel) {
+            return PERMISSION_DENIED;
+        }
     }
 
     struct sensors_direct_cfg_t config = {
@@ -279,6 +320,9 @@ void SensorService::SensorDirectConnection::uncapRates() {
 
 int SensorService::SensorDirectConnection::configure(
         int handle, const sensors_direct_cfg_t* config) {
+    if (isShared()) {
+        return mSharedChannel->setMemberActive(this, config->rate_level != SENSOR_DIRECT_RATE_STOP);
+    }
     if (mDeviceId == RuntimeSensor::DEFAULT_DEVICE_ID) {
         SensorDevice& dev(SensorDevice::getInstance());
         return dev.configureDirectChannel(handle, getHalChannelHandle(), config);
@@ -335,6 +379,11 @@ int32_t SensorService::SensorDirectConnection::getHalChannelHandle() const {
 bool SensorService::SensorDirectConnection::isEquivalent(const sensors_direct_mem_t *mem) const {
     bool ret = false;
 
+    // The memory of a shared channel is never supplied by a client.
+    if (isShared()) {
+        return false;
+    }
+
     if (mMem.type == mem->type) {
         switch (mMem.type) {
             case SENSOR_DIRECT_MEM_TYPE_ASHMEM: {
@@ -25,10 +25,12 @@
 
 #include <sensor/Sensor.h>
 #include <sensor/BitTube.h>
+#include <sensor/SensorEventRing.h>
 #include <sensor/ISensorServer.h>
 #include <sensor/ISensorEventConnection.h>
 
 #include "SensorService.h"
+#include "SharedDirectChannel.h"
 
 namespace android {
 
@@ -39,13 +41,17 @@ class SensorService::SensorDirectConnection: public BnSensorEventConnection {
 public:
     SensorDirectConnection(const sp<SensorService>& service, uid_t uid,
             const sensors_direct_mem_t *mem, int32_t halChannelHandle,
-            const String16& opPackageName, int deviceId);
+            const String16& opPackageName, int deviceId,
+            std::shared_ptr<SharedDirectChannel> sharedChannel = nullptr);
     void dump(String8& result) const;
     void dump(util::ProtoOutputStream* proto) const;
     uid_t getUid() const { return mUid; }
     const String16& getOpPackageName() const { return mOpPackageName; }
     int32_t getHalChannelHandle() const;
     bool isEquivalent(const sensors_direct_mem_t *mem) const;
+    // Whether the connection is a member of a shared direct channel, whose memory and HAL
+    // channel it does not own.
+    bool isShared() const { return mSharedChannel != nullptr; }
 
     // Invoked when access to sensors for this connection has changed, e.g. lost or
     // regained due to changes in the sensor restricted/privacy mode or the
@@ -65,6 +71,7 @@ protected:
     virtual status_t setEventRate(int handle, nsecs_t samplingPeriodNs);
     virtual status_t flush();
     virtual int32_t configureChannel(int handle, int rateLevel);
+    virtual sp<SensorEventRing> createEventRing(int32_t capacity, nsecs_t maxBatchLatencyNs);
     virtual void destroy();
 private:
     bool hasSensorAccess() const;
@@ -100,6 +107,7 @@ private:
     const int32_t mHalChannelHandle;
     const String16 mOpPackageName;
     const int mDeviceId;
+    const std::shared_ptr<SharedDirectChannel> mSharedChannel;
 
     mutable Mutex mConnectionLock;
     std::unordered_map<int, int> mActivated;
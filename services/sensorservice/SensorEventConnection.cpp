@@ -15,7 +15,10 @@
  */
 
 #include <log/log.h>
+#include <string.h>
 #include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
 #include <utils/threads.h>
 
 #include <android/util/ProtoOutputStream.h>
@@ -35,6 +38,9 @@ namespace {
 // Used as the default value for the target SDK until it's obtained via getTargetSdkVersion.
 constexpr int kTargetSdkUnknown = 0;
 
+// How often the events cached while the event ring was full are written to it again.
+constexpr nsecs_t kEventRingCacheRetryNs = 10'000'000;
+
 }  // namespace
 
 SensorService::SensorEventConnection::SensorEventConnection(
@@ -92,6 +98,9 @@ void SensorService::SensorEventConnection::dump(String8& result) {
     result.appendFormat("\t %s | WakeLockRefCount %d | uid %d | cache size %d | "
             "max cache size %d\n", mPackageName.c_str(), mWakeLockRefCount, mUid, mCacheSize,
             mMaxCacheSize);
+    if (mEventRing != nullptr) {
+        result.appendFormat("\t event ring capacity %zu\n", mEventRing->getCapacity());
+    }
     for (auto& it : mSensorInfo) {
         const FlushInfo& flushInfo = it.second;
         result.appendFormat("\t %s 0x%08x | status: %s | pending flush events %d \n",
@@ -232,6 +241,16 @@ void SensorService::SensorEventConnection::updateLooperRegistrationLocked(
         const sp<Looper>& looper) {
     bool isConnectionActive = (mSensorInfo.size() > 0 && !mDataInjectionMode) ||
                               mDataInjectionMode;
+    if (mRingTimerFd.ok() && (isConnectionActive && !mDead) != mHasRingTimerCallback) {
+        if (mHasRingTimerCallback) {
+            looper->removeFd(mRingTimerFd.get());
+            mHasRingTimerCallback = false;
+        } else if (looper->addFd(mRingTimerFd.get(), 0, ALOOPER_EVENT_INPUT, this, nullptr) == 1) {
+            mHasRingTimerCallback = true;
+        } else {
+            ALOGE("Looper::addFd failed fd=%d", mRingTimerFd.get());
+        }
+    }
     // If all sensors are unregistered OR Looper has encountered an error, we can remove the Fd from
     // the Looper if it has been previously added.
     if (!isConnectionActive || mDead) { if (mHasLooperCallbacks) {
@@ -241,7 +260,8 @@ void SensorService::SensorEventConnection::updateLooperRegistrationLocked(
     return; }
 
     int looper_flags = 0;
-    if (mCacheSize > 0) looper_flags |= ALOOPER_EVENT_OUTPUT;
+    // The events in the cache are written to the event ring before the next events instead.
+    if (mCacheSize > 0 && mEventRing == nullptr) looper_flags |= ALOOPER_EVENT_OUTPUT;
     if (mDataInjectionMode) looper_flags |= ALOOPER_EVENT_INPUT;
     for (auto& it : mSensorInfo) {
         const int handle = it.first;
@@ -297,6 +317,7 @@ status_t SensorService::SensorEventConnection::sendEvents(
 
     int count = 0;
     Mutex::Autolock _l(mConnectionLock);
+    const bool hasAccess = hasSensorAccess();
     if (scratch) {
         size_t i=0;
         while (i<numEvents) {
@@ -335,6 +356,8 @@ status_t SensorService::SensorEventConnection::sendEvents(
                 continue;
             }
 
+            // The AppOp is noted once for the run of events of the sensor below.
+            std::optional<bool> canDeliver;
             do {
                 // Keep copying events into the scratch buffer as long as they are regular
                 // sensor_events are from the same sensor_handle OR they are flush_complete_events
@@ -347,7 +370,10 @@ status_t SensorService::SensorEventConnection::sendEvents(
                 } else {
                     // Regular sensor event, just copy it to the scratch buffer after checking
                     // the AppOp.
-                    if (hasSensorAccess() && noteOpIfRequired(buffer[i])) {
+                    if (!canDeliver.has_value()) {
+                        canDeliver = hasAccess && noteOpIfRequired(buffer[i]);
+                    }
+                    if (*canDeliver) {
                         scratch[count++] = buffer[i];
                     }
                 }
@@ -358,7 +384,7 @@ status_t SensorService::SensorEventConnection::sendEvents(
                                         buffer[i].meta_data.sensor == sensor_handle)));
         }
     } else {
-        if (hasSensorAccess()) {
+        if (hasAccess) {
             scratch = const_cast<sensors_event_t *>(buffer);
             count = numEvents;
         } else {
@@ -375,21 +401,30 @@ status_t SensorService::SensorEventConnection::sendEvents(
     sendPendingFlushEventsLocked();
     // Early return if there are no events for this connection.
     if (count == 0) {
+        if (mEventRing != nullptr) {
+            // Send the wake up that was deferred for the events of an earlier call.
+            mEventRing->wakeIfDue();
+            updateRingTimerLocked();
+        }
         return status_t(NO_ERROR);
     }
 
 #if DEBUG_CONNECTIONS
      mEventsReceived += count;
 #endif
+    if (mCacheSize != 0 && mEventRing != nullptr) {
+        writeToSocketFromCacheLocked();
+    }
     if (mCacheSize != 0) {
         // There are some events in the cache which need to be sent first. Copy this buffer to
         // the end of cache.
         appendEventsToCacheLocked(scratch, count);
+        updateRingTimerLocked();
         return status_t(NO_ERROR);
     }
 
     int index_wake_up_event = -1;
-    if (hasSensorAccess()) {
+    if (hasAccess) {
         index_wake_up_event = findWakeUpSensorEventLocked(scratch, count);
         if (index_wake_up_event >= 0) {
             BatteryService::noteWakeupSensorEvent(scratch[index_wake_up_event].timestamp,
@@ -402,9 +437,7 @@ status_t SensorService::SensorEventConnection::sendEvents(
         }
     }
 
-    // NOTE: ASensorEvent and sensors_event_t are the same type.
-    ssize_t size = SensorEventQueue::write(mChannel,
-                                    reinterpret_cast<ASensorEvent const*>(scratch), count);
+    ssize_t size = writeEventsLocked(scratch, count);
     if (size < 0) {
         // Write error, copy events to local cache.
         if (index_wake_up_event >= 0) {
@@ -428,8 +461,10 @@ status_t SensorService::SensorEventConnection::sendEvents(
         // Add this file descriptor to the looper to get a callback when this fd is available for
         // writing.
         updateLooperRegistrationLocked(mService->getLooper());
+        updateRingTimerLocked();
         return size;
     }
+    updateRingTimerLocked();
 
 #if DEBUG_CONNECTIONS
     if (size > 0) {
@@ -441,8 +476,17 @@ status_t SensorService::SensorEventConnection::sendEvents(
 }
 
 bool SensorService::SensorEventConnection::hasSensorAccess() {
-    return mService->isUidActive(mUid)
+    // Acquire, so that the uid state and sensor privacy read below are at least as recent.
+    const uint64_t generation = mService->mSensorAccessGeneration.load(std::memory_order_acquire);
+    const uint64_t cached = mSensorAccess.load(std::memory_order_relaxed);
+    if ((cached >> 1) == generation) {
+        return (cached & 1) != 0;
+    }
+    const bool hasAccess = mService->isUidActive(mUid)
         && !mService->mSensorPrivacyPolicy->isSensorPrivacyEnabled();
+    // If the generation changed meanwhile, the next call evaluates the access again.
+    mSensorAccess.store(generation << 1 | (hasAccess ? 1 : 0), std::memory_order_relaxed);
+    return hasAccess;
 }
 
 bool SensorService::SensorEventConnection::noteOpIfRequired(const sensors_event_t& event) {
@@ -570,7 +614,8 @@ void SensorService::SensorEventConnection::sendPendingFlushEventsLocked() {
                ++mWakeLockRefCount;
                flushCompleteEvent.flags |= WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
             }
-            ssize_t size = SensorEventQueue::write(mChannel, &flushCompleteEvent, 1);
+            ssize_t size = writeEventsLocked(
+                    reinterpret_cast<sensors_event_t const*>(&flushCompleteEvent), 1);
             if (size < 0) {
                 if (wakeUpSensor) --mWakeLockRefCount;
                 return;
@@ -582,12 +627,33 @@ void SensorService::SensorEventConnection::sendPendingFlushEventsLocked() {
     }
 }
 
+ssize_t SensorService::SensorEventConnection::writeEventsLocked(sensors_event_t const* events,
+                                                                int count) {
+    // NOTE: ASensorEvent and sensors_event_t are the same type.
+    ASensorEvent const* sensorEvents = reinterpret_cast<ASensorEvent const*>(events);
+    if (mEventRing != nullptr) {
+        // The app is woken up at once for the events it must acknowledge and for the flush
+        // complete events, and at the latest after the batch latency of the ring otherwise.
+        bool wakeNow = false;
+        for (int i = 0; i < count && !wakeNow; i++) {
+            wakeNow = (events[i].flags & WAKE_UP_SENSOR_EVENT_NEEDS_ACK) ||
+                    events[i].type == SENSOR_TYPE_META_DATA;
+        }
+        return mEventRing->write(sensorEvents, count, wakeNow);
+    }
+    return SensorEventQueue::write(mChannel, sensorEvents, count);
+}
+
 void SensorService::SensorEventConnection::writeToSocketFromCache() {
+    Mutex::Autolock _l(mConnectionLock);
+    writeToSocketFromCacheLocked();
+}
+
+void SensorService::SensorEventConnection::writeToSocketFromCacheLocked() {
     // At a time write at most half the size of the receiver buffer in SensorEventQueue OR
     // half the size of the socket buffer allocated in BitTube whichever is smaller.
     const int maxWriteSize = helpers::min(SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT/2,
             int(mService->mSocketBufferSize/(sizeof(sensors_event_t)*2)));
-    Mutex::Autolock _l(mConnectionLock);
     // Send pending flush complete events (if any)
     sendPendingFlushEventsLocked();
     for (int numEventsSent = 0; numEventsSent < mCacheSize;) {
@@ -606,9 +672,7 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
             }
         }
 
-        ssize_t size = SensorEventQueue::write(mChannel,
-                          reinterpret_cast<ASensorEvent const*>(mEventCache + numEventsSent),
-                          numEventsToWrite);
+        ssize_t size = writeEventsLocked(mEventCache + numEventsSent, numEventsToWrite);
         if (size < 0) {
             if (index_wake_up_event >= 0) {
                 // If there was a wake_up sensor_event, reset the flag.
@@ -811,6 +875,55 @@ status_t  SensorService::SensorEventConnection::flush() {
     return  mService->flushSensor(this, mOpPackageName);
 }
 
+sp<SensorEventRing> SensorService::SensorEventConnection::createEventRing(
+        int32_t capacity, nsecs_t maxBatchLatencyNs) {
+    if (mDestroyed || mDataInjectionMode || capacity <= 0) {
+        return nullptr;
+    }
+    Mutex::Autolock _l(mConnectionLock);
+    if (mEventRing != nullptr) {
+        ALOGE("Event ring already created package=%s uid=%d", mPackageName.c_str(), mUid);
+        return nullptr;
+    }
+    sp<SensorEventRing> ring = new SensorEventRing(capacity, maxBatchLatencyNs);
+    if (ring->initCheck() != NO_ERROR) {
+        return nullptr;
+    }
+    base::unique_fd timerFd(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK));
+    if (!timerFd.ok()) {
+        ALOGE("Can't create the timer of the event ring: %s", strerror(errno));
+        return nullptr;
+    }
+    mEventRing = ring;
+    mRingTimerFd = std::move(timerFd);
+    // The cache is no longer written when the socket becomes writable.
+    updateLooperRegistrationLocked(mService->getLooper());
+    return mEventRing;
+}
+
+void SensorService::SensorEventConnection::updateRingTimerLocked() {
+    if (!mRingTimerFd.ok()) {
+        return;
+    }
+    nsecs_t deadline = mEventRing->getWakeDeadline();
+    if (mCacheSize > 0) {
+        const nsecs_t retryTime = systemTime(SYSTEM_TIME_MONOTONIC) + kEventRingCacheRetryNs;
+        deadline = deadline == 0 ? retryTime : std::min(deadline, retryTime);
+    }
+    if (deadline == mRingTimerDeadline) {
+        return;
+    }
+    // A zero time disarms the timer.
+    struct itimerspec spec = {};
+    spec.it_value.tv_sec = deadline / 1'000'000'000;
+    spec.it_value.tv_nsec = deadline % 1'000'000'000;
+    if (timerfd_settime(mRingTimerFd.get(), TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+        ALOGE("Can't arm the timer of the event ring: %s", strerror(errno));
+        return;
+    }
+    mRingTimerDeadline = deadline;
+}
+
 int32_t SensorService::SensorEventConnection::configureChannel(int handle, int rateLevel) {
     // SensorEventConnection does not support configureChannel, parameters not used
     UNUSED(handle);
@@ -819,6 +932,23 @@ int32_t SensorService::SensorEventConnection::configureChannel(int handle, int r
 }
 
 int SensorService::SensorEventConnection::handleEvent(int fd, int events, void* /*data*/) {
+    if (fd != mChannel->getSendFd()) {
+        // The timer of the event ring expired.
+        uint64_t expirations;
+        TEMP_FAILURE_RETRY(::read(fd, &expirations, sizeof(expirations)));
+        Mutex::Autolock _l(mConnectionLock);
+        if (mEventRing == nullptr) {
+            return 1;
+        }
+        mRingTimerDeadline = 0;
+        if (mCacheSize != 0) {
+            writeToSocketFromCacheLocked();
+        }
+        mEventRing->wakeIfDue();
+        updateRingTimerLocked();
+        return 1;
+    }
+
     if (events & ALOOPER_EVENT_HANGUP || events & ALOOPER_EVENT_ERROR) {
         {
             // If the Looper encounters some error, set the flag mDead, reset mWakeLockRefCount,
@@ -31,10 +31,12 @@
 #include <utils/Looper.h>
 #include <utils/String8.h>
 
+#include <android-base/unique_fd.h>
 #include <binder/BinderService.h>
 
 #include <sensor/Sensor.h>
 #include <sensor/BitTube.h>
+#include <sensor/SensorEventRing.h>
 #include <sensor/ISensorServer.h>
 #include <sensor/ISensorEventConnection.h>
 
@@ -83,6 +85,7 @@ private:
     virtual status_t setEventRate(int handle, nsecs_t samplingPeriodNs);
     virtual status_t flush();
     virtual int32_t configureChannel(int handle, int rateLevel);
+    virtual sp<SensorEventRing> createEventRing(int32_t capacity, nsecs_t maxBatchLatencyNs);
     virtual void destroy();
 
     // Count the number of flush complete events which are about to be dropped in the buffer.
@@ -101,8 +104,12 @@ private:
     // emulates the behavior of flush().
     void sendPendingFlushEventsLocked();
 
+    // Writes the events to the event ring of the connection if it has one, or to its socket.
+    ssize_t writeEventsLocked(sensors_event_t const* events, int count);
+
     // Writes events from mEventCache to the socket.
     void writeToSocketFromCache();
+    void writeToSocketFromCacheLocked();
 
     // Compute the approximate cache size from the FIFO sizes of various sensors registered for this
     // connection. Wake up and non-wake up sensors have separate FIFOs but FIFO may be shared
@@ -136,8 +143,12 @@ private:
     void updateLooperRegistration(const sp<Looper>& looper); void
             updateLooperRegistrationLocked(const sp<Looper>& looper);
 
+    // Arms mRingTimerFd for the deferred wake up of the event ring, or to retry writing the cached
+    // events to it, since the reader does not tell when it frees space. Disarms it otherwise.
+    void updateRingTimerLocked();
+
     // Returns whether sensor access is available based on both the uid being active and sensor
-    // privacy not being enabled.
+    // privacy not being enabled. The result is cached until SensorService invalidates it.
     bool hasSensorAccess();
 
     // Call noteOp for the sensor if the sensor requires a permission
@@ -148,6 +159,17 @@ private:
     void uncapRates();
     sp<SensorService> const mService;
     sp<BitTube> mChannel;
+    // The ring the events are delivered through instead of mChannel, if the client created one.
+    // mChannel is still used for the acknowledgements of the wake up events. Protected by
+    // mConnectionLock.
+    sp<SensorEventRing> mEventRing;
+    // The timer which sends the deferred wake ups and the cached events of mEventRing when no
+    // other events follow, registered to the Looper while the connection is. Protected by
+    // mConnectionLock.
+    base::unique_fd mRingTimerFd;
+    bool mHasRingTimerCallback = false;
+    // The time mRingTimerFd is armed for, or 0 if it is disarmed.
+    nsecs_t mRingTimerDeadline = 0;
     uid_t mUid;
     mutable Mutex mConnectionLock;
     // Number of events from wake up sensors which are still pending and haven't been delivered to
@@ -195,6 +217,10 @@ private:
     // Used to track if this object was inappropriately used after destroy().
     std::atomic_bool mDestroyed;
 
+    // The last result of hasSensorAccess() in the low bit, and the SensorService access generation
+    // it was evaluated at in the bits above. It starts out matching no generation.
+    std::atomic<uint64_t> mSensorAccess = UINT64_MAX;
+
     // Store a mapping of sensor handles to required AppOp for a sensor. This map only contains a
     // valid mapping for sensors that require a permission in order to reduce the lookup time.
     std::unordered_map<int32_t, int32_t> mHandleToAppOp;
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_SENSOR_SERVICE_UTIL_SENSOR_EVENT_FIFO_H
+#define ANDROID_SENSOR_SERVICE_UTIL_SENSOR_EVENT_FIFO_H
+
+#include <hardware/sensors.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace android {
+namespace SensorServiceUtil {
+
+/**
+ * A lock-free FIFO between a single writer thread and a single reader thread. It does not block:
+ * the writer writes the events there is room for and the reader reads the events which are
+ * available, and the threads wait for each other by other means.
+ *
+ * The FIFO also tracks its occupancy, for the dumps.
+ */
+template <typename Event>
+class LockFreeFifo final {
+    static_assert(std::is_trivially_copyable_v<Event>);
+
+public:
+    explicit LockFreeFifo(size_t capacity)
+          : mEvents(capacity), mWriteIndex(0), mReadIndex(0), mMaxSize(0), mFullCount(0) {}
+
+    // Writes up to count events, and returns the number of events written. The writer only.
+    size_t write(const Event* events, size_t count) {
+        const size_t writeIndex = mWriteIndex.load(std::memory_order_relaxed);
+        const size_t size = writeIndex - mReadIndex.load(std::memory_order_acquire);
+        const size_t toWrite = std::min(count, mEvents.size() - size);
+        const size_t start = writeIndex % mEvents.size();
+        const size_t firstCount = std::min(toWrite, mEvents.size() - start);
+        memcpy(&mEvents[start], events, firstCount * EVENT_SIZE);
+        memcpy(mEvents.data(), events + firstCount, (toWrite - firstCount) * EVENT_SIZE);
+        mWriteIndex.store(writeIndex + toWrite, std::memory_order_release);
+
+        if (size + toWrite > mMaxSize.load(std::memory_order_relaxed)) {
+            mMaxSize.store(size + toWrite, std::memory_order_relaxed);
+        }
+        if (toWrite < count) {
+            mFullCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        return toWrite;
+    }
+
+    // Reads up to count events, and returns the number of events read. The reader only.
+    size_t read(Event* events, size_t count) {
+        const size_t readIndex = mReadIndex.load(std::memory_order_relaxed);
+        const size_t size = mWriteIndex.load(std::memory_order_acquire) - readIndex;
+        const size_t toRead = std::min(count, size);
+        const size_t start = readIndex % mEvents.size();
+        const size_t firstCount = std::min(toRead, mEvents.size() - start);
+        memcpy(events, &mEvents[start], firstCount * EVENT_SIZE);
+        memcpy(events + firstCount, mEvents.data(), (toRead - firstCount) * EVENT_SIZE);
+        mReadIndex.store(readIndex + toRead, std::memory_order_release);
+        return toRead;
+    }
+
+    size_t size() const {
+        // The read position is loaded first, since it never goes past the write position.
+        const size_t readIndex = mReadIndex.load(std::memory_order_acquire);
+        return mWriteIndex.load(std::memory_order_acquire) - readIndex;
+    }
+
+    bool isFull() const { return size() == mEvents.size(); }
+    size_t capacity() const { return mEvents.size(); }
+
+    // The highest number of events the FIFO held.
+    size_t getMaxSize() const { return mMaxSize.load(std::memory_order_relaxed); }
+
+    // The number of the writes which did not fit in the FIFO.
+    size_t getFullCount() const { return mFullCount.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t EVENT_SIZE = sizeof(Event);
+
+    std::vector<Event> mEvents;
+
+    // The positions only increase, and index the events modulo the capacity.
+    alignas(64) std::atomic<size_t> mWriteIndex;
+    alignas(64) std::atomic<size_t> mReadIndex;
+
+    std::atomic<size_t> mMaxSize;
+    std::atomic<size_t> mFullCount;
+};
+
+using SensorEventFifo = LockFreeFifo<sensors_event_t>;
+
+} // namespace SensorServiceUtil
+} // namespace android
+
+#endif // ANDROID_SENSOR_SERVICE_UTIL_SENSOR_EVENT_FIFO_H
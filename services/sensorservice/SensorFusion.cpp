@@ -71,7 +71,13 @@ SensorFusion::SensorFusion()
         mEstimatedGyroRate = static_cast<float>(value);
         mTargetDelayNs = 1000000000LL / mEstimatedGyroRate;
 
+        // They may also predict the covariance of the fusion once per a few
+        // gyro samples, rather than for each of them.
+        int32_t decimation = property_get_int32(
+            "sensors.aosp_low_power_sensor_fusion.prediction_decimation", 1);
+
         for (int i = 0; i<NUM_FUSION_MODE; ++i) {
+            mFusions[i].setPredictionDecimation(decimation > 0 ? decimation : 1);
             mFusions[i].init(i);
         }
     }
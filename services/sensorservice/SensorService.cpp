@@ -69,6 +69,7 @@
 #include "SensorRecord.h"
 #include "SensorRegistrationInfo.h"
 #include "SensorServiceUtils.h"
+#include "SharedDirectChannel.h"
 
 using namespace std::chrono_literals;
 namespace sensorservice_flags = com::android::frameworks::sensorservice::flags;
@@ -131,6 +132,21 @@ class RuntimeSensorCallbackProxy : public RuntimeSensor::SensorCallback {
     sp<SensorService::RuntimeSensorCallback> mCallback;
 };
 
+class SensorDeviceChannelHal : public SharedDirectChannel::Hal {
+ public:
+    int32_t registerDirectChannel(const sensors_direct_mem_t* memory) override {
+        return SensorDevice::getInstance().registerDirectChannel(memory);
+    }
+    void unregisterDirectChannel(int32_t channelHandle) override {
+        SensorDevice::getInstance().unregisterDirectChannel(channelHandle);
+    }
+    int32_t configureDirectChannel(int32_t sensorHandle, int32_t channelHandle,
+                                   const sensors_direct_cfg_t* config) override {
+        return SensorDevice::getInstance().configureDirectChannel(sensorHandle, channelHandle,
+                                                                  config);
+    }
+};
+
 } // namespace
 
 static bool isAutomotive() {
@@ -498,6 +514,7 @@ void SensorService::onFirstRef() {
 
             // Start watching sensor privacy changes
             mSensorPrivacyPolicy->registerSelf();
+            invalidateSensorAccess();
 
             // Start watching mic sensor privacy changes
             mMicSensorPrivacyPolicy->registerSelf();
@@ -506,6 +523,7 @@ void SensorService::onFirstRef() {
 }
 
 void SensorService::onUidStateChanged(uid_t uid, UidState state) {
+    invalidateSensorAccess();
     SensorDevice& dev(SensorDevice::getInstance());
 
     ConnectionSafeAutolock connLock = mConnectionHolder.lock(mLock);
@@ -525,6 +543,11 @@ void SensorService::onUidStateChanged(uid_t uid, UidState state) {
     checkAndReportProxStateChangeLocked();
 }
 
+void SensorService::invalidateSensorAccess() {
+    // Release, so that a connection which sees the new generation also sees the new state.
+    mSensorAccessGeneration.fetch_add(1, std::memory_order_release);
+}
+
 bool SensorService::hasSensorAccess(uid_t uid, const String16& opPackageName) {
     Mutex::Autolock _l(mLock);
     return hasSensorAccessLocked(uid, opPackageName);
@@ -1739,6 +1762,97 @@ sp<ISensorEventConnection> SensorService::createSensorDirectConnection(
     return conn;
 }
 
+sp<ISensorEventConnection> SensorService::createSharedSensorDirectConnection(
+        const String16& opPackageName, int deviceId, int32_t sensorHandle, int32_t rateLevel,
+        native_handle_t** memory) {
+    resetTargetSdkVersionCache(opPackageName);
+    *memory = nullptr;
+
+    // The shared channels are registered with the HAL, runtime sensors are not supported.
+    if (deviceId != RuntimeSensor::DEFAULT_DEVICE_ID) {
+        ALOGE("Shared direct channels are not supported for device %d", deviceId);
+        return nullptr;
+    }
+
+    std::shared_ptr<SensorInterface> si = getSensorInterfaceFromHandle(sensorHandle);
+    if (si == nullptr || getDeviceIdFromHandle(sensorHandle) != deviceId) {
+        ALOGE("Shared direct channel requested for unknown sensor %#08x", sensorHandle);
+        return nullptr;
+    }
+    const Sensor& s = si->getSensor();
+    if (!canAccessSensor(s, "create shared direct channel", opPackageName)) {
+        return nullptr;
+    }
+    if (rateLevel <= SENSOR_DIRECT_RATE_STOP || rateLevel > s.getHighestDirectReportRateLevel()
+            || !s.isDirectChannelTypeSupported(SENSOR_DIRECT_MEM_TYPE_ASHMEM)) {
+        ALOGE("Sensor %#08x can't be reported at rate level %d in a shared direct channel",
+              sensorHandle, rateLevel);
+        return nullptr;
+    }
+    // The rate of a shared channel is the same for all of its members, so it can't be capped.
+    if (isSensorInCappedSet(s.getType())) {
+        int cappedRateLevel = rateLevel;
+        if (adjustRateLevelBasedOnMicAndPermission(&cappedRateLevel, opPackageName) != OK
+                || cappedRateLevel != rateLevel) {
+            ALOGE("Rate level %d of sensor %#08x is capped for %s", rateLevel, sensorHandle,
+                  String8(opPackageName).c_str());
+            return nullptr;
+        }
+    }
+
+    ConnectionSafeAutolock connLock = mConnectionHolder.lock(mLock);
+
+    // No new direct connections are allowed when sensor privacy is enabled
+    if (mSensorPrivacyPolicy->isSensorPrivacyEnabled()) {
+        ALOGE("Cannot create new direct connections when sensor privacy is enabled");
+        return nullptr;
+    }
+
+    uid_t uid = IPCThreadState::self()->getCallingUid();
+    if (!hasSensorAccessLocked(uid, opPackageName)) {
+        ALOGE("Shared direct channel requested by %s without sensor access",
+              String8(opPackageName).c_str());
+        return nullptr;
+    }
+
+    std::shared_ptr<SharedDirectChannel> channel;
+    for (auto i = mSharedDirectChannels.begin(); i != mSharedDirectChannels.end();) {
+        std::shared_ptr<SharedDirectChannel> existing = i->lock();
+        if (existing == nullptr) {
+            i = mSharedDirectChannels.erase(i);
+            continue;
+        }
+        if (existing->getSensorHandle() == sensorHandle && existing->getRateLevel() == rateLevel) {
+            channel = std::move(existing);
+        }
+        ++i;
+    }
+    if (channel == nullptr) {
+        static SensorDeviceChannelHal sHal;
+        channel = SharedDirectChannel::create(sHal, sensorHandle, rateLevel);
+        if (channel == nullptr) {
+            return nullptr;
+        }
+        mSharedDirectChannels.push_back(channel);
+    }
+
+    native_handle_t *clone = native_handle_clone(channel->getMemory().handle);
+    if (!clone) {
+        return nullptr;
+    }
+
+    // The memory is owned by the channel, and the connection only reports through it.
+    struct sensors_direct_mem_t mem = channel->getMemory();
+    mem.handle = nullptr;
+    sp<SensorDirectConnection> conn = new SensorDirectConnection(this, uid, &mem,
+            channel->getHalChannelHandle(), opPackageName, deviceId, channel);
+
+    // sensor service should never hold pointer or sp of SensorDirectConnection object.
+    mConnectionHolder.addDirectConnection(conn);
+    *memory = clone;
+    return conn;
+}
+
 int SensorService::configureRuntimeSensorDirectChannel(
         int sensorHandle, const SensorDirectConnection* c, const sensors_direct_cfg_t* config) {
     int deviceId = c->getDeviceId();
@@ -1913,7 +2027,9 @@ void SensorService::cleanupConnection(SensorDirectConnection* c) {
     Mutex::Autolock _l(mLock);
 
     int deviceId = c->getDeviceId();
-    if (deviceId == RuntimeSensor::DEFAULT_DEVICE_ID) {
+    if (c->isShared()) {
+        // The HAL channel is unregistered by the shared channel, once it has no members.
+    } else if (deviceId == RuntimeSensor::DEFAULT_DEVICE_ID) {
         SensorDevice& dev(SensorDevice::getInstance());
         dev.unregisterDirectChannel(c->getHalChannelHandle());
     } else {
@@ -2712,6 +2828,7 @@ binder::Status SensorService::SensorPrivacyPolicy::onSensorPrivacyChanged(int to
     sp<SensorService> service = mService.promote();
 
     if (service != nullptr) {
+        service->invalidateSensorAccess();
         if (enabled) {
             service->disableAllSensors();
         } else {
@@ -37,7 +37,9 @@
 #include <utils/Vector.h>
 #include <utils/threads.h>
 
+#include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <unordered_map>
@@ -76,6 +78,7 @@
 namespace android {
 // ---------------------------------------------------------------------------
 class SensorInterface;
+class SharedDirectChannel;
 
 class SensorService :
         public BinderService<SensorService>,
@@ -404,6 +407,9 @@ private:
     virtual sp<ISensorEventConnection> createSensorDirectConnection(const String16& opPackageName,
             int deviceId, uint32_t size, int32_t type, int32_t format,
             const native_handle *resource);
+    virtual sp<ISensorEventConnection> createSharedSensorDirectConnection(
+            const String16& opPackageName, int deviceId, int32_t sensorHandle, int32_t rateLevel,
+            native_handle_t** memory);
     virtual int setOperationParameter(
             int32_t handle, int32_t type, const Vector<float> &floats, const Vector<int32_t> &ints);
     virtual status_t dump(int fd, const Vector<String16>& args);
@@ -497,6 +503,10 @@ private:
     // Sets whether the given UID can get sensor data
     void onUidStateChanged(uid_t uid, UidState state);
 
+    // Makes the event connections evaluate their sensor access again, after the state of a uid or
+    // sensor privacy changed.
+    void invalidateSensorAccess();
+
     // Returns true if a connection with the given uid and opPackageName
     // currently has access to sensors.
     bool hasSensorAccess(uid_t uid, const String16& opPackageName);
@@ -571,6 +581,8 @@ private:
     Mode mCurrentOperatingMode;
     std::queue<sensors_event_t> mRuntimeSensorEventQueue;
     std::unordered_map</*deviceId*/int, sp<RuntimeSensorCallback>> mRuntimeSensorCallbacks;
+    // The channels are owned by the connections which are their members.
+    std::vector<std::weak_ptr<SharedDirectChannel>> mSharedDirectChannels;
 
     // true if the head tracker sensor type is currently restricted to system usage only
     // (can only be unrestricted for testing, via shell cmd)
@@ -587,6 +599,9 @@ private:
 
     sp<UidPolicy> mUidPolicy;
     sp<SensorPrivacyPolicy> mSensorPrivacyPolicy;
+    // Incremented whenever the sensor access of the event connections may have changed. The
+    // connections cache their access along with the generation it was evaluated at.
+    std::atomic<uint32_t> mSensorAccessGeneration = 0;
 
     static AppOpsManager sAppOpsManager;
     static std::map<String16, int> sPackageTargetVersion;
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SharedDirectChannel.h"
+
+#include <cutils/ashmem.h>
+#include <cutils/native_handle.h>
+#include <errno.h>
+#include <log/log.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utils/Errors.h>
+
+namespace android {
+
+std::shared_ptr<SharedDirectChannel> SharedDirectChannel::create(Hal& hal, int32_t sensorHandle,
+                                                                 int rateLevel) {
+    const size_t size = EVENT_COUNT * sizeof(sensors_event_t);
+    int fd = ashmem_create_region("SensorSharedDirectChannel", size);
+    if (fd < 0) {
+        ALOGE("Cannot create the shared direct channel memory: %s", strerror(errno));
+        return nullptr;
+    }
+
+    native_handle_t* handle = native_handle_create(1, 0);
+    if (handle == nullptr) {
+        close(fd);
+        return nullptr;
+    }
+    handle->data[0] = fd;
+
+    struct sensors_direct_mem_t mem = {
+        .type = SENSOR_DIRECT_MEM_TYPE_ASHMEM,
+        .format = SENSOR_DIRECT_FMT_SENSORS_EVENT,
+        .size = size,
+        .handle = handle,
+    };
+    int32_t channelHandle = hal.registerDirectChannel(&mem);
+    if (channelHandle <= 0) {
+        ALOGE("registerDirectChannel returns %d", channelHandle);
+        native_handle_close(handle);
+        native_handle_delete(handle);
+        return nullptr;
+    }
+
+    // The HAL has mapped the memory for writing, the members can only map it for reading.
+    if (ashmem_set_prot_region(fd, PROT_READ) != 0) {
+        ALOGE("Cannot make the shared direct channel memory read-only: %s", strerror(errno));
+        hal.unregisterDirectChannel(channelHandle);
+        native_handle_close(handle);
+        native_handle_delete(handle);
+        return nullptr;
+    }
+
+    return std::shared_ptr<SharedDirectChannel>(
+            new SharedDirectChannel(hal, sensorHandle, rateLevel, mem, channelHandle));
+}
+
+SharedDirectChannel::SharedDirectChannel(Hal& hal, int32_t sensorHandle, int rateLevel,
+                                         const sensors_direct_mem_t& mem,
+                                         int32_t halChannelHandle)
+      : mHal(hal),
+        mSensorHandle(sensorHandle),
+        mRateLevel(rateLevel),
+        mMem(mem),
+        mHalChannelHandle(halChannelHandle),
+        mIsReporting(false),
+        mReportToken(0) {}
+
+SharedDirectChannel::~SharedDirectChannel() {
+    if (mIsReporting) {
+        const struct sensors_direct_cfg_t config = {.rate_level = SENSOR_DIRECT_RATE_STOP};
+        mHal.configureDirectChannel(mSensorHandle, mHalChannelHandle, &config);
+    }
+    mHal.unregisterDirectChannel(mHalChannelHandle);
+    native_handle_t* handle = const_cast<native_handle_t*>(mMem.handle);
+    native_handle_close(handle);
+    native_handle_delete(handle);
+}
+
+int SharedDirectChannel::setMemberActive(const void* member, bool active) {
+    std::lock_guard<std::mutex> lock(mLock);
+    Member& state = mMembers[member];
+    if (active && isHeldBackLocked()) {
+        state.active = false;
+        return PERMISSION_DENIED;
+    }
+    state.active = active;
+    int ret = updateLocked();
+    if (ret < 0) {
+        state.active = false;
+    }
+    return ret;
+}
+
+void SharedDirectChannel::setMemberAccess(const void* member, bool hasAccess) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mMembers[member].hasAccess = hasAccess;
+    updateLocked();
+}
+
+void SharedDirectChannel::setMemberRateCapped(const void* member, bool isRateCapped) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mMembers[member].isRateCapped = isRateCapped;
+    updateLocked();
+}
+
+void SharedDirectChannel::removeMember(const void* member) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mMembers.erase(member);
+    updateLocked();
+}
+
+bool SharedDirectChannel::isHeldBackLocked() const {
+    for (const auto& [member, state] : mMembers) {
+        if (!state.hasAccess || state.isRateCapped) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int SharedDirectChannel::updateLocked() {
+    bool hasActiveMember = false;
+    for (const auto& [member, state] : mMembers) {
+        hasActiveMember |= state.active;
+    }
+    const bool shouldReport = hasActiveMember && !isHeldBackLocked();
+    if (shouldReport == mIsReporting) {
+        return mIsReporting ? mReportToken : NO_ERROR;
+    }
+
+    const struct sensors_direct_cfg_t config = {
+        .rate_level = shouldReport ? mRateLevel : SENSOR_DIRECT_RATE_STOP
+    };
+    int ret = mHal.configureDirectChannel(mSensorHandle, mHalChannelHandle, &config);
+    if (shouldReport) {
+        if (ret <= 0) {
+            ALOGE("Cannot start the shared direct channel of sensor %#08x: %d", mSensorHandle, ret);
+            return ret < 0 ? ret : UNKNOWN_ERROR;
+        }
+        mReportToken = ret;
+    }
+    mIsReporting = shouldReport;
+    return mIsReporting ? mReportToken : NO_ERROR;
+}
+
+} // namespace android
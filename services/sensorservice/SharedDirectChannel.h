@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_SHARED_DIRECT_CHANNEL_H
+#define ANDROID_SHARED_DIRECT_CHANNEL_H
+
+#include <hardware/sensors.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace android {
+
+/**
+ * A direct channel of the sensor service, whose HAL reports one sensor at one rate level into
+ * an ashmem region which is mapped read-only by each of its members, instead of each client
+ * registering its own channel for the same sensor and rate.
+ *
+ * The mapping of a member can't be revoked, so the sensor is reported only while every member
+ * has the access to it and none is capped below the rate level. Otherwise the channel stops for
+ * all of its members, and resumes once none of them holds it back.
+ */
+class SharedDirectChannel final {
+public:
+    // The calls into the sensor HAL, which tests replace.
+    class Hal {
+    public:
+        virtual ~Hal() = default;
+        virtual int32_t registerDirectChannel(const sensors_direct_mem_t* memory) = 0;
+        virtual void unregisterDirectChannel(int32_t channelHandle) = 0;
+        virtual int32_t configureDirectChannel(int32_t sensorHandle, int32_t channelHandle,
+                                               const sensors_direct_cfg_t* config) = 0;
+    };
+
+    // The number of events the shared memory holds.
+    static constexpr size_t EVENT_COUNT = 2048;
+
+    // Registers the channel with the HAL, and returns null on failure. The HAL must outlive the
+    // channel.
+    static std::shared_ptr<SharedDirectChannel> create(Hal& hal, int32_t sensorHandle,
+                                                       int rateLevel);
+    ~SharedDirectChannel();
+
+    int32_t getSensorHandle() const { return mSensorHandle; }
+    int getRateLevel() const { return mRateLevel; }
+    int32_t getHalChannelHandle() const { return mHalChannelHandle; }
+    const sensors_direct_mem_t& getMemory() const { return mMem; }
+
+    // Starts or stops the reporting for the member. Returns the report token of the HAL when the
+    // sensor is reported, NO_ERROR when it is not, or an error. Fails with PERMISSION_DENIED for
+    // an activation while a member holds the channel back.
+    int setMemberActive(const void* member, bool active);
+
+    // A member without the access to the sensor, or capped below the rate level of the channel,
+    // holds back the reporting for all of the members.
+    void setMemberAccess(const void* member, bool hasAccess);
+    void setMemberRateCapped(const void* member, bool isRateCapped);
+
+    void removeMember(const void* member);
+
+private:
+    struct Member {
+        bool active = false;
+        bool hasAccess = true;
+        bool isRateCapped = false;
+    };
+
+    SharedDirectChannel(Hal& hal, int32_t sensorHandle, int rateLevel,
+                        const sensors_direct_mem_t& mem, int32_t halChannelHandle);
+
+    // Whether a member keeps the sensor from being reported to any of them.
+    bool isHeldBackLocked() const;
+
+    // Starts or stops the reporting of the HAL for the state of the members.
+    int updateLocked();
+
+    Hal& mHal;
+    const int32_t mSensorHandle;
+    const int mRateLevel;
+    const sensors_direct_mem_t mMem;
+    const int32_t mHalChannelHandle;
+
+    // A leaf lock, which is never held while calling into the sensor service.
+    std::mutex mLock;
+    std::map<const void*, Member> mMembers;
+    bool mIsReporting;
+    int mReportToken;
+};
+
+} // namespace android
+
+#endif // ANDROID_SHARED_DIRECT_CHANNEL_H
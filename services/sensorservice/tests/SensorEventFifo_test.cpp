@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <SensorEventFifo.h>
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace {
+
+using SensorServiceUtil::SensorEventFifo;
+
+std::vector<sensors_event_t> makeEvents(size_t count, int64_t firstTimestamp = 0) {
+    std::vector<sensors_event_t> events(count);
+    for (size_t i = 0; i < count; i++) {
+        events[i].timestamp = firstTimestamp + static_cast<int64_t>(i);
+    }
+    return events;
+}
+
+TEST(SensorEventFifoTest, readsEventsInOrder) {
+    SensorEventFifo fifo(8);
+    const std::vector<sensors_event_t> events = makeEvents(5);
+    EXPECT_EQ(5u, fifo.write(events.data(), events.size()));
+    EXPECT_EQ(5u, fifo.size());
+
+    std::vector<sensors_event_t> read(8);
+    EXPECT_EQ(3u, fifo.read(read.data(), 3));
+    EXPECT_EQ(2u, fifo.read(read.data() + 3, read.size() - 3));
+    for (size_t i = 0; i < events.size(); i++) {
+        EXPECT_EQ(events[i].timestamp, read[i].timestamp);
+    }
+    EXPECT_EQ(0u, fifo.size());
+    EXPECT_EQ(0u, fifo.read(read.data(), read.size()));
+}
+
+TEST(SensorEventFifoTest, wrapsAround) {
+    SensorEventFifo fifo(4);
+    std::vector<sensors_event_t> read(4);
+    for (int64_t timestamp = 0; timestamp < 20; timestamp += 3) {
+        const std::vector<sensors_event_t> events = makeEvents(3, timestamp);
+        ASSERT_EQ(3u, fifo.write(events.data(), events.size()));
+        ASSERT_EQ(3u, fifo.read(read.data(), read.size()));
+        for (size_t i = 0; i < events.size(); i++) {
+            EXPECT_EQ(timestamp + static_cast<int64_t>(i), read[i].timestamp);
+        }
+    }
+}
+
+TEST(SensorEventFifoTest, writesWhatFits) {
+    SensorEventFifo fifo(4);
+    const std::vector<sensors_event_t> events = makeEvents(6);
+    EXPECT_EQ(4u, fifo.write(events.data(), events.size()));
+    EXPECT_TRUE(fifo.isFull());
+    EXPECT_EQ(0u, fifo.write(events.data() + 4, 2));
+
+    EXPECT_EQ(4u, fifo.getMaxSize());
+    EXPECT_EQ(2u, fifo.getFullCount());
+}
+
+// A writer and a reader thread exchange events in batches of varying sizes. The reader sees
+// every event once, in order.
+TEST(SensorEventFifoTest, exchangesEventsBetweenThreads) {
+    constexpr size_t kEventCount = 1000000;
+    constexpr size_t kMaxBatch = 37;
+    SensorEventFifo fifo(64);
+    const std::vector<sensors_event_t> events = makeEvents(kEventCount);
+
+    std::thread writer([&] {
+        size_t written = 0;
+        for (size_t batch = 1; written < kEventCount; batch = batch % kMaxBatch + 1) {
+            const size_t count = std::min(batch, kEventCount - written);
+            written += fifo.write(events.data() + written, count);
+            if (fifo.isFull()) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::vector<sensors_event_t> read(kMaxBatch);
+    size_t readCount = 0;
+    size_t outOfOrderCount = 0;
+    for (size_t batch = kMaxBatch; readCount < kEventCount; batch = batch % kMaxBatch + 1) {
+        const size_t count = fifo.read(read.data(), batch);
+        for (size_t i = 0; i < count; i++) {
+            if (read[i].timestamp != static_cast<int64_t>(readCount + i)) {
+                outOfOrderCount++;
+            }
+        }
+        readCount += count;
+        if (count == 0) {
+            std::this_thread::yield();
+        }
+    }
+    writer.join();
+
+    EXPECT_EQ(0u, outOfOrderCount);
+    EXPECT_EQ(0u, fifo.size());
+    EXPECT_LE(fifo.getMaxSize(), fifo.capacity());
+}
+
+} // namespace
+} // namespace android
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <SharedDirectChannel.h>
+
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <utils/Errors.h>
+
+#include <vector>
+
+namespace android {
+namespace {
+
+constexpr int32_t kSensorHandle = 1;
+constexpr int32_t kHalChannelHandle = 7;
+constexpr int32_t kReportToken = 3;
+
+// Records the rate levels the channel configures, instead of calling into a sensor HAL. Like a
+// HAL, it maps the memory for writing when the channel is registered.
+class FakeHal : public SharedDirectChannel::Hal {
+public:
+    ~FakeHal() override {
+        if (mEvents != nullptr) {
+            munmap(mEvents, mSize);
+        }
+    }
+
+    int32_t registerDirectChannel(const sensors_direct_mem_t* memory) override {
+        void* events = mmap(nullptr, memory->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                            memory->handle->data[0], 0);
+        EXPECT_NE(MAP_FAILED, events);
+        if (events != MAP_FAILED) {
+            mEvents = static_cast<sensors_event_t*>(events);
+            mSize = memory->size;
+        }
+        return kHalChannelHandle;
+    }
+    void unregisterDirectChannel(int32_t channelHandle) override {
+        EXPECT_EQ(kHalChannelHandle, channelHandle);
+        unregistered = true;
+    }
+    int32_t configureDirectChannel(int32_t sensorHandle, int32_t channelHandle,
+                                   const sensors_direct_cfg_t* config) override {
+        EXPECT_EQ(kSensorHandle, sensorHandle);
+        EXPECT_EQ(kHalChannelHandle, channelHandle);
+        rateLevels.push_back(config->rate_level);
+        mIsReporting = config->rate_level != SENSOR_DIRECT_RATE_STOP;
+        return mIsReporting ? kReportToken : NO_ERROR;
+    }
+
+    // Writes the next event into the memory if the sensor is reported.
+    void report() {
+        if (mIsReporting && mEvents != nullptr) {
+            mSequence++;
+            mEvents[0] = {.version = sizeof(sensors_event_t),
+                          .sensor = kSensorHandle,
+                          .reserved0 = static_cast<int32_t>(mSequence)};
+        }
+    }
+
+    std::vector<int> rateLevels;
+    bool unregistered = false;
+
+private:
+    sensors_event_t* mEvents = nullptr;
+    size_t mSize = 0;
+    bool mIsReporting = false;
+    uint32_t mSequence = 0;
+};
+
+class SharedDirectChannelTest : public testing::Test {
+protected:
+    void SetUp() override {
+        mChannel = SharedDirectChannel::create(mHal, kSensorHandle, SENSOR_DIRECT_RATE_VERY_FAST);
+        ASSERT_NE(nullptr, mChannel);
+    }
+
+    FakeHal mHal;
+    std::shared_ptr<SharedDirectChannel> mChannel;
+    const int mFirst = 0;
+    const int mSecond = 0;
+};
+
+TEST_F(SharedDirectChannelTest, reportsWhileAnyMemberIsActive) {
+    EXPECT_EQ(kReportToken, mChannel->setMemberActive(&mFirst, true));
+    EXPECT_EQ(kReportToken, mChannel->setMemberActive(&mSecond, true));
+    EXPECT_EQ(std::vector<int>{SENSOR_DIRECT_RATE_VERY_FAST}, mHal.rateLevels);
+
+    mChannel->removeMember(&mFirst);
+    EXPECT_EQ(std::vector<int>{SENSOR_DIRECT_RATE_VERY_FAST}, mHal.rateLevels);
+
+    EXPECT_EQ(NO_ERROR, mChannel->setMemberActive(&mSecond, false));
+    EXPECT_EQ((std::vector<int>{SENSOR_DIRECT_RATE_VERY_FAST, SENSOR_DIRECT_RATE_STOP}),
+              mHal.rateLevels);
+
+    EXPECT_EQ(kReportToken, mChannel->setMemberActive(&mSecond, true));
+    mChannel->removeMember(&mSecond);
+    EXPECT_EQ((std::vector<int>{SENSOR_DIRECT_RATE_VERY_FAST, SENSOR_DIRECT_RATE_STOP,
+                                SENSOR_DIRECT_RATE_VERY_FAST, SENSOR_DIRECT_RATE_STOP}),
+              mHal.rateLevels);
+}
+
+TEST_F(SharedDirectChannelTest, memberWithoutAccessHoldsBackAll) {
+    EXPECT_EQ(kReportToken, mChannel->setMemberActive(&mFirst, true));
+    EXPECT_EQ(kReportToken, mChannel->setMemberActive(&mSecond, true));
+
+    mChannel->setMemberAccess(&mFirst, false);
+    EXPECT_EQ((std::vector<int>{SENSOR_DIRECT_RATE_VERY_FAST, SENSOR_DIRECT_RATE_STOP}),
+              mHal.rateLevels);
+
+    // Nobody can start the channel again while it is held back
+    EXPECT_EQ(PERMISSION_DENIED, mChannel->setMemberActive(&mSecond, true));
+    EXPECT_EQ(PERMISSION_DENIED, mChannel->setMemberActive(&mFirst, true));
+
+    // The members can activate again once the access is regained
+    mChannel->setMemberAccess(&mFirst, true);
+    EXPECT_EQ((std::vector<int>{SENSOR_DIRECT_RATE_VERY_FAST, SENSOR_DIRECT_RATE_STOP}),
+              mHal.rateLevels);
+    EXPECT_EQ(kReportToken, mChannel->setMemberActive(&mSecond, true));
+    EXPECT_EQ((std::vector<int>{SENSOR_DIRECT_RATE_VERY_FAST, SENSOR_DIRECT_RATE_STOP,
+                                SENSOR_DIRECT_RATE_VERY_FAST}),
+              mHal.rateLevels);
+}
+
+TEST_F(SharedDirectChannelTest, rateCappedMemberHoldsBackAll) {
+    EXPECT_EQ(kReportToken, mChannel->setMemberActive(&mFirst, true));
+    EXPECT_EQ(kReportToken, mChannel->setMemberActive(&mSecond, true));
+
+    mChannel->setMemberRateCapped(&mSecond, true);
+    EXPECT_EQ((std::vector<int>{SENSOR_DIRECT_RATE_VERY_FAST, SENSOR_DIRECT_RATE_STOP}),
+              mHal.rateLevels);
+
+    mChannel->setMemberRateCapped(&mSecond, false);
+    EXPECT_EQ((std::vector<int>{SENSOR_DIRECT_RATE_VERY_FAST, SENSOR_DIRECT_RATE_STOP,
+                                SENSOR_DIRECT_RATE_VERY_FAST}),
+              mHal.rateLevels);
+}
+
+TEST_F(SharedDirectChannelTest, removingHoldingBackMemberResumes) {
+    EXPECT_EQ(kReportToken, mChannel->setMemberActive(&mFirst, true));
+    mChannel->setMemberAccess(&mSecond, false);
+    mChannel->removeMember(&mSecond);
+    EXPECT_EQ((std::vector<int>{SENSOR_DIRECT_RATE_VERY_FAST, SENSOR_DIRECT_RATE_STOP,
+                                SENSOR_DIRECT_RATE_VERY_FAST}),
+              mHal.rateLevels);
+}
+
+TEST_F(SharedDirectChannelTest, memberWithoutAccessStopsReceivingData) {
+    const sensors_direct_mem_t& mem = mChannel->getMemory();
+    void* mapping = mmap(nullptr, mem.size, PROT_READ, MAP_SHARED, mem.handle->data[0], 0);
+    ASSERT_NE(MAP_FAILED, mapping);
+    const volatile sensors_event_t* event = static_cast<const sensors_event_t*>(mapping);
+
+    EXPECT_EQ(kReportToken, mChannel->setMemberActive(&mFirst, true));
+    EXPECT_EQ(kReportToken, mChannel->setMemberActive(&mSecond, true));
+    mHal.report();
+    EXPECT_EQ(1, event->reserved0);
+
+    // The mapping of the member can't be revoked, but nothing is written into it anymore
+    mChannel->setMemberAccess(&mFirst, false);
+    mHal.report();
+    mHal.report();
+    EXPECT_EQ(1, event->reserved0);
+
+    mChannel->setMemberAccess(&mFirst, true);
+    EXPECT_EQ(kReportToken, mChannel->setMemberActive(&mFirst, true));
+    mHal.report();
+    EXPECT_EQ(2, event->reserved0);
+
+    munmap(mapping, mem.size);
+}
+
+TEST_F(SharedDirectChannelTest, unregistersWhenReleased) {
+    EXPECT_EQ(kReportToken, mChannel->setMemberActive(&mFirst, true));
+    mChannel.reset();
+    EXPECT_EQ((std::vector<int>{SENSOR_DIRECT_RATE_VERY_FAST, SENSOR_DIRECT_RATE_STOP}),
+              mHal.rateLevels);
+    EXPECT_TRUE(mHal.unregistered);
+}
+
+TEST_F(SharedDirectChannelTest, membersMapMemoryReadOnly) {
+    const sensors_direct_mem_t& mem = mChannel->getMemory();
+    ASSERT_EQ(SENSOR_DIRECT_MEM_TYPE_ASHMEM, mem.type);
+    ASSERT_EQ(SharedDirectChannel::EVENT_COUNT * sizeof(sensors_event_t), mem.size);
+    const int fd = mem.handle->data[0];
+
+    void* writable = mmap(nullptr, mem.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    EXPECT_EQ(MAP_FAILED, writable);
+    if (writable != MAP_FAILED) {
+        munmap(writable, mem.size);
+    }
+
+    void* readable = mmap(nullptr, mem.size, PROT_READ, MAP_SHARED, fd, 0);
+    ASSERT_NE(MAP_FAILED, readable);
+    munmap(readable, mem.size);
+}
+
+} // namespace
+} // namespace android
@@ -19,7 +19,12 @@
 #define LOG_TAG "BackgroundExecutor"
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <android-base/stringprintf.h>
+#include <inttypes.h>
+#include <sys/resource.h>
+#include <system/thread_defs.h>
 #include <utils/Log.h>
+#include <condition_variable>
 #include <mutex>
 
 #include "BackgroundExecutor.h"
@@ -29,49 +34,88 @@ namespace android {
 ANDROID_SINGLETON_STATIC_INSTANCE(BackgroundExecutor);
 
 BackgroundExecutor::BackgroundExecutor() : Singleton<BackgroundExecutor>() {
-    // mSemaphore must be initialized before any calls to
-    // BackgroundExecutor::sendCallbacks. For this reason, we initialize it
-    // within the constructor instead of within mThread.
-    LOG_ALWAYS_FATAL_IF(sem_init(&mSemaphore, 0, 0), "sem_init failed");
-    mThread = std::thread([&]() {
-        while (!mDone) {
-            LOG_ALWAYS_FATAL_IF(sem_wait(&mSemaphore), "sem_wait failed (%d)", errno);
-            auto callbacks = mCallbacksQueue.pop();
-            if (!callbacks) {
-                continue;
-            }
-            for (auto& callback : *callbacks) {
-                callback();
-            }
+    // The semaphores must be initialized before any calls to
+    // BackgroundExecutor::sendCallbacks. For this reason, we initialize them
+    // within the constructor instead of within the threads.
+    for (Lane& lane : mLanes) {
+        LOG_ALWAYS_FATAL_IF(sem_init(&lane.semaphore, 0, 0), "sem_init failed");
+    }
+    Lane& highLane = mLanes[static_cast<size_t>(Priority::High)];
+    highLane.thread = std::thread([this, &highLane]() {
+        if (setpriority(PRIO_PROCESS, 0, ANDROID_PRIORITY_DISPLAY)) {
+            ALOGW("Failed to raise the priority of the high priority lane (%d)", errno);
         }
+        run(highLane);
     });
+    pthread_setname_np(highLane.thread.native_handle(), "BgExecutorHigh");
+    Lane& normalLane = mLanes[static_cast<size_t>(Priority::Normal)];
+    normalLane.thread = std::thread([this, &normalLane]() { run(normalLane); });
+    pthread_setname_np(normalLane.thread.native_handle(), "BgExecutor");
 }
 
 BackgroundExecutor::~BackgroundExecutor() {
     mDone = true;
-    LOG_ALWAYS_FATAL_IF(sem_post(&mSemaphore), "sem_post failed");
-    if (mThread.joinable()) {
-        mThread.join();
-        LOG_ALWAYS_FATAL_IF(sem_destroy(&mSemaphore), "sem_destroy failed");
+    for (Lane& lane : mLanes) {
+        LOG_ALWAYS_FATAL_IF(sem_post(&lane.semaphore), "sem_post failed");
+    }
+    for (Lane& lane : mLanes) {
+        if (lane.thread.joinable()) {
+            lane.thread.join();
+            LOG_ALWAYS_FATAL_IF(sem_destroy(&lane.semaphore), "sem_destroy failed");
+        }
     }
 }
 
-void BackgroundExecutor::sendCallbacks(Callbacks&& tasks) {
-    mCallbacksQueue.push(std::move(tasks));
-    LOG_ALWAYS_FATAL_IF(sem_post(&mSemaphore), "sem_post failed");
+void BackgroundExecutor::run(Lane& lane) {
+    while (!mDone) {
+        LOG_ALWAYS_FATAL_IF(sem_wait(&lane.semaphore), "sem_wait failed (%d)", errno);
+        // A job may be published after the jobs which were queued behind it, and then be popped
+        // on the wakeup of another one, so drain the lane on each wakeup.
+        while (auto job = lane.queue.pop()) {
+            const nsecs_t latency = systemTime() - job->queueTime;
+            if (latency > lane.maxLatency.load(std::memory_order_relaxed)) {
+                lane.maxLatency.store(latency, std::memory_order_relaxed);
+            }
+            for (auto& callback : job->callbacks) {
+                callback();
+            }
+            lane.callbackCount.fetch_add(job->callbacks.size(), std::memory_order_relaxed);
+        }
+    }
+}
+
+void BackgroundExecutor::sendCallbacks(Priority priority, Callbacks&& tasks) {
+    Lane& lane = mLanes[static_cast<size_t>(priority)];
+    lane.queue.push({std::move(tasks), systemTime()});
+    LOG_ALWAYS_FATAL_IF(sem_post(&lane.semaphore), "sem_post failed");
 }
 
 void BackgroundExecutor::flushQueue() {
     std::mutex mutex;
     std::condition_variable cv;
-    bool flushComplete = false;
-    sendCallbacks({[&]() {
-        std::scoped_lock lock{mutex};
-        flushComplete = true;
-        cv.notify_one();
-    }});
+    size_t flushedLanes = 0;
+    for (size_t i = 0; i < kLaneCount; i++) {
+        sendCallbacks(static_cast<Priority>(i), {[&]() {
+                          std::scoped_lock lock{mutex};
+                          flushedLanes++;
+                          cv.notify_one();
+                      }});
+    }
     std::unique_lock<std::mutex> lock{mutex};
-    cv.wait(lock, [&]() { return flushComplete; });
+    cv.wait(lock, [&]() { return flushedLanes == kLaneCount; });
+}
+
+void BackgroundExecutor::dump(std::string& result) const {
+    constexpr const char* kLaneNames[kLaneCount] = {"high", "normal"};
+    for (size_t i = 0; i < kLaneCount; i++) {
+        const Lane& lane = mLanes[i];
+        base::StringAppendF(&result,
+                            "  %-6s lane: %" PRIu64 " callbacks, max latency %.3f ms, "
+                            "max queued %zu, overflowed %zu\n",
+                            kLaneNames[i], lane.callbackCount.load(std::memory_order_relaxed),
+                            ns2us(lane.maxLatency.load(std::memory_order_relaxed)) / 1000.0,
+                            lane.queue.getMaxOccupancy(), lane.queue.getOverflowCount());
+    }
 }
 
 } // namespace android
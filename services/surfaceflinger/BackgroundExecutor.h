@@ -19,29 +19,64 @@
 #include <ftl/small_vector.h>
 #include <semaphore.h>
 #include <utils/Singleton.h>
+#include <utils/Timers.h>
+#include <array>
+#include <atomic>
+#include <string>
 #include <thread>
 
-#include "LocklessQueue.h"
+#include "BoundedLocklessQueue.h"
 
 namespace android {
 
 // Executes tasks off the main thread.
+//
+// Each priority has a lane with a worker thread of its own, so the tasks of a lane only queue behind
+// the tasks of the same lane, which run in the order they were sent.
 class BackgroundExecutor : public Singleton<BackgroundExecutor> {
 public:
     BackgroundExecutor();
     ~BackgroundExecutor();
     using Callbacks = ftl::SmallVector<std::function<void()>, 10>;
+
+    enum class Priority {
+        // For work which holds resources of clients until it runs, such as buffer releases and
+        // transaction callbacks. Its worker runs at display priority.
+        High,
+        Normal,
+    };
+
     // Queues callbacks onto a work queue to be executed by a background thread.
     // This is safe to call from multiple threads.
-    void sendCallbacks(Callbacks&& tasks);
+    void sendCallbacks(Callbacks&& tasks) { sendCallbacks(Priority::Normal, std::move(tasks)); }
+    void sendCallbacks(Priority, Callbacks&& tasks);
+    // Waits for the callbacks which were sent to any lane before the call to run.
     void flushQueue();
 
+    // Dumps how many callbacks each lane ran, and the longest time they waited to run.
+    void dump(std::string& result) const;
+
 private:
-    sem_t mSemaphore;
-    std::atomic_bool mDone = false;
+    static constexpr size_t kLaneCount = 2;
 
-    LocklessQueue<Callbacks> mCallbacksQueue;
-    std::thread mThread;
+    struct Job {
+        Callbacks callbacks;
+        nsecs_t queueTime;
+    };
+
+    struct Lane {
+        sem_t semaphore;
+        // Avoids allocating for each batch of callbacks, unless many are sent at once.
+        BoundedLocklessQueue<Job, 32> queue;
+        std::thread thread;
+        std::atomic<uint64_t> callbackCount = 0;
+        std::atomic<nsecs_t> maxLatency = 0;
+    };
+
+    void run(Lane&);
+
+    std::atomic_bool mDone = false;
+    std::array<Lane, kLaneCount> mLanes;
 };
 
 } // namespace android
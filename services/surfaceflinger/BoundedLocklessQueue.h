@@ -0,0 +1,147 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "LocklessQueue.h"
+
+// Multi producer single consumer FIFO queue, which holds up to Capacity values in a ring of
+// preallocated cells so that push and pop don't allocate.
+//
+// The ring follows Dmitry Vyukov's bounded queue. Each cell has a sequence number, which tells
+// whether the cell is free for the push at its position, or holds the value for the pop at its
+// position. Producers claim a position with a compare_exchange on mPushPosition, construct the
+// value in the cell, and then publish it by advancing the sequence of the cell. The single consumer
+// takes the value once it is published, and advances the sequence to free the cell for the push
+// one lap later.
+//
+// Once the ring is full, values go to an unbounded LocklessQueue instead, until the consumer has
+// popped all of them. Values which a producer pushes in the meantime go there too, so the values
+// of each producer are popped in the order they were pushed.
+template <typename T, size_t Capacity>
+class BoundedLocklessQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+public:
+    BoundedLocklessQueue() : mCells(std::make_unique<Cell[]>(Capacity)) {
+        for (size_t i = 0; i < Capacity; i++) {
+            mCells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool isEmpty() const {
+        return mPushPosition.load(std::memory_order_acquire) ==
+                mPopPosition.load(std::memory_order_acquire) &&
+                mOverflowSize.load(std::memory_order_acquire) == 0;
+    }
+
+    void push(T value) {
+        if (mOverflowSize.load(std::memory_order_acquire) > 0 || !tryPushToRing(value)) {
+            mOverflowSize.fetch_add(1, std::memory_order_acq_rel);
+            mOverflowCount.fetch_add(1, std::memory_order_relaxed);
+            mOverflow.push(std::move(value));
+        }
+    }
+
+    std::optional<T> pop() {
+        const size_t position = mPopPosition.load(std::memory_order_relaxed);
+        Cell& cell = mCells[position & (Capacity - 1)];
+        if (cell.sequence.load(std::memory_order_acquire) == position + 1) {
+            std::optional<T> value = std::move(cell.value);
+            cell.value.reset();
+            cell.sequence.store(position + Capacity, std::memory_order_release);
+            mPopPosition.store(position + 1, std::memory_order_release);
+            return value;
+        }
+
+        // The ring is empty, or its next value is still being pushed.
+        std::optional<T> value = mOverflow.pop();
+        if (value) {
+            mOverflowSize.fetch_sub(1, std::memory_order_acq_rel);
+        }
+        return value;
+    }
+
+    // The number of values in the ring, at most Capacity.
+    size_t getOccupancy() const {
+        return mPushPosition.load(std::memory_order_relaxed) -
+                mPopPosition.load(std::memory_order_relaxed);
+    }
+
+    // The largest occupancy of the ring so far.
+    size_t getMaxOccupancy() const { return mMaxOccupancy.load(std::memory_order_relaxed); }
+
+    // The number of values which were pushed to the overflow queue so far.
+    size_t getOverflowCount() const { return mOverflowCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        std::optional<T> value;
+    };
+
+    bool tryPushToRing(T& value) {
+        size_t position = mPushPosition.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &mCells[position & (Capacity - 1)];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t difference =
+                    static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (mPushPosition.compare_exchange_weak(position, position + 1,
+                                                        std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                // The cell still holds the value of the previous lap.
+                return false;
+            } else {
+                position = mPushPosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value.emplace(std::move(value));
+        cell->sequence.store(position + 1, std::memory_order_release);
+
+        const size_t occupancy =
+                std::min(position + 1 - mPopPosition.load(std::memory_order_relaxed), Capacity);
+        size_t maxOccupancy = mMaxOccupancy.load(std::memory_order_relaxed);
+        while (occupancy > maxOccupancy &&
+               !mMaxOccupancy.compare_exchange_weak(maxOccupancy, occupancy,
+                                                    std::memory_order_relaxed)) {
+        }
+        return true;
+    }
+
+    const std::unique_ptr<Cell[]> mCells;
+    // Producers and the consumer advance their positions on separate cache lines.
+    alignas(64) std::atomic<size_t> mPushPosition = 0;
+    alignas(64) std::atomic<size_t> mPopPosition = 0;
+
+    LocklessQueue<T> mOverflow;
+    // The values in mOverflow, which a producer increments before pushing to it.
+    std::atomic<size_t> mOverflowSize = 0;
+    std::atomic<size_t> mOverflowCount = 0;
+    std::atomic<size_t> mMaxOccupancy = 0;
+};
@@ -22,8 +22,10 @@
 #include <cinttypes>
 
 #include <android-base/stringprintf.h>
+#include <gui/ITransactionCompletedListener.h>
 #include <gui/TraceUtils.h>
 #include <renderengine/impl/ExternalTexture.h>
+#include <ui/PixelFormat.h>
 
 #include "ClientCache.h"
 
@@ -31,6 +33,21 @@ namespace android {
 
 ANDROID_SINGLETON_STATIC_INSTANCE(ClientCache);
 
+namespace {
+
+// The formats without a fixed number of bytes per pixel, e.g. the YUV ones, are counted as two
+// bytes per pixel.
+uint64_t getBufferBytes(const GraphicBuffer& buffer) {
+    uint32_t bytesPerPixelOrDefault = bytesPerPixel(buffer.getPixelFormat());
+    if (bytesPerPixelOrDefault == 0) {
+        bytesPerPixelOrDefault = 2;
+    }
+    return static_cast<uint64_t>(buffer.getStride()) * buffer.getHeight() *
+            buffer.getLayerCount() * bytesPerPixelOrDefault;
+}
+
+} // namespace
+
 ClientCache::ClientCache() : mDeathRecipient(sp<CacheDeathRecipient>::make()) {}
 
 bool ClientCache::getBuffer(const client_cache_t& cacheId,
@@ -72,7 +89,8 @@ ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer)
         return base::unexpected(AddError::Unspecified);
     }
 
-    std::lock_guard lock(mMutex);
+    std::unique_lock lock(mMutex);
+    base::ScopedLockAssertion assumeLock(mMutex);
     sp<IBinder> token;
 
     // If this is a new process token, set a death recipient. If the client process dies, we will
@@ -112,10 +130,89 @@ ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer)
                         "Attempted to build the ClientCache before a RenderEngine instance was "
                         "ready!");
 
-    return (processBuffers[id].buffer = std::make_shared<
-                    renderengine::impl::ExternalTexture>(buffer, *mRenderEngine,
-                                                         renderengine::impl::ExternalTexture::
-                                                                 Usage::READABLE));
+    ClientCacheBuffer& buf = processBuffers[id];
+    if (buf.buffer) {
+        forgetBuffer(buf);
+        buf.evicted = false;
+    }
+    buf.buffer = std::make_shared<
+            renderengine::impl::ExternalTexture>(buffer, *mRenderEngine,
+                                                 renderengine::impl::ExternalTexture::Usage::
+                                                         READABLE);
+    buf.bytes = getBufferBytes(*buffer);
+    buf.lruPosition = mLeastRecentlyUsed.insert(mLeastRecentlyUsed.end(), cacheId);
+    mBytes += buf.bytes;
+    std::shared_ptr<renderengine::ExternalTexture> texture = buf.buffer;
+
+    std::vector<EvictedBuffer> evictedBuffers = evictBuffers(cacheId);
+    // The processes are called without the lock, as erase calls the recipients.
+    lock.unlock();
+    notifyEvicted(evictedBuffers);
+    return texture;
+}
+
+void ClientCache::forgetBuffer(const ClientCacheBuffer& buffer) {
+    mBytes -= buffer.bytes;
+    if (buffer.evicted) {
+        mEvictedBytes -= buffer.bytes;
+    }
+    mLeastRecentlyUsed.erase(buffer.lruPosition);
+}
+
+std::vector<ClientCache::EvictedBuffer> ClientCache::evictBuffers(
+        const client_cache_t& keptCacheId) {
+    std::vector<EvictedBuffer> evictedBuffers;
+    if (mMaxBytes == 0) {
+        return evictedBuffers;
+    }
+
+    ATRACE_CALL();
+    auto it = mLeastRecentlyUsed.begin();
+    while (mBytes - mEvictedBytes > mMaxBytes && it != mLeastRecentlyUsed.end()) {
+        const client_cache_t cacheId = *it++;
+        if (cacheId.id == keptCacheId.id && cacheId.token == keptCacheId.token) {
+            continue;
+        }
+        auto processIt = mBuffers.find(cacheId.token);
+        LOG_ALWAYS_FATAL_IF(processIt == mBuffers.end(), "cached buffer of an unknown process");
+        auto& [processToken, processBuffers] = processIt->second;
+        auto bufferIt = processBuffers.find(cacheId.id);
+        LOG_ALWAYS_FATAL_IF(bufferIt == processBuffers.end(), "unknown cached buffer");
+        ClientCacheBuffer& buf = bufferIt->second;
+        // Evicting a buffer which a layer or a transaction still holds would not free anything.
+        if (buf.evicted || buf.buffer.use_count() > 1) {
+            continue;
+        }
+
+        // The buffer is erased once the process uncaches it. Erasing it now would fail the
+        // transactions which the process sends with its cache id until it hears of the eviction.
+        evictedBuffers.push_back({.cacheId = cacheId.id, .processToken = processToken});
+        buf.evicted = true;
+        mEvictedBytes += buf.bytes;
+        mEvictions++;
+    }
+    ALOGW_IF(mBytes - mEvictedBytes > mMaxBytes,
+             "ClientCache holds %" PRIu64 " bytes of buffers in use, over its limit of %" PRIu64,
+             mBytes - mEvictedBytes, mMaxBytes);
+    return evictedBuffers;
+}
+
+void ClientCache::notifyEvicted(const std::vector<EvictedBuffer>& evictedBuffers) {
+    for (const auto& evicted : evictedBuffers) {
+        // The process token is the TransactionCompletedListener of the process.
+        interface_cast<ITransactionCompletedListener>(evicted.processToken)
+                ->onBufferEvicted(evicted.cacheId);
+    }
+}
+
+void ClientCache::setMaxBytes(uint64_t maxBytes) {
+    std::vector<EvictedBuffer> evictedBuffers;
+    {
+        std::lock_guard lock(mMutex);
+        mMaxBytes = maxBytes;
+        evictedBuffers = evictBuffers({});
+    }
+    notifyEvicted(evictedBuffers);
 }
 
 sp<GraphicBuffer> ClientCache::erase(const client_cache_t& cacheId) {
@@ -139,6 +236,7 @@ sp<GraphicBuffer> ClientCache::erase(const client_cache_t& cacheId) {
             }
         }
 
+        forgetBuffer(*buf);
         mBuffers[processToken].second.erase(id);
     }
 
@@ -154,9 +252,12 @@ std::shared_ptr<renderengine::ExternalTexture> ClientCache::get(const client_cac
     ClientCacheBuffer* buf = nullptr;
     if (!getBuffer(cacheId, &buf)) {
         ALOGE("failed to get buffer, could not retrieve buffer");
+        mMisses++;
         return nullptr;
     }
 
+    mHits++;
+    mLeastRecentlyUsed.splice(mLeastRecentlyUsed.end(), mLeastRecentlyUsed, buf->lruPosition);
     return buf->buffer;
 }
 
@@ -201,6 +302,7 @@ void ClientCache::removeProcess(const wp<IBinder>& processToken) {
         }
 
         for (auto& [id, clientCacheBuffer] : itr->second.second) {
+            forgetBuffer(clientCacheBuffer);
             client_cache_t cacheId = {processToken, id};
             for (auto& recipient : clientCacheBuffer.recipients) {
                 sp<ErasedRecipient> erasedRecipient = recipient.promote();
@@ -223,6 +325,11 @@ void ClientCache::CacheDeathRecipient::binderDied(const wp<IBinder>& who) {
 
 void ClientCache::dump(std::string& result) {
     std::lock_guard lock(mMutex);
+    base::StringAppendF(&result,
+                        " Buffers: %zu, %" PRIu64 " KiB (limit: %" PRIu64 " KiB, evicted: %" PRIu64
+                        " KiB), hits: %" PRIu64 ", misses: %" PRIu64 ", evictions: %" PRIu64 "\n",
+                        mLeastRecentlyUsed.size(), mBytes / 1024, mMaxBytes / 1024,
+                        mEvictedBytes / 1024, mHits, mMisses, mEvictions);
     for (const auto& [_, cache] : mBuffers) {
         base::StringAppendF(&result, " Cache owner: %p\n", cache.first.get());
 
@@ -24,10 +24,12 @@
 #include <utils/RefBase.h>
 #include <utils/Singleton.h>
 
+#include <list>
 #include <map>
 #include <mutex>
 #include <set>
 #include <unordered_map>
+#include <vector>
 
 // 4096 is based on 64 buffers * 64 layers. Once this limit is reached, the least recently used
 // buffer is uncached before the new buffer is cached.
@@ -46,6 +48,14 @@ namespace android {
 // both the SurfaceFlinger side of this other cache, as well as Composer HAL's
 // side of the cache.
 //
+// The memory of the cached buffers of all the processes can also be limited. Past
+// the limit, the least recently used buffers which nothing else holds are evicted:
+// the processes which cached them are told through
+// ITransactionCompletedListener::onBufferEvicted, and uncache them in return. Until
+// then, an evicted buffer stays cached, so that a transaction which the process sent
+// before hearing of the eviction still finds it. It is erased as any other buffer the
+// process uncaches, and only stops counting against the limit in the meantime.
+//
 class ClientCache : public Singleton<ClientCache> {
 public:
     ClientCache();
@@ -65,6 +75,10 @@ public:
 
     void removeProcess(const wp<IBinder>& processToken);
 
+    // Evicts buffers once the cached buffers use more than maxBytes. 0, the default, means no
+    // limit.
+    void setMaxBytes(uint64_t maxBytes);
+
     class ErasedRecipient : public virtual RefBase {
     public:
         virtual void bufferErased(const client_cache_t& clientCacheId) = 0;
@@ -83,12 +97,27 @@ private:
     struct ClientCacheBuffer {
         std::shared_ptr<renderengine::ExternalTexture> buffer;
         std::set<wp<ErasedRecipient>> recipients;
+        uint64_t bytes = 0;
+        std::list<client_cache_t>::iterator lruPosition;
+        // Evicted, until the caching process uncaches it.
+        bool evicted = false;
     };
     std::map<wp<IBinder> /*caching process*/,
              std::pair<sp<IBinder> /*strong ref to caching process*/,
                        std::unordered_map<uint64_t /*cache id*/, ClientCacheBuffer>>>
             mBuffers GUARDED_BY(mMutex);
 
+    // All the cached buffers, from the least to the most recently used.
+    std::list<client_cache_t> mLeastRecentlyUsed GUARDED_BY(mMutex);
+    uint64_t mBytes GUARDED_BY(mMutex) = 0;
+    // The part of mBytes of the evicted buffers which their processes did not uncache yet.
+    uint64_t mEvictedBytes GUARDED_BY(mMutex) = 0;
+    uint64_t mMaxBytes GUARDED_BY(mMutex) = 0;
+
+    uint64_t mHits GUARDED_BY(mMutex) = 0;
+    uint64_t mMisses GUARDED_BY(mMutex) = 0;
+    uint64_t mEvictions GUARDED_BY(mMutex) = 0;
+
     class CacheDeathRecipient : public IBinder::DeathRecipient {
     public:
         void binderDied(const wp<IBinder>& who) override;
@@ -99,6 +128,18 @@ private:
 
     bool getBuffer(const client_cache_t& cacheId, ClientCacheBuffer** outClientCacheBuffer)
             REQUIRES(mMutex);
+
+    // Forgets the memory of a buffer which is about to be removed from mBuffers.
+    void forgetBuffer(const ClientCacheBuffer& buffer) REQUIRES(mMutex);
+
+    struct EvictedBuffer {
+        uint64_t cacheId;
+        sp<IBinder> processToken;
+    };
+    // Evicts the least recently used buffers until the buffers which are not evicted fit in
+    // mMaxBytes, except for the buffer of keptCacheId.
+    std::vector<EvictedBuffer> evictBuffers(const client_cache_t& keptCacheId) REQUIRES(mMutex);
+    static void notifyEvicted(const std::vector<EvictedBuffer>& evictedBuffers);
 };
 
 }; // namespace android
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <TimeStats/FrameStageStats.h>
 #include <TimeStats/TimeStats.h>
 #include <utils/Timers.h>
 #include <memory>
@@ -61,6 +62,9 @@ public:
     virtual TimeStats* getTimeStats() const = 0;
     virtual void setTimeStats(const std::shared_ptr<TimeStats>&) = 0;
 
+    virtual FrameStageStats* getFrameStageStats() const = 0;
+    virtual void setFrameStageStats(const std::shared_ptr<FrameStageStats>&) = 0;
+
     virtual bool needsAnotherUpdate() const = 0;
     virtual nsecs_t getLastFrameRefreshTimestamp() const = 0;
 
@@ -104,6 +104,20 @@ struct CompositionRefreshArgs {
 
     bool hasTrustedPresentationListener = false;
 
+    // If true, the HWC validates all the outputs at the same time, as long as it can present them
+    // from several threads.
+    bool validateOutputsConcurrently = false;
+
+    // If true, the outputs which the HWC can present from several threads each present on a thread
+    // of their own. RenderEngine must then be threaded, so that it can be called from any thread.
+    bool presentOutputsInParallel = false;
+
+    // If true, outputs on which nothing changed that composition uses are not presented, and
+    // outputs on which only the buffers of HWC-composited layers changed only pass those on to
+    // the HWC. Only set when nothing but the layers changed since the previous frame, and the
+    // front end tracks the LayerFECompositionState::frameChanges of each layer.
+    bool skipIdleOutputs = false;
+
     ICEPowerCallback* powerCallback = nullptr;
 };
 
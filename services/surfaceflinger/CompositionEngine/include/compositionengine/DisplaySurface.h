@@ -27,6 +27,7 @@ namespace android {
 
 class Fence;
 class IGraphicBufferProducer;
+class Region;
 class String8;
 
 namespace compositionengine {
@@ -62,6 +63,11 @@ public:
     // advanceFrame may be called again.
     virtual status_t advanceFrame(float hdrSdrRatio) = 0;
 
+    // Sets the region of the next client target which changed since the previous one, in buffer
+    // coordinates, or Region::INVALID_REGION if all of it may have. advanceFrame passes it on to
+    // HWComposer along with the client target. The default implementation ignores it.
+    virtual void setClientTargetDamage(const Region& damage);
+
     // onFrameCommitted is called after the frame has been committed to the
     // hardware composer. The surface collects the release fence for this
     // frame's buffer.
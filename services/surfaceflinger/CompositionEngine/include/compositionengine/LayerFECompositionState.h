@@ -168,6 +168,18 @@ struct LayerFECompositionState {
     Region surfaceDamage;
     uint64_t frameNumber = 0;
 
+    // What changed in the state since the previous frame, as far as composition is concerned.
+    // Front ends which don't track the changes leave it at ALL, so that no output skips any
+    // composition work for the layer.
+    enum class FrameChanges {
+        // Nothing which composition uses.
+        NONE,
+        // Only the buffer, with its acquire fence and surface damage.
+        BUFFER,
+        ALL,
+    };
+    FrameChanges frameChanges{FrameChanges::ALL};
+
     // The handle to use for a sideband stream for this layer
     sp<NativeHandle> sidebandStream;
     // If true, this sideband layer has a frame update
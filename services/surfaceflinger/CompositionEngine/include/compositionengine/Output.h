@@ -274,12 +274,25 @@ public:
     // Make the next call to `present` run asynchronously.
     virtual void offloadPresentNextFrame() = 0;
 
+    // Runs the steps of the next call to `present` up to choosing the composition strategy, and
+    // starts choosing it on another thread. This lets the HWC validate several outputs at the same
+    // time, with `present` then called on each of them.
+    virtual void startValidation(const CompositionRefreshArgs&) = 0;
+
+    // Decides how much of the next frame the output updates, given what changed since the last
+    // one, and records it in the frameUpdate of its state. Called after `prepare`, if the refresh
+    // args let idle outputs be skipped. A SKIPPED output is then not presented at all.
+    virtual void chooseFrameUpdate(const CompositionRefreshArgs&) = 0;
+
     // Enables predicting composition strategy to run client composition earlier
     virtual void setPredictCompositionStrategy(bool) = 0;
 
     // Enables overriding the 170M trasnfer function as sRGB
     virtual void setTreat170mAsSrgb(bool) = 0;
 
+    // Enables redrawing only the damage of the client target, rather than all of it
+    virtual void setPartialClientComposition(bool) = 0;
+
 protected:
     virtual void setDisplayColorProfile(std::unique_ptr<DisplayColorProfile>) = 0;
     virtual void setRenderSurface(std::unique_ptr<RenderSurface>) = 0;
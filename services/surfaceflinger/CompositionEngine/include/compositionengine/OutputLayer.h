@@ -106,6 +106,11 @@ public:
     virtual void writeStateToHWC(bool includeGeometry, bool skipLayer, uint32_t z,
                                  bool zIsOverridden, bool isPeekingThrough) = 0;
 
+    // Sends only the buffer of the layer, with its acquire fence and surface damage, to the HWC.
+    // Only valid when nothing else about the layer changed since writeStateToHWC last sent it,
+    // and the HWC composites it.
+    virtual void writeBufferUpdateToHWC() = 0;
+
     // Updates the cursor position with the HWC
     virtual void writeCursorPositionToHWC() const = 0;
 
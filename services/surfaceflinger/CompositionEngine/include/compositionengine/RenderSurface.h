@@ -19,6 +19,7 @@
 #include <renderengine/ExternalTexture.h>
 #include <ui/Fence.h>
 #include <ui/GraphicTypes.h>
+#include <ui/Region.h>
 #include <ui/Size.h>
 #include <utils/Errors.h>
 #include <utils/StrongPointer.h>
@@ -84,6 +85,17 @@ public:
     virtual std::shared_ptr<renderengine::ExternalTexture> dequeueBuffer(
             base::unique_fd* bufferFence) = 0;
 
+    // Adds to the damage of the frame being composed: the region of the
+    // surface, in buffer coordinates, which may differ from the last frame
+    // queued. The damage of frames which queue no buffer carries over to the
+    // next one which does. The surface only tracks damage once this is called.
+    virtual void addFrameDamage(const Region& damage) = 0;
+
+    // Returns the region of the buffer last dequeued which must be redrawn for
+    // it to hold the frame being composed, or Region::INVALID_REGION if all of
+    // it must, e.g. because it was never queued or its age is unknown.
+    virtual Region getBufferDamage() const = 0;
+
     // Queues the drawn buffer for consumption by HWC. readyFence is the fence
     // which will fire when the buffer is ready for consumption.
     virtual void queueBuffer(base::unique_fd readyFence, float hdrSdrRatio) = 0;
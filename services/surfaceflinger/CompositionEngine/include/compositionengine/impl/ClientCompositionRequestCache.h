@@ -37,22 +37,44 @@ namespace compositionengine::impl {
 // the composition request. We need to make sure the request, including the order of the
 // layers, do not change from call to call. The snapshot removes strong references to the
 // client buffer id so we don't extend the lifetime of the buffer by storing it in the cache.
+//
+// Every snapshot is stored with a hash of its content, which is computed once per request, so
+// that the settings of the layers are only compared one by one when the hashes match.
 class ClientCompositionRequestCache {
 public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
     explicit ClientCompositionRequestCache(uint32_t cacheSize) : mMaxCacheSize(cacheSize){};
     ~ClientCompositionRequestCache() = default;
-    bool exists(uint64_t bufferId, const renderengine::DisplaySettings& display,
-                const std::vector<LayerFE::LayerSettings>& layerSettings) const;
-    void add(uint64_t bufferId, const renderengine::DisplaySettings& display,
+
+    // Hashes the parts of a request which are likely to change from frame to frame. Requests
+    // which are equal have the same hash.
+    static size_t computeHash(const renderengine::DisplaySettings& display,
+                              const std::vector<LayerFE::LayerSettings>& layerSettings);
+
+    // Returns whether the request was the last one rendered into the buffer, and counts a hit or
+    // a miss accordingly. The hash is the one computeHash returns for the request.
+    bool exists(uint64_t bufferId, size_t hash, const renderengine::DisplaySettings& display,
+                const std::vector<LayerFE::LayerSettings>& layerSettings);
+    void add(uint64_t bufferId, size_t hash, const renderengine::DisplaySettings& display,
              const std::vector<LayerFE::LayerSettings>& layerSettings);
     void remove(uint64_t bufferId);
 
+    uint32_t getMaxCacheSize() const { return mMaxCacheSize; }
+    size_t getCacheSize() const { return mCache.size(); }
+    const Stats& getStats() const { return mStats; }
+
 private:
     uint32_t mMaxCacheSize;
+    Stats mStats;
     struct ClientCompositionRequest {
+        size_t hash;
         renderengine::DisplaySettings display;
         std::vector<LayerFE::LayerSettings> layerSettings;
-        ClientCompositionRequest(const renderengine::DisplaySettings& _display,
+        ClientCompositionRequest(size_t _hash, const renderengine::DisplaySettings& _display,
                                  const std::vector<LayerFE::LayerSettings>& _layerSettings);
         bool equals(const renderengine::DisplaySettings& _display,
                     const std::vector<LayerFE::LayerSettings>& _layerSettings) const;
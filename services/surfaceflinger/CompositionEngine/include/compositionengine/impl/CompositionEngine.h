@@ -17,9 +17,25 @@
 #pragma once
 
 #include <compositionengine/CompositionEngine.h>
+#include <compositionengine/CompositionRefreshArgs.h>
+#include <ftl/future.h>
+#include <scheduler/Time.h>
+#include <ui/DisplayId.h>
+#include <ui/DisplayMap.h>
+
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace android::compositionengine {
+class Output;
+} // namespace android::compositionengine
 
 namespace android::compositionengine::impl {
 
+class HwcAsyncWorker;
+
 class CompositionEngine : public compositionengine::CompositionEngine {
 public:
     CompositionEngine();
@@ -39,6 +55,9 @@ public:
     TimeStats* getTimeStats() const override;
     void setTimeStats(const std::shared_ptr<TimeStats>&) override;
 
+    FrameStageStats* getFrameStageStats() const override;
+    void setFrameStageStats(const std::shared_ptr<FrameStageStats>&) override;
+
     bool needsAnotherUpdate() const override;
     nsecs_t getLastFrameRefreshTimestamp() const override;
 
@@ -57,11 +76,56 @@ public:
     void setNeedsAnotherUpdateForTest(bool);
 
 private:
+    // Lets each output choose how much of the frame it updates, and returns those to present.
+    Outputs chooseFrameUpdates(const CompositionRefreshArgs&);
+    void startValidations(const CompositionRefreshArgs&, const Outputs&,
+                          ui::DisplayVector<compositionengine::Output*>& outValidated);
+    void recordValidations(const ui::DisplayVector<compositionengine::Output*>& validated);
+    void presentOutputs(const CompositionRefreshArgs&, const Outputs&,
+                        ui::DisplayVector<ftl::Future<std::monostate>>& outFutures);
+    void recordPresentTiming(const compositionengine::Output&, Duration, bool inParallel);
+
     std::unique_ptr<HWComposer> mHwComposer;
     renderengine::RenderEngine* mRenderEngine;
     std::shared_ptr<TimeStats> mTimeStats;
+    std::shared_ptr<FrameStageStats> mFrameStageStats;
     bool mNeedsAnotherUpdate = false;
     nsecs_t mRefreshStartTime = 0;
+
+    // How well the composition strategies were predicted while the outputs were validated
+    // concurrently.
+    struct ConcurrentValidationStats {
+        uint64_t frames = 0;
+        uint64_t validations = 0;
+        uint64_t predictions = 0;
+        uint64_t predictionHits = 0;
+    };
+    ConcurrentValidationStats mConcurrentValidationStats;
+
+    // Present the outputs which are presented in parallel, other than the one presented on the
+    // main thread.
+    std::vector<std::unique_ptr<HwcAsyncWorker>> mPresentWorkers;
+
+    // How long Output::present took for each display, while presenting in parallel is enabled.
+    struct PresentTiming {
+        std::string name;
+        Duration lastDuration = Duration::fromNs(0);
+        Duration maxDuration = Duration::fromNs(0);
+        Duration totalDuration = Duration::fromNs(0);
+        uint64_t count = 0;
+        bool lastInParallel = false;
+    };
+    std::unordered_map<DisplayId, PresentTiming> mPresentTimings;
+
+    // How many frames each display updated fully, skipped, or only passed new buffers on for,
+    // while idle outputs may be skipped.
+    struct FrameUpdateCounts {
+        std::string name;
+        uint64_t full = 0;
+        uint64_t skipped = 0;
+        uint64_t buffersOnly = 0;
+    };
+    std::unordered_map<DisplayId, FrameUpdateCounts> mFrameUpdateCounts;
 };
 
 std::unique_ptr<compositionengine::CompositionEngine> createCompositionEngine();
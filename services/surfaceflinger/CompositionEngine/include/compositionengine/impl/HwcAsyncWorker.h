@@ -34,6 +34,8 @@ namespace android::compositionengine::impl {
 // was successful otherwise the client composition is re-executed.
 //
 // Note: This does not alter the sequence between HWC and surfaceflinger.
+//
+// CompositionEngine also uses it to present outputs in parallel.
 class HwcAsyncWorker final {
 public:
     HwcAsyncWorker();
@@ -18,6 +18,7 @@
 
 #include <cstdint>
 #include <stack>
+#include <string>
 #include <unordered_map>
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
@@ -66,7 +67,18 @@ public:
     // buffers from the cache. We add an extra slot at the end for the override buffers.
     static const constexpr size_t kOverrideBufferSlot = kMaxLayerBufferCount;
 
+    // Uses the slot budget from debug.sf.hwc_buffer_cache_slots, or every slot by default.
     HwcBufferCache();
+    // The slot budget is clamped to the number of slots the HAL caches for a layer.
+    explicit HwcBufferCache(uint32_t slotBudget);
+
+    // Counts how often buffers were found in the cache, sent to HWC in full, or evicted another
+    // buffer. Override buffers are not counted.
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
 
     //
     // Given a buffer, return the HWC cache slot and buffer to send to HWC.
@@ -92,6 +104,12 @@ public:
     //
     uint32_t uncache(uint64_t graphicBufferId);
 
+    uint32_t getSlotBudget() const { return mSlotBudget; }
+    const Stats& getStats() const { return mStats; }
+
+    // Debugging
+    void dump(std::string& out) const;
+
 private:
     uint32_t cache(const sp<GraphicBuffer>& buffer);
     uint32_t getLeastRecentlyUsedSlot();
@@ -100,14 +118,17 @@ private:
         sp<GraphicBuffer> buffer;
         uint32_t slot;
         // Cache entries are evicted according to least-recently-used when more than
-        // kMaxLayerBufferCount unique buffers have been sent to a layer.
+        // mSlotBudget unique buffers have been sent to a layer. This is the generation of the
+        // most recent use of the entry.
         uint64_t lruCounter;
     };
 
     std::unordered_map<uint64_t, Cache> mCacheByBufferId;
     sp<GraphicBuffer> mLastOverrideBuffer;
     std::stack<uint32_t> mFreeSlots;
-    uint64_t mLeastRecentlyUsedCounter;
+    uint64_t mLeastRecentlyUsedCounter = 0;
+    uint32_t mSlotBudget;
+    Stats mStats;
 };
 
 } // namespace compositionengine::impl
@@ -29,6 +29,7 @@
 #include <renderengine/LayerSettings.h>
 
 #include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -83,6 +84,8 @@ public:
     ftl::Future<std::monostate> present(const CompositionRefreshArgs&) override;
     bool supportsOffloadPresent() const override { return false; }
     void offloadPresentNextFrame() override;
+    void startValidation(const CompositionRefreshArgs&) override;
+    void chooseFrameUpdate(const CompositionRefreshArgs&) override;
 
     void uncacheBuffers(const std::vector<uint64_t>& bufferIdsToUncache) override;
     void rebuildLayerStacks(const CompositionRefreshArgs&, LayerFESet&) override;
@@ -110,6 +113,7 @@ public:
     bool canPredictCompositionStrategy(const CompositionRefreshArgs&) override;
     void setPredictCompositionStrategy(bool) override;
     void setTreat170mAsSrgb(bool) override;
+    void setPartialClientComposition(bool) override;
 
     // Testing
     const ReleasedLayers& getReleasedLayersForTest() const;
@@ -122,8 +126,13 @@ public:
                                      std::shared_ptr<renderengine::ExternalTexture>*);
     virtual std::future<bool> chooseCompositionStrategyAsync(
             std::optional<android::HWComposer::DeviceRequestedChanges>*);
+    // Prepares the frame with the composition strategy which startValidation started choosing.
+    virtual GpuCompositionResult finishValidation();
     virtual void resetCompositionStrategy();
     virtual ftl::Future<std::monostate> presentFrameAndReleaseLayersAsync();
+    // Sends the frame target state and the new buffers to the HWC, for a BUFFERS_ONLY frame.
+    void writeBufferUpdates(const CompositionRefreshArgs&);
+    void writeFrameTargetState(const CompositionRefreshArgs&);
 
 protected:
     std::unique_ptr<compositionengine::OutputLayer> createOutputLayer(const sp<LayerFE>&) const;
@@ -165,11 +174,36 @@ private:
     void updateCompositionStateForBorder(const compositionengine::CompositionRefreshArgs&);
     compositionengine::OutputLayer* findLayerRequestingBackgroundComposition() const;
     void finishPrepareFrame();
+    void beginPresent(const compositionengine::CompositionRefreshArgs&);
+    GpuCompositionResult composeWhileChoosingCompositionStrategy(
+            std::future<bool>& hwcResult,
+            std::optional<android::HWComposer::DeviceRequestedChanges>& changes);
     ui::Dataspace getBestDataspace(ui::Dataspace*, bool*) const;
     compositionengine::Output::ColorProfile pickColorProfile(
             const compositionengine::CompositionRefreshArgs&) const;
     void updateHwcAsyncWorker();
     float getHdrSdrRatio(const std::shared_ptr<renderengine::ExternalTexture>& buffer) const;
+    Region getFramebufferDirtyRegion() const;
+
+    // What client composition draws the client target from, besides the content of the layers,
+    // whose changes the dirty region tracks. Any change of it redraws the whole client target.
+    struct ClientTargetContent {
+        struct Layer {
+            int32_t sequence;
+            bool clientComposition;
+            bool clearClientTarget;
+            // The buffer of the cached set drawn in place of the layer, if any.
+            uint64_t overrideBufferId;
+
+            bool operator==(const Layer&) const;
+        };
+
+        renderengine::DisplaySettings display;
+        std::vector<Layer> layers;
+
+        bool operator==(const ClientTargetContent&) const;
+    };
+    ClientTargetContent getClientTargetContent(const renderengine::DisplaySettings&) const;
 
     std::string mName;
     std::string mNamePlusId;
@@ -184,10 +218,31 @@ private:
     std::unique_ptr<HwcAsyncWorker> mHwComposerAsyncWorker;
 
     bool mPredictCompositionStrategy = false;
+    bool mPartialClientComposition = false;
     bool mOffloadPresent = false;
 
+    // The composition strategy which startValidation started choosing for the next present.
+    struct StartedValidation {
+        std::future<bool> success;
+        std::optional<android::HWComposer::DeviceRequestedChanges> changes;
+        // Whether the client composition runs with the previous strategy in the meantime.
+        bool predicted = false;
+    };
+    std::unique_ptr<StartedValidation> mStartedValidation;
+    // Whether startValidation has run the first steps of the next present.
+    bool mPresentStarted = false;
+    // Whether the HwcAsyncWorker is choosing the composition strategy for startValidation.
+    bool mValidateAsync = false;
+
     // Whether the content must be recomposed this frame.
     bool mMustRecompose = false;
+
+    // What the client target was drawn from this frame, and in the last frame queued.
+    std::optional<ClientTargetContent> mComposedClientTargetContent;
+    std::optional<ClientTargetContent> mQueuedClientTargetContent;
+    // Whether client composition already drew into a buffer this frame, e.g. before a failed
+    // prediction of the composition strategy. Drawing into it again then redraws all of it.
+    bool mClientTargetDrawn = false;
 };
 
 // This template factory function standardizes the implementation details of the
@@ -164,8 +164,26 @@ struct OutputCompositionState {
     CompositionStrategyPredictionState strategyPrediction =
             CompositionStrategyPredictionState::DISABLED;
 
+    enum class FrameUpdate : uint32_t {
+        // The output was composited and presented as usual this frame.
+        FULL = 0,
+        // Nothing on the output changed, so it was neither composited nor presented this frame.
+        SKIPPED = 1,
+        // Only buffers of layers which the HWC composites changed, so only they were passed on to
+        // the HWC before the output was presented this frame.
+        BUFFERS_ONLY = 2,
+
+        ftl_last = BUFFERS_ONLY
+    };
+
+    FrameUpdate frameUpdate = FrameUpdate::FULL;
+
     bool treat170mAsSrgb = false;
 
+    // If true, client composition only redraws the damage of the client target since its buffer
+    // was last queued.
+    bool partialClientComposition = false;
+
     std::vector<renderengine::BorderRenderInfo> borderInfoList;
 
     uint64_t lastOutputLayerHash = 0;
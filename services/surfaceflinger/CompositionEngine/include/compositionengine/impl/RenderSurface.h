@@ -20,6 +20,7 @@
 #include <compositionengine/RenderSurface.h>
 #include <utils/StrongPointer.h>
 
+#include <deque>
 #include <memory>
 #include <vector>
 
@@ -60,6 +61,8 @@ public:
     void prepareFrame(bool usesClientComposition, bool usesDeviceComposition) override;
     std::shared_ptr<renderengine::ExternalTexture> dequeueBuffer(
             base::unique_fd* bufferFence) override;
+    void addFrameDamage(const Region& damage) override;
+    Region getBufferDamage() const override;
     void queueBuffer(base::unique_fd readyFence, float hdrSdrRatio) override;
     void onPresentDisplayCompleted() override;
     bool supportsCompositionStrategyPrediction() const override;
@@ -86,6 +89,19 @@ private:
     ui::Size mSize;
     const size_t mMaxTextureCacheSize;
     bool mProtected{false};
+
+    // The number of frames queued for which the damage is kept, more than the
+    // surface has buffers, so that the damage of any buffer is known.
+    static constexpr size_t kMaxDamageHistory = 4;
+
+    // Whether addFrameDamage was called, after which the age of the buffers is queried.
+    bool mTracksDamage{false};
+    // The damage of the frame being composed, since the last frame queued.
+    Region mFrameDamage;
+    // The damage of the last frames queued, from the most recent one.
+    std::deque<Region> mDamageHistory;
+    // The number of frames since the current buffer was last queued, or 0 if unknown.
+    int mBufferAge{0};
 };
 
 std::unique_ptr<compositionengine::RenderSurface> createRenderSurface(
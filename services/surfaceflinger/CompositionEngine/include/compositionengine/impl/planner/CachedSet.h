@@ -20,6 +20,7 @@
 #include <compositionengine/ProjectionSpace.h>
 #include <compositionengine/impl/planner/LayerState.h>
 #include <compositionengine/impl/planner/TexturePool.h>
+#include <ftl/future.h>
 #include <renderengine/RenderEngine.h>
 
 #include <chrono>
@@ -96,6 +97,7 @@ public:
     void setLastUpdate(std::chrono::steady_clock::time_point now) { mLastUpdate = now; }
     void append(const CachedSet& other) {
         mTexture.reset();
+        mPendingRender.reset();
         mOutputDataspace = ui::Dataspace::UNKNOWN;
         mDrawFence = nullptr;
         mBlurLayer = nullptr;
@@ -114,8 +116,18 @@ public:
     size_t getSkipCount() { return mSkipCount; }
 
     // Renders the cached set with the supplied output composition state.
+    // If waitForRenderEngine is false, the layers are only queued to the RenderEngine, and the
+    // cached set gets its buffer once finishRender sees that the RenderEngine is done with them.
     void render(renderengine::RenderEngine& re, TexturePool& texturePool,
-                const OutputCompositionState& outputState, bool deviceHandlesColorTransform);
+                const OutputCompositionState& outputState, bool deviceHandlesColorTransform,
+                bool waitForRenderEngine = true);
+
+    // True if the layers were queued to the RenderEngine, which hasn't drawn them yet.
+    bool isRendering() const { return mPendingRender.has_value(); }
+
+    // Takes the buffer of a render which didn't wait for the RenderEngine, waiting for the
+    // RenderEngine to draw it if wait is true. Returns false if the render is still pending.
+    bool finishRender(bool wait);
 
     void dump(std::string& result) const;
 
@@ -167,6 +179,16 @@ private:
     // containers in the Flattener. Logically this should have unique ownership otherwise.
     std::shared_ptr<TexturePool::AutoTexture> mTexture;
     sp<Fence> mDrawFence;
+
+    struct PendingRender {
+        ftl::SharedFuture<FenceResult> fenceResult;
+        std::shared_ptr<TexturePool::AutoTexture> texture;
+        ProjectionSpace outputSpace;
+        ui::Dataspace outputDataspace;
+        ui::Transform::RotationFlags orientation;
+    };
+    std::optional<PendingRender> mPendingRender;
+
     ProjectionSpace mOutputSpace;
     ui::Dataspace mOutputDataspace;
     ui::Transform::RotationFlags mOrientation = ui::Transform::ROT_0;
@@ -74,6 +74,8 @@ public:
 
         static const constexpr bool kDefaultEnableHolePunch = true;
 
+        static const constexpr bool kDefaultRenderInBackground = false;
+
         // Threshold for determing whether a layer is active. A layer whose properties, including
         // the buffer, have not changed in at least this time is considered inactive and is
         // therefore a candidate for flattening.
@@ -85,6 +87,11 @@ public:
 
         // True if the hole punching feature should be enabled.
         const bool mEnableHolePunch;
+
+        // True if composition should not wait for the RenderEngine to render a cached set. The
+        // cached set is then merged in once the RenderEngine is done with it, and only rendered if
+        // the reads it saves the display are expected to outweigh the cost of rendering it.
+        const bool mRenderInBackground = kDefaultRenderInBackground;
     };
 
     // Constants not yet backed by a sysprop
@@ -119,6 +126,10 @@ public:
 private:
     size_t calculateDisplayCost(const std::vector<const LayerState*>& layers) const;
 
+    // Whether the reads of the display saved by a cached set add up to more than the cost of
+    // rendering it, assuming that it is used for as many frames as the cached sets so far.
+    bool isWorthRendering(const CachedSet&) const;
+
     void resetActivities(NonBufferHash, std::chrono::steady_clock::time_point now);
 
     NonBufferHash computeLayersHash() const;
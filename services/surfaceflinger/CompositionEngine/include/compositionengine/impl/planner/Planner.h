@@ -23,6 +23,7 @@
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
+#include <future>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -48,6 +49,11 @@ public:
 
     void setDisplaySize(ui::Size);
 
+    // Saves the most reliable predictions to a file with this name, in the directory given by
+    // debug.sf.planner_predictions_dir, so that the Predictor is seeded with them on the next run
+    // for the same display configuration. Only takes effect if prediction is enabled.
+    void setPredictionsFile(const std::string& name);
+
     // Updates the Planner with the current set of layers before a composition strategy is
     // determined.
     // The Planner will call to the Flattener to determine to:
@@ -75,6 +81,12 @@ public:
 private:
     void dumpUsage(std::string&) const;
 
+    // Describes what the saved predictions are valid for, since the hashes of the layer stacks
+    // depend on the display.
+    std::string getPredictionsHeader() const;
+    void loadPredictions();
+    void savePredictions();
+
     std::unordered_map<LayerId, LayerState> mPreviousLayers;
 
     std::vector<const LayerState*> mCurrentLayers;
@@ -86,6 +98,15 @@ private:
     NonBufferHash mFlattenedHash = 0;
 
     bool mPredictorEnabled = false;
+
+    ui::Size mDisplaySize;
+
+    // Empty unless the predictions are saved.
+    std::string mPredictionsPath;
+    bool mPredictionsLoaded = false;
+    size_t mSavedPredictionCount = 0;
+    // The save which writes the predictions file in the background, if any.
+    std::future<void> mSavePredictionsFuture;
 };
 
 } // namespace compositionengine::impl::planner
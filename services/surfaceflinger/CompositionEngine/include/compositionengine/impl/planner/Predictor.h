@@ -251,6 +251,17 @@ public:
 
     void dump(std::string&) const;
 
+    // Writes the plans of the predictions which never missed, at most maxCount of them and the
+    // most hit first, as one "<hash> <plan>" line each.
+    std::string savePredictions(size_t maxCount) const;
+
+    // Seeds the predictor with the plans written by savePredictions, e.g. by a previous run. Since
+    // their layer stacks are unknown, the seeded plans only match exactly, and are replaced by a
+    // regular prediction once hit. Returns the number of plans seeded.
+    size_t loadPredictions(const std::string&);
+
+    size_t getPredictionCount() const { return mPredictions.size(); }
+
     void compareLayerStacks(NonBufferHash leftHash, NonBufferHash rightHash, std::string&) const;
     void describeLayerStack(NonBufferHash, std::string&) const;
     void listSimilarStacks(Plan, std::string&) const;
@@ -292,6 +303,9 @@ private:
     std::unordered_map<NonBufferHash, Prediction> mPredictions;
     std::unordered_map<Plan, std::vector<NonBufferHash>> mSimilarStacks;
 
+    // Plans loaded by loadPredictions which haven't been predicted yet.
+    std::unordered_map<NonBufferHash, Plan> mSeededPlans;
+
     struct ApproximateStack {
         ApproximateStack(NonBufferHash hash, LayerStack::ApproximateMatch match)
               : hash(hash), match(match) {}
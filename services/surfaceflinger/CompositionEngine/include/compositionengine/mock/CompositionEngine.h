@@ -44,6 +44,8 @@ public:
 
     MOCK_CONST_METHOD0(getTimeStats, TimeStats*());
     MOCK_METHOD1(setTimeStats, void(const std::shared_ptr<TimeStats>&));
+    MOCK_CONST_METHOD0(getFrameStageStats, FrameStageStats*());
+    MOCK_METHOD1(setFrameStageStats, void(const std::shared_ptr<FrameStageStats>&));
 
     MOCK_CONST_METHOD0(needsAnotherUpdate, bool());
     MOCK_CONST_METHOD0(getLastFrameRefreshTimestamp, nsecs_t());
@@ -84,6 +84,8 @@ public:
                  ftl::Future<std::monostate>(const compositionengine::CompositionRefreshArgs&));
     MOCK_CONST_METHOD0(supportsOffloadPresent, bool());
     MOCK_METHOD(void, offloadPresentNextFrame, ());
+    MOCK_METHOD(void, startValidation, (const compositionengine::CompositionRefreshArgs&));
+    MOCK_METHOD(void, chooseFrameUpdate, (const compositionengine::CompositionRefreshArgs&));
 
     MOCK_METHOD1(uncacheBuffers, void(const std::vector<uint64_t>&));
     MOCK_METHOD2(rebuildLayerStacks,
@@ -134,6 +136,7 @@ public:
     MOCK_METHOD1(canPredictCompositionStrategy, bool(const CompositionRefreshArgs&));
     MOCK_METHOD1(setPredictCompositionStrategy, void(bool));
     MOCK_METHOD1(setTreat170mAsSrgb, void(bool));
+    MOCK_METHOD1(setPartialClientComposition, void(bool));
     MOCK_METHOD(void, setHintSessionGpuFence, (std::unique_ptr<FenceTime> && gpuFence));
     MOCK_METHOD(bool, isPowerHintSessionEnabled, ());
 };
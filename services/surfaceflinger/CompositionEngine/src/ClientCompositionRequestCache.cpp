@@ -17,6 +17,7 @@
 #include <algorithm>
 
 #include <compositionengine/impl/ClientCompositionRequestCache.h>
+#include <math/HashCombine.h>
 #include <renderengine/DisplaySettings.h>
 #include <renderengine/LayerSettings.h>
 
@@ -66,10 +67,27 @@ bool layerSettingsAreEqual(const LayerFE::LayerSettings& lhs, const LayerFE::Lay
 
 } // namespace
 
+size_t ClientCompositionRequestCache::computeHash(
+        const renderengine::DisplaySettings& display,
+        const std::vector<LayerFE::LayerSettings>& layerSettings) {
+    size_t hash = hashCombine(display.physicalDisplay, display.clip, display.outputDataspace,
+                              display.orientation, display.targetLuminanceNits,
+                              layerSettings.size());
+    for (const LayerFE::LayerSettings& settings : layerSettings) {
+        hashCombineSingleHashed(hash,
+                                hashCombine(settings.bufferId, settings.frameNumber,
+                                            settings.geometry.boundaries, settings.alpha,
+                                            settings.sourceDataspace, settings.source.solidColor,
+                                            settings.disableBlending,
+                                            settings.backgroundBlurRadius));
+    }
+    return hash;
+}
+
 ClientCompositionRequestCache::ClientCompositionRequest::ClientCompositionRequest(
-        const renderengine::DisplaySettings& initDisplay,
+        size_t initHash, const renderengine::DisplaySettings& initDisplay,
         const std::vector<LayerFE::LayerSettings>& initLayerSettings)
-      : display(initDisplay) {
+      : hash(initHash), display(initDisplay) {
     layerSettings.reserve(initLayerSettings.size());
     for (const LayerFE::LayerSettings& settings : initLayerSettings) {
         layerSettings.push_back(getLayerSettingsSnapshot(settings));
@@ -85,20 +103,25 @@ bool ClientCompositionRequestCache::ClientCompositionRequest::equals(
 }
 
 bool ClientCompositionRequestCache::exists(
-        uint64_t bufferId, const renderengine::DisplaySettings& display,
-        const std::vector<LayerFE::LayerSettings>& layerSettings) const {
+        uint64_t bufferId, size_t hash, const renderengine::DisplaySettings& display,
+        const std::vector<LayerFE::LayerSettings>& layerSettings) {
     for (const auto& [cachedBufferId, cachedRequest] : mCache) {
         if (cachedBufferId == bufferId) {
-            return cachedRequest.equals(display, layerSettings);
+            if (cachedRequest.hash == hash && cachedRequest.equals(display, layerSettings)) {
+                mStats.hits++;
+                return true;
+            }
+            break;
         }
     }
+    mStats.misses++;
     return false;
 }
 
-void ClientCompositionRequestCache::add(uint64_t bufferId,
+void ClientCompositionRequestCache::add(uint64_t bufferId, size_t hash,
                                         const renderengine::DisplaySettings& display,
                                         const std::vector<LayerFE::LayerSettings>& layerSettings) {
-    const ClientCompositionRequest request(display, layerSettings);
+    const ClientCompositionRequest request(hash, display, layerSettings);
     for (auto& [cachedBufferId, cachedRequest] : mCache) {
         if (cachedBufferId == bufferId) {
             cachedRequest = std::move(request);
@@ -14,17 +14,22 @@
  * limitations under the License.
  */
 
+#include <android-base/stringprintf.h>
 #include <compositionengine/CompositionRefreshArgs.h>
 #include <compositionengine/LayerFE.h>
 #include <compositionengine/LayerFECompositionState.h>
 #include <compositionengine/OutputLayer.h>
 #include <compositionengine/impl/CompositionEngine.h>
 #include <compositionengine/impl/Display.h>
+#include <compositionengine/impl/HwcAsyncWorker.h>
 #include <ui/DisplayMap.h>
 
 #include <renderengine/RenderEngine.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
+#include <cinttypes>
+
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wconversion"
@@ -39,6 +44,9 @@ namespace android::compositionengine {
 CompositionEngine::~CompositionEngine() = default;
 
 namespace impl {
+using CompositionStrategyPredictionState =
+        OutputCompositionState::CompositionStrategyPredictionState;
+using FrameUpdate = OutputCompositionState::FrameUpdate;
 
 std::unique_ptr<compositionengine::CompositionEngine> createCompositionEngine() {
     return std::make_unique<CompositionEngine>();
@@ -81,6 +89,15 @@ void CompositionEngine::setTimeStats(const std::shared_ptr<TimeStats>& timeStats
     mTimeStats = timeStats;
 }
 
+FrameStageStats* CompositionEngine::getFrameStageStats() const {
+    return mFrameStageStats.get();
+}
+
+void CompositionEngine::setFrameStageStats(
+        const std::shared_ptr<FrameStageStats>& frameStageStats) {
+    mFrameStageStats = frameStageStats;
+}
+
 bool CompositionEngine::needsAnotherUpdate() const {
     return mNeedsAnotherUpdate;
 }
@@ -90,12 +107,11 @@ nsecs_t CompositionEngine::getLastFrameRefreshTimestamp() const {
 }
 
 namespace {
-void offloadOutputs(Outputs& outputs) {
-    if (!FlagManager::getInstance().multithreaded_present() || outputs.size() < 2) {
-        return;
-    }
-
-    ui::PhysicalDisplayVector<compositionengine::Output*> outputsToOffload;
+// Returns the enabled HWC-enabled outputs, or none unless all of them can be presented from
+// several threads.
+ui::PhysicalDisplayVector<compositionengine::Output*> getMultithreadedOutputs(
+        const Outputs& outputs) {
+    ui::PhysicalDisplayVector<compositionengine::Output*> multithreadedOutputs;
     for (const auto& output : outputs) {
         if (!ftl::Optional(output->getDisplayId()).and_then(HalDisplayId::tryCast)) {
             // Not HWC-enabled, so it is always client-composited. No need to offload.
@@ -108,11 +124,20 @@ void offloadOutputs(Outputs& outputs) {
         // Only run present in multiple threads if all HWC-enabled displays
         // being refreshed support it.
         if (!output->supportsOffloadPresent()) {
-            return;
+            return {};
         }
-        outputsToOffload.push_back(output.get());
+        multithreadedOutputs.push_back(output.get());
+    }
+    return multithreadedOutputs;
+}
+
+void offloadOutputs(Outputs& outputs) {
+    if (!FlagManager::getInstance().multithreaded_present() || outputs.size() < 2) {
+        return;
     }
 
+    ui::PhysicalDisplayVector<compositionengine::Output*> outputsToOffload =
+            getMultithreadedOutputs(outputs);
     if (outputsToOffload.size() < 2) {
         return;
     }
@@ -127,6 +152,167 @@ void offloadOutputs(Outputs& outputs) {
 }
 } // namespace
 
+Outputs CompositionEngine::chooseFrameUpdates(const CompositionRefreshArgs& args) {
+    Outputs outputsToPresent;
+    for (const auto& output : args.outputs) {
+        output->chooseFrameUpdate(args);
+        const FrameUpdate frameUpdate = output->getState().frameUpdate;
+        if (const auto displayId = output->getDisplayId()) {
+            auto& counts = mFrameUpdateCounts[*displayId];
+            counts.name = output->getName();
+            switch (frameUpdate) {
+                case FrameUpdate::FULL:
+                    counts.full++;
+                    break;
+                case FrameUpdate::SKIPPED:
+                    counts.skipped++;
+                    break;
+                case FrameUpdate::BUFFERS_ONLY:
+                    counts.buffersOnly++;
+                    break;
+            }
+        }
+        if (frameUpdate != FrameUpdate::SKIPPED) {
+            outputsToPresent.push_back(output);
+        }
+    }
+    return outputsToPresent;
+}
+
+void CompositionEngine::startValidations(
+        const CompositionRefreshArgs& args, const Outputs& outputs,
+        ui::DisplayVector<compositionengine::Output*>& outValidated) {
+    if (!args.validateOutputsConcurrently || outputs.size() < 2) {
+        return;
+    }
+
+    // The HWC validates the outputs on their HwcAsyncWorkers, so with the same threading as an
+    // offloaded present.
+    const auto outputsToValidate = getMultithreadedOutputs(outputs);
+    if (outputsToValidate.size() < 2) {
+        return;
+    }
+
+    ATRACE_CALL();
+    for (compositionengine::Output* output : outputsToValidate) {
+        output->startValidation(args);
+        outValidated.push_back(output);
+    }
+}
+
+void CompositionEngine::recordValidations(
+        const ui::DisplayVector<compositionengine::Output*>& validated) {
+    if (validated.empty()) {
+        return;
+    }
+
+    auto& stats = mConcurrentValidationStats;
+    stats.frames++;
+    for (const compositionengine::Output* output : validated) {
+        stats.validations++;
+        switch (output->getState().strategyPrediction) {
+            case CompositionStrategyPredictionState::SUCCESS:
+                stats.predictionHits++;
+                [[fallthrough]];
+            case CompositionStrategyPredictionState::FAIL:
+                stats.predictions++;
+                break;
+            case CompositionStrategyPredictionState::DISABLED:
+                break;
+        }
+    }
+}
+
+void CompositionEngine::presentOutputs(
+        const CompositionRefreshArgs& args, const Outputs& outputs,
+        ui::DisplayVector<ftl::Future<std::monostate>>& outFutures) {
+    struct OutputPresent {
+        compositionengine::Output* output = nullptr;
+        bool inParallel = false;
+        std::future<bool> worker;
+        ftl::Future<std::monostate> future;
+        Duration duration = Duration::fromNs(0);
+    };
+
+    ui::DisplayVector<OutputPresent> presents;
+    for (const auto& output : outputs) {
+        presents.push_back(OutputPresent{.output = output.get()});
+    }
+
+    // The HWC is called from each of the threads, as for an offloaded present, and RenderEngine
+    // queues the drawing of all of them on its own thread.
+    size_t parallelCount = 0;
+    if (args.presentOutputsInParallel && outputs.size() >= 2) {
+        const auto parallelOutputs = getMultithreadedOutputs(outputs);
+        // All but the last of them present on workers, and the last one on this thread along
+        // with the outputs which can't be presented in parallel.
+        for (size_t i = 0; i + 1 < parallelOutputs.size(); i++) {
+            const auto it = std::find_if(presents.begin(), presents.end(),
+                                         [output = parallelOutputs[i]](const auto& present) {
+                                             return present.output == output;
+                                         });
+            it->inParallel = true;
+            parallelCount++;
+        }
+    }
+    while (mPresentWorkers.size() < parallelCount) {
+        mPresentWorkers.push_back(std::make_unique<HwcAsyncWorker>());
+    }
+
+    const auto presentOutput = [&args](OutputPresent& present) {
+        const TimePoint startTime = TimePoint::now();
+        present.future = present.output->present(args);
+        present.duration = TimePoint::now() - startTime;
+    };
+
+    size_t workerIndex = 0;
+    for (auto& present : presents) {
+        if (present.inParallel) {
+            present.worker = mPresentWorkers[workerIndex++]->send([&present, &presentOutput] {
+                presentOutput(present);
+                return true;
+            });
+        }
+    }
+    for (auto& present : presents) {
+        if (!present.inParallel) {
+            presentOutput(present);
+        }
+    }
+
+    if (parallelCount > 0) {
+        ATRACE_NAME("Waiting on parallel presents");
+        for (auto& present : presents) {
+            if (present.inParallel) {
+                present.worker.get();
+            }
+        }
+    }
+
+    for (auto& present : presents) {
+        if (args.presentOutputsInParallel) {
+            recordPresentTiming(*present.output, present.duration, present.inParallel);
+        }
+        outFutures.push_back(std::move(present.future));
+    }
+}
+
+void CompositionEngine::recordPresentTiming(const compositionengine::Output& output,
+                                            Duration duration, bool inParallel) {
+    const auto displayId = output.getDisplayId();
+    if (!displayId) {
+        return;
+    }
+
+    auto& timing = mPresentTimings[*displayId];
+    timing.name = output.getName();
+    timing.lastDuration = duration;
+    timing.maxDuration = std::max(timing.maxDuration, duration);
+    timing.totalDuration = timing.totalDuration + duration;
+    timing.count++;
+    timing.lastInParallel = inParallel;
+}
+
 void CompositionEngine::present(CompositionRefreshArgs& args) {
     ATRACE_CALL();
     ALOGV(__FUNCTION__);
@@ -144,15 +330,25 @@ void CompositionEngine::present(CompositionRefreshArgs& args) {
         }
     }
 
+    // The outputs on which nothing changed keep showing their last frame.
+    Outputs outputsToPresent;
+    if (args.skipIdleOutputs) {
+        outputsToPresent = chooseFrameUpdates(args);
+    }
+    Outputs& outputs = args.skipIdleOutputs ? outputsToPresent : args.outputs;
+
     // Offloading the HWC call for `present` allows us to simultaneously call it
     // on multiple displays. This is desirable because these calls block and can
     // be slow.
-    offloadOutputs(args.outputs);
+    offloadOutputs(outputs);
+
+    // Likewise for validating, which each output otherwise only overlaps with its own client
+    // composition.
+    ui::DisplayVector<compositionengine::Output*> validatedOutputs;
+    startValidations(args, outputs, validatedOutputs);
 
     ui::DisplayVector<ftl::Future<std::monostate>> presentFutures;
-    for (const auto& output : args.outputs) {
-        presentFutures.push_back(output->present(args));
-    }
+    presentOutputs(args, outputs, presentFutures);
 
     {
         ATRACE_NAME("Waiting on HWC");
@@ -162,6 +358,8 @@ void CompositionEngine::present(CompositionRefreshArgs& args) {
             future.get();
         }
     }
+
+    recordValidations(validatedOutputs);
 }
 
 void CompositionEngine::updateCursorAsync(CompositionRefreshArgs& args) {
@@ -196,8 +394,46 @@ FeatureFlags CompositionEngine::getFeatureFlags() const {
     return {};
 }
 
-void CompositionEngine::dump(std::string&) const {
-    // The base class has no state to dump, but derived classes might.
+void CompositionEngine::dump(std::string& result) const {
+    if (!mPresentTimings.empty()) {
+        result.append("Output present timing:\n");
+        for (const auto& [displayId, timing] : mPresentTimings) {
+            const Duration average = Duration::fromNs(timing.totalDuration.ns() /
+                                                      static_cast<nsecs_t>(timing.count));
+            base::StringAppendF(&result,
+                                "    %s (%s): last %.3f ms, average %.3f ms, max %.3f ms%s\n",
+                                timing.name.c_str(), to_string(displayId).c_str(),
+                                ticks<std::milli, float>(timing.lastDuration),
+                                ticks<std::milli, float>(average),
+                                ticks<std::milli, float>(timing.maxDuration),
+                                timing.lastInParallel ? ", in parallel" : "");
+        }
+    }
+
+    if (!mFrameUpdateCounts.empty()) {
+        result.append("Output frame updates:\n");
+        for (const auto& [displayId, counts] : mFrameUpdateCounts) {
+            base::StringAppendF(&result,
+                                "    %s (%s): %" PRIu64 " full, %" PRIu64 " skipped, %" PRIu64
+                                " buffers only\n",
+                                counts.name.c_str(), to_string(displayId).c_str(), counts.full,
+                                counts.skipped, counts.buffersOnly);
+        }
+    }
+
+    const auto& stats = mConcurrentValidationStats;
+    if (stats.frames == 0) {
+        return;
+    }
+
+    const double hitPercent = stats.predictions == 0
+            ? 0.0
+            : 100.0 * static_cast<double>(stats.predictionHits) /
+                    static_cast<double>(stats.predictions);
+    base::StringAppendF(&result,
+                        "Concurrent HWC validation: %" PRIu64 " frames, %" PRIu64
+                        " outputs validated, %" PRIu64 " strategies predicted, %.1f%% hit\n",
+                        stats.frames, stats.validations, stats.predictions, hitPercent);
 }
 
 void CompositionEngine::setNeedsAnotherUpdateForTest(bool value) {
@@ -268,6 +268,11 @@ bool Display::chooseCompositionStrategy(
         return false;
     }
 
+    if (auto* frameStageStats = getCompositionEngine().getFrameStageStats()) {
+        frameStageStats->record(mId, FrameStageStats::Stage::CompositionStrategy,
+                                TimePoint::now() - hwcValidateStartTime);
+    }
+
     if (isPowerHintSessionEnabled()) {
         mPowerAdvisor->setHwcValidateTiming(mId, hwcValidateStartTime, TimePoint::now());
         if (auto halDisplayId = HalDisplayId::tryCast(mId)) {
@@ -383,6 +388,10 @@ compositionengine::Output::FrameFences Display::presentFrame() {
 
     hwc.presentAndGetReleaseFences(*halDisplayIdOpt, getState().earliestPresentTime);
 
+    if (auto* frameStageStats = getCompositionEngine().getFrameStageStats()) {
+        frameStageStats->record(mId, FrameStageStats::Stage::Present, TimePoint::now() - startTime);
+    }
+
     if (isPowerHintSessionEnabled()) {
         mPowerAdvisor->setHwcPresentTiming(mId, startTime, TimePoint::now());
     }
@@ -15,11 +15,14 @@
  */
 
 #include <compositionengine/DisplaySurface.h>
+#include <ui/Region.h>
 
 namespace android::compositionengine {
 
 DisplaySurface::~DisplaySurface() = default;
 
+void DisplaySurface::setClientTargetDamage(const Region&) {}
+
 bool DisplaySurface::supportsCompositionStrategyPrediction() const {
     return true;
 }
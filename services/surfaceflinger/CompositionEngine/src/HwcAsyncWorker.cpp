@@ -60,11 +60,13 @@ void HwcAsyncWorker::run() {
     std::unique_lock<std::mutex> lock(mMutex);
     android::base::ScopedLockAssertion assumeLock(mMutex);
     while (!mDone) {
-        mCv.wait(lock);
+        // A task may have been sent before the thread got to wait for it.
         if (mTaskRequested && mTask.valid()) {
             mTask();
             mTaskRequested = false;
+            continue;
         }
+        mCv.wait(lock);
     }
 }
 
@@ -16,13 +16,32 @@
 
 #include <compositionengine/impl/HwcBufferCache.h>
 
+#include <algorithm>
+#include <cinttypes>
+
+#include <android-base/properties.h>
+#include <android-base/stringprintf.h>
 #include <gui/BufferQueue.h>
 #include <ui/GraphicBuffer.h>
 
 namespace android::compositionengine::impl {
 
-HwcBufferCache::HwcBufferCache() {
-    for (uint32_t i = kMaxLayerBufferCount; i-- > 0;) {
+namespace {
+
+uint32_t getDefaultSlotBudget() {
+    static const uint32_t sSlotBudget =
+            base::GetUintProperty<uint32_t>(std::string("debug.sf.hwc_buffer_cache_slots"),
+                                            BufferQueue::NUM_BUFFER_SLOTS);
+    return sSlotBudget;
+}
+
+} // namespace
+
+HwcBufferCache::HwcBufferCache() : HwcBufferCache(getDefaultSlotBudget()) {}
+
+HwcBufferCache::HwcBufferCache(uint32_t slotBudget)
+      : mSlotBudget(std::clamp<uint32_t>(slotBudget, 1, kMaxLayerBufferCount)) {
+    for (uint32_t i = mSlotBudget; i-- > 0;) {
         mFreeSlots.push(i);
     }
 }
@@ -32,8 +51,10 @@ HwcSlotAndBuffer HwcBufferCache::getHwcSlotAndBuffer(const sp<GraphicBuffer>& bu
         Cache& cache = i->second;
         // mark this cache slot as more recently used so it won't get evicted anytime soon
         cache.lruCounter = mLeastRecentlyUsedCounter++;
+        mStats.hits++;
         return {cache.slot, nullptr};
     }
+    mStats.misses++;
     return {cache(buffer), buffer};
 }
 
@@ -81,10 +102,19 @@ uint32_t HwcBufferCache::getLeastRecentlyUsedSlot() {
         uint32_t slot = cacheToErase->second.slot;
         mCacheByBufferId.erase(cacheToErase);
         mFreeSlots.push(slot);
+        mStats.evictions++;
     }
     uint32_t slot = mFreeSlots.top();
     mFreeSlots.pop();
     return slot;
 }
 
+void HwcBufferCache::dump(std::string& out) const {
+    base::StringAppendF(&out,
+                        "bufferCache={slots=%zu/%" PRIu32 " hits=%" PRIu64 " misses=%" PRIu64
+                        " evictions=%" PRIu64 "} ",
+                        mCacheByBufferId.size(), mSlotBudget, mStats.hits, mStats.misses,
+                        mStats.evictions);
+}
+
 } // namespace android::compositionengine::impl
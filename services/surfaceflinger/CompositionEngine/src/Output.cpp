@@ -35,6 +35,7 @@
 #include <scheduler/FrameTargeter.h>
 #include <scheduler/Time.h>
 
+#include <cinttypes>
 #include <optional>
 #include <thread>
 
@@ -66,6 +67,8 @@ Output::~Output() = default;
 namespace impl {
 using CompositionStrategyPredictionState =
         OutputCompositionState::CompositionStrategyPredictionState;
+using FrameUpdate = OutputCompositionState::FrameUpdate;
+using FrameChanges = LayerFECompositionState::FrameChanges;
 namespace {
 
 template <typename T>
@@ -148,6 +151,10 @@ void Output::setLayerCachingEnabled(bool enabled) {
         if (mRenderSurface) {
             mPlanner->setDisplaySize(mRenderSurface->getSize());
         }
+        if (const auto displayId = getDisplayId()) {
+            mPlanner->setPredictionsFile("planner_predictions_" +
+                                         std::to_string(displayId->value));
+        }
     } else {
         mPlanner.reset();
     }
@@ -322,6 +329,16 @@ void Output::dumpBase(std::string& out) const {
         out.append("    No render surface!\n");
     }
 
+    if (mClientCompositionRequestCache) {
+        const auto& stats = mClientCompositionRequestCache->getStats();
+        base::StringAppendF(&out,
+                            "\n   Client composition cache: %zu/%" PRIu32 " entries, %" PRIu64
+                            " hits, %" PRIu64 " misses\n",
+                            mClientCompositionRequestCache->getCacheSize(),
+                            mClientCompositionRequestCache->getMaxCacheSize(), stats.hits,
+                            stats.misses);
+    }
+
     base::StringAppendF(&out, "\n   %zu Layers\n", getOutputLayerCount());
     for (const auto* outputLayer : getOutputLayersOrderedByZ()) {
         if (!outputLayer) {
@@ -429,6 +446,54 @@ void Output::prepare(const compositionengine::CompositionRefreshArgs& refreshArg
 
     rebuildLayerStacks(refreshArgs, geomSnapshots);
     uncacheBuffers(refreshArgs.bufferIdsToUncache);
+    editState().frameUpdate = FrameUpdate::FULL;
+}
+
+void Output::chooseFrameUpdate(const compositionengine::CompositionRefreshArgs& refreshArgs) {
+    auto& outputState = editState();
+    outputState.frameUpdate = FrameUpdate::FULL;
+
+    // Only a display which the HWC presents keeps the last frame on screen without presenting it
+    // again. Anything which applies to all the layers needs a full frame.
+    const bool isPhysical =
+            ftl::Optional(getDisplayId()).and_then(PhysicalDisplayId::tryCast).has_value();
+    if (!outputState.isEnabled || !isPhysical ||
+        refreshArgs.updatingOutputGeometryThisFrame || refreshArgs.updatingGeometryThisFrame ||
+        refreshArgs.colorTransformMatrix || refreshArgs.devOptForceClientComposition ||
+        refreshArgs.devOptFlashDirtyRegionsDelay || !refreshArgs.borderInfoList.empty() ||
+        !refreshArgs.bufferIdsToUncache.empty()) {
+        return;
+    }
+
+    bool buffersChanged = false;
+    for (const auto* layer : getOutputLayersOrderedByZ()) {
+        const auto* layerFEState = layer->getLayerFE().getCompositionState();
+        if (!layerFEState || layerFEState->frameChanges == FrameChanges::ALL) {
+            return;
+        }
+        if (layerFEState->frameChanges == FrameChanges::NONE) {
+            continue;
+        }
+
+        // Passing on just the buffer is only enough if the HWC composites the layer as it did
+        // in the last frame, and the client target is not drawn. The planner would also need
+        // to see the buffer, as it may flatten the layer.
+        const auto& layerState = layer->getState();
+        if (mPlanner || outputState.usesClientComposition || !layerFEState->buffer ||
+            layerFEState->compositionType != Composition::DEVICE || !layerState.hwc ||
+            layerState.hwc->hwcCompositionType != Composition::DEVICE ||
+            layerState.hwc->stateOverridden || layerState.hwc->layerSkipped ||
+            layerState.forceClientComposition || layerState.overrideInfo.buffer) {
+            return;
+        }
+        buffersChanged = true;
+    }
+
+    if (buffersChanged) {
+        outputState.frameUpdate = FrameUpdate::BUFFERS_ONLY;
+    } else if (outputState.dirtyRegion.isEmpty()) {
+        outputState.frameUpdate = FrameUpdate::SKIPPED;
+    }
 }
 
 ftl::Future<std::monostate> Output::present(
@@ -457,19 +522,21 @@ ftl::Future<std::monostate> Output::present(
                   stringifyExpectedPresentTime().c_str());
     ALOGV(__FUNCTION__);
 
-    updateColorProfile(refreshArgs);
-    updateCompositionState(refreshArgs);
-    planComposition();
-    writeCompositionState(refreshArgs);
-    setColorTransform(refreshArgs);
-    beginFrame();
+    if (!mPresentStarted) {
+        beginPresent(refreshArgs);
+    }
+    mPresentStarted = false;
 
     GpuCompositionResult result;
-    const bool predictCompositionStrategy = canPredictCompositionStrategy(refreshArgs);
-    if (predictCompositionStrategy) {
-        result = prepareFrameAsync();
+    if (mStartedValidation) {
+        result = finishValidation();
     } else {
-        prepareFrame();
+        const bool predictCompositionStrategy = canPredictCompositionStrategy(refreshArgs);
+        if (predictCompositionStrategy) {
+            result = prepareFrameAsync();
+        } else {
+            prepareFrame();
+        }
     }
 
     devOptRepaintFlash(refreshArgs);
@@ -496,6 +563,46 @@ void Output::offloadPresentNextFrame() {
     updateHwcAsyncWorker();
 }
 
+void Output::beginPresent(const compositionengine::CompositionRefreshArgs& refreshArgs) {
+    if (getState().frameUpdate == FrameUpdate::BUFFERS_ONLY) {
+        // The rest of the state which the HWC has is that of the last frame, and still current.
+        writeBufferUpdates(refreshArgs);
+    } else {
+        updateColorProfile(refreshArgs);
+        updateCompositionState(refreshArgs);
+        planComposition();
+        writeCompositionState(refreshArgs);
+        setColorTransform(refreshArgs);
+    }
+    // The flashes of the dirty regions are queued as frames of their own.
+    editState().partialClientComposition =
+            mPartialClientComposition && !refreshArgs.devOptFlashDirtyRegionsDelay;
+    beginFrame();
+}
+
+void Output::startValidation(const compositionengine::CompositionRefreshArgs& refreshArgs) {
+    ATRACE_FORMAT("%s for %s", __func__, mNamePlusId.c_str());
+    ALOGV(__FUNCTION__);
+
+    beginPresent(refreshArgs);
+    mPresentStarted = true;
+
+    // As in prepareFrame, there is nothing to choose for a disabled output.
+    if (!getState().isEnabled) {
+        return;
+    }
+
+    // As for offloadPresentNextFrame, the HwcAsyncWorker is left in place once this frame no
+    // longer needs it, so that it isn't churned.
+    mValidateAsync = true;
+    updateHwcAsyncWorker();
+
+    mStartedValidation = std::make_unique<StartedValidation>();
+    mStartedValidation->predicted = canPredictCompositionStrategy(refreshArgs);
+    resetCompositionStrategy();
+    mStartedValidation->success = chooseCompositionStrategyAsync(&mStartedValidation->changes);
+}
+
 void Output::uncacheBuffers(std::vector<uint64_t> const& bufferIdsToUncache) {
     if (bufferIdsToUncache.empty()) {
         return;
@@ -878,16 +985,7 @@ void Output::writeCompositionState(const compositionengine::CompositionRefreshAr
         return;
     }
 
-    if (auto frameTargetPtrOpt = ftl::Optional(getDisplayId())
-                                         .and_then(PhysicalDisplayId::tryCast)
-                                         .and_then([&refreshArgs](PhysicalDisplayId id) {
-                                             return refreshArgs.frameTargets.get(id);
-                                         })) {
-        editState().earliestPresentTime = frameTargetPtrOpt->get()->earliestPresentTime();
-        editState().expectedPresentTime = frameTargetPtrOpt->get()->expectedPresentTime().ns();
-    }
-    editState().frameInterval = refreshArgs.frameInterval;
-    editState().powerCallback = refreshArgs.powerCallback;
+    writeFrameTargetState(refreshArgs);
 
     compositionengine::OutputLayer* peekThroughLayer = nullptr;
     sp<GraphicBuffer> previousOverride = nullptr;
@@ -943,6 +1041,31 @@ void Output::writeCompositionState(const compositionengine::CompositionRefreshAr
     editState().outputLayerHash = outputLayerHash;
 }
 
+void Output::writeBufferUpdates(const compositionengine::CompositionRefreshArgs& refreshArgs) {
+    ATRACE_CALL();
+    ALOGV(__FUNCTION__);
+
+    writeFrameTargetState(refreshArgs);
+    for (auto* layer : getOutputLayersOrderedByZ()) {
+        if (layer->getLayerFE().getCompositionState()->frameChanges == FrameChanges::BUFFER) {
+            layer->writeBufferUpdateToHWC();
+        }
+    }
+}
+
+void Output::writeFrameTargetState(const compositionengine::CompositionRefreshArgs& refreshArgs) {
+    if (auto frameTargetPtrOpt = ftl::Optional(getDisplayId())
+                                         .and_then(PhysicalDisplayId::tryCast)
+                                         .and_then([&refreshArgs](PhysicalDisplayId id) {
+                                             return refreshArgs.frameTargets.get(id);
+                                         })) {
+        editState().earliestPresentTime = frameTargetPtrOpt->get()->earliestPresentTime();
+        editState().expectedPresentTime = frameTargetPtrOpt->get()->expectedPresentTime().ns();
+    }
+    editState().frameInterval = refreshArgs.frameInterval;
+    editState().powerCallback = refreshArgs.powerCallback;
+}
+
 compositionengine::OutputLayer* Output::findLayerRequestingBackgroundComposition() const {
     compositionengine::OutputLayer* layerRequestingBgComposition = nullptr;
     for (size_t i = 0; i < getOutputLayerCount(); i++) {
@@ -1123,7 +1246,31 @@ void Output::beginFrame() {
 
     if (mMustRecompose) {
         outputState.lastCompositionHadVisibleLayers = !empty;
+        if (outputState.partialClientComposition) {
+            mRenderSurface->addFrameDamage(getFramebufferDirtyRegion());
+        }
     }
+    mClientTargetDrawn = false;
+}
+
+Region Output::getFramebufferDirtyRegion() const {
+    const auto& outputState = getState();
+    const Rect framebufferBounds = outputState.framebufferSpace.getBoundsAsRect();
+    if (Region(outputState.displaySpace.getBoundsAsRect())
+                .subtractSelf(outputState.dirtyRegion)
+                .isEmpty()) {
+        return Region(framebufferBounds);
+    }
+
+    const ui::Transform transform =
+            outputState.layerStackSpace.getTransform(outputState.framebufferSpace);
+    // Outset by a pixel, since scaled and filtered layers reach into the pixels around their
+    // dirty region.
+    Region dirtyRegion;
+    for (const Rect& rect : transform.transform(getDirtyRegion())) {
+        dirtyRegion.orSelf(Rect(rect.left - 1, rect.top - 1, rect.right + 1, rect.bottom + 1));
+    }
+    return dirtyRegion.intersect(framebufferBounds);
 }
 
 void Output::prepareFrame() {
@@ -1164,11 +1311,38 @@ std::future<bool> Output::chooseCompositionStrategyAsync(
 GpuCompositionResult Output::prepareFrameAsync() {
     ATRACE_CALL();
     ALOGV(__FUNCTION__);
-    auto& state = editState();
-    const auto& previousChanges = state.previousDeviceRequestedChanges;
     std::optional<android::HWComposer::DeviceRequestedChanges> changes;
     resetCompositionStrategy();
     auto hwcResult = chooseCompositionStrategyAsync(&changes);
+    return composeWhileChoosingCompositionStrategy(hwcResult, changes);
+}
+
+GpuCompositionResult Output::finishValidation() {
+    ATRACE_CALL();
+    ALOGV(__FUNCTION__);
+    mValidateAsync = false;
+    const std::unique_ptr<StartedValidation> validation = std::move(mStartedValidation);
+    if (validation->predicted) {
+        return composeWhileChoosingCompositionStrategy(validation->success, validation->changes);
+    }
+
+    auto& state = editState();
+    const bool success = validation->success.get();
+    state.strategyPrediction = CompositionStrategyPredictionState::DISABLED;
+    state.previousDeviceRequestedChanges = validation->changes;
+    state.previousDeviceRequestedSuccess = success;
+    if (success) {
+        applyCompositionStrategy(validation->changes);
+    }
+    finishPrepareFrame();
+    return {};
+}
+
+GpuCompositionResult Output::composeWhileChoosingCompositionStrategy(
+        std::future<bool>& hwcResult,
+        std::optional<android::HWComposer::DeviceRequestedChanges>& changes) {
+    auto& state = editState();
+    const auto& previousChanges = state.previousDeviceRequestedChanges;
     if (state.previousDeviceRequestedSuccess) {
         applyCompositionStrategy(previousChanges);
     }
@@ -1269,6 +1443,11 @@ void Output::finishFrame(GpuCompositionResult&& result) {
     }
     // swap buffers (presentation)
     mRenderSurface->queueBuffer(std::move(*optReadyFence), getHdrSdrRatio(buffer));
+    if (outputState.partialClientComposition &&
+        (outputState.usesClientComposition || outputState.flipClientTarget)) {
+        mQueuedClientTargetContent = std::move(mComposedClientTargetContent);
+        mComposedClientTargetContent.reset();
+    }
 }
 
 void Output::updateProtectedContentState() {
@@ -1357,21 +1536,39 @@ std::optional<base::unique_fd> Output::composeSurfaces(
     appendRegionFlashRequests(debugRegion, clientCompositionLayers);
 
     OutputCompositionState& outputCompositionState = editState();
+    std::optional<ClientTargetContent> clientTargetContent;
+    bool redrawsDamageOnly = false;
+    if (outputState.partialClientComposition) {
+        clientTargetContent = getClientTargetContent(clientCompositionDisplay);
+        // Only redraw the damage of the buffer if it was last drawn from the same content, short
+        // of the dirty region, and not drawn yet this frame. The dirty flashes are drawn whole.
+        redrawsDamageOnly = !mClientTargetDrawn && debugRegion.isEmpty() &&
+                clientTargetContent == mQueuedClientTargetContent;
+        // Otherwise the frame may differ from the last one queued beyond the dirty region.
+        if (!redrawsDamageOnly) {
+            mRenderSurface->addFrameDamage(Region(outputState.framebufferSpace.getBoundsAsRect()));
+        }
+    }
+
     // Check if the client composition requests were rendered into the provided graphic buffer. If
     // so, we can reuse the buffer and avoid client composition.
     if (mClientCompositionRequestCache) {
-        if (mClientCompositionRequestCache->exists(tex->getBuffer()->getId(),
+        const size_t requestHash =
+                ClientCompositionRequestCache::computeHash(clientCompositionDisplay,
+                                                           clientCompositionLayers);
+        if (mClientCompositionRequestCache->exists(tex->getBuffer()->getId(), requestHash,
                                                    clientCompositionDisplay,
                                                    clientCompositionLayers)) {
             ATRACE_NAME("ClientCompositionCacheHit");
             outputCompositionState.reusedClientComposition = true;
             setExpensiveRenderingExpected(false);
+            mComposedClientTargetContent = std::move(clientTargetContent);
             // b/239944175 pass the fence associated with the buffer.
             return base::unique_fd(std::move(fd));
         }
         ATRACE_NAME("ClientCompositionCacheMiss");
-        mClientCompositionRequestCache->add(tex->getBuffer()->getId(), clientCompositionDisplay,
-                                            clientCompositionLayers);
+        mClientCompositionRequestCache->add(tex->getBuffer()->getId(), requestHash,
+                                            clientCompositionDisplay, clientCompositionLayers);
     }
 
     // We boost GPU frequency here because there will be color spaces conversion
@@ -1396,6 +1593,11 @@ std::optional<base::unique_fd> Output::composeSurfaces(
                        return settings;
                    });
 
+    if (redrawsDamageOnly) {
+        clientCompositionDisplay.damage = mRenderSurface->getBufferDamage();
+    }
+    mClientTargetDrawn = true;
+
     const nsecs_t renderEngineStart = systemTime();
     auto fenceResult = renderEngine
                                .drawLayers(clientCompositionDisplay, clientRenderEngineLayers, tex,
@@ -1407,6 +1609,11 @@ std::optional<base::unique_fd> Output::composeSurfaces(
         mClientCompositionRequestCache->remove(tex->getBuffer()->getId());
     }
 
+    // A buffer which failed to render holds unknown content, and is redrawn whole next time.
+    mComposedClientTargetContent = fenceStatus(fenceResult) == NO_ERROR
+            ? std::move(clientTargetContent)
+            : std::nullopt;
+
     const auto fence = std::move(fenceResult).value_or(Fence::NO_FENCE);
 
     if (auto timeStats = getCompositionEngine().getTimeStats()) {
@@ -1418,6 +1625,13 @@ std::optional<base::unique_fd> Output::composeSurfaces(
         }
     }
 
+    if (const auto displayId = getDisplayId()) {
+        if (auto* frameStageStats = getCompositionEngine().getFrameStageStats()) {
+            frameStageStats->record(*displayId, FrameStageStats::Stage::RenderEngine,
+                                    Duration::fromNs(systemTime() - renderEngineStart));
+        }
+    }
+
     for (auto* clientComposedLayer : clientCompositionLayersFE) {
         clientComposedLayer->setWasClientComposed(fence);
     }
@@ -1693,7 +1907,7 @@ void Output::setPredictCompositionStrategy(bool predict) {
 }
 
 void Output::updateHwcAsyncWorker() {
-    if (mPredictCompositionStrategy || mOffloadPresent) {
+    if (mPredictCompositionStrategy || mOffloadPresent || mValidateAsync) {
         if (!mHwComposerAsyncWorker) {
             mHwComposerAsyncWorker = std::make_unique<HwcAsyncWorker>();
         }
@@ -1706,6 +1920,35 @@ void Output::setTreat170mAsSrgb(bool enable) {
     editState().treat170mAsSrgb = enable;
 }
 
+void Output::setPartialClientComposition(bool enable) {
+    mPartialClientComposition = enable;
+}
+
+bool Output::ClientTargetContent::Layer::operator==(const Layer& other) const {
+    return sequence == other.sequence && clientComposition == other.clientComposition &&
+            clearClientTarget == other.clearClientTarget &&
+            overrideBufferId == other.overrideBufferId;
+}
+
+bool Output::ClientTargetContent::operator==(const ClientTargetContent& other) const {
+    return display == other.display && layers == other.layers;
+}
+
+Output::ClientTargetContent Output::getClientTargetContent(
+        const renderengine::DisplaySettings& display) const {
+    ClientTargetContent content{.display = display};
+    content.layers.reserve(getOutputLayerCount());
+    for (auto* layer : getOutputLayersOrderedByZ()) {
+        const auto& overrideBuffer = layer->getState().overrideInfo.buffer;
+        content.layers.push_back(
+                {.sequence = layer->getLayerFE().getSequence(),
+                 .clientComposition = layer->requiresClientComposition(),
+                 .clearClientTarget = layer->getState().clearClientTarget,
+                 .overrideBufferId = overrideBuffer ? overrideBuffer->getBuffer()->getId() : 0});
+    }
+    return content;
+}
+
 bool Output::canPredictCompositionStrategy(const CompositionRefreshArgs& refreshArgs) {
     uint64_t lastOutputLayerHash = getState().lastOutputLayerHash;
     uint64_t outputLayerHash = getState().outputLayerHash;
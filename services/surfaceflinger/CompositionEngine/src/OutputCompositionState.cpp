@@ -63,10 +63,12 @@ void OutputCompositionState::dump(std::string& out) const {
     dumpVal(out, "displayBrightness", displayBrightness);
     out.append("\n   ");
     dumpVal(out, "compositionStrategyPredictionState", ftl::enum_string(strategyPrediction));
+    dumpVal(out, "frameUpdate", ftl::enum_string(frameUpdate));
     out.append("\n   ");
 
     out.append("\n   ");
     dumpVal(out, "treat170mAsSrgb", treat170mAsSrgb);
+    dumpVal(out, "partialClientComposition", partialClientComposition);
 
     out.append("\n");
     for (const auto& borderRenderInfo : borderInfoList) {
@@ -424,6 +424,28 @@ void OutputLayer::writeStateToHWC(bool includeGeometry, bool skipLayer, uint32_t
     editState().hwc->layerSkipped = skipLayer;
 }
 
+void OutputLayer::writeBufferUpdateToHWC() {
+    const auto& state = getState();
+    if (!state.hwc || !state.hwc->hwcLayer) {
+        return;
+    }
+
+    const auto* outputIndependentState = getLayerFE().getCompositionState();
+    if (!outputIndependentState) {
+        return;
+    }
+
+    auto* hwcLayer = state.hwc->hwcLayer.get();
+    if (auto error = hwcLayer->setSurfaceDamage(outputIndependentState->surfaceDamage);
+        error != hal::Error::NONE) {
+        ALOGE("[%s] Failed to set surface damage: %s (%d)", getLayerFE().getDebugName(),
+              to_string(error).c_str(), static_cast<int32_t>(error));
+    }
+
+    constexpr bool skipLayer = false;
+    writeBufferStateToHWC(hwcLayer, *outputIndependentState, skipLayer);
+}
+
 void OutputLayer::writeOutputDependentGeometryStateToHWC(HWC2::Layer* hwcLayer,
                                                          Composition requestedCompositionType,
                                                          uint32_t z) {
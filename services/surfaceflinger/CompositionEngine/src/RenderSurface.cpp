@@ -193,11 +193,36 @@ std::shared_ptr<renderengine::ExternalTexture> RenderSurface::dequeueBuffer(
         mTextureCache.erase(mTextureCache.begin());
     }
 
+    if (mTracksDamage &&
+        mNativeWindow->query(mNativeWindow.get(), NATIVE_WINDOW_BUFFER_AGE, &mBufferAge) !=
+                NO_ERROR) {
+        mBufferAge = 0;
+    }
+
     *bufferFence = base::unique_fd(fd);
 
     return mTexture;
 }
 
+void RenderSurface::addFrameDamage(const Region& damage) {
+    mTracksDamage = true;
+    mFrameDamage.orSelf(damage);
+}
+
+Region RenderSurface::getBufferDamage() const {
+    if (!mTracksDamage || mTexture == nullptr || mBufferAge <= 0 ||
+        static_cast<size_t>(mBufferAge) > mDamageHistory.size() + 1) {
+        return Region::INVALID_REGION;
+    }
+
+    // A buffer of age 1 holds the last frame queued, so only the damage since then is missing.
+    Region damage = mFrameDamage;
+    for (int i = 0; i < mBufferAge - 1; i++) {
+        damage.orSelf(mDamageHistory[i]);
+    }
+    return damage;
+}
+
 void RenderSurface::queueBuffer(base::unique_fd readyFence, float hdrSdrRatio) {
     auto& state = mDisplay.getState();
 
@@ -223,6 +248,17 @@ void RenderSurface::queueBuffer(base::unique_fd readyFence, float hdrSdrRatio) {
             status_t result = mNativeWindow->queueBuffer(mNativeWindow.get(),
                                                          mTexture->getBuffer()->getNativeBuffer(),
                                                          dup(readyFence));
+            if (result == NO_ERROR && mTracksDamage) {
+                // A buffer flipped without being drawn holds an older frame.
+                const Region damage =
+                        state.usesClientComposition ? mFrameDamage : Region(Rect(mSize));
+                mDisplaySurface->setClientTargetDamage(damage);
+                mDamageHistory.push_front(damage);
+                if (mDamageHistory.size() > kMaxDamageHistory) {
+                    mDamageHistory.pop_back();
+                }
+                mFrameDamage.clear();
+            }
             if (result != NO_ERROR) {
                 ALOGE("Error when queueing buffer for display [%s]: %d", mDisplay.getName().c_str(),
                       result);
@@ -259,6 +295,9 @@ void RenderSurface::dump(std::string& out) const {
     out.append("\n   ");
 
     dumpVal(out, "size", mSize);
+    if (mTracksDamage) {
+        dumpVal(out, "bufferAge", mBufferAge);
+    }
     StringAppendF(&out, "ANativeWindow=%p (format %d) ", mNativeWindow.get(),
                   ANativeWindow_getFormat(mNativeWindow.get()));
     out.append("\n");
@@ -160,7 +160,7 @@ void CachedSet::updateAge(std::chrono::steady_clock::time_point now) {
 
 void CachedSet::render(renderengine::RenderEngine& renderEngine, TexturePool& texturePool,
                        const OutputCompositionState& outputState,
-                       bool deviceHandlesColorTransform) {
+                       bool deviceHandlesColorTransform, bool waitForRenderEngine) {
     ATRACE_CALL();
     if (outputState.powerCallback) {
         outputState.powerCallback->notifyCpuLoadUp();
@@ -178,6 +178,7 @@ void CachedSet::render(renderengine::RenderEngine& renderEngine, TexturePool& te
             .deviceHandlesColorTransform = deviceHandlesColorTransform,
             .orientation = orientation,
             .targetLuminanceNits = outputState.displayBrightnessNits,
+            .priority = renderengine::RenderPriority::CACHE,
     };
 
     LayerFE::ClientCompositionTargetSettings
@@ -275,23 +276,47 @@ void CachedSet::render(renderengine::RenderEngine& renderEngine, TexturePool& te
         bufferFence.reset(texture->getReadyFence()->dup());
     }
 
-    auto fenceResult = renderEngine
-                               .drawLayers(displaySettings, layerSettings, texture->get(),
-                                           std::move(bufferFence))
-                               .get();
+    mPendingRender = PendingRender{
+            .fenceResult = renderEngine
+                                   .drawLayers(displaySettings, layerSettings, texture->get(),
+                                               std::move(bufferFence))
+                                   .share(),
+            .texture = texture,
+            .outputSpace = outputState.framebufferSpace,
+            .outputDataspace = outputDataspace,
+            .orientation = orientation,
+    };
+
+    if (waitForRenderEngine) {
+        finishRender(/*wait=*/true);
+    }
+}
+
+bool CachedSet::finishRender(bool wait) {
+    if (!mPendingRender) {
+        return true;
+    }
+
+    if (!wait &&
+        mPendingRender->fenceResult.wait_for(std::chrono::nanoseconds::zero()) !=
+                std::future_status::ready) {
+        return false;
+    }
 
+    FenceResult fenceResult = mPendingRender->fenceResult.get();
     if (fenceStatus(fenceResult) == NO_ERROR) {
         mDrawFence = std::move(fenceResult).value_or(Fence::NO_FENCE);
-        mOutputSpace = outputState.framebufferSpace;
-        mTexture = texture;
+        mOutputSpace = mPendingRender->outputSpace;
+        mTexture = std::move(mPendingRender->texture);
         mTexture->setReadyFence(mDrawFence);
-        mOutputSpace.setOrientation(outputState.framebufferSpace.getOrientation());
-        mOutputDataspace = outputDataspace;
-        mOrientation = orientation;
+        mOutputDataspace = mPendingRender->outputDataspace;
+        mOrientation = mPendingRender->orientation;
         mSkipCount = 0;
     } else {
         mTexture.reset();
     }
+    mPendingRender.reset();
+    return true;
 }
 
 bool CachedSet::requiresHolePunch() const {
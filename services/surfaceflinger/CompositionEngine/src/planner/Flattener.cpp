@@ -119,6 +119,12 @@ void Flattener::renderCachedSets(
         return;
     }
 
+    if (mNewCachedSet->isRendering()) {
+        ATRACE_NAME("mNewCachedSet->isRendering()");
+        mNewCachedSet->finishRender(/*wait=*/false);
+        return;
+    }
+
     // Ensure that a cached set has a valid buffer first
     if (mNewCachedSet->hasRenderedBuffer()) {
         ATRACE_NAME("mNewCachedSet->hasRenderedBuffer()");
@@ -130,26 +136,38 @@ void Flattener::renderCachedSets(
     // If we have a render deadline, and the flattener is configured to skip rendering if we don't
     // have enough time, then we skip rendering the cached set if we think that we'll steal too much
     // time from the next frame.
-    if (renderDeadline && mTunables.mRenderScheduling) {
-        if (const auto estimatedRenderFinish =
-                    now + mTunables.mRenderScheduling->cachedSetRenderDuration;
-            estimatedRenderFinish > *renderDeadline) {
-            mNewCachedSet->incrementSkipCount();
-
-            if (mNewCachedSet->getSkipCount() <=
-                mTunables.mRenderScheduling->maxDeferRenderAttempts) {
+    const auto estimatedRenderFinish = renderDeadline && mTunables.mRenderScheduling
+            ? std::make_optional(now + mTunables.mRenderScheduling->cachedSetRenderDuration)
+            : std::nullopt;
+    const bool exceedsDeadline = estimatedRenderFinish && *estimatedRenderFinish > *renderDeadline;
+
+    // Sets which aren't worth it are deferred like those missing the deadline, so that long lived
+    // sets still get rendered. A frame deferred for both reasons counts as a single skip.
+    const bool worthRendering = !mTunables.mRenderInBackground || isWorthRendering(*mNewCachedSet);
+    if (exceedsDeadline || !worthRendering) {
+        mNewCachedSet->incrementSkipCount();
+
+        const size_t maxDeferRenderAttempts = mTunables.mRenderScheduling
+                ? mTunables.mRenderScheduling->maxDeferRenderAttempts
+                : Tunables::RenderScheduling::kDefaultMaxDeferRenderAttempts;
+        if (mNewCachedSet->getSkipCount() <= maxDeferRenderAttempts) {
+            if (exceedsDeadline) {
                 ATRACE_FORMAT("DeadlinePassed: exceeded deadline by: %d us",
                               std::chrono::duration_cast<std::chrono::microseconds>(
-                                      estimatedRenderFinish - *renderDeadline)
+                                      *estimatedRenderFinish - *renderDeadline)
                                       .count());
-                return;
             } else {
-                ATRACE_NAME("DeadlinePassed: exceeded max skips");
+                ATRACE_NAME("NotWorthRendering");
             }
+            return;
+        } else {
+            ATRACE_NAME(exceedsDeadline ? "DeadlinePassed: exceeded max skips"
+                                        : "NotWorthRendering: exceeded max skips");
         }
     }
 
-    mNewCachedSet->render(mRenderEngine, mTexturePool, outputState, deviceHandlesColorTransform);
+    mNewCachedSet->render(mRenderEngine, mTexturePool, outputState, deviceHandlesColorTransform,
+                          /*waitForRenderEngine=*/!mTunables.mRenderInBackground);
 }
 
 void Flattener::dumpLayers(std::string& result) const {
@@ -239,6 +257,24 @@ size_t Flattener::calculateDisplayCost(const std::vector<const LayerState*>& lay
     return displayCost;
 }
 
+bool Flattener::isWorthRendering(const CachedSet& cachedSet) const {
+    size_t invalidatedCount = 0;
+    size_t totalAge = 0;
+    for (const auto [age, count] : mInvalidatedCachedSetAges) {
+        invalidatedCount += count;
+        totalAge += age * count;
+    }
+    if (invalidatedCount == 0) {
+        return true;
+    }
+
+    const size_t componentDisplayCost = cachedSet.getComponentDisplayCost();
+    const size_t displayCost = cachedSet.getDisplayCost();
+    const size_t savedDisplayCost =
+            componentDisplayCost > displayCost ? componentDisplayCost - displayCost : 0;
+    return savedDisplayCost * (totalAge / invalidatedCount) >= cachedSet.getCreationCost();
+}
+
 void Flattener::resetActivities(NonBufferHash hash, time_point now) {
     ALOGV("[%s]", __func__);
 
@@ -315,7 +351,8 @@ bool Flattener::mergeWithCachedSets(const std::vector<const LayerState*>& layers
                 ALOGV("[%s] Dropping new cached set", __func__);
                 ++mInvalidatedCachedSetAges[0];
                 mNewCachedSet = std::nullopt;
-            } else if (mNewCachedSet->hasReadyBuffer()) {
+            } else if (mNewCachedSet->finishRender(/*wait=*/false) &&
+                       mNewCachedSet->hasReadyBuffer()) {
                 ALOGV("[%s] Found ready buffer", __func__);
                 size_t skipCount = mNewCachedSet->getLayerCount();
                 while (skipCount != 0) {
@@ -20,18 +20,43 @@
 #define LOG_TAG "Planner"
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <android-base/file.h>
 #include <android-base/properties.h>
+#include <android-base/stringprintf.h>
 #include <compositionengine/LayerFECompositionState.h>
 #include <compositionengine/impl/OutputLayerCompositionState.h>
 #include <compositionengine/impl/planner/Planner.h>
 
 #include <utils/Trace.h>
 #include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <future>
 
 namespace android::compositionengine::impl::planner {
 
 namespace {
 
+// Bumped whenever what goes into the hashes of the layer stacks changes.
+constexpr int kPredictionsVersion = 1;
+// Each prediction takes a line of a couple of dozens of bytes.
+constexpr size_t kMaxSavedPredictions = 128;
+
+void writePredictions(const std::string& path, const std::string& predictions) {
+    ATRACE_CALL();
+    // Write to a temporary file first, so that a crash never leaves a truncated file behind.
+    const std::string temporaryPath = path + ".tmp";
+    if (!base::WriteStringToFile(predictions, temporaryPath)) {
+        ALOGE("Could not write the predictions to %s: %s", temporaryPath.c_str(),
+              strerror(errno));
+        return;
+    }
+    if (rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        ALOGE("Could not save the predictions to %s: %s", path.c_str(), strerror(errno));
+    }
+}
+
 std::optional<Flattener::Tunables::RenderScheduling> buildRenderSchedulingTunables() {
     if (!base::GetBoolProperty(std::string("debug.sf.enable_cached_set_render_scheduling"), true)) {
         return std::nullopt;
@@ -61,10 +86,14 @@ Flattener::Tunables buildFlattenerTuneables() {
     const auto enableHolePunch =
             base::GetBoolProperty(std::string("debug.sf.enable_hole_punch_pip"),
                                   Flattener::Tunables::kDefaultEnableHolePunch);
+    const auto renderInBackground =
+            base::GetBoolProperty(std::string("debug.sf.cached_set_render_in_background"),
+                                  Flattener::Tunables::kDefaultRenderInBackground);
     return Flattener::Tunables{
             .mActiveLayerTimeout = activeLayerTimeout,
             .mRenderScheduling = buildRenderSchedulingTunables(),
             .mEnableHolePunch = enableHolePunch,
+            .mRenderInBackground = renderInBackground,
     };
 }
 
@@ -78,12 +107,74 @@ Planner::Planner(renderengine::RenderEngine& renderEngine)
 }
 
 void Planner::setDisplaySize(ui::Size size) {
+    mDisplaySize = size;
     mFlattener.setDisplaySize(size);
 }
 
+void Planner::setPredictionsFile(const std::string& name) {
+    const std::string directory =
+            base::GetProperty(std::string("debug.sf.planner_predictions_dir"), "");
+    if (!mPredictorEnabled || directory.empty()) {
+        return;
+    }
+    mPredictionsPath = directory + "/" + name;
+    mPredictionsLoaded = false;
+}
+
+std::string Planner::getPredictionsHeader() const {
+    return base::StringPrintf("planner predictions v%d %dx%d", kPredictionsVersion,
+                              mDisplaySize.width, mDisplaySize.height);
+}
+
+void Planner::loadPredictions() {
+    ATRACE_CALL();
+    mPredictionsLoaded = true;
+
+    std::string predictions;
+    if (!base::ReadFileToString(mPredictionsPath, &predictions)) {
+        ALOGV("[%s] No predictions saved in %s", __func__, mPredictionsPath.c_str());
+        return;
+    }
+
+    const size_t headerEnd = predictions.find('\n');
+    if (headerEnd == std::string::npos ||
+        predictions.compare(0, headerEnd, getPredictionsHeader()) != 0) {
+        ALOGI("Ignoring the predictions saved for another display configuration in %s",
+              mPredictionsPath.c_str());
+        return;
+    }
+
+    const size_t count = mPredictor.loadPredictions(predictions.substr(headerEnd + 1));
+    ALOGI("Seeded %zu predictions from %s", count, mPredictionsPath.c_str());
+}
+
+void Planner::savePredictions() {
+    ATRACE_CALL();
+    // Only one save runs at a time, so that an older save never replaces the file of a newer one.
+    // The predictions made in the meantime are saved once it is done.
+    if (mSavePredictionsFuture.valid() &&
+        mSavePredictionsFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+    mSavedPredictionCount = mPredictor.getPredictionCount();
+
+    std::string predictions =
+            getPredictionsHeader() + "\n" + mPredictor.savePredictions(kMaxSavedPredictions);
+    // Writing the file may block on I/O, so it is kept off the composition thread.
+    mSavePredictionsFuture =
+            std::async(std::launch::async,
+                       [path = mPredictionsPath, predictions = std::move(predictions)] {
+                           writePredictions(path, predictions);
+                       });
+}
+
 void Planner::plan(
         compositionengine::Output::OutputLayersEnumerator<compositionengine::Output>&& layers) {
     ATRACE_CALL();
+    if (!mPredictionsPath.empty() && !mPredictionsLoaded) {
+        loadPredictions();
+    }
+
     std::unordered_set<LayerId> removedLayers;
     removedLayers.reserve(mPreviousLayers.size());
 
@@ -199,6 +290,12 @@ void Planner::reportFinalPlan(
 
     mPredictor.recordResult(mPredictedPlan, mFlattenedHash, mCurrentLayers, hasSkippedLayers,
                             finalPlan);
+
+    // New predictions are only made for layer stacks seen for the first time, which is rare once
+    // the device has been used for a while.
+    if (!mPredictionsPath.empty() && mPredictor.getPredictionCount() != mSavedPredictionCount) {
+        savePredictions();
+    }
 }
 
 void Planner::renderCachedSets(const OutputCompositionState& outputState,
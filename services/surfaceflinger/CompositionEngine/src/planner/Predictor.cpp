@@ -21,6 +21,9 @@
 
 #include <compositionengine/impl/planner/Predictor.h>
 
+#include <cstdlib>
+#include <sstream>
+
 namespace android::compositionengine::impl::planner {
 
 std::optional<LayerStack::ApproximateMatch> LayerStack::getApproximateMatch(
@@ -118,6 +121,10 @@ std::optional<Plan> Plan::fromString(const std::string& string) {
                 plan.addLayerType(aidl::android::hardware::graphics::composer3::Composition::
                                           DISPLAY_DECORATION);
                 continue;
+            case 'R':
+                plan.addLayerType(aidl::android::hardware::graphics::composer3::Composition::
+                                          REFRESH_RATE_INDICATOR);
+                continue;
             default:
                 return std::nullopt;
         }
@@ -202,8 +209,25 @@ void Predictor::recordResult(std::optional<PredictedPlan> predictedPlan,
                              const std::vector<const LayerState*>& layers, bool hasSkippedLayers,
                              Plan result) {
     if (predictedPlan) {
-        recordPredictedResult(*predictedPlan, layers, std::move(result));
-        return;
+        const auto seededEntry = mSeededPlans.find(predictedPlan->hash);
+        if (seededEntry == mSeededPlans.end()) {
+            recordPredictedResult(*predictedPlan, layers, std::move(result));
+            return;
+        }
+
+        const bool seededPlanHit = seededEntry->second == result;
+        mSeededPlans.erase(seededEntry);
+        if (seededPlanHit) {
+            ALOGV("[%s] Seeded prediction hit for %zx", __func__, predictedPlan->hash);
+            ++mExactHitCount;
+            Prediction prediction(layers, result);
+            prediction.recordHit(Prediction::Type::Exact);
+            mSimilarStacks[result].push_back(predictedPlan->hash);
+            mPredictions.emplace(predictedPlan->hash, std::move(prediction));
+            return;
+        }
+        // Learn the layer stack as if it hadn't been predicted.
+        ALOGV("[%s] Seeded prediction missed for %zx", __func__, predictedPlan->hash);
     }
 
     ++mMissCount;
@@ -228,11 +252,65 @@ void Predictor::dump(std::string& result) const {
                         100.0f * hitCount / totalAttempts, hitCount, totalAttempts);
     base::StringAppendF(&result, "  Exact hits: %zd\n", mExactHitCount);
     base::StringAppendF(&result, "  Approximate hits: %zd\n", mApproximateHitCount);
-    base::StringAppendF(&result, "  Misses: %zd\n\n", mMissCount);
+    base::StringAppendF(&result, "  Misses: %zd\n", mMissCount);
+    base::StringAppendF(&result, "  Seeded plans not predicted yet: %zd\n\n", mSeededPlans.size());
 
     dumpPredictionsByFrequency(result);
 }
 
+std::string Predictor::savePredictions(size_t maxCount) const {
+    std::vector<std::pair<NonBufferHash, const Prediction*>> predictions;
+    for (const auto& [hash, prediction] : mPredictions) {
+        if (prediction.getMissCount(Prediction::Type::Total) == 0) {
+            predictions.emplace_back(hash, &prediction);
+        }
+    }
+
+    const auto hitCount = [](const auto& entry) {
+        return entry.second->getHitCount(Prediction::Type::Total);
+    };
+    std::sort(predictions.begin(), predictions.end(),
+              [&](const auto& lhs, const auto& rhs) { return hitCount(lhs) > hitCount(rhs); });
+    if (predictions.size() > maxCount) {
+        predictions.resize(maxCount);
+    }
+
+    std::string result;
+    for (const auto& [hash, prediction] : predictions) {
+        base::StringAppendF(&result, "%016zx %s\n", hash, to_string(prediction->getPlan()).c_str());
+    }
+    return result;
+}
+
+size_t Predictor::loadPredictions(const std::string& predictions) {
+    size_t count = 0;
+    std::istringstream stream(predictions);
+    std::string line;
+    while (std::getline(stream, line)) {
+        const size_t separator = line.find(' ');
+        if (separator == std::string::npos) {
+            ALOGW("[%s] Skipping malformed line \"%s\"", __func__, line.c_str());
+            continue;
+        }
+
+        char* hashEnd = nullptr;
+        const auto hash = static_cast<NonBufferHash>(std::strtoull(line.c_str(), &hashEnd, 16));
+        std::optional<Plan> plan = Plan::fromString(line.substr(separator + 1));
+        if (hashEnd != line.c_str() + separator || !plan) {
+            ALOGW("[%s] Skipping malformed line \"%s\"", __func__, line.c_str());
+            continue;
+        }
+
+        // What was learned in this run takes precedence.
+        if (mPredictions.count(hash) != 0 || getCandidateEntryByHash(hash) != mCandidates.cend()) {
+            continue;
+        }
+        mSeededPlans.insert_or_assign(hash, std::move(*plan));
+        ++count;
+    }
+    return count;
+}
+
 void Predictor::compareLayerStacks(NonBufferHash leftHash, NonBufferHash rightHash,
                                    std::string& result) const {
     const auto& [leftPredictionEntry, rightPredictionEntry] =
@@ -320,6 +398,10 @@ std::optional<Plan> Predictor::getExactMatch(NonBufferHash hash) const {
     }
 
     if (match == nullptr) {
+        if (const auto seededEntry = mSeededPlans.find(hash); seededEntry != mSeededPlans.end()) {
+            ALOGV("[%s] Found a seeded plan for %zx", __func__, hash);
+            return seededEntry->second;
+        }
         return std::nullopt;
     }
 
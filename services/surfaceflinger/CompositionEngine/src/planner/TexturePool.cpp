@@ -21,6 +21,7 @@
 
 #include <compositionengine/impl/planner/TexturePool.h>
 #include <renderengine/impl/ExternalTexture.h>
+#include <ui/GraphicBufferAllocator.h>
 #include <utils/Log.h>
 
 namespace android::compositionengine::impl::planner {
@@ -82,20 +83,26 @@ void TexturePool::returnTexture(std::shared_ptr<renderengine::ExternalTexture>&&
 
 std::shared_ptr<renderengine::ExternalTexture> TexturePool::genTexture() {
     LOG_ALWAYS_FATAL_IF(!mSize.isValid(), "Attempted to generate texture with invalid size");
+    // The buffers are only shared with the composer, so a buffer which the pool deallocates can be
+    // recycled for the next one.
+    const GraphicBufferAllocator::AllocationRequest request{
+            .importBuffer = true,
+            .width = static_cast<uint32_t>(mSize.getWidth()),
+            .height = static_cast<uint32_t>(mSize.getHeight()),
+            .format = HAL_PIXEL_FORMAT_RGBA_8888,
+            .layerCount = 1U,
+            .usage = static_cast<uint64_t>(GraphicBuffer::USAGE_HW_RENDER |
+                                           GraphicBuffer::USAGE_HW_COMPOSER |
+                                           GraphicBuffer::USAGE_HW_TEXTURE),
+            .requestorName = "Planner",
+            .recyclable = true,
+    };
     return std::make_shared<
-            renderengine::impl::
-                    ExternalTexture>(sp<GraphicBuffer>::
-                                             make(static_cast<uint32_t>(mSize.getWidth()),
-                                                  static_cast<uint32_t>(mSize.getHeight()),
-                                                  HAL_PIXEL_FORMAT_RGBA_8888, 1U,
-                                                  static_cast<uint64_t>(
-                                                          GraphicBuffer::USAGE_HW_RENDER |
-                                                          GraphicBuffer::USAGE_HW_COMPOSER |
-                                                          GraphicBuffer::USAGE_HW_TEXTURE),
-                                                  "Planner"),
-                                     mRenderEngine,
-                                     renderengine::impl::ExternalTexture::Usage::READABLE |
-                                             renderengine::impl::ExternalTexture::Usage::WRITEABLE);
+            renderengine::impl::ExternalTexture>(sp<GraphicBuffer>::make(request), mRenderEngine,
+                                                 renderengine::impl::ExternalTexture::Usage::
+                                                                 READABLE |
+                                                         renderengine::impl::ExternalTexture::
+                                                                 Usage::WRITEABLE);
 }
 
 void TexturePool::setEnabled(bool enabled) {
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <compositionengine/impl/ClientCompositionRequestCache.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace android::compositionengine {
+namespace {
+
+using impl::ClientCompositionRequestCache;
+
+constexpr uint32_t kCacheSize = 2;
+
+class ClientCompositionRequestCacheTest : public testing::Test {
+public:
+    ClientCompositionRequestCacheTest() {
+        mDisplay.physicalDisplay = Rect(0, 0, 100, 200);
+        mDisplay.clip = Rect(0, 0, 100, 200);
+
+        LayerFE::LayerSettings layer;
+        layer.bufferId = 10u;
+        layer.frameNumber = 1u;
+        layer.alpha = 1.f;
+        layer.geometry.boundaries = FloatRect(0.f, 0.f, 100.f, 200.f);
+        mLayers.push_back(layer);
+    }
+
+    // Adds the request of the test to the cache, rendered into the buffer.
+    void add(uint64_t bufferId) {
+        mCache.add(bufferId, hash(mLayers), mDisplay, mLayers);
+    }
+
+    bool exists(uint64_t bufferId, const std::vector<LayerFE::LayerSettings>& layers) {
+        return mCache.exists(bufferId, hash(layers), mDisplay, layers);
+    }
+
+    bool exists(uint64_t bufferId) { return exists(bufferId, mLayers); }
+
+    size_t hash(const std::vector<LayerFE::LayerSettings>& layers) const {
+        return ClientCompositionRequestCache::computeHash(mDisplay, layers);
+    }
+
+    ClientCompositionRequestCache mCache{kCacheSize};
+    renderengine::DisplaySettings mDisplay;
+    std::vector<LayerFE::LayerSettings> mLayers;
+};
+
+TEST_F(ClientCompositionRequestCacheTest, missesWhenEmpty) {
+    EXPECT_FALSE(exists(1u));
+    EXPECT_EQ(0u, mCache.getStats().hits);
+    EXPECT_EQ(1u, mCache.getStats().misses);
+}
+
+TEST_F(ClientCompositionRequestCacheTest, hitsSameRequestInSameBuffer) {
+    add(1u);
+
+    EXPECT_TRUE(exists(1u));
+    EXPECT_TRUE(exists(1u));
+    EXPECT_EQ(2u, mCache.getStats().hits);
+    EXPECT_EQ(0u, mCache.getStats().misses);
+}
+
+TEST_F(ClientCompositionRequestCacheTest, missesSameRequestInOtherBuffer) {
+    add(1u);
+
+    EXPECT_FALSE(exists(2u));
+    EXPECT_EQ(0u, mCache.getStats().hits);
+    EXPECT_EQ(1u, mCache.getStats().misses);
+}
+
+TEST_F(ClientCompositionRequestCacheTest, missesChangedRequest) {
+    add(1u);
+
+    std::vector<LayerFE::LayerSettings> nextFrame = mLayers;
+    nextFrame[0].frameNumber++;
+    EXPECT_FALSE(exists(1u, nextFrame));
+
+    std::vector<LayerFE::LayerSettings> fading = mLayers;
+    fading[0].alpha = 0.5f;
+    EXPECT_FALSE(exists(1u, fading));
+
+    std::vector<LayerFE::LayerSettings> moreLayers = mLayers;
+    moreLayers.push_back(mLayers[0]);
+    EXPECT_FALSE(exists(1u, moreLayers));
+
+    EXPECT_EQ(0u, mCache.getStats().hits);
+    EXPECT_EQ(3u, mCache.getStats().misses);
+}
+
+TEST_F(ClientCompositionRequestCacheTest, missesOtherHashOfSameRequest) {
+    add(1u);
+
+    EXPECT_FALSE(mCache.exists(1u, hash(mLayers) + 1, mDisplay, mLayers));
+    EXPECT_EQ(1u, mCache.getStats().misses);
+}
+
+TEST_F(ClientCompositionRequestCacheTest, hashesEqualRequestsEqually) {
+    std::vector<LayerFE::LayerSettings> copy = mLayers;
+    EXPECT_EQ(hash(mLayers), hash(copy));
+
+    copy[0].frameNumber++;
+    EXPECT_NE(hash(mLayers), hash(copy));
+}
+
+TEST_F(ClientCompositionRequestCacheTest, replacesRequestOfSameBuffer) {
+    add(1u);
+
+    std::vector<LayerFE::LayerSettings> nextFrame = mLayers;
+    nextFrame[0].frameNumber++;
+    mCache.add(1u, hash(nextFrame), mDisplay, nextFrame);
+
+    EXPECT_EQ(1u, mCache.getCacheSize());
+    EXPECT_FALSE(exists(1u));
+    EXPECT_TRUE(exists(1u, nextFrame));
+}
+
+TEST_F(ClientCompositionRequestCacheTest, evictsOldestBufferWhenFull) {
+    add(1u);
+    add(2u);
+    ASSERT_EQ(kCacheSize, mCache.getCacheSize());
+
+    add(3u);
+    EXPECT_EQ(kCacheSize, mCache.getCacheSize());
+    EXPECT_FALSE(exists(1u));
+    EXPECT_TRUE(exists(2u));
+    EXPECT_TRUE(exists(3u));
+    EXPECT_EQ(2u, mCache.getStats().hits);
+    EXPECT_EQ(1u, mCache.getStats().misses);
+}
+
+TEST_F(ClientCompositionRequestCacheTest, removesBuffer) {
+    add(1u);
+    add(2u);
+
+    mCache.remove(1u);
+    EXPECT_EQ(1u, mCache.getCacheSize());
+    EXPECT_FALSE(exists(1u));
+    EXPECT_TRUE(exists(2u));
+
+    // Removing a buffer which is not cached does nothing.
+    mCache.remove(1u);
+    EXPECT_EQ(1u, mCache.getCacheSize());
+}
+
+} // namespace
+} // namespace android::compositionengine
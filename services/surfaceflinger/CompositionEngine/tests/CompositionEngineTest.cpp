@@ -29,6 +29,7 @@
 #include "MockHWComposer.h"
 #include "TimeStats/TimeStats.h"
 
+#include <thread>
 #include <variant>
 
 using namespace com::android::graphics::surfaceflinger;
@@ -81,6 +82,13 @@ TEST_F(CompositionEngineTest, canSetTimeStats) {
     EXPECT_EQ(mTimeStats.get(), mEngine.getTimeStats());
 }
 
+TEST_F(CompositionEngineTest, canSetFrameStageStats) {
+    const auto frameStageStats = std::make_shared<FrameStageStats>();
+    mEngine.setFrameStageStats(frameStageStats);
+
+    EXPECT_EQ(frameStageStats.get(), mEngine.getFrameStageStats());
+}
+
 /*
  * CompositionEngine::present
  */
@@ -130,6 +138,46 @@ TEST_F(CompositionEnginePresentTest, worksAsExpected) {
     mEngine.present(mRefreshArgs);
 }
 
+TEST_F(CompositionEnginePresentTest, skipsOutputsWithNothingToUpdate) {
+    using FrameUpdate = impl::OutputCompositionState::FrameUpdate;
+
+    const std::array<std::shared_ptr<mock::Output>, 3> outputs = {mOutput1, mOutput2, mOutput3};
+    const std::array<FrameUpdate, 3> frameUpdates = {FrameUpdate::SKIPPED,
+                                                     FrameUpdate::BUFFERS_ONLY, FrameUpdate::FULL};
+    std::array<impl::OutputCompositionState, 3> states;
+    const std::string name = "Display";
+
+    EXPECT_CALL(mEngine, preComposition(Ref(mRefreshArgs)));
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, false);
+    for (size_t i = 0; i < outputs.size(); i++) {
+        states[i].frameUpdate = frameUpdates[i];
+        EXPECT_CALL(*outputs[i], prepare(Ref(mRefreshArgs), _));
+        EXPECT_CALL(*outputs[i], chooseFrameUpdate(Ref(mRefreshArgs)));
+        EXPECT_CALL(*outputs[i], getState).WillRepeatedly(ReturnRef(states[i]));
+        EXPECT_CALL(*outputs[i], getDisplayId)
+                .WillRepeatedly(Return(std::make_optional<DisplayId>(
+                        PhysicalDisplayId::fromPort(static_cast<uint8_t>(i)))));
+        EXPECT_CALL(*outputs[i], getName).WillRepeatedly(ReturnRef(name));
+    }
+
+    // Only the outputs with something to update are presented.
+    EXPECT_CALL(*mOutput1, present(_)).Times(0);
+    EXPECT_CALL(*mOutput2, present(Ref(mRefreshArgs)))
+            .WillOnce(Return(ftl::yield<std::monostate>({})));
+    EXPECT_CALL(*mOutput3, present(Ref(mRefreshArgs)))
+            .WillOnce(Return(ftl::yield<std::monostate>({})));
+
+    mRefreshArgs.outputs = {mOutput1, mOutput2, mOutput3};
+    mRefreshArgs.skipIdleOutputs = true;
+    mEngine.present(mRefreshArgs);
+
+    std::string dump;
+    mEngine.dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("0 full, 1 skipped, 0 buffers only"));
+    EXPECT_NE(std::string::npos, dump.find("0 full, 0 skipped, 1 buffers only"));
+    EXPECT_NE(std::string::npos, dump.find("1 full, 0 skipped, 0 buffers only"));
+}
+
 /*
  * CompositionEngine::updateCursorAsync
  */
@@ -483,5 +531,174 @@ TEST_F(CompositionEngineOffloadTest, disabledDisplaysDoNotPreventOthersFromOfflo
     mEngine.present(mRefreshArgs);
 }
 
+// Validating concurrently depends on the same HWC support as offloading present.
+struct CompositionEngineConcurrentValidationTest : public CompositionEngineOffloadTest {
+    using CompositionStrategyPredictionState =
+            impl::OutputCompositionState::CompositionStrategyPredictionState;
+
+    CompositionEngineConcurrentValidationTest() {
+        mRefreshArgs.validateOutputsConcurrently = true;
+    }
+};
+
+TEST_F(CompositionEngineConcurrentValidationTest, startsValidationOfAllDisplays) {
+    EXPECT_CALL(*mDisplay1, supportsOffloadPresent).WillOnce(Return(true));
+    EXPECT_CALL(*mHalVirtualDisplay, supportsOffloadPresent).WillOnce(Return(true));
+
+    EXPECT_CALL(*mDisplay1, startValidation(Ref(mRefreshArgs))).Times(1);
+    EXPECT_CALL(*mVirtualDisplay, startValidation(_)).Times(0);
+    EXPECT_CALL(*mHalVirtualDisplay, startValidation(Ref(mRefreshArgs))).Times(1);
+
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, false);
+    setOutputs({mDisplay1, mVirtualDisplay, mHalVirtualDisplay});
+
+    mEngine.present(mRefreshArgs);
+}
+
+TEST_F(CompositionEngineConcurrentValidationTest, dependsOnSupport) {
+    EXPECT_CALL(*mDisplay1, supportsOffloadPresent).WillOnce(Return(true));
+    EXPECT_CALL(*mDisplay2, supportsOffloadPresent).WillOnce(Return(false));
+
+    EXPECT_CALL(*mDisplay1, startValidation(_)).Times(0);
+    EXPECT_CALL(*mDisplay2, startValidation(_)).Times(0);
+
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, false);
+    setOutputs({mDisplay1, mDisplay2});
+
+    mEngine.present(mRefreshArgs);
+
+    std::string dump;
+    mEngine.dump(dump);
+    EXPECT_TRUE(dump.empty());
+}
+
+TEST_F(CompositionEngineConcurrentValidationTest, dependsOnRefreshArgs) {
+    mRefreshArgs.validateOutputsConcurrently = false;
+    EXPECT_CALL(*mDisplay1, supportsOffloadPresent).Times(0);
+    EXPECT_CALL(*mDisplay2, supportsOffloadPresent).Times(0);
+
+    EXPECT_CALL(*mDisplay1, startValidation(_)).Times(0);
+    EXPECT_CALL(*mDisplay2, startValidation(_)).Times(0);
+
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, false);
+    setOutputs({mDisplay1, mDisplay2});
+
+    mEngine.present(mRefreshArgs);
+}
+
+TEST_F(CompositionEngineConcurrentValidationTest, dumpsPredictionHitRate) {
+    EXPECT_CALL(*mDisplay1, supportsOffloadPresent).WillOnce(Return(true));
+    EXPECT_CALL(*mDisplay2, supportsOffloadPresent).WillOnce(Return(true));
+    EXPECT_CALL(*mDisplay1, startValidation(Ref(mRefreshArgs))).WillOnce([&] {
+        mOutputStates[0].strategyPrediction = CompositionStrategyPredictionState::SUCCESS;
+    });
+    EXPECT_CALL(*mDisplay2, startValidation(Ref(mRefreshArgs))).WillOnce([&] {
+        mOutputStates[1].strategyPrediction = CompositionStrategyPredictionState::FAIL;
+    });
+
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, false);
+    setOutputs({mDisplay1, mDisplay2});
+
+    mEngine.present(mRefreshArgs);
+
+    std::string dump;
+    mEngine.dump(dump);
+    EXPECT_EQ("Concurrent HWC validation: 1 frames, 2 outputs validated, 2 strategies predicted, "
+              "50.0% hit\n",
+              dump);
+}
+
+struct CompositionEngineParallelPresentTest : public CompositionEngineOffloadTest {
+    CompositionEngineParallelPresentTest() {
+        mRefreshArgs.presentOutputsInParallel = true;
+
+        EXPECT_CALL(*mDisplay1, getName).WillRepeatedly(ReturnRef(kDisplay1Name));
+        EXPECT_CALL(*mDisplay2, getName).WillRepeatedly(ReturnRef(kDisplay2Name));
+        EXPECT_CALL(*mVirtualDisplay, getName).WillRepeatedly(ReturnRef(kVirtualDisplayName));
+    }
+
+    // Records the thread which presented the output.
+    void addOutput(const std::shared_ptr<mock::Output>& output, std::thread::id& outThread) {
+        EXPECT_CALL(*output, prepare(Ref(mRefreshArgs), _)).Times(1);
+        EXPECT_CALL(*output, present(Ref(mRefreshArgs))).WillOnce([&outThread](const auto&) {
+            outThread = std::this_thread::get_id();
+            return ftl::yield<std::monostate>({});
+        });
+        mRefreshArgs.outputs.push_back(output);
+    }
+
+    const std::string kDisplay1Name = "Display 1";
+    const std::string kDisplay2Name = "Display 2";
+    const std::string kVirtualDisplayName = "Virtual display";
+};
+
+TEST_F(CompositionEngineParallelPresentTest, presentsOnSeveralThreads) {
+    EXPECT_CALL(*mDisplay1, supportsOffloadPresent).WillOnce(Return(true));
+    EXPECT_CALL(*mDisplay2, supportsOffloadPresent).WillOnce(Return(true));
+
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, false);
+    std::thread::id display1Thread;
+    std::thread::id display2Thread;
+    std::thread::id virtualDisplayThread;
+    addOutput(mDisplay1, display1Thread);
+    addOutput(mVirtualDisplay, virtualDisplayThread);
+    addOutput(mDisplay2, display2Thread);
+
+    mEngine.present(mRefreshArgs);
+
+    // The last of the displays, and the displays which the HWC doesn't present, present on the
+    // calling thread.
+    EXPECT_NE(std::this_thread::get_id(), display1Thread);
+    EXPECT_EQ(std::this_thread::get_id(), display2Thread);
+    EXPECT_EQ(std::this_thread::get_id(), virtualDisplayThread);
+
+    std::string dump;
+    mEngine.dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("Display 1 (" + to_string(kDisplayId1) + "): last"));
+    EXPECT_NE(std::string::npos, dump.find(", in parallel\n"));
+    EXPECT_NE(std::string::npos, dump.find("Display 2 (" + to_string(kDisplayId2) + "): last"));
+}
+
+TEST_F(CompositionEngineParallelPresentTest, dependsOnSupport) {
+    EXPECT_CALL(*mDisplay1, supportsOffloadPresent).WillOnce(Return(true));
+    EXPECT_CALL(*mDisplay2, supportsOffloadPresent).WillOnce(Return(false));
+
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, false);
+    std::thread::id display1Thread;
+    std::thread::id display2Thread;
+    addOutput(mDisplay1, display1Thread);
+    addOutput(mDisplay2, display2Thread);
+
+    mEngine.present(mRefreshArgs);
+
+    EXPECT_EQ(std::this_thread::get_id(), display1Thread);
+    EXPECT_EQ(std::this_thread::get_id(), display2Thread);
+
+    std::string dump;
+    mEngine.dump(dump);
+    EXPECT_EQ(std::string::npos, dump.find("in parallel"));
+}
+
+TEST_F(CompositionEngineParallelPresentTest, dependsOnRefreshArgs) {
+    mRefreshArgs.presentOutputsInParallel = false;
+    EXPECT_CALL(*mDisplay1, supportsOffloadPresent).Times(0);
+    EXPECT_CALL(*mDisplay2, supportsOffloadPresent).Times(0);
+
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, false);
+    std::thread::id display1Thread;
+    std::thread::id display2Thread;
+    addOutput(mDisplay1, display1Thread);
+    addOutput(mDisplay2, display2Thread);
+
+    mEngine.present(mRefreshArgs);
+
+    EXPECT_EQ(std::this_thread::get_id(), display1Thread);
+    EXPECT_EQ(std::this_thread::get_id(), display2Thread);
+
+    std::string dump;
+    mEngine.dump(dump);
+    EXPECT_TRUE(dump.empty());
+}
+
 } // namespace
 } // namespace android::compositionengine
@@ -190,5 +190,48 @@ TEST_F(HwcBufferCacheTest, uncache_whenOverrideUncached_returnsInvalidSlotNumber
     EXPECT_EQ(cache.uncache(mBuffer2->getId()), UINT32_MAX);
 }
 
+TEST_F(HwcBufferCacheTest, getHwcSlotAndBuffer_withSlotBudget_evictsLeastRecentlyUsedBuffer) {
+    HwcBufferCache cache(2);
+    ASSERT_EQ(cache.getSlotBudget(), 2u);
+    sp<GraphicBuffer> buffer3 = sp<GraphicBuffer>::make(1u, 1u, HAL_PIXEL_FORMAT_RGBA_8888, 1u, 0u);
+
+    HwcSlotAndBuffer slotAndBufferFor1 = cache.getHwcSlotAndBuffer(mBuffer1);
+    HwcSlotAndBuffer slotAndBufferFor2 = cache.getHwcSlotAndBuffer(mBuffer2);
+    ASSERT_LT(slotAndBufferFor1.slot, 2u);
+    ASSERT_LT(slotAndBufferFor2.slot, 2u);
+    // mBuffer2 becomes the least recently used buffer
+    EXPECT_EQ(cache.getHwcSlotAndBuffer(mBuffer1).buffer, nullptr);
+
+    HwcSlotAndBuffer slotAndBufferFor3 = cache.getHwcSlotAndBuffer(buffer3);
+    EXPECT_EQ(slotAndBufferFor3.slot, slotAndBufferFor2.slot);
+    EXPECT_EQ(slotAndBufferFor3.buffer, buffer3);
+    EXPECT_EQ(cache.uncache(mBuffer2->getId()), UINT32_MAX);
+    EXPECT_EQ(cache.uncache(mBuffer1->getId()), slotAndBufferFor1.slot);
+}
+
+TEST_F(HwcBufferCacheTest, constructor_clampsSlotBudget) {
+    EXPECT_EQ(HwcBufferCache(0).getSlotBudget(), 1u);
+    EXPECT_EQ(HwcBufferCache(1000).getSlotBudget(),
+              static_cast<uint32_t>(BufferQueue::NUM_BUFFER_SLOTS));
+}
+
+TEST_F(HwcBufferCacheTest, getStats_countsHitsMissesAndEvictions) {
+    HwcBufferCache cache(1);
+
+    cache.getHwcSlotAndBuffer(mBuffer1);
+    cache.getHwcSlotAndBuffer(mBuffer1);
+    cache.getHwcSlotAndBuffer(mBuffer2);
+    cache.getOverrideHwcSlotAndBuffer(mBuffer1);
+
+    const HwcBufferCache::Stats& stats = cache.getStats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.evictions, 1u);
+
+    std::string dump;
+    cache.dump(dump);
+    EXPECT_EQ(dump, "bufferCache={slots=1/1 hits=1 misses=2 evictions=1} ");
+}
+
 } // namespace
 } // namespace android::compositionengine
@@ -1155,6 +1155,107 @@ TEST_F(OutputPrepareFrameAsyncTest, predictionMiss) {
     EXPECT_TRUE(result.bufferAvailable());
 }
 
+/*
+ * Output::startValidation()
+ */
+
+struct OutputStartValidationTest : public testing::Test {
+    // Piggy-back on OutputPrepareFrameAsyncTest's version to avoid some boilerplate.
+    struct OutputPartialMock : public OutputPrepareFrameAsyncTest::OutputPartialMock {
+        // Sets up the helper functions called by the function under test to use
+        // mock implementations.
+        MOCK_METHOD1(updateColorProfile, void(const compositionengine::CompositionRefreshArgs&));
+        MOCK_METHOD1(updateCompositionState,
+                     void(const compositionengine::CompositionRefreshArgs&));
+        MOCK_METHOD0(planComposition, void());
+        MOCK_METHOD1(writeCompositionState, void(const compositionengine::CompositionRefreshArgs&));
+        MOCK_METHOD1(setColorTransform, void(const compositionengine::CompositionRefreshArgs&));
+        MOCK_METHOD0(beginFrame, void());
+        MOCK_METHOD1(canPredictCompositionStrategy, bool(const CompositionRefreshArgs&));
+    };
+
+    OutputStartValidationTest() {
+        mOutput.setDisplayColorProfileForTest(
+                std::unique_ptr<DisplayColorProfile>(mDisplayColorProfile));
+        mOutput.setRenderSurfaceForTest(std::unique_ptr<RenderSurface>(mRenderSurface));
+        mOutput.editState().isEnabled = true;
+        mOutput.editState().usesClientComposition = false;
+        mOutput.editState().usesDeviceComposition = true;
+        mOutput.editState().previousDeviceRequestedChanges =
+                std::make_optional<android::HWComposer::DeviceRequestedChanges>({});
+
+        EXPECT_CALL(mOutput, getOutputLayerCount()).WillRepeatedly(Return(0u));
+    }
+
+    void expectBeginPresent() {
+        EXPECT_CALL(mOutput, updateColorProfile(Ref(mRefreshArgs)));
+        EXPECT_CALL(mOutput, updateCompositionState(Ref(mRefreshArgs)));
+        EXPECT_CALL(mOutput, planComposition());
+        EXPECT_CALL(mOutput, writeCompositionState(Ref(mRefreshArgs)));
+        EXPECT_CALL(mOutput, setColorTransform(Ref(mRefreshArgs)));
+        EXPECT_CALL(mOutput, beginFrame());
+    }
+
+    StrictMock<mock::CompositionEngine> mCompositionEngine;
+    mock::DisplayColorProfile* mDisplayColorProfile = new StrictMock<mock::DisplayColorProfile>();
+    mock::RenderSurface* mRenderSurface = new StrictMock<mock::RenderSurface>();
+    StrictMock<OutputPartialMock> mOutput;
+    CompositionRefreshArgs mRefreshArgs;
+};
+
+TEST_F(OutputStartValidationTest, finishValidationAppliesChosenStrategy) {
+    std::promise<bool> p;
+    p.set_value(true);
+    auto changes = std::make_optional<android::HWComposer::DeviceRequestedChanges>({});
+    changes->displayRequests = static_cast<hal::DisplayRequest>(0);
+
+    expectBeginPresent();
+    EXPECT_CALL(mOutput, canPredictCompositionStrategy(Ref(mRefreshArgs))).WillOnce(Return(false));
+    EXPECT_CALL(mOutput, resetCompositionStrategy());
+    EXPECT_CALL(mOutput, chooseCompositionStrategyAsync(_))
+            .WillOnce(DoAll(SetArgPointee<0>(changes), Return(ByMove(p.get_future()))));
+    EXPECT_CALL(*mRenderSurface, prepareFrame(false, true));
+
+    mOutput.startValidation(mRefreshArgs);
+    impl::GpuCompositionResult result = mOutput.finishValidation();
+
+    EXPECT_EQ(mOutput.getState().strategyPrediction, CompositionStrategyPredictionState::DISABLED);
+    EXPECT_EQ(mOutput.getState().previousDeviceRequestedChanges, changes);
+    EXPECT_TRUE(mOutput.getState().previousDeviceRequestedSuccess);
+    EXPECT_FALSE(result.bufferAvailable());
+}
+
+TEST_F(OutputStartValidationTest, finishValidationComposesWithPredictedStrategy) {
+    std::promise<bool> p;
+    p.set_value(true);
+
+    expectBeginPresent();
+    EXPECT_CALL(mOutput, canPredictCompositionStrategy(Ref(mRefreshArgs))).WillOnce(Return(true));
+    EXPECT_CALL(mOutput, resetCompositionStrategy());
+    EXPECT_CALL(mOutput, chooseCompositionStrategyAsync(_))
+            .WillOnce(DoAll(SetArgPointee<0>(mOutput.editState().previousDeviceRequestedChanges),
+                            Return(ByMove(p.get_future()))));
+    EXPECT_CALL(*mRenderSurface, prepareFrame(false, true));
+    EXPECT_CALL(mOutput, updateProtectedContentState());
+    EXPECT_CALL(mOutput, dequeueRenderBuffer(_, _)).WillOnce(Return(true));
+    EXPECT_CALL(mOutput, composeSurfaces(_, _, _));
+
+    mOutput.startValidation(mRefreshArgs);
+    impl::GpuCompositionResult result = mOutput.finishValidation();
+
+    EXPECT_EQ(mOutput.getState().strategyPrediction, CompositionStrategyPredictionState::SUCCESS);
+    EXPECT_FALSE(result.bufferAvailable());
+}
+
+TEST_F(OutputStartValidationTest, doesNotChooseStrategyForDisabledOutput) {
+    mOutput.editState().isEnabled = false;
+
+    expectBeginPresent();
+    EXPECT_CALL(mOutput, chooseCompositionStrategyAsync(_)).Times(0);
+
+    mOutput.startValidation(mRefreshArgs);
+}
+
 /*
  * Output::prepare()
  */
@@ -2017,6 +2118,11 @@ struct OutputPresentTest : public testing::Test {
         MOCK_METHOD0(presentFrameAndReleaseLayers, void());
         MOCK_METHOD1(renderCachedSets, void(const compositionengine::CompositionRefreshArgs&));
         MOCK_METHOD1(canPredictCompositionStrategy, bool(const CompositionRefreshArgs&));
+        MOCK_METHOD0(resetCompositionStrategy, void());
+        MOCK_METHOD1(
+                chooseCompositionStrategyAsync,
+                std::future<bool>(std::optional<android::HWComposer::DeviceRequestedChanges>*));
+        MOCK_METHOD0(finishValidation, GpuCompositionResult());
     };
 
     StrictMock<OutputPartialMock> mOutput;
@@ -2062,6 +2168,158 @@ TEST_F(OutputPresentTest, predictingCompositionStrategyInvokesPrepareFrameAsync)
     mOutput.present(args);
 }
 
+TEST_F(OutputPresentTest, startedValidationInvokesFinishValidation) {
+    CompositionRefreshArgs args;
+    mOutput.editState().isEnabled = true;
+    std::promise<bool> p;
+    p.set_value(true);
+
+    InSequence seq;
+    EXPECT_CALL(mOutput, updateColorProfile(Ref(args)));
+    EXPECT_CALL(mOutput, updateCompositionState(Ref(args)));
+    EXPECT_CALL(mOutput, planComposition());
+    EXPECT_CALL(mOutput, writeCompositionState(Ref(args)));
+    EXPECT_CALL(mOutput, setColorTransform(Ref(args)));
+    EXPECT_CALL(mOutput, beginFrame());
+    EXPECT_CALL(mOutput, canPredictCompositionStrategy(Ref(args))).WillOnce(Return(false));
+    EXPECT_CALL(mOutput, resetCompositionStrategy());
+    EXPECT_CALL(mOutput, chooseCompositionStrategyAsync(_))
+            .WillOnce(Return(ByMove(p.get_future())));
+    EXPECT_CALL(mOutput, finishValidation());
+    EXPECT_CALL(mOutput, devOptRepaintFlash(Ref(args)));
+    EXPECT_CALL(mOutput, finishFrame(_));
+    EXPECT_CALL(mOutput, presentFrameAndReleaseLayers());
+    EXPECT_CALL(mOutput, renderCachedSets(Ref(args)));
+
+    mOutput.startValidation(args);
+    mOutput.present(args);
+}
+
+TEST_F(OutputPresentTest, buffersOnlyFrameOnlyWritesTheBuffers) {
+    CompositionRefreshArgs args;
+    mOutput.editState().frameUpdate = impl::OutputCompositionState::FrameUpdate::BUFFERS_ONLY;
+
+    EXPECT_CALL(mOutput, getOutputLayerCount()).WillRepeatedly(Return(0u));
+
+    InSequence seq;
+    EXPECT_CALL(mOutput, updateColorProfile(_)).Times(0);
+    EXPECT_CALL(mOutput, updateCompositionState(_)).Times(0);
+    EXPECT_CALL(mOutput, planComposition()).Times(0);
+    EXPECT_CALL(mOutput, writeCompositionState(_)).Times(0);
+    EXPECT_CALL(mOutput, setColorTransform(_)).Times(0);
+    EXPECT_CALL(mOutput, beginFrame());
+    EXPECT_CALL(mOutput, canPredictCompositionStrategy(Ref(args))).WillOnce(Return(false));
+    EXPECT_CALL(mOutput, prepareFrame());
+    EXPECT_CALL(mOutput, devOptRepaintFlash(Ref(args)));
+    EXPECT_CALL(mOutput, finishFrame(_));
+    EXPECT_CALL(mOutput, presentFrameAndReleaseLayers());
+    EXPECT_CALL(mOutput, renderCachedSets(Ref(args)));
+
+    mOutput.present(args);
+}
+
+/*
+ * Output::chooseFrameUpdate()
+ */
+
+struct OutputChooseFrameUpdateTest : public testing::Test {
+    using FrameUpdate = impl::OutputCompositionState::FrameUpdate;
+    using FrameChanges = LayerFECompositionState::FrameChanges;
+
+    struct OutputPartialMock : public OutputPartialMockBase {
+        // Sets up the helper functions called by the function under test to use
+        // mock implementations.
+        MOCK_CONST_METHOD0(getDisplayId, std::optional<DisplayId>());
+    };
+
+    struct Layer {
+        Layer() {
+            EXPECT_CALL(mOutputLayer, getLayerFE()).WillRepeatedly(ReturnRef(*mLayerFE));
+            EXPECT_CALL(mOutputLayer, getState()).WillRepeatedly(ReturnRef(mOutputLayerState));
+            EXPECT_CALL(*mLayerFE, getCompositionState()).WillRepeatedly(Return(&mLayerFEState));
+
+            mLayerFEState.frameChanges = FrameChanges::NONE;
+            mLayerFEState.buffer = sp<GraphicBuffer>::make();
+            mLayerFEState.compositionType =
+                    aidl::android::hardware::graphics::composer3::Composition::DEVICE;
+            mOutputLayerState.hwc = impl::OutputLayerCompositionState::Hwc(nullptr);
+            mOutputLayerState.hwc->hwcCompositionType =
+                    aidl::android::hardware::graphics::composer3::Composition::DEVICE;
+        }
+
+        StrictMock<mock::OutputLayer> mOutputLayer;
+        sp<StrictMock<mock::LayerFE>> mLayerFE = sp<StrictMock<mock::LayerFE>>::make();
+        LayerFECompositionState mLayerFEState;
+        impl::OutputLayerCompositionState mOutputLayerState;
+    };
+
+    OutputChooseFrameUpdateTest() {
+        mOutput.editState().isEnabled = true;
+
+        EXPECT_CALL(mOutput, getDisplayId()).WillRepeatedly(Return(kDisplayId));
+        EXPECT_CALL(mOutput, getOutputLayerCount()).WillRepeatedly(Return(2u));
+        EXPECT_CALL(mOutput, getOutputLayerOrderedByZByIndex(0))
+                .WillRepeatedly(Return(&mLayer1.mOutputLayer));
+        EXPECT_CALL(mOutput, getOutputLayerOrderedByZByIndex(1))
+                .WillRepeatedly(Return(&mLayer2.mOutputLayer));
+    }
+
+    FrameUpdate chooseFrameUpdate() {
+        mOutput.chooseFrameUpdate(mRefreshArgs);
+        return mOutput.getState().frameUpdate;
+    }
+
+    static constexpr PhysicalDisplayId kDisplayId = PhysicalDisplayId::fromPort(123u);
+
+    StrictMock<OutputPartialMock> mOutput;
+    Layer mLayer1;
+    Layer mLayer2;
+    CompositionRefreshArgs mRefreshArgs;
+};
+
+TEST_F(OutputChooseFrameUpdateTest, skipsFrameWhenNothingChanged) {
+    EXPECT_EQ(FrameUpdate::SKIPPED, chooseFrameUpdate());
+}
+
+TEST_F(OutputChooseFrameUpdateTest, composesFrameWhenDirtyRegionIsNotEmpty) {
+    mOutput.editState().dirtyRegion = Region(Rect(0, 0, 10, 10));
+
+    EXPECT_EQ(FrameUpdate::FULL, chooseFrameUpdate());
+}
+
+TEST_F(OutputChooseFrameUpdateTest, onlyWritesBuffersWhenOnlyDeviceBuffersChanged) {
+    mLayer2.mLayerFEState.frameChanges = FrameChanges::BUFFER;
+
+    EXPECT_EQ(FrameUpdate::BUFFERS_ONLY, chooseFrameUpdate());
+}
+
+TEST_F(OutputChooseFrameUpdateTest, composesFrameWhenALayerChanged) {
+    mLayer1.mLayerFEState.frameChanges = FrameChanges::BUFFER;
+    mLayer2.mLayerFEState.frameChanges = FrameChanges::ALL;
+
+    EXPECT_EQ(FrameUpdate::FULL, chooseFrameUpdate());
+}
+
+TEST_F(OutputChooseFrameUpdateTest, composesFrameWhenChangedBufferIsClientComposited) {
+    mLayer1.mLayerFEState.frameChanges = FrameChanges::BUFFER;
+    mLayer1.mOutputLayerState.hwc->hwcCompositionType =
+            aidl::android::hardware::graphics::composer3::Composition::CLIENT;
+
+    EXPECT_EQ(FrameUpdate::FULL, chooseFrameUpdate());
+}
+
+TEST_F(OutputChooseFrameUpdateTest, composesFrameWhenGeometryChanged) {
+    mRefreshArgs.updatingGeometryThisFrame = true;
+
+    EXPECT_EQ(FrameUpdate::FULL, chooseFrameUpdate());
+}
+
+TEST_F(OutputChooseFrameUpdateTest, composesFrameOnVirtualDisplay) {
+    EXPECT_CALL(mOutput, getDisplayId()).WillRepeatedly(Return(GpuVirtualDisplayId(1)));
+
+    EXPECT_EQ(FrameUpdate::FULL, chooseFrameUpdate());
+}
+
 /*
  * Output::updateColorProfile()
  */
@@ -3323,6 +3581,7 @@ struct OutputComposeSurfacesTest : public testing::Test {
         EXPECT_CALL(mOutput, getCompositionEngine()).WillRepeatedly(ReturnRef(mCompositionEngine));
         EXPECT_CALL(mCompositionEngine, getRenderEngine()).WillRepeatedly(ReturnRef(mRenderEngine));
         EXPECT_CALL(mCompositionEngine, getTimeStats()).WillRepeatedly(Return(mTimeStats.get()));
+        EXPECT_CALL(mCompositionEngine, getFrameStageStats()).WillRepeatedly(Return(nullptr));
         EXPECT_CALL(*mDisplayColorProfile, getHdrCapabilities())
                 .WillRepeatedly(ReturnRef(kHdrCapabilities));
     }
@@ -3665,6 +3924,32 @@ TEST_F(OutputComposeSurfacesTest, clientCompositionIfRequestChanges) {
     EXPECT_FALSE(mOutput.mState.reusedClientComposition);
 }
 
+TEST_F(OutputComposeSurfacesTest, partialClientCompositionDamagesWholeFrameOnFullRedraw) {
+    mOutput.mState.partialClientComposition = true;
+    LayerFE::LayerSettings r1;
+    r1.geometry.boundaries = FloatRect{1, 2, 3, 4};
+
+    EXPECT_CALL(mOutput, getSkipColorTransform()).WillRepeatedly(Return(false));
+    EXPECT_CALL(mOutput, getOutputLayerCount()).WillRepeatedly(Return(0u));
+    EXPECT_CALL(*mDisplayColorProfile, hasWideColorGamut()).WillRepeatedly(Return(true));
+    EXPECT_CALL(mRenderEngine, supportsProtectedContent()).WillRepeatedly(Return(false));
+    EXPECT_CALL(mRenderEngine, isProtected()).WillRepeatedly(Return(false));
+    EXPECT_CALL(mOutput, generateClientCompositionRequests(_, kDefaultOutputDataspace, _))
+            .WillRepeatedly(Return(std::vector<LayerFE::LayerSettings>{r1}));
+    EXPECT_CALL(mOutput, appendRegionFlashRequests(RegionEq(kDebugRegion), _))
+            .WillRepeatedly(Return());
+
+    // Nothing was queued from the same content, so the whole buffer is redrawn and the whole
+    // frame is damaged, not only the dirty region.
+    EXPECT_CALL(*mRenderSurface, dequeueBuffer(_)).WillRepeatedly(Return(mOutputBuffer));
+    EXPECT_CALL(*mRenderSurface, addFrameDamage(RegionEq(Region(kDefaultOutputDestinationClip))))
+            .Times(1);
+    EXPECT_CALL(mRenderEngine, drawLayers(_, ElementsAre(r1), _, _))
+            .WillOnce(Return(ByMove(ftl::yield<FenceResult>(Fence::NO_FENCE))));
+
+    verify().execute().expectAFenceWasReturned();
+}
+
 struct OutputComposeSurfacesTest_UsesExpectedDisplaySettings : public OutputComposeSurfacesTest {
     OutputComposeSurfacesTest_UsesExpectedDisplaySettings() {
         EXPECT_CALL(mRenderEngine, supportsProtectedContent()).WillRepeatedly(Return(false));
@@ -352,6 +352,68 @@ TEST_F(RenderSurfaceTest, queueBufferHandlesNativeWindowQueueBufferFailureOnVirt
     EXPECT_EQ(nullptr, mSurface.mutableTextureForTest().get());
 }
 
+/*
+ * RenderSurface::getBufferDamage()
+ */
+
+TEST_F(RenderSurfaceTest, getBufferDamageIsInvalidWithoutDamageTracking) {
+    sp<GraphicBuffer> buffer = sp<GraphicBuffer>::make();
+
+    EXPECT_CALL(*mNativeWindow, dequeueBuffer(_, _))
+            .WillOnce(
+                    DoAll(SetArgPointee<0>(buffer.get()), SetArgPointee<1>(-1), Return(NO_ERROR)));
+
+    base::unique_fd fence;
+    mSurface.dequeueBuffer(&fence);
+
+    EXPECT_TRUE(mSurface.getBufferDamage().hasSameRects(Region::INVALID_REGION));
+}
+
+TEST_F(RenderSurfaceTest, getBufferDamageAccumulatesDamageSinceBufferWasQueued) {
+    sp<GraphicBuffer> buffer1 = sp<GraphicBuffer>::make();
+    sp<GraphicBuffer> buffer2 = sp<GraphicBuffer>::make();
+    const Rect damage1(10, 10, 20, 20);
+    const Rect damage2(30, 30, 40, 40);
+
+    impl::OutputCompositionState state;
+    state.usesClientComposition = true;
+    EXPECT_CALL(mDisplay, getState()).WillRepeatedly(ReturnRef(state));
+    EXPECT_CALL(*mDisplaySurface, advanceFrame(_)).WillRepeatedly(Return(NO_ERROR));
+    EXPECT_CALL(*mNativeWindow, queueBuffer(_, _)).WillRepeatedly(Return(NO_ERROR));
+
+    // A new buffer has no content to keep.
+    mSurface.addFrameDamage(Region(damage1));
+    EXPECT_CALL(*mNativeWindow, dequeueBuffer(_, _))
+            .WillOnce(
+                    DoAll(SetArgPointee<0>(buffer1.get()), SetArgPointee<1>(-1), Return(NO_ERROR)));
+    EXPECT_CALL(*mNativeWindow, query(NATIVE_WINDOW_BUFFER_AGE, _))
+            .WillOnce(DoAll(SetArgPointee<1>(0), Return(NO_ERROR)));
+    base::unique_fd fence;
+    mSurface.dequeueBuffer(&fence);
+    EXPECT_TRUE(mSurface.getBufferDamage().hasSameRects(Region::INVALID_REGION));
+    mSurface.queueBuffer(base::unique_fd(), 1.f);
+
+    // The buffer queued before the last one misses the damage of both frames.
+    mSurface.addFrameDamage(Region(damage2));
+    EXPECT_CALL(*mNativeWindow, dequeueBuffer(_, _))
+            .WillOnce(
+                    DoAll(SetArgPointee<0>(buffer2.get()), SetArgPointee<1>(-1), Return(NO_ERROR)));
+    EXPECT_CALL(*mNativeWindow, query(NATIVE_WINDOW_BUFFER_AGE, _))
+            .WillOnce(DoAll(SetArgPointee<1>(2), Return(NO_ERROR)));
+    mSurface.dequeueBuffer(&fence);
+    EXPECT_TRUE(mSurface.getBufferDamage().hasSameRects(Region(damage1).orSelf(damage2)));
+    mSurface.queueBuffer(base::unique_fd(), 1.f);
+
+    // Older buffers than the history kept are redrawn whole.
+    EXPECT_CALL(*mNativeWindow, dequeueBuffer(_, _))
+            .WillOnce(
+                    DoAll(SetArgPointee<0>(buffer1.get()), SetArgPointee<1>(-1), Return(NO_ERROR)));
+    EXPECT_CALL(*mNativeWindow, query(NATIVE_WINDOW_BUFFER_AGE, _))
+            .WillOnce(DoAll(SetArgPointee<1>(4), Return(NO_ERROR)));
+    mSurface.dequeueBuffer(&fence);
+    EXPECT_TRUE(mSurface.getBufferDamage().hasSameRects(Region::INVALID_REGION));
+}
+
 /*
  * RenderSurface::onPresentDisplayCompleted()
  */
@@ -29,6 +29,7 @@
 #include <renderengine/impl/ExternalTexture.h>
 #include <renderengine/mock/RenderEngine.h>
 #include <chrono>
+#include <future>
 
 namespace android::compositionengine {
 using namespace std::chrono_literals;
@@ -1140,6 +1141,58 @@ TEST_F(FlattenerRenderSchedulingTest, flattenLayers_renderCachedSets_defersUpToM
                                  true);
 }
 
+class FlattenerBackgroundRenderingTest : public FlattenerTest {
+public:
+    FlattenerBackgroundRenderingTest()
+          : FlattenerTest(Flattener::Tunables{.mActiveLayerTimeout = 100ms,
+                                              .mRenderScheduling = std::nullopt,
+                                              .mEnableHolePunch = true,
+                                              .mRenderInBackground = true}) {}
+};
+
+TEST_F(FlattenerBackgroundRenderingTest, flattenLayers_mergesCachedSetOnceRendered) {
+    auto& layerState1 = mTestLayers[0]->layerState;
+    const auto& overrideBuffer1 = layerState1->getOutputLayer()->getState().overrideInfo.buffer;
+    auto& layerState2 = mTestLayers[1]->layerState;
+    const auto& overrideBuffer2 = layerState2->getOutputLayer()->getState().overrideInfo.buffer;
+
+    const std::vector<const LayerState*> layers = {
+            layerState1.get(),
+            layerState2.get(),
+    };
+
+    initializeFlattener(layers);
+
+    // Mark the layers inactive
+    mTime += 200ms;
+    initializeOverrideBuffer(layers);
+    EXPECT_EQ(getNonBufferHash(layers),
+              mFlattener->flattenLayers(layers, getNonBufferHash(layers), mTime));
+
+    // The layers are queued to the RenderEngine, which doesn't draw them yet.
+    std::promise<FenceResult> fenceResult;
+    EXPECT_CALL(mRenderEngine, drawLayers(_, _, _, _))
+            .WillOnce(Return(ByMove(ftl::Future<FenceResult>(fenceResult.get_future()))));
+    mFlattener->renderCachedSets(mOutputState, std::nullopt, true);
+    EXPECT_TRUE(mFlattener->getNewCachedSetForTesting()->isRendering());
+
+    // The cached set isn't merged in while it is being rendered, nor rendered again.
+    EXPECT_CALL(mRenderEngine, drawLayers(_, _, _, _)).Times(0);
+    initializeOverrideBuffer(layers);
+    EXPECT_EQ(getNonBufferHash(layers),
+              mFlattener->flattenLayers(layers, getNonBufferHash(layers), mTime));
+    mFlattener->renderCachedSets(mOutputState, std::nullopt, true);
+    EXPECT_EQ(nullptr, overrideBuffer1);
+    EXPECT_EQ(nullptr, overrideBuffer2);
+
+    fenceResult.set_value(Fence::NO_FENCE);
+    initializeOverrideBuffer(layers);
+    EXPECT_NE(getNonBufferHash(layers),
+              mFlattener->flattenLayers(layers, getNonBufferHash(layers), mTime));
+    EXPECT_NE(nullptr, overrideBuffer1);
+    EXPECT_EQ(overrideBuffer1, overrideBuffer2);
+}
+
 TEST_F(FlattenerTest, flattenLayers_skipsLayersDisabledFromCaching) {
     auto& layerState1 = mTestLayers[0]->layerState;
     const auto& overrideBuffer1 = layerState1->getOutputLayer()->getState().overrideInfo.buffer;
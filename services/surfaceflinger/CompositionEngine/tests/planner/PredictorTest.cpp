@@ -550,5 +550,76 @@ TEST_F(PredictorTest, recordMissedPlan_skipsApproximateMatch) {
     EXPECT_FALSE(predictedPlanTwo);
 }
 
+TEST_F(PredictorTest, savePredictions_seedsAnotherPredictor) {
+    mock::OutputLayer outputLayerOne;
+    sp<mock::LayerFE> layerFEOne = sp<mock::LayerFE>::make();
+    OutputLayerCompositionState outputLayerCompositionStateOne;
+    LayerFECompositionState layerFECompositionStateOne;
+    layerFECompositionStateOne.compositionType = Composition::DEVICE;
+    setupMocksForLayer(outputLayerOne, *layerFEOne, outputLayerCompositionStateOne,
+                       layerFECompositionStateOne);
+    LayerState layerStateOne(&outputLayerOne);
+
+    Plan plan;
+    plan.addLayerType(Composition::DEVICE);
+
+    Predictor predictor;
+
+    NonBufferHash hash = getNonBufferHash({&layerStateOne});
+
+    // Only hit candidates become predictions, which are saved.
+    predictor.recordResult(std::nullopt, hash, {&layerStateOne}, false, plan);
+    EXPECT_EQ("", predictor.savePredictions(1));
+    predictor.recordResult(predictor.getPredictedPlan({}, hash), hash, {&layerStateOne}, false,
+                           plan);
+    const std::string predictions = predictor.savePredictions(1);
+    EXPECT_EQ("", predictor.savePredictions(0));
+
+    Predictor seededPredictor;
+    EXPECT_EQ(1u, seededPredictor.loadPredictions(predictions + "malformed\n0 X\n"));
+    EXPECT_EQ(0u, seededPredictor.getPredictionCount());
+
+    auto predictedPlan = seededPredictor.getPredictedPlan({}, hash);
+    Predictor::PredictedPlan expectedPlan{hash, plan, Prediction::Type::Exact};
+    EXPECT_EQ(expectedPlan, predictedPlan);
+
+    // A hit turns the seeded plan into a prediction.
+    seededPredictor.recordResult(predictedPlan, hash, {&layerStateOne}, false, plan);
+    EXPECT_EQ(1u, seededPredictor.getPredictionCount());
+    EXPECT_EQ(predictions, seededPredictor.savePredictions(1));
+}
+
+TEST_F(PredictorTest, loadPredictions_missedSeededPlanIsForgotten) {
+    mock::OutputLayer outputLayerOne;
+    sp<mock::LayerFE> layerFEOne = sp<mock::LayerFE>::make();
+    OutputLayerCompositionState outputLayerCompositionStateOne;
+    LayerFECompositionState layerFECompositionStateOne;
+    layerFECompositionStateOne.compositionType = Composition::DEVICE;
+    setupMocksForLayer(outputLayerOne, *layerFEOne, outputLayerCompositionStateOne,
+                       layerFECompositionStateOne);
+    LayerState layerStateOne(&outputLayerOne);
+
+    Plan plan;
+    plan.addLayerType(Composition::CLIENT);
+
+    NonBufferHash hash = getNonBufferHash({&layerStateOne});
+
+    Predictor predictor;
+    EXPECT_EQ(1u,
+              predictor.loadPredictions(base::StringPrintf("%016zx %s\n", hash,
+                                                           to_string(plan).c_str())));
+
+    auto predictedPlan = predictor.getPredictedPlan({}, hash);
+    ASSERT_TRUE(predictedPlan);
+
+    // The layer stack is learned with the plan it actually got.
+    Plan actualPlan;
+    actualPlan.addLayerType(Composition::DEVICE);
+    predictor.recordResult(predictedPlan, hash, {&layerStateOne}, false, actualPlan);
+    predictedPlan = predictor.getPredictedPlan({}, hash);
+    ASSERT_TRUE(predictedPlan);
+    EXPECT_EQ(actualPlan, predictedPlan->plan);
+}
+
 } // namespace
 } // namespace android::compositionengine::impl::planner
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+#undef LOG_TAG
+#define LOG_TAG "SurfaceFlinger"
+
+#include "CompositionThread.h"
+
+#include <pthread.h>
+
+#include <gui/TraceUtils.h>
+#include <utils/Log.h>
+
+namespace android {
+
+CompositionThread::CompositionThread() {
+    mThread = std::thread(&CompositionThread::loop, this);
+    pthread_setname_np(mThread.native_handle(), "Composition");
+}
+
+CompositionThread::~CompositionThread() {
+    {
+        std::scoped_lock lock(mMutex);
+        mDone = true;
+        mJobCv.notify_one();
+    }
+    mThread.join();
+}
+
+void CompositionThread::run(std::function<void()> job) {
+    std::scoped_lock lock(mMutex);
+    LOG_ALWAYS_FATAL_IF(mJob, "The previous composition has not been waited for");
+    mJob = std::move(job);
+    mJobCv.notify_one();
+}
+
+void CompositionThread::wait() {
+    ATRACE_CALL();
+    std::unique_lock lock(mMutex);
+    android::base::ScopedLockAssertion assumeLock(mMutex);
+    mIdleCv.wait(lock, [this]() REQUIRES(mMutex) { return !mJob; });
+}
+
+void CompositionThread::loop() {
+    std::unique_lock lock(mMutex);
+    android::base::ScopedLockAssertion assumeLock(mMutex);
+    while (true) {
+        mJobCv.wait(lock, [this]() REQUIRES(mMutex) { return mDone || mJob; });
+        if (mDone) {
+            return;
+        }
+        // The job stays set while it runs, so that it is waited for.
+        std::function<void()>& job = mJob;
+        lock.unlock();
+        job();
+        lock.lock();
+        mJob = nullptr;
+        mIdleCv.notify_all();
+    }
+}
+
+} // namespace android
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace android {
+
+// Runs the composition of a frame, so that the main thread can start on the next frame before it
+// completes. Runs one job at a time, which the thread that started it waits for before starting
+// the next one.
+//
+// The thread is created by the constructor, and inherits the scheduling policy of the thread which
+// created it.
+class CompositionThread final {
+public:
+    CompositionThread();
+    ~CompositionThread();
+
+    CompositionThread(const CompositionThread&) = delete;
+    CompositionThread& operator=(const CompositionThread&) = delete;
+
+    // Starts running the job. Must not be called while the previous job has not been waited for.
+    void run(std::function<void()> job);
+
+    // Returns once the job started by run has completed, or right away if there is none.
+    void wait();
+
+private:
+    void loop();
+
+    std::mutex mMutex;
+    std::condition_variable mJobCv;
+    std::condition_variable mIdleCv;
+    bool mDone GUARDED_BY(mMutex) = false;
+    // The job until it completes.
+    std::function<void()> mJob GUARDED_BY(mMutex);
+    std::thread mThread;
+};
+
+} // namespace android
@@ -85,14 +85,18 @@ DisplayDevice::DisplayDevice(DisplayDeviceCreationArgs& args)
                             static_cast<size_t>(SurfaceFlinger::maxFrameBufferAcquiredBuffers))
                     .build());
 
-    if (!mFlinger->mDisableClientCompositionCache &&
-        SurfaceFlinger::maxFrameBufferAcquiredBuffers > 0) {
-        mCompositionDisplay->createClientCompositionCache(
-                static_cast<uint32_t>(SurfaceFlinger::maxFrameBufferAcquiredBuffers));
+    uint32_t clientCompositionCacheSize = mFlinger->mClientCompositionCacheSize;
+    if (clientCompositionCacheSize == 0 && SurfaceFlinger::maxFrameBufferAcquiredBuffers > 0) {
+        clientCompositionCacheSize =
+                static_cast<uint32_t>(SurfaceFlinger::maxFrameBufferAcquiredBuffers);
+    }
+    if (!mFlinger->mDisableClientCompositionCache && clientCompositionCacheSize > 0) {
+        mCompositionDisplay->createClientCompositionCache(clientCompositionCacheSize);
     }
 
     mCompositionDisplay->setPredictCompositionStrategy(mFlinger->mPredictCompositionStrategy);
     mCompositionDisplay->setTreat170mAsSrgb(mFlinger->mTreat170mAsSrgb);
+    mCompositionDisplay->setPartialClientComposition(mFlinger->mPartialClientComposition);
     mCompositionDisplay->createDisplayColorProfile(
             compositionengine::DisplayColorProfileCreationArgsBuilder()
                     .setHasWideColorGamut(args.hasWideColorGamut)
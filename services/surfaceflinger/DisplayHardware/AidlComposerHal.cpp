@@ -22,6 +22,7 @@
 
 #include <SurfaceFlingerProperties.h>
 #include <android-base/file.h>
+#include <android-base/stringprintf.h>
 #include <android/binder_ibinder_platform.h>
 #include <android/binder_manager.h>
 #include <common/FlagManager.h>
@@ -333,8 +334,20 @@ std::string AidlComposer::dumpDebugInfo() {
 
     std::string hash;
     mAidlComposer->getInterfaceHash(&hash);
+
+    const uint64_t executes = mExecuteCount.load(std::memory_order_relaxed);
+    const uint64_t presents = mPresentCount.load(std::memory_order_relaxed);
+    const uint64_t layerCommands = mLayerCommandCount.load(std::memory_order_relaxed);
+    const float perPresent = presents ? 1.f / static_cast<float>(presents) : 0.f;
+    const std::string counters =
+            base::StringPrintf("\nexecuteCommands: %" PRIu64 " calls, %" PRIu64
+                               " presents, %.2f calls and %.1f layer commands per present\n",
+                               executes, presents, static_cast<float>(executes) * perPresent,
+                               static_cast<float>(layerCommands) * perPresent);
+
     return std::string(mAidlComposer->descriptor) +
-            " version:" + std::to_string(mComposerInterfaceVersion) + " hash:" + hash + str;
+            " version:" + std::to_string(mComposerInterfaceVersion) + " hash:" + hash + str +
+            counters;
 }
 
 void AidlComposer::registerCallback(HWC2::ComposerCallback& callback) {
@@ -1133,6 +1146,14 @@ Error AidlComposer::execute(Display display) {
         return Error::NONE;
     }
 
+    mExecuteCount.fetch_add(1, std::memory_order_relaxed);
+    for (const auto& command : commands) {
+        mLayerCommandCount.fetch_add(command.layers.size(), std::memory_order_relaxed);
+        if (command.presentDisplay || command.presentOrValidateDisplay) {
+            mPresentCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
     { // scope for results
         std::vector<CommandResultPayload> results;
         auto status = mAidlComposerClient->executeCommands(commands, &results);
@@ -296,6 +296,11 @@ private:
     bool mEnableLayerCommandBatchingFlag = false;
     std::atomic<int64_t> mLayerID = 1;
 
+    // HAL traffic, reported in dumpsys. Displays may execute their commands concurrently.
+    std::atomic<uint64_t> mExecuteCount = 0;
+    std::atomic<uint64_t> mPresentCount = 0;
+    std::atomic<uint64_t> mLayerCommandCount = 0;
+
     // Buffer slots for layers are cleared by setting the slot buffer to this buffer.
     sp<GraphicBuffer> mClearSlotBuffer;
 
@@ -91,6 +91,11 @@ status_t FramebufferSurface::prepareFrame(CompositionType /*compositionType*/) {
     return NO_ERROR;
 }
 
+void FramebufferSurface::setClientTargetDamage(const Region& damage) {
+    Mutex::Autolock lock(mMutex);
+    mClientTargetDamage = damage;
+}
+
 status_t FramebufferSurface::advanceFrame(float hdrSdrRatio) {
     Mutex::Autolock lock(mMutex);
 
@@ -131,7 +136,8 @@ status_t FramebufferSurface::advanceFrame(float hdrSdrRatio) {
         hwcBuffer = mCurrentBuffer; // HWC hasn't previously seen this buffer in this slot
     }
     status_t result = mHwc.setClientTarget(mDisplayId, mCurrentBufferSlot, mCurrentFence, hwcBuffer,
-                                           mDataspace, hdrSdrRatio);
+                                           mDataspace, hdrSdrRatio, mClientTargetDamage);
+    mClientTargetDamage = Region::INVALID_REGION;
     if (result != NO_ERROR) {
         ALOGE("error posting framebuffer: %s (%d)", strerror(-result), result);
         return result;
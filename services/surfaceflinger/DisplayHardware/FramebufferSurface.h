@@ -24,6 +24,7 @@
 #include <gui/BufferQueue.h>
 #include <gui/ConsumerBase.h>
 #include <ui/DisplayId.h>
+#include <ui/Region.h>
 #include <ui/Size.h>
 
 #include <ui/DisplayIdentification.h>
@@ -47,6 +48,7 @@ public:
     virtual status_t beginFrame(bool mustRecompose);
     virtual status_t prepareFrame(CompositionType compositionType);
     virtual status_t advanceFrame(float hdrSdrRatio);
+    void setClientTargetDamage(const Region& damage) override;
     virtual void onFrameCommitted();
     virtual void dumpAsString(String8& result) const;
 
@@ -94,6 +96,9 @@ private:
     // mCurrentFence is the current buffer's acquire fence
     sp<Fence> mCurrentFence;
 
+    // The damage of the next buffer to acquire, which is passed on to HWC with it.
+    Region mClientTargetDamage = Region::INVALID_REGION;
+
     // Hardware composer, owned by SurfaceFlinger.
     HWComposer& mHwc;
 
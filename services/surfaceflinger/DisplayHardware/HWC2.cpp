@@ -67,6 +67,19 @@ inline bool hasMetadataKey(const std::set<Hwc2::PerFrameMetadataKey>& keys,
     return keys.find(key) != keys.end();
 }
 
+std::vector<Hwc2::IComposerClient::Rect> convertRegionToHwcRects(const Region& region) {
+    size_t rectCount = 0;
+    Rect const* rectArray = region.getArray(&rectCount);
+
+    std::vector<Hwc2::IComposerClient::Rect> hwcRects;
+    hwcRects.reserve(rectCount);
+    for (size_t rect = 0; rect < rectCount; ++rect) {
+        hwcRects.push_back({rectArray[rect].left, rectArray[rect].top, rectArray[rect].right,
+                            rectArray[rect].bottom});
+    }
+    return hwcRects;
+}
+
 } // namespace anonymous
 
 // Display methods
@@ -414,6 +427,7 @@ Error Display::present(sp<Fence>* outPresentFence)
     auto intError = mComposer.presentDisplay(mId, &presentFenceFd);
     auto error = static_cast<Error>(intError);
     if (error != Error::NONE) {
+        clearLayerCachedState();
         return error;
     }
 
@@ -463,12 +477,15 @@ Error Display::setActiveConfigWithConstraints(hal::HWConfigId configId,
 
 Error Display::setClientTarget(uint32_t slot, const sp<GraphicBuffer>& target,
                                const sp<Fence>& acquireFence, Dataspace dataspace,
-                               float hdrSdrRatio) {
-    // TODO: Properly encode client target surface damage
+                               float hdrSdrRatio, const Region& damage) {
     int32_t fenceFd = acquireFence->dup();
-    auto intError =
-            mComposer.setClientTarget(mId, slot, target, fenceFd, dataspace,
-                                      std::vector<Hwc2::IComposerClient::Rect>(), hdrSdrRatio);
+    // We encode full damage as INVALID_RECT upstream, but as 0 rects for HWC
+    const bool fullDamage = damage.isRect() && damage.getBounds() == Rect::INVALID_RECT;
+    auto intError = mComposer.setClientTarget(mId, slot, target, fenceFd, dataspace,
+                                              fullDamage
+                                                      ? std::vector<Hwc2::IComposerClient::Rect>()
+                                                      : convertRegionToHwcRects(damage),
+                                              hdrSdrRatio);
     return static_cast<Error>(intError);
 }
 
@@ -542,6 +559,7 @@ Error Display::validate(nsecs_t expectedPresentTime, int32_t frameIntervalNs, ui
                                               &numRequests);
     auto error = static_cast<Error>(intError);
     if (error != Error::NONE && !hasChangesError(error)) {
+        clearLayerCachedState();
         return error;
     }
 
@@ -561,6 +579,7 @@ Error Display::presentOrValidate(nsecs_t expectedPresentTime, int32_t frameInter
                                                &numRequests, &presentFenceFd, state);
     auto error = static_cast<Error>(intError);
     if (error != Error::NONE && !hasChangesError(error)) {
+        clearLayerCachedState();
         return error;
     }
 
@@ -649,6 +668,14 @@ void Display::setConnected(bool connected) {
 
 // Other Display methods
 
+void Display::clearLayerCachedState() {
+    for (const auto& [_, weakLayer] : mLayers) {
+        if (std::shared_ptr layer = weakLayer.lock()) {
+            layer->clearCachedState();
+        }
+    }
+}
+
 std::shared_ptr<HWC2::Layer> Display::getLayerById(HWLayerId id) const {
     auto it = mLayers.find(id);
     return it != mLayers.end() ? it->second.lock() : nullptr;
@@ -657,21 +684,6 @@ std::shared_ptr<HWC2::Layer> Display::getLayerById(HWLayerId id) const {
 
 // Layer methods
 
-namespace {
-std::vector<Hwc2::IComposerClient::Rect> convertRegionToHwcRects(const Region& region) {
-    size_t rectCount = 0;
-    Rect const* rectArray = region.getArray(&rectCount);
-
-    std::vector<Hwc2::IComposerClient::Rect> hwcRects;
-    hwcRects.reserve(rectCount);
-    for (size_t rect = 0; rect < rectCount; ++rect) {
-        hwcRects.push_back({rectArray[rect].left, rectArray[rect].top, rectArray[rect].right,
-                            rectArray[rect].bottom});
-    }
-    return hwcRects;
-}
-} // namespace
-
 Layer::~Layer() = default;
 
 namespace impl {
@@ -692,6 +704,17 @@ Layer::~Layer()
     onOwningDisplayDestroyed();
 }
 
+void Layer::clearCachedState() {
+    mBlendMode.reset();
+    mColor.reset();
+    mDisplayFrame.reset();
+    mPlaneAlpha.reset();
+    mSourceCrop.reset();
+    mTransform.reset();
+    mZOrder.reset();
+    mBrightness.reset();
+}
+
 void Layer::onOwningDisplayDestroyed() {
     // Note: onOwningDisplayDestroyed() may be called to perform cleanup by
     // either the Layer dtor or by the Display dtor and must be safe to call
@@ -786,8 +809,15 @@ Error Layer::setBlendMode(BlendMode mode)
         return Error::BAD_DISPLAY;
     }
 
+    if (mBlendMode == mode) {
+        return Error::NONE;
+    }
     auto intError = mComposer.setLayerBlendMode(mDisplay->getId(), mId, mode);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mBlendMode = mode;
+    }
+    return error;
 }
 
 Error Layer::setColor(Color color) {
@@ -795,8 +825,15 @@ Error Layer::setColor(Color color) {
         return Error::BAD_DISPLAY;
     }
 
+    if (mColor == color) {
+        return Error::NONE;
+    }
     auto intError = mComposer.setLayerColor(mDisplay->getId(), mId, color);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mColor = color;
+    }
+    return error;
 }
 
 Error Layer::setCompositionType(Composition type)
@@ -895,10 +932,17 @@ Error Layer::setDisplayFrame(const Rect& frame)
         return Error::BAD_DISPLAY;
     }
 
+    if (mDisplayFrame == frame) {
+        return Error::NONE;
+    }
     Hwc2::IComposerClient::Rect hwcRect{frame.left, frame.top,
         frame.right, frame.bottom};
     auto intError = mComposer.setLayerDisplayFrame(mDisplay->getId(), mId, hwcRect);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mDisplayFrame = frame;
+    }
+    return error;
 }
 
 Error Layer::setPlaneAlpha(float alpha)
@@ -907,8 +951,15 @@ Error Layer::setPlaneAlpha(float alpha)
         return Error::BAD_DISPLAY;
     }
 
+    if (mPlaneAlpha == alpha) {
+        return Error::NONE;
+    }
     auto intError = mComposer.setLayerPlaneAlpha(mDisplay->getId(), mId, alpha);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mPlaneAlpha = alpha;
+    }
+    return error;
 }
 
 Error Layer::setSidebandStream(const native_handle_t* stream)
@@ -932,10 +983,17 @@ Error Layer::setSourceCrop(const FloatRect& crop)
         return Error::BAD_DISPLAY;
     }
 
+    if (mSourceCrop == crop) {
+        return Error::NONE;
+    }
     Hwc2::IComposerClient::FRect hwcRect{
         crop.left, crop.top, crop.right, crop.bottom};
     auto intError = mComposer.setLayerSourceCrop(mDisplay->getId(), mId, hwcRect);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mSourceCrop = crop;
+    }
+    return error;
 }
 
 Error Layer::setTransform(Transform transform)
@@ -944,9 +1002,16 @@ Error Layer::setTransform(Transform transform)
         return Error::BAD_DISPLAY;
     }
 
+    if (mTransform == transform) {
+        return Error::NONE;
+    }
     auto intTransform = static_cast<Hwc2::Transform>(transform);
     auto intError = mComposer.setLayerTransform(mDisplay->getId(), mId, intTransform);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mTransform = transform;
+    }
+    return error;
 }
 
 Error Layer::setVisibleRegion(const Region& region)
@@ -971,8 +1036,15 @@ Error Layer::setZOrder(uint32_t z)
         return Error::BAD_DISPLAY;
     }
 
+    if (mZOrder == z) {
+        return Error::NONE;
+    }
     auto intError = mComposer.setLayerZOrder(mDisplay->getId(), mId, z);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mZOrder = z;
+    }
+    return error;
 }
 
 // Composer HAL 2.3
@@ -1011,8 +1083,15 @@ Error Layer::setBrightness(float brightness) {
         return Error::BAD_DISPLAY;
     }
 
+    if (mBrightness == brightness) {
+        return Error::NONE;
+    }
     auto intError = mComposer.setLayerBrightness(mDisplay->getId(), mId, brightness);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mBrightness = brightness;
+    }
+    return error;
 }
 
 Error Layer::setBlockingRegion(const Region& region) {
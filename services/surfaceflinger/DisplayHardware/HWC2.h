@@ -22,7 +22,9 @@
 #include <ftl/future.h>
 #include <gui/HdrMetadata.h>
 #include <math/mat4.h>
+#include <ui/FloatRect.h>
 #include <ui/HdrCapabilities.h>
+#include <ui/Rect.h>
 #include <ui/Region.h>
 #include <ui/StaticDisplayInfo.h>
 #include <utils/Log.h>
@@ -30,6 +32,7 @@
 #include <utils/Timers.h>
 
 #include <functional>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -144,7 +147,7 @@ public:
     [[nodiscard]] virtual hal::Error setClientTarget(
             uint32_t slot, const android::sp<android::GraphicBuffer>& target,
             const android::sp<android::Fence>& acquireFence, hal::Dataspace dataspace,
-            float hdrSdrRatio) = 0;
+            float hdrSdrRatio, const android::Region& damage) = 0;
     [[nodiscard]] virtual hal::Error setColorMode(hal::ColorMode mode,
                                                   hal::RenderIntent renderIntent) = 0;
     [[nodiscard]] virtual hal::Error setColorTransform(const android::mat4& matrix) = 0;
@@ -232,7 +235,8 @@ public:
     hal::Error present(android::sp<android::Fence>* outPresentFence) override;
     hal::Error setClientTarget(uint32_t slot, const android::sp<android::GraphicBuffer>& target,
                                const android::sp<android::Fence>& acquireFence,
-                               hal::Dataspace dataspace, float hdrSdrRatio) override;
+                               hal::Dataspace dataspace, float hdrSdrRatio,
+                               const android::Region& damage) override;
     hal::Error setColorMode(hal::ColorMode, hal::RenderIntent) override;
     hal::Error setColorTransform(const android::mat4& matrix) override;
     hal::Error setOutputBuffer(const android::sp<android::GraphicBuffer>&,
@@ -278,6 +282,9 @@ public:
     hal::Error getPhysicalDisplayOrientation(Hwc2::AidlTransform* outTransform) const override;
 
 private:
+    // The layer commands are only executed along with the validate or present of the display, so
+    // when those fail, the layers cannot tell which of the state they sent the HWC accepted.
+    void clearLayerCachedState();
 
     // This may fail (and return a null pointer) if no layer with this ID exists
     // on this display
@@ -369,6 +376,9 @@ public:
 
     void onOwningDisplayDestroyed();
 
+    // Forgets the state last sent, so that it is all sent again.
+    void clearCachedState();
+
     hal::HWLayerId getId() const override { return mId; }
 
     hal::Error setCursorPosition(int32_t x, int32_t y) override;
@@ -424,6 +434,16 @@ private:
     android::HdrMetadata mHdrMetadata;
     android::mat4 mColorMatrix;
     uint32_t mBufferSlot;
+    // Only updated once the HWC accepted the value, so that it is sent again after an error. The
+    // display clears them when the commands sent with them fail.
+    std::optional<hal::BlendMode> mBlendMode;
+    std::optional<aidl::android::hardware::graphics::composer3::Color> mColor;
+    std::optional<android::Rect> mDisplayFrame;
+    std::optional<float> mPlaneAlpha;
+    std::optional<android::FloatRect> mSourceCrop;
+    std::optional<hal::Transform> mTransform;
+    std::optional<uint32_t> mZOrder;
+    std::optional<float> mBrightness;
 };
 
 } // namespace impl
@@ -151,9 +151,11 @@ public:
             nsecs_t expectedPresentTime, Fps frameInterval,
             std::optional<DeviceRequestedChanges>* outChanges) = 0;
 
+    // The damage is the region of the target which changed since the previous one, or
+    // Region::INVALID_REGION if all of it may have.
     virtual status_t setClientTarget(HalDisplayId, uint32_t slot, const sp<Fence>& acquireFence,
                                      const sp<GraphicBuffer>& target, ui::Dataspace,
-                                     float hdrSdrRatio) = 0;
+                                     float hdrSdrRatio, const Region& damage) = 0;
 
     // Present layers to the display and read releaseFences.
     virtual status_t presentAndGetReleaseFences(
@@ -352,7 +354,7 @@ public:
 
     status_t setClientTarget(HalDisplayId, uint32_t slot, const sp<Fence>& acquireFence,
                              const sp<GraphicBuffer>& target, ui::Dataspace,
-                             float hdrSdrRatio) override;
+                             float hdrSdrRatio, const Region& damage) override;
 
     // Present layers to the display and read releaseFences.
     status_t presentAndGetReleaseFences(
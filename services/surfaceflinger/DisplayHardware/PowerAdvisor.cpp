@@ -77,19 +77,8 @@ PowerAdvisor::PowerAdvisor(SurfaceFlinger& flinger)
                                    /* resetCallback */ nullptr,
                                    /* timeoutCallback */
                                    [this] {
-                                       while (true) {
-                                           auto timeSinceLastUpdate = std::chrono::nanoseconds(
-                                                   systemTime() - mLastScreenUpdatedTime.load());
-                                           if (timeSinceLastUpdate >= getUpdateTimeout()) {
-                                               break;
-                                           }
-                                           // We may try to disable expensive rendering and allow
-                                           // for sending DISPLAY_UPDATE_IMMINENT hints too early if
-                                           // we idled very shortly after updating the screen, so
-                                           // make sure we wait enough time.
-                                           std::this_thread::sleep_for(getUpdateTimeout() -
-                                                                       timeSinceLastUpdate);
-                                       }
+                                       // The timer is reset on every screen update, so it only
+                                       // expires once the screen has not updated for the timeout.
                                        mSendUpdateImminent.store(true);
                                        mFlinger.disableExpensiveRendering();
                                    });
@@ -108,6 +97,7 @@ void PowerAdvisor::onBootFinished() {
 }
 
 void PowerAdvisor::setExpensiveRenderingExpected(DisplayId displayId, bool expected) {
+    std::scoped_lock lock(mExpensiveRenderingMutex);
     if (!mHasExpensiveRendering) {
         ALOGV("Skipped sending EXPENSIVE_RENDERING because HAL doesn't support it");
         return;
@@ -133,6 +123,11 @@ void PowerAdvisor::setExpensiveRenderingExpected(DisplayId displayId, bool expec
     }
 }
 
+bool PowerAdvisor::isUsingExpensiveRendering() {
+    std::scoped_lock lock(mExpensiveRenderingMutex);
+    return mNotifiedExpensiveRendering;
+}
+
 void PowerAdvisor::notifyCpuLoadUp() {
     // Only start sending this notification once the system has booted so we don't introduce an
     // early-boot dependency on Power HAL
@@ -178,9 +173,7 @@ void PowerAdvisor::notifyDisplayUpdateImminentAndCpuReset() {
             }
         }
 
-        if (mScreenUpdateTimer) {
-            mScreenUpdateTimer->reset();
-        } else {
+        if (!mScreenUpdateTimer) {
             // If we don't have a screen update timer, then we don't throttle power hal calls so
             // flip this bit back to allow for calling into power hal again.
             mSendUpdateImminent.store(true);
@@ -188,7 +181,15 @@ void PowerAdvisor::notifyDisplayUpdateImminentAndCpuReset() {
     }
 
     if (mScreenUpdateTimer) {
-        mLastScreenUpdatedTime.store(systemTime());
+        // Resetting a timer which is waiting only moves its timeout, without waking it up.
+        mScreenUpdateTimer->reset();
+    }
+}
+
+void PowerAdvisor::notifyExpectedHeavyFrame() {
+    // Picked up by the next updateTargetWorkDuration on the main thread.
+    if (mBootFinished.load()) {
+        mHeavyFrameExpected.store(true);
     }
 }
 
@@ -225,6 +226,13 @@ void PowerAdvisor::updateTargetWorkDuration(Duration targetDuration) {
     {
         mTargetDuration = targetDuration;
         if (sTraceHintSessionData) ATRACE_INT64("Time target", targetDuration.ns());
+        // Asking for a shorter frame ahead of a heavy one boosts before it starts, rather than
+        // after it has already run late. The regular target is sent again on the next frame.
+        if (mHeavyFrameExpected.exchange(false)) {
+            targetDuration =
+                    Duration::fromNs(targetDuration.ns() * kHeavyFrameTargetPercent / 100);
+            if (sTraceHintSessionData) ATRACE_INT64("Heavy frame target", targetDuration.ns());
+        }
         if (targetDuration == mLastTargetDurationSent) return;
         std::lock_guard lock(mHintSessionMutex);
         if (ensurePowerHintSessionRunning()) {
@@ -285,9 +293,8 @@ void PowerAdvisor::reportActualWorkDuration() {
                 // TODO(b/284324521): Correctly calculate total duration.
                 .durationNanos = actualDuration->ns(),
                 .workPeriodStartTimestampNanos = mCommitStartTimes[0].ns(),
-                .cpuDurationNanos = actualDuration->ns(),
-                // TODO(b/284324521): Calculate RenderEngine GPU time.
-                .gpuDurationNanos = 0,
+                .cpuDurationNanos = Duration{mWorkBreakdown.cpu + sTargetSafetyMargin}.ns(),
+                .gpuDurationNanos = mWorkBreakdown.gpu.ns(),
         };
         mHintSessionQueue.push_back(duration);
 
@@ -392,6 +399,11 @@ void PowerAdvisor::setHwcPresentDelayedTime(DisplayId displayId, TimePoint earli
 
 void PowerAdvisor::setCommitStart(TimePoint commitStartTime) {
     mCommitStartTimes.append(commitStartTime);
+    mCompositeStartTime.reset();
+}
+
+void PowerAdvisor::setCompositeStart(TimePoint compositeStartTime) {
+    mCompositeStartTime = compositeStartTime;
 }
 
 void PowerAdvisor::setCompositeEnd(TimePoint compositeEndTime) {
@@ -439,6 +451,12 @@ std::optional<Duration> PowerAdvisor::estimateWorkDuration() {
     // used to accumulate gpu time as we iterate over the active displays
     std::optional<TimePoint> estimatedGpuEndTime;
 
+    // The gpu time of all displays, reported to the hint session apart from the cpu time
+    Duration gpuDuration = 0ns;
+
+    // When the first display started presenting to hwc, which ends the composition on the cpu
+    std::optional<TimePoint> firstHwcPresentStartTime;
+
     // The timing info for the previously calculated display, if there was one
     std::optional<DisplayTimeline> previousDisplayTiming;
     std::vector<DisplayId>&& displayIds =
@@ -457,6 +475,7 @@ std::optional<Duration> PowerAdvisor::estimateWorkDuration() {
 
         // If this is the first display, include the duration before hwc present starts
         if (!previousDisplayTiming.has_value()) {
+            firstHwcPresentStartTime = displayTiming.hwcPresentStartTime;
             estimatedHwcEndTime += displayTiming.hwcPresentStartTime - mCommitStartTimes[0];
         } else { // Otherwise add the time since last display's hwc present finished
             estimatedHwcEndTime +=
@@ -478,6 +497,7 @@ std::optional<Duration> PowerAdvisor::estimateWorkDuration() {
         auto gpuTiming = displayData.estimateGpuTiming(previousValidGpuEndTime);
         if (gpuTiming.has_value()) {
             previousValidGpuEndTime = gpuTiming->startTime + gpuTiming->duration;
+            gpuDuration += gpuTiming->duration;
 
             // Estimate the prediction frame's gpu end time from the reference frame
             estimatedGpuEndTime = std::max(displayTiming.hwcPresentStartTime,
@@ -507,6 +527,26 @@ std::optional<Duration> PowerAdvisor::estimateWorkDuration() {
     // Combine the two timings into a single normalized one
     Duration combinedDuration = combineTimingEstimates(totalDuration, flingerDuration);
 
+    // Split the work by stage, so that the hint session can tell the cpu and gpu work apart
+    const TimePoint commitStartTime = mCommitStartTimes[0];
+    const TimePoint compositeStartTime = mCompositeStartTime.value_or(commitStartTime);
+    mWorkBreakdown = {
+            .commit = compositeStartTime - commitStartTime,
+            .composition = firstHwcPresentStartTime
+                    ? std::max(Duration{*firstHwcPresentStartTime - compositeStartTime},
+                               Duration{0ns})
+                    : Duration{0ns},
+            .gpu = gpuDuration,
+            .hwcWait = idleDuration,
+            .cpu = flingerDuration,
+    };
+    if (sTraceHintSessionData) {
+        ATRACE_INT64("Commit duration", mWorkBreakdown.commit.ns());
+        ATRACE_INT64("Composition duration", mWorkBreakdown.composition.ns());
+        ATRACE_INT64("Gpu duration", mWorkBreakdown.gpu.ns());
+        ATRACE_INT64("Hwc wait duration", mWorkBreakdown.hwcWait.ns());
+    }
+
     return std::make_optional(combinedDuration);
 }
 
@@ -92,6 +92,8 @@ public:
     virtual void setFrameDelay(Duration frameDelayDuration) = 0;
     // Reports the SurfaceFlinger commit start time this frame
     virtual void setCommitStart(TimePoint commitStartTime) = 0;
+    // Reports the SurfaceFlinger composite start time this frame
+    virtual void setCompositeStart(TimePoint compositeStartTime) = 0;
     // Reports the SurfaceFlinger composite end time this frame
     virtual void setCompositeEnd(TimePoint compositeEndTime) = 0;
     // Reports the list of the currently active displays
@@ -104,6 +106,9 @@ public:
     virtual void notifyCpuLoadUp() = 0;
     // Send a hint about the imminent start of a new CPU workload
     virtual void notifyDisplayUpdateImminentAndCpuReset() = 0;
+    // Lowers the target work duration of the next frame, which is expected to be heavier than
+    // usual, e.g. for a display mode change or a screenshot, so that boosting starts before it
+    virtual void notifyExpectedHeavyFrame() = 0;
 };
 
 namespace impl {
@@ -117,8 +122,9 @@ public:
 
     void init() override;
     void onBootFinished() override;
-    void setExpensiveRenderingExpected(DisplayId displayId, bool expected) override;
-    bool isUsingExpensiveRendering() override { return mNotifiedExpensiveRendering; };
+    void setExpensiveRenderingExpected(DisplayId displayId, bool expected) override
+            EXCLUDES(mExpensiveRenderingMutex);
+    bool isUsingExpensiveRendering() override EXCLUDES(mExpensiveRenderingMutex);
     bool usePowerHintSession() override;
     bool supportsPowerHintSession() override;
     void updateTargetWorkDuration(Duration targetDuration) override;
@@ -137,6 +143,7 @@ public:
     void setHwcPresentDelayedTime(DisplayId displayId, TimePoint earliestFrameStartTime) override;
     void setFrameDelay(Duration frameDelayDuration) override;
     void setCommitStart(TimePoint commitStartTime) override;
+    void setCompositeStart(TimePoint compositeStartTime) override;
     void setCompositeEnd(TimePoint compositeEndTime) override;
     void setDisplays(std::vector<DisplayId>& displayIds) override;
     void setTotalFrameTargetWorkDuration(Duration targetDuration) override;
@@ -144,6 +151,7 @@ public:
     // --- The following methods may run on threads besides SF main ---
     void notifyCpuLoadUp() override;
     void notifyDisplayUpdateImminentAndCpuReset() override;
+    void notifyExpectedHeavyFrame() override;
 
 private:
     friend class PowerAdvisorTest;
@@ -151,12 +159,14 @@ private:
     std::unique_ptr<power::PowerHalController> mPowerHal;
     std::atomic_bool mBootFinished = false;
 
-    std::unordered_set<DisplayId> mExpensiveDisplays;
-    bool mNotifiedExpensiveRendering = false;
+    // Outputs which are presented in parallel report expensive rendering from their own threads.
+    std::mutex mExpensiveRenderingMutex;
+    std::unordered_set<DisplayId> mExpensiveDisplays GUARDED_BY(mExpensiveRenderingMutex);
+    bool mNotifiedExpensiveRendering GUARDED_BY(mExpensiveRenderingMutex) = false;
 
     SurfaceFlinger& mFlinger;
     std::atomic_bool mSendUpdateImminent = true;
-    std::atomic<nsecs_t> mLastScreenUpdatedTime = 0;
+    std::atomic_bool mHeavyFrameExpected = false;
     std::optional<scheduler::OneShotTimer> mScreenUpdateTimer;
 
     // Higher-level timing data used for estimation
@@ -221,6 +231,20 @@ private:
         }
     };
 
+    // How the work of a frame was split between the stages, as estimated for the hint session
+    struct WorkBreakdown {
+        // Main thread, from commit start until composite start
+        Duration commit{0ns};
+        // Composition on the cpu, from composite start until the first hwc present or validate
+        Duration composition{0ns};
+        // RenderEngine on the gpu, from the client composition fences of all displays
+        Duration gpu{0ns};
+        // Waiting in hwc validate and present, for the present fence or the earliest present time
+        Duration hwcWait{0ns};
+        // All of SurfaceFlinger's work on the cpu, excluding the waits
+        Duration cpu{0ns};
+    };
+
     // Filter and sort the display ids by a given property
     std::vector<DisplayId> getOrderedDisplayIds(
             std::optional<TimePoint> DisplayTimingData::*sortBy);
@@ -237,6 +261,10 @@ private:
     Duration mFrameDelayDuration{0ns};
     // Last frame's post-composition duration
     Duration mLastPostcompDuration{0ns};
+    // Current frame's composite start time, if reported after its commit start
+    std::optional<TimePoint> mCompositeStartTime;
+    // Latest frame's work split, updated when estimating its work duration
+    WorkBreakdown mWorkBreakdown;
     // Buffer of recent commit start times
     RingBuffer<TimePoint, 2> mCommitStartTimes;
     // Buffer of recent expected present times
@@ -263,7 +291,7 @@ private:
             GUARDED_BY(mHintSessionMutex) = nullptr;
 
     // Initialize to true so we try to call, to check if it's supported
-    bool mHasExpensiveRendering = true;
+    bool mHasExpensiveRendering GUARDED_BY(mExpensiveRenderingMutex) = true;
     bool mHasDisplayUpdateImminent = true;
     // Queue of actual durations saved to report
     std::vector<aidl::android::hardware::power::WorkDuration> mHintSessionQueue;
@@ -289,6 +317,9 @@ private:
     static const Duration sTargetSafetyMargin;
     static constexpr const Duration kDefaultTargetSafetyMargin{1ms};
 
+    // The target sent ahead of an expected heavy frame, as a percentage of the regular target
+    static constexpr int kHeavyFrameTargetPercent = 75;
+
     // Whether we should send reportActualWorkDuration calls
     static const bool sUseReportActualDuration;
 
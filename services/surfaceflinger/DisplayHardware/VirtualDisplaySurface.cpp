@@ -231,7 +231,8 @@ status_t VirtualDisplaySurface::advanceFrame(float hdrSdrRatio) {
         }
         // TODO: Correctly propagate the dataspace from GL composition
         result = mHwc.setClientTarget(*halDisplayId, mFbProducerSlot, mFbFence, hwcBuffer,
-                                      ui::Dataspace::UNKNOWN, hdrSdrRatio);
+                                      ui::Dataspace::UNKNOWN, hdrSdrRatio,
+                                      Region::INVALID_REGION);
     }
 
     return result;
@@ -18,8 +18,9 @@
 #define LOG_TAG "FpsReporter"
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
-#include <algorithm>
+#include <utils/Trace.h>
 
+#include "BackgroundExecutor.h"
 #include "FpsReporter.h"
 #include "Layer.h"
 #include "SurfaceFlinger.h"
@@ -37,61 +38,81 @@ void FpsReporter::dispatchLayerFps(const frontend::LayerHierarchy& layerHierarch
         return;
     }
 
-    std::vector<TrackedListener> localListeners;
+    std::unordered_set<int32_t> trackedTasks;
     {
         std::scoped_lock lock(mMutex);
         if (mListeners.empty()) {
             return;
         }
-
-        std::transform(mListeners.begin(), mListeners.end(), std::back_inserter(localListeners),
-                       [](const std::pair<wp<IBinder>, TrackedListener>& entry) {
-                           return entry.second;
-                       });
+        for (const auto& [_, listener] : mListeners) {
+            trackedTasks.insert(listener.taskId);
+        }
     }
 
-    std::unordered_set<int32_t> seenTasks;
-    std::vector<std::pair<TrackedListener, const frontend::LayerHierarchy*>>
-            listenersAndLayersToReport;
-
+    LayerIdsOfTasks layerIdsOfTasks;
     layerHierarchy.traverse([&](const frontend::LayerHierarchy& hierarchy,
                                 const frontend::LayerHierarchy::TraversalPath& traversalPath) {
         if (traversalPath.variant == frontend::LayerHierarchy::Variant::Detached) {
             return false;
         }
         const auto& metadata = hierarchy.getLayer()->metadata;
-        if (metadata.has(gui::METADATA_TASK_ID)) {
-            int32_t taskId = metadata.getInt32(gui::METADATA_TASK_ID, 0);
-            if (seenTasks.count(taskId) == 0) {
-                // localListeners is expected to be tiny
-                for (TrackedListener& listener : localListeners) {
-                    if (listener.taskId == taskId) {
-                        seenTasks.insert(taskId);
-                        listenersAndLayersToReport.push_back({listener, &hierarchy});
-                        break;
-                    }
-                }
-            }
+        if (!metadata.has(gui::METADATA_TASK_ID)) {
+            return true;
+        }
+        const int32_t taskId = metadata.getInt32(gui::METADATA_TASK_ID, 0);
+        if (trackedTasks.count(taskId) == 0 || layerIdsOfTasks.count(taskId) > 0) {
+            return true;
         }
-        return true;
-    });
-
-    for (const auto& [listener, hierarchy] : listenersAndLayersToReport) {
-        std::unordered_set<int32_t> layerIds;
 
-        hierarchy->traverse([&](const frontend::LayerHierarchy& hierarchy,
-                                const frontend::LayerHierarchy::TraversalPath& traversalPath) {
+        // The first layer of the task is its root, whose tree holds all of the layers of the task.
+        std::unordered_set<int32_t>& layerIds = layerIdsOfTasks[taskId];
+        hierarchy.traverse([&](const frontend::LayerHierarchy& hierarchy,
+                               const frontend::LayerHierarchy::TraversalPath& traversalPath) {
             if (traversalPath.variant == frontend::LayerHierarchy::Variant::Detached) {
                 return false;
             }
             layerIds.insert(static_cast<int32_t>(hierarchy.getLayer()->id));
             return true;
         });
+        // Keep going, for the tasks nested in this one.
+        return true;
+    });
 
-        listener.listener->onFpsReported(mFrameTimeline.computeFps(layerIds));
+    mLastDispatch = now;
+    if (layerIdsOfTasks.empty()) {
+        return;
     }
 
-    mLastDispatch = now;
+    BackgroundExecutor::getInstance().sendCallbacks(
+            {[self = sp<FpsReporter>::fromExisting(this),
+              layerIdsOfTasks = std::move(layerIdsOfTasks)]() {
+                self->reportFps(layerIdsOfTasks);
+            }});
+}
+
+void FpsReporter::reportFps(const LayerIdsOfTasks& layerIdsOfTasks) {
+    ATRACE_CALL();
+    std::unordered_map<int32_t, float> fpsOfTasks;
+    for (const auto& [taskId, layerIds] : layerIdsOfTasks) {
+        fpsOfTasks[taskId] = mFrameTimeline.computeFps(layerIds);
+    }
+
+    std::vector<std::pair<sp<gui::IFpsListener>, float>> toInvoke;
+    {
+        std::scoped_lock lock(mMutex);
+        for (auto& [_, listener] : mListeners) {
+            const auto fps = fpsOfTasks.find(listener.taskId);
+            if (fps == fpsOfTasks.end() || listener.lastReportedFps == fps->second) {
+                continue;
+            }
+            listener.lastReportedFps = fps->second;
+            toInvoke.emplace_back(listener.listener, fps->second);
+        }
+    }
+
+    for (const auto& [listener, fps] : toInvoke) {
+        listener->onFpsReported(fps);
+    }
 }
 
 void FpsReporter::binderDied(const wp<IBinder>& who) {
@@ -103,7 +124,7 @@ void FpsReporter::addListener(const sp<gui::IFpsListener>& listener, int32_t tas
     sp<IBinder> asBinder = IInterface::asBinder(listener);
     asBinder->linkToDeath(sp<DeathRecipient>::fromExisting(this));
     std::lock_guard lock(mMutex);
-    mListeners.emplace(wp<IBinder>(asBinder), TrackedListener{listener, taskId});
+    mListeners.emplace(wp<IBinder>(asBinder), TrackedListener{listener, taskId, std::nullopt});
 }
 
 void FpsReporter::removeListener(const sp<gui::IFpsListener>& listener) {
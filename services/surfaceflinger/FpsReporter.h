@@ -20,7 +20,9 @@
 #include <android/gui/IFpsListener.h>
 #include <binder/IBinder.h>
 
+#include <optional>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "Clock.h"
 #include "FrameTimeline/FrameTimeline.h"
@@ -38,8 +40,10 @@ public:
                 std::unique_ptr<Clock> clock = std::make_unique<SteadyClock>());
 
     // Dispatches updated layer fps values for the registered listeners
-    // This method promotes Layer weak pointers and performs layer stack traversals, so mStateLock
-    // must be held when calling this method.
+    // This method performs layer stack traversals, so mStateLock must be held when calling this
+    // method. The layers of each task are gathered once however many listeners watch it, and the
+    // fps is computed and reported on the BackgroundExecutor, only to the listeners whose fps
+    // changed since their last report.
     void dispatchLayerFps(const frontend::LayerHierarchy&) EXCLUDES(mMutex);
 
     // Override for IBinder::DeathRecipient
@@ -56,8 +60,14 @@ private:
     struct TrackedListener {
         sp<gui::IFpsListener> listener;
         int32_t taskId;
+        std::optional<float> lastReportedFps;
     };
 
+    using LayerIdsOfTasks = std::unordered_map<int32_t, std::unordered_set<int32_t>>;
+
+    // Runs on the BackgroundExecutor.
+    void reportFps(const LayerIdsOfTasks&) EXCLUDES(mMutex);
+
     frametimeline::FrameTimeline& mFrameTimeline;
     static const constexpr std::chrono::steady_clock::duration kMinDispatchDuration =
             std::chrono::milliseconds(500);
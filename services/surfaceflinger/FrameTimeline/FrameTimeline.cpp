@@ -25,8 +25,11 @@
 #include <utils/Log.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cinttypes>
+#include <cmath>
+#include <iterator>
 #include <numeric>
 #include <unordered_set>
 
@@ -36,6 +39,9 @@ using base::StringAppendF;
 using FrameTimelineEvent = perfetto::protos::pbzero::FrameTimelineEvent;
 using FrameTimelineDataSource = impl::FrameTimeline::FrameTimelineDataSource;
 
+// Matches IInputConstants::INVALID_INPUT_EVENT_ID, which FrameTimelineInfo defaults to.
+constexpr int32_t kInvalidInputEventId = 0;
+
 void dumpTable(std::string& result, TimelineItem predictions, TimelineItem actuals,
                const std::string& indent, PredictionState predictionState, nsecs_t baseTime) {
     StringAppendF(&result, "%s", indent.c_str());
@@ -322,8 +328,10 @@ int64_t TraceCookieCounter::getCookieForTracing() {
 }
 
 SurfaceFrame::SurfaceFrame(const FrameTimelineInfo& frameTimelineInfo, pid_t ownerPid,
-                           uid_t ownerUid, int32_t layerId, std::string layerName,
-                           std::string debugName, PredictionState predictionState,
+                           uid_t ownerUid, int32_t layerId,
+                           std::shared_ptr<const std::string> layerName,
+                           std::shared_ptr<const std::string> debugName,
+                           PredictionState predictionState,
                            frametimeline::TimelineItem&& predictions,
                            std::shared_ptr<TimeStats> timeStats,
                            JankClassificationThresholds thresholds,
@@ -370,7 +378,7 @@ void SurfaceFrame::setPresentState(PresentState presentState, nsecs_t lastLatchT
     LOG_ALWAYS_FATAL_IF(mPresentState != PresentState::Unknown,
                         "setPresentState called on a SurfaceFrame from Layer - %s, that has a "
                         "PresentState - %s set already.",
-                        mDebugName.c_str(), toString(mPresentState).c_str());
+                        mDebugName->c_str(), toString(mPresentState).c_str());
     mPresentState = presentState;
     mLastLatchTime = lastLatchTime;
 }
@@ -467,7 +475,7 @@ void SurfaceFrame::promoteToBuffer() {
     LOG_ALWAYS_FATAL_IF(mIsBuffer == true,
                         "Trying to promote an already promoted BufferSurfaceFrame from layer %s "
                         "with token %" PRId64 "",
-                        mDebugName.c_str(), mToken);
+                        mDebugName->c_str(), mToken);
     mIsBuffer = true;
 }
 
@@ -479,7 +487,7 @@ bool SurfaceFrame::getIsBuffer() const {
 void SurfaceFrame::dump(std::string& result, const std::string& indent, nsecs_t baseTime) const {
     std::scoped_lock lock(mMutex);
     StringAppendF(&result, "%s", indent.c_str());
-    StringAppendF(&result, "Layer - %s", mDebugName.c_str());
+    StringAppendF(&result, "Layer - %s", mDebugName->c_str());
     if (mJankType != JankType::None) {
         // Easily identify a janky Surface Frame in the dump
         StringAppendF(&result, " [*] ");
@@ -530,7 +538,7 @@ void SurfaceFrame::dump(std::string& result, const std::string& indent, nsecs_t
 std::string SurfaceFrame::miniDump() const {
     std::scoped_lock lock(mMutex);
     std::string result;
-    StringAppendF(&result, "Layer - %s\n", mDebugName.c_str());
+    StringAppendF(&result, "Layer - %s\n", mDebugName->c_str());
     StringAppendF(&result, "Token: %" PRId64 "\n", mToken);
     StringAppendF(&result, "Is Buffer?: %d\n", mIsBuffer);
     StringAppendF(&result, "Present State : %s\n", toString(mPresentState).c_str());
@@ -675,7 +683,7 @@ void SurfaceFrame::onPresent(nsecs_t presentTime, int32_t displayFrameJankType,
 
     if (mPredictionState != PredictionState::None) {
         // Only update janky frames if the app used vsync predictions
-        mTimeStats->incrementJankyFrames({refreshRate, mRenderRate, mOwnerUid, mLayerName,
+        mTimeStats->incrementJankyFrames({refreshRate, mRenderRate, mOwnerUid, *mLayerName,
                                           mGameMode, mJankType, displayDeadlineDelta,
                                           displayPresentDelta, deadlineDelta});
     }
@@ -700,7 +708,7 @@ void SurfaceFrame::tracePredictions(int64_t displayFrameToken, nsecs_t monoBootO
         expectedSurfaceFrameStartEvent->set_display_frame_token(displayFrameToken);
 
         expectedSurfaceFrameStartEvent->set_pid(mOwnerPid);
-        expectedSurfaceFrameStartEvent->set_layer_name(mDebugName);
+        expectedSurfaceFrameStartEvent->set_layer_name(*mDebugName);
     });
 
     // Expected timeline end
@@ -749,7 +757,7 @@ void SurfaceFrame::traceActuals(int64_t displayFrameToken, nsecs_t monoBootOffse
         actualSurfaceFrameStartEvent->set_display_frame_token(displayFrameToken);
 
         actualSurfaceFrameStartEvent->set_pid(mOwnerPid);
-        actualSurfaceFrameStartEvent->set_layer_name(mDebugName);
+        actualSurfaceFrameStartEvent->set_layer_name(*mDebugName);
 
         if (mPresentState == PresentState::Dropped) {
             actualSurfaceFrameStartEvent->set_present_type(FrameTimelineEvent::PRESENT_DROPPED);
@@ -848,31 +856,97 @@ void FrameTimeline::registerDataSource() {
     FrameTimelineDataSource::Register(dsd);
 }
 
+SurfaceFramePool::~SurfaceFramePool() {
+    for (void* block : mFreeBlocks) {
+        ::operator delete(block);
+    }
+}
+
+void* SurfaceFramePool::allocate(size_t size) {
+    {
+        std::scoped_lock lock(mMutex);
+        if (mBlockSize == 0) {
+            mBlockSize = size;
+        }
+        if (size == mBlockSize && !mFreeBlocks.empty()) {
+            void* const block = mFreeBlocks.back();
+            mFreeBlocks.pop_back();
+            return block;
+        }
+    }
+    return ::operator new(size);
+}
+
+void SurfaceFramePool::deallocate(void* block, size_t size) {
+    {
+        std::scoped_lock lock(mMutex);
+        if (size == mBlockSize && mFreeBlocks.size() < kMaxFreeBlocks) {
+            mFreeBlocks.push_back(block);
+            return;
+        }
+    }
+    ::operator delete(block);
+}
+
+size_t SurfaceFramePool::getFreeCount() const {
+    std::scoped_lock lock(mMutex);
+    return mFreeBlocks.size();
+}
+
+std::shared_ptr<const std::string> FrameTimeline::internName(const std::string& name) {
+    std::scoped_lock lock(mNamesMutex);
+    if (const auto it = mNames.find(name); it != mNames.end()) {
+        return it->second;
+    }
+
+    if (mNames.size() >= mNamesSweepSize) {
+        // Only the map points to the names of the layers which stopped updating, or are gone.
+        for (auto it = mNames.begin(); it != mNames.end();) {
+            it = it->second.use_count() == 1 ? mNames.erase(it) : std::next(it);
+        }
+        mNamesSweepSize = std::max(kMinNamesSweepSize, mNames.size() * 2);
+    }
+
+    auto interned = std::make_shared<const std::string>(name);
+    mNames.emplace(*interned, interned);
+    return interned;
+}
+
+template <typename... Args>
+std::shared_ptr<SurfaceFrame> FrameTimeline::makeSurfaceFrame(Args&&... args) {
+    return std::allocate_shared<SurfaceFrame>(SurfaceFramePool::Allocator<SurfaceFrame>(
+                                                      mSurfaceFramePool),
+                                              std::forward<Args>(args)...);
+}
+
 std::shared_ptr<SurfaceFrame> FrameTimeline::createSurfaceFrameForToken(
         const FrameTimelineInfo& frameTimelineInfo, pid_t ownerPid, uid_t ownerUid, int32_t layerId,
-        std::string layerName, std::string debugName, bool isBuffer, GameMode gameMode) {
+        const std::string& layerName, const std::string& debugName, bool isBuffer,
+        GameMode gameMode) {
     ATRACE_CALL();
+    auto internedLayerName = internName(layerName);
+    auto internedDebugName = debugName == layerName ? internedLayerName : internName(debugName);
     if (frameTimelineInfo.vsyncId == FrameTimelineInfo::INVALID_VSYNC_ID) {
-        return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
-                                              std::move(layerName), std::move(debugName),
-                                              PredictionState::None, TimelineItem(), mTimeStats,
-                                              mJankClassificationThresholds, &mTraceCookieCounter,
-                                              isBuffer, gameMode);
+        return makeSurfaceFrame(frameTimelineInfo, ownerPid, ownerUid, layerId,
+                                std::move(internedLayerName), std::move(internedDebugName),
+                                PredictionState::None, TimelineItem(), mTimeStats,
+                                mJankClassificationThresholds, &mTraceCookieCounter, isBuffer,
+                                gameMode);
     }
     std::optional<TimelineItem> predictions =
             mTokenManager.getPredictionsForToken(frameTimelineInfo.vsyncId);
     if (predictions) {
-        return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
-                                              std::move(layerName), std::move(debugName),
-                                              PredictionState::Valid, std::move(*predictions),
-                                              mTimeStats, mJankClassificationThresholds,
-                                              &mTraceCookieCounter, isBuffer, gameMode);
+        return makeSurfaceFrame(frameTimelineInfo, ownerPid, ownerUid, layerId,
+                                std::move(internedLayerName), std::move(internedDebugName),
+                                PredictionState::Valid, std::move(*predictions), mTimeStats,
+                                mJankClassificationThresholds, &mTraceCookieCounter, isBuffer,
+                                gameMode);
     }
-    return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
-                                          std::move(layerName), std::move(debugName),
-                                          PredictionState::Expired, TimelineItem(), mTimeStats,
-                                          mJankClassificationThresholds, &mTraceCookieCounter,
-                                          isBuffer, gameMode);
+    return makeSurfaceFrame(frameTimelineInfo, ownerPid, ownerUid, layerId,
+                            std::move(internedLayerName), std::move(internedDebugName),
+                            PredictionState::Expired, TimelineItem(), mTimeStats,
+                            mJankClassificationThresholds, &mTraceCookieCounter, isBuffer,
+                            gameMode);
 }
 
 FrameTimeline::DisplayFrame::DisplayFrame(std::shared_ptr<TimeStats> timeStats,
@@ -1374,12 +1448,70 @@ void FrameTimeline::flushPendingPresentFences() {
         mPreviousPredictionPresentTime = displayFrame->trace(mSurfaceFlingerPid, monoBootOffset,
                                                              mPreviousPredictionPresentTime);
         mPreviousActualPresentTime = signalTime;
+        if (signalTime != Fence::SIGNAL_TIME_INVALID) {
+            recordInputLatencies(*displayFrame);
+        }
 
         mPendingPresentFences.erase(mPendingPresentFences.begin() + static_cast<int>(i));
         --i;
     }
 }
 
+void FrameTimeline::InputLatencyHistogram::add(nsecs_t latency) {
+    buckets[FrameStageStats::bucketOf(Duration::fromNs(latency))]++;
+    count++;
+}
+
+nsecs_t FrameTimeline::InputLatencyHistogram::getPercentile(float percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+    const float fraction = std::clamp(percentile, 0.f, 100.f) / 100.f;
+    const uint64_t rank =
+            std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * count)));
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        cumulative += buckets[i];
+        if (cumulative >= rank) {
+            return FrameStageStats::bucketUpperBound(i).ns();
+        }
+    }
+    return FrameStageStats::bucketUpperBound(buckets.size() - 1).ns();
+}
+
+void FrameTimeline::recordInputLatencies(const DisplayFrame& displayFrame) {
+    for (const auto& surfaceFrame : displayFrame.getSurfaceFrames()) {
+        if (surfaceFrame->getInputEventId() == kInvalidInputEventId ||
+            surfaceFrame->getPredictionState() != PredictionState::Valid ||
+            surfaceFrame->getPresentState() != SurfaceFrame::PresentState::Presented) {
+            continue;
+        }
+        const TimelineItem actuals = surfaceFrame->getActuals();
+        const nsecs_t vsyncTime = surfaceFrame->getPredictions().startTime;
+        if (actuals.presentTime < vsyncTime) {
+            continue;
+        }
+
+        auto it = mInputLatencies.find(surfaceFrame->getLayerId());
+        if (it == mInputLatencies.end()) {
+            if (mInputLatencies.size() >= kMaxInputLatencyLayers) {
+                mDroppedInputLatencies++;
+                continue;
+            }
+            it = mInputLatencies.try_emplace(surfaceFrame->getLayerId()).first;
+            it->second.layerName = surfaceFrame->getLayerName();
+        }
+
+        InputLatencies& latencies = it->second;
+        latencies.vsyncToPresent.add(actuals.presentTime - vsyncTime);
+        // The acquire fence time is unknown for bufferless frames.
+        if (actuals.endTime >= vsyncTime && actuals.endTime <= actuals.presentTime) {
+            latencies.vsyncToReady.add(actuals.endTime - vsyncTime);
+            latencies.readyToPresent.add(actuals.presentTime - actuals.endTime);
+        }
+    }
+}
+
 void FrameTimeline::finalizeCurrentDisplayFrame() {
     while (mDisplayFrames.size() >= mMaxDisplayFrames) {
         // We maintain only a fixed number of frames' data. Pop older frames
@@ -1476,6 +1608,33 @@ void FrameTimeline::dumpJank(std::string& result) {
     }
 }
 
+void FrameTimeline::dumpInputLatencies(std::string& result) {
+    std::scoped_lock lock(mMutex);
+    StringAppendF(&result, "Input to present latencies (ms), %zu layers, %" PRIu64 " dropped\n",
+                  mInputLatencies.size(), mDroppedInputLatencies);
+    const auto toMillis = [](nsecs_t ns) {
+        return std::chrono::duration<double, std::milli>(std::chrono::nanoseconds(ns)).count();
+    };
+    const auto dumpHistogram = [&](const char* name, const InputLatencyHistogram& histogram) {
+        StringAppendF(&result, "    %-18s count=%" PRIu64 " p50=%.2f p90=%.2f p99=%.2f\n", name,
+                      histogram.count, toMillis(histogram.getPercentile(50)),
+                      toMillis(histogram.getPercentile(90)),
+                      toMillis(histogram.getPercentile(99)));
+    };
+    for (const auto& [layerId, latencies] : mInputLatencies) {
+        StringAppendF(&result, "  %s (%d)\n", latencies.layerName.c_str(), layerId);
+        dumpHistogram("vsync to present", latencies.vsyncToPresent);
+        dumpHistogram("vsync to ready", latencies.vsyncToReady);
+        dumpHistogram("ready to present", latencies.readyToPresent);
+    }
+}
+
+void FrameTimeline::clearInputLatencies() {
+    std::scoped_lock lock(mMutex);
+    mInputLatencies.clear();
+    mDroppedInputLatencies = 0;
+}
+
 void FrameTimeline::parseArgs(const Vector<String16>& args, std::string& result) {
     ATRACE_CALL();
     std::unordered_map<std::string, bool> argsMap;
@@ -1488,6 +1647,13 @@ void FrameTimeline::parseArgs(const Vector<String16>& args, std::string& result)
     if (argsMap.count("-all")) {
         dumpAll(result);
     }
+    if (argsMap.count("-input")) {
+        dumpInputLatencies(result);
+    }
+    if (argsMap.count("-input-clear")) {
+        clearInputLatencies();
+        result.append("Cleared input to present latencies\n");
+    }
 }
 
 void FrameTimeline::setMaxDisplayFrames(uint32_t size) {
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <deque>
@@ -23,6 +24,9 @@
 #include <mutex>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include <gui/ISurfaceComposer.h>
 #include <gui/JankInfo.h>
@@ -37,6 +41,7 @@
 
 #include <scheduler/Fps.h>
 
+#include "../TimeStats/FrameStageStats.h"
 #include "../TimeStats/TimeStats.h"
 
 namespace android::frametimeline {
@@ -159,7 +164,8 @@ public:
     // Only FrameTimeline can construct a SurfaceFrame as it provides Predictions(through
     // TokenManager), Thresholds and TimeStats pointer.
     SurfaceFrame(const FrameTimelineInfo& frameTimelineInfo, pid_t ownerPid, uid_t ownerUid,
-                 int32_t layerId, std::string layerName, std::string debugName,
+                 int32_t layerId, std::shared_ptr<const std::string> layerName,
+                 std::shared_ptr<const std::string> debugName,
                  PredictionState predictionState, TimelineItem&& predictions,
                  std::shared_ptr<TimeStats> timeStats, JankClassificationThresholds thresholds,
                  TraceCookieCounter* traceCookieCounter, bool isBuffer, GameMode);
@@ -218,6 +224,8 @@ public:
     TimelineItem getActuals() const;
     pid_t getOwnerPid() const { return mOwnerPid; };
     int32_t getLayerId() const { return mLayerId; };
+    const std::string& getLayerName() const { return *mLayerName; }
+    const std::string& getDebugName() const { return *mDebugName; }
     PredictionState getPredictionState() const;
     PresentState getPresentState() const;
     FrameReadyMetadata getFrameReadyMetadata() const;
@@ -241,8 +249,9 @@ private:
     const int32_t mInputEventId;
     const pid_t mOwnerPid;
     const uid_t mOwnerUid;
-    const std::string mLayerName;
-    const std::string mDebugName;
+    // Interned by FrameTimeline, as every frame of a layer has the same names.
+    const std::shared_ptr<const std::string> mLayerName;
+    const std::shared_ptr<const std::string> mDebugName;
     const int32_t mLayerId;
     PresentState mPresentState GUARDED_BY(mMutex);
     const PredictionState mPredictionState;
@@ -299,8 +308,8 @@ public:
     // Debug name is the human-readable debugging string for dumpsys.
     virtual std::shared_ptr<SurfaceFrame> createSurfaceFrameForToken(
             const FrameTimelineInfo& frameTimelineInfo, pid_t ownerPid, uid_t ownerUid,
-            int32_t layerId, std::string layerName, std::string debugName, bool isBuffer,
-            GameMode) = 0;
+            int32_t layerId, const std::string& layerName, const std::string& debugName,
+            bool isBuffer, GameMode) = 0;
 
     // Adds a new SurfaceFrame to the current DisplayFrame. Frames from multiple layers can be
     // composited into one display frame.
@@ -322,6 +331,8 @@ public:
     // -jank : Dumps only the Display Frames that are either janky themselves
     //         or contain janky Surface Frames.
     // -all : Dumps the entire list of DisplayFrames and the SurfaceFrames contained within
+    // -input : Dumps the per layer input to present latencies
+    // -input-clear : Clears the per layer input to present latencies
     virtual void parseArgs(const Vector<String16>& args, std::string& result) = 0;
 
     // Sets the max number of display frames that can be stored. Called by SF backdoor.
@@ -338,6 +349,53 @@ public:
 
 namespace impl {
 
+// Keeps the memory of released SurfaceFrames to allocate the next ones from, since a SurfaceFrame
+// is created for every layer which updates in every frame. Blocks of other sizes, or beyond
+// kMaxFreeBlocks, go back to the heap.
+class SurfaceFramePool {
+public:
+    static constexpr size_t kMaxFreeBlocks = 256;
+
+    ~SurfaceFramePool();
+
+    void* allocate(size_t size) EXCLUDES(mMutex);
+    void deallocate(void* block, size_t size) EXCLUDES(mMutex);
+
+    size_t getFreeCount() const EXCLUDES(mMutex);
+
+    // Allocates the control block and the SurfaceFrame of a std::shared_ptr together from the
+    // pool, which it keeps alive until the SurfaceFrame is destroyed.
+    template <typename T>
+    struct Allocator {
+        using value_type = T;
+
+        explicit Allocator(std::shared_ptr<SurfaceFramePool> pool) : pool(std::move(pool)) {}
+
+        template <typename U>
+        Allocator(const Allocator<U>& other) : pool(other.pool) {}
+
+        T* allocate(size_t n) { return static_cast<T*>(pool->allocate(n * sizeof(T))); }
+        void deallocate(T* block, size_t n) { pool->deallocate(block, n * sizeof(T)); }
+
+        template <typename U>
+        bool operator==(const Allocator<U>& other) const {
+            return pool == other.pool;
+        }
+        template <typename U>
+        bool operator!=(const Allocator<U>& other) const {
+            return !(*this == other);
+        }
+
+        std::shared_ptr<SurfaceFramePool> pool;
+    };
+
+private:
+    mutable std::mutex mMutex;
+    // All the free blocks are of mBlockSize, which is set by the first allocation.
+    size_t mBlockSize GUARDED_BY(mMutex) = 0;
+    std::vector<void*> mFreeBlocks GUARDED_BY(mMutex);
+};
+
 class TokenManager : public android::frametimeline::TokenManager {
 public:
     TokenManager() : mCurrentToken(FrameTimelineInfo::INVALID_VSYNC_ID + 1) {}
@@ -469,8 +527,8 @@ public:
     frametimeline::TokenManager* getTokenManager() override { return &mTokenManager; }
     std::shared_ptr<SurfaceFrame> createSurfaceFrameForToken(
             const FrameTimelineInfo& frameTimelineInfo, pid_t ownerPid, uid_t ownerUid,
-            int32_t layerId, std::string layerName, std::string debugName, bool isBuffer,
-            GameMode) override;
+            int32_t layerId, const std::string& layerName, const std::string& debugName,
+            bool isBuffer, GameMode) override;
     void addSurfaceFrame(std::shared_ptr<frametimeline::SurfaceFrame> surfaceFrame) override;
     void setSfWakeUp(int64_t token, nsecs_t wakeupTime, Fps refreshRate, Fps renderRate) override;
     void setSfPresent(nsecs_t sfPresentTime, const std::shared_ptr<FenceTime>& presentFence,
@@ -497,6 +555,39 @@ private:
     void finalizeCurrentDisplayFrame() REQUIRES(mMutex);
     void dumpAll(std::string& result);
     void dumpJank(std::string& result);
+    void dumpInputLatencies(std::string& result);
+    void clearInputLatencies();
+
+    // Histogram of latencies, bucketed like FrameStageStats.
+    struct InputLatencyHistogram {
+        std::array<uint32_t, FrameStageStats::kBucketCount> buckets{};
+        uint64_t count = 0;
+
+        void add(nsecs_t latency);
+        // Returns the upper bound of the bucket holding the percentile, or 0 without samples.
+        nsecs_t getPercentile(float percentile) const;
+    };
+
+    // The latencies of the frames of a layer which the app drew in response to input, i.e. whose
+    // FrameTimelineInfo carries an input event id. The app consumes the input at the vsync of its
+    // frame, so the latencies start at the predicted start time of the frame, and end when the
+    // present fence of the DisplayFrame which presented it signals.
+    struct InputLatencies {
+        std::string layerName;
+        // From the vsync to the acquire fence of the buffer, i.e. the app drawing the frame.
+        InputLatencyHistogram vsyncToReady;
+        // From the acquire fence to the present fence, i.e. SurfaceFlinger and the display.
+        InputLatencyHistogram readyToPresent;
+        InputLatencyHistogram vsyncToPresent;
+    };
+
+    // Records the input latencies of the SurfaceFrames which the DisplayFrame presented.
+    void recordInputLatencies(const DisplayFrame&) REQUIRES(mMutex);
+
+    // Returns the shared copy of the name, which the SurfaceFrames of a layer all point to.
+    std::shared_ptr<const std::string> internName(const std::string& name) EXCLUDES(mNamesMutex);
+    template <typename... Args>
+    std::shared_ptr<SurfaceFrame> makeSurfaceFrame(Args&&... args);
 
     // Sliding window of display frames. TODO(b/168072834): compare perf with fixed size array
     std::deque<std::shared_ptr<DisplayFrame>> mDisplayFrames GUARDED_BY(mMutex);
@@ -511,6 +602,10 @@ private:
     std::shared_ptr<TimeStats> mTimeStats;
     const pid_t mSurfaceFlingerPid;
     nsecs_t mPreviousActualPresentTime = 0;
+    // Layers beyond this many are not recorded, until the latencies are cleared.
+    static constexpr size_t kMaxInputLatencyLayers = 32;
+    std::unordered_map<int32_t, InputLatencies> mInputLatencies GUARDED_BY(mMutex);
+    uint64_t mDroppedInputLatencies GUARDED_BY(mMutex) = 0;
     nsecs_t mPreviousPredictionPresentTime = 0;
     const JankClassificationThresholds mJankClassificationThresholds;
     static constexpr uint32_t kDefaultMaxDisplayFrames = 64;
@@ -519,6 +614,17 @@ private:
     // display frame, this is a good starting size for the vector so that we can avoid the
     // internal vector resizing that happens with push_back.
     static constexpr uint32_t kNumSurfaceFramesInitial = 10;
+
+    const std::shared_ptr<SurfaceFramePool> mSurfaceFramePool =
+            std::make_shared<SurfaceFramePool>();
+
+    // Names which no SurfaceFrame points to anymore are swept once the map reaches this size.
+    static constexpr size_t kMinNamesSweepSize = 64;
+    mutable std::mutex mNamesMutex;
+    // The keys view the values.
+    std::unordered_map<std::string_view, std::shared_ptr<const std::string>> mNames
+            GUARDED_BY(mNamesMutex);
+    size_t mNamesSweepSize GUARDED_BY(mNamesMutex) = kMinNamesSweepSize;
 };
 
 } // namespace impl
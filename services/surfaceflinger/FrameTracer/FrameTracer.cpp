@@ -51,10 +51,8 @@ void FrameTracer::registerDataSource() {
 
 void FrameTracer::traceNewLayer(int32_t layerId, const std::string& layerName) {
     FrameTracerDataSource::Trace([this, layerId, &layerName](FrameTracerDataSource::TraceContext) {
-        if (mTraceTracker.find(layerId) == mTraceTracker.end()) {
-            std::lock_guard<std::mutex> lock(mTraceMutex);
-            mTraceTracker[layerId].layerName = layerName;
-        }
+        std::lock_guard<std::mutex> lock(mTraceMutex);
+        mTraceTracker.try_emplace(layerId, TraceRecord{.layerName = layerName});
     });
 }
 
@@ -64,15 +62,17 @@ void FrameTracer::traceTimestamp(int32_t layerId, uint64_t bufferID, uint64_t fr
     FrameTracerDataSource::Trace([this, layerId, bufferID, frameNumber, timestamp, type,
                                   duration](FrameTracerDataSource::TraceContext ctx) {
         std::lock_guard<std::mutex> lock(mTraceMutex);
-        if (mTraceTracker.find(layerId) == mTraceTracker.end()) {
+        const auto it = mTraceTracker.find(layerId);
+        if (it == mTraceTracker.end()) {
             return;
         }
+        TraceRecord& record = it->second;
 
         // Handle any pending fences for this buffer.
-        tracePendingFencesLocked(ctx, layerId, bufferID);
+        tracePendingFencesLocked(ctx, record, bufferID);
 
         // Complete current trace.
-        traceLocked(ctx, layerId, bufferID, frameNumber, timestamp, type, duration);
+        traceLocked(ctx, record, bufferID, frameNumber, timestamp, type, duration);
     });
 }
 
@@ -84,54 +84,71 @@ void FrameTracer::traceFence(int32_t layerId, uint64_t bufferID, uint64_t frameN
         const nsecs_t signalTime = fence->getSignalTime();
         if (signalTime != Fence::SIGNAL_TIME_INVALID) {
             std::lock_guard<std::mutex> lock(mTraceMutex);
-            if (mTraceTracker.find(layerId) == mTraceTracker.end()) {
+            const auto it = mTraceTracker.find(layerId);
+            if (it == mTraceTracker.end()) {
                 return;
             }
+            TraceRecord& record = it->second;
 
             // Handle any pending fences for this buffer.
-            tracePendingFencesLocked(ctx, layerId, bufferID);
+            tracePendingFencesLocked(ctx, record, bufferID);
 
             if (signalTime != Fence::SIGNAL_TIME_PENDING) {
-                traceSpanLocked(ctx, layerId, bufferID, frameNumber, type, startTime, signalTime);
+                traceSpanLocked(ctx, record, bufferID, frameNumber, type, startTime, signalTime);
             } else {
-                mTraceTracker[layerId].pendingFences[bufferID].push_back(
-                        {.frameNumber = frameNumber,
-                         .type = type,
-                         .fence = fence,
-                         .startTime = startTime});
+                record.pendingFences[bufferID].push_back({.frameNumber = frameNumber,
+                                                          .type = type,
+                                                          .fence = fence,
+                                                          .startTime = startTime});
+                record.pendingFenceCount++;
             }
         }
     });
 }
 
 void FrameTracer::tracePendingFencesLocked(FrameTracerDataSource::TraceContext& ctx,
-                                           int32_t layerId, uint64_t bufferID) {
-    if (mTraceTracker[layerId].pendingFences.count(bufferID)) {
-        auto& pendingFences = mTraceTracker[layerId].pendingFences[bufferID];
-        for (size_t i = 0; i < pendingFences.size(); ++i) {
-            auto& pendingFence = pendingFences[i];
-
-            nsecs_t signalTime = Fence::SIGNAL_TIME_INVALID;
-            if (pendingFence.fence && pendingFence.fence->isValid()) {
-                signalTime = pendingFence.fence->getSignalTime();
-                if (signalTime == Fence::SIGNAL_TIME_PENDING) {
-                    continue;
-                }
-            }
+                                           TraceRecord& record, uint64_t bufferID) {
+    if (record.pendingFenceCount == 0) {
+        return;
+    }
 
-            if (signalTime != Fence::SIGNAL_TIME_INVALID &&
-                systemTime() - signalTime < kFenceSignallingDeadline) {
-                traceSpanLocked(ctx, layerId, bufferID, pendingFence.frameNumber, pendingFence.type,
-                                pendingFence.startTime, signalTime);
+    const auto it = record.pendingFences.find(bufferID);
+    if (it == record.pendingFences.end()) {
+        return;
+    }
+
+    auto& pendingFences = it->second;
+    const nsecs_t now = systemTime();
+    // The fences which are still pending are moved to the front, in one pass.
+    size_t pendingCount = 0;
+    for (auto& pendingFence : pendingFences) {
+        nsecs_t signalTime = Fence::SIGNAL_TIME_INVALID;
+        if (pendingFence.fence && pendingFence.fence->isValid()) {
+            signalTime = pendingFence.fence->getSignalTime();
+            if (signalTime == Fence::SIGNAL_TIME_PENDING) {
+                if (&pendingFences[pendingCount] != &pendingFence) {
+                    pendingFences[pendingCount] = std::move(pendingFence);
+                }
+                pendingCount++;
+                continue;
             }
+        }
 
-            pendingFences.erase(pendingFences.begin() + i);
-            --i;
+        if (signalTime != Fence::SIGNAL_TIME_INVALID &&
+            now - signalTime < kFenceSignallingDeadline) {
+            traceSpanLocked(ctx, record, bufferID, pendingFence.frameNumber, pendingFence.type,
+                            pendingFence.startTime, signalTime);
         }
     }
+
+    record.pendingFenceCount -= pendingFences.size() - pendingCount;
+    pendingFences.resize(pendingCount);
+    if (pendingFences.empty()) {
+        record.pendingFences.erase(it);
+    }
 }
 
-void FrameTracer::traceLocked(FrameTracerDataSource::TraceContext& ctx, int32_t layerId,
+void FrameTracer::traceLocked(FrameTracerDataSource::TraceContext& ctx, const TraceRecord& record,
                               uint64_t bufferID, uint64_t frameNumber, nsecs_t timestamp,
                               FrameEvent::BufferEventType type, nsecs_t duration) {
     auto packet = ctx.NewTracePacket();
@@ -144,10 +161,8 @@ void FrameTracer::traceLocked(FrameTracerDataSource::TraceContext& ctx, int32_t
     }
     event->set_type(type);
 
-    if (mTraceTracker.find(layerId) != mTraceTracker.end() &&
-        !mTraceTracker[layerId].layerName.empty()) {
-        const std::string& layerName = mTraceTracker[layerId].layerName;
-        event->set_layer_name(layerName.c_str(), layerName.size());
+    if (!record.layerName.empty()) {
+        event->set_layer_name(record.layerName.c_str(), record.layerName.size());
     }
 
     if (duration > 0) {
@@ -155,17 +170,17 @@ void FrameTracer::traceLocked(FrameTracerDataSource::TraceContext& ctx, int32_t
     }
 }
 
-void FrameTracer::traceSpanLocked(FrameTracerDataSource::TraceContext& ctx, int32_t layerId,
-                                  uint64_t bufferID, uint64_t frameNumber,
-                                  FrameEvent::BufferEventType type, nsecs_t startTime,
-                                  nsecs_t endTime) {
+void FrameTracer::traceSpanLocked(FrameTracerDataSource::TraceContext& ctx,
+                                  const TraceRecord& record, uint64_t bufferID,
+                                  uint64_t frameNumber, FrameEvent::BufferEventType type,
+                                  nsecs_t startTime, nsecs_t endTime) {
     nsecs_t timestamp = endTime;
     nsecs_t duration = 0;
     if (startTime > 0 && startTime < endTime) {
         timestamp = startTime;
         duration = endTime - startTime;
     }
-    traceLocked(ctx, layerId, bufferID, frameNumber, timestamp, type, duration);
+    traceLocked(ctx, record, bufferID, frameNumber, timestamp, type, duration);
 }
 
 void FrameTracer::onDestroy(int32_t layerId) {
@@ -84,21 +84,23 @@ private:
         std::string layerName;
         using BufferID = uint64_t;
         std::unordered_map<BufferID, std::vector<PendingFence>> pendingFences;
+        // The number of fences in pendingFences, so that layers without any skip the lookup.
+        size_t pendingFenceCount = 0;
     };
 
     // Checks if any pending fences for a layer and buffer have signalled and, if they have, creates
     // trace points for them.
-    void tracePendingFencesLocked(FrameTracerDataSource::TraceContext& ctx, int32_t layerId,
+    void tracePendingFencesLocked(FrameTracerDataSource::TraceContext& ctx, TraceRecord& record,
                                   uint64_t bufferID);
     // Creates a trace point by translating a start time and an end time to a timestamp and
     // duration. If startTime is later than end time it sets end time as the timestamp and the
     // duration to 0. Used by traceFence().
-    void traceSpanLocked(FrameTracerDataSource::TraceContext& ctx, int32_t layerId,
+    void traceSpanLocked(FrameTracerDataSource::TraceContext& ctx, const TraceRecord& record,
                          uint64_t bufferID, uint64_t frameNumber, FrameEvent::BufferEventType type,
                          nsecs_t startTime, nsecs_t endTime);
-    void traceLocked(FrameTracerDataSource::TraceContext& ctx, int32_t layerId, uint64_t bufferID,
-                     uint64_t frameNumber, nsecs_t timestamp, FrameEvent::BufferEventType type,
-                     nsecs_t duration = 0);
+    void traceLocked(FrameTracerDataSource::TraceContext& ctx, const TraceRecord& record,
+                     uint64_t bufferID, uint64_t frameNumber, nsecs_t timestamp,
+                     FrameEvent::BufferEventType type, nsecs_t duration = 0);
 
     std::mutex mTraceMutex;
     std::unordered_map<int32_t, TraceRecord> mTraceTracker;
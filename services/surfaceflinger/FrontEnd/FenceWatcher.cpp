@@ -0,0 +1,149 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+#undef LOG_TAG
+#define LOG_TAG "SurfaceFlinger"
+
+#include "FenceWatcher.h"
+
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+
+#include <utils/Log.h>
+
+namespace android::surfaceflinger::frontend {
+
+FenceWatcher::FenceWatcher()
+      : FenceWatcher([](pollfd* fds, nfds_t count, int timeout) {
+            return poll(fds, count, timeout);
+        }) {}
+
+FenceWatcher::FenceWatcher(PollFunction poll) : mPoll(std::move(poll)) {
+    mWakeFd.reset(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+    LOG_ALWAYS_FATAL_IF(!mWakeFd.ok(), "Could not create eventfd: %s", strerror(errno));
+    mThread = std::thread(&FenceWatcher::run, this);
+    pthread_setname_np(mThread.native_handle(), "FenceWatcher");
+}
+
+FenceWatcher::~FenceWatcher() {
+    {
+        std::scoped_lock lock(mMutex);
+        mDone = true;
+    }
+    wake();
+    mThread.join();
+}
+
+FenceWatcher::SignaledFlag FenceWatcher::watch(const sp<Fence>& fence) {
+    if (!fence->isValid() || fence->getStatus() != Fence::Status::Unsignaled) {
+        return std::make_shared<std::atomic<bool>>(true);
+    }
+
+    Watch watch{base::unique_fd(fence->dup()), std::make_shared<std::atomic<bool>>(false)};
+    if (!watch.fd.ok()) {
+        ALOGE("Could not dup fence: %s", strerror(errno));
+        return nullptr;
+    }
+    SignaledFlag signaled = watch.signaled;
+    {
+        std::scoped_lock lock(mMutex);
+        mNewWatches.emplace_back(std::move(watch));
+    }
+    wake();
+    return signaled;
+}
+
+void FenceWatcher::wake() {
+    const uint64_t value = 1;
+    if (TEMP_FAILURE_RETRY(write(mWakeFd.get(), &value, sizeof(value))) < 0) {
+        ALOGE("Could not wake FenceWatcher: %s", strerror(errno));
+    }
+}
+
+void FenceWatcher::run() {
+    std::vector<Watch> watches;
+    std::vector<pollfd> fds;
+    std::chrono::milliseconds retryDelay = kMinPollRetryDelay;
+    while (true) {
+        {
+            std::scoped_lock lock(mMutex);
+            if (mDone) {
+                return;
+            }
+            std::move(mNewWatches.begin(), mNewWatches.end(), std::back_inserter(watches));
+            mNewWatches.clear();
+        }
+
+        // Nobody is interested in the fences of the transactions which were dropped anymore.
+        watches.erase(std::remove_if(watches.begin(), watches.end(),
+                                     [](const Watch& watch) {
+                                         return watch.signaled.use_count() == 1;
+                                     }),
+                      watches.end());
+
+        fds.clear();
+        fds.push_back({.fd = mWakeFd.get(), .events = POLLIN, .revents = 0});
+        for (const Watch& watch : watches) {
+            fds.push_back({.fd = watch.fd.get(), .events = POLLIN, .revents = 0});
+        }
+        if (mPoll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ALOGE_IF(retryDelay == kMinPollRetryDelay, "FenceWatcher poll failed: %s",
+                     strerror(errno));
+            // Errors such as ENOMEM, or EINVAL once there are too many fences, can last. Check the
+            // fences one at a time meanwhile, as Fence::getStatus does, and back off before
+            // polling them all again, rather than spinning on the error.
+            fds[0].revents = 0;
+            for (size_t i = 1; i < fds.size(); i++) {
+                if (mPoll(&fds[i], 1, 0) < 0) {
+                    fds[i].revents = 0;
+                }
+            }
+            std::this_thread::sleep_for(retryDelay);
+            retryDelay = std::min(retryDelay * 2, kMaxPollRetryDelay);
+        } else {
+            retryDelay = kMinPollRetryDelay;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            uint64_t value;
+            if (TEMP_FAILURE_RETRY(read(mWakeFd.get(), &value, sizeof(value))) < 0) {
+                ALOGE_IF(errno != EAGAIN, "Could not read eventfd: %s", strerror(errno));
+            }
+        }
+        // An error means that the fence won't signal, and Fence treats it as signaled too.
+        for (size_t i = watches.size(); i-- > 0;) {
+            if (fds[i + 1].revents == 0) {
+                continue;
+            }
+            watches[i].signaled->store(true, std::memory_order_release);
+            std::swap(watches[i], watches.back());
+            watches.pop_back();
+        }
+    }
+}
+
+} // namespace android::surfaceflinger::frontend
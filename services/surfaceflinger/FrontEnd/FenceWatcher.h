@@ -0,0 +1,84 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+#include <ui/Fence.h>
+
+#include <poll.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android::surfaceflinger::frontend {
+
+// Waits for fences on a thread of its own, so that whether a fence has signaled can be known
+// without asking the kernel again every time.
+//
+// Each watched fence gets a flag, which the watcher sets once the fence signals. The flag is
+// read without locking.
+class FenceWatcher final {
+public:
+    using SignaledFlag = std::shared_ptr<const std::atomic<bool>>;
+
+    using PollFunction = std::function<int(pollfd*, nfds_t, int)>;
+
+    FenceWatcher();
+    // For testing, polls the fences with the given function instead of poll.
+    explicit FenceWatcher(PollFunction);
+    ~FenceWatcher();
+
+    FenceWatcher(const FenceWatcher&) = delete;
+    FenceWatcher& operator=(const FenceWatcher&) = delete;
+
+    // Returns the flag of the fence, which is already set if the fence has signaled or is invalid.
+    // The fence is no longer waited for once all the copies of its flag are dropped. Returns
+    // nullptr if the fence can't be watched. Thread safe.
+    SignaledFlag watch(const sp<Fence>& fence);
+
+private:
+    struct Watch {
+        base::unique_fd fd;
+        std::shared_ptr<std::atomic<bool>> signaled;
+    };
+
+    // The bounds of the delay before polling again, after poll failed with an error which may
+    // last.
+    static constexpr std::chrono::milliseconds kMinPollRetryDelay{1};
+    static constexpr std::chrono::milliseconds kMaxPollRetryDelay{16};
+
+    void run();
+    void wake();
+
+    const PollFunction mPoll;
+
+    std::mutex mMutex;
+    bool mDone GUARDED_BY(mMutex) = false;
+    // Fences to add to those the thread polls.
+    std::vector<Watch> mNewWatches GUARDED_BY(mMutex);
+    // Wakes the thread up when there are new fences to watch, or when it is done.
+    base::unique_fd mWakeFd;
+    std::thread mThread;
+};
+
+} // namespace android::surfaceflinger::frontend
@@ -190,6 +190,97 @@ bool LayerHierarchy::hasRelZLoop(uint32_t& outInvalidRelativeRoot) const {
     return outInvalidRelativeRoot != UNASSIGNED_LAYER_ID;
 }
 
+void FlattenedLayerHierarchy::rebuild(const LayerHierarchy& root) {
+    mHierarchies.clear();
+    mPaths.clear();
+    mParents.clear();
+    mSubtreeEnds.clear();
+    mDepths.clear();
+    mZOrder.clear();
+    mZOrderSkipTo.clear();
+
+    LayerHierarchy::TraversalPath traversalPath = LayerHierarchy::TraversalPath::ROOT;
+    if (root.getLayer()) {
+        traversalPath.id = root.getLayer()->id;
+    }
+    flatten(root, traversalPath, NO_PARENT, /*depth=*/0);
+    flattenInZOrder(NO_PARENT);
+}
+
+void FlattenedLayerHierarchy::flatten(const LayerHierarchy& hierarchy,
+                                      LayerHierarchy::TraversalPath& traversalPath,
+                                      uint32_t parent, int depth) {
+    uint32_t visit = parent;
+    if (hierarchy.getLayer()) {
+        LLOG_ALWAYS_FATAL_WITH_TRACE_IF(depth > 50, "Cycle detected while flattening hierarchy");
+        visit = static_cast<uint32_t>(mHierarchies.size());
+        mHierarchies.push_back(&hierarchy);
+        mPaths.push_back(traversalPath);
+        mParents.push_back(parent);
+        mSubtreeEnds.push_back(visit + 1);
+        mDepths.push_back(depth);
+    }
+
+    LLOG_ALWAYS_FATAL_WITH_TRACE_IF(traversalPath.hasRelZLoop(), "Found relative z loop layerId:%d",
+                                    traversalPath.invalidRelativeRootId);
+    const int childDepth = hierarchy.getLayer() ? depth + 1 : depth;
+    for (auto& [child, childVariant] : hierarchy.mChildren) {
+        LayerHierarchy::ScopedAddToTraversalPath addChildToTraversalPath(traversalPath,
+                                                                         child->getLayer()->id,
+                                                                         childVariant);
+        flatten(*child, traversalPath, visit, childDepth);
+    }
+
+    if (visit != parent) {
+        mSubtreeEnds[visit] = static_cast<uint32_t>(mHierarchies.size());
+    }
+}
+
+// Mirrors LayerHierarchy::traverseInZOrder, with NO_PARENT standing for a root without a layer.
+void FlattenedLayerHierarchy::flattenInZOrder(uint32_t visit) {
+    const bool hasLayer = visit != NO_PARENT;
+    bool traverseThisLayer = hasLayer;
+    size_t position = 0;
+    auto addThisLayer = [&]() {
+        position = mZOrder.size();
+        mZOrder.push_back(visit);
+        mZOrderSkipTo.push_back(0);
+    };
+
+    const uint32_t end = hasLayer ? mSubtreeEnds[visit] : static_cast<uint32_t>(size());
+    for (uint32_t child = hasLayer ? visit + 1 : 0; child < end; child = mSubtreeEnds[child]) {
+        if (traverseThisLayer && mHierarchies[child]->getLayer()->z >= 0) {
+            traverseThisLayer = false;
+            addThisLayer();
+        }
+        if (mPaths[child].variant == LayerHierarchy::Variant::Detached) {
+            continue;
+        }
+        flattenInZOrder(child);
+    }
+
+    if (traverseThisLayer) {
+        addThisLayer();
+    }
+    if (hasLayer) {
+        // Stopping at this layer skips the children which follow it.
+        mZOrderSkipTo[position] = static_cast<uint32_t>(mZOrder.size());
+    }
+}
+
+void FlattenedLayerHierarchy::traverse(const LayerHierarchy::Visitor& visitor) const {
+    for (size_t i = 0; i < size();) {
+        i = visitor(*mHierarchies[i], mPaths[i]) ? i + 1 : mSubtreeEnds[i];
+    }
+}
+
+void FlattenedLayerHierarchy::traverseInZOrder(const LayerHierarchy::Visitor& visitor) const {
+    for (size_t i = 0; i < mZOrder.size();) {
+        const uint32_t visit = mZOrder[i];
+        i = visitor(*mHierarchies[visit], mPaths[visit]) ? i + 1 : mZOrderSkipTo[i];
+    }
+}
+
 void LayerHierarchyBuilder::init(const std::vector<std::unique_ptr<RequestedLayerState>>& layers) {
     mLayerIdToHierarchy.clear();
     mHierarchies.clear();
@@ -410,12 +501,19 @@ void LayerHierarchyBuilder::update(LayerLifecycleManager& layerLifecycleManager)
         // check if we have any remaining loops
         hasRelZLoop = mRoot.hasRelZLoop(invalidRelativeRoot);
     }
+
+    ATRACE_NAME("LayerHierarchyBuilder:flatten");
+    mFlattenedRoot.rebuild(mRoot);
 }
 
 const LayerHierarchy& LayerHierarchyBuilder::getHierarchy() const {
     return mRoot;
 }
 
+const FlattenedLayerHierarchy& LayerHierarchyBuilder::getFlattenedHierarchy() const {
+    return mFlattenedRoot;
+}
+
 const LayerHierarchy& LayerHierarchyBuilder::getOffscreenHierarchy() const {
     return mOffscreenRoot;
 }
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <limits>
+
 #include "FrontEnd/LayerCreationArgs.h"
 #include "FrontEnd/LayerLifecycleManager.h"
 #include "RequestedLayerState.h"
@@ -193,6 +195,49 @@ private:
     LayerHierarchy* mRelativeParent = nullptr;
 };
 
+// A flattened copy of a LayerHierarchy, which can be walked linearly instead of by chasing the
+// pointers to the LayerHierarchy nodes and building the traversal paths on the way.
+//
+// The visits of LayerHierarchy::traverse are stored in pre-order, as a structure of arrays indexed
+// by the position of the visit. The descendants of a visit are the ones which follow it, up to its
+// subtree end. The visits of traverseInZOrder are stored as positions into these arrays.
+class FlattenedLayerHierarchy {
+public:
+    static constexpr uint32_t NO_PARENT = std::numeric_limits<uint32_t>::max();
+
+    // Replaces the contents with the traversal of root, reusing the storage.
+    void rebuild(const LayerHierarchy& root);
+
+    size_t size() const { return mHierarchies.size(); }
+    const LayerHierarchy& getHierarchy(size_t i) const { return *mHierarchies[i]; }
+    const LayerHierarchy::TraversalPath& getPath(size_t i) const { return mPaths[i]; }
+    // The position of the parent visit, or NO_PARENT for the children of the root.
+    uint32_t getParent(size_t i) const { return mParents[i]; }
+    // One past the position of the last descendant.
+    uint32_t getSubtreeEnd(size_t i) const { return mSubtreeEnds[i]; }
+    // 0 for the children of the root.
+    int getDepth(size_t i) const { return mDepths[i]; }
+
+    // Same as the LayerHierarchy versions, on the hierarchy this was built from.
+    void traverse(const LayerHierarchy::Visitor& visitor) const;
+    void traverseInZOrder(const LayerHierarchy::Visitor& visitor) const;
+
+private:
+    void flatten(const LayerHierarchy& hierarchy, LayerHierarchy::TraversalPath& traversalPath,
+                 uint32_t parent, int depth);
+    void flattenInZOrder(uint32_t visit);
+
+    std::vector<const LayerHierarchy*> mHierarchies;
+    std::vector<LayerHierarchy::TraversalPath> mPaths;
+    std::vector<uint32_t> mParents;
+    std::vector<uint32_t> mSubtreeEnds;
+    std::vector<int> mDepths;
+
+    // The visits of traverseInZOrder, and where to continue if the visitor stops at each of them.
+    std::vector<uint32_t> mZOrder;
+    std::vector<uint32_t> mZOrderSkipTo;
+};
+
 // Given a list of RequestedLayerState, this class will build a root hierarchy and an
 // offscreen hierarchy. The builder also has an update method which can update an existing
 // hierarchy from a list of RequestedLayerState and associated change flags.
@@ -202,6 +247,8 @@ public:
     void update(LayerLifecycleManager& layerLifecycleManager);
     LayerHierarchy getPartialHierarchy(uint32_t, bool childrenOnly) const;
     const LayerHierarchy& getHierarchy() const;
+    // The flattened copy of getHierarchy(), updated with it.
+    const FlattenedLayerHierarchy& getFlattenedHierarchy() const;
     const LayerHierarchy& getOffscreenHierarchy() const;
     std::string getDebugString(uint32_t layerId, uint32_t depth = 0) const;
 
@@ -223,6 +270,7 @@ private:
     std::unordered_map<uint32_t, LayerHierarchy*> mLayerIdToHierarchy;
     std::vector<std::unique_ptr<LayerHierarchy>> mHierarchies;
     LayerHierarchy mRoot{nullptr};
+    FlattenedLayerHierarchy mFlattenedRoot;
     LayerHierarchy mOffscreenRoot{nullptr};
     bool mInitialized = false;
 };
@@ -223,8 +223,7 @@ void LayerLifecycleManager::applyTransactions(const std::vector<TransactionState
                     backgroundLayerArgs.name = layer->name + "BackgroundColorLayer";
                     backgroundLayerArgs.flags = ISurfaceComposerClient::eFXSurfaceEffect;
                     std::vector<std::unique_ptr<RequestedLayerState>> newLayers;
-                    newLayers.emplace_back(
-                            std::make_unique<RequestedLayerState>(backgroundLayerArgs));
+                    newLayers.emplace_back(mLayerPool->make(backgroundLayerArgs));
                     RequestedLayerState* backgroundLayer = newLayers.back().get();
                     backgroundLayer->bgColorLayer = true;
                     backgroundLayer->handleAlive = false;
@@ -291,6 +290,7 @@ void LayerLifecycleManager::commitChanges() {
         for (auto& listener : mListeners) {
             listener->onLayerDestroyed(*destroyedLayer);
         }
+        mLayerPool->recycle(std::move(destroyedLayer));
     }
     mDestroyedLayers.clear();
     mChangedLayers.clear();
@@ -314,6 +314,10 @@ const std::vector<std::unique_ptr<RequestedLayerState>>& LayerLifecycleManager::
     return mDestroyedLayers;
 }
 
+const std::shared_ptr<ObjectPool<RequestedLayerState>>& LayerLifecycleManager::getLayerPool() const {
+    return mLayerPool;
+}
+
 const std::vector<RequestedLayerState*>& LayerLifecycleManager::getChangedLayers() const {
     return mChangedLayers;
 }
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include "ObjectPool.h"
 #include "RequestedLayerState.h"
 #include "TransactionState.h"
 
@@ -81,6 +82,10 @@ public:
     const ftl::Flags<RequestedLayerState::Changes> getGlobalChanges() const;
     const RequestedLayerState* getLayerFromId(uint32_t) const;
     bool isLayerSecure(uint32_t) const;
+    // The RequestedLayerStates destroyed by commitChanges are recycled to this pool. Unlike the
+    // manager, the pool is thread safe, so that new layers can be made from it as they are
+    // created, before they are added.
+    const std::shared_ptr<ObjectPool<RequestedLayerState>>& getLayerPool() const;
 
 private:
     friend class LayerLifecycleManagerTest;
@@ -112,6 +117,9 @@ private:
     std::vector<std::unique_ptr<RequestedLayerState>> mLayers;
     // Layers pending destruction. Layers will be destroyed once changes are committed.
     std::vector<std::unique_ptr<RequestedLayerState>> mDestroyedLayers;
+    static constexpr size_t kRecycledLayers = 32;
+    std::shared_ptr<ObjectPool<RequestedLayerState>> mLayerPool =
+            std::make_shared<ObjectPool<RequestedLayerState>>(kRecycledLayers);
     // Keeps track of all the layers that were added in order. Changes will be cleared once
     // committed.
     std::vector<RequestedLayerState*> mAddedLayers;
@@ -436,6 +436,7 @@ void LayerSnapshot::merge(const RequestedLayerState& requested, bool forceUpdate
             inputInfo.ownerPid = requested.ownerPid;
         }
         inputInfo.id = static_cast<int32_t>(uniqueSequence);
+        inputInfoChanged = true;
         touchCropId = requested.touchCropId;
     }
 
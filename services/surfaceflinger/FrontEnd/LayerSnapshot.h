@@ -79,6 +79,9 @@ struct LayerSnapshot : public compositionengine::LayerFECompositionState {
     bool hasReadyFrame; // used in post composition to check if there is another frame ready
     ui::Transform localTransformInverse;
     gui::WindowInfo inputInfo;
+    // Whether inputInfo may have changed in the last LayerSnapshotBuilder update, unless the change
+    // was already taken by LayerSnapshotBuilder::takeChangedInputWindowIds.
+    bool inputInfoChanged = true;
     ui::Transform localTransform;
     gui::DropInputMode dropInputMode;
     bool isTrustedOverlay;
@@ -270,7 +270,12 @@ void updateVisibility(LayerSnapshot& snapshot, bool visible) {
     // anything.
     const bool visibleForInput =
             snapshot.hasInputInfo() ? snapshot.canReceiveInput() : snapshot.isVisible;
-    snapshot.inputInfo.setInputConfig(gui::WindowInfo::InputConfig::NOT_VISIBLE, !visibleForInput);
+    if (snapshot.inputInfo.inputConfig.test(gui::WindowInfo::InputConfig::NOT_VISIBLE) ==
+        visibleForInput) {
+        snapshot.inputInfo.setInputConfig(gui::WindowInfo::InputConfig::NOT_VISIBLE,
+                                          !visibleForInput);
+        snapshot.inputInfoChanged = true;
+    }
     LLOGV(snapshot.sequence, "updating visibility %s %s", visible ? "true" : "false",
           snapshot.getDebugString().c_str());
 }
@@ -316,6 +321,7 @@ void updateMetadata(LayerSnapshot& snapshot, const RequestedLayerState& requeste
 void clearChanges(LayerSnapshot& snapshot) {
     snapshot.changes.clear();
     snapshot.clientChanges = 0;
+    snapshot.inputInfoChanged = false;
     snapshot.contentDirty = false;
     snapshot.hasReadyFrame = false;
     snapshot.sidebandStreamHasFrame = false;
@@ -333,6 +339,76 @@ uint32_t getPrimaryDisplayRotationFlags(
     return 0;
 }
 
+// The workers of a parallel update, besides the main thread. Snapshot updates are short, so more
+// threads would mostly add wake up latency.
+constexpr size_t kParallelUpdateWorkers = 3;
+// Large subtrees are split until there are about this many subtrees per thread, so that the
+// threads which got smaller ones can take more.
+constexpr size_t kParallelSubtreesPerThread = 4;
+// Only layers this close to the root are split, so that the cost of splitting stays small.
+constexpr int kMaxSplitDepth = 2;
+
+// Returns the number of layers in the subtree, and records the sizes of the subtrees which may be
+// split.
+size_t countLayers(const LayerHierarchy& hierarchy, int depth,
+                   std::unordered_map<const LayerHierarchy*, size_t>& subtreeSizes) {
+    LLOG_ALWAYS_FATAL_WITH_TRACE_IF(depth > 50,
+                                    "Cycle detected in LayerSnapshotBuilder. See "
+                                    "builder_stack_overflow_transactions.winscope");
+    size_t count = 1;
+    for (auto& [childHierarchy, variant] : hierarchy.mChildren) {
+        count += countLayers(*childHierarchy, depth + 1, subtreeSizes);
+    }
+    if (depth < kMaxSplitDepth) {
+        subtreeSizes[&hierarchy] = count;
+    }
+    return count;
+}
+
+void forEachChildPath(const LayerHierarchy& hierarchy, LayerHierarchy::TraversalPath& traversalPath,
+                      const std::function<void(const LayerHierarchy::TraversalPath&)>& visitor) {
+    for (auto& [childHierarchy, variant] : hierarchy.mChildren) {
+        LayerHierarchy::ScopedAddToTraversalPath addChildToPath(traversalPath,
+                                                                childHierarchy->getLayer()->id,
+                                                                variant);
+        visitor(traversalPath);
+        forEachChildPath(*childHierarchy, traversalPath, visitor);
+    }
+}
+
+// The sequential traversal merges the frame rate of each child into the snapshot right after
+// updating the child, and the next children inherit the FrameRate change this may add. So the
+// children may only be updated in parallel, and merged afterwards, if the merges can't change the
+// snapshot.
+bool canMergeFrameRatesAfterChildren(const LayerSnapshot& snapshot) {
+    return snapshot.frameRate.isValid() ||
+            snapshot.changes.test(RequestedLayerState::Changes::FrameRate);
+}
+
+// The changes of a snapshot which its children inherit when they are updated.
+constexpr ftl::Flags<RequestedLayerState::Changes> kChangesInheritedByChildren =
+        RequestedLayerState::Changes::Hierarchy | RequestedLayerState::Changes::Geometry |
+        RequestedLayerState::Changes::Visibility | RequestedLayerState::Changes::Metadata |
+        RequestedLayerState::Changes::AffectsChildren | RequestedLayerState::Changes::Input |
+        RequestedLayerState::Changes::FrameRate | RequestedLayerState::Changes::GameMode;
+
+bool passesChangesToChildren(const LayerSnapshot& snapshot) {
+    return snapshot.changes.any(kChangesInheritedByChildren) ||
+            (snapshot.clientChanges & layer_state_t::AFFECTS_CHILDREN) != 0;
+}
+
+// Without hierarchy, display or forced changes, the snapshots of the subtrees in which no layer
+// changed would be updated to what they already are, so they may be skipped. Their reachability
+// can't change either. Parallel updates still visit every layer.
+bool canSkipUnchangedSubtrees(const LayerSnapshotBuilder::Args& args) {
+    return args.forceUpdate == LayerSnapshotBuilder::ForceUpdateFlags::NONE &&
+            !args.displayChanges && !args.root.getLayer() && args.flattenedRoot &&
+            args.parallelUpdateMinLayers == 0 &&
+            !args.layerLifecycleManager.getGlobalChanges().test(
+                    RequestedLayerState::Changes::Hierarchy) &&
+            args.layerLifecycleManager.getDestroyedLayers().empty();
+}
+
 } // namespace
 
 LayerSnapshot LayerSnapshotBuilder::getRootSnapshot() {
@@ -433,25 +509,35 @@ void LayerSnapshotBuilder::updateSnapshots(const Args& args) {
         rootSnapshot.clientChanges |= layer_state_t::eReparent;
     }
 
-    for (auto& snapshot : mSnapshots) {
-        if (snapshot->reachablilty == LayerSnapshot::Reachablilty::Reachable) {
-            snapshot->reachablilty = LayerSnapshot::Reachablilty::Unreachable;
+    const bool skipUnchangedSubtrees = canSkipUnchangedSubtrees(args);
+    if (!skipUnchangedSubtrees) {
+        for (auto& snapshot : mSnapshots) {
+            if (snapshot->reachablilty == LayerSnapshot::Reachablilty::Reachable) {
+                snapshot->reachablilty = LayerSnapshot::Reachablilty::Unreachable;
+            }
         }
     }
 
     LayerHierarchy::TraversalPath root = LayerHierarchy::TraversalPath::ROOT;
-    if (args.root.getLayer()) {
+    if (skipUnchangedSubtrees) {
+        updateSnapshotsInFlattenedHierarchy(args, rootSnapshot, /*skipUnchangedSubtrees=*/true);
+    } else if (args.root.getLayer()) {
         // The hierarchy can have a root layer when used for screenshots otherwise, it will have
         // multiple children.
         LayerHierarchy::ScopedAddToTraversalPath addChildToPath(root, args.root.getLayer()->id,
                                                                 LayerHierarchy::Variant::Attached);
         updateSnapshotsInHierarchy(args, args.root, root, rootSnapshot, /*depth=*/0);
-    } else {
-        for (auto& [childHierarchy, variant] : args.root.mChildren) {
-            LayerHierarchy::ScopedAddToTraversalPath addChildToPath(root,
-                                                                    childHierarchy->getLayer()->id,
-                                                                    variant);
-            updateSnapshotsInHierarchy(args, *childHierarchy, root, rootSnapshot, /*depth=*/0);
+    } else if (!updateSnapshotsInParallel(args, rootSnapshot)) {
+        if (args.flattenedRoot) {
+            updateSnapshotsInFlattenedHierarchy(args, rootSnapshot,
+                                                /*skipUnchangedSubtrees=*/false);
+        } else {
+            for (auto& [childHierarchy, variant] : args.root.mChildren) {
+                LayerHierarchy::ScopedAddToTraversalPath
+                        addChildToPath(root, childHierarchy->getLayer()->id, variant);
+                updateSnapshotsInHierarchy(args, *childHierarchy, root, rootSnapshot,
+                                           /*depth=*/0);
+            }
         }
     }
 
@@ -488,25 +574,21 @@ void LayerSnapshotBuilder::updateSnapshots(const Args& args) {
             continue;
         }
 
-        mPathToSnapshot.erase(traversalPath);
-
-        auto range = mIdToSnapshots.equal_range(traversalPath.id);
-        auto matchingSnapshot =
-                std::find_if(range.first, range.second, [&traversalPath](auto& snapshotWithId) {
-                    return snapshotWithId.second->path == traversalPath;
-                });
-        mIdToSnapshots.erase(matchingSnapshot);
-        mNeedsTouchableRegionCrop.erase(traversalPath);
-        mSnapshots.back()->globalZ = it->get()->globalZ;
-        std::iter_swap(it, mSnapshots.end() - 1);
-        mSnapshots.erase(mSnapshots.end() - 1);
+        destroySnapshot(it);
     }
 }
 
 void LayerSnapshotBuilder::update(const Args& args) {
     for (auto& snapshot : mSnapshots) {
+        if (snapshot->inputInfoChanged && mChangedInputWindowIds) {
+            mChangedInputWindowIds->insert(snapshot->inputInfo.id);
+        }
         clearChanges(*snapshot);
     }
+    // Keeping more ids than there are windows saves nothing, e.g. when nobody takes them.
+    if (mChangedInputWindowIds && mChangedInputWindowIds->size() > mSnapshots.size()) {
+        mChangedInputWindowIds.reset();
+    }
 
     if (tryFastUpdate(args)) {
         return;
@@ -514,20 +596,295 @@ void LayerSnapshotBuilder::update(const Args& args) {
     updateSnapshots(args);
 }
 
+std::optional<std::unordered_set<int32_t>> LayerSnapshotBuilder::takeChangedInputWindowIds() {
+    std::optional<std::unordered_set<int32_t>> changedIds = std::move(mChangedInputWindowIds);
+    mChangedInputWindowIds = std::unordered_set<int32_t>{};
+    if (!changedIds) {
+        return std::nullopt;
+    }
+    // The changes of the last update are only recorded by the next one.
+    for (auto& snapshot : mSnapshots) {
+        if (snapshot->inputInfoChanged) {
+            changedIds->insert(snapshot->inputInfo.id);
+            snapshot->inputInfoChanged = false;
+        }
+    }
+    return changedIds;
+}
+
+// Updates the display roots, and the other large subtrees close to the root, on multiple threads.
+//
+// The subtrees must not share any snapshot, or one which the others read. The layers close to the
+// root which they have in common are updated first on the calling thread, and the subtrees which
+// share snapshots, e.g. because of relative layers, are updated together by the same thread, in
+// order. The changes subtrees make to the builder, such as new snapshots, are applied in the order
+// of the sequential traversal afterwards, so that the result does not depend on the scheduling of
+// the threads.
+bool LayerSnapshotBuilder::updateSnapshotsInParallel(const Args& args,
+                                                     const LayerSnapshot& rootSnapshot) {
+    if (args.parallelUpdateMinLayers == 0) {
+        return false;
+    }
+
+    std::unordered_map<const LayerHierarchy*, size_t> subtreeSizes;
+    size_t layerCount = 0;
+    for (auto& [childHierarchy, variant] : args.root.mChildren) {
+        layerCount += countLayers(*childHierarchy, /*depth=*/0, subtreeSizes);
+    }
+    if (layerCount < args.parallelUpdateMinLayers) {
+        return false;
+    }
+
+    ATRACE_NAME("UpdateSnapshotsInParallel");
+    if (!mWorkerPool) {
+        mWorkerPool = std::make_unique<WorkerPool>(kParallelUpdateWorkers);
+    }
+    const size_t minSplitSize =
+            layerCount / (mWorkerPool->getThreadCount() * kParallelSubtreesPerThread);
+
+    std::vector<ParallelSubtree> subtrees;
+    SnapshotsByPath splitSnapshotsByPath;
+    LayerHierarchy::TraversalPath root = LayerHierarchy::TraversalPath::ROOT;
+    splitSubtrees(args, args.root, root, rootSnapshot, /*depth=*/0, /*parentSubtree=*/std::nullopt,
+                  subtreeSizes, minSplitSize, subtrees, splitSnapshotsByPath);
+
+    const SubtreeGroups groups = groupDependentSubtrees(subtrees);
+    std::vector<SnapshotsByPath> groupSnapshotsByPath(groups.size());
+    for (size_t i = 0; i < groups.size(); i++) {
+        for (size_t subtreeIndex : groups[i]) {
+            subtrees[subtreeIndex].update.newSnapshotsByPath = &groupSnapshotsByPath[i];
+        }
+    }
+
+    mWorkerPool->parallelFor(groups.size(), [&](size_t i) {
+        for (size_t subtreeIndex : groups[i]) {
+            ParallelSubtree& subtree = subtrees[subtreeIndex];
+            if (subtree.kind == ParallelSubtree::Kind::Subtree) {
+                subtree.snapshot = &updateLayerSnapshot(args, *subtree.hierarchy, subtree.path,
+                                                        *subtree.parentSnapshot, subtree.depth,
+                                                        &subtree.update);
+            }
+            updateChildSnapshots(args, *subtree.hierarchy, subtree.path, *subtree.snapshot,
+                                 subtree.depth, &subtree.update);
+        }
+    });
+
+    for (ParallelSubtree& subtree : subtrees) {
+        applySubtreeUpdate(subtree.update);
+    }
+    // Children first, so that the split layers have their final frame rate when they are merged
+    // into their parent.
+    for (auto it = subtrees.rbegin(); it != subtrees.rend(); it++) {
+        for (size_t child : it->children) {
+            updateFrameRateFromChildSnapshot(*it->snapshot, *subtrees[child].snapshot, args);
+        }
+    }
+    return true;
+}
+
+void LayerSnapshotBuilder::splitSubtrees(
+        const Args& args, const LayerHierarchy& hierarchy,
+        LayerHierarchy::TraversalPath& traversalPath, const LayerSnapshot& snapshot, int depth,
+        std::optional<size_t> parentSubtree,
+        const std::unordered_map<const LayerHierarchy*, size_t>& subtreeSizes, size_t minSplitSize,
+        std::vector<ParallelSubtree>& subtrees, SnapshotsByPath& newSnapshotsByPath) {
+    for (auto& [childHierarchy, variant] : hierarchy.mChildren) {
+        LayerHierarchy::ScopedAddToTraversalPath addChildToPath(traversalPath,
+                                                                childHierarchy->getLayer()->id,
+                                                                variant);
+        const size_t index = subtrees.size();
+        if (parentSubtree) {
+            subtrees[*parentSubtree].children.push_back(index);
+        }
+        ParallelSubtree& subtree = subtrees.emplace_back();
+        subtree.hierarchy = childHierarchy;
+        subtree.path = traversalPath;
+        subtree.parentSnapshot = &snapshot;
+        subtree.depth = depth;
+
+        // Only attached layers are split, since relative and mirrored layers share, or read, the
+        // snapshots of other subtrees.
+        const auto size = subtreeSizes.find(childHierarchy);
+        if (variant != LayerHierarchy::Variant::Attached || childHierarchy->mChildren.empty() ||
+            size == subtreeSizes.end() || size->second <= minSplitSize) {
+            continue;
+        }
+
+        subtree.update.newSnapshotsByPath = &newSnapshotsByPath;
+        subtree.snapshot = &updateLayerSnapshot(args, *childHierarchy, traversalPath, snapshot,
+                                                depth, &subtree.update);
+        if (!canMergeFrameRatesAfterChildren(*subtree.snapshot)) {
+            subtree.kind = ParallelSubtree::Kind::Children;
+            continue;
+        }
+        subtree.kind = ParallelSubtree::Kind::Split;
+        LayerSnapshot& childSnapshot = *subtree.snapshot;
+        splitSubtrees(args, *childHierarchy, traversalPath, childSnapshot, depth + 1, index,
+                      subtreeSizes, minSplitSize, subtrees, newSnapshotsByPath);
+    }
+}
+
+LayerSnapshotBuilder::SubtreeGroups LayerSnapshotBuilder::groupDependentSubtrees(
+        const std::vector<ParallelSubtree>& subtrees) {
+    // Union-find of the subtrees, where each set is represented by its first subtree.
+    std::vector<size_t> firstSubtree(subtrees.size());
+    std::iota(firstSubtree.begin(), firstSubtree.end(), 0);
+    auto find = [&firstSubtree](size_t i) {
+        while (firstSubtree[i] != i) {
+            firstSubtree[i] = firstSubtree[firstSubtree[i]];
+            i = firstSubtree[i];
+        }
+        return i;
+    };
+
+    // A relative layer is visited by the subtrees of both its parent and its relative parent, and
+    // these visits update the same snapshots.
+    std::unordered_map<LayerHierarchy::TraversalPath, size_t, LayerHierarchy::TraversalPathHash>
+            visitingSubtree;
+    for (size_t i = 0; i < subtrees.size(); i++) {
+        const ParallelSubtree& subtree = subtrees[i];
+        if (subtree.kind == ParallelSubtree::Kind::Split) {
+            continue;
+        }
+        auto visit = [&](const LayerHierarchy::TraversalPath& path) {
+            auto [it, inserted] = visitingSubtree.try_emplace(path, i);
+            if (!inserted) {
+                const size_t a = find(it->second);
+                const size_t b = find(i);
+                firstSubtree[std::max(a, b)] = std::min(a, b);
+            }
+        };
+        LayerHierarchy::TraversalPath path = subtree.path;
+        if (subtree.kind == ParallelSubtree::Kind::Subtree) {
+            visit(path);
+        }
+        forEachChildPath(*subtree.hierarchy, path, visit);
+    }
+
+    SubtreeGroups groups;
+    std::unordered_map<size_t, size_t> groupIndex;
+    for (size_t i = 0; i < subtrees.size(); i++) {
+        if (subtrees[i].kind == ParallelSubtree::Kind::Split) {
+            continue;
+        }
+        auto [it, inserted] = groupIndex.try_emplace(find(i), groups.size());
+        if (inserted) {
+            groups.emplace_back();
+        }
+        groups[it->second].push_back(i);
+    }
+    return groups;
+}
+
+void LayerSnapshotBuilder::applySubtreeUpdate(SubtreeUpdate& subtreeUpdate) {
+    for (auto& snapshot : subtreeUpdate.newSnapshots) {
+        if (snapshot->path.isClone()) {
+            // Number the clones in the order of the sequential traversal, rather than in the order
+            // in which the threads happened to create them.
+            snapshot->uniqueSequence = LayerCreationArgs::getInternalLayerId(
+                    LayerCreationArgs::sInternalSequence++);
+            snapshot->inputInfo.id = static_cast<int32_t>(snapshot->uniqueSequence);
+        }
+        addSnapshot(std::move(snapshot));
+    }
+    mNeedsTouchableRegionCrop.insert(subtreeUpdate.needsTouchableRegionCrop.begin(),
+                                     subtreeUpdate.needsTouchableRegionCrop.end());
+    mResortSnapshots |= subtreeUpdate.resortSnapshots;
+}
+
+// Same as updating each child of the root with updateSnapshotsInHierarchy, in a single pass over
+// the flattened hierarchy. The frame rate of each visit is merged into its parent once the visits
+// of its descendants are done, as the recursion would.
+//
+// If skipUnchangedSubtrees is set, see canSkipUnchangedSubtrees, the subtrees in which no layer
+// changed are not visited, unless their parent passes changes down to them. The snapshots which are
+// also visited through a relative parent always are, since the other visit may change them.
+void LayerSnapshotBuilder::updateSnapshotsInFlattenedHierarchy(const Args& args,
+                                                               const LayerSnapshot& rootSnapshot,
+                                                               bool skipUnchangedSubtrees) {
+    const FlattenedLayerHierarchy& hierarchy = *args.flattenedRoot;
+    mFlattenedSnapshots.resize(hierarchy.size());
+    mOpenVisits.clear();
+
+    if (skipUnchangedSubtrees) {
+        // The children of a visit come after it, so a single pass backwards marks all the
+        // ancestors of the changed visits.
+        mChangedSubtrees.assign(hierarchy.size(), false);
+        for (size_t i = hierarchy.size(); i-- > 0;) {
+            const RequestedLayerState* layer = hierarchy.getHierarchy(i).getLayer();
+            const LayerHierarchy::TraversalPath& path = hierarchy.getPath(i);
+            const bool changed = mChangedSubtrees[i] || layer->changes.get() != 0 ||
+                    layer->what != 0 || path.isRelative() || !path.isAttached();
+            const uint32_t parent = hierarchy.getParent(i);
+            if (changed && parent != FlattenedLayerHierarchy::NO_PARENT) {
+                mChangedSubtrees[parent] = true;
+            }
+            mChangedSubtrees[i] = changed;
+        }
+    }
+
+    auto closeVisitsBefore = [&](size_t end) {
+        while (!mOpenVisits.empty() && hierarchy.getSubtreeEnd(mOpenVisits.back()) <= end) {
+            const uint32_t visit = mOpenVisits.back();
+            mOpenVisits.pop_back();
+            const uint32_t parent = hierarchy.getParent(visit);
+            if (parent != FlattenedLayerHierarchy::NO_PARENT) {
+                updateFrameRateFromChildSnapshot(*mFlattenedSnapshots[parent],
+                                                 *mFlattenedSnapshots[visit], args);
+            }
+        }
+    };
+
+    for (size_t i = 0; i < hierarchy.size(); i++) {
+        closeVisitsBefore(i);
+        const uint32_t parent = hierarchy.getParent(i);
+        const LayerSnapshot& parentSnapshot =
+                parent == FlattenedLayerHierarchy::NO_PARENT ? rootSnapshot
+                                                             : *mFlattenedSnapshots[parent];
+        if (skipUnchangedSubtrees && !mChangedSubtrees[i] &&
+            !passesChangesToChildren(parentSnapshot)) {
+            i = hierarchy.getSubtreeEnd(i) - 1;
+            continue;
+        }
+        mFlattenedSnapshots[i] =
+                &updateLayerSnapshot(args, hierarchy.getHierarchy(i), hierarchy.getPath(i),
+                                     parentSnapshot, hierarchy.getDepth(i),
+                                     /*subtreeUpdate=*/nullptr);
+        mOpenVisits.push_back(static_cast<uint32_t>(i));
+    }
+    closeVisitsBefore(hierarchy.size());
+}
+
 const LayerSnapshot& LayerSnapshotBuilder::updateSnapshotsInHierarchy(
         const Args& args, const LayerHierarchy& hierarchy,
         LayerHierarchy::TraversalPath& traversalPath, const LayerSnapshot& parentSnapshot,
-        int depth) {
+        int depth, SubtreeUpdate* subtreeUpdate) {
+    LayerSnapshot& snapshot = updateLayerSnapshot(args, hierarchy, traversalPath, parentSnapshot,
+                                                  depth, subtreeUpdate);
+    updateChildSnapshots(args, hierarchy, traversalPath, snapshot, depth, subtreeUpdate);
+    return snapshot;
+}
+
+LayerSnapshot& LayerSnapshotBuilder::updateLayerSnapshot(
+        const Args& args, const LayerHierarchy& hierarchy,
+        const LayerHierarchy::TraversalPath& traversalPath, const LayerSnapshot& parentSnapshot,
+        int depth, SubtreeUpdate* subtreeUpdate) {
     LLOG_ALWAYS_FATAL_WITH_TRACE_IF(depth > 50,
                                     "Cycle detected in LayerSnapshotBuilder. See "
                                     "builder_stack_overflow_transactions.winscope");
 
     const RequestedLayerState* layer = hierarchy.getLayer();
     LayerSnapshot* snapshot = getSnapshot(traversalPath);
+    if (!snapshot && subtreeUpdate) {
+        auto it = subtreeUpdate->newSnapshotsByPath->find(traversalPath);
+        if (it != subtreeUpdate->newSnapshotsByPath->end()) {
+            snapshot = it->second;
+        }
+    }
     const bool newSnapshot = snapshot == nullptr;
     uint32_t primaryDisplayRotationFlags = getPrimaryDisplayRotationFlags(args.displays);
     if (newSnapshot) {
-        snapshot = createSnapshot(traversalPath, *layer, parentSnapshot);
+        snapshot = createSnapshot(traversalPath, *layer, parentSnapshot, subtreeUpdate);
         snapshot->merge(*layer, /*forceUpdate=*/true, /*displayChanges=*/true, args.forceFullDamage,
                         primaryDisplayRotationFlags);
         snapshot->changes |= RequestedLayerState::Changes::Created;
@@ -540,20 +897,24 @@ const LayerSnapshot& LayerSnapshotBuilder::updateSnapshotsInHierarchy(
         if (traversalPath.isAttached()) {
             resetRelativeState(*snapshot);
         }
-        updateSnapshot(*snapshot, args, *layer, parentSnapshot, traversalPath);
+        updateSnapshot(*snapshot, args, *layer, parentSnapshot, traversalPath, subtreeUpdate);
     }
+    return *snapshot;
+}
 
+void LayerSnapshotBuilder::updateChildSnapshots(const Args& args, const LayerHierarchy& hierarchy,
+                                                LayerHierarchy::TraversalPath& traversalPath,
+                                                LayerSnapshot& snapshot, int depth,
+                                                SubtreeUpdate* subtreeUpdate) {
     for (auto& [childHierarchy, variant] : hierarchy.mChildren) {
         LayerHierarchy::ScopedAddToTraversalPath addChildToPath(traversalPath,
                                                                 childHierarchy->getLayer()->id,
                                                                 variant);
         const LayerSnapshot& childSnapshot =
-                updateSnapshotsInHierarchy(args, *childHierarchy, traversalPath, *snapshot,
-                                           depth + 1);
-        updateFrameRateFromChildSnapshot(*snapshot, childSnapshot, args);
+                updateSnapshotsInHierarchy(args, *childHierarchy, traversalPath, snapshot,
+                                           depth + 1, subtreeUpdate);
+        updateFrameRateFromChildSnapshot(snapshot, childSnapshot, args);
     }
-
-    return *snapshot;
 }
 
 LayerSnapshot* LayerSnapshotBuilder::getSnapshot(uint32_t layerId) const {
@@ -571,17 +932,72 @@ LayerSnapshot* LayerSnapshotBuilder::getSnapshot(const LayerHierarchy::Traversal
 
 LayerSnapshot* LayerSnapshotBuilder::createSnapshot(const LayerHierarchy::TraversalPath& path,
                                                     const RequestedLayerState& layer,
-                                                    const LayerSnapshot& parentSnapshot) {
-    mSnapshots.emplace_back(std::make_unique<LayerSnapshot>(layer, path));
-    LayerSnapshot* snapshot = mSnapshots.back().get();
-    snapshot->globalZ = static_cast<size_t>(mSnapshots.size()) - 1;
+                                                    const LayerSnapshot& parentSnapshot,
+                                                    SubtreeUpdate* subtreeUpdate) {
+    auto snapshot = mSnapshotPool.make(layer, path);
     if (path.isClone() && path.variant != LayerHierarchy::Variant::Mirror) {
         snapshot->mirrorRootPath = parentSnapshot.mirrorRootPath;
     }
-    mPathToSnapshot[path] = snapshot;
+    LayerSnapshot* result = snapshot.get();
+    if (subtreeUpdate) {
+        (*subtreeUpdate->newSnapshotsByPath)[path] = result;
+        subtreeUpdate->newSnapshots.emplace_back(std::move(snapshot));
+    } else {
+        addSnapshot(std::move(snapshot));
+    }
+    return result;
+}
 
-    mIdToSnapshots.emplace(path.id, snapshot);
-    return snapshot;
+void LayerSnapshotBuilder::addSnapshot(std::unique_ptr<LayerSnapshot> snapshot) {
+    snapshot->globalZ = mSnapshots.size();
+    if (mRecycledPathNodes.empty()) {
+        mPathToSnapshot[snapshot->path] = snapshot.get();
+    } else {
+        auto node = std::move(mRecycledPathNodes.back());
+        mRecycledPathNodes.pop_back();
+        node.key() = snapshot->path;
+        node.mapped() = snapshot.get();
+        auto result = mPathToSnapshot.insert(std::move(node));
+        if (!result.inserted) {
+            result.position->second = snapshot.get();
+            mRecycledPathNodes.emplace_back(std::move(result.node));
+        }
+    }
+    if (mRecycledIdNodes.empty()) {
+        mIdToSnapshots.emplace(snapshot->path.id, snapshot.get());
+    } else {
+        auto node = std::move(mRecycledIdNodes.back());
+        mRecycledIdNodes.pop_back();
+        node.key() = snapshot->path.id;
+        node.mapped() = snapshot.get();
+        mIdToSnapshots.insert(std::move(node));
+    }
+    mSnapshots.emplace_back(std::move(snapshot));
+}
+
+// Destroys the snapshot at it, and moves the last snapshot in its place, along with its globalZ.
+void LayerSnapshotBuilder::destroySnapshot(
+        std::vector<std::unique_ptr<LayerSnapshot>>::iterator it) {
+    const LayerHierarchy::TraversalPath& traversalPath = it->get()->path;
+    if (auto node = mPathToSnapshot.extract(traversalPath);
+        node && mRecycledPathNodes.size() < kRecycledSnapshots) {
+        mRecycledPathNodes.emplace_back(std::move(node));
+    }
+
+    auto range = mIdToSnapshots.equal_range(traversalPath.id);
+    auto matchingSnapshot =
+            std::find_if(range.first, range.second, [&traversalPath](auto& snapshotWithId) {
+                return snapshotWithId.second->path == traversalPath;
+            });
+    if (auto node = mIdToSnapshots.extract(matchingSnapshot);
+        mRecycledIdNodes.size() < kRecycledSnapshots) {
+        mRecycledIdNodes.emplace_back(std::move(node));
+    }
+    mNeedsTouchableRegionCrop.erase(traversalPath);
+    mSnapshots.back()->globalZ = it->get()->globalZ;
+    std::iter_swap(it, mSnapshots.end() - 1);
+    mSnapshotPool.recycle(std::move(mSnapshots.back()));
+    mSnapshots.pop_back();
 }
 
 bool LayerSnapshotBuilder::sortSnapshotsByZ(const Args& args) {
@@ -596,7 +1012,7 @@ bool LayerSnapshotBuilder::sortSnapshotsByZ(const Args& args) {
     mResortSnapshots = false;
 
     size_t globalZ = 0;
-    args.root.traverseInZOrder(
+    const LayerHierarchy::Visitor visitor =
             [this, &globalZ](const LayerHierarchy&,
                              const LayerHierarchy::TraversalPath& traversalPath) -> bool {
                 LayerSnapshot* snapshot = getSnapshot(traversalPath);
@@ -619,7 +1035,12 @@ bool LayerSnapshotBuilder::sortSnapshotsByZ(const Args& args) {
                                    mSnapshots.begin() + static_cast<ssize_t>(newZ));
                 }
                 return true;
-            });
+            };
+    if (args.flattenedRoot) {
+        args.flattenedRoot->traverseInZOrder(visitor);
+    } else {
+        args.root.traverseInZOrder(visitor);
+    }
     mNumInterestingSnapshots = (int)globalZ;
     bool hasUnreachableSnapshots = false;
     while (globalZ < mSnapshots.size()) {
@@ -703,13 +1124,11 @@ void LayerSnapshotBuilder::resetRelativeState(LayerSnapshot& snapshot) {
 void LayerSnapshotBuilder::updateSnapshot(LayerSnapshot& snapshot, const Args& args,
                                           const RequestedLayerState& requested,
                                           const LayerSnapshot& parentSnapshot,
-                                          const LayerHierarchy::TraversalPath& path) {
+                                          const LayerHierarchy::TraversalPath& path,
+                                          SubtreeUpdate* subtreeUpdate) {
     // Always update flags and visibility
-    ftl::Flags<RequestedLayerState::Changes> parentChanges = parentSnapshot.changes &
-            (RequestedLayerState::Changes::Hierarchy | RequestedLayerState::Changes::Geometry |
-             RequestedLayerState::Changes::Visibility | RequestedLayerState::Changes::Metadata |
-             RequestedLayerState::Changes::AffectsChildren | RequestedLayerState::Changes::Input |
-             RequestedLayerState::Changes::FrameRate | RequestedLayerState::Changes::GameMode);
+    ftl::Flags<RequestedLayerState::Changes> parentChanges =
+            parentSnapshot.changes & kChangesInheritedByChildren;
     snapshot.changes |= parentChanges;
     if (args.displayChanges) snapshot.changes |= RequestedLayerState::Changes::Geometry;
     snapshot.reachablilty = LayerSnapshot::Reachablilty::Reachable;
@@ -741,7 +1160,7 @@ void LayerSnapshotBuilder::updateSnapshot(LayerSnapshot& snapshot, const Args& a
             snapshot.changes.any(RequestedLayerState::Changes::Geometry |
                                  RequestedLayerState::Changes::BufferSize |
                                  RequestedLayerState::Changes::Input)) {
-            updateInput(snapshot, requested, parentSnapshot, path, args);
+            updateInput(snapshot, requested, parentSnapshot, path, args, subtreeUpdate);
         }
         return;
     }
@@ -757,6 +1176,7 @@ void LayerSnapshotBuilder::updateSnapshot(LayerSnapshot& snapshot, const Args& a
         snapshot.color.a = parentSnapshot.color.a * requested.color.a;
         snapshot.alpha = snapshot.color.a;
         snapshot.inputInfo.alpha = snapshot.color.a;
+        snapshot.inputInfoChanged = true;
     }
 
     if (forceUpdate || snapshot.clientChanges & layer_state_t::eFlagsChanged) {
@@ -864,7 +1284,8 @@ void LayerSnapshotBuilder::updateSnapshot(LayerSnapshot& snapshot, const Args& a
 
     if (forceUpdate || snapshot.changes.any(RequestedLayerState::Changes::Geometry)) {
         uint32_t primaryDisplayRotationFlags = getPrimaryDisplayRotationFlags(args.displays);
-        updateLayerBounds(snapshot, requested, parentSnapshot, primaryDisplayRotationFlags);
+        updateLayerBounds(snapshot, requested, parentSnapshot, primaryDisplayRotationFlags,
+                          subtreeUpdate);
     }
 
     if (forceUpdate || snapshot.clientChanges & layer_state_t::eCornerRadiusChanged ||
@@ -881,7 +1302,7 @@ void LayerSnapshotBuilder::updateSnapshot(LayerSnapshot& snapshot, const Args& a
     if (forceUpdate ||
         snapshot.changes.any(RequestedLayerState::Changes::Geometry |
                              RequestedLayerState::Changes::Input)) {
-        updateInput(snapshot, requested, parentSnapshot, path, args);
+        updateInput(snapshot, requested, parentSnapshot, path, args, subtreeUpdate);
     }
 
     // computed snapshot properties
@@ -944,7 +1365,8 @@ void LayerSnapshotBuilder::updateRoundedCorner(LayerSnapshot& snapshot,
 void LayerSnapshotBuilder::updateLayerBounds(LayerSnapshot& snapshot,
                                              const RequestedLayerState& requested,
                                              const LayerSnapshot& parentSnapshot,
-                                             uint32_t primaryDisplayRotationFlags) {
+                                             uint32_t primaryDisplayRotationFlags,
+                                             SubtreeUpdate* subtreeUpdate) {
     snapshot.geomLayerTransform = parentSnapshot.geomLayerTransform * snapshot.localTransform;
     const bool transformWasInvalid = snapshot.invalidTransform;
     snapshot.invalidTransform = !LayerSnapshot::isTransformValid(snapshot.geomLayerTransform);
@@ -973,7 +1395,11 @@ void LayerSnapshotBuilder::updateLayerBounds(LayerSnapshot& snapshot,
     }
     if (transformWasInvalid != snapshot.invalidTransform) {
         // If transform is invalid, the layer will be hidden.
-        mResortSnapshots = true;
+        if (subtreeUpdate) {
+            subtreeUpdate->resortSnapshots = true;
+        } else {
+            mResortSnapshots = true;
+        }
     }
     snapshot.geomInverseLayerTransform = snapshot.geomLayerTransform.inverse();
 
@@ -1027,7 +1453,8 @@ void LayerSnapshotBuilder::updateInput(LayerSnapshot& snapshot,
                                        const RequestedLayerState& requested,
                                        const LayerSnapshot& parentSnapshot,
                                        const LayerHierarchy::TraversalPath& path,
-                                       const Args& args) {
+                                       const Args& args, SubtreeUpdate* subtreeUpdate) {
+    snapshot.inputInfoChanged = true;
     if (requested.windowInfoHandle) {
         snapshot.inputInfo = *requested.windowInfoHandle->getInfo();
     } else {
@@ -1089,7 +1516,11 @@ void LayerSnapshotBuilder::updateInput(LayerSnapshot& snapshot,
     }
 
     if (requested.touchCropId != UNASSIGNED_LAYER_ID || path.isClone()) {
-        mNeedsTouchableRegionCrop.insert(path);
+        if (subtreeUpdate) {
+            subtreeUpdate->needsTouchableRegionCrop.push_back(path);
+        } else {
+            mNeedsTouchableRegionCrop.insert(path);
+        }
     }
     auto cropLayerSnapshot = getSnapshot(requested.touchCropId);
     if (!cropLayerSnapshot && snapshot.inputInfo.replaceTouchableRegionWithCrop) {
@@ -1199,6 +1630,7 @@ void LayerSnapshotBuilder::updateTouchableRegionCrop(const Args& args) {
             continue;
         }
 
+        snapshot->inputInfoChanged = true;
         if (snapshot->inputInfo.replaceTouchableRegionWithCrop) {
             Rect inputBoundsInDisplaySpace;
             if (!cropLayerSnapshot) {
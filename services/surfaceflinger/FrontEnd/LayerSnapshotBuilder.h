@@ -20,7 +20,9 @@
 #include "FrontEnd/LayerLifecycleManager.h"
 #include "LayerHierarchy.h"
 #include "LayerSnapshot.h"
+#include "ObjectPool.h"
 #include "RequestedLayerState.h"
+#include "WorkerPool.h"
 
 namespace android::surfaceflinger::frontend {
 
@@ -59,6 +61,11 @@ public:
         const std::unordered_map<std::string, uint32_t>& genericLayerMetadataKeyMap;
         bool skipRoundCornersWhenProtected = false;
         LayerSnapshot rootSnapshot = getRootSnapshot();
+        // Hierarchies of at least this many layers are updated on multiple threads, see
+        // updateSnapshotsInParallel. If 0, they are always updated on the calling thread.
+        size_t parallelUpdateMinLayers = 0;
+        // The flattened copy of root, if it has one. The hierarchy is then walked linearly.
+        const FlattenedLayerHierarchy* flattenedRoot = nullptr;
     };
     LayerSnapshotBuilder();
 
@@ -89,6 +96,10 @@ public:
     // Visit each snapshot interesting to input reverse z-order
     void forEachInputSnapshot(const ConstVisitor& visitor) const;
 
+    // Returns the ids of the windows whose input info may have changed since the last call, and
+    // forgets them. Returns std::nullopt if any window may have changed.
+    std::optional<std::unordered_set<int32_t>> takeChangedInputWindowIds();
+
 private:
     friend class LayerSnapshotTest;
 
@@ -98,28 +109,98 @@ private:
 
     void updateSnapshots(const Args& args);
 
+    using SnapshotsByPath = std::unordered_map<LayerHierarchy::TraversalPath, LayerSnapshot*,
+                                               LayerHierarchy::TraversalPathHash>;
+
+    // What updating a subtree changes in the builder, besides the snapshots themselves. When
+    // subtrees are updated in parallel, each one collects these instead of applying them, and
+    // they are applied afterwards in the order of the sequential traversal.
+    struct SubtreeUpdate {
+        std::vector<std::unique_ptr<LayerSnapshot>> newSnapshots;
+        // The new snapshots, of this subtree and of the ones it shares snapshots with.
+        SnapshotsByPath* newSnapshotsByPath = nullptr;
+        std::vector<LayerHierarchy::TraversalPath> needsTouchableRegionCrop;
+        bool resortSnapshots = false;
+    };
+
+    // A part of the hierarchy which is updated by a parallel update.
+    struct ParallelSubtree {
+        enum class Kind {
+            // The layer and its descendants are updated by a worker.
+            Subtree,
+            // The layer is updated first on the calling thread, and its children are separate
+            // subtrees.
+            Split,
+            // The layer is updated first on the calling thread, and its descendants by a worker.
+            Children,
+        };
+        Kind kind = Kind::Subtree;
+        const LayerHierarchy* hierarchy;
+        LayerHierarchy::TraversalPath path;
+        const LayerSnapshot* parentSnapshot;
+        int depth;
+        LayerSnapshot* snapshot = nullptr;
+        // Split: the subtrees of the children.
+        std::vector<size_t> children;
+        SubtreeUpdate update;
+    };
+
+    // The subtrees of each of those sets are updated together, in order, because they share
+    // snapshots. See groupDependentSubtrees.
+    using SubtreeGroups = std::vector<std::vector<size_t>>;
+
+    // Returns false if the hierarchy is too small to be updated in parallel, in which case nothing
+    // is updated.
+    bool updateSnapshotsInParallel(const Args& args, const LayerSnapshot& rootSnapshot);
+    void splitSubtrees(const Args& args, const LayerHierarchy& hierarchy,
+                       LayerHierarchy::TraversalPath& traversalPath, const LayerSnapshot& snapshot,
+                       int depth, std::optional<size_t> parentSubtree,
+                       const std::unordered_map<const LayerHierarchy*, size_t>& subtreeSizes,
+                       size_t minSplitSize, std::vector<ParallelSubtree>& subtrees,
+                       SnapshotsByPath& newSnapshotsByPath);
+    static SubtreeGroups groupDependentSubtrees(const std::vector<ParallelSubtree>& subtrees);
+    void applySubtreeUpdate(SubtreeUpdate& subtreeUpdate);
+
+    void updateSnapshotsInFlattenedHierarchy(const Args& args, const LayerSnapshot& rootSnapshot,
+                                             bool skipUnchangedSubtrees);
+
+    // Updates the snapshots of a layer and its descendants. If subtreeUpdate is not null, the
+    // changes to the builder are collected there.
     const LayerSnapshot& updateSnapshotsInHierarchy(const Args&, const LayerHierarchy& hierarchy,
                                                     LayerHierarchy::TraversalPath& traversalPath,
-                                                    const LayerSnapshot& parentSnapshot, int depth);
+                                                    const LayerSnapshot& parentSnapshot, int depth,
+                                                    SubtreeUpdate* subtreeUpdate = nullptr);
+    LayerSnapshot& updateLayerSnapshot(const Args&, const LayerHierarchy& hierarchy,
+                                       const LayerHierarchy::TraversalPath& traversalPath,
+                                       const LayerSnapshot& parentSnapshot, int depth,
+                                       SubtreeUpdate* subtreeUpdate);
+    void updateChildSnapshots(const Args&, const LayerHierarchy& hierarchy,
+                              LayerHierarchy::TraversalPath& traversalPath, LayerSnapshot& snapshot,
+                              int depth, SubtreeUpdate* subtreeUpdate);
     void updateSnapshot(LayerSnapshot&, const Args&, const RequestedLayerState&,
-                        const LayerSnapshot& parentSnapshot, const LayerHierarchy::TraversalPath&);
+                        const LayerSnapshot& parentSnapshot, const LayerHierarchy::TraversalPath&,
+                        SubtreeUpdate* subtreeUpdate = nullptr);
     static void updateRelativeState(LayerSnapshot& snapshot, const LayerSnapshot& parentSnapshot,
                                     bool parentIsRelative, const Args& args);
     static void resetRelativeState(LayerSnapshot& snapshot);
     static void updateRoundedCorner(LayerSnapshot& snapshot, const RequestedLayerState& layerState,
                                     const LayerSnapshot& parentSnapshot, const Args& args);
     void updateLayerBounds(LayerSnapshot& snapshot, const RequestedLayerState& layerState,
-                           const LayerSnapshot& parentSnapshot, uint32_t displayRotationFlags);
+                           const LayerSnapshot& parentSnapshot, uint32_t displayRotationFlags,
+                           SubtreeUpdate* subtreeUpdate);
     static void updateShadows(LayerSnapshot& snapshot, const RequestedLayerState& requested,
                               const ShadowSettings& globalShadowSettings);
     void updateInput(LayerSnapshot& snapshot, const RequestedLayerState& requested,
                      const LayerSnapshot& parentSnapshot, const LayerHierarchy::TraversalPath& path,
-                     const Args& args);
+                     const Args& args, SubtreeUpdate* subtreeUpdate);
     // Return true if there are unreachable snapshots
     bool sortSnapshotsByZ(const Args& args);
     LayerSnapshot* createSnapshot(const LayerHierarchy::TraversalPath& id,
                                   const RequestedLayerState& layer,
-                                  const LayerSnapshot& parentSnapshot);
+                                  const LayerSnapshot& parentSnapshot,
+                                  SubtreeUpdate* subtreeUpdate = nullptr);
+    void addSnapshot(std::unique_ptr<LayerSnapshot> snapshot);
+    void destroySnapshot(std::vector<std::unique_ptr<LayerSnapshot>>::iterator it);
     void updateFrameRateFromChildSnapshot(LayerSnapshot& snapshot,
                                           const LayerSnapshot& childSnapshot, const Args& args);
     void updateTouchableRegionCrop(const Args& args);
@@ -129,12 +210,33 @@ private:
             mPathToSnapshot;
     std::multimap<uint32_t, LayerSnapshot*> mIdToSnapshots;
 
+    // Layers come and go in bursts, e.g. during app transitions, so the storage of destroyed
+    // snapshots and of their map nodes is kept for the snapshots created by the next burst.
+    static constexpr size_t kRecycledSnapshots = 64;
+    ObjectPool<LayerSnapshot> mSnapshotPool{kRecycledSnapshots};
+    std::vector<decltype(mPathToSnapshot)::node_type> mRecycledPathNodes;
+    std::vector<decltype(mIdToSnapshots)::node_type> mRecycledIdNodes;
+
     // Track snapshots that needs touchable region crop from other snapshots
     std::unordered_set<LayerHierarchy::TraversalPath, LayerHierarchy::TraversalPathHash>
             mNeedsTouchableRegionCrop;
     std::vector<std::unique_ptr<LayerSnapshot>> mSnapshots;
     bool mResortSnapshots = false;
     int mNumInterestingSnapshots = 0;
+
+    // The ids of the windows whose input info changed in the updates since the last call to
+    // takeChangedInputWindowIds, or std::nullopt once there are too many to keep track of.
+    std::optional<std::unordered_set<int32_t>> mChangedInputWindowIds =
+            std::unordered_set<int32_t>{};
+
+    // Created by the first parallel update.
+    std::unique_ptr<WorkerPool> mWorkerPool;
+
+    // The snapshot of each visit of the flattened hierarchy, reused between updates.
+    std::vector<LayerSnapshot*> mFlattenedSnapshots;
+    std::vector<uint32_t> mOpenVisits;
+    // Whether a layer changed in the subtree of each visit of the flattened hierarchy.
+    std::vector<bool> mChangedSubtrees;
 };
 
 } // namespace android::surfaceflinger::frontend
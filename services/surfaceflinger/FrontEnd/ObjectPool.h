@@ -0,0 +1,106 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace android::surfaceflinger::frontend {
+
+// Keeps the storage of destroyed objects around, so that the objects which replace them don't have
+// to be allocated again.
+//
+// The objects are still handed out as std::unique_ptr<T>, since their ownership moves around, and
+// an object made by the pool may outlive it or be destroyed without being recycled. So the
+// storage it keeps is exactly the one that new T would allocate. Only the storage of the object
+// itself is reused, its members still allocate their own.
+//
+// The pool is thread safe.
+template <typename T>
+class ObjectPool {
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                  "over-aligned types are allocated differently by new");
+
+public:
+    // Keeps the storage of up to capacity objects.
+    explicit ObjectPool(size_t capacity) : mCapacity(capacity) {}
+
+    ~ObjectPool() {
+        for (void* storage : mStorage) {
+            ::operator delete(storage);
+        }
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    // Same as std::make_unique<T>(args...), but reuses the storage of a recycled object if there
+    // is one.
+    template <typename... Args>
+    std::unique_ptr<T> make(Args&&... args) {
+        void* storage = take();
+        if (storage == nullptr) {
+            return std::make_unique<T>(std::forward<Args>(args)...);
+        }
+        return std::unique_ptr<T>(new (storage) T(std::forward<Args>(args)...));
+    }
+
+    // Destroys the object, and keeps its storage unless the pool is full.
+    void recycle(std::unique_ptr<T> object) {
+        if (!object) {
+            return;
+        }
+        T* raw = object.release();
+        raw->~T();
+        {
+            std::scoped_lock lock(mMutex);
+            if (mStorage.size() < mCapacity) {
+                mStorage.push_back(raw);
+                return;
+            }
+        }
+        ::operator delete(raw);
+    }
+
+    size_t size() const {
+        std::scoped_lock lock(mMutex);
+        return mStorage.size();
+    }
+
+private:
+    void* take() {
+        std::scoped_lock lock(mMutex);
+        if (mStorage.empty()) {
+            return nullptr;
+        }
+        void* storage = mStorage.back();
+        mStorage.pop_back();
+        return storage;
+    }
+
+    const size_t mCapacity;
+    mutable std::mutex mMutex;
+    std::vector<void*> mStorage GUARDED_BY(mMutex);
+};
+
+} // namespace android::surfaceflinger::frontend
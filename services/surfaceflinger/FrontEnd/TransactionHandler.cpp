@@ -29,18 +29,35 @@
 namespace android::surfaceflinger::frontend {
 
 void TransactionHandler::queueTransaction(TransactionState&& state) {
+    if (mFenceWatcher) {
+        for (auto& resolvedState : state.states) {
+            const auto& bufferData = resolvedState.state.bufferData;
+            if (resolvedState.state.hasBufferChanges() && bufferData &&
+                bufferData->flags.test(BufferData::BufferDataChange::fenceChanged) &&
+                bufferData->acquireFence) {
+                resolvedState.acquireFenceSignaled =
+                        mFenceWatcher->watch(bufferData->acquireFence);
+            }
+        }
+    }
     mLocklessTransactionQueue.push(std::move(state));
     mPendingTransactionCount.fetch_add(1);
     ATRACE_INT("TransactionQueue", static_cast<int>(mPendingTransactionCount.load()));
 }
 
 void TransactionHandler::collectTransactions() {
+    if (ATRACE_ENABLED()) {
+        ATRACE_INT("TransactionQueueRingOccupancy",
+                   static_cast<int>(mLocklessTransactionQueue.getOccupancy()));
+        ATRACE_INT("TransactionQueueOverflowCount",
+                   static_cast<int>(mLocklessTransactionQueue.getOverflowCount()));
+    }
     while (!mLocklessTransactionQueue.isEmpty()) {
         auto maybeTransaction = mLocklessTransactionQueue.pop();
         if (!maybeTransaction.has_value()) {
             break;
         }
-        auto transaction = maybeTransaction.value();
+        auto& transaction = *maybeTransaction;
         mPendingTransactionQueues[transaction.applyToken].emplace(std::move(transaction));
     }
 }
@@ -180,6 +197,17 @@ int TransactionHandler::flushPendingTransactionQueues(std::vector<TransactionSta
     return transactionsPendingBarrier;
 }
 
+void TransactionHandler::watchAcquireFences() {
+    mFenceWatcher = std::make_unique<FenceWatcher>();
+}
+
+bool TransactionHandler::isAcquireFenceSignaled(const ResolvedComposerState& state) {
+    if (state.acquireFenceSignaled) {
+        return state.acquireFenceSignaled->load(std::memory_order_acquire);
+    }
+    return state.state.bufferData->acquireFence->getStatus() != Fence::Status::Unsignaled;
+}
+
 void TransactionHandler::addTransactionReadyFilter(TransactionFilter&& filter) {
     mTransactionReadyFilters.emplace_back(std::move(filter));
 }
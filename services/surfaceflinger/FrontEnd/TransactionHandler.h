@@ -21,12 +21,14 @@
 #include <optional>
 #include <vector>
 
-#include <LocklessQueue.h>
+#include <BoundedLocklessQueue.h>
 #include <TransactionState.h>
 #include <android-base/thread_annotations.h>
 #include <ftl/small_map.h>
 #include <ftl/small_vector.h>
 
+#include "FenceWatcher.h"
+
 namespace android {
 
 class TestableSurfaceFlinger;
@@ -64,6 +66,13 @@ public:
     std::vector<TransactionState> flushTransactions();
     void addTransactionReadyFilter(TransactionFilter&&);
     void queueTransaction(TransactionState&&);
+    // Waits for the acquire fences of the queued transactions on a thread of their own, so that
+    // the filters don't have to query fences on the main thread. Must be called before any
+    // transaction is queued.
+    void watchAcquireFences();
+    // Returns whether the acquire fence of the state has signaled, without querying the fence if
+    // it is watched.
+    static bool isAcquireFenceSignaled(const ResolvedComposerState&);
 
     struct StalledTransactionInfo {
         pid_t pid;
@@ -88,9 +97,14 @@ private:
     TransactionReadiness applyFilters(TransactionFlushState&);
     std::unordered_map<sp<IBinder>, std::queue<TransactionState>, IListenerHash>
             mPendingTransactionQueues;
-    LocklessQueue<TransactionState> mLocklessTransactionQueue;
+    // Holds the transactions of a few frames of a busy system without allocating, and overflows to
+    // an allocating queue beyond that.
+    static constexpr size_t kLocklessTransactionQueueCapacity = 128;
+    BoundedLocklessQueue<TransactionState, kLocklessTransactionQueueCapacity>
+            mLocklessTransactionQueue;
     std::atomic<size_t> mPendingTransactionCount = 0;
     ftl::SmallVector<TransactionFilter, 2> mTransactionReadyFilters;
+    std::unique_ptr<FenceWatcher> mFenceWatcher;
 
     std::mutex mStalledMutex;
     std::unordered_map<uint64_t /* transactionId */, StalledTransactionInfo> mStalledTransactions
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+#undef LOG_TAG
+#define LOG_TAG "SurfaceFlinger"
+
+#include "WorkerPool.h"
+
+#include <pthread.h>
+
+#include <gui/TraceUtils.h>
+
+namespace android::surfaceflinger::frontend {
+
+WorkerPool::WorkerPool(size_t workerCount) {
+    mThreads.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; i++) {
+        mThreads.emplace_back(&WorkerPool::run, this);
+        pthread_setname_np(mThreads.back().native_handle(), "WorkerPool");
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::scoped_lock lock(mMutex);
+        mDone = true;
+        mWorkCv.notify_all();
+    }
+    for (auto& thread : mThreads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& task) {
+    if (mThreads.empty() || count <= 1) {
+        mNextTask = 0;
+        runTasks(task, count);
+        return;
+    }
+
+    {
+        std::scoped_lock lock(mMutex);
+        mTask = &task;
+        mTaskCount = count;
+        mNextTask = 0;
+        mBatch++;
+        mWorkCv.notify_all();
+    }
+
+    runTasks(task, count);
+
+    // Workers which did not join the batch yet would not find any task left, so they don't need
+    // to be waited for.
+    std::unique_lock lock(mMutex);
+    android::base::ScopedLockAssertion assumeLock(mMutex);
+    mTask = nullptr;
+    mIdleCv.wait(lock, [this]() REQUIRES(mMutex) { return mBusyWorkers == 0; });
+}
+
+void WorkerPool::run() {
+    uint64_t lastBatch = 0;
+    std::unique_lock lock(mMutex);
+    android::base::ScopedLockAssertion assumeLock(mMutex);
+    while (true) {
+        mWorkCv.wait(lock, [&]() REQUIRES(mMutex) { return mDone || mBatch != lastBatch; });
+        if (mDone) {
+            return;
+        }
+        lastBatch = mBatch;
+        if (mTask == nullptr) {
+            continue;
+        }
+
+        const std::function<void(size_t)>& task = *mTask;
+        const size_t count = mTaskCount;
+        mBusyWorkers++;
+        lock.unlock();
+        runTasks(task, count);
+        lock.lock();
+        if (--mBusyWorkers == 0) {
+            mIdleCv.notify_one();
+        }
+    }
+}
+
+void WorkerPool::runTasks(const std::function<void(size_t)>& task, size_t count) {
+    ATRACE_CALL();
+    for (size_t i = mNextTask++; i < count; i = mNextTask++) {
+        task(i);
+    }
+}
+
+} // namespace android::surfaceflinger::frontend
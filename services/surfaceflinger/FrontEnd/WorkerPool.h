@@ -0,0 +1,75 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android::surfaceflinger::frontend {
+
+// A small pool of threads which helps the calling thread run a batch of independent tasks.
+//
+// The tasks are not assigned to the threads up front: every thread, including the calling one,
+// takes the next task which has not been started yet, until there are none left. So a thread which
+// got short tasks keeps taking more while another is busy with a long one.
+//
+// The workers are created by the constructor, and inherit the scheduling policy of the thread
+// which created them.
+class WorkerPool final {
+public:
+    // Creates a pool with workerCount threads, besides the calling thread.
+    explicit WorkerPool(size_t workerCount);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Runs task(0) to task(count - 1), and returns once all of them have completed. Must not be
+    // called concurrently, or from a task.
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+    // The number of threads which run the tasks, including the calling thread.
+    size_t getThreadCount() const { return mThreads.size() + 1; }
+
+private:
+    void run();
+    void runTasks(const std::function<void(size_t)>& task, size_t count);
+
+    std::mutex mMutex;
+    std::condition_variable mWorkCv;
+    std::condition_variable mIdleCv;
+    bool mDone GUARDED_BY(mMutex) = false;
+    // Incremented for each batch, so that a worker runs each one once.
+    uint64_t mBatch GUARDED_BY(mMutex) = 0;
+    // The workers which joined the current batch, and have not completed it yet.
+    size_t mBusyWorkers GUARDED_BY(mMutex) = 0;
+    // The task of the current batch, or nullptr once the calling thread ran out of tasks.
+    const std::function<void(size_t)>* mTask GUARDED_BY(mMutex) = nullptr;
+    size_t mTaskCount GUARDED_BY(mMutex) = 0;
+    std::atomic<size_t> mNextTask = 0;
+
+    std::vector<std::thread> mThreads;
+};
+
+} // namespace android::surfaceflinger::frontend
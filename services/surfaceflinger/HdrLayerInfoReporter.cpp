@@ -22,6 +22,7 @@
 #include <inttypes.h>
 #include <utils/Trace.h>
 
+#include "BackgroundExecutor.h"
 #include "HdrLayerInfoReporter.h"
 
 namespace android {
@@ -46,11 +47,17 @@ void HdrLayerInfoReporter::dispatchHdrLayerInfo(const HdrLayerInfo& info) {
         }
     }
 
-    for (const auto& listener : toInvoke) {
-        ATRACE_NAME("invoking onHdrLayerInfoChanged");
-        listener->onHdrLayerInfoChanged(info.numberOfHdrLayers, info.maxW, info.maxH, info.flags,
-                                        info.maxDesiredHdrSdrRatio);
+    if (toInvoke.empty()) {
+        return;
     }
+
+    BackgroundExecutor::getInstance().sendCallbacks({[toInvoke = std::move(toInvoke), info]() {
+        for (const auto& listener : toInvoke) {
+            ATRACE_NAME("invoking onHdrLayerInfoChanged");
+            listener->onHdrLayerInfoChanged(info.numberOfHdrLayers, info.maxW, info.maxH,
+                                            info.flags, info.maxDesiredHdrSdrRatio);
+        }
+    }});
 }
 
 void HdrLayerInfoReporter::binderDied(const wp<IBinder>& who) {
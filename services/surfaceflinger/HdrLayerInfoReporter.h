@@ -63,9 +63,8 @@ public:
     HdrLayerInfoReporter() = default;
     ~HdrLayerInfoReporter() final = default;
 
-    // Dispatches updated layer fps values for the registered listeners
-    // This method promotes Layer weak pointers and performs layer stack traversals, so mStateLock
-    // must be held when calling this method.
+    // Dispatches the info to the registered listeners whose last info differs, from the
+    // BackgroundExecutor.
     void dispatchHdrLayerInfo(const HdrLayerInfo& info) EXCLUDES(mMutex);
 
     // Override for IBinder::DeathRecipient
@@ -15,30 +15,29 @@
  */
 // #define LOG_NDEBUG 0
 #include <algorithm>
+#include <cmath>
 
 #include "HdrSdrRatioOverlay.h"
 
-#include <SkSurface.h>
-
 #undef LOG_TAG
 #define LOG_TAG "HdrSdrRatioOverlay"
 
 namespace android {
 
-void HdrSdrRatioOverlay::drawNumber(float number, int left, SkColor color, SkCanvas& canvas) {
+void HdrSdrRatioOverlay::drawNumber(float number, int left, GlyphAtlas::Glyphs& glyphs) {
     if (!isfinite(number) || number >= 10.f) return;
     // We assume that the number range is [1.f, 10.f)
     // and the decimal places are 2.
     int value = static_cast<int>(number * 100);
-    SegmentDrawer::drawDigit(value / 100, left, color, canvas);
+    glyphs.push_back({GlyphAtlas::digit(value / 100), left});
 
     left += kDigitWidth + kDigitSpace;
-    SegmentDrawer::drawSegment(SegmentDrawer::Segment::DecimalPoint, left, color, canvas);
+    glyphs.push_back({GlyphAtlas::segment(SegmentDrawer::Segment::DecimalPoint), left});
     left += kDigitWidth + kDigitSpace;
 
-    SegmentDrawer::drawDigit((value / 10) % 10, left, color, canvas);
+    glyphs.push_back({GlyphAtlas::digit((value / 10) % 10), left});
     left += kDigitWidth + kDigitSpace;
-    SegmentDrawer::drawDigit(value % 10, left, color, canvas);
+    glyphs.push_back({GlyphAtlas::digit(value % 10), left});
 }
 
 sp<GraphicBuffer> HdrSdrRatioOverlay::draw(float currentHdrSdrRatio, SkColor color,
@@ -61,38 +60,14 @@ sp<GraphicBuffer> HdrSdrRatioOverlay::draw(float currentHdrSdrRatio, SkColor col
 
     auto& buffer = ringBuffer;
 
-    SkMatrix canvasTransform = SkMatrix();
-    switch (rotation) {
-        case ui::Transform::ROT_90:
-            canvasTransform.setTranslate(bufferHeight, 0);
-            canvasTransform.preRotate(90.f);
-            break;
-        case ui::Transform::ROT_270:
-            canvasTransform.setRotate(270.f, bufferWidth / 2.f, bufferWidth / 2.f);
-            break;
-        default:
-            break;
-    }
-
     const status_t bufferStatus = buffer->initCheck();
     LOG_ALWAYS_FATAL_IF(bufferStatus != OK, "HdrSdrRatioOverlay: Buffer failed to allocate: %d",
                         bufferStatus);
 
-    sk_sp<SkSurface> surface =
-            SkSurfaces::Raster(SkImageInfo::MakeN32Premul(bufferWidth, bufferHeight));
-    SkCanvas* canvas = surface->getCanvas();
-    canvas->setMatrix(canvasTransform);
-
-    drawNumber(currentHdrSdrRatio, 0, color, *canvas);
-
-    void* pixels = nullptr;
-    buffer->lock(GRALLOC_USAGE_SW_WRITE_RARELY, reinterpret_cast<void**>(&pixels));
-
-    const SkImageInfo& imageInfo = surface->imageInfo();
-    const size_t dstRowBytes = buffer->getStride() * static_cast<size_t>(imageInfo.bytesPerPixel());
-
-    canvas->readPixels(imageInfo, pixels, dstRowBytes, 0, 0);
-    buffer->unlock();
+    // The buffer is square, so the rotation doesn't change its size.
+    GlyphAtlas::Glyphs glyphs;
+    drawNumber(currentHdrSdrRatio, 0, glyphs);
+    GlyphAtlas::getInstance().compose(glyphs, color, rotation, *buffer);
     return buffer;
 }
 
@@ -21,8 +21,6 @@
 #include <ui/Size.h>
 #include <utils/StrongPointer.h>
 
-class SkCanvas;
-
 namespace android {
 class HdrSdrRatioOverlay {
 private:
@@ -44,7 +42,7 @@ private:
 
     static sp<GraphicBuffer> draw(float currentHdrSdrRatio, SkColor, ui::Transform::RotationFlags,
                                   sp<GraphicBuffer>& ringBufer);
-    static void drawNumber(float number, int left, SkColor, SkCanvas&);
+    static void drawNumber(float number, int left, GlyphAtlas::Glyphs&);
 
     const sp<GraphicBuffer> getOrCreateBuffers(float currentHdrSdrRatio);
 
@@ -1460,7 +1460,7 @@ std::shared_ptr<frametimeline::SurfaceFrame> Layer::createSurfaceFrameForTransac
 }
 
 std::shared_ptr<frametimeline::SurfaceFrame> Layer::createSurfaceFrameForBuffer(
-        const FrameTimelineInfo& info, nsecs_t queueTime, std::string debugName) {
+        const FrameTimelineInfo& info, nsecs_t queueTime, const std::string& debugName) {
     auto surfaceFrame =
             mFlinger->mFrameTimeline->createSurfaceFrameForToken(info, mOwnerPid, mOwnerUid,
                                                                  getSequence(), mName, debugName,
@@ -1477,7 +1477,7 @@ std::shared_ptr<frametimeline::SurfaceFrame> Layer::createSurfaceFrameForBuffer(
 }
 
 void Layer::setFrameTimelineVsyncForSkippedFrames(const FrameTimelineInfo& info, nsecs_t postTime,
-                                                  std::string debugName) {
+                                                  const std::string& debugName) {
     if (info.skippedFrameVsyncId == FrameTimelineInfo::INVALID_VSYNC_ID) {
         return;
     }
@@ -2912,6 +2912,21 @@ void Layer::callReleaseBufferCallback(const sp<ITransactionCompletedListener>& l
                               currentMaxAcquiredBufferCount);
 }
 
+void Layer::queueReleaseBufferCallback(const sp<ITransactionCompletedListener>& listener,
+                                       const sp<GraphicBuffer>& buffer, uint64_t framenumber,
+                                       const sp<Fence>& releaseFence) {
+    if (!listener) {
+        return;
+    }
+    ATRACE_FORMAT_INSTANT("queueReleaseBufferCallback %s - %" PRIu64, getDebugName(), framenumber);
+    uint32_t currentMaxAcquiredBufferCount =
+            mFlinger->getMaxAcquiredBufferCountForCurrentRefreshRate(mOwnerUid);
+    mFlinger->mTransactionCallbackInvoker.addReleasedBuffer(listener,
+                                                            {buffer->getId(), framenumber},
+                                                            releaseFence,
+                                                            currentMaxAcquiredBufferCount);
+}
+
 void Layer::onLayerDisplayed(ftl::SharedFuture<FenceResult> futureFenceResult,
                              ui::LayerStack layerStack,
                              std::function<FenceResult(FenceResult)>&& continuation) {
@@ -3031,6 +3046,12 @@ void Layer::releasePendingBuffer(nsecs_t dequeueReadyTime) {
     for (auto& handle : mDrawingState.callbackHandles) {
         if (handle->releasePreviousBuffer && mPreviousReleaseBufferEndpoint == handle->listener) {
             handle->previousReleaseCallbackId = mPreviousReleaseCallbackId;
+            if (mPreviousReleaseCallbackId != ReleaseCallbackId::INVALID_ID &&
+                mPreviousBufferLatchTime > 0) {
+                mFlinger->mTimeStats->recordBufferHoldDuration(systemTime() -
+                                                                       mPreviousBufferLatchTime,
+                                                               /*releasedEarly=*/false);
+            }
             break;
         }
     }
@@ -3042,6 +3063,44 @@ void Layer::releasePendingBuffer(nsecs_t dequeueReadyTime) {
     mDrawingState.callbackHandles = {};
 }
 
+bool Layer::releasePreviousBufferEarly() {
+    if (mPreviousReleaseCallbackId == ReleaseCallbackId::INVALID_ID) {
+        return false;
+    }
+    sp<CallbackHandle> ch;
+    for (auto& handle : mDrawingState.callbackHandles) {
+        if (handle->releasePreviousBuffer && mPreviousReleaseBufferEndpoint == handle->listener) {
+            ch = handle;
+            break;
+        }
+    }
+    // A layer on several displays, or mirrored, gets a fence per display, which may be from
+    // different frames. Leave those to the callbacks of the frame.
+    if (ch == nullptr || ch->previousReleaseFences.size() != 1 ||
+        ch->previousReleaseFences.front().wait_for(0s) != std::future_status::ready) {
+        return false;
+    }
+
+    ATRACE_FORMAT_INSTANT("releasePreviousBufferEarly %s - %" PRIu64, getDebugName(),
+                          mPreviousReleaseCallbackId.framenumber);
+    sp<Fence> releaseFence = ch->previousReleaseFences.front().get().value_or(Fence::NO_FENCE);
+    ch->previousReleaseFences.clear();
+    // The callbacks of the frame must neither release the buffer again, nor wait for its fence.
+    ch->releasePreviousBuffer = false;
+    ch->previousReleaseCallbackId = ReleaseCallbackId::INVALID_ID;
+
+    mFlinger->getTransactionCallbackInvoker()
+            .addReleasedBuffer(interface_cast<ITransactionCompletedListener>(ch->listener),
+                               mPreviousReleaseCallbackId, releaseFence,
+                               mFlinger->getMaxAcquiredBufferCountForCurrentRefreshRate(
+                                       mOwnerUid));
+    if (mPreviousBufferLatchTime > 0) {
+        mFlinger->mTimeStats->recordBufferHoldDuration(systemTime() - mPreviousBufferLatchTime,
+                                                       /*releasedEarly=*/true);
+    }
+    return true;
+}
+
 bool Layer::willPresentCurrentTransaction() const {
     // Returns true if the most recent Transaction applied to CurrentState will be presented.
     return (getSidebandStreamChanged() || getAutoRefresh() ||
@@ -3175,9 +3234,9 @@ void Layer::releasePreviousBuffer() {
         // before swapping to drawing state, then the first buffer will be
         // dropped and we should decrement the pending buffer count and
         // call any release buffer callbacks if set.
-        callReleaseBufferCallback(mDrawingState.releaseBufferListener,
-                                  mDrawingState.buffer->getBuffer(), mDrawingState.frameNumber,
-                                  mDrawingState.acquireFence);
+        queueReleaseBufferCallback(mDrawingState.releaseBufferListener,
+                                   mDrawingState.buffer->getBuffer(), mDrawingState.frameNumber,
+                                   mDrawingState.acquireFence);
         decrementPendingBufferCount();
         if (mDrawingState.bufferSurfaceFrameTX != nullptr &&
             mDrawingState.bufferSurfaceFrameTX->getPresentState() != PresentState::Presented) {
@@ -3185,9 +3244,9 @@ void Layer::releasePreviousBuffer() {
             mDrawingState.bufferSurfaceFrameTX.reset();
         }
     } else if (EARLY_RELEASE_ENABLED && mLastClientCompositionFence != nullptr) {
-        callReleaseBufferCallback(mDrawingState.releaseBufferListener,
-                                  mDrawingState.buffer->getBuffer(), mDrawingState.frameNumber,
-                                  mLastClientCompositionFence);
+        queueReleaseBufferCallback(mDrawingState.releaseBufferListener,
+                                   mDrawingState.buffer->getBuffer(), mDrawingState.frameNumber,
+                                   mLastClientCompositionFence);
         mLastClientCompositionFence = nullptr;
     }
 }
@@ -3621,6 +3680,7 @@ void Layer::updateTexImage(nsecs_t latchTime, bool bgColorOnly) {
     const uint64_t bufferId = mDrawingState.buffer->getId();
     const uint64_t frameNumber = mDrawingState.frameNumber;
     const auto acquireFence = std::make_shared<FenceTime>(mDrawingState.acquireFence);
+    FenceResolver::getInstance().track(acquireFence);
     mFlinger->mTimeStats->setAcquireFence(layerId, frameNumber, acquireFence);
     mFlinger->mTimeStats->setLatchTime(layerId, frameNumber, latchTime);
 
@@ -3652,6 +3712,8 @@ void Layer::updateTexImage(nsecs_t latchTime, bool bgColorOnly) {
 void Layer::gatherBufferInfo() {
     mPreviousReleaseCallbackId = {getCurrentBufferId(), mBufferInfo.mFrameNumber};
     mPreviousReleaseBufferEndpoint = mBufferInfo.mReleaseBufferEndpoint;
+    mPreviousBufferLatchTime = mBufferLatchTime;
+    mBufferLatchTime = mDrawingState.buffer ? systemTime() : 0;
     if (!mDrawingState.buffer) {
         mBufferInfo = {};
         return;
@@ -3670,6 +3732,7 @@ void Layer::gatherBufferInfo() {
     mBufferInfo.mFrameLatencyNeeded = true;
     mBufferInfo.mDesiredPresentTime = mDrawingState.desiredPresentTime;
     mBufferInfo.mFenceTime = std::make_shared<FenceTime>(mDrawingState.acquireFence);
+    FenceResolver::getInstance().track(mBufferInfo.mFenceTime);
     mBufferInfo.mFence = mDrawingState.acquireFence;
     mBufferInfo.mTransform = mDrawingState.bufferTransform;
     auto lastDataspace = mBufferInfo.mDataspace;
@@ -444,6 +444,10 @@ public:
 
     // If a buffer was replaced this frame, release the former buffer
     void releasePendingBuffer(nsecs_t /*dequeueReadyTime*/);
+    // Once the layer is displayed this frame, releases the former buffer right away if HWC is
+    // already done with it, instead of with the transaction callbacks of the frame. The release
+    // must be displayed on a single display. Returns whether the buffer was released.
+    bool releasePreviousBufferEarly();
 
     /*
      * latchBuffer - called each time the screen is redrawn and returns whether
@@ -803,9 +807,9 @@ public:
     std::shared_ptr<frametimeline::SurfaceFrame> createSurfaceFrameForTransaction(
             const FrameTimelineInfo& info, nsecs_t postTime);
     std::shared_ptr<frametimeline::SurfaceFrame> createSurfaceFrameForBuffer(
-            const FrameTimelineInfo& info, nsecs_t queueTime, std::string debugName);
+            const FrameTimelineInfo& info, nsecs_t queueTime, const std::string& debugName);
     void setFrameTimelineVsyncForSkippedFrames(const FrameTimelineInfo& info, nsecs_t postTime,
-                                               std::string debugName);
+                                               const std::string& debugName);
 
     bool setTrustedPresentationInfo(TrustedPresentationThresholds const& thresholds,
                                     TrustedPresentationListener const& listener);
@@ -912,6 +916,11 @@ public:
     void callReleaseBufferCallback(const sp<ITransactionCompletedListener>& listener,
                                    const sp<GraphicBuffer>& buffer, uint64_t framenumber,
                                    const sp<Fence>& releaseFence);
+    // Same as callReleaseBufferCallback, but the release is sent with the next transaction
+    // callbacks of the listener. Must be called during commit.
+    void queueReleaseBufferCallback(const sp<ITransactionCompletedListener>& listener,
+                                    const sp<GraphicBuffer>& buffer, uint64_t framenumber,
+                                    const sp<Fence>& releaseFence);
     bool setFrameRateForLayerTreeLegacy(FrameRate, nsecs_t now);
     bool setFrameRateForLayerTree(FrameRate, const scheduler::LayerProps&, nsecs_t now);
     void recordLayerHistoryBufferUpdate(const scheduler::LayerProps&, nsecs_t now);
@@ -1254,6 +1263,9 @@ private:
 
     ReleaseCallbackId mPreviousReleaseCallbackId = ReleaseCallbackId::INVALID_ID;
     sp<IBinder> mPreviousReleaseBufferEndpoint;
+    // When the current and the previous buffers were latched, for the hold duration metrics.
+    nsecs_t mBufferLatchTime = 0;
+    nsecs_t mPreviousBufferLatchTime = 0;
 
     bool mReleasePreviousBuffer = false;
 
@@ -83,6 +83,7 @@ const compositionengine::LayerFECompositionState* LayerFE::getCompositionState()
 }
 
 bool LayerFE::onPreComposition(nsecs_t refreshStartTime, bool) {
+    std::scoped_lock lock(mCompositionResultMutex);
     mCompositionResult.refreshStartTime = refreshStartTime;
     return mSnapshot->hasReadyFrame;
 }
@@ -252,6 +253,7 @@ void LayerFE::prepareBufferStateClientComposition(
     layerSettings.source.buffer.maxLuminanceNits = maxLuminance;
     layerSettings.frameNumber = mSnapshot->frameNumber;
     layerSettings.bufferId = mSnapshot->externalTexture->getId();
+    layerSettings.source.buffer.frameNumber = mSnapshot->frameNumber;
 
     const bool useFiltering = targetSettings.needsFiltering ||
                               mSnapshot->geomLayerTransform.needsBilinearFiltering();
@@ -334,10 +336,12 @@ void LayerFE::prepareShadowClientComposition(LayerFE::LayerSettings& caster,
 
 void LayerFE::onLayerDisplayed(ftl::SharedFuture<FenceResult> futureFenceResult,
                                ui::LayerStack layerStack) {
+    std::scoped_lock lock(mCompositionResultMutex);
     mCompositionResult.releaseFences.emplace_back(std::move(futureFenceResult), layerStack);
 }
 
 CompositionResult&& LayerFE::stealCompositionResult() {
+    std::scoped_lock lock(mCompositionResultMutex);
     return std::move(mCompositionResult);
 }
 
@@ -362,6 +366,7 @@ bool LayerFE::hasRoundedCorners() const {
 }
 
 void LayerFE::setWasClientComposed(const sp<Fence>& fence) {
+    std::scoped_lock lock(mCompositionResultMutex);
     mCompositionResult.lastClientCompositionFence = fence;
 }
 
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <android-base/thread_annotations.h>
 #include <android/gui/CachingHint.h>
 #include <gui/LayerMetadata.h>
 #include "FrontEnd/LayerSnapshot.h"
@@ -23,6 +24,8 @@
 #include "compositionengine/LayerFECompositionState.h"
 #include "renderengine/LayerSettings.h"
 
+#include <mutex>
+
 namespace android {
 
 struct CompositionResult {
@@ -77,7 +80,10 @@ private:
 
     const sp<GraphicBuffer> getBuffer() const;
 
-    CompositionResult mCompositionResult;
+    // Outputs which show the same layer stack, and so share their LayerFEs, may be presented in
+    // parallel.
+    std::mutex mCompositionResultMutex;
+    CompositionResult mCompositionResult GUARDED_BY(mCompositionResultMutex);
     std::string mName;
 };
 
@@ -15,14 +15,13 @@
  */
 
 #include <algorithm>
+#include <mutex>
 
 #include <common/FlagManager.h>
 #include "Client.h"
 #include "Layer.h"
 #include "RefreshRateOverlay.h"
 
-#include <SkSurface.h>
-
 #undef LOG_TAG
 #define LOG_TAG "RefreshRateOverlay"
 
@@ -36,17 +35,21 @@ auto RefreshRateOverlay::draw(int vsyncRate, int renderFps, SkColor color,
     Buffers buffers;
     buffers.reserve(loopCount);
 
+    // The segments of the spinner, one per buffer.
+    constexpr std::array kSpinnerSegments = {SegmentDrawer::Segment::Upper,
+                                             SegmentDrawer::Segment::UpperRight,
+                                             SegmentDrawer::Segment::LowerRight,
+                                             SegmentDrawer::Segment::Bottom,
+                                             SegmentDrawer::Segment::LowerLeft,
+                                             SegmentDrawer::Segment::UpperLeft};
+
+    GlyphAtlas::Glyphs glyphs;
     for (size_t i = 0; i < loopCount; i++) {
         // Pre-rotate the buffer before it reaches SurfaceFlinger.
-        SkMatrix canvasTransform = SkMatrix();
         const auto [bufferWidth, bufferHeight] = [&]() -> std::pair<int, int> {
             switch (rotation) {
                 case ui::Transform::ROT_90:
-                    canvasTransform.setTranslate(kBufferHeight, 0);
-                    canvasTransform.preRotate(90.f);
-                    return {kBufferHeight, kBufferWidth};
                 case ui::Transform::ROT_270:
-                    canvasTransform.setRotate(270.f, kBufferWidth / 2.f, kBufferWidth / 2.f);
                     return {kBufferHeight, kBufferWidth};
                 default:
                     return {kBufferWidth, kBufferHeight};
@@ -65,77 +68,41 @@ auto RefreshRateOverlay::draw(int vsyncRate, int renderFps, SkColor color,
         LOG_ALWAYS_FATAL_IF(bufferStatus != OK, "RefreshRateOverlay: Buffer failed to allocate: %d",
                             bufferStatus);
 
-        sk_sp<SkSurface> surface = SkSurfaces::Raster(
-                SkImageInfo::MakeN32Premul(bufferWidth, bufferHeight));
-        SkCanvas* canvas = surface->getCanvas();
-        canvas->setMatrix(canvasTransform);
-
+        glyphs.clear();
         int left = 0;
-        drawNumber(vsyncRate, left, color, *canvas);
+        drawNumber(vsyncRate, left, glyphs);
         left += 3 * (kDigitWidth + kDigitSpace);
         if (features.test(Features::Spinner)) {
-            switch (i) {
-                case 0:
-                    SegmentDrawer::drawSegment(SegmentDrawer::Segment::Upper, left, color, *canvas);
-                    break;
-                case 1:
-                    SegmentDrawer::drawSegment(SegmentDrawer::Segment::UpperRight, left, color,
-                                               *canvas);
-                    break;
-                case 2:
-                    SegmentDrawer::drawSegment(SegmentDrawer::Segment::LowerRight, left, color,
-                                               *canvas);
-                    break;
-                case 3:
-                    SegmentDrawer::drawSegment(SegmentDrawer::Segment::Bottom, left, color,
-                                               *canvas);
-                    break;
-                case 4:
-                    SegmentDrawer::drawSegment(SegmentDrawer::Segment::LowerLeft, left, color,
-                                               *canvas);
-                    break;
-                case 5:
-                    SegmentDrawer::drawSegment(SegmentDrawer::Segment::UpperLeft, left, color,
-                                               *canvas);
-                    break;
-            }
+            glyphs.push_back({GlyphAtlas::segment(kSpinnerSegments[i]), left});
         }
 
         left += kDigitWidth + kDigitSpace;
 
         if (features.test(Features::RenderRate)) {
-            drawNumber(renderFps, left, color, *canvas);
+            drawNumber(renderFps, left, glyphs);
         }
         left += 3 * (kDigitWidth + kDigitSpace);
 
-        void* pixels = nullptr;
-        buffer->lock(GRALLOC_USAGE_SW_WRITE_RARELY, reinterpret_cast<void**>(&pixels));
-
-        const SkImageInfo& imageInfo = surface->imageInfo();
-        const size_t dstRowBytes =
-                buffer->getStride() * static_cast<size_t>(imageInfo.bytesPerPixel());
-
-        canvas->readPixels(imageInfo, pixels, dstRowBytes, 0, 0);
-        buffer->unlock();
+        GlyphAtlas::getInstance().compose(glyphs, color, rotation, *buffer);
         buffers.push_back(std::move(buffer));
     }
     return buffers;
 }
 
-void RefreshRateOverlay::drawNumber(int number, int left, SkColor color, SkCanvas& canvas) {
+void RefreshRateOverlay::drawNumber(int number, int left, GlyphAtlas::Glyphs& glyphs) {
     if (number < 0 || number >= 1000) return;
 
     if (number >= 100) {
-        SegmentDrawer::drawDigit(number / 100, left, color, canvas);
+        glyphs.push_back({GlyphAtlas::digit(number / 100), left});
     }
     left += kDigitWidth + kDigitSpace;
 
     if (number >= 10) {
-        SegmentDrawer::drawDigit((number / 10) % 10, left, color, canvas);
+        glyphs.push_back({GlyphAtlas::digit((number / 10) % 10), left});
     }
     left += kDigitWidth + kDigitSpace;
 
-    SegmentDrawer::drawDigit(number % 10, left, color, canvas);
+    glyphs.push_back({GlyphAtlas::digit(number % 10), left});
 }
 
 std::unique_ptr<RefreshRateOverlay> RefreshRateOverlay::create(FpsRange range,
@@ -228,13 +195,57 @@ auto RefreshRateOverlay::getOrCreateBuffers(Fps vsyncRate, Fps renderFps) -> con
 
         const SkColor color = colorBase.toSkColor();
 
-        auto buffers = draw(displayIntFps, renderIntFps, color, transformHint, mFeatures);
+        auto buffers = getOrDrawSharedBuffers(displayIntFps, renderIntFps, color, transformHint,
+                                              mFeatures);
         it = mBufferCache
                      .try_emplace({displayIntFps, renderIntFps, transformHint}, std::move(buffers))
                      .first;
     }
 
-    return it->second;
+    return *it->second;
+}
+
+auto RefreshRateOverlay::getOrDrawSharedBuffers(int vsyncRate, int renderFps, SkColor color,
+                                                ui::Transform::RotationFlags rotation,
+                                                ftl::Flags<Features> features)
+        -> std::shared_ptr<const Buffers> {
+    // The buffers of the overlays of all displays, which are kept as long as an overlay caches
+    // them, so that the overlay of another display, or the overlay created again after a change
+    // of the display, doesn't allocate and draw them again.
+    struct SharedBuffers {
+        int vsyncRate;
+        int renderFps;
+        SkColor color;
+        ui::Transform::RotationFlags rotation;
+        bool spinner;
+        bool renderRate;
+        std::weak_ptr<const Buffers> buffers;
+    };
+    static std::mutex sMutex;
+    static std::vector<SharedBuffers> sSharedBuffers;
+
+    const bool spinner = features.test(Features::Spinner);
+    const bool renderRate = features.test(Features::RenderRate);
+
+    std::lock_guard lock(sMutex);
+    std::erase_if(sSharedBuffers, [](const SharedBuffers& shared) {
+        return shared.buffers.expired();
+    });
+    for (const auto& shared : sSharedBuffers) {
+        if (shared.vsyncRate == vsyncRate && shared.renderFps == renderFps &&
+            shared.color == color && shared.rotation == rotation && shared.spinner == spinner &&
+            shared.renderRate == renderRate) {
+            if (auto buffers = shared.buffers.lock()) {
+                return buffers;
+            }
+        }
+    }
+
+    auto buffers = std::make_shared<const Buffers>(
+            draw(vsyncRate, renderFps, color, rotation, features));
+    sSharedBuffers.push_back(
+            {vsyncRate, renderFps, color, rotation, spinner, renderRate, buffers});
+    return buffers;
 }
 
 void RefreshRateOverlay::setViewport(ui::Size viewport) {
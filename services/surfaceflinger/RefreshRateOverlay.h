@@ -18,6 +18,7 @@
 
 #include "Utils/OverlayUtils.h"
 
+#include <memory>
 #include <vector>
 
 #include <ftl/flags.h>
@@ -29,8 +30,6 @@
 
 #include <scheduler/Fps.h>
 
-class SkCanvas;
-
 namespace android {
 
 class GraphicBuffer;
@@ -67,7 +66,13 @@ private:
 
     static Buffers draw(int vsyncRate, int renderFps, SkColor, ui::Transform::RotationFlags,
                         ftl::Flags<Features>);
-    static void drawNumber(int number, int left, SkColor, SkCanvas&);
+    static void drawNumber(int number, int left, GlyphAtlas::Glyphs&);
+
+    // Returns the buffers of another overlay which drew the same ones, or draws them.
+    static std::shared_ptr<const Buffers> getOrDrawSharedBuffers(int vsyncRate, int renderFps,
+                                                                 SkColor,
+                                                                 ui::Transform::RotationFlags,
+                                                                 ftl::Flags<Features>);
 
     const Buffers& getOrCreateBuffers(Fps, Fps);
 
@@ -84,7 +89,7 @@ private:
         }
     };
 
-    using BufferCache = ftl::SmallMap<Key, Buffers, 9>;
+    using BufferCache = ftl::SmallMap<Key, std::shared_ptr<const Buffers>, 9>;
     BufferCache mBufferCache;
 
     std::optional<Fps> mVsyncRate;
@@ -32,10 +32,13 @@
 #include <ftl/future.h>
 #include <gui/SpHash.h>
 #include <gui/SyncScreenCaptureListener.h>
+#include <math/HashCombine.h>
 #include <renderengine/impl/ExternalTexture.h>
 #include <ui/DisplayStatInfo.h>
+#include <ui/GraphicBufferAllocator.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <string>
 
 #include "DisplayDevice.h"
@@ -224,8 +227,65 @@ float sampleArea(const uint32_t* data, int32_t width, int32_t height, int32_t st
     return accumulatedLuma / (255.0f * pixelCount);
 }
 
+Rect scaleSampleArea(const Rect& area, const Point& leftTop, int32_t downscale) {
+    const Rect localArea = area - leftTop;
+    if (downscale <= 1) {
+        return localArea;
+    }
+
+    // The area is within the sampled region, so its local coordinates are never negative.
+    return Rect(localArea.left / downscale, localArea.top / downscale,
+                (localArea.right + downscale - 1) / downscale,
+                (localArea.bottom + downscale - 1) / downscale);
+}
+
+// Hashes what the rendering of the layers under the sampling areas depends on, or returns nullopt
+// if a layer may draw new content without any of it changing.
+static std::optional<size_t> hashSampledContent(
+        const std::vector<std::pair<Layer*, sp<LayerFE>>>& layers, size_t hash) {
+    for (const auto& [layer, layerFE] : layers) {
+        const auto& snapshot = *layerFE->mSnapshot;
+        // The producer of a shared buffer draws into it without queueing a new frame, and a
+        // sideband stream is not drawn through a buffer at all.
+        if ((layer && layer->getAutoRefresh()) || snapshot.sidebandStream) {
+            return std::nullopt;
+        }
+
+        hashCombineSingle(hash, snapshot.sequence);
+        hashCombineSingle(hash, snapshot.geomLayerTransform.transform(snapshot.geomLayerBounds));
+        hashCombineSingle(hash, snapshot.geomCrop);
+        hashCombineSingle(hash, snapshot.geomContentCrop);
+        hashCombineSingle(hash, snapshot.geomBufferTransform);
+        hashCombineSingle(hash, snapshot.buffer ? snapshot.buffer->getId() : 0);
+        hashCombineSingle(hash, snapshot.frameNumber);
+        hashCombineSingle(hash, snapshot.alpha);
+        hashCombineSingle(hash, static_cast<float>(snapshot.color.r));
+        hashCombineSingle(hash, static_cast<float>(snapshot.color.g));
+        hashCombineSingle(hash, static_cast<float>(snapshot.color.b));
+        hashCombineSingle(hash, static_cast<float>(snapshot.color.a));
+        hashCombineSingle(hash, static_cast<int32_t>(snapshot.blendMode));
+        hashCombineSingle(hash, static_cast<int32_t>(snapshot.dataspace));
+        if (!snapshot.colorTransformIsIdentity) {
+            for (size_t i = 0; i < 16; i++) {
+                hashCombineSingle(hash, snapshot.colorTransform.asArray()[i]);
+            }
+        }
+        hashCombineSingle(hash, snapshot.roundedCorner.cropRect);
+        hashCombineSingle(hash, snapshot.roundedCorner.radius.x);
+        hashCombineSingle(hash, snapshot.roundedCorner.radius.y);
+        hashCombineSingle(hash, snapshot.backgroundBlurRadius);
+        for (const BlurRegion& blurRegion : snapshot.blurRegions) {
+            hashCombineSingle(hash, blurRegion);
+        }
+        hashCombineSingle(hash, snapshot.shadowSettings.length);
+        hashCombineSingle(hash, snapshot.stretchEffect.vectorX);
+        hashCombineSingle(hash, snapshot.stretchEffect.vectorY);
+    }
+    return hash;
+}
+
 std::vector<float> RegionSamplingThread::sampleBuffer(
-        const sp<GraphicBuffer>& buffer, const Point& leftTop,
+        const sp<GraphicBuffer>& buffer, const Point& leftTop, int32_t downscale,
         const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation) {
     void* data_raw = nullptr;
     buffer->lock(GRALLOC_USAGE_SW_READ_OFTEN, &data_raw);
@@ -240,7 +300,7 @@ std::vector<float> RegionSamplingThread::sampleBuffer(
     std::transform(descriptors.begin(), descriptors.end(), lumas.begin(),
                    [&](auto const& descriptor) {
                        return sampleArea(data.get(), width, height, stride, orientation,
-                                         descriptor.area - leftTop);
+                                         scaleSampleArea(descriptor.area, leftTop, downscale));
                    });
     return lumas;
 }
@@ -270,16 +330,24 @@ void RegionSamplingThread::captureSample() {
 
     std::vector<RegionSamplingThread::Descriptor> descriptors;
     Region sampleRegion;
+    int32_t downscale = kMaxSampleDownscale;
+    size_t descriptorsHash = hashCombine(static_cast<uint32_t>(orientation));
     for (const auto& [listener, descriptor] : mDescriptors) {
         sampleRegion.orSelf(descriptor.area);
         descriptors.emplace_back(descriptor);
+        downscale = std::min({downscale, descriptor.area.getWidth(), descriptor.area.getHeight()});
+        hashCombineSingle(descriptorsHash, descriptor.area);
+        hashCombineSingle(descriptorsHash, descriptor.listener.get());
     }
+    downscale = std::max(downscale, 1);
 
     const Rect sampledBounds = sampleRegion.bounds();
+    const ui::Size sampledSize((sampledBounds.getWidth() + downscale - 1) / downscale,
+                               (sampledBounds.getHeight() + downscale - 1) / downscale);
     constexpr bool kHintForSeamlessTransition = false;
 
     SurfaceFlinger::RenderAreaFuture renderAreaFuture = ftl::defer([=] {
-        return DisplayRenderArea::create(displayWeak, sampledBounds, sampledBounds.getSize(),
+        return DisplayRenderArea::create(displayWeak, sampledBounds, sampledSize,
                                          ui::Dataspace::V0_SRGB, kHintForSeamlessTransition);
     });
 
@@ -353,16 +421,41 @@ void RegionSamplingThread::captureSample() {
         getLayerSnapshots = RenderArea::fromTraverseLayersLambda(traverseLayers);
     }
 
+    // Gathering the layers is cheap next to rendering them and reading the result back, so the
+    // content under the sampling areas is hashed first, on the main thread. If it is the same as
+    // for the last sample, there is no capture, and no sample is taken.
+    auto contentHashFuture = mFlinger.mScheduler->schedule(
+            [&] { return hashSampledContent(getLayerSnapshots(), descriptorsHash); });
+    const std::optional<size_t> contentHash = contentHashFuture.get();
+    if (contentHash && contentHash == mLastContentHash) {
+        ALOGV("Skipping sample, as the sampled content did not change");
+        ATRACE_INT(lumaSamplingStepTag, static_cast<int>(samplingStep::noWorkNeeded));
+        return;
+    }
+    // The capture gathers the layers again.
+    listeners.clear();
+
     std::shared_ptr<renderengine::ExternalTexture> buffer = nullptr;
-    if (mCachedBuffer && mCachedBuffer->getBuffer()->getWidth() == sampledBounds.getWidth() &&
-        mCachedBuffer->getBuffer()->getHeight() == sampledBounds.getHeight()) {
+    if (mCachedBuffer &&
+        mCachedBuffer->getBuffer()->getWidth() == static_cast<uint32_t>(sampledSize.width) &&
+        mCachedBuffer->getBuffer()->getHeight() == static_cast<uint32_t>(sampledSize.height)) {
         buffer = mCachedBuffer;
     } else {
         const uint32_t usage =
                 GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_TEXTURE;
-        sp<GraphicBuffer> graphicBuffer =
-                sp<GraphicBuffer>::make(sampledBounds.getWidth(), sampledBounds.getHeight(),
-                                        PIXEL_FORMAT_RGBA_8888, 1, usage, "RegionSamplingThread");
+        // The buffer never leaves SurfaceFlinger, so it can be recycled once the sampled size
+        // changes back.
+        sp<GraphicBuffer> graphicBuffer = sp<GraphicBuffer>::make(
+                GraphicBufferAllocator::AllocationRequest{.importBuffer = true,
+                                                          .width = static_cast<uint32_t>(
+                                                                  sampledSize.width),
+                                                          .height = static_cast<uint32_t>(
+                                                                  sampledSize.height),
+                                                          .format = PIXEL_FORMAT_RGBA_8888,
+                                                          .layerCount = 1,
+                                                          .usage = usage,
+                                                          .requestorName = "RegionSamplingThread",
+                                                          .recyclable = true});
         const status_t bufferStatus = graphicBuffer->initCheck();
         LOG_ALWAYS_FATAL_IF(bufferStatus != OK, "captureSample: Buffer failed to allocate: %d",
                             bufferStatus);
@@ -384,6 +477,8 @@ void RegionSamplingThread::captureSample() {
         fenceResult.value()->waitForever(LOG_TAG);
     }
 
+    mCachedBuffer = buffer;
+
     std::vector<Descriptor> activeDescriptors;
     for (const auto& descriptor : descriptors) {
         if (listeners.count(descriptor.listener) != 0) {
@@ -392,7 +487,7 @@ void RegionSamplingThread::captureSample() {
     }
 
     ALOGV("Sampling %zu descriptors", activeDescriptors.size());
-    std::vector<float> lumas = sampleBuffer(buffer->getBuffer(), sampledBounds.leftTop(),
+    std::vector<float> lumas = sampleBuffer(buffer->getBuffer(), sampledBounds.leftTop(), downscale,
                                             activeDescriptors, orientation);
     if (lumas.size() != activeDescriptors.size()) {
         ALOGW("collected %zu median luma values for %zu descriptors", lumas.size(),
@@ -404,7 +499,7 @@ void RegionSamplingThread::captureSample() {
         activeDescriptors[d].listener->onSampleCollected(lumas[d]);
     }
 
-    mCachedBuffer = buffer;
+    mLastContentHash = contentHash;
     ATRACE_INT(lumaSamplingStepTag, static_cast<int>(samplingStep::noWorkNeeded));
 }
 
@@ -28,6 +28,7 @@
 #include <condition_variable>
 #include <cstdint>
 #include <mutex>
+#include <optional>
 #include <thread>
 #include <unordered_map>
 
@@ -45,6 +46,10 @@ using gui::IRegionSamplingListener;
 float sampleArea(const uint32_t* data, int32_t width, int32_t height, int32_t stride,
                  uint32_t orientation, const Rect& area);
 
+// Maps a sampling area in display space to the sample buffer, which holds the region at leftTop
+// downscaled by the given factor. The result is rounded outwards so that it is never empty.
+Rect scaleSampleArea(const Rect& area, const Point& leftTop, int32_t downscale);
+
 class RegionSamplingThread : public IBinder::DeathRecipient {
 public:
     struct TimingTunables {
@@ -91,8 +96,13 @@ private:
         sp<IRegionSamplingListener> listener;
     };
 
+    // The sampled region is rendered downscaled by up to this factor, so that the GPU does most of
+    // the averaging and only a small buffer is read back, but never so much that a sampling area
+    // would be smaller than a pixel.
+    static constexpr int32_t kMaxSampleDownscale = 4;
+
     std::vector<float> sampleBuffer(
-            const sp<GraphicBuffer>& buffer, const Point& leftTop,
+            const sp<GraphicBuffer>& buffer, const Point& leftTop, int32_t downscale,
             const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation);
 
     void doSample(std::optional<std::chrono::steady_clock::time_point> samplingDeadline);
@@ -120,6 +130,10 @@ private:
     std::unordered_map<wp<IBinder>, Descriptor, WpHash> mDescriptors GUARDED_BY(mSamplingMutex);
     std::shared_ptr<renderengine::ExternalTexture> mCachedBuffer GUARDED_BY(mSamplingMutex) =
             nullptr;
+    // Hash of the listeners and of the content under their areas when the last sample was taken.
+    // If neither changed, no sample is taken, as the lumas would be the same. Unset if a sampled
+    // layer could draw new content without the hash changing.
+    std::optional<size_t> mLastContentHash GUARDED_BY(mSamplingMutex);
 };
 
 } // namespace android
@@ -82,8 +82,9 @@ std::string toString(VSyncRequest request) {
 }
 
 std::string toString(const EventThreadConnection& connection) {
-    return StringPrintf("Connection{%p, %s}", &connection,
-                        toString(connection.vsyncRequest).c_str());
+    return StringPrintf("Connection{%p, %s%s}", &connection,
+                        toString(connection.vsyncRequest).c_str(),
+                        connection.sharedVsyncWakeFd.ok() ? ", shared vsync" : "");
 }
 
 std::string toString(const DisplayEventReceiver::Event& event) {
@@ -243,6 +244,13 @@ binder::Status EventThreadConnection::getSchedulingPolicy(gui::SchedulingPolicy*
     return gui::getSchedulingPolicy(outPolicy);
 }
 
+binder::Status EventThreadConnection::getSharedVsyncChannel(gui::SharedVsyncChannel* outChannel) {
+    ATRACE_CALL();
+    return binder::Status::fromStatusT(
+            mEventThread->createSharedVsyncChannel(sp<EventThreadConnection>::fromExisting(this),
+                                                   outChannel));
+}
+
 status_t EventThreadConnection::postEvent(const DisplayEventReceiver::Event& event) {
     constexpr auto toStatus = [](ssize_t size) {
         return size < 0 ? status_t(size) : status_t(NO_ERROR);
@@ -410,6 +418,26 @@ VsyncEventData EventThread::getLatestVsyncEventData(
     return vsyncEventData;
 }
 
+status_t EventThread::createSharedVsyncChannel(const sp<EventThreadConnection>& connection,
+                                               gui::SharedVsyncChannel* outChannel) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (!mSharedVsyncChannel) {
+        mSharedVsyncChannel = gui::SharedVsyncChannel::create();
+        if (!mSharedVsyncChannel) {
+            return NAME_NOT_FOUND;
+        }
+    }
+
+    base::unique_fd wakeFd;
+    if (const status_t status = mSharedVsyncChannel->makeReader(outChannel, &wakeFd);
+        status != NO_ERROR) {
+        return status;
+    }
+    connection->sharedVsyncWakeFd = std::move(wakeFd);
+    return NO_ERROR;
+}
+
 void EventThread::enableSyntheticVsync(bool enable) {
     std::lock_guard<std::mutex> lock(mMutex);
     if (!mVSyncState || mVSyncState->synthetic == enable) {
@@ -498,12 +526,13 @@ void EventThread::threadMain(std::unique_lock<std::mutex>& lock) {
         }
 
         bool vsyncRequested = false;
+        ThrottleDecisions throttleDecisions;
 
         // Find connections that should consume this event.
         auto it = mDisplayEventConnections.begin();
         while (it != mDisplayEventConnections.end()) {
             if (const auto connection = it->promote()) {
-                if (event && shouldConsumeEvent(*event, connection)) {
+                if (event && shouldConsumeEvent(*event, connection, throttleDecisions)) {
                     consumers.push_back(connection);
                 }
 
@@ -569,18 +598,32 @@ void EventThread::threadMain(std::unique_lock<std::mutex>& lock) {
 }
 
 bool EventThread::shouldConsumeEvent(const DisplayEventReceiver::Event& event,
-                                     const sp<EventThreadConnection>& connection) const {
+                                     const sp<EventThreadConnection>& connection,
+                                     ThrottleDecisions& throttleDecisions) const {
     const auto throttleVsync = [&]() REQUIRES(mMutex) {
         const auto& vsyncData = event.vsync.vsyncData;
         if (connection->frameRate.isValid()) {
-            return !mVsyncSchedule->getTracker()
-                            .isVSyncInPhase(vsyncData.preferredExpectedPresentationTime(),
-                                            connection->frameRate);
+            const nsecs_t period = connection->frameRate.getPeriodNsecs();
+            if (const auto throttled = throttleDecisions.byFrameRatePeriod.get(period)) {
+                return throttled->get();
+            }
+            const bool throttled =
+                    !mVsyncSchedule->getTracker()
+                             .isVSyncInPhase(vsyncData.preferredExpectedPresentationTime(),
+                                             connection->frameRate);
+            throttleDecisions.byFrameRatePeriod.try_emplace(period, throttled);
+            return throttled;
         }
 
+        const uid_t uid = connection->mOwnerUid;
+        if (const auto throttled = throttleDecisions.byUid.get(uid)) {
+            return throttled->get();
+        }
         const auto expectedPresentTime =
-                TimePoint::fromNs(event.vsync.vsyncData.preferredExpectedPresentationTime());
-        return mCallback.throttleVsync(expectedPresentTime, connection->mOwnerUid);
+                TimePoint::fromNs(vsyncData.preferredExpectedPresentationTime());
+        const bool throttled = mCallback.throttleVsync(expectedPresentTime, uid);
+        throttleDecisions.byUid.try_emplace(uid, throttled);
+        return throttled;
     };
 
     switch (event.header.type) {
@@ -700,14 +743,62 @@ void EventThread::generateFrameTimeline(VsyncEventData& outVsyncEventData, nsecs
 
 void EventThread::dispatchEvent(const DisplayEventReceiver::Event& event,
                                 const DisplayEventConsumers& consumers) {
+    // The frame interval of the vsync published to the shared vsync channel, once it is.
+    std::optional<nsecs_t> sharedFrameInterval;
+
+    // Connections of the same uid get the same frame interval, and connections of the same frame
+    // interval the same frame timelines, so that a vsync generates one set of tokens per rate
+    // rather than one per connection.
+    ftl::SmallMap<uid_t, nsecs_t, 8> frameIntervals;
+    ftl::SmallMap<nsecs_t, VsyncEventData, 4> vsyncEventData;
+
+    const auto frameIntervalOf = [&](uid_t uid) REQUIRES(mMutex) {
+        if (const auto frameInterval = frameIntervals.get(uid)) {
+            return frameInterval->get();
+        }
+        const nsecs_t frameInterval = mCallback.getVsyncPeriod(uid).ns();
+        frameIntervals.try_emplace(uid, frameInterval);
+        return frameInterval;
+    };
+
+    const auto vsyncEventDataOf = [&](nsecs_t frameInterval) -> const VsyncEventData& {
+        if (const auto data = vsyncEventData.get(frameInterval)) {
+            return data->get();
+        }
+        VsyncEventData data = event.vsync.vsyncData;
+        data.frameInterval = frameInterval;
+        generateFrameTimeline(data, frameInterval, event.header.timestamp,
+                              event.vsync.vsyncData.preferredExpectedPresentationTime(),
+                              event.vsync.vsyncData.preferredDeadlineTimestamp());
+        return vsyncEventData.try_emplace(frameInterval, data).first->second;
+    };
+
     for (const auto& consumer : consumers) {
         DisplayEventReceiver::Event copy = event;
         if (event.header.type == DisplayEventReceiver::DISPLAY_EVENT_VSYNC) {
-            const Period frameInterval = mCallback.getVsyncPeriod(consumer->mOwnerUid);
-            copy.vsync.vsyncData.frameInterval = frameInterval.ns();
-            generateFrameTimeline(copy.vsync.vsyncData, frameInterval.ns(), copy.header.timestamp,
-                                  event.vsync.vsyncData.preferredExpectedPresentationTime(),
-                                  event.vsync.vsyncData.preferredDeadlineTimestamp());
+            const nsecs_t frameInterval = frameIntervalOf(consumer->mOwnerUid);
+            if (consumer->sharedVsyncWakeFd.ok()) {
+                if (!sharedFrameInterval) {
+                    gui::SharedVsyncChannel::Vsync vsync{.timestamp = event.header.timestamp,
+                                                         .displayId = event.header.displayId,
+                                                         .count = event.vsync.count};
+                    vsync.vsyncData = vsyncEventDataOf(frameInterval);
+                    mSharedVsyncChannel->publish(vsync);
+                    sharedFrameInterval = frameInterval;
+                }
+
+                // A connection with another frame interval still gets its own frame timelines
+                // through its BitTube.
+                if (*sharedFrameInterval == frameInterval) {
+                    const status_t status =
+                            gui::SharedVsyncChannel::wake(consumer->sharedVsyncWakeFd.get());
+                    ALOGW_IF(status != NO_ERROR, "Failed waking up %s for %s: %s",
+                             toString(*consumer).c_str(), toString(event).c_str(),
+                             strerror(-status));
+                    continue;
+                }
+            }
+            copy.vsync.vsyncData = vsyncEventDataOf(frameInterval);
         }
         switch (consumer->postEvent(copy)) {
             case NO_ERROR:
@@ -17,9 +17,12 @@
 #pragma once
 
 #include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
 #include <android/gui/BnDisplayEventConnection.h>
+#include <ftl/small_map.h>
 #include <gui/DisplayEventReceiver.h>
 #include <private/gui/BitTube.h>
+#include <private/gui/SharedVsyncChannel.h>
 #include <sys/types.h>
 #include <utils/Errors.h>
 
@@ -79,8 +82,12 @@ public:
     binder::Status requestNextVsync() override; // asynchronous
     binder::Status getLatestVsyncEventData(ParcelableVsyncEventData* outVsyncEventData) override;
     binder::Status getSchedulingPolicy(gui::SchedulingPolicy* outPolicy) override;
+    binder::Status getSharedVsyncChannel(gui::SharedVsyncChannel* outChannel) override;
 
     VSyncRequest vsyncRequest = VSyncRequest::None;
+    // Wakes up the connection once a vsync for it was published to the shared vsync channel, if
+    // it uses one instead of mChannel for vsync events.
+    base::unique_fd sharedVsyncWakeFd;
     const uid_t mOwnerUid;
     const EventRegistrationFlags mEventRegistration;
 
@@ -129,6 +136,9 @@ public:
     virtual void requestNextVsync(const sp<EventThreadConnection>& connection) = 0;
     virtual VsyncEventData getLatestVsyncEventData(
             const sp<EventThreadConnection>& connection) const = 0;
+    // Moves the vsync events of the connection to the shared vsync channel of this thread.
+    virtual status_t createSharedVsyncChannel(const sp<EventThreadConnection>& connection,
+                                              gui::SharedVsyncChannel* outChannel) = 0;
 
     virtual void onNewVsyncSchedule(std::shared_ptr<scheduler::VsyncSchedule>) = 0;
 
@@ -162,6 +172,8 @@ public:
     void requestNextVsync(const sp<EventThreadConnection>& connection) override;
     VsyncEventData getLatestVsyncEventData(
             const sp<EventThreadConnection>& connection) const override;
+    status_t createSharedVsyncChannel(const sp<EventThreadConnection>& connection,
+                                      gui::SharedVsyncChannel* outChannel) override;
 
     void enableSyntheticVsync(bool) override;
 
@@ -189,10 +201,18 @@ private:
 
     using DisplayEventConsumers = std::vector<sp<EventThreadConnection>>;
 
+    // Whether a vsync is throttled is the same for every connection of a uid, or of a frame rate,
+    // so it is decided once per event for each of them.
+    struct ThrottleDecisions {
+        ftl::SmallMap<uid_t, bool, 8> byUid;
+        ftl::SmallMap<nsecs_t, bool, 4> byFrameRatePeriod;
+    };
+
     void threadMain(std::unique_lock<std::mutex>& lock) REQUIRES(mMutex);
 
     bool shouldConsumeEvent(const DisplayEventReceiver::Event& event,
-                            const sp<EventThreadConnection>& connection) const REQUIRES(mMutex);
+                            const sp<EventThreadConnection>& connection,
+                            ThrottleDecisions& throttleDecisions) const REQUIRES(mMutex);
     void dispatchEvent(const DisplayEventReceiver::Event& event,
                        const DisplayEventConsumers& consumers) REQUIRES(mMutex);
 
@@ -232,6 +252,10 @@ private:
     std::vector<wp<EventThreadConnection>> mDisplayEventConnections GUARDED_BY(mMutex);
     std::deque<DisplayEventReceiver::Event> mPendingEvents GUARDED_BY(mMutex);
 
+    // Created for the first connection which asks for it. Each vsync is published to it once for
+    // all the connections using it, unless their frame interval differs.
+    std::unique_ptr<gui::SharedVsyncChannel> mSharedVsyncChannel GUARDED_BY(mMutex);
+
     // VSYNC state of connected display.
     struct VSyncState {
         explicit VSyncState(PhysicalDisplayId displayId) : displayId(displayId) {}
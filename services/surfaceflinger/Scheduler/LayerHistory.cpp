@@ -195,6 +195,7 @@ auto LayerHistory::summarize(const RefreshRateSelector& selector, nsecs_t now) -
     std::lock_guard lock(mLock);
 
     partitionLayers(now);
+    summary.reserve(mActiveLayerInfos.size());
 
     for (const auto& [key, value] : mActiveLayerInfos) {
         auto& info = value.second;
@@ -218,11 +219,14 @@ auto LayerHistory::summarize(const RefreshRateSelector& selector, nsecs_t now) -
 
             const float layerArea = transformed.getWidth() * transformed.getHeight();
             float weight = mDisplayArea ? layerArea / mDisplayArea : 0.0f;
-            const std::string categoryString = vote.category == FrameRateCategory::Default
-                    ? ""
-                    : base::StringPrintf("category=%s", ftl::enum_string(vote.category).c_str());
-            ATRACE_FORMAT_INSTANT("%s %s %s (%.2f)", ftl::enum_string(vote.type).c_str(),
-                                  to_string(vote.fps).c_str(), categoryString.c_str(), weight);
+            if (ATRACE_ENABLED()) {
+                const std::string categoryString = vote.category == FrameRateCategory::Default
+                        ? ""
+                        : base::StringPrintf("category=%s",
+                                             ftl::enum_string(vote.category).c_str());
+                ATRACE_FORMAT_INSTANT("%s %s %s (%.2f)", ftl::enum_string(vote.type).c_str(),
+                                      to_string(vote.fps).c_str(), categoryString.c_str(), weight);
+            }
             summary.push_back({info->getName(), info->getOwnerUid(), vote.type, vote.fps,
                                vote.seamlessness, vote.category, vote.categorySmoothSwitchOnly,
                                weight, layerFocused});
@@ -253,7 +257,10 @@ void LayerHistory::partitionLayers(nsecs_t now) {
             if (CC_UNLIKELY(mTraceEnabled)) {
                 trace(*info, LayerVoteType::NoVote, 0);
             }
-            info->onLayerInactive(now);
+            // Layers that stay inactive were already reset, and have no frames to discard.
+            if (!info->isInactiveSinceLastUpdate()) {
+                info->onLayerInactive(now);
+            }
             it++;
         }
     }
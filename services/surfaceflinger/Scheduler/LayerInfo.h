@@ -224,8 +224,13 @@ public:
         mLastRefreshRate = {};
         mRefreshRateHistory.clear();
         mIsFrequencyConclusive = true;
+        mInactiveSinceLastUpdate = true;
     }
 
+    // Whether onLayerInactive was called since the layer was last updated, in which case
+    // calling it again has no effect on the heuristics.
+    bool isInactiveSinceLastUpdate() const { return mInactiveSinceLastUpdate; }
+
     void clearHistory(nsecs_t now) {
         onLayerInactive(now);
         mFrameTimes.clear();
@@ -342,6 +347,7 @@ private:
     std::deque<FrameTimeData> mFrameTimes;
     std::chrono::time_point<std::chrono::steady_clock> mFrameTimeValidSince =
             std::chrono::steady_clock::now();
+    bool mInactiveSinceLastUpdate = false;
     static constexpr size_t HISTORY_SIZE = RefreshRateHistory::HISTORY_SIZE;
     static constexpr std::chrono::nanoseconds HISTORY_DURATION = LayerHistory::kMaxPeriodForHistory;
 
@@ -167,12 +167,36 @@ void MessageQueue::waitMessage() {
     } while (true);
 }
 
+namespace {
+
+// Finishes the pending composition before handling the message. See
+// ICompositor::finishPendingComposite.
+class AfterCompositeHandler final : public MessageHandler {
+public:
+    AfterCompositeHandler(ICompositor& compositor, sp<MessageHandler>&& handler)
+          : mCompositor(compositor), mHandler(std::move(handler)) {}
+
+    void handleMessage(const Message& message) override {
+        mCompositor.finishPendingComposite();
+        mHandler->handleMessage(message);
+    }
+
+private:
+    ICompositor& mCompositor;
+    const sp<MessageHandler> mHandler;
+};
+
+} // namespace
+
 void MessageQueue::postMessage(sp<MessageHandler>&& handler) {
-    mLooper->sendMessage(handler, Message());
+    mLooper->sendMessage(sp<AfterCompositeHandler>::make(mCompositor, std::move(handler)),
+                         Message());
 }
 
 void MessageQueue::postMessageDelayed(sp<MessageHandler>&& handler, nsecs_t uptimeDelay) {
-    mLooper->sendMessageDelayed(uptimeDelay, handler, Message());
+    mLooper->sendMessageDelayed(uptimeDelay,
+                                sp<AfterCompositeHandler>::make(mCompositor, std::move(handler)),
+                                Message());
 }
 
 void MessageQueue::scheduleConfigure() {
@@ -18,31 +18,16 @@
 #include <utils/Log.h>
 #include <utils/Timers.h>
 #include <chrono>
-#include <sstream>
-#include <thread>
-
-namespace {
-using namespace std::chrono_literals;
-
-constexpr int64_t kNsToSeconds = std::chrono::duration_cast<std::chrono::nanoseconds>(1s).count();
-
-// The syscall interface uses a pair of integers for the timestamp. The first
-// (tv_sec) is the whole count of seconds. The second (tv_nsec) is the
-// nanosecond part of the count. This function takes care of translation.
-void calculateTimeoutTime(std::chrono::nanoseconds timestamp, timespec* spec) {
-    const nsecs_t timeout = systemTime(CLOCK_MONOTONIC) + timestamp.count();
-    spec->tv_sec = static_cast<__kernel_time_t>(timeout / kNsToSeconds);
-    spec->tv_nsec = timeout % kNsToSeconds;
-}
-} // namespace
 
 namespace android {
 namespace scheduler {
 
 OneShotTimer::OneShotTimer(std::string name, const Interval& interval,
                            const ResetCallback& resetCallback,
-                           const TimeoutCallback& timeoutCallback, std::unique_ptr<Clock> clock)
-      : mClock(std::move(clock)),
+                           const TimeoutCallback& timeoutCallback, std::unique_ptr<Clock> clock,
+                           TimerService& service)
+      : mService(service),
+        mClock(std::move(clock)),
         mName(std::move(name)),
         mInterval(interval),
         mResetCallback(resetCallback),
@@ -56,103 +41,72 @@ OneShotTimer::~OneShotTimer() {
 }
 
 void OneShotTimer::start() {
-    int result = sem_init(&mSemaphore, 0, 0);
-    LOG_ALWAYS_FATAL_IF(result, "sem_init failed");
-
-    if (!mThread.joinable()) {
-        // Only create thread if it has not been created.
-        mThread = std::thread(&OneShotTimer::loop, this);
+    // Only start if not already started.
+    if (mStarted.exchange(true)) {
+        return;
     }
+
+    mStopTriggered = false;
+    mState = TimerState::RESET;
+    mService.wakeUpAt(*this, systemTime(SYSTEM_TIME_MONOTONIC));
 }
 
 void OneShotTimer::stop() {
     mStopTriggered = true;
-    int result = sem_post(&mSemaphore);
-    LOG_ALWAYS_FATAL_IF(result, "sem_post failed");
 
-    if (mThread.joinable()) {
-        mThread.join();
-        result = sem_destroy(&mSemaphore);
-        LOG_ALWAYS_FATAL_IF(result, "sem_destroy failed");
-    }
+    // No callback runs once the service returns, and none is pending.
+    mService.cancel(*this);
+    mWaiting = false;
+    mState = TimerState::STOPPED;
+    mStarted = false;
 }
 
-void OneShotTimer::loop() {
-    if (pthread_setname_np(pthread_self(), mName.c_str())) {
-        ALOGW("Failed to set thread name on dispatch thread");
-    }
-
-    TimerState state = TimerState::RESET;
-    while (true) {
-        bool triggerReset = false;
-        bool triggerTimeout = false;
-
-        state = checkForResetAndStop(state);
-        if (state == TimerState::STOPPED) {
-            break;
-        }
-
-        if (state == TimerState::IDLE) {
-            int result = sem_wait(&mSemaphore);
-            if (result && errno != EINTR) {
-                std::stringstream ss;
-                ss << "sem_wait failed (" << errno << ")";
-                LOG_ALWAYS_FATAL("%s", ss.str().c_str());
-            }
-            continue;
-        }
-
-        if (state == TimerState::RESET) {
-            triggerReset = true;
-        }
-
-        if (triggerReset && mResetCallback) {
-            mResetCallback();
-        }
-
-        state = checkForResetAndStop(state);
-        if (state == TimerState::STOPPED) {
-            break;
-        }
+void OneShotTimer::onTimerServiceWakeup() {
+    mWaiting = false;
 
-        auto triggerTime = mClock->now() + mInterval;
-        state = TimerState::WAITING;
-        while (true) {
-            // Wait until triggerTime time to check if we need to reset or drop into the idle state.
-            if (const auto triggerInterval = triggerTime - mClock->now(); triggerInterval > 0ns) {
-                mWaiting = true;
-                struct timespec ts;
-                calculateTimeoutTime(triggerInterval, &ts);
-                int result = sem_clockwait(&mSemaphore, CLOCK_MONOTONIC, &ts);
-                if (result && errno != ETIMEDOUT && errno != EINTR) {
-                    std::stringstream ss;
-                    ss << "sem_clockwait failed (" << errno << ")";
-                    LOG_ALWAYS_FATAL("%s", ss.str().c_str());
-                }
-            }
-
-            mWaiting = false;
-            state = checkForResetAndStop(state);
-            if (state == TimerState::STOPPED) {
-                break;
-            }
+    const TimerState previousState = mState;
+    TimerState state = checkForResetAndStop(previousState);
+    if (state == TimerState::STOPPED || state == TimerState::IDLE) {
+        mState = state;
+        return;
+    }
 
-            if (state == TimerState::WAITING && (triggerTime - mClock->now()) <= 0ns) {
-                triggerTimeout = true;
-                state = TimerState::IDLE;
-                break;
+    if (state == TimerState::RESET) {
+        if (previousState == TimerState::WAITING) {
+            // A reset while waiting only moves the trigger time.
+            mTriggerTime = mLastResetTime.load() + mInterval;
+        } else {
+            // The timer restarts from the reset, rather than from the return of its callback.
+            const auto resetTime = mClock->now();
+            if (mResetCallback) {
+                mResetCallback();
             }
 
-            if (state == TimerState::RESET) {
-                triggerTime = mLastResetTime.load() + mInterval;
-                state = TimerState::WAITING;
+            if (checkForResetAndStop(state) == TimerState::STOPPED) {
+                mState = TimerState::STOPPED;
+                return;
             }
+            mTriggerTime = resetTime + mInterval;
         }
+    }
 
-        if (triggerTimeout && mTimeoutCallback) {
+    // Wakeups within the slack of the service are the same wakeup, so the timer expires then.
+    const auto triggerInterval = mTriggerTime - mClock->now();
+    if (triggerInterval <= TimerService::kSlack) {
+        mState = TimerState::IDLE;
+        if (mTimeoutCallback) {
             mTimeoutCallback();
         }
+        return;
     }
+
+    // Check back for a reset or the timeout at the trigger time.
+    mState = TimerState::WAITING;
+    mWaiting = true;
+    mService.wakeUpAt(*this,
+                      systemTime(SYSTEM_TIME_MONOTONIC) +
+                              std::chrono::duration_cast<std::chrono::nanoseconds>(triggerInterval)
+                                      .count());
 }
 
 OneShotTimer::TimerState OneShotTimer::checkForResetAndStop(TimerState state) {
@@ -160,7 +114,7 @@ OneShotTimer::TimerState OneShotTimer::checkForResetAndStop(TimerState state) {
     if (mStopTriggered.exchange(false)) {
         return TimerState::STOPPED;
     }
-    // If the state was stopped, the thread was joined, and we cannot reset
+    // If the state was stopped, the timer is off the service, and we cannot reset
     // the timer anymore.
     if (state != TimerState::STOPPED && mResetTriggered.exchange(false)) {
         return TimerState::RESET;
@@ -171,11 +125,10 @@ OneShotTimer::TimerState OneShotTimer::checkForResetAndStop(TimerState state) {
 void OneShotTimer::reset() {
     mLastResetTime = mClock->now();
     mResetTriggered = true;
-    // If mWaiting is true, then we are guaranteed to be in a block where we are waiting on
-    // mSemaphore for a timeout, rather than idling. So we can avoid a sem_post call since we can
-    // just check that we triggered a reset on timeout.
-    if (!mWaiting) {
-        LOG_ALWAYS_FATAL_IF(sem_post(&mSemaphore), "sem_post failed");
+    // If mWaiting is true, then the timer is due to wake up at its trigger time, rather than
+    // idling. So we can avoid a wakeup since the reset is checked for on timeout.
+    if (!mWaiting && mStarted) {
+        mService.wakeUpAt(*this, systemTime(SYSTEM_TIME_MONOTONIC));
     }
 }
 
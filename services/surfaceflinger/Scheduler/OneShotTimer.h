@@ -16,11 +16,13 @@
 
 #pragma once
 
-#include <semaphore.h>
+#include <atomic>
 #include <chrono>
-#include <condition_variable>
-#include <thread>
+#include <functional>
+#include <memory>
+#include <string>
 #include "../Clock.h"
+#include "TimerService.h"
 
 #include <android-base/thread_annotations.h>
 #include <scheduler/Time.h>
@@ -30,9 +32,9 @@ namespace scheduler {
 
 /*
  * Class that sets off a timer for a given interval, and fires a callback when the
- * interval expires.
+ * interval expires. The timers share the thread of a TimerService, which runs the callbacks.
  */
-class OneShotTimer {
+class OneShotTimer : private TimerService::Client {
 public:
     using Interval = std::chrono::milliseconds;
     using ResetCallback = std::function<void()>;
@@ -40,8 +42,9 @@ public:
 
     OneShotTimer(std::string name, const Interval& interval, const ResetCallback& resetCallback,
                  const TimeoutCallback& timeoutCallback,
-                 std::unique_ptr<android::Clock> clock = std::make_unique<SteadyClock>());
-    ~OneShotTimer();
+                 std::unique_ptr<android::Clock> clock = std::make_unique<SteadyClock>(),
+                 TimerService& service = TimerService::getInstance());
+    ~OneShotTimer() override;
 
     Duration interval() const { return mInterval; }
 
@@ -71,22 +74,18 @@ private:
         IDLE = 3
     };
 
-    // Function that loops until the condition for stopping is met.
-    void loop();
+    // Advances the state of the timer, and fires its callbacks, on the TimerService thread.
+    void onTimerServiceWakeup() override;
 
     // Checks whether mResetTriggered and mStopTriggered were set and updates
     // mState if so.
     TimerState checkForResetAndStop(TimerState state);
 
-    // Thread waiting for timer to expire.
-    std::thread mThread;
+    TimerService& mService;
 
     // Clock object for the timer. Mocked in unit tests.
     std::unique_ptr<android::Clock> mClock;
 
-    // Semaphore to keep mThread synchronized.
-    sem_t mSemaphore;
-
     // Timer's name.
     std::string mName;
 
@@ -105,7 +104,13 @@ private:
     std::atomic<bool> mResetTriggered = false;
     std::atomic<bool> mStopTriggered = false;
     std::atomic<bool> mWaiting = false;
+    std::atomic<bool> mStarted = false;
     std::atomic<std::chrono::steady_clock::time_point> mLastResetTime;
+
+    // Only advanced on the TimerService thread, except by start and stop, which wait for the
+    // timer to be off that thread.
+    std::atomic<TimerState> mState = TimerState::STOPPED;
+    std::chrono::steady_clock::time_point mTriggerTime;
 };
 
 } // namespace scheduler
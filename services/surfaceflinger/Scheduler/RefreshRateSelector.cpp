@@ -21,7 +21,9 @@
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wextra"
 
+#include <algorithm>
 #include <chrono>
+#include <cinttypes>
 #include <cmath>
 #include <deque>
 #include <map>
@@ -33,6 +35,7 @@
 #include <ftl/match.h>
 #include <ftl/unit.h>
 #include <gui/TraceUtils.h>
+#include <math/HashCombine.h>
 #include <scheduler/FrameRateMode.h>
 #include <utils/Trace.h>
 
@@ -477,16 +480,49 @@ auto RefreshRateSelector::getRankedFrameRates(const std::vector<LayerRequirement
                                               GlobalSignals signals) const -> RankedFrameRates {
     std::lock_guard lock(mLock);
 
-    if (mGetRankedFrameRatesCache &&
-        mGetRankedFrameRatesCache->arguments == std::make_pair(layers, signals)) {
-        return mGetRankedFrameRatesCache->result;
+    const size_t signature = getRankedFrameRatesSignature(layers, signals);
+    const auto it = std::find_if(mGetRankedFrameRatesCache.begin(),
+                                 mGetRankedFrameRatesCache.end(), [&](const auto& entry) {
+                                     return entry.signature == signature &&
+                                             entry.arguments.second == signals &&
+                                             entry.arguments.first == layers;
+                                 });
+    if (it != mGetRankedFrameRatesCache.end()) {
+        mGetRankedFrameRatesCacheHits++;
+        std::rotate(mGetRankedFrameRatesCache.begin(), it, std::next(it));
+        return mGetRankedFrameRatesCache.front().result;
     }
 
+    mGetRankedFrameRatesCacheMisses++;
     const auto result = getRankedFrameRatesLocked(layers, signals);
-    mGetRankedFrameRatesCache = GetRankedFrameRatesCache{{layers, signals}, result};
+    if (mGetRankedFrameRatesCache.size() == kGetRankedFrameRatesCacheSize) {
+        mGetRankedFrameRatesCache.pop_back();
+    }
+    mGetRankedFrameRatesCache.insert(mGetRankedFrameRatesCache.begin(),
+                                     GetRankedFrameRatesCache{signature, {layers, signals}, result});
     return result;
 }
 
+size_t RefreshRateSelector::getRankedFrameRatesSignature(
+        const std::vector<LayerRequirement>& layers, GlobalSignals signals) {
+    // Fps are compared approximately, so the signature only uses their integer part. Arguments
+    // that compare equal may then have different signatures, which only costs a cache miss.
+    size_t signature = hashCombine(signals.touch, signals.idle, signals.powerOnImminent,
+                                   layers.size());
+    for (const auto& layer : layers) {
+        hashCombineSingleHashed(signature,
+                                hashCombine(layer.name, layer.vote,
+                                            layer.desiredRefreshRate.getIntValue(),
+                                            layer.seamlessness, layer.frameRateCategory,
+                                            layer.weight, layer.focused));
+    }
+    return signature;
+}
+
+void RefreshRateSelector::clearGetRankedFrameRatesCache() const {
+    mGetRankedFrameRatesCache.clear();
+}
+
 auto RefreshRateSelector::getRankedFrameRatesLocked(const std::vector<LayerRequirement>& layers,
                                                     GlobalSignals signals) const
         -> RankedFrameRates {
@@ -1204,9 +1240,9 @@ const FrameRateMode& RefreshRateSelector::getActiveModeLocked() const {
 void RefreshRateSelector::setActiveMode(DisplayModeId modeId, Fps renderFrameRate) {
     std::lock_guard lock(mLock);
 
-    // Invalidate the cached invocation to getRankedFrameRates. This forces
+    // Invalidate the cached invocations of getRankedFrameRates. This forces
     // the refresh rate to be recomputed on the next call to getRankedFrameRates.
-    mGetRankedFrameRatesCache.reset();
+    clearGetRankedFrameRatesCache();
 
     const auto activeModeOpt = mDisplayModes.get(modeId);
     LOG_ALWAYS_FATAL_IF(!activeModeOpt);
@@ -1236,16 +1272,17 @@ void RefreshRateSelector::initializeIdleTimer() {
                     if (const auto callbacks = getIdleTimerCallbacks()) {
                         callbacks->onExpired();
                     }
-                });
+                },
+                std::make_unique<SteadyClock>(), TimerService::getPolicyInstance());
     }
 }
 
 void RefreshRateSelector::updateDisplayModes(DisplayModes modes, DisplayModeId activeModeId) {
     std::lock_guard lock(mLock);
 
-    // Invalidate the cached invocation to getRankedFrameRates. This forces
+    // Invalidate the cached invocations of getRankedFrameRates. This forces
     // the refresh rate to be recomputed on the next call to getRankedFrameRates.
-    mGetRankedFrameRatesCache.reset();
+    clearGetRankedFrameRatesCache();
 
     mDisplayModes = std::move(modes);
     const auto activeModeOpt = mDisplayModes.get(activeModeId);
@@ -1345,7 +1382,7 @@ auto RefreshRateSelector::setPolicy(const PolicyVariant& policy) -> SetPolicyRes
             return SetPolicyResult::Invalid;
         }
 
-        mGetRankedFrameRatesCache.reset();
+        clearGetRankedFrameRatesCache();
 
         if (*getCurrentPolicyLocked() == oldPolicy) {
             return SetPolicyResult::Unchanged;
@@ -1533,6 +1570,17 @@ void RefreshRateSelector::dump(utils::Dumper& dumper) const {
 
     dumper.dump("frameRateOverrideConfig"sv, *ftl::enum_name(mFrameRateOverrideConfig));
 
+    const uint64_t lookups = mGetRankedFrameRatesCacheHits + mGetRankedFrameRatesCacheMisses;
+    const float hitPercent = lookups == 0
+            ? 0.f
+            : 100.f * static_cast<float>(mGetRankedFrameRatesCacheHits) /
+                    static_cast<float>(lookups);
+    dumper.dump("rankedFrameRatesCache"sv,
+                base::StringPrintf("%zu entries, %" PRIu64 " hits, %" PRIu64 " misses (%.1f%%)",
+                                   mGetRankedFrameRatesCache.size(),
+                                   mGetRankedFrameRatesCacheHits, mGetRankedFrameRatesCacheMisses,
+                                   hitPercent));
+
     dumper.dump("idleTimer"sv);
     {
         utils::Dumper::Indent indent(dumper);
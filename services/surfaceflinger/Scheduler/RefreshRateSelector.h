@@ -533,11 +533,24 @@ private:
 
     Config::FrameRateOverride mFrameRateOverrideConfig;
 
+    // The scheduler tends to alternate between a few sets of arguments, e.g. as touch boost comes
+    // and goes, so the results for the most recent ones are kept. An entry is found by the
+    // signature of its arguments, and then compared in full. The cache is cleared whenever the
+    // display modes or the policy change.
     struct GetRankedFrameRatesCache {
+        size_t signature;
         std::pair<std::vector<LayerRequirement>, GlobalSignals> arguments;
         RankedFrameRates result;
     };
-    mutable std::optional<GetRankedFrameRatesCache> mGetRankedFrameRatesCache GUARDED_BY(mLock);
+    static constexpr size_t kGetRankedFrameRatesCacheSize = 4;
+    static size_t getRankedFrameRatesSignature(const std::vector<LayerRequirement>&,
+                                               GlobalSignals);
+    void clearGetRankedFrameRatesCache() const REQUIRES(mLock);
+
+    // Ordered from the most recently used entry.
+    mutable std::vector<GetRankedFrameRatesCache> mGetRankedFrameRatesCache GUARDED_BY(mLock);
+    mutable uint64_t mGetRankedFrameRatesCacheHits GUARDED_BY(mLock) = 0;
+    mutable uint64_t mGetRankedFrameRatesCacheMisses GUARDED_BY(mLock) = 0;
 
     // Declare mIdleTimer last to ensure its thread joins before the mutex/callbacks are destroyed.
     std::mutex mIdleTimerCallbacksMutex;
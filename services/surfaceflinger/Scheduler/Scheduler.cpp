@@ -104,7 +104,8 @@ void Scheduler::startTimers() {
         mTouchTimer.emplace(
                 "TouchTimer", std::chrono::milliseconds(millis),
                 [this] { touchTimerCallback(TimerState::Reset); },
-                [this] { touchTimerCallback(TimerState::Expired); });
+                [this] { touchTimerCallback(TimerState::Expired); }, std::make_unique<SteadyClock>(),
+                TimerService::getPolicyInstance());
         mTouchTimer->start();
     }
 
@@ -112,7 +113,8 @@ void Scheduler::startTimers() {
         mDisplayPowerTimer.emplace(
                 "DisplayPowerTimer", std::chrono::milliseconds(millis),
                 [this] { displayPowerTimerCallback(TimerState::Reset); },
-                [this] { displayPowerTimerCallback(TimerState::Expired); });
+                [this] { displayPowerTimerCallback(TimerState::Expired); },
+                std::make_unique<SteadyClock>(), TimerService::getPolicyInstance());
         mDisplayPowerTimer->start();
     }
 }
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "TimerService"
+
+#include "TimerService.h"
+
+#include <pthread.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+
+#include <log/log.h>
+
+namespace android::scheduler {
+
+namespace {
+
+constexpr nsecs_t kNsPerSecond = 1'000'000'000;
+
+} // namespace
+
+TimerService& TimerService::getInstance() {
+    static TimerService& sInstance = *new TimerService("TimerService");
+    return sInstance;
+}
+
+TimerService& TimerService::getPolicyInstance() {
+    static TimerService& sInstance = *new TimerService("PolicyTimers");
+    return sInstance;
+}
+
+TimerService::TimerService(std::string name)
+      : mName(std::move(name)), mTimerFd(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC)) {
+    LOG_ALWAYS_FATAL_IF(!mTimerFd.ok(), "timerfd_create failed (%d)", errno);
+    mThread = std::thread(&TimerService::threadMain, this);
+}
+
+TimerService::~TimerService() {
+    {
+        std::lock_guard lock(mMutex);
+        mStopping = true;
+        // Set the timer in the past so that the thread wakes up right away.
+        setTimerLocked(1);
+    }
+    mThread.join();
+}
+
+void TimerService::wakeUpAt(Client& client, nsecs_t wakeupTime) {
+    std::lock_guard lock(mMutex);
+    if (mStopping) return;
+
+    const auto [it, inserted] = mWakeupTimes.try_emplace(&client, wakeupTime);
+    if (!inserted) {
+        if (it->second <= wakeupTime) return;
+        it->second = wakeupTime;
+    }
+    mWakeups.push({wakeupTime, &client});
+
+    if (mArmedTime == 0 || wakeupTime < mArmedTime) {
+        setTimerLocked(wakeupTime);
+    }
+}
+
+void TimerService::cancel(Client& client) {
+    std::unique_lock lock(mMutex);
+    if (!isServiceThread()) {
+        mWakeupDone.wait(lock, [&]() REQUIRES(mMutex) { return mRunningClient != &client; });
+    }
+
+    // Erased after the wait, in case the client asked for another wakeup in the meantime.
+    if (mWakeupTimes.erase(&client) > 0) {
+        armTimerLocked();
+    }
+}
+
+void TimerService::armTimerLocked() {
+    // Drop the wakeups which are no longer current, so that they do not wake up the thread.
+    while (!mWakeups.empty()) {
+        const Wakeup& wakeup = mWakeups.top();
+        const auto it = mWakeupTimes.find(wakeup.client);
+        if (it != mWakeupTimes.end() && it->second == wakeup.time) break;
+        mWakeups.pop();
+    }
+
+    const nsecs_t time = mWakeups.empty() ? 0 : mWakeups.top().time;
+    if (time != mArmedTime) {
+        setTimerLocked(time);
+    }
+}
+
+void TimerService::setTimerLocked(nsecs_t time) {
+    const itimerspec spec{.it_interval = {.tv_sec = 0, .tv_nsec = 0},
+                          .it_value = {.tv_sec = static_cast<time_t>(time / kNsPerSecond),
+                                       .tv_nsec = static_cast<long>(time % kNsPerSecond)}};
+
+    // A zero time disarms the timer.
+    if (timerfd_settime(mTimerFd.get(), TFD_TIMER_ABSTIME, &spec, nullptr)) {
+        ALOGE("%s: timerfd_settime failed (%d)", __func__, errno);
+        return;
+    }
+    mArmedTime = time;
+}
+
+void TimerService::threadMain() {
+    if (pthread_setname_np(pthread_self(), mName.c_str())) {
+        ALOGW("Failed to set thread name on timer service thread");
+    }
+
+    while (true) {
+        uint64_t expirations;
+        if (read(mTimerFd.get(), &expirations, sizeof(expirations)) < 0) {
+            LOG_ALWAYS_FATAL_IF(errno != EINTR, "read of timerfd failed (%d)", errno);
+            continue;
+        }
+
+        std::unique_lock lock(mMutex);
+        mArmedTime = 0;
+        if (mStopping) break;
+
+        const nsecs_t deadline = systemTime(SYSTEM_TIME_MONOTONIC) + kSlack.count();
+        while (!mWakeups.empty() && mWakeups.top().time <= deadline) {
+            const Wakeup wakeup = mWakeups.top();
+            mWakeups.pop();
+
+            const auto it = mWakeupTimes.find(wakeup.client);
+            if (it == mWakeupTimes.end() || it->second != wakeup.time) continue;
+            mWakeupTimes.erase(it);
+
+            mRunningClient = wakeup.client;
+            lock.unlock();
+            wakeup.client->onTimerServiceWakeup();
+            lock.lock();
+            mRunningClient = nullptr;
+            mWakeupDone.notify_all();
+        }
+
+        armTimerLocked();
+    }
+}
+
+} // namespace android::scheduler
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+#include <utils/Timers.h>
+
+namespace android::scheduler {
+
+// Wakes up its clients at the requested times, all from a single thread which waits on a timerfd
+// for the earliest of them. The clients run on that thread, so they must not block.
+class TimerService {
+public:
+    class Client {
+    public:
+        virtual ~Client() = default;
+
+        // Called on the service thread at or after the requested wakeup time.
+        virtual void onTimerServiceWakeup() = 0;
+    };
+
+    // Wakeups this close to the earliest one are handled along with it, so that timers which are
+    // due at about the same time share a wakeup of the thread.
+    static constexpr std::chrono::nanoseconds kSlack = std::chrono::microseconds(500);
+
+    // The service shared by the timers of the process, which is never destroyed.
+    static TimerService& getInstance();
+
+    // The service shared by the timers whose callbacks apply the refresh rate policy, which is
+    // never destroyed. Those callbacks wait for the locks of SurfaceFlinger, so they only hold up
+    // each other rather than the timers on the other service.
+    static TimerService& getPolicyInstance();
+
+    explicit TimerService(std::string name);
+    ~TimerService();
+
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+
+    // Wakes up the client at the given time on CLOCK_MONOTONIC, unless it is already due to be
+    // woken up earlier.
+    void wakeUpAt(Client&, nsecs_t wakeupTime) EXCLUDES(mMutex);
+
+    // Cancels the pending wakeup of the client, if any. Unless called from the service thread,
+    // this also waits for a wakeup of the client in progress to return, so that the client may be
+    // destroyed right after.
+    void cancel(Client&) EXCLUDES(mMutex);
+
+    bool isServiceThread() const { return std::this_thread::get_id() == mThread.get_id(); }
+
+private:
+    struct Wakeup {
+        nsecs_t time;
+        Client* client;
+
+        bool operator>(const Wakeup& other) const { return time > other.time; }
+    };
+
+    void threadMain() EXCLUDES(mMutex);
+    // Sets the timer to the earliest current wakeup, or disarms it if there is none.
+    void armTimerLocked() REQUIRES(mMutex);
+    void setTimerLocked(nsecs_t time) REQUIRES(mMutex);
+
+    const std::string mName;
+    const base::unique_fd mTimerFd;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mWakeupDone;
+
+    // The heap may hold wakeups which were cancelled or superseded by earlier ones. A wakeup is
+    // only current if it matches the time of its client in mWakeupTimes.
+    std::priority_queue<Wakeup, std::vector<Wakeup>, std::greater<>> mWakeups GUARDED_BY(mMutex);
+    std::unordered_map<Client*, nsecs_t> mWakeupTimes GUARDED_BY(mMutex);
+
+    // The time the timerfd is set to, or 0 if it is not set.
+    nsecs_t mArmedTime GUARDED_BY(mMutex) = 0;
+
+    Client* mRunningClient GUARDED_BY(mMutex) = nullptr;
+    bool mStopping GUARDED_BY(mMutex) = false;
+
+    std::thread mThread;
+};
+
+} // namespace android::scheduler
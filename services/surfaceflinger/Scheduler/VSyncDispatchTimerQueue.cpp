@@ -20,6 +20,7 @@
 
 #include <android-base/stringprintf.h>
 #include <ftl/concat.h>
+#include <ftl/small_vector.h>
 #include <utils/Trace.h>
 #include <log/log_main.h>
 
@@ -322,7 +323,8 @@ void VSyncDispatchTimerQueue::timerCallback() {
         nsecs_t wakeupTimestamp;
         nsecs_t deadlineTimestamp;
     };
-    std::vector<Invocation> invocations;
+    // Sized like the callback map, so that firing the timer does not allocate.
+    ftl::SmallVector<Invocation, 5> invocations;
     {
         std::lock_guard lock(mMutex);
         if (!mRunning) {
@@ -331,6 +333,10 @@ void VSyncDispatchTimerQueue::timerCallback() {
         }
         auto const now = mTimeKeeper->now();
         mLastTimerCallback = now;
+        // Every callback due within the timer slack of this wakeup runs now, rather than arming
+        // the timer again for it.
+        auto const lagAllowance = std::max(now - mIntendedWakeupTime, static_cast<nsecs_t>(0));
+        auto const dueTime = mIntendedWakeupTime + mTimerSlack + lagAllowance;
         for (auto it = mCallbacks.begin(); it != mCallbacks.end(); it++) {
             auto& callback = it->second;
             auto const wakeupTime = callback->wakeupTime();
@@ -340,8 +346,7 @@ void VSyncDispatchTimerQueue::timerCallback() {
 
             auto const readyTime = callback->readyTime();
 
-            auto const lagAllowance = std::max(now - mIntendedWakeupTime, static_cast<nsecs_t>(0));
-            if (*wakeupTime < mIntendedWakeupTime + mTimerSlack + lagAllowance) {
+            if (*wakeupTime < dueTime) {
                 callback->executing();
                 invocations.emplace_back(Invocation{callback, *callback->lastExecutedVsyncTarget(),
                                                     *wakeupTime, *readyTime});
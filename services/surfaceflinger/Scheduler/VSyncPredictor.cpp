@@ -182,8 +182,8 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     //
     // intercept = mean(Y) - slope * mean(X)
     //
-    std::vector<nsecs_t> vsyncTS(numSamples);
-    std::vector<nsecs_t> ordinals(numSamples);
+    // The ordinals are snapped to the current period, so they are computed again for each sample
+    // rather than kept, which avoids allocating on every HW vsync.
 
     // Normalizing to the oldest timestamp cuts down on error in calculating the intercept.
     const auto oldestTS = *std::min_element(mTimestamps.begin(), mTimestamps.end());
@@ -194,34 +194,32 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     // fixed-point arithmetic.
     constexpr int64_t kScalingFactor = 1000;
 
+    const auto ordinalOf = [currentPeriod](nsecs_t timestamp) -> nsecs_t {
+        return currentPeriod == 0
+                ? 0
+                : (timestamp + currentPeriod / 2) / currentPeriod * kScalingFactor;
+    };
+
     nsecs_t meanTS = 0;
     nsecs_t meanOrdinal = 0;
 
-    for (size_t i = 0; i < numSamples; i++) {
-        const auto timestamp = mTimestamps[i] - oldestTS;
-        vsyncTS[i] = timestamp;
+    for (const nsecs_t sample : mTimestamps) {
+        const auto timestamp = sample - oldestTS;
         meanTS += timestamp;
-
-        const auto ordinal = currentPeriod == 0
-                ? 0
-                : (vsyncTS[i] + currentPeriod / 2) / currentPeriod * kScalingFactor;
-        ordinals[i] = ordinal;
-        meanOrdinal += ordinal;
+        meanOrdinal += ordinalOf(timestamp);
     }
 
     meanTS /= numSamples;
     meanOrdinal /= numSamples;
 
-    for (size_t i = 0; i < numSamples; i++) {
-        vsyncTS[i] -= meanTS;
-        ordinals[i] -= meanOrdinal;
-    }
-
     nsecs_t top = 0;
     nsecs_t bottom = 0;
-    for (size_t i = 0; i < numSamples; i++) {
-        top += vsyncTS[i] * ordinals[i];
-        bottom += ordinals[i] * ordinals[i];
+    for (const nsecs_t sample : mTimestamps) {
+        const auto timestamp = sample - oldestTS;
+        const auto vsyncTS = timestamp - meanTS;
+        const auto ordinal = ordinalOf(timestamp) - meanOrdinal;
+        top += vsyncTS * ordinal;
+        bottom += ordinal * ordinal;
     }
 
     if (CC_UNLIKELY(bottom == 0)) {
@@ -25,6 +25,7 @@
 #include <log/log.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cinttypes>
 #include <mutex>
@@ -37,6 +38,7 @@ const std::chrono::nanoseconds VsyncModulator::MIN_EARLY_TRANSACTION_TIME = 1ms;
 
 VsyncModulator::VsyncModulator(const VsyncConfigSet& config, Now now)
       : mVsyncConfigSet(config),
+        mAdaptiveWorkDuration(base::GetBoolProperty("debug.sf.adaptive_sf_work_duration", false)),
         mNow(now),
         mTraceDetailedInfo(base::GetBoolProperty("debug.sf.vsync_trace_detailed_info", false)) {}
 
@@ -129,6 +131,61 @@ VsyncModulator::VsyncConfigOpt VsyncModulator::onDisplayRefresh(bool usedGpuComp
     return updateVsyncConfig();
 }
 
+VsyncConfig VsyncModulator::setAdaptiveWorkDuration(bool enabled) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mAdaptiveWorkDuration != enabled) {
+        mAdaptiveWorkDuration = enabled;
+        mWorkDurationPredictors.clear();
+        mPredictedWorkDuration.reset();
+    }
+    return updateVsyncConfigLocked();
+}
+
+bool VsyncModulator::isAdaptiveWorkDurationEnabled() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mAdaptiveWorkDuration;
+}
+
+VsyncModulator::VsyncConfigOpt VsyncModulator::onFrameWorkDuration(PhysicalDisplayId displayId,
+                                                                   Duration workDuration) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mAdaptiveWorkDuration) return std::nullopt;
+
+    WorkDurationPredictor& predictor = mWorkDurationPredictors.try_emplace(displayId).first->second;
+    predictor.addFrame(workDuration);
+
+    const auto prediction = predictor.predict();
+    if (!prediction) {
+        // Until the display has enough frames, keep the prediction of the display before, if any.
+        return std::nullopt;
+    }
+
+    const std::chrono::nanoseconds predicted = *prediction;
+    if (mPredictedWorkDuration &&
+        std::chrono::abs(predicted - *mPredictedWorkDuration) < kAdaptiveWorkDurationHysteresis) {
+        return std::nullopt;
+    }
+    mPredictedWorkDuration = predicted;
+
+    if (mTraceDetailedInfo) {
+        ATRACE_INT64("Vsync-PredictedWorkDuration", predicted.count());
+    }
+
+    // The early configs are left as they are, and the prediction is applied on return to late.
+    if (getNextVsyncConfigType() != VsyncConfigType::Late) return std::nullopt;
+    return updateVsyncConfigLocked();
+}
+
+std::chrono::nanoseconds VsyncModulator::getAdaptiveSfWorkDuration(
+        std::chrono::nanoseconds prediction) const {
+    const std::chrono::nanoseconds lateDuration = mVsyncConfigSet.late.sfWorkDuration;
+    const std::chrono::nanoseconds minDuration = lateDuration / kAdaptiveWorkDurationMaxShrink;
+    const std::chrono::nanoseconds maxDuration =
+            std::max({lateDuration, mVsyncConfigSet.early.sfWorkDuration,
+                      mVsyncConfigSet.earlyGpu.sfWorkDuration});
+    return std::clamp(prediction + kAdaptiveWorkDurationMargin, minDuration, maxDuration);
+}
+
 VsyncConfig VsyncModulator::getVsyncConfig() const {
     std::lock_guard<std::mutex> lock(mMutex);
     return mVsyncConfig;
@@ -167,6 +224,10 @@ VsyncConfig VsyncModulator::updateVsyncConfigLocked() {
     const VsyncConfig& offsets = getNextVsyncConfig();
     mVsyncConfig = offsets;
 
+    if (mAdaptiveWorkDuration && mPredictedWorkDuration && &offsets == &mVsyncConfigSet.late) {
+        mVsyncConfig.sfWorkDuration = getAdaptiveSfWorkDuration(*mPredictedWorkDuration);
+    }
+
     if (mTraceDetailedInfo) {
         const bool isEarly = &offsets == &mVsyncConfigSet.early;
         const bool isEarlyGpu = &offsets == &mVsyncConfigSet.earlyGpu;
@@ -175,9 +236,10 @@ VsyncConfig VsyncModulator::updateVsyncConfigLocked() {
         ATRACE_INT("Vsync-EarlyOffsetsOn", isEarly);
         ATRACE_INT("Vsync-EarlyGpuOffsetsOn", isEarlyGpu);
         ATRACE_INT("Vsync-LateOffsetsOn", isLate);
+        ATRACE_INT64("Vsync-SfWorkDuration", mVsyncConfig.sfWorkDuration.count());
     }
 
-    return offsets;
+    return mVsyncConfig;
 }
 
 void VsyncModulator::binderDied(const wp<IBinder>& who) {
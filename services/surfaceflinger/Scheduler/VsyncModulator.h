@@ -23,10 +23,14 @@
 
 #include <android-base/thread_annotations.h>
 #include <binder/IBinder.h>
+#include <ftl/small_map.h>
+#include <ui/DisplayId.h>
 #include <utils/Timers.h>
 
+#include <scheduler/Time.h>
 #include <scheduler/TransactionSchedule.h>
 #include <scheduler/VsyncConfig.h>
+#include <scheduler/WorkDurationPredictor.h>
 
 #include "../WpHash.h"
 
@@ -45,6 +49,18 @@ public:
     // This may keep early offsets for an extra frame, but avoids a race with transaction commit.
     static const std::chrono::nanoseconds MIN_EARLY_TRANSACTION_TIME;
 
+    // In adaptive mode, the SF work duration of the late config is the predicted duration of the
+    // next frame plus this margin, so that SF wakes up as late as it safely can.
+    static constexpr std::chrono::nanoseconds kAdaptiveWorkDurationMargin = 1ms;
+
+    // The prediction must move by this much for the config to change, so that the wakeup is not
+    // rescheduled on every frame.
+    static constexpr std::chrono::nanoseconds kAdaptiveWorkDurationHysteresis = 500us;
+
+    // The adaptive SF work duration is at least the late one divided by this, and at most the
+    // longest of the configs, since the early ones are already meant for heavier frames.
+    static constexpr int kAdaptiveWorkDurationMaxShrink = 2;
+
     using VsyncConfigOpt = std::optional<VsyncConfig>;
 
     using Clock = std::chrono::steady_clock;
@@ -76,6 +92,16 @@ public:
 
     [[nodiscard]] VsyncConfigOpt onDisplayRefresh(bool usedGpuComposition);
 
+    // Enables predicting the SF work duration of the late config from the recent frames, rather
+    // than using the fixed one. Set by debug.sf.adaptive_sf_work_duration by default.
+    [[nodiscard]] VsyncConfig setAdaptiveWorkDuration(bool enabled) EXCLUDES(mMutex);
+    bool isAdaptiveWorkDurationEnabled() const EXCLUDES(mMutex);
+
+    // Called with the commit plus composite duration of each frame of the pacesetter display.
+    // The history is kept per display, so that a change of pacesetter does not mix the frames of
+    // displays with different workloads.
+    [[nodiscard]] VsyncConfigOpt onFrameWorkDuration(PhysicalDisplayId, Duration) EXCLUDES(mMutex);
+
 protected:
     // Called from unit tests as well
     void binderDied(const wp<IBinder>&) override EXCLUDES(mMutex);
@@ -85,6 +111,8 @@ private:
 
     VsyncConfigType getNextVsyncConfigType() const REQUIRES(mMutex);
     const VsyncConfig& getNextVsyncConfig() const REQUIRES(mMutex);
+    std::chrono::nanoseconds getAdaptiveSfWorkDuration(std::chrono::nanoseconds prediction) const
+            REQUIRES(mMutex);
     [[nodiscard]] VsyncConfig updateVsyncConfig() EXCLUDES(mMutex);
     [[nodiscard]] VsyncConfig updateVsyncConfigLocked() REQUIRES(mMutex);
 
@@ -104,6 +132,12 @@ private:
     std::atomic<TimePoint> mEarlyTransactionStartTime = TimePoint();
     std::atomic<TimePoint> mLastTransactionCommitTime = TimePoint();
 
+    bool mAdaptiveWorkDuration GUARDED_BY(mMutex);
+    ftl::SmallMap<PhysicalDisplayId, WorkDurationPredictor, 4> mWorkDurationPredictors
+            GUARDED_BY(mMutex);
+    // The predicted work duration of the latest display to report a frame, without the margin.
+    std::optional<std::chrono::nanoseconds> mPredictedWorkDuration GUARDED_BY(mMutex);
+
     const Now mNow;
     const bool mTraceDetailedInfo;
 };
@@ -64,8 +64,11 @@ public:
     const FenceTimePtr& presentFenceForPastVsync(Period minFramePeriod) const;
 
     // Equivalent to `presentFenceForPastVsync` unless running N VSYNCs ahead.
+    //
+    // Both are NO_FENCE if the frame in question was still being presented when this frame began,
+    // which only happens if composition is pipelined. See `FrameTargeter::setPresentPending`.
     const FenceTimePtr& presentFenceForPreviousFrame() const {
-        return mPresentFences.front().fenceTime;
+        return mPresentPending ? FenceTime::NO_FENCE : mPresentFences.front().fenceTime;
     }
 
     bool isFramePending() const { return mFramePending; }
@@ -78,6 +81,13 @@ protected:
 
     bool wouldPresentEarly(Period minFramePeriod) const;
 
+    // Whether the frame that had targeted the most recent VSYNC before this frame had yet to be
+    // presented when this frame began.
+    bool isPastVsyncPresentPending(Period minFramePeriod) const {
+        // TODO(b/267315508): Generalize to N VSYNCs.
+        return mPresentPending && !targetsVsyncsAhead<2>(minFramePeriod);
+    }
+
     // Equivalent to `pastVsyncTime` unless running N VSYNCs ahead.
     TimePoint previousFrameVsyncTime(Period minFramePeriod) const {
         return mExpectedPresentTime - minFramePeriod;
@@ -98,6 +108,8 @@ protected:
         FenceTimePtr fenceTime = FenceTime::NO_FENCE;
     };
     std::array<FenceWithFenceTime, 2> mPresentFences;
+    // Whether the present fence of the latest frame is yet to be added to mPresentFences.
+    bool mPresentPending = false;
 
 private:
     friend class FrameTargeterTestBase;
@@ -109,6 +121,12 @@ private:
     }
 };
 
+// A copy of the FrameTarget of a frame, which stays the same once the next frame has begun.
+class FrameTargetSnapshot final : public FrameTarget {
+public:
+    explicit FrameTargetSnapshot(const FrameTarget& target) : FrameTarget(target) {}
+};
+
 // Computes a display's per-frame metrics about past/upcoming targeting of present deadlines.
 class FrameTargeter final : private FrameTarget {
 public:
@@ -135,6 +153,11 @@ public:
     // TODO(b/241285191): Merge with FrameTargeter::endFrame.
     FenceTimePtr setPresentFence(sp<Fence>);
 
+    // Records that the frame is being presented in the background, so its present fence is only
+    // set once that completes, which may be after the next frame has begun. Until then, that next
+    // frame sees the frame as pending if it had targeted the VSYNC before it.
+    void setPresentPending() { mPresentPending = true; }
+
     void endFrame(const CompositeResult&);
 
     void dump(utils::Dumper&) const;
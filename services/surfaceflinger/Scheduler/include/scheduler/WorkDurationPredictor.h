@@ -0,0 +1,58 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <optional>
+
+#include <scheduler/Time.h>
+
+namespace android::scheduler {
+
+// Predicts how long the next frame will take to commit and composite, from the durations of the
+// recent frames. The prediction is the larger of a moving average, which follows the trend, and
+// a high percentile of the history, which accounts for the occasional heavy frame.
+class WorkDurationPredictor {
+public:
+    static constexpr size_t kHistorySize = 32;
+
+    // No prediction is made until the history has this many frames.
+    static constexpr size_t kMinFrames = 8;
+
+    // The moving average weighs the latest frame by 1 / kAverageWeight.
+    static constexpr int kAverageWeight = 8;
+
+    static constexpr int kPercentile = 90;
+
+    void addFrame(Duration workDuration);
+    void reset();
+
+    std::optional<Duration> predict() const;
+
+    size_t getFrameCount() const { return mFrameCount; }
+    Duration getAverage() const { return Duration::fromNs(mAverage); }
+    Duration getPercentile() const;
+
+private:
+    std::array<nsecs_t, kHistorySize> mHistory{};
+    size_t mNextIndex = 0;
+    size_t mFrameCount = 0;
+    nsecs_t mAverage = 0;
+};
+
+} // namespace android::scheduler
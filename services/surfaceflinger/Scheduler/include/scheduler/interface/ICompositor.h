@@ -47,6 +47,11 @@ struct ICompositor {
     virtual CompositeResultsPerDisplay composite(PhysicalDisplayId pacesetterId,
                                                  const scheduler::FrameTargeters&) = 0;
 
+    // Waits for the frame that composite left compositing in the background, if any, and finishes
+    // it. Called before handling any message other than a frame, since the composition owns state
+    // that the message may touch until then.
+    virtual void finishPendingComposite() = 0;
+
     // Sends a hint about the expected present time
     virtual void sendNotifyExpectedPresentHint(PhysicalDisplayId) = 0;
 
@@ -36,6 +36,10 @@ TimePoint FrameTarget::pastVsyncTime(Period minFramePeriod) const {
 const FenceTimePtr& FrameTarget::presentFenceForPastVsync(Period minFramePeriod) const {
     // TODO(b/267315508): Generalize to N VSYNCs.
     const size_t i = static_cast<size_t>(targetsVsyncsAhead<2>(minFramePeriod));
+    if (mPresentPending) {
+        // The fences are one frame behind, and the latest frame has no fence yet.
+        return i == 0 ? FenceTime::NO_FENCE : mPresentFences[i - 1].fenceTime;
+    }
     return mPresentFences[i].fenceTime;
 }
 
@@ -100,10 +104,12 @@ void FrameTargeter::beginFrame(const BeginFrameArgs& args, const IVsyncSource& v
     const int graceTimeForPresentFenceMs = static_cast<int>(
             mBackpressureGpuComposition || !mCompositionCoverage.test(CompositionCoverage::Gpu));
 
-    // Pending frames may trigger backpressure propagation.
+    // Pending frames may trigger backpressure propagation. A frame that had yet to be presented
+    // when this one began is pending, and has missed its VSYNC.
     const auto& isFencePending = *isFencePendingFuncPtr;
-    mFramePending = pastPresentFence != FenceTime::NO_FENCE &&
-            isFencePending(pastPresentFence, graceTimeForPresentFenceMs);
+    mFramePending = isPastVsyncPresentPending(minFramePeriod) ||
+            (pastPresentFence != FenceTime::NO_FENCE &&
+             isFencePending(pastPresentFence, graceTimeForPresentFenceMs));
 
     // A frame is missed if the prior frame is still pending. If no longer pending, then we still
     // count the frame as missed if the predicted present time was further in the past than when the
@@ -145,6 +151,7 @@ FenceTimePtr FrameTargeter::setPresentFence(sp<Fence> presentFence) {
 FenceTimePtr FrameTargeter::setPresentFence(sp<Fence> presentFence, FenceTimePtr presentFenceTime) {
     mPresentFences[1] = mPresentFences[0];
     mPresentFences[0] = {std::move(presentFence), presentFenceTime};
+    mPresentPending = false;
     return presentFenceTime;
 }
 
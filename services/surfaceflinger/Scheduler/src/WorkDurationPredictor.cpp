@@ -0,0 +1,65 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <scheduler/WorkDurationPredictor.h>
+
+#include <algorithm>
+
+namespace android::scheduler {
+
+void WorkDurationPredictor::addFrame(Duration workDuration) {
+    const nsecs_t duration = std::max<nsecs_t>(workDuration.ns(), 0);
+
+    if (mFrameCount == 0) {
+        mAverage = duration;
+    } else {
+        mAverage += (duration - mAverage) / kAverageWeight;
+    }
+
+    mHistory[mNextIndex] = duration;
+    mNextIndex = (mNextIndex + 1) % kHistorySize;
+    mFrameCount = std::min(mFrameCount + 1, kHistorySize);
+}
+
+void WorkDurationPredictor::reset() {
+    mNextIndex = 0;
+    mFrameCount = 0;
+    mAverage = 0;
+}
+
+Duration WorkDurationPredictor::getPercentile() const {
+    if (mFrameCount == 0) {
+        return Duration::fromNs(0);
+    }
+
+    std::array<nsecs_t, kHistorySize> sorted;
+    const auto end = std::copy_n(mHistory.begin(), mFrameCount, sorted.begin());
+
+    // The rank is rounded up, so that the percentile of a short history is its maximum.
+    const size_t rank = (mFrameCount * kPercentile + 99) / 100;
+    const auto nth = sorted.begin() + static_cast<std::ptrdiff_t>(std::max<size_t>(rank, 1) - 1);
+    std::nth_element(sorted.begin(), nth, end);
+    return Duration::fromNs(*nth);
+}
+
+std::optional<Duration> WorkDurationPredictor::predict() const {
+    if (mFrameCount < kMinFrames) {
+        return std::nullopt;
+    }
+    return std::max(getAverage(), getPercentile());
+}
+
+} // namespace android::scheduler
@@ -56,6 +56,8 @@ public:
         return target().wouldPresentEarly(minFramePeriod);
     }
 
+    void setPresentPending() { mTargeter.setPresentPending(); }
+
     struct Frame {
         Frame(FrameTargeterTestBase* testPtr, VsyncId vsyncId, TimePoint& frameBeginTime,
               Duration frameDuration, Fps refreshRate, Fps peakRefreshRate,
@@ -153,6 +155,24 @@ TEST_F(FrameTargeterTest, targetsFrames) {
     }
 }
 
+TEST_F(FrameTargeterTest, snapshotOutlivesFrame) {
+    VsyncId vsyncId{42};
+    TimePoint frameBeginTime(989ms);
+    std::optional<FrameTargetSnapshot> snapshot;
+    {
+        const Frame frame(this, vsyncId++, frameBeginTime, 10ms, 60_Hz, 60_Hz);
+        snapshot.emplace(target());
+    }
+    {
+        const Frame frame(this, vsyncId++, frameBeginTime, 11ms, 60_Hz, 60_Hz);
+
+        EXPECT_EQ(target().vsyncId(), VsyncId{43});
+        EXPECT_EQ(snapshot->vsyncId(), VsyncId{42});
+        EXPECT_EQ(snapshot->frameBeginTime(), TimePoint(989ms));
+        EXPECT_EQ(snapshot->expectedPresentTime(), TimePoint(999ms));
+    }
+}
+
 TEST_F(FrameTargeterTest, inflatesExpectedPresentTime) {
     // Negative such that `expectedVsyncTime` is in the past.
     constexpr Duration kFrameDuration = -3ms;
@@ -227,6 +247,61 @@ TEST_F(FrameTargeterTest, recallsPastVsyncTwoVsyncsAheadVrr) {
     }
 }
 
+TEST_F(FrameTargeterTest, detectsPendingPresent) {
+    VsyncId vsyncId{333};
+    TimePoint frameBeginTime(3000ms);
+    constexpr Fps kRefreshRate = 60_Hz;
+    constexpr Period kPeriod = kRefreshRate.getPeriod();
+    constexpr Duration kFrameDuration = 13ms;
+
+    std::optional<Frame> previousFrame;
+    previousFrame.emplace(this, vsyncId++, frameBeginTime, kFrameDuration, kRefreshRate,
+                          kRefreshRate);
+    setPresentPending();
+
+    // The next frame begins before the previous frame has been presented.
+    TimePoint nextFrameBeginTime = frameBeginTime + kPeriod;
+    Frame frame(this, vsyncId++, nextFrameBeginTime, kFrameDuration, kRefreshRate, kRefreshRate);
+
+    EXPECT_TRUE(target().isFramePending());
+    EXPECT_TRUE(target().didMissFrame());
+    EXPECT_EQ(target().presentFenceForPastVsync(kPeriod), FenceTime::NO_FENCE);
+    EXPECT_EQ(target().presentFenceForPreviousFrame(), FenceTime::NO_FENCE);
+
+    const auto fence = previousFrame->end();
+    EXPECT_EQ(target().presentFenceForPastVsync(kPeriod), fence);
+    EXPECT_EQ(target().presentFenceForPreviousFrame(), fence);
+}
+
+TEST_F(FrameTargeterTest, recallsPastVsyncTwoVsyncsAheadWithPendingPresent) {
+    VsyncId vsyncId{444};
+    TimePoint frameBeginTime(4000ms);
+    constexpr Fps kRefreshRate = 120_Hz;
+    constexpr Period kPeriod = kRefreshRate.getPeriod();
+    constexpr Duration kFrameDuration = 10ms;
+
+    FenceTimePtr pastFence;
+    {
+        Frame frame(this, vsyncId++, frameBeginTime, kFrameDuration, kRefreshRate, kRefreshRate);
+        pastFence = frame.end();
+    }
+
+    std::optional<Frame> previousFrame;
+    previousFrame.emplace(this, vsyncId++, frameBeginTime, kFrameDuration, kRefreshRate,
+                          kRefreshRate);
+    setPresentPending();
+
+    // The past VSYNC of the next frame was targeted by the frame before the pending one.
+    TimePoint nextFrameBeginTime = frameBeginTime + kPeriod;
+    Frame frame(this, vsyncId++, nextFrameBeginTime, kFrameDuration, kRefreshRate, kRefreshRate);
+
+    EXPECT_FALSE(target().isFramePending());
+    EXPECT_EQ(target().presentFenceForPastVsync(kPeriod), pastFence);
+
+    previousFrame->end();
+    EXPECT_EQ(target().presentFenceForPastVsync(kPeriod), pastFence);
+}
+
 TEST_F(FrameTargeterTest, doesNotDetectEarlyPresentIfNoFence) {
     constexpr Period kPeriod = (60_Hz).getPeriod();
     EXPECT_EQ(target().presentFenceForPastVsync(kPeriod), FenceTime::NO_FENCE);
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include <scheduler/WorkDurationPredictor.h>
+
+namespace android::scheduler {
+
+using namespace std::chrono_literals;
+
+TEST(WorkDurationPredictorTest, waitsForEnoughFrames) {
+    WorkDurationPredictor predictor;
+    for (size_t i = 1; i < WorkDurationPredictor::kMinFrames; i++) {
+        predictor.addFrame(4ms);
+        EXPECT_FALSE(predictor.predict());
+    }
+
+    predictor.addFrame(4ms);
+    EXPECT_EQ(4ms, predictor.predict());
+
+    predictor.reset();
+    EXPECT_EQ(0u, predictor.getFrameCount());
+    EXPECT_FALSE(predictor.predict());
+}
+
+TEST(WorkDurationPredictorTest, accountsForOccasionalHeavyFrames) {
+    WorkDurationPredictor predictor;
+
+    // One frame in five is heavy, which the average alone would smooth away.
+    for (size_t i = 0; i < WorkDurationPredictor::kHistorySize; i++) {
+        predictor.addFrame(i % 5 == 0 ? 10ms : 2ms);
+    }
+
+    EXPECT_LT(predictor.getAverage(), 10ms);
+    EXPECT_EQ(10ms, predictor.getPercentile());
+    EXPECT_EQ(10ms, predictor.predict());
+}
+
+TEST(WorkDurationPredictorTest, forgetsOldFrames) {
+    WorkDurationPredictor predictor;
+    for (size_t i = 0; i < WorkDurationPredictor::kHistorySize; i++) {
+        predictor.addFrame(10ms);
+    }
+    for (size_t i = 0; i < WorkDurationPredictor::kHistorySize; i++) {
+        predictor.addFrame(2ms);
+    }
+
+    EXPECT_EQ(WorkDurationPredictor::kHistorySize, predictor.getFrameCount());
+    EXPECT_EQ(2ms, predictor.getPercentile());
+
+    const auto prediction = predictor.predict();
+    ASSERT_TRUE(prediction);
+    EXPECT_GE(*prediction, 2ms);
+    EXPECT_LT(*prediction, 3ms);
+}
+
+TEST(WorkDurationPredictorTest, ignoresNegativeDurations) {
+    WorkDurationPredictor predictor;
+    for (size_t i = 0; i < WorkDurationPredictor::kMinFrames; i++) {
+        predictor.addFrame(-1ms);
+    }
+    EXPECT_EQ(0ms, predictor.predict());
+}
+
+} // namespace android::scheduler
@@ -37,6 +37,11 @@ public:
         return mBuffer;
     }
 
+    // Screenshots are drawn whole, into a buffer of their own.
+    void addFrameDamage(const Region&) override {}
+
+    Region getBufferDamage() const override { return Region::INVALID_REGION; }
+
     void queueBuffer(base::unique_fd readyFence, float) override {
         mRenderFence = sp<Fence>::make(readyFence.release());
     }
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+namespace android {
+
+// Bounds the number of screen captures requested over Binder which are in flight at once. Each of
+// them holds its Binder thread until it is rendered, so without a bound a client taking many
+// captures could tie up all of the threads, and the other Binder calls would wait behind them.
+class ScreenCaptureThrottle {
+public:
+    explicit ScreenCaptureThrottle(size_t maxInFlight) : mMaxInFlight(maxInFlight) {}
+
+    // Held for as long as a capture is in flight.
+    class Token {
+    public:
+        Token(Token&& other) : mThrottle(std::exchange(other.mThrottle, nullptr)) {}
+        Token(const Token&) = delete;
+        Token& operator=(const Token&) = delete;
+        Token& operator=(Token&&) = delete;
+
+        ~Token() {
+            if (mThrottle) mThrottle->mInFlight--;
+        }
+
+    private:
+        friend ScreenCaptureThrottle;
+        explicit Token(ScreenCaptureThrottle* throttle) : mThrottle(throttle) {}
+
+        ScreenCaptureThrottle* mThrottle;
+    };
+
+    // Returns std::nullopt if the maximum number of captures is already in flight, in which case
+    // the capture must fail rather than wait for a Binder thread to be released.
+    std::optional<Token> tryAcquire() {
+        size_t inFlight = mInFlight.load();
+        do {
+            if (inFlight >= mMaxInFlight) return std::nullopt;
+        } while (!mInFlight.compare_exchange_weak(inFlight, inFlight + 1));
+        return Token(this);
+    }
+
+    size_t getInFlightCount() const { return mInFlight.load(); }
+
+private:
+    const size_t mMaxInFlight;
+    std::atomic<size_t> mInFlight = 0;
+};
+
+} // namespace android
@@ -76,6 +76,7 @@
 #include <private/android_filesystem_config.h>
 #include <private/gui/SyncFeatures.h>
 #include <processgroup/processgroup.h>
+#include <pthread.h>
 #include <renderengine/RenderEngine.h>
 #include <renderengine/impl/ExternalTexture.h>
 #include <scheduler/FrameTargeter.h>
@@ -88,6 +89,7 @@
 #include <ui/DisplayState.h>
 #include <ui/DynamicDisplayInfo.h>
 #include <ui/GraphicBufferAllocator.h>
+#include <ui/GraphicBufferMapper.h>
 #include <ui/HdrRenderTypeUtils.h>
 #include <ui/LayerStack.h>
 #include <ui/PixelFormat.h>
@@ -105,6 +107,7 @@
 #include <cstdint>
 #include <filesystem>
 #include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -155,6 +158,7 @@
 #include "ScreenCaptureOutput.h"
 #include "StartPropertySetThread.h"
 #include "SurfaceFlingerProperties.h"
+#include "TimeStats/FrameStageStats.h"
 #include "TimeStats/TimeStats.h"
 #include "TunnelModeEnabledReporter.h"
 #include "Utils/Dumper.h"
@@ -196,6 +200,7 @@ using aidl::android::hardware::graphics::composer3::Capability;
 using aidl::android::hardware::graphics::composer3::DisplayCapability;
 using CompositionStrategyPredictionState = android::compositionengine::impl::
         OutputCompositionState::CompositionStrategyPredictionState;
+using OutputFrameUpdate = android::compositionengine::impl::OutputCompositionState::FrameUpdate;
 
 using base::StringAppendF;
 using display::PhysicalDisplay;
@@ -368,6 +373,43 @@ bool isExpectedPresentWithinTimeout(TimePoint expectedPresentTime,
     return std::abs(expectedPresentTime.ns() -
                     (lastExpectedPresentTimestamp.ns() + timeoutOpt->ns())) < threshold.ns();
 }
+
+// What changed in a snapshot since the last frame, for the outputs which skip composition work
+// for unchanged layers.
+compositionengine::LayerFECompositionState::FrameChanges getFrameChanges(
+        const frontend::LayerSnapshot& snapshot, bool hasQueuedFrame) {
+    using Changes = frontend::RequestedLayerState::Changes;
+    using FrameChanges = compositionengine::LayerFECompositionState::FrameChanges;
+
+    // Only the front end, input, and the scheduler use these.
+    constexpr ftl::Flags<Changes> kNoCompositionChanges =
+            Changes::Input | Changes::FrameRate | Changes::GameMode | Changes::AffectsChildren;
+    constexpr uint64_t kNoCompositionClientChanges = layer_state_t::eInputInfoChanged |
+            layer_state_t::eDropInputModeChanged | layer_state_t::eTrustedOverlayChanged |
+            layer_state_t::eTrustedPresentationInfoChanged | layer_state_t::eFlushJankData |
+            layer_state_t::eHasListenerCallbacksChanged | layer_state_t::eFrameRateChanged |
+            layer_state_t::eFrameRateCategoryChanged |
+            layer_state_t::eFrameRateSelectionStrategyChanged |
+            layer_state_t::eFrameRateSelectionPriority |
+            layer_state_t::eDefaultFrameRateCompatibilityChanged |
+            layer_state_t::eFixedTransformHintChanged;
+    // A new buffer of the same size, format and usage.
+    constexpr ftl::Flags<Changes> kBufferChanges = Changes::Buffer | Changes::Content;
+    constexpr uint64_t kBufferClientChanges =
+            layer_state_t::eBufferChanged | layer_state_t::eSurfaceDamageRegionChanged;
+
+    const auto changes = snapshot.changes.get();
+    if ((changes & ~kNoCompositionChanges.get()) == 0 &&
+        (snapshot.clientChanges & ~kNoCompositionClientChanges) == 0) {
+        // A frame may still be latched without a transaction, e.g. in auto refresh mode.
+        return hasQueuedFrame ? FrameChanges::BUFFER : FrameChanges::NONE;
+    }
+    if ((changes & ~(kNoCompositionChanges | kBufferChanges).get()) == 0 &&
+        (snapshot.clientChanges & ~(kNoCompositionClientChanges | kBufferClientChanges)) == 0) {
+        return FrameChanges::BUFFER;
+    }
+    return FrameChanges::ALL;
+}
 }  // namespace anonymous
 
 // ---------------------------------------------------------------------------
@@ -427,6 +469,7 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory, SkipInitializationTag)
       : mFactory(factory),
         mPid(getpid()),
         mTimeStats(std::make_shared<impl::TimeStats>()),
+        mFrameStageStats(std::make_shared<FrameStageStats>()),
         mFrameTracer(mFactory.createFrameTracer()),
         mFrameTimeline(mFactory.createFrameTimeline(mTimeStats, mPid)),
         mCompositionEngine(mFactory.createCompositionEngine()),
@@ -486,6 +529,19 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory) : SurfaceFlinger(factory, SkipI
 
     mDebugFlashDelay = base::GetUintProperty("debug.sf.showupdates"s, 0u);
 
+    // Screenshots are not recyclable, since they are sent to other processes, but the buffers which
+    // stay in SurfaceFlinger, e.g. for region sampling and layer caching, are.
+    GraphicBufferAllocator::get()
+            .setRecyclingPoolLimits(base::GetUintProperty("debug.sf.buffer_recycling_pool_kb"s,
+                                                          16u * 1024u) *
+                                            1024u,
+                                    ms2ns(base::GetUintProperty(
+                                            "debug.sf.buffer_recycling_pool_ttl_ms"s, 1000u)));
+    // Clients re-send the same buffers, and SurfaceFlinger never locks the buffers it imports, so
+    // their GraphicBuffers can share a handle.
+    GraphicBufferMapper::get().setImportCacheEnabled(
+            base::GetBoolProperty("debug.sf.enable_buffer_import_cache"s, true));
+
     mBackpressureGpuComposition = base::GetBoolProperty("debug.sf.enable_gl_backpressure"s, true);
     ALOGI_IF(mBackpressureGpuComposition, "Enabling backpressure for GPU composition");
 
@@ -499,10 +555,24 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory) : SurfaceFlinger(factory, SkipI
 
     property_get("debug.sf.disable_client_composition_cache", value, "0");
     mDisableClientCompositionCache = atoi(value);
+    mClientCompositionCacheSize =
+            base::GetUintProperty("debug.sf.client_composition_cache_size"s, 0u);
 
     property_get("debug.sf.predict_hwc_composition_strategy", value, "1");
     mPredictCompositionStrategy = atoi(value);
 
+    property_get("debug.sf.partial_client_composition", value, "0");
+    mPartialClientComposition = atoi(value);
+
+    property_get("debug.sf.validate_displays_concurrently", value, "0");
+    mValidateOutputsConcurrently = atoi(value);
+
+    property_get("debug.sf.present_displays_in_parallel", value, "0");
+    mPresentOutputsInParallel = atoi(value);
+
+    property_get("debug.sf.skip_idle_displays", value, "0");
+    mSkipIdleOutputs = atoi(value);
+
     property_get("debug.sf.treat_170m_as_sRGB", value, "0");
     mTreat170mAsSrgb = atoi(value);
 
@@ -545,6 +615,17 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory) : SurfaceFlinger(factory, SkipI
             base::GetBoolProperty("persist.debug.sf.enable_layer_lifecycle_manager"s, true);
     mLegacyFrontEndEnabled = !mLayerLifecycleManagerEnabled ||
             base::GetBoolProperty("persist.debug.sf.enable_legacy_frontend"s, false);
+    mParallelLayerSnapshotsMinLayers =
+            base::GetUintProperty("debug.sf.parallel_layer_snapshots_min_layers"s, size_t(0));
+    if (base::GetBoolProperty("debug.sf.watch_transaction_fences"s, false)) {
+        mTransactionHandler.watchAcquireFences();
+    }
+    mPipelinedComposite = base::GetBoolProperty("debug.sf.pipelined_composite"s, false);
+    if (mPipelinedComposite && mLegacyFrontEndEnabled) {
+        ALOGW("Not pipelining composition, since the legacy front end is enabled");
+        mPipelinedComposite = false;
+    }
+    mEarlyBufferRelease = base::GetBoolProperty("debug.sf.early_buffer_release"s, false);
 
     // These are set by the HWC implementation to indicate that they will use the workarounds.
     mIsHotplugErrViaNegVsync =
@@ -737,10 +818,13 @@ void SurfaceFlinger::bootFinished() {
     }
 
     if (mRenderEnginePrimeCacheFuture.valid()) {
+        const nsecs_t waitStartTime = systemTime();
         mRenderEnginePrimeCacheFuture.get();
+        recordBootPhase("shader cache priming wait", systemTime() - waitStartTime);
     }
     const nsecs_t now = systemTime();
     const nsecs_t duration = now - mBootTime;
+    recordBootPhase("boot", duration);
     ALOGI("Boot is finished (%ld ms)", long(ns2ms(duration)) );
 
     mFrameTracer->initialize();
@@ -835,6 +919,27 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     addTransactionReadyFilters();
     Mutex::Autolock lock(mStateLock);
 
+    const nsecs_t initStartTime = systemTime();
+    nsecs_t phaseStartTime = initStartTime;
+    const auto endBootPhase = [&](const char* name) {
+        const nsecs_t now = systemTime();
+        recordBootPhase(name, now - phaseStartTime);
+        phaseStartTime = now;
+    };
+
+    // Connecting to the composer does not depend on RenderEngine, and both mostly wait for their
+    // HALs and drivers to come up, so connect concurrently unless disabled for debugging.
+    std::future<std::unique_ptr<HWComposer>> hwComposerFuture;
+    if (base::GetBoolProperty("debug.sf.parallel_init"s, true)) {
+        hwComposerFuture = std::async(std::launch::async, [this] {
+            pthread_setname_np(pthread_self(), "HwcConnect");
+            const nsecs_t startTime = systemTime();
+            auto hwComposer = getFactory().createHWComposer(mHwcServiceName);
+            recordBootPhase("hwc connection", systemTime() - startTime);
+            return hwComposer;
+        });
+    }
+
     // Get a RenderEngine for the given display / config (can't fail)
     // TODO(b/77156734): We need to stop casting and use HAL types when possible.
     // Sending maxFrameBufferAcquiredBuffers as the cache size is tightly tuned to single-display.
@@ -851,8 +956,13 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     chooseRenderEngineType(builder);
     mRenderEngine = renderengine::RenderEngine::create(builder.build());
     mCompositionEngine->setRenderEngine(mRenderEngine.get());
+    if (mPresentOutputsInParallel && !getRenderEngine().isThreaded()) {
+        ALOGW("Not presenting displays in parallel, since RenderEngine is not threaded");
+        mPresentOutputsInParallel = false;
+    }
     mMaxRenderTargetSize =
             std::min(getRenderEngine().getMaxTextureSize(), getRenderEngine().getMaxViewportDims());
+    endBootPhase("renderengine");
 
     // Set SF main policy after initializing RenderEngine which has its own policy.
     if (!SetTaskProfiles(0, {"SFMainPolicy"})) {
@@ -860,9 +970,18 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     }
 
     mCompositionEngine->setTimeStats(mTimeStats);
-    mCompositionEngine->setHwComposer(getFactory().createHWComposer(mHwcServiceName));
+    mCompositionEngine->setFrameStageStats(mFrameStageStats);
+    if (hwComposerFuture.valid()) {
+        mCompositionEngine->setHwComposer(hwComposerFuture.get());
+        endBootPhase("hwc connection wait");
+    } else {
+        mCompositionEngine->setHwComposer(getFactory().createHWComposer(mHwcServiceName));
+        endBootPhase("hwc connection");
+    }
     mCompositionEngine->getHwComposer().setCallback(*this);
     ClientCache::getInstance().setRenderEngine(&getRenderEngine());
+    ClientCache::getInstance().setMaxBytes(
+            base::GetUintProperty("debug.sf.client_cache_max_size_mb"s, uint64_t(0)) * 1024 * 1024);
 
     enableLatchUnsignaledConfig = getLatchUnsignaledConfig();
 
@@ -873,6 +992,7 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     // Process hotplug for displays connected at boot.
     LOG_ALWAYS_FATAL_IF(!configureLocked(),
                         "Initial display configuration failed: HWC did not hotplug");
+    endBootPhase("display configuration");
 
     // Commit primary display.
     sp<const DisplayDevice> display;
@@ -891,11 +1011,13 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     LOG_ALWAYS_FATAL_IF(!display, "Failed to configure the primary display");
     LOG_ALWAYS_FATAL_IF(!getHwComposer().isConnected(display->getPhysicalId()),
                         "Primary display is disconnected");
+    endBootPhase("primary display");
 
     // TODO(b/241285876): The Scheduler needlessly depends on creating the CompositionEngine part of
     // the DisplayDevice, hence the above commit of the primary display. Remove that special case by
     // initializing the Scheduler after configureLocked, once decoupled from DisplayDevice.
     initScheduler(display);
+    endBootPhase("scheduler");
 
     mLayerTracing.setTakeLayersSnapshotProtoFunction([&](uint32_t traceFlags) {
         auto snapshot = perfetto::protos::LayersSnapshotProto{};
@@ -910,6 +1032,7 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
 
     // Commit secondary display(s).
     processDisplayChangesLocked();
+    endBootPhase("secondary displays");
 
     // initialize our drawing state
     mDrawingState = mCurrentState;
@@ -946,7 +1069,13 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     }
 
     initTransactionTraceWriter();
-    ALOGV("Done initializing");
+    recordBootPhase("init", systemTime() - initStartTime);
+    ALOGI("Done initializing (%" PRId64 " ms)", ns2ms(systemTime() - initStartTime));
+}
+
+void SurfaceFlinger::recordBootPhase(const char* name, nsecs_t duration) {
+    std::lock_guard lock(mBootPhasesMutex);
+    mBootPhases.emplace_back(name, duration);
 }
 
 void SurfaceFlinger::initTransactionTraceWriter() {
@@ -1460,6 +1589,9 @@ void SurfaceFlinger::initiateDisplayModeChanges() {
         display->refreshRateSelector().onModeChangeInitiated();
         mScheduler->onNewVsyncPeriodChangeTimeline(outTimeline);
 
+        // The frames around a mode change recompose every layer for the new timeline.
+        mPowerAdvisor->notifyExpectedHeavyFrame();
+
         if (outTimeline.refreshRequired) {
             scheduleComposite(FrameHint::kNone);
         } else {
@@ -1483,7 +1615,8 @@ void SurfaceFlinger::initiateDisplayModeChanges() {
 
 void SurfaceFlinger::disableExpensiveRendering() {
     const char* const whence = __func__;
-    auto future = mScheduler->schedule([=, this]() FTL_FAKE_GUARD(mStateLock) {
+    // Not waited for, since this is called from the thread shared by the OneShotTimers.
+    static_cast<void>(mScheduler->schedule([=, this]() FTL_FAKE_GUARD(mStateLock) {
         ATRACE_NAME(whence);
         if (mPowerAdvisor->isUsingExpensiveRendering()) {
             for (const auto& [_, display] : mDisplays) {
@@ -1491,9 +1624,7 @@ void SurfaceFlinger::disableExpensiveRendering() {
                 mPowerAdvisor->setExpensiveRenderingExpected(display->getId(), kDisable);
             }
         }
-    });
-
-    future.wait();
+    }));
 }
 
 status_t SurfaceFlinger::getDisplayNativePrimaries(const sp<IBinder>& displayToken,
@@ -2342,56 +2473,71 @@ void SurfaceFlinger::updateLayerHistory(nsecs_t now) {
     }
 }
 
+frontend::Update SurfaceFlinger::takeFrontEndUpdate() {
+    frontend::Update update;
+    ATRACE_NAME("TransactionHandler:flushTransactions");
+    // Locking:
+    // 1. to prevent onHandleDestroyed from being called while the state lock is held,
+    // we must keep a copy of the transactions (specifically the composer
+    // states) around outside the scope of the lock.
+    // 2. Transactions and created layers do not share a lock. To prevent applying
+    // transactions with layers still in the createdLayer queue, collect the transactions
+    // before committing the created layers.
+    // 3. Transactions can only be flushed after adding layers, since the layer can be a newly
+    // created one
+    mTransactionHandler.collectTransactions();
+    {
+        // TODO(b/238781169) lockless queue this and keep order.
+        std::scoped_lock<std::mutex> lock(mCreatedLayersLock);
+        update.layerCreatedStates = std::move(mCreatedLayers);
+        mCreatedLayers.clear();
+        update.newLayers = std::move(mNewLayers);
+        mNewLayers.clear();
+        update.layerCreationArgs = std::move(mNewLayerArgs);
+        mNewLayerArgs.clear();
+        update.destroyedHandles = std::move(mDestroyedHandles);
+        mDestroyedHandles.clear();
+    }
+
+    mLayerLifecycleManager.addLayers(std::move(update.newLayers));
+    update.transactions = mTransactionHandler.flushTransactions();
+    mLayerLifecycleManager.applyTransactions(update.transactions);
+    mLayerLifecycleManager.onHandlesDestroyed(update.destroyedHandles);
+    for (auto& legacyLayer : update.layerCreatedStates) {
+        sp<Layer> layer = legacyLayer.layer.promote();
+        if (layer) {
+            mLegacyLayers[layer->sequence] = layer;
+        }
+    }
+    mLayerHierarchyBuilder.update(mLayerLifecycleManager);
+    return update;
+}
+
 bool SurfaceFlinger::updateLayerSnapshots(VsyncId vsyncId, nsecs_t frameTimeNs,
                                           bool flushTransactions, bool& outTransactionsAreEmpty) {
     using Changes = frontend::RequestedLayerState::Changes;
     ATRACE_CALL();
     frontend::Update update;
-    if (flushTransactions) {
-        ATRACE_NAME("TransactionHandler:flushTransactions");
-        // Locking:
-        // 1. to prevent onHandleDestroyed from being called while the state lock is held,
-        // we must keep a copy of the transactions (specifically the composer
-        // states) around outside the scope of the lock.
-        // 2. Transactions and created layers do not share a lock. To prevent applying
-        // transactions with layers still in the createdLayer queue, collect the transactions
-        // before committing the created layers.
-        // 3. Transactions can only be flushed after adding layers, since the layer can be a newly
-        // created one
-        mTransactionHandler.collectTransactions();
-        {
-            // TODO(b/238781169) lockless queue this and keep order.
-            std::scoped_lock<std::mutex> lock(mCreatedLayersLock);
-            update.layerCreatedStates = std::move(mCreatedLayers);
-            mCreatedLayers.clear();
-            update.newLayers = std::move(mNewLayers);
-            mNewLayers.clear();
-            update.layerCreationArgs = std::move(mNewLayerArgs);
-            mNewLayerArgs.clear();
-            update.destroyedHandles = std::move(mDestroyedHandles);
-            mDestroyedHandles.clear();
-        }
-
-        mLayerLifecycleManager.addLayers(std::move(update.newLayers));
-        update.transactions = mTransactionHandler.flushTransactions();
-        if (mTransactionTracing) {
-            mTransactionTracing->addCommittedTransactions(ftl::to_underlying(vsyncId), frameTimeNs,
-                                                          update, mFrontEndDisplayInfos,
-                                                          mFrontEndDisplayInfosChanged);
-        }
-        mLayerLifecycleManager.applyTransactions(update.transactions);
-        mLayerLifecycleManager.onHandlesDestroyed(update.destroyedHandles);
-        for (auto& legacyLayer : update.layerCreatedStates) {
-            sp<Layer> layer = legacyLayer.layer.promote();
-            if (layer) {
-                mLegacyLayers[layer->sequence] = layer;
-            }
-        }
-        mLayerHierarchyBuilder.update(mLayerLifecycleManager);
+    const bool tookUpdate = mPipelinedUpdate || flushTransactions;
+    if (mPipelinedUpdate) {
+        // Taken in by commit while the previous frame was being composited.
+        update = std::move(*mPipelinedUpdate);
+        mPipelinedUpdate.reset();
+    } else if (flushTransactions) {
+        update = takeFrontEndUpdate();
+    }
+    // Traced once the previous frame has finished, so that the trace keeps the order of frames.
+    if (tookUpdate && mTransactionTracing) {
+        mTransactionTracing->addCommittedTransactions(ftl::to_underlying(vsyncId), frameTimeNs,
+                                                      update, mFrontEndDisplayInfos,
+                                                      mFrontEndDisplayInfosChanged);
     }
 
     bool mustComposite = false;
-    mustComposite |= applyAndCommitDisplayTransactionStates(update.transactions);
+    if (applyAndCommitDisplayTransactionStates(update.transactions)) {
+        mustComposite = true;
+        mMustUpdateAllOutputs = true;
+    }
 
     {
         ATRACE_NAME("LayerSnapshotBuilder:update");
@@ -2407,7 +2553,9 @@ bool SurfaceFlinger::updateLayerSnapshots(VsyncId vsyncId, nsecs_t frameTimeNs,
                              getHwComposer().getSupportedLayerGenericMetadata(),
                      .genericLayerMetadataKeyMap = getGenericLayerMetadataKeyMap(),
                      .skipRoundCornersWhenProtected =
-                             !getRenderEngine().supportsProtectedContent()};
+                             !getRenderEngine().supportsProtectedContent(),
+                     .parallelUpdateMinLayers = mParallelLayerSnapshotsMinLayers,
+                     .flattenedRoot = &mLayerHierarchyBuilder.getFlattenedHierarchy()};
         mLayerSnapshotBuilder.update(args);
     }
 
@@ -2506,6 +2654,7 @@ bool SurfaceFlinger::updateLayerSnapshots(VsyncId vsyncId, nsecs_t frameTimeNs,
             mBootStage = BootStage::BOOTANIMATION;
         }
     }
+    mMustUpdateAllOutputs |= (getTransactionFlags() & eDisplayTransactionNeeded) != 0;
     mustComposite |= (getTransactionFlags() & ~eTransactionFlushNeeded) || newDataLatched;
     if (mustComposite && !mLegacyFrontEndEnabled) {
         commitTransactions();
@@ -2520,6 +2669,8 @@ bool SurfaceFlinger::commit(PhysicalDisplayId pacesetterId,
 
     const VsyncId vsyncId = pacesetterFrameTarget.vsyncId();
     ATRACE_NAME(ftl::Concat(__func__, ' ', ftl::to_underlying(vsyncId)).c_str());
+    FrameStageStats::ScopedTimer commitTimer(mFrameStageStats.get(), pacesetterId,
+                                             FrameStageStats::Stage::Commit);
 
     if (pacesetterFrameTarget.didMissFrame()) {
         mTimeStats->incrementMissedFrames();
@@ -2541,6 +2692,16 @@ bool SurfaceFlinger::commit(PhysicalDisplayId pacesetterId,
         return false;
     }
 
+    if (mPendingComposite &&
+        std::any_of(frameTargets.begin(), frameTargets.end(),
+                    [this](const auto& pair) FTL_FAKE_GUARD(mStateLock) {
+                        const auto display = getDisplayDeviceLocked(pair.first);
+                        return display && display->isModeSetPending();
+                    })) {
+        // The mode is set through the HAL, which the composition may still be presenting with.
+        finishPendingComposite();
+    }
+
     {
         Mutex::Autolock lock(mStateLock);
 
@@ -2573,8 +2734,9 @@ bool SurfaceFlinger::commit(PhysicalDisplayId pacesetterId,
     // Save this once per commit + composite to ensure consistency
     // TODO (b/240619471): consider removing active display check once AOD is fixed
     const auto activeDisplay = FTL_FAKE_GUARD(mStateLock, getDisplayDeviceLocked(mActiveDisplayId));
+    // The work durations reported to the session assume that commit and composite don't overlap.
     mPowerHintSessionEnabled = mPowerAdvisor->usePowerHintSession() && activeDisplay &&
-            activeDisplay->getPowerMode() == hal::PowerMode::ON;
+            activeDisplay->getPowerMode() == hal::PowerMode::ON && !mPipelinedComposite;
     if (mPowerHintSessionEnabled) {
         mPowerAdvisor->setCommitStart(pacesetterFrameTarget.frameBeginTime());
         mPowerAdvisor->setExpectedPresentTime(pacesetterFrameTarget.expectedPresentTime());
@@ -2602,23 +2764,37 @@ bool SurfaceFlinger::commit(PhysicalDisplayId pacesetterId,
 
     // Composite if transactions were committed, or if requested by HWC.
     bool mustComposite = mMustComposite.exchange(false);
+    mMustUpdateAllOutputs |= mustComposite;
     {
+        const bool flushTransactions = clearTransactionFlags(eTransactionFlushNeeded);
+        if (mPendingComposite) {
+            // Only the front end may take the transactions in while the previous frame is still
+            // being composited. The rest of the commit touches state that the composition owns.
+            if (flushTransactions) {
+                mPipelinedUpdate = takeFrontEndUpdate();
+            }
+            finishPendingComposite();
+        }
+
         mFrameTimeline->setSfWakeUp(ftl::to_underlying(vsyncId),
                                     pacesetterFrameTarget.frameBeginTime().ns(),
                                     Fps::fromPeriodNsecs(vsyncPeriod.ns()),
                                     mScheduler->getPacesetterRefreshRate());
 
-        const bool flushTransactions = clearTransactionFlags(eTransactionFlushNeeded);
         bool transactionsAreEmpty;
-        if (mLegacyFrontEndEnabled) {
-            mustComposite |=
-                    updateLayerSnapshotsLegacy(vsyncId, pacesetterFrameTarget.frameBeginTime().ns(),
-                                               flushTransactions, transactionsAreEmpty);
-        }
-        if (mLayerLifecycleManagerEnabled) {
-            mustComposite |=
-                    updateLayerSnapshots(vsyncId, pacesetterFrameTarget.frameBeginTime().ns(),
-                                         flushTransactions, transactionsAreEmpty);
+        {
+            FrameStageStats::ScopedTimer snapshotTimer(mFrameStageStats.get(), pacesetterId,
+                                                       FrameStageStats::Stage::SnapshotBuild);
+            const nsecs_t frameTimeNs = pacesetterFrameTarget.frameBeginTime().ns();
+            if (mLegacyFrontEndEnabled) {
+                mustComposite |= updateLayerSnapshotsLegacy(vsyncId, frameTimeNs,
+                                                            flushTransactions,
+                                                            transactionsAreEmpty);
+            }
+            if (mLayerLifecycleManagerEnabled) {
+                mustComposite |= updateLayerSnapshots(vsyncId, frameTimeNs, flushTransactions,
+                                                      transactionsAreEmpty);
+            }
         }
 
         if (transactionFlushNeeded()) {
@@ -2658,12 +2834,16 @@ bool SurfaceFlinger::commit(PhysicalDisplayId pacesetterId,
     }
     doActiveLayersTracingIfNeeded(false, mVisibleRegionsDirty,
                                   pacesetterFrameTarget.frameBeginTime(), vsyncId);
+    publishDumpSnapshotIfRequested(vsyncId);
 
     mLastCommittedVsyncId = vsyncId;
 
     persistDisplayBrightness(mustComposite);
 
-    return mustComposite && CC_LIKELY(mBootStage != BootStage::BOOTLOADER);
+    const bool composite = mustComposite && CC_LIKELY(mBootStage != BootStage::BOOTLOADER);
+    // The next composite can't tell which layers changed in this commit.
+    mMustUpdateAllOutputs |= mustComposite && !composite;
+    return composite;
 }
 
 CompositeResultsPerDisplay SurfaceFlinger::composite(
@@ -2674,7 +2854,17 @@ CompositeResultsPerDisplay SurfaceFlinger::composite(
     const VsyncId vsyncId = pacesetterTarget.vsyncId();
     ATRACE_NAME(ftl::Concat(__func__, ' ', ftl::to_underlying(vsyncId)).c_str());
 
-    compositionengine::CompositionRefreshArgs refreshArgs;
+    // The frame before is still pending if the commit of this one returned early.
+    finishPendingComposite();
+
+    if (mPowerHintSessionEnabled) {
+        mPowerAdvisor->setCompositeStart(TimePoint::now());
+    }
+
+    PendingComposite& composition = mPendingComposite.emplace(
+            PendingComposite{.pacesetterId = pacesetterId, .frameTargeters = frameTargeters});
+
+    compositionengine::CompositionRefreshArgs& refreshArgs = composition.refreshArgs;
     refreshArgs.powerCallback = this;
     const auto& displays = FTL_FAKE_GUARD(mStateLock, mDisplays);
     refreshArgs.outputs.reserve(displays.size());
@@ -2687,7 +2877,10 @@ CompositeResultsPerDisplay SurfaceFlinger::composite(
             refreshArgs.outputs.push_back(display);
         }
 
-        refreshArgs.frameTargets.try_emplace(id, &targeter->target());
+        composition.frameTargets.try_emplace(id, targeter->target());
+    }
+    for (const auto& [id, target] : composition.frameTargets) {
+        refreshArgs.frameTargets.try_emplace(id, &target);
     }
 
     std::vector<DisplayId> displayIds;
@@ -2765,12 +2958,18 @@ CompositeResultsPerDisplay SurfaceFlinger::composite(
             : std::nullopt;
     refreshArgs.scheduledFrameTime = scheduledFrameTimeOpt;
     refreshArgs.hasTrustedPresentationListener = mNumTrustedPresentationListeners > 0;
+    refreshArgs.validateOutputsConcurrently = mValidateOutputsConcurrently;
+    // The power hint session times the displays as if they were composited one after another.
+    refreshArgs.presentOutputsInParallel = mPresentOutputsInParallel && !mPowerHintSessionEnabled;
+    // Only the snapshots of the new front end know what changed in each layer.
+    refreshArgs.skipIdleOutputs = mSkipIdleOutputs && mLayerLifecycleManagerEnabled &&
+            !std::exchange(mMustUpdateAllOutputs, false);
     // Store the present time just before calling to the composition engine so we could notify
     // the scheduler.
-    const auto presentTime = systemTime();
+    composition.presentTime = systemTime();
 
     constexpr bool kCursorOnly = false;
-    const auto layers = moveSnapshotsToCompositionArgs(refreshArgs, kCursorOnly);
+    composition.layers = moveSnapshotsToCompositionArgs(refreshArgs, kCursorOnly);
 
     if (mLayerLifecycleManagerEnabled && !mVisibleRegionsDirty) {
         for (const auto& [token, display] : FTL_FAKE_GUARD(mStateLock, mDisplays)) {
@@ -2794,9 +2993,73 @@ CompositeResultsPerDisplay SurfaceFlinger::composite(
         }
     }
 
-    mCompositionEngine->present(refreshArgs);
-    moveSnapshotsFromCompositionArgs(refreshArgs, layers);
+    if (mPipelinedComposite) {
+        if (!mCompositionThread) {
+            // Created here so that it inherits the scheduling policy of the main thread.
+            mCompositionThread = std::make_unique<CompositionThread>();
+        }
+        mCompositionThread->run([this, &refreshArgs] {
+            mCompositionEngine->present(refreshArgs);
+            // Finish the frame right away, rather than when the next message is handled.
+            static_cast<void>(mScheduler->schedule(
+                    [this]() FTL_FAKE_GUARD(kMainThreadContext) { finishPendingComposite(); }));
+        });
+        // Until finishComposite sets the present fences, the next frame must not mistake the
+        // fence of this frame's predecessor for the one of this frame.
+        for (const auto& [_, targeter] : frameTargeters) {
+            targeter->setPresentPending();
+        }
+    } else {
+        mCompositionEngine->present(refreshArgs);
+        finishPendingComposite();
+    }
+
+    CompositeResultsPerDisplay resultsPerDisplay;
+
+    // Filter out virtual displays.
+    for (const auto& [id, coverage] : mCompositionCoverage) {
+        if (const auto idOpt = PhysicalDisplayId::tryCast(id)) {
+            resultsPerDisplay.try_emplace(*idOpt, CompositeResult{coverage});
+        }
+    }
+
+    // When pipelined, these are the results of the frame before, which may not have had all the
+    // displays of this one.
+    for (const auto& [id, _] : frameTargeters) {
+        resultsPerDisplay.try_emplace(id);
+    }
+
+    return resultsPerDisplay;
+}
+
+void SurfaceFlinger::finishPendingComposite() {
+    if (!mPendingComposite) {
+        return;
+    }
+    if (mCompositionThread) {
+        mCompositionThread->wait();
+    }
+    finishComposite(*mPendingComposite);
+    mPendingComposite.reset();
+}
+
+void SurfaceFlinger::finishComposite(PendingComposite& composition) {
+    const scheduler::FrameTarget& pacesetterTarget =
+            composition.frameTargets.get(composition.pacesetterId)->get();
+    const VsyncId vsyncId = pacesetterTarget.vsyncId();
+    ATRACE_NAME(ftl::Concat(__func__, ' ', ftl::to_underlying(vsyncId)).c_str());
+
+    const PhysicalDisplayId pacesetterId = composition.pacesetterId;
+    const scheduler::FrameTargeters& frameTargeters = composition.frameTargeters;
+    const auto& displays = FTL_FAKE_GUARD(mStateLock, mDisplays);
+    const auto& layers = composition.layers;
+    const nsecs_t presentTime = composition.presentTime;
 
+    moveSnapshotsFromCompositionArgs(composition.refreshArgs, layers);
+
+    // The layers whose previous buffer may be released early, once all of their release fences
+    // are in.
+    std::vector<Layer*> earlyReleaseLayers;
     for (auto [layer, layerFE] : layers) {
         CompositionResult compositionResult{layerFE->stealCompositionResult()};
         layer->onPreComposition(compositionResult.refreshStartTime);
@@ -2807,10 +3070,26 @@ CompositeResultsPerDisplay SurfaceFlinger::composite(
         }
         if (compositionResult.lastClientCompositionFence) {
             layer->setWasClientComposed(compositionResult.lastClientCompositionFence);
+        } else if (mEarlyBufferRelease && !layer->getClonedFrom() &&
+                   compositionResult.releaseFences.size() == 1) {
+            // Composited by HWC, whose release fence of the previous buffer is final.
+            earlyReleaseLayers.push_back(layer);
+        }
+    }
+    if (!earlyReleaseLayers.empty()) {
+        ATRACE_NAME("releasePreviousBuffersEarly");
+        bool released = false;
+        for (Layer* layer : earlyReleaseLayers) {
+            released |= layer->releasePreviousBufferEarly();
+        }
+        if (released) {
+            mTransactionCallbackInvoker.sendReleasedBuffers();
         }
     }
 
     mTimeStats->recordFrameDuration(pacesetterTarget.frameBeginTime().ns(), systemTime());
+    mScheduler->modulateVsync({}, &VsyncModulator::onFrameWorkDuration, pacesetterId,
+                              Duration(TimePoint::now() - pacesetterTarget.frameBeginTime()));
 
     // Send a power hint after presentation is finished.
     if (mPowerHintSessionEnabled) {
@@ -2867,6 +3146,18 @@ CompositeResultsPerDisplay SurfaceFlinger::composite(
 
     mTimeStats->pushCompositionStrategyState(clientCompositionRecord);
 
+    if (mPipelinedComposite) {
+        // The Scheduler ends the frame with the results of the frame before. Let the next frame
+        // begin with those of this one.
+        for (const auto& [id, flags] : mCompositionCoverage) {
+            if (const auto idOpt = PhysicalDisplayId::tryCast(id)) {
+                if (const auto targeterOpt = frameTargeters.get(*idOpt)) {
+                    targeterOpt->get()->endFrame(CompositeResult{flags});
+                }
+            }
+        }
+    }
+
     using namespace ftl::flag_operators;
 
     // TODO(b/160583065): Enable skip validation when SF caches all client composition layers.
@@ -2891,17 +3182,6 @@ CompositeResultsPerDisplay SurfaceFlinger::composite(
     if (mPowerHintSessionEnabled) {
         mPowerAdvisor->setCompositeEnd(TimePoint::now());
     }
-
-    CompositeResultsPerDisplay resultsPerDisplay;
-
-    // Filter out virtual displays.
-    for (const auto& [id, coverage] : mCompositionCoverage) {
-        if (const auto idOpt = PhysicalDisplayId::tryCast(id)) {
-            resultsPerDisplay.try_emplace(*idOpt, CompositeResult{coverage});
-        }
-    }
-
-    return resultsPerDisplay;
 }
 
 void SurfaceFlinger::updateLayerGeometry() {
@@ -2994,21 +3274,30 @@ void SurfaceFlinger::onCompositionPresented(PhysicalDisplayId pacesetterId,
     ui::PhysicalDisplayMap<PhysicalDisplayId, std::shared_ptr<FenceTime>> presentFences;
     ui::PhysicalDisplayMap<PhysicalDisplayId, const sp<Fence>> gpuCompositionDoneFences;
 
+    bool pacesetterPresentSkipped = false;
     for (const auto& [id, targeter] : frameTargeters) {
-        auto presentFence = getHwComposer().getPresentFence(id);
+        ftl::FakeGuard guard(mStateLock);
+        const auto display = getCompositionDisplayLocked(id);
+
+        // A display with nothing to update was not presented, so the HWC still has the present
+        // fence of an earlier frame.
+        const bool presentSkipped =
+                display && display->getState().frameUpdate == OutputFrameUpdate::SKIPPED;
+        auto presentFence =
+                presentSkipped ? Fence::NO_FENCE : getHwComposer().getPresentFence(id);
 
         if (id == pacesetterId) {
             mTransactionCallbackInvoker.addPresentFence(presentFence);
+            pacesetterPresentSkipped = presentSkipped;
         }
 
         if (auto fenceTime = targeter->setPresentFence(std::move(presentFence));
             fenceTime->isValid()) {
+            FenceResolver::getInstance().track(fenceTime);
             presentFences.try_emplace(id, std::move(fenceTime));
         }
 
-        ftl::FakeGuard guard(mStateLock);
-        if (const auto display = getCompositionDisplayLocked(id);
-            display && display->getState().usesClientComposition) {
+        if (display && !presentSkipped && display->getState().usesClientComposition) {
             gpuCompositionDoneFences
                     .try_emplace(id, display->getRenderSurface()->getClientTargetAcquireFence());
         }
@@ -3024,7 +3313,9 @@ void SurfaceFlinger::onCompositionPresented(PhysicalDisplayId pacesetterId,
     std::shared_ptr<FenceTime> pacesetterGpuCompositionDoneFenceTime =
             gpuCompositionDoneFences.get(pacesetterId)
                     .transform([](sp<Fence> fence) {
-                        return std::make_shared<FenceTime>(std::move(fence));
+                        auto fenceTime = std::make_shared<FenceTime>(std::move(fence));
+                        FenceResolver::getInstance().track(fenceTime);
+                        return fenceTime;
                     })
                     .value_or(FenceTime::NO_FENCE);
 
@@ -3042,7 +3333,8 @@ void SurfaceFlinger::onCompositionPresented(PhysicalDisplayId pacesetterId,
     const TimePoint compositeTime =
             TimePoint::fromNs(mCompositionEngine->getLastFrameRefreshTimestamp());
     const Duration presentLatency =
-            getHwComposer().hasCapability(Capability::PRESENT_FENCE_IS_NOT_RELIABLE)
+            getHwComposer().hasCapability(Capability::PRESENT_FENCE_IS_NOT_RELIABLE) ||
+                    pacesetterPresentSkipped
             ? Duration::zero()
             : mPresentLatencyTracker.trackPendingFrame(compositeTime, pacesetterPresentFenceTime);
 
@@ -3112,68 +3404,78 @@ void SurfaceFlinger::onCompositionPresented(PhysicalDisplayId pacesetterId,
         mAddingHDRLayerInfoListener = false;
     }
 
-    if (haveNewListeners || mHdrLayerInfoChanged) {
-        for (auto& [compositionDisplay, listener] : hdrInfoListeners) {
+    if ((haveNewListeners || mHdrLayerInfoChanged) && !hdrInfoListeners.empty()) {
+        // The infos of all displays are gathered in a single pass over the layers.
+        struct DisplayHdrInfo {
             HdrLayerInfoReporter::HdrLayerInfo info;
             int32_t maxArea = 0;
+        };
+        std::vector<DisplayHdrInfo> displayHdrInfos(hdrInfoListeners.size());
 
-            auto updateInfoFn =
-                    [&](const std::shared_ptr<compositionengine::Display>& compositionDisplay,
-                        const frontend::LayerSnapshot& snapshot, const sp<LayerFE>& layerFe) {
-                        if (snapshot.isVisible &&
-                            compositionDisplay->includesLayer(snapshot.outputFilter)) {
-                            if (isHdrLayer(snapshot)) {
-                                const auto* outputLayer =
-                                        compositionDisplay->getOutputLayerForLayer(layerFe);
-                                if (outputLayer) {
-                                    const float desiredHdrSdrRatio =
-                                            snapshot.desiredHdrSdrRatio < 1.f
-                                            ? std::numeric_limits<float>::infinity()
-                                            : snapshot.desiredHdrSdrRatio;
-                                    info.mergeDesiredRatio(desiredHdrSdrRatio);
-                                    info.numberOfHdrLayers++;
-                                    const auto displayFrame = outputLayer->getState().displayFrame;
-                                    const int32_t area =
-                                            displayFrame.width() * displayFrame.height();
-                                    if (area > maxArea) {
-                                        maxArea = area;
-                                        info.maxW = displayFrame.width();
-                                        info.maxH = displayFrame.height();
-                                    }
-                                }
-                            }
-                        }
-                    };
-
-            if (mLayerLifecycleManagerEnabled) {
-                mLayerSnapshotBuilder.forEachVisibleSnapshot(
-                        [&, compositionDisplay = compositionDisplay](
-                                std::unique_ptr<frontend::LayerSnapshot>& snapshot) {
-                            auto it = mLegacyLayers.find(snapshot->sequence);
-                            LLOG_ALWAYS_FATAL_WITH_TRACE_IF(it == mLegacyLayers.end(),
-                                                            "Couldnt find layer object for %s",
-                                                            snapshot->getDebugString().c_str());
-                            auto& legacyLayer = it->second;
-                            sp<LayerFE> layerFe =
-                                    legacyLayer->getCompositionEngineLayerFE(snapshot->path);
-
-                            updateInfoFn(compositionDisplay, *snapshot, layerFe);
-                        });
-            } else {
-                mDrawingState.traverse([&, compositionDisplay = compositionDisplay](Layer* layer) {
-                    const auto layerFe = layer->getCompositionEngineLayerFE();
-                    const frontend::LayerSnapshot& snapshot = *layer->getLayerSnapshot();
-                    updateInfoFn(compositionDisplay, snapshot, layerFe);
-                });
+        auto updateInfoFn = [&](const frontend::LayerSnapshot& snapshot,
+                                const sp<LayerFE>& layerFe) {
+            if (!snapshot.isVisible || !isHdrLayer(snapshot)) {
+                return;
+            }
+            for (size_t i = 0; i < hdrInfoListeners.size(); i++) {
+                const auto& compositionDisplay = hdrInfoListeners[i].first;
+                if (!compositionDisplay->includesLayer(snapshot.outputFilter)) {
+                    continue;
+                }
+                const auto* outputLayer = compositionDisplay->getOutputLayerForLayer(layerFe);
+                if (!outputLayer) {
+                    continue;
+                }
+                auto& [info, maxArea] = displayHdrInfos[i];
+                const float desiredHdrSdrRatio = snapshot.desiredHdrSdrRatio < 1.f
+                        ? std::numeric_limits<float>::infinity()
+                        : snapshot.desiredHdrSdrRatio;
+                info.mergeDesiredRatio(desiredHdrSdrRatio);
+                info.numberOfHdrLayers++;
+                const auto displayFrame = outputLayer->getState().displayFrame;
+                const int32_t area = displayFrame.width() * displayFrame.height();
+                if (area > maxArea) {
+                    maxArea = area;
+                    info.maxW = displayFrame.width();
+                    info.maxH = displayFrame.height();
+                }
             }
-            listener->dispatchHdrLayerInfo(info);
+        };
+
+        if (mLayerLifecycleManagerEnabled) {
+            mLayerSnapshotBuilder.forEachVisibleSnapshot(
+                    [&](std::unique_ptr<frontend::LayerSnapshot>& snapshot) {
+                        auto it = mLegacyLayers.find(snapshot->sequence);
+                        LLOG_ALWAYS_FATAL_WITH_TRACE_IF(it == mLegacyLayers.end(),
+                                                        "Couldnt find layer object for %s",
+                                                        snapshot->getDebugString().c_str());
+                        auto& legacyLayer = it->second;
+                        sp<LayerFE> layerFe =
+                                legacyLayer->getCompositionEngineLayerFE(snapshot->path);
+
+                        updateInfoFn(*snapshot, layerFe);
+                    });
+        } else {
+            mDrawingState.traverse([&](Layer* layer) {
+                const auto layerFe = layer->getCompositionEngineLayerFE();
+                const frontend::LayerSnapshot& snapshot = *layer->getLayerSnapshot();
+                updateInfoFn(snapshot, layerFe);
+            });
+        }
+
+        for (size_t i = 0; i < hdrInfoListeners.size(); i++) {
+            hdrInfoListeners[i].second->dispatchHdrLayerInfo(displayHdrInfos[i].info);
         }
     }
 
     mHdrLayerInfoChanged = false;
 
-    mTransactionCallbackInvoker.sendCallbacks(false /* onCommitOnly */);
-    mTransactionCallbackInvoker.clearCompletedTransactions();
+    {
+        FrameStageStats::ScopedTimer callbacksTimer(mFrameStageStats.get(), pacesetterId,
+                                                    FrameStageStats::Stage::Callbacks);
+        mTransactionCallbackInvoker.sendCallbacks(false /* onCommitOnly */);
+        mTransactionCallbackInvoker.clearCompletedTransactions();
+    }
 
     mTimeStats->incrementTotalFrames();
     mTimeStats->setPresentFenceGlobal(pacesetterPresentFenceTime);
@@ -4033,10 +4335,15 @@ void SurfaceFlinger::updateInputFlinger(VsyncId vsyncId, TimePoint frameTime) {
     std::vector<WindowInfo> windowInfos;
     std::vector<DisplayInfo> displayInfos;
     bool updateWindowInfo = false;
+    // Without the ids of the windows which changed, the listeners compare all of them.
+    std::optional<std::unordered_set<int32_t>> changedWindowIds;
     if (mUpdateInputInfo) {
         mUpdateInputInfo = false;
         updateWindowInfo = true;
         buildWindowInfos(windowInfos, displayInfos);
+        if (mLayerLifecycleManagerEnabled) {
+            changedWindowIds = mLayerSnapshotBuilder.takeChangedInputWindowIds();
+        }
     }
 
     std::unordered_set<int32_t> visibleWindowIds;
@@ -4054,6 +4361,8 @@ void SurfaceFlinger::updateInputFlinger(VsyncId vsyncId, TimePoint frameTime) {
     BackgroundExecutor::getInstance().sendCallbacks({[updateWindowInfo,
                                                       windowInfos = std::move(windowInfos),
                                                       displayInfos = std::move(displayInfos),
+                                                      changedWindowIds =
+                                                              std::move(changedWindowIds),
                                                       inputWindowCommands =
                                                               std::move(mInputWindowCommands),
                                                       inputFlinger = mInputFlinger, this,
@@ -4068,7 +4377,8 @@ void SurfaceFlinger::updateInputFlinger(VsyncId vsyncId, TimePoint frameTime) {
                                          std::move(
                                                  inputWindowCommands.windowInfosReportedListeners),
                                          /* forceImmediateCall= */ visibleWindowsChanged ||
-                                                 !inputWindowCommands.focusRequests.empty());
+                                                 !inputWindowCommands.focusRequests.empty(),
+                                         std::move(changedWindowIds));
         } else {
             // If there are listeners but no changes to input windows, call the listeners
             // immediately.
@@ -4361,6 +4671,8 @@ void SurfaceFlinger::sendNotifyExpectedPresentHint(PhysicalDisplayId displayId)
         itr->second.hintStatus != NotifyExpectedPresentHintStatus::ScheduleOnPresent) {
         return;
     }
+    // The hint is sent through the HAL, which the composition may still be presenting with.
+    finishPendingComposite();
     scheduleNotifyExpectedPresentHint(displayId);
 }
 
@@ -4678,7 +4990,7 @@ status_t SurfaceFlinger::addClientLayer(LayerCreationArgs& args, const sp<IBinde
     {
         std::scoped_lock<std::mutex> lock(mCreatedLayersLock);
         mCreatedLayers.emplace_back(layer, parent, args.addToRoot);
-        mNewLayers.emplace_back(std::make_unique<frontend::RequestedLayerState>(args));
+        mNewLayers.emplace_back(mLayerLifecycleManager.getLayerPool()->make(args));
         args.mirrorLayerHandle.clear();
         args.parentHandle.clear();
         mNewLayerArgs.emplace_back(std::move(args));
@@ -4766,10 +5078,10 @@ TransactionHandler::TransactionReadiness SurfaceFlinger::transactionReadyBufferC
             // barrier. This means the incoming buffer is older and we can release it here. We
             // don't wait on the barrier since we know that's stale information.
             if (layer->getDrawingState().barrierProducerId > s.bufferData->producerId) {
-                layer->callReleaseBufferCallback(s.bufferData->releaseBufferListener,
-                                                 resolvedState.externalTexture->getBuffer(),
-                                                 s.bufferData->frameNumber,
-                                                 s.bufferData->acquireFence);
+                layer->queueReleaseBufferCallback(s.bufferData->releaseBufferListener,
+                                                  resolvedState.externalTexture->getBuffer(),
+                                                  s.bufferData->frameNumber,
+                                                  s.bufferData->acquireFence);
                 // Delete the entire state at this point and not just release the buffer because
                 // everything associated with the Layer in this Transaction is now out of date.
                 ATRACE_FORMAT("DeleteStaleBuffer %s barrierProducerId:%d > %d",
@@ -4808,7 +5120,7 @@ TransactionHandler::TransactionReadiness SurfaceFlinger::transactionReadyBufferC
                 s.bufferData->flags.test(BufferData::BufferDataChange::fenceChanged) &&
                 s.bufferData->acquireFence;
         const bool fenceSignaled = !acquireFenceAvailable ||
-                s.bufferData->acquireFence->getStatus() != Fence::Status::Unsignaled;
+                TransactionHandler::isAcquireFenceSignaled(resolvedState);
         if (!fenceSignaled) {
             // check fence status
             const bool allowLatchUnsignaled = shouldLatchUnsignaled(s, transaction.states.size(),
@@ -4862,15 +5174,14 @@ TransactionHandler::TransactionReadiness SurfaceFlinger::transactionReadyBufferC
                 if (s.bufferData->releaseBufferListener) {
                     uint32_t currentMaxAcquiredBufferCount =
                             getMaxAcquiredBufferCountForCurrentRefreshRate(layer->ownerUid.val());
-                    ATRACE_FORMAT_INSTANT("callReleaseBufferCallback %s - %" PRIu64,
+                    ATRACE_FORMAT_INSTANT("queueReleaseBufferCallback %s - %" PRIu64,
                                           layer->name.c_str(), s.bufferData->frameNumber);
-                    s.bufferData->releaseBufferListener
-                            ->onReleaseBuffer({resolvedState.externalTexture->getBuffer()->getId(),
-                                               s.bufferData->frameNumber},
-                                              s.bufferData->acquireFence
-                                                      ? s.bufferData->acquireFence
-                                                      : Fence::NO_FENCE,
-                                              currentMaxAcquiredBufferCount);
+                    mTransactionCallbackInvoker
+                            .addReleasedBuffer(s.bufferData->releaseBufferListener,
+                                               {resolvedState.externalTexture->getBuffer()->getId(),
+                                                s.bufferData->frameNumber},
+                                               s.bufferData->acquireFence,
+                                               currentMaxAcquiredBufferCount);
                 }
 
                 // Delete the entire state at this point and not just release the buffer because
@@ -4909,7 +5220,7 @@ TransactionHandler::TransactionReadiness SurfaceFlinger::transactionReadyBufferC
                 s.bufferData->flags.test(BufferData::BufferDataChange::fenceChanged) &&
                 s.bufferData->acquireFence;
         const bool fenceSignaled = !acquireFenceAvailable ||
-                s.bufferData->acquireFence->getStatus() != Fence::Status::Unsignaled;
+                TransactionHandler::isAcquireFenceSignaled(resolvedState);
         if (!fenceSignaled) {
             // check fence status
             const bool allowLatchUnsignaled = shouldLatchUnsignaled(s, transaction.states.size(),
@@ -6255,12 +6566,16 @@ status_t SurfaceFlinger::doDump(int fd, const DumpArgs& args, bool asProto) {
         return NO_ERROR;
     }
 
+    // The dumpers which read the front end or the composition state run on the main thread, and the
+    // others take mStateLock, except for --snapshot which takes neither.
     static const std::unordered_map<std::string, Dumper> dumpers = {
+            {"--boot-timing"s, dumper(&SurfaceFlinger::dumpBootTiming)},
             {"--comp-displays"s, dumper(&SurfaceFlinger::dumpCompositionDisplays)},
             {"--display-id"s, dumper(&SurfaceFlinger::dumpDisplayIdentificationData)},
             {"--displays"s, dumper(&SurfaceFlinger::dumpDisplays)},
             {"--edid"s, argsDumper(&SurfaceFlinger::dumpRawDisplayIdentificationData)},
             {"--events"s, dumper(&SurfaceFlinger::dumpEvents)},
+            {"--frame-stages"s, argsDumper(&SurfaceFlinger::dumpFrameStages)},
             {"--frametimeline"s, argsDumper(&SurfaceFlinger::dumpFrameTimeline)},
             {"--frontend"s, mainThreadDumper(&SurfaceFlinger::dumpFrontEnd)},
             {"--hdrinfo"s, dumper(&SurfaceFlinger::dumpHdrInfo)},
@@ -6270,6 +6585,8 @@ status_t SurfaceFlinger::doDump(int fd, const DumpArgs& args, bool asProto) {
             {"--list"s, dumper(&SurfaceFlinger::listLayersLocked)},
             {"--planner"s, argsDumper(&SurfaceFlinger::dumpPlannerInfo)},
             {"--scheduler"s, dumper(&SurfaceFlinger::dumpScheduler)},
+            {"--snapshot"s,
+             [this](const DumpArgs&, bool, std::string& result) { dumpSnapshot(result); }},
             {"--timestats"s, protoDumper(&SurfaceFlinger::dumpTimeStats)},
             {"--vsync"s, dumper(&SurfaceFlinger::dumpVsync)},
             {"--wide-color"s, dumper(&SurfaceFlinger::dumpWideColorInfo)},
@@ -6336,6 +6653,10 @@ void SurfaceFlinger::dumpFrameTimeline(const DumpArgs& args, std::string& result
     mFrameTimeline->parseArgs(args, result);
 }
 
+void SurfaceFlinger::dumpFrameStages(const DumpArgs& args, std::string& result) const {
+    mFrameStageStats->parseArgs(args, result);
+}
+
 void SurfaceFlinger::logFrameStats(TimePoint now) {
     static TimePoint sTimestamp = now;
     if (now - sTimestamp < 30min) return;
@@ -6373,6 +6694,14 @@ void SurfaceFlinger::dumpScheduler(std::string& result) const {
                   dispSyncPresentTimeOffset, getVsyncPeriodFromHWC());
 }
 
+void SurfaceFlinger::dumpBootTiming(std::string& result) const {
+    std::lock_guard lock(mBootPhasesMutex);
+    result.append("Boot phases:\n");
+    for (const auto& [name, duration] : mBootPhases) {
+        StringAppendF(&result, "  %-28s %8.3f ms\n", name, duration / 1e6);
+    }
+}
+
 void SurfaceFlinger::dumpEvents(std::string& result) const {
     mScheduler->dump(scheduler::Cycle::Render, result);
 }
@@ -6576,6 +6905,135 @@ void SurfaceFlinger::dumpVisibleFrontEnd(std::string& result) {
     }
 }
 
+void SurfaceFlinger::publishDumpSnapshotIfRequested(VsyncId vsyncId) {
+    if (!mDumpSnapshotRequested.exchange(false)) {
+        return;
+    }
+    ATRACE_CALL();
+
+    // Only copy, and leave the serialization to the dump.
+    auto snapshot = std::make_shared<DumpSnapshot>();
+    snapshot->vsyncId = vsyncId;
+    snapshot->time = TimePoint::now();
+    for (const auto& [_, display] : FTL_FAKE_GUARD(mStateLock, mDisplays)) {
+        const auto coverage = mCompositionCoverage.get(display->getId());
+        snapshot->displays.push_back({display->getDisplayName(), display->getId(),
+                                      display->getLayerStack(), display->getSize(),
+                                      display->getOrientation(), display->getPowerMode(),
+                                      display->isVirtual()
+                                              ? std::nullopt
+                                              : std::make_optional(display->getActiveMode()),
+                                      coverage ? coverage->get() : CompositionCoverageFlags()});
+    }
+    if (mLayerLifecycleManagerEnabled) {
+        const auto& builder = mLayerSnapshotBuilder;
+        builder.forEachVisibleSnapshot([&](const frontend::LayerSnapshot& layerSnapshot) {
+            if (layerSnapshot.hasSomethingToDraw()) {
+                snapshot->visibleSnapshots.push_back(layerSnapshot);
+            }
+        });
+        builder.forEachInputSnapshot([&](const frontend::LayerSnapshot& layerSnapshot) {
+            snapshot->inputSnapshots.push_back(layerSnapshot);
+        });
+    }
+
+    std::shared_ptr<const DumpSnapshot> previous;
+    {
+        std::lock_guard lock(mDumpSnapshotMutex);
+        previous = std::exchange(mDumpSnapshot, std::move(snapshot));
+    }
+    mDumpSnapshotCondition.notify_all();
+}
+
+auto SurfaceFlinger::takeDumpSnapshot() -> std::shared_ptr<const DumpSnapshot> {
+    constexpr auto kTimeout = 500ms;
+
+    std::unique_lock lock(mDumpSnapshotMutex);
+    // Drop the snapshot which an earlier dump timed out on, on the main thread like below.
+    if (auto stale = std::exchange(mDumpSnapshot, nullptr)) {
+        static_cast<void>(mScheduler->schedule([stale = std::move(stale)]() {}));
+    }
+    mDumpSnapshotRequested = true;
+    // Commit a frame if SurfaceFlinger is idle.
+    scheduleCommit(FrameHint::kNone);
+
+    mDumpSnapshotCondition.wait_for(lock, kTimeout, [this]() REQUIRES(mDumpSnapshotMutex) {
+        return mDumpSnapshot != nullptr;
+    });
+    return std::exchange(mDumpSnapshot, nullptr);
+}
+
+void SurfaceFlinger::dumpSnapshot(std::string& result) {
+    using namespace std::string_view_literals;
+
+    if (!mLayerLifecycleManagerEnabled) {
+        result.append("The snapshot dump needs the new front end.\n");
+        return;
+    }
+
+    std::shared_ptr<const DumpSnapshot> snapshot = takeDumpSnapshot();
+    if (!snapshot) {
+        result.append("Timed out waiting for the main thread to take a snapshot.\n");
+        return;
+    }
+
+    StringAppendF(&result, "Snapshot of vsync %" PRId64 ", taken %.3f ms ago\n",
+                  ftl::to_underlying(snapshot->vsyncId),
+                  ticks<std::milli, float>(TimePoint::now() - snapshot->time));
+    // These sections need mStateLock or the main thread to be consistent, so they are left out.
+    result.append("Without the hierarchy, HWC layers, planner and composition displays, which only "
+                  "the full dump has.\n\n");
+
+    utils::Dumper dumper{result};
+    {
+        utils::Dumper::Section section(dumper,
+                                       ftl::Concat("Displays (", snapshot->displays.size(),
+                                                   " entries)")
+                                               .str());
+        for (const auto& display : snapshot->displays) {
+            utils::Dumper::Section displaySection(dumper, to_string(display.id));
+            dumper.dump("name"sv, '"' + display.name + '"');
+            dumper.dump("layerStack"sv, display.layerStack.id);
+            dumper.dump("size"sv, display.size.width, display.size.height);
+            dumper.dump("orientation"sv, ui::toCString(display.orientation));
+            dumper.dump("powerMode"sv, display.powerMode);
+            dumper.dump("activeMode"sv, display.activeMode);
+            dumper.dump("compositionCoverage"sv, display.compositionCoverage.string());
+        }
+    }
+
+    std::ostringstream out;
+    out << "Composition list\n";
+    ui::LayerStack lastPrintedLayerStackHeader = ui::INVALID_LAYER_STACK;
+    for (const auto& layerSnapshot : snapshot->visibleSnapshots) {
+        if (lastPrintedLayerStackHeader != layerSnapshot.outputFilter.layerStack) {
+            lastPrintedLayerStackHeader = layerSnapshot.outputFilter.layerStack;
+            out << "LayerStack=" << lastPrintedLayerStackHeader.id << "\n";
+        }
+        out << "  " << layerSnapshot << "\n";
+    }
+
+    out << "\nInput list\n";
+    lastPrintedLayerStackHeader = ui::INVALID_LAYER_STACK;
+    for (const auto& layerSnapshot : snapshot->inputSnapshots) {
+        if (lastPrintedLayerStackHeader != layerSnapshot.outputFilter.layerStack) {
+            lastPrintedLayerStackHeader = layerSnapshot.outputFilter.layerStack;
+            out << "LayerStack=" << lastPrintedLayerStackHeader.id << "\n";
+        }
+        out << "  " << layerSnapshot << "\n";
+    }
+    out << "\n";
+    result.append(out.str());
+
+    result.append("BackgroundExecutor state:\n");
+    BackgroundExecutor::getInstance().dump(result);
+    result.append(mTimeStats->miniDump());
+    result.append("\n");
+
+    // The snapshots may hold the last references to buffers, which are released on the main thread.
+    static_cast<void>(mScheduler->schedule([snapshot = std::move(snapshot)]() {}));
+}
+
 perfetto::protos::LayersProto SurfaceFlinger::dumpDrawingStateProto(uint32_t traceFlags) const {
     std::unordered_set<uint64_t> stackIdsToSkip;
 
@@ -6801,6 +7259,8 @@ void SurfaceFlinger::dumpAll(const DumpArgs& args, const std::string& compositio
 
     result.append("ClientCache state:\n");
     ClientCache::getInstance().dump(result);
+    result.append("BackgroundExecutor state:\n");
+    BackgroundExecutor::getInstance().dump(result);
     DebugEGLImageTracker::getInstance()->dump(result);
 
     if (const auto display = getDefaultDisplayDeviceLocked()) {
@@ -6869,6 +7329,7 @@ void SurfaceFlinger::dumpAll(const DumpArgs& args, const std::string& compositio
      */
     const GraphicBufferAllocator& alloc(GraphicBufferAllocator::get());
     alloc.dump(result);
+    GraphicBufferMapper::get().dumpImportStats(result);
 
     /*
      * Dump flag/property manager state
@@ -7023,9 +7484,9 @@ status_t SurfaceFlinger::CheckTransactCodeCredentials(uint32_t code) {
         code == IBinder::SYSPROPS_TRANSACTION) {
         return OK;
     }
-    // Numbers from 1000 to 1045 are currently used for backdoors. The code
+    // Numbers from 1000 to 1046 are currently used for backdoors. The code
     // in onTransact verifies that the user is root, and has access to use SF.
-    if (code >= 1000 && code <= 1045) {
+    if (code >= 1000 && code <= 1046) {
         ALOGV("Accessing SurfaceFlinger through backdoor code: %u", code);
         return OK;
     }
@@ -7566,6 +8027,12 @@ status_t SurfaceFlinger::onTransact(uint32_t code, const Parcel& data, Parcel* r
                 }
                 return err;
             }
+            // Release the memory which RenderEngine only keeps for reuse, e.g. when the device
+            // runs low on memory.
+            case 1046: {
+                getRenderEngine().trimMemory();
+                return NO_ERROR;
+            }
         }
     }
     return err;
@@ -8100,6 +8567,14 @@ void SurfaceFlinger::captureScreenCommon(RenderAreaFuture renderAreaFuture,
                                          const sp<IScreenCaptureListener>& captureListener) {
     ATRACE_CALL();
 
+    // The Binder thread waits for the capture to be rendered, which only so many may do at once.
+    const auto inFlightToken = mScreenCaptureThrottle.tryAcquire();
+    if (!inFlightToken) {
+        ALOGW("Dropping a screen capture, too many are in flight");
+        invokeScreenCaptureError(WOULD_BLOCK, captureListener);
+        return;
+    }
+
     if (exceedsMaxRenderTargetSize(bufferSize.getWidth(), bufferSize.getHeight())) {
         ALOGE("Attempted to capture screen with size (%" PRId32 ", %" PRId32
               ") that exceeds render target size limit.",
@@ -8151,6 +8626,10 @@ void SurfaceFlinger::captureScreenCommon(RenderAreaFuture renderAreaFuture,
             renderengine::impl::ExternalTexture>(buffer, getRenderEngine(),
                                                  renderengine::impl::ExternalTexture::Usage::
                                                          WRITEABLE);
+
+    // The screenshot is rendered on the main thread, on top of the regular frames.
+    mPowerAdvisor->notifyExpectedHeavyFrame();
+
     auto fence = captureScreenCommon(std::move(renderAreaFuture), getLayerSnapshots, texture,
                                      false /* regionSampling */, grayscale, isProtected,
                                      captureListener);
@@ -9196,6 +9675,9 @@ std::vector<std::pair<Layer*, LayerFE*>> SurfaceFlinger::moveSnapshotsToComposit
                     auto& legacyLayer = it->second;
                     sp<LayerFE> layerFE = legacyLayer->getCompositionEngineLayerFE(snapshot->path);
                     snapshot->fps = getLayerFramerate(currentTime, snapshot->sequence);
+                    snapshot->frameChanges =
+                            getFrameChanges(*snapshot,
+                                            mLayersIdsWithQueuedFrames.contains(snapshot->path.id));
                     layerFE->mSnapshot = std::move(snapshot);
                     refreshArgs.layers.push_back(layerFE);
                     layers.emplace_back(legacyLayer.get(), layerFE.get());
@@ -9239,7 +9721,7 @@ SurfaceFlinger::getLayerSnapshotsForScreenshots(
         std::optional<ui::LayerStack> layerStack, uint32_t uid,
         std::function<bool(const frontend::LayerSnapshot&, bool& outStopTraversal)>
                 snapshotFilterFn) {
-    return [&, layerStack, uid]() {
+    return [&, layerStack, uid, snapshotFilterFn = std::move(snapshotFilterFn)]() {
         std::vector<std::pair<Layer*, sp<LayerFE>>> layers;
         bool stopTraversal = false;
         mLayerSnapshotBuilder.forEachVisibleSnapshot(
@@ -9300,7 +9782,8 @@ SurfaceFlinger::getLayerSnapshotsForScreenshots(std::optional<ui::LayerStack> la
                              getHwComposer().getSupportedLayerGenericMetadata(),
                      .genericLayerMetadataKeyMap = getGenericLayerMetadataKeyMap(),
                      .skipRoundCornersWhenProtected =
-                             !getRenderEngine().supportsProtectedContent()};
+                             !getRenderEngine().supportsProtectedContent(),
+                     .flattenedRoot = &mLayerHierarchyBuilder.getFlattenedHierarchy()};
         mLayerSnapshotBuilder.update(args);
 
         auto getLayerSnapshotsFn =
@@ -56,6 +56,7 @@
 #include <utils/Trace.h>
 #include <utils/threads.h>
 
+#include <compositionengine/CompositionRefreshArgs.h>
 #include <compositionengine/OutputColorSetting.h>
 #include <scheduler/Fps.h>
 #include <scheduler/PresentLatencyTracker.h>
@@ -66,6 +67,7 @@
 #include <ui/FenceResult.h>
 
 #include <common/FlagManager.h>
+#include "CompositionThread.h"
 #include "Display/PhysicalDisplay.h"
 #include "DisplayDevice.h"
 #include "DisplayHardware/HWC2.h"
@@ -83,6 +85,7 @@
 #include "Scheduler/ISchedulerCallback.h"
 #include "Scheduler/RefreshRateSelector.h"
 #include "Scheduler/Scheduler.h"
+#include "ScreenCaptureThrottle.h"
 #include "SurfaceFlingerFactory.h"
 #include "ThreadContext.h"
 #include "Tracing/LayerTracing.h"
@@ -91,6 +94,7 @@
 #include "TransactionState.h"
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <functional>
 #include <map>
@@ -128,6 +132,7 @@ class MessageBase;
 class RefreshRateOverlay;
 class RegionSamplingThread;
 class RenderArea;
+class FrameStageStats;
 class TimeStats;
 class FrameTracer;
 class ScreenCapturer;
@@ -305,6 +310,11 @@ public:
     // debug.sf.disable_client_composition_cache
     bool mDisableClientCompositionCache = false;
 
+    // Number of client composition requests cached per display. Set by
+    // debug.sf.client_composition_cache_size, and defaults to the number of framebuffers which
+    // can be acquired when 0.
+    uint32_t mClientCompositionCacheSize = 0;
+
     // Disables expensive rendering for all displays
     // This is scheduled on the main thread
     void disableExpensiveRendering();
@@ -315,6 +325,23 @@ public:
     // run parallel to the hwc validateDisplay call and re-run if the predition is incorrect.
     bool mPredictCompositionStrategy = false;
 
+    // If set, client composition only redraws the region of the client target which changed since
+    // its buffer was last queued, and passes the damage of the client target on to the HWC.
+    bool mPartialClientComposition = false;
+
+    // If set, and the HWC can present from several threads, composition engine validates all the
+    // displays at the same time rather than one after another.
+    bool mValidateOutputsConcurrently = false;
+
+    // If set, and the HWC can present from several threads, composition engine presents the
+    // displays in parallel rather than one after another. Requires a threaded RenderEngine.
+    bool mPresentOutputsInParallel = false;
+
+    // If set, composition engine neither composites nor presents the displays on which no layer
+    // changed, and only passes new buffers on to the HWC if they are all that changed on a
+    // display. Only applies to frames in which nothing but the layers changed.
+    bool mSkipIdleOutputs = false;
+
     // If true, then any layer with a SMPTE 170M transfer function is decoded using the sRGB
     // transfer instead. This is mainly to preserve legacy behavior, where implementations treated
     // SMPTE 170M as sRGB prior to color management being implemented, and now implementations rely
@@ -676,6 +703,7 @@ private:
     CompositeResultsPerDisplay composite(PhysicalDisplayId pacesetterId,
                                          const scheduler::FrameTargeters&) override
             REQUIRES(kMainThreadContext);
+    void finishPendingComposite() override REQUIRES(kMainThreadContext);
 
     void sample() override;
 
@@ -772,6 +800,9 @@ private:
                               bool& out) REQUIRES(kMainThreadContext);
     void updateLayerHistory(nsecs_t now);
     frontend::Update flushLifecycleUpdates() REQUIRES(kMainThreadContext);
+    // Takes the queued transactions and layer changes, and applies them to the
+    // LayerLifecycleManager and the LayerHierarchyBuilder.
+    frontend::Update takeFrontEndUpdate() REQUIRES(kMainThreadContext);
 
     void updateInputFlinger(VsyncId vsyncId, TimePoint frameTime);
     void persistDisplayBrightness(bool needsComposite) REQUIRES(kMainThreadContext);
@@ -1017,6 +1048,21 @@ private:
     /*
      * Compositing
      */
+    // A frame between the start of composite and the end of its composition.
+    struct PendingComposite {
+        PhysicalDisplayId pacesetterId;
+        scheduler::FrameTargeters frameTargeters;
+        // Copies of the targets of the frame, which refreshArgs points to, since the next frame
+        // begins before a pipelined composition has completed.
+        ui::PhysicalDisplayMap<PhysicalDisplayId, scheduler::FrameTargetSnapshot> frameTargets;
+        compositionengine::CompositionRefreshArgs refreshArgs;
+        std::vector<std::pair<Layer*, LayerFE*>> layers;
+        nsecs_t presentTime = 0;
+    };
+
+    // Runs the main thread part of the frame once its composition has completed.
+    void finishComposite(PendingComposite&) REQUIRES(kMainThreadContext);
+
     void onCompositionPresented(PhysicalDisplayId pacesetterId, const scheduler::FrameTargeters&,
                                 nsecs_t presentStartTime) REQUIRES(kMainThreadContext);
 
@@ -1119,9 +1165,11 @@ private:
     void clearStatsLocked(const DumpArgs& args, std::string& result);
     void dumpTimeStats(const DumpArgs& args, bool asProto, std::string& result) const;
     void dumpFrameTimeline(const DumpArgs& args, std::string& result) const;
+    void dumpFrameStages(const DumpArgs& args, std::string& result) const;
     void logFrameStats(TimePoint now) REQUIRES(kMainThreadContext);
 
     void dumpScheduler(std::string& result) const REQUIRES(mStateLock);
+    void dumpBootTiming(std::string& result) const EXCLUDES(mBootPhasesMutex);
     void dumpEvents(std::string& result) const REQUIRES(mStateLock);
     void dumpVsync(std::string& result) const REQUIRES(mStateLock);
 
@@ -1134,6 +1182,32 @@ private:
     void dumpFrontEnd(std::string& result) REQUIRES(kMainThreadContext);
     void dumpVisibleFrontEnd(std::string& result) REQUIRES(mStateLock, kMainThreadContext);
 
+    // The state which the --snapshot dump reads. The main thread copies it at the end of a commit
+    // when a dump asks for it, and the dump serializes it on its own thread, without mStateLock.
+    struct DumpSnapshot {
+        struct Display {
+            std::string name;
+            DisplayId id;
+            ui::LayerStack layerStack;
+            ui::Size size;
+            ui::Rotation orientation;
+            hal::PowerMode powerMode;
+            std::optional<scheduler::FrameRateMode> activeMode;
+            CompositionCoverageFlags compositionCoverage;
+        };
+
+        VsyncId vsyncId;
+        TimePoint time;
+        std::vector<Display> displays;
+        std::vector<frontend::LayerSnapshot> visibleSnapshots;
+        std::vector<frontend::LayerSnapshot> inputSnapshots;
+    };
+
+    void publishDumpSnapshotIfRequested(VsyncId) REQUIRES(kMainThreadContext);
+    // Waits for the main thread to publish a snapshot, and takes it.
+    std::shared_ptr<const DumpSnapshot> takeDumpSnapshot() EXCLUDES(mDumpSnapshotMutex);
+    void dumpSnapshot(std::string& result) EXCLUDES(mStateLock, mDumpSnapshotMutex);
+
     perfetto::protos::LayersProto dumpDrawingStateProto(uint32_t traceFlags) const;
     void dumpOffscreenLayersProto(perfetto::protos::LayersProto& layersProto,
                                   uint32_t traceFlags = LayerTracing::TRACE_ALL) const;
@@ -1189,6 +1263,12 @@ private:
     pid_t mPid;
     std::future<void> mRenderEnginePrimeCacheFuture;
 
+    // Durations of the phases of boot, in the order they completed. Phases can overlap, e.g. the
+    // HWC connection is set up concurrently with RenderEngine.
+    void recordBootPhase(const char* name, nsecs_t duration) EXCLUDES(mBootPhasesMutex);
+    mutable std::mutex mBootPhasesMutex;
+    std::vector<std::pair<const char*, nsecs_t>> mBootPhases GUARDED_BY(mBootPhasesMutex);
+
     // mStateLock has conventions related to the current thread, because only
     // the main thread should modify variables protected by mStateLock.
     // - read access from a non-main thread must lock mStateLock, since the main
@@ -1219,6 +1299,9 @@ private:
 
     std::atomic_bool mMustComposite = false;
     std::atomic_bool mGeometryDirty = false;
+    // Set if the next composite must update every display, as something other than the layers
+    // changed, or a commit took in the changes of the layers without compositing them.
+    bool mMustUpdateAllOutputs = true;
 
     // constant members (no synchronization needed for access)
     const nsecs_t mBootTime = systemTime();
@@ -1306,11 +1389,17 @@ private:
     std::optional<TransactionTracing> mTransactionTracing;
 
     const std::shared_ptr<TimeStats> mTimeStats;
+    const std::shared_ptr<FrameStageStats> mFrameStageStats;
     const std::unique_ptr<FrameTracer> mFrameTracer;
     const std::unique_ptr<frametimeline::FrameTimeline> mFrameTimeline;
 
     VsyncId mLastCommittedVsyncId;
 
+    std::atomic<bool> mDumpSnapshotRequested = false;
+    std::mutex mDumpSnapshotMutex;
+    std::condition_variable mDumpSnapshotCondition;
+    std::shared_ptr<const DumpSnapshot> mDumpSnapshot GUARDED_BY(mDumpSnapshotMutex);
+
     // If blurs should be enabled on this device.
     bool mSupportsBlur = false;
 
@@ -1352,6 +1441,21 @@ private:
 
     CompositionCoveragePerDisplay mCompositionCoverage;
 
+    // Whether composite leaves the composition of the frame to mCompositionThread, so that the
+    // commit of the next frame can start before it completes. Until finishPendingComposite, the
+    // composition owns mPendingComposite, the CompositionEngine and its outputs, and the LayerFEs
+    // along with the snapshots moved to them. Meanwhile, the main thread only takes in the
+    // transactions of the next frame, and waits for the composition before anything else.
+    bool mPipelinedComposite = false;
+    std::unique_ptr<CompositionThread> mCompositionThread;
+    std::optional<PendingComposite> mPendingComposite;
+    // The update that commit took in while the previous frame was still being composited.
+    std::optional<frontend::Update> mPipelinedUpdate;
+
+    // If set, the previous buffer of a layer which HWC composited is released as soon as the frame
+    // is presented, with the HWC release fence, instead of with the transaction callbacks.
+    bool mEarlyBufferRelease = false;
+
     // mMaxRenderTargetSize is only set once in init() so it doesn't need to be protected by
     // any mutex.
     size_t mMaxRenderTargetSize{1};
@@ -1364,6 +1468,8 @@ private:
 
     bool mLumaSampling = true;
     sp<RegionSamplingThread> mRegionSamplingThread;
+    // Leaves two of the four Binder threads to the other calls while captures render.
+    ScreenCaptureThrottle mScreenCaptureThrottle{2};
     sp<FpsReporter> mFpsReporter;
     sp<TunnelModeEnabledReporter> mTunnelModeEnabledReporter;
     ui::DisplayPrimaries mInternalDisplayPrimaries;
@@ -1456,6 +1562,8 @@ private:
 
     bool mLayerLifecycleManagerEnabled = false;
     bool mLegacyFrontEndEnabled = true;
+    // If non-zero, hierarchies of at least this many layers are updated in parallel.
+    size_t mParallelLayerSnapshotsMinLayers = 0;
 
     frontend::LayerLifecycleManager mLayerLifecycleManager;
     frontend::LayerHierarchyBuilder mLayerHierarchyBuilder;
@@ -0,0 +1,275 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "FrameStageStats"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "FrameStageStats.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+
+#include <android-base/stringprintf.h>
+#include <timestatsatomsproto/TimeStatsAtomsProtoHeader.h>
+#include <utils/String8.h>
+#include <utils/Trace.h>
+
+namespace android {
+
+using base::StringAppendF;
+using surfaceflinger::SurfaceflingerStatsFrameStages;
+using surfaceflinger::SurfaceflingerStatsFrameStagesWrapper;
+
+namespace {
+
+constexpr nsecs_t kNanosPerMicro = 1000;
+
+SurfaceflingerStatsFrameStages::Stage stageToProto(FrameStageStats::Stage stage) {
+    switch (stage) {
+        case FrameStageStats::Stage::Commit:
+            return SurfaceflingerStatsFrameStages::STAGE_COMMIT;
+        case FrameStageStats::Stage::SnapshotBuild:
+            return SurfaceflingerStatsFrameStages::STAGE_SNAPSHOT_BUILD;
+        case FrameStageStats::Stage::CompositionStrategy:
+            return SurfaceflingerStatsFrameStages::STAGE_COMPOSITION_STRATEGY;
+        case FrameStageStats::Stage::RenderEngine:
+            return SurfaceflingerStatsFrameStages::STAGE_RENDER_ENGINE;
+        case FrameStageStats::Stage::Present:
+            return SurfaceflingerStatsFrameStages::STAGE_PRESENT;
+        case FrameStageStats::Stage::Callbacks:
+            return SurfaceflingerStatsFrameStages::STAGE_CALLBACKS;
+    }
+    return SurfaceflingerStatsFrameStages::STAGE_UNSPECIFIED;
+}
+
+int64_t toMicros(std::optional<Duration> duration) {
+    return duration ? duration->ns() / kNanosPerMicro : 0;
+}
+
+} // namespace
+
+size_t FrameStageStats::bucketOf(Duration duration) {
+    const uint64_t micros = static_cast<uint64_t>(std::max<nsecs_t>(duration.ns(), 0)) /
+            static_cast<uint64_t>(kNanosPerMicro);
+    if (micros < kSubBucketCount) {
+        return static_cast<size_t>(micros);
+    }
+
+    // The position of the top bit selects the power of two, and the bits below it the bucket.
+    const size_t log2 = 63 - static_cast<size_t>(__builtin_clzll(micros));
+    const size_t subBucket = (micros >> (log2 - kSubBucketBits)) & (kSubBucketCount - 1);
+    const size_t bucket = (log2 - kSubBucketBits + 1) * kSubBucketCount + subBucket;
+    return std::min(bucket, kBucketCount - 1);
+}
+
+Duration FrameStageStats::bucketLowerBound(size_t bucket) {
+    if (bucket < kSubBucketCount) {
+        return Duration::fromNs(static_cast<nsecs_t>(bucket) * kNanosPerMicro);
+    }
+    const size_t shift = bucket / kSubBucketCount - 1;
+    const nsecs_t micros = static_cast<nsecs_t>(kSubBucketCount + bucket % kSubBucketCount)
+            << shift;
+    return Duration::fromNs(micros * kNanosPerMicro);
+}
+
+Duration FrameStageStats::bucketUpperBound(size_t bucket) {
+    if (bucket < kSubBucketCount) {
+        return Duration::fromNs(static_cast<nsecs_t>(bucket + 1) * kNanosPerMicro);
+    }
+    const size_t shift = bucket / kSubBucketCount - 1;
+    return bucketLowerBound(bucket) + Duration::fromNs((nsecs_t{1} << shift) * kNanosPerMicro);
+}
+
+FrameStageStats::Slot* FrameStageStats::slotFor(DisplayId displayId) {
+    for (Slot& slot : mSlots) {
+        uint64_t id = slot.displayId.load(std::memory_order_acquire);
+        if (id == kFreeSlot &&
+            slot.displayId.compare_exchange_strong(id, displayId.value,
+                                                   std::memory_order_acq_rel)) {
+            return &slot;
+        }
+        // The slot is taken, possibly by another thread which just claimed it for this display.
+        if (id == displayId.value) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+const FrameStageStats::Slot* FrameStageStats::findSlot(DisplayId displayId) const {
+    for (const Slot& slot : mSlots) {
+        if (slot.displayId.load(std::memory_order_acquire) == displayId.value) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+void FrameStageStats::record(DisplayId displayId, Stage stage, Duration duration) {
+    Slot* const slot = slotFor(displayId);
+    if (!slot) {
+        mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Histogram& histogram = slot->histograms[ftl::to_underlying(stage)];
+    histogram.buckets[bucketOf(duration)].fetch_add(1, std::memory_order_relaxed);
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+    histogram.totalNs.fetch_add(static_cast<uint64_t>(std::max<nsecs_t>(duration.ns(), 0)),
+                                std::memory_order_relaxed);
+}
+
+uint64_t FrameStageStats::getCount(DisplayId displayId, Stage stage) const {
+    const Slot* const slot = findSlot(displayId);
+    return slot ? slot->histograms[ftl::to_underlying(stage)].count.load(
+                          std::memory_order_relaxed)
+                : 0;
+}
+
+std::optional<Duration> FrameStageStats::getPercentile(DisplayId displayId, Stage stage,
+                                                       float percentile) const {
+    const Slot* const slot = findSlot(displayId);
+    if (!slot) {
+        return std::nullopt;
+    }
+    return percentileOf(slot->histograms[ftl::to_underlying(stage)], percentile);
+}
+
+std::optional<Duration> FrameStageStats::percentileOf(const Histogram& histogram,
+                                                      float percentile) {
+    // The buckets are read one at a time while samples may still come in, so the count is taken
+    // from the buckets themselves for the result to stay within them.
+    std::array<uint32_t, kBucketCount> counts;
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBucketCount; i++) {
+        counts[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return std::nullopt;
+    }
+
+    const float fraction = std::clamp(percentile, 0.f, 100.f) / 100.f;
+    const uint64_t rank =
+            std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * total)));
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < kBucketCount; i++) {
+        cumulative += counts[i];
+        if (cumulative >= rank) {
+            return bucketUpperBound(i);
+        }
+    }
+    return bucketUpperBound(kBucketCount - 1);
+}
+
+void FrameStageStats::clear() {
+    ATRACE_CALL();
+    // The displays keep their slot, since a cleared display is likely to record again.
+    for (Slot& slot : mSlots) {
+        for (Histogram& histogram : slot.histograms) {
+            for (auto& bucket : histogram.buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            histogram.count.store(0, std::memory_order_relaxed);
+            histogram.totalNs.store(0, std::memory_order_relaxed);
+        }
+    }
+    mDroppedCount.store(0, std::memory_order_relaxed);
+}
+
+void FrameStageStats::parseArgs(const Vector<String16>& args, std::string& result) {
+    ATRACE_CALL();
+    for (size_t i = 0; i < args.size(); i++) {
+        if (std::string(String8(args[i]).c_str()) == "-clear") {
+            clear();
+            result.append("Cleared frame stage stats\n");
+            return;
+        }
+    }
+    dump(result);
+}
+
+void FrameStageStats::dump(std::string& result) const {
+    result.append("Frame stage durations in microseconds\n");
+    for (const Slot& slot : mSlots) {
+        const uint64_t id = slot.displayId.load(std::memory_order_acquire);
+        if (id == kFreeSlot) {
+            continue;
+        }
+
+        StringAppendF(&result, "Display %" PRIu64 "\n", id);
+        StringAppendF(&result, "%20s %10s %8s %8s %8s %8s\n", "stage", "count", "p50", "p90",
+                      "p99", "mean");
+        for (const Stage stage : ftl::enum_range<Stage>()) {
+            const Histogram& histogram = slot.histograms[ftl::to_underlying(stage)];
+            const uint64_t count = histogram.count.load(std::memory_order_relaxed);
+            if (count == 0) {
+                continue;
+            }
+            const uint64_t mean =
+                    histogram.totalNs.load(std::memory_order_relaxed) / count / kNanosPerMicro;
+            StringAppendF(&result, "%20s %10" PRIu64 " %8" PRId64 " %8" PRId64 " %8" PRId64
+                          " %8" PRIu64 "\n",
+                          ftl::enum_string(stage).c_str(), count,
+                          toMicros(percentileOf(histogram, 50)),
+                          toMicros(percentileOf(histogram, 90)),
+                          toMicros(percentileOf(histogram, 99)), mean);
+        }
+    }
+
+    if (const uint64_t dropped = getDroppedCount()) {
+        StringAppendF(&result, "Dropped %" PRIu64 " samples beyond %zu displays\n", dropped,
+                      kMaxDisplays);
+    }
+}
+
+bool FrameStageStats::populateAtom(std::vector<uint8_t>* pulledData) {
+    ATRACE_CALL();
+    SurfaceflingerStatsFrameStagesWrapper atomList;
+    for (const Slot& slot : mSlots) {
+        const uint64_t id = slot.displayId.load(std::memory_order_acquire);
+        if (id == kFreeSlot) {
+            continue;
+        }
+
+        for (const Stage stage : ftl::enum_range<Stage>()) {
+            const Histogram& histogram = slot.histograms[ftl::to_underlying(stage)];
+            const uint64_t count = histogram.count.load(std::memory_order_relaxed);
+            if (count == 0) {
+                continue;
+            }
+            SurfaceflingerStatsFrameStages* atom = atomList.add_atom();
+            atom->set_stage(stageToProto(stage));
+            atom->set_display_id(static_cast<int64_t>(id));
+            atom->set_frame_count(static_cast<int64_t>(count));
+            atom->set_p50_micros(toMicros(percentileOf(histogram, 50)));
+            atom->set_p90_micros(toMicros(percentileOf(histogram, 90)));
+            atom->set_p99_micros(toMicros(percentileOf(histogram, 99)));
+            atom->set_mean_micros(static_cast<int64_t>(
+                    histogram.totalNs.load(std::memory_order_relaxed) / count / kNanosPerMicro));
+        }
+    }
+
+    // Always clear data.
+    clear();
+
+    pulledData->resize(atomList.ByteSizeLong());
+    return atomList.SerializeToArray(pulledData->data(), atomList.ByteSizeLong());
+}
+
+} // namespace android
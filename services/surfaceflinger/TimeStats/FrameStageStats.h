@@ -0,0 +1,131 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <ftl/enum.h>
+#include <scheduler/Time.h>
+#include <ui/DisplayId.h>
+#include <utils/String16.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+// Always-on histograms of how long each stage of a frame takes, per display. Recording is
+// lock-free, so that it is cheap enough to leave on in the field, and may happen from any thread.
+class FrameStageStats {
+public:
+    enum class Stage : uint8_t {
+        Commit,
+        SnapshotBuild,
+        CompositionStrategy,
+        RenderEngine,
+        Present,
+        Callbacks,
+
+        ftl_last = Callbacks
+    };
+
+    static constexpr size_t kStageCount = ftl::to_underlying(Stage::ftl_last) + 1;
+
+    // Displays beyond this many are not recorded.
+    static constexpr size_t kMaxDisplays = 4;
+
+    // The buckets are in microseconds. The first kSubBucketCount are one microsecond wide, and
+    // then each power of two is split in kSubBucketCount buckets, i.e. the error is 12.5% at most.
+    static constexpr size_t kSubBucketBits = 3;
+    static constexpr size_t kSubBucketCount = 1 << kSubBucketBits;
+    static constexpr size_t kBucketCount = 20 * kSubBucketCount;
+
+    static size_t bucketOf(Duration);
+    // The durations in a bucket are in [lower bound, upper bound).
+    static Duration bucketLowerBound(size_t bucket);
+    static Duration bucketUpperBound(size_t bucket);
+
+    void record(DisplayId, Stage, Duration);
+
+    // Records the time from its construction to its destruction. The stats may be null.
+    class ScopedTimer {
+    public:
+        ScopedTimer(FrameStageStats* stats, DisplayId displayId, Stage stage)
+              : mStats(stats), mDisplayId(displayId), mStage(stage), mStart(TimePoint::now()) {}
+
+        ~ScopedTimer() {
+            if (mStats) {
+                mStats->record(mDisplayId, mStage, TimePoint::now() - mStart);
+            }
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        FrameStageStats* const mStats;
+        const DisplayId mDisplayId;
+        const Stage mStage;
+        const TimePoint mStart;
+    };
+
+    uint64_t getCount(DisplayId, Stage) const;
+    // Returns the upper bound of the bucket holding the percentile, or nullopt without samples.
+    std::optional<Duration> getPercentile(DisplayId, Stage, float percentile) const;
+    uint64_t getDroppedCount() const { return mDroppedCount.load(std::memory_order_relaxed); }
+
+    void clear();
+
+    // Handles `dumpsys SurfaceFlinger --frame-stages [-clear]`.
+    void parseArgs(const Vector<String16>& args, std::string& result);
+    void dump(std::string& result) const;
+
+    // Serializes a SurfaceflingerStatsFrameStagesWrapper of the displays and stages with samples,
+    // and clears them, since each pull covers the time since the previous one.
+    bool populateAtom(std::vector<uint8_t>* pulledData);
+
+private:
+    struct Histogram {
+        std::array<std::atomic<uint32_t>, kBucketCount> buckets{};
+        std::atomic<uint64_t> count = 0;
+        std::atomic<uint64_t> totalNs = 0;
+    };
+
+    // No DisplayId has every flag set.
+    static constexpr uint64_t kFreeSlot = std::numeric_limits<uint64_t>::max();
+
+    struct Slot {
+        std::atomic<uint64_t> displayId = kFreeSlot;
+        std::array<Histogram, kStageCount> histograms;
+    };
+
+    // Claims a slot for the display on its first sample.
+    Slot* slotFor(DisplayId);
+    const Slot* findSlot(DisplayId) const;
+
+    static std::optional<Duration> percentileOf(const Histogram&, float percentile);
+
+    std::array<Slot, kMaxDisplays> mSlots;
+    std::atomic<uint64_t> mDroppedCount = 0;
+};
+
+} // namespace android
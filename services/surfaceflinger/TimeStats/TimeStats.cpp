@@ -25,9 +25,12 @@
 #include <utils/Timers.h>
 #include <utils/Trace.h>
 
+#include <pthread.h>
+
 #include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <iterator>
 #include <unordered_map>
 
 #include "TimeStats.h"
@@ -93,6 +96,7 @@ SurfaceflingerStatsLayerInfo_SetFrameRateVote frameRateVoteToProto(
 
 bool TimeStats::populateGlobalAtom(std::vector<uint8_t>* pulledData) {
     std::lock_guard<std::mutex> lock(mMutex);
+    applyPendingEventsLocked();
 
     if (mTimeStats.statsStartLegacy == 0) {
         return false;
@@ -146,6 +150,7 @@ bool TimeStats::populateGlobalAtom(std::vector<uint8_t>* pulledData) {
 
 bool TimeStats::populateLayerAtom(std::vector<uint8_t>* pulledData) {
     std::lock_guard<std::mutex> lock(mMutex);
+    applyPendingEventsLocked();
 
     std::vector<TimeStatsHelper::TimeStatsLayer*> dumpStats;
     uint32_t numLayers = 0;
@@ -246,6 +251,18 @@ TimeStats::TimeStats() : TimeStats(std::nullopt, std::nullopt) {}
 
 TimeStats::TimeStats(std::optional<size_t> maxPulledLayers,
                      std::optional<size_t> maxPulledHistogramBuckets) {
+    auto& registry = perfcounters::Registry::getInstance();
+    mTotalFramesCounter = registry.getCounter("surfaceflinger.frames.total");
+    mMissedFramesCounter = registry.getCounter("surfaceflinger.frames.missed");
+    mClientCompositionFramesCounter =
+            registry.getCounter("surfaceflinger.frames.client_composition");
+    mRefreshRateSwitchesCounter = registry.getCounter("surfaceflinger.refresh_rate_switches");
+    mJankyFramesCounter = registry.getCounter("surfaceflinger.frames.janky");
+    mFrameDurationHistogram = registry.getHistogram("surfaceflinger.frame_duration_us");
+    mBufferHoldHistogram = registry.getHistogram("surfaceflinger.buffer_hold_us");
+    mEarlyBufferHoldHistogram = registry.getHistogram("surfaceflinger.buffer_hold_early_us");
+    mEarlyBufferReleasesCounter = registry.getCounter("surfaceflinger.buffer_releases.early");
+
     if (maxPulledLayers) {
         mMaxPulledLayers = *maxPulledLayers;
     }
@@ -253,6 +270,117 @@ TimeStats::TimeStats(std::optional<size_t> maxPulledLayers,
     if (maxPulledHistogramBuckets) {
         mMaxPulledHistogramBuckets = *maxPulledHistogramBuckets;
     }
+
+    mMergeThread = std::thread(&TimeStats::mergeLoop, this);
+}
+
+TimeStats::~TimeStats() {
+    {
+        std::lock_guard<std::mutex> lock(mMergeMutex);
+        mStopMerging = true;
+    }
+    mMergeCondition.notify_one();
+    mMergeThread.join();
+}
+
+void TimeStats::pushLayerEvent(LayerEvent&& event) {
+    // Threads take the shards in turn rather than by the hash of their id, so that the few
+    // threads which record most of the events don't end up sharing a shard.
+    static std::atomic<size_t> sNextShardIndex = 0;
+    static thread_local const size_t shardIndex = sNextShardIndex++ % NUM_LAYER_EVENT_SHARDS;
+    LayerEventShard& shard = mLayerEventShards[shardIndex];
+
+    // Counted before the event is queued, so that the count never drops below the number of
+    // events which a merge takes.
+    const size_t pendingCount = ++mPendingLayerEventCount;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.events.push_back({mNextLayerEventSequence++, std::move(event)});
+    }
+
+    // Only wake up the merge thread when it may be waiting for the first event, or for the
+    // threshold to be reached.
+    if (pendingCount == 1 || pendingCount == LAYER_EVENT_MERGE_THRESHOLD) {
+        std::lock_guard<std::mutex> lock(mMergeMutex);
+        mMergeCondition.notify_one();
+    }
+}
+
+void TimeStats::applyPendingEventsLocked() {
+    ATRACE_CALL();
+
+    mTimeStats.totalFramesLegacy += mPendingGlobalCounters.totalFrames.exchange(0);
+    mTimeStats.missedFramesLegacy += mPendingGlobalCounters.missedFrames.exchange(0);
+    mTimeStats.refreshRateSwitchesLegacy += mPendingGlobalCounters.refreshRateSwitches.exchange(0);
+    mTimeStats.compositionStrategyChangesLegacy +=
+            mPendingGlobalCounters.compositionStrategyChanges.exchange(0);
+    mTimeStats.clientCompositionFramesLegacy +=
+            mPendingGlobalCounters.clientCompositionFrames.exchange(0);
+    mTimeStats.clientCompositionReusedFramesLegacy +=
+            mPendingGlobalCounters.clientCompositionReusedFrames.exchange(0);
+    mTimeStats.compositionStrategyPredictedLegacy +=
+            mPendingGlobalCounters.compositionStrategyPredicted.exchange(0);
+    mTimeStats.compositionStrategyPredictionSucceededLegacy +=
+            mPendingGlobalCounters.compositionStrategyPredictionSucceeded.exchange(0);
+
+    // An event takes its sequence number under the lock of its shard, so while the locks of all
+    // the shards are held, every numbered event is queued. The events taken are then exactly the
+    // ones numbered below some sequence number, and none recorded earlier is left for the next
+    // merge.
+    std::vector<SequencedLayerEvent> events;
+    {
+        std::array<std::unique_lock<std::mutex>, NUM_LAYER_EVENT_SHARDS> locks;
+        for (size_t i = 0; i < NUM_LAYER_EVENT_SHARDS; i++) {
+            locks[i] = std::unique_lock<std::mutex>(mLayerEventShards[i].mutex);
+        }
+        for (LayerEventShard& shard : mLayerEventShards) {
+            if (events.empty()) {
+                events.swap(shard.events);
+            } else {
+                events.insert(events.end(), std::make_move_iterator(shard.events.begin()),
+                              std::make_move_iterator(shard.events.end()));
+                shard.events.clear();
+            }
+        }
+    }
+    if (events.empty()) return;
+    mPendingLayerEventCount -= events.size();
+
+    // The events of a single shard are already in order.
+    if (!std::is_sorted(events.begin(), events.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.sequence < rhs.sequence;
+        })) {
+        std::sort(events.begin(), events.end(),
+                  [](const auto& lhs, const auto& rhs) { return lhs.sequence < rhs.sequence; });
+    }
+
+    for (const SequencedLayerEvent& event : events) {
+        std::visit([this](const auto& e) { applyLayerEventLocked(e); }, event.event);
+    }
+}
+
+void TimeStats::mergeLoop() {
+    pthread_setname_np(pthread_self(), "TimeStatsMerge");
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mMergeMutex);
+            if (mPendingLayerEventCount == 0) {
+                mMergeCondition.wait(lock, [this] {
+                    return mStopMerging || mPendingLayerEventCount > 0;
+                });
+            } else {
+                mMergeCondition.wait_for(lock, LAYER_EVENT_MERGE_PERIOD, [this] {
+                    return mStopMerging ||
+                            mPendingLayerEventCount >= LAYER_EVENT_MERGE_THRESHOLD;
+                });
+            }
+            if (mStopMerging) break;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        applyPendingEventsLocked();
+    }
 }
 
 bool TimeStats::onPullAtom(const int atomId, std::vector<uint8_t>* pulledData) {
@@ -308,6 +436,7 @@ std::string TimeStats::miniDump() {
 
     std::string result = "TimeStats miniDump:\n";
     std::lock_guard<std::mutex> lock(mMutex);
+    applyPendingEventsLocked();
     android::base::StringAppendF(&result, "Number of layers currently being tracked is %zu\n",
                                  mTimeStatsTracker.size());
     android::base::StringAppendF(&result, "Number of layers in the stats pool is %zu\n",
@@ -316,45 +445,47 @@ std::string TimeStats::miniDump() {
 }
 
 void TimeStats::incrementTotalFrames() {
+    mTotalFramesCounter.add();
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    mTimeStats.totalFramesLegacy++;
+    mPendingGlobalCounters.totalFrames++;
 }
 
 void TimeStats::incrementMissedFrames() {
+    mMissedFramesCounter.add();
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    mTimeStats.missedFramesLegacy++;
+    mPendingGlobalCounters.missedFrames++;
 }
 
 void TimeStats::pushCompositionStrategyState(const TimeStats::ClientCompositionRecord& record) {
+    if (record.hadClientComposition) {
+        mClientCompositionFramesCounter.add();
+    }
     if (!mEnabled.load() || !record.hasInterestingData()) {
         return;
     }
 
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (record.changed) mTimeStats.compositionStrategyChangesLegacy++;
-    if (record.hadClientComposition) mTimeStats.clientCompositionFramesLegacy++;
-    if (record.reused) mTimeStats.clientCompositionReusedFramesLegacy++;
-    if (record.predicted) mTimeStats.compositionStrategyPredictedLegacy++;
-    if (record.predictionSucceeded) mTimeStats.compositionStrategyPredictionSucceededLegacy++;
+    if (record.changed) mPendingGlobalCounters.compositionStrategyChanges++;
+    if (record.hadClientComposition) mPendingGlobalCounters.clientCompositionFrames++;
+    if (record.reused) mPendingGlobalCounters.clientCompositionReusedFrames++;
+    if (record.predicted) mPendingGlobalCounters.compositionStrategyPredicted++;
+    if (record.predictionSucceeded) mPendingGlobalCounters.compositionStrategyPredictionSucceeded++;
 }
 
 void TimeStats::incrementRefreshRateSwitches() {
+    mRefreshRateSwitchesCounter.add();
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    mTimeStats.refreshRateSwitchesLegacy++;
+    mPendingGlobalCounters.refreshRateSwitches++;
 }
 
 static int32_t toMs(nsecs_t nanos) {
@@ -370,6 +501,8 @@ static int32_t msBetween(nsecs_t start, nsecs_t end) {
 }
 
 void TimeStats::recordFrameDuration(nsecs_t startTime, nsecs_t endTime) {
+    mFrameDurationHistogram.record(
+            static_cast<uint64_t>(std::max<nsecs_t>(endTime - startTime, 0)) / 1000);
     if (!mEnabled.load()) return;
 
     std::lock_guard<std::mutex> lock(mMutex);
@@ -378,6 +511,15 @@ void TimeStats::recordFrameDuration(nsecs_t startTime, nsecs_t endTime) {
     }
 }
 
+void TimeStats::recordBufferHoldDuration(nsecs_t duration, bool releasedEarly) {
+    const uint64_t durationUs = static_cast<uint64_t>(std::max<nsecs_t>(duration, 0)) / 1000;
+    mBufferHoldHistogram.record(durationUs);
+    if (releasedEarly) {
+        mEarlyBufferHoldHistogram.record(durationUs);
+        mEarlyBufferReleasesCounter.add();
+    }
+}
+
 void TimeStats::recordRenderEngineDuration(nsecs_t startTime, nsecs_t endTime) {
     if (!mEnabled.load()) return;
 
@@ -572,7 +714,11 @@ void TimeStats::setPostTime(int32_t layerId, uint64_t frameNumber, const std::st
     ALOGV("[%d]-[%" PRIu64 "]-[%s]-PostTime[%" PRId64 "]", layerId, frameNumber, layerName.c_str(),
           postTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    pushLayerEvent(PostTimeEvent{layerId, frameNumber, layerName, uid, postTime, gameMode});
+}
+
+void TimeStats::applyLayerEventLocked(const PostTimeEvent& event) {
+    const auto& [layerId, frameNumber, layerName, uid, postTime, gameMode] = event;
     if (!canAddNewAggregatedStats(uid, layerName, gameMode)) {
         return;
     }
@@ -615,7 +761,11 @@ void TimeStats::setLatchTime(int32_t layerId, uint64_t frameNumber, nsecs_t latc
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-LatchTime[%" PRId64 "]", layerId, frameNumber, latchTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    pushLayerEvent(FrameTimeEvent{layerId, frameNumber, &FrameTime::latchTime, latchTime});
+}
+
+void TimeStats::applyLayerEventLocked(const FrameTimeEvent& event) {
+    const auto& [layerId, frameNumber, field, time] = event;
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     if (layerRecord.waitData < 0 ||
@@ -623,7 +773,7 @@ void TimeStats::setLatchTime(int32_t layerId, uint64_t frameNumber, nsecs_t latc
         return;
     TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
     if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.latchTime = latchTime;
+        timeRecord.frameTime.*field = time;
     }
 }
 
@@ -634,7 +784,11 @@ void TimeStats::incrementLatchSkipped(int32_t layerId, LatchSkipReason reason) {
     ALOGV("[%d]-LatchSkipped-Reason[%d]", layerId,
           static_cast<std::underlying_type<LatchSkipReason>::type>(reason));
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    pushLayerEvent(LatchSkippedEvent{layerId, reason});
+}
+
+void TimeStats::applyLayerEventLocked(const LatchSkippedEvent& event) {
+    const auto& [layerId, reason] = event;
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
 
@@ -651,7 +805,11 @@ void TimeStats::incrementBadDesiredPresent(int32_t layerId) {
     ATRACE_CALL();
     ALOGV("[%d]-BadDesiredPresent", layerId);
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    pushLayerEvent(BadDesiredPresentEvent{layerId});
+}
+
+void TimeStats::applyLayerEventLocked(const BadDesiredPresentEvent& event) {
+    const int32_t layerId = event.layerId;
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     layerRecord.badDesiredPresentFrames++;
@@ -663,16 +821,7 @@ void TimeStats::setDesiredTime(int32_t layerId, uint64_t frameNumber, nsecs_t de
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-DesiredTime[%" PRId64 "]", layerId, frameNumber, desiredTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.desiredTime = desiredTime;
-    }
+    pushLayerEvent(FrameTimeEvent{layerId, frameNumber, &FrameTime::desiredTime, desiredTime});
 }
 
 void TimeStats::setAcquireTime(int32_t layerId, uint64_t frameNumber, nsecs_t acquireTime) {
@@ -681,16 +830,7 @@ void TimeStats::setAcquireTime(int32_t layerId, uint64_t frameNumber, nsecs_t ac
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-AcquireTime[%" PRId64 "]", layerId, frameNumber, acquireTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.acquireTime = acquireTime;
-    }
+    pushLayerEvent(FrameTimeEvent{layerId, frameNumber, &FrameTime::acquireTime, acquireTime});
 }
 
 void TimeStats::setAcquireFence(int32_t layerId, uint64_t frameNumber,
@@ -701,7 +841,11 @@ void TimeStats::setAcquireFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-AcquireFenceTime[%" PRId64 "]", layerId, frameNumber,
           acquireFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    pushLayerEvent(AcquireFenceEvent{layerId, frameNumber, acquireFence});
+}
+
+void TimeStats::applyLayerEventLocked(const AcquireFenceEvent& event) {
+    const auto& [layerId, frameNumber, acquireFence] = event;
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     if (layerRecord.waitData < 0 ||
@@ -721,7 +865,13 @@ void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t pr
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-PresentTime[%" PRId64 "]", layerId, frameNumber, presentTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    pushLayerEvent(PresentEvent{layerId, frameNumber, presentTime, displayRefreshRate, renderRate,
+                                frameRateVote, gameMode});
+}
+
+void TimeStats::applyLayerEventLocked(const PresentEvent& event) {
+    const auto& [layerId, frameNumber, present, displayRefreshRate, renderRate, frameRateVote,
+                 gameMode] = event;
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     if (layerRecord.waitData < 0 ||
@@ -729,7 +879,11 @@ void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t pr
         return;
     TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
     if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.presentTime = presentTime;
+        if (const auto* presentTime = std::get_if<nsecs_t>(&present)) {
+            timeRecord.frameTime.presentTime = *presentTime;
+        } else {
+            timeRecord.presentFence = std::get<std::shared_ptr<FenceTime>>(present);
+        }
         timeRecord.ready = true;
         layerRecord.waitData++;
     }
@@ -748,21 +902,8 @@ void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-PresentFenceTime[%" PRId64 "]", layerId, frameNumber,
           presentFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.presentFence = presentFence;
-        timeRecord.ready = true;
-        layerRecord.waitData++;
-    }
-
-    flushAvailableRecordsToStatsLocked(layerId, displayRefreshRate, renderRate, frameRateVote,
-                                       gameMode);
+    pushLayerEvent(PresentEvent{layerId, frameNumber, presentFence, displayRefreshRate, renderRate,
+                                frameRateVote, gameMode});
 }
 
 static const constexpr int32_t kValidJankyReason = JankType::DisplayHAL |
@@ -803,11 +944,16 @@ static void updateJankPayload(T& t, int32_t reasons) {
 }
 
 void TimeStats::incrementJankyFrames(const JankyFramesInfo& info) {
+    if (info.reasons & kValidJankyReason) {
+        mJankyFramesCounter.add();
+    }
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
-    std::lock_guard<std::mutex> lock(mMutex);
+    pushLayerEvent(info);
+}
 
+void TimeStats::applyLayerEventLocked(const JankyFramesInfo& info) {
     // Only update layer stats if we're already tracking the layer in TimeStats.
     // Otherwise, continue tracking the statistic but use a default layer name instead.
     // As an implementation detail, we do this because this method is expected to be
@@ -863,7 +1009,11 @@ void TimeStats::incrementJankyFrames(const JankyFramesInfo& info) {
 void TimeStats::onDestroy(int32_t layerId) {
     ATRACE_CALL();
     ALOGV("[%d]-onDestroy", layerId);
-    std::lock_guard<std::mutex> lock(mMutex);
+    pushLayerEvent(DestroyEvent{layerId});
+}
+
+void TimeStats::applyLayerEventLocked(const DestroyEvent& event) {
+    const int32_t layerId = event.layerId;
     mTimeStatsTracker.erase(layerId);
 }
 
@@ -873,7 +1023,11 @@ void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-removeTimeRecord", layerId, frameNumber);
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    pushLayerEvent(RemoveTimeRecordEvent{layerId, frameNumber});
+}
+
+void TimeStats::applyLayerEventLocked(const RemoveTimeRecordEvent& event) {
+    const auto& [layerId, frameNumber] = event;
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     size_t removeAt = 0;
@@ -1045,6 +1199,7 @@ void TimeStats::disable() {
 
 void TimeStats::clearAll() {
     std::lock_guard<std::mutex> lock(mMutex);
+    applyPendingEventsLocked();
     mTimeStats.stats.clear();
     clearGlobalLocked();
     clearLayersLocked();
@@ -1096,6 +1251,7 @@ void TimeStats::dump(bool asProto, std::optional<uint32_t> maxLayers, std::strin
     ATRACE_CALL();
 
     std::lock_guard<std::mutex> lock(mMutex);
+    applyPendingEventsLocked();
     if (mTimeStats.statsStartLegacy == 0) {
         return;
     }
@@ -16,16 +16,24 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <deque>
 #include <mutex>
 #include <optional>
+#include <string>
+#include <thread>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 #include <android/hardware/graphics/composer/2.4/IComposerClient.h>
 #include <gui/JankInfo.h>
 #include <gui/LayerMetadata.h>
+#include <perfcounters/PerfCounters.h>
 #include <timestatsproto/TimeStatsHelper.h>
 #include <timestatsproto/TimeStatsProtoHeader.h>
 #include <ui/FenceTime.h>
@@ -71,6 +79,10 @@ public:
     // Same as above, but passes in a fence representing the end time.
     virtual void recordRenderEngineDuration(nsecs_t startTime,
                                             const std::shared_ptr<FenceTime>& readyFence) = 0;
+    // Records how long SurfaceFlinger held a buffer, from its latch until its release was sent.
+    // releasedEarly is set if the buffer was released as soon as HWC was done with it, instead of
+    // with the transaction callbacks of the frame.
+    virtual void recordBufferHoldDuration(nsecs_t duration, bool releasedEarly) = 0;
 
     virtual void setPostTime(int32_t layerId, uint64_t frameNumber, const std::string& layerName,
                              uid_t uid, nsecs_t postTime, GameMode) = 0;
@@ -91,8 +103,8 @@ public:
     virtual void setAcquireTime(int32_t layerId, uint64_t frameNumber, nsecs_t acquireTime) = 0;
     virtual void setAcquireFence(int32_t layerId, uint64_t frameNumber,
                                  const std::shared_ptr<FenceTime>& acquireFence) = 0;
-    // SetPresent{Time, Fence} are not expected to be called in the critical
-    // rendering path, as they flush prior fences if those fences have fired.
+    // SetPresent{Time, Fence} flush prior fences if those fences have fired. The per-layer calls
+    // are queued and applied on a separate thread, so this does not happen in the calling thread.
     virtual void setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t presentTime,
                                 Fps displayRefreshRate, std::optional<Fps> renderRate,
                                 SetFrameRateVote frameRateVote, GameMode) = 0;
@@ -236,11 +248,94 @@ class TimeStats : public android::TimeStats {
         std::deque<RenderEngineDuration> renderEngineDurations;
     };
 
+    // The per-layer calls, which SurfaceFlinger makes for every buffer on the frame path, are
+    // queued as events rather than applied to mTimeStatsTracker under mMutex.
+    struct PostTimeEvent {
+        int32_t layerId;
+        uint64_t frameNumber;
+        std::string layerName;
+        uid_t uid;
+        nsecs_t postTime;
+        GameMode gameMode;
+    };
+
+    struct FrameTimeEvent {
+        int32_t layerId;
+        uint64_t frameNumber;
+        nsecs_t FrameTime::*field;
+        nsecs_t time;
+    };
+
+    struct LatchSkippedEvent {
+        int32_t layerId;
+        LatchSkipReason reason;
+    };
+
+    struct BadDesiredPresentEvent {
+        int32_t layerId;
+    };
+
+    struct AcquireFenceEvent {
+        int32_t layerId;
+        uint64_t frameNumber;
+        std::shared_ptr<FenceTime> acquireFence;
+    };
+
+    struct PresentEvent {
+        int32_t layerId;
+        uint64_t frameNumber;
+        std::variant<nsecs_t, std::shared_ptr<FenceTime>> present;
+        Fps displayRefreshRate;
+        std::optional<Fps> renderRate;
+        SetFrameRateVote frameRateVote;
+        GameMode gameMode;
+    };
+
+    struct DestroyEvent {
+        int32_t layerId;
+    };
+
+    struct RemoveTimeRecordEvent {
+        int32_t layerId;
+        uint64_t frameNumber;
+    };
+
+    using LayerEvent =
+            std::variant<PostTimeEvent, FrameTimeEvent, LatchSkippedEvent, BadDesiredPresentEvent,
+                         AcquireFenceEvent, PresentEvent, JankyFramesInfo, DestroyEvent,
+                         RemoveTimeRecordEvent>;
+
+    struct SequencedLayerEvent {
+        uint64_t sequence;
+        LayerEvent event;
+    };
+
+    // The events of a thread go to its shard, so that the lock of a shard is only contended by
+    // the merge of the events, and by the other threads of the shard once there are more threads
+    // than shards.
+    struct LayerEventShard {
+        std::mutex mutex;
+        std::vector<SequencedLayerEvent> events;
+    };
+
+    // The global counters, until they are added to mTimeStats by the next merge.
+    struct PendingGlobalCounters {
+        std::atomic<int32_t> totalFrames = 0;
+        std::atomic<int32_t> missedFrames = 0;
+        std::atomic<int32_t> refreshRateSwitches = 0;
+        std::atomic<int32_t> compositionStrategyChanges = 0;
+        std::atomic<int32_t> clientCompositionFrames = 0;
+        std::atomic<int32_t> clientCompositionReusedFrames = 0;
+        std::atomic<int32_t> compositionStrategyPredicted = 0;
+        std::atomic<int32_t> compositionStrategyPredictionSucceeded = 0;
+    };
+
 public:
     TimeStats();
     // For testing only for injecting custom dependencies.
     TimeStats(std::optional<size_t> maxPulledLayers,
               std::optional<size_t> maxPulledHistogramBuckets);
+    ~TimeStats() override;
 
     bool onPullAtom(const int atomId, std::vector<uint8_t>* pulledData) override;
     void parseArgs(bool asProto, const Vector<String16>& args, std::string& result) override;
@@ -255,6 +350,7 @@ public:
     void recordRenderEngineDuration(nsecs_t startTime, nsecs_t endTime) override;
     void recordRenderEngineDuration(nsecs_t startTime,
                                     const std::shared_ptr<FenceTime>& readyFence) override;
+    void recordBufferHoldDuration(nsecs_t duration, bool releasedEarly) override;
 
     void setPostTime(int32_t layerId, uint64_t frameNumber, const std::string& layerName, uid_t uid,
                      nsecs_t postTime, GameMode) override;
@@ -288,7 +384,29 @@ public:
 
     static const size_t MAX_NUM_TIME_RECORDS = 64;
 
+    // The merge thread applies the queued events once this many are pending, or after
+    // LAYER_EVENT_MERGE_PERIOD otherwise.
+    static const size_t LAYER_EVENT_MERGE_THRESHOLD = 64;
+    static constexpr std::chrono::milliseconds LAYER_EVENT_MERGE_PERIOD{100};
+
 private:
+    void pushLayerEvent(LayerEvent&&);
+    // Applies the queued events in the order of the calls, and adds up the pending global
+    // counters. This resolves the fences of the records that became ready, so it runs on the
+    // merge thread, or before the stats are read.
+    void applyPendingEventsLocked();
+    void mergeLoop();
+
+    void applyLayerEventLocked(const PostTimeEvent&);
+    void applyLayerEventLocked(const FrameTimeEvent&);
+    void applyLayerEventLocked(const LatchSkippedEvent&);
+    void applyLayerEventLocked(const BadDesiredPresentEvent&);
+    void applyLayerEventLocked(const AcquireFenceEvent&);
+    void applyLayerEventLocked(const PresentEvent&);
+    void applyLayerEventLocked(const JankyFramesInfo&);
+    void applyLayerEventLocked(const DestroyEvent&);
+    void applyLayerEventLocked(const RemoveTimeRecordEvent&);
+
     bool populateGlobalAtom(std::vector<uint8_t>* pulledData);
     bool populateLayerAtom(std::vector<uint8_t>* pulledData);
     bool recordReadyLocked(int32_t layerId, TimeRecord* timeRecord);
@@ -314,6 +432,17 @@ private:
     PowerTime mPowerTime;
     GlobalRecord mGlobalRecord;
 
+    static const size_t NUM_LAYER_EVENT_SHARDS = 4;
+    std::array<LayerEventShard, NUM_LAYER_EVENT_SHARDS> mLayerEventShards;
+    std::atomic<uint64_t> mNextLayerEventSequence = 0;
+    std::atomic<size_t> mPendingLayerEventCount = 0;
+    PendingGlobalCounters mPendingGlobalCounters;
+
+    std::mutex mMergeMutex;
+    std::condition_variable mMergeCondition;
+    bool mStopMerging = false;
+    std::thread mMergeThread;
+
     static const size_t MAX_NUM_LAYER_RECORDS = 200;
 
     static const size_t REFRESH_RATE_BUCKET_WIDTH = 30;
@@ -322,6 +451,18 @@ private:
     static const size_t MAX_NUM_PULLED_LAYERS = MAX_NUM_LAYER_STATS;
     size_t mMaxPulledLayers = MAX_NUM_PULLED_LAYERS;
     size_t mMaxPulledHistogramBuckets = 6;
+
+    // Always-on mirrors of the global stats, which collectors read from shared memory. They are
+    // recorded even while TimeStats is disabled, and are never cleared.
+    perfcounters::Counter mTotalFramesCounter;
+    perfcounters::Counter mMissedFramesCounter;
+    perfcounters::Counter mClientCompositionFramesCounter;
+    perfcounters::Counter mRefreshRateSwitchesCounter;
+    perfcounters::Counter mJankyFramesCounter;
+    perfcounters::Histogram mFrameDurationHistogram;
+    perfcounters::Histogram mBufferHoldHistogram;
+    perfcounters::Histogram mEarlyBufferHoldHistogram;
+    perfcounters::Counter mEarlyBufferReleasesCounter;
 };
 
 } // namespace impl
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "LayerTracing"
+
+#include "LayerTraceDelta.h"
+
+#include <log/log.h>
+
+namespace android {
+
+void LayersSnapshotDeltaEncoder::encode(perfetto::protos::LayersSnapshotProto& snapshot) {
+    const bool isKeyframe = !mHasKeyframe || mSnapshotsSinceKeyframe + 1 >= mKeyframeInterval;
+
+    std::unordered_map<int32_t, std::string> layers;
+    layers.reserve(static_cast<size_t>(snapshot.layers().layers_size()));
+
+    for (perfetto::protos::LayerProto& layer : *snapshot.mutable_layers()->mutable_layers()) {
+        std::string serializedLayer = layer.SerializeAsString();
+        if (!isKeyframe) {
+            const auto it = mPreviousLayers.find(layer.id());
+            if (it != mPreviousLayers.end() && it->second == serializedLayer) {
+                const int32_t layerId = layer.id();
+                layer.Clear();
+                layer.set_id(layerId);
+            }
+        }
+        layers.emplace(layer.id(), std::move(serializedLayer));
+    }
+
+    mPreviousLayers = std::move(layers);
+    mHasKeyframe = true;
+    mSnapshotsSinceKeyframe = isKeyframe ? 0 : mSnapshotsSinceKeyframe + 1;
+}
+
+void LayersSnapshotDeltaEncoder::reset() {
+    mHasKeyframe = false;
+    mSnapshotsSinceKeyframe = 0;
+    mPreviousLayers.clear();
+}
+
+bool LayersSnapshotDeltaDecoder::decode(perfetto::protos::LayersSnapshotProto& snapshot) {
+    bool restored = true;
+
+    std::unordered_map<int32_t, perfetto::protos::LayerProto> layers;
+    layers.reserve(static_cast<size_t>(snapshot.layers().layers_size()));
+
+    for (perfetto::protos::LayerProto& layer : *snapshot.mutable_layers()->mutable_layers()) {
+        if (isStrippedLayer(layer)) {
+            const auto it = mPreviousLayers.find(layer.id());
+            if (it == mPreviousLayers.end()) {
+                ALOGW("Could not restore layer id %d of snapshot for vsync id %" PRId64,
+                      layer.id(), snapshot.vsync_id());
+                restored = false;
+                continue;
+            }
+            layer = it->second;
+        }
+        layers.emplace(layer.id(), layer);
+    }
+
+    mPreviousLayers = std::move(layers);
+    return restored;
+}
+
+bool LayersSnapshotDeltaDecoder::decode(perfetto::protos::LayersTraceFileProto& traceFile) {
+    LayersSnapshotDeltaDecoder decoder;
+    bool restored = true;
+    for (perfetto::protos::LayersSnapshotProto& entry : *traceFile.mutable_entry()) {
+        restored &= decoder.decode(entry);
+    }
+    return restored;
+}
+
+} // namespace android
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <layerproto/LayerProtoHeader.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace android {
+
+/*
+ * Layers snapshots can be traced as periodic keyframes, which hold the full proto of every layer,
+ * followed by deltas. In a delta, the layers which did not change since the previous snapshot
+ * only carry their id, and the layers missing from it were removed. A layer always has a name, so
+ * the layers without one are those left out of a delta.
+ */
+class LayersSnapshotDeltaEncoder {
+public:
+    static constexpr uint32_t DEFAULT_KEYFRAME_INTERVAL = 64;
+
+    explicit LayersSnapshotDeltaEncoder(uint32_t keyframeInterval = DEFAULT_KEYFRAME_INTERVAL)
+          : mKeyframeInterval(keyframeInterval) {}
+
+    // Strips the layers of the snapshot which did not change since the previous one, unless the
+    // snapshot is due to be a keyframe.
+    void encode(perfetto::protos::LayersSnapshotProto&);
+
+    // Makes the next snapshot a keyframe.
+    void reset();
+
+    void setKeyframeInterval(uint32_t keyframeInterval) { mKeyframeInterval = keyframeInterval; }
+
+private:
+    uint32_t mKeyframeInterval;
+    uint32_t mSnapshotsSinceKeyframe = 0;
+    bool mHasKeyframe = false;
+    // The serialized protos of the layers in the previous snapshot.
+    std::unordered_map<int32_t /* layerId */, std::string> mPreviousLayers;
+};
+
+class LayersSnapshotDeltaDecoder {
+public:
+    static bool isStrippedLayer(const perfetto::protos::LayerProto& layer) {
+        return !layer.has_name();
+    }
+
+    // Restores the layers which were left out of the snapshot, if it is a delta. Returns false if
+    // a layer is missing from the previous snapshot, e.g. if the trace starts with a delta, in
+    // which case the stripped layers are left as is.
+    bool decode(perfetto::protos::LayersSnapshotProto&);
+
+    // Decodes all the entries of a trace. Returns false if some could not be fully restored.
+    static bool decode(perfetto::protos::LayersTraceFileProto&);
+
+private:
+    std::unordered_map<int32_t /* layerId */, perfetto::protos::LayerProto> mPreviousLayers;
+};
+
+} // namespace android
@@ -24,6 +24,7 @@
 #include "Tracing/tools/LayerTraceGenerator.h"
 #include "TransactionTracing.h"
 
+#include <android-base/properties.h>
 #include <log/log.h>
 #include <perfetto/tracing.h>
 #include <utils/Timers.h>
@@ -57,6 +58,7 @@ void LayerTracing::onStart(Mode mode, uint32_t flags) {
     switch (mode) {
         case Mode::MODE_ACTIVE: {
             mActiveTracingFlags.store(flags);
+            resetDeltaEncoder(Mode::MODE_ACTIVE);
             mIsActiveTracingStarted.store(true);
             ALOGV("Starting active tracing (waiting for initial snapshot)");
             // It might take a while before a layers change occurs and a "spontaneous" snapshot is
@@ -121,6 +123,7 @@ void LayerTracing::onFlush(Mode mode, uint32_t flags, bool isBugreport) {
     }
 
     auto transactionTrace = mTransactionTracing->writeToProto();
+    resetDeltaEncoder(Mode::MODE_GENERATED);
     LayerTraceGenerator{}.generate(transactionTrace, flags, *this);
     ALOGD("Flushed generated tracing");
 }
@@ -138,10 +141,39 @@ void LayerTracing::addProtoSnapshotToOstream(perfetto::protos::LayersSnapshotPro
     if (mOutStream) {
         writeSnapshotToStream(std::move(snapshot));
     } else {
+        deltaEncode(snapshot, mode);
         writeSnapshotToPerfetto(snapshot, mode);
     }
 }
 
+void LayerTracing::resetDeltaEncoder(Mode mode) {
+    const uint32_t keyframeInterval =
+            base::GetUintProperty("debug.sf.layer_trace_keyframe_interval", 0u);
+
+    std::scoped_lock lock(mDeltaEncoderLock);
+    auto& encoder = mode == Mode::MODE_ACTIVE ? mActiveDeltaEncoder : mGeneratedDeltaEncoder;
+    if (keyframeInterval > 1) {
+        encoder.emplace(keyframeInterval);
+    } else {
+        encoder.reset();
+    }
+}
+
+void LayerTracing::deltaEncode(perfetto::protos::LayersSnapshotProto& snapshot, Mode mode) {
+    std::scoped_lock lock(mDeltaEncoderLock);
+    if (mode == Mode::MODE_ACTIVE && mActiveDeltaEncoder) {
+        mActiveDeltaEncoder->encode(snapshot);
+    } else if (mode == Mode::MODE_GENERATED && mGeneratedDeltaEncoder) {
+        // Snapshots which were already written by a previous flush are skipped, so the delta of
+        // the next snapshot must not be taken against them.
+        if (snapshot.vsync_id() <= mLastVsyncIdWrittenToPerfetto.load()) {
+            mGeneratedDeltaEncoder->reset();
+            return;
+        }
+        mGeneratedDeltaEncoder->encode(snapshot);
+    }
+}
+
 bool LayerTracing::isActiveTracingStarted() const {
     return mIsActiveTracingStarted.load();
 }
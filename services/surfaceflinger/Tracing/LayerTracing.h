@@ -18,11 +18,16 @@
 
 #include <layerproto/LayerProtoHeader.h>
 
+#include <android-base/thread_annotations.h>
+
 #include <atomic>
 #include <functional>
+#include <mutex>
 #include <optional>
 #include <ostream>
 
+#include "LayerTraceDelta.h"
+
 namespace android {
 
 class TransactionTracing;
@@ -54,6 +59,10 @@ class TransactionTracing;
  * When the 'start' event is received a single layers snapshot is taken
  * and written to perfetto.
  *
+ * In ACTIVE and GENERATED modes, setting debug.sf.layer_trace_keyframe_interval to N > 1 writes
+ * every Nth snapshot in full, and only the layers which changed in between (see
+ * LayersSnapshotDeltaEncoder). LayersSnapshotDeltaDecoder restores the full snapshots.
+ *
  *
  * E.g. start active mode tracing
  * (replace mode value with MODE_DUMP, MODE_GENERATED or MODE_GENERATED_BUGREPORT_ONLY to enable
@@ -122,6 +131,10 @@ private:
     void writeSnapshotToStream(perfetto::protos::LayersSnapshotProto&& snapshot) const;
     void writeSnapshotToPerfetto(const perfetto::protos::LayersSnapshotProto& snapshot, Mode mode);
     bool checkAndUpdateLastVsyncIdWrittenToPerfetto(Mode mode, std::int64_t vsyncId);
+    // Starts a new sequence of keyframes and deltas for the mode.
+    void resetDeltaEncoder(Mode mode) EXCLUDES(mDeltaEncoderLock);
+    void deltaEncode(perfetto::protos::LayersSnapshotProto& snapshot, Mode mode)
+            EXCLUDES(mDeltaEncoderLock);
 
     std::function<perfetto::protos::LayersSnapshotProto(uint32_t)> mTakeLayersSnapshotProto;
     TransactionTracing* mTransactionTracing;
@@ -130,6 +143,12 @@ private:
     std::atomic<uint32_t> mActiveTracingFlags{0};
     std::atomic<std::int64_t> mLastVsyncIdWrittenToPerfetto{-1};
     std::optional<std::reference_wrapper<std::ostream>> mOutStream;
+
+    // Snapshots are written from the main thread in ACTIVE mode, and from the perfetto thread on
+    // start and in GENERATED mode.
+    std::mutex mDeltaEncoderLock;
+    std::optional<LayersSnapshotDeltaEncoder> mActiveDeltaEncoder GUARDED_BY(mDeltaEncoderLock);
+    std::optional<LayersSnapshotDeltaEncoder> mGeneratedDeltaEncoder GUARDED_BY(mDeltaEncoderLock);
 };
 
 } // namespace android
@@ -29,6 +29,38 @@
 namespace android {
 ANDROID_SINGLETON_STATIC_INSTANCE(android::TransactionTraceWriter)
 
+namespace {
+
+// Copies the fields of the transaction which are traced, leaving out the callbacks, caches and
+// commands which the trace does not record. The buffer data is the only traced state which the
+// main thread may update after the transaction is queued, so only its traced fields are copied,
+// which also avoids holding onto the buffer, fence and release listener.
+TransactionState copyTracedFields(const TransactionState& transaction) {
+    TransactionState copy;
+    copy.frameTimelineInfo = transaction.frameTimelineInfo;
+    copy.states = transaction.states;
+    copy.displays = transaction.displays;
+    copy.postTime = transaction.postTime;
+    copy.originPid = transaction.originPid;
+    copy.originUid = transaction.originUid;
+    copy.id = transaction.id;
+    copy.mergedTransactionIds = transaction.mergedTransactionIds;
+
+    for (ResolvedComposerState& resolvedState : copy.states) {
+        const std::shared_ptr<BufferData>& bufferData = resolvedState.state.bufferData;
+        if (!bufferData) continue;
+
+        auto tracedBufferData = std::make_shared<BufferData>();
+        tracedBufferData->frameNumber = bufferData->frameNumber;
+        tracedBufferData->flags = bufferData->flags;
+        tracedBufferData->cachedBuffer.id = bufferData->cachedBuffer.id;
+        resolvedState.state.bufferData = std::move(tracedBufferData);
+    }
+    return copy;
+}
+
+} // namespace
+
 TransactionTracing::TransactionTracing()
       : mProtoParser(std::make_unique<TransactionProtoParser::FlingerDataMapper>()) {
     std::scoped_lock lock(mTraceLock);
@@ -57,6 +89,9 @@ TransactionTracing::~TransactionTracing() {
     if (thread.joinable()) {
         thread.join();
     }
+    while (auto transaction = mTransactionQueue.pop()) {
+        delete transaction;
+    }
 }
 
 void TransactionTracing::onStart(TransactionTracing::Mode mode) {
@@ -161,15 +196,30 @@ perfetto::protos::TransactionTraceFile TransactionTracing::createTraceFileProto(
 
 void TransactionTracing::dump(std::string& result) const {
     std::scoped_lock lock(mTraceLock);
-    base::StringAppendF(&result, "  queued transactions=%zu created layers=%zu states=%zu\n",
-                        mQueuedTransactions.size(), mCreatedLayers.size(), mStartingStates.size());
+    base::StringAppendF(&result,
+                        "  queued transactions=%zu created layers=%zu states=%zu "
+                        "dropped transactions=%" PRIu64 "\n",
+                        mQueuedTransactions.size() + mTransactionQueueSize, mCreatedLayers.size(),
+                        mStartingStates.size(), mDroppedTransactionCount.load());
     mBuffer.dump(result);
 }
 
 void TransactionTracing::addQueuedTransaction(const TransactionState& transaction) {
-    perfetto::protos::TransactionState* state =
-            new perfetto::protos::TransactionState(mProtoParser.toProto(transaction));
-    mTransactionQueue.push(state);
+    // Drop the transaction rather than grow the queue if the tracing thread falls behind.
+    if (mTransactionQueueSize.fetch_add(1) >= MAX_QUEUED_TRANSACTIONS) {
+        mTransactionQueueSize--;
+        mDroppedTransactionCount++;
+        return;
+    }
+    mTransactionQueue.push(new TransactionState(copyTracedFields(transaction)));
+}
+
+void TransactionTracing::drainTransactionQueueLocked() {
+    while (auto incomingTransaction = mTransactionQueue.pop()) {
+        mTransactionQueueSize--;
+        mQueuedTransactions[incomingTransaction->id] = mProtoParser.toProto(*incomingTransaction);
+        delete incomingTransaction;
+    }
 }
 
 void TransactionTracing::addCommittedTransactions(int64_t vsyncId, nsecs_t commitTime,
@@ -232,11 +282,7 @@ void TransactionTracing::addEntry(const std::vector<CommittedUpdates>& committed
     std::vector<std::string> removedEntries;
     perfetto::protos::TransactionTraceEntry entryProto;
 
-    while (auto incomingTransaction = mTransactionQueue.pop()) {
-        auto transaction = *incomingTransaction;
-        mQueuedTransactions[incomingTransaction->transaction_id()] = transaction;
-        delete incomingTransaction;
-    }
+    drainTransactionQueueLocked();
     for (const CommittedUpdates& update : committedUpdates) {
         entryProto.set_elapsed_realtime_nanos(update.timestamp);
         entryProto.set_vsync_id(update.vsyncId);
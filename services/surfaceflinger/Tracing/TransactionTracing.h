@@ -22,6 +22,7 @@
 #include <utils/Singleton.h>
 #include <utils/Timers.h>
 
+#include <atomic>
 #include <mutex>
 #include <optional>
 #include <thread>
@@ -43,11 +44,11 @@ class TransactionTracingTest;
 /*
  * Records all committed transactions into a ring buffer.
  *
- * Transactions come in via the binder thread. They are serialized to proto
- * and stored in a map using the transaction id as key. Main thread will
- * pass the list of transaction ids that are committed every vsync and notify
- * the tracing thread. The tracing thread will then wake up and add the
- * committed transactions to the ring buffer.
+ * Transactions come in via the binder thread. A copy of the traced fields is pushed, without
+ * locking, onto a bounded queue. The tracing thread serializes them to proto and stores them in a
+ * map using the transaction id as key. Main thread will pass the list of transaction ids that are
+ * committed every vsync and notify the tracing thread. The tracing thread will then wake up and
+ * add the committed transactions to the ring buffer.
  *
  * The traced data can then be collected via:
  * - Perfetto (preferred).
@@ -149,6 +150,8 @@ public:
     static constexpr auto LEGACY_ACTIVE_TRACING_BUFFER_SIZE = 100 * 1024 * 1024;
     // version 1 - switching to support new frontend
     static constexpr auto TRACING_VERSION = 1;
+    // Transactions queued beyond this many, before the tracing thread gets to them, are dropped.
+    static constexpr size_t MAX_QUEUED_TRANSACTIONS = 1024;
 
 private:
     friend class TransactionTraceWriter;
@@ -168,7 +171,11 @@ private:
             mBuffer GUARDED_BY(mTraceLock);
     std::unordered_map<uint64_t, perfetto::protos::TransactionState> mQueuedTransactions
             GUARDED_BY(mTraceLock);
-    LocklessStack<perfetto::protos::TransactionState> mTransactionQueue;
+    // Copies of the traced fields of the incoming transactions, which are serialized to proto by
+    // the tracing thread.
+    LocklessStack<TransactionState> mTransactionQueue;
+    std::atomic<size_t> mTransactionQueueSize = 0;
+    std::atomic<uint64_t> mDroppedTransactionCount = 0;
     nsecs_t mStartingTimestamp GUARDED_BY(mTraceLock);
     std::unordered_map<int, perfetto::protos::LayerCreationArgs> mCreatedLayers
             GUARDED_BY(mTraceLock);
@@ -204,6 +211,7 @@ private:
     void writeRingBufferToPerfetto(TransactionTracing::Mode mode);
     perfetto::protos::TransactionTraceFile createTraceFileProto() const;
     void loop();
+    void drainTransactionQueueLocked() REQUIRES(mTraceLock);
     void addEntry(const std::vector<CommittedUpdates>& committedTransactions,
                   const std::vector<uint32_t>& removedLayers) EXCLUDES(mTraceLock);
     int32_t getLayerIdLocked(const sp<IBinder>& layerHandle) REQUIRES(mTraceLock);
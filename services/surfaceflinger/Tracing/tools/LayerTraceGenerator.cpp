@@ -23,10 +23,13 @@
 #include <log/log.h>
 #include <renderengine/ExternalTexture.h>
 #include <utils/String16.h>
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <ios>
 #include <string>
+#include <thread>
 #include <vector>
 #include "FrontEnd/LayerCreationArgs.h"
 #include "FrontEnd/RequestedLayerState.h"
@@ -46,93 +49,107 @@ public:
     ScopedTraceDisabler() { TransactionTraceWriter::getInstance().disable(); }
     ~ScopedTraceDisabler() { TransactionTraceWriter::getInstance().enable(); }
 };
-} // namespace
 
-bool LayerTraceGenerator::generate(const perfetto::protos::TransactionTraceFile& traceFile,
-                                   std::uint32_t traceFlags, LayerTracing& layerTracing,
-                                   bool onlyLastEntry) {
-    // We are generating the layers trace by replaying back a set of transactions. If the
-    // transactions have unexpected states, we may generate a transaction trace to debug
-    // the unexpected state. This is silly. So we disable it by poking the
-    // TransactionTraceWriter. This is really a hack since we should manage our depenecies a
-    // little better.
-    ScopedTraceDisabler fatalErrorTraceDisabler;
+// The state changes of a trace entry, parsed from proto.
+struct ParsedEntry {
+    std::vector<std::unique_ptr<frontend::RequestedLayerState>> addedLayers;
+    std::vector<TransactionState> transactions;
+    std::vector<std::pair<uint32_t, std::string>> destroyedHandles;
+    std::optional<frontend::DisplayInfos> displayInfos;
+};
 
-    if (traceFile.entry_size() == 0) {
-        ALOGD("Trace file is empty");
-        return false;
+ParsedEntry parseEntry(TransactionProtoParser& parser,
+                       const perfetto::protos::TransactionTraceEntry& entry) {
+    ParsedEntry parsed;
+
+    parsed.addedLayers.reserve((size_t)entry.added_layers_size());
+    for (int j = 0; j < entry.added_layers_size(); j++) {
+        LayerCreationArgs args;
+        parser.fromProto(entry.added_layers(j), args);
+        ALOGV("       %s", args.getDebugString().c_str());
+        parsed.addedLayers.emplace_back(std::make_unique<frontend::RequestedLayerState>(args));
     }
 
-    TransactionProtoParser parser(std::make_unique<TransactionProtoParser::FlingerDataMapper>());
+    parsed.transactions.reserve((size_t)entry.transactions_size());
+    for (int j = 0; j < entry.transactions_size(); j++) {
+        // apply transactions
+        TransactionState transaction = parser.fromProto(entry.transactions(j));
+        for (auto& resolvedComposerState : transaction.states) {
+            if (resolvedComposerState.state.what & layer_state_t::eInputInfoChanged) {
+                if (!resolvedComposerState.state.windowInfoHandle->getInfo()->inputConfig.test(
+                            gui::WindowInfo::InputConfig::NO_INPUT_CHANNEL)) {
+                    // create a fake token since the FE expects a valid token
+                    resolvedComposerState.state.windowInfoHandle->editInfo()->token =
+                            sp<BBinder>::make();
+                }
+            }
+        }
+        parsed.transactions.emplace_back(std::move(transaction));
+    }
 
-    // frontend
-    frontend::LayerLifecycleManager lifecycleManager;
-    frontend::LayerHierarchyBuilder hierarchyBuilder;
-    frontend::LayerSnapshotBuilder snapshotBuilder;
-    ui::DisplayMap<ui::LayerStack, frontend::DisplayInfo> displayInfos;
+    for (int j = 0; j < entry.destroyed_layers_size(); j++) {
+        ALOGV("       destroyedHandles=%d", entry.destroyed_layers(j));
+    }
 
-    ShadowSettings globalShadowSettings{.ambientColor = {1, 1, 1, 1}};
-    char value[PROPERTY_VALUE_MAX];
-    property_get("ro.surface_flinger.supports_background_blur", value, "0");
-    bool supportsBlur = atoi(value);
+    parsed.destroyedHandles.reserve((size_t)entry.destroyed_layer_handles_size());
+    for (int j = 0; j < entry.destroyed_layer_handles_size(); j++) {
+        ALOGV("       destroyedHandles=%d", entry.destroyed_layer_handles(j));
+        parsed.destroyedHandles.push_back({entry.destroyed_layer_handles(j), ""});
+    }
 
-    ALOGD("Generating %d transactions...", traceFile.entry_size());
-    for (int i = 0; i < traceFile.entry_size(); i++) {
-        // parse proto
-        perfetto::protos::TransactionTraceEntry entry = traceFile.entry(i);
-        ALOGV("    Entry %04d/%04d for time=%" PRId64 " vsyncid=%" PRId64
-              " layers +%d -%d handles -%d transactions=%d",
-              i, traceFile.entry_size(), entry.elapsed_realtime_nanos(), entry.vsync_id(),
-              entry.added_layers_size(), entry.destroyed_layers_size(),
-              entry.destroyed_layer_handles_size(), entry.transactions_size());
+    if (entry.displays_changed()) {
+        parser.fromProto(entry.displays(), parsed.displayInfos.emplace());
+    }
+    return parsed;
+}
 
-        std::vector<std::unique_ptr<frontend::RequestedLayerState>> addedLayers;
-        addedLayers.reserve((size_t)entry.added_layers_size());
-        for (int j = 0; j < entry.added_layers_size(); j++) {
-            LayerCreationArgs args;
-            parser.fromProto(entry.added_layers(j), args);
-            ALOGV("       %s", args.getDebugString().c_str());
-            addedLayers.emplace_back(std::make_unique<frontend::RequestedLayerState>(args));
-        }
+// Parses every entry of the trace, sharding contiguous ranges of entries among the threads.
+std::vector<ParsedEntry> parseEntries(const perfetto::protos::TransactionTraceFile& traceFile,
+                                      size_t threadCount) {
+    const size_t entryCount = static_cast<size_t>(traceFile.entry_size());
+    std::vector<ParsedEntry> entries(entryCount);
 
-        std::vector<TransactionState> transactions;
-        transactions.reserve((size_t)entry.transactions_size());
-        for (int j = 0; j < entry.transactions_size(); j++) {
-            // apply transactions
-            TransactionState transaction = parser.fromProto(entry.transactions(j));
-            for (auto& resolvedComposerState : transaction.states) {
-                if (resolvedComposerState.state.what & layer_state_t::eInputInfoChanged) {
-                    if (!resolvedComposerState.state.windowInfoHandle->getInfo()->inputConfig.test(
-                                gui::WindowInfo::InputConfig::NO_INPUT_CHANNEL)) {
-                        // create a fake token since the FE expects a valid token
-                        resolvedComposerState.state.windowInfoHandle->editInfo()->token =
-                                sp<BBinder>::make();
-                    }
-                }
-            }
-            transactions.emplace_back(std::move(transaction));
-        }
+    threadCount = std::clamp<size_t>(threadCount, 1, std::max<size_t>(entryCount, 1));
+    const size_t shardSize = (entryCount + threadCount - 1) / threadCount;
 
-        for (int j = 0; j < entry.destroyed_layers_size(); j++) {
-            ALOGV("       destroyedHandles=%d", entry.destroyed_layers(j));
+    const auto parseShard = [&](size_t begin, size_t end) {
+        TransactionProtoParser parser(std::make_unique<TransactionProtoParser::FlingerDataMapper>());
+        for (size_t i = begin; i < end; i++) {
+            entries[i] = parseEntry(parser, traceFile.entry(static_cast<int>(i)));
         }
+    };
 
-        std::vector<std::pair<uint32_t, std::string>> destroyedHandles;
-        destroyedHandles.reserve((size_t)entry.destroyed_layer_handles_size());
-        for (int j = 0; j < entry.destroyed_layer_handles_size(); j++) {
-            ALOGV("       destroyedHandles=%d", entry.destroyed_layer_handles(j));
-            destroyedHandles.push_back({entry.destroyed_layer_handles(j), ""});
-        }
+    std::vector<std::thread> threads;
+    for (size_t begin = shardSize; begin < entryCount; begin += shardSize) {
+        threads.emplace_back(parseShard, begin, std::min(begin + shardSize, entryCount));
+    }
+    parseShard(0, std::min(shardSize, entryCount));
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return entries;
+}
 
-        bool displayChanged = entry.displays_changed();
+// Applies the entries of a trace the way the main thread of SurfaceFlinger does.
+class FrontEnd {
+public:
+    FrontEnd() {
+        char value[PROPERTY_VALUE_MAX];
+        property_get("ro.surface_flinger.supports_background_blur", value, "0");
+        mSupportsBlur = atoi(value);
+    }
+
+    // Returns whether the visible regions changed.
+    bool apply(ParsedEntry&& entry) {
+        const bool displayChanged = entry.displayInfos.has_value();
         if (displayChanged) {
-            parser.fromProto(entry.displays(), displayInfos);
+            displayInfos = std::move(*entry.displayInfos);
         }
 
         // apply updates
-        lifecycleManager.addLayers(std::move(addedLayers));
-        lifecycleManager.applyTransactions(transactions, /*ignoreUnknownHandles=*/true);
-        lifecycleManager.onHandlesDestroyed(destroyedHandles, /*ignoreUnknownHandles=*/true);
+        lifecycleManager.addLayers(std::move(entry.addedLayers));
+        lifecycleManager.applyTransactions(entry.transactions, /*ignoreUnknownHandles=*/true);
+        lifecycleManager.onHandlesDestroyed(entry.destroyedHandles, /*ignoreUnknownHandles=*/true);
 
         // update hierarchy
         hierarchyBuilder.update(lifecycleManager);
@@ -142,14 +159,14 @@ bool LayerTraceGenerator::generate(const perfetto::protos::TransactionTraceFile&
                                                   .layerLifecycleManager = lifecycleManager,
                                                   .displays = displayInfos,
                                                   .displayChanges = displayChanged,
-                                                  .globalShadowSettings = globalShadowSettings,
-                                                  .supportsBlur = supportsBlur,
+                                                  .globalShadowSettings = mGlobalShadowSettings,
+                                                  .supportsBlur = mSupportsBlur,
                                                   .forceFullDamage = false,
                                                   .supportedLayerGenericMetadata = {},
                                                   .genericLayerMetadataKeyMap = {}};
         snapshotBuilder.update(args);
 
-        bool visibleRegionsDirty = lifecycleManager.getGlobalChanges().any(
+        const bool visibleRegionsDirty = lifecycleManager.getGlobalChanges().any(
                 frontend::RequestedLayerState::Changes::VisibleRegion |
                 frontend::RequestedLayerState::Changes::Hierarchy |
                 frontend::RequestedLayerState::Changes::Visibility);
@@ -159,11 +176,102 @@ bool LayerTraceGenerator::generate(const perfetto::protos::TransactionTraceFile&
               lifecycleManager.getGlobalChanges().string().c_str());
 
         lifecycleManager.commitChanges();
+        return visibleRegionsDirty;
+    }
 
-        auto layersProto =
-                LayerProtoFromSnapshotGenerator(snapshotBuilder, displayInfos, {}, traceFlags)
-                        .generate(hierarchyBuilder.getHierarchy());
-        auto displayProtos = LayerProtoHelper::writeDisplayInfoToProto(displayInfos);
+    frontend::LayerLifecycleManager lifecycleManager;
+    frontend::LayerHierarchyBuilder hierarchyBuilder;
+    frontend::LayerSnapshotBuilder snapshotBuilder;
+    frontend::DisplayInfos displayInfos;
+
+private:
+    const ShadowSettings mGlobalShadowSettings{.ambientColor = {1, 1, 1, 1}};
+    bool mSupportsBlur = false;
+};
+
+template <typename T>
+T percentile(std::vector<T> values, size_t percent) {
+    if (values.empty()) return T{};
+    const size_t index = std::min(values.size() - 1, values.size() * percent / 100);
+    std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index),
+                     values.end());
+    return values[index];
+}
+
+} // namespace
+
+void LayerTraceBenchmarkResult::dump(std::ostream& out, bool perFrame) const {
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+
+    std::vector<int64_t> durations;
+    std::vector<uint64_t> allocations;
+    durations.reserve(frames.size());
+    allocations.reserve(frames.size());
+    int64_t totalDuration = 0;
+    uint64_t totalAllocations = 0;
+    for (const auto& frame : frames) {
+        const int64_t duration = duration_cast<microseconds>(frame.duration).count();
+        durations.push_back(duration);
+        allocations.push_back(frame.allocations);
+        totalDuration += duration;
+        totalAllocations += frame.allocations;
+    }
+
+    const size_t count = std::max<size_t>(frames.size(), 1);
+    out << "Frames: " << frames.size() << "\n"
+        << "Parse time: " << duration_cast<microseconds>(parseDuration).count() << " us\n"
+        << "Frame time (us): mean=" << totalDuration / static_cast<int64_t>(count)
+        << " p50=" << percentile(durations, 50) << " p90=" << percentile(durations, 90)
+        << " p99=" << percentile(durations, 99) << " max=" << percentile(durations, 100) << "\n"
+        << "Allocations per frame: mean=" << totalAllocations / count
+        << " p50=" << percentile(allocations, 50) << " p90=" << percentile(allocations, 90)
+        << " p99=" << percentile(allocations, 99) << " max=" << percentile(allocations, 100)
+        << "\n";
+
+    if (perFrame) {
+        out << "vsync_id,duration_us,allocations\n";
+        for (const auto& frame : frames) {
+            out << frame.vsyncId << "," << duration_cast<microseconds>(frame.duration).count() << ","
+                << frame.allocations << "\n";
+        }
+    }
+}
+
+bool LayerTraceGenerator::generate(const perfetto::protos::TransactionTraceFile& traceFile,
+                                   std::uint32_t traceFlags, LayerTracing& layerTracing,
+                                   bool onlyLastEntry) {
+    // We are generating the layers trace by replaying back a set of transactions. If the
+    // transactions have unexpected states, we may generate a transaction trace to debug
+    // the unexpected state. This is silly. So we disable it by poking the
+    // TransactionTraceWriter. This is really a hack since we should manage our depenecies a
+    // little better.
+    ScopedTraceDisabler fatalErrorTraceDisabler;
+
+    if (traceFile.entry_size() == 0) {
+        ALOGD("Trace file is empty");
+        return false;
+    }
+
+    TransactionProtoParser parser(std::make_unique<TransactionProtoParser::FlingerDataMapper>());
+    FrontEnd frontEnd;
+
+    ALOGD("Generating %d transactions...", traceFile.entry_size());
+    for (int i = 0; i < traceFile.entry_size(); i++) {
+        // parse proto
+        perfetto::protos::TransactionTraceEntry entry = traceFile.entry(i);
+        ALOGV("    Entry %04d/%04d for time=%" PRId64 " vsyncid=%" PRId64
+              " layers +%d -%d handles -%d transactions=%d",
+              i, traceFile.entry_size(), entry.elapsed_realtime_nanos(), entry.vsync_id(),
+              entry.added_layers_size(), entry.destroyed_layers_size(),
+              entry.destroyed_layer_handles_size(), entry.transactions_size());
+
+        const bool visibleRegionsDirty = frontEnd.apply(parseEntry(parser, entry));
+
+        auto layersProto = LayerProtoFromSnapshotGenerator(frontEnd.snapshotBuilder,
+                                                           frontEnd.displayInfos, {}, traceFlags)
+                                   .generate(frontEnd.hierarchyBuilder.getHierarchy());
+        auto displayProtos = LayerProtoHelper::writeDisplayInfoToProto(frontEnd.displayInfos);
         if (!onlyLastEntry || (i == traceFile.entry_size() - 1)) {
             perfetto::protos::LayersSnapshotProto snapshotProto{};
             snapshotProto.set_vsync_id(entry.vsync_id());
@@ -183,4 +291,42 @@ bool LayerTraceGenerator::generate(const perfetto::protos::TransactionTraceFile&
     return true;
 }
 
+std::optional<LayerTraceBenchmarkResult> LayerTraceGenerator::benchmark(
+        const perfetto::protos::TransactionTraceFile& traceFile,
+        const LayerTraceBenchmarkOptions& options) {
+    ScopedTraceDisabler fatalErrorTraceDisabler;
+
+    if (traceFile.entry_size() == 0) {
+        ALOGD("Trace file is empty");
+        return std::nullopt;
+    }
+
+    const auto allocationCount = [&options]() -> uint64_t {
+        return options.allocationCount ? options.allocationCount() : 0;
+    };
+
+    LayerTraceBenchmarkResult result;
+    result.frames.reserve(static_cast<size_t>(traceFile.entry_size()) * options.iterations);
+
+    for (size_t iteration = 0; iteration < options.iterations; iteration++) {
+        const auto parseStart = std::chrono::steady_clock::now();
+        std::vector<ParsedEntry> entries = parseEntries(traceFile, options.parseThreads);
+        result.parseDuration += std::chrono::steady_clock::now() - parseStart;
+
+        FrontEnd frontEnd;
+        for (size_t i = 0; i < entries.size(); i++) {
+            const uint64_t allocationsBefore = allocationCount();
+            const auto start = std::chrono::steady_clock::now();
+
+            frontEnd.apply(std::move(entries[i]));
+
+            const auto duration = std::chrono::steady_clock::now() - start;
+            result.frames.push_back({.vsyncId = traceFile.entry(static_cast<int>(i)).vsync_id(),
+                                     .duration = duration,
+                                     .allocations = allocationCount() - allocationsBefore});
+        }
+    }
+    return result;
+}
+
 } // namespace android
@@ -18,18 +18,50 @@
 
 #include <Tracing/TransactionTracing.h>
 
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <optional>
 #include <ostream>
 #include <string>
+#include <vector>
 
 namespace android {
 
 class LayerTracing;
 
+struct LayerTraceBenchmarkOptions {
+    // The number of times the trace is replayed. The frames of every replay are reported.
+    size_t iterations = 1;
+    // The number of threads among which the parsing of the trace is sharded before each replay.
+    size_t parseThreads = 1;
+    // Returns the number of allocations made by the process so far, if the caller counts them.
+    std::function<uint64_t()> allocationCount;
+};
+
+struct LayerTraceBenchmarkResult {
+    struct Frame {
+        int64_t vsyncId;
+        std::chrono::nanoseconds duration;
+        uint64_t allocations;
+    };
+
+    // The frames of every replay, in the order they were replayed.
+    std::vector<Frame> frames;
+    std::chrono::nanoseconds parseDuration{0};
+
+    // Writes the percentiles of the frame durations and allocations, and each frame if perFrame.
+    void dump(std::ostream&, bool perFrame = false) const;
+};
+
 class LayerTraceGenerator {
 public:
     bool generate(const perfetto::protos::TransactionTraceFile&, std::uint32_t traceFlags,
                   LayerTracing& layerTracing, bool onlyLastEntry = false);
+
+    // Replays the trace through the FrontEnd, timing the update of the layers, hierarchy and
+    // snapshots for each entry. The parsing of the entries is not timed.
+    std::optional<LayerTraceBenchmarkResult> benchmark(
+            const perfetto::protos::TransactionTraceFile&, const LayerTraceBenchmarkOptions&);
 };
 } // namespace android
@@ -17,22 +17,139 @@
 #undef LOG_TAG
 #define LOG_TAG "LayerTraceGenerator"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <new>
 #include <string>
 
+#include <Tracing/LayerTraceDelta.h>
 #include <Tracing/LayerTracing.h>
+#include <log/log.h>
 #include "LayerTraceGenerator.h"
 
 using namespace android;
 
+namespace {
+
+// Counts the allocations made through operator new, for the allocations reported by --benchmark.
+std::atomic<uint64_t> gAllocationCount{0};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    gAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = std::malloc(size ? size : 1);
+    LOG_ALWAYS_FATAL_IF(!ptr, "Failed to allocate %zu bytes", size);
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+// Restores the full layers of a layers trace which was written as keyframes and deltas.
+int expandDeltas(const char* inputLayersTracePath, const char* outputLayersTracePath) {
+    std::cout << "Parsing " << inputLayersTracePath << "\n";
+    std::fstream input(inputLayersTracePath, std::ios::in | std::ios::binary);
+    if (!input) {
+        std::cout << "Error: Could not open " << inputLayersTracePath;
+        return -1;
+    }
+
+    perfetto::protos::LayersTraceFileProto layersTraceFile;
+    if (!layersTraceFile.ParseFromIstream(&input)) {
+        std::cout << "Error: Failed to parse " << inputLayersTracePath;
+        return -1;
+    }
+
+    if (!LayersSnapshotDeltaDecoder::decode(layersTraceFile)) {
+        std::cout << "Warning: Some layers could not be restored, since the trace does not start "
+                     "with a keyframe\n";
+    }
+
+    std::cout << "Writing " << outputLayersTracePath << "\n";
+    auto outStream = std::ofstream{outputLayersTracePath, std::ios::binary | std::ios::out};
+    if (!layersTraceFile.SerializeToOstream(&outStream)) {
+        std::cout << "Error: Failed to write " << outputLayersTracePath << "\n";
+        return -1;
+    }
+    return 0;
+}
+
+// Replays a transaction trace through the FrontEnd and reports how long each entry took.
+int benchmark(int argc, char** argv) {
+    const char* transactionTracePath = argv[0];
+    LayerTraceBenchmarkOptions options{.allocationCount = [] {
+        return gAllocationCount.load(std::memory_order_relaxed);
+    }};
+    bool perFrame = false;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg = argv[i];
+        if (arg == "--per-frame") {
+            perFrame = true;
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            options.iterations = static_cast<size_t>(std::max(1, atoi(argv[++i])));
+        } else if (arg == "--parse-threads" && i + 1 < argc) {
+            options.parseThreads = static_cast<size_t>(std::max(1, atoi(argv[++i])));
+        } else {
+            std::cout << "Error: Unknown benchmark option " << arg << "\n";
+            return -1;
+        }
+    }
+
+    std::cout << "Parsing " << transactionTracePath << "\n";
+    std::fstream input(transactionTracePath, std::ios::in | std::ios::binary);
+    if (!input) {
+        std::cout << "Error: Could not open " << transactionTracePath;
+        return -1;
+    }
+
+    perfetto::protos::TransactionTraceFile transactionTraceFile;
+    if (!transactionTraceFile.ParseFromIstream(&input)) {
+        std::cout << "Error: Failed to parse " << transactionTracePath;
+        return -1;
+    }
+
+    const auto result = LayerTraceGenerator().benchmark(transactionTraceFile, options);
+    if (!result) {
+        std::cout << "Error: Failed to replay " << transactionTracePath << "\n";
+        return -1;
+    }
+    result->dump(std::cout, perFrame);
+    return 0;
+}
+
+} // namespace
+
 int main(int argc, char** argv) {
+    if (argc > 2 && std::string_view(argv[1]) == "--benchmark") {
+        return benchmark(argc - 2, argv + 2);
+    }
+
     if (argc > 4) {
         std::cout << "Usage: " << argv[0]
-                  << " [transaction-trace-path] [output-layers-trace-path] [--last-entry-only]\n";
+                  << " [transaction-trace-path] [output-layers-trace-path] [--last-entry-only]\n"
+                  << "       " << argv[0]
+                  << " --expand-deltas input-layers-trace-path output-layers-trace-path\n"
+                  << "       " << argv[0]
+                  << " --benchmark transaction-trace-path [--iterations n] [--parse-threads n]"
+                     " [--per-frame]\n";
         return -1;
     }
 
+    if (argc == 4 && std::string_view(argv[1]) == "--expand-deltas") {
+        return expandDeltas(argv[2], argv[3]);
+    }
+
     const char* transactionTracePath =
             (argc > 1) ? argv[1] : "/data/misc/wmtrace/transactions_trace.winscope";
     std::cout << "Parsing " << transactionTracePath << "\n";
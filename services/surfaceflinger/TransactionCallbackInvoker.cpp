@@ -152,14 +152,49 @@ void TransactionCallbackInvoker::addPresentFence(sp<Fence> presentFence) {
     mPresentFence = std::move(presentFence);
 }
 
+void TransactionCallbackInvoker::addReleasedBuffer(
+        const sp<ITransactionCompletedListener>& listener, const ReleaseCallbackId& callbackId,
+        const sp<Fence>& releaseFence, uint32_t currentMaxAcquiredBufferCount) {
+    if (!listener) {
+        return;
+    }
+    mReleasedBuffers[IInterface::asBinder(listener)]
+            .emplace_back(callbackId, releaseFence ? releaseFence : Fence::NO_FENCE,
+                          currentMaxAcquiredBufferCount);
+}
+
 void TransactionCallbackInvoker::sendCallbacks(bool onCommitOnly) {
     // For each listener
     auto completedTransactionsItr = mCompletedTransactions.begin();
     BackgroundExecutor::Callbacks callbacks;
+    const auto takeReleasedBuffers = [&](const sp<IBinder>& listener, ListenerStats& stats) {
+        const auto it = mReleasedBuffers.find(listener);
+        if (it != mReleasedBuffers.end() && !it->second.empty()) {
+            stats.releasedBuffers = std::move(it->second);
+            it->second.clear();
+        }
+    };
+    const auto send = [&](ListenerStats&& listenerStats) {
+        // If the listener is still alive
+        if (!listenerStats.listener->isBinderAlive()) {
+            return;
+        }
+        // Send callback.  The listener stored in listenerStats
+        // comes from the cross-process setTransactionState call to
+        // SF.  This MUST be an ITransactionCompletedListener.  We
+        // keep it as an IBinder due to consistency reasons: if we
+        // interface_cast at the IPC boundary when reading a Parcel,
+        // we get pointers that compare unequal in the SF process.
+        callbacks.emplace_back([stats = std::move(listenerStats)]() {
+            interface_cast<ITransactionCompletedListener>(stats.listener)
+                    ->onTransactionCompleted(stats);
+        });
+    };
     while (completedTransactionsItr != mCompletedTransactions.end()) {
         auto& [listener, transactionStatsDeque] = *completedTransactionsItr;
         ListenerStats listenerStats;
         listenerStats.listener = listener;
+        listenerStats.transactionStats.reserve(transactionStatsDeque.size());
 
         // For each transaction
         auto transactionStatsItr = transactionStatsDeque.begin();
@@ -182,28 +217,59 @@ void TransactionCallbackInvoker::sendCallbacks(bool onCommitOnly) {
         }
         // If the listener has completed transactions
         if (!listenerStats.transactionStats.empty()) {
-            // If the listener is still alive
-            if (listener->isBinderAlive()) {
-                // Send callback.  The listener stored in listenerStats
-                // comes from the cross-process setTransactionState call to
-                // SF.  This MUST be an ITransactionCompletedListener.  We
-                // keep it as an IBinder due to consistency reasons: if we
-                // interface_cast at the IPC boundary when reading a Parcel,
-                // we get pointers that compare unequal in the SF process.
-                callbacks.emplace_back([stats = std::move(listenerStats)]() {
-                    interface_cast<ITransactionCompletedListener>(stats.listener)
-                            ->onTransactionCompleted(stats);
-                });
-            }
+            takeReleasedBuffers(listener, listenerStats);
+            send(std::move(listenerStats));
         }
         completedTransactionsItr++;
     }
 
+    // The listeners which only have buffer releases
+    for (auto& [listener, releasedBuffers] : mReleasedBuffers) {
+        if (releasedBuffers.empty()) {
+            continue;
+        }
+        ListenerStats listenerStats;
+        listenerStats.listener = listener;
+        takeReleasedBuffers(listener, listenerStats);
+        send(std::move(listenerStats));
+    }
+
     if (mPresentFence) {
         mPresentFence.clear();
     }
 
-    BackgroundExecutor::getInstance().sendCallbacks(std::move(callbacks));
+    BackgroundExecutor::getInstance().sendCallbacks(BackgroundExecutor::Priority::High,
+                                                    std::move(callbacks));
+}
+
+void TransactionCallbackInvoker::sendReleasedBuffers() {
+    BackgroundExecutor::Callbacks callbacks;
+    for (auto& [listener, releasedBuffers] : mReleasedBuffers) {
+        if (releasedBuffers.empty() || !listener->isBinderAlive()) {
+            continue;
+        }
+        ListenerStats listenerStats;
+        listenerStats.listener = listener;
+        listenerStats.releasedBuffers = std::move(releasedBuffers);
+        releasedBuffers.clear();
+        callbacks.emplace_back([stats = std::move(listenerStats)]() {
+            interface_cast<ITransactionCompletedListener>(stats.listener)
+                    ->onTransactionCompleted(stats);
+        });
+    }
+    if (!callbacks.empty()) {
+        BackgroundExecutor::getInstance().sendCallbacks(BackgroundExecutor::Priority::High,
+                                                        std::move(callbacks));
+    }
+}
+
+void TransactionCallbackInvoker::clearCompletedTransactions() {
+    const auto isDead = [](const auto& entry) { return !entry.first->isBinderAlive(); };
+    std::erase_if(mCompletedTransactions, isDead);
+    std::erase_if(mReleasedBuffers, isDead);
+    for (auto& [_, transactionStatsDeque] : mCompletedTransactions) {
+        transactionStatsDeque.clear();
+    }
 }
 
 // -----------------------------------------------------------------------
@@ -71,10 +71,19 @@ public:
 
     void addPresentFence(sp<Fence>);
 
+    // Queues a buffer release so that it is sent with the next callbacks of the listener, instead
+    // of in an onReleaseBuffer call of its own.
+    void addReleasedBuffer(const sp<ITransactionCompletedListener>& listener,
+                           const ReleaseCallbackId& callbackId, const sp<Fence>& releaseFence,
+                           uint32_t currentMaxAcquiredBufferCount);
+
+    // Sends at most one onTransactionCompleted call per listener, with its completed transactions
+    // and its queued buffer releases. The queued releases are sent even if onCommitOnly is set.
     void sendCallbacks(bool onCommitOnly);
-    void clearCompletedTransactions() {
-        mCompletedTransactions.clear();
-    }
+    // Sends the queued buffer releases right away, without waiting for the callbacks of the frame,
+    // in an onTransactionCompleted call per listener which has no transaction stats.
+    void sendReleasedBuffers();
+    void clearCompletedTransactions();
 
     status_t addCallbackHandle(const sp<CallbackHandle>& handle,
                                const std::vector<JankData>& jankData);
@@ -85,8 +94,12 @@ private:
                                           const std::vector<CallbackId>& callbackIds,
                                           TransactionStats** outTransactionStats);
 
+    // The entries of the listeners are kept when their transactions are sent, so that the next
+    // frames don't allocate them again. They are removed once the listener dies.
     std::unordered_map<sp<IBinder>, std::deque<TransactionStats>, IListenerHash>
         mCompletedTransactions;
+    std::unordered_map<sp<IBinder>, std::vector<ReleasedBufferStats>, IListenerHash>
+            mReleasedBuffers;
 
     sp<Fence> mPresentFence;
 };
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
@@ -44,6 +45,8 @@ public:
     uint32_t parentId = UNASSIGNED_LAYER_ID;
     uint32_t relativeParentId = UNASSIGNED_LAYER_ID;
     uint32_t touchCropId = UNASSIGNED_LAYER_ID;
+    // Set once the acquire fence has signaled, if it is watched by the TransactionHandler.
+    std::shared_ptr<const std::atomic<bool>> acquireFenceSignaled;
 };
 
 struct TransactionState {
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "OverlayUtils"
+
+#include "OverlayUtils.h"
+
+#include <algorithm>
+
+#include <log/log.h>
+#include <ui/GraphicBuffer.h>
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <SkSurface.h>
+#pragma clang diagnostic pop
+
+namespace android {
+
+const GlyphAtlas& GlyphAtlas::getInstance() {
+    static const GlyphAtlas sInstance;
+    return sInstance;
+}
+
+GlyphAtlas::GlyphAtlas() : mCoverage(kGlyphCount * kGlyphPixels) {
+    // The glyphs are stacked vertically, so that each of them is contiguous.
+    sk_sp<SkSurface> surface =
+            SkSurfaces::Raster(SkImageInfo::MakeA8(kDigitWidth, kGlyphCount * kDigitHeight));
+    LOG_ALWAYS_FATAL_IF(!surface, "GlyphAtlas: can't allocate the atlas");
+    SkCanvas* canvas = surface->getCanvas();
+    canvas->clear(SK_ColorTRANSPARENT);
+    for (int glyph = 0; glyph < kGlyphCount; glyph++) {
+        canvas->save();
+        canvas->translate(0, static_cast<SkScalar>(glyph * kDigitHeight));
+        if (glyph < kDigitCount) {
+            SegmentDrawer::drawDigit(glyph, 0, SK_ColorWHITE, *canvas);
+        } else {
+            SegmentDrawer::drawSegment(static_cast<SegmentDrawer::Segment>(glyph - kDigitCount), 0,
+                                       SK_ColorWHITE, *canvas);
+        }
+        canvas->restore();
+    }
+    surface->readPixels(SkImageInfo::MakeA8(kDigitWidth, kGlyphCount * kDigitHeight),
+                        mCoverage.data(), kDigitWidth, 0, 0);
+}
+
+void GlyphAtlas::compose(const Glyphs& glyphs, SkColor color,
+                         ui::Transform::RotationFlags rotation, uint32_t* pixels, int width,
+                         int height, int stride) const {
+    for (int y = 0; y < height; y++) {
+        std::fill_n(pixels + y * stride, width, 0u);
+    }
+
+    // The segments are pixel aligned, so that the pixels are either covered or not.
+    const uint32_t value = SkPreMultiplyColor(color);
+    for (const auto& [glyph, left] : glyphs) {
+        for (int y = 0; y < kDigitHeight; y++) {
+            for (int x = 0; x < kDigitWidth; x++) {
+                if (!isCovered(glyph, x, y)) {
+                    continue;
+                }
+                // The pixel of the buffer, mapped like the canvas transform of the overlays.
+                int bufferX = left + x;
+                int bufferY = y;
+                switch (rotation) {
+                    case ui::Transform::ROT_90:
+                        bufferX = width - 1 - y;
+                        bufferY = left + x;
+                        break;
+                    case ui::Transform::ROT_270:
+                        bufferX = y;
+                        bufferY = height - 1 - (left + x);
+                        break;
+                    default:
+                        break;
+                }
+                if (bufferX >= 0 && bufferX < width && bufferY >= 0 && bufferY < height) {
+                    pixels[bufferY * stride + bufferX] = value;
+                }
+            }
+        }
+    }
+}
+
+void GlyphAtlas::compose(const Glyphs& glyphs, SkColor color,
+                         ui::Transform::RotationFlags rotation, GraphicBuffer& buffer) const {
+    void* pixels = nullptr;
+    const status_t status = buffer.lock(GRALLOC_USAGE_SW_WRITE_RARELY, &pixels);
+    if (status != OK || !pixels) {
+        ALOGE("GlyphAtlas: can't lock the buffer: %d", status);
+        return;
+    }
+    compose(glyphs, color, rotation, static_cast<uint32_t*>(pixels),
+            static_cast<int>(buffer.getWidth()), static_cast<int>(buffer.getHeight()),
+            static_cast<int>(buffer.getStride()));
+    buffer.unlock();
+}
+
+} // namespace android
@@ -26,8 +26,13 @@
 #pragma clang diagnostic pop
 
 #include <gui/SurfaceComposerClient.h>
+#include <ui/Transform.h>
 #include <utils/StrongPointer.h>
 
+#include <array>
+#include <cstdint>
+#include <vector>
+
 namespace android {
 
 inline constexpr int kDigitWidth = 64;
@@ -40,6 +45,7 @@ inline constexpr int kMaxDigits = /*displayFps*/ 3 + /*renderFps*/ 3 + /*spinner
 inline constexpr int kBufferWidth = kMaxDigits * kDigitWidth + (kMaxDigits - 1) * kDigitSpace;
 inline constexpr int kBufferHeight = kDigitHeight;
 
+class GraphicBuffer;
 class SurfaceControl;
 
 // Helper class to delete the SurfaceControl on a helper thread as
@@ -143,4 +149,50 @@ public:
     }
 };
 
+// The digits and segments of the overlays, which SegmentDrawer draws once into a coverage atlas.
+// The overlay buffers are then composed by copying the glyphs from the atlas, so that a new value,
+// color or rotation of an overlay only writes pixels, without drawing with Skia.
+class GlyphAtlas {
+public:
+    // The glyphs 0 to 9 are the digits, and the next ones are the segments.
+    using Glyph = uint8_t;
+
+    static constexpr Glyph digit(int digit) { return static_cast<Glyph>(digit); }
+    static constexpr Glyph segment(SegmentDrawer::Segment segment) {
+        return static_cast<Glyph>(kDigitCount + static_cast<int>(segment));
+    }
+
+    struct PlacedGlyph {
+        Glyph glyph;
+        // The left edge of the glyph in the unrotated buffer, whose top edge is at 0.
+        int left;
+    };
+    using Glyphs = std::vector<PlacedGlyph>;
+
+    static const GlyphAtlas& getInstance();
+
+    // Clears the width by height pixels, of stride pixels per row, and then writes the glyphs in
+    // the color, pre-rotated like the canvas transform of the overlays.
+    void compose(const Glyphs&, SkColor, ui::Transform::RotationFlags, uint32_t* pixels,
+                 int width, int height, int stride) const;
+    // Same as above, into a locked RGBA_8888 buffer.
+    void compose(const Glyphs&, SkColor, ui::Transform::RotationFlags, GraphicBuffer&) const;
+
+private:
+    static constexpr int kDigitCount = 10;
+    static constexpr int kGlyphCount =
+            kDigitCount + static_cast<int>(SegmentDrawer::Segment::DecimalPoint) + 1;
+    static constexpr size_t kGlyphPixels = kDigitWidth * kDigitHeight;
+
+    GlyphAtlas();
+
+    bool isCovered(Glyph glyph, int x, int y) const {
+        return mCoverage[static_cast<size_t>(glyph) * kGlyphPixels +
+                         static_cast<size_t>(y * kDigitWidth + x)] != 0;
+    }
+
+    // The glyphs one after the other, each kDigitWidth by kDigitHeight.
+    std::vector<uint8_t> mCoverage;
+};
+
 } // namespace android
@@ -46,7 +46,8 @@ void WindowInfosListenerInvoker::addWindowInfosListener(sp<IWindowInfosListener>
                 sp<IBinder> asBinder = IInterface::asBinder(listener);
                 asBinder->linkToDeath(sp<DeathRecipient>::fromExisting(this));
                 mWindowInfosListeners.try_emplace(asBinder,
-                                                  std::make_pair(listenerId, std::move(listener)));
+                                                  Listener{.id = listenerId,
+                                                           .listener = std::move(listener)});
             }});
 }
 
@@ -69,7 +70,7 @@ void WindowInfosListenerInvoker::binderDied(const wp<IBinder>& who) {
 
 void WindowInfosListenerInvoker::eraseListenerAndAckMessages(const wp<IBinder>& binder) {
     auto it = mWindowInfosListeners.find(binder);
-    int64_t listenerId = it->second.first;
+    int64_t listenerId = it->second.id;
     mWindowInfosListeners.erase(binder);
 
     std::vector<int64_t> vsyncIds;
@@ -87,7 +88,15 @@ void WindowInfosListenerInvoker::eraseListenerAndAckMessages(const wp<IBinder>&
 
 void WindowInfosListenerInvoker::windowInfosChanged(
         gui::WindowInfosUpdate update, WindowInfosReportedListenerSet reportedListeners,
-        bool forceImmediateCall) {
+        bool forceImmediateCall, std::optional<std::unordered_set<int32_t>> changedWindowIds) {
+    if (mChangedWindowIds) {
+        if (changedWindowIds) {
+            mChangedWindowIds->merge(*changedWindowIds);
+        } else {
+            mChangedWindowIds.reset();
+        }
+    }
+
     if (!mDelayInfo) {
         mDelayInfo = DelayInfo{
                 .vsyncId = update.vsyncId,
@@ -126,21 +135,36 @@ void WindowInfosListenerInvoker::windowInfosChanged(
                                                                   std::move(reportedListeners)});
     auto& unackedState = it->second;
     for (auto& pair : mWindowInfosListeners) {
-        int64_t listenerId = pair.second.first;
+        int64_t listenerId = pair.second.id;
         unackedState.unackedListenerIds.push_back(listenerId);
     }
 
     mDelayInfo.reset();
     updateMaxSendDelay();
 
+    // Listeners which received the last update only get the windows which changed since then.
+    update.generation = mNextGeneration++;
+    std::optional<gui::WindowInfosUpdate> delta;
+    if (mLastUpdate) {
+        ATRACE_NAME("WindowInfosListenerInvoker::makeDelta");
+        delta = update.makeDelta(*mLastUpdate, mChangedWindowIds ? &*mChangedWindowIds : nullptr);
+    }
+
     // Call the listeners
     for (auto& pair : mWindowInfosListeners) {
-        auto& [listenerId, listener] = pair.second;
-        auto status = listener->onWindowInfosChanged(update);
-        if (!status.isOk()) {
-            ackWindowInfosReceived(update.vsyncId, listenerId);
+        auto& listener = pair.second;
+        const bool sendDelta = delta && listener.generation == delta->baseGeneration;
+        auto status = listener.listener->onWindowInfosChanged(sendDelta ? *delta : update);
+        if (status.isOk()) {
+            listener.generation = update.generation;
+        } else {
+            listener.generation = -1;
+            ackWindowInfosReceived(update.vsyncId, listener.id);
         }
     }
+
+    mLastUpdate = std::move(update);
+    mChangedWindowIds = std::unordered_set<int32_t>{};
 }
 
 WindowInfosListenerInvoker::DebugInfo WindowInfosListenerInvoker::getDebugInfo() {
@@ -175,10 +199,14 @@ binder::Status WindowInfosListenerInvoker::ackWindowInfosReceived(int64_t vsyncI
             return;
         }
 
+        // A listener which asked for a resync acks the update it gets again.
         auto& state = it->second;
-        state.unackedListenerIds.unstable_erase(std::find(state.unackedListenerIds.begin(),
-                                                          state.unackedListenerIds.end(),
-                                                          listenerId));
+        auto listenerIt = std::find(state.unackedListenerIds.begin(),
+                                    state.unackedListenerIds.end(), listenerId);
+        if (listenerIt == state.unackedListenerIds.end()) {
+            return;
+        }
+        state.unackedListenerIds.unstable_erase(listenerIt);
         if (!state.unackedListenerIds.empty()) {
             return;
         }
@@ -198,7 +226,28 @@ binder::Status WindowInfosListenerInvoker::ackWindowInfosReceived(int64_t vsyncI
         }
         gui::WindowInfosUpdate update{std::move(*mDelayedUpdate)};
         mDelayedUpdate.reset();
-        windowInfosChanged(std::move(update), {}, false);
+        // The windows which changed in the delayed update were recorded when it was delayed.
+        windowInfosChanged(std::move(update), {}, false, std::unordered_set<int32_t>{});
+    }});
+    return binder::Status::ok();
+}
+
+binder::Status WindowInfosListenerInvoker::requestWindowInfosResync(int64_t listenerId) {
+    BackgroundExecutor::getInstance().sendCallbacks({[this, listenerId]() {
+        ATRACE_NAME("WindowInfosListenerInvoker::requestWindowInfosResync");
+        for (auto& pair : mWindowInfosListeners) {
+            auto& listener = pair.second;
+            if (listener.id != listenerId) {
+                continue;
+            }
+
+            listener.generation = -1;
+            if (mLastUpdate &&
+                listener.listener->onWindowInfosChanged(*mLastUpdate).isOk()) {
+                listener.generation = mLastUpdate->generation;
+            }
+            return;
+        }
     }});
     return binder::Status::ok();
 }
@@ -26,6 +26,7 @@
 #include <ftl/small_map.h>
 #include <ftl/small_vector.h>
 #include <gui/SpHash.h>
+#include <gui/WindowInfosUpdate.h>
 #include <utils/Mutex.h>
 
 #include "scheduler/VsyncId.h"
@@ -42,11 +43,16 @@ public:
     void addWindowInfosListener(sp<gui::IWindowInfosListener>, gui::WindowInfosListenerInfo*);
     void removeWindowInfosListener(const sp<gui::IWindowInfosListener>& windowInfosListener);
 
+    // changedWindowIds holds the ids of the windows which may have changed since the previous
+    // update, or std::nullopt if any of them may have.
     void windowInfosChanged(gui::WindowInfosUpdate update,
                             WindowInfosReportedListenerSet windowInfosReportedListeners,
-                            bool forceImmediateCall);
+                            bool forceImmediateCall,
+                            std::optional<std::unordered_set<int32_t>> changedWindowIds =
+                                    std::nullopt);
 
     binder::Status ackWindowInfosReceived(int64_t, int64_t) override;
+    binder::Status requestWindowInfosResync(int64_t) override;
 
     struct DebugInfo {
         VsyncId maxSendDelayVsyncId;
@@ -61,9 +67,21 @@ protected:
 private:
     static constexpr size_t kStaticCapacity = 3;
     std::atomic<int64_t> mNextListenerId{0};
-    ftl::SmallMap<wp<IBinder>, const std::pair<int64_t, sp<gui::IWindowInfosListener>>,
-                  kStaticCapacity>
-            mWindowInfosListeners;
+    struct Listener {
+        const int64_t id;
+        const sp<gui::IWindowInfosListener> listener;
+        // The generation of the last update the listener received, or -1 if it must get a full
+        // update next.
+        int64_t generation = -1;
+    };
+    ftl::SmallMap<wp<IBinder>, Listener, kStaticCapacity> mWindowInfosListeners;
+
+    // The last update sent to the listeners, which the deltas of the next one are made against.
+    std::optional<gui::WindowInfosUpdate> mLastUpdate;
+    int64_t mNextGeneration = 0;
+    // The ids of the windows which may have changed since mLastUpdate, including in the updates
+    // which were dropped, or std::nullopt if any of them may have.
+    std::optional<std::unordered_set<int32_t>> mChangedWindowIds = std::unordered_set<int32_t>{};
 
     std::optional<gui::WindowInfosUpdate> mDelayedUpdate;
     WindowInfosReportedListenerSet mReportedListeners;
@@ -144,5 +144,33 @@ TEST(LayerStateTest, ParcellingScreenCaptureResultsWithFenceError) {
     ASSERT_EQ(results.fenceResult.error(), results2.fenceResult.error());
 }
 
+TEST(LayerStateTest, ParcellingLayerStateWritesChangedFieldsOnly) {
+    layer_state_t state;
+    state.surface = sp<BBinder>::make();
+    state.layerId = 42;
+    state.what = layer_state_t::ePositionChanged | layer_state_t::eAlphaChanged;
+    state.x = 10;
+    state.y = 20;
+    state.color.a = 0.5f;
+    // not flagged as changed, so it is not sent
+    state.cornerRadius = 5;
+
+    Parcel p;
+    ASSERT_EQ(NO_ERROR, state.write(p));
+    p.setDataPosition(0);
+
+    layer_state_t state2;
+    ASSERT_EQ(NO_ERROR, state2.read(p));
+
+    ASSERT_EQ(state.surface, state2.surface);
+    ASSERT_EQ(state.layerId, state2.layerId);
+    ASSERT_EQ(state.what, state2.what);
+    ASSERT_EQ(state.x, state2.x);
+    ASSERT_EQ(state.y, state2.y);
+    ASSERT_EQ(state.color.a, state2.color.a);
+    ASSERT_EQ(0.f, state2.cornerRadius);
+    ASSERT_EQ(p.dataSize(), p.dataPosition());
+}
+
 } // namespace test
 } // namespace android
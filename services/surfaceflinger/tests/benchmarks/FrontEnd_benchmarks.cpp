@@ -0,0 +1,424 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/file.h>
+#include <gui/LayerState.h>
+#include <gui/fake/BufferData.h>
+#include <layerproto/TransactionProto.h>
+#include <renderengine/mock/FakeExternalTexture.h>
+#include <ui/ShadowSettings.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Client.h" // temporarily needed for LayerCreationArgs
+#include "FrontEnd/LayerCreationArgs.h"
+#include "FrontEnd/LayerHierarchy.h"
+#include "FrontEnd/LayerLifecycleManager.h"
+#include "FrontEnd/LayerSnapshotBuilder.h"
+#include "Tracing/TransactionProtoParser.h"
+#include "TransactionState.h"
+
+// Counts the allocations of the whole process, so that the benchmarks can report how many an
+// update makes.
+namespace {
+std::atomic<uint64_t> sAllocations{0};
+} // namespace
+
+void* operator new(size_t size) {
+    sAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace android::surfaceflinger::frontend {
+namespace {
+
+// To run the benchmarks:
+/**
+ mp :surfaceflinger_frontend_benchmarks && adb sync; adb shell \
+    /data/benchmarktest64/surfaceflinger_frontend_benchmarks/surfaceflinger_frontend_benchmarks
+*/
+
+// The number of layers which change in each update of the change patterns that touch several.
+constexpr uint32_t kChangedLayers = 8;
+// The number of children of each layer of the synthetic hierarchies, except of the leaves.
+constexpr uint32_t kFanout = 4;
+
+std::vector<TransactionState> makeTransaction(uint32_t layerId, uint64_t what) {
+    std::vector<TransactionState> transactions;
+    transactions.emplace_back();
+    transactions.back().states.push_back({});
+    transactions.back().states.front().layerId = layerId;
+    transactions.back().states.front().state.what = what;
+    return transactions;
+}
+
+std::vector<TransactionState> makeBufferTransaction(uint32_t layerId) {
+    static uint64_t sBufferId = 1;
+    auto transactions = makeTransaction(layerId, layer_state_t::eBufferChanged);
+    auto texture = std::make_shared<
+            renderengine::mock::FakeExternalTexture>(1U /*width*/, 1U /*height*/, sBufferId++,
+                                                     HAL_PIXEL_FORMAT_RGBA_8888,
+                                                     GRALLOC_USAGE_PROTECTED /*usage*/);
+    auto& state = transactions.back().states.front();
+    state.externalTexture = texture;
+    state.state.bufferData =
+            std::make_shared<fake::BufferData>(texture->getId(), texture->getWidth(),
+                                               texture->getHeight(), texture->getPixelFormat(),
+                                               texture->getUsage());
+    return transactions;
+}
+
+std::vector<TransactionState> makeColorTransaction(uint32_t layerId) {
+    auto transactions = makeTransaction(layerId, layer_state_t::eColorChanged);
+    transactions.back().states.front().state.color.rgb = half3(1._hf, 1._hf, 1._hf);
+    return transactions;
+}
+
+std::vector<TransactionState> makeReparentTransaction(uint32_t layerId, uint32_t parentId) {
+    auto transactions = makeTransaction(layerId, layer_state_t::eReparent);
+    transactions.back().states.front().parentId = parentId;
+    transactions.back().states.front().relativeParentId = UNASSIGNED_LAYER_ID;
+    return transactions;
+}
+
+std::unique_ptr<RequestedLayerState> makeLayer(uint32_t id, uint32_t parentId) {
+    LayerCreationArgs args(std::make_optional(id));
+    args.name = "benchmarklayer";
+    args.addToRoot = parentId == UNASSIGNED_LAYER_ID;
+    args.parentId = parentId;
+    return std::make_unique<RequestedLayerState>(args);
+}
+
+// The front end of SurfaceFlinger, with a single display.
+class FrontEnd {
+public:
+    FrontEnd() {
+        DisplayInfo display;
+        display.info.logicalWidth = 1080;
+        display.info.logicalHeight = 2400;
+        display.isPrimary = true;
+        mDisplays.emplace_or_replace(ui::DEFAULT_LAYER_STACK, display);
+    }
+
+    // Makes a tree of layerCount layers in which every layer draws something, with buffers in the
+    // leaves and colors elsewhere.
+    void createSyntheticHierarchy(uint32_t layerCount) {
+        std::vector<std::unique_ptr<RequestedLayerState>> layers;
+        layers.reserve(layerCount);
+        for (uint32_t id = 1; id <= layerCount; id++) {
+            layers.emplace_back(makeLayer(id, getSyntheticParent(id)));
+        }
+        lifecycleManager.addLayers(std::move(layers));
+
+        std::vector<TransactionState> transactions;
+        for (uint32_t id = 1; id <= layerCount; id++) {
+            auto transaction = isSyntheticLeaf(id, layerCount) ? makeBufferTransaction(id)
+                                                               : makeColorTransaction(id);
+            transactions.emplace_back(std::move(transaction.front()));
+        }
+        lifecycleManager.applyTransactions(transactions);
+        update();
+    }
+
+    static uint32_t getSyntheticParent(uint32_t id) {
+        return id == 1 ? UNASSIGNED_LAYER_ID : 1 + (id - 2) / kFanout;
+    }
+
+    static bool isSyntheticLeaf(uint32_t id, uint32_t layerCount) {
+        return 2 + (id - 1) * kFanout > layerCount;
+    }
+
+    // Runs the steps of a SurfaceFlinger commit which follow the transactions.
+    void update(bool displayChanges = false) {
+        hierarchyBuilder.update(lifecycleManager);
+        LayerSnapshotBuilder::Args args{.root = hierarchyBuilder.getHierarchy(),
+                                        .layerLifecycleManager = lifecycleManager,
+                                        .includeMetadata = false,
+                                        .displays = mDisplays,
+                                        .displayChanges = displayChanges,
+                                        .globalShadowSettings = mShadowSettings,
+                                        .supportsBlur = true,
+                                        .forceFullDamage = false,
+                                        .supportedLayerGenericMetadata = {},
+                                        .genericLayerMetadataKeyMap = {}};
+        args.flattenedRoot = &hierarchyBuilder.getFlattenedHierarchy();
+        snapshotBuilder.update(args);
+        lifecycleManager.commitChanges();
+    }
+
+    ui::DisplayMap<ui::LayerStack, DisplayInfo>& getDisplays() { return mDisplays; }
+
+    LayerLifecycleManager lifecycleManager;
+    LayerHierarchyBuilder hierarchyBuilder;
+    LayerSnapshotBuilder snapshotBuilder;
+
+private:
+    ui::DisplayMap<ui::LayerStack, DisplayInfo> mDisplays;
+    ShadowSettings mShadowSettings{.ambientColor = {1, 1, 1, 1}};
+};
+
+// Reports the time and the allocations of the updates of state, which the change prepares with
+// the timer paused.
+template <typename Change>
+void runUpdates(benchmark::State& state, FrontEnd& frontEnd, Change&& change) {
+    uint64_t allocations = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        change();
+        const uint64_t allocationsBefore = sAllocations.load(std::memory_order_relaxed);
+        state.ResumeTiming();
+
+        frontEnd.update();
+
+        state.PauseTiming();
+        allocations += sAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+        state.ResumeTiming();
+    }
+    state.counters["allocs"] = benchmark::Counter(static_cast<double>(allocations),
+                                                  benchmark::Counter::kAvgIterations);
+    state.counters["snapshots"] =
+            static_cast<double>(frontEnd.snapshotBuilder.getSnapshots().size());
+}
+
+uint32_t getLayerCount(const benchmark::State& state) {
+    return static_cast<uint32_t>(state.range(0));
+}
+
+// Applications which only queue buffers, the most common case.
+void BM_BufferUpdate(benchmark::State& state) {
+    const uint32_t layerCount = getLayerCount(state);
+    FrontEnd frontEnd;
+    frontEnd.createSyntheticHierarchy(layerCount);
+    runUpdates(state, frontEnd, [&]() {
+        std::vector<TransactionState> transactions;
+        for (uint32_t id = layerCount; id > layerCount - kChangedLayers; id--) {
+            transactions.emplace_back(std::move(makeBufferTransaction(id).front()));
+        }
+        frontEnd.lifecycleManager.applyTransactions(transactions);
+    });
+}
+BENCHMARK(BM_BufferUpdate)->RangeMultiplier(10)->Range(100, 10000);
+
+// An animation which moves a layer close to the root, and so a large subtree.
+void BM_GeometryUpdate(benchmark::State& state) {
+    FrontEnd frontEnd;
+    frontEnd.createSyntheticHierarchy(getLayerCount(state));
+    float x = 0.f;
+    runUpdates(state, frontEnd, [&]() {
+        auto transactions = makeTransaction(2, layer_state_t::ePositionChanged);
+        x = x == 0.f ? 10.f : 0.f;
+        transactions.back().states.front().state.x = x;
+        transactions.back().states.front().state.y = x;
+        frontEnd.lifecycleManager.applyTransactions(transactions);
+    });
+}
+BENCHMARK(BM_GeometryUpdate)->RangeMultiplier(10)->Range(100, 10000);
+
+// A subtree which moves back and forth between two parents, e.g. a task being reparented.
+void BM_Reparent(benchmark::State& state) {
+    FrontEnd frontEnd;
+    frontEnd.createSyntheticHierarchy(getLayerCount(state));
+    const uint32_t layerId = 2 + kFanout;
+    uint32_t parentId = FrontEnd::getSyntheticParent(layerId);
+    runUpdates(state, frontEnd, [&]() {
+        parentId = parentId == 2 ? 3 : 2;
+        frontEnd.lifecycleManager.applyTransactions(makeReparentTransaction(layerId, parentId));
+    });
+}
+BENCHMARK(BM_Reparent)->RangeMultiplier(10)->Range(100, 10000);
+
+// Layers which are created and destroyed in every update, as during app transitions.
+void BM_CreateDestroy(benchmark::State& state) {
+    const uint32_t layerCount = getLayerCount(state);
+    FrontEnd frontEnd;
+    frontEnd.createSyntheticHierarchy(layerCount);
+    uint32_t nextLayerId = layerCount + 1;
+    std::vector<uint32_t> createdLayerIds;
+    runUpdates(state, frontEnd, [&]() {
+        std::vector<TransactionState> transactions;
+        std::vector<std::pair<uint32_t, std::string>> destroyedHandles;
+        for (uint32_t id : createdLayerIds) {
+            transactions.emplace_back(
+                    std::move(makeReparentTransaction(id, UNASSIGNED_LAYER_ID).front()));
+            destroyedHandles.emplace_back(id, "benchmarklayer");
+        }
+        createdLayerIds.clear();
+
+        std::vector<std::unique_ptr<RequestedLayerState>> layers;
+        for (uint32_t i = 0; i < kChangedLayers; i++) {
+            const uint32_t id = nextLayerId++;
+            layers.emplace_back(makeLayer(id, /*parentId=*/1));
+            transactions.emplace_back(std::move(makeColorTransaction(id).front()));
+            createdLayerIds.push_back(id);
+        }
+        frontEnd.lifecycleManager.addLayers(std::move(layers));
+        frontEnd.lifecycleManager.applyTransactions(transactions);
+        frontEnd.lifecycleManager.onHandlesDestroyed(destroyedHandles);
+    });
+}
+BENCHMARK(BM_CreateDestroy)->RangeMultiplier(10)->Range(100, 10000);
+
+// The updates of a transaction trace, as the layertracegenerator replays them.
+struct TraceUpdate {
+    std::vector<std::unique_ptr<RequestedLayerState>> addedLayers;
+    std::vector<TransactionState> transactions;
+    std::vector<std::pair<uint32_t, std::string>> destroyedHandles;
+    std::optional<ui::DisplayMap<ui::LayerStack, DisplayInfo>> displays;
+};
+
+std::vector<TraceUpdate> parseTrace(const perfetto::protos::TransactionTraceFile& traceFile) {
+    TransactionProtoParser parser(std::make_unique<TransactionProtoParser::FlingerDataMapper>());
+    std::vector<TraceUpdate> updates(static_cast<size_t>(traceFile.entry_size()));
+    for (int i = 0; i < traceFile.entry_size(); i++) {
+        const auto& entry = traceFile.entry(i);
+        TraceUpdate& update = updates[static_cast<size_t>(i)];
+        for (int j = 0; j < entry.added_layers_size(); j++) {
+            LayerCreationArgs args;
+            parser.fromProto(entry.added_layers(j), args);
+            update.addedLayers.emplace_back(std::make_unique<RequestedLayerState>(args));
+        }
+        for (int j = 0; j < entry.transactions_size(); j++) {
+            TransactionState transaction = parser.fromProto(entry.transactions(j));
+            for (auto& resolvedComposerState : transaction.states) {
+                if (resolvedComposerState.state.what & layer_state_t::eInputInfoChanged &&
+                    !resolvedComposerState.state.windowInfoHandle->getInfo()->inputConfig.test(
+                            gui::WindowInfo::InputConfig::NO_INPUT_CHANNEL)) {
+                    // the front end expects a valid token
+                    resolvedComposerState.state.windowInfoHandle->editInfo()->token =
+                            sp<BBinder>::make();
+                }
+            }
+            update.transactions.emplace_back(std::move(transaction));
+        }
+        for (int j = 0; j < entry.destroyed_layer_handles_size(); j++) {
+            update.destroyedHandles.emplace_back(entry.destroyed_layer_handles(j), "");
+        }
+        if (entry.displays_changed()) {
+            update.displays.emplace();
+            parser.fromProto(entry.displays(), *update.displays);
+        }
+    }
+    return updates;
+}
+
+void BM_TraceReplay(benchmark::State& state, const std::filesystem::path& tracePath) {
+    perfetto::protos::TransactionTraceFile traceFile;
+    std::ifstream input(tracePath, std::ios::in | std::ios::binary);
+    if (!input || !traceFile.ParseFromIstream(&input) || traceFile.entry_size() == 0) {
+        state.SkipWithError("Could not read the transaction trace");
+        return;
+    }
+
+    uint64_t allocations = 0;
+    size_t snapshots = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<TraceUpdate> updates = parseTrace(traceFile);
+        auto frontEnd = std::make_unique<FrontEnd>();
+        const uint64_t allocationsBefore = sAllocations.load(std::memory_order_relaxed);
+        state.ResumeTiming();
+
+        for (TraceUpdate& update : updates) {
+            frontEnd->lifecycleManager.addLayers(std::move(update.addedLayers));
+            frontEnd->lifecycleManager.applyTransactions(update.transactions,
+                                                         /*ignoreUnknownLayers=*/true);
+            frontEnd->lifecycleManager.onHandlesDestroyed(update.destroyedHandles,
+                                                          /*ignoreUnknownHandles=*/true);
+            if (update.displays) {
+                frontEnd->getDisplays() = std::move(*update.displays);
+            }
+            frontEnd->update(/*displayChanges=*/update.displays.has_value());
+        }
+
+        state.PauseTiming();
+        allocations += sAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+        snapshots = std::max(snapshots, frontEnd->snapshotBuilder.getSnapshots().size());
+        // The front end and the updates are destroyed with the timer paused.
+        updates.clear();
+        frontEnd.reset();
+        state.ResumeTiming();
+    }
+
+    const auto updateCount = static_cast<double>(traceFile.entry_size());
+    state.counters["updates"] = updateCount;
+    state.counters["time/update"] =
+            benchmark::Counter(updateCount,
+                               benchmark::Counter::kIsIterationInvariantRate |
+                                       benchmark::Counter::kInvert);
+    state.counters["allocs/update"] =
+            benchmark::Counter(static_cast<double>(allocations) / updateCount,
+                               benchmark::Counter::kAvgIterations);
+    state.counters["snapshots"] = static_cast<double>(snapshots);
+}
+
+// Registers a benchmark for each transaction trace installed with the benchmarks.
+void registerTraceBenchmarks() {
+    const std::filesystem::path testData =
+            std::filesystem::path(base::GetExecutableDirectory()) / "testdata";
+    std::error_code error;
+    for (const auto& file : std::filesystem::directory_iterator(testData, error)) {
+        const std::string name = file.path().filename().string();
+        if (name.rfind("transactions_trace_", 0) != 0) {
+            continue;
+        }
+        benchmark::RegisterBenchmark(("BM_TraceReplay/" + name).c_str(), BM_TraceReplay,
+                                     file.path())
+                ->Unit(benchmark::kMillisecond);
+    }
+}
+
+} // namespace
+} // namespace android::surfaceflinger::frontend
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    android::surfaceflinger::frontend::registerTraceBenchmarks();
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
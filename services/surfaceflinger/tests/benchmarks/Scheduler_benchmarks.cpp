@@ -0,0 +1,156 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <gmock/gmock.h>
+#include <scheduler/TimeKeeper.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Scheduler/VSyncDispatchTimerQueue.h"
+#include "mock/MockVSyncTracker.h"
+
+namespace android::scheduler {
+namespace {
+
+// To run the benchmarks:
+/**
+ mp :surfaceflinger_scheduler_benchmarks && adb sync; adb shell \
+    /data/benchmarktest64/surfaceflinger_scheduler_benchmarks/surfaceflinger_scheduler_benchmarks
+*/
+
+constexpr nsecs_t kPeriod = 8'333'333; // 120 Hz
+constexpr nsecs_t kTimerSlack = 500'000;
+constexpr nsecs_t kMinVsyncDistance = 3'000'000;
+
+// A clock which only moves when told to, and which keeps the alarm rather than setting a timer.
+class FakeTimeKeeper : public TimeKeeper {
+public:
+    nsecs_t now() const override { return mNow; }
+    void alarmAt(std::function<void()> callback, nsecs_t time) override {
+        mCallback = std::move(callback);
+        mAlarmTime = time;
+    }
+    void alarmCancel() override { mCallback = nullptr; }
+    void dump(std::string&) const override {}
+
+    // Moves the clock to the alarm and fires it. Returns false if no alarm is set.
+    bool fireAlarm() {
+        if (!mCallback) {
+            return false;
+        }
+        mNow = std::max(mNow, mAlarmTime);
+        auto callback = std::move(mCallback);
+        mCallback = nullptr;
+        callback();
+        return true;
+    }
+
+    void advanceBy(nsecs_t duration) { mNow += duration; }
+
+private:
+    nsecs_t mNow = kPeriod;
+    nsecs_t mAlarmTime = 0;
+    std::function<void()> mCallback;
+};
+
+struct Dispatch {
+    explicit Dispatch(int callbackCount) {
+        auto timeKeeper = std::make_unique<FakeTimeKeeper>();
+        clock = timeKeeper.get();
+        auto tracker = std::make_shared<testing::NiceMock<mock::VSyncTracker>>();
+        ON_CALL(*tracker, nextAnticipatedVSyncTimeFrom(testing::_, testing::_))
+                .WillByDefault([](nsecs_t timePoint, std::optional<nsecs_t>) {
+                    return (timePoint / kPeriod + 1) * kPeriod;
+                });
+        ON_CALL(*tracker, currentPeriod()).WillByDefault(testing::Return(kPeriod));
+        ON_CALL(*tracker, isVSyncInPhase(testing::_, testing::_))
+                .WillByDefault(testing::Return(true));
+        dispatch = std::make_unique<VSyncDispatchTimerQueue>(std::move(timeKeeper),
+                                                             std::move(tracker), kTimerSlack,
+                                                             kMinVsyncDistance);
+        for (int i = 0; i < callbackCount; i++) {
+            tokens.push_back(dispatch->registerCallback([](nsecs_t, nsecs_t, nsecs_t) {},
+                                                        "callback" + std::to_string(i)));
+        }
+    }
+
+    ~Dispatch() {
+        for (const auto token : tokens) {
+            dispatch->unregisterCallback(token);
+        }
+    }
+
+    // Spreads the work durations of the callbacks over a period, so that they do not all wake
+    // up at once.
+    VSyncDispatch::ScheduleTiming timingFor(size_t index) const {
+        const nsecs_t step = kPeriod / static_cast<nsecs_t>(tokens.size() + 1);
+        return {.workDuration = step * static_cast<nsecs_t>(index + 1),
+                .readyDuration = 0,
+                .lastVsync = clock->now()};
+    }
+
+    FakeTimeKeeper* clock;
+    std::unique_ptr<VSyncDispatchTimerQueue> dispatch;
+    std::vector<VSyncDispatch::CallbackToken> tokens;
+};
+
+// Schedules every callback once per frame, the way the EventThreads and the MessageQueue of
+// several displays do.
+void BM_ScheduleAll(benchmark::State& state) {
+    Dispatch dispatch(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        for (size_t i = 0; i < dispatch.tokens.size(); i++) {
+            benchmark::DoNotOptimize(
+                    dispatch.dispatch->schedule(dispatch.tokens[i], dispatch.timingFor(i)));
+        }
+        state.PauseTiming();
+        while (dispatch.clock->fireAlarm()) {
+        }
+        dispatch.clock->advanceBy(kPeriod);
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_ScheduleAll)->Arg(1)->Arg(4)->Arg(8)->Arg(16);
+
+// Fires the timer until every scheduled callback ran.
+void BM_DispatchAll(benchmark::State& state) {
+    Dispatch dispatch(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (size_t i = 0; i < dispatch.tokens.size(); i++) {
+            dispatch.dispatch->schedule(dispatch.tokens[i], dispatch.timingFor(i));
+        }
+        state.ResumeTiming();
+        while (dispatch.clock->fireAlarm()) {
+        }
+        state.PauseTiming();
+        dispatch.clock->advanceBy(kPeriod);
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_DispatchAll)->Arg(1)->Arg(4)->Arg(8)->Arg(16);
+
+} // namespace
+} // namespace android::scheduler
+
+BENCHMARK_MAIN();
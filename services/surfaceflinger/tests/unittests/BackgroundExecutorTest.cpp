@@ -52,6 +52,40 @@ TEST_F(BackgroundExecutorTest, multipleProducers) {
     ASSERT_EQ(backgroundTaskCount, backgroundTaskCompleteCount);
 }
 
+TEST_F(BackgroundExecutorTest, highPriorityDoesNotWaitForNormalPriority) {
+    std::mutex mutex;
+    std::condition_variable condition_variable;
+    bool normalTaskReleased = false;
+    bool highTaskComplete = false;
+
+    BackgroundExecutor::getInstance().sendCallbacks(BackgroundExecutor::Priority::Normal,
+                                                    {[&]() {
+                                                        std::unique_lock<std::mutex> lock{mutex};
+                                                        condition_variable.wait(lock, [&]() {
+                                                            return normalTaskReleased;
+                                                        });
+                                                    }});
+    BackgroundExecutor::getInstance().sendCallbacks(BackgroundExecutor::Priority::High,
+                                                    {[&]() {
+                                                        std::lock_guard<std::mutex> lock{mutex};
+                                                        highTaskComplete = true;
+                                                        condition_variable.notify_all();
+                                                    }});
+
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        condition_variable.wait(lock, [&]() { return highTaskComplete; });
+        normalTaskReleased = true;
+        condition_variable.notify_all();
+    }
+    BackgroundExecutor::getInstance().flushQueue();
+
+    std::string dump;
+    BackgroundExecutor::getInstance().dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("high   lane:"));
+    EXPECT_NE(std::string::npos, dump.find("normal lane:"));
+}
+
 } // namespace
 
 } // namespace android
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BoundedLocklessQueue.h"
+
+namespace android {
+namespace {
+
+TEST(BoundedLocklessQueueTest, popsInPushOrder) {
+    BoundedLocklessQueue<std::string, 4> queue;
+    EXPECT_TRUE(queue.isEmpty());
+    EXPECT_FALSE(queue.pop().has_value());
+
+    // Go around the ring a few times.
+    for (int i = 0; i < 10; i++) {
+        queue.push(std::to_string(i));
+        queue.push(std::to_string(i + 100));
+        EXPECT_FALSE(queue.isEmpty());
+        EXPECT_EQ(2u, queue.getOccupancy());
+        EXPECT_EQ(std::to_string(i), queue.pop());
+        EXPECT_EQ(std::to_string(i + 100), queue.pop());
+        EXPECT_TRUE(queue.isEmpty());
+    }
+    EXPECT_EQ(2u, queue.getMaxOccupancy());
+    EXPECT_EQ(0u, queue.getOverflowCount());
+}
+
+TEST(BoundedLocklessQueueTest, overflowsOnceFull) {
+    BoundedLocklessQueue<int, 4> queue;
+    for (int i = 0; i < 10; i++) {
+        queue.push(i);
+    }
+    EXPECT_EQ(4u, queue.getOccupancy());
+    EXPECT_EQ(4u, queue.getMaxOccupancy());
+    EXPECT_EQ(6u, queue.getOverflowCount());
+
+    // Values pushed while the overflow queue isn't empty follow the overflowed values.
+    EXPECT_EQ(0, queue.pop());
+    queue.push(10);
+    EXPECT_EQ(7u, queue.getOverflowCount());
+    for (int i = 1; i <= 10; i++) {
+        EXPECT_EQ(i, queue.pop());
+    }
+    EXPECT_TRUE(queue.isEmpty());
+    EXPECT_FALSE(queue.pop().has_value());
+
+    // The ring is used again once the overflow queue is drained.
+    queue.push(11);
+    EXPECT_EQ(7u, queue.getOverflowCount());
+    EXPECT_EQ(1u, queue.getOccupancy());
+    EXPECT_EQ(11, queue.pop());
+}
+
+TEST(BoundedLocklessQueueTest, multipleProducers) {
+    constexpr int kProducerCount = 4;
+    constexpr int kValueCount = 10000;
+    BoundedLocklessQueue<std::pair<int, int>, 16> queue;
+
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < kProducerCount; producer++) {
+        producers.emplace_back([&queue, producer]() {
+            for (int i = 0; i < kValueCount; i++) {
+                queue.push({producer, i});
+            }
+        });
+    }
+
+    // Each producer's values are popped in the order they were pushed.
+    std::vector<int> nextValues(kProducerCount, 0);
+    int popped = 0;
+    while (popped < kProducerCount * kValueCount) {
+        if (auto value = queue.pop()) {
+            EXPECT_EQ(nextValues[value->first]++, value->second);
+            popped++;
+        }
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    EXPECT_TRUE(queue.isEmpty());
+    EXPECT_LE(queue.getMaxOccupancy(), 16u);
+}
+
+} // namespace
+} // namespace android
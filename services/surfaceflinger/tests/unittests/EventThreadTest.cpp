@@ -21,9 +21,11 @@
 #undef LOG_TAG
 #define LOG_TAG "LibSurfaceFlingerUnittests"
 
+#include <binder/Parcel.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <log/log.h>
+#include <poll.h>
 #include <scheduler/VsyncConfig.h>
 #include <utils/Errors.h>
 
@@ -593,6 +595,72 @@ TEST_F(EventThreadTest, setVsyncRateOnePostsAllEventsToThatConnection) {
     expectOnExpectedPresentTimePosted(777);
 }
 
+TEST_F(EventThreadTest, connectionsOfTheSameUidShareThrottlingAndFrameTimelines) {
+    setupEventThread();
+
+    ConnectionEventRecorder otherConnectionEventRecorder{0};
+    sp<MockEventThreadConnection> otherConnection = createConnection(otherConnectionEventRecorder);
+
+    mThread->setVsyncRate(1, mConnection);
+    mThread->setVsyncRate(1, otherConnection);
+
+    // EventThread should enable vsync callbacks.
+    expectVSyncCallbackScheduleReceived(true);
+
+    // Both connections belong to the same uid, so the throttler is asked once for the event.
+    onVSyncEvent(123, 456, 789);
+    expectThrottleVsyncReceived(456, mConnectionUid);
+    EXPECT_FALSE(mThrottleVsyncCallRecorder.waitForUnexpectedCall().has_value());
+
+    auto args = mConnectionEventCallRecorder.waitForCall();
+    ASSERT_TRUE(args.has_value());
+    auto otherArgs = otherConnectionEventRecorder.waitForCall();
+    ASSERT_TRUE(otherArgs.has_value());
+
+    // The connections have the same frame interval, and so the same frame timelines.
+    const auto& vsyncData = std::get<0>(args.value()).vsync.vsyncData;
+    const auto& otherVsyncData = std::get<0>(otherArgs.value()).vsync.vsyncData;
+    ASSERT_EQ(vsyncData.frameTimelinesLength, otherVsyncData.frameTimelinesLength);
+    for (size_t i = 0; i < vsyncData.frameTimelinesLength; i++) {
+        EXPECT_EQ(vsyncData.frameTimelines[i].vsyncId, otherVsyncData.frameTimelines[i].vsyncId);
+    }
+}
+
+TEST_F(EventThreadTest, sharedVsyncChannelReplacesVsyncEventsOfThatConnection) {
+    setupEventThread();
+
+    ConnectionEventRecorder connectionEventRecorder{0};
+    sp<MockEventThreadConnection> connection = createConnection(connectionEventRecorder);
+    gui::SharedVsyncChannel channel;
+    ASSERT_EQ(NO_ERROR, mThread->createSharedVsyncChannel(connection, &channel));
+
+    // A parcelled reader maps the page, like the reader of DisplayEventReceiver.
+    Parcel parcel;
+    ASSERT_EQ(NO_ERROR, channel.writeToParcel(&parcel));
+    parcel.setDataPosition(0);
+    gui::SharedVsyncChannel reader;
+    ASSERT_EQ(NO_ERROR, reader.readFromParcel(&parcel));
+
+    mThread->setVsyncRate(1, connection);
+    expectVSyncCallbackScheduleReceived(true);
+
+    onVSyncEvent(123, 456, 789);
+
+    pollfd pfd{.fd = reader.getFd(), .events = POLLIN};
+    ASSERT_EQ(1, poll(&pfd, 1, 1000));
+    gui::SharedVsyncChannel::Vsync vsync;
+    ASSERT_TRUE(reader.consume(&vsync));
+    EXPECT_EQ(123, vsync.timestamp);
+    EXPECT_EQ(INTERNAL_DISPLAY_ID, vsync.displayId);
+    EXPECT_EQ(1u, vsync.count);
+    EXPECT_EQ(mVsyncPeriod.count(), vsync.vsyncData.frameInterval);
+    expectVsyncEventDataFrameTimelinesValidLength(vsync.vsyncData);
+
+    // Only one wake up per vsync, and no event through the BitTube.
+    EXPECT_FALSE(reader.consume(&vsync));
+    EXPECT_FALSE(connectionEventRecorder.waitForUnexpectedCall().has_value());
+}
+
 TEST_F(EventThreadTest, setVsyncRateTwoPostsEveryOtherEventToThatConnection) {
     setupEventThread();
 
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/unique_fd.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+
+#include "FrontEnd/FenceWatcher.h"
+
+namespace android::surfaceflinger::frontend {
+namespace {
+
+using namespace std::chrono_literals;
+
+// Fence polls its fd like a sync fence, so the read end of a pipe stands for a fence which
+// signals once something is written to the pipe.
+struct PipeFence {
+    PipeFence() {
+        int fds[2];
+        EXPECT_EQ(0, pipe(fds));
+        fence = sp<Fence>::make(fds[0]);
+        writeFd.reset(fds[1]);
+    }
+
+    void signal() { EXPECT_EQ(1, write(writeFd.get(), "x", 1)); }
+
+    sp<Fence> fence;
+    base::unique_fd writeFd;
+};
+
+bool waitForSignaled(const FenceWatcher::SignaledFlag& signaled) {
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (!signaled->load()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+TEST(FenceWatcherTest, setsFlagOnceFenceSignals) {
+    FenceWatcher watcher;
+    PipeFence pipeFence;
+
+    const FenceWatcher::SignaledFlag signaled = watcher.watch(pipeFence.fence);
+    ASSERT_NE(nullptr, signaled);
+    EXPECT_FALSE(signaled->load());
+
+    pipeFence.signal();
+    EXPECT_TRUE(waitForSignaled(signaled));
+}
+
+TEST(FenceWatcherTest, setsFlagOfSignaledFence) {
+    FenceWatcher watcher;
+    PipeFence pipeFence;
+    pipeFence.signal();
+
+    const FenceWatcher::SignaledFlag signaled = watcher.watch(pipeFence.fence);
+    ASSERT_NE(nullptr, signaled);
+    EXPECT_TRUE(signaled->load());
+}
+
+TEST(FenceWatcherTest, backsOffWhilePollFails) {
+    // Fails as poll does once there are too many fds, whenever a fence is polled with the eventfd.
+    std::atomic<int> failedPollCount = 0;
+    FenceWatcher watcher([&](pollfd* fds, nfds_t count, int timeout) {
+        if (count > 1) {
+            failedPollCount++;
+            errno = EINVAL;
+            return -1;
+        }
+        return poll(fds, count, timeout);
+    });
+    PipeFence pipeFence;
+
+    const FenceWatcher::SignaledFlag signaled = watcher.watch(pipeFence.fence);
+    ASSERT_NE(nullptr, signaled);
+    std::this_thread::sleep_for(200ms);
+    EXPECT_FALSE(signaled->load());
+    // Spinning on the error would fail many thousands of times.
+    EXPECT_GT(failedPollCount.load(), 0);
+    EXPECT_LT(failedPollCount.load(), 100);
+
+    // The fence is still checked on its own.
+    pipeFence.signal();
+    EXPECT_TRUE(waitForSignaled(signaled));
+}
+
+TEST(FenceWatcherTest, stopsWhilePollFails) {
+    std::atomic<int> failedPollCount = 0;
+    auto watcher = std::make_unique<FenceWatcher>([&](pollfd*, nfds_t, int) {
+        failedPollCount++;
+        errno = ENOMEM;
+        return -1;
+    });
+    PipeFence pipeFence;
+
+    const FenceWatcher::SignaledFlag signaled = watcher->watch(pipeFence.fence);
+    ASSERT_NE(nullptr, signaled);
+    while (failedPollCount.load() == 0) {
+        std::this_thread::sleep_for(1ms);
+    }
+    watcher.reset();
+    EXPECT_FALSE(signaled->load());
+}
+
+} // namespace
+} // namespace android::surfaceflinger::frontend
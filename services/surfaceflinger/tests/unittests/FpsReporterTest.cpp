@@ -24,6 +24,7 @@
 #include <gtest/gtest.h>
 #include <gui/LayerMetadata.h>
 
+#include "BackgroundExecutor.h"
 #include "Client.h" // temporarily needed for LayerCreationArgs
 #include "FpsReporter.h"
 #include "FrontEnd/LayerCreationArgs.h"
@@ -55,9 +56,11 @@ struct TestableFpsListener : public gui::BnFpsListener {
     TestableFpsListener() {}
 
     float lastReportedFps = 0;
+    int reportCount = 0;
 
     binder::Status onFpsReported(float fps) override {
         lastReportedFps = fps;
+        reportCount++;
         return binder::Status::ok();
     }
 };
@@ -103,6 +106,12 @@ protected:
     fake::FakeClock* mClock = new fake::FakeClock();
     sp<FpsReporter> mFpsReporter =
             sp<FpsReporter>::make(mFrameTimeline, std::unique_ptr<Clock>(mClock));
+
+    // Reports are sent from the BackgroundExecutor.
+    void dispatchLayerFps(const frontend::LayerHierarchy& hierarchy) {
+        mFpsReporter->dispatchLayerFps(hierarchy);
+        BackgroundExecutor::getInstance().flushQueue();
+    }
 };
 
 FpsReporterTest::FpsReporterTest() {
@@ -169,13 +178,13 @@ TEST_F(FpsReporterTest, callsListeners) {
 
     mFpsReporter->addListener(mFpsListener, kTaskId);
     mClock->advanceTime(600ms);
-    mFpsReporter->dispatchLayerFps(hierarchyBuilder.getHierarchy());
+    dispatchLayerFps(hierarchyBuilder.getHierarchy());
     EXPECT_EQ(expectedFps, mFpsListener->lastReportedFps);
     mFpsReporter->removeListener(mFpsListener);
     Mock::VerifyAndClearExpectations(&mFrameTimeline);
 
     EXPECT_CALL(mFrameTimeline, computeFps(_)).Times(0);
-    mFpsReporter->dispatchLayerFps(hierarchyBuilder.getHierarchy());
+    dispatchLayerFps(hierarchyBuilder.getHierarchy());
 }
 
 TEST_F(FpsReporterTest, rateLimits) {
@@ -197,18 +206,63 @@ TEST_F(FpsReporterTest, rateLimits) {
 
     mFpsReporter->addListener(mFpsListener, kTaskId);
     mClock->advanceTime(600ms);
-    mFpsReporter->dispatchLayerFps(hierarchyBuilder.getHierarchy());
+    dispatchLayerFps(hierarchyBuilder.getHierarchy());
     EXPECT_EQ(firstFps, mFpsListener->lastReportedFps);
     mClock->advanceTime(200ms);
-    mFpsReporter->dispatchLayerFps(hierarchyBuilder.getHierarchy());
+    dispatchLayerFps(hierarchyBuilder.getHierarchy());
     EXPECT_EQ(firstFps, mFpsListener->lastReportedFps);
     mClock->advanceTime(200ms);
-    mFpsReporter->dispatchLayerFps(hierarchyBuilder.getHierarchy());
+    dispatchLayerFps(hierarchyBuilder.getHierarchy());
     EXPECT_EQ(firstFps, mFpsListener->lastReportedFps);
     mClock->advanceTime(200ms);
-    mFpsReporter->dispatchLayerFps(hierarchyBuilder.getHierarchy());
+    dispatchLayerFps(hierarchyBuilder.getHierarchy());
     EXPECT_EQ(secondFps, mFpsListener->lastReportedFps);
 }
 
+TEST_F(FpsReporterTest, computesFpsOncePerTask) {
+    constexpr int32_t kTaskId = 12;
+    LayerMetadata targetMetadata;
+    targetMetadata.setInt32(gui::METADATA_TASK_ID, kTaskId);
+    createRootLayer(1, targetMetadata);
+    createLayer(11, 1);
+
+    frontend::LayerHierarchyBuilder hierarchyBuilder;
+    hierarchyBuilder.update(mLifecycleManager);
+
+    constexpr float kExpectedFps = 44.0;
+    EXPECT_CALL(mFrameTimeline, computeFps(UnorderedElementsAre(1, 11)))
+            .WillOnce(Return(kExpectedFps));
+
+    sp<TestableFpsListener> otherListener = sp<TestableFpsListener>::make();
+    mFpsReporter->addListener(mFpsListener, kTaskId);
+    mFpsReporter->addListener(otherListener, kTaskId);
+    mClock->advanceTime(600ms);
+    dispatchLayerFps(hierarchyBuilder.getHierarchy());
+    EXPECT_EQ(kExpectedFps, mFpsListener->lastReportedFps);
+    EXPECT_EQ(kExpectedFps, otherListener->lastReportedFps);
+}
+
+TEST_F(FpsReporterTest, skipsUnchangedFps) {
+    constexpr int32_t kTaskId = 12;
+    LayerMetadata targetMetadata;
+    targetMetadata.setInt32(gui::METADATA_TASK_ID, kTaskId);
+    createRootLayer(1, targetMetadata);
+
+    frontend::LayerHierarchyBuilder hierarchyBuilder;
+    hierarchyBuilder.update(mLifecycleManager);
+
+    constexpr float kExpectedFps = 44.0;
+    EXPECT_CALL(mFrameTimeline, computeFps(UnorderedElementsAre(1)))
+            .WillRepeatedly(Return(kExpectedFps));
+
+    mFpsReporter->addListener(mFpsListener, kTaskId);
+    mClock->advanceTime(600ms);
+    dispatchLayerFps(hierarchyBuilder.getHierarchy());
+    mClock->advanceTime(600ms);
+    dispatchLayerFps(hierarchyBuilder.getHierarchy());
+    EXPECT_EQ(kExpectedFps, mFpsListener->lastReportedFps);
+    EXPECT_EQ(1, mFpsListener->reportCount);
+}
+
 } // namespace
 } // namespace android
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "LibSurfaceFlingerUnittests"
+
+#include <TimeStats/FrameStageStats.h>
+#include <gtest/gtest.h>
+#include <timestatsatomsproto/TimeStatsAtomsProtoHeader.h>
+
+#include <chrono>
+
+using namespace android::surfaceflinger;
+using namespace std::chrono_literals;
+
+namespace android {
+namespace {
+
+using Stage = FrameStageStats::Stage;
+
+constexpr PhysicalDisplayId kDisplayId = PhysicalDisplayId::fromPort(111u);
+constexpr PhysicalDisplayId kOtherDisplayId = PhysicalDisplayId::fromPort(222u);
+
+constexpr auto kSubBucketCount = static_cast<Duration::rep>(FrameStageStats::kSubBucketCount);
+
+TEST(FrameStageStatsTest, bucketsCoverDurations) {
+    for (size_t bucket = 0; bucket < FrameStageStats::kBucketCount; bucket++) {
+        const Duration lower = FrameStageStats::bucketLowerBound(bucket);
+        const Duration upper = FrameStageStats::bucketUpperBound(bucket);
+        EXPECT_EQ(bucket, FrameStageStats::bucketOf(lower));
+        EXPECT_EQ(bucket, FrameStageStats::bucketOf(upper - 1us));
+        if (bucket + 1 < FrameStageStats::kBucketCount) {
+            EXPECT_EQ(upper, FrameStageStats::bucketLowerBound(bucket + 1));
+        }
+        // Past the first buckets, which are a microsecond wide, the buckets are at most an eighth
+        // of their lower bound wide.
+        if (bucket >= FrameStageStats::kSubBucketCount) {
+            EXPECT_LE((upper - lower) * kSubBucketCount, lower) << bucket;
+        }
+    }
+
+    EXPECT_EQ(0u, FrameStageStats::bucketOf(-1ms));
+    EXPECT_EQ(FrameStageStats::kBucketCount - 1, FrameStageStats::bucketOf(1h));
+}
+
+TEST(FrameStageStatsTest, recordsPercentilesPerDisplayAndStage) {
+    FrameStageStats stats;
+    for (int i = 1; i <= 100; i++) {
+        stats.record(kDisplayId, Stage::Commit, std::chrono::microseconds(i * 100));
+    }
+    stats.record(kOtherDisplayId, Stage::Present, 5ms);
+
+    EXPECT_EQ(100u, stats.getCount(kDisplayId, Stage::Commit));
+    EXPECT_EQ(0u, stats.getCount(kDisplayId, Stage::Present));
+    EXPECT_EQ(1u, stats.getCount(kOtherDisplayId, Stage::Present));
+
+    const auto expectNear = [](Duration expected, std::optional<Duration> actual) {
+        ASSERT_TRUE(actual);
+        EXPECT_GE(*actual, expected);
+        EXPECT_LE(*actual, expected + expected / kSubBucketCount);
+    };
+    expectNear(5ms, stats.getPercentile(kDisplayId, Stage::Commit, 50));
+    expectNear(9ms, stats.getPercentile(kDisplayId, Stage::Commit, 90));
+    expectNear(9900us, stats.getPercentile(kDisplayId, Stage::Commit, 99));
+    expectNear(5ms, stats.getPercentile(kOtherDisplayId, Stage::Present, 99));
+    EXPECT_FALSE(stats.getPercentile(kDisplayId, Stage::Present, 50));
+}
+
+TEST(FrameStageStatsTest, dropsDisplaysBeyondCapacity) {
+    FrameStageStats stats;
+    for (uint8_t port = 0; port <= FrameStageStats::kMaxDisplays; port++) {
+        stats.record(PhysicalDisplayId::fromPort(port), Stage::Commit, 1ms);
+    }
+
+    EXPECT_EQ(1u, stats.getDroppedCount());
+    EXPECT_EQ(0u,
+              stats.getCount(PhysicalDisplayId::fromPort(
+                                     static_cast<uint8_t>(FrameStageStats::kMaxDisplays)),
+                             Stage::Commit));
+}
+
+TEST(FrameStageStatsTest, clearKeepsDisplays) {
+    FrameStageStats stats;
+    stats.record(kDisplayId, Stage::RenderEngine, 1ms);
+    stats.clear();
+    EXPECT_EQ(0u, stats.getCount(kDisplayId, Stage::RenderEngine));
+
+    stats.record(kDisplayId, Stage::RenderEngine, 2ms);
+    EXPECT_EQ(1u, stats.getCount(kDisplayId, Stage::RenderEngine));
+}
+
+TEST(FrameStageStatsTest, dumpsStagesWithSamples) {
+    FrameStageStats stats;
+    stats.record(kDisplayId, Stage::SnapshotBuild, 1ms);
+
+    std::string result;
+    stats.dump(result);
+    EXPECT_NE(std::string::npos, result.find("SnapshotBuild"));
+    EXPECT_EQ(std::string::npos, result.find("Callbacks"));
+}
+
+TEST(FrameStageStatsTest, pullsAtomAndClears) {
+    FrameStageStats stats;
+    for (int i = 0; i < 10; i++) {
+        stats.record(kDisplayId, Stage::Present, 2ms);
+    }
+
+    std::vector<uint8_t> pulledBytes;
+    ASSERT_TRUE(stats.populateAtom(&pulledBytes));
+
+    SurfaceflingerStatsFrameStagesWrapper atomList;
+    ASSERT_TRUE(atomList.ParseFromArray(pulledBytes.data(), pulledBytes.size()));
+    ASSERT_EQ(1, atomList.atom_size());
+    const SurfaceflingerStatsFrameStages& atom = atomList.atom(0);
+    EXPECT_EQ(SurfaceflingerStatsFrameStages::STAGE_PRESENT, atom.stage());
+    EXPECT_EQ(static_cast<int64_t>(kDisplayId.value), atom.display_id());
+    EXPECT_EQ(10, atom.frame_count());
+    EXPECT_EQ(2000, atom.mean_micros());
+    EXPECT_GE(atom.p99_micros(), 2000);
+    EXPECT_LE(atom.p99_micros(), 2250);
+
+    EXPECT_EQ(0u, stats.getCount(kDisplayId, Stage::Present));
+}
+
+} // namespace
+} // namespace android
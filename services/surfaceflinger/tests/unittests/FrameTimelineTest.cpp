@@ -169,6 +169,19 @@ public:
 
     int64_t snoopCurrentTraceCookie() const { return mTraceCookieCounter->mTraceCookie; }
 
+    size_t getSurfaceFramePoolFreeCount() const {
+        return mFrameTimeline->mSurfaceFramePool->getFreeCount();
+    }
+
+    std::optional<impl::FrameTimeline::InputLatencies> getInputLatencies(int32_t layerId) const {
+        std::lock_guard<std::mutex> lock(mFrameTimeline->mMutex);
+        const auto it = mFrameTimeline->mInputLatencies.find(layerId);
+        if (it == mFrameTimeline->mInputLatencies.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
     void flushTrace() {
         using FrameTimelineDataSource = impl::FrameTimeline::FrameTimelineDataSource;
         FrameTimelineDataSource::Trace(
@@ -268,6 +281,44 @@ TEST_F(FrameTimelineTest, createSurfaceFrameForToken_validInputEventId) {
     EXPECT_EQ(inputEventId, surfaceFrame->getInputEventId());
 }
 
+TEST_F(FrameTimelineTest, surfaceFramesOfALayerShareItsNames) {
+    auto surfaceFrame1 =
+            mFrameTimeline->createSurfaceFrameForToken({}, sPidOne, sUidOne, sLayerIdOne,
+                                                       sLayerNameOne, sLayerNameOne,
+                                                       /*isBuffer*/ true, sGameMode);
+    auto surfaceFrame2 =
+            mFrameTimeline->createSurfaceFrameForToken({}, sPidOne, sUidOne, sLayerIdOne,
+                                                       sLayerNameOne, sLayerNameOne,
+                                                       /*isBuffer*/ true, sGameMode);
+    auto surfaceFrame3 =
+            mFrameTimeline->createSurfaceFrameForToken({}, sPidTwo, sUidOne, sLayerIdTwo,
+                                                       sLayerNameTwo, sLayerNameTwo,
+                                                       /*isBuffer*/ true, sGameMode);
+
+    EXPECT_EQ(sLayerNameOne, surfaceFrame1->getLayerName());
+    EXPECT_EQ(&surfaceFrame1->getLayerName(), &surfaceFrame2->getLayerName());
+    EXPECT_EQ(&surfaceFrame1->getLayerName(), &surfaceFrame2->getDebugName());
+    EXPECT_EQ(sLayerNameTwo, surfaceFrame3->getLayerName());
+}
+
+TEST_F(FrameTimelineTest, releasedSurfaceFramesAreReused) {
+    auto surfaceFrame =
+            mFrameTimeline->createSurfaceFrameForToken({}, sPidOne, sUidOne, sLayerIdOne,
+                                                       sLayerNameOne, sLayerNameOne,
+                                                       /*isBuffer*/ true, sGameMode);
+    const void* const address = surfaceFrame.get();
+    EXPECT_EQ(0u, getSurfaceFramePoolFreeCount());
+
+    surfaceFrame.reset();
+    EXPECT_EQ(1u, getSurfaceFramePoolFreeCount());
+
+    surfaceFrame = mFrameTimeline->createSurfaceFrameForToken({}, sPidOne, sUidOne, sLayerIdOne,
+                                                              sLayerNameOne, sLayerNameOne,
+                                                              /*isBuffer*/ true, sGameMode);
+    EXPECT_EQ(address, surfaceFrame.get());
+    EXPECT_EQ(0u, getSurfaceFramePoolFreeCount());
+}
+
 TEST_F(FrameTimelineTest, presentFenceSignaled_droppedFramesNotUpdated) {
     auto presentFence1 = fenceFactory.createFenceTimeForTest(Fence::NO_FENCE);
     int64_t token1 = mTokenManager->generateTokenForPredictions({10, 20, 30});
@@ -2678,4 +2729,95 @@ TEST_F(FrameTimelineTest, surfaceFrameRenderRateUsingAppFrameRate) {
 
     EXPECT_EQ(surfaceFrame->getRenderRate().getPeriodNsecs(), 30);
 }
+TEST_F(FrameTimelineTest, inputLatencies_recordedForFramesWithInputEventId) {
+    const nsecs_t vsyncTime = std::chrono::nanoseconds(10ms).count();
+    const nsecs_t acquireTime = std::chrono::nanoseconds(18ms).count();
+    const nsecs_t presentTime = std::chrono::nanoseconds(30ms).count();
+    int64_t surfaceFrameToken = mTokenManager->generateTokenForPredictions(
+            {vsyncTime, acquireTime, presentTime});
+    int64_t sfToken = mTokenManager->generateTokenForPredictions(
+            {acquireTime, acquireTime + 1, presentTime});
+
+    FrameTimelineInfo ftInfo;
+    ftInfo.vsyncId = surfaceFrameToken;
+    ftInfo.inputEventId = sInputEventId;
+    auto surfaceFrame1 =
+            mFrameTimeline->createSurfaceFrameForToken(ftInfo, sPidOne, sUidOne, sLayerIdOne,
+                                                       sLayerNameOne, sLayerNameOne,
+                                                       /*isBuffer*/ true, sGameMode);
+    // The second layer updates in the same frame, but not in response to input.
+    ftInfo.inputEventId = 0;
+    auto surfaceFrame2 =
+            mFrameTimeline->createSurfaceFrameForToken(ftInfo, sPidTwo, sUidOne, sLayerIdTwo,
+                                                       sLayerNameTwo, sLayerNameTwo,
+                                                       /*isBuffer*/ true, sGameMode);
+
+    auto presentFence = fenceFactory.createFenceTimeForTest(Fence::NO_FENCE);
+    mFrameTimeline->setSfWakeUp(sfToken, acquireTime, RR_11, RR_11);
+    surfaceFrame1->setAcquireFenceTime(acquireTime);
+    surfaceFrame1->setPresentState(SurfaceFrame::PresentState::Presented);
+    mFrameTimeline->addSurfaceFrame(surfaceFrame1);
+    surfaceFrame2->setAcquireFenceTime(acquireTime);
+    surfaceFrame2->setPresentState(SurfaceFrame::PresentState::Presented);
+    mFrameTimeline->addSurfaceFrame(surfaceFrame2);
+    mFrameTimeline->setSfPresent(acquireTime + 1, presentFence);
+
+    // The latencies are recorded once the present fence signals.
+    EXPECT_FALSE(getInputLatencies(sLayerIdOne).has_value());
+    presentFence->signalForTest(presentTime);
+    addEmptyDisplayFrame();
+
+    const auto latencies = getInputLatencies(sLayerIdOne);
+    ASSERT_TRUE(latencies.has_value());
+    EXPECT_EQ(latencies->layerName, sLayerNameOne);
+    EXPECT_EQ(latencies->vsyncToPresent.count, 1u);
+    EXPECT_EQ(latencies->vsyncToReady.count, 1u);
+    EXPECT_EQ(latencies->readyToPresent.count, 1u);
+
+    // The buckets are at most 12.5% wide.
+    const nsecs_t vsyncToPresent = latencies->vsyncToPresent.getPercentile(50);
+    EXPECT_GT(vsyncToPresent, presentTime - vsyncTime);
+    EXPECT_LE(vsyncToPresent, (presentTime - vsyncTime) * 9 / 8);
+    const nsecs_t readyToPresent = latencies->readyToPresent.getPercentile(50);
+    EXPECT_GT(readyToPresent, presentTime - acquireTime);
+    EXPECT_LE(readyToPresent, (presentTime - acquireTime) * 9 / 8);
+
+    EXPECT_FALSE(getInputLatencies(sLayerIdTwo).has_value());
+
+    std::string result;
+    Vector<String16> args;
+    args.add(String16("-input"));
+    mFrameTimeline->parseArgs(args, result);
+    EXPECT_NE(result.find(sLayerNameOne), std::string::npos);
+    EXPECT_EQ(result.find(sLayerNameTwo), std::string::npos);
+
+    args.clear();
+    args.add(String16("-input-clear"));
+    mFrameTimeline->parseArgs(args, result);
+    EXPECT_FALSE(getInputLatencies(sLayerIdOne).has_value());
+}
+
+TEST_F(FrameTimelineTest, inputLatencies_notRecordedForDroppedFrames) {
+    int64_t surfaceFrameToken = mTokenManager->generateTokenForPredictions({10, 20, 30});
+    int64_t sfToken = mTokenManager->generateTokenForPredictions({22, 26, 30});
+    FrameTimelineInfo ftInfo;
+    ftInfo.vsyncId = surfaceFrameToken;
+    ftInfo.inputEventId = sInputEventId;
+    auto surfaceFrame =
+            mFrameTimeline->createSurfaceFrameForToken(ftInfo, sPidOne, sUidOne, sLayerIdOne,
+                                                       sLayerNameOne, sLayerNameOne,
+                                                       /*isBuffer*/ true, sGameMode);
+
+    auto presentFence = fenceFactory.createFenceTimeForTest(Fence::NO_FENCE);
+    mFrameTimeline->setSfWakeUp(sfToken, 22, RR_11, RR_11);
+    surfaceFrame->setDropTime(12);
+    surfaceFrame->setPresentState(SurfaceFrame::PresentState::Dropped);
+    mFrameTimeline->addSurfaceFrame(surfaceFrame);
+    mFrameTimeline->setSfPresent(26, presentFence);
+    presentFence->signalForTest(30);
+    addEmptyDisplayFrame();
+
+    EXPECT_FALSE(getInputLatencies(sLayerIdOne).has_value());
+}
+
 } // namespace android::frametimeline
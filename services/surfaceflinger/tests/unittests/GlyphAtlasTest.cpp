@@ -0,0 +1,142 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <vector>
+
+#include "Utils/OverlayUtils.h"
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <SkSurface.h>
+#pragma clang diagnostic pop
+
+namespace android {
+namespace {
+
+constexpr SkColor kColor = SkColorSetARGB(204, 40, 200, 10);
+
+// Draws the glyphs with SegmentDrawer, like the overlays did before the atlas.
+std::vector<uint32_t> drawWithSkia(const GlyphAtlas::Glyphs& glyphs,
+                                   ui::Transform::RotationFlags rotation, int width, int height) {
+    SkMatrix canvasTransform = SkMatrix();
+    switch (rotation) {
+        case ui::Transform::ROT_90:
+            canvasTransform.setTranslate(width, 0);
+            canvasTransform.preRotate(90.f);
+            break;
+        case ui::Transform::ROT_270:
+            canvasTransform.setRotate(270.f, height / 2.f, height / 2.f);
+            break;
+        default:
+            break;
+    }
+
+    const SkImageInfo imageInfo = SkImageInfo::MakeN32Premul(width, height);
+    sk_sp<SkSurface> surface = SkSurfaces::Raster(imageInfo);
+    SkCanvas* canvas = surface->getCanvas();
+    canvas->setMatrix(canvasTransform);
+    for (const auto& [glyph, left] : glyphs) {
+        if (glyph < 10) {
+            SegmentDrawer::drawDigit(glyph, left, kColor, *canvas);
+        } else {
+            SegmentDrawer::drawSegment(static_cast<SegmentDrawer::Segment>(glyph - 10), left,
+                                       kColor, *canvas);
+        }
+    }
+
+    std::vector<uint32_t> pixels(static_cast<size_t>(width * height));
+    canvas->readPixels(imageInfo, pixels.data(), static_cast<size_t>(width) * sizeof(uint32_t),
+                       0, 0);
+    return pixels;
+}
+
+std::vector<uint32_t> compose(const GlyphAtlas::Glyphs& glyphs,
+                              ui::Transform::RotationFlags rotation, int width, int height) {
+    // Garbage from a previous frame, which compose clears.
+    std::vector<uint32_t> pixels(static_cast<size_t>(width * height), 0xdeadbeef);
+    GlyphAtlas::getInstance().compose(glyphs, kColor, rotation, pixels.data(), width, height,
+                                      width);
+    return pixels;
+}
+
+// Skia may round the premultiplied color differently, by one at most.
+void expectNear(const std::vector<uint32_t>& expected, const std::vector<uint32_t>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            const int expectedChannel = static_cast<int>((expected[i] >> shift) & 0xff);
+            const int actualChannel = static_cast<int>((actual[i] >> shift) & 0xff);
+            ASSERT_LE(std::abs(expectedChannel - actualChannel), 1) << "at pixel " << i;
+        }
+    }
+}
+
+GlyphAtlas::Glyphs allGlyphs() {
+    GlyphAtlas::Glyphs glyphs;
+    int left = 0;
+    for (int digit = 0; digit < 10; digit++) {
+        glyphs.push_back({GlyphAtlas::digit(digit), left});
+        left = (left + kDigitWidth + kDigitSpace) % (kBufferWidth - kDigitWidth);
+    }
+    glyphs.push_back({GlyphAtlas::segment(SegmentDrawer::Segment::DecimalPoint), 0});
+    glyphs.push_back({GlyphAtlas::segment(SegmentDrawer::Segment::UpperLeft), kDigitWidth});
+    return glyphs;
+}
+
+TEST(GlyphAtlasTest, matchesSkia) {
+    for (const auto& glyphs : {GlyphAtlas::Glyphs{{GlyphAtlas::digit(8), 0}}, allGlyphs()}) {
+        expectNear(drawWithSkia(glyphs, ui::Transform::ROT_0, kBufferWidth, kBufferHeight),
+                   compose(glyphs, ui::Transform::ROT_0, kBufferWidth, kBufferHeight));
+    }
+}
+
+TEST(GlyphAtlasTest, matchesSkiaWhenRotated) {
+    const auto glyphs = allGlyphs();
+    for (const auto rotation : {ui::Transform::ROT_90, ui::Transform::ROT_270}) {
+        SCOPED_TRACE(rotation);
+        // The buffers of RefreshRateOverlay, and the square ones of HdrSdrRatioOverlay.
+        expectNear(drawWithSkia(glyphs, rotation, kBufferHeight, kBufferWidth),
+                   compose(glyphs, rotation, kBufferHeight, kBufferWidth));
+        expectNear(drawWithSkia(glyphs, rotation, kBufferWidth, kBufferWidth),
+                   compose(glyphs, rotation, kBufferWidth, kBufferWidth));
+    }
+}
+
+TEST(GlyphAtlasTest, composeRespectsStride) {
+    constexpr int kStride = kBufferWidth + 7;
+    std::vector<uint32_t> pixels(static_cast<size_t>(kStride * kBufferHeight), 0xdeadbeef);
+    GlyphAtlas::getInstance().compose({{GlyphAtlas::digit(1), 0}}, kColor, ui::Transform::ROT_0,
+                                      pixels.data(), kBufferWidth, kBufferHeight, kStride);
+
+    const auto expected = compose({{GlyphAtlas::digit(1), 0}}, ui::Transform::ROT_0, kBufferWidth,
+                                  kBufferHeight);
+    for (int y = 0; y < kBufferHeight; y++) {
+        for (int x = 0; x < kStride; x++) {
+            const uint32_t pixel = pixels[static_cast<size_t>(y * kStride + x)];
+            if (x < kBufferWidth) {
+                ASSERT_EQ(expected[static_cast<size_t>(y * kBufferWidth + x)], pixel);
+            } else {
+                // The padding of the rows is left as is.
+                ASSERT_EQ(0xdeadbeefu, pixel);
+            }
+        }
+    }
+}
+
+} // namespace
+} // namespace android
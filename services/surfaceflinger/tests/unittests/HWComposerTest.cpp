@@ -567,4 +567,66 @@ TEST_F(HWComposerLayerGenericMetadataTest, forwardsSupportedMetadata) {
     EXPECT_EQ(hal::Error::UNSUPPORTED, result);
 }
 
+struct HWComposerLayerStateTest : public HWComposerLayerTest {
+    HWComposerLayerStateTest() : HWComposerLayerTest({}) {}
+};
+
+TEST_F(HWComposerLayerStateTest, skipsUnchangedState) {
+    EXPECT_CALL(*mHal, setLayerBlendMode(kDisplayId, kLayerId, hal::BlendMode::PREMULTIPLIED))
+            .WillOnce(Return(V2_4::Error::NONE));
+    EXPECT_CALL(*mHal, setLayerZOrder(kDisplayId, kLayerId, 3u))
+            .WillOnce(Return(V2_4::Error::NONE));
+    EXPECT_CALL(*mHal, setLayerPlaneAlpha(kDisplayId, kLayerId, 0.5f))
+            .WillOnce(Return(V2_4::Error::NONE));
+
+    for (int i = 0; i < 2; i++) {
+        EXPECT_EQ(hal::Error::NONE, mLayer.setBlendMode(hal::BlendMode::PREMULTIPLIED));
+        EXPECT_EQ(hal::Error::NONE, mLayer.setZOrder(3u));
+        EXPECT_EQ(hal::Error::NONE, mLayer.setPlaneAlpha(0.5f));
+    }
+
+    EXPECT_CALL(*mHal, setLayerZOrder(kDisplayId, kLayerId, 4u))
+            .WillOnce(Return(V2_4::Error::NONE));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setZOrder(4u));
+}
+
+TEST_F(HWComposerLayerStateTest, resendsStateAfterError) {
+    EXPECT_CALL(*mHal, setLayerZOrder(kDisplayId, kLayerId, 3u))
+            .WillOnce(Return(V2_4::Error::BAD_PARAMETER))
+            .WillOnce(Return(V2_4::Error::NONE));
+
+    EXPECT_EQ(hal::Error::BAD_PARAMETER, mLayer.setZOrder(3u));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setZOrder(3u));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setZOrder(3u));
+}
+
+TEST(HWComposerDisplayLayerStateTest, resendsLayerStateAfterValidateError) {
+    constexpr hal::HWDisplayId kDisplayId = static_cast<hal::HWDisplayId>(1001);
+    constexpr hal::HWLayerId kLayerId = static_cast<hal::HWLayerId>(1002);
+    StrictMock<Hwc2::mock::Composer> hal;
+    const std::unordered_set<aidl::Capability> capabilities;
+    HWC2::impl::Display display{hal, capabilities, kDisplayId, hal::DisplayType::INVALID};
+
+    EXPECT_CALL(hal, createLayer(kDisplayId, _))
+            .WillOnce(DoAll(SetArgPointee<1>(kLayerId), Return(V2_4::Error::NONE)));
+    auto layer = display.createLayer();
+    ASSERT_TRUE(layer.has_value());
+
+    // The HWC only reports the failure of the layer commands on validate.
+    EXPECT_CALL(hal, setLayerZOrder(kDisplayId, kLayerId, 3u))
+            .Times(2)
+            .WillRepeatedly(Return(V2_4::Error::NONE));
+    EXPECT_CALL(hal, validateDisplay(kDisplayId, _, _, _, _))
+            .WillOnce(Return(V2_4::Error::BAD_LAYER));
+
+    EXPECT_EQ(hal::Error::NONE, (*layer)->setZOrder(3u));
+    uint32_t numTypes = 0;
+    uint32_t numRequests = 0;
+    EXPECT_EQ(hal::Error::BAD_LAYER, display.validate(0, 0, &numTypes, &numRequests));
+    EXPECT_EQ(hal::Error::NONE, (*layer)->setZOrder(3u));
+    EXPECT_EQ(hal::Error::NONE, (*layer)->setZOrder(3u));
+
+    EXPECT_CALL(hal, destroyLayer(kDisplayId, kLayerId));
+}
+
 } // namespace android
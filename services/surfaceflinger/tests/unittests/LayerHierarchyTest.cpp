@@ -777,4 +777,39 @@ TEST_F(LayerHierarchyTest, canMirrorDisplayWithMirrors) {
     EXPECT_EQ(getTraversalPath(hierarchyBuilder.getOffscreenHierarchy()), expected);
 }
 
+TEST_F(LayerHierarchyTest, flattenedHierarchyStopsLikeHierarchy) {
+    LayerHierarchyBuilder hierarchyBuilder;
+    hierarchyBuilder.update(mLifecycleManager);
+    setZ(121, -1);
+    reparentRelativeLayer(13, 11);
+    UPDATE_AND_VERIFY(hierarchyBuilder);
+
+    // Stopping at 11 or 12 skips their children which would be visited after them.
+    auto visitUntilStop = [](const auto& hierarchy, bool inZOrder) {
+        std::vector<uint32_t> layerIds;
+        auto visitor = [&layerIds](const LayerHierarchy& hierarchy,
+                                   const LayerHierarchy::TraversalPath&) -> bool {
+            const uint32_t id = hierarchy.getLayer()->id;
+            layerIds.emplace_back(id);
+            return id != 11 && id != 12;
+        };
+        if (inZOrder) {
+            hierarchy.traverseInZOrder(visitor);
+        } else {
+            hierarchy.traverse(visitor);
+        }
+        return layerIds;
+    };
+
+    const LayerHierarchy& hierarchy = hierarchyBuilder.getHierarchy();
+    const FlattenedLayerHierarchy& flattened = hierarchyBuilder.getFlattenedHierarchy();
+    EXPECT_EQ(visitUntilStop(hierarchy, false), visitUntilStop(flattened, false));
+    EXPECT_EQ(visitUntilStop(hierarchy, true), visitUntilStop(flattened, true));
+    // 13 is still visited as a detached child of 1.
+    std::vector<uint32_t> expected = {1, 11, 12, 13, 2};
+    EXPECT_EQ(visitUntilStop(flattened, false), expected);
+    expected = {1, 11, 121, 12, 2};
+    EXPECT_EQ(visitUntilStop(flattened, true), expected);
+}
+
 } // namespace android::surfaceflinger::frontend
@@ -73,7 +73,9 @@ protected:
         return args;
     }
 
-    std::vector<uint32_t> getTraversalPath(const LayerHierarchy& hierarchy) const {
+    // Works with LayerHierarchy and FlattenedLayerHierarchy.
+    template <typename Hierarchy>
+    std::vector<uint32_t> getTraversalPath(const Hierarchy& hierarchy) const {
         std::vector<uint32_t> layerIds;
         hierarchy.traverse([&layerIds = layerIds](const LayerHierarchy& hierarchy,
                                                   const LayerHierarchy::TraversalPath&) -> bool {
@@ -83,7 +85,8 @@ protected:
         return layerIds;
     }
 
-    std::vector<uint32_t> getTraversalPathInZOrder(const LayerHierarchy& hierarchy) const {
+    template <typename Hierarchy>
+    std::vector<uint32_t> getTraversalPathInZOrder(const Hierarchy& hierarchy) const {
         std::vector<uint32_t> layerIds;
         hierarchy.traverseInZOrder(
                 [&layerIds = layerIds](const LayerHierarchy& hierarchy,
@@ -186,6 +189,10 @@ protected:
                   getTraversalPath(newBuilder.getHierarchy()));
         EXPECT_EQ(getTraversalPathInZOrder(hierarchyBuilder.getHierarchy()),
                   getTraversalPathInZOrder(newBuilder.getHierarchy()));
+        EXPECT_EQ(getTraversalPath(hierarchyBuilder.getHierarchy()),
+                  getTraversalPath(hierarchyBuilder.getFlattenedHierarchy()));
+        EXPECT_EQ(getTraversalPathInZOrder(hierarchyBuilder.getHierarchy()),
+                  getTraversalPathInZOrder(hierarchyBuilder.getFlattenedHierarchy()));
         EXPECT_FALSE(
                 mLifecycleManager.getGlobalChanges().test(RequestedLayerState::Changes::Hierarchy));
     }
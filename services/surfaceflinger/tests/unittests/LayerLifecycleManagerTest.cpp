@@ -96,6 +96,24 @@ TEST_F(LayerLifecycleManagerTest, addLayers) {
     listener->expectLayersDestroyed({1, 2, 3});
 }
 
+TEST_F(LayerLifecycleManagerTest, destroyedLayersAreRecycled) {
+    LayerLifecycleManager lifecycleManager;
+    std::vector<std::unique_ptr<RequestedLayerState>> layers;
+    layers.emplace_back(rootLayer(1));
+    const RequestedLayerState* destroyedLayer = layers.back().get();
+    lifecycleManager.addLayers(std::move(layers));
+    lifecycleManager.onHandlesDestroyed({{1, "1"}});
+    lifecycleManager.commitChanges();
+    EXPECT_EQ(lifecycleManager.getLayerPool()->size(), 1u);
+
+    std::unique_ptr<RequestedLayerState> layer = lifecycleManager.getLayerPool()->make(
+            createArgs(/*id=*/2, /*canBeRoot=*/true, /*parent=*/UNASSIGNED_LAYER_ID,
+                       /*mirror=*/UNASSIGNED_LAYER_ID));
+    EXPECT_EQ(layer.get(), destroyedLayer);
+    EXPECT_EQ(layer->id, 2u);
+    EXPECT_EQ(lifecycleManager.getLayerPool()->size(), 0u);
+}
+
 TEST_F(LayerLifecycleManagerTest, updateLayerStates) {
     LayerLifecycleManager lifecycleManager;
     std::vector<std::unique_ptr<RequestedLayerState>> layers;
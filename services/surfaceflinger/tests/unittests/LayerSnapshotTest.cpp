@@ -103,6 +103,26 @@ protected:
         EXPECT_EQ(expectedVisibleLayerIdsInZOrder, actualVisibleLayerIdsInZOrder);
     }
 
+    static void expectSameSnapshots(LayerSnapshotBuilder& expectedBuilder,
+                                    LayerSnapshotBuilder& actualBuilder) {
+        auto& expected = expectedBuilder.getSnapshots();
+        auto& actual = actualBuilder.getSnapshots();
+        ASSERT_EQ(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            SCOPED_TRACE(expected[i]->getDebugString());
+            EXPECT_EQ(expected[i]->path, actual[i]->path);
+            EXPECT_EQ(expected[i]->globalZ, actual[i]->globalZ);
+            EXPECT_EQ(expected[i]->changes, actual[i]->changes);
+            EXPECT_EQ(expected[i]->isVisible, actual[i]->isVisible);
+            EXPECT_EQ(expected[i]->color.a, actual[i]->color.a);
+            EXPECT_EQ(expected[i]->geomLayerTransform, actual[i]->geomLayerTransform);
+            EXPECT_EQ(expected[i]->frameRate, actual[i]->frameRate);
+            EXPECT_EQ(expected[i]->isHiddenByPolicyFromRelativeParent,
+                      actual[i]->isHiddenByPolicyFromRelativeParent);
+            EXPECT_EQ(expected[i]->reachablilty, actual[i]->reachablilty);
+        }
+    }
+
     LayerSnapshot* getSnapshot(uint32_t layerId) { return mSnapshotBuilder.getSnapshot(layerId); }
     LayerSnapshot* getSnapshot(const LayerHierarchy::TraversalPath path) {
         return mSnapshotBuilder.getSnapshot(path);
@@ -257,6 +277,35 @@ TEST_F(LayerSnapshotTest, FastPathClearsPreviousChangeStates) {
     EXPECT_EQ(getSnapshot(11)->changes.get(), 0u);
 }
 
+TEST_F(LayerSnapshotTest, TracksWindowsWithChangedInputInfo) {
+    auto changedIds = mSnapshotBuilder.takeChangedInputWindowIds();
+    ASSERT_TRUE(changedIds.has_value());
+    EXPECT_EQ(1u, changedIds->count(getSnapshot(1)->inputInfo.id));
+    EXPECT_EQ(1u, changedIds->count(getSnapshot(1221)->inputInfo.id));
+
+    setColor(11, {1._hf, 0._hf, 0._hf});
+    UPDATE_AND_VERIFY(mSnapshotBuilder, STARTING_ZORDER);
+    changedIds = mSnapshotBuilder.takeChangedInputWindowIds();
+    ASSERT_TRUE(changedIds.has_value());
+    EXPECT_TRUE(changedIds->empty());
+
+    // The changes of several updates add up until they are taken.
+    setAlpha(11, 0.5f);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, STARTING_ZORDER);
+    setAlpha(13, 0.5f);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, STARTING_ZORDER);
+    changedIds = mSnapshotBuilder.takeChangedInputWindowIds();
+    ASSERT_TRUE(changedIds.has_value());
+    EXPECT_EQ(1u, changedIds->count(getSnapshot(11)->inputInfo.id));
+    EXPECT_EQ(1u, changedIds->count(getSnapshot(111)->inputInfo.id));
+    EXPECT_EQ(1u, changedIds->count(getSnapshot(13)->inputInfo.id));
+    EXPECT_EQ(0u, changedIds->count(getSnapshot(12)->inputInfo.id));
+
+    changedIds = mSnapshotBuilder.takeChangedInputWindowIds();
+    ASSERT_TRUE(changedIds.has_value());
+    EXPECT_TRUE(changedIds->empty());
+}
+
 TEST_F(LayerSnapshotTest, FastPathSetsChangeFlagToContent) {
     setColor(1, {1._hf, 0._hf, 0._hf});
     UPDATE_AND_VERIFY(mSnapshotBuilder, STARTING_ZORDER);
@@ -1258,4 +1307,85 @@ TEST_F(LayerSnapshotTest, canOccludePresentation) {
     EXPECT_EQ(getSnapshot(1221)->inputInfo.canOccludePresentation, true);
 }
 
+TEST_F(LayerSnapshotTest, parallelAndFlattenedUpdatesMatchRecursiveUpdate) {
+    reparentRelativeLayer(13, 2);
+    mirrorLayer(/*layer*/ 14, /*parent*/ 1, /*layerToMirror*/ 11);
+    setAlpha(12, 0.5f);
+    setFrameRate(121, 60.0f, ANATIVEWINDOW_FRAME_RATE_COMPATIBILITY_DEFAULT,
+                 ANATIVEWINDOW_CHANGE_FRAME_RATE_ONLY_IF_SEAMLESS);
+
+    LayerSnapshotBuilder recursiveBuilder;
+    LayerSnapshotBuilder flattenedBuilder;
+    LayerSnapshotBuilder parallelBuilder;
+
+    auto updateAndCompare = [&]() {
+        mHierarchyBuilder.update(mLifecycleManager);
+        LayerSnapshotBuilder::Args args{.root = mHierarchyBuilder.getHierarchy(),
+                                        .layerLifecycleManager = mLifecycleManager,
+                                        .includeMetadata = false,
+                                        .displays = mFrontEndDisplayInfos,
+                                        .globalShadowSettings = globalShadowSettings,
+                                        .supportsBlur = true,
+                                        .supportedLayerGenericMetadata = {},
+                                        .genericLayerMetadataKeyMap = {}};
+        recursiveBuilder.update(args);
+        args.flattenedRoot = &mHierarchyBuilder.getFlattenedHierarchy();
+        flattenedBuilder.update(args);
+        args.parallelUpdateMinLayers = 1;
+        parallelBuilder.update(args);
+        mLifecycleManager.commitChanges();
+
+        expectSameSnapshots(recursiveBuilder, flattenedBuilder);
+        expectSameSnapshots(recursiveBuilder, parallelBuilder);
+    };
+
+    updateAndCompare();
+    setAlpha(1, 0.25f);
+    setCrop(122, Rect(0, 0, 50, 50));
+    updateAndCompare();
+    setFlags(2, layer_state_t::eLayerHidden, layer_state_t::eLayerHidden);
+    updateAndCompare();
+}
+
+TEST_F(LayerSnapshotTest, skippingUnchangedSubtreesMatchesRecursiveUpdate) {
+    reparentRelativeLayer(13, 2);
+
+    LayerSnapshotBuilder recursiveBuilder;
+    LayerSnapshotBuilder flattenedBuilder;
+
+    auto updateAndCompare = [&]() {
+        mHierarchyBuilder.update(mLifecycleManager);
+        LayerSnapshotBuilder::Args args{.root = mHierarchyBuilder.getHierarchy(),
+                                        .layerLifecycleManager = mLifecycleManager,
+                                        .includeMetadata = false,
+                                        .displays = mFrontEndDisplayInfos,
+                                        .globalShadowSettings = globalShadowSettings,
+                                        .supportsBlur = true,
+                                        .supportedLayerGenericMetadata = {},
+                                        .genericLayerMetadataKeyMap = {}};
+        recursiveBuilder.update(args);
+        args.flattenedRoot = &mHierarchyBuilder.getFlattenedHierarchy();
+        flattenedBuilder.update(args);
+        mLifecycleManager.commitChanges();
+
+        expectSameSnapshots(recursiveBuilder, flattenedBuilder);
+    };
+
+    updateAndCompare();
+    // a change deep in one subtree
+    setCrop(1221, Rect(0, 0, 10, 10));
+    updateAndCompare();
+    // a frame rate vote which is merged into the ancestors
+    setFrameRate(1221, 60.0f, ANATIVEWINDOW_FRAME_RATE_COMPATIBILITY_DEFAULT,
+                 ANATIVEWINDOW_CHANGE_FRAME_RATE_ONLY_IF_SEAMLESS);
+    updateAndCompare();
+    // changes of the parent and of the relative parent of a relative layer
+    setAlpha(1, 0.5f);
+    updateAndCompare();
+    setFlags(2, layer_state_t::eLayerHidden, layer_state_t::eLayerHidden);
+    updateAndCompare();
+    // nothing changed
+    updateAndCompare();
+}
+
 } // namespace android::surfaceflinger::frontend
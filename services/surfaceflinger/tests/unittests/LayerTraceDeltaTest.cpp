@@ -0,0 +1,121 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <layerproto/LayerProtoHeader.h>
+
+#include "Tracing/LayerTraceDelta.h"
+
+namespace android {
+namespace {
+
+perfetto::protos::LayersSnapshotProto makeSnapshot(int64_t vsyncId,
+                                                   std::vector<std::pair<int32_t, float>> layers) {
+    perfetto::protos::LayersSnapshotProto snapshot;
+    snapshot.set_vsync_id(vsyncId);
+    for (const auto& [id, alpha] : layers) {
+        perfetto::protos::LayerProto* layer = snapshot.mutable_layers()->add_layers();
+        layer->set_id(id);
+        layer->set_name("layer" + std::to_string(id));
+        layer->mutable_color()->set_a(alpha);
+    }
+    return snapshot;
+}
+
+size_t strippedLayerCount(const perfetto::protos::LayersSnapshotProto& snapshot) {
+    size_t count = 0;
+    for (const auto& layer : snapshot.layers().layers()) {
+        count += LayersSnapshotDeltaDecoder::isStrippedLayer(layer) ? 1 : 0;
+    }
+    return count;
+}
+
+void expectEqual(const perfetto::protos::LayersSnapshotProto& expected,
+                 const perfetto::protos::LayersSnapshotProto& actual) {
+    EXPECT_EQ(expected.SerializeAsString(), actual.SerializeAsString());
+}
+
+TEST(LayerTraceDeltaTest, stripsUnchangedLayers) {
+    LayersSnapshotDeltaEncoder encoder;
+
+    auto keyframe = makeSnapshot(1, {{1, 1.f}, {2, 1.f}, {3, 1.f}});
+    encoder.encode(keyframe);
+    EXPECT_EQ(0u, strippedLayerCount(keyframe));
+
+    auto delta = makeSnapshot(2, {{1, 1.f}, {2, 0.5f}, {3, 1.f}});
+    encoder.encode(delta);
+    EXPECT_EQ(2u, strippedLayerCount(delta));
+    ASSERT_EQ(3, delta.layers().layers_size());
+    EXPECT_EQ(1, delta.layers().layers(0).id());
+    EXPECT_EQ("layer2", delta.layers().layers(1).name());
+    EXPECT_EQ(3, delta.layers().layers(2).id());
+}
+
+TEST(LayerTraceDeltaTest, writesPeriodicKeyframes) {
+    constexpr uint32_t kKeyframeInterval = 4;
+    LayersSnapshotDeltaEncoder encoder(kKeyframeInterval);
+
+    for (int64_t vsyncId = 0; vsyncId < 3 * kKeyframeInterval; vsyncId++) {
+        auto snapshot = makeSnapshot(vsyncId, {{1, 1.f}, {2, 1.f}});
+        encoder.encode(snapshot);
+        EXPECT_EQ(vsyncId % kKeyframeInterval == 0 ? 0u : 2u, strippedLayerCount(snapshot));
+    }
+
+    encoder.reset();
+    auto snapshot = makeSnapshot(100, {{1, 1.f}, {2, 1.f}});
+    encoder.encode(snapshot);
+    EXPECT_EQ(0u, strippedLayerCount(snapshot));
+}
+
+TEST(LayerTraceDeltaTest, restoresFullSnapshots) {
+    const std::vector<perfetto::protos::LayersSnapshotProto> snapshots = {
+            makeSnapshot(1, {{1, 1.f}, {2, 1.f}}),
+            makeSnapshot(2, {{1, 1.f}, {2, 0.5f}, {3, 1.f}}),
+            // Layer 2 is removed.
+            makeSnapshot(3, {{1, 1.f}, {3, 1.f}}),
+            makeSnapshot(4, {{1, 0.f}, {3, 1.f}}),
+    };
+
+    LayersSnapshotDeltaEncoder encoder;
+    perfetto::protos::LayersTraceFileProto traceFile;
+    for (auto snapshot : snapshots) {
+        encoder.encode(snapshot);
+        *traceFile.add_entry() = std::move(snapshot);
+    }
+    EXPECT_EQ(1u, strippedLayerCount(traceFile.entry(3)));
+
+    EXPECT_TRUE(LayersSnapshotDeltaDecoder::decode(traceFile));
+    ASSERT_EQ(static_cast<int>(snapshots.size()), traceFile.entry_size());
+    for (size_t i = 0; i < snapshots.size(); i++) {
+        expectEqual(snapshots[i], traceFile.entry(static_cast<int>(i)));
+    }
+}
+
+TEST(LayerTraceDeltaTest, reportsMissingKeyframe) {
+    LayersSnapshotDeltaEncoder encoder;
+    auto keyframe = makeSnapshot(1, {{1, 1.f}});
+    encoder.encode(keyframe);
+    auto delta = makeSnapshot(2, {{1, 1.f}});
+    encoder.encode(delta);
+
+    LayersSnapshotDeltaDecoder decoder;
+    EXPECT_FALSE(decoder.decode(delta));
+    EXPECT_EQ(1u, strippedLayerCount(delta));
+}
+
+} // namespace
+} // namespace android
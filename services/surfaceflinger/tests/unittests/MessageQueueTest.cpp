@@ -41,6 +41,7 @@ struct NoOpCompositor final : ICompositor {
                                          const scheduler::FrameTargeters&) override {
         return {};
     }
+    void finishPendingComposite() override {}
     void sample() override {}
     void sendNotifyExpectedPresentHint(PhysicalDisplayId) {}
 } gNoOpCompositor;
@@ -16,6 +16,8 @@
 #undef LOG_TAG
 #define LOG_TAG "SchedulerUnittests"
 
+#include <future>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <utils/Log.h>
@@ -262,6 +264,39 @@ TEST_F(OneShotTimerTest, noCallbacksAfterStopTest) {
     EXPECT_FALSE(mResetTimerCallback.waitForUnexpectedCall().has_value());
 }
 
+TEST_F(OneShotTimerTest, blockedCallbackOnlyHoldsUpItsService) {
+    TimerService blockingService("BlockingTimers");
+    std::promise<bool> entered;
+    std::promise<void> unblock;
+    std::shared_future<void> unblocked = unblock.get_future().share();
+    OneShotTimer blockingTimer(
+            "BlockingTimer", 1ms,
+            [&] {
+                entered.set_value(blockingService.isServiceThread());
+                unblocked.wait();
+            },
+            [] {}, std::make_unique<fake::FakeClock>(), blockingService);
+    blockingTimer.start();
+    auto enteredOnService = entered.get_future();
+    ASSERT_EQ(std::future_status::ready, enteredOnService.wait_for(1s));
+    EXPECT_TRUE(enteredOnService.get());
+
+    // The timers on the shared service keep running while the callback waits.
+    fake::FakeClock* clock = new fake::FakeClock();
+    mIdleTimer = std::make_unique<scheduler::OneShotTimer>("TestTimer", 1ms,
+                                                           mResetTimerCallback.getInvocable(),
+                                                           mExpiredTimerCallback.getInvocable(),
+                                                           std::unique_ptr<fake::FakeClock>(clock));
+    mIdleTimer->start();
+    EXPECT_TRUE(mResetTimerCallback.waitForCall().has_value());
+    clock->advanceTime(2ms);
+    EXPECT_TRUE(mExpiredTimerCallback.waitForCall().has_value());
+    mIdleTimer->stop();
+
+    unblock.set_value();
+    blockingTimer.stop();
+}
+
 } // namespace
 } // namespace scheduler
 } // namespace android
@@ -49,6 +49,9 @@ public:
     void setTimingTestingMode(bool testinMode);
     void allowReportActualToAcquireMutex();
     bool sessionExists();
+    Duration getCommitDuration() const;
+    Duration getCompositionDuration() const;
+    int getHeavyFrameTargetPercent() const;
 
 protected:
     TestableSurfaceFlinger mFlinger;
@@ -114,6 +117,18 @@ Duration PowerAdvisorTest::getFenceWaitDelayDuration(bool skipValidate) {
                          : PowerAdvisor::kFenceWaitStartDelayValidated);
 }
 
+Duration PowerAdvisorTest::getCommitDuration() const {
+    return mPowerAdvisor->mWorkBreakdown.commit;
+}
+
+Duration PowerAdvisorTest::getCompositionDuration() const {
+    return mPowerAdvisor->mWorkBreakdown.composition;
+}
+
+int PowerAdvisorTest::getHeavyFrameTargetPercent() const {
+    return PowerAdvisor::kHeavyFrameTargetPercent;
+}
+
 Duration PowerAdvisorTest::getErrorMargin() {
     return mPowerAdvisor->sTargetSafetyMargin;
 }
@@ -370,5 +385,74 @@ TEST_F(PowerAdvisorTest, hintSessionTestNotifyReportRace) {
     EXPECT_EQ(sessionExists(), false);
 }
 
+TEST_F(PowerAdvisorTest, hintSessionReportsWorkSplit) {
+    mPowerAdvisor->onBootFinished();
+    startPowerHintSession();
+
+    std::vector<DisplayId> displayIds{PhysicalDisplayId::fromPort(42u)};
+
+    // 60hz
+    const Duration vsyncPeriod{std::chrono::nanoseconds(1s) / 60};
+    const Duration commitDuration = 500us;
+    const Duration presentDuration = 5ms;
+    const Duration postCompDuration = 1ms;
+
+    TimePoint startTime{100ns};
+
+    // advisor only starts on frame 2 so do an initial no-op frame
+    fakeBasicFrameTiming(startTime, vsyncPeriod);
+    setExpectedTiming(vsyncPeriod, startTime + vsyncPeriod);
+    mPowerAdvisor->setDisplays(displayIds);
+    mPowerAdvisor->setSfPresentTiming(startTime, startTime + presentDuration);
+    mPowerAdvisor->setCompositeEnd(startTime + presentDuration + postCompDuration);
+
+    // increment the frame
+    startTime += vsyncPeriod;
+
+    // Without client composition, all of the work is on the cpu.
+    const Duration expectedDuration = getErrorMargin() + presentDuration + postCompDuration;
+    EXPECT_CALL(*mMockPowerHintSession,
+                reportActualWorkDuration(ElementsAre(
+                        AllOf(Field(&WorkDuration::durationNanos, Eq(expectedDuration.ns())),
+                              Field(&WorkDuration::cpuDurationNanos, Eq(expectedDuration.ns())),
+                              Field(&WorkDuration::gpuDurationNanos, Eq(0))))))
+            .Times(1)
+            .WillOnce(Return(testing::ByMove(ndk::ScopedAStatus::ok())));
+    fakeBasicFrameTiming(startTime, vsyncPeriod);
+    setExpectedTiming(vsyncPeriod, startTime + vsyncPeriod);
+    mPowerAdvisor->setDisplays(displayIds);
+    mPowerAdvisor->setCompositeStart(startTime + commitDuration);
+    mPowerAdvisor->setHwcValidateTiming(displayIds[0], startTime + 1ms, startTime + 1500us);
+    mPowerAdvisor->setHwcPresentTiming(displayIds[0], startTime + 2ms, startTime + 2500us);
+    mPowerAdvisor->setSfPresentTiming(startTime, startTime + presentDuration);
+    mPowerAdvisor->reportActualWorkDuration();
+
+    EXPECT_EQ(commitDuration, getCommitDuration());
+    EXPECT_EQ(2ms - commitDuration, getCompositionDuration());
+}
+
+TEST_F(PowerAdvisorTest, hintSessionLowersTargetAheadOfHeavyFrame) {
+    mPowerAdvisor->onBootFinished();
+    startPowerHintSession();
+
+    const Duration vsyncPeriod = 10ms;
+    const Duration heavyFrameTarget = vsyncPeriod * getHeavyFrameTargetPercent() / 100;
+
+    {
+        InSequence seq;
+        EXPECT_CALL(*mMockPowerHintSession, updateTargetWorkDuration(heavyFrameTarget.ns()))
+                .WillOnce(Return(testing::ByMove(ndk::ScopedAStatus::ok())));
+        EXPECT_CALL(*mMockPowerHintSession, updateTargetWorkDuration(vsyncPeriod.ns()))
+                .WillOnce(Return(testing::ByMove(ndk::ScopedAStatus::ok())));
+    }
+
+    mPowerAdvisor->notifyExpectedHeavyFrame();
+    mPowerAdvisor->updateTargetWorkDuration(vsyncPeriod);
+
+    // The regular target is restored on the next frame, and then not sent again.
+    mPowerAdvisor->updateTargetWorkDuration(vsyncPeriod);
+    mPowerAdvisor->updateTargetWorkDuration(vsyncPeriod);
+}
+
 } // namespace
 } // namespace android::Hwc2::impl
@@ -100,6 +100,8 @@ struct TestableRefreshRateSelector : RefreshRateSelector {
     const std::vector<Fps>& knownFrameRates() const { return mKnownFrameRates; }
 
     using RefreshRateSelector::GetRankedFrameRatesCache;
+    using RefreshRateSelector::getRankedFrameRatesSignature;
+    using RefreshRateSelector::kGetRankedFrameRatesCacheSize;
     auto& mutableGetRankedRefreshRatesCache() { return mGetRankedFrameRatesCache; }
 
     auto getRankedFrameRates(const std::vector<LayerRequirement>& layers,
@@ -2729,7 +2731,9 @@ TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_ReadsCache) {
                                                                   {90_Hz, kMode90}}},
                                                           GlobalSignals{.touch = true}};
 
-    selector.mutableGetRankedRefreshRatesCache() = {args, result};
+    selector.mutableGetRankedRefreshRatesCache() = {
+            {TestableRefreshRateSelector::getRankedFrameRatesSignature(args.first, args.second),
+             args, result}};
 
     EXPECT_EQ(result, selector.getRankedFrameRates(args.first, args.second));
 }
@@ -2737,7 +2741,7 @@ TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_ReadsCache) {
 TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_WritesCache) {
     auto selector = createSelector(kModes_30_60_72_90_120, kModeId60);
 
-    EXPECT_FALSE(selector.mutableGetRankedRefreshRatesCache());
+    EXPECT_TRUE(selector.mutableGetRankedRefreshRatesCache().empty());
 
     std::vector<LayerRequirement> layers = {{.weight = 1.f}, {.weight = 0.5f}};
     RefreshRateSelector::GlobalSignals globalSignals{.touch = true, .idle = true};
@@ -2745,10 +2749,43 @@ TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_WritesCache) {
     const auto result = selector.getRankedFrameRates(layers, globalSignals);
 
     const auto& cache = selector.mutableGetRankedRefreshRatesCache();
-    ASSERT_TRUE(cache);
+    ASSERT_EQ(cache.size(), 1u);
 
-    EXPECT_EQ(cache->arguments, std::make_pair(layers, globalSignals));
-    EXPECT_EQ(cache->result, result);
+    EXPECT_EQ(cache.front().arguments, std::make_pair(layers, globalSignals));
+    EXPECT_EQ(cache.front().result, result);
+}
+
+TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_KeepsRecentArgumentsInCache) {
+    auto selector = createSelector(kModes_30_60_72_90_120, kModeId60);
+
+    using GlobalSignals = RefreshRateSelector::GlobalSignals;
+    const std::vector<LayerRequirement> layers = {{.weight = 1.f}};
+    const auto touchResult = selector.getRankedFrameRates(layers, GlobalSignals{.touch = true});
+    const auto idleResult = selector.getRankedFrameRates(layers, GlobalSignals{.idle = true});
+
+    const auto& cache = selector.mutableGetRankedRefreshRatesCache();
+    ASSERT_EQ(cache.size(), 2u);
+    EXPECT_EQ(cache.front().arguments.second, GlobalSignals{.idle = true});
+
+    // Alternating arguments are both found in the cache.
+    EXPECT_EQ(touchResult, selector.getRankedFrameRates(layers, GlobalSignals{.touch = true}));
+    ASSERT_EQ(cache.size(), 2u);
+    EXPECT_EQ(cache.front().arguments.second, GlobalSignals{.touch = true});
+    EXPECT_EQ(idleResult, selector.getRankedFrameRates(layers, GlobalSignals{.idle = true}));
+    EXPECT_EQ(cache.size(), 2u);
+
+    // The least recently used arguments are evicted.
+    for (size_t i = 0; i < TestableRefreshRateSelector::kGetRankedFrameRatesCacheSize; i++) {
+        selector.getRankedFrameRates({{.weight = static_cast<float>(i + 2)}}, {});
+    }
+    EXPECT_EQ(cache.size(), TestableRefreshRateSelector::kGetRankedFrameRatesCacheSize);
+    EXPECT_TRUE(std::none_of(cache.begin(), cache.end(), [&](const auto& entry) {
+        return entry.arguments.first == layers;
+    }));
+
+    // Changing the display modes clears the cache.
+    selector.setActiveMode(kModeId90, 90_Hz);
+    EXPECT_TRUE(cache.empty());
 }
 
 TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_ExplicitExactTouchBoost) {
@@ -106,6 +106,26 @@ TEST_F(RegionSamplingTest, bounds_checking) {
                 testing::Eq(0.0));
 }
 
+TEST_F(RegionSamplingTest, scale_sample_area) {
+    const Point leftTop{100, 200};
+
+    EXPECT_EQ(Rect(0, 0, 8, 4), scaleSampleArea(Rect(100, 200, 108, 204), leftTop, 1));
+    EXPECT_EQ(Rect(0, 0, 2, 1), scaleSampleArea(Rect(100, 200, 108, 204), leftTop, 4));
+
+    // Partially covered pixels of the downscaled buffer are included.
+    EXPECT_EQ(Rect(0, 1, 3, 3), scaleSampleArea(Rect(102, 205, 109, 209), leftTop, 4));
+}
+
+TEST_F(RegionSamplingTest, calculate_mean_downscaled) {
+    std::fill(buffer.begin(), buffer.end(), kBlack);
+    std::fill(buffer.begin(), buffer.begin() + kStride, kWhite);
+
+    // With a downscale of 4, the first row of the buffer holds the first 4 rows of the region.
+    const Rect area = scaleSampleArea(Rect(0, 0, 8, 4), {0, 0}, 4);
+    EXPECT_THAT(sampleArea(buffer.data(), kWidth, kHeight, kStride, kOrientation, area),
+                testing::FloatEq(1.0f));
+}
+
 } // namespace android
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
@@ -510,6 +510,7 @@ TEST_F(SchedulerTest, onFrameSignalMultipleDisplays) {
             return results;
         }
 
+        void finishPendingComposite() override {}
         void sample() override {}
         void sendNotifyExpectedPresentHint(PhysicalDisplayId) override {}
     } compositor(*mScheduler);
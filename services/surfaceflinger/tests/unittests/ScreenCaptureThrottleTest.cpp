@@ -0,0 +1,85 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "ScreenCaptureThrottle.h"
+
+namespace android {
+namespace {
+
+TEST(ScreenCaptureThrottleTest, failsOnceMaxCapturesAreInFlight) {
+    ScreenCaptureThrottle throttle(2);
+
+    auto first = throttle.tryAcquire();
+    auto second = throttle.tryAcquire();
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(2u, throttle.getInFlightCount());
+    EXPECT_FALSE(throttle.tryAcquire());
+    EXPECT_EQ(2u, throttle.getInFlightCount());
+
+    // A capture completing makes room for the next one.
+    first.reset();
+    EXPECT_EQ(1u, throttle.getInFlightCount());
+    auto third = throttle.tryAcquire();
+    EXPECT_TRUE(third);
+    EXPECT_FALSE(throttle.tryAcquire());
+}
+
+TEST(ScreenCaptureThrottleTest, movedTokenReleasesOnce) {
+    ScreenCaptureThrottle throttle(1);
+    {
+        auto token = throttle.tryAcquire();
+        ASSERT_TRUE(token);
+        ScreenCaptureThrottle::Token moved = std::move(*token);
+        token.reset();
+        EXPECT_EQ(1u, throttle.getInFlightCount());
+    }
+    EXPECT_EQ(0u, throttle.getInFlightCount());
+}
+
+TEST(ScreenCaptureThrottleTest, neverExceedsMaxFromManyThreads) {
+    constexpr size_t kMaxInFlight = 3;
+    ScreenCaptureThrottle throttle(kMaxInFlight);
+    std::atomic<size_t> maxSeen = 0;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 1000; j++) {
+                if (auto token = throttle.tryAcquire()) {
+                    size_t inFlight = throttle.getInFlightCount();
+                    size_t seen = maxSeen.load();
+                    while (inFlight > seen && !maxSeen.compare_exchange_weak(seen, inFlight)) {
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_LE(maxSeen.load(), kMaxInFlight);
+    EXPECT_EQ(0u, throttle.getInFlightCount());
+}
+
+} // namespace
+} // namespace android
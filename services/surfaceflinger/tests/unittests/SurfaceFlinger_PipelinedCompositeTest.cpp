@@ -0,0 +1,122 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "SurfaceFlingerPipelinedCompositeTest"
+
+#include <mutex>
+#include <vector>
+
+#include <android-base/thread_annotations.h>
+#include <scheduler/FrameTargeter.h>
+#include <utils/Looper.h>
+
+#include "CommitAndCompositeTest.h"
+
+using namespace std::chrono_literals;
+
+namespace android {
+namespace {
+
+class PipelinedCompositeTest : public CommitAndCompositeTest {
+protected:
+    void SetUp() override {
+        CommitAndCompositeTest::SetUp();
+        mFlinger.mutablePipelinedComposite() = true;
+
+        // The composition thread posts the finish of its frame to the main thread, which the test
+        // stands in for.
+        ON_CALL(*mFlinger.scheduler(), postMessage)
+                .WillByDefault([this](sp<MessageHandler>&& handler) {
+                    std::scoped_lock lock(mMutex);
+                    mMessages.push_back(std::move(handler));
+                });
+    }
+
+    void TearDown() override {
+        mFlinger.finishPendingComposite();
+        handleMessages();
+    }
+
+    void beginFrame(VsyncId vsyncId, TimePoint frameTime) {
+        mTargeter.beginFrame({.frameBeginTime = frameTime,
+                              .vsyncId = vsyncId,
+                              .expectedVsyncTime = frameTime + kFrameDuration,
+                              .sfWorkDuration = kFrameDuration,
+                              .hwcMinWorkDuration = 0ms},
+                             *mFlinger.scheduler()->getVsyncSchedule());
+    }
+
+    void handleMessages() {
+        std::vector<sp<MessageHandler>> messages;
+        {
+            std::scoped_lock lock(mMutex);
+            messages.swap(mMessages);
+        }
+        for (const auto& handler : messages) {
+            handler->handleMessage(Message());
+        }
+    }
+
+    // Shorter than the VSYNC period, so each frame targets the VSYNC right after the one before.
+    static constexpr Duration kFrameDuration = 10ms;
+    static constexpr Period kVsyncPeriod =
+            Period::fromNs(FakeHwcDisplayInjector::DEFAULT_VSYNC_PERIOD);
+
+    scheduler::FrameTargeter mTargeter{DEFAULT_DISPLAY_ID,
+                                       scheduler::Feature::kBackpressureGpuComposition};
+
+    std::mutex mMutex;
+    std::vector<sp<MessageHandler>> mMessages GUARDED_BY(mMutex);
+};
+
+TEST_F(PipelinedCompositeTest, nextFrameSeesUnfinishedFrameAsPending) {
+    const TimePoint frameTime = scheduler::SchedulerClock::now();
+    beginFrame(VsyncId{1}, frameTime);
+    mFlinger.commitAndComposite(mTargeter);
+
+    // The next frame begins before the main thread has finished the frame.
+    beginFrame(VsyncId{2}, frameTime + kVsyncPeriod);
+    EXPECT_TRUE(mTargeter.target().isFramePending());
+    EXPECT_TRUE(mTargeter.target().didMissFrame());
+    EXPECT_EQ(mTargeter.target().presentFenceForPastVsync(kVsyncPeriod), FenceTime::NO_FENCE);
+
+    // Finishing the frame sets its present fence as that of the frame before the next one.
+    mFlinger.finishPendingComposite();
+    EXPECT_NE(mTargeter.target().presentFenceForPastVsync(kVsyncPeriod), FenceTime::NO_FENCE);
+    EXPECT_EQ(mTargeter.target().presentFenceForPastVsync(kVsyncPeriod),
+              mTargeter.target().presentFenceForPreviousFrame());
+}
+
+TEST_F(PipelinedCompositeTest, nextFrameSeesFinishedFrame) {
+    const TimePoint frameTime = scheduler::SchedulerClock::now();
+    beginFrame(VsyncId{1}, frameTime);
+    mFlinger.commitAndComposite(mTargeter);
+
+    // The frame is finished before the next frame begins.
+    mFlinger.finishPendingComposite();
+
+    const auto presentFence = mTargeter.target().presentFenceForPreviousFrame();
+    EXPECT_NE(presentFence, FenceTime::NO_FENCE);
+
+    beginFrame(VsyncId{2}, frameTime + kVsyncPeriod);
+    EXPECT_FALSE(mTargeter.target().isFramePending());
+    EXPECT_FALSE(mTargeter.target().didMissFrame());
+    EXPECT_EQ(mTargeter.target().presentFenceForPastVsync(kVsyncPeriod), presentFence);
+}
+
+} // namespace
+} // namespace android
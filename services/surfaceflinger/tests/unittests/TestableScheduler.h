@@ -207,6 +207,7 @@ private:
                                          const scheduler::FrameTargeters&) override {
         return {};
     }
+    void finishPendingComposite() override {}
     void sample() override {}
     void sendNotifyExpectedPresentHint(PhysicalDisplayId) override {}
 };
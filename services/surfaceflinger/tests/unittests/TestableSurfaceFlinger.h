@@ -381,20 +381,7 @@ public:
                                   .hwcMinWorkDuration = 10ms},
                                  *mScheduler->getVsyncSchedule());
 
-        scheduler::FrameTargets targets;
-        scheduler::FrameTargeters targeters;
-
-        for (const auto& [id, display] :
-             FTL_FAKE_GUARD(mFlinger->mStateLock, mFlinger->mPhysicalDisplays)) {
-            targets.try_emplace(id, &frameTargeter.target());
-            targeters.try_emplace(id, &frameTargeter);
-        }
-
-        mFlinger->commit(displayId, targets);
-
-        if (composite) {
-            mFlinger->composite(displayId, targeters);
-        }
+        commit(displayId, frameTargeter, composite);
     }
 
     void commit(TimePoint frameTime, VsyncId vsyncId, bool composite = false) {
@@ -416,6 +403,21 @@ public:
         commit(kComposite);
     }
 
+    // Commits and composites the frame that `frameTargeter` has begun, so that the test can begin
+    // the next frame on the same targeter.
+    void commitAndComposite(scheduler::FrameTargeter& frameTargeter) {
+        const auto displayIdOpt = mScheduler->pacesetterDisplayId();
+        LOG_ALWAYS_FATAL_IF(!displayIdOpt);
+
+        constexpr bool kComposite = true;
+        commit(*displayIdOpt, frameTargeter, kComposite);
+    }
+
+    void finishPendingComposite() {
+        ftl::FakeGuard guard(kMainThreadContext);
+        mFlinger->finishPendingComposite();
+    }
+
     auto createDisplay(const String8& displayName, bool secure, float requestedRefreshRate = 0.0f) {
         return mFlinger->createDisplay(displayName, secure, requestedRefreshRate);
     }
@@ -648,6 +650,7 @@ public:
     auto& mutablePendingHotplugEvents() { return mFlinger->mPendingHotplugEvents; }
     auto& mutableTransactionFlags() { return mFlinger->mTransactionFlags; }
     auto& mutableDebugDisableHWC() { return mFlinger->mDebugDisableHWC; }
+    auto& mutablePipelinedComposite() { return mFlinger->mPipelinedComposite; }
     auto& mutableMaxRenderTargetSize() { return mFlinger->mMaxRenderTargetSize; }
 
     auto& mutableHwcDisplayData() { return getHwComposer().mDisplayData; }
@@ -1103,6 +1106,26 @@ public:
     };
 
 private:
+    void commit(PhysicalDisplayId displayId, scheduler::FrameTargeter& frameTargeter,
+                bool composite) {
+        ftl::FakeGuard guard(kMainThreadContext);
+
+        scheduler::FrameTargets targets;
+        scheduler::FrameTargeters targeters;
+
+        for (const auto& [id, display] :
+             FTL_FAKE_GUARD(mFlinger->mStateLock, mFlinger->mPhysicalDisplays)) {
+            targets.try_emplace(id, &frameTargeter.target());
+            targeters.try_emplace(id, &frameTargeter);
+        }
+
+        mFlinger->commit(displayId, targets);
+
+        if (composite) {
+            mFlinger->composite(displayId, targeters);
+        }
+    }
+
     template <typename T>
     static std::unique_ptr<T> makeMock(bool useNiceMock) {
         return useNiceMock ? std::make_unique<testing::NiceMock<T>>() : std::make_unique<T>();
@@ -32,6 +32,7 @@
 
 #include <chrono>
 #include <random>
+#include <thread>
 #include <unordered_set>
 
 #include "libsurfaceflinger_unittest_main.h"
@@ -780,6 +781,57 @@ TEST_F(TimeStatsTest, canInsertUnorderedLayerTimeStats) {
     }
 }
 
+TEST_F(TimeStatsTest, mergesEventsOfThreadsInOrder) {
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    // Each timestamp is set by a thread of its own, so that consecutive events of a frame are
+    // queued into different shards.
+    for (uint64_t frameNumber = 1; frameNumber <= 3; frameNumber++) {
+        nsecs_t ts = frameNumber * 10000000;
+        for (TimeStamp type : NORMAL_SEQUENCE) {
+            std::thread([&] { setTimeStamp(type, LAYER_ID_0, frameNumber, ts, {}, kGameMode); })
+                    .join();
+            ts += 1000000;
+        }
+    }
+
+    SFTimeStatsGlobalProto globalProto;
+    ASSERT_TRUE(globalProto.ParseFromString(inputCommand(InputCommand::DUMP_ALL, FMT_PROTO)));
+
+    ASSERT_EQ(1, globalProto.stats_size());
+    EXPECT_EQ(2, globalProto.stats(0).total_frames());
+}
+
+TEST_F(TimeStatsTest, mergesEventsRecordedConcurrently) {
+    constexpr int32_t NUM_THREADS = 8;
+    constexpr uint64_t NUM_FRAMES = 100;
+
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    // Enough events to be merged by the merge thread while they are still being recorded.
+    std::vector<std::thread> threads;
+    for (int32_t layerId = 0; layerId < NUM_THREADS; layerId++) {
+        threads.emplace_back([this, layerId] {
+            for (uint64_t frameNumber = 1; frameNumber <= NUM_FRAMES; frameNumber++) {
+                insertTimeRecord(NORMAL_SEQUENCE, layerId, frameNumber, frameNumber * 10000000);
+                mTimeStats->incrementTotalFrames();
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    SFTimeStatsGlobalProto globalProto;
+    ASSERT_TRUE(globalProto.ParseFromString(inputCommand(InputCommand::DUMP_ALL, FMT_PROTO)));
+
+    EXPECT_EQ(NUM_THREADS * NUM_FRAMES, globalProto.total_frames());
+    ASSERT_EQ(NUM_THREADS, globalProto.stats_size());
+    for (const SFTimeStatsLayerProto& layerProto : globalProto.stats()) {
+        EXPECT_EQ(NUM_FRAMES - 1, layerProto.total_frames());
+    }
+}
+
 TEST_F(TimeStatsTest, recordRefreshRateNewConfigs) {
     EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
 
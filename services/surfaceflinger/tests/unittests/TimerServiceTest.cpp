@@ -0,0 +1,106 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "SchedulerUnittests"
+
+#include <gtest/gtest.h>
+#include <utils/Timers.h>
+
+#include <chrono>
+#include <thread>
+
+#include "AsyncCallRecorder.h"
+#include "Scheduler/TimerService.h"
+
+using namespace std::chrono_literals;
+
+namespace android::scheduler {
+namespace {
+
+class RecordingClient : public TimerService::Client {
+public:
+    void onTimerServiceWakeup() override {
+        mThreadId = std::this_thread::get_id();
+        mWakeup.recordCall();
+    }
+
+    AsyncCallRecorder<void (*)()> mWakeup;
+    std::thread::id mThreadId;
+};
+
+nsecs_t fromNow(std::chrono::nanoseconds delay) {
+    return systemTime(SYSTEM_TIME_MONOTONIC) + delay.count();
+}
+
+TEST(TimerServiceTest, wakesUpClientsOnSharedThread) {
+    TimerService service("TestTimer");
+    RecordingClient first;
+    RecordingClient second;
+
+    service.wakeUpAt(second, fromNow(2ms));
+    service.wakeUpAt(first, fromNow(1ms));
+
+    EXPECT_TRUE(first.mWakeup.waitForCall().has_value());
+    EXPECT_TRUE(second.mWakeup.waitForCall().has_value());
+    EXPECT_EQ(first.mThreadId, second.mThreadId);
+    EXPECT_NE(std::this_thread::get_id(), first.mThreadId);
+
+    // Each request is a single wakeup.
+    EXPECT_FALSE(first.mWakeup.waitForUnexpectedCall().has_value());
+    EXPECT_FALSE(second.mWakeup.waitForUnexpectedCall().has_value());
+}
+
+TEST(TimerServiceTest, keepsEarliestWakeup) {
+    TimerService service("TestTimer");
+    RecordingClient client;
+
+    service.wakeUpAt(client, fromNow(1ms));
+    service.wakeUpAt(client, fromNow(1s));
+
+    EXPECT_TRUE(client.mWakeup.waitForCall(100ms).has_value());
+    EXPECT_FALSE(client.mWakeup.waitForUnexpectedCall().has_value());
+}
+
+TEST(TimerServiceTest, cancelsWakeup) {
+    TimerService service("TestTimer");
+    RecordingClient cancelled;
+    RecordingClient client;
+
+    service.wakeUpAt(cancelled, fromNow(1ms));
+    service.wakeUpAt(client, fromNow(2ms));
+    service.cancel(cancelled);
+
+    EXPECT_TRUE(client.mWakeup.waitForCall().has_value());
+    EXPECT_FALSE(cancelled.mWakeup.waitForUnexpectedCall().has_value());
+}
+
+TEST(TimerServiceTest, coalescesWakeupsWithinSlack) {
+    TimerService service("TestTimer");
+    RecordingClient first;
+    RecordingClient second;
+
+    const nsecs_t wakeupTime = fromNow(5ms);
+    service.wakeUpAt(first, wakeupTime);
+    service.wakeUpAt(second, wakeupTime + TimerService::kSlack.count() / 2);
+
+    EXPECT_TRUE(first.mWakeup.waitForCall().has_value());
+    EXPECT_TRUE(second.mWakeup.waitForCall().has_value());
+    EXPECT_LT(systemTime(SYSTEM_TIME_MONOTONIC) - wakeupTime, 1'000'000'000);
+}
+
+} // namespace
+} // namespace android::scheduler
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <vector>
+
+#include "BackgroundExecutor.h"
+#include "TransactionCallbackInvoker.h"
+
+namespace android {
+namespace {
+
+// Records the calls, which the invoker makes directly since the listener is in the same process.
+class FakeTransactionCompletedListener : public BnTransactionCompletedListener {
+public:
+    void onTransactionCompleted(ListenerStats stats) override {
+        std::scoped_lock lock(mMutex);
+        mCompleted.push_back(std::move(stats));
+    }
+    void onReleaseBuffer(ReleaseCallbackId, sp<Fence>, uint32_t) override {
+        std::scoped_lock lock(mMutex);
+        mReleaseBufferCallCount++;
+    }
+    void onTransactionQueueStalled(const String8&) override {}
+    void onTrustedPresentationChanged(int, bool) override {}
+    void onBufferEvicted(uint64_t) override {}
+
+    std::vector<ListenerStats> takeCompleted() {
+        std::scoped_lock lock(mMutex);
+        std::vector<ListenerStats> completed;
+        completed.swap(mCompleted);
+        return completed;
+    }
+    size_t getReleaseBufferCallCount() {
+        std::scoped_lock lock(mMutex);
+        return mReleaseBufferCallCount;
+    }
+
+private:
+    std::mutex mMutex;
+    std::vector<ListenerStats> mCompleted;
+    size_t mReleaseBufferCallCount = 0;
+};
+
+class TransactionCallbackInvokerTest : public testing::Test {
+protected:
+    // Waits for the callbacks to be sent, since they are sent off the calling thread.
+    std::vector<ListenerStats> sendCallbacks(bool onCommitOnly) {
+        mInvoker.sendCallbacks(onCommitOnly);
+        BackgroundExecutor::getInstance().flushQueue();
+        return mListener->takeCompleted();
+    }
+
+    void addTransaction(CallbackId::Type type) {
+        mInvoker.addEmptyTransaction(ListenerCallbacks(IInterface::asBinder(mListener),
+                                                       std::vector<CallbackId>{{1, type}}));
+    }
+
+    TransactionCallbackInvoker mInvoker;
+    sp<FakeTransactionCompletedListener> mListener =
+            sp<FakeTransactionCompletedListener>::make();
+};
+
+TEST_F(TransactionCallbackInvokerTest, sendsReleasedBuffersWithTransactionStats) {
+    addTransaction(CallbackId::Type::ON_COMPLETE);
+    mInvoker.addReleasedBuffer(mListener, {1, 2}, Fence::NO_FENCE, 3);
+    mInvoker.addReleasedBuffer(mListener, {4, 5}, nullptr, 3);
+
+    const std::vector<ListenerStats> completed = sendCallbacks(false);
+    ASSERT_EQ(1u, completed.size());
+    EXPECT_EQ(1u, completed[0].transactionStats.size());
+    ASSERT_EQ(2u, completed[0].releasedBuffers.size());
+    EXPECT_EQ(ReleaseCallbackId(1, 2), completed[0].releasedBuffers[0].callbackId);
+    EXPECT_EQ(ReleaseCallbackId(4, 5), completed[0].releasedBuffers[1].callbackId);
+    EXPECT_EQ(Fence::NO_FENCE, completed[0].releasedBuffers[1].releaseFence);
+    EXPECT_EQ(0u, mListener->getReleaseBufferCallCount());
+}
+
+TEST_F(TransactionCallbackInvokerTest, sendsReleasedBuffersWithoutTransactionStats) {
+    mInvoker.addReleasedBuffer(mListener, {1, 2}, Fence::NO_FENCE, 3);
+
+    const std::vector<ListenerStats> completed = sendCallbacks(false);
+    ASSERT_EQ(1u, completed.size());
+    EXPECT_TRUE(completed[0].transactionStats.empty());
+    EXPECT_EQ(1u, completed[0].releasedBuffers.size());
+}
+
+TEST_F(TransactionCallbackInvokerTest, sendsReleasedBuffersOnCommit) {
+    addTransaction(CallbackId::Type::ON_COMPLETE);
+    mInvoker.addReleasedBuffer(mListener, {1, 2}, Fence::NO_FENCE, 3);
+
+    // The transaction waits for the present, but the release does not.
+    std::vector<ListenerStats> completed = sendCallbacks(true);
+    ASSERT_EQ(1u, completed.size());
+    EXPECT_TRUE(completed[0].transactionStats.empty());
+    EXPECT_EQ(1u, completed[0].releasedBuffers.size());
+
+    completed = sendCallbacks(false);
+    ASSERT_EQ(1u, completed.size());
+    EXPECT_EQ(1u, completed[0].transactionStats.size());
+    EXPECT_TRUE(completed[0].releasedBuffers.empty());
+}
+
+TEST_F(TransactionCallbackInvokerTest, sendsReleasedBuffersOnce) {
+    mInvoker.addReleasedBuffer(mListener, {1, 2}, Fence::NO_FENCE, 3);
+    EXPECT_EQ(1u, sendCallbacks(false).size());
+
+    mInvoker.clearCompletedTransactions();
+    EXPECT_TRUE(sendCallbacks(false).empty());
+}
+
+TEST_F(TransactionCallbackInvokerTest, sendReleasedBuffersOnlySendsReleases) {
+    addTransaction(CallbackId::Type::ON_COMPLETE);
+    mInvoker.addReleasedBuffer(mListener, {1, 2}, Fence::NO_FENCE, 3);
+
+    mInvoker.sendReleasedBuffers();
+    BackgroundExecutor::getInstance().flushQueue();
+    std::vector<ListenerStats> completed = mListener->takeCompleted();
+    ASSERT_EQ(1u, completed.size());
+    EXPECT_TRUE(completed[0].transactionStats.empty());
+    EXPECT_EQ(1u, completed[0].releasedBuffers.size());
+
+    completed = sendCallbacks(false);
+    ASSERT_EQ(1u, completed.size());
+    EXPECT_EQ(1u, completed[0].transactionStats.size());
+    EXPECT_TRUE(completed[0].releasedBuffers.empty());
+}
+
+} // namespace
+} // namespace android
@@ -515,6 +515,51 @@ public:
         // There shouldn't be any pending classifications. Everything should have been cleared.
         EXPECT_EQ(0u, layer->mPendingJankClassifications.size());
     }
+
+    // Returns the handle of a transaction which replaced the buffer {1, 1} of the layer.
+    sp<CallbackHandle> addReleasePreviousBufferHandle(Layer* layer) {
+        const sp<IBinder> listener = sp<BBinder>::make();
+        auto handle = sp<CallbackHandle>::make(listener, std::vector<CallbackId>(), nullptr);
+        handle->releasePreviousBuffer = true;
+        layer->mDrawingState.callbackHandles.push_back(handle);
+        layer->mPreviousReleaseCallbackId = {1, 1};
+        layer->mPreviousReleaseBufferEndpoint = listener;
+        return handle;
+    }
+
+    void PreviousBufferReleasedEarly() {
+        sp<Layer> layer = createLayer();
+        const auto handle = addReleasePreviousBufferHandle(layer.get());
+
+        layer->onLayerDisplayed(ftl::yield<FenceResult>(Fence::NO_FENCE).share(),
+                                ui::DEFAULT_LAYER_STACK);
+        EXPECT_TRUE(layer->releasePreviousBufferEarly());
+
+        // The callbacks of the frame don't release the buffer again.
+        EXPECT_FALSE(handle->releasePreviousBuffer);
+        EXPECT_EQ(ReleaseCallbackId::INVALID_ID, handle->previousReleaseCallbackId);
+        EXPECT_TRUE(handle->previousReleaseFences.empty());
+        EXPECT_FALSE(layer->releasePreviousBufferEarly());
+
+        layer->releasePendingBuffer(25);
+        EXPECT_EQ(ReleaseCallbackId::INVALID_ID, handle->previousReleaseCallbackId);
+    }
+
+    void PreviousBufferOnSeveralDisplaysNotReleasedEarly() {
+        sp<Layer> layer = createLayer();
+        const auto handle = addReleasePreviousBufferHandle(layer.get());
+
+        layer->onLayerDisplayed(ftl::yield<FenceResult>(Fence::NO_FENCE).share(),
+                                ui::DEFAULT_LAYER_STACK);
+        layer->onLayerDisplayed(ftl::yield<FenceResult>(Fence::NO_FENCE).share(),
+                                ui::LayerStack::fromValue(1));
+        EXPECT_FALSE(layer->releasePreviousBufferEarly());
+
+        EXPECT_TRUE(handle->releasePreviousBuffer);
+        EXPECT_EQ(2u, handle->previousReleaseFences.size());
+        layer->releasePendingBuffer(25);
+        EXPECT_EQ(layer->mPreviousReleaseCallbackId, handle->previousReleaseCallbackId);
+    }
 };
 
 TEST_F(TransactionSurfaceFrameTest, PresentedBufferlessSurfaceFrame) {
@@ -554,4 +599,12 @@ TEST_F(TransactionSurfaceFrameTest, MultipleCommitsBeforeLatch) {
     MultipleCommitsBeforeLatch();
 }
 
+TEST_F(TransactionSurfaceFrameTest, PreviousBufferReleasedEarly) {
+    PreviousBufferReleasedEarly();
+}
+
+TEST_F(TransactionSurfaceFrameTest, PreviousBufferOnSeveralDisplaysNotReleasedEarly) {
+    PreviousBufferOnSeveralDisplaysNotReleasedEarly();
+}
+
 } // namespace android
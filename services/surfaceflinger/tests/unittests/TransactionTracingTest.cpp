@@ -38,6 +38,7 @@ protected:
 
     void flush() { mTracing.flush(); }
     perfetto::protos::TransactionTraceFile writeToProto() { return mTracing.writeToProto(); }
+    uint64_t getDroppedTransactionCount() const { return mTracing.mDroppedTransactionCount; }
 
     perfetto::protos::TransactionTraceEntry bufferFront() {
         std::scoped_lock<std::mutex> lock(mTracing.mTraceLock);
@@ -123,6 +124,38 @@ TEST_F(TransactionTracingTest, addTransactions) {
     verifyEntry(proto.entry(1), secondUpdate.transactions, secondTransactionSetVsyncId);
 }
 
+TEST_F(TransactionTracingTest, dropsTransactionsWhenQueueIsFull) {
+    constexpr size_t kDroppedCount = 10;
+    std::vector<TransactionState> transactions;
+    transactions.reserve(TransactionTracing::MAX_QUEUED_TRANSACTIONS + kDroppedCount);
+    for (uint64_t i = 0; i < TransactionTracing::MAX_QUEUED_TRANSACTIONS + kDroppedCount; i++) {
+        TransactionState transaction;
+        transaction.id = i;
+        transaction.originPid = static_cast<int32_t>(i);
+        transactions.emplace_back(transaction);
+        mTracing.addQueuedTransaction(transaction);
+    }
+    EXPECT_EQ(kDroppedCount, getDroppedTransactionCount());
+
+    // The transactions which were queued before the queue filled up are still traced.
+    int64_t vsyncId = 42;
+    frontend::Update update;
+    update.transactions = std::vector<TransactionState>(transactions.begin(),
+                                                        transactions.begin() +
+                                                                TransactionTracing::
+                                                                        MAX_QUEUED_TRANSACTIONS);
+    mTracing.addCommittedTransactions(vsyncId, 0, update, {}, false);
+    flush();
+
+    perfetto::protos::TransactionTraceFile proto = writeToProto();
+    ASSERT_EQ(proto.entry().size(), 1);
+    verifyEntry(proto.entry(0), update.transactions, vsyncId);
+
+    // Draining the queue makes room for new transactions.
+    queueAndCommitTransaction(++vsyncId);
+    EXPECT_EQ(kDroppedCount, getDroppedTransactionCount());
+}
+
 class TransactionTracingLayerHandlingTest : public TransactionTracingTest {
 protected:
     void SetUp() override {
@@ -209,4 +209,64 @@ TEST_F(VsyncModulatorTest, EarlyStartWithBinderDeath) {
     CHECK_COMMIT(std::nullopt, kLate);
 }
 
+TEST_F(VsyncModulatorTest, AdaptiveWorkDuration) {
+    using namespace std::chrono_literals;
+
+    const VsyncConfig late{0, 0, 16ms, 16ms};
+    const VsyncConfig early{0, 0, 20ms, 16ms};
+    const VsyncConfigSet offsets = {early, early, late, 0ns};
+    EXPECT_EQ(late, mVsyncModulator->setVsyncConfigSet(offsets));
+    EXPECT_EQ(late, mVsyncModulator->setAdaptiveWorkDuration(true));
+
+    constexpr PhysicalDisplayId kDisplayId = PhysicalDisplayId::fromPort(1u);
+    constexpr PhysicalDisplayId kOtherDisplayId = PhysicalDisplayId::fromPort(2u);
+    constexpr auto kMargin = VsyncModulator::kAdaptiveWorkDurationMargin;
+
+    // The fixed duration is kept until there are enough frames to predict from.
+    for (size_t i = 1; i < WorkDurationPredictor::kMinFrames; i++) {
+        EXPECT_FALSE(mVsyncModulator->onFrameWorkDuration(kDisplayId, 10ms));
+    }
+
+    // Light frames move the wakeup later.
+    auto config = mVsyncModulator->onFrameWorkDuration(kDisplayId, 10ms);
+    ASSERT_TRUE(config);
+    EXPECT_EQ(10ms + kMargin, config->sfWorkDuration);
+    EXPECT_EQ(late.appWorkDuration, config->appWorkDuration);
+    EXPECT_EQ(*config, mVsyncModulator->getVsyncConfig());
+
+    // Small changes are filtered out.
+    EXPECT_FALSE(mVsyncModulator->onFrameWorkDuration(kDisplayId, 10200us));
+
+    // A display without enough frames does not replace the prediction.
+    EXPECT_FALSE(mVsyncModulator->onFrameWorkDuration(kOtherDisplayId, 1ms));
+
+    // Very light frames are bounded by half the fixed duration.
+    for (size_t i = 0; i < WorkDurationPredictor::kHistorySize; i++) {
+        static_cast<void>(mVsyncModulator->onFrameWorkDuration(kDisplayId, 1ms));
+    }
+    EXPECT_EQ(8ms, mVsyncModulator->getVsyncConfig().sfWorkDuration);
+
+    // Heavy frames move the wakeup earlier, up to the longest of the configs.
+    for (size_t i = 0; i < WorkDurationPredictor::kHistorySize; i++) {
+        static_cast<void>(mVsyncModulator->onFrameWorkDuration(kDisplayId, 30ms));
+    }
+    EXPECT_EQ(20ms, mVsyncModulator->getVsyncConfig().sfWorkDuration);
+
+    // Early offsets are not adapted, but the prediction is applied on return to late offsets.
+    const auto token = sp<BBinder>::make();
+    EXPECT_EQ(early, mVsyncModulator->setTransactionSchedule(Schedule::EarlyStart, token));
+    for (size_t i = 0; i < WorkDurationPredictor::kHistorySize; i++) {
+        EXPECT_FALSE(mVsyncModulator->onFrameWorkDuration(kDisplayId, 12ms));
+    }
+    EXPECT_EQ(early, mVsyncModulator->getVsyncConfig());
+
+    mVsyncModulator->binderDied(token);
+    const auto sfWorkDuration = mVsyncModulator->getVsyncConfig().sfWorkDuration;
+    EXPECT_GE(sfWorkDuration, 12ms + kMargin - VsyncModulator::kAdaptiveWorkDurationHysteresis);
+    EXPECT_LE(sfWorkDuration, 13ms + kMargin);
+
+    EXPECT_EQ(late, mVsyncModulator->setAdaptiveWorkDuration(false));
+    EXPECT_FALSE(mVsyncModulator->onFrameWorkDuration(kDisplayId, 12ms));
+}
+
 } // namespace android::scheduler
@@ -245,6 +245,50 @@ TEST_F(WindowInfosListenerInvokerTest, noListeners) {
     EXPECT_EQ(callCount, 1);
 }
 
+// Test that a listener which received the previous update only gets the windows which changed.
+TEST_F(WindowInfosListenerInvokerTest, sendsDeltas) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<gui::WindowInfosUpdate> updates;
+
+    gui::WindowInfosListenerInfo listenerInfo;
+    mInvoker->addWindowInfosListener(sp<Listener>::make([&](const gui::WindowInfosUpdate& update) {
+                                         std::scoped_lock lock{mutex};
+                                         updates.push_back(update);
+                                         cv.notify_one();
+
+                                         listenerInfo.windowInfosPublisher
+                                                 ->ackWindowInfosReceived(update.vsyncId,
+                                                                          listenerInfo.listenerId);
+                                     }),
+                                     &listenerInfo);
+
+    gui::WindowInfo first;
+    first.id = 1;
+    first.name = "first";
+    gui::WindowInfo second;
+    second.id = 2;
+    second.name = "second";
+    BackgroundExecutor::getInstance().sendCallbacks({[&]() {
+        mInvoker->windowInfosChanged(gui::WindowInfosUpdate{{first, second}, {}, 0, 0}, {}, true);
+        second.name = "second, renamed";
+        mInvoker->windowInfosChanged(gui::WindowInfosUpdate{{first, second}, {}, 1, 0}, {}, true);
+    }});
+
+    std::unique_lock lock{mutex};
+    cv.wait(lock, [&]() { return updates.size() == 2; });
+    EXPECT_FALSE(updates[0].isDelta());
+    EXPECT_EQ(2u, updates[0].windowInfos.size());
+    ASSERT_TRUE(updates[1].isDelta());
+    EXPECT_EQ(updates[0].generation, updates[1].baseGeneration);
+    ASSERT_EQ(1u, updates[1].windowInfos.size());
+    EXPECT_EQ("second, renamed", updates[1].windowInfos[0].name);
+
+    auto applied = updates[0].applyDelta(updates[1]);
+    ASSERT_TRUE(applied.has_value());
+    EXPECT_EQ(2u, applied->windowInfos.size());
+}
+
 // Test that WindowInfosListenerInvoker#removeWindowInfosListener acks any unacked messages for
 // the removed listener.
 TEST_F(WindowInfosListenerInvokerTest, removeListenerAcks) {
@@ -68,7 +68,8 @@ public:
     MOCK_METHOD(hal::Error, present, (android::sp<android::Fence> *), (override));
     MOCK_METHOD(hal::Error, setClientTarget,
                 (uint32_t, const android::sp<android::GraphicBuffer>&,
-                 const android::sp<android::Fence>&, hal::Dataspace, float),
+                 const android::sp<android::Fence>&, hal::Dataspace, float,
+                 const android::Region&),
                 (override));
     MOCK_METHOD(hal::Error, setColorMode, (hal::ColorMode, hal::RenderIntent), (override));
     MOCK_METHOD(hal::Error, setColorTransform, (const android::mat4 &), (override));
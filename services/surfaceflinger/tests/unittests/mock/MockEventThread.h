@@ -56,6 +56,8 @@ public:
     MOCK_METHOD(void, requestNextVsync, (const sp<android::EventThreadConnection>&), (override));
     MOCK_METHOD(VsyncEventData, getLatestVsyncEventData,
                 (const sp<android::EventThreadConnection>&), (const, override));
+    MOCK_METHOD(status_t, createSharedVsyncChannel,
+                (const sp<android::EventThreadConnection>&, gui::SharedVsyncChannel*), (override));
     MOCK_METHOD(void, requestLatestConfig, (const sp<android::EventThreadConnection>&));
     MOCK_METHOD(void, pauseVsyncCallback, (bool));
     MOCK_METHOD(void, onNewVsyncSchedule, (std::shared_ptr<scheduler::VsyncSchedule>), (override));
@@ -14,9 +14,20 @@
  * limitations under the License.
  */
 
+#define LOG_TAG "VibratorCallbackScheduler"
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
+#include <utils/Log.h>
+
 #include <vibratorservice/VibratorCallbackScheduler.h>
 
 namespace android {
@@ -54,47 +65,77 @@ CallbackScheduler::~CallbackScheduler() {
     {
         std::lock_guard<std::mutex> lock(mMutex);
         mFinished = true;
+        if (mTimerFd.ok()) {
+            // Wake up the callback thread right away.
+            setTimer(std::chrono::time_point<std::chrono::steady_clock>(
+                    std::chrono::nanoseconds(1)));
+        }
     }
-    mCondition.notify_all();
     if (mCallbackThread && mCallbackThread->joinable()) {
         mCallbackThread->join();
     }
 }
 
 void CallbackScheduler::schedule(std::function<void()> callback, std::chrono::milliseconds delay) {
-    {
-        std::lock_guard<std::mutex> lock(mMutex);
-        if (mCallbackThread == nullptr) {
-            mCallbackThread = std::make_unique<std::thread>(&CallbackScheduler::loop, this);
-        }
-        mQueue.emplace(DelayedCallback(callback, delay));
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mCallbackThread == nullptr) {
+        mTimerFd.reset(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC));
+        LOG_ALWAYS_FATAL_IF(!mTimerFd.ok(), "Failed to create callback timer: %s",
+                            strerror(errno));
+        mQueue.reserve(INITIAL_CAPACITY);
+        mCallbackThread = std::make_unique<std::thread>(&CallbackScheduler::loop, this);
+    }
+    const auto expiration = mQueue.emplace_back(std::move(callback), delay).getExpiration();
+    std::push_heap(mQueue.begin(), mQueue.end(), std::greater<DelayedCallback>());
+    if (mQueue.front().getExpiration() == expiration) {
+        // The new callback expires first.
+        updateTimerLocked();
+    }
+}
+
+void CallbackScheduler::updateTimerLocked() {
+    setTimer(mQueue.empty() ? std::chrono::time_point<std::chrono::steady_clock>()
+                            : mQueue.front().getExpiration());
+}
+
+void CallbackScheduler::setTimer(std::chrono::time_point<std::chrono::steady_clock> expiration) {
+    // The steady clock is CLOCK_MONOTONIC, so the expiration can be used as an absolute time of the
+    // timer. A zero expiration disarms it.
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            expiration.time_since_epoch())
+                            .count();
+    itimerspec spec = {};
+    spec.it_value.tv_sec = ns / 1'000'000'000;
+    spec.it_value.tv_nsec = ns % 1'000'000'000;
+    if (timerfd_settime(mTimerFd.get(), TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+        ALOGE("Failed to set callback timer: %s", strerror(errno));
     }
-    mCondition.notify_all();
 }
 
 void CallbackScheduler::loop() {
+    pthread_setname_np(pthread_self(), "VibratorCallback");
     while (true) {
-        std::unique_lock<std::mutex> lock(mMutex);
-        if (mFinished) {
-            // Destructor was called, so let the callback thread die.
-            break;
+        // Wait until the next callback expires, or the destructor is called.
+        uint64_t expirations;
+        if (TEMP_FAILURE_RETRY(read(mTimerFd.get(), &expirations, sizeof(expirations))) < 0) {
+            ALOGE("Failed to wait for callback timer: %s", strerror(errno));
         }
-        while (!mQueue.empty() && mQueue.top().isExpired()) {
-            DelayedCallback callback = mQueue.top();
-            mQueue.pop();
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mFinished && !mQueue.empty() && mQueue.front().isExpired()) {
+            std::pop_heap(mQueue.begin(), mQueue.end(), std::greater<DelayedCallback>());
+            DelayedCallback callback = std::move(mQueue.back());
+            mQueue.pop_back();
             lock.unlock();
             callback.run();
             lock.lock();
         }
-        if (mQueue.empty()) {
-            // Wait until a new callback is scheduled.
-            mCondition.wait(mMutex);
-        } else {
-            // Wait until next callback expires, or a new one is scheduled.
-            // Use the monotonic steady clock to wait for the measured delay interval via wait_for
-            // instead of using a wall clock via wait_until.
-            mCondition.wait_for(mMutex, mQueue.top().getWaitForExpirationDuration());
+        if (mFinished) {
+            // Destructor was called, so let the callback thread die. Do not rearm the timer, which
+            // would override the wake up of the destructor.
+            break;
         }
+        updateTimerLocked();
     }
 }
 
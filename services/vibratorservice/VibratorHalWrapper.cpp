@@ -118,6 +118,35 @@ HalResult<Capabilities> HalWrapper::getCapabilities() {
 
 HalResult<std::vector<milliseconds>> HalWrapper::getPrimitiveDurations() {
     std::lock_guard<std::mutex> lock(mInfoMutex);
+    return getPrimitiveDurationsLocked();
+}
+
+milliseconds HalWrapper::getComposedEffectDuration(const std::vector<CompositeEffect>& primitives) {
+    std::lock_guard<std::mutex> lock(mInfoMutex);
+    const auto& durationsResult = getPrimitiveDurationsLocked();
+    static const std::vector<milliseconds> sNoDurations;
+    const auto& durations = durationsResult.isOk() ? durationsResult.value() : sNoDurations;
+
+    milliseconds duration(0);
+    for (const auto& effect : primitives) {
+        auto primitiveIdx = static_cast<size_t>(effect.primitive);
+        if (primitiveIdx < durations.size()) {
+            duration += durations[primitiveIdx];
+        } else {
+            // Make sure the returned duration is positive to indicate successful vibration.
+            duration += milliseconds(1);
+        }
+        duration += milliseconds(effect.delayMs);
+    }
+    return duration;
+}
+
+void HalWrapper::invalidateInfoCache() {
+    std::lock_guard<std::mutex> lock(mInfoMutex);
+    mInfoCache = InfoCache();
+}
+
+const HalResult<std::vector<milliseconds>>& HalWrapper::getPrimitiveDurationsLocked() {
     if (mInfoCache.mSupportedPrimitives.isFailed()) {
         mInfoCache.mSupportedPrimitives = getSupportedPrimitivesInternal();
         if (mInfoCache.mSupportedPrimitives.isUnsupported()) {
@@ -210,8 +239,16 @@ void AidlHalWrapper::tryReconnect() {
     }
     sp<Aidl::IVibrator> newHandle = result.value();
     if (newHandle) {
-        std::lock_guard<std::mutex> lock(mHandleMutex);
-        mHandle = std::move(newHandle);
+        bool reconnected;
+        {
+            std::lock_guard<std::mutex> lock(mHandleMutex);
+            reconnected = IInterface::asBinder(newHandle) != IInterface::asBinder(mHandle);
+            mHandle = std::move(newHandle);
+        }
+        if (reconnected) {
+            // The info of the previous HAL instance no longer applies.
+            invalidateInfoCache();
+        }
     }
 }
 
@@ -274,20 +311,7 @@ HalResult<milliseconds> AidlHalWrapper::performComposedEffect(
         const std::function<void()>& completionCallback) {
     // This method should always support callbacks, so no need to double check.
     auto cb = new HalCallbackWrapper(completionCallback);
-
-    auto durations = getPrimitiveDurations().valueOr({});
-    milliseconds duration(0);
-    for (const auto& effect : primitives) {
-        auto primitiveIdx = static_cast<size_t>(effect.primitive);
-        if (primitiveIdx < durations.size()) {
-            duration += durations[primitiveIdx];
-        } else {
-            // Make sure the returned duration is positive to indicate successful vibration.
-            duration += milliseconds(1);
-        }
-        duration += milliseconds(effect.delayMs);
-    }
-
+    milliseconds duration = getComposedEffectDuration(primitives);
     return HalResultFactory::fromStatus<milliseconds>(getHal()->compose(primitives, cb), duration);
 }
 
@@ -428,8 +452,16 @@ template <typename I>
 void HidlHalWrapper<I>::tryReconnect() {
     sp<I> newHandle = I::tryGetService();
     if (newHandle) {
-        std::lock_guard<std::mutex> lock(mHandleMutex);
-        mHandle = std::move(newHandle);
+        bool reconnected;
+        {
+            std::lock_guard<std::mutex> lock(mHandleMutex);
+            reconnected = newHandle != mHandle;
+            mHandle = std::move(newHandle);
+        }
+        if (reconnected) {
+            // The info of the previous HAL instance no longer applies.
+            invalidateInfoCache();
+        }
     }
 }
 
@@ -16,9 +16,14 @@
 
 #define LOG_TAG "VibratorHalControllerBenchmarks"
 
+#include <android-base/thread_annotations.h>
 #include <benchmark/benchmark.h>
+#include <vibratorservice/VibratorCallbackScheduler.h>
 #include <vibratorservice/VibratorHalController.h>
 
+#include <condition_variable>
+#include <mutex>
+
 using ::android::enum_range;
 using ::android::hardware::vibrator::CompositeEffect;
 using ::android::hardware::vibrator::CompositePrimitive;
@@ -415,6 +420,8 @@ BENCHMARK_WRAPPER(VibratorEffectsBench, performEffect, {
 
 class VibratorPrimitivesBench : public VibratorBench {
 public:
+    static constexpr int32_t kComposedEffectSequenceSize = 8;
+
     static void DefaultArgs(Benchmark* b) {
         vibrator::HalController controller;
         auto primitivesResult = controller.getInfo().supportedPrimitives;
@@ -480,4 +487,88 @@ BENCHMARK_WRAPPER(VibratorPrimitivesBench, performComposedEffect, {
     }
 });
 
+BENCHMARK_WRAPPER(VibratorPrimitivesBench, performComposedEffectSequence, {
+    if (!hasCapabilities(vibrator::Capabilities::COMPOSE_EFFECTS, state)) {
+        state.SkipWithMessage("missing capability");
+        return;
+    }
+    if (!hasArgs(state)) {
+        state.SkipWithMessage("missing args");
+        return;
+    }
+
+    auto compositionSizeMax = mController.getInfo().compositionSizeMax;
+    if (!checkHalResult(compositionSizeMax, state)) {
+        return;
+    }
+
+    // Short primitives played in a row, like the haptic feedback of fast typing.
+    CompositeEffect effect;
+    effect.primitive = getPrimitive(state);
+    effect.scale = 0.5f;
+    effect.delayMs = static_cast<int32_t>(0);
+
+    std::vector<CompositeEffect> effects(
+            std::clamp(compositionSizeMax.valueOr(1), 1, kComposedEffectSequenceSize), effect);
+    auto callback = []() {};
+
+    for (auto _ : state) {
+        state.ResumeTiming();
+        auto ret = halCall<std::chrono::milliseconds>(mController, [&](auto hal) {
+            return hal->performComposedEffect(effects, callback);
+        });
+        state.PauseTiming();
+        if (checkHalResult(ret, state)) {
+            turnVibratorOff(state);
+        }
+    }
+});
+
+class CallbackSchedulerBench : public Fixture {
+public:
+    static void DefaultConfig(Benchmark* b) { b->Unit(kMicrosecond); }
+
+    static void DefaultArgs(Benchmark* b) {
+        b->ArgNames({"Callbacks"});
+        for (int64_t callbacks : {1, 8, 64}) {
+            b->Args({callbacks});
+        }
+    }
+
+protected:
+    vibrator::CallbackScheduler mScheduler;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    int64_t mPendingCallbacks GUARDED_BY(mMutex) = 0;
+
+    void onCallback() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (--mPendingCallbacks == 0) {
+            mCondition.notify_all();
+        }
+    }
+
+    void waitForCallbacks() {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this]() REQUIRES(mMutex) { return mPendingCallbacks == 0; });
+    }
+};
+
+// Completion callbacks of the vibrations which the HAL cannot notify, scheduled in bursts.
+BENCHMARK_WRAPPER(CallbackSchedulerBench, schedule, {
+    const int64_t callbacks = state.range(0);
+    for (auto _ : state) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mPendingCallbacks = callbacks;
+        }
+        for (int64_t i = 0; i < callbacks; i++) {
+            mScheduler.schedule([this]() { onCallback(); }, std::chrono::milliseconds(i % 2));
+        }
+        waitForCallbacks();
+    }
+    state.counters["callbacks"] =
+            Counter(static_cast<double>(callbacks * state.iterations()), Counter::kIsRate);
+});
+
 BENCHMARK_MAIN();
@@ -18,10 +18,12 @@
 #define ANDROID_VIBRATOR_CALLBACK_SCHEDULER_H
 
 #include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
 #include <chrono>
-#include <condition_variable>
-#include <queue>
+#include <functional>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 namespace android {
 
@@ -31,12 +33,14 @@ namespace vibrator {
 class DelayedCallback {
 public:
     DelayedCallback(std::function<void()> callback, std::chrono::milliseconds delay)
-          : mCallback(callback), mExpiration(std::chrono::steady_clock::now() + delay) {}
+          : mCallback(std::move(callback)),
+            mExpiration(std::chrono::steady_clock::now() + delay) {}
     ~DelayedCallback() = default;
 
     void run() const;
     bool isExpired() const;
     std::chrono::milliseconds getWaitForExpirationDuration() const;
+    std::chrono::time_point<std::chrono::steady_clock> getExpiration() const { return mExpiration; }
 
     // Compare by expiration time, where A < B when A expires first.
     bool operator<(const DelayedCallback& other) const;
@@ -50,6 +54,11 @@ private:
 };
 
 // Schedules callbacks to be executed after a delay.
+//
+// The callback thread sleeps on a timerfd armed for the earliest expiration, so it wakes up exactly
+// once per expiration instead of polling with millisecond granularity. Callbacks are moved in and
+// out of a heap which keeps its capacity, so scheduling does not allocate once the heap has grown
+// to the number of callbacks in flight.
 class CallbackScheduler {
 public:
     CallbackScheduler() : mCallbackThread(nullptr), mFinished(false) {}
@@ -58,19 +67,23 @@ public:
     virtual void schedule(std::function<void()> callback, std::chrono::milliseconds delay);
 
 private:
-    std::condition_variable_any mCondition;
+    static constexpr size_t INITIAL_CAPACITY = 16;
+
     std::mutex mMutex;
 
     // Lazily instantiated only at the first time this scheduler is used.
     std::unique_ptr<std::thread> mCallbackThread;
+    base::unique_fd mTimerFd;
 
     // Used to quit the callback thread when this instance is being destroyed.
     bool mFinished GUARDED_BY(mMutex);
 
-    // Priority queue with reverse comparator, so tasks that expire first will be on top.
-    std::priority_queue<DelayedCallback, std::vector<DelayedCallback>,
-                        std::greater<DelayedCallback>>
-            mQueue GUARDED_BY(mMutex);
+    // Min heap ordered with std::greater, so tasks that expire first will be on top.
+    std::vector<DelayedCallback> mQueue GUARDED_BY(mMutex);
+
+    // Arms the timer for the earliest expiration, or disarms it if there is no callback left.
+    void updateTimerLocked() REQUIRES(mMutex);
+    void setTimer(std::chrono::time_point<std::chrono::steady_clock> expiration);
 
     void loop();
 };
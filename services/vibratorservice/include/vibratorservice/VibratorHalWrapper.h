@@ -379,6 +379,13 @@ protected:
     HalResult<Capabilities> getCapabilities();
     HalResult<std::vector<std::chrono::milliseconds>> getPrimitiveDurations();
 
+    // Sums up the cached primitive durations of a composition, without copying them.
+    std::chrono::milliseconds getComposedEffectDuration(
+            const std::vector<hardware::vibrator::CompositeEffect>& primitives);
+
+    // Drops the cached vibrator info, which is only needed when a new HAL instance is connected.
+    void invalidateInfoCache();
+
     // Request vibrator info to HAL skipping cache.
     virtual HalResult<Capabilities> getCapabilitiesInternal() = 0;
     virtual HalResult<std::vector<hardware::vibrator::Effect>> getSupportedEffectsInternal();
@@ -400,6 +407,9 @@ protected:
 private:
     std::mutex mInfoMutex;
     InfoCache mInfoCache GUARDED_BY(mInfoMutex);
+
+    const HalResult<std::vector<std::chrono::milliseconds>>& getPrimitiveDurationsLocked()
+            REQUIRES(mInfoMutex);
 };
 
 // Wrapper for the AIDL Vibrator HAL.
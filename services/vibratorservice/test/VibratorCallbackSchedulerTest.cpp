@@ -124,3 +124,27 @@ TEST_F(VibratorCallbackSchedulerTest, TestDestructorDropsPendingCallbacksAndKill
     ASSERT_EQ(0, waitForCallbacks(1, 50ms));
     ASSERT_TRUE(getExpiredCallbacks().empty());
 }
+
+TEST_F(VibratorCallbackSchedulerTest, TestScheduleManyCallbacksRunsAllOfThem) {
+    // Keep scheduling while earlier callbacks expire, like rich haptics do while typing.
+    for (int32_t i = 0; i < 100; i++) {
+        mScheduler->schedule(createCallback(i), milliseconds(i % 5));
+    }
+
+    ASSERT_EQ(100, waitForCallbacks(100, 5ms));
+}
+
+TEST_F(VibratorCallbackSchedulerTest, TestDestructorWaitsForRunningCallback) {
+    mScheduler->schedule(
+            [&]() {
+                std::this_thread::sleep_for(20ms);
+                createCallback(1)();
+            },
+            0ms);
+    mScheduler->schedule(createCallback(2), 0ms);
+    std::this_thread::sleep_for(10ms);
+    mScheduler.reset(nullptr);
+
+    // The running callback completed, but the other one was dropped.
+    ASSERT_THAT(getExpiredCallbacks(), ElementsAre(1));
+}
@@ -482,6 +482,43 @@ TEST_F(VibratorHalWrapperAidlTest, TestGetInfoCachesResult) {
     ASSERT_TRUE(info.maxAmplitudes.isUnsupported());
 }
 
+TEST_F(VibratorHalWrapperAidlTest, TestTryReconnectToNewHalReloadsInfo) {
+    sp<StrictMock<MockIVibrator>> newMockHal = new StrictMock<MockIVibrator>();
+    sp<StrictMock<MockBinder>> newMockBinder = new StrictMock<MockBinder>();
+    mWrapper = std::make_unique<vibrator::AidlHalWrapper>(mMockScheduler, mMockHal, [&]() {
+        return vibrator::HalResult<sp<IVibrator>>::ok(newMockHal);
+    });
+
+    EXPECT_CALL(*mMockHal.get(), onAsBinder()).WillRepeatedly(Return(mMockBinder.get()));
+    EXPECT_CALL(*newMockHal.get(), onAsBinder()).WillRepeatedly(Return(newMockBinder.get()));
+    EXPECT_CALL(*mMockHal.get(), getCapabilities(_))
+            .Times(Exactly(1))
+            .WillRepeatedly(DoAll(SetArgPointee<0>(IVibrator::CAP_ON_CALLBACK), Return(Status())));
+    EXPECT_CALL(*mMockHal.get(), on(Eq(10), _)).Times(Exactly(1)).WillRepeatedly(Return(Status()));
+    EXPECT_CALL(*newMockHal.get(), getCapabilities(_))
+            .Times(Exactly(1))
+            .WillRepeatedly(DoAll(SetArgPointee<0>(IVibrator::CAP_ON_CALLBACK), Return(Status())));
+    EXPECT_CALL(*newMockHal.get(), on(Eq(20), _))
+            .Times(Exactly(1))
+            .WillRepeatedly(Return(Status()));
+    EXPECT_CALL(*newMockHal.get(), on(Eq(30), _))
+            .Times(Exactly(1))
+            .WillRepeatedly(Return(Status()));
+
+    std::unique_ptr<int32_t> callbackCounter = std::make_unique<int32_t>();
+    auto callback = vibrator::TestFactory::createCountingCallback(callbackCounter.get());
+
+    ASSERT_TRUE(mWrapper->on(10ms, callback).isOk());
+
+    // Capabilities are loaded again from the new HAL instance.
+    mWrapper->tryReconnect();
+    ASSERT_TRUE(mWrapper->on(20ms, callback).isOk());
+
+    // Capabilities stay cached when reconnecting to the same HAL instance.
+    mWrapper->tryReconnect();
+    ASSERT_TRUE(mWrapper->on(30ms, callback).isOk());
+}
+
 TEST_F(VibratorHalWrapperAidlTest, TestPerformEffectWithCallbackSupport) {
     {
         InSequence seq;
@@ -78,19 +78,30 @@ class Hal {
 
     int GetDebugReportIndex() const { return debug_report_index_; }
 
+    // The HAL instance extensions don't change once the HAL is opened, so
+    // they are enumerated from a copy made by Open().
+    VkResult EnumerateInstanceExtensionProperties(
+        uint32_t* count,
+        VkExtensionProperties* props) const;
+
    private:
-    Hal() : dev_(nullptr), debug_report_index_(-1) {}
+    Hal()
+        : dev_(nullptr),
+          debug_report_index_(-1),
+          instance_extensions_valid_(false) {}
     Hal(const Hal&) = delete;
     Hal& operator=(const Hal&) = delete;
 
     bool ShouldUnloadBuiltinDriver();
     void UnloadBuiltinDriver();
-    bool InitDebugReportIndex();
+    bool InitInstanceExtensions();
 
     static Hal hal_;
 
     const hwvulkan_device_t* dev_;
     int debug_report_index_;
+    std::vector<VkExtensionProperties> instance_extensions_;
+    bool instance_extensions_valid_;
 };
 
 class CreateInfoWrapper {
@@ -310,7 +321,7 @@ bool Hal::Open() {
 
     hal_.dev_ = device;
 
-    hal_.InitDebugReportIndex();
+    hal_.InitInstanceExtensions();
 
     android::GraphicsEnv::getInstance().setDriverLoaded(
         android::GpuStatsInfo::Api::API_VK, true, systemTime() - openTime);
@@ -349,9 +360,11 @@ void Hal::UnloadBuiltinDriver() {
 
     hal_.dev_ = nullptr;
     hal_.debug_report_index_ = -1;
+    hal_.instance_extensions_.clear();
+    hal_.instance_extensions_valid_ = false;
 }
 
-bool Hal::InitDebugReportIndex() {
+bool Hal::InitInstanceExtensions() {
     ATRACE_CALL();
 
     uint32_t count;
@@ -361,19 +374,13 @@ bool Hal::InitDebugReportIndex() {
         return false;
     }
 
-    VkExtensionProperties* exts = reinterpret_cast<VkExtensionProperties*>(
-        malloc(sizeof(VkExtensionProperties) * count));
-    if (!exts) {
-        ALOGE("failed to allocate HAL instance extension array");
-        return false;
-    }
-
-    if (dev_->EnumerateInstanceExtensionProperties(nullptr, &count, exts) !=
-        VK_SUCCESS) {
+    std::vector<VkExtensionProperties> exts(count);
+    if (dev_->EnumerateInstanceExtensionProperties(nullptr, &count,
+                                                   exts.data()) != VK_SUCCESS) {
         ALOGE("failed to enumerate HAL instance extensions");
-        free(exts);
         return false;
     }
+    exts.resize(count);
 
     for (uint32_t i = 0; i < count; i++) {
         if (strcmp(exts[i].extensionName, VK_EXT_DEBUG_REPORT_EXTENSION_NAME) ==
@@ -383,11 +390,32 @@ bool Hal::InitDebugReportIndex() {
         }
     }
 
-    free(exts);
+    instance_extensions_ = std::move(exts);
+    instance_extensions_valid_ = true;
 
     return true;
 }
 
+VkResult Hal::EnumerateInstanceExtensionProperties(
+    uint32_t* count,
+    VkExtensionProperties* props) const {
+    if (!instance_extensions_valid_)
+        return dev_->EnumerateInstanceExtensionProperties(nullptr, count, props);
+
+    const uint32_t ext_count =
+        static_cast<uint32_t>(instance_extensions_.size());
+    if (!props) {
+        *count = ext_count;
+        return VK_SUCCESS;
+    }
+
+    const uint32_t copied = std::min(*count, ext_count);
+    std::copy_n(instance_extensions_.data(), copied, props);
+    *count = copied;
+
+    return (copied == ext_count) ? VK_SUCCESS : VK_INCOMPLETE;
+}
+
 CreateInfoWrapper::CreateInfoWrapper(const VkInstanceCreateInfo& create_info,
                                      uint32_t icd_api_version,
                                      const VkAllocationCallbacks& allocator)
@@ -576,8 +604,7 @@ VkResult CreateInfoWrapper::SanitizeExtensions() {
 
 VkResult CreateInfoWrapper::QueryExtensionCount(uint32_t& count) const {
     if (is_instance_) {
-        return Hal::Device().EnumerateInstanceExtensionProperties(
-            nullptr, &count, nullptr);
+        return Hal::Get().EnumerateInstanceExtensionProperties(&count, nullptr);
     } else {
         const auto& driver = GetData(physical_dev_).driver;
         return driver.EnumerateDeviceExtensionProperties(physical_dev_, nullptr,
@@ -589,8 +616,7 @@ VkResult CreateInfoWrapper::EnumerateExtensions(
     uint32_t& count,
     VkExtensionProperties* props) const {
     if (is_instance_) {
-        return Hal::Device().EnumerateInstanceExtensionProperties(
-            nullptr, &count, props);
+        return Hal::Get().EnumerateInstanceExtensionProperties(&count, props);
     } else {
         const auto& driver = GetData(physical_dev_).driver;
         return driver.EnumerateDeviceExtensionProperties(physical_dev_, nullptr,
@@ -1032,10 +1058,16 @@ VkResult EnumerateInstanceExtensionProperties(
         }
     }
 
-    ATRACE_BEGIN("driver.EnumerateInstanceExtensionProperties");
-    VkResult result = Hal::Device().EnumerateInstanceExtensionProperties(
-        pLayerName, pPropertyCount, pProperties);
-    ATRACE_END();
+    VkResult result;
+    if (!pLayerName) {
+        result = Hal::Get().EnumerateInstanceExtensionProperties(pPropertyCount,
+                                                                 pProperties);
+    } else {
+        ATRACE_BEGIN("driver.EnumerateInstanceExtensionProperties");
+        result = Hal::Device().EnumerateInstanceExtensionProperties(
+            pLayerName, pPropertyCount, pProperties);
+        ATRACE_END();
+    }
 
     if (!pLayerName && (result == VK_SUCCESS || result == VK_INCOMPLETE)) {
         int idx = Hal::Get().GetDebugReportIndex();
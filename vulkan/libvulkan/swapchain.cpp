@@ -19,6 +19,7 @@
 
 #include <aidl/android/hardware/graphics/common/Dataspace.h>
 #include <aidl/android/hardware/graphics/common/PixelFormat.h>
+#include <android-base/properties.h>
 #include <android/hardware/graphics/common/1.0/types.h>
 #include <android/hardware_buffer.h>
 #include <grallocusage/GrallocUsageConversion.h>
@@ -34,6 +35,7 @@
 #include <utils/Trace.h>
 
 #include <algorithm>
+#include <array>
 #include <unordered_set>
 #include <vector>
 
@@ -180,6 +182,7 @@ const static VkColorSpaceKHR
 
 class TimingInfo {
    public:
+    TimingInfo() = default;
     TimingInfo(const VkPresentTimeGOOGLE* qp, uint64_t nativeFrameId)
         : vals_{qp->presentID, qp->desiredPresentTime, 0, 0, 0},
           native_frame_id_(nativeFrameId) {}
@@ -270,6 +273,104 @@ enum { MAX_TIMING_INFOS = 10 };
 // syncronous requests to Surface Flinger):
 enum { MIN_NUM_FRAMES_AGO = 5 };
 
+// TimingRing keeps the last MAX_TIMING_INFOS TimingInfo structs of a
+// swapchain, oldest first, so that recording a present and dropping the
+// reported ones don't move the others.
+class TimingRing {
+   public:
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    void clear() { size_ = 0; }
+
+    TimingInfo& operator[](size_t i) {
+        return infos_[(begin_ + i) % MAX_TIMING_INFOS];
+    }
+    const TimingInfo& operator[](size_t i) const {
+        return infos_[(begin_ + i) % MAX_TIMING_INFOS];
+    }
+
+    // Adds a TimingInfo, dropping the oldest one if the ring is full.
+    void push_back(const TimingInfo& ti) {
+        if (size_ == MAX_TIMING_INFOS)
+            pop_front(1);
+        infos_[(begin_ + size_) % MAX_TIMING_INFOS] = ti;
+        size_++;
+    }
+
+    // Drops the count oldest TimingInfo structs.
+    void pop_front(size_t count) {
+        begin_ = (begin_ + count) % MAX_TIMING_INFOS;
+        size_ -= count;
+    }
+
+   private:
+    std::array<TimingInfo, MAX_TIMING_INFOS> infos_;
+    size_t begin_ = 0;
+    size_t size_ = 0;
+};
+
+// FramePacer picks the desired present times of a FIFO swapchain whose app
+// doesn't time its presents with GOOGLE_display_timing, when the
+// debug.vulkan.frame_pacing property is set. Frames which take a bit longer
+// than a refresh cycle to render are then shown for a steady number of
+// refresh cycles, instead of alternating between one and two.
+class FramePacer {
+   public:
+    // Records that the app was blocked for duration waiting for a buffer,
+    // which doesn't count in the time the app takes to render a frame.
+    void add_blocked_time(int64_t duration) { blocked_time_ += duration; }
+
+    // Returns the desired present time of a frame presented at now, or
+    // NATIVE_WINDOW_TIMESTAMP_AUTO for the window to present it as soon as
+    // possible.
+    int64_t next_present_time(int64_t now, int64_t refresh_duration) {
+        const int64_t interval = now - last_present_;
+        const int64_t frame_time = interval - blocked_time_;
+        last_present_ = now;
+        blocked_time_ = 0;
+
+        if (interval > kMaxFrameInterval || refresh_duration <= 0) {
+            // Start over after a pause of the app
+            frame_time_ = 0;
+            target_ = 0;
+            return NATIVE_WINDOW_TIMESTAMP_AUTO;
+        }
+        frame_time_ = frame_time_ ? frame_time_ + (frame_time - frame_time_) / 8
+                                  : frame_time;
+
+        // The number of refresh cycles which the frames are shown for, with
+        // some slack so that the jitter of the frames which fit in their
+        // period doesn't make them skip to the next one.
+        const int64_t cycles = std::max<int64_t>(
+            1, (frame_time_ - refresh_duration / 8 + refresh_duration - 1) /
+                   refresh_duration);
+        if (cycles == 1) {
+            // FIFO already shows each frame for one refresh cycle
+            target_ = 0;
+            return NATIVE_WINDOW_TIMESTAMP_AUTO;
+        }
+
+        // Keep the cadence of the previous frames, unless this one is late,
+        // and don't queue more than kMaxQueuedPeriods periods ahead so that
+        // the latency stays bounded.
+        const int64_t period = cycles * refresh_duration;
+        target_ = std::clamp(target_ + period, now,
+                             now + kMaxQueuedPeriods * period);
+        return target_;
+    }
+
+   private:
+    static constexpr int64_t kMaxFrameInterval = 200'000'000;  // 200ms
+    static constexpr int64_t kMaxQueuedPeriods = 3;
+
+    int64_t last_present_ = 0;
+    int64_t blocked_time_ = 0;
+    // The moving average of the time the app takes to render a frame.
+    int64_t frame_time_ = 0;
+    // The desired present time of the last frame, or 0 if it wasn't paced.
+    int64_t target_ = 0;
+};
+
 bool IsSharedPresentMode(VkPresentModeKHR mode) {
     return mode == VK_PRESENT_MODE_SHARED_DEMAND_REFRESH_KHR ||
         mode == VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR;
@@ -288,7 +389,11 @@ struct Swapchain {
           frame_timestamps_enabled(false),
           refresh_duration(refresh_duration_),
           acquire_next_image_timeout(-1),
-          shared(IsSharedPresentMode(present_mode)) {
+          shared(IsSharedPresentMode(present_mode)),
+          frame_pacing_enabled(android::base::GetBoolProperty(
+              "debug.vulkan.frame_pacing", false)),
+          frame_pacing(present_mode == VK_PRESENT_MODE_FIFO_KHR &&
+                       frame_pacing_enabled) {
     }
 
     VkResult get_refresh_duration(uint64_t& outRefreshDuration)
@@ -314,6 +419,13 @@ struct Swapchain {
     int64_t refresh_duration;
     nsecs_t acquire_next_image_timeout;
     bool shared;
+    // Whether the debug.vulkan.frame_pacing property was set when the
+    // swapchain was created.
+    const bool frame_pacing_enabled;
+    // Whether pacer picks the desired present times of the frames which the
+    // app doesn't time itself.
+    bool frame_pacing;
+    FramePacer pacer;
 
     struct Image {
         Image()
@@ -338,7 +450,12 @@ struct Swapchain {
         bool dequeued;
     } images[android::BufferQueueDefs::NUM_BUFFER_SLOTS];
 
-    std::vector<TimingInfo> timing;
+    // Indices of the images which are still dequeued from the swapchain's
+    // creation. AcquireNextImageKHR hands these out before it dequeues from
+    // the window again.
+    std::vector<uint32_t> pre_dequeued;
+
+    TimingRing timing;
 };
 
 VkSwapchainKHR HandleFromSwapchain(Swapchain* swapchain) {
@@ -421,9 +538,72 @@ void ReleaseSwapchainImage(VkDevice device,
     image.buffer.clear();
 }
 
+// Returns the given dequeued images to the window, along with their dequeue
+// fences, in a single round trip where the window supports it.
+void CancelSwapchainImages(ANativeWindow* window,
+                           Swapchain& swapchain,
+                           const uint32_t* indices,
+                           uint32_t count) {
+    ATRACE_CALL();
+
+    // The window may have taken some of the fences when the batch fails, so
+    // it gets duplicates, and the originals are kept for cancelling the
+    // buffers one at a time.
+    ANativeWindowBuffer* buffers[android::BufferQueueDefs::NUM_BUFFER_SLOTS];
+    int fences[android::BufferQueueDefs::NUM_BUFFER_SLOTS];
+    bool duplicated = true;
+    for (uint32_t i = 0; i < count; i++) {
+        const Swapchain::Image& img = swapchain.images[indices[i]];
+        buffers[i] = img.buffer.get();
+        fences[i] = img.dequeue_fence >= 0 ? dup(img.dequeue_fence) : -1;
+        duplicated &= img.dequeue_fence < 0 || fences[i] >= 0;
+    }
+
+    int err = android::NO_MEMORY;
+    if (duplicated) {
+        err = native_window_cancel_buffers(window, count, buffers, fences);
+    }
+    if (!duplicated || err == android::INVALID_OPERATION ||
+        err == android::NAME_NOT_FOUND) {
+        // The window hasn't touched the duplicates.
+        for (uint32_t i = 0; i < count; i++) {
+            if (fences[i] >= 0)
+                close(fences[i]);
+        }
+    }
+    if (err != android::OK && duplicated) {
+        ALOGW("native_window_cancel_buffers failed: %s (%d)", strerror(-err),
+              err);
+    }
+
+    // Only a successful batch has cancelled all of the buffers. Otherwise,
+    // cancel them one at a time, which is harmless for any that the batch
+    // did cancel.
+    for (uint32_t i = 0; i < count; i++) {
+        Swapchain::Image& img = swapchain.images[indices[i]];
+        if (err == android::OK) {
+            if (img.dequeue_fence >= 0)
+                close(img.dequeue_fence);
+        } else {
+            window->cancelBuffer(window, img.buffer.get(), img.dequeue_fence);
+        }
+        img.dequeue_fence = -1;
+        img.dequeued = false;
+    }
+}
+
 void OrphanSwapchain(VkDevice device, Swapchain* swapchain) {
     if (swapchain->surface.swapchain_handle != HandleFromSwapchain(swapchain))
         return;
+    // The application never acquired these, so it won't present them, and
+    // they'd stay dequeued from the window until it is destroyed.
+    if (!swapchain->pre_dequeued.empty()) {
+        CancelSwapchainImages(swapchain->surface.window.get(), *swapchain,
+                              swapchain->pre_dequeued.data(),
+                              static_cast<uint32_t>(
+                                  swapchain->pre_dequeued.size()));
+        swapchain->pre_dequeued.clear();
+    }
     for (uint32_t i = 0; i < swapchain->num_images; i++) {
         if (!swapchain->images[i].dequeued) {
             ReleaseSwapchainImage(device, swapchain->shared, nullptr, -1,
@@ -520,8 +700,7 @@ void copy_ready_timings(Swapchain& swapchain,
 
     // Discard old frames that aren't ready if newer frames are ready.
     // We don't expect to get the timing info for those old frames.
-    swapchain.timing.erase(swapchain.timing.begin(),
-                           swapchain.timing.begin() + num_to_remove);
+    swapchain.timing.pop_front(num_to_remove);
 
     *count = num_copied;
 }
@@ -2045,25 +2224,45 @@ VkResult CreateSwapchainKHR(VkDevice device,
         // -- Dequeue all buffers and create a VkImage for each --
         // Any failures during or after this must cancel the dequeued buffers.
 
+        // Dequeue them with a single round trip where the window supports it,
+        // and one at a time below otherwise.
+        if (!swapchain->shared) {
+            ANativeWindowBuffer* buffers[android::BufferQueueDefs::NUM_BUFFER_SLOTS];
+            int fences[android::BufferQueueDefs::NUM_BUFFER_SLOTS];
+            ATRACE_BEGIN("dequeueBuffers");
+            err = native_window_dequeue_buffers(window, num_images, buffers, fences);
+            ATRACE_END();
+            if (err == android::OK) {
+                for (uint32_t i = 0; i < num_images; i++) {
+                    Swapchain::Image& img = swapchain->images[i];
+                    img.buffer = buffers[i];
+                    img.dequeue_fence = fences[i];
+                    img.dequeued = true;
+                }
+            }
+        }
+
         for (uint32_t i = 0; i < num_images; i++) {
             Swapchain::Image& img = swapchain->images[i];
 
-            ANativeWindowBuffer* buffer;
-            err = window->dequeueBuffer(window, &buffer, &img.dequeue_fence);
-            if (err != android::OK) {
-                ALOGE("dequeueBuffer[%u] failed: %s (%d)", i, strerror(-err), err);
-                switch (-err) {
-                    case ENOMEM:
-                        result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
-                        break;
-                    default:
-                        result = VK_ERROR_SURFACE_LOST_KHR;
-                        break;
+            if (!img.dequeued) {
+                ANativeWindowBuffer* buffer;
+                err = window->dequeueBuffer(window, &buffer, &img.dequeue_fence);
+                if (err != android::OK) {
+                    ALOGE("dequeueBuffer[%u] failed: %s (%d)", i, strerror(-err), err);
+                    switch (-err) {
+                        case ENOMEM:
+                            result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+                            break;
+                        default:
+                            result = VK_ERROR_SURFACE_LOST_KHR;
+                            break;
+                    }
+                    break;
                 }
-                break;
+                img.buffer = buffer;
+                img.dequeued = true;
             }
-            img.buffer = buffer;
-            img.dequeued = true;
 
             image_native_buffer.handle = img.buffer->handle;
             image_native_buffer.stride = img.buffer->stride;
@@ -2087,19 +2286,37 @@ VkResult CreateSwapchainKHR(VkDevice device,
             }
         }
 
-        // -- Cancel all buffers, returning them to the queue --
-        // If an error occurred before, also destroy the VkImage and release the
-        // buffer reference. Otherwise, we retain a strong reference to the buffer.
-        for (uint32_t i = 0; i < num_images; i++) {
-            Swapchain::Image& img = swapchain->images[i];
-            if (img.dequeued) {
-                if (!swapchain->shared) {
-                    window->cancelBuffer(window, img.buffer.get(),
-                                         img.dequeue_fence);
-                    img.dequeue_fence = -1;
-                    img.dequeued = false;
+        // -- Keep some buffers dequeued for AcquireNextImageKHR --
+        // This saves it from dequeueing them again, one round trip each. It
+        // keeps no more than the window lets the producer hold dequeued at a
+        // time, so that acquiring them doesn't get around the throttling by
+        // the consumer. The rest are cancelled, returning them to the queue.
+        // We retain a strong reference to all of the buffers.
+        //
+        // If an error occurred before, cancel them all instead.
+        // DestroySwapchainInternal then destroys the VkImages and releases the
+        // buffer references.
+        if (!swapchain->shared) {
+            const uint32_t num_pre_dequeued =
+                result == VK_SUCCESS
+                    ? std::min(num_images,
+                               buffer_count - min_undequeued_buffers)
+                    : 0;
+            for (uint32_t i = num_pre_dequeued; i > 0; i--) {
+                swapchain->pre_dequeued.push_back(i - 1);
+            }
+
+            uint32_t cancelled[android::BufferQueueDefs::NUM_BUFFER_SLOTS];
+            uint32_t num_cancelled = 0;
+            for (uint32_t i = num_pre_dequeued; i < num_images; i++) {
+                if (swapchain->images[i].dequeued) {
+                    cancelled[num_cancelled++] = i;
                 }
             }
+            if (num_cancelled > 0) {
+                CancelSwapchainImages(window, *swapchain, cancelled,
+                                      num_cancelled);
+            }
         }
     }
 
@@ -2189,106 +2406,119 @@ VkResult AcquireNextImageKHR(VkDevice device,
         return result;
     }
 
-    const nsecs_t acquire_next_image_timeout =
-        timeout > (uint64_t)std::numeric_limits<nsecs_t>::max() ? -1 : timeout;
-    if (acquire_next_image_timeout != swapchain.acquire_next_image_timeout) {
-        // Cache the timeout to avoid the duplicate binder cost.
-        err = window->perform(window, NATIVE_WINDOW_SET_DEQUEUE_TIMEOUT,
-                              acquire_next_image_timeout);
-        if (err != android::OK) {
-            ALOGE("window->perform(SET_DEQUEUE_TIMEOUT) failed: %s (%d)",
-                  strerror(-err), err);
-            return VK_ERROR_SURFACE_LOST_KHR;
-        }
-        swapchain.acquire_next_image_timeout = acquire_next_image_timeout;
-    }
-
+    uint32_t idx;
     ANativeWindowBuffer* buffer;
     int fence_fd;
-    err = window->dequeueBuffer(window, &buffer, &fence_fd);
-    if (err == android::TIMED_OUT || err == android::INVALID_OPERATION) {
-        ALOGW("dequeueBuffer timed out: %s (%d)", strerror(-err), err);
-        return timeout ? VK_TIMEOUT : VK_NOT_READY;
-    } else if (err != android::OK) {
-        ALOGE("dequeueBuffer failed: %s (%d)", strerror(-err), err);
-        return VK_ERROR_SURFACE_LOST_KHR;
-    }
-
-    uint32_t idx;
-    for (idx = 0; idx < swapchain.num_images; idx++) {
-        if (swapchain.images[idx].buffer.get() == buffer) {
-            swapchain.images[idx].dequeued = true;
-            swapchain.images[idx].dequeue_fence = fence_fd;
-            break;
+    if (!swapchain.pre_dequeued.empty()) {
+        // Still dequeued from CreateSwapchainKHR, so there's no need to ask
+        // the window for a buffer.
+        idx = swapchain.pre_dequeued.back();
+        swapchain.pre_dequeued.pop_back();
+        buffer = swapchain.images[idx].buffer.get();
+        fence_fd = swapchain.images[idx].dequeue_fence;
+    } else {
+        const nsecs_t acquire_next_image_timeout =
+            timeout > (uint64_t)std::numeric_limits<nsecs_t>::max() ? -1 : timeout;
+        if (acquire_next_image_timeout != swapchain.acquire_next_image_timeout) {
+            // Cache the timeout to avoid the duplicate binder cost.
+            err = window->perform(window, NATIVE_WINDOW_SET_DEQUEUE_TIMEOUT,
+                                  acquire_next_image_timeout);
+            if (err != android::OK) {
+                ALOGE("window->perform(SET_DEQUEUE_TIMEOUT) failed: %s (%d)",
+                      strerror(-err), err);
+                return VK_ERROR_SURFACE_LOST_KHR;
+            }
+            swapchain.acquire_next_image_timeout = acquire_next_image_timeout;
+        }
+
+        const nsecs_t dequeue_time =
+            swapchain.frame_pacing ? systemTime() : 0;
+        err = window->dequeueBuffer(window, &buffer, &fence_fd);
+        if (swapchain.frame_pacing)
+            swapchain.pacer.add_blocked_time(systemTime() - dequeue_time);
+        if (err == android::TIMED_OUT || err == android::INVALID_OPERATION) {
+            ALOGW("dequeueBuffer timed out: %s (%d)", strerror(-err), err);
+            return timeout ? VK_TIMEOUT : VK_NOT_READY;
+        } else if (err != android::OK) {
+            ALOGE("dequeueBuffer failed: %s (%d)", strerror(-err), err);
+            return VK_ERROR_SURFACE_LOST_KHR;
         }
-    }
 
-    // If this is a deferred alloc swapchain, this may be the first time we've
-    // seen a particular buffer. If so, there should be an empty slot. Find it,
-    // and bind the gralloc buffer to the VkImage for that slot. If there is no
-    // empty slot, then we dequeued an unexpected buffer. Non-deferred swapchains
-    // will also take this path, but will never have an empty slot since we
-    // populated them all upfront.
-    if (idx == swapchain.num_images) {
         for (idx = 0; idx < swapchain.num_images; idx++) {
-            if (!swapchain.images[idx].buffer) {
-                // Note: this structure is technically required for
-                // Vulkan correctness, even though the driver is probably going
-                // to use everything from the VkNativeBufferANDROID below.
-                // This is kindof silly, but it's how we did the ANB
-                // side of VK_KHR_swapchain v69, so we're stuck with it unless
-                // we want to go tinkering with the ANB spec some more.
-                VkBindImageMemorySwapchainInfoKHR bimsi = {
-                    .sType = VK_STRUCTURE_TYPE_BIND_IMAGE_MEMORY_SWAPCHAIN_INFO_KHR,
-                    .pNext = nullptr,
-                    .swapchain = swapchain_handle,
-                    .imageIndex = idx,
-                };
-                VkNativeBufferANDROID nb = {
-                    .sType = VK_STRUCTURE_TYPE_NATIVE_BUFFER_ANDROID,
-                    .pNext = &bimsi,
-                    .handle = buffer->handle,
-                    .stride = buffer->stride,
-                    .format = buffer->format,
-                    .usage = int(buffer->usage),
-                    .usage3 = buffer->usage,
-                    .ahb = ANativeWindowBuffer_getHardwareBuffer(buffer),
-                };
-                android_convertGralloc0To1Usage(int(buffer->usage),
-                                                &nb.usage2.producer,
-                                                &nb.usage2.consumer);
-                VkBindImageMemoryInfo bimi = {
-                    .sType = VK_STRUCTURE_TYPE_BIND_IMAGE_MEMORY_INFO,
-                    .pNext = &nb,
-                    .image = swapchain.images[idx].image,
-                    .memory = VK_NULL_HANDLE,
-                    .memoryOffset = 0,
-                };
-                result = GetData(device).driver.BindImageMemory2(device, 1, &bimi);
-                if (result != VK_SUCCESS) {
-                    // This shouldn't really happen. If it does, something is probably
-                    // unrecoverably wrong with the swapchain and its images. Cancel
-                    // the buffer and declare the swapchain broken.
-                    ALOGE("failed to do deferred gralloc buffer bind");
-                    window->cancelBuffer(window, buffer, fence_fd);
-                    return VK_ERROR_OUT_OF_DATE_KHR;
-                }
-
+            if (swapchain.images[idx].buffer.get() == buffer) {
                 swapchain.images[idx].dequeued = true;
                 swapchain.images[idx].dequeue_fence = fence_fd;
-                swapchain.images[idx].buffer = buffer;
                 break;
             }
         }
-    }
 
-    // The buffer doesn't match any slot. This shouldn't normally happen, but is
-    // possible if the bufferqueue is reconfigured behind libvulkan's back. If this
-    // happens, just declare the swapchain to be broken and the app will recreate it.
-    if (idx == swapchain.num_images) {
-        ALOGE("dequeueBuffer returned unrecognized buffer");
-        window->cancelBuffer(window, buffer, fence_fd);
-        return VK_ERROR_OUT_OF_DATE_KHR;
+        // If this is a deferred alloc swapchain, this may be the first time we've
+        // seen a particular buffer. If so, there should be an empty slot. Find it,
+        // and bind the gralloc buffer to the VkImage for that slot. If there is no
+        // empty slot, then we dequeued an unexpected buffer. Non-deferred swapchains
+        // will also take this path, but will never have an empty slot since we
+        // populated them all upfront.
+        if (idx == swapchain.num_images) {
+            for (idx = 0; idx < swapchain.num_images; idx++) {
+                if (!swapchain.images[idx].buffer) {
+                    // Note: this structure is technically required for
+                    // Vulkan correctness, even though the driver is probably going
+                    // to use everything from the VkNativeBufferANDROID below.
+                    // This is kindof silly, but it's how we did the ANB
+                    // side of VK_KHR_swapchain v69, so we're stuck with it unless
+                    // we want to go tinkering with the ANB spec some more.
+                    VkBindImageMemorySwapchainInfoKHR bimsi = {
+                        .sType = VK_STRUCTURE_TYPE_BIND_IMAGE_MEMORY_SWAPCHAIN_INFO_KHR,
+                        .pNext = nullptr,
+                        .swapchain = swapchain_handle,
+                        .imageIndex = idx,
+                    };
+                    VkNativeBufferANDROID nb = {
+                        .sType = VK_STRUCTURE_TYPE_NATIVE_BUFFER_ANDROID,
+                        .pNext = &bimsi,
+                        .handle = buffer->handle,
+                        .stride = buffer->stride,
+                        .format = buffer->format,
+                        .usage = int(buffer->usage),
+                        .usage3 = buffer->usage,
+                        .ahb = ANativeWindowBuffer_getHardwareBuffer(buffer),
+                    };
+                    android_convertGralloc0To1Usage(int(buffer->usage),
+                                                    &nb.usage2.producer,
+                                                    &nb.usage2.consumer);
+                    VkBindImageMemoryInfo bimi = {
+                        .sType = VK_STRUCTURE_TYPE_BIND_IMAGE_MEMORY_INFO,
+                        .pNext = &nb,
+                        .image = swapchain.images[idx].image,
+                        .memory = VK_NULL_HANDLE,
+                        .memoryOffset = 0,
+                    };
+                    result = GetData(device).driver.BindImageMemory2(device, 1, &bimi);
+                    if (result != VK_SUCCESS) {
+                        // This shouldn't really happen. If it does, something is probably
+                        // unrecoverably wrong with the swapchain and its images. Cancel
+                        // the buffer and declare the swapchain broken.
+                        ALOGE("failed to do deferred gralloc buffer bind");
+                        window->cancelBuffer(window, buffer, fence_fd);
+                        return VK_ERROR_OUT_OF_DATE_KHR;
+                    }
+
+                    swapchain.images[idx].dequeued = true;
+                    swapchain.images[idx].dequeue_fence = fence_fd;
+                    swapchain.images[idx].buffer = buffer;
+                    break;
+                }
+            }
+        }
+
+        // The buffer doesn't match any slot. This shouldn't normally happen, but is
+        // possible if the bufferqueue is reconfigured behind libvulkan's back. If this
+        // happens, just declare the swapchain to be broken and the app will recreate it.
+        if (idx == swapchain.num_images) {
+            ALOGE("dequeueBuffer returned unrecognized buffer");
+            window->cancelBuffer(window, buffer, fence_fd);
+            return VK_ERROR_OUT_OF_DATE_KHR;
+        }
     }
 
     int fence_clone = -1;
@@ -2394,12 +2624,7 @@ static void SetSwapchainFrameTimestamp(Swapchain &swapchain, const VkPresentTime
 
     // Add a new timing record with the user's presentID and
     // the nativeFrameId.
-    swapchain.timing.emplace_back(pTime, nativeFrameId);
-    if (swapchain.timing.size() > MAX_TIMING_INFOS) {
-        swapchain.timing.erase(
-            swapchain.timing.begin(),
-            swapchain.timing.begin() + swapchain.timing.size() - MAX_TIMING_INFOS);
-    }
+    swapchain.timing.push_back(TimingInfo(pTime, nativeFrameId));
     if (pTime->desiredPresentTime) {
         ALOGV(
             "Calling native_window_set_buffers_timestamp(%" PRId64 ")",
@@ -2410,6 +2635,30 @@ static void SetSwapchainFrameTimestamp(Swapchain &swapchain, const VkPresentTime
     }
 }
 
+// Frame pacing aspect of QueuePresentKHR
+static void SetSwapchainPacedTimestamp(Swapchain &swapchain) {
+    ANativeWindow *window = swapchain.surface.window.get();
+
+    // The compositor timing of the window follows the refresh rate of the
+    // display, without a query to Surface Flinger, once frame timestamps are
+    // enabled.
+    if (!swapchain.frame_timestamps_enabled) {
+        ALOGV("Calling native_window_enable_frame_timestamps(true)");
+        native_window_enable_frame_timestamps(window, true);
+        swapchain.frame_timestamps_enabled = true;
+    }
+    int64_t refresh_duration = 0;
+    if (native_window_get_compositor_timing(window, nullptr, &refresh_duration,
+                                            nullptr) != android::OK ||
+        refresh_duration <= 0) {
+        refresh_duration = swapchain.refresh_duration;
+    }
+
+    const int64_t timestamp =
+        swapchain.pacer.next_present_time(systemTime(), refresh_duration);
+    native_window_set_buffers_timestamp(window, timestamp);
+}
+
 // EXT_swapchain_maintenance1 present mode change
 static bool SetSwapchainPresentMode(ANativeWindow *window, VkPresentModeKHR mode) {
     // There is no dynamic switching between non-shared present modes.
@@ -2492,6 +2741,12 @@ static VkResult PresentOneSwapchain(
                 if (!SetSwapchainPresentMode(window, *pPresentMode))
                     swapchain_result = WorstPresentResult(swapchain_result,
                         VK_ERROR_SURFACE_LOST_KHR);
+                swapchain.frame_pacing =
+                    *pPresentMode == VK_PRESENT_MODE_FIFO_KHR &&
+                    swapchain.frame_pacing_enabled;
+            }
+            if (!pTime && swapchain.frame_pacing) {
+                SetSwapchainPacedTimestamp(swapchain);
             }
 
             err = window->queueBuffer(window, img.buffer.get(), fence);